@@ -123,7 +123,7 @@ hip_gpu_bench:
 endif
 
 # Wrapped OpenMP linker dependencies for NVCC
-$(CUDA_BENCH_EXEC): $(CUDA_BENCH_OBJ) $(OPENMP_BIT_HELPERS_OBJ)
+$(CUDA_BENCH_EXEC): $(CUDA_BENCH_OBJ) $(OPENMP_BIT_HELPERS_OBJ) $(BENCH_HARNESS_OBJ) $(BENCH_PERF_OBJ)
 	$(NVCC) -o $@ $^ -lm -Xlinker --no-as-needed $(HOST_OPENMP_LIBS) -Xlinker --as-needed
 
 # Added CONFIG_STAMP dependency here
@@ -131,7 +131,7 @@ $(CUDA_BENCH_OBJ): $(CUDA_BENCH_SRC) $(CONFIG_STAMP)
 	$(NVCC) $(NVCC_FLAGS) $(NVCC_ARCH_FLAGS) -c $< -o $@
 
 # Wrapped OpenMP linker dependencies for HIPCC
-$(HIP_BENCH_EXEC): $(HIP_BENCH_OBJ) $(OPENMP_BIT_HELPERS_OBJ)
+$(HIP_BENCH_EXEC): $(HIP_BENCH_OBJ) $(OPENMP_BIT_HELPERS_OBJ) $(BENCH_HARNESS_OBJ) $(BENCH_PERF_OBJ)
 	$(HIPCC) --hip-link -lstdc++ -o $@ $^ -lm -Wl,--no-as-needed $(HOST_OPENMP_LIBS) -Wl,--as-needed
 
 # Added CONFIG_STAMP dependency here
@@ -168,6 +168,6 @@ clean-bench:
 	rm -f $(BUILD_DIR)/cuda_gpu_benchmark $(BUILD_DIR)/cuda_gpu_benchmark.o $(BUILD_DIR)/hip_gpu_benchmark $(BUILD_DIR)/hip_gpu_benchmark.o $(BUILD_DIR)/openmp_bit_nocpu.o
 	rm -f $(BENCH_OMP_NO_CPU_GPUTL_REGISTRY_OBJ) $(BENCH_OMP_NO_CPU_GPUTL_FSM_OBJ) $(BENCH_OMP_NO_CPU_GPUTL_KERNELS_OBJ)
 	rm -f $(BUILD_DIR)/openmp_bit_nocpu
-	rm -f $(OPENMP_BIT_HELPERS_OBJ)
+	rm -f $(OPENMP_BIT_HELPERS_OBJ) $(BENCH_HARNESS_OBJ) $(BENCH_PERF_OBJ) $(BENCH_ROOFLINE_OBJ) $(BENCH_DATA_OBJ)
 
 distclean-bench: clean-bench
\ No newline at end of file
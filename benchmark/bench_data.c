@@ -0,0 +1,403 @@
+/*
+    Workload generators and dataset loaders of the benchmarks (see
+    bench_data.h)
+*/
+#define _GNU_SOURCE // getline
+
+#include "bench_data.h"
+#include <ctype.h>
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define DATA_SPEC_MAX 256
+#define ZIPF_MAX_BITS (1 << 24) // larger bitsets draw their bits uniformly
+
+typedef enum { DATA_UNIFORM, DATA_FINGERPRINT, DATA_KMER, DATA_FILE } data_kind;
+
+typedef struct {
+  int *bits; // set bits
+  int count;
+} data_file_row;
+
+static struct {
+  bool parsed, enabled;
+  data_kind kind;
+  char spec[DATA_SPEC_MAX];
+  char params[DATA_SPEC_MAX + 8];
+  double density, spread, skew, noise, dup;
+  long kmers; // 0 for bits / 8
+  int clusters;
+  uint64_t seed;
+  // fingerprints: bit positions in decreasing frequency, and the cumulative
+  // Zipf weights of those ranks, for the length they were built for
+  int zipf_length;
+  int *zipf_bits;
+  double *zipf_cdf;
+  data_file_row *file_rows;
+  int file_nrows;
+} data;
+
+static void data_error(const char *what) {
+  fprintf(stderr, "Error: BENCH_DATA '%s': %s\n", data.spec, what);
+  exit(EXIT_FAILURE);
+}
+
+static uint64_t splitmix(uint64_t *state) {
+  uint64_t z = (*state += 0x9E3779B97F4A7C15ULL);
+  z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+  z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+  return z ^ (z >> 31);
+}
+
+static double uniform01(uint64_t *state) {
+  return (double)(splitmix(state) >> 11) * 0x1.0p-53;
+}
+
+static double normal(uint64_t *state) {
+  const double u = uniform01(state), v = uniform01(state);
+  return sqrt(-2.0 * log(u > 0 ? u : 0x1.0p-53)) * cos(6.283185307179586 * v);
+}
+
+/* Stream of one row (or centroid) of one set */
+static uint64_t row_state(uint64_t tag, int set, int index) {
+  uint64_t state = data.seed * 0x100000001B3ULL ^ tag;
+  state ^= ((uint64_t)(uint32_t)set << 32 | (uint32_t)index) *
+           0xD6E8FEB86659FD93ULL;
+  splitmix(&state);
+  return state;
+}
+
+static void load_file(const char *path) {
+  FILE *file = fopen(path, "r");
+  if (!file)
+    data_error("cannot open the file");
+  const bool fps = strncmp(data.spec, "fps", 3) == 0;
+  int capacity = 0;
+  char *line = NULL;
+  size_t line_capacity = 0;
+  while (getline(&line, &line_capacity, file) > 0) {
+    if (line[0] == '#' || line[0] == '\n')
+      continue;
+    int *bits = NULL, count = 0, bits_capacity = 0;
+    if (fps) {
+      // hex digits up to the tab before the id, LSB of every byte first
+      for (int i = 0; isxdigit((unsigned char)line[i]); i++) {
+        const int c = tolower((unsigned char)line[i]);
+        const int nibble = isdigit(c) ? c - '0' : c - 'a' + 10;
+        // two digits per byte, the high nibble first
+        const int base = (i / 2) * 8 + (i % 2 ? 0 : 4);
+        for (int b = 0; b < 4; b++) {
+          if (!(nibble >> b & 1))
+            continue;
+          if (count == bits_capacity) {
+            bits_capacity = bits_capacity ? 2 * bits_capacity : 64;
+            bits = realloc(bits, bits_capacity * sizeof(int));
+            if (!bits)
+              data_error("out of memory");
+          }
+          bits[count++] = base + b;
+        }
+      }
+    } else {
+      for (char *p = line, *end; *p; p = end) {
+        const long bit = strtol(p, &end, 10);
+        if (end == p) {
+          end = p + 1; // separators
+          continue;
+        }
+        if (bit < 0)
+          data_error("negative bit index in the file");
+        if (count == bits_capacity) {
+          bits_capacity = bits_capacity ? 2 * bits_capacity : 64;
+          bits = realloc(bits, bits_capacity * sizeof(int));
+          if (!bits)
+            data_error("out of memory");
+        }
+        bits[count++] = bit > INT32_MAX ? INT32_MAX : (int)bit;
+      }
+    }
+    if (data.file_nrows == capacity) {
+      capacity = capacity ? 2 * capacity : 1024;
+      data.file_rows = realloc(data.file_rows, capacity * sizeof(*data.file_rows));
+      if (!data.file_rows)
+        data_error("out of memory");
+    }
+    data.file_rows[data.file_nrows++] = (data_file_row){bits, count};
+  }
+  free(line);
+  fclose(file);
+  if (data.file_nrows == 0)
+    data_error("the file has no rows");
+}
+
+static void parse(void) {
+  data.parsed = true;
+  const char *spec = getenv("BENCH_DATA");
+  if (!spec || !*spec)
+    return;
+  data.enabled = true;
+  snprintf(data.spec, sizeof(data.spec), "%s", spec);
+  snprintf(data.params, sizeof(data.params), " data=%s", spec);
+  data.seed = 1;
+  data.noise = 0.0;
+  data.spread = 0.6;
+  char path[DATA_SPEC_MAX] = "";
+  const size_t kind_len = strcspn(spec, ":");
+  if (strncmp(spec, "uniform", kind_len) == 0 && kind_len == 7) {
+    data.kind = DATA_UNIFORM;
+    data.density = 0.5;
+  } else if (strncmp(spec, "fingerprint", kind_len) == 0 && kind_len == 11) {
+    data.kind = DATA_FINGERPRINT;
+    data.density = 0.05;
+    data.skew = 1.0;
+  } else if (strncmp(spec, "kmer", kind_len) == 0 && kind_len == 4) {
+    data.kind = DATA_KMER;
+    data.spread = 0.3;
+    data.clusters = 64;
+    data.noise = 0.2;
+  } else if ((strncmp(spec, "fps", kind_len) == 0 && kind_len == 3) ||
+             (strncmp(spec, "indices", kind_len) == 0 && kind_len == 7)) {
+    data.kind = DATA_FILE;
+  } else {
+    data_error("unknown kind; use uniform, fingerprint, kmer, fps or indices");
+  }
+  // key=value pairs after the kind
+  for (const char *p = spec[kind_len] ? spec + kind_len + 1 : ""; *p;) {
+    const size_t len = strcspn(p, ",");
+    char pair[DATA_SPEC_MAX];
+    snprintf(pair, sizeof(pair), "%.*s", (int)len, p);
+    char *value = strchr(pair, '=');
+    if (!value)
+      data_error("parameters are key=value");
+    *value++ = '\0';
+    char *end;
+    const double number = strtod(value, &end);
+    const bool numeric = *value && !*end;
+    if (strcmp(pair, "path") == 0)
+      snprintf(path, sizeof(path), "%s", value);
+    else if (!numeric)
+      data_error("parameter values other than path are numbers");
+    else if (strcmp(pair, "density") == 0 && number > 0 && number <= 1)
+      data.density = number;
+    else if (strcmp(pair, "spread") == 0 && number >= 0)
+      data.spread = number;
+    else if (strcmp(pair, "skew") == 0 && number >= 0)
+      data.skew = number;
+    else if (strcmp(pair, "kmers") == 0 && number >= 1)
+      data.kmers = (long)number;
+    else if (strcmp(pair, "clusters") == 0 && number >= 0)
+      data.clusters = (int)number;
+    else if (strcmp(pair, "noise") == 0 && number >= 0 && number <= 1)
+      data.noise = number;
+    else if (strcmp(pair, "dup") == 0 && number >= 0 && number < 1)
+      data.dup = number;
+    else if (strcmp(pair, "seed") == 0)
+      data.seed = (uint64_t)number;
+    else
+      data_error("unknown parameter or value out of range");
+    p += len + (p[len] == ',');
+  }
+  if (data.kind == DATA_FILE) {
+    if (!*path)
+      data_error("fps and indices need path=<file>");
+    load_file(path);
+  }
+}
+
+bool bench_data_enabled(void) {
+  if (!data.parsed)
+    parse();
+  return data.enabled;
+}
+
+const char *bench_data_params(void) {
+  return bench_data_enabled() ? data.params : "";
+}
+
+/* Ranks of the fingerprint bits: a fixed permutation of the positions,
+   with Zipf(skew) weights by rank */
+static void build_zipf(int length) {
+  if (data.zipf_length == length)
+    return;
+  free(data.zipf_bits);
+  free(data.zipf_cdf);
+  data.zipf_bits = malloc(length * sizeof(int));
+  data.zipf_cdf = malloc(length * sizeof(double));
+  if (!data.zipf_bits || !data.zipf_cdf)
+    data_error("out of memory");
+  uint64_t state = row_state(0x5A1FULL, 0, 0);
+  for (int i = 0; i < length; i++)
+    data.zipf_bits[i] = i;
+  for (int i = length - 1; i > 0; i--) {
+    const int j = (int)(splitmix(&state) % (uint64_t)(i + 1));
+    const int t = data.zipf_bits[i];
+    data.zipf_bits[i] = data.zipf_bits[j];
+    data.zipf_bits[j] = t;
+  }
+  double sum = 0;
+  for (int i = 0; i < length; i++)
+    data.zipf_cdf[i] = sum += pow(i + 1, -data.skew);
+  for (int i = 0; i < length; i++)
+    data.zipf_cdf[i] /= sum;
+  data.zipf_length = length;
+}
+
+/* One bit drawn from the distribution of the generator */
+static int draw_bit(int length, uint64_t *state) {
+  if (data.kind != DATA_FINGERPRINT || data.skew == 0 ||
+      length > ZIPF_MAX_BITS)
+    return (int)(splitmix(state) % (uint64_t)length);
+  const double u = uniform01(state);
+  int lo = 0, hi = length - 1;
+  while (lo < hi) {
+    const int mid = lo + (hi - lo) / 2;
+    if (data.zipf_cdf[mid] < u)
+      lo = mid + 1;
+    else
+      hi = mid;
+  }
+  return data.zipf_bits[lo];
+}
+
+/* A row of the generator, without clusters or duplicates */
+static void generate(Bit_T row, uint64_t *state) {
+  const int length = Bit_length(row);
+  if (data.kind == DATA_UNIFORM) {
+    for (int i = 0; i < length; i++)
+      if (uniform01(state) < data.density)
+        Bit_bset(row, i);
+    return;
+  }
+  // log-normal popcount (fingerprints) or k-mer count (sketches), whose
+  // mean is the target: median = mean * exp(-spread^2 / 2)
+  const double mean = data.kind == DATA_KMER
+                          ? (double)(data.kmers ? data.kmers : length / 8)
+                          : data.density * length;
+  double draws = mean * exp(data.spread * (normal(state) - data.spread / 2));
+  if (draws < 1)
+    draws = 1;
+  if (data.kind == DATA_FINGERPRINT) {
+    if (draws > length)
+      draws = length;
+    build_zipf(length);
+    // distinct bits up to the popcount; skewed draws repeat, so give up
+    // after a few rounds of misses
+    for (long set = 0, tries = 0; set < (long)draws && tries < 16 * draws;
+         tries++) {
+      const int bit = draw_bit(length, state);
+      if (!Bit_get(row, bit)) {
+        Bit_bset(row, bit);
+        set++;
+      }
+    }
+  } else {
+    // every k-mer hashes to a bit, colliding as in a real sketch
+    for (long k = 0; k < (long)draws; k++)
+      Bit_bset(row, draw_bit(length, state));
+  }
+}
+
+static void file_row(Bit_T row, int set, int index) {
+  const int start = set == BENCH_DATA_REFERENCES ? data.file_nrows / 2 : 0;
+  const data_file_row *r =
+      &data.file_rows[(int)(((int64_t)start + index) % data.file_nrows)];
+  const int length = Bit_length(row);
+  for (int i = 0; i < r->count; i++)
+    if (r->bits[i] < length)
+      Bit_bset(row, r->bits[i]);
+}
+
+void bench_data_row(Bit_T row, int set, int index) {
+  if (!bench_data_enabled())
+    return;
+  const int length = Bit_length(row);
+  Bit_clear(row, 0, length - 1);
+  if (data.kind == DATA_FILE) {
+    file_row(row, set, index);
+    return;
+  }
+  uint64_t state = row_state(0xD0FULL, set, index);
+  // a duplicate of an earlier row of the set
+  if (index > 0 && uniform01(&state) < data.dup) {
+    bench_data_row(row, set, (int)(splitmix(&state) % (uint64_t)index));
+    return;
+  }
+  if (data.clusters <= 0) {
+    generate(row, &state);
+    return;
+  }
+  // a copy of its centroid, shared by both sets, with a fraction noise of
+  // the set bits moved to bits drawn from the generator
+  const int cluster = (int)(splitmix(&state) % (uint64_t)data.clusters);
+  uint64_t centroid_state = row_state(0xCE27ULL, 0, cluster);
+  generate(row, &centroid_state);
+  if (data.noise > 0) {
+    if (data.kind == DATA_FINGERPRINT)
+      build_zipf(length);
+    int moved = 0;
+    for (int bit = Bit_next_set(row, 0); bit >= 0;
+         bit = bit + 1 < length ? Bit_next_set(row, bit + 1) : -1) {
+      if (uniform01(&state) < data.noise) {
+        Bit_bclear(row, bit);
+        moved++;
+      }
+    }
+    while (moved-- > 0)
+      Bit_bset(row, draw_bit(length, &state));
+  }
+}
+
+static int compare_int(const void *a, const void *b) {
+  const int x = *(const int *)a, y = *(const int *)b;
+  return (x > y) - (x < y);
+}
+
+/* Popcounts of the rows, sorted, as mean and percentiles */
+static void describe(int *popcounts, int n, int length, int set) {
+  if (n <= 0)
+    return;
+  qsort(popcounts, n, sizeof(int), compare_int);
+  double sum = 0;
+  for (int i = 0; i < n; i++)
+    sum += popcounts[i];
+  printf("Dataset %s, %s: %d rows of %d bits, popcount mean %.1f "
+         "(%.2f%%), p5 %d, median %d, p95 %d, max %d\n",
+         data.spec, set == BENCH_DATA_QUERIES ? "queries" : "references", n,
+         length, sum / n, 100.0 * sum / n / length, popcounts[n / 20],
+         popcounts[n / 2], popcounts[n - 1 - n / 20], popcounts[n - 1]);
+}
+
+void bench_data_fill(Bit_T *rows, int n, int set) {
+  if (!bench_data_enabled() || n <= 0)
+    return;
+  int *popcounts = malloc(n * sizeof(int));
+  if (!popcounts)
+    data_error("out of memory");
+  for (int i = 0; i < n; i++) {
+    bench_data_row(rows[i], set, i);
+    popcounts[i] = Bit_count(rows[i]);
+  }
+  describe(popcounts, n, Bit_length(rows[0]), set);
+  free(popcounts);
+}
+
+void bench_data_fill_db(Bit_DB_T db, int set) {
+  const int n = BitDB_nelem(db);
+  if (!bench_data_enabled() || n <= 0)
+    return;
+  int *popcounts = malloc(n * sizeof(int));
+  if (!popcounts)
+    data_error("out of memory");
+  Bit_T row = Bit_new(BitDB_length(db));
+  for (int i = 0; i < n; i++) {
+    bench_data_row(row, set, i);
+    popcounts[i] = Bit_count(row);
+    BitDB_put_at(db, i, row);
+  }
+  describe(popcounts, n, BitDB_length(db), set);
+  Bit_free(&row);
+  free(popcounts);
+}
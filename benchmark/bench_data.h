@@ -0,0 +1,65 @@
+#ifndef BENCH_DATA_H
+#define BENCH_DATA_H
+
+/*
+  Workloads of the container benchmarks, chosen by BENCH_DATA. Unset, the
+  benchmarks keep their own fill (the upper half of every row set); set, the
+  rows come from one of these generators or a file:
+
+    uniform:density=0.5            every bit set with probability density
+    fingerprint:density=0.05,spread=0.6,skew=1
+                                   chemical fingerprints: popcounts drawn
+                                   from a log-normal of mean density * bits
+                                   and shape spread (long-tailed), bits drawn
+                                   with Zipf(skew) frequencies, so that a few
+                                   keys are set in most rows
+    kmer:kmers=<bits/8>,spread=0.3 k-mer sketches: kmers hashed k-mers per
+                                   row (log-normal genome sizes), families
+                                   of related genomes by default
+                                   (clusters=64,noise=0.2)
+    fps:path=<file>                rows of a chemfp FPS file (hex
+                                   fingerprints, '#' header lines)
+    indices:path=<file>            one row per line, its set bits as
+                                   integers
+
+  and, for every generator:
+    clusters=C,noise=f   rows are copies of C centroids with a fraction f
+                         of their set bits moved elsewhere
+    dup=f                a fraction f of the rows duplicate an earlier row
+    seed=s               seed of the rows (1)
+
+  Rows are a function of the seed, the set (queries or references) and the
+  row index only, so every run and every benchmark sees the same data, and
+  the two sets share their centroids. Rows of a file are cycled when the
+  benchmark asks for more, the references starting halfway through; bits
+  past the benchmark's length are dropped.
+*/
+
+#include "bit.h"
+#include <stdbool.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+enum { BENCH_DATA_QUERIES, BENCH_DATA_REFERENCES };
+
+/* Whether BENCH_DATA is set; exits on a malformed specification */
+bool bench_data_enabled(void);
+
+/* " data=<BENCH_DATA>" to append to the params of a case, "" if unset */
+const char *bench_data_params(void);
+
+/* Row index of set (BENCH_DATA_QUERIES or BENCH_DATA_REFERENCES) into row,
+   which is cleared first */
+void bench_data_row(Bit_T row, int set, int index);
+
+/* The n rows of set, and a summary of their popcounts on stdout */
+void bench_data_fill(Bit_T *rows, int n, int set);
+void bench_data_fill_db(Bit_DB_T db, int set);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // BENCH_DATA_H
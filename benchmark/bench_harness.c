@@ -0,0 +1,535 @@
+/*
+    Benchmark harness shared by the benchmark programs (see bench_harness.h)
+*/
+#define _GNU_SOURCE // sched_setaffinity, gethostname
+
+#include "bench_harness.h"
+#include "bench_perf.h"
+#include <math.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#ifdef __linux__
+#include <sched.h>
+#endif
+
+typedef struct {
+  char *name;
+  char *params;
+  char *unit;
+  double work;
+  double bytes;
+  double words;
+  int warmup; // -1 for samples recorded by the caller
+  int64_t check;
+  double *samples; // sorted
+  size_t count;
+  int ncounters; // hardware counters per repetition, see bench_perf.h
+  const char *counter_names[BENCH_PERF_MAX_EVENTS];
+  double counters[BENCH_PERF_MAX_EVENTS];
+} bench_result;
+
+static bench_case *cases;
+static size_t ncases, cases_capacity;
+static bench_result *results;
+static size_t nresults, results_capacity;
+static double roof_bytes_per_s, roof_words_per_s;
+
+int64_t bench_now_ns(void) {
+  struct timespec now;
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  return (int64_t)now.tv_sec * 1000000000 + now.tv_nsec;
+}
+
+static int env_int(const char *name, int fallback) {
+  const char *value = getenv(name);
+  return value && *value ? atoi(value) : fallback;
+}
+
+bench_config bench_config_default(const char *program) {
+  bench_config config = {.warmup = 1,
+                         .repetitions = 10,
+                         .pin_cpu = -1,
+                         .format = BENCH_TEXT,
+                         .output = NULL,
+                         .program = program};
+  config.warmup = env_int("BENCH_WARMUP", config.warmup);
+  config.repetitions = env_int("BENCH_REPETITIONS", config.repetitions);
+  config.pin_cpu = env_int("BENCH_PIN", config.pin_cpu);
+  const char *format = getenv("BENCH_FORMAT");
+  if (format && strcmp(format, "json") == 0)
+    config.format = BENCH_JSON;
+  else if (format && strcmp(format, "csv") == 0)
+    config.format = BENCH_CSV;
+  const char *output = getenv("BENCH_OUTPUT");
+  if (output && *output)
+    config.output = output;
+  if (config.warmup < 0)
+    config.warmup = 0;
+  if (config.repetitions < 1)
+    config.repetitions = 1;
+  return config;
+}
+
+static void *grow(void *items, size_t *capacity, size_t size) {
+  const size_t wanted = *capacity ? 2 * *capacity : 16;
+  void *grown = realloc(items, wanted * size);
+  if (!grown) {
+    fprintf(stderr, "Error: out of memory in the benchmark harness\n");
+    exit(EXIT_FAILURE);
+  }
+  *capacity = wanted;
+  return grown;
+}
+
+static char *copy_string(const char *s) {
+  char *copy = malloc(strlen(s ? s : "") + 1);
+  if (!copy) {
+    fprintf(stderr, "Error: out of memory in the benchmark harness\n");
+    exit(EXIT_FAILURE);
+  }
+  return strcpy(copy, s ? s : "");
+}
+
+void bench_register(const bench_case *c) {
+  if (ncases == cases_capacity)
+    cases = grow(cases, &cases_capacity, sizeof(bench_case));
+  cases[ncases++] = *c;
+}
+
+static int compare_doubles(const void *a, const void *b) {
+  const double x = *(const double *)a, y = *(const double *)b;
+  return (x > y) - (x < y);
+}
+
+static void add_result(const char *name, const char *params, double work,
+                       const char *unit, double bytes, double words,
+                       int warmup, double *samples, size_t count,
+                       int64_t check) {
+  if (nresults == results_capacity)
+    results = grow(results, &results_capacity, sizeof(bench_result));
+  qsort(samples, count, sizeof(double), compare_doubles);
+  results[nresults++] = (bench_result){
+      copy_string(name), copy_string(params), copy_string(unit), work, bytes,
+      words, warmup, check, samples, count, 0, {NULL}, {0}};
+}
+
+void bench_set_roofs(double bytes_per_s, double words_per_s) {
+  roof_bytes_per_s = bytes_per_s;
+  roof_words_per_s = words_per_s;
+}
+
+void bench_record(const char *name, const char *params, double work,
+                  const char *unit, const double *samples_ns, size_t count,
+                  int64_t check) {
+  double *samples = malloc((count ? count : 1) * sizeof(double));
+  if (!samples) {
+    fprintf(stderr, "Error: out of memory in the benchmark harness\n");
+    exit(EXIT_FAILURE);
+  }
+  memcpy(samples, samples_ns, count * sizeof(double));
+  add_result(name, params, work, unit, 0.0, 0.0, -1, samples, count, check);
+}
+
+/* --- Statistics --- */
+
+typedef struct {
+  double min, median, p95, max, mean, stddev, ci_low, ci_high;
+} bench_stats;
+
+/* Two-sided 95% quantile of Student's t with df degrees of freedom */
+static double student_t95(size_t df) {
+  static const double t[] = {12.706, 4.303, 3.182, 2.776, 2.571, 2.447,
+                             2.365,  2.306, 2.262, 2.228, 2.201, 2.179,
+                             2.160,  2.145, 2.131, 2.120, 2.110, 2.101,
+                             2.093,  2.086, 2.080, 2.074, 2.069, 2.064,
+                             2.060,  2.056, 2.052, 2.048, 2.045, 2.042};
+  if (df == 0)
+    return 0.0;
+  if (df <= sizeof(t) / sizeof(t[0]))
+    return t[df - 1];
+  return 1.960 + 2.4 / (double)df; // within 0.2% of the quantile past 30
+}
+
+/* Median, nearest-rank 95th percentile, and the mean with its 95%
+   confidence interval, of sorted samples */
+static bench_stats compute_stats(const double *s, size_t n) {
+  bench_stats st = {0};
+  if (n == 0)
+    return st;
+  st.min = s[0];
+  st.max = s[n - 1];
+  st.median = n % 2 ? s[n / 2] : 0.5 * (s[n / 2 - 1] + s[n / 2]);
+  st.p95 = s[(size_t)ceil(0.95 * (double)n) - 1];
+  double sum = 0.0;
+  for (size_t i = 0; i < n; i++)
+    sum += s[i];
+  st.mean = sum / (double)n;
+  double squares = 0.0;
+  for (size_t i = 0; i < n; i++)
+    squares += (s[i] - st.mean) * (s[i] - st.mean);
+  st.stddev = n > 1 ? sqrt(squares / (double)(n - 1)) : 0.0;
+  const double half = student_t95(n - 1) * st.stddev / sqrt((double)n);
+  st.ci_low = st.mean - half;
+  st.ci_high = st.mean + half;
+  return st;
+}
+
+/* Rates of a result at its median, as fractions of the roofs; the bound is
+   the roof the result is nearer to */
+typedef struct {
+  double bytes_per_s, words_per_s, bandwidth_fraction, popcount_fraction;
+  const char *bound; // "memory", "compute", or "" if not known
+} bench_roofline;
+
+static bench_roofline compute_roofline(const bench_result *res,
+                                       const bench_stats *st) {
+  bench_roofline rl = {.bound = ""};
+  if (st->median <= 0)
+    return rl;
+  rl.bytes_per_s = res->bytes * 1e9 / st->median;
+  rl.words_per_s = res->words * 1e9 / st->median;
+  if (roof_bytes_per_s > 0)
+    rl.bandwidth_fraction = rl.bytes_per_s / roof_bytes_per_s;
+  if (roof_words_per_s > 0)
+    rl.popcount_fraction = rl.words_per_s / roof_words_per_s;
+  if (rl.bandwidth_fraction > 0 || rl.popcount_fraction > 0)
+    rl.bound =
+        rl.bandwidth_fraction >= rl.popcount_fraction ? "memory" : "compute";
+  return rl;
+}
+
+/* --- Output --- */
+
+static void json_string(FILE *out, const char *s) {
+  fputc('"', out);
+  for (; *s; s++) {
+    const unsigned char c = (unsigned char)*s;
+    if (c == '"' || c == '\\')
+      fprintf(out, "\\%c", c);
+    else if (c < 0x20)
+      fprintf(out, "\\u%04x", c);
+    else
+      fputc(c, out);
+  }
+  fputc('"', out);
+}
+
+/* Field of a CSV row, quoted when it holds a separator or a quote */
+static void csv_string(FILE *out, const char *s) {
+  if (!strpbrk(s, ",\"\n")) {
+    fputs(s, out);
+    return;
+  }
+  fputc('"', out);
+  for (; *s; s++) {
+    if (*s == '"')
+      fputc('"', out);
+    fputc(*s, out);
+  }
+  fputc('"', out);
+}
+
+/* Counter of a result by name, NAN if it was not counted */
+static double counter(const bench_result *res, const char *name) {
+  for (int i = 0; i < res->ncounters; i++)
+    if (strcmp(res->counter_names[i], name) == 0)
+      return res->counters[i];
+  return NAN;
+}
+
+/* Ratios of the counters that go together, where both were counted */
+static void write_counter_ratios(FILE *out, const bench_result *res) {
+  static const struct {
+    const char *name, *numerator, *denominator;
+    double scale;
+  } ratios[] = {
+      {"IPC", "instructions", "cycles", 1},
+      {"branch miss %", "branch-misses", "branches", 100},
+      {"cache miss %", "cache-misses", "cache-references", 100},
+      {"L1D load miss %", "L1-dcache-load-misses", "L1-dcache-loads", 100},
+      {"LLC load miss %", "LLC-load-misses", "LLC-loads", 100},
+      {"dTLB load miss %", "dTLB-load-misses", "dTLB-loads", 100},
+      {"backend stall %", "stalled-cycles-backend", "cycles", 100},
+  };
+  for (size_t i = 0; i < sizeof(ratios) / sizeof(ratios[0]); i++) {
+    const double n = counter(res, ratios[i].numerator);
+    const double d = counter(res, ratios[i].denominator);
+    if (!isnan(n) && !isnan(d) && d > 0)
+      fprintf(out, "%-40s %-32s %-24s %16.3f\n", "", "", ratios[i].name,
+              ratios[i].scale * n / d);
+  }
+}
+
+static void write_counters_text(FILE *out) {
+  bool counted = false;
+  for (size_t r = 0; r < nresults; r++)
+    counted = counted || results[r].ncounters > 0;
+  if (!counted)
+    return;
+  fprintf(out, "\nHardware counters per timed repetition (all threads)\n");
+  fprintf(out, "%-40s %-32s %-24s %16s\n", "benchmark", "params", "counter",
+          "value");
+  for (size_t r = 0; r < nresults; r++) {
+    const bench_result *res = &results[r];
+    for (int i = 0; i < res->ncounters; i++) {
+      fprintf(out, "%-40s %-32s %-24s ", i ? "" : res->name,
+              i ? "" : res->params, res->counter_names[i]);
+      if (isnan(res->counters[i]))
+        fprintf(out, "%16s\n", "not counted");
+      else
+        fprintf(out, "%16.0f\n", res->counters[i]);
+    }
+    write_counter_ratios(out, res);
+  }
+}
+
+static void write_text(FILE *out, const bench_config *config) {
+  fprintf(out, "%-40s %-32s %12s %12s %12s %12s %14s  %s\n", "benchmark",
+          "params", "median ns", "p95 ns", "mean ns", "+/- 95% ns",
+          "throughput/s", "check");
+  for (size_t r = 0; r < nresults; r++) {
+    const bench_result *res = &results[r];
+    const bench_stats st = compute_stats(res->samples, res->count);
+    fprintf(out, "%-40s %-32s %12.0f %12.0f %12.0f %12.0f ", res->name,
+            res->params, st.median, st.p95, st.mean, st.mean - st.ci_low);
+    if (res->work > 0 && st.median > 0)
+      fprintf(out, "%14.4g  ", res->work * 1e9 / st.median);
+    else
+      fprintf(out, "%14s  ", "-");
+    fprintf(out, "%lld\n", (long long)res->check);
+  }
+  fprintf(out, "(%d warm-up and %d timed repetitions per case)\n",
+          config->warmup, config->repetitions);
+
+  write_counters_text(out);
+
+  bool roofline = false;
+  for (size_t r = 0; r < nresults; r++)
+    roofline = roofline || results[r].bytes > 0 || results[r].words > 0;
+  if (!roofline)
+    return;
+  fprintf(out, "\nRoofline (machine: %.2f GB/s read, %.3g popcounted words/s)\n",
+          roof_bytes_per_s / 1e9, roof_words_per_s);
+  fprintf(out, "%-40s %-32s %12s %10s %8s %12s %8s  %s\n", "benchmark",
+          "params", "MB moved", "GB/s", "% bw", "Gwords/s", "% pop", "bound");
+  for (size_t r = 0; r < nresults; r++) {
+    const bench_result *res = &results[r];
+    if (res->bytes <= 0 && res->words <= 0)
+      continue;
+    const bench_stats st = compute_stats(res->samples, res->count);
+    const bench_roofline rl = compute_roofline(res, &st);
+    fprintf(out, "%-40s %-32s %12.3f %10.2f %8.1f %12.3f %8.1f  %s\n",
+            res->name, res->params, res->bytes / 1e6, rl.bytes_per_s / 1e9,
+            100.0 * rl.bandwidth_fraction, rl.words_per_s / 1e9,
+            100.0 * rl.popcount_fraction, rl.bound);
+  }
+}
+
+
+static void write_json(FILE *out, const bench_config *config) {
+  char host[256] = "";
+  gethostname(host, sizeof(host) - 1);
+  char date[32] = "";
+  const time_t now = time(NULL);
+  struct tm utc;
+  gmtime_r(&now, &utc);
+  strftime(date, sizeof(date), "%Y-%m-%dT%H:%M:%SZ", &utc);
+
+  fprintf(out, "{\n  \"schema\": \"%s\",\n  \"context\": {\"program\": ",
+          BENCH_SCHEMA);
+  json_string(out, config->program ? config->program : "");
+  fprintf(out, ", \"host\": ");
+  json_string(out, host);
+  fprintf(out,
+          ", \"date\": \"%s\", \"warmup\": %d, \"repetitions\": %d, "
+          "\"pinned_cpu\": %d,\n              \"roof_bytes_per_s\": %.17g, "
+          "\"roof_words_per_s\": %.17g},\n  \"results\": [",
+          date, config->warmup, config->repetitions, config->pin_cpu,
+          roof_bytes_per_s, roof_words_per_s);
+  for (size_t r = 0; r < nresults; r++) {
+    const bench_result *res = &results[r];
+    const bench_stats st = compute_stats(res->samples, res->count);
+    const bench_roofline rl = compute_roofline(res, &st);
+    fprintf(out, "%s\n    {\"name\": ", r ? "," : "");
+    json_string(out, res->name);
+    fprintf(out, ", \"params\": ");
+    json_string(out, res->params);
+    fprintf(out, ", \"unit\": ");
+    json_string(out, res->unit);
+    fprintf(out, ", \"work\": %.17g, \"warmup\": ", res->work);
+    if (res->warmup < 0)
+      fprintf(out, "null");
+    else
+      fprintf(out, "%d", res->warmup);
+    fprintf(out,
+            ", \"repetitions\": %zu,\n     \"min_ns\": %.17g, "
+            "\"median_ns\": %.17g, \"p95_ns\": %.17g, \"max_ns\": %.17g, "
+            "\"mean_ns\": %.17g, \"stddev_ns\": %.17g,\n     "
+            "\"ci95_low_ns\": %.17g, \"ci95_high_ns\": %.17g, "
+            "\"throughput_per_s\": %.17g, \"check\": %lld,\n     "
+            "\"bytes\": %.17g, \"words\": %.17g, \"bytes_per_s\": %.17g, "
+            "\"words_per_s\": %.17g,\n     \"bandwidth_fraction\": %.17g, "
+            "\"popcount_fraction\": %.17g, \"bound\": ",
+            res->count, st.min, st.median, st.p95, st.max, st.mean, st.stddev,
+            st.ci_low, st.ci_high,
+            res->work > 0 && st.median > 0 ? res->work * 1e9 / st.median : 0.0,
+            (long long)res->check, res->bytes, res->words, rl.bytes_per_s,
+            rl.words_per_s, rl.bandwidth_fraction, rl.popcount_fraction);
+    json_string(out, rl.bound);
+    fprintf(out, ",\n     \"counters\": {");
+    for (int i = 0; i < res->ncounters; i++) {
+      fprintf(out, "%s", i ? ", " : "");
+      json_string(out, res->counter_names[i]);
+      if (isnan(res->counters[i]))
+        fprintf(out, ": null");
+      else
+        fprintf(out, ": %.17g", res->counters[i]);
+    }
+    fprintf(out, "},\n     \"samples_ns\": [");
+    for (size_t i = 0; i < res->count; i++)
+      fprintf(out, "%s%.17g", i ? ", " : "", res->samples[i]);
+    fprintf(out, "]}");
+  }
+  fprintf(out, "\n  ]\n}\n");
+}
+
+/* One row per result; the header is written to an empty file only, so
+   several runs can append to one file */
+static void write_csv(FILE *out, const bench_config *config) {
+  if (fseek(out, 0, SEEK_END) != 0 || ftell(out) <= 0)
+    fprintf(out, "schema,program,name,params,unit,work,warmup,repetitions,"
+                 "min_ns,median_ns,p95_ns,max_ns,mean_ns,stddev_ns,"
+                 "ci95_low_ns,ci95_high_ns,throughput_per_s,check,bytes,"
+                 "words,bytes_per_s,words_per_s,bandwidth_fraction,"
+                 "popcount_fraction,bound,counters\n");
+  for (size_t r = 0; r < nresults; r++) {
+    const bench_result *res = &results[r];
+    const bench_stats st = compute_stats(res->samples, res->count);
+    const bench_roofline rl = compute_roofline(res, &st);
+    fprintf(out, "%s,", BENCH_SCHEMA);
+    csv_string(out, config->program ? config->program : "");
+    fputc(',', out);
+    csv_string(out, res->name);
+    fputc(',', out);
+    csv_string(out, res->params);
+    fputc(',', out);
+    csv_string(out, res->unit);
+    fprintf(out, ",%.17g,", res->work);
+    if (res->warmup >= 0)
+      fprintf(out, "%d", res->warmup);
+    fprintf(out, ",%zu,%.17g,%.17g,%.17g,%.17g,%.17g,%.17g,%.17g,%.17g,%.17g,"
+                 "%lld,%.17g,%.17g,%.17g,%.17g,%.17g,%.17g,%s,",
+            res->count, st.min, st.median, st.p95, st.max, st.mean, st.stddev,
+            st.ci_low, st.ci_high,
+            res->work > 0 && st.median > 0 ? res->work * 1e9 / st.median : 0.0,
+            (long long)res->check, res->bytes, res->words, rl.bytes_per_s,
+            rl.words_per_s, rl.bandwidth_fraction, rl.popcount_fraction,
+            rl.bound);
+    // name=value pairs separated by semicolons; counters not counted are left
+    // out
+    for (int i = 0, n = 0; i < res->ncounters; i++)
+      if (!isnan(res->counters[i]))
+        fprintf(out, "%s%s=%.17g", n++ ? ";" : "", res->counter_names[i],
+                res->counters[i]);
+    fputc('\n', out);
+  }
+}
+
+/* --- Runs --- */
+
+static void pin_thread(int cpu) {
+  if (cpu < 0)
+    return;
+#ifdef __linux__
+  cpu_set_t set;
+  CPU_ZERO(&set);
+  CPU_SET(cpu, &set);
+  if (sched_setaffinity(0, sizeof(set), &set) != 0)
+    fprintf(stderr, "Warning: could not pin the benchmark to CPU %d\n", cpu);
+#else
+  fprintf(stderr, "Warning: BENCH_PIN is not supported on this system\n");
+#endif
+}
+
+int bench_run(const bench_config *config) {
+  pin_thread(config->pin_cpu);
+  for (size_t c = 0; c < ncases; c++) {
+    const bench_case *bc = &cases[c];
+    double *samples = malloc((size_t)config->repetitions * sizeof(double));
+    if (!samples) {
+      fprintf(stderr, "Error: out of memory in the benchmark harness\n");
+      exit(EXIT_FAILURE);
+    }
+    if (bc->setup)
+      bc->setup(bc->arg);
+    int64_t check = 0;
+    for (int w = 0; w < config->warmup; w++)
+      check = bc->body(bc->arg);
+    // after the warm-up, so that the threads of the case exist
+    const bool counted = bench_perf_open() > 0;
+    for (int r = 0; r < config->repetitions; r++) {
+      if (counted)
+        bench_perf_start();
+      const int64_t start = bench_now_ns();
+      check = bc->body(bc->arg);
+      samples[r] = (double)(bench_now_ns() - start);
+      if (counted)
+        bench_perf_stop();
+    }
+    const char *names[BENCH_PERF_MAX_EVENTS];
+    double totals[BENCH_PERF_MAX_EVENTS];
+    const int ncounters =
+        counted ? bench_perf_read(names, totals, BENCH_PERF_MAX_EVENTS) : 0;
+    bench_perf_close();
+    if (bc->teardown)
+      bc->teardown(bc->arg);
+    add_result(bc->name, bc->params, bc->work, bc->unit, bc->bytes, bc->words,
+               config->warmup, samples, (size_t)config->repetitions, check);
+    bench_result *res = &results[nresults - 1];
+    res->ncounters = ncounters;
+    for (int i = 0; i < ncounters; i++) {
+      res->counter_names[i] = names[i];
+      res->counters[i] = totals[i] / config->repetitions;
+    }
+  }
+
+  FILE *out = stdout;
+  if (config->output) {
+    out = fopen(config->output, config->format == BENCH_CSV ? "a" : "w");
+    if (!out) {
+      fprintf(stderr, "Error: unable to open benchmark output '%s'\n",
+              config->output);
+      out = NULL;
+    }
+  }
+  if (out) {
+    if (config->format == BENCH_JSON)
+      write_json(out, config);
+    else if (config->format == BENCH_CSV)
+      write_csv(out, config);
+    else
+      write_text(out, config);
+  }
+  const int status = out && !ferror(out) ? 0 : -1;
+  if (out && out != stdout)
+    fclose(out);
+  else if (out)
+    fflush(out);
+
+  for (size_t r = 0; r < nresults; r++) {
+    free(results[r].name);
+    free(results[r].params);
+    free(results[r].unit);
+    free(results[r].samples);
+  }
+  free(results);
+  free(cases);
+  results = NULL;
+  cases = NULL;
+  nresults = results_capacity = ncases = cases_capacity = 0;
+  return status;
+}
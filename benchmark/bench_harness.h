@@ -0,0 +1,97 @@
+#ifndef BENCH_HARNESS_H
+#define BENCH_HARNESS_H
+
+/*
+  Benchmark harness shared by the benchmark programs: registered cases,
+  untimed warm-up, timed repetitions, robust statistics, and one output
+  format (text for people, JSON or CSV of schema BENCH_SCHEMA for scripts).
+
+  A program registers its cases, then calls bench_run once. Each case gets
+  its own setup and teardown around the repetitions, which stay untimed;
+  body is one repetition, timed as a whole with CLOCK_MONOTONIC, and its
+  return value is kept as the check of the case (a count, a maximum, ...)
+  so that scripts can see two runs computed the same thing. Samples timed
+  by the program itself (GPU events, transfer phases) join the results
+  through bench_record.
+
+  A case that also gives the bytes it moves and the words it popcounts per
+  repetition is placed against the roofs of the machine (bench_set_roofs,
+  measured by bench_roofline.h): its GB/s and popcounted words/s are shown
+  as fractions of the machine's, and the nearer roof names the bound.
+
+  Settings come from bench_config_default, then the environment:
+    BENCH_WARMUP       untimed repetitions per case (default 1)
+    BENCH_REPETITIONS  timed repetitions per case (default 10)
+    BENCH_FORMAT       text, json or csv (default text)
+    BENCH_OUTPUT       file the results go to (default stdout)
+    BENCH_PIN          CPU the calling thread is pinned to (default none);
+                       OpenMP threads created afterwards inherit the pin, so
+                       use OMP_PLACES / OMP_PROC_BIND for parallel cases
+    BENCH_PERF         hardware counter groups read around the timed
+                       repetitions of every case (default none), see
+                       bench_perf.h
+*/
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Version of the JSON and CSV layout, bumped on incompatible changes; the
+   JSON layout is described by benchmark/bench_schema.json */
+#define BENCH_SCHEMA "bit-bench/3"
+
+typedef enum { BENCH_TEXT, BENCH_JSON, BENCH_CSV } bench_format;
+
+typedef struct {
+  int warmup;          // untimed repetitions before the timed ones
+  int repetitions;     // timed repetitions, at least 1
+  int pin_cpu;         // CPU of the calling thread, -1 to leave it
+  bench_format format;
+  const char *output;  // path of the results, NULL for stdout
+  const char *program; // name recorded with the results
+} bench_config;
+
+typedef struct {
+  const char *name;   // what is measured, e.g. "Bit_count"
+  const char *params; // its parameters, "key=value" separated by spaces
+  double work;        // units of work per repetition, 0 for none
+  const char *unit;   // name of the units of work, e.g. "searches"
+  void (*setup)(void *arg);    // before the first repetition, or NULL
+  int64_t (*body)(void *arg);  // one repetition; returns the check
+  void (*teardown)(void *arg); // after the last repetition, or NULL
+  void *arg;
+  double bytes; // bytes moved to and from memory per repetition, or 0
+  double words; // 64-bit words popcounted per repetition, or 0
+} bench_case;
+
+/* Monotonic clock in nanoseconds */
+int64_t bench_now_ns(void);
+
+/* Defaults, then the BENCH_* variables of the environment */
+bench_config bench_config_default(const char *program);
+
+/* Case run by bench_run; name, params, unit and arg must outlive it */
+void bench_register(const bench_case *c);
+
+/* Result of count samples in nanoseconds measured by the caller; the
+   strings and samples are copied */
+void bench_record(const char *name, const char *params, double work,
+                  const char *unit, const double *samples_ns, size_t count,
+                  int64_t check);
+
+/* Memory bandwidth (bytes/s) and popcount rate (words/s) the results are
+   compared against; 0 for a roof that was not measured */
+void bench_set_roofs(double bytes_per_s, double words_per_s);
+
+/* Run the registered cases in order, then write them and the recorded
+   results. Returns 0, or -1 if the output could not be written */
+int bench_run(const bench_config *config);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // BENCH_HARNESS_H
@@ -0,0 +1,301 @@
+/*
+    Hardware performance counters of the timed repetitions (see bench_perf.h)
+*/
+#define _GNU_SOURCE // syscall
+
+#include "bench_perf.h"
+#include <math.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef __linux__
+#include <dirent.h>
+#include <errno.h>
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#define PERF_GROUP_EVENTS 8
+#define PERF_RAW_NAME 48
+
+typedef struct {
+  const char *name;
+  uint32_t type;
+  uint64_t config;
+} perf_event_def;
+
+typedef struct {
+  const char *name;
+  int nevents;
+  perf_event_def events[PERF_GROUP_EVENTS];
+} perf_group_def;
+
+#define HW(name, id) {name, PERF_TYPE_HARDWARE, PERF_COUNT_HW_##id}
+#define SW(name, id) {name, PERF_TYPE_SOFTWARE, PERF_COUNT_SW_##id}
+#define CACHE(name, cache, op, result)                                         \
+  {name, PERF_TYPE_HW_CACHE,                                                   \
+   PERF_COUNT_HW_CACHE_##cache | PERF_COUNT_HW_CACHE_OP_##op << 8 |            \
+       PERF_COUNT_HW_CACHE_RESULT_##result << 16}
+
+/* Named after the perf stat events they match, so that scripts can read
+   either */
+static const perf_group_def builtin_groups[] = {
+    {"core",
+     4,
+     {HW("cycles", CPU_CYCLES), HW("instructions", INSTRUCTIONS),
+      HW("branches", BRANCH_INSTRUCTIONS), HW("branch-misses", BRANCH_MISSES)}},
+    {"cache",
+     4,
+     {HW("cache-references", CACHE_REFERENCES),
+      HW("cache-misses", CACHE_MISSES),
+      CACHE("L1-dcache-loads", L1D, READ, ACCESS),
+      CACHE("L1-dcache-load-misses", L1D, READ, MISS)}},
+    {"llc",
+     2,
+     {CACHE("LLC-loads", LL, READ, ACCESS),
+      CACHE("LLC-load-misses", LL, READ, MISS)}},
+    {"tlb",
+     4,
+     {CACHE("dTLB-loads", DTLB, READ, ACCESS),
+      CACHE("dTLB-load-misses", DTLB, READ, MISS),
+      CACHE("iTLB-loads", ITLB, READ, ACCESS),
+      CACHE("iTLB-load-misses", ITLB, READ, MISS)}},
+    {"stalls",
+     2,
+     {HW("stalled-cycles-frontend", STALLED_CYCLES_FRONTEND),
+      HW("stalled-cycles-backend", STALLED_CYCLES_BACKEND)}},
+    {"os",
+     4,
+     {SW("task-clock", TASK_CLOCK), SW("page-faults", PAGE_FAULTS),
+      SW("context-switches", CONTEXT_SWITCHES),
+      SW("cpu-migrations", CPU_MIGRATIONS)}},
+};
+#define NBUILTIN (int)(sizeof(builtin_groups) / sizeof(builtin_groups[0]))
+
+static perf_group_def raw_group = {"raw", 0, {{0}}};
+static char raw_names[PERF_GROUP_EVENTS][PERF_RAW_NAME];
+#define NGROUPS (NBUILTIN + 1) // the built-in groups, then raw_group
+
+static const perf_group_def *groups[NGROUPS]; // the groups being counted
+static bool supported[NGROUPS];
+static int ngroups;
+static bool warned[NGROUPS];
+static int *fds; // [thread][group][event], -1 where not opened
+static int nthreads, threads_capacity;
+
+static int *thread_fds(int t, int g) {
+  return fds + ((size_t)t * NGROUPS + g) * PERF_GROUP_EVENTS;
+}
+
+/* BENCH_PERF_RAW: name=0xconfig,... */
+static void parse_raw(void) {
+  raw_group.nevents = 0;
+  const char *spec = getenv("BENCH_PERF_RAW");
+  while (spec && *spec && raw_group.nevents < PERF_GROUP_EVENTS) {
+    const char *end = strchr(spec, ',');
+    const size_t len = end ? (size_t)(end - spec) : strlen(spec);
+    const char *equals = memchr(spec, '=', len);
+    if (equals && equals > spec && (size_t)(equals - spec) < PERF_RAW_NAME) {
+      char *name = raw_names[raw_group.nevents];
+      memcpy(name, spec, (size_t)(equals - spec));
+      name[equals - spec] = '\0';
+      raw_group.events[raw_group.nevents++] = (perf_event_def){
+          name, PERF_TYPE_RAW, strtoull(equals + 1, NULL, 0)};
+    } else {
+      fprintf(stderr, "Warning: BENCH_PERF_RAW entry '%.*s' is not "
+                      "name=config\n", (int)len, spec);
+    }
+    spec = end ? end + 1 : NULL;
+  }
+}
+
+/* Groups named by BENCH_PERF */
+static void select_groups(void) {
+  ngroups = 0;
+  const char *spec = getenv("BENCH_PERF");
+  if (!spec || !*spec || strcmp(spec, "0") == 0)
+    return;
+  parse_raw();
+  const bool all = strcmp(spec, "all") == 0;
+  for (int g = 0; g < NGROUPS; g++) {
+    const perf_group_def *def = g < NBUILTIN ? &builtin_groups[g] : &raw_group;
+    const size_t len = strlen(def->name);
+    bool wanted = all;
+    for (const char *s = spec; !wanted && (s = strstr(s, def->name)); s++)
+      wanted = (s == spec || s[-1] == ',') && (s[len] == ',' || !s[len]);
+    if (wanted && def->nevents > 0) {
+      supported[ngroups] = true;
+      groups[ngroups++] = def;
+    }
+  }
+}
+
+static int open_event(const perf_event_def *event, pid_t tid, int group_fd) {
+  struct perf_event_attr attr;
+  memset(&attr, 0, sizeof(attr));
+  attr.size = sizeof(attr);
+  attr.type = event->type;
+  attr.config = event->config;
+  attr.disabled = group_fd == -1; // members follow their leader
+  // context switches and migrations happen in the kernel, so the software
+  // events count there too where perf_event_paranoid allows it
+  attr.exclude_kernel = event->type != PERF_TYPE_SOFTWARE;
+  attr.exclude_hv = 1;
+  attr.read_format = PERF_FORMAT_GROUP | PERF_FORMAT_TOTAL_TIME_ENABLED |
+                     PERF_FORMAT_TOTAL_TIME_RUNNING;
+  int fd = (int)syscall(SYS_perf_event_open, &attr, tid, -1, group_fd,
+                        PERF_FLAG_FD_CLOEXEC);
+  if (fd < 0 && errno == EACCES && !attr.exclude_kernel) {
+    attr.exclude_kernel = 1;
+    fd = (int)syscall(SYS_perf_event_open, &attr, tid, -1, group_fd,
+                      PERF_FLAG_FD_CLOEXEC);
+  }
+  return fd;
+}
+
+/* Every event of a group on thread tid into out, the leader first; all -1
+   if one of them cannot be opened */
+static bool open_group(const perf_group_def *group, pid_t tid, int *out) {
+  for (int e = 0; e < PERF_GROUP_EVENTS; e++)
+    out[e] = -1;
+  for (int e = 0; e < group->nevents; e++) {
+    out[e] = open_event(&group->events[e], tid, e ? out[0] : -1);
+    if (out[e] < 0) {
+      const int saved = errno;
+      for (int o = 0; o < e; o++) {
+        close(out[o]);
+        out[o] = -1;
+      }
+      errno = saved;
+      return false;
+    }
+  }
+  return true;
+}
+
+static void add_thread(pid_t tid, bool first) {
+  if (nthreads == threads_capacity) {
+    threads_capacity = threads_capacity ? 2 * threads_capacity : 64;
+    fds = realloc(fds, (size_t)threads_capacity * NGROUPS *
+                           PERF_GROUP_EVENTS * sizeof(int));
+    if (!fds) {
+      fprintf(stderr, "Error: out of memory in the benchmark harness\n");
+      exit(EXIT_FAILURE);
+    }
+  }
+  const int t = nthreads++;
+  for (int g = 0; g < ngroups; g++) {
+    int *out = thread_fds(t, g);
+    if (!supported[g]) {
+      for (int e = 0; e < PERF_GROUP_EVENTS; e++)
+        out[e] = -1;
+      continue;
+    }
+    // the calling thread decides what this CPU and kernel support
+    if (!open_group(groups[g], tid, out) && first) {
+      const int w = groups[g] == &raw_group ? NBUILTIN
+                                            : (int)(groups[g] - builtin_groups);
+      if (!warned[w])
+        fprintf(stderr, "Warning: hardware counters '%s' unavailable: %s\n",
+                groups[g]->name, strerror(errno));
+      warned[w] = true;
+      supported[g] = false;
+    }
+  }
+}
+
+int bench_perf_open(void) {
+  bench_perf_close();
+  select_groups();
+  if (ngroups == 0)
+    return 0;
+  const pid_t self = (pid_t)syscall(SYS_gettid);
+  add_thread(self, true);
+  DIR *tasks = opendir("/proc/self/task");
+  for (struct dirent *task; tasks && (task = readdir(tasks));) {
+    const pid_t tid = (pid_t)atoi(task->d_name);
+    if (tid > 0 && tid != self)
+      add_thread(tid, false);
+  }
+  if (tasks)
+    closedir(tasks);
+  int nevents = 0;
+  for (int g = 0; g < ngroups; g++)
+    nevents += supported[g] ? groups[g]->nevents : 0;
+  if (nevents == 0)
+    bench_perf_close();
+  return nevents < BENCH_PERF_MAX_EVENTS ? nevents : BENCH_PERF_MAX_EVENTS;
+}
+
+static void perf_ioctl(unsigned long request) {
+  for (int t = 0; t < nthreads; t++)
+    for (int g = 0; g < ngroups; g++)
+      if (thread_fds(t, g)[0] >= 0)
+        ioctl(thread_fds(t, g)[0], request, PERF_IOC_FLAG_GROUP);
+}
+
+void bench_perf_start(void) { perf_ioctl(PERF_EVENT_IOC_ENABLE); }
+
+void bench_perf_stop(void) { perf_ioctl(PERF_EVENT_IOC_DISABLE); }
+
+int bench_perf_read(const char **names, double *values, int max) {
+  int n = 0;
+  for (int g = 0; g < ngroups; g++) {
+    if (!supported[g])
+      continue;
+    const int nevents = groups[g]->nevents;
+    double sums[PERF_GROUP_EVENTS] = {0};
+    double enabled = 0, running = 0;
+    for (int t = 0; t < nthreads; t++) {
+      // nr, time enabled, time running, then the values
+      uint64_t buf[3 + PERF_GROUP_EVENTS];
+      const int leader = thread_fds(t, g)[0];
+      if (leader < 0 ||
+          read(leader, buf, sizeof(buf)) < (ssize_t)(3 * sizeof(uint64_t)))
+        continue;
+      enabled += (double)buf[1];
+      running += (double)buf[2];
+      for (uint64_t e = 0; e < buf[0] && e < (uint64_t)nevents; e++)
+        sums[e] += (double)buf[3 + e];
+    }
+    for (int e = 0; e < nevents && n < max; e++, n++) {
+      names[n] = groups[g]->events[e].name;
+      // a group time-sliced out for the whole region was never counted
+      values[n] = running > 0   ? sums[e] * enabled / running
+                  : enabled > 0 ? NAN
+                                : 0.0;
+    }
+  }
+  return n;
+}
+
+void bench_perf_close(void) {
+  for (int t = 0; t < nthreads; t++)
+    for (int g = 0; g < ngroups; g++)
+      for (int e = 0; e < PERF_GROUP_EVENTS; e++)
+        if (thread_fds(t, g)[e] >= 0)
+          close(thread_fds(t, g)[e]);
+  nthreads = 0;
+}
+
+#else // no perf_event_open
+
+int bench_perf_open(void) {
+  const char *spec = getenv("BENCH_PERF");
+  if (spec && *spec && strcmp(spec, "0") != 0)
+    fprintf(stderr, "Warning: BENCH_PERF is not supported on this system\n");
+  return 0;
+}
+void bench_perf_start(void) {}
+void bench_perf_stop(void) {}
+int bench_perf_read(const char **names, double *values, int max) {
+  (void)names, (void)values, (void)max;
+  return 0;
+}
+void bench_perf_close(void) {}
+
+#endif
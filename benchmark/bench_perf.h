@@ -0,0 +1,58 @@
+#ifndef BENCH_PERF_H
+#define BENCH_PERF_H
+
+/*
+  Hardware performance counters of the timed repetitions, read in process
+  with perf_event_open so that setup, allocation, warm-up and verification
+  stay out of them. bench_run opens the counters on every thread of the
+  process once a case has warmed up (so the OpenMP team exists), enables
+  them around each timed repetition only, and reports the totals per
+  repetition, summed over the threads.
+
+  BENCH_PERF selects the counter groups, comma separated, or "all":
+    core    cycles, instructions, branches, branch-misses
+    cache   cache-references, cache-misses, L1-dcache-loads,
+            L1-dcache-load-misses
+    llc     LLC-loads, LLC-load-misses
+    tlb     dTLB-loads, dTLB-load-misses, iTLB-loads, iTLB-load-misses
+    stalls  stalled-cycles-frontend, stalled-cycles-backend
+    os      task-clock, page-faults, context-switches, cpu-migrations
+            (software events, available in virtual machines too)
+    raw     the events of BENCH_PERF_RAW, "name=0xconfig" comma separated,
+            e.g. the port dispatch events of the CPU at hand
+  All groups are opened in one pass; when they need more counters than the
+  PMU has, the kernel time-slices them and the values are scaled by the
+  time each group was counting. Only user-space events of this process are
+  counted, which perf_event_paranoid <= 2 allows (the os group also counts
+  in the kernel where it may). A group the CPU or the kernel does not
+  support is skipped with a warning.
+*/
+
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define BENCH_PERF_MAX_EVENTS 32
+
+/* Counters of BENCH_PERF opened on every thread; returns how many events
+   are counted, 0 if none (BENCH_PERF unset, or no counters available) */
+int bench_perf_open(void);
+
+/* Count from now on / stop counting, on every thread */
+void bench_perf_start(void);
+void bench_perf_stop(void);
+
+/* Names and totals of the counted events, scaled for time-slicing and
+   summed over the threads; a group that was never scheduled reads NaN.
+   Returns the number of events, at most max */
+int bench_perf_read(const char **names, double *values, int max);
+
+void bench_perf_close(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // BENCH_PERF_H
@@ -0,0 +1,402 @@
+/* Replay of a workload capture (Bit_capture_start, BIT_CAPTURE_FILE).
+
+   Every captured call is issued again, with the shapes and the opts it was
+   recorded with, by as many threads as the capture saw, each thread in
+   its recorded order. The rows are drawn per length and side: uniform at
+   the density of the capture (BIT_CAPTURE_DATA, else one half), the rows
+   of BENCH_DATA, or those of a BitDB_save snapshot, cycled, when one is
+   given. The per call kind results put the replayed times against the
+   captured ones.
+
+     BENCH_REPLAY_PACE  recorded (default) starts every call no earlier than
+                        it started in the capture; asap issues them back to
+                        back
+*/
+#define _POSIX_C_SOURCE 199309L
+
+#include "bit.h"
+#include "bench_data.h"
+#include "bench_harness.h"
+#include <omp.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+static const char *const call_names[BIT_CAPTURE_CALLS] = {
+    "replay_count_cpu",      "replay_count_gpu",
+    "replay_topk_cpu",       "replay_topk_gpu",
+    "replay_threshold_cpu",  "replay_threshold_gpu",
+    "replay_similarity_topk", "replay_similarity_threshold"};
+
+/* Rows of one length and side (queries, targets), as many as the largest
+   call needs; a call wraps the first rows it uses */
+typedef struct {
+  uint32_t length;
+  int side;
+  uint32_t rows;
+  double ones, bits; // captured set bits, over the bits they were seen in
+  uint64_t *buffer;
+} row_pool;
+
+typedef struct {
+  row_pool *pools;
+  size_t npools;
+} pool_list;
+
+static row_pool *pool_find(pool_list *list, uint32_t length, int side) {
+  for (size_t i = 0; i < list->npools; ++i) {
+    if (list->pools[i].length == length && list->pools[i].side == side) {
+      return &list->pools[i];
+    }
+  }
+  list->pools = realloc(list->pools, (list->npools + 1) * sizeof(row_pool));
+  if (list->pools == NULL) {
+    fputs("Unable to allocate the row pools\n", stderr);
+    exit(EXIT_FAILURE);
+  }
+  list->pools[list->npools] = (row_pool){.length = length, .side = side};
+  return &list->pools[list->npools++];
+}
+
+static uint64_t xorshift(uint64_t *state) {
+  uint64_t x = *state;
+  x ^= x << 13;
+  x ^= x >> 7;
+  x ^= x << 17;
+  return *state = x;
+}
+
+/* Word with each bit set with probability (numerator / 256) */
+static uint64_t random_word(uint64_t *state, unsigned int numerator) {
+  uint64_t word = 0;
+  for (int bit = 0; bit < 8; ++bit) {
+    const uint64_t r = xorshift(state);
+    word = (numerator >> bit) & 1u ? word | r : word & r;
+  }
+  return numerator >= 256 ? ~UINT64_C(0) : word;
+}
+
+static void pool_fill(row_pool *pool, Bit_DB_T snapshot) {
+  const size_t row_bytes = (size_t)Bit_buffer_size((int)pool->length);
+  const size_t words = row_bytes / sizeof(uint64_t);
+  pool->buffer = aligned_alloc(64, pool->rows * row_bytes);
+  if (pool->buffer == NULL) {
+    fputs("Unable to allocate the replay rows\n", stderr);
+    exit(EXIT_FAILURE);
+  }
+  memset(pool->buffer, 0, pool->rows * row_bytes);
+
+  Bit_DB_T source = NULL;
+  if (snapshot != NULL && BitDB_length(snapshot) == (int)pool->length) {
+    source = snapshot;
+  } else if (bench_data_enabled()) {
+    source = BitDB_new((int)pool->length, (int)pool->rows);
+    bench_data_fill_db(source, pool->side == 0 ? BENCH_DATA_QUERIES
+                                               : BENCH_DATA_REFERENCES);
+  }
+  if (source != NULL) {
+    const int nsource = BitDB_nelem(source);
+    for (uint32_t i = 0; i < pool->rows; ++i) {
+      BitDB_extract_from(source, (int)(i % (uint32_t)nsource),
+                         pool->buffer + i * words);
+    }
+    if (source != snapshot) {
+      BitDB_free(&source);
+    }
+    return;
+  }
+
+  const double density = pool->bits > 0 ? pool->ones / pool->bits : 0.5;
+  const unsigned int numerator = (unsigned int)(density * 256.0 + 0.5);
+  const unsigned int tail = pool->length % 64;
+  const uint64_t tail_mask =
+      tail == 0 ? ~UINT64_C(0) : (UINT64_C(1) << tail) - 1;
+  const size_t used = (pool->length + 63) / 64;
+  uint64_t state = UINT64_C(0x9E3779B97F4A7C15) ^ pool->length ^
+                   ((uint64_t)pool->side << 32);
+  for (uint32_t i = 0; i < pool->rows; ++i) {
+    uint64_t *row = pool->buffer + i * words;
+    for (size_t w = 0; w < used; ++w) {
+      row[w] = random_word(&state, numerator);
+    }
+    row[used - 1] &= tail_mask;
+  }
+}
+
+/* Output buffers of one replaying thread, sized for its largest call */
+typedef struct {
+  void *counts;
+  int *idx;
+  int *ints;
+  float *sims;
+  size_t *offsets;
+} thread_buffers;
+
+static SETOP_COUNT_OPTS record_opts(const Bit_capture_record *r) {
+  return (SETOP_COUNT_OPTS){.num_cpu_threads = r->num_cpu_threads,
+                            .device_id = r->device_id,
+                            .bit_lo = r->bit_lo,
+                            .bit_hi = r->bit_hi,
+                            .algorithm = r->algorithm,
+                            .isa = r->isa,
+                            .store = r->store,
+                            .exec = r->exec};
+}
+
+/* Issue one recorded call; returns a check of its output */
+static int64_t replay_call(const Bit_capture_record *r, Bit_DB_T q,
+                           Bit_DB_T t, thread_buffers *out) {
+  const SETOP_COUNT_OPTS opts = record_opts(r);
+  const Bit_similarity sim = {.metric = r->op, .alpha = 1.0, .beta = 1.0};
+  int *idx = NULL, *ints = NULL;
+  float *sims = NULL;
+  size_t found = 0;
+
+  switch (r->call) {
+  case BIT_CAPTURE_COUNT_CPU:
+    BitDB_count_store_typed_cpu(q, t, r->op, out->counts, r->counts_type,
+                                opts);
+    return ((const unsigned char *)out->counts)[0];
+  case BIT_CAPTURE_COUNT_GPU:
+    BitDB_count_store_typed_gpu(q, t, r->op, out->counts, r->counts_type,
+                                opts);
+    return ((const unsigned char *)out->counts)[0];
+  case BIT_CAPTURE_TOPK_CPU:
+    BitDB_inter_count_topk(q, t, r->k, opts, out->idx, out->ints);
+    return out->ints[0];
+  case BIT_CAPTURE_TOPK_GPU:
+    BitDB_inter_count_topk_gpu(q, t, r->k, opts, out->idx, out->ints);
+    return out->ints[0];
+  case BIT_CAPTURE_THRESHOLD_CPU:
+    found = BitDB_inter_count_threshold(q, t, r->k, opts, out->offsets, &idx,
+                                        &ints);
+    break;
+  case BIT_CAPTURE_THRESHOLD_GPU:
+    found = BitDB_inter_count_threshold_gpu(q, t, r->k, opts, out->offsets,
+                                            &idx, &ints);
+    break;
+  case BIT_CAPTURE_SIMILARITY_TOPK:
+    BitDB_similarity_topk(q, t, sim, r->k, opts, out->idx, out->sims);
+    return out->idx[0];
+  case BIT_CAPTURE_SIMILARITY_THRESHOLD:
+    found = BitDB_similarity_threshold(q, t, sim, r->cutoff, opts,
+                                       out->offsets, &idx, &sims);
+    break;
+  }
+  free(idx);
+  free(ints);
+  free(sims);
+  return (int64_t)found;
+}
+
+static size_t counts_bytes(const Bit_capture_record *r) {
+  const size_t cells = (size_t)r->nqueries * r->ntargets;
+  switch (r->counts_type) {
+  case BIT_COUNTS_U8:
+    return cells;
+  case BIT_COUNTS_U16:
+    return cells * sizeof(uint16_t);
+  default:
+    return cells * sizeof(int);
+  }
+}
+
+static void sleep_until(int64_t deadline_ns) {
+  for (int64_t now = bench_now_ns(); now < deadline_ns;
+       now = bench_now_ns()) {
+    const int64_t wait = deadline_ns - now;
+    struct timespec ts = {wait / 1000000000, wait % 1000000000};
+    nanosleep(&ts, NULL);
+  }
+}
+
+static int compare_double(const void *a, const void *b) {
+  const double x = *(const double *)a, y = *(const double *)b;
+  return (x > y) - (x < y);
+}
+
+int main(int argc, char *argv[]) {
+  if (argc != 2 && argc != 3) {
+    fprintf(stderr, "Usage: %s <capture> [snapshot]\n", argv[0]);
+    return EXIT_FAILURE;
+  }
+
+  size_t n = 0;
+  unsigned int flags = 0;
+  Bit_capture_record *records = Bit_capture_load(argv[1], &n, &flags);
+  if (records == NULL || n == 0) {
+    fprintf(stderr, "%s is not a capture or holds no calls\n", argv[1]);
+    free(records);
+    return EXIT_FAILURE;
+  }
+  Bit_DB_T snapshot = NULL;
+  if (argc == 3 && (snapshot = BitDB_open_mmap(argv[2], 0)) == NULL) {
+    fprintf(stderr, "Unable to map the snapshot %s\n", argv[2]);
+    free(records);
+    return EXIT_FAILURE;
+  }
+  const char *pace = getenv("BENCH_REPLAY_PACE");
+  const bool paced = pace == NULL || strcmp(pace, "asap") != 0;
+
+  /* Records are stored in the order the calls returned; replay them in
+     the order they started */
+  for (size_t i = 1; i < n; ++i) {
+    const Bit_capture_record r = records[i];
+    size_t j = i;
+    for (; j > 0 && records[j - 1].start_ns > r.start_ns; --j) {
+      records[j] = records[j - 1];
+    }
+    records[j] = r;
+  }
+
+  pool_list pools = {NULL, 0};
+  uint32_t nthreads = 0;
+  for (size_t i = 0; i < n; ++i) {
+    const Bit_capture_record *r = &records[i];
+    if (r->thread + 1 > nthreads) {
+      nthreads = r->thread + 1;
+    }
+    for (int side = 0; side < (r->self ? 1 : 2); ++side) {
+      row_pool *pool = pool_find(&pools, r->length, side);
+      const uint32_t rows = side == 0 ? r->nqueries : r->ntargets;
+      if (rows > pool->rows) {
+        pool->rows = rows;
+      }
+      if (flags & BIT_CAPTURE_DATA) {
+        pool->ones += (double)(side == 0 ? r->ones_q : r->ones_t);
+        pool->bits += (double)rows * r->length;
+      }
+    }
+  }
+  for (size_t p = 0; p < pools.npools; ++p) {
+    pool_fill(&pools.pools[p], snapshot);
+  }
+
+  /* Containers and output buffers are made before the replay starts */
+  Bit_DB_T *queries = calloc(n, sizeof(*queries));
+  Bit_DB_T *targets = calloc(n, sizeof(*targets));
+  double *replayed_ns = calloc(n, sizeof(*replayed_ns));
+  int64_t *checks = calloc(n, sizeof(*checks));
+  thread_buffers *buffers = calloc(nthreads, sizeof(*buffers));
+  if (!queries || !targets || !replayed_ns || !checks || !buffers) {
+    fputs("Unable to allocate the replay\n", stderr);
+    return EXIT_FAILURE;
+  }
+  for (uint32_t t = 0; t < nthreads; ++t) {
+    size_t counts = 1, cells = 1, offsets = 2;
+    for (size_t i = 0; i < n; ++i) {
+      const Bit_capture_record *r = &records[i];
+      if (r->thread != t) {
+        continue;
+      }
+      const size_t topk = (size_t)r->nqueries * (r->k > 0 ? r->k : 1);
+      counts = counts_bytes(r) > counts ? counts_bytes(r) : counts;
+      cells = topk > cells ? topk : cells;
+      offsets = r->nqueries + 1u > offsets ? r->nqueries + 1u : offsets;
+    }
+    buffers[t] = (thread_buffers){malloc(counts),
+                                  malloc(cells * sizeof(int)),
+                                  malloc(cells * sizeof(int)),
+                                  malloc(cells * sizeof(float)),
+                                  malloc(offsets * sizeof(size_t))};
+  }
+  for (size_t i = 0; i < n; ++i) {
+    const Bit_capture_record *r = &records[i];
+    queries[i] = BitDB_load((int)r->length, (int)r->nqueries,
+                            pool_find(&pools, r->length, 0)->buffer);
+    targets[i] =
+        r->self ? queries[i]
+                : BitDB_load((int)r->length, (int)r->ntargets,
+                             pool_find(&pools, r->length, 1)->buffer);
+  }
+
+  print_Bit_configuration();
+  printf("Replaying %zu calls of %s on %u threads (%s)\n", n, argv[1],
+         nthreads, paced ? "recorded pace" : "asap");
+
+  /* One thread per captured thread; the calls nest their own teams */
+  omp_set_max_active_levels(2);
+  const int64_t replay_start = bench_now_ns();
+#pragma omp parallel num_threads(nthreads)
+  {
+    const uint32_t t = (uint32_t)omp_get_thread_num();
+    for (size_t i = 0; i < n; ++i) {
+      const Bit_capture_record *r = &records[i];
+      if (r->thread != t) {
+        continue;
+      }
+      if (paced) {
+        sleep_until(replay_start + (int64_t)r->start_ns);
+      }
+      const int64_t start = bench_now_ns();
+      checks[i] = replay_call(r, queries[i], targets[i], &buffers[t]);
+      replayed_ns[i] = (double)(bench_now_ns() - start);
+    }
+  }
+  const double replay_ns = (double)(bench_now_ns() - replay_start);
+
+  for (int call = 0; call < BIT_CAPTURE_CALLS; ++call) {
+    size_t count = 0;
+    double comparisons = 0;
+    int64_t check = 0;
+    double *captured = malloc(n * sizeof(double));
+    double *samples = malloc(n * sizeof(double));
+    for (size_t i = 0; i < n; ++i) {
+      if (records[i].call != call) {
+        continue;
+      }
+      comparisons += (double)records[i].nqueries * records[i].ntargets;
+      captured[count] = (double)records[i].elapsed_ns;
+      samples[count++] = replayed_ns[i];
+      check += checks[i];
+    }
+    if (count > 0) {
+      qsort(captured, count, sizeof(double), compare_double);
+      char params[256];
+      snprintf(params, sizeof(params),
+               "calls=%zu captured_median_ns=%.0f threads=%u pace=%s%s",
+               count, captured[count / 2], nthreads,
+               paced ? "recorded" : "asap", bench_data_params());
+      bench_record(call_names[call], params, comparisons / (double)count,
+                   "comparisons", samples, count, check);
+    }
+    free(captured);
+    free(samples);
+  }
+  char params[128];
+  snprintf(params, sizeof(params), "calls=%zu threads=%u pace=%s", n,
+           nthreads, paced ? "recorded" : "asap");
+  bench_record("replay", params, (double)n, "calls", &replay_ns, 1, 0);
+  bench_config config = bench_config_default(argv[0]);
+  const int status = bench_run(&config);
+
+  for (size_t i = 0; i < n; ++i) {
+    if (!records[i].self) {
+      BitDB_free(&targets[i]);
+    }
+    BitDB_free(&queries[i]);
+  }
+  for (uint32_t t = 0; t < nthreads; ++t) {
+    free(buffers[t].counts);
+    free(buffers[t].idx);
+    free(buffers[t].ints);
+    free(buffers[t].sims);
+    free(buffers[t].offsets);
+  }
+  for (size_t p = 0; p < pools.npools; ++p) {
+    free(pools.pools[p].buffer);
+  }
+  free(pools.pools);
+  if (snapshot != NULL) {
+    BitDB_free(&snapshot);
+  }
+  free(buffers);
+  free(checks);
+  free(replayed_ns);
+  free(targets);
+  free(queries);
+  free(records);
+  return status == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
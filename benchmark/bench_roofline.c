@@ -0,0 +1,116 @@
+/*
+    Machine roofs and count traffic of the CPU benchmarks (see
+    bench_roofline.h)
+*/
+#include "bench_roofline.h"
+#include "bench_harness.h"
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define BENCH_PROBE_PASSES 5
+// Rows of the popcount probe (32 per thread, at least 128) and their
+// length: a tile pair of 32 rows stays in L2, and long rows keep the count
+// stores out of the way
+#define BENCH_PROBE_ROWS 32
+#define BENCH_PROBE_MIN_ROWS 128
+#define BENCH_PROBE_BITS 16384
+#define BENCH_PROBE_CALLS 20
+
+double bench_probe_bandwidth(int threads) {
+  const char *mb = getenv("BENCH_STREAM_MB");
+  size_t bytes = (size_t)(mb && atoi(mb) > 0 ? atoi(mb) : 256) << 20;
+  const size_t n = bytes / sizeof(uint64_t);
+  uint64_t *a = malloc(n * sizeof(uint64_t));
+  if (!a) {
+    fprintf(stderr, "Warning: no memory for the bandwidth probe\n");
+    return 0.0;
+  }
+  // the threads that read a page touch it first, as in STREAM
+#pragma omp parallel for schedule(static) num_threads(threads)
+  for (size_t i = 0; i < n; i++)
+    a[i] = i;
+
+  double best = 0.0;
+  uint64_t sink = 0;
+  for (int pass = 0; pass < BENCH_PROBE_PASSES; pass++) {
+    uint64_t sum = 0;
+    const int64_t start = bench_now_ns();
+#pragma omp parallel for schedule(static) num_threads(threads) reduction(+ : sum)
+    for (size_t i = 0; i < n; i++)
+      sum += a[i];
+    const int64_t elapsed = bench_now_ns() - start;
+    sink += sum;
+    if (elapsed > 0 && (double)bytes * 1e9 / elapsed > best)
+      best = (double)bytes * 1e9 / elapsed;
+  }
+  free(a);
+  // the sum is n(n-1)/2 per pass; checking it keeps the loads alive
+  if (sink != (uint64_t)BENCH_PROBE_PASSES * (n * (n - 1) / 2))
+    fprintf(stderr, "Warning: bandwidth probe computed a wrong sum\n");
+  return best;
+}
+
+double bench_probe_popcount(int threads) {
+  const int rows = BENCH_PROBE_ROWS * threads > BENCH_PROBE_MIN_ROWS
+                       ? BENCH_PROBE_ROWS * threads
+                       : BENCH_PROBE_MIN_ROWS;
+  Bit_DB_T queries = BitDB_new(BENCH_PROBE_BITS, rows);
+  Bit_DB_T targets = BitDB_new(BENCH_PROBE_BITS, rows);
+  Bit_T row = Bit_new(BENCH_PROBE_BITS);
+  Bit_set(row, 0, BENCH_PROBE_BITS / 2);
+  for (int i = 0; i < rows; i++) {
+    BitDB_put_at(queries, i, row);
+    BitDB_put_at(targets, i, row);
+  }
+  Bit_free(&row);
+  int *counts = malloc((size_t)rows * rows * sizeof(int));
+  if (!counts) {
+    fprintf(stderr, "Warning: no memory for the popcount probe\n");
+    BitDB_free(&queries);
+    BitDB_free(&targets);
+    return 0.0;
+  }
+  const SETOP_COUNT_OPTS opts = {.num_cpu_threads = threads};
+  const double words = bench_count_words(rows, rows, BENCH_PROBE_BITS / 64);
+  BitDB_inter_count_store_cpu(queries, targets, counts, opts);
+  double best = 0.0;
+  for (int call = 0; call < BENCH_PROBE_CALLS; call++) {
+    const int64_t start = bench_now_ns();
+    BitDB_inter_count_store_cpu(queries, targets, counts, opts);
+    const int64_t elapsed = bench_now_ns() - start;
+    if (elapsed > 0 && words * 1e9 / elapsed > best)
+      best = words * 1e9 / elapsed;
+  }
+  free(counts);
+  BitDB_free(&queries);
+  BitDB_free(&targets);
+  return best;
+}
+
+void bench_probe_roofs(int threads) {
+  const char *enabled = getenv("BENCH_ROOFLINE");
+  if (enabled && strcmp(enabled, "0") == 0)
+    return;
+  const double bytes_per_s = bench_probe_bandwidth(threads);
+  const double words_per_s = bench_probe_popcount(threads);
+  printf("Machine roofs (%d threads): %.2f GB/s read, %.3g popcounted "
+         "words/s\n",
+         threads, bytes_per_s / 1e9, words_per_s);
+  bench_set_roofs(bytes_per_s, words_per_s);
+}
+
+double bench_count_bytes(int nq, int nt, int words, int tile) {
+  if (tile < 1)
+    tile = 1;
+  const double query_tiles = (double)((nq + tile - 1) / tile);
+  const double target_tiles = (double)((nt + tile - 1) / tile);
+  const double row_bytes = (double)words * sizeof(uint64_t);
+  return row_bytes * ((double)nq * target_tiles + (double)nt * query_tiles) +
+         (double)nq * nt * sizeof(int);
+}
+
+double bench_count_words(int nq, int nt, int words) {
+  return (double)nq * nt * words;
+}
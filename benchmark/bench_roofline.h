@@ -0,0 +1,46 @@
+#ifndef BENCH_ROOFLINE_H
+#define BENCH_ROOFLINE_H
+
+/*
+  Roofs of the machine for the CPU count benchmarks, and the memory traffic
+  of a tiled count, so that bench_harness can tell whether a run is bound by
+  memory bandwidth or by the popcount rate.
+
+  The bandwidth probe is a STREAM-like read (a sum over a buffer far larger
+  than the caches, first touched by the threads that read it); the
+  popcount probe times BitDB_inter_count_store_cpu on containers that stay
+  in cache, the best the count kernels can do when memory is not in the
+  way. Both run with the given number of OpenMP threads and keep the best
+  of a few passes. BENCH_STREAM_MB sets the size of the bandwidth buffer
+  (default 256); BENCH_ROOFLINE=0 skips both probes, e.g. under perf, and
+  the results are then shown without fractions.
+*/
+
+#include "bit.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Read bandwidth in bytes/s */
+double bench_probe_bandwidth(int threads);
+
+/* Popcounted 64-bit words/s of the intersection count kernel */
+double bench_probe_popcount(int threads);
+
+/* Both probes, handed to bench_set_roofs, unless BENCH_ROOFLINE is 0 */
+void bench_probe_roofs(int threads);
+
+/* Bytes a count of nq x nt rows of words qwords moves with square cache
+   tiles of tile rows: every tile pair streams its rows of both operands
+   once, and the 4-byte counts are written once */
+double bench_count_bytes(int nq, int nt, int words, int tile);
+
+/* 64-bit words popcounted by that count */
+double bench_count_words(int nq, int nt, int words);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // BENCH_ROOFLINE_H
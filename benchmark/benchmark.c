@@ -1,258 +1,368 @@
 // Benchmarking code for the bit library
 #define _POSIX_C_SOURCE 199309L
 #include "bit.h"
+#include "bench_harness.h"
 #include "simde_integration.h"
 #include <assert.h>
 
+#include <stdbool.h>
 #include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
-#include <time.h>
 
 #define BPQW (sizeof(unsigned long long) * 8) // bits per qword
 #define BPB (sizeof(unsigned char) * 8)       // bits per byte
 #define nqwords(len)                                                           \
   ((((len) + BPQW - 1) & (~(BPQW - 1))) / BPQW) // ceil(len/QBPW)
 
-// Benchmarking function type definition
-typedef int64_t (*benchmark_func)(int size, int iterations);
+// used to prevent compiler optimization of the result
+#define DO_NOT_OPTIMIZE_AWAY(val) __asm__ volatile("" : : "g"(val) : "memory")
 
-int64_t bench_Bit_aset(int size, int iterations);
-int64_t bench_Bit_aclear(int size, int iterations);
-int64_t bench_Bit_count(int size, int iterations);
-int64_t bench_Bit_inter_count(int size, int iterations);
-int64_t bench_Bit_inter_count_mem(int size, int iterations);
-int64_t bench_Bit_inter(int size, int iterations);
-int64_t bench_Bit_and(int size, int iterations);
-int64_t bench_Bit_and_SIMD(int size, int iterations);
-void summarize_results(char *test, int64_t timeElapsed, int num_of_iterations);
-int64_t timeDiff(struct timespec *timeA_p, struct timespec *timeB_p);
+// Operands of one case, built outside the timed repetitions; a repetition
+// makes iterations calls
+typedef struct {
+  int size;
+  int iterations;
+  Bit_T bit1;
+  Bit_T bit2;
+  int *indices;
+  int length_of_index;
+  unsigned long long *buf1;
+  unsigned long long *buf2;
+  size_t size_in_qwords;
+  char params[32];
+} micro_case;
 
-int64_t bench_Bit_aset(int size, int iterations) {
-  struct timespec start_time, end_time;
-  int64_t timeElapsed = 0;
-  Bit_T bit1 = Bit_new(size);
-  int length_of_index = size / 2 >= 2048 ? 2048 : size / 2;
-  int *indices = malloc((length_of_index) * sizeof(int));
-  for (int i = 0; i < length_of_index; i++) {
-    indices[i] = i;
-  }
-  clock_gettime(CLOCK_MONOTONIC, &start_time);
-  for (int i = 0; i < iterations; i++) {
-    Bit_aset(bit1, indices, length_of_index);
-  }
+// Single-bit accesses of one case: accesses indices of a pattern over a
+// bitset sized for one level of the memory hierarchy. Independent accesses
+// measure throughput; dependent ones feed each result into the next index,
+// so that the accesses serialize and measure latency.
+#define ACCESS_COUNT (1 << 16) // accesses per repetition
+#define ACCESS_BATCH 64        // indices per Bit_aset call
+#define ACCESS_STRIDE 520      // bits: a new cache line every access
+#define ACCESS_CLUSTER 64      // accesses per cluster
+#define ACCESS_WINDOW 4096     // bits a cluster falls in
 
-  clock_gettime(CLOCK_MONOTONIC, &end_time);
-  timeElapsed = timeDiff(&end_time, &start_time);
-  Bit_free(&bit1);
-  free(indices);
-  return timeElapsed;
-}
+typedef enum { PATTERN_RANDOM, PATTERN_STRIDED, PATTERN_CLUSTERED } pattern;
+
+typedef struct {
+  int size;
+  pattern pattern;
+  bool dependent;
+  Bit_T bit;
+  int *indices; // ACCESS_COUNT indices in [0, size - 2], room for + 1
+  char params[80];
+} access_case;
 
-int64_t bench_Bit_aclear(int size, int iterations) {
-  struct timespec start_time, end_time;
-  int64_t timeElapsed = 0;
-  Bit_T bit1 = Bit_new(size);
-  int length_of_index = size / 2 >= 2048 ? 2048 : size / 2;
-  int *indices = malloc((length_of_index) * sizeof(int));
-  for (int i = 0; i < length_of_index; i++) {
-    indices[i] = i;
+void access_setup(void *arg);
+void access_teardown(void *arg);
+int64_t bench_access_get(void *arg);
+int64_t bench_access_bset(void *arg);
+int64_t bench_access_put(void *arg);
+int64_t bench_access_aset(void *arg);
+void micro_setup(void *arg);
+void micro_teardown(void *arg);
+int64_t bench_Bit_aset(void *arg);
+int64_t bench_Bit_aclear(void *arg);
+int64_t bench_Bit_count(void *arg);
+int64_t bench_Bit_inter_count(void *arg);
+int64_t bench_Bit_inter_count_mem(void *arg);
+int64_t bench_Bit_inter(void *arg);
+int64_t bench_Bit_and(void *arg);
+int64_t bench_Bit_and_SIMD(void *arg);
+
+void micro_setup(void *arg) {
+  micro_case *m = arg;
+  m->bit1 = Bit_new(m->size);
+  m->bit2 = Bit_new(m->size);
+  Bit_set(m->bit1, m->size / 2, m->size - 1);
+  Bit_bset(m->bit1, 0);
+  m->length_of_index = m->size / 2 >= 2048 ? 2048 : m->size / 2;
+  m->indices = malloc((m->length_of_index) * sizeof(int));
+  for (int i = 0; i < m->length_of_index; i++) {
+    m->indices[i] = i;
   }
-  clock_gettime(CLOCK_MONOTONIC, &start_time);
-  for (int i = 0; i < iterations; i++) {
-    Bit_aclear(bit1, indices, length_of_index);
+  m->size_in_qwords = nqwords(m->size);
+  size_t size_in_bytes = m->size_in_qwords * BPQW / BPB;
+  m->buf1 = malloc(size_in_bytes);
+  m->buf2 = malloc(size_in_bytes);
+  // Initialize with some data pattern
+  for (size_t i = 0; i < m->size_in_qwords; i++) {
+    m->buf1[i] = i + 1;
+    m->buf2[i] = ~i;
   }
+}
 
-  clock_gettime(CLOCK_MONOTONIC, &end_time);
-  timeElapsed = timeDiff(&end_time, &start_time);
-  Bit_free(&bit1);
-  free(indices);
-  return timeElapsed;
+void micro_teardown(void *arg) {
+  micro_case *m = arg;
+  Bit_free(&m->bit1);
+  Bit_free(&m->bit2);
+  free(m->indices);
+  free(m->buf1);
+  free(m->buf2);
 }
-int64_t bench_Bit_count(int size, int iterations) {
-  struct timespec start_time, end_time;
-  int64_t timeElapsed = 0;
-  volatile int result;
-  Bit_T bit1 = Bit_new(size);
-  Bit_set(bit1, size / 2, size - 1);
-  Bit_bset(bit1, 0);
-  clock_gettime(CLOCK_MONOTONIC, &start_time);
-  for (int i = 0; i < iterations; i++) {
-    result = Bit_count(bit1);
+
+int64_t bench_Bit_aset(void *arg) {
+  micro_case *m = arg;
+  for (int i = 0; i < m->iterations; i++) {
+    Bit_aset(m->bit1, m->indices, m->length_of_index);
   }
+  return Bit_count(m->bit1);
+}
 
-  clock_gettime(CLOCK_MONOTONIC, &end_time);
-  timeElapsed = timeDiff(&end_time, &start_time);
-  Bit_free(&bit1);
-  return timeElapsed;
+int64_t bench_Bit_aclear(void *arg) {
+  micro_case *m = arg;
+  for (int i = 0; i < m->iterations; i++) {
+    Bit_aclear(m->bit1, m->indices, m->length_of_index);
+  }
+  return Bit_count(m->bit1);
 }
 
-int64_t bench_Bit_inter_count(int size, int iterations) {
-  struct timespec start_time, end_time;
-  int64_t timeElapsed = 0;
-  volatile int result;
-  Bit_T bit1 = Bit_new(size);
-  Bit_T bit2 = Bit_new(size);
-  Bit_set(bit1, size / 2, size - 1);
-  Bit_bset(bit1, 0);
-  clock_gettime(CLOCK_MONOTONIC, &start_time);
-  for (int i = 0; i < iterations; i++) {
-    result = Bit_inter_count(bit1, bit2);
+int64_t bench_Bit_count(void *arg) {
+  micro_case *m = arg;
+  volatile int result = 0;
+  for (int i = 0; i < m->iterations; i++) {
+    result = Bit_count(m->bit1);
   }
+  return result;
+}
 
-  clock_gettime(CLOCK_MONOTONIC, &end_time);
-  timeElapsed = timeDiff(&end_time, &start_time);
-  Bit_free(&bit1);
-  Bit_free(&bit2);
-  return timeElapsed;
+int64_t bench_Bit_inter_count(void *arg) {
+  micro_case *m = arg;
+  volatile int result = 0;
+  for (int i = 0; i < m->iterations; i++) {
+    result = Bit_inter_count(m->bit1, m->bit2);
+  }
+  return result;
 }
-int64_t bench_Bit_inter_count_mem(int size, int iterations) {
-  struct timespec start_time, end_time;
-  int64_t timeElapsed = 0;
-  volatile int result;
-  Bit_T bit1 = Bit_new(size);
-  Bit_T bit2 = Bit_new(size);
-  Bit_set(bit1, size / 2, size - 1);
-  Bit_bset(bit1, 0);
-  clock_gettime(CLOCK_MONOTONIC, &start_time);
-  for (int i = 0; i < iterations; i++) {
-    Bit_T bit3 = Bit_inter(bit1, bit2);
+
+int64_t bench_Bit_inter_count_mem(void *arg) {
+  micro_case *m = arg;
+  volatile int result = 0;
+  for (int i = 0; i < m->iterations; i++) {
+    Bit_T bit3 = Bit_inter(m->bit1, m->bit2);
     result = Bit_count(bit3);
     Bit_free(&bit3);
   }
-
-  clock_gettime(CLOCK_MONOTONIC, &end_time);
-  timeElapsed = timeDiff(&end_time, &start_time);
-  Bit_free(&bit1);
-  Bit_free(&bit2);
-  return timeElapsed;
+  return result;
 }
 
-int64_t bench_Bit_inter(int size, int iterations) {
-  struct timespec start_time, end_time;
-  int64_t timeElapsed = 0;
-  Bit_T bit1 = Bit_new(size);
-  Bit_T bit2 = Bit_new(size);
-  Bit_set(bit1, size / 2, size - 1);
-  Bit_bset(bit1, 0);
-  clock_gettime(CLOCK_MONOTONIC, &start_time);
-  for (int i = 0; i < iterations; i++) {
-    Bit_T bit3 = Bit_inter(bit1, bit2);
+int64_t bench_Bit_inter(void *arg) {
+  micro_case *m = arg;
+  for (int i = 0; i < m->iterations; i++) {
+    Bit_T bit3 = Bit_inter(m->bit1, m->bit2);
     Bit_free(&bit3);
   }
-
-  clock_gettime(CLOCK_MONOTONIC, &end_time);
-  timeElapsed = timeDiff(&end_time, &start_time);
-  return timeElapsed;
+  return 0;
 }
 
-int64_t bench_Bit_and(int size, int iterations) {
-  struct timespec start_time, end_time;
-  int64_t timeElapsed = 0;
-  size_t size_in_qwords = nqwords(size);
-  size_t size_in_bytes = size_in_qwords * BPQW / BPB;
-
-  unsigned long long *bit1 = malloc(size_in_bytes);
-  unsigned long long *bit2 = malloc(size_in_bytes);
-
-  unsigned long long volatile result;
-
-  // Initialize with some data pattern
-  for (size_t i = 0; i < size_in_qwords; i++) {
-    bit1[i] = i + 1;
-    bit2[i] = ~i;
-  }
-  clock_gettime(CLOCK_MONOTONIC, &start_time);
-  for (int i = 0; i < iterations; i++) {
-    for (int j = size_in_qwords; --j >= 0;) {
-      result = bit1[j] & bit2[j];
+int64_t bench_Bit_and(void *arg) {
+  micro_case *m = arg;
+  unsigned long long volatile result = 0;
+  for (int i = 0; i < m->iterations; i++) {
+    for (int j = m->size_in_qwords; --j >= 0;) {
+      result = m->buf1[j] & m->buf2[j];
     }
   }
-
-  clock_gettime(CLOCK_MONOTONIC, &end_time);
-  timeElapsed = timeDiff(&end_time, &start_time);
-  return timeElapsed;
+  return (int64_t)result;
 }
 
-int64_t bench_Bit_and_SIMD(int size, int iterations) {
-  struct timespec start_time, end_time;
-  int64_t timeElapsed = 0;
-  size_t size_in_qwords = nqwords(size);
-  size_t size_in_bytes = size_in_qwords * BPQW / BPB;
-
-  // used to prevent compiler optimization of the result
-  #define DO_NOT_OPTIMIZE_AWAY(val) __asm__ volatile("" : : "g"(val) : "memory")
-
-  unsigned long long *bit1 = malloc(size_in_bytes);
-  unsigned long long *bit2 = malloc(size_in_bytes);
-  volatile unsigned long long result;
-  // Initialize with some data pattern
-  for (size_t i = 0; i < size_in_qwords; i++) {
-    bit1[i] = i + 1;
-    bit2[i] = ~i;
-  }
-  clock_gettime(CLOCK_MONOTONIC, &start_time);
+int64_t bench_Bit_and_SIMD(void *arg) {
+  micro_case *m = arg;
+  volatile unsigned long long result = 0;
 #if defined(BIT_SIMD_PATH_AVX512)
   // SIMDe AVX512 version - process 8 qwords (512 bits) at once
-  for (int i = 0; i < iterations; i++) {
-    int j = size_in_qwords;
+  for (int i = 0; i < m->iterations; i++) {
+    int j = m->size_in_qwords;
     // Process 8 qwords at a time
     for (; j >= 8; j -= 8) {
-      simde__m512i a = simde_mm512_loadu_si512(bit1 + j - 8);
-      simde__m512i b = simde_mm512_loadu_si512(bit2 + j - 8);
+      simde__m512i a = simde_mm512_loadu_si512(m->buf1 + j - 8);
+      simde__m512i b = simde_mm512_loadu_si512(m->buf2 + j - 8);
       volatile simde__m512i c = simde_mm512_and_si512(a, b);
       DO_NOT_OPTIMIZE_AWAY(c);
     }
     // Handle remaining elements
     for (; j > 0; j--) {
-      volatile unsigned long long result = bit1[j - 1] & bit2[j - 1];
+      volatile unsigned long long result = m->buf1[j - 1] & m->buf2[j - 1];
     }
   }
 #elif defined(BIT_SIMD_PATH_AVX2)
   // SIMDe AVX2 version - process 4 qwords (256 bits) at once
-  for (int i = 0; i < iterations; i++) {
-    int j = size_in_qwords;
+  for (int i = 0; i < m->iterations; i++) {
+    int j = m->size_in_qwords;
     // Process 4 qwords at a time
     for (; j >= 4; j -= 4) {
-      simde__m256i a = simde_mm256_loadu_si256(bit1 + j - 4);
-      simde__m256i b = simde_mm256_loadu_si256(bit2 + j - 4);
+      simde__m256i a = simde_mm256_loadu_si256(m->buf1 + j - 4);
+      simde__m256i b = simde_mm256_loadu_si256(m->buf2 + j - 4);
       volatile simde__m256i c = simde_mm256_and_si256(a, b);
       DO_NOT_OPTIMIZE_AWAY(c);
     }
     // Handle remaining elements
     for (; j > 0; j--) {
-      volatile unsigned long long result = bit1[j - 1] & bit2[j - 1];
+      volatile unsigned long long result = m->buf1[j - 1] & m->buf2[j - 1];
     }
   }
 #elif defined(BIT_SIMD_PATH_128)
   // SIMDe AVX version - process 2 qwords (128 bits) at once
-  for (int i = 0; i < iterations; i++) {
-    int j = size_in_qwords;
+  for (int i = 0; i < m->iterations; i++) {
+    int j = m->size_in_qwords;
     // Process 2 qwords at a time
     for (; j >= 2; j -= 2) {
-      simde__m128i a = simde_mm_loadu_si128(bit1 + j - 2);
-      simde__m128i b = simde_mm_loadu_si128(bit2 + j - 2);
+      simde__m128i a = simde_mm_loadu_si128(m->buf1 + j - 2);
+      simde__m128i b = simde_mm_loadu_si128(m->buf2 + j - 2);
       volatile simde__m128i c = simde_mm_and_si128(a, b);
       DO_NOT_OPTIMIZE_AWAY(c);
     }
     // Handle remaining elements
     for (; j > 0; j--) {
-      volatile unsigned long long result = bit1[j - 1] & bit2[j - 1];
+      volatile unsigned long long result = m->buf1[j - 1] & m->buf2[j - 1];
     }
   }
 #else
   // Scalar version (fallback)
-  for (int i = 0; i < iterations; i++) {
-    for (int j = size_in_qwords; --j >= 0;) {
-      result = bit1[j] & bit2[j];
+  for (int i = 0; i < m->iterations; i++) {
+    for (int j = m->size_in_qwords; --j >= 0;) {
+      result = m->buf1[j] & m->buf2[j];
     }
   }
 #endif
 
-  clock_gettime(CLOCK_MONOTONIC, &end_time);
-  timeElapsed = timeDiff(&end_time, &start_time);
-  return timeElapsed;
+  return (int64_t)result;
+}
+
+static uint64_t access_next(uint64_t *state) {
+  // xorshift64*: a fixed sequence, so that every run checks the same bits
+  *state ^= *state >> 12;
+  *state ^= *state << 25;
+  *state ^= *state >> 27;
+  return *state * 0x2545F4914F6CDD1DULL;
+}
+
+void access_setup(void *arg) {
+  access_case *a = arg;
+  a->bit = Bit_new(a->size);
+  a->indices = malloc(ACCESS_COUNT * sizeof(int));
+  assert(a->indices != NULL);
+  // every page written before the timed repetitions, half of the bits set
+  Bit_set(a->bit, 0, a->size - 1);
+  Bit_clear(a->bit, a->size / 2, a->size - 1);
+  const uint64_t range = (uint64_t)a->size - 1;
+  uint64_t state = 0x9E3779B97F4A7C15ULL, window = 0;
+  for (int i = 0; i < ACCESS_COUNT; i++) {
+    switch (a->pattern) {
+    case PATTERN_RANDOM:
+      a->indices[i] = (int)(access_next(&state) % range);
+      break;
+    case PATTERN_STRIDED:
+      a->indices[i] = (int)((uint64_t)i * ACCESS_STRIDE % range);
+      break;
+    case PATTERN_CLUSTERED:
+      if (i % ACCESS_CLUSTER == 0)
+        window = range > ACCESS_WINDOW
+                     ? access_next(&state) % (range - ACCESS_WINDOW)
+                     : 0;
+      a->indices[i] =
+          (int)((window + access_next(&state) % ACCESS_WINDOW) % range);
+      break;
+    }
+  }
+}
+
+void access_teardown(void *arg) {
+  access_case *a = arg;
+  Bit_free(&a->bit);
+  free(a->indices);
+}
+
+int64_t bench_access_get(void *arg) {
+  access_case *a = arg;
+  int64_t sum = 0;
+  if (a->dependent) {
+    for (int i = 0, r = 0; i < ACCESS_COUNT; i++) {
+      r = Bit_get(a->bit, a->indices[i] + r);
+      sum += r;
+    }
+  } else {
+    for (int i = 0; i < ACCESS_COUNT; i++)
+      sum += Bit_get(a->bit, a->indices[i]);
+  }
+  return sum;
+}
+
+int64_t bench_access_bset(void *arg) {
+  access_case *a = arg;
+  for (int i = 0; i < ACCESS_COUNT; i++)
+    Bit_bset(a->bit, a->indices[i]);
+  return Bit_get(a->bit, a->indices[ACCESS_COUNT - 1]);
+}
+
+int64_t bench_access_put(void *arg) {
+  access_case *a = arg;
+  int64_t sum = 0;
+  if (a->dependent) {
+    // Bit_put returns the previous bit, which moves the next index
+    for (int i = 0, r = 0; i < ACCESS_COUNT; i++) {
+      r = Bit_put(a->bit, a->indices[i] + r, r ^ 1);
+      sum += r;
+    }
+  } else {
+    for (int i = 0; i < ACCESS_COUNT; i++)
+      sum += Bit_put(a->bit, a->indices[i], i & 1);
+  }
+  return sum;
+}
+
+int64_t bench_access_aset(void *arg) {
+  access_case *a = arg;
+  for (int i = 0; i < ACCESS_COUNT; i += ACCESS_BATCH)
+    Bit_aset(a->bit, a->indices + i, ACCESS_BATCH);
+  return Bit_get(a->bit, a->indices[ACCESS_COUNT - 1]);
+}
+
+// Random, strided and clustered accesses of Bit_get, Bit_bset, Bit_put and
+// Bit_aset on bitsets of L1, L2, LLC and DRAM size; returns the cases to
+// free after bench_run
+static access_case *register_access_cases(void) {
+  static const struct {
+    const char *name;
+    int64_t (*body)(void *);
+    bool dependent;
+  } ops[] = {
+      {"get", bench_access_get, false},   {"get", bench_access_get, true},
+      {"bset", bench_access_bset, false}, {"put", bench_access_put, false},
+      {"put", bench_access_put, true},    {"aset", bench_access_aset, false},
+  };
+  // 16 KiB, 128 KiB, 4 MiB and 128 MiB of bits
+  static const int sizes[] = {1 << 17, 1 << 20, 1 << 25, 1 << 30};
+  static const char *patterns[] = {"random", "strided", "clustered"};
+  const size_t nops = sizeof(ops) / sizeof(ops[0]);
+  const size_t nsizes = sizeof(sizes) / sizeof(sizes[0]);
+  const size_t npatterns = sizeof(patterns) / sizeof(patterns[0]);
+  access_case *cases = calloc(nops * nsizes * npatterns, sizeof(access_case));
+  assert(cases != NULL);
+  access_case *a = cases;
+  for (size_t o = 0; o < nops; o++) {
+    for (size_t p = 0; p < npatterns; p++) {
+      for (size_t i = 0; i < nsizes; i++, a++) {
+        a->size = sizes[i];
+        a->pattern = (pattern)p;
+        a->dependent = ops[o].dependent;
+        snprintf(a->params, sizeof(a->params),
+                 "size=%d pattern=%s access=%s", sizes[i], patterns[p],
+                 a->dependent ? "dependent" : "independent");
+        bench_register(&(bench_case){.name = ops[o].name,
+                                     .params = a->params,
+                                     .work = ACCESS_COUNT,
+                                     .unit = "accesses",
+                                     .setup = access_setup,
+                                     .body = ops[o].body,
+                                     .teardown = access_teardown,
+                                     .arg = a});
+      }
+    }
+  }
+  return cases;
 }
 
 int main() {
@@ -281,10 +391,10 @@ int main() {
 
 print_Bit_configuration();
   // Array of benchmark functions
-  benchmark_func benchmark_funcs[] = {
-      bench_Bit_count,       bench_Bit_inter_count, bench_Bit_inter_count_mem,
-      bench_Bit_inter_count, bench_Bit_and,         bench_Bit_and_SIMD,
-      bench_Bit_aset,        bench_Bit_aclear,
+  int64_t (*benchmark_funcs[])(void *) = {
+      bench_Bit_count, bench_Bit_inter_count, bench_Bit_inter_count_mem,
+      bench_Bit_inter, bench_Bit_and,         bench_Bit_and_SIMD,
+      bench_Bit_aset,  bench_Bit_aclear,
   };
   char *test_explantion[] = {
       "Count the number of bits set in the bitset",
@@ -302,30 +412,34 @@ print_Bit_configuration();
   for (size_t i = 0; i < sizeof(test_array) / sizeof(char *); i++) {
     printf("%s => %s\n", test_array[i], test_explantion[i]);
   }
-  int iterations = 1000;
-  int64_t timeElapsed;
-  char s[50];
-  for (size_t j = 0; j < sizeof(test_array) / sizeof(char *); j++) {
-    for (size_t i = 0; i < sizeof(size_array) / sizeof(int); i++) {
-      timeElapsed = benchmark_funcs[j](size_array[i], iterations);
-      snprintf(s, sizeof(s), "Bit %15s (size = %10d)", test_array[j],
-               size_array[i]);
-      summarize_results(s, timeElapsed, iterations);
+  printf("get, bset, put, aset (with a pattern) => %d single-bit accesses of\n"
+         "\trandom, strided or clustered indices; dependent accesses feed\n"
+         "\teach result into the next index and measure latency\n",
+         ACCESS_COUNT);
+  const size_t ntests = sizeof(test_array) / sizeof(char *);
+  const size_t nsizes = sizeof(size_array) / sizeof(int);
+  micro_case *cases = calloc(ntests * nsizes, sizeof(micro_case));
+  assert(cases != NULL);
+  for (size_t j = 0; j < ntests; j++) {
+    for (size_t i = 0; i < nsizes; i++) {
+      micro_case *m = &cases[j * nsizes + i];
+      m->size = size_array[i];
+      m->iterations = 1000;
+      snprintf(m->params, sizeof(m->params), "size=%d", size_array[i]);
+      bench_register(&(bench_case){.name = test_array[j],
+                                   .params = m->params,
+                                   .work = m->iterations,
+                                   .unit = "calls",
+                                   .setup = micro_setup,
+                                   .body = benchmark_funcs[j],
+                                   .teardown = micro_teardown,
+                                   .arg = m});
     }
   }
-
-  return 0;
-}
-
-void summarize_results(char *test, int64_t timeElapsed, int num_of_iterations) {
-  printf("Total time for %20s: %15ld ns\t", test, timeElapsed);
-  printf("Time per iteration: %10.2lf ns\t",
-         (double)timeElapsed / num_of_iterations);
-  printf("Iterations per second %10.2lg\n",
-         (double)num_of_iterations * 1e9 / timeElapsed);
-}
-
-int64_t timeDiff(struct timespec *timeA_p, struct timespec *timeB_p) {
-  return ((timeA_p->tv_sec - timeB_p->tv_sec) * 1000000000 + timeA_p->tv_nsec -
-          timeB_p->tv_nsec);
+  access_case *access_cases = register_access_cases();
+  const bench_config config = bench_config_default("benchmark");
+  const int status = bench_run(&config);
+  free(cases);
+  free(access_cases);
+  return status == 0 ? 0 : 1;
 }
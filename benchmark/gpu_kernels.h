@@ -73,7 +73,6 @@ typedef hipEvent_t gpu_event_t;
 #include <stdint.h>
 #include <stddef.h>
 
-/*
 #ifndef GPU_TILE_J
 #define GPU_TILE_J 2048
 #endif
@@ -81,7 +80,23 @@ typedef hipEvent_t gpu_event_t;
 #ifndef GPU_ILP
 #define GPU_ILP 16
 #endif
-*/
+
+#ifndef GPU_OUTER_ROWS
+#define GPU_OUTER_ROWS 4
+#endif
+
+#ifndef GPU_OUTER_COLS
+#define GPU_OUTER_COLS 4
+#endif
+
+#ifndef GPU_TILE_DIM
+#define GPU_TILE_DIM 32
+#endif
+
+#ifndef GPU_BLOCK_ROWS
+#define GPU_BLOCK_ROWS 8
+#endif
+
 // ===========================================================================
 // All-pairs (matrix) popcount intersection kernels
 // Each thread block processes a tile of query/ref pairs.
@@ -116,6 +131,13 @@ static __device__ __forceinline__ unsigned int popcount_uint64(uint64_t x) {
 #endif
 }
 
+static __device__ __forceinline__ unsigned int popcount_word(uint32_t x) {
+    return popcount_uint32(x);
+}
+static __device__ __forceinline__ unsigned int popcount_word(uint64_t x) {
+    return popcount_uint64(x);
+}
+
 static __device__ __forceinline__ unsigned int popcount_pair_word(
     uint32_t lhs, uint32_t rhs)
 {
@@ -128,11 +150,174 @@ static __device__ __forceinline__ unsigned int popcount_pair_word(
     return popcount_uint64(lhs & rhs);
 }
 
+// ===========================================================================
+// Set operations of the count kernels. SetOp<OPS> adds the popcounts of the
+// ops of the mask OPS on one (query word, ref word) pair to its COUNTS
+// running sums, in the order of the GPU_OP_* bits. A kernel on a single op
+// writes one K x N matrix of counts; on several, the fused variant, it
+// loads every word pair once and writes COUNTS matrices one after another.
+// ===========================================================================
+
+#define GPU_OP_INTER 1u // |q & r|
+#define GPU_OP_UNION 2u // |q | r|
+#define GPU_OP_DIFF 4u  // |q ^ r|
+#define GPU_OP_MINUS 8u // |q & ~r|
+#define GPU_OP_ALL 15u
+
+template <unsigned int OPS>
+struct SetOp {
+    static constexpr int COUNTS = ((OPS & GPU_OP_INTER) != 0) +
+                                  ((OPS & GPU_OP_UNION) != 0) +
+                                  ((OPS & GPU_OP_DIFF) != 0) +
+                                  ((OPS & GPU_OP_MINUS) != 0);
+
+    template <typename T>
+    static __device__ __forceinline__ void accumulate(T q, T r, int *sum) {
+        int c = 0;
+        if (OPS & GPU_OP_INTER) sum[c++] += popcount_word(static_cast<T>(q & r));
+        if (OPS & GPU_OP_UNION) sum[c++] += popcount_word(static_cast<T>(q | r));
+        if (OPS & GPU_OP_DIFF) sum[c++] += popcount_word(static_cast<T>(q ^ r));
+        if (OPS & GPU_OP_MINUS) sum[c] += popcount_word(static_cast<T>(q & ~r));
+    }
+};
+
+typedef SetOp<GPU_OP_INTER> SetOpInter;
+typedef SetOp<GPU_OP_UNION> SetOpUnion;
+typedef SetOp<GPU_OP_DIFF> SetOpDiff;
+typedef SetOp<GPU_OP_MINUS> SetOpMinus;
+typedef SetOp<GPU_OP_ALL> SetOpAll;
+
+// ===========================================================================
+// Output stages of the count kernels, passed by value. CountsOut stores the
+// COUNTS sums of a pair into the dense K x N matrices. MatchesOut keeps only
+// the pairs whose first count reaches threshold: a warp ballots its hits,
+// one lane reserves slots for all of them with a single atomicAdd, and the
+// hits fill the slots in lane order. A hit past capacity still counts in
+// *total but is dropped and lowers *resume to its query, so every query
+// below *resume is complete and a second launch from *resume on, with room
+// for the rest, finishes the list. The kernels call emit from every thread
+// of a block for the same jobs, which keeps whole warps together.
+// ===========================================================================
+
+template <typename T>
+static __device__ __forceinline__ T shuffle_word(T word, int lane) {
+#if defined(__HIP__)
+    return __shfl(word, lane);
+#else
+    return __shfl_sync(0xffffffffu, word, lane);
+#endif
+}
+
+#if defined(__HIP__)
+typedef unsigned long long gpu_lane_mask_t;
+#define GPU_BALLOT(pred) __ballot(pred)
+#define GPU_LANE_ID() static_cast<int>(__lane_id())
+#define GPU_MASK_POPC(mask) __popcll(mask)
+#define GPU_MASK_FFS(mask) __ffsll(mask)
+#else
+typedef unsigned int gpu_lane_mask_t;
+#define GPU_BALLOT(pred) __ballot_sync(0xffffffffu, pred)
+#define GPU_LANE_ID() static_cast<int>(threadIdx.x % 32)
+#define GPU_MASK_POPC(mask) __popc(mask)
+#define GPU_MASK_FFS(mask) __ffs(mask)
+#endif
+
+struct CountsOut {
+    int *counts;
+
+    template <int COUNTS>
+    __device__ __forceinline__ void emit(int K, int N, int k, int i, bool valid,
+                                         const int *sum) const {
+        if (valid) {
+            #pragma unroll
+            for (int c = 0; c < COUNTS; ++c) {
+                counts[static_cast<size_t>(c) * K * N + k * N + i] = sum[c];
+            }
+        }
+    }
+};
+
+struct GpuMatch {
+    int query;
+    int target;
+    int count;
+};
+
+struct MatchesOut {
+    GpuMatch *matches;
+    unsigned long long capacity;
+    unsigned long long *total; // hits found, stored or not
+    int *resume;               // lowest query with a dropped hit
+    int threshold;
+    int first_query;           // added to k, for a launch on later rows
+
+    template <int COUNTS>
+    __device__ __forceinline__ void emit(int, int, int k, int i, bool valid,
+                                         const int *sum) const {
+        const bool hit = valid && sum[0] >= threshold;
+        const gpu_lane_mask_t hits = GPU_BALLOT(hit);
+        if (hits == 0) return; // the same for the whole warp
+        const int lane = GPU_LANE_ID();
+        const int leader = GPU_MASK_FFS(hits) - 1;
+        unsigned long long base = 0;
+        if (lane == leader) {
+            base = atomicAdd(total,
+                             static_cast<unsigned long long>(GPU_MASK_POPC(hits)));
+        }
+        base = shuffle_word(base, leader);
+        if (hit) {
+            const gpu_lane_mask_t below = (static_cast<gpu_lane_mask_t>(1) << lane) - 1;
+            const unsigned long long slot = base + GPU_MASK_POPC(hits & below);
+            if (slot < capacity) {
+                GpuMatch match = {first_query + k, i, sum[0]};
+                matches[slot] = match;
+            } else {
+                atomicMin(resume, first_query + k);
+            }
+        }
+    }
+};
+
+// ===========================================================================
+// Tiled transpose of a height x width row-major matrix into width x height,
+// which turns the reference rows word-major for the coarsened kernel.
+// Launch with GPU_TILE_DIM x GPU_BLOCK_ROWS threads per block.
+// ===========================================================================
+
 template <typename T>
+GPU_KERNEL void transpose_kernel(const T *__restrict__ in, T *__restrict__ out,
+                                 int width, int height) {
+  __shared__ T tile[GPU_TILE_DIM][GPU_TILE_DIM + 1];
+
+  int x = blockIdx.x * GPU_TILE_DIM + threadIdx.x;
+  int y = blockIdx.y * GPU_TILE_DIM + threadIdx.y;
+
+  for (int j = 0; j < GPU_TILE_DIM; j += GPU_BLOCK_ROWS) {
+    if (x < width && (y + j) < height) {
+      tile[threadIdx.y + j][threadIdx.x] = in[(y + j) * width + x];
+    }
+  }
+
+  __syncthreads();
+
+  int x_t = blockIdx.y * GPU_TILE_DIM + threadIdx.x;
+  int y_t = blockIdx.x * GPU_TILE_DIM + threadIdx.y;
+
+  for (int j = 0; j < GPU_TILE_DIM; j += GPU_BLOCK_ROWS) {
+    if (x_t < height && (y_t + j) < width) {
+      out[(y_t + j) * height + x_t] = tile[threadIdx.x][threadIdx.y + j];
+    }
+  }
+}
+
+// TILE_J and ILP default to the build parameters; the native backend also
+// instantiates other pairs and picks one per device and shape at run time.
+template <typename T, typename Op = SetOpInter, int TILE_J = GPU_TILE_J,
+          int ILP = GPU_ILP, typename Out = CountsOut>
 GPU_KERNEL void compute_setop_popcount_coarsened_kernel(
     const T *bit_qwords,
     const T *bits_qwords_T,
-    int *counts,
+    Out out,
     int K,
     int N,
     int J)
@@ -140,7 +325,7 @@ GPU_KERNEL void compute_setop_popcount_coarsened_kernel(
     extern __shared__ unsigned char s_query_raw[];
     T *s_query = reinterpret_cast<T *>(s_query_raw);
 
-    const int cols_per_block = blockDim.x * GPU_ILP;
+    const int cols_per_block = blockDim.x * ILP;
     const int blocks_per_row = (N + cols_per_block - 1) / cols_per_block;
     const int total_jobs = K * blocks_per_row;
     const int job = blockIdx.x;
@@ -148,16 +333,16 @@ GPU_KERNEL void compute_setop_popcount_coarsened_kernel(
     for (int job_idx = job; job_idx < total_jobs; job_idx += gridDim.x) {
         const int k = job_idx / blocks_per_row;
         const int i_base = (job_idx % blocks_per_row) * cols_per_block;
-        int i[GPU_ILP];
-        int sum[GPU_ILP] = {0};
+        int i[ILP];
+        int sum[ILP][Op::COUNTS] = {{0}};
 
         #pragma unroll
-        for (int u = 0; u < GPU_ILP; ++u) {
+        for (int u = 0; u < ILP; ++u) {
             i[u] = i_base + threadIdx.x + u * blockDim.x;
         }
 
-        for (int j_tile = 0; j_tile < J; j_tile += GPU_TILE_J) {
-            const int current_tile = ((j_tile + GPU_TILE_J) > J) ? (J - j_tile) : GPU_TILE_J;
+        for (int j_tile = 0; j_tile < J; j_tile += TILE_J) {
+            const int current_tile = ((j_tile + TILE_J) > J) ? (J - j_tile) : TILE_J;
             for (int t = threadIdx.x; t < current_tile; t += blockDim.x) {
                 s_query[t] = bit_qwords[k * J + j_tile + t];
             }
@@ -168,19 +353,19 @@ GPU_KERNEL void compute_setop_popcount_coarsened_kernel(
                 for (int j = 0; j < current_tile; ++j) {
                     const T sk = s_query[j];
                     #pragma unroll
-                    for (int u = 0; u < GPU_ILP; ++u) {
-                        sum[u] += popcount_pair_word(sk,
-                                                     bits_qwords_T[(j_tile + j) * N + i[u]]);
+                    for (int u = 0; u < ILP; ++u) {
+                        Op::accumulate(sk, bits_qwords_T[(j_tile + j) * N + i[u]],
+                                       sum[u]);
                     }
                 }
             } else {
                 for (int j = 0; j < current_tile; ++j) {
                     const T sk = s_query[j];
                     #pragma unroll
-                    for (int u = 0; u < GPU_ILP; ++u) {
+                    for (int u = 0; u < ILP; ++u) {
                         if (i[u] < N) {
-                            sum[u] += popcount_pair_word(sk,
-                                                         bits_qwords_T[(j_tile + j) * N + i[u]]);
+                            Op::accumulate(sk, bits_qwords_T[(j_tile + j) * N + i[u]],
+                                           sum[u]);
                         }
                     }
                 }
@@ -189,56 +374,318 @@ GPU_KERNEL void compute_setop_popcount_coarsened_kernel(
         }
 
         #pragma unroll
-        for (int u = 0; u < GPU_ILP; ++u) {
-            if (i[u] < N) {
-                counts[k * N + i[u]] = sum[u];
-            }
+        for (int u = 0; u < ILP; ++u) {
+            out.template emit<Op::COUNTS>(K, N, k, i[u], i[u] < N, sum[u]);
         }
     }
 }
 
-template <typename T>
+template <typename T, typename Op = SetOpInter, int TILE_J = GPU_TILE_J,
+          int ILP = GPU_ILP, typename Out = CountsOut>
+static inline void launch_setop_coarsened_out(
+    const T *d_bit_qwords,
+    const T *d_bits_qwords_T,
+    Out out,
+    int K,
+    int N,
+    int J,
+    gpu_stream_t stream = 0)
+{
+    const dim3 blockDim(256);
+    const int cols_per_block = blockDim.x * ILP;
+    const int blocks_per_row = (N + cols_per_block - 1) / cols_per_block;
+    const int total_jobs = K * blocks_per_row;
+    const int max_physical_blocks = 65536;
+    const dim3 gridDim(total_jobs < max_physical_blocks ? total_jobs : max_physical_blocks);
+    const size_t shared_mem_bytes = static_cast<size_t>(TILE_J) * sizeof(T);
+
+    // named through a pointer: the template arguments would split the macro
+    void (*kernel)(const T *, const T *, Out, int, int, int) =
+        compute_setop_popcount_coarsened_kernel<T, Op, TILE_J, ILP, Out>;
+    GPU_LAUNCH_KERNEL(kernel,
+                      gridDim,
+                      blockDim,
+                      shared_mem_bytes,
+                      stream,
+                      d_bit_qwords,
+                      d_bits_qwords_T,
+                      out,
+                      K,
+                      N,
+                      J);
+    GPU_CHECK(GPU_GET_LAST_ERROR);
+}
+
+template <typename T, typename Op = SetOpInter, int TILE_J = GPU_TILE_J,
+          int ILP = GPU_ILP>
 static inline void launch_setop_coarsened(
     const T *d_bit_qwords,
     const T *d_bits_qwords_T,
     int *d_counts,
     int K,
     int N,
+    int J,
+    gpu_stream_t stream = 0)
+{
+    const CountsOut out = {d_counts};
+    launch_setop_coarsened_out<T, Op, TILE_J, ILP>(d_bit_qwords, d_bits_qwords_T, out,
+                                                   K, N, J, stream);
+}
+
+// ===========================================================================
+// Warp-shuffle kernel for short rows (J <= GPU_SHUFFLE_WORDS). Lane l of
+// every warp holds query word l in a register and the warp broadcasts word
+// j with a shuffle, so the hot loop has no shared memory and no barriers.
+// GPU_SHUFFLE_WORDS is the narrowest warp (32 lanes); an AMD wavefront of
+// 64 simply leaves its upper lanes' words unused.
+// ===========================================================================
+
+#ifndef GPU_SHUFFLE_WORDS
+#define GPU_SHUFFLE_WORDS 32
+#endif
+
+template <typename T, typename Op = SetOpInter, int ILP = GPU_ILP,
+          typename Out = CountsOut>
+GPU_KERNEL void compute_setop_popcount_shuffle_kernel(
+    const T *bit_qwords,
+    const T *bits_qwords_T,
+    Out out,
+    int K,
+    int N,
     int J)
+{
+    const int cols_per_block = blockDim.x * ILP;
+    const int blocks_per_row = (N + cols_per_block - 1) / cols_per_block;
+    const int total_jobs = K * blocks_per_row;
+    const int lane = threadIdx.x % GPU_SHUFFLE_WORDS;
+
+    // every thread of a block takes the same jobs, so whole warps shuffle
+    for (int job_idx = blockIdx.x; job_idx < total_jobs; job_idx += gridDim.x) {
+        const int k = job_idx / blocks_per_row;
+        const int i_base = (job_idx % blocks_per_row) * cols_per_block;
+        const T query_word = lane < J ? bit_qwords[k * J + lane] : T(0);
+        int i[ILP];
+        int sum[ILP][Op::COUNTS] = {{0}};
+
+        #pragma unroll
+        for (int u = 0; u < ILP; ++u) {
+            i[u] = i_base + threadIdx.x + u * blockDim.x;
+        }
+
+        if (i_base + cols_per_block <= N) {
+            for (int j = 0; j < J; ++j) {
+                const T sk = shuffle_word(query_word, j);
+                #pragma unroll
+                for (int u = 0; u < ILP; ++u) {
+                    Op::accumulate(sk, bits_qwords_T[j * N + i[u]], sum[u]);
+                }
+            }
+        } else {
+            for (int j = 0; j < J; ++j) {
+                const T sk = shuffle_word(query_word, j);
+                #pragma unroll
+                for (int u = 0; u < ILP; ++u) {
+                    if (i[u] < N) {
+                        Op::accumulate(sk, bits_qwords_T[j * N + i[u]], sum[u]);
+                    }
+                }
+            }
+        }
+
+        #pragma unroll
+        for (int u = 0; u < ILP; ++u) {
+            out.template emit<Op::COUNTS>(K, N, k, i[u], i[u] < N, sum[u]);
+        }
+    }
+}
+
+// J must not exceed GPU_SHUFFLE_WORDS
+template <typename T, typename Op = SetOpInter, int ILP = GPU_ILP,
+          typename Out = CountsOut>
+static inline void launch_setop_shuffle_out(
+    const T *d_bit_qwords,
+    const T *d_bits_qwords_T,
+    Out out,
+    int K,
+    int N,
+    int J,
+    gpu_stream_t stream = 0)
 {
     const dim3 blockDim(256);
-    const int cols_per_block = blockDim.x * GPU_ILP;
+    const int cols_per_block = blockDim.x * ILP;
     const int blocks_per_row = (N + cols_per_block - 1) / cols_per_block;
     const int total_jobs = K * blocks_per_row;
     const int max_physical_blocks = 65536;
     const dim3 gridDim(total_jobs < max_physical_blocks ? total_jobs : max_physical_blocks);
-    const size_t shared_mem_bytes = static_cast<size_t>(GPU_TILE_J) * sizeof(T);
-
-    gpu_event_t start, stop;
-    GPU_CHECK(GPU_EVENT_CREATE(&start));
-    GPU_CHECK(GPU_EVENT_CREATE(&stop));
-    GPU_CHECK(GPU_EVENT_RECORD(start, 0));
 
-    GPU_LAUNCH_KERNEL(compute_setop_popcount_coarsened_kernel<T>,
+    // named through a pointer: the template arguments would split the macro
+    void (*kernel)(const T *, const T *, Out, int, int, int) =
+        compute_setop_popcount_shuffle_kernel<T, Op, ILP, Out>;
+    GPU_LAUNCH_KERNEL(kernel,
                       gridDim,
                       blockDim,
-                      shared_mem_bytes,
                       0,
+                      stream,
                       d_bit_qwords,
                       d_bits_qwords_T,
-                      d_counts,
+                      out,
                       K,
                       N,
                       J);
     GPU_CHECK(GPU_GET_LAST_ERROR);
+}
+
+template <typename T, typename Op = SetOpInter, int ILP = GPU_ILP>
+static inline void launch_setop_shuffle(
+    const T *d_bit_qwords,
+    const T *d_bits_qwords_T,
+    int *d_counts,
+    int K,
+    int N,
+    int J,
+    gpu_stream_t stream = 0)
+{
+    const CountsOut out = {d_counts};
+    launch_setop_shuffle_out<T, Op, ILP>(d_bit_qwords, d_bits_qwords_T, out,
+                                         K, N, J, stream);
+}
+
+// ===========================================================================
+// Register-blocked outer-product kernel. Each thread counts an R x C block
+// of (query, ref) pairs: per word it loads R query words from shared memory
+// and C ref words from the transposed refs, and accumulates all R * C
+// products, the GPU counterpart of the OUTER_ROW_NUM x OUTER_COL_NUM CPU
+// microkernels. A block stages R query rows GPU_TILE_J / R words at a time,
+// the shared memory of the coarsened kernel, and reads every ref word once
+// for R queries instead of once per query.
+// ===========================================================================
+
+template <typename T, int R, int C, typename Op = SetOpInter,
+          typename Out = CountsOut>
+GPU_KERNEL void compute_setop_popcount_outer_kernel(
+    const T *bit_qwords,
+    const T *bits_qwords_T,
+    Out out,
+    int K,
+    int N,
+    int J)
+{
+    extern __shared__ unsigned char s_outer_raw[];
+    T *s_query = reinterpret_cast<T *>(s_outer_raw);
+
+    const int tile_j = GPU_TILE_J / R;
+    const int cols_per_block = blockDim.x * C;
+    const int blocks_per_row = (N + cols_per_block - 1) / cols_per_block;
+    const int row_blocks = (K + R - 1) / R;
+    const int total_jobs = row_blocks * blocks_per_row;
 
-    GPU_CHECK(GPU_EVENT_RECORD(stop, 0));
-    GPU_EVENT_SYNC(stop);
-    float milliseconds = 0.0f;
-    GPU_EVENT_ELAPSED_TIME(&milliseconds, start, stop);
+    for (int job_idx = blockIdx.x; job_idx < total_jobs; job_idx += gridDim.x) {
+        const int k_base = (job_idx / blocks_per_row) * R;
+        const int i_base = (job_idx % blocks_per_row) * cols_per_block;
+        int i[C];
+        int sum[R][C][Op::COUNTS] = {{{0}}};
 
-    GPU_EVENT_DESTROY(start);
-    GPU_EVENT_DESTROY(stop);
+        #pragma unroll
+        for (int c = 0; c < C; ++c) {
+            i[c] = i_base + threadIdx.x + c * blockDim.x;
+        }
+
+        for (int j_tile = 0; j_tile < J; j_tile += tile_j) {
+            const int current_tile = ((j_tile + tile_j) > J) ? (J - j_tile) : tile_j;
+            for (int t = threadIdx.x; t < R * current_tile; t += blockDim.x) {
+                const int r = t / current_tile;
+                const int j = t % current_tile;
+                s_query[r * tile_j + j] = (k_base + r < K)
+                    ? bit_qwords[(k_base + r) * J + j_tile + j]
+                    : static_cast<T>(0);
+            }
+            __syncthreads();
+
+            for (int j = 0; j < current_tile; ++j) {
+                T q[R];
+                T ref[C];
+                #pragma unroll
+                for (int r = 0; r < R; ++r) {
+                    q[r] = s_query[r * tile_j + j];
+                }
+                #pragma unroll
+                for (int c = 0; c < C; ++c) {
+                    ref[c] = (i[c] < N) ? bits_qwords_T[(j_tile + j) * N + i[c]]
+                                        : static_cast<T>(0);
+                }
+                #pragma unroll
+                for (int r = 0; r < R; ++r) {
+                    #pragma unroll
+                    for (int c = 0; c < C; ++c) {
+                        Op::accumulate(q[r], ref[c], sum[r][c]);
+                    }
+                }
+            }
+            __syncthreads();
+        }
+
+        #pragma unroll
+        for (int r = 0; r < R; ++r) {
+            #pragma unroll
+            for (int c = 0; c < C; ++c) {
+                out.template emit<Op::COUNTS>(K, N, k_base + r, i[c],
+                                              k_base + r < K && i[c] < N,
+                                              sum[r][c]);
+            }
+        }
+    }
+}
+
+template <typename T, typename Op = SetOpInter, typename Out = CountsOut>
+static inline void launch_setop_outer_out(
+    const T *d_bit_qwords,
+    const T *d_bits_qwords_T,
+    Out out,
+    int K,
+    int N,
+    int J,
+    gpu_stream_t stream = 0)
+{
+    const dim3 blockDim(256);
+    const int cols_per_block = blockDim.x * GPU_OUTER_COLS;
+    const int blocks_per_row = (N + cols_per_block - 1) / cols_per_block;
+    const int row_blocks = (K + GPU_OUTER_ROWS - 1) / GPU_OUTER_ROWS;
+    const int total_jobs = row_blocks * blocks_per_row;
+    const int max_physical_blocks = 65536;
+    const dim3 gridDim(total_jobs < max_physical_blocks ? total_jobs : max_physical_blocks);
+    const size_t shared_mem_bytes =
+        static_cast<size_t>(GPU_TILE_J / GPU_OUTER_ROWS) * GPU_OUTER_ROWS * sizeof(T);
+
+    // named through a pointer: the template arguments would split the macro
+    void (*kernel)(const T *, const T *, Out, int, int, int) =
+        compute_setop_popcount_outer_kernel<T, GPU_OUTER_ROWS, GPU_OUTER_COLS, Op, Out>;
+    GPU_LAUNCH_KERNEL(kernel,
+                      gridDim,
+                      blockDim,
+                      shared_mem_bytes,
+                      stream,
+                      d_bit_qwords,
+                      d_bits_qwords_T,
+                      out,
+                      K,
+                      N,
+                      J);
+    GPU_CHECK(GPU_GET_LAST_ERROR);
+}
+
+template <typename T, typename Op = SetOpInter>
+static inline void launch_setop_outer(
+    const T *d_bit_qwords,
+    const T *d_bits_qwords_T,
+    int *d_counts,
+    int K,
+    int N,
+    int J,
+    gpu_stream_t stream = 0)
+{
+    const CountsOut out = {d_counts};
+    launch_setop_outer_out<T, Op>(d_bit_qwords, d_bits_qwords_T, out,
+                                  K, N, J, stream);
 }
 
 template <typename T>
@@ -53,6 +53,7 @@
 #include <sys/stat.h>
 #include <vector>
 
+#include "bench_harness.h"
 #include "openmp_bit_helpers.h"
 
 #if defined(__HIPCC__)
@@ -68,6 +69,21 @@ typedef hipEvent_t gpu_event_t;
   } while (0)
 #define GPU_MALLOC hipMalloc
 #define GPU_MEMCPY hipMemcpy
+#define GPU_MEMCPY_ASYNC hipMemcpyAsync
+#define GPU_MALLOC_HOST(p, n) hipHostMalloc(p, n, hipHostMallocDefault)
+#define GPU_FREE_HOST hipHostFree
+#define GPU_STREAM_CREATE hipStreamCreate
+#define GPU_STREAM_DESTROY hipStreamDestroy
+#define GPU_STREAM_SYNC hipStreamSynchronize
+typedef hipGraph_t gpu_graph_t;
+typedef hipGraphExec_t gpu_graph_exec_t;
+#define GPU_STREAM_BEGIN_CAPTURE(s)                                            \
+  hipStreamBeginCapture(s, hipStreamCaptureModeThreadLocal)
+#define GPU_STREAM_END_CAPTURE hipStreamEndCapture
+#define GPU_GRAPH_INSTANTIATE(e, g) hipGraphInstantiateWithFlags(e, g, 0)
+#define GPU_GRAPH_LAUNCH hipGraphLaunch
+#define GPU_GRAPH_DESTROY hipGraphDestroy
+#define GPU_GRAPH_EXEC_DESTROY hipGraphExecDestroy
 #define GPU_MEMCPY_H2D hipMemcpyHostToDevice
 #define GPU_MEMCPY_D2H hipMemcpyDeviceToHost
 #define GPU_FREE hipFree
@@ -95,6 +111,21 @@ typedef cudaEvent_t gpu_event_t;
   } while (0)
 #define GPU_MALLOC cudaMalloc
 #define GPU_MEMCPY cudaMemcpy
+#define GPU_MEMCPY_ASYNC cudaMemcpyAsync
+#define GPU_MALLOC_HOST cudaMallocHost
+#define GPU_FREE_HOST cudaFreeHost
+#define GPU_STREAM_CREATE cudaStreamCreate
+#define GPU_STREAM_DESTROY cudaStreamDestroy
+#define GPU_STREAM_SYNC cudaStreamSynchronize
+typedef cudaGraph_t gpu_graph_t;
+typedef cudaGraphExec_t gpu_graph_exec_t;
+#define GPU_STREAM_BEGIN_CAPTURE(s)                                            \
+  cudaStreamBeginCapture(s, cudaStreamCaptureModeThreadLocal)
+#define GPU_STREAM_END_CAPTURE cudaStreamEndCapture
+#define GPU_GRAPH_INSTANTIATE(e, g) cudaGraphInstantiateWithFlags(e, g, 0)
+#define GPU_GRAPH_LAUNCH cudaGraphLaunch
+#define GPU_GRAPH_DESTROY cudaGraphDestroy
+#define GPU_GRAPH_EXEC_DESTROY cudaGraphExecDestroy
 #define GPU_MEMCPY_H2D cudaMemcpyHostToDevice
 #define GPU_MEMCPY_D2H cudaMemcpyDeviceToHost
 #define GPU_FREE cudaFree
@@ -113,12 +144,6 @@ typedef cudaEvent_t gpu_event_t;
 
 #include "gpu_kernels.h"
 
-static inline int64_t time_ns() {
-  struct timespec ts;
-  clock_gettime(CLOCK_MONOTONIC, &ts);
-  return (int64_t)ts.tv_sec * 1000000000LL + (int64_t)ts.tv_nsec;
-}
-
 void summarize_results(const char *test, int64_t timeElapsed, int iteration,
                        uint32_t result, float speedup) {
   printf("Total time for %-35s: %15ld ns\t", test, timeElapsed);
@@ -239,6 +264,7 @@ struct NativeBenchmarkResult {
   double kernel_time_ns;
   double total_time_ns;
   double cpu_overhead_ns;
+  double launch_time_ns;
   double compute_gbps;
   double total_gbps;
   uint64_t checksum;
@@ -249,42 +275,212 @@ struct NativeBenchmarkResult {
   std::vector<double> per_iter_kernel_ms;
   std::vector<double> per_iter_total_ms;
   std::vector<double> per_iter_cpu_overhead_ms;
+  std::vector<double> per_iter_launch_ms;
   std::vector<double> per_iter_d2h_ms;
   std::vector<uint32_t> per_iter_results;
 };
 
+// GPU_KERNEL=shuffle runs the warp-shuffle kernel instead of the coarsened
+// one, for rows of at most GPU_SHUFFLE_WORDS words
+static bool shuffle_kernel_selected(int J) {
+  const char *kernel = getenv("GPU_KERNEL");
+  return kernel && strcmp(kernel, "shuffle") == 0 && J <= GPU_SHUFFLE_WORDS;
+}
+
 template <typename T>
-__global__ void transpose_kernel(const T *__restrict__ in, T *__restrict__ out,
-                                 int width, int height) {
-  __shared__ T tile[GPU_TILE_DIM][GPU_TILE_DIM + 1];
+static void launch_setop(const T *d_bit_qwords, const T *d_bits_qwords_T,
+                         int *d_counts, int K, int N, int J,
+                         gpu_stream_t stream = 0) {
+  if (shuffle_kernel_selected(J)) {
+    launch_setop_shuffle<T>(d_bit_qwords, d_bits_qwords_T, d_counts, K, N, J,
+                            stream);
+  } else {
+    launch_setop_coarsened<T>(d_bit_qwords, d_bits_qwords_T, d_counts, K, N,
+                              J, stream);
+  }
+}
+
+// Returns the host time of the launch, in ns
+template <typename T>
+int64_t run_setop_gpu(const T *d_bit_qwords, const T *d_bits_qwords_T,
+                      int *d_counts, int K, int N, int J) {
+  const int64_t launch_start = bench_now_ns();
+  launch_setop<T>(d_bit_qwords, d_bits_qwords_T, d_counts, K, N, J);
+  const int64_t launch_ns = bench_now_ns() - launch_start;
+  GPU_CHECK(GPU_DEVICE_SYNC);
+  GPU_CHECK(GPU_GET_LAST_ERROR);
+  return launch_ns;
+}
 
-  int x = blockIdx.x * GPU_TILE_DIM + threadIdx.x;
-  int y = blockIdx.y * GPU_TILE_DIM + threadIdx.y;
+// Streamed mode, selected by GPU_STREAMS=<n>: the queries are split into
+// chunks of GPU_CHUNK_ROWS rows (default: 4 chunks per stream) that are
+// staged in pinned memory, copied, counted and copied back round robin on
+// n streams, so a chunk's transfers overlap the kernels of the others. Only
+// the transposed refs and one chunk per stream live on the device.
+static size_t env_size(const char *name) {
+  const char *value = getenv(name);
+  return (value && value[0] != '\0') ? strtoull(value, nullptr, 10) : 0;
+}
 
-  for (int j = 0; j < GPU_TILE_DIM; j += GPU_BLOCK_ROWS) {
-    if (x < width && (y + j) < height) {
-      tile[threadIdx.y + j][threadIdx.x] = in[(y + j) * width + x];
-    }
-  }
+template <typename T> struct GpuPipeline {
+  int streams;
+  size_t rows;
+  std::vector<gpu_stream_t> stream;
+  std::vector<gpu_event_t> done;
+  std::vector<T *> h_chunk;
+  std::vector<T *> d_chunk;
+  std::vector<int *> h_counts;
+  std::vector<int *> d_counts;
+};
 
-  __syncthreads();
+template <typename T>
+static bool create_pipeline(GpuPipeline<T> *pipe, size_t num_queries,
+                            size_t num_refs, size_t words_per_bitset) {
+  pipe->streams = (int)env_size("GPU_STREAMS");
+  if (pipe->streams <= 0) {
+    return false;
+  }
+  pipe->rows = env_size("GPU_CHUNK_ROWS");
+  if (pipe->rows == 0) {
+    pipe->rows = (num_queries + 4 * pipe->streams - 1) / (4 * pipe->streams);
+  }
+  pipe->rows = std::min(std::max(pipe->rows, (size_t)1), num_queries);
+  pipe->stream.resize(pipe->streams);
+  pipe->done.resize(pipe->streams);
+  pipe->h_chunk.resize(pipe->streams);
+  pipe->d_chunk.resize(pipe->streams);
+  pipe->h_counts.resize(pipe->streams);
+  pipe->d_counts.resize(pipe->streams);
+  const size_t chunk_bytes = pipe->rows * words_per_bitset * sizeof(T);
+  const size_t counts_bytes = pipe->rows * num_refs * sizeof(int);
+  for (int s = 0; s < pipe->streams; ++s) {
+    GPU_CHECK(GPU_STREAM_CREATE(&pipe->stream[s]));
+    GPU_CHECK(GPU_EVENT_CREATE(&pipe->done[s]));
+    GPU_CHECK(GPU_MALLOC_HOST((void **)&pipe->h_chunk[s], chunk_bytes));
+    GPU_CHECK(GPU_MALLOC((void **)&pipe->d_chunk[s], chunk_bytes));
+    GPU_CHECK(GPU_MALLOC_HOST((void **)&pipe->h_counts[s], counts_bytes));
+    GPU_CHECK(GPU_MALLOC((void **)&pipe->d_counts[s], counts_bytes));
+  }
+  return true;
+}
 
-  int x_t = blockIdx.y * GPU_TILE_DIM + threadIdx.x;
-  int y_t = blockIdx.x * GPU_TILE_DIM + threadIdx.y;
+template <typename T> static void destroy_pipeline(GpuPipeline<T> *pipe) {
+  for (int s = 0; s < pipe->streams; ++s) {
+    GPU_CHECK(GPU_FREE(pipe->d_counts[s]));
+    GPU_CHECK(GPU_FREE_HOST(pipe->h_counts[s]));
+    GPU_CHECK(GPU_FREE(pipe->d_chunk[s]));
+    GPU_CHECK(GPU_FREE_HOST(pipe->h_chunk[s]));
+    GPU_CHECK(GPU_EVENT_DESTROY(pipe->done[s]));
+    GPU_CHECK(GPU_STREAM_DESTROY(pipe->stream[s]));
+  }
+}
 
-  for (int j = 0; j < GPU_TILE_DIM; j += GPU_BLOCK_ROWS) {
-    if (x_t < height && (y_t + j) < width) {
-      out[(y_t + j) * height + x_t] = tile[threadIdx.x][threadIdx.y + j];
+// H2D of the queries, counts and D2H of the results, chunk by chunk.
+// Returns the host time spent issuing them, in ns
+template <typename T>
+int64_t run_setop_gpu_pipelined(GpuPipeline<T> *pipe, const T *h_queries,
+                             const T *d_bits_qwords_T, uint32_t *h_results,
+                             size_t num_queries, size_t num_refs,
+                             size_t words_per_bitset) {
+  const size_t chunks = (num_queries + pipe->rows - 1) / pipe->rows;
+  int64_t launch_ns = 0;
+  // copies the counts of chunk c out of the pinned buffer of its stream
+  auto drain = [&](size_t c) {
+    const int s = (int)(c % pipe->streams);
+    const size_t first = c * pipe->rows;
+    const size_t rows = std::min(pipe->rows, num_queries - first);
+    GPU_CHECK(GPU_EVENT_SYNC(pipe->done[s]));
+    memcpy(h_results + first * num_refs, pipe->h_counts[s],
+           rows * num_refs * sizeof(int));
+  };
+  for (size_t c = 0; c < chunks; ++c) {
+    const int s = (int)(c % pipe->streams);
+    if (c >= (size_t)pipe->streams) {
+      drain(c - pipe->streams);
     }
+    const size_t first = c * pipe->rows;
+    const size_t rows = std::min(pipe->rows, num_queries - first);
+    const size_t chunk_bytes = rows * words_per_bitset * sizeof(T);
+    memcpy(pipe->h_chunk[s], h_queries + first * words_per_bitset,
+           chunk_bytes);
+    const int64_t launch_start = bench_now_ns();
+    GPU_CHECK(GPU_MEMCPY_ASYNC(pipe->d_chunk[s], pipe->h_chunk[s], chunk_bytes,
+                               GPU_MEMCPY_H2D, pipe->stream[s]));
+    launch_setop<T>(pipe->d_chunk[s], d_bits_qwords_T, pipe->d_counts[s],
+                    static_cast<int>(rows), static_cast<int>(num_refs),
+                    static_cast<int>(words_per_bitset), pipe->stream[s]);
+    GPU_CHECK(GPU_MEMCPY_ASYNC(pipe->h_counts[s], pipe->d_counts[s],
+                               rows * num_refs * sizeof(int), GPU_MEMCPY_D2H,
+                               pipe->stream[s]));
+    GPU_CHECK(GPU_EVENT_RECORD(pipe->done[s], pipe->stream[s]));
+    launch_ns += bench_now_ns() - launch_start;
   }
+  for (size_t c = chunks > (size_t)pipe->streams ? chunks - pipe->streams : 0;
+       c < chunks; ++c) {
+    drain(c);
+  }
+  return launch_ns;
 }
 
+// Graph mode, selected by GPU_GRAPH=1: the H2D of the queries, the kernel
+// and the D2H of the results are captured once into a graph, through pinned
+// staging, and every iteration replays it with a single launch.
+template <typename T> struct GpuGraph {
+  gpu_stream_t stream;
+  gpu_graph_exec_t exec;
+  T *h_queries;
+  int *h_results;
+};
+
 template <typename T>
-void run_setop_gpu(const T *d_bit_qwords, const T *d_bits_qwords_T,
-                   int *d_counts, int K, int N, int J) {
-  launch_setop_coarsened<T>(d_bit_qwords, d_bits_qwords_T, d_counts, K, N, J);
-  GPU_CHECK(GPU_DEVICE_SYNC);
-  GPU_CHECK(GPU_GET_LAST_ERROR);
+static bool create_graph(GpuGraph<T> *graph, T *d_queries,
+                         const T *d_bits_qwords_T, int *d_results,
+                         size_t num_queries, size_t num_refs,
+                         size_t words_per_bitset) {
+  if (env_size("GPU_GRAPH") == 0) {
+    return false;
+  }
+  const size_t queries_bytes = num_queries * words_per_bitset * sizeof(T);
+  const size_t results_bytes = num_queries * num_refs * sizeof(int);
+  GPU_CHECK(GPU_STREAM_CREATE(&graph->stream));
+  GPU_CHECK(GPU_MALLOC_HOST((void **)&graph->h_queries, queries_bytes));
+  GPU_CHECK(GPU_MALLOC_HOST((void **)&graph->h_results, results_bytes));
+  gpu_graph_t captured = nullptr;
+  GPU_CHECK(GPU_STREAM_BEGIN_CAPTURE(graph->stream));
+  GPU_CHECK(GPU_MEMCPY_ASYNC(d_queries, graph->h_queries, queries_bytes,
+                             GPU_MEMCPY_H2D, graph->stream));
+  launch_setop<T>(d_queries, d_bits_qwords_T, d_results,
+                  static_cast<int>(num_queries), static_cast<int>(num_refs),
+                  static_cast<int>(words_per_bitset), graph->stream);
+  GPU_CHECK(GPU_MEMCPY_ASYNC(graph->h_results, d_results, results_bytes,
+                             GPU_MEMCPY_D2H, graph->stream));
+  GPU_CHECK(GPU_STREAM_END_CAPTURE(graph->stream, &captured));
+  GPU_CHECK(GPU_GRAPH_INSTANTIATE(&graph->exec, captured));
+  GPU_CHECK(GPU_GRAPH_DESTROY(captured));
+  return true;
+}
+
+template <typename T> static void destroy_graph(GpuGraph<T> *graph) {
+  GPU_CHECK(GPU_GRAPH_EXEC_DESTROY(graph->exec));
+  GPU_CHECK(GPU_FREE_HOST(graph->h_results));
+  GPU_CHECK(GPU_FREE_HOST(graph->h_queries));
+  GPU_CHECK(GPU_STREAM_DESTROY(graph->stream));
+}
+
+// Replays the graph on fresh queries. Returns the host time of the launch,
+// in ns
+template <typename T>
+int64_t run_setop_gpu_graph(GpuGraph<T> *graph, const T *h_queries,
+                            uint32_t *h_results, size_t num_queries,
+                            size_t num_refs, size_t words_per_bitset) {
+  memcpy(graph->h_queries, h_queries,
+         num_queries * words_per_bitset * sizeof(T));
+  const int64_t launch_start = bench_now_ns();
+  GPU_CHECK(GPU_GRAPH_LAUNCH(graph->exec, graph->stream));
+  const int64_t launch_ns = bench_now_ns() - launch_start;
+  GPU_CHECK(GPU_STREAM_SYNC(graph->stream));
+  memcpy(h_results, graph->h_results, num_queries * num_refs * sizeof(int));
+  return launch_ns;
 }
 
 template <typename T>
@@ -300,14 +496,31 @@ benchmark_native_gpu(const T *h_queries, const T *h_refs,
   const size_t refs_bytes = words_per_bitset * num_refs * sizeof(T);
   const size_t results_bytes = num_queries * num_refs * sizeof(uint32_t);
 
+  GpuPipeline<T> pipe = {};
+  const bool pipelined =
+      create_pipeline(&pipe, num_queries, num_refs, words_per_bitset);
+  if (pipelined) {
+    printf("Streamed pipeline: %d streams, %zu queries per chunk\n",
+           pipe.streams, pipe.rows);
+  }
+
   T *d_queries = nullptr;
   T *d_refs = nullptr;
   T *d_refs_T = nullptr;
   int *d_results = nullptr;
-  GPU_CHECK(GPU_MALLOC(&d_queries, queries_bytes));
+  if (!pipelined) {
+    GPU_CHECK(GPU_MALLOC(&d_queries, queries_bytes));
+    GPU_CHECK(GPU_MALLOC(&d_results, results_bytes));
+  }
   GPU_CHECK(GPU_MALLOC(&d_refs, refs_bytes));
   GPU_CHECK(GPU_MALLOC(&d_refs_T, refs_bytes));
-  GPU_CHECK(GPU_MALLOC(&d_results, results_bytes));
+  GpuGraph<T> graph = {};
+  const bool graphed =
+      !pipelined && create_graph(&graph, d_queries, d_refs_T, d_results,
+                                 num_queries, num_refs, words_per_bitset);
+  if (graphed) {
+    puts("Graph mode: H2D, kernel and D2H replayed as one graph");
+  }
 
   GPU_CHECK(GPU_MEMCPY(d_refs, h_refs, refs_bytes, GPU_MEMCPY_H2D));
 
@@ -335,14 +548,22 @@ benchmark_native_gpu(const T *h_queries, const T *h_refs,
   GPU_CHECK(GPU_EVENT_DESTROY(transpose_start));
   GPU_CHECK(GPU_EVENT_DESTROY(transpose_stop));
 
-  GPU_CHECK(GPU_MEMCPY(d_queries, h_queries, queries_bytes, GPU_MEMCPY_H2D));
-  run_setop_gpu<T>(d_queries, d_refs_T, d_results,
-                   static_cast<int>(num_queries), static_cast<int>(num_refs),
-                   static_cast<int>(words_per_bitset));
   uint32_t *burnin_results = (uint32_t *)malloc(results_bytes);
   assert(burnin_results);
-  GPU_CHECK(
-      GPU_MEMCPY(burnin_results, d_results, results_bytes, GPU_MEMCPY_D2H));
+  if (pipelined) {
+    run_setop_gpu_pipelined<T>(&pipe, h_queries, d_refs_T, burnin_results,
+                               num_queries, num_refs, words_per_bitset);
+  } else if (graphed) {
+    run_setop_gpu_graph<T>(&graph, h_queries, burnin_results, num_queries,
+                           num_refs, words_per_bitset);
+  } else {
+    GPU_CHECK(GPU_MEMCPY(d_queries, h_queries, queries_bytes, GPU_MEMCPY_H2D));
+    run_setop_gpu<T>(d_queries, d_refs_T, d_results,
+                     static_cast<int>(num_queries), static_cast<int>(num_refs),
+                     static_cast<int>(words_per_bitset));
+    GPU_CHECK(
+        GPU_MEMCPY(burnin_results, d_results, results_bytes, GPU_MEMCPY_D2H));
+  }
   free(burnin_results);
   puts("Completed burn-in iteration to warm up GPU and PCIe paths");
 
@@ -360,11 +581,13 @@ benchmark_native_gpu(const T *h_queries, const T *h_refs,
   std::vector<double> total_times;
   std::vector<double> cpu_overhead_times;
   std::vector<double> d2h_times;
+  std::vector<double> launch_times;
   std::vector<uint32_t> iteration_results;
   kernel_times.reserve(gpu_iterations);
   total_times.reserve(gpu_iterations);
   cpu_overhead_times.reserve(gpu_iterations);
   d2h_times.reserve(gpu_iterations);
+  launch_times.reserve(gpu_iterations);
   iteration_results.reserve(gpu_iterations);
 
   result.gpu_results = (uint32_t *)malloc(results_bytes);
@@ -372,23 +595,42 @@ benchmark_native_gpu(const T *h_queries, const T *h_refs,
   memset(result.gpu_results, 0, results_bytes);
 
   for (int repeat = 0; repeat < gpu_iterations; ++repeat) {
-    int64_t total_start = time_ns();
-    GPU_CHECK(GPU_MEMCPY(d_queries, h_queries, queries_bytes, GPU_MEMCPY_H2D));
+    int64_t total_start = bench_now_ns();
+    int64_t launch_ns = 0;
+    if (!pipelined && !graphed) {
+      GPU_CHECK(
+          GPU_MEMCPY(d_queries, h_queries, queries_bytes, GPU_MEMCPY_H2D));
+    }
     gpu_event_t kernel_start = nullptr;
     gpu_event_t kernel_stop = nullptr;
     GPU_CHECK(GPU_EVENT_CREATE(&kernel_start));
     GPU_CHECK(GPU_EVENT_CREATE(&kernel_stop));
     GPU_CHECK(GPU_EVENT_RECORD(kernel_start, 0));
-    run_setop_gpu<T>(d_queries, d_refs_T, d_results,
-                     static_cast<int>(num_queries), static_cast<int>(num_refs),
-                     static_cast<int>(words_per_bitset));
+    if (pipelined) {
+      // the kernel timing spans the transfers that overlap the kernels
+      launch_ns = run_setop_gpu_pipelined<T>(&pipe, h_queries, d_refs_T,
+                                             result.gpu_results, num_queries,
+                                             num_refs, words_per_bitset);
+    } else if (graphed) {
+      // as it does the copies replayed by the graph
+      launch_ns = run_setop_gpu_graph<T>(&graph, h_queries, result.gpu_results,
+                                         num_queries, num_refs,
+                                         words_per_bitset);
+    } else {
+      launch_ns = run_setop_gpu<T>(d_queries, d_refs_T, d_results,
+                                   static_cast<int>(num_queries),
+                                   static_cast<int>(num_refs),
+                                   static_cast<int>(words_per_bitset));
+    }
     GPU_CHECK(GPU_EVENT_RECORD(kernel_stop, 0));
     GPU_CHECK(GPU_EVENT_SYNC(kernel_stop));
-    int64_t d2h_start = time_ns();
-    GPU_CHECK(GPU_MEMCPY(result.gpu_results, d_results, results_bytes,
-                         GPU_MEMCPY_D2H));
-    int64_t d2h_end = time_ns();
-    int64_t cpu_scan_start = time_ns();
+    int64_t d2h_start = bench_now_ns();
+    if (!pipelined && !graphed) {
+      GPU_CHECK(GPU_MEMCPY(result.gpu_results, d_results, results_bytes,
+                           GPU_MEMCPY_D2H));
+    }
+    int64_t d2h_end = bench_now_ns();
+    int64_t cpu_scan_start = bench_now_ns();
     uint32_t max_val = 0;
     uint32_t current = 0;
     const size_t nelem = num_queries * num_refs;
@@ -398,8 +640,8 @@ benchmark_native_gpu(const T *h_queries, const T *h_refs,
         max_val = current;
       }
     }
-    int64_t cpu_scan_end = time_ns();
-    int64_t total_end = time_ns();
+    int64_t cpu_scan_end = bench_now_ns();
+    int64_t total_end = bench_now_ns();
 
     float kernel_ms = 0.0f;
     GPU_CHECK(GPU_EVENT_ELAPSED_TIME(&kernel_ms, kernel_start, kernel_stop));
@@ -413,6 +655,7 @@ benchmark_native_gpu(const T *h_queries, const T *h_refs,
     kernel_times.push_back(kernel_ms);
     cpu_overhead_times.push_back(cpu_ns / 1.0e6);
     d2h_times.push_back(d2h_ns / 1.0e6);
+    launch_times.push_back((double)launch_ns / 1.0e6);
     iteration_results.push_back((uint32_t)max_val);
 
     if (csv_file) {
@@ -426,11 +669,15 @@ benchmark_native_gpu(const T *h_queries, const T *h_refs,
               ? (total_ns_ull - kernel_ns - cpu_ns_ull)
               : 0ULL;
       write_csv_row(csv_file, GPU_TILE_J, GPU_ILP, bitset_bits, num_queries, num_refs,
-                    repeat + 1, "kernel", kernel_ns);
+                    repeat + 1,
+                    pipelined ? "pipelined" : graphed ? "graph" : "kernel",
+                    kernel_ns);
       write_csv_row(csv_file, GPU_TILE_J, GPU_ILP, bitset_bits, num_queries, num_refs,
                     repeat + 1, "total", total_ns_ull);
       write_csv_row(csv_file, GPU_TILE_J, GPU_ILP, bitset_bits, num_queries, num_refs,
                     repeat + 1, "PCIe", pcie_ns);
+      write_csv_row(csv_file, GPU_TILE_J, GPU_ILP, bitset_bits, num_queries, num_refs,
+                    repeat + 1, "launch", (unsigned long long)launch_ns);
       fflush(csv_file);
     }
   }
@@ -450,6 +697,10 @@ benchmark_native_gpu(const T *h_queries, const T *h_refs,
   result.per_iter_kernel_ms = std::move(kernel_times);
   result.per_iter_total_ms = std::move(total_times);
   result.per_iter_cpu_overhead_ms = std::move(cpu_overhead_times);
+  result.launch_time_ns =
+      std::accumulate(launch_times.begin(), launch_times.end(), 0.0) * 1.0e6 /
+      gpu_iterations;
+  result.per_iter_launch_ms = std::move(launch_times);
   result.per_iter_d2h_ms = std::move(d2h_times);
   result.per_iter_results = std::move(iteration_results);
   result.per_iter_transpose_ms.resize(1, transpose_ms);
@@ -485,10 +736,45 @@ benchmark_native_gpu(const T *h_queries, const T *h_refs,
     fclose(csv_file);
   }
 
-  GPU_CHECK(GPU_FREE(d_results));
+  // the same samples through the benchmark harness, in nanoseconds
+  {
+    char params[160];
+    snprintf(params, sizeof(params),
+             "backend=%s method=%s size=%zu queries=%zu refs=%zu tile_j=%d "
+             "ilp=%d",
+             BACKEND_NAME, POPCOUNT_METHOD_LABEL, bitset_bits, num_queries,
+             num_refs, GPU_TILE_J, GPU_ILP);
+    const double pairs = (double)(num_queries * num_refs);
+    std::vector<double> samples_ns(gpu_iterations);
+    const std::vector<double> *phases[] = {&result.per_iter_kernel_ms,
+                                           &result.per_iter_total_ms,
+                                           &result.per_iter_launch_ms};
+    const char *names[] = {
+        pipelined ? "pipelined" : graphed ? "graph" : "kernel", "total",
+        "launch"};
+    for (int p = 0; p < 3; ++p) {
+      for (int i = 0; i < gpu_iterations; ++i) {
+        samples_ns[i] = (*phases[p])[i] * 1.0e6;
+      }
+      bench_record(names[p], params, p < 2 ? pairs : 0.0,
+                   p < 2 ? "comparisons" : "", samples_ns.data(),
+                   samples_ns.size(), (int64_t)result.max_result);
+    }
+    const bench_config config = bench_config_default(BACKEND_NAME "_bench");
+    bench_run(&config);
+  }
+
+  if (graphed) {
+    destroy_graph(&graph);
+  }
+  if (pipelined) {
+    destroy_pipeline(&pipe);
+  } else {
+    GPU_CHECK(GPU_FREE(d_results));
+    GPU_CHECK(GPU_FREE(d_queries));
+  }
   GPU_CHECK(GPU_FREE(d_refs_T));
   GPU_CHECK(GPU_FREE(d_refs));
-  GPU_CHECK(GPU_FREE(d_queries));
 
   return result;
 }
@@ -503,6 +789,12 @@ int main(int argc, char *argv[]) {
     fprintf(stderr,
             "This will create 1000 bitsets of size 1024 and run 10 GPU-only "
             "containerized intersection-count iterations on GPU 0.\n");
+    fprintf(stderr,
+            "GPU_STREAMS=<n> [GPU_CHUNK_ROWS=<rows>] streams the queries in "
+            "chunks over n streams instead; GPU_GRAPH=1 replays the copies "
+            "and kernel as one graph; GPU_KERNEL=shuffle runs the "
+            "warp-shuffle kernel on rows of up to %d words.\n",
+            GPU_SHUFFLE_WORDS);
     return EXIT_FAILURE;
   }
 
@@ -552,6 +844,10 @@ int main(int argc, char *argv[]) {
   GPU_CHECK(GPU_SET_DEVICE(gpu_id));
   printf("Starting GPU-only benchmark\n");
   printf("GPU_TILE_J: %d, GPU_ILP: %d, word_bits: %u\n", GPU_TILE_J, GPU_ILP, word_bits);
+  if (shuffle_kernel_selected(
+          (int)((size + word_bits - 1) / word_bits))) {
+    puts("Kernel: warp shuffle");
+  }
 
   const size_t words_per_bitset = (size_t)(size + word_bits - 1) / word_bits;
   const size_t query_words = words_per_bitset * (size_t)num_of_bits;
@@ -604,6 +900,13 @@ int main(int argc, char *argv[]) {
                         static_cast<float>(result.per_iter_cpu_overhead_ms[0] /
                                            result.per_iter_cpu_overhead_ms[i]));
     }
+    puts("Launch Overhead Timings:");
+    for (int i = 0; i < gpu_iterations; ++i) {
+      summarize_results(test_name, ms_to_ns(result.per_iter_launch_ms[i]),
+                        i + 1, result.per_iter_results[i],
+                        static_cast<float>(result.per_iter_launch_ms[0] /
+                                           result.per_iter_launch_ms[i]));
+    }
     puts("Transpose Timing:");
     printf("  transpose: %.3f ms\n", result.per_iter_transpose_ms[0]);
     puts("\nPer-Iteration Data Movement Breakdown:");
@@ -659,6 +962,7 @@ int main(int argc, char *argv[]) {
            stddev_total_ns);
     printf("Total operation throughput: mean=%.3lf GB/s, stddev=%.3lf GB/s\n",
            avg_total_gbps, stddev_total_gbps);
+    printf("Launch overhead: mean=%.3f ns\n", result.launch_time_ns);
     printf("%s,backend=%s,method=%s,bitset_bits=%d,nelem=%d,iterations=%d,avg_"
            "ns=%.3f,stddev_ns=%.3f,gbps=%.6f,gbps_stddev=%.6f,max=%u\n",
            BACKEND_SUMMARY_LABEL, BACKEND_NAME, POPCOUNT_METHOD_LABEL, size,
@@ -721,6 +1025,13 @@ int main(int argc, char *argv[]) {
                       static_cast<float>(result.per_iter_cpu_overhead_ms[0] /
                                          result.per_iter_cpu_overhead_ms[i]));
   }
+  puts("Launch Overhead Timings:");
+  for (int i = 0; i < gpu_iterations; ++i) {
+    summarize_results(test_name, ms_to_ns(result.per_iter_launch_ms[i]), i + 1,
+                      result.per_iter_results[i],
+                      static_cast<float>(result.per_iter_launch_ms[0] /
+                                         result.per_iter_launch_ms[i]));
+  }
   puts("Transpose Timing:");
   printf("  transpose: %.3f ms\n", result.per_iter_transpose_ms[0]);
   puts("\nPer-Iteration Data Movement Breakdown:");
@@ -776,6 +1087,7 @@ int main(int argc, char *argv[]) {
          stddev_total_ns);
   printf("Total operation throughput: mean=%.3lf GB/s, stddev=%.3lf GB/s\n",
          avg_total_gbps, stddev_total_gbps);
+  printf("Launch overhead: mean=%.3f ns\n", result.launch_time_ns);
   printf("%s,backend=%s,method=%s,bitset_bits=%d,nelem=%d,iterations=%d,avg_ns="
          "%.3f,stddev_ns=%.3f,gbps=%.6f,gbps_stddev=%.6f,max=%u\n",
          BACKEND_SUMMARY_LABEL, BACKEND_NAME, POPCOUNT_METHOD_LABEL, size,
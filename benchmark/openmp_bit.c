@@ -6,13 +6,15 @@ OpenMP enabled benchmarks
 #define _POSIX_C_SOURCE 199309L
 
 #include "bit.h"
+#include "bench_data.h"
+#include "bench_harness.h"
+#include "bench_roofline.h"
 #include <assert.h> // For assert() validation
 #include <omp.h>    // For OpenMP parallelization
 #include <stdint.h> // For int64_t type
 #include <stdio.h>  // For printf/fprintf functions
 #include <stdlib.h> // For malloc, atoi, and EXIT_FAILURE
 #include <string.h> // For memcpy
-#include <time.h>   // For timespec structure and clock_gettime
 #define MAX_THREADS 1024
 #define MIN_SIZE 128
 #define POPCOUNT(x) (int)count_WWG((x))
@@ -30,15 +32,34 @@ typedef CONTAINER* bitcontainer;
 #endif
 
 static inline unsigned long long count_WWG(unsigned long long x);
-int64_t timeDiff(struct timespec* timeA_p, struct timespec* timeB_p);
 int database_match(Bit_T* bit, Bit_T* bitsets, int num_of_bits,
   int num_of_ref_bits);
 int database_match_omp(Bit_T* bit, Bit_T* bitsets, int num_of_bits,
   int num_of_ref_bits, int threads);
 int database_match_container_omp(Bit_DB_T db1, Bit_DB_T db2, int threads);
+int database_match_indirect_omp(Bit_IDB_T idb1, Bit_IDB_T idb2, int threads);
 int database_match_GPU(Bit_DB_T db1, Bit_DB_T db2, SETOP_COUNT_OPTS opts);
-void summarize_results(char* test, int64_t timeElapsed, int num_of_threads,
-  int result, float speedup);
+
+// One registered case: the search it times and the operands, built once
+typedef struct {
+  Bit_T* bits;
+  Bit_T* bitsets;
+  int num_of_bits;
+  int num_of_ref_bits;
+  Bit_DB_T db1;
+  Bit_DB_T db2;
+  Bit_IDB_T idb1;
+  Bit_IDB_T idb2;
+  int threads;
+  SETOP_COUNT_OPTS opts;
+  char params[384];
+} match_case;
+
+int64_t bench_serial(void* arg);
+int64_t bench_omp(void* arg);
+int64_t bench_container_omp(void* arg);
+int64_t bench_indirect_omp(void* arg);
+int64_t bench_GPU(void* arg);
 
 int main(int argc, char* argv []) {
   if (argc != 5 && argc != 6) {
@@ -132,135 +153,128 @@ int main(int argc, char* argv []) {
 
   Bit_set(bits[0], size / 2 - 1, size / 2 + 5);
   Bit_set(bitsets[0], size / 2, size / 2 + 5);
+  // or the workload of BENCH_DATA
+  bench_data_fill(bits, num_of_bits, BENCH_DATA_QUERIES);
+  bench_data_fill(bitsets, num_of_ref_bits, BENCH_DATA_REFERENCES);
   printf("Finished allocating bitsets \n");
 
-  Bit_DB_T db1 = BitDB_new(size, num_of_bits);
-  Bit_DB_T db2 = BitDB_new(size, num_of_ref_bits);
-  for (int i = 0; i < num_of_bits; i++)
-    BitDB_put_at(db1, i, bits[i]);
-
-  for (int i = 0; i < num_of_ref_bits; i++)
-    BitDB_put_at(db2, i, bitsets[i]);
+  Bit_DB_T db1 = BitDB_from_bitsets(bits, num_of_bits);
+  Bit_DB_T db2 = BitDB_from_bitsets(bitsets, num_of_ref_bits);
+  // the same bitsets, counted in place by the tiled engine
+  Bit_IDB_T idb1 = BitIDB_from_bitsets(bits, num_of_bits);
+  Bit_IDB_T idb2 = BitIDB_from_bitsets(bitsets, num_of_ref_bits);
 
   printf("Finished allocating BitDB\n");
-  int64_t timings[2 * MAX_THREADS + 6];
-  int64_t results[2 * MAX_THREADS + 6];
-  int max = 0;
-  struct timespec start_time, end_time;
-
-  max = database_match(bits, bitsets, num_of_bits,
-    num_of_ref_bits); // to warm up the processor
-
-  clock_gettime(CLOCK_MONOTONIC, &start_time);
-  max = database_match(bits, bitsets, num_of_bits, num_of_ref_bits);
-  clock_gettime(CLOCK_MONOTONIC, &end_time);
-  int64_t duration = timeDiff(&end_time, &start_time);
-  timings[0] = duration;
-  results[0] = max;
-
-  clock_gettime(CLOCK_MONOTONIC, &start_time);
-  max = database_match(bits, bitsets, num_of_bits, num_of_ref_bits);
-  clock_gettime(CLOCK_MONOTONIC, &end_time);
-  duration = timeDiff(&end_time, &start_time);
-  timings[1] = duration;
-  results[1] = max;
-
-  clock_gettime(CLOCK_MONOTONIC, &start_time);
-  max = database_match(bits, bitsets, num_of_bits, num_of_ref_bits);
-  clock_gettime(CLOCK_MONOTONIC, &end_time);
-  duration = timeDiff(&end_time, &start_time);
-  timings[2] = duration;
-  results[2] = max;
-
-  puts("Finished single-threaded match");
-  for (int i = 1; i <= max_threads; i++) {
-    clock_gettime(CLOCK_MONOTONIC, &start_time);
-    max = database_match_omp(bits, bitsets, num_of_bits, num_of_ref_bits, i);
-    clock_gettime(CLOCK_MONOTONIC, &end_time);
-    duration = timeDiff(&end_time, &start_time);
-    timings[2 + i] = duration;
-    results[2 + i] = max;
+  match_case base = { .bits = bits, .bitsets = bitsets,
+    .num_of_bits = num_of_bits, .num_of_ref_bits = num_of_ref_bits,
+    .db1 = db1, .db2 = db2, .idb1 = idb1, .idb2 = idb2, .threads = 1 };
+  const double pairs = (double)num_of_bits * num_of_ref_bits;
+  match_case* cases = calloc(3 * (size_t)max_threads + 4, sizeof(match_case));
+  assert(cases != NULL);
+  size_t ncases = 0;
+
+  // the container cases are placed against the roofs of the machine
+  bench_probe_roofs(max_threads);
+  const int words = (size + 63) / 64;
+  const double container_bytes = bench_count_bytes(num_of_bits,
+    num_of_ref_bits, words, Bit_tuning_get().tile);
+  const double container_words = bench_count_words(num_of_bits,
+    num_of_ref_bits, words);
+
+  // The serial search is the baseline the others are compared against
+  cases[ncases] = base;
+  snprintf(cases[ncases].params, sizeof(cases[ncases].params),
+    "size=%d queries=%d refs=%d threads=1%s", size, num_of_bits,
+    num_of_ref_bits, bench_data_params());
+  bench_register(&(bench_case) { .name = "Serial", .params = cases[ncases].params,
+    .work = pairs, .unit = "comparisons", .body = bench_serial,
+    .arg = &cases[ncases] });
+  ncases++;
+  for (int i = 1; i <= max_threads; i++, ncases++) {
+    cases[ncases] = base;
+    cases[ncases].threads = i;
+    snprintf(cases[ncases].params, sizeof(cases[ncases].params),
+      "size=%d queries=%d refs=%d threads=%d%s", size, num_of_bits,
+      num_of_ref_bits, i, bench_data_params());
+    bench_register(&(bench_case) { .name = "OpenMP", .params = cases[ncases].params,
+      .work = pairs, .unit = "comparisons", .body = bench_omp,
+      .arg = &cases[ncases] });
   }
-  puts("Finished multi-threaded match with OpenMP");
-  for (int i = max_threads + 1; i <= 2 * max_threads; i++) {
-    clock_gettime(CLOCK_MONOTONIC, &start_time);
-    max = database_match_container_omp(db1, db2, i - max_threads);
-    clock_gettime(CLOCK_MONOTONIC, &end_time);
-    duration = timeDiff(&end_time, &start_time);
-    timings[2 + i] = duration;
-    results[2 + i] = max;
+  for (int i = 1; i <= max_threads; i++, ncases++) {
+    cases[ncases] = base;
+    cases[ncases].threads = i;
+    snprintf(cases[ncases].params, sizeof(cases[ncases].params),
+      "size=%d queries=%d refs=%d threads=%d%s", size, num_of_bits,
+      num_of_ref_bits, i, bench_data_params());
+    bench_register(&(bench_case) { .name = "Container OpenMP",
+      .params = cases[ncases].params, .work = pairs, .unit = "comparisons",
+      .body = bench_container_omp, .arg = &cases[ncases],
+      .bytes = container_bytes, .words = container_words });
   }
-  puts("Finished multi-threaded match of containers with OpenMP");
-  clock_gettime(CLOCK_MONOTONIC, &start_time);
-  max = database_match_GPU(db1, db2,
-    (SETOP_COUNT_OPTS) {
-    .device_id =    gpu_id,
-      .upd_1st_operand = true,
-      .upd_2nd_operand = true
-  });
-  clock_gettime(CLOCK_MONOTONIC, &end_time);
-  duration = timeDiff(&end_time, &start_time);
-  timings[2 + 2 * max_threads + 1] = duration;
-  results[2 + 2 * max_threads + 1] = max;
-
-  clock_gettime(CLOCK_MONOTONIC, &start_time);
-  max = database_match_GPU(db1, db2,
-    (SETOP_COUNT_OPTS) {
-    .device_id =    gpu_id,
-      .upd_1st_operand = true,
-      .upd_2nd_operand = false  
-});
-  clock_gettime(CLOCK_MONOTONIC, &end_time);
-  duration = timeDiff(&end_time, &start_time);
-  timings[2 + 2 * max_threads + 2] = duration;
-  results[2 + 2 * max_threads + 2] = max;
-
-  clock_gettime(CLOCK_MONOTONIC, &start_time);
-  max = database_match_GPU(db1, db2,
-    (SETOP_COUNT_OPTS) {
-    .device_id =    gpu_id,
-      .upd_1st_operand = true,
-      .upd_2nd_operand = false,
-      .release_1st_operand = true,
-      .release_2nd_operand = true,
-      .release_counts = true
-  });
-  clock_gettime(CLOCK_MONOTONIC, &end_time);
-  duration = timeDiff(&end_time, &start_time);
-  timings[2 + 2 * max_threads + 3] = duration;
-  results[2 + 2 * max_threads + 3] = max;
-
-  // Print results
-  puts("Results:");
-  summarize_results("Single-threaded - Serial - Rep1", timings[0], 1,
-    results[0], 1.0f);
-  summarize_results("Single-threaded - Serial - Rep2", timings[1], 1,
-    results[1], (float)timings[0] / timings[1]);
-  summarize_results("Single-threaded - Serial - Rep3", timings[2], 1,
-    results[2], (float)timings[0] / timings[2]);
-  for (int i = 1; i <= max_threads; i++) {
-    summarize_results(" Multi-threaded - OpenMP", timings[2 + i], i,
-      results[2 + i], (float)timings[0] / timings[2 + i]);
+  for (int i = 1; i <= max_threads; i++, ncases++) {
+    cases[ncases] = base;
+    cases[ncases].threads = i;
+    snprintf(cases[ncases].params, sizeof(cases[ncases].params),
+      "size=%d queries=%d refs=%d threads=%d%s", size, num_of_bits,
+      num_of_ref_bits, i, bench_data_params());
+    bench_register(&(bench_case) { .name = "Indirect OpenMP",
+      .params = cases[ncases].params, .work = pairs, .unit = "comparisons",
+      .body = bench_indirect_omp, .arg = &cases[ncases],
+      .bytes = container_bytes, .words = container_words });
   }
-  for (int i = max_threads + 1; i <= 2 * max_threads; i++) {
-    summarize_results("Container - Multi-threaded - OpenMP", timings[2 + i],
-      i - max_threads, results[2 + i],
-      (float)timings[0] / timings[2 + i]);
-  }
-  for (int i = 2 * max_threads + 1; i <= 2 * max_threads + 3; i++) {
-    summarize_results("Container - GPU - OpenMP", timings[2 + i], -1,
-      results[2 + i], (float)timings[0] / timings[2 + i]);
+
+  // Both operands uploaded on every search, then the references kept on the
+  // device, then everything released after each search
+  const SETOP_COUNT_OPTS gpu_opts[] = {
+    { .device_id = gpu_id, .upd_1st_operand = true, .upd_2nd_operand = true },
+    { .device_id = gpu_id, .upd_1st_operand = true, .upd_2nd_operand = false },
+    { .device_id = gpu_id, .upd_1st_operand = true, .upd_2nd_operand = true,
+      .release_1st_operand = true, .release_2nd_operand = true,
+      .release_counts = true },
+  };
+  const char* gpu_modes[] = { "upload", "resident", "release" };
+  for (int i = 0; i < 3; i++, ncases++) {
+    cases[ncases] = base;
+    cases[ncases].opts = gpu_opts[i];
+    snprintf(cases[ncases].params, sizeof(cases[ncases].params),
+      "size=%d queries=%d refs=%d device=%d mode=%s%s", size, num_of_bits,
+      num_of_ref_bits, gpu_id, gpu_modes[i], bench_data_params());
+    bench_register(&(bench_case) { .name = "Container GPU",
+      .params = cases[ncases].params, .work = pairs, .unit = "comparisons",
+      .body = bench_GPU, .arg = &cases[ncases] });
   }
+
+  const bench_config config = bench_config_default(argv[0]);
+  const int status = bench_run(&config);
+  free(cases);
+  return status == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+int64_t bench_serial(void* arg) {
+  match_case* m = arg;
+  return database_match(m->bits, m->bitsets, m->num_of_bits,
+    m->num_of_ref_bits);
 }
 
-void summarize_results(char* test, int64_t timeElapsed, int num_of_threads,
-  int result, float speedup) {
-  printf("Total time for %-35s: %15ld ns\t", test, timeElapsed);
-  printf("Searches per second : %0.2f\t", (float)1E9 / timeElapsed);
-  num_of_threads > 0 ? printf("Number of threads: %3d \t", num_of_threads)
-    : printf("Number of threads: GPU \t");
-  printf("Result: %d\t", result);
-  printf("Speedup factor: %.2f\n", speedup);
+int64_t bench_omp(void* arg) {
+  match_case* m = arg;
+  return database_match_omp(m->bits, m->bitsets, m->num_of_bits,
+    m->num_of_ref_bits, m->threads);
+}
+
+int64_t bench_container_omp(void* arg) {
+  match_case* m = arg;
+  return database_match_container_omp(m->db1, m->db2, m->threads);
+}
+
+int64_t bench_indirect_omp(void* arg) {
+  match_case* m = arg;
+  return database_match_indirect_omp(m->idb1, m->idb2, m->threads);
+}
+
+int64_t bench_GPU(void* arg) {
+  match_case* m = arg;
+  return database_match_GPU(m->db1, m->db2, m->opts);
 }
 
 int database_match(Bit_T* bit, Bit_T* bitsets, int num_of_bits,
@@ -346,6 +360,27 @@ int database_match_container_omp(Bit_DB_T db1, Bit_DB_T db2, int num_threads) {
   return (int)max;
 }
 
+int database_match_indirect_omp(Bit_IDB_T idb1, Bit_IDB_T idb2,
+  int num_threads) {
+  int max = 0, current = 0;
+  size_t nelem = (size_t)BitIDB_nelem(idb1) * BitIDB_nelem(idb2);
+  int* results = malloc(nelem * sizeof(int));
+  if (results == NULL) {
+    fprintf(stderr, "Error: Unable to allocate memory for counts array of size %zu in %s\n", nelem, __func__);
+    exit(EXIT_FAILURE);
+  }
+  BitIDB_count_store(idb1, idb2, BIT_COUNT_INTER, results,
+    (SETOP_COUNT_OPTS) { .num_cpu_threads = num_threads });
+  for (size_t i = 0; i < nelem; i++) {
+    current = results[i];
+    if (current > max) {
+      max = current;
+    }
+  }
+  free(results);
+  return max;
+}
+
 int database_match_GPU(Bit_DB_T db1, Bit_DB_T db2, SETOP_COUNT_OPTS opts) {
   int max = 0, current = 0, * results;
   results = BitDB_inter_count_gpu(db1, db2, opts);
@@ -359,10 +394,6 @@ int database_match_GPU(Bit_DB_T db1, Bit_DB_T db2, SETOP_COUNT_OPTS opts) {
   // free(results);
   return (int)max;
 }
-int64_t timeDiff(struct timespec* timeA_p, struct timespec* timeB_p) {
-  return ((timeA_p->tv_sec - timeB_p->tv_sec) * 1000000000 + timeA_p->tv_nsec -
-    timeB_p->tv_nsec);
-}
 
 static inline unsigned long long count_WWG(unsigned long long x) {
 #define C1_WWG UINT64_C(0X5555555555555555)
@@ -2,17 +2,31 @@
 #define _POSIX_C_SOURCE 199309L
 
 #include "bit.h"
-#include <inttypes.h>
+#include "bench_data.h"
+#include "bench_harness.h"
+#include "bench_roofline.h"
 #include <limits.h>
 #include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
-#include <time.h>
 
-static int64_t elapsed_ns(const struct timespec *start,
-                          const struct timespec *end) {
-  return (int64_t)(end->tv_sec - start->tv_sec) * INT64_C(1000000000) +
-         end->tv_nsec - start->tv_nsec;
+typedef struct {
+  Bit_DB_T left;
+  Bit_DB_T right;
+  int *results;
+  size_t result_count;
+  SETOP_COUNT_OPTS opts;
+} count_case;
+
+/* One count; the checksum of the matrix is the check */
+static int64_t bench_count(void *arg) {
+  count_case *c = arg;
+  BitDB_inter_count_store_cpu(c->left, c->right, c->results, c->opts);
+  uint64_t checksum = 0;
+  for (size_t i = 0; i < c->result_count; ++i) {
+    checksum += (uint32_t)c->results[i];
+  }
+  return (int64_t)checksum;
 }
 
 static int parse_positive(const char *text, const char *name) {
@@ -49,16 +63,21 @@ int main(int argc, char *argv[]) {
 
   Bit_DB_T left = BitDB_new(bit_length, left_count);
   Bit_DB_T right = BitDB_new(bit_length, right_count);
-  Bit_T template = Bit_new(bit_length);
-  Bit_set(template, bit_length / 2, bit_length - 1);
-
-  for (int i = 0; i < left_count; ++i) {
-    BitDB_put_at(left, i, template);
-  }
-  for (int j = 0; j < right_count; ++j) {
-    BitDB_put_at(right, j, template);
+  if (bench_data_enabled()) {
+    bench_data_fill_db(left, BENCH_DATA_QUERIES);
+    bench_data_fill_db(right, BENCH_DATA_REFERENCES);
+  } else {
+    Bit_T template = Bit_new(bit_length);
+    Bit_set(template, bit_length / 2, bit_length - 1);
+
+    for (int i = 0; i < left_count; ++i) {
+      BitDB_put_at(left, i, template);
+    }
+    for (int j = 0; j < right_count; ++j) {
+      BitDB_put_at(right, j, template);
+    }
+    Bit_free(&template);
   }
-  Bit_free(&template);
 
   int *results = malloc(result_count * sizeof(*results));
   if (results == NULL) {
@@ -68,45 +87,33 @@ int main(int argc, char *argv[]) {
     return EXIT_FAILURE;
   }
 
-  const SETOP_COUNT_OPTS opts = {.num_cpu_threads = threads};
   print_Bit_configuration();
-
-  /* Establish mappings, page placement, and OpenMP worker state. */
-  BitDB_inter_count_store_cpu(left, right, results, opts);
-
-  int64_t total_ns = 0;
-  int64_t best_ns = INT64_MAX;
-  for (int run = 0; run < repetitions; ++run) {
-    struct timespec start;
-    struct timespec end;
-    clock_gettime(CLOCK_MONOTONIC, &start);
-    BitDB_inter_count_store_cpu(left, right, results, opts);
-    clock_gettime(CLOCK_MONOTONIC, &end);
-
-    const int64_t duration = elapsed_ns(&start, &end);
-    total_ns += duration;
-    if (duration < best_ns) {
-      best_ns = duration;
-    }
-    printf("run %d: %" PRId64 " ns\n", run + 1, duration);
-  }
-
-  uint64_t checksum = 0;
-  for (size_t i = 0; i < result_count; ++i) {
-    checksum += (uint32_t)results[i];
-  }
-
-  const double qword_reductions =
-      (double)left_count * right_count * ((bit_length + 63) / 64);
-  const double average_ns = (double)total_ns / repetitions;
-  printf("best:    %" PRId64 " ns (%.3f Gqword-pairs/s)\n", best_ns,
-         qword_reductions / best_ns);
-  printf("average: %.0f ns (%.3f Gqword-pairs/s)\n", average_ns,
-         qword_reductions / average_ns);
-  printf("checksum: %" PRIu64 "\n", checksum);
+  bench_probe_roofs(threads);
+
+  /* The untimed warm-up establishes mappings, page placement, and OpenMP
+     worker state; repetitions is the number of timed counts. */
+  count_case c = {left, right, results, result_count,
+                  {.num_cpu_threads = threads}};
+  const int words = (bit_length + 63) / 64;
+  char params[384];
+  snprintf(params, sizeof(params), "bits=%d left=%d right=%d threads=%d%s",
+           bit_length, left_count, right_count, threads, bench_data_params());
+  bench_register(&(bench_case){
+      .name = "BitDB_inter_count_store_cpu",
+      .params = params,
+      .work = (double)result_count,
+      .unit = "comparisons",
+      .body = bench_count,
+      .arg = &c,
+      .bytes = bench_count_bytes(left_count, right_count, words,
+                                 Bit_tuning_get().tile),
+      .words = bench_count_words(left_count, right_count, words)});
+  bench_config config = bench_config_default(argv[0]);
+  config.repetitions = repetitions;
+  const int status = bench_run(&config);
 
   free(results);
   BitDB_free(&left);
   BitDB_free(&right);
-  return EXIT_SUCCESS;
+  return status == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
 }
@@ -191,14 +191,8 @@ int main(int argc, char *argv[]) {
   }
 
 
-  Bit_DB_T db1 = BitDB_new(size, num_of_bits);
-  Bit_DB_T db2 = BitDB_new(size, num_of_ref_bits);
-  for (int i = 0; i < num_of_bits; i++) {
-    BitDB_put_at(db1, i, bits[i]);
-  }
-  for (int i = 0; i < num_of_ref_bits; i++) {
-    BitDB_put_at(db2, i, bitsets[i]);
-  }
+  Bit_DB_T db1 = BitDB_from_bitsets(bits, num_of_bits);
+  Bit_DB_T db2 = BitDB_from_bitsets(bitsets, num_of_ref_bits);
 
   int64_t timings[MAX_GPU_ITERATIONS + 1];
   int64_t PCIe_timings[MAX_GPU_ITERATIONS + 1];
@@ -0,0 +1,312 @@
+/*
+    Thread and socket scaling of the CPU intersection count.
+
+    The driver reads the NUMA topology from sysfs and runs one worker
+    process per configuration: the first 1..k nodes, with power-of-two
+    thread counts on one node and every physical core on several, each with
+    OMP_PLACES set to those cores and OMP_PROC_BIND close (one node) or
+    spread (several), since the OpenMP runtime reads both only once. Workers
+    place the rows with BIT_NUMA_FIRST_TOUCH, so they land on the nodes of
+    the threads that count them. Strong scaling keeps the problem; weak
+    scaling gives every thread queries / max threads queries, so that both
+    meet at the largest run. The driver reports speedup, parallel efficiency
+    and bandwidth per node, and records the timings with the harness.
+*/
+#define _GNU_SOURCE // sched_getaffinity
+
+#include "bit.h"
+#include "bench_data.h"
+#include "bench_harness.h"
+#include "bench_roofline.h"
+#include <limits.h>
+#include <sched.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#define MAX_CPUS 4096
+#define MAX_NODES 64
+#define MAX_RUNS 256
+#define MAX_SAMPLES 1024
+
+typedef struct {
+  int cpus[MAX_CPUS]; // physical cores of the node we may run on
+  int ncpus;
+} node_cpus;
+
+typedef struct {
+  bool weak;
+  int nodes, threads, queries;
+  double samples[MAX_SAMPLES];
+  size_t nsamples;
+  int64_t check;
+  double median;
+  char params[384];
+} scaling_run;
+
+static int parse_positive(const char *text, const char *name) {
+  char *end = NULL;
+  long value = strtol(text, &end, 10);
+  if (*text == '\0' || *end != '\0' || value <= 0 || value > INT_MAX) {
+    fprintf(stderr, "%s must be an integer in [1, %d]\n", name, INT_MAX);
+    exit(EXIT_FAILURE);
+  }
+  return (int)value;
+}
+
+/* "0-3,8,10-11" into cpus; returns their number */
+static int parse_cpulist(const char *list, int *cpus, int max) {
+  int n = 0;
+  for (const char *p = list; *p && *p != '\n';) {
+    char *end;
+    const long lo = strtol(p, &end, 10);
+    long hi = lo;
+    if (end == p)
+      break;
+    if (*end == '-')
+      hi = strtol(end + 1, &end, 10);
+    for (long c = lo; c <= hi && n < max; c++)
+      cpus[n++] = (int)c;
+    p = *end == ',' ? end + 1 : end;
+  }
+  return n;
+}
+
+static bool read_line(const char *path, char *line, size_t size) {
+  FILE *file = fopen(path, "r");
+  if (!file)
+    return false;
+  const bool ok = fgets(line, (int)size, file) != NULL;
+  fclose(file);
+  return ok;
+}
+
+/* The first hardware thread of every core we may run on, by node */
+static int read_topology(node_cpus *nodes) {
+  cpu_set_t allowed;
+  CPU_ZERO(&allowed);
+  if (sched_getaffinity(0, sizeof(allowed), &allowed) != 0)
+    for (int c = 0; c < CPU_SETSIZE; c++)
+      CPU_SET(c, &allowed);
+  static int cpus[MAX_CPUS];
+  char path[128], line[4096];
+  int nnodes = 0;
+  for (int node = 0; node < MAX_NODES; node++) {
+    snprintf(path, sizeof(path), "/sys/devices/system/node/node%d/cpulist",
+             node);
+    int n;
+    if (read_line(path, line, sizeof(line)))
+      n = parse_cpulist(line, cpus, MAX_CPUS);
+    else if (node == 0) // no NUMA in sysfs: one node of every CPU
+      for (n = 0; n < CPU_SETSIZE && n < MAX_CPUS; n++)
+        cpus[n] = n;
+    else
+      continue;
+    node_cpus *out = &nodes[nnodes];
+    out->ncpus = 0;
+    for (int i = 0; i < n; i++) {
+      const int c = cpus[i];
+      if (c >= CPU_SETSIZE || !CPU_ISSET(c, &allowed))
+        continue;
+      snprintf(path, sizeof(path),
+               "/sys/devices/system/cpu/cpu%d/topology/thread_siblings_list",
+               c);
+      int siblings[2];
+      if (read_line(path, line, sizeof(line)) &&
+          parse_cpulist(line, siblings, 2) > 0 && siblings[0] != c)
+        continue; // a second hardware thread of a core
+      out->cpus[out->ncpus++] = c;
+    }
+    if (out->ncpus > 0)
+      nnodes++;
+  }
+  return nnodes;
+}
+
+/* One count per repetition on rows placed by their threads; prints the
+   samples and the check for the driver */
+static int worker(int bits, int queries, int refs, int threads) {
+  const SETOP_COUNT_OPTS opts = {.num_cpu_threads = threads};
+  Bit_DB_T left = BitDB_new_numa(bits, queries, 64, BIT_NUMA_FIRST_TOUCH, opts);
+  Bit_DB_T right = BitDB_new_numa(bits, refs, 64, BIT_NUMA_FIRST_TOUCH, opts);
+  if (bench_data_enabled()) {
+    bench_data_fill_db(left, BENCH_DATA_QUERIES);
+    bench_data_fill_db(right, BENCH_DATA_REFERENCES);
+  } else {
+    Bit_T row = Bit_new(bits);
+    Bit_set(row, bits / 2, bits - 1);
+    for (int i = 0; i < queries; i++)
+      BitDB_put_at(left, i, row);
+    for (int i = 0; i < refs; i++)
+      BitDB_put_at(right, i, row);
+    Bit_free(&row);
+  }
+  int *counts = malloc((size_t)queries * refs * sizeof(int));
+  if (!counts) {
+    fputs("Unable to allocate the result matrix\n", stderr);
+    return EXIT_FAILURE;
+  }
+  const bench_config config = bench_config_default("openmp_bit_scaling");
+  for (int r = 0; r < config.warmup; r++)
+    BitDB_inter_count_store_cpu(left, right, counts, opts);
+  for (int r = 0; r < config.repetitions && r < MAX_SAMPLES; r++) {
+    const int64_t start = bench_now_ns();
+    BitDB_inter_count_store_cpu(left, right, counts, opts);
+    printf("sample %lld\n", (long long)(bench_now_ns() - start));
+  }
+  int64_t check = 0;
+  for (size_t i = 0; i < (size_t)queries * refs; i++)
+    check += counts[i];
+  printf("check %lld\n", (long long)check);
+  free(counts);
+  BitDB_free(&left);
+  BitDB_free(&right);
+  return EXIT_SUCCESS;
+}
+
+static int compare_double(const void *a, const void *b) {
+  const double x = *(const double *)a, y = *(const double *)b;
+  return (x > y) - (x < y);
+}
+
+/* The worker of one run, bound to the cores of its nodes */
+static bool run_worker(const char *self, const node_cpus *nodes,
+                       scaling_run *run, int bits, int refs) {
+  static char places[MAX_CPUS * 8];
+  size_t used = 0;
+  for (int n = 0; n < run->nodes; n++)
+    for (int i = 0; i < nodes[n].ncpus && used + 16 < sizeof(places); i++)
+      used += snprintf(places + used, sizeof(places) - used, "%s{%d}",
+                       used ? "," : "", nodes[n].cpus[i]);
+  char command[sizeof(places) + 512];
+  snprintf(command, sizeof(command),
+           "OMP_PLACES='%s' OMP_PROC_BIND=%s OMP_NUM_THREADS=%d '%s' "
+           "--worker %d %d %d %d",
+           places, run->nodes > 1 ? "spread" : "close", run->threads, self,
+           bits, run->queries, refs, run->threads);
+  FILE *out = popen(command, "r");
+  if (!out)
+    return false;
+  char line[128];
+  long long value;
+  run->nsamples = 0;
+  while (fgets(line, sizeof(line), out)) {
+    if (sscanf(line, "sample %lld", &value) == 1 &&
+        run->nsamples < MAX_SAMPLES)
+      run->samples[run->nsamples++] = (double)value;
+    else if (sscanf(line, "check %lld", &value) == 1)
+      run->check = value;
+  }
+  if (pclose(out) != 0 || run->nsamples == 0)
+    return false;
+  double sorted[MAX_SAMPLES];
+  memcpy(sorted, run->samples, run->nsamples * sizeof(double));
+  qsort(sorted, run->nsamples, sizeof(double), compare_double);
+  run->median = run->nsamples % 2
+                    ? sorted[run->nsamples / 2]
+                    : (sorted[run->nsamples / 2 - 1] +
+                       sorted[run->nsamples / 2]) / 2;
+  return true;
+}
+
+int main(int argc, char *argv[]) {
+  if (argc == 6 && strcmp(argv[1], "--worker") == 0)
+    return worker(parse_positive(argv[2], "bits"),
+                  parse_positive(argv[3], "queries"),
+                  parse_positive(argv[4], "refs"),
+                  parse_positive(argv[5], "threads"));
+  if (argc != 4 && argc != 5) {
+    fprintf(stderr,
+            "Usage: %s <bits> <queries> <references> [<max threads>]\n",
+            argv[0]);
+    return EXIT_FAILURE;
+  }
+  const int bits = parse_positive(argv[1], "bits");
+  const int queries = parse_positive(argv[2], "queries");
+  const int refs = parse_positive(argv[3], "references");
+  const int max_threads =
+      argc == 5 ? parse_positive(argv[4], "max threads") : INT_MAX;
+
+  static node_cpus nodes[MAX_NODES];
+  const int nnodes = read_topology(nodes);
+  char self[PATH_MAX];
+  const ssize_t len = readlink("/proc/self/exe", self, sizeof(self) - 1);
+  if (nnodes == 0 || len <= 0) {
+    fputs("Unable to read the CPU topology\n", stderr);
+    return EXIT_FAILURE;
+  }
+  self[len] = '\0';
+  print_Bit_configuration();
+  printf("Topology: %d node(s) with", nnodes);
+  for (int n = 0; n < nnodes; n++)
+    printf(" %d", nodes[n].ncpus);
+  printf(" physical cores\n");
+
+  // one node with 1, 2, 4, ... threads and all its cores, then every core
+  // of the first 2, 3, ... nodes
+  static scaling_run runs[MAX_RUNS];
+  int nruns = 0, cores = 0, top = 1;
+  for (int k = 1; k <= nnodes; k++) {
+    cores += nodes[k - 1].ncpus;
+    int counts[64], ncounts = 0;
+    if (k == 1)
+      for (int t = 1; t < cores && t < max_threads; t *= 2)
+        counts[ncounts++] = t;
+    counts[ncounts++] = cores < max_threads ? cores : max_threads;
+    for (int i = 0; i < ncounts; i++) {
+      if (counts[i] > top)
+        top = counts[i];
+      for (int weak = 0; weak <= 1 && nruns < MAX_RUNS; weak++)
+        runs[nruns++] = (scaling_run){.weak = weak, .nodes = k,
+                                      .threads = counts[i]};
+    }
+    if (cores >= max_threads)
+      break;
+  }
+  const int per_thread = queries / top > 0 ? queries / top : 1;
+  for (int r = 0; r < nruns; r++)
+    runs[r].queries = runs[r].weak ? per_thread * runs[r].threads : queries;
+
+  const int words = (bits + 63) / 64;
+  const int tile = Bit_tuning_get().tile;
+  const scaling_run *base[2] = {NULL, NULL};
+  printf("\nScaling of BitDB_inter_count_store_cpu (strong: %d queries; "
+         "weak: %d per thread), %d references of %d bits\n",
+         queries, per_thread, refs, bits);
+  printf("%-6s %5s %7s %8s %12s %8s %10s %9s %11s\n", "mode", "nodes",
+         "threads", "queries", "median ms", "speedup", "efficiency", "GB/s",
+         "GB/s/node");
+  for (int r = 0; r < nruns; r++) {
+    scaling_run *run = &runs[r];
+    fflush(stdout);
+    if (!run_worker(self, nodes, run, bits, refs)) {
+      fprintf(stderr, "Warning: the run of %d threads on %d node(s) failed\n",
+              run->threads, run->nodes);
+      continue;
+    }
+    if (!base[run->weak] && run->threads == 1)
+      base[run->weak] = run;
+    const scaling_run *b = base[run->weak];
+    // strong: T1 / Tt; weak: the work grows with t, so t * T1 / Tt
+    const double speedup =
+        b ? (run->weak ? run->threads : 1) * b->median / run->median : 0.0;
+    const double gbps =
+        bench_count_bytes(run->queries, refs, words, tile) / run->median;
+    printf("%-6s %5d %7d %8d %12.3f %8.2f %9.1f%% %9.2f %11.2f\n",
+           run->weak ? "weak" : "strong", run->nodes, run->threads,
+           run->queries, run->median / 1e6, speedup,
+           100.0 * speedup / run->threads, gbps, gbps / run->nodes);
+    snprintf(run->params, sizeof(run->params),
+             "bits=%d queries=%d refs=%d threads=%d nodes=%d bind=%s%s", bits,
+             run->queries, refs, run->threads, run->nodes,
+             run->nodes > 1 ? "spread" : "close", bench_data_params());
+    bench_record(run->weak ? "Scaling weak" : "Scaling strong", run->params,
+                 (double)run->queries * refs, "comparisons", run->samples,
+                 run->nsamples, run->check);
+  }
+  printf("\n");
+  const bench_config config = bench_config_default(argv[0]);
+  return bench_run(&config) == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
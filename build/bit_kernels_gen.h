@@ -0,0 +1,4681 @@
+/*
+    Register block count kernels of KERNEL_BLOCKS="1x1x4 2x2x2 2x4x1 4x2x1 4x4x1 3x8x1",
+    written by scripts/gen_kernels.pl; do not edit. Included once per
+    instruction set tier by src/bit_kernels.c.
+*/
+
+/* and, 1x1 register block, 4 vectors a step, aligned loads */
+static inline void gen_block_and_1x1x4_aligned(
+    const uint64_t *restrict const *a, const uint64_t *restrict const *b,
+    size_t k_b, size_t k_max, int results[1][1]) {
+#if BIT_GEN_VECTOR_BLOCKS
+  const size_t step = 4 * VECTOR_QWORDS;
+  CHUNK_LIMIT(limit, k_b, k_max, step)
+  VECTOR_TYPE s0_0 = SIMDe_ZERO_VECTOR;
+  size_t k = k_b;
+  for (; k < limit; k += step) {
+    {
+      const VECTOR_TYPE a0 = BIT_GEN_ALIGNED_LOAD((VECTOR_TYPE *)&a[0][k + VECTOR_OFFSET(0)]);
+      const VECTOR_TYPE b0 = BIT_GEN_ALIGNED_LOAD((VECTOR_TYPE *)&b[0][k + VECTOR_OFFSET(0)]);
+      s0_0 = SIMDe_VECTOR_ADD(s0_0, SIMDe_POPCOUNT(BIT_AND(a0, b0)));
+    }
+    {
+      const VECTOR_TYPE a0 = BIT_GEN_ALIGNED_LOAD((VECTOR_TYPE *)&a[0][k + VECTOR_OFFSET(1)]);
+      const VECTOR_TYPE b0 = BIT_GEN_ALIGNED_LOAD((VECTOR_TYPE *)&b[0][k + VECTOR_OFFSET(1)]);
+      s0_0 = SIMDe_VECTOR_ADD(s0_0, SIMDe_POPCOUNT(BIT_AND(a0, b0)));
+    }
+    {
+      const VECTOR_TYPE a0 = BIT_GEN_ALIGNED_LOAD((VECTOR_TYPE *)&a[0][k + VECTOR_OFFSET(2)]);
+      const VECTOR_TYPE b0 = BIT_GEN_ALIGNED_LOAD((VECTOR_TYPE *)&b[0][k + VECTOR_OFFSET(2)]);
+      s0_0 = SIMDe_VECTOR_ADD(s0_0, SIMDe_POPCOUNT(BIT_AND(a0, b0)));
+    }
+    {
+      const VECTOR_TYPE a0 = BIT_GEN_ALIGNED_LOAD((VECTOR_TYPE *)&a[0][k + VECTOR_OFFSET(3)]);
+      const VECTOR_TYPE b0 = BIT_GEN_ALIGNED_LOAD((VECTOR_TYPE *)&b[0][k + VECTOR_OFFSET(3)]);
+      s0_0 = SIMDe_VECTOR_ADD(s0_0, SIMDe_POPCOUNT(BIT_AND(a0, b0)));
+    }
+  }
+  uint64_t c0_0 = gen_lanes_sum(s0_0);
+  for (; k < k_max; k++) {
+    const uint64_t a0 = a[0][k];
+    const uint64_t b0 = b[0][k];
+    c0_0 += POPCOUNT(BIT_SCALAR_AND(a0, b0));
+  }
+  results[0][0] = (int)c0_0;
+#else
+  setop_count_db_cpu_kernel_outer(1, 1, 4, a, b, k_b, k_max, results, _AND,
+                                  OMP_CPU_SIMD_ALIGN_BUFFER(ALIGNMENT, setop_buffer),
+                                  BIT_GEN_ALIGNED_LOAD);
+#endif
+}
+
+static void gen_rows_and_1x1x4_aligned(const uint64_t *const *a, int ni,
+    const uint64_t *const *b, int nj, size_t k_b, size_t k_max,
+    int *restrict counts, size_t ld) {
+  SETOP_BLOCK_TILES(_AND, BIT_GEN_ALIGNED_LOAD, SETOP_INDIRECT_A, SETOP_INDIRECT_B, 1, 1,
+                    gen_block_and_1x1x4_aligned(a_rows, b_rows, k_b, k_max, results))
+}
+
+/* and, 1x1 register block, 4 vectors a step, unaligned loads */
+static inline void gen_block_and_1x1x4_unaligned(
+    const uint64_t *restrict const *a, const uint64_t *restrict const *b,
+    size_t k_b, size_t k_max, int results[1][1]) {
+#if BIT_GEN_VECTOR_BLOCKS
+  const size_t step = 4 * VECTOR_QWORDS;
+  CHUNK_LIMIT(limit, k_b, k_max, step)
+  VECTOR_TYPE s0_0 = SIMDe_ZERO_VECTOR;
+  size_t k = k_b;
+  for (; k < limit; k += step) {
+    {
+      const VECTOR_TYPE a0 = VECTOR_UNALIGNED_LOAD((VECTOR_TYPE *)&a[0][k + VECTOR_OFFSET(0)]);
+      const VECTOR_TYPE b0 = VECTOR_UNALIGNED_LOAD((VECTOR_TYPE *)&b[0][k + VECTOR_OFFSET(0)]);
+      s0_0 = SIMDe_VECTOR_ADD(s0_0, SIMDe_POPCOUNT(BIT_AND(a0, b0)));
+    }
+    {
+      const VECTOR_TYPE a0 = VECTOR_UNALIGNED_LOAD((VECTOR_TYPE *)&a[0][k + VECTOR_OFFSET(1)]);
+      const VECTOR_TYPE b0 = VECTOR_UNALIGNED_LOAD((VECTOR_TYPE *)&b[0][k + VECTOR_OFFSET(1)]);
+      s0_0 = SIMDe_VECTOR_ADD(s0_0, SIMDe_POPCOUNT(BIT_AND(a0, b0)));
+    }
+    {
+      const VECTOR_TYPE a0 = VECTOR_UNALIGNED_LOAD((VECTOR_TYPE *)&a[0][k + VECTOR_OFFSET(2)]);
+      const VECTOR_TYPE b0 = VECTOR_UNALIGNED_LOAD((VECTOR_TYPE *)&b[0][k + VECTOR_OFFSET(2)]);
+      s0_0 = SIMDe_VECTOR_ADD(s0_0, SIMDe_POPCOUNT(BIT_AND(a0, b0)));
+    }
+    {
+      const VECTOR_TYPE a0 = VECTOR_UNALIGNED_LOAD((VECTOR_TYPE *)&a[0][k + VECTOR_OFFSET(3)]);
+      const VECTOR_TYPE b0 = VECTOR_UNALIGNED_LOAD((VECTOR_TYPE *)&b[0][k + VECTOR_OFFSET(3)]);
+      s0_0 = SIMDe_VECTOR_ADD(s0_0, SIMDe_POPCOUNT(BIT_AND(a0, b0)));
+    }
+  }
+  uint64_t c0_0 = gen_lanes_sum(s0_0);
+  for (; k < k_max; k++) {
+    const uint64_t a0 = a[0][k];
+    const uint64_t b0 = b[0][k];
+    c0_0 += POPCOUNT(BIT_SCALAR_AND(a0, b0));
+  }
+  results[0][0] = (int)c0_0;
+#else
+  setop_count_db_cpu_kernel_outer(1, 1, 4, a, b, k_b, k_max, results, _AND,
+                                  OMP_CPU_SIMD_ALIGN_BUFFER(ALIGNMENT, setop_buffer),
+                                  VECTOR_UNALIGNED_LOAD);
+#endif
+}
+
+static void gen_rows_and_1x1x4_unaligned(const uint64_t *const *a, int ni,
+    const uint64_t *const *b, int nj, size_t k_b, size_t k_max,
+    int *restrict counts, size_t ld) {
+  SETOP_BLOCK_TILES(_AND, VECTOR_UNALIGNED_LOAD, SETOP_INDIRECT_A, SETOP_INDIRECT_B, 1, 1,
+                    gen_block_and_1x1x4_unaligned(a_rows, b_rows, k_b, k_max, results))
+}
+
+/* or, 1x1 register block, 4 vectors a step, aligned loads */
+static inline void gen_block_or_1x1x4_aligned(
+    const uint64_t *restrict const *a, const uint64_t *restrict const *b,
+    size_t k_b, size_t k_max, int results[1][1]) {
+#if BIT_GEN_VECTOR_BLOCKS
+  const size_t step = 4 * VECTOR_QWORDS;
+  CHUNK_LIMIT(limit, k_b, k_max, step)
+  VECTOR_TYPE s0_0 = SIMDe_ZERO_VECTOR;
+  size_t k = k_b;
+  for (; k < limit; k += step) {
+    {
+      const VECTOR_TYPE a0 = BIT_GEN_ALIGNED_LOAD((VECTOR_TYPE *)&a[0][k + VECTOR_OFFSET(0)]);
+      const VECTOR_TYPE b0 = BIT_GEN_ALIGNED_LOAD((VECTOR_TYPE *)&b[0][k + VECTOR_OFFSET(0)]);
+      s0_0 = SIMDe_VECTOR_ADD(s0_0, SIMDe_POPCOUNT(BIT_OR(a0, b0)));
+    }
+    {
+      const VECTOR_TYPE a0 = BIT_GEN_ALIGNED_LOAD((VECTOR_TYPE *)&a[0][k + VECTOR_OFFSET(1)]);
+      const VECTOR_TYPE b0 = BIT_GEN_ALIGNED_LOAD((VECTOR_TYPE *)&b[0][k + VECTOR_OFFSET(1)]);
+      s0_0 = SIMDe_VECTOR_ADD(s0_0, SIMDe_POPCOUNT(BIT_OR(a0, b0)));
+    }
+    {
+      const VECTOR_TYPE a0 = BIT_GEN_ALIGNED_LOAD((VECTOR_TYPE *)&a[0][k + VECTOR_OFFSET(2)]);
+      const VECTOR_TYPE b0 = BIT_GEN_ALIGNED_LOAD((VECTOR_TYPE *)&b[0][k + VECTOR_OFFSET(2)]);
+      s0_0 = SIMDe_VECTOR_ADD(s0_0, SIMDe_POPCOUNT(BIT_OR(a0, b0)));
+    }
+    {
+      const VECTOR_TYPE a0 = BIT_GEN_ALIGNED_LOAD((VECTOR_TYPE *)&a[0][k + VECTOR_OFFSET(3)]);
+      const VECTOR_TYPE b0 = BIT_GEN_ALIGNED_LOAD((VECTOR_TYPE *)&b[0][k + VECTOR_OFFSET(3)]);
+      s0_0 = SIMDe_VECTOR_ADD(s0_0, SIMDe_POPCOUNT(BIT_OR(a0, b0)));
+    }
+  }
+  uint64_t c0_0 = gen_lanes_sum(s0_0);
+  for (; k < k_max; k++) {
+    const uint64_t a0 = a[0][k];
+    const uint64_t b0 = b[0][k];
+    c0_0 += POPCOUNT(BIT_SCALAR_OR(a0, b0));
+  }
+  results[0][0] = (int)c0_0;
+#else
+  setop_count_db_cpu_kernel_outer(1, 1, 4, a, b, k_b, k_max, results, _OR,
+                                  OMP_CPU_SIMD_ALIGN_BUFFER(ALIGNMENT, setop_buffer),
+                                  BIT_GEN_ALIGNED_LOAD);
+#endif
+}
+
+static void gen_rows_or_1x1x4_aligned(const uint64_t *const *a, int ni,
+    const uint64_t *const *b, int nj, size_t k_b, size_t k_max,
+    int *restrict counts, size_t ld) {
+  SETOP_BLOCK_TILES(_OR, BIT_GEN_ALIGNED_LOAD, SETOP_INDIRECT_A, SETOP_INDIRECT_B, 1, 1,
+                    gen_block_or_1x1x4_aligned(a_rows, b_rows, k_b, k_max, results))
+}
+
+/* or, 1x1 register block, 4 vectors a step, unaligned loads */
+static inline void gen_block_or_1x1x4_unaligned(
+    const uint64_t *restrict const *a, const uint64_t *restrict const *b,
+    size_t k_b, size_t k_max, int results[1][1]) {
+#if BIT_GEN_VECTOR_BLOCKS
+  const size_t step = 4 * VECTOR_QWORDS;
+  CHUNK_LIMIT(limit, k_b, k_max, step)
+  VECTOR_TYPE s0_0 = SIMDe_ZERO_VECTOR;
+  size_t k = k_b;
+  for (; k < limit; k += step) {
+    {
+      const VECTOR_TYPE a0 = VECTOR_UNALIGNED_LOAD((VECTOR_TYPE *)&a[0][k + VECTOR_OFFSET(0)]);
+      const VECTOR_TYPE b0 = VECTOR_UNALIGNED_LOAD((VECTOR_TYPE *)&b[0][k + VECTOR_OFFSET(0)]);
+      s0_0 = SIMDe_VECTOR_ADD(s0_0, SIMDe_POPCOUNT(BIT_OR(a0, b0)));
+    }
+    {
+      const VECTOR_TYPE a0 = VECTOR_UNALIGNED_LOAD((VECTOR_TYPE *)&a[0][k + VECTOR_OFFSET(1)]);
+      const VECTOR_TYPE b0 = VECTOR_UNALIGNED_LOAD((VECTOR_TYPE *)&b[0][k + VECTOR_OFFSET(1)]);
+      s0_0 = SIMDe_VECTOR_ADD(s0_0, SIMDe_POPCOUNT(BIT_OR(a0, b0)));
+    }
+    {
+      const VECTOR_TYPE a0 = VECTOR_UNALIGNED_LOAD((VECTOR_TYPE *)&a[0][k + VECTOR_OFFSET(2)]);
+      const VECTOR_TYPE b0 = VECTOR_UNALIGNED_LOAD((VECTOR_TYPE *)&b[0][k + VECTOR_OFFSET(2)]);
+      s0_0 = SIMDe_VECTOR_ADD(s0_0, SIMDe_POPCOUNT(BIT_OR(a0, b0)));
+    }
+    {
+      const VECTOR_TYPE a0 = VECTOR_UNALIGNED_LOAD((VECTOR_TYPE *)&a[0][k + VECTOR_OFFSET(3)]);
+      const VECTOR_TYPE b0 = VECTOR_UNALIGNED_LOAD((VECTOR_TYPE *)&b[0][k + VECTOR_OFFSET(3)]);
+      s0_0 = SIMDe_VECTOR_ADD(s0_0, SIMDe_POPCOUNT(BIT_OR(a0, b0)));
+    }
+  }
+  uint64_t c0_0 = gen_lanes_sum(s0_0);
+  for (; k < k_max; k++) {
+    const uint64_t a0 = a[0][k];
+    const uint64_t b0 = b[0][k];
+    c0_0 += POPCOUNT(BIT_SCALAR_OR(a0, b0));
+  }
+  results[0][0] = (int)c0_0;
+#else
+  setop_count_db_cpu_kernel_outer(1, 1, 4, a, b, k_b, k_max, results, _OR,
+                                  OMP_CPU_SIMD_ALIGN_BUFFER(ALIGNMENT, setop_buffer),
+                                  VECTOR_UNALIGNED_LOAD);
+#endif
+}
+
+static void gen_rows_or_1x1x4_unaligned(const uint64_t *const *a, int ni,
+    const uint64_t *const *b, int nj, size_t k_b, size_t k_max,
+    int *restrict counts, size_t ld) {
+  SETOP_BLOCK_TILES(_OR, VECTOR_UNALIGNED_LOAD, SETOP_INDIRECT_A, SETOP_INDIRECT_B, 1, 1,
+                    gen_block_or_1x1x4_unaligned(a_rows, b_rows, k_b, k_max, results))
+}
+
+/* xor, 1x1 register block, 4 vectors a step, aligned loads */
+static inline void gen_block_xor_1x1x4_aligned(
+    const uint64_t *restrict const *a, const uint64_t *restrict const *b,
+    size_t k_b, size_t k_max, int results[1][1]) {
+#if BIT_GEN_VECTOR_BLOCKS
+  const size_t step = 4 * VECTOR_QWORDS;
+  CHUNK_LIMIT(limit, k_b, k_max, step)
+  VECTOR_TYPE s0_0 = SIMDe_ZERO_VECTOR;
+  size_t k = k_b;
+  for (; k < limit; k += step) {
+    {
+      const VECTOR_TYPE a0 = BIT_GEN_ALIGNED_LOAD((VECTOR_TYPE *)&a[0][k + VECTOR_OFFSET(0)]);
+      const VECTOR_TYPE b0 = BIT_GEN_ALIGNED_LOAD((VECTOR_TYPE *)&b[0][k + VECTOR_OFFSET(0)]);
+      s0_0 = SIMDe_VECTOR_ADD(s0_0, SIMDe_POPCOUNT(BIT_XOR(a0, b0)));
+    }
+    {
+      const VECTOR_TYPE a0 = BIT_GEN_ALIGNED_LOAD((VECTOR_TYPE *)&a[0][k + VECTOR_OFFSET(1)]);
+      const VECTOR_TYPE b0 = BIT_GEN_ALIGNED_LOAD((VECTOR_TYPE *)&b[0][k + VECTOR_OFFSET(1)]);
+      s0_0 = SIMDe_VECTOR_ADD(s0_0, SIMDe_POPCOUNT(BIT_XOR(a0, b0)));
+    }
+    {
+      const VECTOR_TYPE a0 = BIT_GEN_ALIGNED_LOAD((VECTOR_TYPE *)&a[0][k + VECTOR_OFFSET(2)]);
+      const VECTOR_TYPE b0 = BIT_GEN_ALIGNED_LOAD((VECTOR_TYPE *)&b[0][k + VECTOR_OFFSET(2)]);
+      s0_0 = SIMDe_VECTOR_ADD(s0_0, SIMDe_POPCOUNT(BIT_XOR(a0, b0)));
+    }
+    {
+      const VECTOR_TYPE a0 = BIT_GEN_ALIGNED_LOAD((VECTOR_TYPE *)&a[0][k + VECTOR_OFFSET(3)]);
+      const VECTOR_TYPE b0 = BIT_GEN_ALIGNED_LOAD((VECTOR_TYPE *)&b[0][k + VECTOR_OFFSET(3)]);
+      s0_0 = SIMDe_VECTOR_ADD(s0_0, SIMDe_POPCOUNT(BIT_XOR(a0, b0)));
+    }
+  }
+  uint64_t c0_0 = gen_lanes_sum(s0_0);
+  for (; k < k_max; k++) {
+    const uint64_t a0 = a[0][k];
+    const uint64_t b0 = b[0][k];
+    c0_0 += POPCOUNT(BIT_SCALAR_XOR(a0, b0));
+  }
+  results[0][0] = (int)c0_0;
+#else
+  setop_count_db_cpu_kernel_outer(1, 1, 4, a, b, k_b, k_max, results, _XOR,
+                                  OMP_CPU_SIMD_ALIGN_BUFFER(ALIGNMENT, setop_buffer),
+                                  BIT_GEN_ALIGNED_LOAD);
+#endif
+}
+
+static void gen_rows_xor_1x1x4_aligned(const uint64_t *const *a, int ni,
+    const uint64_t *const *b, int nj, size_t k_b, size_t k_max,
+    int *restrict counts, size_t ld) {
+  SETOP_BLOCK_TILES(_XOR, BIT_GEN_ALIGNED_LOAD, SETOP_INDIRECT_A, SETOP_INDIRECT_B, 1, 1,
+                    gen_block_xor_1x1x4_aligned(a_rows, b_rows, k_b, k_max, results))
+}
+
+/* xor, 1x1 register block, 4 vectors a step, unaligned loads */
+static inline void gen_block_xor_1x1x4_unaligned(
+    const uint64_t *restrict const *a, const uint64_t *restrict const *b,
+    size_t k_b, size_t k_max, int results[1][1]) {
+#if BIT_GEN_VECTOR_BLOCKS
+  const size_t step = 4 * VECTOR_QWORDS;
+  CHUNK_LIMIT(limit, k_b, k_max, step)
+  VECTOR_TYPE s0_0 = SIMDe_ZERO_VECTOR;
+  size_t k = k_b;
+  for (; k < limit; k += step) {
+    {
+      const VECTOR_TYPE a0 = VECTOR_UNALIGNED_LOAD((VECTOR_TYPE *)&a[0][k + VECTOR_OFFSET(0)]);
+      const VECTOR_TYPE b0 = VECTOR_UNALIGNED_LOAD((VECTOR_TYPE *)&b[0][k + VECTOR_OFFSET(0)]);
+      s0_0 = SIMDe_VECTOR_ADD(s0_0, SIMDe_POPCOUNT(BIT_XOR(a0, b0)));
+    }
+    {
+      const VECTOR_TYPE a0 = VECTOR_UNALIGNED_LOAD((VECTOR_TYPE *)&a[0][k + VECTOR_OFFSET(1)]);
+      const VECTOR_TYPE b0 = VECTOR_UNALIGNED_LOAD((VECTOR_TYPE *)&b[0][k + VECTOR_OFFSET(1)]);
+      s0_0 = SIMDe_VECTOR_ADD(s0_0, SIMDe_POPCOUNT(BIT_XOR(a0, b0)));
+    }
+    {
+      const VECTOR_TYPE a0 = VECTOR_UNALIGNED_LOAD((VECTOR_TYPE *)&a[0][k + VECTOR_OFFSET(2)]);
+      const VECTOR_TYPE b0 = VECTOR_UNALIGNED_LOAD((VECTOR_TYPE *)&b[0][k + VECTOR_OFFSET(2)]);
+      s0_0 = SIMDe_VECTOR_ADD(s0_0, SIMDe_POPCOUNT(BIT_XOR(a0, b0)));
+    }
+    {
+      const VECTOR_TYPE a0 = VECTOR_UNALIGNED_LOAD((VECTOR_TYPE *)&a[0][k + VECTOR_OFFSET(3)]);
+      const VECTOR_TYPE b0 = VECTOR_UNALIGNED_LOAD((VECTOR_TYPE *)&b[0][k + VECTOR_OFFSET(3)]);
+      s0_0 = SIMDe_VECTOR_ADD(s0_0, SIMDe_POPCOUNT(BIT_XOR(a0, b0)));
+    }
+  }
+  uint64_t c0_0 = gen_lanes_sum(s0_0);
+  for (; k < k_max; k++) {
+    const uint64_t a0 = a[0][k];
+    const uint64_t b0 = b[0][k];
+    c0_0 += POPCOUNT(BIT_SCALAR_XOR(a0, b0));
+  }
+  results[0][0] = (int)c0_0;
+#else
+  setop_count_db_cpu_kernel_outer(1, 1, 4, a, b, k_b, k_max, results, _XOR,
+                                  OMP_CPU_SIMD_ALIGN_BUFFER(ALIGNMENT, setop_buffer),
+                                  VECTOR_UNALIGNED_LOAD);
+#endif
+}
+
+static void gen_rows_xor_1x1x4_unaligned(const uint64_t *const *a, int ni,
+    const uint64_t *const *b, int nj, size_t k_b, size_t k_max,
+    int *restrict counts, size_t ld) {
+  SETOP_BLOCK_TILES(_XOR, VECTOR_UNALIGNED_LOAD, SETOP_INDIRECT_A, SETOP_INDIRECT_B, 1, 1,
+                    gen_block_xor_1x1x4_unaligned(a_rows, b_rows, k_b, k_max, results))
+}
+
+/* and_not, 1x1 register block, 4 vectors a step, aligned loads */
+static inline void gen_block_and_not_1x1x4_aligned(
+    const uint64_t *restrict const *a, const uint64_t *restrict const *b,
+    size_t k_b, size_t k_max, int results[1][1]) {
+#if BIT_GEN_VECTOR_BLOCKS
+  const size_t step = 4 * VECTOR_QWORDS;
+  CHUNK_LIMIT(limit, k_b, k_max, step)
+  VECTOR_TYPE s0_0 = SIMDe_ZERO_VECTOR;
+  size_t k = k_b;
+  for (; k < limit; k += step) {
+    {
+      const VECTOR_TYPE a0 = BIT_GEN_ALIGNED_LOAD((VECTOR_TYPE *)&a[0][k + VECTOR_OFFSET(0)]);
+      const VECTOR_TYPE b0 = BIT_GEN_ALIGNED_LOAD((VECTOR_TYPE *)&b[0][k + VECTOR_OFFSET(0)]);
+      s0_0 = SIMDe_VECTOR_ADD(s0_0, SIMDe_POPCOUNT(BIT_AND_NOT(a0, b0)));
+    }
+    {
+      const VECTOR_TYPE a0 = BIT_GEN_ALIGNED_LOAD((VECTOR_TYPE *)&a[0][k + VECTOR_OFFSET(1)]);
+      const VECTOR_TYPE b0 = BIT_GEN_ALIGNED_LOAD((VECTOR_TYPE *)&b[0][k + VECTOR_OFFSET(1)]);
+      s0_0 = SIMDe_VECTOR_ADD(s0_0, SIMDe_POPCOUNT(BIT_AND_NOT(a0, b0)));
+    }
+    {
+      const VECTOR_TYPE a0 = BIT_GEN_ALIGNED_LOAD((VECTOR_TYPE *)&a[0][k + VECTOR_OFFSET(2)]);
+      const VECTOR_TYPE b0 = BIT_GEN_ALIGNED_LOAD((VECTOR_TYPE *)&b[0][k + VECTOR_OFFSET(2)]);
+      s0_0 = SIMDe_VECTOR_ADD(s0_0, SIMDe_POPCOUNT(BIT_AND_NOT(a0, b0)));
+    }
+    {
+      const VECTOR_TYPE a0 = BIT_GEN_ALIGNED_LOAD((VECTOR_TYPE *)&a[0][k + VECTOR_OFFSET(3)]);
+      const VECTOR_TYPE b0 = BIT_GEN_ALIGNED_LOAD((VECTOR_TYPE *)&b[0][k + VECTOR_OFFSET(3)]);
+      s0_0 = SIMDe_VECTOR_ADD(s0_0, SIMDe_POPCOUNT(BIT_AND_NOT(a0, b0)));
+    }
+  }
+  uint64_t c0_0 = gen_lanes_sum(s0_0);
+  for (; k < k_max; k++) {
+    const uint64_t a0 = a[0][k];
+    const uint64_t b0 = b[0][k];
+    c0_0 += POPCOUNT(BIT_SCALAR_AND_NOT(a0, b0));
+  }
+  results[0][0] = (int)c0_0;
+#else
+  setop_count_db_cpu_kernel_outer(1, 1, 4, a, b, k_b, k_max, results, _AND_NOT,
+                                  OMP_CPU_SIMD_ALIGN_BUFFER(ALIGNMENT, setop_buffer),
+                                  BIT_GEN_ALIGNED_LOAD);
+#endif
+}
+
+static void gen_rows_and_not_1x1x4_aligned(const uint64_t *const *a, int ni,
+    const uint64_t *const *b, int nj, size_t k_b, size_t k_max,
+    int *restrict counts, size_t ld) {
+  SETOP_BLOCK_TILES(_AND_NOT, BIT_GEN_ALIGNED_LOAD, SETOP_INDIRECT_A, SETOP_INDIRECT_B, 1, 1,
+                    gen_block_and_not_1x1x4_aligned(a_rows, b_rows, k_b, k_max, results))
+}
+
+/* and_not, 1x1 register block, 4 vectors a step, unaligned loads */
+static inline void gen_block_and_not_1x1x4_unaligned(
+    const uint64_t *restrict const *a, const uint64_t *restrict const *b,
+    size_t k_b, size_t k_max, int results[1][1]) {
+#if BIT_GEN_VECTOR_BLOCKS
+  const size_t step = 4 * VECTOR_QWORDS;
+  CHUNK_LIMIT(limit, k_b, k_max, step)
+  VECTOR_TYPE s0_0 = SIMDe_ZERO_VECTOR;
+  size_t k = k_b;
+  for (; k < limit; k += step) {
+    {
+      const VECTOR_TYPE a0 = VECTOR_UNALIGNED_LOAD((VECTOR_TYPE *)&a[0][k + VECTOR_OFFSET(0)]);
+      const VECTOR_TYPE b0 = VECTOR_UNALIGNED_LOAD((VECTOR_TYPE *)&b[0][k + VECTOR_OFFSET(0)]);
+      s0_0 = SIMDe_VECTOR_ADD(s0_0, SIMDe_POPCOUNT(BIT_AND_NOT(a0, b0)));
+    }
+    {
+      const VECTOR_TYPE a0 = VECTOR_UNALIGNED_LOAD((VECTOR_TYPE *)&a[0][k + VECTOR_OFFSET(1)]);
+      const VECTOR_TYPE b0 = VECTOR_UNALIGNED_LOAD((VECTOR_TYPE *)&b[0][k + VECTOR_OFFSET(1)]);
+      s0_0 = SIMDe_VECTOR_ADD(s0_0, SIMDe_POPCOUNT(BIT_AND_NOT(a0, b0)));
+    }
+    {
+      const VECTOR_TYPE a0 = VECTOR_UNALIGNED_LOAD((VECTOR_TYPE *)&a[0][k + VECTOR_OFFSET(2)]);
+      const VECTOR_TYPE b0 = VECTOR_UNALIGNED_LOAD((VECTOR_TYPE *)&b[0][k + VECTOR_OFFSET(2)]);
+      s0_0 = SIMDe_VECTOR_ADD(s0_0, SIMDe_POPCOUNT(BIT_AND_NOT(a0, b0)));
+    }
+    {
+      const VECTOR_TYPE a0 = VECTOR_UNALIGNED_LOAD((VECTOR_TYPE *)&a[0][k + VECTOR_OFFSET(3)]);
+      const VECTOR_TYPE b0 = VECTOR_UNALIGNED_LOAD((VECTOR_TYPE *)&b[0][k + VECTOR_OFFSET(3)]);
+      s0_0 = SIMDe_VECTOR_ADD(s0_0, SIMDe_POPCOUNT(BIT_AND_NOT(a0, b0)));
+    }
+  }
+  uint64_t c0_0 = gen_lanes_sum(s0_0);
+  for (; k < k_max; k++) {
+    const uint64_t a0 = a[0][k];
+    const uint64_t b0 = b[0][k];
+    c0_0 += POPCOUNT(BIT_SCALAR_AND_NOT(a0, b0));
+  }
+  results[0][0] = (int)c0_0;
+#else
+  setop_count_db_cpu_kernel_outer(1, 1, 4, a, b, k_b, k_max, results, _AND_NOT,
+                                  OMP_CPU_SIMD_ALIGN_BUFFER(ALIGNMENT, setop_buffer),
+                                  VECTOR_UNALIGNED_LOAD);
+#endif
+}
+
+static void gen_rows_and_not_1x1x4_unaligned(const uint64_t *const *a, int ni,
+    const uint64_t *const *b, int nj, size_t k_b, size_t k_max,
+    int *restrict counts, size_t ld) {
+  SETOP_BLOCK_TILES(_AND_NOT, VECTOR_UNALIGNED_LOAD, SETOP_INDIRECT_A, SETOP_INDIRECT_B, 1, 1,
+                    gen_block_and_not_1x1x4_unaligned(a_rows, b_rows, k_b, k_max, results))
+}
+
+/* and, 2x2 register block, 2 vectors a step, aligned loads */
+static inline void gen_block_and_2x2x2_aligned(
+    const uint64_t *restrict const *a, const uint64_t *restrict const *b,
+    size_t k_b, size_t k_max, int results[2][2]) {
+#if BIT_GEN_VECTOR_BLOCKS
+  const size_t step = 2 * VECTOR_QWORDS;
+  CHUNK_LIMIT(limit, k_b, k_max, step)
+  VECTOR_TYPE s0_0 = SIMDe_ZERO_VECTOR;
+  VECTOR_TYPE s0_1 = SIMDe_ZERO_VECTOR;
+  VECTOR_TYPE s1_0 = SIMDe_ZERO_VECTOR;
+  VECTOR_TYPE s1_1 = SIMDe_ZERO_VECTOR;
+  size_t k = k_b;
+  for (; k < limit; k += step) {
+    {
+      const VECTOR_TYPE a0 = BIT_GEN_ALIGNED_LOAD((VECTOR_TYPE *)&a[0][k + VECTOR_OFFSET(0)]);
+      const VECTOR_TYPE a1 = BIT_GEN_ALIGNED_LOAD((VECTOR_TYPE *)&a[1][k + VECTOR_OFFSET(0)]);
+      const VECTOR_TYPE b0 = BIT_GEN_ALIGNED_LOAD((VECTOR_TYPE *)&b[0][k + VECTOR_OFFSET(0)]);
+      const VECTOR_TYPE b1 = BIT_GEN_ALIGNED_LOAD((VECTOR_TYPE *)&b[1][k + VECTOR_OFFSET(0)]);
+      s0_0 = SIMDe_VECTOR_ADD(s0_0, SIMDe_POPCOUNT(BIT_AND(a0, b0)));
+      s0_1 = SIMDe_VECTOR_ADD(s0_1, SIMDe_POPCOUNT(BIT_AND(a0, b1)));
+      s1_0 = SIMDe_VECTOR_ADD(s1_0, SIMDe_POPCOUNT(BIT_AND(a1, b0)));
+      s1_1 = SIMDe_VECTOR_ADD(s1_1, SIMDe_POPCOUNT(BIT_AND(a1, b1)));
+    }
+    {
+      const VECTOR_TYPE a0 = BIT_GEN_ALIGNED_LOAD((VECTOR_TYPE *)&a[0][k + VECTOR_OFFSET(1)]);
+      const VECTOR_TYPE a1 = BIT_GEN_ALIGNED_LOAD((VECTOR_TYPE *)&a[1][k + VECTOR_OFFSET(1)]);
+      const VECTOR_TYPE b0 = BIT_GEN_ALIGNED_LOAD((VECTOR_TYPE *)&b[0][k + VECTOR_OFFSET(1)]);
+      const VECTOR_TYPE b1 = BIT_GEN_ALIGNED_LOAD((VECTOR_TYPE *)&b[1][k + VECTOR_OFFSET(1)]);
+      s0_0 = SIMDe_VECTOR_ADD(s0_0, SIMDe_POPCOUNT(BIT_AND(a0, b0)));
+      s0_1 = SIMDe_VECTOR_ADD(s0_1, SIMDe_POPCOUNT(BIT_AND(a0, b1)));
+      s1_0 = SIMDe_VECTOR_ADD(s1_0, SIMDe_POPCOUNT(BIT_AND(a1, b0)));
+      s1_1 = SIMDe_VECTOR_ADD(s1_1, SIMDe_POPCOUNT(BIT_AND(a1, b1)));
+    }
+  }
+  uint64_t c0_0 = gen_lanes_sum(s0_0);
+  uint64_t c0_1 = gen_lanes_sum(s0_1);
+  uint64_t c1_0 = gen_lanes_sum(s1_0);
+  uint64_t c1_1 = gen_lanes_sum(s1_1);
+  for (; k < k_max; k++) {
+    const uint64_t a0 = a[0][k];
+    const uint64_t a1 = a[1][k];
+    const uint64_t b0 = b[0][k];
+    const uint64_t b1 = b[1][k];
+    c0_0 += POPCOUNT(BIT_SCALAR_AND(a0, b0));
+    c0_1 += POPCOUNT(BIT_SCALAR_AND(a0, b1));
+    c1_0 += POPCOUNT(BIT_SCALAR_AND(a1, b0));
+    c1_1 += POPCOUNT(BIT_SCALAR_AND(a1, b1));
+  }
+  results[0][0] = (int)c0_0;
+  results[0][1] = (int)c0_1;
+  results[1][0] = (int)c1_0;
+  results[1][1] = (int)c1_1;
+#else
+  setop_count_db_cpu_kernel_outer(2, 2, 2, a, b, k_b, k_max, results, _AND,
+                                  OMP_CPU_SIMD_ALIGN_BUFFER(ALIGNMENT, setop_buffer),
+                                  BIT_GEN_ALIGNED_LOAD);
+#endif
+}
+
+static void gen_rows_and_2x2x2_aligned(const uint64_t *const *a, int ni,
+    const uint64_t *const *b, int nj, size_t k_b, size_t k_max,
+    int *restrict counts, size_t ld) {
+  SETOP_BLOCK_TILES(_AND, BIT_GEN_ALIGNED_LOAD, SETOP_INDIRECT_A, SETOP_INDIRECT_B, 2, 2,
+                    gen_block_and_2x2x2_aligned(a_rows, b_rows, k_b, k_max, results))
+}
+
+/* and, 2x2 register block, 2 vectors a step, unaligned loads */
+static inline void gen_block_and_2x2x2_unaligned(
+    const uint64_t *restrict const *a, const uint64_t *restrict const *b,
+    size_t k_b, size_t k_max, int results[2][2]) {
+#if BIT_GEN_VECTOR_BLOCKS
+  const size_t step = 2 * VECTOR_QWORDS;
+  CHUNK_LIMIT(limit, k_b, k_max, step)
+  VECTOR_TYPE s0_0 = SIMDe_ZERO_VECTOR;
+  VECTOR_TYPE s0_1 = SIMDe_ZERO_VECTOR;
+  VECTOR_TYPE s1_0 = SIMDe_ZERO_VECTOR;
+  VECTOR_TYPE s1_1 = SIMDe_ZERO_VECTOR;
+  size_t k = k_b;
+  for (; k < limit; k += step) {
+    {
+      const VECTOR_TYPE a0 = VECTOR_UNALIGNED_LOAD((VECTOR_TYPE *)&a[0][k + VECTOR_OFFSET(0)]);
+      const VECTOR_TYPE a1 = VECTOR_UNALIGNED_LOAD((VECTOR_TYPE *)&a[1][k + VECTOR_OFFSET(0)]);
+      const VECTOR_TYPE b0 = VECTOR_UNALIGNED_LOAD((VECTOR_TYPE *)&b[0][k + VECTOR_OFFSET(0)]);
+      const VECTOR_TYPE b1 = VECTOR_UNALIGNED_LOAD((VECTOR_TYPE *)&b[1][k + VECTOR_OFFSET(0)]);
+      s0_0 = SIMDe_VECTOR_ADD(s0_0, SIMDe_POPCOUNT(BIT_AND(a0, b0)));
+      s0_1 = SIMDe_VECTOR_ADD(s0_1, SIMDe_POPCOUNT(BIT_AND(a0, b1)));
+      s1_0 = SIMDe_VECTOR_ADD(s1_0, SIMDe_POPCOUNT(BIT_AND(a1, b0)));
+      s1_1 = SIMDe_VECTOR_ADD(s1_1, SIMDe_POPCOUNT(BIT_AND(a1, b1)));
+    }
+    {
+      const VECTOR_TYPE a0 = VECTOR_UNALIGNED_LOAD((VECTOR_TYPE *)&a[0][k + VECTOR_OFFSET(1)]);
+      const VECTOR_TYPE a1 = VECTOR_UNALIGNED_LOAD((VECTOR_TYPE *)&a[1][k + VECTOR_OFFSET(1)]);
+      const VECTOR_TYPE b0 = VECTOR_UNALIGNED_LOAD((VECTOR_TYPE *)&b[0][k + VECTOR_OFFSET(1)]);
+      const VECTOR_TYPE b1 = VECTOR_UNALIGNED_LOAD((VECTOR_TYPE *)&b[1][k + VECTOR_OFFSET(1)]);
+      s0_0 = SIMDe_VECTOR_ADD(s0_0, SIMDe_POPCOUNT(BIT_AND(a0, b0)));
+      s0_1 = SIMDe_VECTOR_ADD(s0_1, SIMDe_POPCOUNT(BIT_AND(a0, b1)));
+      s1_0 = SIMDe_VECTOR_ADD(s1_0, SIMDe_POPCOUNT(BIT_AND(a1, b0)));
+      s1_1 = SIMDe_VECTOR_ADD(s1_1, SIMDe_POPCOUNT(BIT_AND(a1, b1)));
+    }
+  }
+  uint64_t c0_0 = gen_lanes_sum(s0_0);
+  uint64_t c0_1 = gen_lanes_sum(s0_1);
+  uint64_t c1_0 = gen_lanes_sum(s1_0);
+  uint64_t c1_1 = gen_lanes_sum(s1_1);
+  for (; k < k_max; k++) {
+    const uint64_t a0 = a[0][k];
+    const uint64_t a1 = a[1][k];
+    const uint64_t b0 = b[0][k];
+    const uint64_t b1 = b[1][k];
+    c0_0 += POPCOUNT(BIT_SCALAR_AND(a0, b0));
+    c0_1 += POPCOUNT(BIT_SCALAR_AND(a0, b1));
+    c1_0 += POPCOUNT(BIT_SCALAR_AND(a1, b0));
+    c1_1 += POPCOUNT(BIT_SCALAR_AND(a1, b1));
+  }
+  results[0][0] = (int)c0_0;
+  results[0][1] = (int)c0_1;
+  results[1][0] = (int)c1_0;
+  results[1][1] = (int)c1_1;
+#else
+  setop_count_db_cpu_kernel_outer(2, 2, 2, a, b, k_b, k_max, results, _AND,
+                                  OMP_CPU_SIMD_ALIGN_BUFFER(ALIGNMENT, setop_buffer),
+                                  VECTOR_UNALIGNED_LOAD);
+#endif
+}
+
+static void gen_rows_and_2x2x2_unaligned(const uint64_t *const *a, int ni,
+    const uint64_t *const *b, int nj, size_t k_b, size_t k_max,
+    int *restrict counts, size_t ld) {
+  SETOP_BLOCK_TILES(_AND, VECTOR_UNALIGNED_LOAD, SETOP_INDIRECT_A, SETOP_INDIRECT_B, 2, 2,
+                    gen_block_and_2x2x2_unaligned(a_rows, b_rows, k_b, k_max, results))
+}
+
+/* or, 2x2 register block, 2 vectors a step, aligned loads */
+static inline void gen_block_or_2x2x2_aligned(
+    const uint64_t *restrict const *a, const uint64_t *restrict const *b,
+    size_t k_b, size_t k_max, int results[2][2]) {
+#if BIT_GEN_VECTOR_BLOCKS
+  const size_t step = 2 * VECTOR_QWORDS;
+  CHUNK_LIMIT(limit, k_b, k_max, step)
+  VECTOR_TYPE s0_0 = SIMDe_ZERO_VECTOR;
+  VECTOR_TYPE s0_1 = SIMDe_ZERO_VECTOR;
+  VECTOR_TYPE s1_0 = SIMDe_ZERO_VECTOR;
+  VECTOR_TYPE s1_1 = SIMDe_ZERO_VECTOR;
+  size_t k = k_b;
+  for (; k < limit; k += step) {
+    {
+      const VECTOR_TYPE a0 = BIT_GEN_ALIGNED_LOAD((VECTOR_TYPE *)&a[0][k + VECTOR_OFFSET(0)]);
+      const VECTOR_TYPE a1 = BIT_GEN_ALIGNED_LOAD((VECTOR_TYPE *)&a[1][k + VECTOR_OFFSET(0)]);
+      const VECTOR_TYPE b0 = BIT_GEN_ALIGNED_LOAD((VECTOR_TYPE *)&b[0][k + VECTOR_OFFSET(0)]);
+      const VECTOR_TYPE b1 = BIT_GEN_ALIGNED_LOAD((VECTOR_TYPE *)&b[1][k + VECTOR_OFFSET(0)]);
+      s0_0 = SIMDe_VECTOR_ADD(s0_0, SIMDe_POPCOUNT(BIT_OR(a0, b0)));
+      s0_1 = SIMDe_VECTOR_ADD(s0_1, SIMDe_POPCOUNT(BIT_OR(a0, b1)));
+      s1_0 = SIMDe_VECTOR_ADD(s1_0, SIMDe_POPCOUNT(BIT_OR(a1, b0)));
+      s1_1 = SIMDe_VECTOR_ADD(s1_1, SIMDe_POPCOUNT(BIT_OR(a1, b1)));
+    }
+    {
+      const VECTOR_TYPE a0 = BIT_GEN_ALIGNED_LOAD((VECTOR_TYPE *)&a[0][k + VECTOR_OFFSET(1)]);
+      const VECTOR_TYPE a1 = BIT_GEN_ALIGNED_LOAD((VECTOR_TYPE *)&a[1][k + VECTOR_OFFSET(1)]);
+      const VECTOR_TYPE b0 = BIT_GEN_ALIGNED_LOAD((VECTOR_TYPE *)&b[0][k + VECTOR_OFFSET(1)]);
+      const VECTOR_TYPE b1 = BIT_GEN_ALIGNED_LOAD((VECTOR_TYPE *)&b[1][k + VECTOR_OFFSET(1)]);
+      s0_0 = SIMDe_VECTOR_ADD(s0_0, SIMDe_POPCOUNT(BIT_OR(a0, b0)));
+      s0_1 = SIMDe_VECTOR_ADD(s0_1, SIMDe_POPCOUNT(BIT_OR(a0, b1)));
+      s1_0 = SIMDe_VECTOR_ADD(s1_0, SIMDe_POPCOUNT(BIT_OR(a1, b0)));
+      s1_1 = SIMDe_VECTOR_ADD(s1_1, SIMDe_POPCOUNT(BIT_OR(a1, b1)));
+    }
+  }
+  uint64_t c0_0 = gen_lanes_sum(s0_0);
+  uint64_t c0_1 = gen_lanes_sum(s0_1);
+  uint64_t c1_0 = gen_lanes_sum(s1_0);
+  uint64_t c1_1 = gen_lanes_sum(s1_1);
+  for (; k < k_max; k++) {
+    const uint64_t a0 = a[0][k];
+    const uint64_t a1 = a[1][k];
+    const uint64_t b0 = b[0][k];
+    const uint64_t b1 = b[1][k];
+    c0_0 += POPCOUNT(BIT_SCALAR_OR(a0, b0));
+    c0_1 += POPCOUNT(BIT_SCALAR_OR(a0, b1));
+    c1_0 += POPCOUNT(BIT_SCALAR_OR(a1, b0));
+    c1_1 += POPCOUNT(BIT_SCALAR_OR(a1, b1));
+  }
+  results[0][0] = (int)c0_0;
+  results[0][1] = (int)c0_1;
+  results[1][0] = (int)c1_0;
+  results[1][1] = (int)c1_1;
+#else
+  setop_count_db_cpu_kernel_outer(2, 2, 2, a, b, k_b, k_max, results, _OR,
+                                  OMP_CPU_SIMD_ALIGN_BUFFER(ALIGNMENT, setop_buffer),
+                                  BIT_GEN_ALIGNED_LOAD);
+#endif
+}
+
+static void gen_rows_or_2x2x2_aligned(const uint64_t *const *a, int ni,
+    const uint64_t *const *b, int nj, size_t k_b, size_t k_max,
+    int *restrict counts, size_t ld) {
+  SETOP_BLOCK_TILES(_OR, BIT_GEN_ALIGNED_LOAD, SETOP_INDIRECT_A, SETOP_INDIRECT_B, 2, 2,
+                    gen_block_or_2x2x2_aligned(a_rows, b_rows, k_b, k_max, results))
+}
+
+/* or, 2x2 register block, 2 vectors a step, unaligned loads */
+static inline void gen_block_or_2x2x2_unaligned(
+    const uint64_t *restrict const *a, const uint64_t *restrict const *b,
+    size_t k_b, size_t k_max, int results[2][2]) {
+#if BIT_GEN_VECTOR_BLOCKS
+  const size_t step = 2 * VECTOR_QWORDS;
+  CHUNK_LIMIT(limit, k_b, k_max, step)
+  VECTOR_TYPE s0_0 = SIMDe_ZERO_VECTOR;
+  VECTOR_TYPE s0_1 = SIMDe_ZERO_VECTOR;
+  VECTOR_TYPE s1_0 = SIMDe_ZERO_VECTOR;
+  VECTOR_TYPE s1_1 = SIMDe_ZERO_VECTOR;
+  size_t k = k_b;
+  for (; k < limit; k += step) {
+    {
+      const VECTOR_TYPE a0 = VECTOR_UNALIGNED_LOAD((VECTOR_TYPE *)&a[0][k + VECTOR_OFFSET(0)]);
+      const VECTOR_TYPE a1 = VECTOR_UNALIGNED_LOAD((VECTOR_TYPE *)&a[1][k + VECTOR_OFFSET(0)]);
+      const VECTOR_TYPE b0 = VECTOR_UNALIGNED_LOAD((VECTOR_TYPE *)&b[0][k + VECTOR_OFFSET(0)]);
+      const VECTOR_TYPE b1 = VECTOR_UNALIGNED_LOAD((VECTOR_TYPE *)&b[1][k + VECTOR_OFFSET(0)]);
+      s0_0 = SIMDe_VECTOR_ADD(s0_0, SIMDe_POPCOUNT(BIT_OR(a0, b0)));
+      s0_1 = SIMDe_VECTOR_ADD(s0_1, SIMDe_POPCOUNT(BIT_OR(a0, b1)));
+      s1_0 = SIMDe_VECTOR_ADD(s1_0, SIMDe_POPCOUNT(BIT_OR(a1, b0)));
+      s1_1 = SIMDe_VECTOR_ADD(s1_1, SIMDe_POPCOUNT(BIT_OR(a1, b1)));
+    }
+    {
+      const VECTOR_TYPE a0 = VECTOR_UNALIGNED_LOAD((VECTOR_TYPE *)&a[0][k + VECTOR_OFFSET(1)]);
+      const VECTOR_TYPE a1 = VECTOR_UNALIGNED_LOAD((VECTOR_TYPE *)&a[1][k + VECTOR_OFFSET(1)]);
+      const VECTOR_TYPE b0 = VECTOR_UNALIGNED_LOAD((VECTOR_TYPE *)&b[0][k + VECTOR_OFFSET(1)]);
+      const VECTOR_TYPE b1 = VECTOR_UNALIGNED_LOAD((VECTOR_TYPE *)&b[1][k + VECTOR_OFFSET(1)]);
+      s0_0 = SIMDe_VECTOR_ADD(s0_0, SIMDe_POPCOUNT(BIT_OR(a0, b0)));
+      s0_1 = SIMDe_VECTOR_ADD(s0_1, SIMDe_POPCOUNT(BIT_OR(a0, b1)));
+      s1_0 = SIMDe_VECTOR_ADD(s1_0, SIMDe_POPCOUNT(BIT_OR(a1, b0)));
+      s1_1 = SIMDe_VECTOR_ADD(s1_1, SIMDe_POPCOUNT(BIT_OR(a1, b1)));
+    }
+  }
+  uint64_t c0_0 = gen_lanes_sum(s0_0);
+  uint64_t c0_1 = gen_lanes_sum(s0_1);
+  uint64_t c1_0 = gen_lanes_sum(s1_0);
+  uint64_t c1_1 = gen_lanes_sum(s1_1);
+  for (; k < k_max; k++) {
+    const uint64_t a0 = a[0][k];
+    const uint64_t a1 = a[1][k];
+    const uint64_t b0 = b[0][k];
+    const uint64_t b1 = b[1][k];
+    c0_0 += POPCOUNT(BIT_SCALAR_OR(a0, b0));
+    c0_1 += POPCOUNT(BIT_SCALAR_OR(a0, b1));
+    c1_0 += POPCOUNT(BIT_SCALAR_OR(a1, b0));
+    c1_1 += POPCOUNT(BIT_SCALAR_OR(a1, b1));
+  }
+  results[0][0] = (int)c0_0;
+  results[0][1] = (int)c0_1;
+  results[1][0] = (int)c1_0;
+  results[1][1] = (int)c1_1;
+#else
+  setop_count_db_cpu_kernel_outer(2, 2, 2, a, b, k_b, k_max, results, _OR,
+                                  OMP_CPU_SIMD_ALIGN_BUFFER(ALIGNMENT, setop_buffer),
+                                  VECTOR_UNALIGNED_LOAD);
+#endif
+}
+
+static void gen_rows_or_2x2x2_unaligned(const uint64_t *const *a, int ni,
+    const uint64_t *const *b, int nj, size_t k_b, size_t k_max,
+    int *restrict counts, size_t ld) {
+  SETOP_BLOCK_TILES(_OR, VECTOR_UNALIGNED_LOAD, SETOP_INDIRECT_A, SETOP_INDIRECT_B, 2, 2,
+                    gen_block_or_2x2x2_unaligned(a_rows, b_rows, k_b, k_max, results))
+}
+
+/* xor, 2x2 register block, 2 vectors a step, aligned loads */
+static inline void gen_block_xor_2x2x2_aligned(
+    const uint64_t *restrict const *a, const uint64_t *restrict const *b,
+    size_t k_b, size_t k_max, int results[2][2]) {
+#if BIT_GEN_VECTOR_BLOCKS
+  const size_t step = 2 * VECTOR_QWORDS;
+  CHUNK_LIMIT(limit, k_b, k_max, step)
+  VECTOR_TYPE s0_0 = SIMDe_ZERO_VECTOR;
+  VECTOR_TYPE s0_1 = SIMDe_ZERO_VECTOR;
+  VECTOR_TYPE s1_0 = SIMDe_ZERO_VECTOR;
+  VECTOR_TYPE s1_1 = SIMDe_ZERO_VECTOR;
+  size_t k = k_b;
+  for (; k < limit; k += step) {
+    {
+      const VECTOR_TYPE a0 = BIT_GEN_ALIGNED_LOAD((VECTOR_TYPE *)&a[0][k + VECTOR_OFFSET(0)]);
+      const VECTOR_TYPE a1 = BIT_GEN_ALIGNED_LOAD((VECTOR_TYPE *)&a[1][k + VECTOR_OFFSET(0)]);
+      const VECTOR_TYPE b0 = BIT_GEN_ALIGNED_LOAD((VECTOR_TYPE *)&b[0][k + VECTOR_OFFSET(0)]);
+      const VECTOR_TYPE b1 = BIT_GEN_ALIGNED_LOAD((VECTOR_TYPE *)&b[1][k + VECTOR_OFFSET(0)]);
+      s0_0 = SIMDe_VECTOR_ADD(s0_0, SIMDe_POPCOUNT(BIT_XOR(a0, b0)));
+      s0_1 = SIMDe_VECTOR_ADD(s0_1, SIMDe_POPCOUNT(BIT_XOR(a0, b1)));
+      s1_0 = SIMDe_VECTOR_ADD(s1_0, SIMDe_POPCOUNT(BIT_XOR(a1, b0)));
+      s1_1 = SIMDe_VECTOR_ADD(s1_1, SIMDe_POPCOUNT(BIT_XOR(a1, b1)));
+    }
+    {
+      const VECTOR_TYPE a0 = BIT_GEN_ALIGNED_LOAD((VECTOR_TYPE *)&a[0][k + VECTOR_OFFSET(1)]);
+      const VECTOR_TYPE a1 = BIT_GEN_ALIGNED_LOAD((VECTOR_TYPE *)&a[1][k + VECTOR_OFFSET(1)]);
+      const VECTOR_TYPE b0 = BIT_GEN_ALIGNED_LOAD((VECTOR_TYPE *)&b[0][k + VECTOR_OFFSET(1)]);
+      const VECTOR_TYPE b1 = BIT_GEN_ALIGNED_LOAD((VECTOR_TYPE *)&b[1][k + VECTOR_OFFSET(1)]);
+      s0_0 = SIMDe_VECTOR_ADD(s0_0, SIMDe_POPCOUNT(BIT_XOR(a0, b0)));
+      s0_1 = SIMDe_VECTOR_ADD(s0_1, SIMDe_POPCOUNT(BIT_XOR(a0, b1)));
+      s1_0 = SIMDe_VECTOR_ADD(s1_0, SIMDe_POPCOUNT(BIT_XOR(a1, b0)));
+      s1_1 = SIMDe_VECTOR_ADD(s1_1, SIMDe_POPCOUNT(BIT_XOR(a1, b1)));
+    }
+  }
+  uint64_t c0_0 = gen_lanes_sum(s0_0);
+  uint64_t c0_1 = gen_lanes_sum(s0_1);
+  uint64_t c1_0 = gen_lanes_sum(s1_0);
+  uint64_t c1_1 = gen_lanes_sum(s1_1);
+  for (; k < k_max; k++) {
+    const uint64_t a0 = a[0][k];
+    const uint64_t a1 = a[1][k];
+    const uint64_t b0 = b[0][k];
+    const uint64_t b1 = b[1][k];
+    c0_0 += POPCOUNT(BIT_SCALAR_XOR(a0, b0));
+    c0_1 += POPCOUNT(BIT_SCALAR_XOR(a0, b1));
+    c1_0 += POPCOUNT(BIT_SCALAR_XOR(a1, b0));
+    c1_1 += POPCOUNT(BIT_SCALAR_XOR(a1, b1));
+  }
+  results[0][0] = (int)c0_0;
+  results[0][1] = (int)c0_1;
+  results[1][0] = (int)c1_0;
+  results[1][1] = (int)c1_1;
+#else
+  setop_count_db_cpu_kernel_outer(2, 2, 2, a, b, k_b, k_max, results, _XOR,
+                                  OMP_CPU_SIMD_ALIGN_BUFFER(ALIGNMENT, setop_buffer),
+                                  BIT_GEN_ALIGNED_LOAD);
+#endif
+}
+
+static void gen_rows_xor_2x2x2_aligned(const uint64_t *const *a, int ni,
+    const uint64_t *const *b, int nj, size_t k_b, size_t k_max,
+    int *restrict counts, size_t ld) {
+  SETOP_BLOCK_TILES(_XOR, BIT_GEN_ALIGNED_LOAD, SETOP_INDIRECT_A, SETOP_INDIRECT_B, 2, 2,
+                    gen_block_xor_2x2x2_aligned(a_rows, b_rows, k_b, k_max, results))
+}
+
+/* xor, 2x2 register block, 2 vectors a step, unaligned loads */
+static inline void gen_block_xor_2x2x2_unaligned(
+    const uint64_t *restrict const *a, const uint64_t *restrict const *b,
+    size_t k_b, size_t k_max, int results[2][2]) {
+#if BIT_GEN_VECTOR_BLOCKS
+  const size_t step = 2 * VECTOR_QWORDS;
+  CHUNK_LIMIT(limit, k_b, k_max, step)
+  VECTOR_TYPE s0_0 = SIMDe_ZERO_VECTOR;
+  VECTOR_TYPE s0_1 = SIMDe_ZERO_VECTOR;
+  VECTOR_TYPE s1_0 = SIMDe_ZERO_VECTOR;
+  VECTOR_TYPE s1_1 = SIMDe_ZERO_VECTOR;
+  size_t k = k_b;
+  for (; k < limit; k += step) {
+    {
+      const VECTOR_TYPE a0 = VECTOR_UNALIGNED_LOAD((VECTOR_TYPE *)&a[0][k + VECTOR_OFFSET(0)]);
+      const VECTOR_TYPE a1 = VECTOR_UNALIGNED_LOAD((VECTOR_TYPE *)&a[1][k + VECTOR_OFFSET(0)]);
+      const VECTOR_TYPE b0 = VECTOR_UNALIGNED_LOAD((VECTOR_TYPE *)&b[0][k + VECTOR_OFFSET(0)]);
+      const VECTOR_TYPE b1 = VECTOR_UNALIGNED_LOAD((VECTOR_TYPE *)&b[1][k + VECTOR_OFFSET(0)]);
+      s0_0 = SIMDe_VECTOR_ADD(s0_0, SIMDe_POPCOUNT(BIT_XOR(a0, b0)));
+      s0_1 = SIMDe_VECTOR_ADD(s0_1, SIMDe_POPCOUNT(BIT_XOR(a0, b1)));
+      s1_0 = SIMDe_VECTOR_ADD(s1_0, SIMDe_POPCOUNT(BIT_XOR(a1, b0)));
+      s1_1 = SIMDe_VECTOR_ADD(s1_1, SIMDe_POPCOUNT(BIT_XOR(a1, b1)));
+    }
+    {
+      const VECTOR_TYPE a0 = VECTOR_UNALIGNED_LOAD((VECTOR_TYPE *)&a[0][k + VECTOR_OFFSET(1)]);
+      const VECTOR_TYPE a1 = VECTOR_UNALIGNED_LOAD((VECTOR_TYPE *)&a[1][k + VECTOR_OFFSET(1)]);
+      const VECTOR_TYPE b0 = VECTOR_UNALIGNED_LOAD((VECTOR_TYPE *)&b[0][k + VECTOR_OFFSET(1)]);
+      const VECTOR_TYPE b1 = VECTOR_UNALIGNED_LOAD((VECTOR_TYPE *)&b[1][k + VECTOR_OFFSET(1)]);
+      s0_0 = SIMDe_VECTOR_ADD(s0_0, SIMDe_POPCOUNT(BIT_XOR(a0, b0)));
+      s0_1 = SIMDe_VECTOR_ADD(s0_1, SIMDe_POPCOUNT(BIT_XOR(a0, b1)));
+      s1_0 = SIMDe_VECTOR_ADD(s1_0, SIMDe_POPCOUNT(BIT_XOR(a1, b0)));
+      s1_1 = SIMDe_VECTOR_ADD(s1_1, SIMDe_POPCOUNT(BIT_XOR(a1, b1)));
+    }
+  }
+  uint64_t c0_0 = gen_lanes_sum(s0_0);
+  uint64_t c0_1 = gen_lanes_sum(s0_1);
+  uint64_t c1_0 = gen_lanes_sum(s1_0);
+  uint64_t c1_1 = gen_lanes_sum(s1_1);
+  for (; k < k_max; k++) {
+    const uint64_t a0 = a[0][k];
+    const uint64_t a1 = a[1][k];
+    const uint64_t b0 = b[0][k];
+    const uint64_t b1 = b[1][k];
+    c0_0 += POPCOUNT(BIT_SCALAR_XOR(a0, b0));
+    c0_1 += POPCOUNT(BIT_SCALAR_XOR(a0, b1));
+    c1_0 += POPCOUNT(BIT_SCALAR_XOR(a1, b0));
+    c1_1 += POPCOUNT(BIT_SCALAR_XOR(a1, b1));
+  }
+  results[0][0] = (int)c0_0;
+  results[0][1] = (int)c0_1;
+  results[1][0] = (int)c1_0;
+  results[1][1] = (int)c1_1;
+#else
+  setop_count_db_cpu_kernel_outer(2, 2, 2, a, b, k_b, k_max, results, _XOR,
+                                  OMP_CPU_SIMD_ALIGN_BUFFER(ALIGNMENT, setop_buffer),
+                                  VECTOR_UNALIGNED_LOAD);
+#endif
+}
+
+static void gen_rows_xor_2x2x2_unaligned(const uint64_t *const *a, int ni,
+    const uint64_t *const *b, int nj, size_t k_b, size_t k_max,
+    int *restrict counts, size_t ld) {
+  SETOP_BLOCK_TILES(_XOR, VECTOR_UNALIGNED_LOAD, SETOP_INDIRECT_A, SETOP_INDIRECT_B, 2, 2,
+                    gen_block_xor_2x2x2_unaligned(a_rows, b_rows, k_b, k_max, results))
+}
+
+/* and_not, 2x2 register block, 2 vectors a step, aligned loads */
+static inline void gen_block_and_not_2x2x2_aligned(
+    const uint64_t *restrict const *a, const uint64_t *restrict const *b,
+    size_t k_b, size_t k_max, int results[2][2]) {
+#if BIT_GEN_VECTOR_BLOCKS
+  const size_t step = 2 * VECTOR_QWORDS;
+  CHUNK_LIMIT(limit, k_b, k_max, step)
+  VECTOR_TYPE s0_0 = SIMDe_ZERO_VECTOR;
+  VECTOR_TYPE s0_1 = SIMDe_ZERO_VECTOR;
+  VECTOR_TYPE s1_0 = SIMDe_ZERO_VECTOR;
+  VECTOR_TYPE s1_1 = SIMDe_ZERO_VECTOR;
+  size_t k = k_b;
+  for (; k < limit; k += step) {
+    {
+      const VECTOR_TYPE a0 = BIT_GEN_ALIGNED_LOAD((VECTOR_TYPE *)&a[0][k + VECTOR_OFFSET(0)]);
+      const VECTOR_TYPE a1 = BIT_GEN_ALIGNED_LOAD((VECTOR_TYPE *)&a[1][k + VECTOR_OFFSET(0)]);
+      const VECTOR_TYPE b0 = BIT_GEN_ALIGNED_LOAD((VECTOR_TYPE *)&b[0][k + VECTOR_OFFSET(0)]);
+      const VECTOR_TYPE b1 = BIT_GEN_ALIGNED_LOAD((VECTOR_TYPE *)&b[1][k + VECTOR_OFFSET(0)]);
+      s0_0 = SIMDe_VECTOR_ADD(s0_0, SIMDe_POPCOUNT(BIT_AND_NOT(a0, b0)));
+      s0_1 = SIMDe_VECTOR_ADD(s0_1, SIMDe_POPCOUNT(BIT_AND_NOT(a0, b1)));
+      s1_0 = SIMDe_VECTOR_ADD(s1_0, SIMDe_POPCOUNT(BIT_AND_NOT(a1, b0)));
+      s1_1 = SIMDe_VECTOR_ADD(s1_1, SIMDe_POPCOUNT(BIT_AND_NOT(a1, b1)));
+    }
+    {
+      const VECTOR_TYPE a0 = BIT_GEN_ALIGNED_LOAD((VECTOR_TYPE *)&a[0][k + VECTOR_OFFSET(1)]);
+      const VECTOR_TYPE a1 = BIT_GEN_ALIGNED_LOAD((VECTOR_TYPE *)&a[1][k + VECTOR_OFFSET(1)]);
+      const VECTOR_TYPE b0 = BIT_GEN_ALIGNED_LOAD((VECTOR_TYPE *)&b[0][k + VECTOR_OFFSET(1)]);
+      const VECTOR_TYPE b1 = BIT_GEN_ALIGNED_LOAD((VECTOR_TYPE *)&b[1][k + VECTOR_OFFSET(1)]);
+      s0_0 = SIMDe_VECTOR_ADD(s0_0, SIMDe_POPCOUNT(BIT_AND_NOT(a0, b0)));
+      s0_1 = SIMDe_VECTOR_ADD(s0_1, SIMDe_POPCOUNT(BIT_AND_NOT(a0, b1)));
+      s1_0 = SIMDe_VECTOR_ADD(s1_0, SIMDe_POPCOUNT(BIT_AND_NOT(a1, b0)));
+      s1_1 = SIMDe_VECTOR_ADD(s1_1, SIMDe_POPCOUNT(BIT_AND_NOT(a1, b1)));
+    }
+  }
+  uint64_t c0_0 = gen_lanes_sum(s0_0);
+  uint64_t c0_1 = gen_lanes_sum(s0_1);
+  uint64_t c1_0 = gen_lanes_sum(s1_0);
+  uint64_t c1_1 = gen_lanes_sum(s1_1);
+  for (; k < k_max; k++) {
+    const uint64_t a0 = a[0][k];
+    const uint64_t a1 = a[1][k];
+    const uint64_t b0 = b[0][k];
+    const uint64_t b1 = b[1][k];
+    c0_0 += POPCOUNT(BIT_SCALAR_AND_NOT(a0, b0));
+    c0_1 += POPCOUNT(BIT_SCALAR_AND_NOT(a0, b1));
+    c1_0 += POPCOUNT(BIT_SCALAR_AND_NOT(a1, b0));
+    c1_1 += POPCOUNT(BIT_SCALAR_AND_NOT(a1, b1));
+  }
+  results[0][0] = (int)c0_0;
+  results[0][1] = (int)c0_1;
+  results[1][0] = (int)c1_0;
+  results[1][1] = (int)c1_1;
+#else
+  setop_count_db_cpu_kernel_outer(2, 2, 2, a, b, k_b, k_max, results, _AND_NOT,
+                                  OMP_CPU_SIMD_ALIGN_BUFFER(ALIGNMENT, setop_buffer),
+                                  BIT_GEN_ALIGNED_LOAD);
+#endif
+}
+
+static void gen_rows_and_not_2x2x2_aligned(const uint64_t *const *a, int ni,
+    const uint64_t *const *b, int nj, size_t k_b, size_t k_max,
+    int *restrict counts, size_t ld) {
+  SETOP_BLOCK_TILES(_AND_NOT, BIT_GEN_ALIGNED_LOAD, SETOP_INDIRECT_A, SETOP_INDIRECT_B, 2, 2,
+                    gen_block_and_not_2x2x2_aligned(a_rows, b_rows, k_b, k_max, results))
+}
+
+/* and_not, 2x2 register block, 2 vectors a step, unaligned loads */
+static inline void gen_block_and_not_2x2x2_unaligned(
+    const uint64_t *restrict const *a, const uint64_t *restrict const *b,
+    size_t k_b, size_t k_max, int results[2][2]) {
+#if BIT_GEN_VECTOR_BLOCKS
+  const size_t step = 2 * VECTOR_QWORDS;
+  CHUNK_LIMIT(limit, k_b, k_max, step)
+  VECTOR_TYPE s0_0 = SIMDe_ZERO_VECTOR;
+  VECTOR_TYPE s0_1 = SIMDe_ZERO_VECTOR;
+  VECTOR_TYPE s1_0 = SIMDe_ZERO_VECTOR;
+  VECTOR_TYPE s1_1 = SIMDe_ZERO_VECTOR;
+  size_t k = k_b;
+  for (; k < limit; k += step) {
+    {
+      const VECTOR_TYPE a0 = VECTOR_UNALIGNED_LOAD((VECTOR_TYPE *)&a[0][k + VECTOR_OFFSET(0)]);
+      const VECTOR_TYPE a1 = VECTOR_UNALIGNED_LOAD((VECTOR_TYPE *)&a[1][k + VECTOR_OFFSET(0)]);
+      const VECTOR_TYPE b0 = VECTOR_UNALIGNED_LOAD((VECTOR_TYPE *)&b[0][k + VECTOR_OFFSET(0)]);
+      const VECTOR_TYPE b1 = VECTOR_UNALIGNED_LOAD((VECTOR_TYPE *)&b[1][k + VECTOR_OFFSET(0)]);
+      s0_0 = SIMDe_VECTOR_ADD(s0_0, SIMDe_POPCOUNT(BIT_AND_NOT(a0, b0)));
+      s0_1 = SIMDe_VECTOR_ADD(s0_1, SIMDe_POPCOUNT(BIT_AND_NOT(a0, b1)));
+      s1_0 = SIMDe_VECTOR_ADD(s1_0, SIMDe_POPCOUNT(BIT_AND_NOT(a1, b0)));
+      s1_1 = SIMDe_VECTOR_ADD(s1_1, SIMDe_POPCOUNT(BIT_AND_NOT(a1, b1)));
+    }
+    {
+      const VECTOR_TYPE a0 = VECTOR_UNALIGNED_LOAD((VECTOR_TYPE *)&a[0][k + VECTOR_OFFSET(1)]);
+      const VECTOR_TYPE a1 = VECTOR_UNALIGNED_LOAD((VECTOR_TYPE *)&a[1][k + VECTOR_OFFSET(1)]);
+      const VECTOR_TYPE b0 = VECTOR_UNALIGNED_LOAD((VECTOR_TYPE *)&b[0][k + VECTOR_OFFSET(1)]);
+      const VECTOR_TYPE b1 = VECTOR_UNALIGNED_LOAD((VECTOR_TYPE *)&b[1][k + VECTOR_OFFSET(1)]);
+      s0_0 = SIMDe_VECTOR_ADD(s0_0, SIMDe_POPCOUNT(BIT_AND_NOT(a0, b0)));
+      s0_1 = SIMDe_VECTOR_ADD(s0_1, SIMDe_POPCOUNT(BIT_AND_NOT(a0, b1)));
+      s1_0 = SIMDe_VECTOR_ADD(s1_0, SIMDe_POPCOUNT(BIT_AND_NOT(a1, b0)));
+      s1_1 = SIMDe_VECTOR_ADD(s1_1, SIMDe_POPCOUNT(BIT_AND_NOT(a1, b1)));
+    }
+  }
+  uint64_t c0_0 = gen_lanes_sum(s0_0);
+  uint64_t c0_1 = gen_lanes_sum(s0_1);
+  uint64_t c1_0 = gen_lanes_sum(s1_0);
+  uint64_t c1_1 = gen_lanes_sum(s1_1);
+  for (; k < k_max; k++) {
+    const uint64_t a0 = a[0][k];
+    const uint64_t a1 = a[1][k];
+    const uint64_t b0 = b[0][k];
+    const uint64_t b1 = b[1][k];
+    c0_0 += POPCOUNT(BIT_SCALAR_AND_NOT(a0, b0));
+    c0_1 += POPCOUNT(BIT_SCALAR_AND_NOT(a0, b1));
+    c1_0 += POPCOUNT(BIT_SCALAR_AND_NOT(a1, b0));
+    c1_1 += POPCOUNT(BIT_SCALAR_AND_NOT(a1, b1));
+  }
+  results[0][0] = (int)c0_0;
+  results[0][1] = (int)c0_1;
+  results[1][0] = (int)c1_0;
+  results[1][1] = (int)c1_1;
+#else
+  setop_count_db_cpu_kernel_outer(2, 2, 2, a, b, k_b, k_max, results, _AND_NOT,
+                                  OMP_CPU_SIMD_ALIGN_BUFFER(ALIGNMENT, setop_buffer),
+                                  VECTOR_UNALIGNED_LOAD);
+#endif
+}
+
+static void gen_rows_and_not_2x2x2_unaligned(const uint64_t *const *a, int ni,
+    const uint64_t *const *b, int nj, size_t k_b, size_t k_max,
+    int *restrict counts, size_t ld) {
+  SETOP_BLOCK_TILES(_AND_NOT, VECTOR_UNALIGNED_LOAD, SETOP_INDIRECT_A, SETOP_INDIRECT_B, 2, 2,
+                    gen_block_and_not_2x2x2_unaligned(a_rows, b_rows, k_b, k_max, results))
+}
+
+/* and, 2x4 register block, 1 vector a step, aligned loads */
+static inline void gen_block_and_2x4x1_aligned(
+    const uint64_t *restrict const *a, const uint64_t *restrict const *b,
+    size_t k_b, size_t k_max, int results[2][4]) {
+#if BIT_GEN_VECTOR_BLOCKS
+  const size_t step = 1 * VECTOR_QWORDS;
+  CHUNK_LIMIT(limit, k_b, k_max, step)
+  VECTOR_TYPE s0_0 = SIMDe_ZERO_VECTOR;
+  VECTOR_TYPE s0_1 = SIMDe_ZERO_VECTOR;
+  VECTOR_TYPE s0_2 = SIMDe_ZERO_VECTOR;
+  VECTOR_TYPE s0_3 = SIMDe_ZERO_VECTOR;
+  VECTOR_TYPE s1_0 = SIMDe_ZERO_VECTOR;
+  VECTOR_TYPE s1_1 = SIMDe_ZERO_VECTOR;
+  VECTOR_TYPE s1_2 = SIMDe_ZERO_VECTOR;
+  VECTOR_TYPE s1_3 = SIMDe_ZERO_VECTOR;
+  size_t k = k_b;
+  for (; k < limit; k += step) {
+    {
+      const VECTOR_TYPE a0 = BIT_GEN_ALIGNED_LOAD((VECTOR_TYPE *)&a[0][k + VECTOR_OFFSET(0)]);
+      const VECTOR_TYPE a1 = BIT_GEN_ALIGNED_LOAD((VECTOR_TYPE *)&a[1][k + VECTOR_OFFSET(0)]);
+      const VECTOR_TYPE b0 = BIT_GEN_ALIGNED_LOAD((VECTOR_TYPE *)&b[0][k + VECTOR_OFFSET(0)]);
+      const VECTOR_TYPE b1 = BIT_GEN_ALIGNED_LOAD((VECTOR_TYPE *)&b[1][k + VECTOR_OFFSET(0)]);
+      const VECTOR_TYPE b2 = BIT_GEN_ALIGNED_LOAD((VECTOR_TYPE *)&b[2][k + VECTOR_OFFSET(0)]);
+      const VECTOR_TYPE b3 = BIT_GEN_ALIGNED_LOAD((VECTOR_TYPE *)&b[3][k + VECTOR_OFFSET(0)]);
+      s0_0 = SIMDe_VECTOR_ADD(s0_0, SIMDe_POPCOUNT(BIT_AND(a0, b0)));
+      s0_1 = SIMDe_VECTOR_ADD(s0_1, SIMDe_POPCOUNT(BIT_AND(a0, b1)));
+      s0_2 = SIMDe_VECTOR_ADD(s0_2, SIMDe_POPCOUNT(BIT_AND(a0, b2)));
+      s0_3 = SIMDe_VECTOR_ADD(s0_3, SIMDe_POPCOUNT(BIT_AND(a0, b3)));
+      s1_0 = SIMDe_VECTOR_ADD(s1_0, SIMDe_POPCOUNT(BIT_AND(a1, b0)));
+      s1_1 = SIMDe_VECTOR_ADD(s1_1, SIMDe_POPCOUNT(BIT_AND(a1, b1)));
+      s1_2 = SIMDe_VECTOR_ADD(s1_2, SIMDe_POPCOUNT(BIT_AND(a1, b2)));
+      s1_3 = SIMDe_VECTOR_ADD(s1_3, SIMDe_POPCOUNT(BIT_AND(a1, b3)));
+    }
+  }
+  uint64_t c0_0 = gen_lanes_sum(s0_0);
+  uint64_t c0_1 = gen_lanes_sum(s0_1);
+  uint64_t c0_2 = gen_lanes_sum(s0_2);
+  uint64_t c0_3 = gen_lanes_sum(s0_3);
+  uint64_t c1_0 = gen_lanes_sum(s1_0);
+  uint64_t c1_1 = gen_lanes_sum(s1_1);
+  uint64_t c1_2 = gen_lanes_sum(s1_2);
+  uint64_t c1_3 = gen_lanes_sum(s1_3);
+  for (; k < k_max; k++) {
+    const uint64_t a0 = a[0][k];
+    const uint64_t a1 = a[1][k];
+    const uint64_t b0 = b[0][k];
+    const uint64_t b1 = b[1][k];
+    const uint64_t b2 = b[2][k];
+    const uint64_t b3 = b[3][k];
+    c0_0 += POPCOUNT(BIT_SCALAR_AND(a0, b0));
+    c0_1 += POPCOUNT(BIT_SCALAR_AND(a0, b1));
+    c0_2 += POPCOUNT(BIT_SCALAR_AND(a0, b2));
+    c0_3 += POPCOUNT(BIT_SCALAR_AND(a0, b3));
+    c1_0 += POPCOUNT(BIT_SCALAR_AND(a1, b0));
+    c1_1 += POPCOUNT(BIT_SCALAR_AND(a1, b1));
+    c1_2 += POPCOUNT(BIT_SCALAR_AND(a1, b2));
+    c1_3 += POPCOUNT(BIT_SCALAR_AND(a1, b3));
+  }
+  results[0][0] = (int)c0_0;
+  results[0][1] = (int)c0_1;
+  results[0][2] = (int)c0_2;
+  results[0][3] = (int)c0_3;
+  results[1][0] = (int)c1_0;
+  results[1][1] = (int)c1_1;
+  results[1][2] = (int)c1_2;
+  results[1][3] = (int)c1_3;
+#else
+  setop_count_db_cpu_kernel_outer(2, 4, 1, a, b, k_b, k_max, results, _AND,
+                                  OMP_CPU_SIMD_ALIGN_BUFFER(ALIGNMENT, setop_buffer),
+                                  BIT_GEN_ALIGNED_LOAD);
+#endif
+}
+
+static void gen_rows_and_2x4x1_aligned(const uint64_t *const *a, int ni,
+    const uint64_t *const *b, int nj, size_t k_b, size_t k_max,
+    int *restrict counts, size_t ld) {
+  SETOP_BLOCK_TILES(_AND, BIT_GEN_ALIGNED_LOAD, SETOP_INDIRECT_A, SETOP_INDIRECT_B, 2, 4,
+                    gen_block_and_2x4x1_aligned(a_rows, b_rows, k_b, k_max, results))
+}
+
+/* and, 2x4 register block, 1 vector a step, unaligned loads */
+static inline void gen_block_and_2x4x1_unaligned(
+    const uint64_t *restrict const *a, const uint64_t *restrict const *b,
+    size_t k_b, size_t k_max, int results[2][4]) {
+#if BIT_GEN_VECTOR_BLOCKS
+  const size_t step = 1 * VECTOR_QWORDS;
+  CHUNK_LIMIT(limit, k_b, k_max, step)
+  VECTOR_TYPE s0_0 = SIMDe_ZERO_VECTOR;
+  VECTOR_TYPE s0_1 = SIMDe_ZERO_VECTOR;
+  VECTOR_TYPE s0_2 = SIMDe_ZERO_VECTOR;
+  VECTOR_TYPE s0_3 = SIMDe_ZERO_VECTOR;
+  VECTOR_TYPE s1_0 = SIMDe_ZERO_VECTOR;
+  VECTOR_TYPE s1_1 = SIMDe_ZERO_VECTOR;
+  VECTOR_TYPE s1_2 = SIMDe_ZERO_VECTOR;
+  VECTOR_TYPE s1_3 = SIMDe_ZERO_VECTOR;
+  size_t k = k_b;
+  for (; k < limit; k += step) {
+    {
+      const VECTOR_TYPE a0 = VECTOR_UNALIGNED_LOAD((VECTOR_TYPE *)&a[0][k + VECTOR_OFFSET(0)]);
+      const VECTOR_TYPE a1 = VECTOR_UNALIGNED_LOAD((VECTOR_TYPE *)&a[1][k + VECTOR_OFFSET(0)]);
+      const VECTOR_TYPE b0 = VECTOR_UNALIGNED_LOAD((VECTOR_TYPE *)&b[0][k + VECTOR_OFFSET(0)]);
+      const VECTOR_TYPE b1 = VECTOR_UNALIGNED_LOAD((VECTOR_TYPE *)&b[1][k + VECTOR_OFFSET(0)]);
+      const VECTOR_TYPE b2 = VECTOR_UNALIGNED_LOAD((VECTOR_TYPE *)&b[2][k + VECTOR_OFFSET(0)]);
+      const VECTOR_TYPE b3 = VECTOR_UNALIGNED_LOAD((VECTOR_TYPE *)&b[3][k + VECTOR_OFFSET(0)]);
+      s0_0 = SIMDe_VECTOR_ADD(s0_0, SIMDe_POPCOUNT(BIT_AND(a0, b0)));
+      s0_1 = SIMDe_VECTOR_ADD(s0_1, SIMDe_POPCOUNT(BIT_AND(a0, b1)));
+      s0_2 = SIMDe_VECTOR_ADD(s0_2, SIMDe_POPCOUNT(BIT_AND(a0, b2)));
+      s0_3 = SIMDe_VECTOR_ADD(s0_3, SIMDe_POPCOUNT(BIT_AND(a0, b3)));
+      s1_0 = SIMDe_VECTOR_ADD(s1_0, SIMDe_POPCOUNT(BIT_AND(a1, b0)));
+      s1_1 = SIMDe_VECTOR_ADD(s1_1, SIMDe_POPCOUNT(BIT_AND(a1, b1)));
+      s1_2 = SIMDe_VECTOR_ADD(s1_2, SIMDe_POPCOUNT(BIT_AND(a1, b2)));
+      s1_3 = SIMDe_VECTOR_ADD(s1_3, SIMDe_POPCOUNT(BIT_AND(a1, b3)));
+    }
+  }
+  uint64_t c0_0 = gen_lanes_sum(s0_0);
+  uint64_t c0_1 = gen_lanes_sum(s0_1);
+  uint64_t c0_2 = gen_lanes_sum(s0_2);
+  uint64_t c0_3 = gen_lanes_sum(s0_3);
+  uint64_t c1_0 = gen_lanes_sum(s1_0);
+  uint64_t c1_1 = gen_lanes_sum(s1_1);
+  uint64_t c1_2 = gen_lanes_sum(s1_2);
+  uint64_t c1_3 = gen_lanes_sum(s1_3);
+  for (; k < k_max; k++) {
+    const uint64_t a0 = a[0][k];
+    const uint64_t a1 = a[1][k];
+    const uint64_t b0 = b[0][k];
+    const uint64_t b1 = b[1][k];
+    const uint64_t b2 = b[2][k];
+    const uint64_t b3 = b[3][k];
+    c0_0 += POPCOUNT(BIT_SCALAR_AND(a0, b0));
+    c0_1 += POPCOUNT(BIT_SCALAR_AND(a0, b1));
+    c0_2 += POPCOUNT(BIT_SCALAR_AND(a0, b2));
+    c0_3 += POPCOUNT(BIT_SCALAR_AND(a0, b3));
+    c1_0 += POPCOUNT(BIT_SCALAR_AND(a1, b0));
+    c1_1 += POPCOUNT(BIT_SCALAR_AND(a1, b1));
+    c1_2 += POPCOUNT(BIT_SCALAR_AND(a1, b2));
+    c1_3 += POPCOUNT(BIT_SCALAR_AND(a1, b3));
+  }
+  results[0][0] = (int)c0_0;
+  results[0][1] = (int)c0_1;
+  results[0][2] = (int)c0_2;
+  results[0][3] = (int)c0_3;
+  results[1][0] = (int)c1_0;
+  results[1][1] = (int)c1_1;
+  results[1][2] = (int)c1_2;
+  results[1][3] = (int)c1_3;
+#else
+  setop_count_db_cpu_kernel_outer(2, 4, 1, a, b, k_b, k_max, results, _AND,
+                                  OMP_CPU_SIMD_ALIGN_BUFFER(ALIGNMENT, setop_buffer),
+                                  VECTOR_UNALIGNED_LOAD);
+#endif
+}
+
+static void gen_rows_and_2x4x1_unaligned(const uint64_t *const *a, int ni,
+    const uint64_t *const *b, int nj, size_t k_b, size_t k_max,
+    int *restrict counts, size_t ld) {
+  SETOP_BLOCK_TILES(_AND, VECTOR_UNALIGNED_LOAD, SETOP_INDIRECT_A, SETOP_INDIRECT_B, 2, 4,
+                    gen_block_and_2x4x1_unaligned(a_rows, b_rows, k_b, k_max, results))
+}
+
+/* or, 2x4 register block, 1 vector a step, aligned loads */
+static inline void gen_block_or_2x4x1_aligned(
+    const uint64_t *restrict const *a, const uint64_t *restrict const *b,
+    size_t k_b, size_t k_max, int results[2][4]) {
+#if BIT_GEN_VECTOR_BLOCKS
+  const size_t step = 1 * VECTOR_QWORDS;
+  CHUNK_LIMIT(limit, k_b, k_max, step)
+  VECTOR_TYPE s0_0 = SIMDe_ZERO_VECTOR;
+  VECTOR_TYPE s0_1 = SIMDe_ZERO_VECTOR;
+  VECTOR_TYPE s0_2 = SIMDe_ZERO_VECTOR;
+  VECTOR_TYPE s0_3 = SIMDe_ZERO_VECTOR;
+  VECTOR_TYPE s1_0 = SIMDe_ZERO_VECTOR;
+  VECTOR_TYPE s1_1 = SIMDe_ZERO_VECTOR;
+  VECTOR_TYPE s1_2 = SIMDe_ZERO_VECTOR;
+  VECTOR_TYPE s1_3 = SIMDe_ZERO_VECTOR;
+  size_t k = k_b;
+  for (; k < limit; k += step) {
+    {
+      const VECTOR_TYPE a0 = BIT_GEN_ALIGNED_LOAD((VECTOR_TYPE *)&a[0][k + VECTOR_OFFSET(0)]);
+      const VECTOR_TYPE a1 = BIT_GEN_ALIGNED_LOAD((VECTOR_TYPE *)&a[1][k + VECTOR_OFFSET(0)]);
+      const VECTOR_TYPE b0 = BIT_GEN_ALIGNED_LOAD((VECTOR_TYPE *)&b[0][k + VECTOR_OFFSET(0)]);
+      const VECTOR_TYPE b1 = BIT_GEN_ALIGNED_LOAD((VECTOR_TYPE *)&b[1][k + VECTOR_OFFSET(0)]);
+      const VECTOR_TYPE b2 = BIT_GEN_ALIGNED_LOAD((VECTOR_TYPE *)&b[2][k + VECTOR_OFFSET(0)]);
+      const VECTOR_TYPE b3 = BIT_GEN_ALIGNED_LOAD((VECTOR_TYPE *)&b[3][k + VECTOR_OFFSET(0)]);
+      s0_0 = SIMDe_VECTOR_ADD(s0_0, SIMDe_POPCOUNT(BIT_OR(a0, b0)));
+      s0_1 = SIMDe_VECTOR_ADD(s0_1, SIMDe_POPCOUNT(BIT_OR(a0, b1)));
+      s0_2 = SIMDe_VECTOR_ADD(s0_2, SIMDe_POPCOUNT(BIT_OR(a0, b2)));
+      s0_3 = SIMDe_VECTOR_ADD(s0_3, SIMDe_POPCOUNT(BIT_OR(a0, b3)));
+      s1_0 = SIMDe_VECTOR_ADD(s1_0, SIMDe_POPCOUNT(BIT_OR(a1, b0)));
+      s1_1 = SIMDe_VECTOR_ADD(s1_1, SIMDe_POPCOUNT(BIT_OR(a1, b1)));
+      s1_2 = SIMDe_VECTOR_ADD(s1_2, SIMDe_POPCOUNT(BIT_OR(a1, b2)));
+      s1_3 = SIMDe_VECTOR_ADD(s1_3, SIMDe_POPCOUNT(BIT_OR(a1, b3)));
+    }
+  }
+  uint64_t c0_0 = gen_lanes_sum(s0_0);
+  uint64_t c0_1 = gen_lanes_sum(s0_1);
+  uint64_t c0_2 = gen_lanes_sum(s0_2);
+  uint64_t c0_3 = gen_lanes_sum(s0_3);
+  uint64_t c1_0 = gen_lanes_sum(s1_0);
+  uint64_t c1_1 = gen_lanes_sum(s1_1);
+  uint64_t c1_2 = gen_lanes_sum(s1_2);
+  uint64_t c1_3 = gen_lanes_sum(s1_3);
+  for (; k < k_max; k++) {
+    const uint64_t a0 = a[0][k];
+    const uint64_t a1 = a[1][k];
+    const uint64_t b0 = b[0][k];
+    const uint64_t b1 = b[1][k];
+    const uint64_t b2 = b[2][k];
+    const uint64_t b3 = b[3][k];
+    c0_0 += POPCOUNT(BIT_SCALAR_OR(a0, b0));
+    c0_1 += POPCOUNT(BIT_SCALAR_OR(a0, b1));
+    c0_2 += POPCOUNT(BIT_SCALAR_OR(a0, b2));
+    c0_3 += POPCOUNT(BIT_SCALAR_OR(a0, b3));
+    c1_0 += POPCOUNT(BIT_SCALAR_OR(a1, b0));
+    c1_1 += POPCOUNT(BIT_SCALAR_OR(a1, b1));
+    c1_2 += POPCOUNT(BIT_SCALAR_OR(a1, b2));
+    c1_3 += POPCOUNT(BIT_SCALAR_OR(a1, b3));
+  }
+  results[0][0] = (int)c0_0;
+  results[0][1] = (int)c0_1;
+  results[0][2] = (int)c0_2;
+  results[0][3] = (int)c0_3;
+  results[1][0] = (int)c1_0;
+  results[1][1] = (int)c1_1;
+  results[1][2] = (int)c1_2;
+  results[1][3] = (int)c1_3;
+#else
+  setop_count_db_cpu_kernel_outer(2, 4, 1, a, b, k_b, k_max, results, _OR,
+                                  OMP_CPU_SIMD_ALIGN_BUFFER(ALIGNMENT, setop_buffer),
+                                  BIT_GEN_ALIGNED_LOAD);
+#endif
+}
+
+static void gen_rows_or_2x4x1_aligned(const uint64_t *const *a, int ni,
+    const uint64_t *const *b, int nj, size_t k_b, size_t k_max,
+    int *restrict counts, size_t ld) {
+  SETOP_BLOCK_TILES(_OR, BIT_GEN_ALIGNED_LOAD, SETOP_INDIRECT_A, SETOP_INDIRECT_B, 2, 4,
+                    gen_block_or_2x4x1_aligned(a_rows, b_rows, k_b, k_max, results))
+}
+
+/* or, 2x4 register block, 1 vector a step, unaligned loads */
+static inline void gen_block_or_2x4x1_unaligned(
+    const uint64_t *restrict const *a, const uint64_t *restrict const *b,
+    size_t k_b, size_t k_max, int results[2][4]) {
+#if BIT_GEN_VECTOR_BLOCKS
+  const size_t step = 1 * VECTOR_QWORDS;
+  CHUNK_LIMIT(limit, k_b, k_max, step)
+  VECTOR_TYPE s0_0 = SIMDe_ZERO_VECTOR;
+  VECTOR_TYPE s0_1 = SIMDe_ZERO_VECTOR;
+  VECTOR_TYPE s0_2 = SIMDe_ZERO_VECTOR;
+  VECTOR_TYPE s0_3 = SIMDe_ZERO_VECTOR;
+  VECTOR_TYPE s1_0 = SIMDe_ZERO_VECTOR;
+  VECTOR_TYPE s1_1 = SIMDe_ZERO_VECTOR;
+  VECTOR_TYPE s1_2 = SIMDe_ZERO_VECTOR;
+  VECTOR_TYPE s1_3 = SIMDe_ZERO_VECTOR;
+  size_t k = k_b;
+  for (; k < limit; k += step) {
+    {
+      const VECTOR_TYPE a0 = VECTOR_UNALIGNED_LOAD((VECTOR_TYPE *)&a[0][k + VECTOR_OFFSET(0)]);
+      const VECTOR_TYPE a1 = VECTOR_UNALIGNED_LOAD((VECTOR_TYPE *)&a[1][k + VECTOR_OFFSET(0)]);
+      const VECTOR_TYPE b0 = VECTOR_UNALIGNED_LOAD((VECTOR_TYPE *)&b[0][k + VECTOR_OFFSET(0)]);
+      const VECTOR_TYPE b1 = VECTOR_UNALIGNED_LOAD((VECTOR_TYPE *)&b[1][k + VECTOR_OFFSET(0)]);
+      const VECTOR_TYPE b2 = VECTOR_UNALIGNED_LOAD((VECTOR_TYPE *)&b[2][k + VECTOR_OFFSET(0)]);
+      const VECTOR_TYPE b3 = VECTOR_UNALIGNED_LOAD((VECTOR_TYPE *)&b[3][k + VECTOR_OFFSET(0)]);
+      s0_0 = SIMDe_VECTOR_ADD(s0_0, SIMDe_POPCOUNT(BIT_OR(a0, b0)));
+      s0_1 = SIMDe_VECTOR_ADD(s0_1, SIMDe_POPCOUNT(BIT_OR(a0, b1)));
+      s0_2 = SIMDe_VECTOR_ADD(s0_2, SIMDe_POPCOUNT(BIT_OR(a0, b2)));
+      s0_3 = SIMDe_VECTOR_ADD(s0_3, SIMDe_POPCOUNT(BIT_OR(a0, b3)));
+      s1_0 = SIMDe_VECTOR_ADD(s1_0, SIMDe_POPCOUNT(BIT_OR(a1, b0)));
+      s1_1 = SIMDe_VECTOR_ADD(s1_1, SIMDe_POPCOUNT(BIT_OR(a1, b1)));
+      s1_2 = SIMDe_VECTOR_ADD(s1_2, SIMDe_POPCOUNT(BIT_OR(a1, b2)));
+      s1_3 = SIMDe_VECTOR_ADD(s1_3, SIMDe_POPCOUNT(BIT_OR(a1, b3)));
+    }
+  }
+  uint64_t c0_0 = gen_lanes_sum(s0_0);
+  uint64_t c0_1 = gen_lanes_sum(s0_1);
+  uint64_t c0_2 = gen_lanes_sum(s0_2);
+  uint64_t c0_3 = gen_lanes_sum(s0_3);
+  uint64_t c1_0 = gen_lanes_sum(s1_0);
+  uint64_t c1_1 = gen_lanes_sum(s1_1);
+  uint64_t c1_2 = gen_lanes_sum(s1_2);
+  uint64_t c1_3 = gen_lanes_sum(s1_3);
+  for (; k < k_max; k++) {
+    const uint64_t a0 = a[0][k];
+    const uint64_t a1 = a[1][k];
+    const uint64_t b0 = b[0][k];
+    const uint64_t b1 = b[1][k];
+    const uint64_t b2 = b[2][k];
+    const uint64_t b3 = b[3][k];
+    c0_0 += POPCOUNT(BIT_SCALAR_OR(a0, b0));
+    c0_1 += POPCOUNT(BIT_SCALAR_OR(a0, b1));
+    c0_2 += POPCOUNT(BIT_SCALAR_OR(a0, b2));
+    c0_3 += POPCOUNT(BIT_SCALAR_OR(a0, b3));
+    c1_0 += POPCOUNT(BIT_SCALAR_OR(a1, b0));
+    c1_1 += POPCOUNT(BIT_SCALAR_OR(a1, b1));
+    c1_2 += POPCOUNT(BIT_SCALAR_OR(a1, b2));
+    c1_3 += POPCOUNT(BIT_SCALAR_OR(a1, b3));
+  }
+  results[0][0] = (int)c0_0;
+  results[0][1] = (int)c0_1;
+  results[0][2] = (int)c0_2;
+  results[0][3] = (int)c0_3;
+  results[1][0] = (int)c1_0;
+  results[1][1] = (int)c1_1;
+  results[1][2] = (int)c1_2;
+  results[1][3] = (int)c1_3;
+#else
+  setop_count_db_cpu_kernel_outer(2, 4, 1, a, b, k_b, k_max, results, _OR,
+                                  OMP_CPU_SIMD_ALIGN_BUFFER(ALIGNMENT, setop_buffer),
+                                  VECTOR_UNALIGNED_LOAD);
+#endif
+}
+
+static void gen_rows_or_2x4x1_unaligned(const uint64_t *const *a, int ni,
+    const uint64_t *const *b, int nj, size_t k_b, size_t k_max,
+    int *restrict counts, size_t ld) {
+  SETOP_BLOCK_TILES(_OR, VECTOR_UNALIGNED_LOAD, SETOP_INDIRECT_A, SETOP_INDIRECT_B, 2, 4,
+                    gen_block_or_2x4x1_unaligned(a_rows, b_rows, k_b, k_max, results))
+}
+
+/* xor, 2x4 register block, 1 vector a step, aligned loads */
+static inline void gen_block_xor_2x4x1_aligned(
+    const uint64_t *restrict const *a, const uint64_t *restrict const *b,
+    size_t k_b, size_t k_max, int results[2][4]) {
+#if BIT_GEN_VECTOR_BLOCKS
+  const size_t step = 1 * VECTOR_QWORDS;
+  CHUNK_LIMIT(limit, k_b, k_max, step)
+  VECTOR_TYPE s0_0 = SIMDe_ZERO_VECTOR;
+  VECTOR_TYPE s0_1 = SIMDe_ZERO_VECTOR;
+  VECTOR_TYPE s0_2 = SIMDe_ZERO_VECTOR;
+  VECTOR_TYPE s0_3 = SIMDe_ZERO_VECTOR;
+  VECTOR_TYPE s1_0 = SIMDe_ZERO_VECTOR;
+  VECTOR_TYPE s1_1 = SIMDe_ZERO_VECTOR;
+  VECTOR_TYPE s1_2 = SIMDe_ZERO_VECTOR;
+  VECTOR_TYPE s1_3 = SIMDe_ZERO_VECTOR;
+  size_t k = k_b;
+  for (; k < limit; k += step) {
+    {
+      const VECTOR_TYPE a0 = BIT_GEN_ALIGNED_LOAD((VECTOR_TYPE *)&a[0][k + VECTOR_OFFSET(0)]);
+      const VECTOR_TYPE a1 = BIT_GEN_ALIGNED_LOAD((VECTOR_TYPE *)&a[1][k + VECTOR_OFFSET(0)]);
+      const VECTOR_TYPE b0 = BIT_GEN_ALIGNED_LOAD((VECTOR_TYPE *)&b[0][k + VECTOR_OFFSET(0)]);
+      const VECTOR_TYPE b1 = BIT_GEN_ALIGNED_LOAD((VECTOR_TYPE *)&b[1][k + VECTOR_OFFSET(0)]);
+      const VECTOR_TYPE b2 = BIT_GEN_ALIGNED_LOAD((VECTOR_TYPE *)&b[2][k + VECTOR_OFFSET(0)]);
+      const VECTOR_TYPE b3 = BIT_GEN_ALIGNED_LOAD((VECTOR_TYPE *)&b[3][k + VECTOR_OFFSET(0)]);
+      s0_0 = SIMDe_VECTOR_ADD(s0_0, SIMDe_POPCOUNT(BIT_XOR(a0, b0)));
+      s0_1 = SIMDe_VECTOR_ADD(s0_1, SIMDe_POPCOUNT(BIT_XOR(a0, b1)));
+      s0_2 = SIMDe_VECTOR_ADD(s0_2, SIMDe_POPCOUNT(BIT_XOR(a0, b2)));
+      s0_3 = SIMDe_VECTOR_ADD(s0_3, SIMDe_POPCOUNT(BIT_XOR(a0, b3)));
+      s1_0 = SIMDe_VECTOR_ADD(s1_0, SIMDe_POPCOUNT(BIT_XOR(a1, b0)));
+      s1_1 = SIMDe_VECTOR_ADD(s1_1, SIMDe_POPCOUNT(BIT_XOR(a1, b1)));
+      s1_2 = SIMDe_VECTOR_ADD(s1_2, SIMDe_POPCOUNT(BIT_XOR(a1, b2)));
+      s1_3 = SIMDe_VECTOR_ADD(s1_3, SIMDe_POPCOUNT(BIT_XOR(a1, b3)));
+    }
+  }
+  uint64_t c0_0 = gen_lanes_sum(s0_0);
+  uint64_t c0_1 = gen_lanes_sum(s0_1);
+  uint64_t c0_2 = gen_lanes_sum(s0_2);
+  uint64_t c0_3 = gen_lanes_sum(s0_3);
+  uint64_t c1_0 = gen_lanes_sum(s1_0);
+  uint64_t c1_1 = gen_lanes_sum(s1_1);
+  uint64_t c1_2 = gen_lanes_sum(s1_2);
+  uint64_t c1_3 = gen_lanes_sum(s1_3);
+  for (; k < k_max; k++) {
+    const uint64_t a0 = a[0][k];
+    const uint64_t a1 = a[1][k];
+    const uint64_t b0 = b[0][k];
+    const uint64_t b1 = b[1][k];
+    const uint64_t b2 = b[2][k];
+    const uint64_t b3 = b[3][k];
+    c0_0 += POPCOUNT(BIT_SCALAR_XOR(a0, b0));
+    c0_1 += POPCOUNT(BIT_SCALAR_XOR(a0, b1));
+    c0_2 += POPCOUNT(BIT_SCALAR_XOR(a0, b2));
+    c0_3 += POPCOUNT(BIT_SCALAR_XOR(a0, b3));
+    c1_0 += POPCOUNT(BIT_SCALAR_XOR(a1, b0));
+    c1_1 += POPCOUNT(BIT_SCALAR_XOR(a1, b1));
+    c1_2 += POPCOUNT(BIT_SCALAR_XOR(a1, b2));
+    c1_3 += POPCOUNT(BIT_SCALAR_XOR(a1, b3));
+  }
+  results[0][0] = (int)c0_0;
+  results[0][1] = (int)c0_1;
+  results[0][2] = (int)c0_2;
+  results[0][3] = (int)c0_3;
+  results[1][0] = (int)c1_0;
+  results[1][1] = (int)c1_1;
+  results[1][2] = (int)c1_2;
+  results[1][3] = (int)c1_3;
+#else
+  setop_count_db_cpu_kernel_outer(2, 4, 1, a, b, k_b, k_max, results, _XOR,
+                                  OMP_CPU_SIMD_ALIGN_BUFFER(ALIGNMENT, setop_buffer),
+                                  BIT_GEN_ALIGNED_LOAD);
+#endif
+}
+
+static void gen_rows_xor_2x4x1_aligned(const uint64_t *const *a, int ni,
+    const uint64_t *const *b, int nj, size_t k_b, size_t k_max,
+    int *restrict counts, size_t ld) {
+  SETOP_BLOCK_TILES(_XOR, BIT_GEN_ALIGNED_LOAD, SETOP_INDIRECT_A, SETOP_INDIRECT_B, 2, 4,
+                    gen_block_xor_2x4x1_aligned(a_rows, b_rows, k_b, k_max, results))
+}
+
+/* xor, 2x4 register block, 1 vector a step, unaligned loads */
+static inline void gen_block_xor_2x4x1_unaligned(
+    const uint64_t *restrict const *a, const uint64_t *restrict const *b,
+    size_t k_b, size_t k_max, int results[2][4]) {
+#if BIT_GEN_VECTOR_BLOCKS
+  const size_t step = 1 * VECTOR_QWORDS;
+  CHUNK_LIMIT(limit, k_b, k_max, step)
+  VECTOR_TYPE s0_0 = SIMDe_ZERO_VECTOR;
+  VECTOR_TYPE s0_1 = SIMDe_ZERO_VECTOR;
+  VECTOR_TYPE s0_2 = SIMDe_ZERO_VECTOR;
+  VECTOR_TYPE s0_3 = SIMDe_ZERO_VECTOR;
+  VECTOR_TYPE s1_0 = SIMDe_ZERO_VECTOR;
+  VECTOR_TYPE s1_1 = SIMDe_ZERO_VECTOR;
+  VECTOR_TYPE s1_2 = SIMDe_ZERO_VECTOR;
+  VECTOR_TYPE s1_3 = SIMDe_ZERO_VECTOR;
+  size_t k = k_b;
+  for (; k < limit; k += step) {
+    {
+      const VECTOR_TYPE a0 = VECTOR_UNALIGNED_LOAD((VECTOR_TYPE *)&a[0][k + VECTOR_OFFSET(0)]);
+      const VECTOR_TYPE a1 = VECTOR_UNALIGNED_LOAD((VECTOR_TYPE *)&a[1][k + VECTOR_OFFSET(0)]);
+      const VECTOR_TYPE b0 = VECTOR_UNALIGNED_LOAD((VECTOR_TYPE *)&b[0][k + VECTOR_OFFSET(0)]);
+      const VECTOR_TYPE b1 = VECTOR_UNALIGNED_LOAD((VECTOR_TYPE *)&b[1][k + VECTOR_OFFSET(0)]);
+      const VECTOR_TYPE b2 = VECTOR_UNALIGNED_LOAD((VECTOR_TYPE *)&b[2][k + VECTOR_OFFSET(0)]);
+      const VECTOR_TYPE b3 = VECTOR_UNALIGNED_LOAD((VECTOR_TYPE *)&b[3][k + VECTOR_OFFSET(0)]);
+      s0_0 = SIMDe_VECTOR_ADD(s0_0, SIMDe_POPCOUNT(BIT_XOR(a0, b0)));
+      s0_1 = SIMDe_VECTOR_ADD(s0_1, SIMDe_POPCOUNT(BIT_XOR(a0, b1)));
+      s0_2 = SIMDe_VECTOR_ADD(s0_2, SIMDe_POPCOUNT(BIT_XOR(a0, b2)));
+      s0_3 = SIMDe_VECTOR_ADD(s0_3, SIMDe_POPCOUNT(BIT_XOR(a0, b3)));
+      s1_0 = SIMDe_VECTOR_ADD(s1_0, SIMDe_POPCOUNT(BIT_XOR(a1, b0)));
+      s1_1 = SIMDe_VECTOR_ADD(s1_1, SIMDe_POPCOUNT(BIT_XOR(a1, b1)));
+      s1_2 = SIMDe_VECTOR_ADD(s1_2, SIMDe_POPCOUNT(BIT_XOR(a1, b2)));
+      s1_3 = SIMDe_VECTOR_ADD(s1_3, SIMDe_POPCOUNT(BIT_XOR(a1, b3)));
+    }
+  }
+  uint64_t c0_0 = gen_lanes_sum(s0_0);
+  uint64_t c0_1 = gen_lanes_sum(s0_1);
+  uint64_t c0_2 = gen_lanes_sum(s0_2);
+  uint64_t c0_3 = gen_lanes_sum(s0_3);
+  uint64_t c1_0 = gen_lanes_sum(s1_0);
+  uint64_t c1_1 = gen_lanes_sum(s1_1);
+  uint64_t c1_2 = gen_lanes_sum(s1_2);
+  uint64_t c1_3 = gen_lanes_sum(s1_3);
+  for (; k < k_max; k++) {
+    const uint64_t a0 = a[0][k];
+    const uint64_t a1 = a[1][k];
+    const uint64_t b0 = b[0][k];
+    const uint64_t b1 = b[1][k];
+    const uint64_t b2 = b[2][k];
+    const uint64_t b3 = b[3][k];
+    c0_0 += POPCOUNT(BIT_SCALAR_XOR(a0, b0));
+    c0_1 += POPCOUNT(BIT_SCALAR_XOR(a0, b1));
+    c0_2 += POPCOUNT(BIT_SCALAR_XOR(a0, b2));
+    c0_3 += POPCOUNT(BIT_SCALAR_XOR(a0, b3));
+    c1_0 += POPCOUNT(BIT_SCALAR_XOR(a1, b0));
+    c1_1 += POPCOUNT(BIT_SCALAR_XOR(a1, b1));
+    c1_2 += POPCOUNT(BIT_SCALAR_XOR(a1, b2));
+    c1_3 += POPCOUNT(BIT_SCALAR_XOR(a1, b3));
+  }
+  results[0][0] = (int)c0_0;
+  results[0][1] = (int)c0_1;
+  results[0][2] = (int)c0_2;
+  results[0][3] = (int)c0_3;
+  results[1][0] = (int)c1_0;
+  results[1][1] = (int)c1_1;
+  results[1][2] = (int)c1_2;
+  results[1][3] = (int)c1_3;
+#else
+  setop_count_db_cpu_kernel_outer(2, 4, 1, a, b, k_b, k_max, results, _XOR,
+                                  OMP_CPU_SIMD_ALIGN_BUFFER(ALIGNMENT, setop_buffer),
+                                  VECTOR_UNALIGNED_LOAD);
+#endif
+}
+
+static void gen_rows_xor_2x4x1_unaligned(const uint64_t *const *a, int ni,
+    const uint64_t *const *b, int nj, size_t k_b, size_t k_max,
+    int *restrict counts, size_t ld) {
+  SETOP_BLOCK_TILES(_XOR, VECTOR_UNALIGNED_LOAD, SETOP_INDIRECT_A, SETOP_INDIRECT_B, 2, 4,
+                    gen_block_xor_2x4x1_unaligned(a_rows, b_rows, k_b, k_max, results))
+}
+
+/* and_not, 2x4 register block, 1 vector a step, aligned loads */
+static inline void gen_block_and_not_2x4x1_aligned(
+    const uint64_t *restrict const *a, const uint64_t *restrict const *b,
+    size_t k_b, size_t k_max, int results[2][4]) {
+#if BIT_GEN_VECTOR_BLOCKS
+  const size_t step = 1 * VECTOR_QWORDS;
+  CHUNK_LIMIT(limit, k_b, k_max, step)
+  VECTOR_TYPE s0_0 = SIMDe_ZERO_VECTOR;
+  VECTOR_TYPE s0_1 = SIMDe_ZERO_VECTOR;
+  VECTOR_TYPE s0_2 = SIMDe_ZERO_VECTOR;
+  VECTOR_TYPE s0_3 = SIMDe_ZERO_VECTOR;
+  VECTOR_TYPE s1_0 = SIMDe_ZERO_VECTOR;
+  VECTOR_TYPE s1_1 = SIMDe_ZERO_VECTOR;
+  VECTOR_TYPE s1_2 = SIMDe_ZERO_VECTOR;
+  VECTOR_TYPE s1_3 = SIMDe_ZERO_VECTOR;
+  size_t k = k_b;
+  for (; k < limit; k += step) {
+    {
+      const VECTOR_TYPE a0 = BIT_GEN_ALIGNED_LOAD((VECTOR_TYPE *)&a[0][k + VECTOR_OFFSET(0)]);
+      const VECTOR_TYPE a1 = BIT_GEN_ALIGNED_LOAD((VECTOR_TYPE *)&a[1][k + VECTOR_OFFSET(0)]);
+      const VECTOR_TYPE b0 = BIT_GEN_ALIGNED_LOAD((VECTOR_TYPE *)&b[0][k + VECTOR_OFFSET(0)]);
+      const VECTOR_TYPE b1 = BIT_GEN_ALIGNED_LOAD((VECTOR_TYPE *)&b[1][k + VECTOR_OFFSET(0)]);
+      const VECTOR_TYPE b2 = BIT_GEN_ALIGNED_LOAD((VECTOR_TYPE *)&b[2][k + VECTOR_OFFSET(0)]);
+      const VECTOR_TYPE b3 = BIT_GEN_ALIGNED_LOAD((VECTOR_TYPE *)&b[3][k + VECTOR_OFFSET(0)]);
+      s0_0 = SIMDe_VECTOR_ADD(s0_0, SIMDe_POPCOUNT(BIT_AND_NOT(a0, b0)));
+      s0_1 = SIMDe_VECTOR_ADD(s0_1, SIMDe_POPCOUNT(BIT_AND_NOT(a0, b1)));
+      s0_2 = SIMDe_VECTOR_ADD(s0_2, SIMDe_POPCOUNT(BIT_AND_NOT(a0, b2)));
+      s0_3 = SIMDe_VECTOR_ADD(s0_3, SIMDe_POPCOUNT(BIT_AND_NOT(a0, b3)));
+      s1_0 = SIMDe_VECTOR_ADD(s1_0, SIMDe_POPCOUNT(BIT_AND_NOT(a1, b0)));
+      s1_1 = SIMDe_VECTOR_ADD(s1_1, SIMDe_POPCOUNT(BIT_AND_NOT(a1, b1)));
+      s1_2 = SIMDe_VECTOR_ADD(s1_2, SIMDe_POPCOUNT(BIT_AND_NOT(a1, b2)));
+      s1_3 = SIMDe_VECTOR_ADD(s1_3, SIMDe_POPCOUNT(BIT_AND_NOT(a1, b3)));
+    }
+  }
+  uint64_t c0_0 = gen_lanes_sum(s0_0);
+  uint64_t c0_1 = gen_lanes_sum(s0_1);
+  uint64_t c0_2 = gen_lanes_sum(s0_2);
+  uint64_t c0_3 = gen_lanes_sum(s0_3);
+  uint64_t c1_0 = gen_lanes_sum(s1_0);
+  uint64_t c1_1 = gen_lanes_sum(s1_1);
+  uint64_t c1_2 = gen_lanes_sum(s1_2);
+  uint64_t c1_3 = gen_lanes_sum(s1_3);
+  for (; k < k_max; k++) {
+    const uint64_t a0 = a[0][k];
+    const uint64_t a1 = a[1][k];
+    const uint64_t b0 = b[0][k];
+    const uint64_t b1 = b[1][k];
+    const uint64_t b2 = b[2][k];
+    const uint64_t b3 = b[3][k];
+    c0_0 += POPCOUNT(BIT_SCALAR_AND_NOT(a0, b0));
+    c0_1 += POPCOUNT(BIT_SCALAR_AND_NOT(a0, b1));
+    c0_2 += POPCOUNT(BIT_SCALAR_AND_NOT(a0, b2));
+    c0_3 += POPCOUNT(BIT_SCALAR_AND_NOT(a0, b3));
+    c1_0 += POPCOUNT(BIT_SCALAR_AND_NOT(a1, b0));
+    c1_1 += POPCOUNT(BIT_SCALAR_AND_NOT(a1, b1));
+    c1_2 += POPCOUNT(BIT_SCALAR_AND_NOT(a1, b2));
+    c1_3 += POPCOUNT(BIT_SCALAR_AND_NOT(a1, b3));
+  }
+  results[0][0] = (int)c0_0;
+  results[0][1] = (int)c0_1;
+  results[0][2] = (int)c0_2;
+  results[0][3] = (int)c0_3;
+  results[1][0] = (int)c1_0;
+  results[1][1] = (int)c1_1;
+  results[1][2] = (int)c1_2;
+  results[1][3] = (int)c1_3;
+#else
+  setop_count_db_cpu_kernel_outer(2, 4, 1, a, b, k_b, k_max, results, _AND_NOT,
+                                  OMP_CPU_SIMD_ALIGN_BUFFER(ALIGNMENT, setop_buffer),
+                                  BIT_GEN_ALIGNED_LOAD);
+#endif
+}
+
+static void gen_rows_and_not_2x4x1_aligned(const uint64_t *const *a, int ni,
+    const uint64_t *const *b, int nj, size_t k_b, size_t k_max,
+    int *restrict counts, size_t ld) {
+  SETOP_BLOCK_TILES(_AND_NOT, BIT_GEN_ALIGNED_LOAD, SETOP_INDIRECT_A, SETOP_INDIRECT_B, 2, 4,
+                    gen_block_and_not_2x4x1_aligned(a_rows, b_rows, k_b, k_max, results))
+}
+
+/* and_not, 2x4 register block, 1 vector a step, unaligned loads */
+static inline void gen_block_and_not_2x4x1_unaligned(
+    const uint64_t *restrict const *a, const uint64_t *restrict const *b,
+    size_t k_b, size_t k_max, int results[2][4]) {
+#if BIT_GEN_VECTOR_BLOCKS
+  const size_t step = 1 * VECTOR_QWORDS;
+  CHUNK_LIMIT(limit, k_b, k_max, step)
+  VECTOR_TYPE s0_0 = SIMDe_ZERO_VECTOR;
+  VECTOR_TYPE s0_1 = SIMDe_ZERO_VECTOR;
+  VECTOR_TYPE s0_2 = SIMDe_ZERO_VECTOR;
+  VECTOR_TYPE s0_3 = SIMDe_ZERO_VECTOR;
+  VECTOR_TYPE s1_0 = SIMDe_ZERO_VECTOR;
+  VECTOR_TYPE s1_1 = SIMDe_ZERO_VECTOR;
+  VECTOR_TYPE s1_2 = SIMDe_ZERO_VECTOR;
+  VECTOR_TYPE s1_3 = SIMDe_ZERO_VECTOR;
+  size_t k = k_b;
+  for (; k < limit; k += step) {
+    {
+      const VECTOR_TYPE a0 = VECTOR_UNALIGNED_LOAD((VECTOR_TYPE *)&a[0][k + VECTOR_OFFSET(0)]);
+      const VECTOR_TYPE a1 = VECTOR_UNALIGNED_LOAD((VECTOR_TYPE *)&a[1][k + VECTOR_OFFSET(0)]);
+      const VECTOR_TYPE b0 = VECTOR_UNALIGNED_LOAD((VECTOR_TYPE *)&b[0][k + VECTOR_OFFSET(0)]);
+      const VECTOR_TYPE b1 = VECTOR_UNALIGNED_LOAD((VECTOR_TYPE *)&b[1][k + VECTOR_OFFSET(0)]);
+      const VECTOR_TYPE b2 = VECTOR_UNALIGNED_LOAD((VECTOR_TYPE *)&b[2][k + VECTOR_OFFSET(0)]);
+      const VECTOR_TYPE b3 = VECTOR_UNALIGNED_LOAD((VECTOR_TYPE *)&b[3][k + VECTOR_OFFSET(0)]);
+      s0_0 = SIMDe_VECTOR_ADD(s0_0, SIMDe_POPCOUNT(BIT_AND_NOT(a0, b0)));
+      s0_1 = SIMDe_VECTOR_ADD(s0_1, SIMDe_POPCOUNT(BIT_AND_NOT(a0, b1)));
+      s0_2 = SIMDe_VECTOR_ADD(s0_2, SIMDe_POPCOUNT(BIT_AND_NOT(a0, b2)));
+      s0_3 = SIMDe_VECTOR_ADD(s0_3, SIMDe_POPCOUNT(BIT_AND_NOT(a0, b3)));
+      s1_0 = SIMDe_VECTOR_ADD(s1_0, SIMDe_POPCOUNT(BIT_AND_NOT(a1, b0)));
+      s1_1 = SIMDe_VECTOR_ADD(s1_1, SIMDe_POPCOUNT(BIT_AND_NOT(a1, b1)));
+      s1_2 = SIMDe_VECTOR_ADD(s1_2, SIMDe_POPCOUNT(BIT_AND_NOT(a1, b2)));
+      s1_3 = SIMDe_VECTOR_ADD(s1_3, SIMDe_POPCOUNT(BIT_AND_NOT(a1, b3)));
+    }
+  }
+  uint64_t c0_0 = gen_lanes_sum(s0_0);
+  uint64_t c0_1 = gen_lanes_sum(s0_1);
+  uint64_t c0_2 = gen_lanes_sum(s0_2);
+  uint64_t c0_3 = gen_lanes_sum(s0_3);
+  uint64_t c1_0 = gen_lanes_sum(s1_0);
+  uint64_t c1_1 = gen_lanes_sum(s1_1);
+  uint64_t c1_2 = gen_lanes_sum(s1_2);
+  uint64_t c1_3 = gen_lanes_sum(s1_3);
+  for (; k < k_max; k++) {
+    const uint64_t a0 = a[0][k];
+    const uint64_t a1 = a[1][k];
+    const uint64_t b0 = b[0][k];
+    const uint64_t b1 = b[1][k];
+    const uint64_t b2 = b[2][k];
+    const uint64_t b3 = b[3][k];
+    c0_0 += POPCOUNT(BIT_SCALAR_AND_NOT(a0, b0));
+    c0_1 += POPCOUNT(BIT_SCALAR_AND_NOT(a0, b1));
+    c0_2 += POPCOUNT(BIT_SCALAR_AND_NOT(a0, b2));
+    c0_3 += POPCOUNT(BIT_SCALAR_AND_NOT(a0, b3));
+    c1_0 += POPCOUNT(BIT_SCALAR_AND_NOT(a1, b0));
+    c1_1 += POPCOUNT(BIT_SCALAR_AND_NOT(a1, b1));
+    c1_2 += POPCOUNT(BIT_SCALAR_AND_NOT(a1, b2));
+    c1_3 += POPCOUNT(BIT_SCALAR_AND_NOT(a1, b3));
+  }
+  results[0][0] = (int)c0_0;
+  results[0][1] = (int)c0_1;
+  results[0][2] = (int)c0_2;
+  results[0][3] = (int)c0_3;
+  results[1][0] = (int)c1_0;
+  results[1][1] = (int)c1_1;
+  results[1][2] = (int)c1_2;
+  results[1][3] = (int)c1_3;
+#else
+  setop_count_db_cpu_kernel_outer(2, 4, 1, a, b, k_b, k_max, results, _AND_NOT,
+                                  OMP_CPU_SIMD_ALIGN_BUFFER(ALIGNMENT, setop_buffer),
+                                  VECTOR_UNALIGNED_LOAD);
+#endif
+}
+
+static void gen_rows_and_not_2x4x1_unaligned(const uint64_t *const *a, int ni,
+    const uint64_t *const *b, int nj, size_t k_b, size_t k_max,
+    int *restrict counts, size_t ld) {
+  SETOP_BLOCK_TILES(_AND_NOT, VECTOR_UNALIGNED_LOAD, SETOP_INDIRECT_A, SETOP_INDIRECT_B, 2, 4,
+                    gen_block_and_not_2x4x1_unaligned(a_rows, b_rows, k_b, k_max, results))
+}
+
+/* and, 4x2 register block, 1 vector a step, aligned loads */
+static inline void gen_block_and_4x2x1_aligned(
+    const uint64_t *restrict const *a, const uint64_t *restrict const *b,
+    size_t k_b, size_t k_max, int results[4][2]) {
+#if BIT_GEN_VECTOR_BLOCKS
+  const size_t step = 1 * VECTOR_QWORDS;
+  CHUNK_LIMIT(limit, k_b, k_max, step)
+  VECTOR_TYPE s0_0 = SIMDe_ZERO_VECTOR;
+  VECTOR_TYPE s0_1 = SIMDe_ZERO_VECTOR;
+  VECTOR_TYPE s1_0 = SIMDe_ZERO_VECTOR;
+  VECTOR_TYPE s1_1 = SIMDe_ZERO_VECTOR;
+  VECTOR_TYPE s2_0 = SIMDe_ZERO_VECTOR;
+  VECTOR_TYPE s2_1 = SIMDe_ZERO_VECTOR;
+  VECTOR_TYPE s3_0 = SIMDe_ZERO_VECTOR;
+  VECTOR_TYPE s3_1 = SIMDe_ZERO_VECTOR;
+  size_t k = k_b;
+  for (; k < limit; k += step) {
+    {
+      const VECTOR_TYPE a0 = BIT_GEN_ALIGNED_LOAD((VECTOR_TYPE *)&a[0][k + VECTOR_OFFSET(0)]);
+      const VECTOR_TYPE a1 = BIT_GEN_ALIGNED_LOAD((VECTOR_TYPE *)&a[1][k + VECTOR_OFFSET(0)]);
+      const VECTOR_TYPE a2 = BIT_GEN_ALIGNED_LOAD((VECTOR_TYPE *)&a[2][k + VECTOR_OFFSET(0)]);
+      const VECTOR_TYPE a3 = BIT_GEN_ALIGNED_LOAD((VECTOR_TYPE *)&a[3][k + VECTOR_OFFSET(0)]);
+      const VECTOR_TYPE b0 = BIT_GEN_ALIGNED_LOAD((VECTOR_TYPE *)&b[0][k + VECTOR_OFFSET(0)]);
+      const VECTOR_TYPE b1 = BIT_GEN_ALIGNED_LOAD((VECTOR_TYPE *)&b[1][k + VECTOR_OFFSET(0)]);
+      s0_0 = SIMDe_VECTOR_ADD(s0_0, SIMDe_POPCOUNT(BIT_AND(a0, b0)));
+      s0_1 = SIMDe_VECTOR_ADD(s0_1, SIMDe_POPCOUNT(BIT_AND(a0, b1)));
+      s1_0 = SIMDe_VECTOR_ADD(s1_0, SIMDe_POPCOUNT(BIT_AND(a1, b0)));
+      s1_1 = SIMDe_VECTOR_ADD(s1_1, SIMDe_POPCOUNT(BIT_AND(a1, b1)));
+      s2_0 = SIMDe_VECTOR_ADD(s2_0, SIMDe_POPCOUNT(BIT_AND(a2, b0)));
+      s2_1 = SIMDe_VECTOR_ADD(s2_1, SIMDe_POPCOUNT(BIT_AND(a2, b1)));
+      s3_0 = SIMDe_VECTOR_ADD(s3_0, SIMDe_POPCOUNT(BIT_AND(a3, b0)));
+      s3_1 = SIMDe_VECTOR_ADD(s3_1, SIMDe_POPCOUNT(BIT_AND(a3, b1)));
+    }
+  }
+  uint64_t c0_0 = gen_lanes_sum(s0_0);
+  uint64_t c0_1 = gen_lanes_sum(s0_1);
+  uint64_t c1_0 = gen_lanes_sum(s1_0);
+  uint64_t c1_1 = gen_lanes_sum(s1_1);
+  uint64_t c2_0 = gen_lanes_sum(s2_0);
+  uint64_t c2_1 = gen_lanes_sum(s2_1);
+  uint64_t c3_0 = gen_lanes_sum(s3_0);
+  uint64_t c3_1 = gen_lanes_sum(s3_1);
+  for (; k < k_max; k++) {
+    const uint64_t a0 = a[0][k];
+    const uint64_t a1 = a[1][k];
+    const uint64_t a2 = a[2][k];
+    const uint64_t a3 = a[3][k];
+    const uint64_t b0 = b[0][k];
+    const uint64_t b1 = b[1][k];
+    c0_0 += POPCOUNT(BIT_SCALAR_AND(a0, b0));
+    c0_1 += POPCOUNT(BIT_SCALAR_AND(a0, b1));
+    c1_0 += POPCOUNT(BIT_SCALAR_AND(a1, b0));
+    c1_1 += POPCOUNT(BIT_SCALAR_AND(a1, b1));
+    c2_0 += POPCOUNT(BIT_SCALAR_AND(a2, b0));
+    c2_1 += POPCOUNT(BIT_SCALAR_AND(a2, b1));
+    c3_0 += POPCOUNT(BIT_SCALAR_AND(a3, b0));
+    c3_1 += POPCOUNT(BIT_SCALAR_AND(a3, b1));
+  }
+  results[0][0] = (int)c0_0;
+  results[0][1] = (int)c0_1;
+  results[1][0] = (int)c1_0;
+  results[1][1] = (int)c1_1;
+  results[2][0] = (int)c2_0;
+  results[2][1] = (int)c2_1;
+  results[3][0] = (int)c3_0;
+  results[3][1] = (int)c3_1;
+#else
+  setop_count_db_cpu_kernel_outer(4, 2, 1, a, b, k_b, k_max, results, _AND,
+                                  OMP_CPU_SIMD_ALIGN_BUFFER(ALIGNMENT, setop_buffer),
+                                  BIT_GEN_ALIGNED_LOAD);
+#endif
+}
+
+static void gen_rows_and_4x2x1_aligned(const uint64_t *const *a, int ni,
+    const uint64_t *const *b, int nj, size_t k_b, size_t k_max,
+    int *restrict counts, size_t ld) {
+  SETOP_BLOCK_TILES(_AND, BIT_GEN_ALIGNED_LOAD, SETOP_INDIRECT_A, SETOP_INDIRECT_B, 4, 2,
+                    gen_block_and_4x2x1_aligned(a_rows, b_rows, k_b, k_max, results))
+}
+
+/* and, 4x2 register block, 1 vector a step, unaligned loads */
+static inline void gen_block_and_4x2x1_unaligned(
+    const uint64_t *restrict const *a, const uint64_t *restrict const *b,
+    size_t k_b, size_t k_max, int results[4][2]) {
+#if BIT_GEN_VECTOR_BLOCKS
+  const size_t step = 1 * VECTOR_QWORDS;
+  CHUNK_LIMIT(limit, k_b, k_max, step)
+  VECTOR_TYPE s0_0 = SIMDe_ZERO_VECTOR;
+  VECTOR_TYPE s0_1 = SIMDe_ZERO_VECTOR;
+  VECTOR_TYPE s1_0 = SIMDe_ZERO_VECTOR;
+  VECTOR_TYPE s1_1 = SIMDe_ZERO_VECTOR;
+  VECTOR_TYPE s2_0 = SIMDe_ZERO_VECTOR;
+  VECTOR_TYPE s2_1 = SIMDe_ZERO_VECTOR;
+  VECTOR_TYPE s3_0 = SIMDe_ZERO_VECTOR;
+  VECTOR_TYPE s3_1 = SIMDe_ZERO_VECTOR;
+  size_t k = k_b;
+  for (; k < limit; k += step) {
+    {
+      const VECTOR_TYPE a0 = VECTOR_UNALIGNED_LOAD((VECTOR_TYPE *)&a[0][k + VECTOR_OFFSET(0)]);
+      const VECTOR_TYPE a1 = VECTOR_UNALIGNED_LOAD((VECTOR_TYPE *)&a[1][k + VECTOR_OFFSET(0)]);
+      const VECTOR_TYPE a2 = VECTOR_UNALIGNED_LOAD((VECTOR_TYPE *)&a[2][k + VECTOR_OFFSET(0)]);
+      const VECTOR_TYPE a3 = VECTOR_UNALIGNED_LOAD((VECTOR_TYPE *)&a[3][k + VECTOR_OFFSET(0)]);
+      const VECTOR_TYPE b0 = VECTOR_UNALIGNED_LOAD((VECTOR_TYPE *)&b[0][k + VECTOR_OFFSET(0)]);
+      const VECTOR_TYPE b1 = VECTOR_UNALIGNED_LOAD((VECTOR_TYPE *)&b[1][k + VECTOR_OFFSET(0)]);
+      s0_0 = SIMDe_VECTOR_ADD(s0_0, SIMDe_POPCOUNT(BIT_AND(a0, b0)));
+      s0_1 = SIMDe_VECTOR_ADD(s0_1, SIMDe_POPCOUNT(BIT_AND(a0, b1)));
+      s1_0 = SIMDe_VECTOR_ADD(s1_0, SIMDe_POPCOUNT(BIT_AND(a1, b0)));
+      s1_1 = SIMDe_VECTOR_ADD(s1_1, SIMDe_POPCOUNT(BIT_AND(a1, b1)));
+      s2_0 = SIMDe_VECTOR_ADD(s2_0, SIMDe_POPCOUNT(BIT_AND(a2, b0)));
+      s2_1 = SIMDe_VECTOR_ADD(s2_1, SIMDe_POPCOUNT(BIT_AND(a2, b1)));
+      s3_0 = SIMDe_VECTOR_ADD(s3_0, SIMDe_POPCOUNT(BIT_AND(a3, b0)));
+      s3_1 = SIMDe_VECTOR_ADD(s3_1, SIMDe_POPCOUNT(BIT_AND(a3, b1)));
+    }
+  }
+  uint64_t c0_0 = gen_lanes_sum(s0_0);
+  uint64_t c0_1 = gen_lanes_sum(s0_1);
+  uint64_t c1_0 = gen_lanes_sum(s1_0);
+  uint64_t c1_1 = gen_lanes_sum(s1_1);
+  uint64_t c2_0 = gen_lanes_sum(s2_0);
+  uint64_t c2_1 = gen_lanes_sum(s2_1);
+  uint64_t c3_0 = gen_lanes_sum(s3_0);
+  uint64_t c3_1 = gen_lanes_sum(s3_1);
+  for (; k < k_max; k++) {
+    const uint64_t a0 = a[0][k];
+    const uint64_t a1 = a[1][k];
+    const uint64_t a2 = a[2][k];
+    const uint64_t a3 = a[3][k];
+    const uint64_t b0 = b[0][k];
+    const uint64_t b1 = b[1][k];
+    c0_0 += POPCOUNT(BIT_SCALAR_AND(a0, b0));
+    c0_1 += POPCOUNT(BIT_SCALAR_AND(a0, b1));
+    c1_0 += POPCOUNT(BIT_SCALAR_AND(a1, b0));
+    c1_1 += POPCOUNT(BIT_SCALAR_AND(a1, b1));
+    c2_0 += POPCOUNT(BIT_SCALAR_AND(a2, b0));
+    c2_1 += POPCOUNT(BIT_SCALAR_AND(a2, b1));
+    c3_0 += POPCOUNT(BIT_SCALAR_AND(a3, b0));
+    c3_1 += POPCOUNT(BIT_SCALAR_AND(a3, b1));
+  }
+  results[0][0] = (int)c0_0;
+  results[0][1] = (int)c0_1;
+  results[1][0] = (int)c1_0;
+  results[1][1] = (int)c1_1;
+  results[2][0] = (int)c2_0;
+  results[2][1] = (int)c2_1;
+  results[3][0] = (int)c3_0;
+  results[3][1] = (int)c3_1;
+#else
+  setop_count_db_cpu_kernel_outer(4, 2, 1, a, b, k_b, k_max, results, _AND,
+                                  OMP_CPU_SIMD_ALIGN_BUFFER(ALIGNMENT, setop_buffer),
+                                  VECTOR_UNALIGNED_LOAD);
+#endif
+}
+
+static void gen_rows_and_4x2x1_unaligned(const uint64_t *const *a, int ni,
+    const uint64_t *const *b, int nj, size_t k_b, size_t k_max,
+    int *restrict counts, size_t ld) {
+  SETOP_BLOCK_TILES(_AND, VECTOR_UNALIGNED_LOAD, SETOP_INDIRECT_A, SETOP_INDIRECT_B, 4, 2,
+                    gen_block_and_4x2x1_unaligned(a_rows, b_rows, k_b, k_max, results))
+}
+
+/* or, 4x2 register block, 1 vector a step, aligned loads */
+static inline void gen_block_or_4x2x1_aligned(
+    const uint64_t *restrict const *a, const uint64_t *restrict const *b,
+    size_t k_b, size_t k_max, int results[4][2]) {
+#if BIT_GEN_VECTOR_BLOCKS
+  const size_t step = 1 * VECTOR_QWORDS;
+  CHUNK_LIMIT(limit, k_b, k_max, step)
+  VECTOR_TYPE s0_0 = SIMDe_ZERO_VECTOR;
+  VECTOR_TYPE s0_1 = SIMDe_ZERO_VECTOR;
+  VECTOR_TYPE s1_0 = SIMDe_ZERO_VECTOR;
+  VECTOR_TYPE s1_1 = SIMDe_ZERO_VECTOR;
+  VECTOR_TYPE s2_0 = SIMDe_ZERO_VECTOR;
+  VECTOR_TYPE s2_1 = SIMDe_ZERO_VECTOR;
+  VECTOR_TYPE s3_0 = SIMDe_ZERO_VECTOR;
+  VECTOR_TYPE s3_1 = SIMDe_ZERO_VECTOR;
+  size_t k = k_b;
+  for (; k < limit; k += step) {
+    {
+      const VECTOR_TYPE a0 = BIT_GEN_ALIGNED_LOAD((VECTOR_TYPE *)&a[0][k + VECTOR_OFFSET(0)]);
+      const VECTOR_TYPE a1 = BIT_GEN_ALIGNED_LOAD((VECTOR_TYPE *)&a[1][k + VECTOR_OFFSET(0)]);
+      const VECTOR_TYPE a2 = BIT_GEN_ALIGNED_LOAD((VECTOR_TYPE *)&a[2][k + VECTOR_OFFSET(0)]);
+      const VECTOR_TYPE a3 = BIT_GEN_ALIGNED_LOAD((VECTOR_TYPE *)&a[3][k + VECTOR_OFFSET(0)]);
+      const VECTOR_TYPE b0 = BIT_GEN_ALIGNED_LOAD((VECTOR_TYPE *)&b[0][k + VECTOR_OFFSET(0)]);
+      const VECTOR_TYPE b1 = BIT_GEN_ALIGNED_LOAD((VECTOR_TYPE *)&b[1][k + VECTOR_OFFSET(0)]);
+      s0_0 = SIMDe_VECTOR_ADD(s0_0, SIMDe_POPCOUNT(BIT_OR(a0, b0)));
+      s0_1 = SIMDe_VECTOR_ADD(s0_1, SIMDe_POPCOUNT(BIT_OR(a0, b1)));
+      s1_0 = SIMDe_VECTOR_ADD(s1_0, SIMDe_POPCOUNT(BIT_OR(a1, b0)));
+      s1_1 = SIMDe_VECTOR_ADD(s1_1, SIMDe_POPCOUNT(BIT_OR(a1, b1)));
+      s2_0 = SIMDe_VECTOR_ADD(s2_0, SIMDe_POPCOUNT(BIT_OR(a2, b0)));
+      s2_1 = SIMDe_VECTOR_ADD(s2_1, SIMDe_POPCOUNT(BIT_OR(a2, b1)));
+      s3_0 = SIMDe_VECTOR_ADD(s3_0, SIMDe_POPCOUNT(BIT_OR(a3, b0)));
+      s3_1 = SIMDe_VECTOR_ADD(s3_1, SIMDe_POPCOUNT(BIT_OR(a3, b1)));
+    }
+  }
+  uint64_t c0_0 = gen_lanes_sum(s0_0);
+  uint64_t c0_1 = gen_lanes_sum(s0_1);
+  uint64_t c1_0 = gen_lanes_sum(s1_0);
+  uint64_t c1_1 = gen_lanes_sum(s1_1);
+  uint64_t c2_0 = gen_lanes_sum(s2_0);
+  uint64_t c2_1 = gen_lanes_sum(s2_1);
+  uint64_t c3_0 = gen_lanes_sum(s3_0);
+  uint64_t c3_1 = gen_lanes_sum(s3_1);
+  for (; k < k_max; k++) {
+    const uint64_t a0 = a[0][k];
+    const uint64_t a1 = a[1][k];
+    const uint64_t a2 = a[2][k];
+    const uint64_t a3 = a[3][k];
+    const uint64_t b0 = b[0][k];
+    const uint64_t b1 = b[1][k];
+    c0_0 += POPCOUNT(BIT_SCALAR_OR(a0, b0));
+    c0_1 += POPCOUNT(BIT_SCALAR_OR(a0, b1));
+    c1_0 += POPCOUNT(BIT_SCALAR_OR(a1, b0));
+    c1_1 += POPCOUNT(BIT_SCALAR_OR(a1, b1));
+    c2_0 += POPCOUNT(BIT_SCALAR_OR(a2, b0));
+    c2_1 += POPCOUNT(BIT_SCALAR_OR(a2, b1));
+    c3_0 += POPCOUNT(BIT_SCALAR_OR(a3, b0));
+    c3_1 += POPCOUNT(BIT_SCALAR_OR(a3, b1));
+  }
+  results[0][0] = (int)c0_0;
+  results[0][1] = (int)c0_1;
+  results[1][0] = (int)c1_0;
+  results[1][1] = (int)c1_1;
+  results[2][0] = (int)c2_0;
+  results[2][1] = (int)c2_1;
+  results[3][0] = (int)c3_0;
+  results[3][1] = (int)c3_1;
+#else
+  setop_count_db_cpu_kernel_outer(4, 2, 1, a, b, k_b, k_max, results, _OR,
+                                  OMP_CPU_SIMD_ALIGN_BUFFER(ALIGNMENT, setop_buffer),
+                                  BIT_GEN_ALIGNED_LOAD);
+#endif
+}
+
+static void gen_rows_or_4x2x1_aligned(const uint64_t *const *a, int ni,
+    const uint64_t *const *b, int nj, size_t k_b, size_t k_max,
+    int *restrict counts, size_t ld) {
+  SETOP_BLOCK_TILES(_OR, BIT_GEN_ALIGNED_LOAD, SETOP_INDIRECT_A, SETOP_INDIRECT_B, 4, 2,
+                    gen_block_or_4x2x1_aligned(a_rows, b_rows, k_b, k_max, results))
+}
+
+/* or, 4x2 register block, 1 vector a step, unaligned loads */
+static inline void gen_block_or_4x2x1_unaligned(
+    const uint64_t *restrict const *a, const uint64_t *restrict const *b,
+    size_t k_b, size_t k_max, int results[4][2]) {
+#if BIT_GEN_VECTOR_BLOCKS
+  const size_t step = 1 * VECTOR_QWORDS;
+  CHUNK_LIMIT(limit, k_b, k_max, step)
+  VECTOR_TYPE s0_0 = SIMDe_ZERO_VECTOR;
+  VECTOR_TYPE s0_1 = SIMDe_ZERO_VECTOR;
+  VECTOR_TYPE s1_0 = SIMDe_ZERO_VECTOR;
+  VECTOR_TYPE s1_1 = SIMDe_ZERO_VECTOR;
+  VECTOR_TYPE s2_0 = SIMDe_ZERO_VECTOR;
+  VECTOR_TYPE s2_1 = SIMDe_ZERO_VECTOR;
+  VECTOR_TYPE s3_0 = SIMDe_ZERO_VECTOR;
+  VECTOR_TYPE s3_1 = SIMDe_ZERO_VECTOR;
+  size_t k = k_b;
+  for (; k < limit; k += step) {
+    {
+      const VECTOR_TYPE a0 = VECTOR_UNALIGNED_LOAD((VECTOR_TYPE *)&a[0][k + VECTOR_OFFSET(0)]);
+      const VECTOR_TYPE a1 = VECTOR_UNALIGNED_LOAD((VECTOR_TYPE *)&a[1][k + VECTOR_OFFSET(0)]);
+      const VECTOR_TYPE a2 = VECTOR_UNALIGNED_LOAD((VECTOR_TYPE *)&a[2][k + VECTOR_OFFSET(0)]);
+      const VECTOR_TYPE a3 = VECTOR_UNALIGNED_LOAD((VECTOR_TYPE *)&a[3][k + VECTOR_OFFSET(0)]);
+      const VECTOR_TYPE b0 = VECTOR_UNALIGNED_LOAD((VECTOR_TYPE *)&b[0][k + VECTOR_OFFSET(0)]);
+      const VECTOR_TYPE b1 = VECTOR_UNALIGNED_LOAD((VECTOR_TYPE *)&b[1][k + VECTOR_OFFSET(0)]);
+      s0_0 = SIMDe_VECTOR_ADD(s0_0, SIMDe_POPCOUNT(BIT_OR(a0, b0)));
+      s0_1 = SIMDe_VECTOR_ADD(s0_1, SIMDe_POPCOUNT(BIT_OR(a0, b1)));
+      s1_0 = SIMDe_VECTOR_ADD(s1_0, SIMDe_POPCOUNT(BIT_OR(a1, b0)));
+      s1_1 = SIMDe_VECTOR_ADD(s1_1, SIMDe_POPCOUNT(BIT_OR(a1, b1)));
+      s2_0 = SIMDe_VECTOR_ADD(s2_0, SIMDe_POPCOUNT(BIT_OR(a2, b0)));
+      s2_1 = SIMDe_VECTOR_ADD(s2_1, SIMDe_POPCOUNT(BIT_OR(a2, b1)));
+      s3_0 = SIMDe_VECTOR_ADD(s3_0, SIMDe_POPCOUNT(BIT_OR(a3, b0)));
+      s3_1 = SIMDe_VECTOR_ADD(s3_1, SIMDe_POPCOUNT(BIT_OR(a3, b1)));
+    }
+  }
+  uint64_t c0_0 = gen_lanes_sum(s0_0);
+  uint64_t c0_1 = gen_lanes_sum(s0_1);
+  uint64_t c1_0 = gen_lanes_sum(s1_0);
+  uint64_t c1_1 = gen_lanes_sum(s1_1);
+  uint64_t c2_0 = gen_lanes_sum(s2_0);
+  uint64_t c2_1 = gen_lanes_sum(s2_1);
+  uint64_t c3_0 = gen_lanes_sum(s3_0);
+  uint64_t c3_1 = gen_lanes_sum(s3_1);
+  for (; k < k_max; k++) {
+    const uint64_t a0 = a[0][k];
+    const uint64_t a1 = a[1][k];
+    const uint64_t a2 = a[2][k];
+    const uint64_t a3 = a[3][k];
+    const uint64_t b0 = b[0][k];
+    const uint64_t b1 = b[1][k];
+    c0_0 += POPCOUNT(BIT_SCALAR_OR(a0, b0));
+    c0_1 += POPCOUNT(BIT_SCALAR_OR(a0, b1));
+    c1_0 += POPCOUNT(BIT_SCALAR_OR(a1, b0));
+    c1_1 += POPCOUNT(BIT_SCALAR_OR(a1, b1));
+    c2_0 += POPCOUNT(BIT_SCALAR_OR(a2, b0));
+    c2_1 += POPCOUNT(BIT_SCALAR_OR(a2, b1));
+    c3_0 += POPCOUNT(BIT_SCALAR_OR(a3, b0));
+    c3_1 += POPCOUNT(BIT_SCALAR_OR(a3, b1));
+  }
+  results[0][0] = (int)c0_0;
+  results[0][1] = (int)c0_1;
+  results[1][0] = (int)c1_0;
+  results[1][1] = (int)c1_1;
+  results[2][0] = (int)c2_0;
+  results[2][1] = (int)c2_1;
+  results[3][0] = (int)c3_0;
+  results[3][1] = (int)c3_1;
+#else
+  setop_count_db_cpu_kernel_outer(4, 2, 1, a, b, k_b, k_max, results, _OR,
+                                  OMP_CPU_SIMD_ALIGN_BUFFER(ALIGNMENT, setop_buffer),
+                                  VECTOR_UNALIGNED_LOAD);
+#endif
+}
+
+static void gen_rows_or_4x2x1_unaligned(const uint64_t *const *a, int ni,
+    const uint64_t *const *b, int nj, size_t k_b, size_t k_max,
+    int *restrict counts, size_t ld) {
+  SETOP_BLOCK_TILES(_OR, VECTOR_UNALIGNED_LOAD, SETOP_INDIRECT_A, SETOP_INDIRECT_B, 4, 2,
+                    gen_block_or_4x2x1_unaligned(a_rows, b_rows, k_b, k_max, results))
+}
+
+/* xor, 4x2 register block, 1 vector a step, aligned loads */
+static inline void gen_block_xor_4x2x1_aligned(
+    const uint64_t *restrict const *a, const uint64_t *restrict const *b,
+    size_t k_b, size_t k_max, int results[4][2]) {
+#if BIT_GEN_VECTOR_BLOCKS
+  const size_t step = 1 * VECTOR_QWORDS;
+  CHUNK_LIMIT(limit, k_b, k_max, step)
+  VECTOR_TYPE s0_0 = SIMDe_ZERO_VECTOR;
+  VECTOR_TYPE s0_1 = SIMDe_ZERO_VECTOR;
+  VECTOR_TYPE s1_0 = SIMDe_ZERO_VECTOR;
+  VECTOR_TYPE s1_1 = SIMDe_ZERO_VECTOR;
+  VECTOR_TYPE s2_0 = SIMDe_ZERO_VECTOR;
+  VECTOR_TYPE s2_1 = SIMDe_ZERO_VECTOR;
+  VECTOR_TYPE s3_0 = SIMDe_ZERO_VECTOR;
+  VECTOR_TYPE s3_1 = SIMDe_ZERO_VECTOR;
+  size_t k = k_b;
+  for (; k < limit; k += step) {
+    {
+      const VECTOR_TYPE a0 = BIT_GEN_ALIGNED_LOAD((VECTOR_TYPE *)&a[0][k + VECTOR_OFFSET(0)]);
+      const VECTOR_TYPE a1 = BIT_GEN_ALIGNED_LOAD((VECTOR_TYPE *)&a[1][k + VECTOR_OFFSET(0)]);
+      const VECTOR_TYPE a2 = BIT_GEN_ALIGNED_LOAD((VECTOR_TYPE *)&a[2][k + VECTOR_OFFSET(0)]);
+      const VECTOR_TYPE a3 = BIT_GEN_ALIGNED_LOAD((VECTOR_TYPE *)&a[3][k + VECTOR_OFFSET(0)]);
+      const VECTOR_TYPE b0 = BIT_GEN_ALIGNED_LOAD((VECTOR_TYPE *)&b[0][k + VECTOR_OFFSET(0)]);
+      const VECTOR_TYPE b1 = BIT_GEN_ALIGNED_LOAD((VECTOR_TYPE *)&b[1][k + VECTOR_OFFSET(0)]);
+      s0_0 = SIMDe_VECTOR_ADD(s0_0, SIMDe_POPCOUNT(BIT_XOR(a0, b0)));
+      s0_1 = SIMDe_VECTOR_ADD(s0_1, SIMDe_POPCOUNT(BIT_XOR(a0, b1)));
+      s1_0 = SIMDe_VECTOR_ADD(s1_0, SIMDe_POPCOUNT(BIT_XOR(a1, b0)));
+      s1_1 = SIMDe_VECTOR_ADD(s1_1, SIMDe_POPCOUNT(BIT_XOR(a1, b1)));
+      s2_0 = SIMDe_VECTOR_ADD(s2_0, SIMDe_POPCOUNT(BIT_XOR(a2, b0)));
+      s2_1 = SIMDe_VECTOR_ADD(s2_1, SIMDe_POPCOUNT(BIT_XOR(a2, b1)));
+      s3_0 = SIMDe_VECTOR_ADD(s3_0, SIMDe_POPCOUNT(BIT_XOR(a3, b0)));
+      s3_1 = SIMDe_VECTOR_ADD(s3_1, SIMDe_POPCOUNT(BIT_XOR(a3, b1)));
+    }
+  }
+  uint64_t c0_0 = gen_lanes_sum(s0_0);
+  uint64_t c0_1 = gen_lanes_sum(s0_1);
+  uint64_t c1_0 = gen_lanes_sum(s1_0);
+  uint64_t c1_1 = gen_lanes_sum(s1_1);
+  uint64_t c2_0 = gen_lanes_sum(s2_0);
+  uint64_t c2_1 = gen_lanes_sum(s2_1);
+  uint64_t c3_0 = gen_lanes_sum(s3_0);
+  uint64_t c3_1 = gen_lanes_sum(s3_1);
+  for (; k < k_max; k++) {
+    const uint64_t a0 = a[0][k];
+    const uint64_t a1 = a[1][k];
+    const uint64_t a2 = a[2][k];
+    const uint64_t a3 = a[3][k];
+    const uint64_t b0 = b[0][k];
+    const uint64_t b1 = b[1][k];
+    c0_0 += POPCOUNT(BIT_SCALAR_XOR(a0, b0));
+    c0_1 += POPCOUNT(BIT_SCALAR_XOR(a0, b1));
+    c1_0 += POPCOUNT(BIT_SCALAR_XOR(a1, b0));
+    c1_1 += POPCOUNT(BIT_SCALAR_XOR(a1, b1));
+    c2_0 += POPCOUNT(BIT_SCALAR_XOR(a2, b0));
+    c2_1 += POPCOUNT(BIT_SCALAR_XOR(a2, b1));
+    c3_0 += POPCOUNT(BIT_SCALAR_XOR(a3, b0));
+    c3_1 += POPCOUNT(BIT_SCALAR_XOR(a3, b1));
+  }
+  results[0][0] = (int)c0_0;
+  results[0][1] = (int)c0_1;
+  results[1][0] = (int)c1_0;
+  results[1][1] = (int)c1_1;
+  results[2][0] = (int)c2_0;
+  results[2][1] = (int)c2_1;
+  results[3][0] = (int)c3_0;
+  results[3][1] = (int)c3_1;
+#else
+  setop_count_db_cpu_kernel_outer(4, 2, 1, a, b, k_b, k_max, results, _XOR,
+                                  OMP_CPU_SIMD_ALIGN_BUFFER(ALIGNMENT, setop_buffer),
+                                  BIT_GEN_ALIGNED_LOAD);
+#endif
+}
+
+static void gen_rows_xor_4x2x1_aligned(const uint64_t *const *a, int ni,
+    const uint64_t *const *b, int nj, size_t k_b, size_t k_max,
+    int *restrict counts, size_t ld) {
+  SETOP_BLOCK_TILES(_XOR, BIT_GEN_ALIGNED_LOAD, SETOP_INDIRECT_A, SETOP_INDIRECT_B, 4, 2,
+                    gen_block_xor_4x2x1_aligned(a_rows, b_rows, k_b, k_max, results))
+}
+
+/* xor, 4x2 register block, 1 vector a step, unaligned loads */
+static inline void gen_block_xor_4x2x1_unaligned(
+    const uint64_t *restrict const *a, const uint64_t *restrict const *b,
+    size_t k_b, size_t k_max, int results[4][2]) {
+#if BIT_GEN_VECTOR_BLOCKS
+  const size_t step = 1 * VECTOR_QWORDS;
+  CHUNK_LIMIT(limit, k_b, k_max, step)
+  VECTOR_TYPE s0_0 = SIMDe_ZERO_VECTOR;
+  VECTOR_TYPE s0_1 = SIMDe_ZERO_VECTOR;
+  VECTOR_TYPE s1_0 = SIMDe_ZERO_VECTOR;
+  VECTOR_TYPE s1_1 = SIMDe_ZERO_VECTOR;
+  VECTOR_TYPE s2_0 = SIMDe_ZERO_VECTOR;
+  VECTOR_TYPE s2_1 = SIMDe_ZERO_VECTOR;
+  VECTOR_TYPE s3_0 = SIMDe_ZERO_VECTOR;
+  VECTOR_TYPE s3_1 = SIMDe_ZERO_VECTOR;
+  size_t k = k_b;
+  for (; k < limit; k += step) {
+    {
+      const VECTOR_TYPE a0 = VECTOR_UNALIGNED_LOAD((VECTOR_TYPE *)&a[0][k + VECTOR_OFFSET(0)]);
+      const VECTOR_TYPE a1 = VECTOR_UNALIGNED_LOAD((VECTOR_TYPE *)&a[1][k + VECTOR_OFFSET(0)]);
+      const VECTOR_TYPE a2 = VECTOR_UNALIGNED_LOAD((VECTOR_TYPE *)&a[2][k + VECTOR_OFFSET(0)]);
+      const VECTOR_TYPE a3 = VECTOR_UNALIGNED_LOAD((VECTOR_TYPE *)&a[3][k + VECTOR_OFFSET(0)]);
+      const VECTOR_TYPE b0 = VECTOR_UNALIGNED_LOAD((VECTOR_TYPE *)&b[0][k + VECTOR_OFFSET(0)]);
+      const VECTOR_TYPE b1 = VECTOR_UNALIGNED_LOAD((VECTOR_TYPE *)&b[1][k + VECTOR_OFFSET(0)]);
+      s0_0 = SIMDe_VECTOR_ADD(s0_0, SIMDe_POPCOUNT(BIT_XOR(a0, b0)));
+      s0_1 = SIMDe_VECTOR_ADD(s0_1, SIMDe_POPCOUNT(BIT_XOR(a0, b1)));
+      s1_0 = SIMDe_VECTOR_ADD(s1_0, SIMDe_POPCOUNT(BIT_XOR(a1, b0)));
+      s1_1 = SIMDe_VECTOR_ADD(s1_1, SIMDe_POPCOUNT(BIT_XOR(a1, b1)));
+      s2_0 = SIMDe_VECTOR_ADD(s2_0, SIMDe_POPCOUNT(BIT_XOR(a2, b0)));
+      s2_1 = SIMDe_VECTOR_ADD(s2_1, SIMDe_POPCOUNT(BIT_XOR(a2, b1)));
+      s3_0 = SIMDe_VECTOR_ADD(s3_0, SIMDe_POPCOUNT(BIT_XOR(a3, b0)));
+      s3_1 = SIMDe_VECTOR_ADD(s3_1, SIMDe_POPCOUNT(BIT_XOR(a3, b1)));
+    }
+  }
+  uint64_t c0_0 = gen_lanes_sum(s0_0);
+  uint64_t c0_1 = gen_lanes_sum(s0_1);
+  uint64_t c1_0 = gen_lanes_sum(s1_0);
+  uint64_t c1_1 = gen_lanes_sum(s1_1);
+  uint64_t c2_0 = gen_lanes_sum(s2_0);
+  uint64_t c2_1 = gen_lanes_sum(s2_1);
+  uint64_t c3_0 = gen_lanes_sum(s3_0);
+  uint64_t c3_1 = gen_lanes_sum(s3_1);
+  for (; k < k_max; k++) {
+    const uint64_t a0 = a[0][k];
+    const uint64_t a1 = a[1][k];
+    const uint64_t a2 = a[2][k];
+    const uint64_t a3 = a[3][k];
+    const uint64_t b0 = b[0][k];
+    const uint64_t b1 = b[1][k];
+    c0_0 += POPCOUNT(BIT_SCALAR_XOR(a0, b0));
+    c0_1 += POPCOUNT(BIT_SCALAR_XOR(a0, b1));
+    c1_0 += POPCOUNT(BIT_SCALAR_XOR(a1, b0));
+    c1_1 += POPCOUNT(BIT_SCALAR_XOR(a1, b1));
+    c2_0 += POPCOUNT(BIT_SCALAR_XOR(a2, b0));
+    c2_1 += POPCOUNT(BIT_SCALAR_XOR(a2, b1));
+    c3_0 += POPCOUNT(BIT_SCALAR_XOR(a3, b0));
+    c3_1 += POPCOUNT(BIT_SCALAR_XOR(a3, b1));
+  }
+  results[0][0] = (int)c0_0;
+  results[0][1] = (int)c0_1;
+  results[1][0] = (int)c1_0;
+  results[1][1] = (int)c1_1;
+  results[2][0] = (int)c2_0;
+  results[2][1] = (int)c2_1;
+  results[3][0] = (int)c3_0;
+  results[3][1] = (int)c3_1;
+#else
+  setop_count_db_cpu_kernel_outer(4, 2, 1, a, b, k_b, k_max, results, _XOR,
+                                  OMP_CPU_SIMD_ALIGN_BUFFER(ALIGNMENT, setop_buffer),
+                                  VECTOR_UNALIGNED_LOAD);
+#endif
+}
+
+static void gen_rows_xor_4x2x1_unaligned(const uint64_t *const *a, int ni,
+    const uint64_t *const *b, int nj, size_t k_b, size_t k_max,
+    int *restrict counts, size_t ld) {
+  SETOP_BLOCK_TILES(_XOR, VECTOR_UNALIGNED_LOAD, SETOP_INDIRECT_A, SETOP_INDIRECT_B, 4, 2,
+                    gen_block_xor_4x2x1_unaligned(a_rows, b_rows, k_b, k_max, results))
+}
+
+/* and_not, 4x2 register block, 1 vector a step, aligned loads */
+static inline void gen_block_and_not_4x2x1_aligned(
+    const uint64_t *restrict const *a, const uint64_t *restrict const *b,
+    size_t k_b, size_t k_max, int results[4][2]) {
+#if BIT_GEN_VECTOR_BLOCKS
+  const size_t step = 1 * VECTOR_QWORDS;
+  CHUNK_LIMIT(limit, k_b, k_max, step)
+  VECTOR_TYPE s0_0 = SIMDe_ZERO_VECTOR;
+  VECTOR_TYPE s0_1 = SIMDe_ZERO_VECTOR;
+  VECTOR_TYPE s1_0 = SIMDe_ZERO_VECTOR;
+  VECTOR_TYPE s1_1 = SIMDe_ZERO_VECTOR;
+  VECTOR_TYPE s2_0 = SIMDe_ZERO_VECTOR;
+  VECTOR_TYPE s2_1 = SIMDe_ZERO_VECTOR;
+  VECTOR_TYPE s3_0 = SIMDe_ZERO_VECTOR;
+  VECTOR_TYPE s3_1 = SIMDe_ZERO_VECTOR;
+  size_t k = k_b;
+  for (; k < limit; k += step) {
+    {
+      const VECTOR_TYPE a0 = BIT_GEN_ALIGNED_LOAD((VECTOR_TYPE *)&a[0][k + VECTOR_OFFSET(0)]);
+      const VECTOR_TYPE a1 = BIT_GEN_ALIGNED_LOAD((VECTOR_TYPE *)&a[1][k + VECTOR_OFFSET(0)]);
+      const VECTOR_TYPE a2 = BIT_GEN_ALIGNED_LOAD((VECTOR_TYPE *)&a[2][k + VECTOR_OFFSET(0)]);
+      const VECTOR_TYPE a3 = BIT_GEN_ALIGNED_LOAD((VECTOR_TYPE *)&a[3][k + VECTOR_OFFSET(0)]);
+      const VECTOR_TYPE b0 = BIT_GEN_ALIGNED_LOAD((VECTOR_TYPE *)&b[0][k + VECTOR_OFFSET(0)]);
+      const VECTOR_TYPE b1 = BIT_GEN_ALIGNED_LOAD((VECTOR_TYPE *)&b[1][k + VECTOR_OFFSET(0)]);
+      s0_0 = SIMDe_VECTOR_ADD(s0_0, SIMDe_POPCOUNT(BIT_AND_NOT(a0, b0)));
+      s0_1 = SIMDe_VECTOR_ADD(s0_1, SIMDe_POPCOUNT(BIT_AND_NOT(a0, b1)));
+      s1_0 = SIMDe_VECTOR_ADD(s1_0, SIMDe_POPCOUNT(BIT_AND_NOT(a1, b0)));
+      s1_1 = SIMDe_VECTOR_ADD(s1_1, SIMDe_POPCOUNT(BIT_AND_NOT(a1, b1)));
+      s2_0 = SIMDe_VECTOR_ADD(s2_0, SIMDe_POPCOUNT(BIT_AND_NOT(a2, b0)));
+      s2_1 = SIMDe_VECTOR_ADD(s2_1, SIMDe_POPCOUNT(BIT_AND_NOT(a2, b1)));
+      s3_0 = SIMDe_VECTOR_ADD(s3_0, SIMDe_POPCOUNT(BIT_AND_NOT(a3, b0)));
+      s3_1 = SIMDe_VECTOR_ADD(s3_1, SIMDe_POPCOUNT(BIT_AND_NOT(a3, b1)));
+    }
+  }
+  uint64_t c0_0 = gen_lanes_sum(s0_0);
+  uint64_t c0_1 = gen_lanes_sum(s0_1);
+  uint64_t c1_0 = gen_lanes_sum(s1_0);
+  uint64_t c1_1 = gen_lanes_sum(s1_1);
+  uint64_t c2_0 = gen_lanes_sum(s2_0);
+  uint64_t c2_1 = gen_lanes_sum(s2_1);
+  uint64_t c3_0 = gen_lanes_sum(s3_0);
+  uint64_t c3_1 = gen_lanes_sum(s3_1);
+  for (; k < k_max; k++) {
+    const uint64_t a0 = a[0][k];
+    const uint64_t a1 = a[1][k];
+    const uint64_t a2 = a[2][k];
+    const uint64_t a3 = a[3][k];
+    const uint64_t b0 = b[0][k];
+    const uint64_t b1 = b[1][k];
+    c0_0 += POPCOUNT(BIT_SCALAR_AND_NOT(a0, b0));
+    c0_1 += POPCOUNT(BIT_SCALAR_AND_NOT(a0, b1));
+    c1_0 += POPCOUNT(BIT_SCALAR_AND_NOT(a1, b0));
+    c1_1 += POPCOUNT(BIT_SCALAR_AND_NOT(a1, b1));
+    c2_0 += POPCOUNT(BIT_SCALAR_AND_NOT(a2, b0));
+    c2_1 += POPCOUNT(BIT_SCALAR_AND_NOT(a2, b1));
+    c3_0 += POPCOUNT(BIT_SCALAR_AND_NOT(a3, b0));
+    c3_1 += POPCOUNT(BIT_SCALAR_AND_NOT(a3, b1));
+  }
+  results[0][0] = (int)c0_0;
+  results[0][1] = (int)c0_1;
+  results[1][0] = (int)c1_0;
+  results[1][1] = (int)c1_1;
+  results[2][0] = (int)c2_0;
+  results[2][1] = (int)c2_1;
+  results[3][0] = (int)c3_0;
+  results[3][1] = (int)c3_1;
+#else
+  setop_count_db_cpu_kernel_outer(4, 2, 1, a, b, k_b, k_max, results, _AND_NOT,
+                                  OMP_CPU_SIMD_ALIGN_BUFFER(ALIGNMENT, setop_buffer),
+                                  BIT_GEN_ALIGNED_LOAD);
+#endif
+}
+
+static void gen_rows_and_not_4x2x1_aligned(const uint64_t *const *a, int ni,
+    const uint64_t *const *b, int nj, size_t k_b, size_t k_max,
+    int *restrict counts, size_t ld) {
+  SETOP_BLOCK_TILES(_AND_NOT, BIT_GEN_ALIGNED_LOAD, SETOP_INDIRECT_A, SETOP_INDIRECT_B, 4, 2,
+                    gen_block_and_not_4x2x1_aligned(a_rows, b_rows, k_b, k_max, results))
+}
+
+/* and_not, 4x2 register block, 1 vector a step, unaligned loads */
+static inline void gen_block_and_not_4x2x1_unaligned(
+    const uint64_t *restrict const *a, const uint64_t *restrict const *b,
+    size_t k_b, size_t k_max, int results[4][2]) {
+#if BIT_GEN_VECTOR_BLOCKS
+  const size_t step = 1 * VECTOR_QWORDS;
+  CHUNK_LIMIT(limit, k_b, k_max, step)
+  VECTOR_TYPE s0_0 = SIMDe_ZERO_VECTOR;
+  VECTOR_TYPE s0_1 = SIMDe_ZERO_VECTOR;
+  VECTOR_TYPE s1_0 = SIMDe_ZERO_VECTOR;
+  VECTOR_TYPE s1_1 = SIMDe_ZERO_VECTOR;
+  VECTOR_TYPE s2_0 = SIMDe_ZERO_VECTOR;
+  VECTOR_TYPE s2_1 = SIMDe_ZERO_VECTOR;
+  VECTOR_TYPE s3_0 = SIMDe_ZERO_VECTOR;
+  VECTOR_TYPE s3_1 = SIMDe_ZERO_VECTOR;
+  size_t k = k_b;
+  for (; k < limit; k += step) {
+    {
+      const VECTOR_TYPE a0 = VECTOR_UNALIGNED_LOAD((VECTOR_TYPE *)&a[0][k + VECTOR_OFFSET(0)]);
+      const VECTOR_TYPE a1 = VECTOR_UNALIGNED_LOAD((VECTOR_TYPE *)&a[1][k + VECTOR_OFFSET(0)]);
+      const VECTOR_TYPE a2 = VECTOR_UNALIGNED_LOAD((VECTOR_TYPE *)&a[2][k + VECTOR_OFFSET(0)]);
+      const VECTOR_TYPE a3 = VECTOR_UNALIGNED_LOAD((VECTOR_TYPE *)&a[3][k + VECTOR_OFFSET(0)]);
+      const VECTOR_TYPE b0 = VECTOR_UNALIGNED_LOAD((VECTOR_TYPE *)&b[0][k + VECTOR_OFFSET(0)]);
+      const VECTOR_TYPE b1 = VECTOR_UNALIGNED_LOAD((VECTOR_TYPE *)&b[1][k + VECTOR_OFFSET(0)]);
+      s0_0 = SIMDe_VECTOR_ADD(s0_0, SIMDe_POPCOUNT(BIT_AND_NOT(a0, b0)));
+      s0_1 = SIMDe_VECTOR_ADD(s0_1, SIMDe_POPCOUNT(BIT_AND_NOT(a0, b1)));
+      s1_0 = SIMDe_VECTOR_ADD(s1_0, SIMDe_POPCOUNT(BIT_AND_NOT(a1, b0)));
+      s1_1 = SIMDe_VECTOR_ADD(s1_1, SIMDe_POPCOUNT(BIT_AND_NOT(a1, b1)));
+      s2_0 = SIMDe_VECTOR_ADD(s2_0, SIMDe_POPCOUNT(BIT_AND_NOT(a2, b0)));
+      s2_1 = SIMDe_VECTOR_ADD(s2_1, SIMDe_POPCOUNT(BIT_AND_NOT(a2, b1)));
+      s3_0 = SIMDe_VECTOR_ADD(s3_0, SIMDe_POPCOUNT(BIT_AND_NOT(a3, b0)));
+      s3_1 = SIMDe_VECTOR_ADD(s3_1, SIMDe_POPCOUNT(BIT_AND_NOT(a3, b1)));
+    }
+  }
+  uint64_t c0_0 = gen_lanes_sum(s0_0);
+  uint64_t c0_1 = gen_lanes_sum(s0_1);
+  uint64_t c1_0 = gen_lanes_sum(s1_0);
+  uint64_t c1_1 = gen_lanes_sum(s1_1);
+  uint64_t c2_0 = gen_lanes_sum(s2_0);
+  uint64_t c2_1 = gen_lanes_sum(s2_1);
+  uint64_t c3_0 = gen_lanes_sum(s3_0);
+  uint64_t c3_1 = gen_lanes_sum(s3_1);
+  for (; k < k_max; k++) {
+    const uint64_t a0 = a[0][k];
+    const uint64_t a1 = a[1][k];
+    const uint64_t a2 = a[2][k];
+    const uint64_t a3 = a[3][k];
+    const uint64_t b0 = b[0][k];
+    const uint64_t b1 = b[1][k];
+    c0_0 += POPCOUNT(BIT_SCALAR_AND_NOT(a0, b0));
+    c0_1 += POPCOUNT(BIT_SCALAR_AND_NOT(a0, b1));
+    c1_0 += POPCOUNT(BIT_SCALAR_AND_NOT(a1, b0));
+    c1_1 += POPCOUNT(BIT_SCALAR_AND_NOT(a1, b1));
+    c2_0 += POPCOUNT(BIT_SCALAR_AND_NOT(a2, b0));
+    c2_1 += POPCOUNT(BIT_SCALAR_AND_NOT(a2, b1));
+    c3_0 += POPCOUNT(BIT_SCALAR_AND_NOT(a3, b0));
+    c3_1 += POPCOUNT(BIT_SCALAR_AND_NOT(a3, b1));
+  }
+  results[0][0] = (int)c0_0;
+  results[0][1] = (int)c0_1;
+  results[1][0] = (int)c1_0;
+  results[1][1] = (int)c1_1;
+  results[2][0] = (int)c2_0;
+  results[2][1] = (int)c2_1;
+  results[3][0] = (int)c3_0;
+  results[3][1] = (int)c3_1;
+#else
+  setop_count_db_cpu_kernel_outer(4, 2, 1, a, b, k_b, k_max, results, _AND_NOT,
+                                  OMP_CPU_SIMD_ALIGN_BUFFER(ALIGNMENT, setop_buffer),
+                                  VECTOR_UNALIGNED_LOAD);
+#endif
+}
+
+static void gen_rows_and_not_4x2x1_unaligned(const uint64_t *const *a, int ni,
+    const uint64_t *const *b, int nj, size_t k_b, size_t k_max,
+    int *restrict counts, size_t ld) {
+  SETOP_BLOCK_TILES(_AND_NOT, VECTOR_UNALIGNED_LOAD, SETOP_INDIRECT_A, SETOP_INDIRECT_B, 4, 2,
+                    gen_block_and_not_4x2x1_unaligned(a_rows, b_rows, k_b, k_max, results))
+}
+
+/* and, 4x4 register block, 1 vector a step, aligned loads */
+static inline void gen_block_and_4x4x1_aligned(
+    const uint64_t *restrict const *a, const uint64_t *restrict const *b,
+    size_t k_b, size_t k_max, int results[4][4]) {
+#if BIT_GEN_VECTOR_BLOCKS
+  const size_t step = 1 * VECTOR_QWORDS;
+  CHUNK_LIMIT(limit, k_b, k_max, step)
+  VECTOR_TYPE s0_0 = SIMDe_ZERO_VECTOR;
+  VECTOR_TYPE s0_1 = SIMDe_ZERO_VECTOR;
+  VECTOR_TYPE s0_2 = SIMDe_ZERO_VECTOR;
+  VECTOR_TYPE s0_3 = SIMDe_ZERO_VECTOR;
+  VECTOR_TYPE s1_0 = SIMDe_ZERO_VECTOR;
+  VECTOR_TYPE s1_1 = SIMDe_ZERO_VECTOR;
+  VECTOR_TYPE s1_2 = SIMDe_ZERO_VECTOR;
+  VECTOR_TYPE s1_3 = SIMDe_ZERO_VECTOR;
+  VECTOR_TYPE s2_0 = SIMDe_ZERO_VECTOR;
+  VECTOR_TYPE s2_1 = SIMDe_ZERO_VECTOR;
+  VECTOR_TYPE s2_2 = SIMDe_ZERO_VECTOR;
+  VECTOR_TYPE s2_3 = SIMDe_ZERO_VECTOR;
+  VECTOR_TYPE s3_0 = SIMDe_ZERO_VECTOR;
+  VECTOR_TYPE s3_1 = SIMDe_ZERO_VECTOR;
+  VECTOR_TYPE s3_2 = SIMDe_ZERO_VECTOR;
+  VECTOR_TYPE s3_3 = SIMDe_ZERO_VECTOR;
+  size_t k = k_b;
+  for (; k < limit; k += step) {
+    {
+      const VECTOR_TYPE a0 = BIT_GEN_ALIGNED_LOAD((VECTOR_TYPE *)&a[0][k + VECTOR_OFFSET(0)]);
+      const VECTOR_TYPE a1 = BIT_GEN_ALIGNED_LOAD((VECTOR_TYPE *)&a[1][k + VECTOR_OFFSET(0)]);
+      const VECTOR_TYPE a2 = BIT_GEN_ALIGNED_LOAD((VECTOR_TYPE *)&a[2][k + VECTOR_OFFSET(0)]);
+      const VECTOR_TYPE a3 = BIT_GEN_ALIGNED_LOAD((VECTOR_TYPE *)&a[3][k + VECTOR_OFFSET(0)]);
+      const VECTOR_TYPE b0 = BIT_GEN_ALIGNED_LOAD((VECTOR_TYPE *)&b[0][k + VECTOR_OFFSET(0)]);
+      const VECTOR_TYPE b1 = BIT_GEN_ALIGNED_LOAD((VECTOR_TYPE *)&b[1][k + VECTOR_OFFSET(0)]);
+      const VECTOR_TYPE b2 = BIT_GEN_ALIGNED_LOAD((VECTOR_TYPE *)&b[2][k + VECTOR_OFFSET(0)]);
+      const VECTOR_TYPE b3 = BIT_GEN_ALIGNED_LOAD((VECTOR_TYPE *)&b[3][k + VECTOR_OFFSET(0)]);
+      s0_0 = SIMDe_VECTOR_ADD(s0_0, SIMDe_POPCOUNT(BIT_AND(a0, b0)));
+      s0_1 = SIMDe_VECTOR_ADD(s0_1, SIMDe_POPCOUNT(BIT_AND(a0, b1)));
+      s0_2 = SIMDe_VECTOR_ADD(s0_2, SIMDe_POPCOUNT(BIT_AND(a0, b2)));
+      s0_3 = SIMDe_VECTOR_ADD(s0_3, SIMDe_POPCOUNT(BIT_AND(a0, b3)));
+      s1_0 = SIMDe_VECTOR_ADD(s1_0, SIMDe_POPCOUNT(BIT_AND(a1, b0)));
+      s1_1 = SIMDe_VECTOR_ADD(s1_1, SIMDe_POPCOUNT(BIT_AND(a1, b1)));
+      s1_2 = SIMDe_VECTOR_ADD(s1_2, SIMDe_POPCOUNT(BIT_AND(a1, b2)));
+      s1_3 = SIMDe_VECTOR_ADD(s1_3, SIMDe_POPCOUNT(BIT_AND(a1, b3)));
+      s2_0 = SIMDe_VECTOR_ADD(s2_0, SIMDe_POPCOUNT(BIT_AND(a2, b0)));
+      s2_1 = SIMDe_VECTOR_ADD(s2_1, SIMDe_POPCOUNT(BIT_AND(a2, b1)));
+      s2_2 = SIMDe_VECTOR_ADD(s2_2, SIMDe_POPCOUNT(BIT_AND(a2, b2)));
+      s2_3 = SIMDe_VECTOR_ADD(s2_3, SIMDe_POPCOUNT(BIT_AND(a2, b3)));
+      s3_0 = SIMDe_VECTOR_ADD(s3_0, SIMDe_POPCOUNT(BIT_AND(a3, b0)));
+      s3_1 = SIMDe_VECTOR_ADD(s3_1, SIMDe_POPCOUNT(BIT_AND(a3, b1)));
+      s3_2 = SIMDe_VECTOR_ADD(s3_2, SIMDe_POPCOUNT(BIT_AND(a3, b2)));
+      s3_3 = SIMDe_VECTOR_ADD(s3_3, SIMDe_POPCOUNT(BIT_AND(a3, b3)));
+    }
+  }
+  uint64_t c0_0 = gen_lanes_sum(s0_0);
+  uint64_t c0_1 = gen_lanes_sum(s0_1);
+  uint64_t c0_2 = gen_lanes_sum(s0_2);
+  uint64_t c0_3 = gen_lanes_sum(s0_3);
+  uint64_t c1_0 = gen_lanes_sum(s1_0);
+  uint64_t c1_1 = gen_lanes_sum(s1_1);
+  uint64_t c1_2 = gen_lanes_sum(s1_2);
+  uint64_t c1_3 = gen_lanes_sum(s1_3);
+  uint64_t c2_0 = gen_lanes_sum(s2_0);
+  uint64_t c2_1 = gen_lanes_sum(s2_1);
+  uint64_t c2_2 = gen_lanes_sum(s2_2);
+  uint64_t c2_3 = gen_lanes_sum(s2_3);
+  uint64_t c3_0 = gen_lanes_sum(s3_0);
+  uint64_t c3_1 = gen_lanes_sum(s3_1);
+  uint64_t c3_2 = gen_lanes_sum(s3_2);
+  uint64_t c3_3 = gen_lanes_sum(s3_3);
+  for (; k < k_max; k++) {
+    const uint64_t a0 = a[0][k];
+    const uint64_t a1 = a[1][k];
+    const uint64_t a2 = a[2][k];
+    const uint64_t a3 = a[3][k];
+    const uint64_t b0 = b[0][k];
+    const uint64_t b1 = b[1][k];
+    const uint64_t b2 = b[2][k];
+    const uint64_t b3 = b[3][k];
+    c0_0 += POPCOUNT(BIT_SCALAR_AND(a0, b0));
+    c0_1 += POPCOUNT(BIT_SCALAR_AND(a0, b1));
+    c0_2 += POPCOUNT(BIT_SCALAR_AND(a0, b2));
+    c0_3 += POPCOUNT(BIT_SCALAR_AND(a0, b3));
+    c1_0 += POPCOUNT(BIT_SCALAR_AND(a1, b0));
+    c1_1 += POPCOUNT(BIT_SCALAR_AND(a1, b1));
+    c1_2 += POPCOUNT(BIT_SCALAR_AND(a1, b2));
+    c1_3 += POPCOUNT(BIT_SCALAR_AND(a1, b3));
+    c2_0 += POPCOUNT(BIT_SCALAR_AND(a2, b0));
+    c2_1 += POPCOUNT(BIT_SCALAR_AND(a2, b1));
+    c2_2 += POPCOUNT(BIT_SCALAR_AND(a2, b2));
+    c2_3 += POPCOUNT(BIT_SCALAR_AND(a2, b3));
+    c3_0 += POPCOUNT(BIT_SCALAR_AND(a3, b0));
+    c3_1 += POPCOUNT(BIT_SCALAR_AND(a3, b1));
+    c3_2 += POPCOUNT(BIT_SCALAR_AND(a3, b2));
+    c3_3 += POPCOUNT(BIT_SCALAR_AND(a3, b3));
+  }
+  results[0][0] = (int)c0_0;
+  results[0][1] = (int)c0_1;
+  results[0][2] = (int)c0_2;
+  results[0][3] = (int)c0_3;
+  results[1][0] = (int)c1_0;
+  results[1][1] = (int)c1_1;
+  results[1][2] = (int)c1_2;
+  results[1][3] = (int)c1_3;
+  results[2][0] = (int)c2_0;
+  results[2][1] = (int)c2_1;
+  results[2][2] = (int)c2_2;
+  results[2][3] = (int)c2_3;
+  results[3][0] = (int)c3_0;
+  results[3][1] = (int)c3_1;
+  results[3][2] = (int)c3_2;
+  results[3][3] = (int)c3_3;
+#else
+  setop_count_db_cpu_kernel_outer(4, 4, 1, a, b, k_b, k_max, results, _AND,
+                                  OMP_CPU_SIMD_ALIGN_BUFFER(ALIGNMENT, setop_buffer),
+                                  BIT_GEN_ALIGNED_LOAD);
+#endif
+}
+
+static void gen_rows_and_4x4x1_aligned(const uint64_t *const *a, int ni,
+    const uint64_t *const *b, int nj, size_t k_b, size_t k_max,
+    int *restrict counts, size_t ld) {
+  SETOP_BLOCK_TILES(_AND, BIT_GEN_ALIGNED_LOAD, SETOP_INDIRECT_A, SETOP_INDIRECT_B, 4, 4,
+                    gen_block_and_4x4x1_aligned(a_rows, b_rows, k_b, k_max, results))
+}
+
+/* and, 4x4 register block, 1 vector a step, unaligned loads */
+static inline void gen_block_and_4x4x1_unaligned(
+    const uint64_t *restrict const *a, const uint64_t *restrict const *b,
+    size_t k_b, size_t k_max, int results[4][4]) {
+#if BIT_GEN_VECTOR_BLOCKS
+  const size_t step = 1 * VECTOR_QWORDS;
+  CHUNK_LIMIT(limit, k_b, k_max, step)
+  VECTOR_TYPE s0_0 = SIMDe_ZERO_VECTOR;
+  VECTOR_TYPE s0_1 = SIMDe_ZERO_VECTOR;
+  VECTOR_TYPE s0_2 = SIMDe_ZERO_VECTOR;
+  VECTOR_TYPE s0_3 = SIMDe_ZERO_VECTOR;
+  VECTOR_TYPE s1_0 = SIMDe_ZERO_VECTOR;
+  VECTOR_TYPE s1_1 = SIMDe_ZERO_VECTOR;
+  VECTOR_TYPE s1_2 = SIMDe_ZERO_VECTOR;
+  VECTOR_TYPE s1_3 = SIMDe_ZERO_VECTOR;
+  VECTOR_TYPE s2_0 = SIMDe_ZERO_VECTOR;
+  VECTOR_TYPE s2_1 = SIMDe_ZERO_VECTOR;
+  VECTOR_TYPE s2_2 = SIMDe_ZERO_VECTOR;
+  VECTOR_TYPE s2_3 = SIMDe_ZERO_VECTOR;
+  VECTOR_TYPE s3_0 = SIMDe_ZERO_VECTOR;
+  VECTOR_TYPE s3_1 = SIMDe_ZERO_VECTOR;
+  VECTOR_TYPE s3_2 = SIMDe_ZERO_VECTOR;
+  VECTOR_TYPE s3_3 = SIMDe_ZERO_VECTOR;
+  size_t k = k_b;
+  for (; k < limit; k += step) {
+    {
+      const VECTOR_TYPE a0 = VECTOR_UNALIGNED_LOAD((VECTOR_TYPE *)&a[0][k + VECTOR_OFFSET(0)]);
+      const VECTOR_TYPE a1 = VECTOR_UNALIGNED_LOAD((VECTOR_TYPE *)&a[1][k + VECTOR_OFFSET(0)]);
+      const VECTOR_TYPE a2 = VECTOR_UNALIGNED_LOAD((VECTOR_TYPE *)&a[2][k + VECTOR_OFFSET(0)]);
+      const VECTOR_TYPE a3 = VECTOR_UNALIGNED_LOAD((VECTOR_TYPE *)&a[3][k + VECTOR_OFFSET(0)]);
+      const VECTOR_TYPE b0 = VECTOR_UNALIGNED_LOAD((VECTOR_TYPE *)&b[0][k + VECTOR_OFFSET(0)]);
+      const VECTOR_TYPE b1 = VECTOR_UNALIGNED_LOAD((VECTOR_TYPE *)&b[1][k + VECTOR_OFFSET(0)]);
+      const VECTOR_TYPE b2 = VECTOR_UNALIGNED_LOAD((VECTOR_TYPE *)&b[2][k + VECTOR_OFFSET(0)]);
+      const VECTOR_TYPE b3 = VECTOR_UNALIGNED_LOAD((VECTOR_TYPE *)&b[3][k + VECTOR_OFFSET(0)]);
+      s0_0 = SIMDe_VECTOR_ADD(s0_0, SIMDe_POPCOUNT(BIT_AND(a0, b0)));
+      s0_1 = SIMDe_VECTOR_ADD(s0_1, SIMDe_POPCOUNT(BIT_AND(a0, b1)));
+      s0_2 = SIMDe_VECTOR_ADD(s0_2, SIMDe_POPCOUNT(BIT_AND(a0, b2)));
+      s0_3 = SIMDe_VECTOR_ADD(s0_3, SIMDe_POPCOUNT(BIT_AND(a0, b3)));
+      s1_0 = SIMDe_VECTOR_ADD(s1_0, SIMDe_POPCOUNT(BIT_AND(a1, b0)));
+      s1_1 = SIMDe_VECTOR_ADD(s1_1, SIMDe_POPCOUNT(BIT_AND(a1, b1)));
+      s1_2 = SIMDe_VECTOR_ADD(s1_2, SIMDe_POPCOUNT(BIT_AND(a1, b2)));
+      s1_3 = SIMDe_VECTOR_ADD(s1_3, SIMDe_POPCOUNT(BIT_AND(a1, b3)));
+      s2_0 = SIMDe_VECTOR_ADD(s2_0, SIMDe_POPCOUNT(BIT_AND(a2, b0)));
+      s2_1 = SIMDe_VECTOR_ADD(s2_1, SIMDe_POPCOUNT(BIT_AND(a2, b1)));
+      s2_2 = SIMDe_VECTOR_ADD(s2_2, SIMDe_POPCOUNT(BIT_AND(a2, b2)));
+      s2_3 = SIMDe_VECTOR_ADD(s2_3, SIMDe_POPCOUNT(BIT_AND(a2, b3)));
+      s3_0 = SIMDe_VECTOR_ADD(s3_0, SIMDe_POPCOUNT(BIT_AND(a3, b0)));
+      s3_1 = SIMDe_VECTOR_ADD(s3_1, SIMDe_POPCOUNT(BIT_AND(a3, b1)));
+      s3_2 = SIMDe_VECTOR_ADD(s3_2, SIMDe_POPCOUNT(BIT_AND(a3, b2)));
+      s3_3 = SIMDe_VECTOR_ADD(s3_3, SIMDe_POPCOUNT(BIT_AND(a3, b3)));
+    }
+  }
+  uint64_t c0_0 = gen_lanes_sum(s0_0);
+  uint64_t c0_1 = gen_lanes_sum(s0_1);
+  uint64_t c0_2 = gen_lanes_sum(s0_2);
+  uint64_t c0_3 = gen_lanes_sum(s0_3);
+  uint64_t c1_0 = gen_lanes_sum(s1_0);
+  uint64_t c1_1 = gen_lanes_sum(s1_1);
+  uint64_t c1_2 = gen_lanes_sum(s1_2);
+  uint64_t c1_3 = gen_lanes_sum(s1_3);
+  uint64_t c2_0 = gen_lanes_sum(s2_0);
+  uint64_t c2_1 = gen_lanes_sum(s2_1);
+  uint64_t c2_2 = gen_lanes_sum(s2_2);
+  uint64_t c2_3 = gen_lanes_sum(s2_3);
+  uint64_t c3_0 = gen_lanes_sum(s3_0);
+  uint64_t c3_1 = gen_lanes_sum(s3_1);
+  uint64_t c3_2 = gen_lanes_sum(s3_2);
+  uint64_t c3_3 = gen_lanes_sum(s3_3);
+  for (; k < k_max; k++) {
+    const uint64_t a0 = a[0][k];
+    const uint64_t a1 = a[1][k];
+    const uint64_t a2 = a[2][k];
+    const uint64_t a3 = a[3][k];
+    const uint64_t b0 = b[0][k];
+    const uint64_t b1 = b[1][k];
+    const uint64_t b2 = b[2][k];
+    const uint64_t b3 = b[3][k];
+    c0_0 += POPCOUNT(BIT_SCALAR_AND(a0, b0));
+    c0_1 += POPCOUNT(BIT_SCALAR_AND(a0, b1));
+    c0_2 += POPCOUNT(BIT_SCALAR_AND(a0, b2));
+    c0_3 += POPCOUNT(BIT_SCALAR_AND(a0, b3));
+    c1_0 += POPCOUNT(BIT_SCALAR_AND(a1, b0));
+    c1_1 += POPCOUNT(BIT_SCALAR_AND(a1, b1));
+    c1_2 += POPCOUNT(BIT_SCALAR_AND(a1, b2));
+    c1_3 += POPCOUNT(BIT_SCALAR_AND(a1, b3));
+    c2_0 += POPCOUNT(BIT_SCALAR_AND(a2, b0));
+    c2_1 += POPCOUNT(BIT_SCALAR_AND(a2, b1));
+    c2_2 += POPCOUNT(BIT_SCALAR_AND(a2, b2));
+    c2_3 += POPCOUNT(BIT_SCALAR_AND(a2, b3));
+    c3_0 += POPCOUNT(BIT_SCALAR_AND(a3, b0));
+    c3_1 += POPCOUNT(BIT_SCALAR_AND(a3, b1));
+    c3_2 += POPCOUNT(BIT_SCALAR_AND(a3, b2));
+    c3_3 += POPCOUNT(BIT_SCALAR_AND(a3, b3));
+  }
+  results[0][0] = (int)c0_0;
+  results[0][1] = (int)c0_1;
+  results[0][2] = (int)c0_2;
+  results[0][3] = (int)c0_3;
+  results[1][0] = (int)c1_0;
+  results[1][1] = (int)c1_1;
+  results[1][2] = (int)c1_2;
+  results[1][3] = (int)c1_3;
+  results[2][0] = (int)c2_0;
+  results[2][1] = (int)c2_1;
+  results[2][2] = (int)c2_2;
+  results[2][3] = (int)c2_3;
+  results[3][0] = (int)c3_0;
+  results[3][1] = (int)c3_1;
+  results[3][2] = (int)c3_2;
+  results[3][3] = (int)c3_3;
+#else
+  setop_count_db_cpu_kernel_outer(4, 4, 1, a, b, k_b, k_max, results, _AND,
+                                  OMP_CPU_SIMD_ALIGN_BUFFER(ALIGNMENT, setop_buffer),
+                                  VECTOR_UNALIGNED_LOAD);
+#endif
+}
+
+static void gen_rows_and_4x4x1_unaligned(const uint64_t *const *a, int ni,
+    const uint64_t *const *b, int nj, size_t k_b, size_t k_max,
+    int *restrict counts, size_t ld) {
+  SETOP_BLOCK_TILES(_AND, VECTOR_UNALIGNED_LOAD, SETOP_INDIRECT_A, SETOP_INDIRECT_B, 4, 4,
+                    gen_block_and_4x4x1_unaligned(a_rows, b_rows, k_b, k_max, results))
+}
+
+/* or, 4x4 register block, 1 vector a step, aligned loads */
+static inline void gen_block_or_4x4x1_aligned(
+    const uint64_t *restrict const *a, const uint64_t *restrict const *b,
+    size_t k_b, size_t k_max, int results[4][4]) {
+#if BIT_GEN_VECTOR_BLOCKS
+  const size_t step = 1 * VECTOR_QWORDS;
+  CHUNK_LIMIT(limit, k_b, k_max, step)
+  VECTOR_TYPE s0_0 = SIMDe_ZERO_VECTOR;
+  VECTOR_TYPE s0_1 = SIMDe_ZERO_VECTOR;
+  VECTOR_TYPE s0_2 = SIMDe_ZERO_VECTOR;
+  VECTOR_TYPE s0_3 = SIMDe_ZERO_VECTOR;
+  VECTOR_TYPE s1_0 = SIMDe_ZERO_VECTOR;
+  VECTOR_TYPE s1_1 = SIMDe_ZERO_VECTOR;
+  VECTOR_TYPE s1_2 = SIMDe_ZERO_VECTOR;
+  VECTOR_TYPE s1_3 = SIMDe_ZERO_VECTOR;
+  VECTOR_TYPE s2_0 = SIMDe_ZERO_VECTOR;
+  VECTOR_TYPE s2_1 = SIMDe_ZERO_VECTOR;
+  VECTOR_TYPE s2_2 = SIMDe_ZERO_VECTOR;
+  VECTOR_TYPE s2_3 = SIMDe_ZERO_VECTOR;
+  VECTOR_TYPE s3_0 = SIMDe_ZERO_VECTOR;
+  VECTOR_TYPE s3_1 = SIMDe_ZERO_VECTOR;
+  VECTOR_TYPE s3_2 = SIMDe_ZERO_VECTOR;
+  VECTOR_TYPE s3_3 = SIMDe_ZERO_VECTOR;
+  size_t k = k_b;
+  for (; k < limit; k += step) {
+    {
+      const VECTOR_TYPE a0 = BIT_GEN_ALIGNED_LOAD((VECTOR_TYPE *)&a[0][k + VECTOR_OFFSET(0)]);
+      const VECTOR_TYPE a1 = BIT_GEN_ALIGNED_LOAD((VECTOR_TYPE *)&a[1][k + VECTOR_OFFSET(0)]);
+      const VECTOR_TYPE a2 = BIT_GEN_ALIGNED_LOAD((VECTOR_TYPE *)&a[2][k + VECTOR_OFFSET(0)]);
+      const VECTOR_TYPE a3 = BIT_GEN_ALIGNED_LOAD((VECTOR_TYPE *)&a[3][k + VECTOR_OFFSET(0)]);
+      const VECTOR_TYPE b0 = BIT_GEN_ALIGNED_LOAD((VECTOR_TYPE *)&b[0][k + VECTOR_OFFSET(0)]);
+      const VECTOR_TYPE b1 = BIT_GEN_ALIGNED_LOAD((VECTOR_TYPE *)&b[1][k + VECTOR_OFFSET(0)]);
+      const VECTOR_TYPE b2 = BIT_GEN_ALIGNED_LOAD((VECTOR_TYPE *)&b[2][k + VECTOR_OFFSET(0)]);
+      const VECTOR_TYPE b3 = BIT_GEN_ALIGNED_LOAD((VECTOR_TYPE *)&b[3][k + VECTOR_OFFSET(0)]);
+      s0_0 = SIMDe_VECTOR_ADD(s0_0, SIMDe_POPCOUNT(BIT_OR(a0, b0)));
+      s0_1 = SIMDe_VECTOR_ADD(s0_1, SIMDe_POPCOUNT(BIT_OR(a0, b1)));
+      s0_2 = SIMDe_VECTOR_ADD(s0_2, SIMDe_POPCOUNT(BIT_OR(a0, b2)));
+      s0_3 = SIMDe_VECTOR_ADD(s0_3, SIMDe_POPCOUNT(BIT_OR(a0, b3)));
+      s1_0 = SIMDe_VECTOR_ADD(s1_0, SIMDe_POPCOUNT(BIT_OR(a1, b0)));
+      s1_1 = SIMDe_VECTOR_ADD(s1_1, SIMDe_POPCOUNT(BIT_OR(a1, b1)));
+      s1_2 = SIMDe_VECTOR_ADD(s1_2, SIMDe_POPCOUNT(BIT_OR(a1, b2)));
+      s1_3 = SIMDe_VECTOR_ADD(s1_3, SIMDe_POPCOUNT(BIT_OR(a1, b3)));
+      s2_0 = SIMDe_VECTOR_ADD(s2_0, SIMDe_POPCOUNT(BIT_OR(a2, b0)));
+      s2_1 = SIMDe_VECTOR_ADD(s2_1, SIMDe_POPCOUNT(BIT_OR(a2, b1)));
+      s2_2 = SIMDe_VECTOR_ADD(s2_2, SIMDe_POPCOUNT(BIT_OR(a2, b2)));
+      s2_3 = SIMDe_VECTOR_ADD(s2_3, SIMDe_POPCOUNT(BIT_OR(a2, b3)));
+      s3_0 = SIMDe_VECTOR_ADD(s3_0, SIMDe_POPCOUNT(BIT_OR(a3, b0)));
+      s3_1 = SIMDe_VECTOR_ADD(s3_1, SIMDe_POPCOUNT(BIT_OR(a3, b1)));
+      s3_2 = SIMDe_VECTOR_ADD(s3_2, SIMDe_POPCOUNT(BIT_OR(a3, b2)));
+      s3_3 = SIMDe_VECTOR_ADD(s3_3, SIMDe_POPCOUNT(BIT_OR(a3, b3)));
+    }
+  }
+  uint64_t c0_0 = gen_lanes_sum(s0_0);
+  uint64_t c0_1 = gen_lanes_sum(s0_1);
+  uint64_t c0_2 = gen_lanes_sum(s0_2);
+  uint64_t c0_3 = gen_lanes_sum(s0_3);
+  uint64_t c1_0 = gen_lanes_sum(s1_0);
+  uint64_t c1_1 = gen_lanes_sum(s1_1);
+  uint64_t c1_2 = gen_lanes_sum(s1_2);
+  uint64_t c1_3 = gen_lanes_sum(s1_3);
+  uint64_t c2_0 = gen_lanes_sum(s2_0);
+  uint64_t c2_1 = gen_lanes_sum(s2_1);
+  uint64_t c2_2 = gen_lanes_sum(s2_2);
+  uint64_t c2_3 = gen_lanes_sum(s2_3);
+  uint64_t c3_0 = gen_lanes_sum(s3_0);
+  uint64_t c3_1 = gen_lanes_sum(s3_1);
+  uint64_t c3_2 = gen_lanes_sum(s3_2);
+  uint64_t c3_3 = gen_lanes_sum(s3_3);
+  for (; k < k_max; k++) {
+    const uint64_t a0 = a[0][k];
+    const uint64_t a1 = a[1][k];
+    const uint64_t a2 = a[2][k];
+    const uint64_t a3 = a[3][k];
+    const uint64_t b0 = b[0][k];
+    const uint64_t b1 = b[1][k];
+    const uint64_t b2 = b[2][k];
+    const uint64_t b3 = b[3][k];
+    c0_0 += POPCOUNT(BIT_SCALAR_OR(a0, b0));
+    c0_1 += POPCOUNT(BIT_SCALAR_OR(a0, b1));
+    c0_2 += POPCOUNT(BIT_SCALAR_OR(a0, b2));
+    c0_3 += POPCOUNT(BIT_SCALAR_OR(a0, b3));
+    c1_0 += POPCOUNT(BIT_SCALAR_OR(a1, b0));
+    c1_1 += POPCOUNT(BIT_SCALAR_OR(a1, b1));
+    c1_2 += POPCOUNT(BIT_SCALAR_OR(a1, b2));
+    c1_3 += POPCOUNT(BIT_SCALAR_OR(a1, b3));
+    c2_0 += POPCOUNT(BIT_SCALAR_OR(a2, b0));
+    c2_1 += POPCOUNT(BIT_SCALAR_OR(a2, b1));
+    c2_2 += POPCOUNT(BIT_SCALAR_OR(a2, b2));
+    c2_3 += POPCOUNT(BIT_SCALAR_OR(a2, b3));
+    c3_0 += POPCOUNT(BIT_SCALAR_OR(a3, b0));
+    c3_1 += POPCOUNT(BIT_SCALAR_OR(a3, b1));
+    c3_2 += POPCOUNT(BIT_SCALAR_OR(a3, b2));
+    c3_3 += POPCOUNT(BIT_SCALAR_OR(a3, b3));
+  }
+  results[0][0] = (int)c0_0;
+  results[0][1] = (int)c0_1;
+  results[0][2] = (int)c0_2;
+  results[0][3] = (int)c0_3;
+  results[1][0] = (int)c1_0;
+  results[1][1] = (int)c1_1;
+  results[1][2] = (int)c1_2;
+  results[1][3] = (int)c1_3;
+  results[2][0] = (int)c2_0;
+  results[2][1] = (int)c2_1;
+  results[2][2] = (int)c2_2;
+  results[2][3] = (int)c2_3;
+  results[3][0] = (int)c3_0;
+  results[3][1] = (int)c3_1;
+  results[3][2] = (int)c3_2;
+  results[3][3] = (int)c3_3;
+#else
+  setop_count_db_cpu_kernel_outer(4, 4, 1, a, b, k_b, k_max, results, _OR,
+                                  OMP_CPU_SIMD_ALIGN_BUFFER(ALIGNMENT, setop_buffer),
+                                  BIT_GEN_ALIGNED_LOAD);
+#endif
+}
+
+static void gen_rows_or_4x4x1_aligned(const uint64_t *const *a, int ni,
+    const uint64_t *const *b, int nj, size_t k_b, size_t k_max,
+    int *restrict counts, size_t ld) {
+  SETOP_BLOCK_TILES(_OR, BIT_GEN_ALIGNED_LOAD, SETOP_INDIRECT_A, SETOP_INDIRECT_B, 4, 4,
+                    gen_block_or_4x4x1_aligned(a_rows, b_rows, k_b, k_max, results))
+}
+
+/* or, 4x4 register block, 1 vector a step, unaligned loads */
+static inline void gen_block_or_4x4x1_unaligned(
+    const uint64_t *restrict const *a, const uint64_t *restrict const *b,
+    size_t k_b, size_t k_max, int results[4][4]) {
+#if BIT_GEN_VECTOR_BLOCKS
+  const size_t step = 1 * VECTOR_QWORDS;
+  CHUNK_LIMIT(limit, k_b, k_max, step)
+  VECTOR_TYPE s0_0 = SIMDe_ZERO_VECTOR;
+  VECTOR_TYPE s0_1 = SIMDe_ZERO_VECTOR;
+  VECTOR_TYPE s0_2 = SIMDe_ZERO_VECTOR;
+  VECTOR_TYPE s0_3 = SIMDe_ZERO_VECTOR;
+  VECTOR_TYPE s1_0 = SIMDe_ZERO_VECTOR;
+  VECTOR_TYPE s1_1 = SIMDe_ZERO_VECTOR;
+  VECTOR_TYPE s1_2 = SIMDe_ZERO_VECTOR;
+  VECTOR_TYPE s1_3 = SIMDe_ZERO_VECTOR;
+  VECTOR_TYPE s2_0 = SIMDe_ZERO_VECTOR;
+  VECTOR_TYPE s2_1 = SIMDe_ZERO_VECTOR;
+  VECTOR_TYPE s2_2 = SIMDe_ZERO_VECTOR;
+  VECTOR_TYPE s2_3 = SIMDe_ZERO_VECTOR;
+  VECTOR_TYPE s3_0 = SIMDe_ZERO_VECTOR;
+  VECTOR_TYPE s3_1 = SIMDe_ZERO_VECTOR;
+  VECTOR_TYPE s3_2 = SIMDe_ZERO_VECTOR;
+  VECTOR_TYPE s3_3 = SIMDe_ZERO_VECTOR;
+  size_t k = k_b;
+  for (; k < limit; k += step) {
+    {
+      const VECTOR_TYPE a0 = VECTOR_UNALIGNED_LOAD((VECTOR_TYPE *)&a[0][k + VECTOR_OFFSET(0)]);
+      const VECTOR_TYPE a1 = VECTOR_UNALIGNED_LOAD((VECTOR_TYPE *)&a[1][k + VECTOR_OFFSET(0)]);
+      const VECTOR_TYPE a2 = VECTOR_UNALIGNED_LOAD((VECTOR_TYPE *)&a[2][k + VECTOR_OFFSET(0)]);
+      const VECTOR_TYPE a3 = VECTOR_UNALIGNED_LOAD((VECTOR_TYPE *)&a[3][k + VECTOR_OFFSET(0)]);
+      const VECTOR_TYPE b0 = VECTOR_UNALIGNED_LOAD((VECTOR_TYPE *)&b[0][k + VECTOR_OFFSET(0)]);
+      const VECTOR_TYPE b1 = VECTOR_UNALIGNED_LOAD((VECTOR_TYPE *)&b[1][k + VECTOR_OFFSET(0)]);
+      const VECTOR_TYPE b2 = VECTOR_UNALIGNED_LOAD((VECTOR_TYPE *)&b[2][k + VECTOR_OFFSET(0)]);
+      const VECTOR_TYPE b3 = VECTOR_UNALIGNED_LOAD((VECTOR_TYPE *)&b[3][k + VECTOR_OFFSET(0)]);
+      s0_0 = SIMDe_VECTOR_ADD(s0_0, SIMDe_POPCOUNT(BIT_OR(a0, b0)));
+      s0_1 = SIMDe_VECTOR_ADD(s0_1, SIMDe_POPCOUNT(BIT_OR(a0, b1)));
+      s0_2 = SIMDe_VECTOR_ADD(s0_2, SIMDe_POPCOUNT(BIT_OR(a0, b2)));
+      s0_3 = SIMDe_VECTOR_ADD(s0_3, SIMDe_POPCOUNT(BIT_OR(a0, b3)));
+      s1_0 = SIMDe_VECTOR_ADD(s1_0, SIMDe_POPCOUNT(BIT_OR(a1, b0)));
+      s1_1 = SIMDe_VECTOR_ADD(s1_1, SIMDe_POPCOUNT(BIT_OR(a1, b1)));
+      s1_2 = SIMDe_VECTOR_ADD(s1_2, SIMDe_POPCOUNT(BIT_OR(a1, b2)));
+      s1_3 = SIMDe_VECTOR_ADD(s1_3, SIMDe_POPCOUNT(BIT_OR(a1, b3)));
+      s2_0 = SIMDe_VECTOR_ADD(s2_0, SIMDe_POPCOUNT(BIT_OR(a2, b0)));
+      s2_1 = SIMDe_VECTOR_ADD(s2_1, SIMDe_POPCOUNT(BIT_OR(a2, b1)));
+      s2_2 = SIMDe_VECTOR_ADD(s2_2, SIMDe_POPCOUNT(BIT_OR(a2, b2)));
+      s2_3 = SIMDe_VECTOR_ADD(s2_3, SIMDe_POPCOUNT(BIT_OR(a2, b3)));
+      s3_0 = SIMDe_VECTOR_ADD(s3_0, SIMDe_POPCOUNT(BIT_OR(a3, b0)));
+      s3_1 = SIMDe_VECTOR_ADD(s3_1, SIMDe_POPCOUNT(BIT_OR(a3, b1)));
+      s3_2 = SIMDe_VECTOR_ADD(s3_2, SIMDe_POPCOUNT(BIT_OR(a3, b2)));
+      s3_3 = SIMDe_VECTOR_ADD(s3_3, SIMDe_POPCOUNT(BIT_OR(a3, b3)));
+    }
+  }
+  uint64_t c0_0 = gen_lanes_sum(s0_0);
+  uint64_t c0_1 = gen_lanes_sum(s0_1);
+  uint64_t c0_2 = gen_lanes_sum(s0_2);
+  uint64_t c0_3 = gen_lanes_sum(s0_3);
+  uint64_t c1_0 = gen_lanes_sum(s1_0);
+  uint64_t c1_1 = gen_lanes_sum(s1_1);
+  uint64_t c1_2 = gen_lanes_sum(s1_2);
+  uint64_t c1_3 = gen_lanes_sum(s1_3);
+  uint64_t c2_0 = gen_lanes_sum(s2_0);
+  uint64_t c2_1 = gen_lanes_sum(s2_1);
+  uint64_t c2_2 = gen_lanes_sum(s2_2);
+  uint64_t c2_3 = gen_lanes_sum(s2_3);
+  uint64_t c3_0 = gen_lanes_sum(s3_0);
+  uint64_t c3_1 = gen_lanes_sum(s3_1);
+  uint64_t c3_2 = gen_lanes_sum(s3_2);
+  uint64_t c3_3 = gen_lanes_sum(s3_3);
+  for (; k < k_max; k++) {
+    const uint64_t a0 = a[0][k];
+    const uint64_t a1 = a[1][k];
+    const uint64_t a2 = a[2][k];
+    const uint64_t a3 = a[3][k];
+    const uint64_t b0 = b[0][k];
+    const uint64_t b1 = b[1][k];
+    const uint64_t b2 = b[2][k];
+    const uint64_t b3 = b[3][k];
+    c0_0 += POPCOUNT(BIT_SCALAR_OR(a0, b0));
+    c0_1 += POPCOUNT(BIT_SCALAR_OR(a0, b1));
+    c0_2 += POPCOUNT(BIT_SCALAR_OR(a0, b2));
+    c0_3 += POPCOUNT(BIT_SCALAR_OR(a0, b3));
+    c1_0 += POPCOUNT(BIT_SCALAR_OR(a1, b0));
+    c1_1 += POPCOUNT(BIT_SCALAR_OR(a1, b1));
+    c1_2 += POPCOUNT(BIT_SCALAR_OR(a1, b2));
+    c1_3 += POPCOUNT(BIT_SCALAR_OR(a1, b3));
+    c2_0 += POPCOUNT(BIT_SCALAR_OR(a2, b0));
+    c2_1 += POPCOUNT(BIT_SCALAR_OR(a2, b1));
+    c2_2 += POPCOUNT(BIT_SCALAR_OR(a2, b2));
+    c2_3 += POPCOUNT(BIT_SCALAR_OR(a2, b3));
+    c3_0 += POPCOUNT(BIT_SCALAR_OR(a3, b0));
+    c3_1 += POPCOUNT(BIT_SCALAR_OR(a3, b1));
+    c3_2 += POPCOUNT(BIT_SCALAR_OR(a3, b2));
+    c3_3 += POPCOUNT(BIT_SCALAR_OR(a3, b3));
+  }
+  results[0][0] = (int)c0_0;
+  results[0][1] = (int)c0_1;
+  results[0][2] = (int)c0_2;
+  results[0][3] = (int)c0_3;
+  results[1][0] = (int)c1_0;
+  results[1][1] = (int)c1_1;
+  results[1][2] = (int)c1_2;
+  results[1][3] = (int)c1_3;
+  results[2][0] = (int)c2_0;
+  results[2][1] = (int)c2_1;
+  results[2][2] = (int)c2_2;
+  results[2][3] = (int)c2_3;
+  results[3][0] = (int)c3_0;
+  results[3][1] = (int)c3_1;
+  results[3][2] = (int)c3_2;
+  results[3][3] = (int)c3_3;
+#else
+  setop_count_db_cpu_kernel_outer(4, 4, 1, a, b, k_b, k_max, results, _OR,
+                                  OMP_CPU_SIMD_ALIGN_BUFFER(ALIGNMENT, setop_buffer),
+                                  VECTOR_UNALIGNED_LOAD);
+#endif
+}
+
+static void gen_rows_or_4x4x1_unaligned(const uint64_t *const *a, int ni,
+    const uint64_t *const *b, int nj, size_t k_b, size_t k_max,
+    int *restrict counts, size_t ld) {
+  SETOP_BLOCK_TILES(_OR, VECTOR_UNALIGNED_LOAD, SETOP_INDIRECT_A, SETOP_INDIRECT_B, 4, 4,
+                    gen_block_or_4x4x1_unaligned(a_rows, b_rows, k_b, k_max, results))
+}
+
+/* xor, 4x4 register block, 1 vector a step, aligned loads */
+static inline void gen_block_xor_4x4x1_aligned(
+    const uint64_t *restrict const *a, const uint64_t *restrict const *b,
+    size_t k_b, size_t k_max, int results[4][4]) {
+#if BIT_GEN_VECTOR_BLOCKS
+  const size_t step = 1 * VECTOR_QWORDS;
+  CHUNK_LIMIT(limit, k_b, k_max, step)
+  VECTOR_TYPE s0_0 = SIMDe_ZERO_VECTOR;
+  VECTOR_TYPE s0_1 = SIMDe_ZERO_VECTOR;
+  VECTOR_TYPE s0_2 = SIMDe_ZERO_VECTOR;
+  VECTOR_TYPE s0_3 = SIMDe_ZERO_VECTOR;
+  VECTOR_TYPE s1_0 = SIMDe_ZERO_VECTOR;
+  VECTOR_TYPE s1_1 = SIMDe_ZERO_VECTOR;
+  VECTOR_TYPE s1_2 = SIMDe_ZERO_VECTOR;
+  VECTOR_TYPE s1_3 = SIMDe_ZERO_VECTOR;
+  VECTOR_TYPE s2_0 = SIMDe_ZERO_VECTOR;
+  VECTOR_TYPE s2_1 = SIMDe_ZERO_VECTOR;
+  VECTOR_TYPE s2_2 = SIMDe_ZERO_VECTOR;
+  VECTOR_TYPE s2_3 = SIMDe_ZERO_VECTOR;
+  VECTOR_TYPE s3_0 = SIMDe_ZERO_VECTOR;
+  VECTOR_TYPE s3_1 = SIMDe_ZERO_VECTOR;
+  VECTOR_TYPE s3_2 = SIMDe_ZERO_VECTOR;
+  VECTOR_TYPE s3_3 = SIMDe_ZERO_VECTOR;
+  size_t k = k_b;
+  for (; k < limit; k += step) {
+    {
+      const VECTOR_TYPE a0 = BIT_GEN_ALIGNED_LOAD((VECTOR_TYPE *)&a[0][k + VECTOR_OFFSET(0)]);
+      const VECTOR_TYPE a1 = BIT_GEN_ALIGNED_LOAD((VECTOR_TYPE *)&a[1][k + VECTOR_OFFSET(0)]);
+      const VECTOR_TYPE a2 = BIT_GEN_ALIGNED_LOAD((VECTOR_TYPE *)&a[2][k + VECTOR_OFFSET(0)]);
+      const VECTOR_TYPE a3 = BIT_GEN_ALIGNED_LOAD((VECTOR_TYPE *)&a[3][k + VECTOR_OFFSET(0)]);
+      const VECTOR_TYPE b0 = BIT_GEN_ALIGNED_LOAD((VECTOR_TYPE *)&b[0][k + VECTOR_OFFSET(0)]);
+      const VECTOR_TYPE b1 = BIT_GEN_ALIGNED_LOAD((VECTOR_TYPE *)&b[1][k + VECTOR_OFFSET(0)]);
+      const VECTOR_TYPE b2 = BIT_GEN_ALIGNED_LOAD((VECTOR_TYPE *)&b[2][k + VECTOR_OFFSET(0)]);
+      const VECTOR_TYPE b3 = BIT_GEN_ALIGNED_LOAD((VECTOR_TYPE *)&b[3][k + VECTOR_OFFSET(0)]);
+      s0_0 = SIMDe_VECTOR_ADD(s0_0, SIMDe_POPCOUNT(BIT_XOR(a0, b0)));
+      s0_1 = SIMDe_VECTOR_ADD(s0_1, SIMDe_POPCOUNT(BIT_XOR(a0, b1)));
+      s0_2 = SIMDe_VECTOR_ADD(s0_2, SIMDe_POPCOUNT(BIT_XOR(a0, b2)));
+      s0_3 = SIMDe_VECTOR_ADD(s0_3, SIMDe_POPCOUNT(BIT_XOR(a0, b3)));
+      s1_0 = SIMDe_VECTOR_ADD(s1_0, SIMDe_POPCOUNT(BIT_XOR(a1, b0)));
+      s1_1 = SIMDe_VECTOR_ADD(s1_1, SIMDe_POPCOUNT(BIT_XOR(a1, b1)));
+      s1_2 = SIMDe_VECTOR_ADD(s1_2, SIMDe_POPCOUNT(BIT_XOR(a1, b2)));
+      s1_3 = SIMDe_VECTOR_ADD(s1_3, SIMDe_POPCOUNT(BIT_XOR(a1, b3)));
+      s2_0 = SIMDe_VECTOR_ADD(s2_0, SIMDe_POPCOUNT(BIT_XOR(a2, b0)));
+      s2_1 = SIMDe_VECTOR_ADD(s2_1, SIMDe_POPCOUNT(BIT_XOR(a2, b1)));
+      s2_2 = SIMDe_VECTOR_ADD(s2_2, SIMDe_POPCOUNT(BIT_XOR(a2, b2)));
+      s2_3 = SIMDe_VECTOR_ADD(s2_3, SIMDe_POPCOUNT(BIT_XOR(a2, b3)));
+      s3_0 = SIMDe_VECTOR_ADD(s3_0, SIMDe_POPCOUNT(BIT_XOR(a3, b0)));
+      s3_1 = SIMDe_VECTOR_ADD(s3_1, SIMDe_POPCOUNT(BIT_XOR(a3, b1)));
+      s3_2 = SIMDe_VECTOR_ADD(s3_2, SIMDe_POPCOUNT(BIT_XOR(a3, b2)));
+      s3_3 = SIMDe_VECTOR_ADD(s3_3, SIMDe_POPCOUNT(BIT_XOR(a3, b3)));
+    }
+  }
+  uint64_t c0_0 = gen_lanes_sum(s0_0);
+  uint64_t c0_1 = gen_lanes_sum(s0_1);
+  uint64_t c0_2 = gen_lanes_sum(s0_2);
+  uint64_t c0_3 = gen_lanes_sum(s0_3);
+  uint64_t c1_0 = gen_lanes_sum(s1_0);
+  uint64_t c1_1 = gen_lanes_sum(s1_1);
+  uint64_t c1_2 = gen_lanes_sum(s1_2);
+  uint64_t c1_3 = gen_lanes_sum(s1_3);
+  uint64_t c2_0 = gen_lanes_sum(s2_0);
+  uint64_t c2_1 = gen_lanes_sum(s2_1);
+  uint64_t c2_2 = gen_lanes_sum(s2_2);
+  uint64_t c2_3 = gen_lanes_sum(s2_3);
+  uint64_t c3_0 = gen_lanes_sum(s3_0);
+  uint64_t c3_1 = gen_lanes_sum(s3_1);
+  uint64_t c3_2 = gen_lanes_sum(s3_2);
+  uint64_t c3_3 = gen_lanes_sum(s3_3);
+  for (; k < k_max; k++) {
+    const uint64_t a0 = a[0][k];
+    const uint64_t a1 = a[1][k];
+    const uint64_t a2 = a[2][k];
+    const uint64_t a3 = a[3][k];
+    const uint64_t b0 = b[0][k];
+    const uint64_t b1 = b[1][k];
+    const uint64_t b2 = b[2][k];
+    const uint64_t b3 = b[3][k];
+    c0_0 += POPCOUNT(BIT_SCALAR_XOR(a0, b0));
+    c0_1 += POPCOUNT(BIT_SCALAR_XOR(a0, b1));
+    c0_2 += POPCOUNT(BIT_SCALAR_XOR(a0, b2));
+    c0_3 += POPCOUNT(BIT_SCALAR_XOR(a0, b3));
+    c1_0 += POPCOUNT(BIT_SCALAR_XOR(a1, b0));
+    c1_1 += POPCOUNT(BIT_SCALAR_XOR(a1, b1));
+    c1_2 += POPCOUNT(BIT_SCALAR_XOR(a1, b2));
+    c1_3 += POPCOUNT(BIT_SCALAR_XOR(a1, b3));
+    c2_0 += POPCOUNT(BIT_SCALAR_XOR(a2, b0));
+    c2_1 += POPCOUNT(BIT_SCALAR_XOR(a2, b1));
+    c2_2 += POPCOUNT(BIT_SCALAR_XOR(a2, b2));
+    c2_3 += POPCOUNT(BIT_SCALAR_XOR(a2, b3));
+    c3_0 += POPCOUNT(BIT_SCALAR_XOR(a3, b0));
+    c3_1 += POPCOUNT(BIT_SCALAR_XOR(a3, b1));
+    c3_2 += POPCOUNT(BIT_SCALAR_XOR(a3, b2));
+    c3_3 += POPCOUNT(BIT_SCALAR_XOR(a3, b3));
+  }
+  results[0][0] = (int)c0_0;
+  results[0][1] = (int)c0_1;
+  results[0][2] = (int)c0_2;
+  results[0][3] = (int)c0_3;
+  results[1][0] = (int)c1_0;
+  results[1][1] = (int)c1_1;
+  results[1][2] = (int)c1_2;
+  results[1][3] = (int)c1_3;
+  results[2][0] = (int)c2_0;
+  results[2][1] = (int)c2_1;
+  results[2][2] = (int)c2_2;
+  results[2][3] = (int)c2_3;
+  results[3][0] = (int)c3_0;
+  results[3][1] = (int)c3_1;
+  results[3][2] = (int)c3_2;
+  results[3][3] = (int)c3_3;
+#else
+  setop_count_db_cpu_kernel_outer(4, 4, 1, a, b, k_b, k_max, results, _XOR,
+                                  OMP_CPU_SIMD_ALIGN_BUFFER(ALIGNMENT, setop_buffer),
+                                  BIT_GEN_ALIGNED_LOAD);
+#endif
+}
+
+static void gen_rows_xor_4x4x1_aligned(const uint64_t *const *a, int ni,
+    const uint64_t *const *b, int nj, size_t k_b, size_t k_max,
+    int *restrict counts, size_t ld) {
+  SETOP_BLOCK_TILES(_XOR, BIT_GEN_ALIGNED_LOAD, SETOP_INDIRECT_A, SETOP_INDIRECT_B, 4, 4,
+                    gen_block_xor_4x4x1_aligned(a_rows, b_rows, k_b, k_max, results))
+}
+
+/* xor, 4x4 register block, 1 vector a step, unaligned loads */
+static inline void gen_block_xor_4x4x1_unaligned(
+    const uint64_t *restrict const *a, const uint64_t *restrict const *b,
+    size_t k_b, size_t k_max, int results[4][4]) {
+#if BIT_GEN_VECTOR_BLOCKS
+  const size_t step = 1 * VECTOR_QWORDS;
+  CHUNK_LIMIT(limit, k_b, k_max, step)
+  VECTOR_TYPE s0_0 = SIMDe_ZERO_VECTOR;
+  VECTOR_TYPE s0_1 = SIMDe_ZERO_VECTOR;
+  VECTOR_TYPE s0_2 = SIMDe_ZERO_VECTOR;
+  VECTOR_TYPE s0_3 = SIMDe_ZERO_VECTOR;
+  VECTOR_TYPE s1_0 = SIMDe_ZERO_VECTOR;
+  VECTOR_TYPE s1_1 = SIMDe_ZERO_VECTOR;
+  VECTOR_TYPE s1_2 = SIMDe_ZERO_VECTOR;
+  VECTOR_TYPE s1_3 = SIMDe_ZERO_VECTOR;
+  VECTOR_TYPE s2_0 = SIMDe_ZERO_VECTOR;
+  VECTOR_TYPE s2_1 = SIMDe_ZERO_VECTOR;
+  VECTOR_TYPE s2_2 = SIMDe_ZERO_VECTOR;
+  VECTOR_TYPE s2_3 = SIMDe_ZERO_VECTOR;
+  VECTOR_TYPE s3_0 = SIMDe_ZERO_VECTOR;
+  VECTOR_TYPE s3_1 = SIMDe_ZERO_VECTOR;
+  VECTOR_TYPE s3_2 = SIMDe_ZERO_VECTOR;
+  VECTOR_TYPE s3_3 = SIMDe_ZERO_VECTOR;
+  size_t k = k_b;
+  for (; k < limit; k += step) {
+    {
+      const VECTOR_TYPE a0 = VECTOR_UNALIGNED_LOAD((VECTOR_TYPE *)&a[0][k + VECTOR_OFFSET(0)]);
+      const VECTOR_TYPE a1 = VECTOR_UNALIGNED_LOAD((VECTOR_TYPE *)&a[1][k + VECTOR_OFFSET(0)]);
+      const VECTOR_TYPE a2 = VECTOR_UNALIGNED_LOAD((VECTOR_TYPE *)&a[2][k + VECTOR_OFFSET(0)]);
+      const VECTOR_TYPE a3 = VECTOR_UNALIGNED_LOAD((VECTOR_TYPE *)&a[3][k + VECTOR_OFFSET(0)]);
+      const VECTOR_TYPE b0 = VECTOR_UNALIGNED_LOAD((VECTOR_TYPE *)&b[0][k + VECTOR_OFFSET(0)]);
+      const VECTOR_TYPE b1 = VECTOR_UNALIGNED_LOAD((VECTOR_TYPE *)&b[1][k + VECTOR_OFFSET(0)]);
+      const VECTOR_TYPE b2 = VECTOR_UNALIGNED_LOAD((VECTOR_TYPE *)&b[2][k + VECTOR_OFFSET(0)]);
+      const VECTOR_TYPE b3 = VECTOR_UNALIGNED_LOAD((VECTOR_TYPE *)&b[3][k + VECTOR_OFFSET(0)]);
+      s0_0 = SIMDe_VECTOR_ADD(s0_0, SIMDe_POPCOUNT(BIT_XOR(a0, b0)));
+      s0_1 = SIMDe_VECTOR_ADD(s0_1, SIMDe_POPCOUNT(BIT_XOR(a0, b1)));
+      s0_2 = SIMDe_VECTOR_ADD(s0_2, SIMDe_POPCOUNT(BIT_XOR(a0, b2)));
+      s0_3 = SIMDe_VECTOR_ADD(s0_3, SIMDe_POPCOUNT(BIT_XOR(a0, b3)));
+      s1_0 = SIMDe_VECTOR_ADD(s1_0, SIMDe_POPCOUNT(BIT_XOR(a1, b0)));
+      s1_1 = SIMDe_VECTOR_ADD(s1_1, SIMDe_POPCOUNT(BIT_XOR(a1, b1)));
+      s1_2 = SIMDe_VECTOR_ADD(s1_2, SIMDe_POPCOUNT(BIT_XOR(a1, b2)));
+      s1_3 = SIMDe_VECTOR_ADD(s1_3, SIMDe_POPCOUNT(BIT_XOR(a1, b3)));
+      s2_0 = SIMDe_VECTOR_ADD(s2_0, SIMDe_POPCOUNT(BIT_XOR(a2, b0)));
+      s2_1 = SIMDe_VECTOR_ADD(s2_1, SIMDe_POPCOUNT(BIT_XOR(a2, b1)));
+      s2_2 = SIMDe_VECTOR_ADD(s2_2, SIMDe_POPCOUNT(BIT_XOR(a2, b2)));
+      s2_3 = SIMDe_VECTOR_ADD(s2_3, SIMDe_POPCOUNT(BIT_XOR(a2, b3)));
+      s3_0 = SIMDe_VECTOR_ADD(s3_0, SIMDe_POPCOUNT(BIT_XOR(a3, b0)));
+      s3_1 = SIMDe_VECTOR_ADD(s3_1, SIMDe_POPCOUNT(BIT_XOR(a3, b1)));
+      s3_2 = SIMDe_VECTOR_ADD(s3_2, SIMDe_POPCOUNT(BIT_XOR(a3, b2)));
+      s3_3 = SIMDe_VECTOR_ADD(s3_3, SIMDe_POPCOUNT(BIT_XOR(a3, b3)));
+    }
+  }
+  uint64_t c0_0 = gen_lanes_sum(s0_0);
+  uint64_t c0_1 = gen_lanes_sum(s0_1);
+  uint64_t c0_2 = gen_lanes_sum(s0_2);
+  uint64_t c0_3 = gen_lanes_sum(s0_3);
+  uint64_t c1_0 = gen_lanes_sum(s1_0);
+  uint64_t c1_1 = gen_lanes_sum(s1_1);
+  uint64_t c1_2 = gen_lanes_sum(s1_2);
+  uint64_t c1_3 = gen_lanes_sum(s1_3);
+  uint64_t c2_0 = gen_lanes_sum(s2_0);
+  uint64_t c2_1 = gen_lanes_sum(s2_1);
+  uint64_t c2_2 = gen_lanes_sum(s2_2);
+  uint64_t c2_3 = gen_lanes_sum(s2_3);
+  uint64_t c3_0 = gen_lanes_sum(s3_0);
+  uint64_t c3_1 = gen_lanes_sum(s3_1);
+  uint64_t c3_2 = gen_lanes_sum(s3_2);
+  uint64_t c3_3 = gen_lanes_sum(s3_3);
+  for (; k < k_max; k++) {
+    const uint64_t a0 = a[0][k];
+    const uint64_t a1 = a[1][k];
+    const uint64_t a2 = a[2][k];
+    const uint64_t a3 = a[3][k];
+    const uint64_t b0 = b[0][k];
+    const uint64_t b1 = b[1][k];
+    const uint64_t b2 = b[2][k];
+    const uint64_t b3 = b[3][k];
+    c0_0 += POPCOUNT(BIT_SCALAR_XOR(a0, b0));
+    c0_1 += POPCOUNT(BIT_SCALAR_XOR(a0, b1));
+    c0_2 += POPCOUNT(BIT_SCALAR_XOR(a0, b2));
+    c0_3 += POPCOUNT(BIT_SCALAR_XOR(a0, b3));
+    c1_0 += POPCOUNT(BIT_SCALAR_XOR(a1, b0));
+    c1_1 += POPCOUNT(BIT_SCALAR_XOR(a1, b1));
+    c1_2 += POPCOUNT(BIT_SCALAR_XOR(a1, b2));
+    c1_3 += POPCOUNT(BIT_SCALAR_XOR(a1, b3));
+    c2_0 += POPCOUNT(BIT_SCALAR_XOR(a2, b0));
+    c2_1 += POPCOUNT(BIT_SCALAR_XOR(a2, b1));
+    c2_2 += POPCOUNT(BIT_SCALAR_XOR(a2, b2));
+    c2_3 += POPCOUNT(BIT_SCALAR_XOR(a2, b3));
+    c3_0 += POPCOUNT(BIT_SCALAR_XOR(a3, b0));
+    c3_1 += POPCOUNT(BIT_SCALAR_XOR(a3, b1));
+    c3_2 += POPCOUNT(BIT_SCALAR_XOR(a3, b2));
+    c3_3 += POPCOUNT(BIT_SCALAR_XOR(a3, b3));
+  }
+  results[0][0] = (int)c0_0;
+  results[0][1] = (int)c0_1;
+  results[0][2] = (int)c0_2;
+  results[0][3] = (int)c0_3;
+  results[1][0] = (int)c1_0;
+  results[1][1] = (int)c1_1;
+  results[1][2] = (int)c1_2;
+  results[1][3] = (int)c1_3;
+  results[2][0] = (int)c2_0;
+  results[2][1] = (int)c2_1;
+  results[2][2] = (int)c2_2;
+  results[2][3] = (int)c2_3;
+  results[3][0] = (int)c3_0;
+  results[3][1] = (int)c3_1;
+  results[3][2] = (int)c3_2;
+  results[3][3] = (int)c3_3;
+#else
+  setop_count_db_cpu_kernel_outer(4, 4, 1, a, b, k_b, k_max, results, _XOR,
+                                  OMP_CPU_SIMD_ALIGN_BUFFER(ALIGNMENT, setop_buffer),
+                                  VECTOR_UNALIGNED_LOAD);
+#endif
+}
+
+static void gen_rows_xor_4x4x1_unaligned(const uint64_t *const *a, int ni,
+    const uint64_t *const *b, int nj, size_t k_b, size_t k_max,
+    int *restrict counts, size_t ld) {
+  SETOP_BLOCK_TILES(_XOR, VECTOR_UNALIGNED_LOAD, SETOP_INDIRECT_A, SETOP_INDIRECT_B, 4, 4,
+                    gen_block_xor_4x4x1_unaligned(a_rows, b_rows, k_b, k_max, results))
+}
+
+/* and_not, 4x4 register block, 1 vector a step, aligned loads */
+static inline void gen_block_and_not_4x4x1_aligned(
+    const uint64_t *restrict const *a, const uint64_t *restrict const *b,
+    size_t k_b, size_t k_max, int results[4][4]) {
+#if BIT_GEN_VECTOR_BLOCKS
+  const size_t step = 1 * VECTOR_QWORDS;
+  CHUNK_LIMIT(limit, k_b, k_max, step)
+  VECTOR_TYPE s0_0 = SIMDe_ZERO_VECTOR;
+  VECTOR_TYPE s0_1 = SIMDe_ZERO_VECTOR;
+  VECTOR_TYPE s0_2 = SIMDe_ZERO_VECTOR;
+  VECTOR_TYPE s0_3 = SIMDe_ZERO_VECTOR;
+  VECTOR_TYPE s1_0 = SIMDe_ZERO_VECTOR;
+  VECTOR_TYPE s1_1 = SIMDe_ZERO_VECTOR;
+  VECTOR_TYPE s1_2 = SIMDe_ZERO_VECTOR;
+  VECTOR_TYPE s1_3 = SIMDe_ZERO_VECTOR;
+  VECTOR_TYPE s2_0 = SIMDe_ZERO_VECTOR;
+  VECTOR_TYPE s2_1 = SIMDe_ZERO_VECTOR;
+  VECTOR_TYPE s2_2 = SIMDe_ZERO_VECTOR;
+  VECTOR_TYPE s2_3 = SIMDe_ZERO_VECTOR;
+  VECTOR_TYPE s3_0 = SIMDe_ZERO_VECTOR;
+  VECTOR_TYPE s3_1 = SIMDe_ZERO_VECTOR;
+  VECTOR_TYPE s3_2 = SIMDe_ZERO_VECTOR;
+  VECTOR_TYPE s3_3 = SIMDe_ZERO_VECTOR;
+  size_t k = k_b;
+  for (; k < limit; k += step) {
+    {
+      const VECTOR_TYPE a0 = BIT_GEN_ALIGNED_LOAD((VECTOR_TYPE *)&a[0][k + VECTOR_OFFSET(0)]);
+      const VECTOR_TYPE a1 = BIT_GEN_ALIGNED_LOAD((VECTOR_TYPE *)&a[1][k + VECTOR_OFFSET(0)]);
+      const VECTOR_TYPE a2 = BIT_GEN_ALIGNED_LOAD((VECTOR_TYPE *)&a[2][k + VECTOR_OFFSET(0)]);
+      const VECTOR_TYPE a3 = BIT_GEN_ALIGNED_LOAD((VECTOR_TYPE *)&a[3][k + VECTOR_OFFSET(0)]);
+      const VECTOR_TYPE b0 = BIT_GEN_ALIGNED_LOAD((VECTOR_TYPE *)&b[0][k + VECTOR_OFFSET(0)]);
+      const VECTOR_TYPE b1 = BIT_GEN_ALIGNED_LOAD((VECTOR_TYPE *)&b[1][k + VECTOR_OFFSET(0)]);
+      const VECTOR_TYPE b2 = BIT_GEN_ALIGNED_LOAD((VECTOR_TYPE *)&b[2][k + VECTOR_OFFSET(0)]);
+      const VECTOR_TYPE b3 = BIT_GEN_ALIGNED_LOAD((VECTOR_TYPE *)&b[3][k + VECTOR_OFFSET(0)]);
+      s0_0 = SIMDe_VECTOR_ADD(s0_0, SIMDe_POPCOUNT(BIT_AND_NOT(a0, b0)));
+      s0_1 = SIMDe_VECTOR_ADD(s0_1, SIMDe_POPCOUNT(BIT_AND_NOT(a0, b1)));
+      s0_2 = SIMDe_VECTOR_ADD(s0_2, SIMDe_POPCOUNT(BIT_AND_NOT(a0, b2)));
+      s0_3 = SIMDe_VECTOR_ADD(s0_3, SIMDe_POPCOUNT(BIT_AND_NOT(a0, b3)));
+      s1_0 = SIMDe_VECTOR_ADD(s1_0, SIMDe_POPCOUNT(BIT_AND_NOT(a1, b0)));
+      s1_1 = SIMDe_VECTOR_ADD(s1_1, SIMDe_POPCOUNT(BIT_AND_NOT(a1, b1)));
+      s1_2 = SIMDe_VECTOR_ADD(s1_2, SIMDe_POPCOUNT(BIT_AND_NOT(a1, b2)));
+      s1_3 = SIMDe_VECTOR_ADD(s1_3, SIMDe_POPCOUNT(BIT_AND_NOT(a1, b3)));
+      s2_0 = SIMDe_VECTOR_ADD(s2_0, SIMDe_POPCOUNT(BIT_AND_NOT(a2, b0)));
+      s2_1 = SIMDe_VECTOR_ADD(s2_1, SIMDe_POPCOUNT(BIT_AND_NOT(a2, b1)));
+      s2_2 = SIMDe_VECTOR_ADD(s2_2, SIMDe_POPCOUNT(BIT_AND_NOT(a2, b2)));
+      s2_3 = SIMDe_VECTOR_ADD(s2_3, SIMDe_POPCOUNT(BIT_AND_NOT(a2, b3)));
+      s3_0 = SIMDe_VECTOR_ADD(s3_0, SIMDe_POPCOUNT(BIT_AND_NOT(a3, b0)));
+      s3_1 = SIMDe_VECTOR_ADD(s3_1, SIMDe_POPCOUNT(BIT_AND_NOT(a3, b1)));
+      s3_2 = SIMDe_VECTOR_ADD(s3_2, SIMDe_POPCOUNT(BIT_AND_NOT(a3, b2)));
+      s3_3 = SIMDe_VECTOR_ADD(s3_3, SIMDe_POPCOUNT(BIT_AND_NOT(a3, b3)));
+    }
+  }
+  uint64_t c0_0 = gen_lanes_sum(s0_0);
+  uint64_t c0_1 = gen_lanes_sum(s0_1);
+  uint64_t c0_2 = gen_lanes_sum(s0_2);
+  uint64_t c0_3 = gen_lanes_sum(s0_3);
+  uint64_t c1_0 = gen_lanes_sum(s1_0);
+  uint64_t c1_1 = gen_lanes_sum(s1_1);
+  uint64_t c1_2 = gen_lanes_sum(s1_2);
+  uint64_t c1_3 = gen_lanes_sum(s1_3);
+  uint64_t c2_0 = gen_lanes_sum(s2_0);
+  uint64_t c2_1 = gen_lanes_sum(s2_1);
+  uint64_t c2_2 = gen_lanes_sum(s2_2);
+  uint64_t c2_3 = gen_lanes_sum(s2_3);
+  uint64_t c3_0 = gen_lanes_sum(s3_0);
+  uint64_t c3_1 = gen_lanes_sum(s3_1);
+  uint64_t c3_2 = gen_lanes_sum(s3_2);
+  uint64_t c3_3 = gen_lanes_sum(s3_3);
+  for (; k < k_max; k++) {
+    const uint64_t a0 = a[0][k];
+    const uint64_t a1 = a[1][k];
+    const uint64_t a2 = a[2][k];
+    const uint64_t a3 = a[3][k];
+    const uint64_t b0 = b[0][k];
+    const uint64_t b1 = b[1][k];
+    const uint64_t b2 = b[2][k];
+    const uint64_t b3 = b[3][k];
+    c0_0 += POPCOUNT(BIT_SCALAR_AND_NOT(a0, b0));
+    c0_1 += POPCOUNT(BIT_SCALAR_AND_NOT(a0, b1));
+    c0_2 += POPCOUNT(BIT_SCALAR_AND_NOT(a0, b2));
+    c0_3 += POPCOUNT(BIT_SCALAR_AND_NOT(a0, b3));
+    c1_0 += POPCOUNT(BIT_SCALAR_AND_NOT(a1, b0));
+    c1_1 += POPCOUNT(BIT_SCALAR_AND_NOT(a1, b1));
+    c1_2 += POPCOUNT(BIT_SCALAR_AND_NOT(a1, b2));
+    c1_3 += POPCOUNT(BIT_SCALAR_AND_NOT(a1, b3));
+    c2_0 += POPCOUNT(BIT_SCALAR_AND_NOT(a2, b0));
+    c2_1 += POPCOUNT(BIT_SCALAR_AND_NOT(a2, b1));
+    c2_2 += POPCOUNT(BIT_SCALAR_AND_NOT(a2, b2));
+    c2_3 += POPCOUNT(BIT_SCALAR_AND_NOT(a2, b3));
+    c3_0 += POPCOUNT(BIT_SCALAR_AND_NOT(a3, b0));
+    c3_1 += POPCOUNT(BIT_SCALAR_AND_NOT(a3, b1));
+    c3_2 += POPCOUNT(BIT_SCALAR_AND_NOT(a3, b2));
+    c3_3 += POPCOUNT(BIT_SCALAR_AND_NOT(a3, b3));
+  }
+  results[0][0] = (int)c0_0;
+  results[0][1] = (int)c0_1;
+  results[0][2] = (int)c0_2;
+  results[0][3] = (int)c0_3;
+  results[1][0] = (int)c1_0;
+  results[1][1] = (int)c1_1;
+  results[1][2] = (int)c1_2;
+  results[1][3] = (int)c1_3;
+  results[2][0] = (int)c2_0;
+  results[2][1] = (int)c2_1;
+  results[2][2] = (int)c2_2;
+  results[2][3] = (int)c2_3;
+  results[3][0] = (int)c3_0;
+  results[3][1] = (int)c3_1;
+  results[3][2] = (int)c3_2;
+  results[3][3] = (int)c3_3;
+#else
+  setop_count_db_cpu_kernel_outer(4, 4, 1, a, b, k_b, k_max, results, _AND_NOT,
+                                  OMP_CPU_SIMD_ALIGN_BUFFER(ALIGNMENT, setop_buffer),
+                                  BIT_GEN_ALIGNED_LOAD);
+#endif
+}
+
+static void gen_rows_and_not_4x4x1_aligned(const uint64_t *const *a, int ni,
+    const uint64_t *const *b, int nj, size_t k_b, size_t k_max,
+    int *restrict counts, size_t ld) {
+  SETOP_BLOCK_TILES(_AND_NOT, BIT_GEN_ALIGNED_LOAD, SETOP_INDIRECT_A, SETOP_INDIRECT_B, 4, 4,
+                    gen_block_and_not_4x4x1_aligned(a_rows, b_rows, k_b, k_max, results))
+}
+
+/* and_not, 4x4 register block, 1 vector a step, unaligned loads */
+static inline void gen_block_and_not_4x4x1_unaligned(
+    const uint64_t *restrict const *a, const uint64_t *restrict const *b,
+    size_t k_b, size_t k_max, int results[4][4]) {
+#if BIT_GEN_VECTOR_BLOCKS
+  const size_t step = 1 * VECTOR_QWORDS;
+  CHUNK_LIMIT(limit, k_b, k_max, step)
+  VECTOR_TYPE s0_0 = SIMDe_ZERO_VECTOR;
+  VECTOR_TYPE s0_1 = SIMDe_ZERO_VECTOR;
+  VECTOR_TYPE s0_2 = SIMDe_ZERO_VECTOR;
+  VECTOR_TYPE s0_3 = SIMDe_ZERO_VECTOR;
+  VECTOR_TYPE s1_0 = SIMDe_ZERO_VECTOR;
+  VECTOR_TYPE s1_1 = SIMDe_ZERO_VECTOR;
+  VECTOR_TYPE s1_2 = SIMDe_ZERO_VECTOR;
+  VECTOR_TYPE s1_3 = SIMDe_ZERO_VECTOR;
+  VECTOR_TYPE s2_0 = SIMDe_ZERO_VECTOR;
+  VECTOR_TYPE s2_1 = SIMDe_ZERO_VECTOR;
+  VECTOR_TYPE s2_2 = SIMDe_ZERO_VECTOR;
+  VECTOR_TYPE s2_3 = SIMDe_ZERO_VECTOR;
+  VECTOR_TYPE s3_0 = SIMDe_ZERO_VECTOR;
+  VECTOR_TYPE s3_1 = SIMDe_ZERO_VECTOR;
+  VECTOR_TYPE s3_2 = SIMDe_ZERO_VECTOR;
+  VECTOR_TYPE s3_3 = SIMDe_ZERO_VECTOR;
+  size_t k = k_b;
+  for (; k < limit; k += step) {
+    {
+      const VECTOR_TYPE a0 = VECTOR_UNALIGNED_LOAD((VECTOR_TYPE *)&a[0][k + VECTOR_OFFSET(0)]);
+      const VECTOR_TYPE a1 = VECTOR_UNALIGNED_LOAD((VECTOR_TYPE *)&a[1][k + VECTOR_OFFSET(0)]);
+      const VECTOR_TYPE a2 = VECTOR_UNALIGNED_LOAD((VECTOR_TYPE *)&a[2][k + VECTOR_OFFSET(0)]);
+      const VECTOR_TYPE a3 = VECTOR_UNALIGNED_LOAD((VECTOR_TYPE *)&a[3][k + VECTOR_OFFSET(0)]);
+      const VECTOR_TYPE b0 = VECTOR_UNALIGNED_LOAD((VECTOR_TYPE *)&b[0][k + VECTOR_OFFSET(0)]);
+      const VECTOR_TYPE b1 = VECTOR_UNALIGNED_LOAD((VECTOR_TYPE *)&b[1][k + VECTOR_OFFSET(0)]);
+      const VECTOR_TYPE b2 = VECTOR_UNALIGNED_LOAD((VECTOR_TYPE *)&b[2][k + VECTOR_OFFSET(0)]);
+      const VECTOR_TYPE b3 = VECTOR_UNALIGNED_LOAD((VECTOR_TYPE *)&b[3][k + VECTOR_OFFSET(0)]);
+      s0_0 = SIMDe_VECTOR_ADD(s0_0, SIMDe_POPCOUNT(BIT_AND_NOT(a0, b0)));
+      s0_1 = SIMDe_VECTOR_ADD(s0_1, SIMDe_POPCOUNT(BIT_AND_NOT(a0, b1)));
+      s0_2 = SIMDe_VECTOR_ADD(s0_2, SIMDe_POPCOUNT(BIT_AND_NOT(a0, b2)));
+      s0_3 = SIMDe_VECTOR_ADD(s0_3, SIMDe_POPCOUNT(BIT_AND_NOT(a0, b3)));
+      s1_0 = SIMDe_VECTOR_ADD(s1_0, SIMDe_POPCOUNT(BIT_AND_NOT(a1, b0)));
+      s1_1 = SIMDe_VECTOR_ADD(s1_1, SIMDe_POPCOUNT(BIT_AND_NOT(a1, b1)));
+      s1_2 = SIMDe_VECTOR_ADD(s1_2, SIMDe_POPCOUNT(BIT_AND_NOT(a1, b2)));
+      s1_3 = SIMDe_VECTOR_ADD(s1_3, SIMDe_POPCOUNT(BIT_AND_NOT(a1, b3)));
+      s2_0 = SIMDe_VECTOR_ADD(s2_0, SIMDe_POPCOUNT(BIT_AND_NOT(a2, b0)));
+      s2_1 = SIMDe_VECTOR_ADD(s2_1, SIMDe_POPCOUNT(BIT_AND_NOT(a2, b1)));
+      s2_2 = SIMDe_VECTOR_ADD(s2_2, SIMDe_POPCOUNT(BIT_AND_NOT(a2, b2)));
+      s2_3 = SIMDe_VECTOR_ADD(s2_3, SIMDe_POPCOUNT(BIT_AND_NOT(a2, b3)));
+      s3_0 = SIMDe_VECTOR_ADD(s3_0, SIMDe_POPCOUNT(BIT_AND_NOT(a3, b0)));
+      s3_1 = SIMDe_VECTOR_ADD(s3_1, SIMDe_POPCOUNT(BIT_AND_NOT(a3, b1)));
+      s3_2 = SIMDe_VECTOR_ADD(s3_2, SIMDe_POPCOUNT(BIT_AND_NOT(a3, b2)));
+      s3_3 = SIMDe_VECTOR_ADD(s3_3, SIMDe_POPCOUNT(BIT_AND_NOT(a3, b3)));
+    }
+  }
+  uint64_t c0_0 = gen_lanes_sum(s0_0);
+  uint64_t c0_1 = gen_lanes_sum(s0_1);
+  uint64_t c0_2 = gen_lanes_sum(s0_2);
+  uint64_t c0_3 = gen_lanes_sum(s0_3);
+  uint64_t c1_0 = gen_lanes_sum(s1_0);
+  uint64_t c1_1 = gen_lanes_sum(s1_1);
+  uint64_t c1_2 = gen_lanes_sum(s1_2);
+  uint64_t c1_3 = gen_lanes_sum(s1_3);
+  uint64_t c2_0 = gen_lanes_sum(s2_0);
+  uint64_t c2_1 = gen_lanes_sum(s2_1);
+  uint64_t c2_2 = gen_lanes_sum(s2_2);
+  uint64_t c2_3 = gen_lanes_sum(s2_3);
+  uint64_t c3_0 = gen_lanes_sum(s3_0);
+  uint64_t c3_1 = gen_lanes_sum(s3_1);
+  uint64_t c3_2 = gen_lanes_sum(s3_2);
+  uint64_t c3_3 = gen_lanes_sum(s3_3);
+  for (; k < k_max; k++) {
+    const uint64_t a0 = a[0][k];
+    const uint64_t a1 = a[1][k];
+    const uint64_t a2 = a[2][k];
+    const uint64_t a3 = a[3][k];
+    const uint64_t b0 = b[0][k];
+    const uint64_t b1 = b[1][k];
+    const uint64_t b2 = b[2][k];
+    const uint64_t b3 = b[3][k];
+    c0_0 += POPCOUNT(BIT_SCALAR_AND_NOT(a0, b0));
+    c0_1 += POPCOUNT(BIT_SCALAR_AND_NOT(a0, b1));
+    c0_2 += POPCOUNT(BIT_SCALAR_AND_NOT(a0, b2));
+    c0_3 += POPCOUNT(BIT_SCALAR_AND_NOT(a0, b3));
+    c1_0 += POPCOUNT(BIT_SCALAR_AND_NOT(a1, b0));
+    c1_1 += POPCOUNT(BIT_SCALAR_AND_NOT(a1, b1));
+    c1_2 += POPCOUNT(BIT_SCALAR_AND_NOT(a1, b2));
+    c1_3 += POPCOUNT(BIT_SCALAR_AND_NOT(a1, b3));
+    c2_0 += POPCOUNT(BIT_SCALAR_AND_NOT(a2, b0));
+    c2_1 += POPCOUNT(BIT_SCALAR_AND_NOT(a2, b1));
+    c2_2 += POPCOUNT(BIT_SCALAR_AND_NOT(a2, b2));
+    c2_3 += POPCOUNT(BIT_SCALAR_AND_NOT(a2, b3));
+    c3_0 += POPCOUNT(BIT_SCALAR_AND_NOT(a3, b0));
+    c3_1 += POPCOUNT(BIT_SCALAR_AND_NOT(a3, b1));
+    c3_2 += POPCOUNT(BIT_SCALAR_AND_NOT(a3, b2));
+    c3_3 += POPCOUNT(BIT_SCALAR_AND_NOT(a3, b3));
+  }
+  results[0][0] = (int)c0_0;
+  results[0][1] = (int)c0_1;
+  results[0][2] = (int)c0_2;
+  results[0][3] = (int)c0_3;
+  results[1][0] = (int)c1_0;
+  results[1][1] = (int)c1_1;
+  results[1][2] = (int)c1_2;
+  results[1][3] = (int)c1_3;
+  results[2][0] = (int)c2_0;
+  results[2][1] = (int)c2_1;
+  results[2][2] = (int)c2_2;
+  results[2][3] = (int)c2_3;
+  results[3][0] = (int)c3_0;
+  results[3][1] = (int)c3_1;
+  results[3][2] = (int)c3_2;
+  results[3][3] = (int)c3_3;
+#else
+  setop_count_db_cpu_kernel_outer(4, 4, 1, a, b, k_b, k_max, results, _AND_NOT,
+                                  OMP_CPU_SIMD_ALIGN_BUFFER(ALIGNMENT, setop_buffer),
+                                  VECTOR_UNALIGNED_LOAD);
+#endif
+}
+
+static void gen_rows_and_not_4x4x1_unaligned(const uint64_t *const *a, int ni,
+    const uint64_t *const *b, int nj, size_t k_b, size_t k_max,
+    int *restrict counts, size_t ld) {
+  SETOP_BLOCK_TILES(_AND_NOT, VECTOR_UNALIGNED_LOAD, SETOP_INDIRECT_A, SETOP_INDIRECT_B, 4, 4,
+                    gen_block_and_not_4x4x1_unaligned(a_rows, b_rows, k_b, k_max, results))
+}
+
+/* and, 3x8 register block, 1 vector a step, aligned loads */
+static inline void gen_block_and_3x8x1_aligned(
+    const uint64_t *restrict const *a, const uint64_t *restrict const *b,
+    size_t k_b, size_t k_max, int results[3][8]) {
+#if BIT_GEN_VECTOR_BLOCKS
+  const size_t step = 1 * VECTOR_QWORDS;
+  CHUNK_LIMIT(limit, k_b, k_max, step)
+  VECTOR_TYPE s0_0 = SIMDe_ZERO_VECTOR;
+  VECTOR_TYPE s0_1 = SIMDe_ZERO_VECTOR;
+  VECTOR_TYPE s0_2 = SIMDe_ZERO_VECTOR;
+  VECTOR_TYPE s0_3 = SIMDe_ZERO_VECTOR;
+  VECTOR_TYPE s0_4 = SIMDe_ZERO_VECTOR;
+  VECTOR_TYPE s0_5 = SIMDe_ZERO_VECTOR;
+  VECTOR_TYPE s0_6 = SIMDe_ZERO_VECTOR;
+  VECTOR_TYPE s0_7 = SIMDe_ZERO_VECTOR;
+  VECTOR_TYPE s1_0 = SIMDe_ZERO_VECTOR;
+  VECTOR_TYPE s1_1 = SIMDe_ZERO_VECTOR;
+  VECTOR_TYPE s1_2 = SIMDe_ZERO_VECTOR;
+  VECTOR_TYPE s1_3 = SIMDe_ZERO_VECTOR;
+  VECTOR_TYPE s1_4 = SIMDe_ZERO_VECTOR;
+  VECTOR_TYPE s1_5 = SIMDe_ZERO_VECTOR;
+  VECTOR_TYPE s1_6 = SIMDe_ZERO_VECTOR;
+  VECTOR_TYPE s1_7 = SIMDe_ZERO_VECTOR;
+  VECTOR_TYPE s2_0 = SIMDe_ZERO_VECTOR;
+  VECTOR_TYPE s2_1 = SIMDe_ZERO_VECTOR;
+  VECTOR_TYPE s2_2 = SIMDe_ZERO_VECTOR;
+  VECTOR_TYPE s2_3 = SIMDe_ZERO_VECTOR;
+  VECTOR_TYPE s2_4 = SIMDe_ZERO_VECTOR;
+  VECTOR_TYPE s2_5 = SIMDe_ZERO_VECTOR;
+  VECTOR_TYPE s2_6 = SIMDe_ZERO_VECTOR;
+  VECTOR_TYPE s2_7 = SIMDe_ZERO_VECTOR;
+  size_t k = k_b;
+  for (; k < limit; k += step) {
+    {
+      const VECTOR_TYPE a0 = BIT_GEN_ALIGNED_LOAD((VECTOR_TYPE *)&a[0][k + VECTOR_OFFSET(0)]);
+      const VECTOR_TYPE a1 = BIT_GEN_ALIGNED_LOAD((VECTOR_TYPE *)&a[1][k + VECTOR_OFFSET(0)]);
+      const VECTOR_TYPE a2 = BIT_GEN_ALIGNED_LOAD((VECTOR_TYPE *)&a[2][k + VECTOR_OFFSET(0)]);
+      const VECTOR_TYPE b0 = BIT_GEN_ALIGNED_LOAD((VECTOR_TYPE *)&b[0][k + VECTOR_OFFSET(0)]);
+      const VECTOR_TYPE b1 = BIT_GEN_ALIGNED_LOAD((VECTOR_TYPE *)&b[1][k + VECTOR_OFFSET(0)]);
+      const VECTOR_TYPE b2 = BIT_GEN_ALIGNED_LOAD((VECTOR_TYPE *)&b[2][k + VECTOR_OFFSET(0)]);
+      const VECTOR_TYPE b3 = BIT_GEN_ALIGNED_LOAD((VECTOR_TYPE *)&b[3][k + VECTOR_OFFSET(0)]);
+      const VECTOR_TYPE b4 = BIT_GEN_ALIGNED_LOAD((VECTOR_TYPE *)&b[4][k + VECTOR_OFFSET(0)]);
+      const VECTOR_TYPE b5 = BIT_GEN_ALIGNED_LOAD((VECTOR_TYPE *)&b[5][k + VECTOR_OFFSET(0)]);
+      const VECTOR_TYPE b6 = BIT_GEN_ALIGNED_LOAD((VECTOR_TYPE *)&b[6][k + VECTOR_OFFSET(0)]);
+      const VECTOR_TYPE b7 = BIT_GEN_ALIGNED_LOAD((VECTOR_TYPE *)&b[7][k + VECTOR_OFFSET(0)]);
+      s0_0 = SIMDe_VECTOR_ADD(s0_0, SIMDe_POPCOUNT(BIT_AND(a0, b0)));
+      s0_1 = SIMDe_VECTOR_ADD(s0_1, SIMDe_POPCOUNT(BIT_AND(a0, b1)));
+      s0_2 = SIMDe_VECTOR_ADD(s0_2, SIMDe_POPCOUNT(BIT_AND(a0, b2)));
+      s0_3 = SIMDe_VECTOR_ADD(s0_3, SIMDe_POPCOUNT(BIT_AND(a0, b3)));
+      s0_4 = SIMDe_VECTOR_ADD(s0_4, SIMDe_POPCOUNT(BIT_AND(a0, b4)));
+      s0_5 = SIMDe_VECTOR_ADD(s0_5, SIMDe_POPCOUNT(BIT_AND(a0, b5)));
+      s0_6 = SIMDe_VECTOR_ADD(s0_6, SIMDe_POPCOUNT(BIT_AND(a0, b6)));
+      s0_7 = SIMDe_VECTOR_ADD(s0_7, SIMDe_POPCOUNT(BIT_AND(a0, b7)));
+      s1_0 = SIMDe_VECTOR_ADD(s1_0, SIMDe_POPCOUNT(BIT_AND(a1, b0)));
+      s1_1 = SIMDe_VECTOR_ADD(s1_1, SIMDe_POPCOUNT(BIT_AND(a1, b1)));
+      s1_2 = SIMDe_VECTOR_ADD(s1_2, SIMDe_POPCOUNT(BIT_AND(a1, b2)));
+      s1_3 = SIMDe_VECTOR_ADD(s1_3, SIMDe_POPCOUNT(BIT_AND(a1, b3)));
+      s1_4 = SIMDe_VECTOR_ADD(s1_4, SIMDe_POPCOUNT(BIT_AND(a1, b4)));
+      s1_5 = SIMDe_VECTOR_ADD(s1_5, SIMDe_POPCOUNT(BIT_AND(a1, b5)));
+      s1_6 = SIMDe_VECTOR_ADD(s1_6, SIMDe_POPCOUNT(BIT_AND(a1, b6)));
+      s1_7 = SIMDe_VECTOR_ADD(s1_7, SIMDe_POPCOUNT(BIT_AND(a1, b7)));
+      s2_0 = SIMDe_VECTOR_ADD(s2_0, SIMDe_POPCOUNT(BIT_AND(a2, b0)));
+      s2_1 = SIMDe_VECTOR_ADD(s2_1, SIMDe_POPCOUNT(BIT_AND(a2, b1)));
+      s2_2 = SIMDe_VECTOR_ADD(s2_2, SIMDe_POPCOUNT(BIT_AND(a2, b2)));
+      s2_3 = SIMDe_VECTOR_ADD(s2_3, SIMDe_POPCOUNT(BIT_AND(a2, b3)));
+      s2_4 = SIMDe_VECTOR_ADD(s2_4, SIMDe_POPCOUNT(BIT_AND(a2, b4)));
+      s2_5 = SIMDe_VECTOR_ADD(s2_5, SIMDe_POPCOUNT(BIT_AND(a2, b5)));
+      s2_6 = SIMDe_VECTOR_ADD(s2_6, SIMDe_POPCOUNT(BIT_AND(a2, b6)));
+      s2_7 = SIMDe_VECTOR_ADD(s2_7, SIMDe_POPCOUNT(BIT_AND(a2, b7)));
+    }
+  }
+  uint64_t c0_0 = gen_lanes_sum(s0_0);
+  uint64_t c0_1 = gen_lanes_sum(s0_1);
+  uint64_t c0_2 = gen_lanes_sum(s0_2);
+  uint64_t c0_3 = gen_lanes_sum(s0_3);
+  uint64_t c0_4 = gen_lanes_sum(s0_4);
+  uint64_t c0_5 = gen_lanes_sum(s0_5);
+  uint64_t c0_6 = gen_lanes_sum(s0_6);
+  uint64_t c0_7 = gen_lanes_sum(s0_7);
+  uint64_t c1_0 = gen_lanes_sum(s1_0);
+  uint64_t c1_1 = gen_lanes_sum(s1_1);
+  uint64_t c1_2 = gen_lanes_sum(s1_2);
+  uint64_t c1_3 = gen_lanes_sum(s1_3);
+  uint64_t c1_4 = gen_lanes_sum(s1_4);
+  uint64_t c1_5 = gen_lanes_sum(s1_5);
+  uint64_t c1_6 = gen_lanes_sum(s1_6);
+  uint64_t c1_7 = gen_lanes_sum(s1_7);
+  uint64_t c2_0 = gen_lanes_sum(s2_0);
+  uint64_t c2_1 = gen_lanes_sum(s2_1);
+  uint64_t c2_2 = gen_lanes_sum(s2_2);
+  uint64_t c2_3 = gen_lanes_sum(s2_3);
+  uint64_t c2_4 = gen_lanes_sum(s2_4);
+  uint64_t c2_5 = gen_lanes_sum(s2_5);
+  uint64_t c2_6 = gen_lanes_sum(s2_6);
+  uint64_t c2_7 = gen_lanes_sum(s2_7);
+  for (; k < k_max; k++) {
+    const uint64_t a0 = a[0][k];
+    const uint64_t a1 = a[1][k];
+    const uint64_t a2 = a[2][k];
+    const uint64_t b0 = b[0][k];
+    const uint64_t b1 = b[1][k];
+    const uint64_t b2 = b[2][k];
+    const uint64_t b3 = b[3][k];
+    const uint64_t b4 = b[4][k];
+    const uint64_t b5 = b[5][k];
+    const uint64_t b6 = b[6][k];
+    const uint64_t b7 = b[7][k];
+    c0_0 += POPCOUNT(BIT_SCALAR_AND(a0, b0));
+    c0_1 += POPCOUNT(BIT_SCALAR_AND(a0, b1));
+    c0_2 += POPCOUNT(BIT_SCALAR_AND(a0, b2));
+    c0_3 += POPCOUNT(BIT_SCALAR_AND(a0, b3));
+    c0_4 += POPCOUNT(BIT_SCALAR_AND(a0, b4));
+    c0_5 += POPCOUNT(BIT_SCALAR_AND(a0, b5));
+    c0_6 += POPCOUNT(BIT_SCALAR_AND(a0, b6));
+    c0_7 += POPCOUNT(BIT_SCALAR_AND(a0, b7));
+    c1_0 += POPCOUNT(BIT_SCALAR_AND(a1, b0));
+    c1_1 += POPCOUNT(BIT_SCALAR_AND(a1, b1));
+    c1_2 += POPCOUNT(BIT_SCALAR_AND(a1, b2));
+    c1_3 += POPCOUNT(BIT_SCALAR_AND(a1, b3));
+    c1_4 += POPCOUNT(BIT_SCALAR_AND(a1, b4));
+    c1_5 += POPCOUNT(BIT_SCALAR_AND(a1, b5));
+    c1_6 += POPCOUNT(BIT_SCALAR_AND(a1, b6));
+    c1_7 += POPCOUNT(BIT_SCALAR_AND(a1, b7));
+    c2_0 += POPCOUNT(BIT_SCALAR_AND(a2, b0));
+    c2_1 += POPCOUNT(BIT_SCALAR_AND(a2, b1));
+    c2_2 += POPCOUNT(BIT_SCALAR_AND(a2, b2));
+    c2_3 += POPCOUNT(BIT_SCALAR_AND(a2, b3));
+    c2_4 += POPCOUNT(BIT_SCALAR_AND(a2, b4));
+    c2_5 += POPCOUNT(BIT_SCALAR_AND(a2, b5));
+    c2_6 += POPCOUNT(BIT_SCALAR_AND(a2, b6));
+    c2_7 += POPCOUNT(BIT_SCALAR_AND(a2, b7));
+  }
+  results[0][0] = (int)c0_0;
+  results[0][1] = (int)c0_1;
+  results[0][2] = (int)c0_2;
+  results[0][3] = (int)c0_3;
+  results[0][4] = (int)c0_4;
+  results[0][5] = (int)c0_5;
+  results[0][6] = (int)c0_6;
+  results[0][7] = (int)c0_7;
+  results[1][0] = (int)c1_0;
+  results[1][1] = (int)c1_1;
+  results[1][2] = (int)c1_2;
+  results[1][3] = (int)c1_3;
+  results[1][4] = (int)c1_4;
+  results[1][5] = (int)c1_5;
+  results[1][6] = (int)c1_6;
+  results[1][7] = (int)c1_7;
+  results[2][0] = (int)c2_0;
+  results[2][1] = (int)c2_1;
+  results[2][2] = (int)c2_2;
+  results[2][3] = (int)c2_3;
+  results[2][4] = (int)c2_4;
+  results[2][5] = (int)c2_5;
+  results[2][6] = (int)c2_6;
+  results[2][7] = (int)c2_7;
+#else
+  setop_count_db_cpu_kernel_outer(3, 8, 1, a, b, k_b, k_max, results, _AND,
+                                  OMP_CPU_SIMD_ALIGN_BUFFER(ALIGNMENT, setop_buffer),
+                                  BIT_GEN_ALIGNED_LOAD);
+#endif
+}
+
+static void gen_rows_and_3x8x1_aligned(const uint64_t *const *a, int ni,
+    const uint64_t *const *b, int nj, size_t k_b, size_t k_max,
+    int *restrict counts, size_t ld) {
+  SETOP_BLOCK_TILES(_AND, BIT_GEN_ALIGNED_LOAD, SETOP_INDIRECT_A, SETOP_INDIRECT_B, 3, 8,
+                    gen_block_and_3x8x1_aligned(a_rows, b_rows, k_b, k_max, results))
+}
+
+/* and, 3x8 register block, 1 vector a step, unaligned loads */
+static inline void gen_block_and_3x8x1_unaligned(
+    const uint64_t *restrict const *a, const uint64_t *restrict const *b,
+    size_t k_b, size_t k_max, int results[3][8]) {
+#if BIT_GEN_VECTOR_BLOCKS
+  const size_t step = 1 * VECTOR_QWORDS;
+  CHUNK_LIMIT(limit, k_b, k_max, step)
+  VECTOR_TYPE s0_0 = SIMDe_ZERO_VECTOR;
+  VECTOR_TYPE s0_1 = SIMDe_ZERO_VECTOR;
+  VECTOR_TYPE s0_2 = SIMDe_ZERO_VECTOR;
+  VECTOR_TYPE s0_3 = SIMDe_ZERO_VECTOR;
+  VECTOR_TYPE s0_4 = SIMDe_ZERO_VECTOR;
+  VECTOR_TYPE s0_5 = SIMDe_ZERO_VECTOR;
+  VECTOR_TYPE s0_6 = SIMDe_ZERO_VECTOR;
+  VECTOR_TYPE s0_7 = SIMDe_ZERO_VECTOR;
+  VECTOR_TYPE s1_0 = SIMDe_ZERO_VECTOR;
+  VECTOR_TYPE s1_1 = SIMDe_ZERO_VECTOR;
+  VECTOR_TYPE s1_2 = SIMDe_ZERO_VECTOR;
+  VECTOR_TYPE s1_3 = SIMDe_ZERO_VECTOR;
+  VECTOR_TYPE s1_4 = SIMDe_ZERO_VECTOR;
+  VECTOR_TYPE s1_5 = SIMDe_ZERO_VECTOR;
+  VECTOR_TYPE s1_6 = SIMDe_ZERO_VECTOR;
+  VECTOR_TYPE s1_7 = SIMDe_ZERO_VECTOR;
+  VECTOR_TYPE s2_0 = SIMDe_ZERO_VECTOR;
+  VECTOR_TYPE s2_1 = SIMDe_ZERO_VECTOR;
+  VECTOR_TYPE s2_2 = SIMDe_ZERO_VECTOR;
+  VECTOR_TYPE s2_3 = SIMDe_ZERO_VECTOR;
+  VECTOR_TYPE s2_4 = SIMDe_ZERO_VECTOR;
+  VECTOR_TYPE s2_5 = SIMDe_ZERO_VECTOR;
+  VECTOR_TYPE s2_6 = SIMDe_ZERO_VECTOR;
+  VECTOR_TYPE s2_7 = SIMDe_ZERO_VECTOR;
+  size_t k = k_b;
+  for (; k < limit; k += step) {
+    {
+      const VECTOR_TYPE a0 = VECTOR_UNALIGNED_LOAD((VECTOR_TYPE *)&a[0][k + VECTOR_OFFSET(0)]);
+      const VECTOR_TYPE a1 = VECTOR_UNALIGNED_LOAD((VECTOR_TYPE *)&a[1][k + VECTOR_OFFSET(0)]);
+      const VECTOR_TYPE a2 = VECTOR_UNALIGNED_LOAD((VECTOR_TYPE *)&a[2][k + VECTOR_OFFSET(0)]);
+      const VECTOR_TYPE b0 = VECTOR_UNALIGNED_LOAD((VECTOR_TYPE *)&b[0][k + VECTOR_OFFSET(0)]);
+      const VECTOR_TYPE b1 = VECTOR_UNALIGNED_LOAD((VECTOR_TYPE *)&b[1][k + VECTOR_OFFSET(0)]);
+      const VECTOR_TYPE b2 = VECTOR_UNALIGNED_LOAD((VECTOR_TYPE *)&b[2][k + VECTOR_OFFSET(0)]);
+      const VECTOR_TYPE b3 = VECTOR_UNALIGNED_LOAD((VECTOR_TYPE *)&b[3][k + VECTOR_OFFSET(0)]);
+      const VECTOR_TYPE b4 = VECTOR_UNALIGNED_LOAD((VECTOR_TYPE *)&b[4][k + VECTOR_OFFSET(0)]);
+      const VECTOR_TYPE b5 = VECTOR_UNALIGNED_LOAD((VECTOR_TYPE *)&b[5][k + VECTOR_OFFSET(0)]);
+      const VECTOR_TYPE b6 = VECTOR_UNALIGNED_LOAD((VECTOR_TYPE *)&b[6][k + VECTOR_OFFSET(0)]);
+      const VECTOR_TYPE b7 = VECTOR_UNALIGNED_LOAD((VECTOR_TYPE *)&b[7][k + VECTOR_OFFSET(0)]);
+      s0_0 = SIMDe_VECTOR_ADD(s0_0, SIMDe_POPCOUNT(BIT_AND(a0, b0)));
+      s0_1 = SIMDe_VECTOR_ADD(s0_1, SIMDe_POPCOUNT(BIT_AND(a0, b1)));
+      s0_2 = SIMDe_VECTOR_ADD(s0_2, SIMDe_POPCOUNT(BIT_AND(a0, b2)));
+      s0_3 = SIMDe_VECTOR_ADD(s0_3, SIMDe_POPCOUNT(BIT_AND(a0, b3)));
+      s0_4 = SIMDe_VECTOR_ADD(s0_4, SIMDe_POPCOUNT(BIT_AND(a0, b4)));
+      s0_5 = SIMDe_VECTOR_ADD(s0_5, SIMDe_POPCOUNT(BIT_AND(a0, b5)));
+      s0_6 = SIMDe_VECTOR_ADD(s0_6, SIMDe_POPCOUNT(BIT_AND(a0, b6)));
+      s0_7 = SIMDe_VECTOR_ADD(s0_7, SIMDe_POPCOUNT(BIT_AND(a0, b7)));
+      s1_0 = SIMDe_VECTOR_ADD(s1_0, SIMDe_POPCOUNT(BIT_AND(a1, b0)));
+      s1_1 = SIMDe_VECTOR_ADD(s1_1, SIMDe_POPCOUNT(BIT_AND(a1, b1)));
+      s1_2 = SIMDe_VECTOR_ADD(s1_2, SIMDe_POPCOUNT(BIT_AND(a1, b2)));
+      s1_3 = SIMDe_VECTOR_ADD(s1_3, SIMDe_POPCOUNT(BIT_AND(a1, b3)));
+      s1_4 = SIMDe_VECTOR_ADD(s1_4, SIMDe_POPCOUNT(BIT_AND(a1, b4)));
+      s1_5 = SIMDe_VECTOR_ADD(s1_5, SIMDe_POPCOUNT(BIT_AND(a1, b5)));
+      s1_6 = SIMDe_VECTOR_ADD(s1_6, SIMDe_POPCOUNT(BIT_AND(a1, b6)));
+      s1_7 = SIMDe_VECTOR_ADD(s1_7, SIMDe_POPCOUNT(BIT_AND(a1, b7)));
+      s2_0 = SIMDe_VECTOR_ADD(s2_0, SIMDe_POPCOUNT(BIT_AND(a2, b0)));
+      s2_1 = SIMDe_VECTOR_ADD(s2_1, SIMDe_POPCOUNT(BIT_AND(a2, b1)));
+      s2_2 = SIMDe_VECTOR_ADD(s2_2, SIMDe_POPCOUNT(BIT_AND(a2, b2)));
+      s2_3 = SIMDe_VECTOR_ADD(s2_3, SIMDe_POPCOUNT(BIT_AND(a2, b3)));
+      s2_4 = SIMDe_VECTOR_ADD(s2_4, SIMDe_POPCOUNT(BIT_AND(a2, b4)));
+      s2_5 = SIMDe_VECTOR_ADD(s2_5, SIMDe_POPCOUNT(BIT_AND(a2, b5)));
+      s2_6 = SIMDe_VECTOR_ADD(s2_6, SIMDe_POPCOUNT(BIT_AND(a2, b6)));
+      s2_7 = SIMDe_VECTOR_ADD(s2_7, SIMDe_POPCOUNT(BIT_AND(a2, b7)));
+    }
+  }
+  uint64_t c0_0 = gen_lanes_sum(s0_0);
+  uint64_t c0_1 = gen_lanes_sum(s0_1);
+  uint64_t c0_2 = gen_lanes_sum(s0_2);
+  uint64_t c0_3 = gen_lanes_sum(s0_3);
+  uint64_t c0_4 = gen_lanes_sum(s0_4);
+  uint64_t c0_5 = gen_lanes_sum(s0_5);
+  uint64_t c0_6 = gen_lanes_sum(s0_6);
+  uint64_t c0_7 = gen_lanes_sum(s0_7);
+  uint64_t c1_0 = gen_lanes_sum(s1_0);
+  uint64_t c1_1 = gen_lanes_sum(s1_1);
+  uint64_t c1_2 = gen_lanes_sum(s1_2);
+  uint64_t c1_3 = gen_lanes_sum(s1_3);
+  uint64_t c1_4 = gen_lanes_sum(s1_4);
+  uint64_t c1_5 = gen_lanes_sum(s1_5);
+  uint64_t c1_6 = gen_lanes_sum(s1_6);
+  uint64_t c1_7 = gen_lanes_sum(s1_7);
+  uint64_t c2_0 = gen_lanes_sum(s2_0);
+  uint64_t c2_1 = gen_lanes_sum(s2_1);
+  uint64_t c2_2 = gen_lanes_sum(s2_2);
+  uint64_t c2_3 = gen_lanes_sum(s2_3);
+  uint64_t c2_4 = gen_lanes_sum(s2_4);
+  uint64_t c2_5 = gen_lanes_sum(s2_5);
+  uint64_t c2_6 = gen_lanes_sum(s2_6);
+  uint64_t c2_7 = gen_lanes_sum(s2_7);
+  for (; k < k_max; k++) {
+    const uint64_t a0 = a[0][k];
+    const uint64_t a1 = a[1][k];
+    const uint64_t a2 = a[2][k];
+    const uint64_t b0 = b[0][k];
+    const uint64_t b1 = b[1][k];
+    const uint64_t b2 = b[2][k];
+    const uint64_t b3 = b[3][k];
+    const uint64_t b4 = b[4][k];
+    const uint64_t b5 = b[5][k];
+    const uint64_t b6 = b[6][k];
+    const uint64_t b7 = b[7][k];
+    c0_0 += POPCOUNT(BIT_SCALAR_AND(a0, b0));
+    c0_1 += POPCOUNT(BIT_SCALAR_AND(a0, b1));
+    c0_2 += POPCOUNT(BIT_SCALAR_AND(a0, b2));
+    c0_3 += POPCOUNT(BIT_SCALAR_AND(a0, b3));
+    c0_4 += POPCOUNT(BIT_SCALAR_AND(a0, b4));
+    c0_5 += POPCOUNT(BIT_SCALAR_AND(a0, b5));
+    c0_6 += POPCOUNT(BIT_SCALAR_AND(a0, b6));
+    c0_7 += POPCOUNT(BIT_SCALAR_AND(a0, b7));
+    c1_0 += POPCOUNT(BIT_SCALAR_AND(a1, b0));
+    c1_1 += POPCOUNT(BIT_SCALAR_AND(a1, b1));
+    c1_2 += POPCOUNT(BIT_SCALAR_AND(a1, b2));
+    c1_3 += POPCOUNT(BIT_SCALAR_AND(a1, b3));
+    c1_4 += POPCOUNT(BIT_SCALAR_AND(a1, b4));
+    c1_5 += POPCOUNT(BIT_SCALAR_AND(a1, b5));
+    c1_6 += POPCOUNT(BIT_SCALAR_AND(a1, b6));
+    c1_7 += POPCOUNT(BIT_SCALAR_AND(a1, b7));
+    c2_0 += POPCOUNT(BIT_SCALAR_AND(a2, b0));
+    c2_1 += POPCOUNT(BIT_SCALAR_AND(a2, b1));
+    c2_2 += POPCOUNT(BIT_SCALAR_AND(a2, b2));
+    c2_3 += POPCOUNT(BIT_SCALAR_AND(a2, b3));
+    c2_4 += POPCOUNT(BIT_SCALAR_AND(a2, b4));
+    c2_5 += POPCOUNT(BIT_SCALAR_AND(a2, b5));
+    c2_6 += POPCOUNT(BIT_SCALAR_AND(a2, b6));
+    c2_7 += POPCOUNT(BIT_SCALAR_AND(a2, b7));
+  }
+  results[0][0] = (int)c0_0;
+  results[0][1] = (int)c0_1;
+  results[0][2] = (int)c0_2;
+  results[0][3] = (int)c0_3;
+  results[0][4] = (int)c0_4;
+  results[0][5] = (int)c0_5;
+  results[0][6] = (int)c0_6;
+  results[0][7] = (int)c0_7;
+  results[1][0] = (int)c1_0;
+  results[1][1] = (int)c1_1;
+  results[1][2] = (int)c1_2;
+  results[1][3] = (int)c1_3;
+  results[1][4] = (int)c1_4;
+  results[1][5] = (int)c1_5;
+  results[1][6] = (int)c1_6;
+  results[1][7] = (int)c1_7;
+  results[2][0] = (int)c2_0;
+  results[2][1] = (int)c2_1;
+  results[2][2] = (int)c2_2;
+  results[2][3] = (int)c2_3;
+  results[2][4] = (int)c2_4;
+  results[2][5] = (int)c2_5;
+  results[2][6] = (int)c2_6;
+  results[2][7] = (int)c2_7;
+#else
+  setop_count_db_cpu_kernel_outer(3, 8, 1, a, b, k_b, k_max, results, _AND,
+                                  OMP_CPU_SIMD_ALIGN_BUFFER(ALIGNMENT, setop_buffer),
+                                  VECTOR_UNALIGNED_LOAD);
+#endif
+}
+
+static void gen_rows_and_3x8x1_unaligned(const uint64_t *const *a, int ni,
+    const uint64_t *const *b, int nj, size_t k_b, size_t k_max,
+    int *restrict counts, size_t ld) {
+  SETOP_BLOCK_TILES(_AND, VECTOR_UNALIGNED_LOAD, SETOP_INDIRECT_A, SETOP_INDIRECT_B, 3, 8,
+                    gen_block_and_3x8x1_unaligned(a_rows, b_rows, k_b, k_max, results))
+}
+
+/* or, 3x8 register block, 1 vector a step, aligned loads */
+static inline void gen_block_or_3x8x1_aligned(
+    const uint64_t *restrict const *a, const uint64_t *restrict const *b,
+    size_t k_b, size_t k_max, int results[3][8]) {
+#if BIT_GEN_VECTOR_BLOCKS
+  const size_t step = 1 * VECTOR_QWORDS;
+  CHUNK_LIMIT(limit, k_b, k_max, step)
+  VECTOR_TYPE s0_0 = SIMDe_ZERO_VECTOR;
+  VECTOR_TYPE s0_1 = SIMDe_ZERO_VECTOR;
+  VECTOR_TYPE s0_2 = SIMDe_ZERO_VECTOR;
+  VECTOR_TYPE s0_3 = SIMDe_ZERO_VECTOR;
+  VECTOR_TYPE s0_4 = SIMDe_ZERO_VECTOR;
+  VECTOR_TYPE s0_5 = SIMDe_ZERO_VECTOR;
+  VECTOR_TYPE s0_6 = SIMDe_ZERO_VECTOR;
+  VECTOR_TYPE s0_7 = SIMDe_ZERO_VECTOR;
+  VECTOR_TYPE s1_0 = SIMDe_ZERO_VECTOR;
+  VECTOR_TYPE s1_1 = SIMDe_ZERO_VECTOR;
+  VECTOR_TYPE s1_2 = SIMDe_ZERO_VECTOR;
+  VECTOR_TYPE s1_3 = SIMDe_ZERO_VECTOR;
+  VECTOR_TYPE s1_4 = SIMDe_ZERO_VECTOR;
+  VECTOR_TYPE s1_5 = SIMDe_ZERO_VECTOR;
+  VECTOR_TYPE s1_6 = SIMDe_ZERO_VECTOR;
+  VECTOR_TYPE s1_7 = SIMDe_ZERO_VECTOR;
+  VECTOR_TYPE s2_0 = SIMDe_ZERO_VECTOR;
+  VECTOR_TYPE s2_1 = SIMDe_ZERO_VECTOR;
+  VECTOR_TYPE s2_2 = SIMDe_ZERO_VECTOR;
+  VECTOR_TYPE s2_3 = SIMDe_ZERO_VECTOR;
+  VECTOR_TYPE s2_4 = SIMDe_ZERO_VECTOR;
+  VECTOR_TYPE s2_5 = SIMDe_ZERO_VECTOR;
+  VECTOR_TYPE s2_6 = SIMDe_ZERO_VECTOR;
+  VECTOR_TYPE s2_7 = SIMDe_ZERO_VECTOR;
+  size_t k = k_b;
+  for (; k < limit; k += step) {
+    {
+      const VECTOR_TYPE a0 = BIT_GEN_ALIGNED_LOAD((VECTOR_TYPE *)&a[0][k + VECTOR_OFFSET(0)]);
+      const VECTOR_TYPE a1 = BIT_GEN_ALIGNED_LOAD((VECTOR_TYPE *)&a[1][k + VECTOR_OFFSET(0)]);
+      const VECTOR_TYPE a2 = BIT_GEN_ALIGNED_LOAD((VECTOR_TYPE *)&a[2][k + VECTOR_OFFSET(0)]);
+      const VECTOR_TYPE b0 = BIT_GEN_ALIGNED_LOAD((VECTOR_TYPE *)&b[0][k + VECTOR_OFFSET(0)]);
+      const VECTOR_TYPE b1 = BIT_GEN_ALIGNED_LOAD((VECTOR_TYPE *)&b[1][k + VECTOR_OFFSET(0)]);
+      const VECTOR_TYPE b2 = BIT_GEN_ALIGNED_LOAD((VECTOR_TYPE *)&b[2][k + VECTOR_OFFSET(0)]);
+      const VECTOR_TYPE b3 = BIT_GEN_ALIGNED_LOAD((VECTOR_TYPE *)&b[3][k + VECTOR_OFFSET(0)]);
+      const VECTOR_TYPE b4 = BIT_GEN_ALIGNED_LOAD((VECTOR_TYPE *)&b[4][k + VECTOR_OFFSET(0)]);
+      const VECTOR_TYPE b5 = BIT_GEN_ALIGNED_LOAD((VECTOR_TYPE *)&b[5][k + VECTOR_OFFSET(0)]);
+      const VECTOR_TYPE b6 = BIT_GEN_ALIGNED_LOAD((VECTOR_TYPE *)&b[6][k + VECTOR_OFFSET(0)]);
+      const VECTOR_TYPE b7 = BIT_GEN_ALIGNED_LOAD((VECTOR_TYPE *)&b[7][k + VECTOR_OFFSET(0)]);
+      s0_0 = SIMDe_VECTOR_ADD(s0_0, SIMDe_POPCOUNT(BIT_OR(a0, b0)));
+      s0_1 = SIMDe_VECTOR_ADD(s0_1, SIMDe_POPCOUNT(BIT_OR(a0, b1)));
+      s0_2 = SIMDe_VECTOR_ADD(s0_2, SIMDe_POPCOUNT(BIT_OR(a0, b2)));
+      s0_3 = SIMDe_VECTOR_ADD(s0_3, SIMDe_POPCOUNT(BIT_OR(a0, b3)));
+      s0_4 = SIMDe_VECTOR_ADD(s0_4, SIMDe_POPCOUNT(BIT_OR(a0, b4)));
+      s0_5 = SIMDe_VECTOR_ADD(s0_5, SIMDe_POPCOUNT(BIT_OR(a0, b5)));
+      s0_6 = SIMDe_VECTOR_ADD(s0_6, SIMDe_POPCOUNT(BIT_OR(a0, b6)));
+      s0_7 = SIMDe_VECTOR_ADD(s0_7, SIMDe_POPCOUNT(BIT_OR(a0, b7)));
+      s1_0 = SIMDe_VECTOR_ADD(s1_0, SIMDe_POPCOUNT(BIT_OR(a1, b0)));
+      s1_1 = SIMDe_VECTOR_ADD(s1_1, SIMDe_POPCOUNT(BIT_OR(a1, b1)));
+      s1_2 = SIMDe_VECTOR_ADD(s1_2, SIMDe_POPCOUNT(BIT_OR(a1, b2)));
+      s1_3 = SIMDe_VECTOR_ADD(s1_3, SIMDe_POPCOUNT(BIT_OR(a1, b3)));
+      s1_4 = SIMDe_VECTOR_ADD(s1_4, SIMDe_POPCOUNT(BIT_OR(a1, b4)));
+      s1_5 = SIMDe_VECTOR_ADD(s1_5, SIMDe_POPCOUNT(BIT_OR(a1, b5)));
+      s1_6 = SIMDe_VECTOR_ADD(s1_6, SIMDe_POPCOUNT(BIT_OR(a1, b6)));
+      s1_7 = SIMDe_VECTOR_ADD(s1_7, SIMDe_POPCOUNT(BIT_OR(a1, b7)));
+      s2_0 = SIMDe_VECTOR_ADD(s2_0, SIMDe_POPCOUNT(BIT_OR(a2, b0)));
+      s2_1 = SIMDe_VECTOR_ADD(s2_1, SIMDe_POPCOUNT(BIT_OR(a2, b1)));
+      s2_2 = SIMDe_VECTOR_ADD(s2_2, SIMDe_POPCOUNT(BIT_OR(a2, b2)));
+      s2_3 = SIMDe_VECTOR_ADD(s2_3, SIMDe_POPCOUNT(BIT_OR(a2, b3)));
+      s2_4 = SIMDe_VECTOR_ADD(s2_4, SIMDe_POPCOUNT(BIT_OR(a2, b4)));
+      s2_5 = SIMDe_VECTOR_ADD(s2_5, SIMDe_POPCOUNT(BIT_OR(a2, b5)));
+      s2_6 = SIMDe_VECTOR_ADD(s2_6, SIMDe_POPCOUNT(BIT_OR(a2, b6)));
+      s2_7 = SIMDe_VECTOR_ADD(s2_7, SIMDe_POPCOUNT(BIT_OR(a2, b7)));
+    }
+  }
+  uint64_t c0_0 = gen_lanes_sum(s0_0);
+  uint64_t c0_1 = gen_lanes_sum(s0_1);
+  uint64_t c0_2 = gen_lanes_sum(s0_2);
+  uint64_t c0_3 = gen_lanes_sum(s0_3);
+  uint64_t c0_4 = gen_lanes_sum(s0_4);
+  uint64_t c0_5 = gen_lanes_sum(s0_5);
+  uint64_t c0_6 = gen_lanes_sum(s0_6);
+  uint64_t c0_7 = gen_lanes_sum(s0_7);
+  uint64_t c1_0 = gen_lanes_sum(s1_0);
+  uint64_t c1_1 = gen_lanes_sum(s1_1);
+  uint64_t c1_2 = gen_lanes_sum(s1_2);
+  uint64_t c1_3 = gen_lanes_sum(s1_3);
+  uint64_t c1_4 = gen_lanes_sum(s1_4);
+  uint64_t c1_5 = gen_lanes_sum(s1_5);
+  uint64_t c1_6 = gen_lanes_sum(s1_6);
+  uint64_t c1_7 = gen_lanes_sum(s1_7);
+  uint64_t c2_0 = gen_lanes_sum(s2_0);
+  uint64_t c2_1 = gen_lanes_sum(s2_1);
+  uint64_t c2_2 = gen_lanes_sum(s2_2);
+  uint64_t c2_3 = gen_lanes_sum(s2_3);
+  uint64_t c2_4 = gen_lanes_sum(s2_4);
+  uint64_t c2_5 = gen_lanes_sum(s2_5);
+  uint64_t c2_6 = gen_lanes_sum(s2_6);
+  uint64_t c2_7 = gen_lanes_sum(s2_7);
+  for (; k < k_max; k++) {
+    const uint64_t a0 = a[0][k];
+    const uint64_t a1 = a[1][k];
+    const uint64_t a2 = a[2][k];
+    const uint64_t b0 = b[0][k];
+    const uint64_t b1 = b[1][k];
+    const uint64_t b2 = b[2][k];
+    const uint64_t b3 = b[3][k];
+    const uint64_t b4 = b[4][k];
+    const uint64_t b5 = b[5][k];
+    const uint64_t b6 = b[6][k];
+    const uint64_t b7 = b[7][k];
+    c0_0 += POPCOUNT(BIT_SCALAR_OR(a0, b0));
+    c0_1 += POPCOUNT(BIT_SCALAR_OR(a0, b1));
+    c0_2 += POPCOUNT(BIT_SCALAR_OR(a0, b2));
+    c0_3 += POPCOUNT(BIT_SCALAR_OR(a0, b3));
+    c0_4 += POPCOUNT(BIT_SCALAR_OR(a0, b4));
+    c0_5 += POPCOUNT(BIT_SCALAR_OR(a0, b5));
+    c0_6 += POPCOUNT(BIT_SCALAR_OR(a0, b6));
+    c0_7 += POPCOUNT(BIT_SCALAR_OR(a0, b7));
+    c1_0 += POPCOUNT(BIT_SCALAR_OR(a1, b0));
+    c1_1 += POPCOUNT(BIT_SCALAR_OR(a1, b1));
+    c1_2 += POPCOUNT(BIT_SCALAR_OR(a1, b2));
+    c1_3 += POPCOUNT(BIT_SCALAR_OR(a1, b3));
+    c1_4 += POPCOUNT(BIT_SCALAR_OR(a1, b4));
+    c1_5 += POPCOUNT(BIT_SCALAR_OR(a1, b5));
+    c1_6 += POPCOUNT(BIT_SCALAR_OR(a1, b6));
+    c1_7 += POPCOUNT(BIT_SCALAR_OR(a1, b7));
+    c2_0 += POPCOUNT(BIT_SCALAR_OR(a2, b0));
+    c2_1 += POPCOUNT(BIT_SCALAR_OR(a2, b1));
+    c2_2 += POPCOUNT(BIT_SCALAR_OR(a2, b2));
+    c2_3 += POPCOUNT(BIT_SCALAR_OR(a2, b3));
+    c2_4 += POPCOUNT(BIT_SCALAR_OR(a2, b4));
+    c2_5 += POPCOUNT(BIT_SCALAR_OR(a2, b5));
+    c2_6 += POPCOUNT(BIT_SCALAR_OR(a2, b6));
+    c2_7 += POPCOUNT(BIT_SCALAR_OR(a2, b7));
+  }
+  results[0][0] = (int)c0_0;
+  results[0][1] = (int)c0_1;
+  results[0][2] = (int)c0_2;
+  results[0][3] = (int)c0_3;
+  results[0][4] = (int)c0_4;
+  results[0][5] = (int)c0_5;
+  results[0][6] = (int)c0_6;
+  results[0][7] = (int)c0_7;
+  results[1][0] = (int)c1_0;
+  results[1][1] = (int)c1_1;
+  results[1][2] = (int)c1_2;
+  results[1][3] = (int)c1_3;
+  results[1][4] = (int)c1_4;
+  results[1][5] = (int)c1_5;
+  results[1][6] = (int)c1_6;
+  results[1][7] = (int)c1_7;
+  results[2][0] = (int)c2_0;
+  results[2][1] = (int)c2_1;
+  results[2][2] = (int)c2_2;
+  results[2][3] = (int)c2_3;
+  results[2][4] = (int)c2_4;
+  results[2][5] = (int)c2_5;
+  results[2][6] = (int)c2_6;
+  results[2][7] = (int)c2_7;
+#else
+  setop_count_db_cpu_kernel_outer(3, 8, 1, a, b, k_b, k_max, results, _OR,
+                                  OMP_CPU_SIMD_ALIGN_BUFFER(ALIGNMENT, setop_buffer),
+                                  BIT_GEN_ALIGNED_LOAD);
+#endif
+}
+
+static void gen_rows_or_3x8x1_aligned(const uint64_t *const *a, int ni,
+    const uint64_t *const *b, int nj, size_t k_b, size_t k_max,
+    int *restrict counts, size_t ld) {
+  SETOP_BLOCK_TILES(_OR, BIT_GEN_ALIGNED_LOAD, SETOP_INDIRECT_A, SETOP_INDIRECT_B, 3, 8,
+                    gen_block_or_3x8x1_aligned(a_rows, b_rows, k_b, k_max, results))
+}
+
+/* or, 3x8 register block, 1 vector a step, unaligned loads */
+static inline void gen_block_or_3x8x1_unaligned(
+    const uint64_t *restrict const *a, const uint64_t *restrict const *b,
+    size_t k_b, size_t k_max, int results[3][8]) {
+#if BIT_GEN_VECTOR_BLOCKS
+  const size_t step = 1 * VECTOR_QWORDS;
+  CHUNK_LIMIT(limit, k_b, k_max, step)
+  VECTOR_TYPE s0_0 = SIMDe_ZERO_VECTOR;
+  VECTOR_TYPE s0_1 = SIMDe_ZERO_VECTOR;
+  VECTOR_TYPE s0_2 = SIMDe_ZERO_VECTOR;
+  VECTOR_TYPE s0_3 = SIMDe_ZERO_VECTOR;
+  VECTOR_TYPE s0_4 = SIMDe_ZERO_VECTOR;
+  VECTOR_TYPE s0_5 = SIMDe_ZERO_VECTOR;
+  VECTOR_TYPE s0_6 = SIMDe_ZERO_VECTOR;
+  VECTOR_TYPE s0_7 = SIMDe_ZERO_VECTOR;
+  VECTOR_TYPE s1_0 = SIMDe_ZERO_VECTOR;
+  VECTOR_TYPE s1_1 = SIMDe_ZERO_VECTOR;
+  VECTOR_TYPE s1_2 = SIMDe_ZERO_VECTOR;
+  VECTOR_TYPE s1_3 = SIMDe_ZERO_VECTOR;
+  VECTOR_TYPE s1_4 = SIMDe_ZERO_VECTOR;
+  VECTOR_TYPE s1_5 = SIMDe_ZERO_VECTOR;
+  VECTOR_TYPE s1_6 = SIMDe_ZERO_VECTOR;
+  VECTOR_TYPE s1_7 = SIMDe_ZERO_VECTOR;
+  VECTOR_TYPE s2_0 = SIMDe_ZERO_VECTOR;
+  VECTOR_TYPE s2_1 = SIMDe_ZERO_VECTOR;
+  VECTOR_TYPE s2_2 = SIMDe_ZERO_VECTOR;
+  VECTOR_TYPE s2_3 = SIMDe_ZERO_VECTOR;
+  VECTOR_TYPE s2_4 = SIMDe_ZERO_VECTOR;
+  VECTOR_TYPE s2_5 = SIMDe_ZERO_VECTOR;
+  VECTOR_TYPE s2_6 = SIMDe_ZERO_VECTOR;
+  VECTOR_TYPE s2_7 = SIMDe_ZERO_VECTOR;
+  size_t k = k_b;
+  for (; k < limit; k += step) {
+    {
+      const VECTOR_TYPE a0 = VECTOR_UNALIGNED_LOAD((VECTOR_TYPE *)&a[0][k + VECTOR_OFFSET(0)]);
+      const VECTOR_TYPE a1 = VECTOR_UNALIGNED_LOAD((VECTOR_TYPE *)&a[1][k + VECTOR_OFFSET(0)]);
+      const VECTOR_TYPE a2 = VECTOR_UNALIGNED_LOAD((VECTOR_TYPE *)&a[2][k + VECTOR_OFFSET(0)]);
+      const VECTOR_TYPE b0 = VECTOR_UNALIGNED_LOAD((VECTOR_TYPE *)&b[0][k + VECTOR_OFFSET(0)]);
+      const VECTOR_TYPE b1 = VECTOR_UNALIGNED_LOAD((VECTOR_TYPE *)&b[1][k + VECTOR_OFFSET(0)]);
+      const VECTOR_TYPE b2 = VECTOR_UNALIGNED_LOAD((VECTOR_TYPE *)&b[2][k + VECTOR_OFFSET(0)]);
+      const VECTOR_TYPE b3 = VECTOR_UNALIGNED_LOAD((VECTOR_TYPE *)&b[3][k + VECTOR_OFFSET(0)]);
+      const VECTOR_TYPE b4 = VECTOR_UNALIGNED_LOAD((VECTOR_TYPE *)&b[4][k + VECTOR_OFFSET(0)]);
+      const VECTOR_TYPE b5 = VECTOR_UNALIGNED_LOAD((VECTOR_TYPE *)&b[5][k + VECTOR_OFFSET(0)]);
+      const VECTOR_TYPE b6 = VECTOR_UNALIGNED_LOAD((VECTOR_TYPE *)&b[6][k + VECTOR_OFFSET(0)]);
+      const VECTOR_TYPE b7 = VECTOR_UNALIGNED_LOAD((VECTOR_TYPE *)&b[7][k + VECTOR_OFFSET(0)]);
+      s0_0 = SIMDe_VECTOR_ADD(s0_0, SIMDe_POPCOUNT(BIT_OR(a0, b0)));
+      s0_1 = SIMDe_VECTOR_ADD(s0_1, SIMDe_POPCOUNT(BIT_OR(a0, b1)));
+      s0_2 = SIMDe_VECTOR_ADD(s0_2, SIMDe_POPCOUNT(BIT_OR(a0, b2)));
+      s0_3 = SIMDe_VECTOR_ADD(s0_3, SIMDe_POPCOUNT(BIT_OR(a0, b3)));
+      s0_4 = SIMDe_VECTOR_ADD(s0_4, SIMDe_POPCOUNT(BIT_OR(a0, b4)));
+      s0_5 = SIMDe_VECTOR_ADD(s0_5, SIMDe_POPCOUNT(BIT_OR(a0, b5)));
+      s0_6 = SIMDe_VECTOR_ADD(s0_6, SIMDe_POPCOUNT(BIT_OR(a0, b6)));
+      s0_7 = SIMDe_VECTOR_ADD(s0_7, SIMDe_POPCOUNT(BIT_OR(a0, b7)));
+      s1_0 = SIMDe_VECTOR_ADD(s1_0, SIMDe_POPCOUNT(BIT_OR(a1, b0)));
+      s1_1 = SIMDe_VECTOR_ADD(s1_1, SIMDe_POPCOUNT(BIT_OR(a1, b1)));
+      s1_2 = SIMDe_VECTOR_ADD(s1_2, SIMDe_POPCOUNT(BIT_OR(a1, b2)));
+      s1_3 = SIMDe_VECTOR_ADD(s1_3, SIMDe_POPCOUNT(BIT_OR(a1, b3)));
+      s1_4 = SIMDe_VECTOR_ADD(s1_4, SIMDe_POPCOUNT(BIT_OR(a1, b4)));
+      s1_5 = SIMDe_VECTOR_ADD(s1_5, SIMDe_POPCOUNT(BIT_OR(a1, b5)));
+      s1_6 = SIMDe_VECTOR_ADD(s1_6, SIMDe_POPCOUNT(BIT_OR(a1, b6)));
+      s1_7 = SIMDe_VECTOR_ADD(s1_7, SIMDe_POPCOUNT(BIT_OR(a1, b7)));
+      s2_0 = SIMDe_VECTOR_ADD(s2_0, SIMDe_POPCOUNT(BIT_OR(a2, b0)));
+      s2_1 = SIMDe_VECTOR_ADD(s2_1, SIMDe_POPCOUNT(BIT_OR(a2, b1)));
+      s2_2 = SIMDe_VECTOR_ADD(s2_2, SIMDe_POPCOUNT(BIT_OR(a2, b2)));
+      s2_3 = SIMDe_VECTOR_ADD(s2_3, SIMDe_POPCOUNT(BIT_OR(a2, b3)));
+      s2_4 = SIMDe_VECTOR_ADD(s2_4, SIMDe_POPCOUNT(BIT_OR(a2, b4)));
+      s2_5 = SIMDe_VECTOR_ADD(s2_5, SIMDe_POPCOUNT(BIT_OR(a2, b5)));
+      s2_6 = SIMDe_VECTOR_ADD(s2_6, SIMDe_POPCOUNT(BIT_OR(a2, b6)));
+      s2_7 = SIMDe_VECTOR_ADD(s2_7, SIMDe_POPCOUNT(BIT_OR(a2, b7)));
+    }
+  }
+  uint64_t c0_0 = gen_lanes_sum(s0_0);
+  uint64_t c0_1 = gen_lanes_sum(s0_1);
+  uint64_t c0_2 = gen_lanes_sum(s0_2);
+  uint64_t c0_3 = gen_lanes_sum(s0_3);
+  uint64_t c0_4 = gen_lanes_sum(s0_4);
+  uint64_t c0_5 = gen_lanes_sum(s0_5);
+  uint64_t c0_6 = gen_lanes_sum(s0_6);
+  uint64_t c0_7 = gen_lanes_sum(s0_7);
+  uint64_t c1_0 = gen_lanes_sum(s1_0);
+  uint64_t c1_1 = gen_lanes_sum(s1_1);
+  uint64_t c1_2 = gen_lanes_sum(s1_2);
+  uint64_t c1_3 = gen_lanes_sum(s1_3);
+  uint64_t c1_4 = gen_lanes_sum(s1_4);
+  uint64_t c1_5 = gen_lanes_sum(s1_5);
+  uint64_t c1_6 = gen_lanes_sum(s1_6);
+  uint64_t c1_7 = gen_lanes_sum(s1_7);
+  uint64_t c2_0 = gen_lanes_sum(s2_0);
+  uint64_t c2_1 = gen_lanes_sum(s2_1);
+  uint64_t c2_2 = gen_lanes_sum(s2_2);
+  uint64_t c2_3 = gen_lanes_sum(s2_3);
+  uint64_t c2_4 = gen_lanes_sum(s2_4);
+  uint64_t c2_5 = gen_lanes_sum(s2_5);
+  uint64_t c2_6 = gen_lanes_sum(s2_6);
+  uint64_t c2_7 = gen_lanes_sum(s2_7);
+  for (; k < k_max; k++) {
+    const uint64_t a0 = a[0][k];
+    const uint64_t a1 = a[1][k];
+    const uint64_t a2 = a[2][k];
+    const uint64_t b0 = b[0][k];
+    const uint64_t b1 = b[1][k];
+    const uint64_t b2 = b[2][k];
+    const uint64_t b3 = b[3][k];
+    const uint64_t b4 = b[4][k];
+    const uint64_t b5 = b[5][k];
+    const uint64_t b6 = b[6][k];
+    const uint64_t b7 = b[7][k];
+    c0_0 += POPCOUNT(BIT_SCALAR_OR(a0, b0));
+    c0_1 += POPCOUNT(BIT_SCALAR_OR(a0, b1));
+    c0_2 += POPCOUNT(BIT_SCALAR_OR(a0, b2));
+    c0_3 += POPCOUNT(BIT_SCALAR_OR(a0, b3));
+    c0_4 += POPCOUNT(BIT_SCALAR_OR(a0, b4));
+    c0_5 += POPCOUNT(BIT_SCALAR_OR(a0, b5));
+    c0_6 += POPCOUNT(BIT_SCALAR_OR(a0, b6));
+    c0_7 += POPCOUNT(BIT_SCALAR_OR(a0, b7));
+    c1_0 += POPCOUNT(BIT_SCALAR_OR(a1, b0));
+    c1_1 += POPCOUNT(BIT_SCALAR_OR(a1, b1));
+    c1_2 += POPCOUNT(BIT_SCALAR_OR(a1, b2));
+    c1_3 += POPCOUNT(BIT_SCALAR_OR(a1, b3));
+    c1_4 += POPCOUNT(BIT_SCALAR_OR(a1, b4));
+    c1_5 += POPCOUNT(BIT_SCALAR_OR(a1, b5));
+    c1_6 += POPCOUNT(BIT_SCALAR_OR(a1, b6));
+    c1_7 += POPCOUNT(BIT_SCALAR_OR(a1, b7));
+    c2_0 += POPCOUNT(BIT_SCALAR_OR(a2, b0));
+    c2_1 += POPCOUNT(BIT_SCALAR_OR(a2, b1));
+    c2_2 += POPCOUNT(BIT_SCALAR_OR(a2, b2));
+    c2_3 += POPCOUNT(BIT_SCALAR_OR(a2, b3));
+    c2_4 += POPCOUNT(BIT_SCALAR_OR(a2, b4));
+    c2_5 += POPCOUNT(BIT_SCALAR_OR(a2, b5));
+    c2_6 += POPCOUNT(BIT_SCALAR_OR(a2, b6));
+    c2_7 += POPCOUNT(BIT_SCALAR_OR(a2, b7));
+  }
+  results[0][0] = (int)c0_0;
+  results[0][1] = (int)c0_1;
+  results[0][2] = (int)c0_2;
+  results[0][3] = (int)c0_3;
+  results[0][4] = (int)c0_4;
+  results[0][5] = (int)c0_5;
+  results[0][6] = (int)c0_6;
+  results[0][7] = (int)c0_7;
+  results[1][0] = (int)c1_0;
+  results[1][1] = (int)c1_1;
+  results[1][2] = (int)c1_2;
+  results[1][3] = (int)c1_3;
+  results[1][4] = (int)c1_4;
+  results[1][5] = (int)c1_5;
+  results[1][6] = (int)c1_6;
+  results[1][7] = (int)c1_7;
+  results[2][0] = (int)c2_0;
+  results[2][1] = (int)c2_1;
+  results[2][2] = (int)c2_2;
+  results[2][3] = (int)c2_3;
+  results[2][4] = (int)c2_4;
+  results[2][5] = (int)c2_5;
+  results[2][6] = (int)c2_6;
+  results[2][7] = (int)c2_7;
+#else
+  setop_count_db_cpu_kernel_outer(3, 8, 1, a, b, k_b, k_max, results, _OR,
+                                  OMP_CPU_SIMD_ALIGN_BUFFER(ALIGNMENT, setop_buffer),
+                                  VECTOR_UNALIGNED_LOAD);
+#endif
+}
+
+static void gen_rows_or_3x8x1_unaligned(const uint64_t *const *a, int ni,
+    const uint64_t *const *b, int nj, size_t k_b, size_t k_max,
+    int *restrict counts, size_t ld) {
+  SETOP_BLOCK_TILES(_OR, VECTOR_UNALIGNED_LOAD, SETOP_INDIRECT_A, SETOP_INDIRECT_B, 3, 8,
+                    gen_block_or_3x8x1_unaligned(a_rows, b_rows, k_b, k_max, results))
+}
+
+/* xor, 3x8 register block, 1 vector a step, aligned loads */
+static inline void gen_block_xor_3x8x1_aligned(
+    const uint64_t *restrict const *a, const uint64_t *restrict const *b,
+    size_t k_b, size_t k_max, int results[3][8]) {
+#if BIT_GEN_VECTOR_BLOCKS
+  const size_t step = 1 * VECTOR_QWORDS;
+  CHUNK_LIMIT(limit, k_b, k_max, step)
+  VECTOR_TYPE s0_0 = SIMDe_ZERO_VECTOR;
+  VECTOR_TYPE s0_1 = SIMDe_ZERO_VECTOR;
+  VECTOR_TYPE s0_2 = SIMDe_ZERO_VECTOR;
+  VECTOR_TYPE s0_3 = SIMDe_ZERO_VECTOR;
+  VECTOR_TYPE s0_4 = SIMDe_ZERO_VECTOR;
+  VECTOR_TYPE s0_5 = SIMDe_ZERO_VECTOR;
+  VECTOR_TYPE s0_6 = SIMDe_ZERO_VECTOR;
+  VECTOR_TYPE s0_7 = SIMDe_ZERO_VECTOR;
+  VECTOR_TYPE s1_0 = SIMDe_ZERO_VECTOR;
+  VECTOR_TYPE s1_1 = SIMDe_ZERO_VECTOR;
+  VECTOR_TYPE s1_2 = SIMDe_ZERO_VECTOR;
+  VECTOR_TYPE s1_3 = SIMDe_ZERO_VECTOR;
+  VECTOR_TYPE s1_4 = SIMDe_ZERO_VECTOR;
+  VECTOR_TYPE s1_5 = SIMDe_ZERO_VECTOR;
+  VECTOR_TYPE s1_6 = SIMDe_ZERO_VECTOR;
+  VECTOR_TYPE s1_7 = SIMDe_ZERO_VECTOR;
+  VECTOR_TYPE s2_0 = SIMDe_ZERO_VECTOR;
+  VECTOR_TYPE s2_1 = SIMDe_ZERO_VECTOR;
+  VECTOR_TYPE s2_2 = SIMDe_ZERO_VECTOR;
+  VECTOR_TYPE s2_3 = SIMDe_ZERO_VECTOR;
+  VECTOR_TYPE s2_4 = SIMDe_ZERO_VECTOR;
+  VECTOR_TYPE s2_5 = SIMDe_ZERO_VECTOR;
+  VECTOR_TYPE s2_6 = SIMDe_ZERO_VECTOR;
+  VECTOR_TYPE s2_7 = SIMDe_ZERO_VECTOR;
+  size_t k = k_b;
+  for (; k < limit; k += step) {
+    {
+      const VECTOR_TYPE a0 = BIT_GEN_ALIGNED_LOAD((VECTOR_TYPE *)&a[0][k + VECTOR_OFFSET(0)]);
+      const VECTOR_TYPE a1 = BIT_GEN_ALIGNED_LOAD((VECTOR_TYPE *)&a[1][k + VECTOR_OFFSET(0)]);
+      const VECTOR_TYPE a2 = BIT_GEN_ALIGNED_LOAD((VECTOR_TYPE *)&a[2][k + VECTOR_OFFSET(0)]);
+      const VECTOR_TYPE b0 = BIT_GEN_ALIGNED_LOAD((VECTOR_TYPE *)&b[0][k + VECTOR_OFFSET(0)]);
+      const VECTOR_TYPE b1 = BIT_GEN_ALIGNED_LOAD((VECTOR_TYPE *)&b[1][k + VECTOR_OFFSET(0)]);
+      const VECTOR_TYPE b2 = BIT_GEN_ALIGNED_LOAD((VECTOR_TYPE *)&b[2][k + VECTOR_OFFSET(0)]);
+      const VECTOR_TYPE b3 = BIT_GEN_ALIGNED_LOAD((VECTOR_TYPE *)&b[3][k + VECTOR_OFFSET(0)]);
+      const VECTOR_TYPE b4 = BIT_GEN_ALIGNED_LOAD((VECTOR_TYPE *)&b[4][k + VECTOR_OFFSET(0)]);
+      const VECTOR_TYPE b5 = BIT_GEN_ALIGNED_LOAD((VECTOR_TYPE *)&b[5][k + VECTOR_OFFSET(0)]);
+      const VECTOR_TYPE b6 = BIT_GEN_ALIGNED_LOAD((VECTOR_TYPE *)&b[6][k + VECTOR_OFFSET(0)]);
+      const VECTOR_TYPE b7 = BIT_GEN_ALIGNED_LOAD((VECTOR_TYPE *)&b[7][k + VECTOR_OFFSET(0)]);
+      s0_0 = SIMDe_VECTOR_ADD(s0_0, SIMDe_POPCOUNT(BIT_XOR(a0, b0)));
+      s0_1 = SIMDe_VECTOR_ADD(s0_1, SIMDe_POPCOUNT(BIT_XOR(a0, b1)));
+      s0_2 = SIMDe_VECTOR_ADD(s0_2, SIMDe_POPCOUNT(BIT_XOR(a0, b2)));
+      s0_3 = SIMDe_VECTOR_ADD(s0_3, SIMDe_POPCOUNT(BIT_XOR(a0, b3)));
+      s0_4 = SIMDe_VECTOR_ADD(s0_4, SIMDe_POPCOUNT(BIT_XOR(a0, b4)));
+      s0_5 = SIMDe_VECTOR_ADD(s0_5, SIMDe_POPCOUNT(BIT_XOR(a0, b5)));
+      s0_6 = SIMDe_VECTOR_ADD(s0_6, SIMDe_POPCOUNT(BIT_XOR(a0, b6)));
+      s0_7 = SIMDe_VECTOR_ADD(s0_7, SIMDe_POPCOUNT(BIT_XOR(a0, b7)));
+      s1_0 = SIMDe_VECTOR_ADD(s1_0, SIMDe_POPCOUNT(BIT_XOR(a1, b0)));
+      s1_1 = SIMDe_VECTOR_ADD(s1_1, SIMDe_POPCOUNT(BIT_XOR(a1, b1)));
+      s1_2 = SIMDe_VECTOR_ADD(s1_2, SIMDe_POPCOUNT(BIT_XOR(a1, b2)));
+      s1_3 = SIMDe_VECTOR_ADD(s1_3, SIMDe_POPCOUNT(BIT_XOR(a1, b3)));
+      s1_4 = SIMDe_VECTOR_ADD(s1_4, SIMDe_POPCOUNT(BIT_XOR(a1, b4)));
+      s1_5 = SIMDe_VECTOR_ADD(s1_5, SIMDe_POPCOUNT(BIT_XOR(a1, b5)));
+      s1_6 = SIMDe_VECTOR_ADD(s1_6, SIMDe_POPCOUNT(BIT_XOR(a1, b6)));
+      s1_7 = SIMDe_VECTOR_ADD(s1_7, SIMDe_POPCOUNT(BIT_XOR(a1, b7)));
+      s2_0 = SIMDe_VECTOR_ADD(s2_0, SIMDe_POPCOUNT(BIT_XOR(a2, b0)));
+      s2_1 = SIMDe_VECTOR_ADD(s2_1, SIMDe_POPCOUNT(BIT_XOR(a2, b1)));
+      s2_2 = SIMDe_VECTOR_ADD(s2_2, SIMDe_POPCOUNT(BIT_XOR(a2, b2)));
+      s2_3 = SIMDe_VECTOR_ADD(s2_3, SIMDe_POPCOUNT(BIT_XOR(a2, b3)));
+      s2_4 = SIMDe_VECTOR_ADD(s2_4, SIMDe_POPCOUNT(BIT_XOR(a2, b4)));
+      s2_5 = SIMDe_VECTOR_ADD(s2_5, SIMDe_POPCOUNT(BIT_XOR(a2, b5)));
+      s2_6 = SIMDe_VECTOR_ADD(s2_6, SIMDe_POPCOUNT(BIT_XOR(a2, b6)));
+      s2_7 = SIMDe_VECTOR_ADD(s2_7, SIMDe_POPCOUNT(BIT_XOR(a2, b7)));
+    }
+  }
+  uint64_t c0_0 = gen_lanes_sum(s0_0);
+  uint64_t c0_1 = gen_lanes_sum(s0_1);
+  uint64_t c0_2 = gen_lanes_sum(s0_2);
+  uint64_t c0_3 = gen_lanes_sum(s0_3);
+  uint64_t c0_4 = gen_lanes_sum(s0_4);
+  uint64_t c0_5 = gen_lanes_sum(s0_5);
+  uint64_t c0_6 = gen_lanes_sum(s0_6);
+  uint64_t c0_7 = gen_lanes_sum(s0_7);
+  uint64_t c1_0 = gen_lanes_sum(s1_0);
+  uint64_t c1_1 = gen_lanes_sum(s1_1);
+  uint64_t c1_2 = gen_lanes_sum(s1_2);
+  uint64_t c1_3 = gen_lanes_sum(s1_3);
+  uint64_t c1_4 = gen_lanes_sum(s1_4);
+  uint64_t c1_5 = gen_lanes_sum(s1_5);
+  uint64_t c1_6 = gen_lanes_sum(s1_6);
+  uint64_t c1_7 = gen_lanes_sum(s1_7);
+  uint64_t c2_0 = gen_lanes_sum(s2_0);
+  uint64_t c2_1 = gen_lanes_sum(s2_1);
+  uint64_t c2_2 = gen_lanes_sum(s2_2);
+  uint64_t c2_3 = gen_lanes_sum(s2_3);
+  uint64_t c2_4 = gen_lanes_sum(s2_4);
+  uint64_t c2_5 = gen_lanes_sum(s2_5);
+  uint64_t c2_6 = gen_lanes_sum(s2_6);
+  uint64_t c2_7 = gen_lanes_sum(s2_7);
+  for (; k < k_max; k++) {
+    const uint64_t a0 = a[0][k];
+    const uint64_t a1 = a[1][k];
+    const uint64_t a2 = a[2][k];
+    const uint64_t b0 = b[0][k];
+    const uint64_t b1 = b[1][k];
+    const uint64_t b2 = b[2][k];
+    const uint64_t b3 = b[3][k];
+    const uint64_t b4 = b[4][k];
+    const uint64_t b5 = b[5][k];
+    const uint64_t b6 = b[6][k];
+    const uint64_t b7 = b[7][k];
+    c0_0 += POPCOUNT(BIT_SCALAR_XOR(a0, b0));
+    c0_1 += POPCOUNT(BIT_SCALAR_XOR(a0, b1));
+    c0_2 += POPCOUNT(BIT_SCALAR_XOR(a0, b2));
+    c0_3 += POPCOUNT(BIT_SCALAR_XOR(a0, b3));
+    c0_4 += POPCOUNT(BIT_SCALAR_XOR(a0, b4));
+    c0_5 += POPCOUNT(BIT_SCALAR_XOR(a0, b5));
+    c0_6 += POPCOUNT(BIT_SCALAR_XOR(a0, b6));
+    c0_7 += POPCOUNT(BIT_SCALAR_XOR(a0, b7));
+    c1_0 += POPCOUNT(BIT_SCALAR_XOR(a1, b0));
+    c1_1 += POPCOUNT(BIT_SCALAR_XOR(a1, b1));
+    c1_2 += POPCOUNT(BIT_SCALAR_XOR(a1, b2));
+    c1_3 += POPCOUNT(BIT_SCALAR_XOR(a1, b3));
+    c1_4 += POPCOUNT(BIT_SCALAR_XOR(a1, b4));
+    c1_5 += POPCOUNT(BIT_SCALAR_XOR(a1, b5));
+    c1_6 += POPCOUNT(BIT_SCALAR_XOR(a1, b6));
+    c1_7 += POPCOUNT(BIT_SCALAR_XOR(a1, b7));
+    c2_0 += POPCOUNT(BIT_SCALAR_XOR(a2, b0));
+    c2_1 += POPCOUNT(BIT_SCALAR_XOR(a2, b1));
+    c2_2 += POPCOUNT(BIT_SCALAR_XOR(a2, b2));
+    c2_3 += POPCOUNT(BIT_SCALAR_XOR(a2, b3));
+    c2_4 += POPCOUNT(BIT_SCALAR_XOR(a2, b4));
+    c2_5 += POPCOUNT(BIT_SCALAR_XOR(a2, b5));
+    c2_6 += POPCOUNT(BIT_SCALAR_XOR(a2, b6));
+    c2_7 += POPCOUNT(BIT_SCALAR_XOR(a2, b7));
+  }
+  results[0][0] = (int)c0_0;
+  results[0][1] = (int)c0_1;
+  results[0][2] = (int)c0_2;
+  results[0][3] = (int)c0_3;
+  results[0][4] = (int)c0_4;
+  results[0][5] = (int)c0_5;
+  results[0][6] = (int)c0_6;
+  results[0][7] = (int)c0_7;
+  results[1][0] = (int)c1_0;
+  results[1][1] = (int)c1_1;
+  results[1][2] = (int)c1_2;
+  results[1][3] = (int)c1_3;
+  results[1][4] = (int)c1_4;
+  results[1][5] = (int)c1_5;
+  results[1][6] = (int)c1_6;
+  results[1][7] = (int)c1_7;
+  results[2][0] = (int)c2_0;
+  results[2][1] = (int)c2_1;
+  results[2][2] = (int)c2_2;
+  results[2][3] = (int)c2_3;
+  results[2][4] = (int)c2_4;
+  results[2][5] = (int)c2_5;
+  results[2][6] = (int)c2_6;
+  results[2][7] = (int)c2_7;
+#else
+  setop_count_db_cpu_kernel_outer(3, 8, 1, a, b, k_b, k_max, results, _XOR,
+                                  OMP_CPU_SIMD_ALIGN_BUFFER(ALIGNMENT, setop_buffer),
+                                  BIT_GEN_ALIGNED_LOAD);
+#endif
+}
+
+static void gen_rows_xor_3x8x1_aligned(const uint64_t *const *a, int ni,
+    const uint64_t *const *b, int nj, size_t k_b, size_t k_max,
+    int *restrict counts, size_t ld) {
+  SETOP_BLOCK_TILES(_XOR, BIT_GEN_ALIGNED_LOAD, SETOP_INDIRECT_A, SETOP_INDIRECT_B, 3, 8,
+                    gen_block_xor_3x8x1_aligned(a_rows, b_rows, k_b, k_max, results))
+}
+
+/* xor, 3x8 register block, 1 vector a step, unaligned loads */
+static inline void gen_block_xor_3x8x1_unaligned(
+    const uint64_t *restrict const *a, const uint64_t *restrict const *b,
+    size_t k_b, size_t k_max, int results[3][8]) {
+#if BIT_GEN_VECTOR_BLOCKS
+  const size_t step = 1 * VECTOR_QWORDS;
+  CHUNK_LIMIT(limit, k_b, k_max, step)
+  VECTOR_TYPE s0_0 = SIMDe_ZERO_VECTOR;
+  VECTOR_TYPE s0_1 = SIMDe_ZERO_VECTOR;
+  VECTOR_TYPE s0_2 = SIMDe_ZERO_VECTOR;
+  VECTOR_TYPE s0_3 = SIMDe_ZERO_VECTOR;
+  VECTOR_TYPE s0_4 = SIMDe_ZERO_VECTOR;
+  VECTOR_TYPE s0_5 = SIMDe_ZERO_VECTOR;
+  VECTOR_TYPE s0_6 = SIMDe_ZERO_VECTOR;
+  VECTOR_TYPE s0_7 = SIMDe_ZERO_VECTOR;
+  VECTOR_TYPE s1_0 = SIMDe_ZERO_VECTOR;
+  VECTOR_TYPE s1_1 = SIMDe_ZERO_VECTOR;
+  VECTOR_TYPE s1_2 = SIMDe_ZERO_VECTOR;
+  VECTOR_TYPE s1_3 = SIMDe_ZERO_VECTOR;
+  VECTOR_TYPE s1_4 = SIMDe_ZERO_VECTOR;
+  VECTOR_TYPE s1_5 = SIMDe_ZERO_VECTOR;
+  VECTOR_TYPE s1_6 = SIMDe_ZERO_VECTOR;
+  VECTOR_TYPE s1_7 = SIMDe_ZERO_VECTOR;
+  VECTOR_TYPE s2_0 = SIMDe_ZERO_VECTOR;
+  VECTOR_TYPE s2_1 = SIMDe_ZERO_VECTOR;
+  VECTOR_TYPE s2_2 = SIMDe_ZERO_VECTOR;
+  VECTOR_TYPE s2_3 = SIMDe_ZERO_VECTOR;
+  VECTOR_TYPE s2_4 = SIMDe_ZERO_VECTOR;
+  VECTOR_TYPE s2_5 = SIMDe_ZERO_VECTOR;
+  VECTOR_TYPE s2_6 = SIMDe_ZERO_VECTOR;
+  VECTOR_TYPE s2_7 = SIMDe_ZERO_VECTOR;
+  size_t k = k_b;
+  for (; k < limit; k += step) {
+    {
+      const VECTOR_TYPE a0 = VECTOR_UNALIGNED_LOAD((VECTOR_TYPE *)&a[0][k + VECTOR_OFFSET(0)]);
+      const VECTOR_TYPE a1 = VECTOR_UNALIGNED_LOAD((VECTOR_TYPE *)&a[1][k + VECTOR_OFFSET(0)]);
+      const VECTOR_TYPE a2 = VECTOR_UNALIGNED_LOAD((VECTOR_TYPE *)&a[2][k + VECTOR_OFFSET(0)]);
+      const VECTOR_TYPE b0 = VECTOR_UNALIGNED_LOAD((VECTOR_TYPE *)&b[0][k + VECTOR_OFFSET(0)]);
+      const VECTOR_TYPE b1 = VECTOR_UNALIGNED_LOAD((VECTOR_TYPE *)&b[1][k + VECTOR_OFFSET(0)]);
+      const VECTOR_TYPE b2 = VECTOR_UNALIGNED_LOAD((VECTOR_TYPE *)&b[2][k + VECTOR_OFFSET(0)]);
+      const VECTOR_TYPE b3 = VECTOR_UNALIGNED_LOAD((VECTOR_TYPE *)&b[3][k + VECTOR_OFFSET(0)]);
+      const VECTOR_TYPE b4 = VECTOR_UNALIGNED_LOAD((VECTOR_TYPE *)&b[4][k + VECTOR_OFFSET(0)]);
+      const VECTOR_TYPE b5 = VECTOR_UNALIGNED_LOAD((VECTOR_TYPE *)&b[5][k + VECTOR_OFFSET(0)]);
+      const VECTOR_TYPE b6 = VECTOR_UNALIGNED_LOAD((VECTOR_TYPE *)&b[6][k + VECTOR_OFFSET(0)]);
+      const VECTOR_TYPE b7 = VECTOR_UNALIGNED_LOAD((VECTOR_TYPE *)&b[7][k + VECTOR_OFFSET(0)]);
+      s0_0 = SIMDe_VECTOR_ADD(s0_0, SIMDe_POPCOUNT(BIT_XOR(a0, b0)));
+      s0_1 = SIMDe_VECTOR_ADD(s0_1, SIMDe_POPCOUNT(BIT_XOR(a0, b1)));
+      s0_2 = SIMDe_VECTOR_ADD(s0_2, SIMDe_POPCOUNT(BIT_XOR(a0, b2)));
+      s0_3 = SIMDe_VECTOR_ADD(s0_3, SIMDe_POPCOUNT(BIT_XOR(a0, b3)));
+      s0_4 = SIMDe_VECTOR_ADD(s0_4, SIMDe_POPCOUNT(BIT_XOR(a0, b4)));
+      s0_5 = SIMDe_VECTOR_ADD(s0_5, SIMDe_POPCOUNT(BIT_XOR(a0, b5)));
+      s0_6 = SIMDe_VECTOR_ADD(s0_6, SIMDe_POPCOUNT(BIT_XOR(a0, b6)));
+      s0_7 = SIMDe_VECTOR_ADD(s0_7, SIMDe_POPCOUNT(BIT_XOR(a0, b7)));
+      s1_0 = SIMDe_VECTOR_ADD(s1_0, SIMDe_POPCOUNT(BIT_XOR(a1, b0)));
+      s1_1 = SIMDe_VECTOR_ADD(s1_1, SIMDe_POPCOUNT(BIT_XOR(a1, b1)));
+      s1_2 = SIMDe_VECTOR_ADD(s1_2, SIMDe_POPCOUNT(BIT_XOR(a1, b2)));
+      s1_3 = SIMDe_VECTOR_ADD(s1_3, SIMDe_POPCOUNT(BIT_XOR(a1, b3)));
+      s1_4 = SIMDe_VECTOR_ADD(s1_4, SIMDe_POPCOUNT(BIT_XOR(a1, b4)));
+      s1_5 = SIMDe_VECTOR_ADD(s1_5, SIMDe_POPCOUNT(BIT_XOR(a1, b5)));
+      s1_6 = SIMDe_VECTOR_ADD(s1_6, SIMDe_POPCOUNT(BIT_XOR(a1, b6)));
+      s1_7 = SIMDe_VECTOR_ADD(s1_7, SIMDe_POPCOUNT(BIT_XOR(a1, b7)));
+      s2_0 = SIMDe_VECTOR_ADD(s2_0, SIMDe_POPCOUNT(BIT_XOR(a2, b0)));
+      s2_1 = SIMDe_VECTOR_ADD(s2_1, SIMDe_POPCOUNT(BIT_XOR(a2, b1)));
+      s2_2 = SIMDe_VECTOR_ADD(s2_2, SIMDe_POPCOUNT(BIT_XOR(a2, b2)));
+      s2_3 = SIMDe_VECTOR_ADD(s2_3, SIMDe_POPCOUNT(BIT_XOR(a2, b3)));
+      s2_4 = SIMDe_VECTOR_ADD(s2_4, SIMDe_POPCOUNT(BIT_XOR(a2, b4)));
+      s2_5 = SIMDe_VECTOR_ADD(s2_5, SIMDe_POPCOUNT(BIT_XOR(a2, b5)));
+      s2_6 = SIMDe_VECTOR_ADD(s2_6, SIMDe_POPCOUNT(BIT_XOR(a2, b6)));
+      s2_7 = SIMDe_VECTOR_ADD(s2_7, SIMDe_POPCOUNT(BIT_XOR(a2, b7)));
+    }
+  }
+  uint64_t c0_0 = gen_lanes_sum(s0_0);
+  uint64_t c0_1 = gen_lanes_sum(s0_1);
+  uint64_t c0_2 = gen_lanes_sum(s0_2);
+  uint64_t c0_3 = gen_lanes_sum(s0_3);
+  uint64_t c0_4 = gen_lanes_sum(s0_4);
+  uint64_t c0_5 = gen_lanes_sum(s0_5);
+  uint64_t c0_6 = gen_lanes_sum(s0_6);
+  uint64_t c0_7 = gen_lanes_sum(s0_7);
+  uint64_t c1_0 = gen_lanes_sum(s1_0);
+  uint64_t c1_1 = gen_lanes_sum(s1_1);
+  uint64_t c1_2 = gen_lanes_sum(s1_2);
+  uint64_t c1_3 = gen_lanes_sum(s1_3);
+  uint64_t c1_4 = gen_lanes_sum(s1_4);
+  uint64_t c1_5 = gen_lanes_sum(s1_5);
+  uint64_t c1_6 = gen_lanes_sum(s1_6);
+  uint64_t c1_7 = gen_lanes_sum(s1_7);
+  uint64_t c2_0 = gen_lanes_sum(s2_0);
+  uint64_t c2_1 = gen_lanes_sum(s2_1);
+  uint64_t c2_2 = gen_lanes_sum(s2_2);
+  uint64_t c2_3 = gen_lanes_sum(s2_3);
+  uint64_t c2_4 = gen_lanes_sum(s2_4);
+  uint64_t c2_5 = gen_lanes_sum(s2_5);
+  uint64_t c2_6 = gen_lanes_sum(s2_6);
+  uint64_t c2_7 = gen_lanes_sum(s2_7);
+  for (; k < k_max; k++) {
+    const uint64_t a0 = a[0][k];
+    const uint64_t a1 = a[1][k];
+    const uint64_t a2 = a[2][k];
+    const uint64_t b0 = b[0][k];
+    const uint64_t b1 = b[1][k];
+    const uint64_t b2 = b[2][k];
+    const uint64_t b3 = b[3][k];
+    const uint64_t b4 = b[4][k];
+    const uint64_t b5 = b[5][k];
+    const uint64_t b6 = b[6][k];
+    const uint64_t b7 = b[7][k];
+    c0_0 += POPCOUNT(BIT_SCALAR_XOR(a0, b0));
+    c0_1 += POPCOUNT(BIT_SCALAR_XOR(a0, b1));
+    c0_2 += POPCOUNT(BIT_SCALAR_XOR(a0, b2));
+    c0_3 += POPCOUNT(BIT_SCALAR_XOR(a0, b3));
+    c0_4 += POPCOUNT(BIT_SCALAR_XOR(a0, b4));
+    c0_5 += POPCOUNT(BIT_SCALAR_XOR(a0, b5));
+    c0_6 += POPCOUNT(BIT_SCALAR_XOR(a0, b6));
+    c0_7 += POPCOUNT(BIT_SCALAR_XOR(a0, b7));
+    c1_0 += POPCOUNT(BIT_SCALAR_XOR(a1, b0));
+    c1_1 += POPCOUNT(BIT_SCALAR_XOR(a1, b1));
+    c1_2 += POPCOUNT(BIT_SCALAR_XOR(a1, b2));
+    c1_3 += POPCOUNT(BIT_SCALAR_XOR(a1, b3));
+    c1_4 += POPCOUNT(BIT_SCALAR_XOR(a1, b4));
+    c1_5 += POPCOUNT(BIT_SCALAR_XOR(a1, b5));
+    c1_6 += POPCOUNT(BIT_SCALAR_XOR(a1, b6));
+    c1_7 += POPCOUNT(BIT_SCALAR_XOR(a1, b7));
+    c2_0 += POPCOUNT(BIT_SCALAR_XOR(a2, b0));
+    c2_1 += POPCOUNT(BIT_SCALAR_XOR(a2, b1));
+    c2_2 += POPCOUNT(BIT_SCALAR_XOR(a2, b2));
+    c2_3 += POPCOUNT(BIT_SCALAR_XOR(a2, b3));
+    c2_4 += POPCOUNT(BIT_SCALAR_XOR(a2, b4));
+    c2_5 += POPCOUNT(BIT_SCALAR_XOR(a2, b5));
+    c2_6 += POPCOUNT(BIT_SCALAR_XOR(a2, b6));
+    c2_7 += POPCOUNT(BIT_SCALAR_XOR(a2, b7));
+  }
+  results[0][0] = (int)c0_0;
+  results[0][1] = (int)c0_1;
+  results[0][2] = (int)c0_2;
+  results[0][3] = (int)c0_3;
+  results[0][4] = (int)c0_4;
+  results[0][5] = (int)c0_5;
+  results[0][6] = (int)c0_6;
+  results[0][7] = (int)c0_7;
+  results[1][0] = (int)c1_0;
+  results[1][1] = (int)c1_1;
+  results[1][2] = (int)c1_2;
+  results[1][3] = (int)c1_3;
+  results[1][4] = (int)c1_4;
+  results[1][5] = (int)c1_5;
+  results[1][6] = (int)c1_6;
+  results[1][7] = (int)c1_7;
+  results[2][0] = (int)c2_0;
+  results[2][1] = (int)c2_1;
+  results[2][2] = (int)c2_2;
+  results[2][3] = (int)c2_3;
+  results[2][4] = (int)c2_4;
+  results[2][5] = (int)c2_5;
+  results[2][6] = (int)c2_6;
+  results[2][7] = (int)c2_7;
+#else
+  setop_count_db_cpu_kernel_outer(3, 8, 1, a, b, k_b, k_max, results, _XOR,
+                                  OMP_CPU_SIMD_ALIGN_BUFFER(ALIGNMENT, setop_buffer),
+                                  VECTOR_UNALIGNED_LOAD);
+#endif
+}
+
+static void gen_rows_xor_3x8x1_unaligned(const uint64_t *const *a, int ni,
+    const uint64_t *const *b, int nj, size_t k_b, size_t k_max,
+    int *restrict counts, size_t ld) {
+  SETOP_BLOCK_TILES(_XOR, VECTOR_UNALIGNED_LOAD, SETOP_INDIRECT_A, SETOP_INDIRECT_B, 3, 8,
+                    gen_block_xor_3x8x1_unaligned(a_rows, b_rows, k_b, k_max, results))
+}
+
+/* and_not, 3x8 register block, 1 vector a step, aligned loads */
+static inline void gen_block_and_not_3x8x1_aligned(
+    const uint64_t *restrict const *a, const uint64_t *restrict const *b,
+    size_t k_b, size_t k_max, int results[3][8]) {
+#if BIT_GEN_VECTOR_BLOCKS
+  const size_t step = 1 * VECTOR_QWORDS;
+  CHUNK_LIMIT(limit, k_b, k_max, step)
+  VECTOR_TYPE s0_0 = SIMDe_ZERO_VECTOR;
+  VECTOR_TYPE s0_1 = SIMDe_ZERO_VECTOR;
+  VECTOR_TYPE s0_2 = SIMDe_ZERO_VECTOR;
+  VECTOR_TYPE s0_3 = SIMDe_ZERO_VECTOR;
+  VECTOR_TYPE s0_4 = SIMDe_ZERO_VECTOR;
+  VECTOR_TYPE s0_5 = SIMDe_ZERO_VECTOR;
+  VECTOR_TYPE s0_6 = SIMDe_ZERO_VECTOR;
+  VECTOR_TYPE s0_7 = SIMDe_ZERO_VECTOR;
+  VECTOR_TYPE s1_0 = SIMDe_ZERO_VECTOR;
+  VECTOR_TYPE s1_1 = SIMDe_ZERO_VECTOR;
+  VECTOR_TYPE s1_2 = SIMDe_ZERO_VECTOR;
+  VECTOR_TYPE s1_3 = SIMDe_ZERO_VECTOR;
+  VECTOR_TYPE s1_4 = SIMDe_ZERO_VECTOR;
+  VECTOR_TYPE s1_5 = SIMDe_ZERO_VECTOR;
+  VECTOR_TYPE s1_6 = SIMDe_ZERO_VECTOR;
+  VECTOR_TYPE s1_7 = SIMDe_ZERO_VECTOR;
+  VECTOR_TYPE s2_0 = SIMDe_ZERO_VECTOR;
+  VECTOR_TYPE s2_1 = SIMDe_ZERO_VECTOR;
+  VECTOR_TYPE s2_2 = SIMDe_ZERO_VECTOR;
+  VECTOR_TYPE s2_3 = SIMDe_ZERO_VECTOR;
+  VECTOR_TYPE s2_4 = SIMDe_ZERO_VECTOR;
+  VECTOR_TYPE s2_5 = SIMDe_ZERO_VECTOR;
+  VECTOR_TYPE s2_6 = SIMDe_ZERO_VECTOR;
+  VECTOR_TYPE s2_7 = SIMDe_ZERO_VECTOR;
+  size_t k = k_b;
+  for (; k < limit; k += step) {
+    {
+      const VECTOR_TYPE a0 = BIT_GEN_ALIGNED_LOAD((VECTOR_TYPE *)&a[0][k + VECTOR_OFFSET(0)]);
+      const VECTOR_TYPE a1 = BIT_GEN_ALIGNED_LOAD((VECTOR_TYPE *)&a[1][k + VECTOR_OFFSET(0)]);
+      const VECTOR_TYPE a2 = BIT_GEN_ALIGNED_LOAD((VECTOR_TYPE *)&a[2][k + VECTOR_OFFSET(0)]);
+      const VECTOR_TYPE b0 = BIT_GEN_ALIGNED_LOAD((VECTOR_TYPE *)&b[0][k + VECTOR_OFFSET(0)]);
+      const VECTOR_TYPE b1 = BIT_GEN_ALIGNED_LOAD((VECTOR_TYPE *)&b[1][k + VECTOR_OFFSET(0)]);
+      const VECTOR_TYPE b2 = BIT_GEN_ALIGNED_LOAD((VECTOR_TYPE *)&b[2][k + VECTOR_OFFSET(0)]);
+      const VECTOR_TYPE b3 = BIT_GEN_ALIGNED_LOAD((VECTOR_TYPE *)&b[3][k + VECTOR_OFFSET(0)]);
+      const VECTOR_TYPE b4 = BIT_GEN_ALIGNED_LOAD((VECTOR_TYPE *)&b[4][k + VECTOR_OFFSET(0)]);
+      const VECTOR_TYPE b5 = BIT_GEN_ALIGNED_LOAD((VECTOR_TYPE *)&b[5][k + VECTOR_OFFSET(0)]);
+      const VECTOR_TYPE b6 = BIT_GEN_ALIGNED_LOAD((VECTOR_TYPE *)&b[6][k + VECTOR_OFFSET(0)]);
+      const VECTOR_TYPE b7 = BIT_GEN_ALIGNED_LOAD((VECTOR_TYPE *)&b[7][k + VECTOR_OFFSET(0)]);
+      s0_0 = SIMDe_VECTOR_ADD(s0_0, SIMDe_POPCOUNT(BIT_AND_NOT(a0, b0)));
+      s0_1 = SIMDe_VECTOR_ADD(s0_1, SIMDe_POPCOUNT(BIT_AND_NOT(a0, b1)));
+      s0_2 = SIMDe_VECTOR_ADD(s0_2, SIMDe_POPCOUNT(BIT_AND_NOT(a0, b2)));
+      s0_3 = SIMDe_VECTOR_ADD(s0_3, SIMDe_POPCOUNT(BIT_AND_NOT(a0, b3)));
+      s0_4 = SIMDe_VECTOR_ADD(s0_4, SIMDe_POPCOUNT(BIT_AND_NOT(a0, b4)));
+      s0_5 = SIMDe_VECTOR_ADD(s0_5, SIMDe_POPCOUNT(BIT_AND_NOT(a0, b5)));
+      s0_6 = SIMDe_VECTOR_ADD(s0_6, SIMDe_POPCOUNT(BIT_AND_NOT(a0, b6)));
+      s0_7 = SIMDe_VECTOR_ADD(s0_7, SIMDe_POPCOUNT(BIT_AND_NOT(a0, b7)));
+      s1_0 = SIMDe_VECTOR_ADD(s1_0, SIMDe_POPCOUNT(BIT_AND_NOT(a1, b0)));
+      s1_1 = SIMDe_VECTOR_ADD(s1_1, SIMDe_POPCOUNT(BIT_AND_NOT(a1, b1)));
+      s1_2 = SIMDe_VECTOR_ADD(s1_2, SIMDe_POPCOUNT(BIT_AND_NOT(a1, b2)));
+      s1_3 = SIMDe_VECTOR_ADD(s1_3, SIMDe_POPCOUNT(BIT_AND_NOT(a1, b3)));
+      s1_4 = SIMDe_VECTOR_ADD(s1_4, SIMDe_POPCOUNT(BIT_AND_NOT(a1, b4)));
+      s1_5 = SIMDe_VECTOR_ADD(s1_5, SIMDe_POPCOUNT(BIT_AND_NOT(a1, b5)));
+      s1_6 = SIMDe_VECTOR_ADD(s1_6, SIMDe_POPCOUNT(BIT_AND_NOT(a1, b6)));
+      s1_7 = SIMDe_VECTOR_ADD(s1_7, SIMDe_POPCOUNT(BIT_AND_NOT(a1, b7)));
+      s2_0 = SIMDe_VECTOR_ADD(s2_0, SIMDe_POPCOUNT(BIT_AND_NOT(a2, b0)));
+      s2_1 = SIMDe_VECTOR_ADD(s2_1, SIMDe_POPCOUNT(BIT_AND_NOT(a2, b1)));
+      s2_2 = SIMDe_VECTOR_ADD(s2_2, SIMDe_POPCOUNT(BIT_AND_NOT(a2, b2)));
+      s2_3 = SIMDe_VECTOR_ADD(s2_3, SIMDe_POPCOUNT(BIT_AND_NOT(a2, b3)));
+      s2_4 = SIMDe_VECTOR_ADD(s2_4, SIMDe_POPCOUNT(BIT_AND_NOT(a2, b4)));
+      s2_5 = SIMDe_VECTOR_ADD(s2_5, SIMDe_POPCOUNT(BIT_AND_NOT(a2, b5)));
+      s2_6 = SIMDe_VECTOR_ADD(s2_6, SIMDe_POPCOUNT(BIT_AND_NOT(a2, b6)));
+      s2_7 = SIMDe_VECTOR_ADD(s2_7, SIMDe_POPCOUNT(BIT_AND_NOT(a2, b7)));
+    }
+  }
+  uint64_t c0_0 = gen_lanes_sum(s0_0);
+  uint64_t c0_1 = gen_lanes_sum(s0_1);
+  uint64_t c0_2 = gen_lanes_sum(s0_2);
+  uint64_t c0_3 = gen_lanes_sum(s0_3);
+  uint64_t c0_4 = gen_lanes_sum(s0_4);
+  uint64_t c0_5 = gen_lanes_sum(s0_5);
+  uint64_t c0_6 = gen_lanes_sum(s0_6);
+  uint64_t c0_7 = gen_lanes_sum(s0_7);
+  uint64_t c1_0 = gen_lanes_sum(s1_0);
+  uint64_t c1_1 = gen_lanes_sum(s1_1);
+  uint64_t c1_2 = gen_lanes_sum(s1_2);
+  uint64_t c1_3 = gen_lanes_sum(s1_3);
+  uint64_t c1_4 = gen_lanes_sum(s1_4);
+  uint64_t c1_5 = gen_lanes_sum(s1_5);
+  uint64_t c1_6 = gen_lanes_sum(s1_6);
+  uint64_t c1_7 = gen_lanes_sum(s1_7);
+  uint64_t c2_0 = gen_lanes_sum(s2_0);
+  uint64_t c2_1 = gen_lanes_sum(s2_1);
+  uint64_t c2_2 = gen_lanes_sum(s2_2);
+  uint64_t c2_3 = gen_lanes_sum(s2_3);
+  uint64_t c2_4 = gen_lanes_sum(s2_4);
+  uint64_t c2_5 = gen_lanes_sum(s2_5);
+  uint64_t c2_6 = gen_lanes_sum(s2_6);
+  uint64_t c2_7 = gen_lanes_sum(s2_7);
+  for (; k < k_max; k++) {
+    const uint64_t a0 = a[0][k];
+    const uint64_t a1 = a[1][k];
+    const uint64_t a2 = a[2][k];
+    const uint64_t b0 = b[0][k];
+    const uint64_t b1 = b[1][k];
+    const uint64_t b2 = b[2][k];
+    const uint64_t b3 = b[3][k];
+    const uint64_t b4 = b[4][k];
+    const uint64_t b5 = b[5][k];
+    const uint64_t b6 = b[6][k];
+    const uint64_t b7 = b[7][k];
+    c0_0 += POPCOUNT(BIT_SCALAR_AND_NOT(a0, b0));
+    c0_1 += POPCOUNT(BIT_SCALAR_AND_NOT(a0, b1));
+    c0_2 += POPCOUNT(BIT_SCALAR_AND_NOT(a0, b2));
+    c0_3 += POPCOUNT(BIT_SCALAR_AND_NOT(a0, b3));
+    c0_4 += POPCOUNT(BIT_SCALAR_AND_NOT(a0, b4));
+    c0_5 += POPCOUNT(BIT_SCALAR_AND_NOT(a0, b5));
+    c0_6 += POPCOUNT(BIT_SCALAR_AND_NOT(a0, b6));
+    c0_7 += POPCOUNT(BIT_SCALAR_AND_NOT(a0, b7));
+    c1_0 += POPCOUNT(BIT_SCALAR_AND_NOT(a1, b0));
+    c1_1 += POPCOUNT(BIT_SCALAR_AND_NOT(a1, b1));
+    c1_2 += POPCOUNT(BIT_SCALAR_AND_NOT(a1, b2));
+    c1_3 += POPCOUNT(BIT_SCALAR_AND_NOT(a1, b3));
+    c1_4 += POPCOUNT(BIT_SCALAR_AND_NOT(a1, b4));
+    c1_5 += POPCOUNT(BIT_SCALAR_AND_NOT(a1, b5));
+    c1_6 += POPCOUNT(BIT_SCALAR_AND_NOT(a1, b6));
+    c1_7 += POPCOUNT(BIT_SCALAR_AND_NOT(a1, b7));
+    c2_0 += POPCOUNT(BIT_SCALAR_AND_NOT(a2, b0));
+    c2_1 += POPCOUNT(BIT_SCALAR_AND_NOT(a2, b1));
+    c2_2 += POPCOUNT(BIT_SCALAR_AND_NOT(a2, b2));
+    c2_3 += POPCOUNT(BIT_SCALAR_AND_NOT(a2, b3));
+    c2_4 += POPCOUNT(BIT_SCALAR_AND_NOT(a2, b4));
+    c2_5 += POPCOUNT(BIT_SCALAR_AND_NOT(a2, b5));
+    c2_6 += POPCOUNT(BIT_SCALAR_AND_NOT(a2, b6));
+    c2_7 += POPCOUNT(BIT_SCALAR_AND_NOT(a2, b7));
+  }
+  results[0][0] = (int)c0_0;
+  results[0][1] = (int)c0_1;
+  results[0][2] = (int)c0_2;
+  results[0][3] = (int)c0_3;
+  results[0][4] = (int)c0_4;
+  results[0][5] = (int)c0_5;
+  results[0][6] = (int)c0_6;
+  results[0][7] = (int)c0_7;
+  results[1][0] = (int)c1_0;
+  results[1][1] = (int)c1_1;
+  results[1][2] = (int)c1_2;
+  results[1][3] = (int)c1_3;
+  results[1][4] = (int)c1_4;
+  results[1][5] = (int)c1_5;
+  results[1][6] = (int)c1_6;
+  results[1][7] = (int)c1_7;
+  results[2][0] = (int)c2_0;
+  results[2][1] = (int)c2_1;
+  results[2][2] = (int)c2_2;
+  results[2][3] = (int)c2_3;
+  results[2][4] = (int)c2_4;
+  results[2][5] = (int)c2_5;
+  results[2][6] = (int)c2_6;
+  results[2][7] = (int)c2_7;
+#else
+  setop_count_db_cpu_kernel_outer(3, 8, 1, a, b, k_b, k_max, results, _AND_NOT,
+                                  OMP_CPU_SIMD_ALIGN_BUFFER(ALIGNMENT, setop_buffer),
+                                  BIT_GEN_ALIGNED_LOAD);
+#endif
+}
+
+static void gen_rows_and_not_3x8x1_aligned(const uint64_t *const *a, int ni,
+    const uint64_t *const *b, int nj, size_t k_b, size_t k_max,
+    int *restrict counts, size_t ld) {
+  SETOP_BLOCK_TILES(_AND_NOT, BIT_GEN_ALIGNED_LOAD, SETOP_INDIRECT_A, SETOP_INDIRECT_B, 3, 8,
+                    gen_block_and_not_3x8x1_aligned(a_rows, b_rows, k_b, k_max, results))
+}
+
+/* and_not, 3x8 register block, 1 vector a step, unaligned loads */
+static inline void gen_block_and_not_3x8x1_unaligned(
+    const uint64_t *restrict const *a, const uint64_t *restrict const *b,
+    size_t k_b, size_t k_max, int results[3][8]) {
+#if BIT_GEN_VECTOR_BLOCKS
+  const size_t step = 1 * VECTOR_QWORDS;
+  CHUNK_LIMIT(limit, k_b, k_max, step)
+  VECTOR_TYPE s0_0 = SIMDe_ZERO_VECTOR;
+  VECTOR_TYPE s0_1 = SIMDe_ZERO_VECTOR;
+  VECTOR_TYPE s0_2 = SIMDe_ZERO_VECTOR;
+  VECTOR_TYPE s0_3 = SIMDe_ZERO_VECTOR;
+  VECTOR_TYPE s0_4 = SIMDe_ZERO_VECTOR;
+  VECTOR_TYPE s0_5 = SIMDe_ZERO_VECTOR;
+  VECTOR_TYPE s0_6 = SIMDe_ZERO_VECTOR;
+  VECTOR_TYPE s0_7 = SIMDe_ZERO_VECTOR;
+  VECTOR_TYPE s1_0 = SIMDe_ZERO_VECTOR;
+  VECTOR_TYPE s1_1 = SIMDe_ZERO_VECTOR;
+  VECTOR_TYPE s1_2 = SIMDe_ZERO_VECTOR;
+  VECTOR_TYPE s1_3 = SIMDe_ZERO_VECTOR;
+  VECTOR_TYPE s1_4 = SIMDe_ZERO_VECTOR;
+  VECTOR_TYPE s1_5 = SIMDe_ZERO_VECTOR;
+  VECTOR_TYPE s1_6 = SIMDe_ZERO_VECTOR;
+  VECTOR_TYPE s1_7 = SIMDe_ZERO_VECTOR;
+  VECTOR_TYPE s2_0 = SIMDe_ZERO_VECTOR;
+  VECTOR_TYPE s2_1 = SIMDe_ZERO_VECTOR;
+  VECTOR_TYPE s2_2 = SIMDe_ZERO_VECTOR;
+  VECTOR_TYPE s2_3 = SIMDe_ZERO_VECTOR;
+  VECTOR_TYPE s2_4 = SIMDe_ZERO_VECTOR;
+  VECTOR_TYPE s2_5 = SIMDe_ZERO_VECTOR;
+  VECTOR_TYPE s2_6 = SIMDe_ZERO_VECTOR;
+  VECTOR_TYPE s2_7 = SIMDe_ZERO_VECTOR;
+  size_t k = k_b;
+  for (; k < limit; k += step) {
+    {
+      const VECTOR_TYPE a0 = VECTOR_UNALIGNED_LOAD((VECTOR_TYPE *)&a[0][k + VECTOR_OFFSET(0)]);
+      const VECTOR_TYPE a1 = VECTOR_UNALIGNED_LOAD((VECTOR_TYPE *)&a[1][k + VECTOR_OFFSET(0)]);
+      const VECTOR_TYPE a2 = VECTOR_UNALIGNED_LOAD((VECTOR_TYPE *)&a[2][k + VECTOR_OFFSET(0)]);
+      const VECTOR_TYPE b0 = VECTOR_UNALIGNED_LOAD((VECTOR_TYPE *)&b[0][k + VECTOR_OFFSET(0)]);
+      const VECTOR_TYPE b1 = VECTOR_UNALIGNED_LOAD((VECTOR_TYPE *)&b[1][k + VECTOR_OFFSET(0)]);
+      const VECTOR_TYPE b2 = VECTOR_UNALIGNED_LOAD((VECTOR_TYPE *)&b[2][k + VECTOR_OFFSET(0)]);
+      const VECTOR_TYPE b3 = VECTOR_UNALIGNED_LOAD((VECTOR_TYPE *)&b[3][k + VECTOR_OFFSET(0)]);
+      const VECTOR_TYPE b4 = VECTOR_UNALIGNED_LOAD((VECTOR_TYPE *)&b[4][k + VECTOR_OFFSET(0)]);
+      const VECTOR_TYPE b5 = VECTOR_UNALIGNED_LOAD((VECTOR_TYPE *)&b[5][k + VECTOR_OFFSET(0)]);
+      const VECTOR_TYPE b6 = VECTOR_UNALIGNED_LOAD((VECTOR_TYPE *)&b[6][k + VECTOR_OFFSET(0)]);
+      const VECTOR_TYPE b7 = VECTOR_UNALIGNED_LOAD((VECTOR_TYPE *)&b[7][k + VECTOR_OFFSET(0)]);
+      s0_0 = SIMDe_VECTOR_ADD(s0_0, SIMDe_POPCOUNT(BIT_AND_NOT(a0, b0)));
+      s0_1 = SIMDe_VECTOR_ADD(s0_1, SIMDe_POPCOUNT(BIT_AND_NOT(a0, b1)));
+      s0_2 = SIMDe_VECTOR_ADD(s0_2, SIMDe_POPCOUNT(BIT_AND_NOT(a0, b2)));
+      s0_3 = SIMDe_VECTOR_ADD(s0_3, SIMDe_POPCOUNT(BIT_AND_NOT(a0, b3)));
+      s0_4 = SIMDe_VECTOR_ADD(s0_4, SIMDe_POPCOUNT(BIT_AND_NOT(a0, b4)));
+      s0_5 = SIMDe_VECTOR_ADD(s0_5, SIMDe_POPCOUNT(BIT_AND_NOT(a0, b5)));
+      s0_6 = SIMDe_VECTOR_ADD(s0_6, SIMDe_POPCOUNT(BIT_AND_NOT(a0, b6)));
+      s0_7 = SIMDe_VECTOR_ADD(s0_7, SIMDe_POPCOUNT(BIT_AND_NOT(a0, b7)));
+      s1_0 = SIMDe_VECTOR_ADD(s1_0, SIMDe_POPCOUNT(BIT_AND_NOT(a1, b0)));
+      s1_1 = SIMDe_VECTOR_ADD(s1_1, SIMDe_POPCOUNT(BIT_AND_NOT(a1, b1)));
+      s1_2 = SIMDe_VECTOR_ADD(s1_2, SIMDe_POPCOUNT(BIT_AND_NOT(a1, b2)));
+      s1_3 = SIMDe_VECTOR_ADD(s1_3, SIMDe_POPCOUNT(BIT_AND_NOT(a1, b3)));
+      s1_4 = SIMDe_VECTOR_ADD(s1_4, SIMDe_POPCOUNT(BIT_AND_NOT(a1, b4)));
+      s1_5 = SIMDe_VECTOR_ADD(s1_5, SIMDe_POPCOUNT(BIT_AND_NOT(a1, b5)));
+      s1_6 = SIMDe_VECTOR_ADD(s1_6, SIMDe_POPCOUNT(BIT_AND_NOT(a1, b6)));
+      s1_7 = SIMDe_VECTOR_ADD(s1_7, SIMDe_POPCOUNT(BIT_AND_NOT(a1, b7)));
+      s2_0 = SIMDe_VECTOR_ADD(s2_0, SIMDe_POPCOUNT(BIT_AND_NOT(a2, b0)));
+      s2_1 = SIMDe_VECTOR_ADD(s2_1, SIMDe_POPCOUNT(BIT_AND_NOT(a2, b1)));
+      s2_2 = SIMDe_VECTOR_ADD(s2_2, SIMDe_POPCOUNT(BIT_AND_NOT(a2, b2)));
+      s2_3 = SIMDe_VECTOR_ADD(s2_3, SIMDe_POPCOUNT(BIT_AND_NOT(a2, b3)));
+      s2_4 = SIMDe_VECTOR_ADD(s2_4, SIMDe_POPCOUNT(BIT_AND_NOT(a2, b4)));
+      s2_5 = SIMDe_VECTOR_ADD(s2_5, SIMDe_POPCOUNT(BIT_AND_NOT(a2, b5)));
+      s2_6 = SIMDe_VECTOR_ADD(s2_6, SIMDe_POPCOUNT(BIT_AND_NOT(a2, b6)));
+      s2_7 = SIMDe_VECTOR_ADD(s2_7, SIMDe_POPCOUNT(BIT_AND_NOT(a2, b7)));
+    }
+  }
+  uint64_t c0_0 = gen_lanes_sum(s0_0);
+  uint64_t c0_1 = gen_lanes_sum(s0_1);
+  uint64_t c0_2 = gen_lanes_sum(s0_2);
+  uint64_t c0_3 = gen_lanes_sum(s0_3);
+  uint64_t c0_4 = gen_lanes_sum(s0_4);
+  uint64_t c0_5 = gen_lanes_sum(s0_5);
+  uint64_t c0_6 = gen_lanes_sum(s0_6);
+  uint64_t c0_7 = gen_lanes_sum(s0_7);
+  uint64_t c1_0 = gen_lanes_sum(s1_0);
+  uint64_t c1_1 = gen_lanes_sum(s1_1);
+  uint64_t c1_2 = gen_lanes_sum(s1_2);
+  uint64_t c1_3 = gen_lanes_sum(s1_3);
+  uint64_t c1_4 = gen_lanes_sum(s1_4);
+  uint64_t c1_5 = gen_lanes_sum(s1_5);
+  uint64_t c1_6 = gen_lanes_sum(s1_6);
+  uint64_t c1_7 = gen_lanes_sum(s1_7);
+  uint64_t c2_0 = gen_lanes_sum(s2_0);
+  uint64_t c2_1 = gen_lanes_sum(s2_1);
+  uint64_t c2_2 = gen_lanes_sum(s2_2);
+  uint64_t c2_3 = gen_lanes_sum(s2_3);
+  uint64_t c2_4 = gen_lanes_sum(s2_4);
+  uint64_t c2_5 = gen_lanes_sum(s2_5);
+  uint64_t c2_6 = gen_lanes_sum(s2_6);
+  uint64_t c2_7 = gen_lanes_sum(s2_7);
+  for (; k < k_max; k++) {
+    const uint64_t a0 = a[0][k];
+    const uint64_t a1 = a[1][k];
+    const uint64_t a2 = a[2][k];
+    const uint64_t b0 = b[0][k];
+    const uint64_t b1 = b[1][k];
+    const uint64_t b2 = b[2][k];
+    const uint64_t b3 = b[3][k];
+    const uint64_t b4 = b[4][k];
+    const uint64_t b5 = b[5][k];
+    const uint64_t b6 = b[6][k];
+    const uint64_t b7 = b[7][k];
+    c0_0 += POPCOUNT(BIT_SCALAR_AND_NOT(a0, b0));
+    c0_1 += POPCOUNT(BIT_SCALAR_AND_NOT(a0, b1));
+    c0_2 += POPCOUNT(BIT_SCALAR_AND_NOT(a0, b2));
+    c0_3 += POPCOUNT(BIT_SCALAR_AND_NOT(a0, b3));
+    c0_4 += POPCOUNT(BIT_SCALAR_AND_NOT(a0, b4));
+    c0_5 += POPCOUNT(BIT_SCALAR_AND_NOT(a0, b5));
+    c0_6 += POPCOUNT(BIT_SCALAR_AND_NOT(a0, b6));
+    c0_7 += POPCOUNT(BIT_SCALAR_AND_NOT(a0, b7));
+    c1_0 += POPCOUNT(BIT_SCALAR_AND_NOT(a1, b0));
+    c1_1 += POPCOUNT(BIT_SCALAR_AND_NOT(a1, b1));
+    c1_2 += POPCOUNT(BIT_SCALAR_AND_NOT(a1, b2));
+    c1_3 += POPCOUNT(BIT_SCALAR_AND_NOT(a1, b3));
+    c1_4 += POPCOUNT(BIT_SCALAR_AND_NOT(a1, b4));
+    c1_5 += POPCOUNT(BIT_SCALAR_AND_NOT(a1, b5));
+    c1_6 += POPCOUNT(BIT_SCALAR_AND_NOT(a1, b6));
+    c1_7 += POPCOUNT(BIT_SCALAR_AND_NOT(a1, b7));
+    c2_0 += POPCOUNT(BIT_SCALAR_AND_NOT(a2, b0));
+    c2_1 += POPCOUNT(BIT_SCALAR_AND_NOT(a2, b1));
+    c2_2 += POPCOUNT(BIT_SCALAR_AND_NOT(a2, b2));
+    c2_3 += POPCOUNT(BIT_SCALAR_AND_NOT(a2, b3));
+    c2_4 += POPCOUNT(BIT_SCALAR_AND_NOT(a2, b4));
+    c2_5 += POPCOUNT(BIT_SCALAR_AND_NOT(a2, b5));
+    c2_6 += POPCOUNT(BIT_SCALAR_AND_NOT(a2, b6));
+    c2_7 += POPCOUNT(BIT_SCALAR_AND_NOT(a2, b7));
+  }
+  results[0][0] = (int)c0_0;
+  results[0][1] = (int)c0_1;
+  results[0][2] = (int)c0_2;
+  results[0][3] = (int)c0_3;
+  results[0][4] = (int)c0_4;
+  results[0][5] = (int)c0_5;
+  results[0][6] = (int)c0_6;
+  results[0][7] = (int)c0_7;
+  results[1][0] = (int)c1_0;
+  results[1][1] = (int)c1_1;
+  results[1][2] = (int)c1_2;
+  results[1][3] = (int)c1_3;
+  results[1][4] = (int)c1_4;
+  results[1][5] = (int)c1_5;
+  results[1][6] = (int)c1_6;
+  results[1][7] = (int)c1_7;
+  results[2][0] = (int)c2_0;
+  results[2][1] = (int)c2_1;
+  results[2][2] = (int)c2_2;
+  results[2][3] = (int)c2_3;
+  results[2][4] = (int)c2_4;
+  results[2][5] = (int)c2_5;
+  results[2][6] = (int)c2_6;
+  results[2][7] = (int)c2_7;
+#else
+  setop_count_db_cpu_kernel_outer(3, 8, 1, a, b, k_b, k_max, results, _AND_NOT,
+                                  OMP_CPU_SIMD_ALIGN_BUFFER(ALIGNMENT, setop_buffer),
+                                  VECTOR_UNALIGNED_LOAD);
+#endif
+}
+
+static void gen_rows_and_not_3x8x1_unaligned(const uint64_t *const *a, int ni,
+    const uint64_t *const *b, int nj, size_t k_b, size_t k_max,
+    int *restrict counts, size_t ld) {
+  SETOP_BLOCK_TILES(_AND_NOT, VECTOR_UNALIGNED_LOAD, SETOP_INDIRECT_A, SETOP_INDIRECT_B, 3, 8,
+                    gen_block_and_not_3x8x1_unaligned(a_rows, b_rows, k_b, k_max, results))
+}
+
+#define BIT_GEN_COUNT_VARIANTS 48
+static const bit_count_variant gen_count_variants[BIT_GEN_COUNT_VARIANTS] = {
+    {"and_1x1x4_aligned", BIT_OP_AND, 1, 1, 4, true,
+     gen_rows_and_1x1x4_aligned},
+    {"and_1x1x4_unaligned", BIT_OP_AND, 1, 1, 4, false,
+     gen_rows_and_1x1x4_unaligned},
+    {"or_1x1x4_aligned", BIT_OP_OR, 1, 1, 4, true,
+     gen_rows_or_1x1x4_aligned},
+    {"or_1x1x4_unaligned", BIT_OP_OR, 1, 1, 4, false,
+     gen_rows_or_1x1x4_unaligned},
+    {"xor_1x1x4_aligned", BIT_OP_XOR, 1, 1, 4, true,
+     gen_rows_xor_1x1x4_aligned},
+    {"xor_1x1x4_unaligned", BIT_OP_XOR, 1, 1, 4, false,
+     gen_rows_xor_1x1x4_unaligned},
+    {"and_not_1x1x4_aligned", BIT_OP_AND_NOT, 1, 1, 4, true,
+     gen_rows_and_not_1x1x4_aligned},
+    {"and_not_1x1x4_unaligned", BIT_OP_AND_NOT, 1, 1, 4, false,
+     gen_rows_and_not_1x1x4_unaligned},
+    {"and_2x2x2_aligned", BIT_OP_AND, 2, 2, 2, true,
+     gen_rows_and_2x2x2_aligned},
+    {"and_2x2x2_unaligned", BIT_OP_AND, 2, 2, 2, false,
+     gen_rows_and_2x2x2_unaligned},
+    {"or_2x2x2_aligned", BIT_OP_OR, 2, 2, 2, true,
+     gen_rows_or_2x2x2_aligned},
+    {"or_2x2x2_unaligned", BIT_OP_OR, 2, 2, 2, false,
+     gen_rows_or_2x2x2_unaligned},
+    {"xor_2x2x2_aligned", BIT_OP_XOR, 2, 2, 2, true,
+     gen_rows_xor_2x2x2_aligned},
+    {"xor_2x2x2_unaligned", BIT_OP_XOR, 2, 2, 2, false,
+     gen_rows_xor_2x2x2_unaligned},
+    {"and_not_2x2x2_aligned", BIT_OP_AND_NOT, 2, 2, 2, true,
+     gen_rows_and_not_2x2x2_aligned},
+    {"and_not_2x2x2_unaligned", BIT_OP_AND_NOT, 2, 2, 2, false,
+     gen_rows_and_not_2x2x2_unaligned},
+    {"and_2x4x1_aligned", BIT_OP_AND, 2, 4, 1, true,
+     gen_rows_and_2x4x1_aligned},
+    {"and_2x4x1_unaligned", BIT_OP_AND, 2, 4, 1, false,
+     gen_rows_and_2x4x1_unaligned},
+    {"or_2x4x1_aligned", BIT_OP_OR, 2, 4, 1, true,
+     gen_rows_or_2x4x1_aligned},
+    {"or_2x4x1_unaligned", BIT_OP_OR, 2, 4, 1, false,
+     gen_rows_or_2x4x1_unaligned},
+    {"xor_2x4x1_aligned", BIT_OP_XOR, 2, 4, 1, true,
+     gen_rows_xor_2x4x1_aligned},
+    {"xor_2x4x1_unaligned", BIT_OP_XOR, 2, 4, 1, false,
+     gen_rows_xor_2x4x1_unaligned},
+    {"and_not_2x4x1_aligned", BIT_OP_AND_NOT, 2, 4, 1, true,
+     gen_rows_and_not_2x4x1_aligned},
+    {"and_not_2x4x1_unaligned", BIT_OP_AND_NOT, 2, 4, 1, false,
+     gen_rows_and_not_2x4x1_unaligned},
+    {"and_4x2x1_aligned", BIT_OP_AND, 4, 2, 1, true,
+     gen_rows_and_4x2x1_aligned},
+    {"and_4x2x1_unaligned", BIT_OP_AND, 4, 2, 1, false,
+     gen_rows_and_4x2x1_unaligned},
+    {"or_4x2x1_aligned", BIT_OP_OR, 4, 2, 1, true,
+     gen_rows_or_4x2x1_aligned},
+    {"or_4x2x1_unaligned", BIT_OP_OR, 4, 2, 1, false,
+     gen_rows_or_4x2x1_unaligned},
+    {"xor_4x2x1_aligned", BIT_OP_XOR, 4, 2, 1, true,
+     gen_rows_xor_4x2x1_aligned},
+    {"xor_4x2x1_unaligned", BIT_OP_XOR, 4, 2, 1, false,
+     gen_rows_xor_4x2x1_unaligned},
+    {"and_not_4x2x1_aligned", BIT_OP_AND_NOT, 4, 2, 1, true,
+     gen_rows_and_not_4x2x1_aligned},
+    {"and_not_4x2x1_unaligned", BIT_OP_AND_NOT, 4, 2, 1, false,
+     gen_rows_and_not_4x2x1_unaligned},
+    {"and_4x4x1_aligned", BIT_OP_AND, 4, 4, 1, true,
+     gen_rows_and_4x4x1_aligned},
+    {"and_4x4x1_unaligned", BIT_OP_AND, 4, 4, 1, false,
+     gen_rows_and_4x4x1_unaligned},
+    {"or_4x4x1_aligned", BIT_OP_OR, 4, 4, 1, true,
+     gen_rows_or_4x4x1_aligned},
+    {"or_4x4x1_unaligned", BIT_OP_OR, 4, 4, 1, false,
+     gen_rows_or_4x4x1_unaligned},
+    {"xor_4x4x1_aligned", BIT_OP_XOR, 4, 4, 1, true,
+     gen_rows_xor_4x4x1_aligned},
+    {"xor_4x4x1_unaligned", BIT_OP_XOR, 4, 4, 1, false,
+     gen_rows_xor_4x4x1_unaligned},
+    {"and_not_4x4x1_aligned", BIT_OP_AND_NOT, 4, 4, 1, true,
+     gen_rows_and_not_4x4x1_aligned},
+    {"and_not_4x4x1_unaligned", BIT_OP_AND_NOT, 4, 4, 1, false,
+     gen_rows_and_not_4x4x1_unaligned},
+    {"and_3x8x1_aligned", BIT_OP_AND, 3, 8, 1, true,
+     gen_rows_and_3x8x1_aligned},
+    {"and_3x8x1_unaligned", BIT_OP_AND, 3, 8, 1, false,
+     gen_rows_and_3x8x1_unaligned},
+    {"or_3x8x1_aligned", BIT_OP_OR, 3, 8, 1, true,
+     gen_rows_or_3x8x1_aligned},
+    {"or_3x8x1_unaligned", BIT_OP_OR, 3, 8, 1, false,
+     gen_rows_or_3x8x1_unaligned},
+    {"xor_3x8x1_aligned", BIT_OP_XOR, 3, 8, 1, true,
+     gen_rows_xor_3x8x1_aligned},
+    {"xor_3x8x1_unaligned", BIT_OP_XOR, 3, 8, 1, false,
+     gen_rows_xor_3x8x1_unaligned},
+    {"and_not_3x8x1_aligned", BIT_OP_AND_NOT, 3, 8, 1, true,
+     gen_rows_and_not_3x8x1_aligned},
+    {"and_not_3x8x1_unaligned", BIT_OP_AND_NOT, 3, 8, 1, false,
+     gen_rows_and_not_3x8x1_unaligned},
+};
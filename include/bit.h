@@ -3,6 +3,25 @@
     1) a BIT_T type and a set of functions to manipulate it.
     2) Packed containers of Bit_T (Bit_DB_T) that can be used to
        store multiple bitsets in a contiguous memory region.
+    3) Compressed bitsets (Bit_C_T) for sparse or clustered sets, which
+       operate directly with Bit_T.
+    4) Packed containers with sparse rows (Bit_SDB_T), which count against
+       Bit_DB_T without streaming their sparse rows.
+    5) Bitsets of 64-bit length (Bit_L_T), past the INT_MAX bits of a Bit_T.
+    6) Blocked Bloom filters (Bit_BF_T) on Bit_T storage.
+    7) Bit matrices on Bit_DB_T storage: transposes and boolean products.
+    8) MinHash sketches of Bit_DB_T rows and LSH candidate pairs.
+    9) Bit-sliced indices (Bit_BSI_T) of integer columns, queried into Bit_T.
+    10) Apache Arrow C Data Interface export and import of Bit_T and Bit_DB_T.
+    11) Multi-index hashing (Bit_MIH_T) for Hamming distance searches.
+    12) All-pairs counts over the ranks of an MPI job (Bit_mpi_grid_T),
+        built with MPI=1.
+    13) Packed containers of short rows (Bit_PDB_T), several bitsets of at
+        most 32 bits to a 64-bit word.
+    14) Weighted counts (Bit_W_T): sums of per-position weights over the
+        set bits of Bit_T and of the rows of Bit_DB_T.
+    15) Packed containers of rows of different lengths (Bit_RDB_T).
+    16) Indirect containers over arrays of Bit_T (Bit_IDB_T).
 
     * Author : Christos Argyropoulos
     * Created : April 1st 2025
@@ -15,7 +34,9 @@
     This is not a general bitset library, i.e. one cannot grow the bitset.
     Bitsets are also limited in capacity to int (at the time of the
     writting the same size as uint32_t). If one needs larger bitsets, then
-    they should probably be using roaring or compressed bitsets.
+    they should probably be using Bit_L_T, roaring or compressed bitsets.
+    Sparse bitsets within that capacity can use Bit_C_T (see the end of this
+    file).
 
     Functions that create, free or load an externally created bitset into a T.
     * Bit_new           : Create a new bitset with a fixed capacity/length
@@ -24,6 +45,9 @@
                           by the library). Returns the address of the storage
                           if allocated externally, or NULL if the
                           bitset was allocated by the library.
+    * Bit_pool_new      : Create a pool of bitsets of a fixed length
+    * Bit_pool_get      : Take a cleared bitset from a pool
+    * Bit_pool_free     : Free a pool and all the bitsets carved from it
     * Bit_load          : Load an externally allocated bitset into a (new) T.
                           The buffer must be large enough to hold the bitset (so
                           please ensure that you use Bit_buffer_size(length) to
@@ -34,13 +58,23 @@
                           multiple of 8 bytes. If you allocate a shorter buffer,
                           contratulations, you just inserted an overrun buffer
                           bug in your application.
+                          The buffer should also be aligned to 64 bytes (e.g.
+                          with aligned_alloc); set operations on bitsets whose
+                          storage is aligned this way (as that of Bit_new
+                          always is) use aligned vector loads. Misaligned
+                          buffers still work, through unaligned loads.
     * Bit_extract       : Extract the bitset from a T into an externally
                           allocated buffer. Returns the number of bytes written.
+    * Bit_serialize_rle : Bit_extract into a run-length encoded stream, with
+                          Bit_deserialize_rle its Bit_load (see below).
 
 
     Functions that obtain the properties of a bitset:
     * Bit_length        : Return the length (or capacity) of the bitset (bits)
     * Bit_count         : Count the number of bits set in the bitset
+    * Bit_touch         : Drop the cached count and indices after writes to
+                          a loaded buffer behind the library's back
+    * Bit_hash64        : 64-bit hash of the bits, for hash maps and dedup
     * Bit_buffer_size   : Return the number of bytes needed to store the
                           individual bits of the bitset of a given length
 
@@ -48,22 +82,44 @@
     * Bit_aset          : Set an array of bits in the bitset to one
     * Bit_bset          : Set a bit in the bitset to one
     * Bit_aclear        : Clear an array of bits in the bitset
+    * Bit_aset_sorted   : Bit_aset for a sorted array of bits
+    * Bit_aclear_sorted : Bit_aclear for a sorted array of bits
+    * Bit_aget          : Get the values of an array of bits in the bitset
     * Bit_bclear        : Clear a bit in the bitset
+    * Bit_bset_atomic, Bit_aset_atomic, Bit_test_and_set : Set bits from
+                          many threads at once
+    * Bit_shards_new    : Private bitsets for threads that build one bitset,
+                          ORed into it by Bit_shards_merge
     * Bit_clear         : Clears a range of bits [lo,hi] in the bitset
+    * Bit_clear_ranges  : Clears n ranges of bits [lo[i],hi[i]] in the bitset
     * Bit_get           : Get the value of a bit in the bitset
     * Bit_map           : Applies a function to each bit in the bitset. The
     *                     function *may* change the bitset in place. Note that
     *                     as a function is applied from left to right, the
     *                     changes will be seen by subsequent calls
+    * Bit_next_set      : Index of the first set bit at or after a position
+    * Bit_prev_set      : Index of the last set bit at or before a position
+    * Bit_foreach_set   : Applies a function to the index of each set bit
+    * Bit_to_indices    : The indices of the set bits, into an array
+    * Bit_rank          : Number of set bits before a position
+    * Bit_select        : Position of the k-th set bit
+    * Bit_rank_build    : Build the rank/select index ahead of time
+    * Bit_cache_summary : Keep a summary of the non-empty 512-bit blocks
     * Bit_not           : Inverts a range of bits [lo,hi] in the bitset
+    * Bit_not_ranges    : Inverts n ranges of bits [lo[i],hi[i]] in the bitset
     * Bit_put           : Set a bit in the bitset to a value & returns the
                           previous value of the bit
+    * Bit_*_inline      : Inline Bit_get/bset/bclear/put, from the opt-in
+                          bit_inline.h (see below)
     * Bit_set           : Sets a range of bits [lo,hi] in the bitset to one
+    * Bit_set_ranges    : Sets n ranges of bits [lo[i],hi[i]] in the bitset
 
     Functions that compare bitsets:
     * Bit_eq            : Compare two bitsets for equality (=1)
     * Bit_leq           : Compare two bitsets for less than or equal (=1)
     * Bit_lt            : Compare two bitsets for less than (=1)
+    * Bit_intersects    : Test whether two bitsets share a set bit (=1)
+    * Bit_disjoint      : Test whether two bitsets share no set bit (=1)
 
     Functions that operate on sets of bitsets (and create a new one):
     * Bit_inter         : Perform an intersection operation with another bitset
@@ -71,6 +127,14 @@
     * Bit_minus         : Perform a symmetric difference operation, ie the XOR
     * Bit_union         : Perform a union operation with another bitset
 
+    Functions that perform the same operations into caller storage:
+    * Bit_diff_into     * Bit_inter_into    * Bit_minus_into  * Bit_union_into
+    * Bit_diff_assign   * Bit_inter_assign  * Bit_minus_assign
+    * Bit_union_assign
+
+    Functions that shift, rotate and dilate a bitset (in place or *_into):
+    * Bit_shift_left    * Bit_shift_right   * Bit_rotate_left
+    * Bit_rotate_right  * Bit_dilate
 
     Functions that perform counts on set operations of two bitsets:
     * Bit_diff_count    : Count the number of bits set in the difference
@@ -78,6 +142,16 @@
     * Bit_minus_count   : Count the number of bits set in the symmetric
                           difference
     * Bit_union_count   : Count the number of bits set in the union
+    * Bit_SETOP_count_batch : The same counts over arrays of pairs, e.g.
+                          Bit_inter_count_batch
+    * Bit_count_range   : Count the set bits in a range [lo,hi]; with
+                          Bit_count_not(_range) and Bit_SETOP_count_range
+                          the complement and range-restricted counts
+    * Bit_reduce        : Union, intersection, parity or k-of-n of many
+                          bitsets into one (BitDB_reduce for the rows of a
+                          container)
+    * Bit_expr_count    : Count the number of bits set in a multi-operand
+                          expression, without forming it
 
     ===========================================================================
 
@@ -85,6 +159,23 @@
     a few functions to manipulate it.
 
     * BitDB_new         : Create a new packed container of bitsets
+    * BitDB_new_padded  : Same, with every row padded to an aligned stride.
+    * BitDB_new_numa    : Same, with the rows placed on the NUMA nodes.
+    * BitDB_new_pinned  : Same, with the rows in page-locked host memory.
+    * BitDB_is_pinned   : Whether the rows of a container are page-locked.
+    * Bit_pinned_alloc  : Page-locked buffer, e.g. for GPU counts matrices.
+    * Bit_pinned_free   : Release a buffer of Bit_pinned_alloc.
+    * BitDB_new_huge    : Same, with the rows on huge pages.
+    * Bit_huge_alloc    : Huge page buffer, e.g. for large counts matrices.
+    * BitDB_save        : Write a container to a file in the Bit_DB format.
+    * BitDB_open_mmap   : Map a saved container, without reading it in.
+    * BitDB_create_shared : One copy of a container for many processes.
+    * BitDB_writer_open : Stream rows into a Bit_DB file, in large writes.
+    * BitDB_save_compressed : Save a container in compressed blocks.
+    * BitDB_reader_open : Read a saved container ahead, for streaming counts.
+    * BitDB_load_text   : Read hex or index-list fingerprint files in parallel.
+    * BitDB_build_from_csr : Build a container from CSR index lists in
+                          parallel.
     * BitDB_load        : Load a packed container of bitsets from an
                           externally allocated buffer. See warnings under
                           Bit_load about buffer size and padding.
@@ -93,13 +184,26 @@
     * BitDB_count_at    : Population count at a given index in the container.
     * BitDB_nelem       : Get the number of bitsets in the packed container.
     * BitDB_count       : Population count of all bitsets in the container.
+    * BitDB_count_store : Same, into a caller buffer, with thread controls.
+    * BitDB_cache_counts: Keep a per-row population count cache current.
+    * BitDB_cache_summary: Keep per-row summaries of the non-empty blocks.
+    * BitDB_cache_postings: Keep an index of the rows holding every bit.
+    * BitDB_hash_rows   : Bit_hash64 of every row, in parallel.
+    * BitDB_cache_hashes: Keep the row hashes until the rows change.
+    * BitDB_column_counts: Number of rows holding every bit.
 
     * BitDB_clear_at    : Clear a bitset at a given index in the packed
                           container.
     * BitDB_clear       : Clear all bitsets in the packed container.
     * BitDB_get_from    : Returns a bitset from the bytes at a given index.
+    * BitDB_view_at     : Points a bitset handle at a row, without copying.
     * BitDB_put_at      : Set a bit in the bitset at a given index in the packed
                           container to the contents of another bitset.
+    * BitDB_put_many, BitDB_from_bitsets : Copy an array of bitsets into
+                          the rows of a container, or into a new one, in
+                          parallel.
+    * BitDB_gather, BitDB_scatter : Copy a list of rows into a compact
+                          container that keeps their IDs, and back.
     * BitDB_extract_from: Extract a bitset from the packed container at a given
    index into an externally allocated buffer. Returns the number of bytes
    written. The buffer must be large enough to hold the bitset (so please ensure
@@ -110,6 +214,14 @@
    index with the contents of a buffer.
     * BitDB_insert_at    : Insert a new bitset into the packed container at
     *                     a given index.
+    * BitDB_append       : Append a bitset to the end of the packed container.
+    * BitDB_append_many  : Append a run of packed bitsets from a buffer.
+    * BitDB_reserve      : Make room for a number of bitsets ahead of appends.
+    * BitDB_capacity     : Get the number of bitsets the container can hold.
+    * BitDB_track_changes : Log the rows written, for BitDB_export_delta.
+    * BitDB_apply_delta  : Apply the rows that changed to a replica.
+    * BitDB_concurrent   : Let row writers run alongside queries.
+    * BitDB_snapshot     : A read-only view of the rows as they are now.
 
 
     * BitDB_SETOP_count : Count the number of bits set in the SETOP
@@ -117,9 +229,10 @@
                           bitsets in another container. This is a macro that
                           expands to a function that takes two containers,
                           a structure for various control options and a target
-                          that is their the token cpu or gpu. The actual
-                          functions are BitDB_inter_count_cpu and
-                          BitDB_inter_count_gpu.
+                          that is their the token cpu, gpu, hybrid or auto.
+                          The actual functions are BitDB_inter_count_cpu,
+                          BitDB_inter_count_gpu, BitDB_inter_count_hybrid
+                          and BitDB_inter_count_auto.
 
     * BitDB_SETOP_count_store : Count the number of bits set in the SETOP
                           of all the bitsets in the container with all the
@@ -127,9 +240,141 @@
                           expands to a function that takes two containers,
                           a structure for various control options and a target
                           pre-allocated buffer to store the results and a target
-                          that is their the token cpu or gpu. The actual
-                          functions are BitDB_inter_count_store_cpu and
-                          BitDB_inter_count_store_gpu.
+                          that is their the token cpu, gpu, hybrid or auto.
+                          The actual functions are
+                          BitDB_inter_count_store_cpu,
+                          BitDB_inter_count_store_gpu,
+                          BitDB_inter_count_store_hybrid and
+                          BitDB_inter_count_store_auto.
+    * BitDB_counts_size : Number of entries in a SETOP count buffer (size_t).
+    * BitDB_counts_offset: Offset (size_t) of a pair in a SETOP count buffer.
+    * BitDB_SETOP_count_stream_cpu : SETOP counts of a container against
+                          rows streamed in blocks, for libraries too large to
+                          hold in memory.
+    * BitDB_inter_count_topk, BitDB_inter_count_threshold : Search modes
+                          that keep only the best or the qualifying matches
+                          of every query instead of the full count matrix.
+    * BitDB_inter_count_topk_gpu, BitDB_inter_count_threshold_gpu : The
+                          same, selected on the GPU.
+    * BitDB_inter_count_threshold_bits(_gpu) : A bit matrix of the pairs
+                          whose intersection count reaches a threshold.
+    * BitDB_screen_words, BitDB_inter_count_screened : Threshold searches
+                          that count in full only the targets a count over
+                          sampled words lets through.
+    * BitDB_fold, BitDB_inter_count_threshold_folded,
+      BitDB_inter_count_topk_folded : Exact searches screened through a
+                          folded companion container.
+    * BitDB_similarity_store_cpu, BitDB_similarity_u16_store_cpu,
+      BitDB_similarity_topk, BitDB_similarity_threshold : Tanimoto, Dice,
+                          cosine or Tversky similarities computed from the
+                          intersection counts as they are produced.
+    * BitDB_similarity_join : The pairs of rows of a container above a
+                          high similarity cutoff, by prefix filtering
+                          instead of all pairs.
+    * BitDB_sort_by_count : Order the rows by popcount, so that similarity
+                          searches prune whole tiles of targets.
+    * BitDB_reorder     : Order the rows by popcount, Gray code or a given
+                          permutation, with searches reporting row IDs.
+    * BitDB_dedup       : The distinct rows of a container and the map of
+                          every row to its copy, with functions that expand
+                          counts and search results against the distinct
+                          rows back to all rows.
+    * BitDB_multi_count_store : Any combination of the four SETOP counts of
+                          the same pairs from a single pass over the rows.
+    * BitDB_multi_count_store_gpu : The same on the GPU, fused into one
+                          kernel by the NATIVE_COARSENED algorithm.
+    * BitDB_count_store_typed_cpu, BitDB_count_store_typed_gpu : SETOP
+                          counts as uint8_t, uint16_t or int matrices.
+    * BitDB_count_tiles_cpu, BitDB_count_store_file_cpu : SETOP counts
+                          handed out a tile at a time, or written to a
+                          file, never held whole in memory.
+    * BitDB_count_update_file_cpu : An all-pairs count file brought up
+                          to date with the rows changed or appended since.
+    * BitDB_count_histogram_cpu, BitDB_count_histogram_gpu : Histograms
+                          of the SETOP counts, per query or overall.
+    * BitDB_count_stats_cpu, BitDB_count_stats_gpu : Mean, variance, min
+                          and max of the SETOP counts of every query,
+                          with or without the counts.
+    * BitDB_count_store_tiled_cpu, BitDB_tiles_open : SETOP counts in a
+                          file of fixed tiles, optionally compressed, that
+                          is mapped and read one tile at a time.
+    * BitDB_count_store_gpu_async, BitDB_async_wait : SETOP counts on the
+                          GPU that return at once, with the transfers of
+                          the targets and counts overlapped with compute.
+    * BitDB_count_store_gpu_multi : SETOP counts with the rows of the
+                          second container sharded across several GPUs.
+    * BitDB_column_partition, BitDB_count_store_gpu_parts : Containers of
+                          one word range of the rows each, and SETOP counts
+                          summed over such ranges on several GPUs.
+    * BitDB_device_attach, BitDB_device_sync, BitDB_device_detach : Keep a
+                          container on a GPU and push only its changed rows.
+    * BitDB_count_store_gpu, BitDB_count_store_cards_gpu,
+      BitDB_column_counts_gpu, BitDB_reduce_gpu : Row counts (alone or with
+                          SETOP counts), column counts and reductions of
+                          the rows resident on a GPU.
+    * Bit_L_device_attach and the Bit_L_*_gpu functions : Keep a Bit_L_T
+                          on a GPU and chain set operations, counts, ranges
+                          and comparisons on the device copy.
+    * Bit_gpu_stats_get, Bit_gpu_stats_reset, Bit_gpu_stats_timers : Counters
+                          of layout transitions and host <-> device copies.
+    * Bit_gpu_budget_set, Bit_gpu_budget_get, Bit_gpu_resident_bytes : Cap
+                          the device memory of resident containers (LRU).
+    * Bit_gpu_word_bits_set, Bit_gpu_word_bits : 32- or 64-bit device words
+                          for GPUs with weak 64-bit integer throughput.
+    * Bit_gpu_native_backend : The native CUDA/HIP backend (libbit_cuda,
+                          libbit_hip) of the NATIVE_COARSENED algorithm.
+    * Bit_gemm_backend_set, BitDB_count_store_gemm : SETOP counts as int8
+                          matrix products through a GEMM the caller plugs
+                          in, for accelerators without a fast popcount.
+    * BitDB_query_count_store : SETOP counts of one bitset against every
+                          row, streamed at memory bandwidth.
+    * BitDB_superset_search, BitDB_subset_search : The rows that contain,
+                          or are contained in, one bitset, as a row mask.
+    * BitDB_queue_new, BitDB_query_submit, BitDB_query_wait,
+      BitDB_queue_free : Micro-batching of single queries submitted from
+                          many threads into one tiled pass.
+    * BitDB_SETOP_count_self_cpu : Symmetric counts of a container against
+                          itself from the upper triangle of pairs only.
+    * Bit_tuning_get, Bit_tuning_set, Bit_tuning_load, Bit_tuning_save,
+      Bit_tuning_defaults, Bit_tuning_autotune : Pick the register block and
+                          tile sizes of the CPU count kernels at run time.
+    * Bit_kernel_variants, BitDB_count_variant : The generated register
+                          block kernels, one at a time for benchmarking.
+    * Bit_isa_threshold_get, Bit_isa_threshold_set, Bit_isa_calibrate :
+                          AVX2 rather than AVX-512 kernels for small CPU
+                          counts, below a measured work threshold.
+    * Bit_store_threshold_get, Bit_store_threshold_set : Count matrices
+                          larger than the last level cache written with
+                          non-temporal stores.
+    * Bit_parallel_threshold_get, Bit_parallel_threshold_set : Bit_T
+                          operations on long bitsets split over the threads.
+    * Bit_ctx_new, Bit_ctx_opts, Bit_ctx_counts, Bit_ctx_free : Execution
+                          context that keeps the team size, tuning and
+                          scratch of repeated small calls.
+    * Bit_ctx_budget_set, Bit_ctx_bytes : Cap the memory a context keeps.
+    * SETOP_COUNT_OPTS.exec : CPU count stores as tasks of the caller's
+                          team when called from a parallel region.
+    * Bit_affinity_cpus : The CPUs that SETOP_COUNT_OPTS.affinity pins the
+                          team of the CPU count stores to.
+    * Bit_cancel_new, Bit_cancel_request, Bit_cancel_requested,
+      Bit_cancel_reset, Bit_cancel_free : Cancellation tokens that, with a
+                          deadline, stop long count store calls early.
+                          Tile and progress hooks of the same calls.
+    * Bit_stats_snapshot, Bit_stats_reset : Per-function calls, ticks and
+                          bytes, and the kernel paths taken, of a library
+                          built with PROFILE=1.
+    * Bit_capture_start, Bit_capture_stop, Bit_capture_load : Record the
+                          container counts and searches of a process to a
+                          file that bench_replay plays back.
+    * Bit_memory_stats, Bit_memory_reset_peaks : Bytes the library holds on
+                          the host and the GPUs, by category, with their
+                          high-water marks.
+    * BitDB_estimate : Predicted runtime, bytes moved and peak memory of a
+                          count call of a given shape on the CPU or a GPU.
+
+    * BitDB_expr_count_cpu, BitDB_expr_count_store_cpu : Count the number of
+                          bits set in a fused multi-operand expression (see
+                          Bit_expr_count) for every bitset in the container.
 
     > SETOP can be one of the following:
         1. inter = intersection
@@ -154,6 +399,7 @@
 
 #include <stdbool.h>
 #include <stddef.h>
+#include <stdint.h>
 
 #define T Bit_T
 typedef struct T *T;
@@ -161,6 +407,231 @@ typedef struct T *T;
 #define T_DB Bit_DB_T
 typedef struct T_DB *T_DB;
 
+typedef struct Bit_pool_T *Bit_pool_T;
+
+typedef struct Bit_shards_T *Bit_shards_T;
+
+typedef struct Bit_ctx_T *Bit_ctx_T;
+
+typedef struct Bit_cancel_T *Bit_cancel_T;
+
+typedef struct Bit_queue_T *Bit_queue_T;
+
+typedef struct Bit_query_T *Bit_query_T;
+
+typedef struct Bit_async_T *Bit_async_T;
+
+typedef struct Bit_writer_T *Bit_writer_T;
+
+typedef struct Bit_zreader_T *Bit_zreader_T;
+
+typedef struct Bit_reader_T *Bit_reader_T;
+
+typedef struct Bit_tiles_T *Bit_tiles_T;
+
+#define T_C Bit_C_T
+typedef struct T_C *T_C;
+
+#define T_SDB Bit_SDB_T
+typedef struct T_SDB *T_SDB;
+
+#define T_PDB Bit_PDB_T
+typedef struct T_PDB *T_PDB;
+
+#define T_W Bit_W_T
+typedef struct T_W *T_W;
+
+#define T_L Bit_L_T
+typedef struct T_L *T_L;
+
+#define T_BF Bit_BF_T
+typedef struct T_BF *T_BF;
+
+#define T_BSI Bit_BSI_T
+typedef struct T_BSI *T_BSI;
+
+#define T_MIH Bit_MIH_T
+typedef struct T_MIH *T_MIH;
+
+#define T_RDB Bit_RDB_T
+typedef struct T_RDB *T_RDB;
+
+#define T_IDB Bit_IDB_T
+typedef struct T_IDB *T_IDB;
+
+/* Register blocks (queries x targets per microkernel call) of the CPU count
+   kernels. Every variant is compiled into the library, see Bit_tuning_*. */
+typedef enum {
+  BIT_TUNING_BLOCK_DEFAULT = 0, // OUTER_ROW_NUM x OUTER_COL_NUM of the build
+  BIT_TUNING_BLOCK_1X1,
+  BIT_TUNING_BLOCK_2X2,
+  BIT_TUNING_BLOCK_4X2,
+  BIT_TUNING_BLOCK_4X4,
+  BIT_TUNING_BLOCK_SLICED, // 1 query x 64 bit-sliced targets, see below
+  BIT_TUNING_BLOCK_RECURSIVE, // cache-oblivious halving, see below
+  BIT_TUNING_BLOCK_COUNT
+} Bit_tuning_block;
+
+typedef struct {
+  Bit_tuning_block block; // register block of the count microkernel
+  int tile;               // rows of each container per cache tile
+  int k_block;            // qwords of a row per tile pass, a multiple of 8
+  int prefetch;           // cache lines of a row prefetched ahead, 0 for none
+} Bit_tuning;
+
+/* Functions Bit_stats_snapshot reports at most */
+#define BIT_STATS_CALLS 64
+
+/* Profile of one public function, see Bit_stats_snapshot */
+typedef struct {
+  const char *name; // function name
+  uint64_t calls;   // calls since the last reset
+  uint64_t ticks;   // time in the calls, nested calls included
+  uint64_t bytes;   // operand bytes read and result bytes written
+} Bit_stats_call;
+
+/* Hot-path profile of a library built with PROFILE=1 */
+typedef struct {
+  bool enabled;           // false, and the rest zero, without PROFILE=1
+  const char *ticks_unit; // "cycles" (time stamp counter) or "ns"
+  const char *isa;        // kernel instruction set picked for this host
+  const char *simd;       // its vector path: avx512, avx2, 128 or scalar
+  int ncalls;             // entries of calls, by name
+  Bit_stats_call calls[BIT_STATS_CALLS];
+  uint64_t db_aligned, db_unaligned; // DB count kernel load paths
+  uint64_t setop_aligned, setop_unaligned; // single bitset kernels
+  uint64_t blocks[BIT_TUNING_BLOCK_COUNT]; // DB count calls per block
+} Bit_stats;
+
+/* Calls recorded by Bit_capture_start */
+typedef enum {
+  BIT_CAPTURE_COUNT_CPU = 0,        // BitDB_*_count_store_cpu and typed
+  BIT_CAPTURE_COUNT_GPU,            // BitDB_*_count_store_gpu and typed
+  BIT_CAPTURE_TOPK_CPU,             // BitDB_inter_count_topk
+  BIT_CAPTURE_TOPK_GPU,             // BitDB_inter_count_topk_gpu
+  BIT_CAPTURE_THRESHOLD_CPU,        // BitDB_inter_count_threshold
+  BIT_CAPTURE_THRESHOLD_GPU,        // BitDB_inter_count_threshold_gpu
+  BIT_CAPTURE_SIMILARITY_TOPK,      // BitDB_similarity_topk
+  BIT_CAPTURE_SIMILARITY_THRESHOLD, // BitDB_similarity_threshold
+  BIT_CAPTURE_CALLS
+} Bit_capture_call;
+
+/* Bit_capture_start flag: hash and popcount the operands of every call */
+#define BIT_CAPTURE_DATA 1u
+
+/* One recorded call, as stored in a capture file */
+typedef struct {
+  uint16_t call;        // Bit_capture_call
+  uint16_t op;          // Bit_count_ops, or the Bit_similarity_metric
+  uint32_t thread;      // calling thread, numbered by first recorded call
+  uint64_t start_ns;    // since Bit_capture_start
+  uint64_t elapsed_ns;  // time in the call
+  uint32_t nqueries;    // rows of the first container
+  uint32_t ntargets;    // rows of the second container
+  uint32_t length;      // bits of the rows
+  int32_t k;            // k of a top-k, threshold of a threshold search
+  float cutoff;         // cutoff of a similarity threshold search
+  int32_t num_cpu_threads, device_id, bit_lo, bit_hi; // of opts
+  uint8_t algorithm, isa, store, exec; // of opts
+  uint8_t counts_type;  // Bit_counts_type of a count store
+  uint8_t self;         // 1 if both containers were the same
+  uint8_t reserved[2];
+  uint64_t ones_q, ones_t; // set bits of the containers (BIT_CAPTURE_DATA)
+  uint64_t hash_q, hash_t; // hashes of their rows (BIT_CAPTURE_DATA)
+} Bit_capture_record;
+
+/* What the bytes of Bit_memory_stats are held for */
+typedef enum {
+  BIT_MEM_BITSETS = 0, // Bit_T headers and payloads, bitset pool slabs
+  BIT_MEM_CONTAINERS,  // rows of the Bit_DB containers the library allocated
+  BIT_MEM_MAPPED,      // files and snapshots mapped by the containers
+  BIT_MEM_RESULTS,     // Bit_ctx_counts, Bit_pinned_alloc, Bit_huge_alloc
+  BIT_MEM_SCRATCH,     // per-thread scratch kept by the contexts
+  BIT_MEM_DEVICE,      // container and counts buffers mapped on the GPUs
+  BIT_MEM_TRANSPOSED,  // device scratch of the layout transitions
+  BIT_MEM_CATEGORIES
+} Bit_mem_category;
+
+#define BIT_MEM_MAX_DEVICES 16
+
+/* Memory held by the library, see Bit_memory_stats */
+typedef struct Bit_mem_stats {
+  size_t bytes[BIT_MEM_CATEGORIES]; // held now (devices summed)
+  size_t peak[BIT_MEM_CATEGORIES];  // high-water marks since the last reset
+  size_t host_bytes, host_peak;     // the host categories together
+  int ndevices;                     // devices reported below
+  size_t device_bytes[BIT_MEM_MAX_DEVICES]; // mapped and scratch, by device
+  size_t device_peak[BIT_MEM_MAX_DEVICES];
+} Bit_mem_stats;
+
+/* Engine a BitDB_estimate is made for */
+typedef enum {
+  BIT_ESTIMATE_CPU = 0, // the CPU count stores
+  BIT_ESTIMATE_GPU,     // the GPU count stores on opts.device_id
+  BIT_ESTIMATE_AUTO,    // whichever of the two is predicted to finish first
+} Bit_estimate_target;
+
+/* A count call described by its sizes, see BitDB_estimate */
+typedef struct {
+  int nqueries, ntargets; // rows of the two containers
+  int length;             // bits of the rows
+  int k;                  // results kept per query of a top-k, 0: all counts
+  bool queries_resident;  // already on the device (mapped or attached)
+  bool targets_resident;
+} Bit_estimate_shape;
+
+/* What BitDB_estimate predicts for a call */
+typedef struct {
+  double seconds;        // runtime, copies included
+  double copy_seconds;   // of which host <-> device copies
+  uint64_t memory_bytes; // rows and counts read and written by the kernels
+  uint64_t copy_bytes;   // host <-> device copies
+  size_t peak_bytes;     // results and device buffers the call holds
+  bool gpu;              // the engine the estimate is for
+  bool calibrated;       // false if a rate was not measured on this host
+} Bit_estimate;
+
+/* How far a count store call with a cancellation token or deadline got */
+typedef struct {
+  bool stopped;     // true if the call returned before all counts were done
+  int queries_done; // leading rows of bit whose counts are all complete
+} Bit_progress;
+
+/* How the CPU count stores spread their tiles (see Bit_ctx_free) */
+typedef enum {
+  BIT_EXEC_TEAM = 0,  // a team of num_cpu_threads threads per call
+  BIT_EXEC_TASKS = 1, // in a parallel region, tasks of the caller's team
+} Bit_exec;
+
+/* Kernel tier of the CPU count stores of a call (see Bit_isa_calibrate) */
+typedef enum {
+  BIT_ISA_AUTO = 0,   // the host's tier, or AVX2 below the work threshold
+  BIT_ISA_WIDEST = 1, // the host's tier, AVX-512 where supported
+  BIT_ISA_NARROW = 2, // AVX2 on a host whose tier is AVX-512
+} Bit_isa_policy;
+
+/* How the CPU count stores of a call write their counts (see
+   Bit_store_threshold_get) */
+typedef enum {
+  BIT_STORE_CACHED = 0, // through the caches, accumulated in place
+  BIT_STORE_STREAM = 1, // each finished tile once, with non-temporal stores
+  BIT_STORE_AUTO = 2,   // streamed when the counts pass the threshold
+} Bit_store_policy;
+
+/* Hardware threads of a core that a Bit_affinity keeps */
+typedef enum {
+  BIT_SMT_ALL = 0,          // every hardware thread of the kept cores
+  BIT_SMT_ONE_PER_CORE = 1, // the first hardware thread of each core
+} Bit_smt_policy;
+
+/* CPUs the team of a CPU count store is pinned to (see Bit_affinity_cpus) */
+typedef struct {
+  const int *cpus;    // logical CPUs to use, in order, or NULL for all
+  int ncpus;          // entries of cpus
+  uint64_t sockets;   // bit s set: package s may be used; 0 for every one
+  Bit_smt_policy smt; // hardware threads kept per core
+} Bit_affinity;
+
 typedef struct {
   int num_cpu_threads;      // number of CPU threads
   int device_id;            // GPU device ID, ignored for CPU
@@ -172,9 +643,221 @@ typedef struct {
   enum {
     TRANSPOSED_TEAM_PARALLEL_SIMD = 0, // transpose + team parallel + SIMD
     SHARED_TILE_ILP = 1,               // Shared tile + Instruction level parallelism
+    ZCURVE_TILED = 2,                  // Z-curve (Morton) tiled targets
+    BIT_SLICED = 3,                    // bit-sliced (64-row interleaved) targets
+    NATIVE_COARSENED = 4,              // native CUDA/HIP kernel, see below
+    K_SPLIT = 5,                       // word ranges of few long rows
   } algorithm; // algorithm to use for GPU set operations
+  const Bit_tuning *tuning; // CPU tile kernels; NULL for Bit_tuning_get()
+  Bit_ctx_T ctx;            // scratch reused across calls, or NULL
+  T row_mask; // search modes: the target rows to search, or NULL for all
+  Bit_cancel_T cancel;    // count stores stop once it is cancelled, or NULL
+  double deadline;        // ... or once omp_get_wtime() reaches it (0: never)
+  Bit_progress *progress; // receives how far a count store got, or NULL
+  void (*on_tile)(void *cl, int first_query, int nquery, int first_target,
+                  int ntarget); // count stores: a tile of counts is final
+  void (*on_progress)(void *cl, size_t tiles_done, size_t tiles_total,
+                      uint64_t bytes_scanned); // ... after every such tile
+  void *hook_cl; // cl of on_tile and on_progress
+  Bit_exec exec; // CPU count stores: a team of their own or the caller's
+  const Bit_affinity *affinity; // CPU count stores: pin the team, or NULL
+  Bit_isa_policy isa; // CPU count stores: kernel tier of the call
+  Bit_store_policy store; // CPU count stores: how the counts are written
+  int bit_lo, bit_hi; // CPU int count stores: bits [bit_lo, bit_hi) only,
+                      // the whole rows if bit_hi is 0
 } SETOP_COUNT_OPTS;
 
+/* Output layouts of the BitDB_SETOP_count_self_cpu self-joins */
+typedef enum {
+  BIT_SELF_MIRROR = 0, // full n x n matrix, both triangles written
+  BIT_SELF_PACKED = 1, // row-major upper triangle with diagonal, n(n+1)/2
+} Bit_self_layout;
+
+/* Page placement of the rows of BitDB_new_numa on NUMA machines */
+typedef enum {
+  BIT_NUMA_LOCAL = 0,       // node of the allocating thread (BitDB_new)
+  BIT_NUMA_FIRST_TOUCH = 1, // node of the thread whose tiles use the rows
+  BIT_NUMA_INTERLEAVE = 2,  // pages spread round robin over all nodes
+} Bit_numa_policy;
+
+/* Pages of the rows of BitDB_new_huge and of Bit_huge_alloc buffers; each
+   falls back to the one above it when the system cannot provide it */
+typedef enum {
+  BIT_PAGES_DEFAULT = 0,    // base pages (4 KiB), as BitDB_new
+  BIT_PAGES_HUGE = 1,       // transparent huge pages (2 MiB aligned, advised)
+  BIT_PAGES_HUGETLB = 2,    // reserved 2 MiB huge pages (MAP_HUGETLB)
+  BIT_PAGES_HUGETLB_1G = 3, // reserved 1 GiB huge pages
+} Bit_page_policy;
+
+/* Ops requested from BitDB_multi_count_store, or-ed together */
+typedef enum {
+  BIT_COUNT_INTER = 1, // |A & B|
+  BIT_COUNT_UNION = 2, // |A | B|
+  BIT_COUNT_DIFF = 4,  // |A ^ B|
+  BIT_COUNT_MINUS = 8, // |A & ~B|
+  BIT_COUNT_ALL = 15
+} Bit_count_ops;
+
+/* A generated register block count kernel, see Bit_kernel_variants */
+typedef struct {
+  const char *name;  // op_RxCxV_load, e.g. "and_4x4x1_aligned"
+  Bit_count_ops op;  // BIT_COUNT_INTER, _UNION, _DIFF or _MINUS
+  int rows, cols;    // queries x targets per microkernel call
+  int vec_blk;       // vectors of every row per step of the word loop
+  bool aligned;      // aligned vector loads
+} Bit_kernel_variant;
+
+/* Sums of the boolean matrix products of BitDB_matrix_product */
+typedef enum {
+  BIT_MATRIX_BOOLEAN = 0, // C[i][k] = OR over j of A[i][j] AND B[j][k]
+  BIT_MATRIX_GF2,         // C[i][k] = XOR over j of A[i][j] AND B[j][k]
+} Bit_matrix_ring;
+
+/* Comparisons of the values of a Bit_BSI_T with a constant */
+typedef enum {
+  BIT_BSI_LT = 0, // value < c
+  BIT_BSI_LE,     // value <= c
+  BIT_BSI_GT,     // value > c
+  BIT_BSI_GE,     // value >= c
+  BIT_BSI_EQ,     // value == c
+  BIT_BSI_NE,     // value != c
+} Bit_bsi_op;
+
+/* Text formats of BitDB_load_text: one row per line */
+typedef enum {
+  BIT_TEXT_HEX = 0, // hex digits of the row bytes (FPS), e.g. "0a3f..."
+  BIT_TEXT_INDICES, // indices of the set bits (CSV), e.g. "3,17,256"
+} Bit_text_format;
+
+/* Reductions of many bitsets into one (Bit_reduce, BitDB_reduce) */
+typedef enum {
+  BIT_REDUCE_OR = 0,   // bits set in any input (union)
+  BIT_REDUCE_AND,      // bits set in every input (intersection)
+  BIT_REDUCE_XOR,      // bits set in an odd number of inputs
+  BIT_REDUCE_ATLEAST,  // bits set in at least k inputs
+  BIT_REDUCE_MAJORITY, // bits set in more than half of the inputs
+} Bit_reduce_op;
+
+/* How BitDB_inter_count_screened screens a target from its sampled words */
+typedef enum {
+  BIT_SCREEN_BOUND = 0, // an upper bound of the count: no match is lost
+  BIT_SCREEN_ESTIMATE,  // the sampled count, scaled: may lose matches
+} Bit_screen_mode;
+
+/* An int8 matrix product for BitDB_count_store_gemm: c[i * n + j] = the
+   sum over l < k of a[i * k + l] * b[j * k + l], i.e. a (m x k) times the
+   transpose of b (n x k), all row major. Returns 0 on success */
+typedef int (*Bit_gemm_s8)(void *ctx, int m, int n, int k, const int8_t *a,
+                           const int8_t *b, int32_t *c);
+
+typedef struct {
+  const char *name; // reported by Bit_gemm_backend_name
+  Bit_gemm_s8 gemm; // oneDNN, cuBLASLt, an NPU runtime, ...
+  void *ctx;        // first argument of gemm
+} Bit_gemm_backend;
+
+/* Element types of the count matrices of BitDB_count_store_typed_* */
+typedef enum {
+  BIT_COUNTS_AUTO = 0, // the narrowest type that holds counts of length bits
+  BIT_COUNTS_U8,       // uint8_t, lengths up to 255
+  BIT_COUNTS_U16,      // uint16_t, lengths up to 65535
+  BIT_COUNTS_I32,      // int, as the BitDB_SETOP_count_store functions
+} Bit_counts_type;
+
+/* Statistics of the counts of one query against every target, see
+   BitDB_count_stats_cpu */
+typedef struct {
+  double mean;     // of the counts
+  double variance; // population variance: divided by the number of targets
+  int min, max;    // smallest and largest count
+} Bit_count_stats;
+
+/* Orders of the rows of a Bit_DB, see BitDB_reorder */
+typedef enum {
+  BIT_ORDER_COUNT = 0,  // increasing popcount, ties in row order
+  BIT_ORDER_GRAY,       // Gray-code order: neighbouring rows differ little
+  BIT_ORDER_COUNT_GRAY, // increasing popcount, ties in Gray-code order
+  BIT_ORDER_PERM,       // the caller's permutation
+} Bit_row_order;
+
+/* Similarity coefficients of two bitsets A and B, see BitDB_similarity_* */
+typedef enum {
+  BIT_SIMILARITY_TANIMOTO = 0, // |A & B| / |A | B| (Jaccard)
+  BIT_SIMILARITY_DICE,         // 2 |A & B| / (|A| + |B|)
+  BIT_SIMILARITY_COSINE,       // |A & B| / sqrt(|A| |B|)
+  BIT_SIMILARITY_TVERSKY,      // |A & B| / (|A & B| + alpha |A - B|
+                               //            + beta |B - A|)
+} Bit_similarity_metric;
+
+typedef struct {
+  Bit_similarity_metric metric; // coefficient to compute
+  double alpha, beta;           // Tversky weights, ignored by other metrics
+} Bit_similarity;
+
+/* Op-codes of a fused count expression, see Bit_expr_count */
+typedef enum {
+  BIT_EXPR_PUSH = 0, // push the next operand
+  BIT_EXPR_PUSH_ROW, // push the current row (BitDB_expr_count_* only)
+  BIT_EXPR_AND,      // pop b, a; push a & b
+  BIT_EXPR_OR,       // pop b, a; push a | b
+  BIT_EXPR_XOR,      // pop b, a; push a ^ b
+  BIT_EXPR_AND_NOT,  // pop b, a; push a & ~b
+  BIT_EXPR_NOT,      // pop a; push ~a
+} Bit_expr_op;
+
+#define BIT_EXPR_MAX_DEPTH 8 // maximum stack depth of an expression
+
+/* Device layouts counted by Bit_gpu_stats: row-major, column-major, Z-curve
+   tiles and bit-sliced groups, in that order */
+#define BIT_GPU_LAYOUTS 4
+
+/* Telemetry of the GPU functions, see Bit_gpu_stats_get */
+typedef struct {
+  uint64_t layout_hits;   // layout checks that found the buffer as needed
+  uint64_t layout_misses; // layout checks that had to lock it to change it
+  uint64_t transitions[BIT_GPU_LAYOUTS][BIT_GPU_LAYOUTS]; // [from][to]
+  uint64_t h2d_bytes, d2h_bytes;         // bytes copied to / from devices
+  uint64_t h2d_transfers, d2h_transfers; // copies behind those bytes
+  uint64_t evictions, evicted_bytes;     // unmapped over a device budget
+  double transition_seconds; // in layout transitions (timers on only)
+  double transfer_seconds;   // in blocking copies (timers on only)
+  double kernel_seconds;     // in set-operation kernels (timers on only)
+  uint64_t auto_cpu_calls, auto_gpu_calls; // routing of the auto target
+  double auto_cpu_estimate, auto_gpu_estimate; // seconds the cost model
+                                               // gave the last auto call
+} Bit_gpu_stats;
+
+/* Build and host configuration of the library, see Bit_get_configuration */
+typedef struct Bit_config {
+  // CPU kernels
+  const char *isa;      // kernel instruction set picked for this host
+  const char *simd;     // its vector path: avx512, avx2, 128 or scalar
+  const char *popcount; // bulk popcount of the kernels, see below
+  bool isa_dispatch;    // variants picked at load time (ISA_DISPATCH=1)
+  int alignment;        // bytes of alignment of the rows of Bit_new/BitDB_new
+  Bit_tuning tuning;    // process-wide tuning of the DB count kernels
+  int cpu_tile_bit, cpu_tile_bits, k_block; // build tile parameters
+  int setop_buffer_size;                    // qwords staged per popcount
+  int outer_rows, outer_cols, outer_vec_blk; // default register block
+  // OpenMP
+  int omp_max_threads;  // omp_get_max_threads()
+  int omp_thread_limit; // omp_get_thread_limit()
+  int omp_num_procs;    // omp_get_num_procs()
+  // GPU
+  bool gpu;                   // built with offload kernels (not GPU=NONE)
+  int gpu_devices;            // omp_get_num_devices()
+  int gpu_default_device;     // omp_get_default_device()
+  const char *gpu_archs;      // offload architectures, comma separated
+  int gpu_tile_j, gpu_ilp;    // SHARED_TILE_ILP tile of the build
+  int gpu_word_bits;          // word width on the default device
+  unsigned int gpu_algorithms; // 1u << algorithm of the runnable ones
+  const char *native_backend; // "cuda", "hip", or NULL for none
+  int native_devices;         // devices of the native backend
+  // instrumentation
+  bool profile; // PROFILE=1, see Bit_stats_snapshot
+  bool trace;   // TRACE=1, see the README
+} Bit_config;
+
 /*
     Functions that create, free and obtain the properties of the bitset. Note
     the following error checking
@@ -185,13 +868,35 @@ typedef struct {
     * Bit_load          : Checked runtime error if length is less than 0 or
                           greater than INT_MAX. Also checks if buffer is NULL
                           Cannot possibly check if the buffer is padded to
-                          the next multiple of the size of a uint64_t.
+                          the next multiple of the size of a uint64_t. A
+                          misaligned buffer is not an error (see above).
     * Bit_buffer_size   : Checked runtime error if length is less than 0 or
                           greater than INT_MAX.
     * Bit_length        : Obtains the length (capacity of the bitset) in bits.
                           It is a checked runtime error to a non-positive length
                           or a length greater than INT_MAX.
     * Bit_count         : Counts the number of set bits set in the bitset.
+                          The count is cached until the bits change: every
+                          library function that writes them drops it, and
+                          Bit_bset, Bit_bclear and Bit_put keep it exact, so
+                          a count of an unchanged set is O(1). Caching makes
+                          the first count after a change a write, so sets
+                          counted from several threads are counted once
+                          first, as for Bit_rank_build.
+    * Bit_touch         : Marks the cached count, the rank/select index and
+                          the block summary of set stale. Call it after
+                          writing to the buffer of a Bit_load set (or a row
+                          under a BitDB_view_at view) behind the library's
+                          back; nothing else can see such writes.
+    * Bit_hash64        : 64-bit hash of the bits and the length of set,
+                          for seed. Equal sets hash equal whatever their
+                          storage (Bit_new, Bit_load, a BitDB_view_at row),
+                          and a row of a container hashes as BitDB_hash_rows
+                          hashes it. The hash reads the set a qword at a time
+                          in eight independent lanes (vectors of them where
+                          the instruction set has them) and is the same on
+                          every instruction set the library dispatches to.
+                          It is not a cryptographic hash.
 
     It is a checked runtime error to pass a NULL set to any of these routines.
 */
@@ -203,6 +908,55 @@ extern int Bit_extract(T set, void *buffer);
 extern int Bit_buffer_size(int length);
 extern int Bit_length(T set);
 extern int Bit_count(T set);
+extern void Bit_touch(T set);
+extern uint64_t Bit_hash64(T set, uint64_t seed);
+
+/*
+    Run-length encoded serialization, for storing and shipping mostly empty
+    bitsets. The stream is word-aligned (EWAH): runs of qwords that are all
+    zeros or all ones take one marker word, and the other qwords are copied
+    verbatim, so it is at most two words longer than Bit_extract's bytes.
+    * Bit_serialize_rle   : Writes the stream of set into buffer and returns
+                            its bytes. With a NULL buffer only returns the
+                            bytes.
+    * Bit_deserialize_rle : A new bitset from the stream in the bytes of
+                            buffer.
+    * Bit_rle_length      : Length in bits of the bitset of a stream.
+    * Bit_rle_count       : Set bits of a stream.
+    * Bit_rle_inter_count : Set bits of the intersection of two streams.
+    * Bit_rle_inter       : Writes the stream of the intersection of two
+                            streams into buffer and returns its bytes, or
+                            only its bytes with a NULL buffer.
+    The last three work on the streams themselves: a run of zeros in either
+    stream skips the words of the other, and runs of ones are counted
+    without reading them.
+
+    Streams are arrays of uint64_t in host byte order, so buffers must be
+    aligned to 8 bytes. It is a checked runtime error to pass a NULL set or
+    stream, a truncated stream, or two streams of different lengths.
+*/
+extern int Bit_serialize_rle(T set, void *buffer);
+extern T Bit_deserialize_rle(const void *buffer, int bytes);
+extern int Bit_rle_length(const void *buffer);
+extern int Bit_rle_count(const void *buffer);
+extern int Bit_rle_inter_count(const void *s, const void *t);
+extern int Bit_rle_inter(const void *s, const void *t, void *buffer);
+
+/*
+    Bitset pools for high-churn temporaries. A pool hands out bitsets of one
+    length, carving header and payload together from slabs of per_slab
+    bitsets, and Bit_free of a pooled bitset returns it to its pool; both
+    are O(1) and do not touch the heap once the pool is warm. Bit_new uses
+    the same single-block layout, so it makes one allocation per bitset.
+
+    A pool is not thread safe: use one pool per thread. Bit_pool_free
+    releases every bitset of the pool, including those still in use.
+    It is a checked runtime error to pass a non-positive length or per_slab
+    to Bit_pool_new, or a NULL pool to the other two functions.
+*/
+extern Bit_pool_T Bit_pool_new(int length, int per_slab);
+extern T Bit_pool_get(Bit_pool_T pool);
+extern void Bit_pool_free(Bit_pool_T *pool);
 
 /*
     Functions that manipulate an individual bitset (member operations).
@@ -212,6 +966,10 @@ extern int Bit_count(T set);
     is less than zero, 3) the high bit to be greater than the bitset
     length and 4) the low bit to be greater than the high bit, 5) the
     indices to attempt to overrun the bitset length.
+
+    Loops dominated by single-bit calls can include bit_inline.h instead,
+    which exposes the layout of Bit_T and provides static inline versions
+    of Bit_get, Bit_bset, Bit_bclear and Bit_put (checked and unchecked).
     */
 extern void Bit_aset(T set, int indices[], int n); // set an array of bits
 extern void Bit_bset(T set, int index); // set a bit in the bitset to 1
@@ -221,6 +979,8 @@ extern void Bit_bclear(T set, int index); // clear a bit in the bitset
 extern void Bit_clear(T set, int lo,
                       int hi); // clear a range of bits [lo,hi] in the bitset
 extern int Bit_get(T set, int index); // returns the bit at index
+extern void Bit_aget(T set, int indices[], int n,
+                     int out[]); // out[i] = bit at indices[i]
 extern void
 Bit_map(T set, void apply(int n, int bit, void *cl),
         void *cl); // maps apply to bit n in the range [0, length-1], where *cl
@@ -231,16 +991,153 @@ extern int Bit_put(T set, int n, int val); // sets the nth bit to val in set
 extern void Bit_set(T set, int lo,
                     int hi); // sets a range of bits [lo,hi] in the bitset
 
+/*
+    Rank and select, backed by an index of cumulative popcounts per 512-bit
+    block. The index is built on first use (or by Bit_rank_build) and is
+    marked stale by every library function that modifies the bitset; the
+    next query rebuilds it. Modifying an externally loaded buffer behind
+    the library's back is not detected; call Bit_touch afterwards.
+
+        > Bit_rank(set, i) returns the number of set bits in [0, i); O(1)
+        > Bit_select(set, k) returns the position of the k-th set bit,
+          counting from 0, or -1 if the bitset has k or fewer set bits;
+          O(log(length / 512))
+
+    Building the index is not thread safe, so bitsets that are queried from
+    several threads should be built with Bit_rank_build first.
+    It is a checked runtime error to pass a NULL set, an index outside
+    [0, length] to Bit_rank, or a negative k to Bit_select.
+*/
+extern int Bit_rank(T set, int index);
+extern int Bit_select(T set, int k);
+extern void Bit_rank_build(T set);
+
+/*
+    Non-empty block summaries: one bit per 512-bit block of the bitset, set
+    iff the block holds a set bit. With a summary, Bit_count, the SETOP
+    counts, the set operations and the comparisons only visit the blocks
+    their result can have bits in (for an intersection the blocks non-empty
+    in both operands, for a difference those of the left one), so
+    clustered, sparse bitsets leave most of their cache lines untouched.
+    The counts and set operations take the skipping path when both operands
+    keep summaries and the blocks to visit are at most half of them; the
+    result of Bit_diff, Bit_minus, Bit_inter and Bit_union then keeps a
+    summary as well.
+
+        > Bit_cache_summary(set, true) builds the summary (again, if the
+          set has one) and keeps it from then on; false drops it
+
+    Bit_aset, Bit_bset, Bit_put, Bit_set and their clearing and inverting
+    counterparts update the summary in place; the *_into and *_assign
+    forms leave a destination that skipped blocks with a current summary,
+    and one that ran in full with a stale one that the next use rebuilds,
+    which is not thread safe. Changes made behind the library's back (e.g.
+    to a Bit_load buffer) are not seen until Bit_touch or Bit_cache_summary
+    is called. Bitsets returned to a pool drop their summary.
+    It is a checked runtime error to pass a NULL set.
+*/
+extern void Bit_cache_summary(T set, bool enable);
+
+/*
+    Sorted index lists: same as Bit_aset / Bit_aclear, but indices that fall
+    in the same 64-bit word are folded into a single update. It is a checked
+    runtime error for the indices to not be in non-decreasing order, in
+    addition to the errors listed for the member operations above.
+*/
+extern void Bit_aset_sorted(T set, int indices[], int n);
+extern void Bit_aclear_sorted(T set, int indices[], int n);
+
+/*
+    Parallel construction. The member operations read and write whole bytes
+    or words, so two threads setting bits of the same word lose one of the
+    bits. The atomic forms set bits with a relaxed atomic OR of the 64-bit
+    word instead, so any number of threads can set bits of one bitset. They
+    order nothing else: read the bitset after the threads have joined.
+
+    * Bit_bset_atomic  : Bit_bset, atomically.
+    * Bit_aset_atomic  : Bit_aset, atomically; bits already set cost a load.
+    * Bit_test_and_set : Sets a bit atomically and returns what it was, so
+                         exactly one of the threads setting it sees 0.
+
+    When every thread sets many bits, private shards are usually faster:
+    there is no contention on the words and no locked instruction.
+
+    * Bit_shards_new   : nshards empty bitsets of length, one per thread.
+    * Bit_shards_get   : Shard number shard, for the plain member operations
+                         of one thread (e.g. omp_get_thread_num()).
+    * Bit_shards_merge : ORs every shard into set and empties the shards,
+                         one cache-sized chunk of the words at a time, in
+                         parallel. Call it once the threads are done.
+    * Bit_shards_free  : Frees the shards and zeros the pointer.
+
+    The checked runtime errors are those of the member operations, and for
+    the shards a non-positive length or nshards, a shard outside the
+    shards, a set of another length or a NULL handle.
+*/
+extern void Bit_bset_atomic(T set, int index);
+extern void Bit_aset_atomic(T set, int indices[], int n);
+extern int Bit_test_and_set(T set, int index);
+extern Bit_shards_T Bit_shards_new(int length, int nshards);
+extern T Bit_shards_get(Bit_shards_T shards, int shard);
+extern void Bit_shards_merge(Bit_shards_T shards, T set);
+extern void Bit_shards_free(Bit_shards_T *shards);
+
+/*
+    Set-bit enumeration. These skip zero qwords and jump between set bits,
+    so they cost O(popcount + length/64) rather than O(length) as Bit_map.
+
+        > Bit_next_set(set, from) returns the smallest set index >= from, or
+          -1 if there is none (including when from >= length)
+        > Bit_prev_set(set, from) returns the largest set index <= from, or
+          -1 if there is none (including when from < 0)
+        > Bit_foreach_set(set, apply, cl) calls apply(n, cl) for each set bit
+          n in increasing order. If apply changes the bitset, changes in the
+          current 64-bit word are not seen by subsequent calls.
+        > Bit_to_indices(set, out, max) writes the smallest min(max, count)
+          set indices to out in increasing order and returns the count of
+          set bits, so a count above max tells that out was too short. The
+          kernels decode a word at a time: AVX-512 compresses lane indices
+          under each 16 bits (vpcompressd), AVX2 and the 128-bit tiers
+          widen the positions of each byte from a table. Sets of 256 KiB or
+          more are decoded by the threads, each range at the prefix sum of
+          the popcounts of the ranges before it.
+
+    A typical loop is
+        for (int i = Bit_next_set(s, 0); i >= 0; i = Bit_next_set(s, i + 1))
+
+    It is a checked runtime error to pass a NULL set, a negative from to
+    Bit_next_set, a from >= length to Bit_prev_set, a negative max, or a
+    NULL out with a positive max to Bit_to_indices.
+*/
+extern int Bit_next_set(T set, int from);
+extern int Bit_prev_set(T set, int from);
+extern void Bit_foreach_set(T set, void apply(int n, void *cl), void *cl);
+extern int Bit_to_indices(T set, int *out, int max);
+
+/*
+    Batched range operations: apply Bit_set, Bit_clear or Bit_not to each of
+    the n ranges [lo[i], hi[i]], in order. Overlapping ranges are allowed.
+    The checked runtime errors of the single range functions apply to every
+    range, and it is a checked runtime error to pass NULL lo or hi arrays.
+*/
+extern void Bit_set_ranges(T set, int lo[], int hi[], int n);
+extern void Bit_clear_ranges(T set, int lo[], int hi[], int n);
+extern void Bit_not_ranges(T set, int lo[], int hi[], int n);
+
 /*
     Functions that compare two bitsets; note the following error checking:
 
     It is a checked runtime error for the two bitsets to be of different
     lengths, or if s or t are NULL.
+    Bit_leq and Bit_lt test for subset and proper subset respectively. All
+    of these stop at the first block of words that decides the answer.
 
 */
 extern int Bit_eq(T s, T t);  // compare two bitsets for equality
 extern int Bit_leq(T s, T t); // compare two bitsets for less than or equal
 extern int Bit_lt(T s, T t);  // compare two bitsets for less than
+extern int Bit_intersects(T s, T t); // 1 if s and t have a common bit
+extern int Bit_disjoint(T s, T t);   // 1 if s and t have no common bit
 
 /*
     Functions that operate on sets of bitsets (and create a new one):
@@ -264,6 +1161,54 @@ extern T Bit_inter(T s, T t); // intersection of two bitsets
 extern T Bit_minus(T s, T t); // symmetric difference of two bitsets
 extern T Bit_union(T s, T t); // union of two bitsets
 
+/*
+    Same set operations, written into caller-supplied storage instead of a
+    freshly allocated bitset. dst must have the same length as the operands
+    and may alias either of them; the NULL and s == t rules above apply
+    unchanged. Bit_X_assign(s, t) is shorthand for Bit_X_into(s, s, t).
+    It is a checked runtime error for dst to be NULL, or for s to be NULL
+    in the *_assign forms.
+*/
+extern void Bit_diff_into(T dst, T s, T t);
+extern void Bit_inter_into(T dst, T s, T t);
+extern void Bit_minus_into(T dst, T s, T t);
+extern void Bit_union_into(T dst, T s, T t);
+extern void Bit_diff_assign(T s, T t);  // s = s XOR t
+extern void Bit_inter_assign(T s, T t); // s = s AND t
+extern void Bit_minus_assign(T s, T t); // s = s AND NOT t
+extern void Bit_union_assign(T s, T t); // s = s OR t
+
+/*
+    Shifts, rotations and dilation, for position masks such as k-mer or
+    time-series windows. "Left" moves bit i to bit i + k (towards the end
+    of the set, as << does within a word) and "right" to bit i - k. Shifts
+    drop the bits moved past either end and clear the bits they vacate;
+    rotations wrap them around modulo the length.
+        > Bit_shift_left(set, k), Bit_shift_right, Bit_rotate_left and
+          Bit_rotate_right work in place, the *_into(dst, s, k) forms write
+          dst, which may be s
+        > Bit_dilate(set, before, after) sets bit i iff the set had a bit
+          in [i - before, i + after] (the OR of the shifts of the set by
+          -after .. before); Bit_dilate_into(dst, s, before, after) writes
+          dst
+    The shifts run word by word, with one funnel shift of two neighbouring
+    qwords per word, close to the speed of a copy on the vector tiers. A
+    dilation takes about log2(before) + log2(after) such passes. A rotation
+    in place copies the set first.
+    It is a checked runtime error to pass NULL sets, sets of different
+    lengths, or a negative k, before or after.
+*/
+extern void Bit_shift_left(T set, int k);
+extern void Bit_shift_right(T set, int k);
+extern void Bit_rotate_left(T set, int k);
+extern void Bit_rotate_right(T set, int k);
+extern void Bit_shift_left_into(T dst, T s, int k);
+extern void Bit_shift_right_into(T dst, T s, int k);
+extern void Bit_rotate_left_into(T dst, T s, int k);
+extern void Bit_rotate_right_into(T dst, T s, int k);
+extern void Bit_dilate(T set, int before, int after);
+extern void Bit_dilate_into(T dst, T s, int before, int after);
+
 /*
     Functions that calculate population counts on the operations of sets of
     bitsets (but without creating a new bitset):
@@ -286,6 +1231,156 @@ extern int Bit_inter_count(T s, T t); // intersection of two bitsets
 extern int Bit_minus_count(T s, T t); // symmetric difference of two bitsets
 extern int Bit_union_count(T s, T t); // union of two bitsets
 
+/*
+    Batched pair counts: out[i] is the SETOP count of a[i] and b[i], as
+    from Bit_SETOP_count, for n pairs. The checks and the kernel lookup are
+    paid once per batch instead of once per pair, the words of the next
+    pair are prefetched while a pair is counted, and large batches are
+    split across the OpenMP threads. Unlike the single forms, the batch
+    does not take NULL bitsets or use block summaries. It is a checked
+    runtime error to pass a negative n, NULL arrays (unless n is 0), or a
+    NULL bitset or one of another length than a[0].
+*/
+extern void Bit_diff_count_batch(T a[], T b[], int n, int out[]);
+extern void Bit_inter_count_batch(T a[], T b[], int n, int out[]);
+extern void Bit_minus_count_batch(T a[], T b[], int n, int out[]);
+extern void Bit_union_count_batch(T a[], T b[], int n, int out[]);
+
+/*
+    Range-restricted and complement counts, computed in one pass over the
+    words of the range with nothing materialized (no Bit_not of a copy):
+        > Bit_count_range(set, lo, hi) counts the set bits in [lo, hi]; with
+          a current rank/select index it takes two O(1) rank lookups
+        > Bit_count_not(set) counts the clear bits, Bit_count_not_range
+          those in [lo, hi]
+        > Bit_SETOP_count_range(s, t, lo, hi) is the SETOP count over the
+          bits [lo, hi] only; Bit_minus_count_range(s, t, lo, hi) is
+          |s AND NOT t| there, the count of s within the complement of t
+    It is a checked runtime error to pass a NULL bitset (the range forms do
+    not take NULL for the empty set), bitsets of different lengths, or a
+    range outside 0 <= lo <= hi < length.
+*/
+extern int Bit_count_range(T set, int lo, int hi);
+extern int Bit_count_not(T set);
+extern int Bit_count_not_range(T set, int lo, int hi);
+extern int Bit_diff_count_range(T s, T t, int lo, int hi);
+extern int Bit_inter_count_range(T s, T t, int lo, int hi);
+extern int Bit_minus_count_range(T s, T t, int lo, int hi);
+extern int Bit_union_count_range(T s, T t, int lo, int hi);
+
+/*
+    N-way reductions: out = the op of n bitsets, computed a block of words
+    at a time so that each block of out is produced from all the inputs
+    while it is in cache, with the blocks (and, for short bitsets, groups
+    of the inputs) spread over the OpenMP threads. No intermediate bitset is
+    made. BIT_REDUCE_ATLEAST sets the bits that at least k inputs have (k
+    is ignored by the other ops); it counts with bit-sliced counters, so
+    consensus bits of 10^6 inputs cost about two word operations per input
+    word. BIT_REDUCE_MAJORITY is BIT_REDUCE_ATLEAST with k = n / 2 + 1.
+
+    * Bit_reduce   : Reduces in[0] .. in[n - 1] into out.
+    * BitDB_reduce : Reduces the rows of set into out, with
+                     opts.num_cpu_threads threads (all available if 0).
+
+    It is a checked runtime error to pass a NULL array, set or out, a
+    non-positive n, an empty set, an input of another length than out, an
+    op not listed above, or a negative k for BIT_REDUCE_ATLEAST.
+*/
+extern void Bit_reduce(T in[], int n, Bit_reduce_op op, int k, T out);
+extern void BitDB_reduce(T_DB set, Bit_reduce_op op, int k, T out,
+                         SETOP_COUNT_OPTS opts);
+
+/*
+    Set operations of rows into a container: the rows themselves rather
+    than their counts, e.g. a query intersected with every row of a
+    container. Row m of out receives the op of a pair of rows, written in
+    place by the set-operation kernels with the rows spread over
+    opts.num_cpu_threads threads (all available if 0); the other fields of
+    opts are ignored. The popcount, summary and change-log caches of out are
+    kept current.
+
+    * BitDB_inter_store, BitDB_union_store, BitDB_diff_store,
+      BitDB_minus_store : out row m = op(bit row pairs[2m], bits row
+                          pairs[2m + 1]) for the n pairs of a pairs array,
+                          as taken by BitDB_pairs_count. With pairs NULL, n
+                          is ignored and every row i of bit is paired with
+                          every row j of bits, into row
+                          BitDB_counts_offset(bits, i, j) of out.
+
+    It is a checked runtime error to pass NULL containers, a read-only out,
+    an out that is bit or bits, containers of different lengths, rows
+    outside their containers, or an out with fewer rows than pairs.
+*/
+extern void BitDB_inter_store(T_DB bit, T_DB bits, const int pairs[],
+                              size_t n, T_DB out, SETOP_COUNT_OPTS opts);
+extern void BitDB_union_store(T_DB bit, T_DB bits, const int pairs[],
+                              size_t n, T_DB out, SETOP_COUNT_OPTS opts);
+extern void BitDB_diff_store(T_DB bit, T_DB bits, const int pairs[], size_t n,
+                             T_DB out, SETOP_COUNT_OPTS opts);
+extern void BitDB_minus_store(T_DB bit, T_DB bits, const int pairs[],
+                              size_t n, T_DB out, SETOP_COUNT_OPTS opts);
+
+/*
+    Masks applied to the rows of a container in place: row = op(row, mask),
+    e.g. BIT_COUNT_INTER keeps the features of a mask and BIT_COUNT_MINUS
+    drops them. The rows are spread over opts.num_cpu_threads threads (all
+    available if 0); the other fields of opts are ignored. Each row is
+    recounted for the popcount cache and resummarized right after it is
+    written, and the rows are marked for the next sync of an attached
+    device copy.
+
+    * BitDB_apply       : Applies the mask to every row.
+    * BitDB_apply_range : Applies it to rows first .. first + n - 1.
+
+    It is a checked runtime error to pass a NULL container or mask, a
+    read-only container, a mask of another length, rows outside the
+    container, or an op that is not a single Bit_count_ops value.
+*/
+extern void BitDB_apply(T_DB set, Bit_count_ops op, T mask,
+                        SETOP_COUNT_OPTS opts);
+extern void BitDB_apply_range(T_DB set, int first, int n, Bit_count_ops op,
+                              T mask, SETOP_COUNT_OPTS opts);
+
+/*
+    Column counts: out[j] = the number of rows of set that have bit j, for
+    every j below BitDB_length(set) (feature frequencies). The rows are
+    added into bit-sliced counters a block of words at a time, at about two
+    word operations per word of a row, and the counters of every 64
+    columns become counts through one 64 x 64 bit transpose per 65535 rows.
+    Blocks of columns, and groups of rows when the blocks are fewer than
+    the threads, are spread over opts.num_cpu_threads threads (all
+    available if 0).
+
+    It is a checked runtime error to pass a NULL set or out. out must hold
+    BitDB_length(set) counts.
+*/
+extern void BitDB_column_counts(T_DB set, uint32_t *out,
+                                SETOP_COUNT_OPTS opts);
+
+/*
+    Fused count expressions: the population count of an arbitrary expression
+    over several bitsets, evaluated in one streaming pass without forming any
+    intermediate bitset. The expression is a postfix program of nops
+    op-codes; each BIT_EXPR_PUSH consumes the next of the noperands operands
+    in order. For example |A & B & ~C| with operands {A, B, C} is
+
+        {BIT_EXPR_PUSH, BIT_EXPR_PUSH, BIT_EXPR_AND, BIT_EXPR_PUSH,
+         BIT_EXPR_AND_NOT}
+
+    and |(A | B) & D| with operands {A, B, D} is
+
+        {BIT_EXPR_PUSH, BIT_EXPR_PUSH, BIT_EXPR_OR, BIT_EXPR_PUSH,
+         BIT_EXPR_AND}
+
+    It is a checked runtime error for any operand to be NULL or of a
+    different length than the others, for the program to use BIT_EXPR_PUSH_ROW,
+    to not consume exactly noperands operands, to pop from an empty stack,
+    to grow the stack beyond BIT_EXPR_MAX_DEPTH or to leave anything other
+    than a single value on it.
+*/
+extern int Bit_expr_count(const Bit_expr_op program[], int nops,
+                          T operands[], int noperands);
+
 /*
     BitDB operations on packed containers of bitsets
 
@@ -294,6 +1389,81 @@ extern int Bit_union_count(T s, T t); // union of two bitsets
    the following error checking
     * BitDB_new          : Checked runtime error if length or size is less
                           than 0 or greater than INT_MAX.L.
+    * BitDB_new_padded   : As BitDB_new, but rows start row_align bytes
+                          apart (rounded up to whole qwords), so that every
+                          row, not just the first, takes aligned vector
+                          loads. The padding is kept zero, which lets the
+                          SETOP count kernels run their vector loops over
+                          it instead of scalar fringes: pass a multiple of
+                          the vector width, e.g. 64 or 128. A row_align of
+                          0 (or anything up to 8) gives packed rows, like
+                          BitDB_new. Checked runtime error if row_align is
+                          negative, not a power of two, or above 4096.
+                          Buffers passed to or filled by the container
+                          (BitDB_replace_at, BitDB_extract_from,
+                          BitDB_append_many) stay packed.
+    * BitDB_new_numa     : As BitDB_new_padded, with the pages of the rows
+                          placed by policy. BIT_NUMA_FIRST_TOUCH zeroes the
+                          rows with the threads of opts, in the same static
+                          partition of tuning tiles that the SETOP count
+                          kernels then use when the container is their
+                          first operand, so that with bound threads
+                          (OMP_PROC_BIND) each socket streams rows from its
+                          own node. BIT_NUMA_INTERLEAVE spreads the pages
+                          over all online nodes: use it for the second
+                          operand, which every thread reads in full.
+                          BIT_NUMA_LOCAL is BitDB_new_padded. Rows added by
+                          growth are placed by the appending thread (first
+                          touch) or keep the interleaving. Placement is a
+                          hint: off Linux, or on one node, the container is
+                          an ordinary one.
+    * BitDB_new_pinned   : As BitDB_new_padded, with the rows in page-locked
+                          (pinned) host memory, which GPU transfers read at
+                          full DMA bandwidth, without a staging copy, and
+                          which the nowait transfers of
+                          BitDB_count_store_gpu_async overlap with the
+                          kernels. The rows come from an OpenMP allocator
+                          with the pinned trait when the runtime has one,
+                          else (on Linux) from a mapping locked with mlock.
+                          Pinning is a hint: past the locked memory limit
+                          (RLIMIT_MEMLOCK) the rows are ordinary memory, as
+                          BitDB_is_pinned tells. Growth keeps them pinned.
+    * BitDB_is_pinned    : True if the rows of set are page-locked.
+    * Bit_pinned_alloc   : Returns nbytes of zeroed, page-locked (when
+                          possible, as above) memory aligned like container
+                          rows, e.g. for the counts of the GPU set
+                          operations. Checked runtime error if nbytes is 0
+                          or the memory cannot be allocated.
+    * Bit_pinned_free    : Releases a buffer of Bit_pinned_alloc (NULL is
+                          ignored). Pinned containers free their rows in
+                          BitDB_free.
+    * BitDB_new_huge     : As BitDB_new_padded, with the rows on huge
+                          pages, so that scans of containers of many GB
+                          take one TLB entry per 2 MiB (or 1 GiB) instead
+                          of per 4 KiB. BIT_PAGES_HUGE maps the rows 2 MiB
+                          aligned and advises the kernel to back them with
+                          transparent huge pages (MADV_HUGEPAGE), which
+                          works when THP is enabled as always or madvise.
+                          BIT_PAGES_HUGETLB and BIT_PAGES_HUGETLB_1G take
+                          reserved pages of the huge page pool
+                          (vm.nr_hugepages, or hugepagesz=1G at boot), and
+                          fall back to BIT_PAGES_HUGE when the pool is
+                          short. BIT_PAGES_DEFAULT is BitDB_new_padded.
+                          Off Linux the rows are ordinary memory. Growth
+                          keeps the pages.
+    * BitDB_pages        : The pages the rows of set got: BIT_PAGES_DEFAULT
+                          for containers not made by BitDB_new_huge, or
+                          whose huge pages could not be had. For the
+                          transparent kind this is what was asked for; the
+                          kernel may still use base pages.
+    * Bit_huge_alloc     : Returns nbytes of zeroed memory on pages as
+                          above, aligned like container rows, e.g. for the
+                          counts of the _store functions. Checked runtime
+                          error if nbytes is 0 or the memory cannot be
+                          allocated.
+    * Bit_huge_pages     : The pages a buffer of Bit_huge_alloc got.
+    * Bit_huge_free      : Releases a buffer of Bit_huge_alloc (NULL is
+                          ignored).
     * BitDB_free         : It is a checked runtime error to try to free a Bit_DB
                           that was not allocated by the library.
     * BitDB_load         : Checked runtime error if length or size is less
@@ -306,13 +1476,345 @@ extern int Bit_union_count(T s, T t); // union of two bitsets
                           to pass an index that is less than 0 or greater than
                           the number of bitsets in the container.
     * BitDB_count        : See footnote
+    * BitDB_count_store  : See footnote; it is also a checked runtime error
+                          to pass a NULL counts buffer, which must hold
+                          BitDB_nelem(set) integers. Rows are counted in
+                          parallel with opts.num_cpu_threads threads (all
+                          available if <= 0); BitDB_count uses all of them.
+    * BitDB_cache_counts : See footnote. With enable true, computes the row
+                          counts once (with the threads of opts) and keeps
+                          them current through BitDB_put_at, BitDB_replace_at,
+                          BitDB_clear_at and BitDB_clear, so that the count
+                          functions become lookups; with enable false, drops
+                          the cache. Changes made to the rows behind the
+                          library's back (e.g. in a BitDB_load buffer) are
+                          not seen by the cache.
+    * BitDB_cache_summary: Same for a summary of the non-empty 512-bit blocks
+                          of every row (see Bit_cache_summary), kept current
+                          by the same functions and by the growth and
+                          reordering ones. BitDB_query_count_store uses the
+                          summaries when the query keeps one too: every row
+                          visits only the blocks its count can come from,
+                          or is streamed whole when they are more than half.
+    * BitDB_cache_postings: With enable true, builds (with the threads of
+                          opts) an inverted index of the columns: for every
+                          bit position, the rows that hold it. Queries of
+                          BitDB_query_count_store whose bits have few rows
+                          between them, e.g. queries of a handful of bits,
+                          then add up the postings of those bits instead of
+                          scanning every row. The choice is made per query,
+                          by the number of postings its bits select against
+                          the size of the rows. Ops other than
+                          BIT_COUNT_INTER also need BitDB_cache_counts.
+                          Writes through the BitDB API mark the index stale
+                          and the next query rebuilds it; with enable false,
+                          drops it. The index takes 4 bytes per set bit and
+                          8 per column.
+    * BitDB_hash_rows    : See footnote; it is also a checked runtime error
+                          to pass a NULL out buffer, which must hold
+                          BitDB_nelem(set) hashes. Stores the Bit_hash64 of
+                          every row for seed, hashing rows in parallel with
+                          opts.num_cpu_threads threads (all available if
+                          <= 0).
+    * BitDB_cache_hashes : See footnote. With enable true, BitDB_hash_rows
+                          keeps the hashes it computes, and a later call with
+                          the same seed copies them out until a write through
+                          the BitDB API changes the rows; with enable false,
+                          drops them. Like the other caches it does not see
+                          writes made behind the library's back.
 
     It is a checked runtime error to pass a NULL set to any of these routines.
 */
 extern T_DB BitDB_new(int length, int num_of_bitsets);
+extern T_DB BitDB_new_padded(int length, int num_of_bitsets, int row_align);
+extern T_DB BitDB_new_numa(int length, int num_of_bitsets, int row_align,
+                           Bit_numa_policy policy, SETOP_COUNT_OPTS opts);
+extern T_DB BitDB_new_pinned(int length, int num_of_bitsets, int row_align);
+extern bool BitDB_is_pinned(T_DB set);
+extern void *Bit_pinned_alloc(size_t nbytes);
+extern void Bit_pinned_free(void *ptr);
+extern T_DB BitDB_new_huge(int length, int num_of_bitsets, int row_align,
+                           Bit_page_policy pages);
+extern Bit_page_policy BitDB_pages(T_DB set);
+extern void *Bit_huge_alloc(size_t nbytes, Bit_page_policy pages);
+extern Bit_page_policy Bit_huge_pages(const void *ptr);
+extern void Bit_huge_free(void *ptr);
 extern T_DB BitDB_load(int length, int num_of_bitsets, void *buffer);
 extern void *BitDB_free(T_DB *set);
 
+/*
+    Persistent containers. A Bit_DB file is a one page header (length,
+    number of rows, row stride and alignment, checksums) followed by the
+    rows exactly as they are laid out in memory, in host byte order.
+    BitDB_open_mmap maps such a file instead of reading it, so opening is
+    O(1) whatever its size and the kernels run on the page cache directly.
+
+    * BitDB_save          : Writes set to path, replacing any existing
+                            file. Returns 0 on success and -1 if the file
+                            could not be written (errno tells why).
+    * BitDB_open_mmap     : Maps the file at path. flags is a bitwise or of
+                            the BIT_DB_MMAP_* values below. The rows are
+                            shared with the file and read-only unless
+                            BIT_DB_MMAP_PRIVATE maps them copy-on-write;
+                            writing a read-only container is a checked
+                            runtime error, writes to a private one are
+                            never written back. A mapped container cannot
+                            grow. Returns NULL if the file cannot be opened,
+                            is not a Bit_DB file of this host's byte order,
+                            is truncated, or fails BIT_DB_MMAP_VERIFY; and
+                            always on systems without mmap. BitDB_free
+                            unmaps it and returns NULL.
+                            BIT_DB_MMAP_HUGE asks the kernel for huge
+                            pages for the mapping, which it honours for
+                            private copies and on file systems with
+                            huge page support in the page cache.
+
+    It is a checked runtime error to pass a NULL set or path.
+*/
+enum {
+  BIT_DB_MMAP_READONLY = 0,   // shared, read-only rows (the default)
+  BIT_DB_MMAP_PRIVATE = 1,    // copy-on-write rows
+  BIT_DB_MMAP_SEQUENTIAL = 2, // advise sequential access and read-ahead
+  BIT_DB_MMAP_VERIFY = 4,     // checksum every row before returning
+  BIT_DB_MMAP_HUGE = 8        // advise huge pages (MADV_HUGEPAGE)
+};
+extern int BitDB_save(T_DB set, const char *path);
+extern T_DB BitDB_open_mmap(const char *path, int flags);
+
+/*
+    Shared memory containers, for processes that serve the same rows: one
+    physical copy, in the page cache of a POSIX shared memory object, is
+    mapped by all of them. The object has the layout of a Bit_DB file, and
+    its header also records the generation of the rows. Generations work
+    as a sequence lock: odd while the creator writes the rows, even once
+    they are published. A worker that reads the same even generation before
+    and after a batch of counts has counted one consistent set of rows.
+
+    * BitDB_create_shared   : Creates the shared memory object name (as for
+                              shm_open: "/name", readable by processes of
+                              the same user) with num_of_bitsets zeroed
+                              rows of length bits, and returns a writable
+                              container mapped on it, in generation 1. It
+                              cannot grow. BIT_DB_SHARED_HUGE advises huge
+                              pages (MADV_HUGEPAGE), which the kernel
+                              honours when shmem_enabled under
+                              /sys/kernel/mm/transparent_hugepage allows.
+                              Returns NULL if name exists or the object
+                              cannot be made; and on systems without POSIX
+                              shared memory.
+    * BitDB_attach_shared   : Maps the object name read-only. Returns NULL
+                              if it does not exist, is not a Bit_DB of this
+                              host, or has never been published.
+    * BitDB_shared_generation : The generation of the rows of set, 0 for
+                              containers that are not shared.
+    * BitDB_shared_begin_write : Makes the generation odd before the
+                              creator rewrites rows that are published.
+    * BitDB_shared_publish  : Refreshes the header checksums, makes the
+                              generation even and returns it. It is a
+                              checked runtime error to publish rows that
+                              are not being written, or to begin writing or
+                              publish through an attached container.
+    * BitDB_unlink_shared   : Removes the name; the memory goes when the
+                              last container mapped on it is freed.
+                              Returns 0, or -1 (errno tells why).
+                              BitDB_free never unlinks.
+
+    It is a checked runtime error to pass a NULL set or name.
+*/
+enum {
+  BIT_DB_SHARED_HUGE = 1 // advise huge pages (MADV_HUGEPAGE)
+};
+extern T_DB BitDB_create_shared(const char *name, int length,
+                                int num_of_bitsets, int flags);
+extern T_DB BitDB_attach_shared(const char *name);
+extern uint64_t BitDB_shared_generation(T_DB set);
+extern void BitDB_shared_begin_write(T_DB set);
+extern uint64_t BitDB_shared_publish(T_DB set);
+extern int BitDB_unlink_shared(const char *name);
+
+/*
+    Streaming writes of Bit_DB files, for containers built one row at a
+    time that need not be held in memory. A writer stages the rows in a
+    page aligned buffer of BIT_DB_WRITER_BUFFER bytes (8 MiB unless set at
+    build time) and writes it out whole, so a file takes one system call
+    per buffer rather than one per row. The header, with the row count and
+    checksum, is written at close, and the file then opens with
+    BitDB_open_mmap like one of BitDB_save.
+
+    * BitDB_writer_open    : Creates (or truncates) the file at path for
+                             rows of length bits. With BIT_DB_WRITER_DIRECT
+                             in flags the writes bypass the page cache
+                             (O_DIRECT), on systems and file systems that
+                             support it, and are buffered otherwise.
+                             Returns NULL if the file cannot be created, and
+                             always on systems without POSIX files.
+    * BitDB_writer_put     : Appends the rows of a bitset of that length.
+    * BitDB_writer_put_many: Appends n rows packed Bit_buffer_size(length)
+                             bytes apart in buffer, as Bit_extract writes
+                             them (or BitDB_append_many reads them).
+    * BitDB_writer_close   : Writes the rest of the rows and the header,
+                             closes the file and frees the writer.
+
+    The puts return 0, or -1 once a write fails (errno tells why) or the
+    file would reach INT_MAX rows; later puts then fail too, and close
+    returns -1 as well, as it does if its own writes fail. A file closed
+    with no rows has a header only, which BitDB_open_mmap refuses. It is a
+    checked runtime error to pass a NULL path, writer, bitset or buffer
+    (with n > 0), a length out of range, a bitset of another length, or a
+    negative n. A writer is not thread safe.
+*/
+enum {
+  BIT_DB_WRITER_DIRECT = 1 // write around the page cache (O_DIRECT)
+};
+extern Bit_writer_T BitDB_writer_open(const char *path, int length, int flags);
+extern int BitDB_writer_put(Bit_writer_T writer, T set);
+extern int BitDB_writer_put_many(Bit_writer_T writer, int n,
+                                 const void *buffer);
+extern int BitDB_writer_close(Bit_writer_T *writer);
+
+/*
+    Compressed Bit_DB files, for when reading the file costs more than
+    counting it, e.g. over a network file system. The rows are cut into
+    blocks of block_rows rows, and each block is compressed on its own and
+    found through an index at the end of the file. Blocks are compressed by
+    leaving out the bytes of the rows that are zero: a control byte per
+    qword tells which bytes follow. Sparse fingerprints shrink by 2 to 3
+    times. Blocks that would not shrink are stored as they are. Reads
+    decompress the blocks they span in parallel, each thread reading its
+    blocks with its own staging buffer.
+
+    * BitDB_save_compressed : Writes set to path, compressing blocks on
+                              opts.num_cpu_threads threads. Returns 0, or -1
+                              if the file cannot be written.
+    * BitDB_zreader_open    : Opens a file of BitDB_save_compressed for
+                              reading, with opts.num_cpu_threads threads
+                              decompressing. Returns NULL if the file cannot
+                              be read or its header or index is malformed,
+                              and always on systems without POSIX files.
+    * BitDB_zreader_length  : Bits per row of the file.
+    * BitDB_zreader_nelem   : Rows in the file.
+    * BitDB_zreader_read    : Copies the next max_rows rows of the file (or
+                              those left) into rows, packed row_bytes =
+                              Bit_buffer_size(length) bytes apart, and
+                              returns how many it copied. It is a next_block
+                              of the streaming counts, e.g.
+                              BitDB_inter_count_stream_cpu(bit,
+                              BitDB_zreader_read, reader, ...), which then
+                              decompresses the next block while it counts
+                              the current one. A read that fails (an I/O
+                              error, or a block whose checksum does not
+                              match) copies nothing and returns 0, as do the
+                              reads after it.
+    * BitDB_zreader_close   : Closes the file and frees the reader. Returns
+                              -1 if a read failed, 0 otherwise.
+    * BitDB_load_compressed : A new container holding all the rows of the
+                              file, or NULL if it cannot be read.
+
+    It is a checked runtime error to pass a NULL set, path, reader or rows,
+    a block_rows less than 1 or of more than 2^31 bytes, a negative
+    max_rows, or a row_bytes other than the file's.
+*/
+extern int BitDB_save_compressed(T_DB set, const char *path, int block_rows,
+                                 SETOP_COUNT_OPTS opts);
+extern Bit_zreader_T BitDB_zreader_open(const char *path,
+                                        SETOP_COUNT_OPTS opts);
+extern int BitDB_zreader_length(Bit_zreader_T reader);
+extern int BitDB_zreader_nelem(Bit_zreader_T reader);
+extern int BitDB_zreader_read(void *reader, void *rows, int max_rows,
+                              int row_bytes);
+extern int BitDB_zreader_close(Bit_zreader_T *reader);
+extern T_DB BitDB_load_compressed(const char *path, SETOP_COUNT_OPTS opts);
+
+/*
+    Reading saved Bit_DB files ahead, for streaming counts against files
+    too large for memory. A reader keeps BIT_DB_READER_DEPTH reads of
+    BIT_DB_READER_CHUNK bytes (8 of 1 MiB unless set at build time) of the
+    file in flight. The kernel fills them while the caller counts, and the
+    caller waits only for a chunk it has reached before it is in. On Linux
+    the reads go through io_uring, into buffers registered with the kernel,
+    without blocking calls or page faults. Elsewhere, or where the kernel
+    refuses io_uring, a chunk is read with pread when it is reached, and
+    the kernel is told in advance which chunks will be needed.
+
+    * BitDB_reader_open  : Opens a file of BitDB_save (or BitDB_writer_open)
+                           for reading. flags is a bitwise or of
+                           BIT_DB_READER_DIRECT, to read around the page
+                           cache (O_DIRECT) where the file system allows it,
+                           and BIT_DB_READER_PREAD, to read with pread even
+                           where io_uring is available. Returns NULL if the
+                           file cannot be read or is not a saved container,
+                           and always on systems without POSIX files.
+    * BitDB_reader_length: Bits per row of the file.
+    * BitDB_reader_nelem : Rows in the file.
+    * BitDB_reader_read  : Copies the next max_rows rows of the file (or
+                           those left) into rows, packed row_bytes =
+                           Bit_buffer_size(length) bytes apart, and returns
+                           how many it copied. It is a next_block of the
+                           streaming counts, e.g.
+                           BitDB_inter_count_stream_cpu(bit,
+                           BitDB_reader_read, reader, ...). A read that
+                           fails copies nothing and returns 0, as do the
+                           reads after it.
+    * BitDB_reader_close : Waits for the reads in flight, closes the file
+                           and frees the reader. Returns -1 if a read
+                           failed, 0 otherwise.
+
+    It is a checked runtime error to pass a NULL path, reader or rows, a
+    negative max_rows, or a row_bytes other than the file's. A reader is
+    not thread safe.
+*/
+enum {
+  BIT_DB_READER_DIRECT = 1, // read around the page cache (O_DIRECT)
+  BIT_DB_READER_PREAD = 2   // read with pread, not io_uring
+};
+extern Bit_reader_T BitDB_reader_open(const char *path, int flags);
+extern int BitDB_reader_length(Bit_reader_T reader);
+extern int BitDB_reader_nelem(Bit_reader_T reader);
+extern int BitDB_reader_read(void *reader, void *rows, int max_rows,
+                             int row_bytes);
+extern int BitDB_reader_close(Bit_reader_T *reader);
+
+/*
+    Fingerprint text files. BitDB_load_text reads the file at path into a
+    new container, one row per record. The file is mapped, split at line
+    starts into a few chunks per thread (opts.num_cpu_threads, all available
+    if 0), and every chunk decodes its records straight into their rows.
+    Records are the lines that are not blank and do not start with '#', so
+    the header lines of an FPS file are skipped. In BIT_TEXT_HEX files a
+    record starts with the hex digits of the row bytes, byte 0 first and
+    each byte high nibble first (the FPS encoding: bit i is bit i % 8 of
+    byte i / 8); anything after the first blank, such as an FPS id, is
+    ignored. The digits are checked and decoded with vector loops. In
+    BIT_TEXT_INDICES files a record lists the indices of the set bits,
+    separated by commas, semicolons, spaces or tabs.
+
+    length is the length of the rows, or 0 to take it from the file: 4 bits
+    per hex digit of the first record, or one more than the largest index.
+    Returns NULL if the file cannot be read or holds no records, if a hex
+    record has more or fewer digits than the length takes or a non-hex
+    digit, or if an index record has other characters or an index at or
+    past the length. It is a checked runtime error to pass a NULL path, a
+    format not listed above, or a negative length.
+*/
+extern T_DB BitDB_load_text(const char *path, Bit_text_format format,
+                            int length, SETOP_COUNT_OPTS opts);
+
+/*
+    Index lists in memory. BitDB_build_from_csr builds a container of nrows
+    rows of length bits from compressed sparse row (CSR) lists: the set bits
+    of row r are col_idx[row_ptr[r]] .. col_idx[row_ptr[r + 1] - 1]. No
+    Bit_T is made per row. Each thread (opts.num_cpu_threads, all available
+    if 0) fills the rows of its own range, the ranges holding about as many
+    indices each. Indices in the same 64-bit word of a row are set with one
+    store when they are next to each other in the list, as in sorted lists;
+    the lists need not be sorted. Returns NULL if an index is negative or at
+    or past length. It is a checked runtime error to pass a non-positive
+    length or nrows, a NULL row_ptr, a NULL col_idx with indices, or a
+    row_ptr that decreases.
+*/
+extern T_DB BitDB_build_from_csr(int length, int nrows, const size_t row_ptr[],
+                                 const int col_idx[], SETOP_COUNT_OPTS opts);
+
 /*
     Functions that return the properties of a Bit_DB container.
 
@@ -321,6 +1823,15 @@ extern int BitDB_length(T_DB set);
 extern int BitDB_nelem(T_DB set);
 extern int BitDB_count_at(T_DB set, int index);
 extern int *BitDB_count(T_DB set);
+extern void BitDB_count_store(T_DB set, int *counts, SETOP_COUNT_OPTS opts);
+extern void BitDB_cache_counts(T_DB set, bool enable, SETOP_COUNT_OPTS opts);
+extern void BitDB_cache_summary(T_DB set, bool enable,
+                                SETOP_COUNT_OPTS opts);
+extern void BitDB_cache_postings(T_DB set, bool enable,
+                                 SETOP_COUNT_OPTS opts);
+extern void BitDB_hash_rows(T_DB set, uint64_t seed, uint64_t *out,
+                            SETOP_COUNT_OPTS opts);
+extern void BitDB_cache_hashes(T_DB set, bool enable);
 /*
     Functions that manipulate and obtain the contents of a packed
     container of bitsets (Bit_DB). One can use either Bits or externally
@@ -337,12 +1848,199 @@ extern int *BitDB_count(T_DB set);
     any of these routines.
 */
 extern T BitDB_get_from(T_DB set, int index);
+/*
+    * BitDB_view_at       : Makes *out a handle onto row index of the
+                            container, like Bit_load over the row: no bytes
+                            are copied. If *out is NULL a handle is
+                            allocated (release it with Bit_free); otherwise
+                            *out must be a handle from an earlier
+                            BitDB_view_at or Bit_load and is re-pointed with
+                            no allocation, so a loop over rows reuses one
+                            handle. Writes through the view change the row,
+                            but bypass the BitDB_cache_counts cache, and the
+                            view dangles once the row storage is freed or
+                            grown. It is a checked runtime error to pass a
+                            NULL out, or a *out that owns its storage.
+*/
+extern void BitDB_view_at(T_DB set, int index, T *out);
 extern void BitDB_put_at(T_DB set, int index, T bitset);
+/*
+    * BitDB_put_many      : Copies rows[0 .. n - 1] into rows first_index
+                            to first_index + n - 1, as n BitDB_put_at calls
+                            would, with the checks made once up front. The
+                            copies spread over the OpenMP threads once they
+                            reach 1 MiB (BIT_PUT_PARALLEL_BYTES at build
+                            time), and go past the caches with streaming
+                            stores once they exceed Bit_store_threshold_get.
+    * BitDB_from_bitsets  : A new container of the n bitsets of rows, in
+                            order, filled by BitDB_put_many.
+
+    It is a checked runtime error to pass a NULL set, a read-only set, a
+    NULL rows array or row, rows of a length other than the container's, a
+    negative n (or, for BitDB_from_bitsets, an n less than 1), or a range
+    of rows outside the container.
+*/
+extern void BitDB_put_many(T_DB set, int first_index, T rows[], int n);
+extern T_DB BitDB_from_bitsets(T rows[], int n);
+/*
+    * BitDB_gather        : Rows rows[0 .. n - 1] of set, in that order, as
+                            the rows of a packed container: out, reused
+                            (resized to n rows, growing its storage if
+                            needed), or a new container if out is NULL.
+                            Returns it. The copies run in parallel and
+                            prefetch the scattered rows ahead of the copy.
+                            Row j takes the ID of rows[j] in set (see
+                            BitDB_row_ids), so the search modes over the
+                            gathered rows report the rows of set.
+    * BitDB_scatter       : Writes rows 0 .. n - 1 of from back into rows
+                            rows[0 .. n - 1] of set, the inverse of a
+                            gather.
+
+    opts.num_cpu_threads sets the number of threads. It is a checked runtime
+    error to pass a NULL set or from, a NULL rows array with n above 0, a
+    negative n, rows outside set, a row listed twice to BitDB_scatter, an n
+    above the rows of from, containers of different lengths, the same
+    container as both operands, or a read-only, tracked (BitDB_track_changes)
+    or device-attached out, or a read-only set to BitDB_scatter.
+*/
+extern T_DB BitDB_gather(T_DB set, const int rows[], int n, T_DB out,
+                         SETOP_COUNT_OPTS opts);
+extern void BitDB_scatter(T_DB set, const int rows[], int n, T_DB from,
+                          SETOP_COUNT_OPTS opts);
 extern void BitDB_extract_from(T_DB set, int index, void *buffer);
 extern void BitDB_replace_at(T_DB set, int index, void *buffer);
 extern void BitDB_clear(T_DB set);
 extern void BitDB_clear_at(T_DB set, int index);
 
+/*
+    Functions that grow a packed container of bitsets (Bit_DB). Capacity
+    grows geometrically, so a sequence of appends costs amortized O(1)
+    row copies each; large containers on Linux are grown in place with
+    mremap. Growth may move the rows, so pointers into the storage and
+    device copies made by the gpu functions are invalidated by it. The
+    per-row count cache (BitDB_cache_counts) is kept current.
+
+    * BitDB_append        : Appends bitset after the last row and returns
+                            its index.
+    * BitDB_append_many   : Appends n rows taken from buffer, which holds n
+                            packed bitsets of Bit_buffer_size(BitDB_length(set))
+                            bytes each; a NULL buffer appends cleared rows.
+                            Returns the index of the first new row.
+    * BitDB_insert_at     : Inserts bitset at index, which may be in
+                            [0, BitDB_nelem(set)], shifting later rows up.
+    * BitDB_reserve       : Ensures the capacity is at least capacity rows;
+                            it never shrinks the container.
+
+    It is a checked runtime error to pass a NULL set, a NULL bitset, a
+    bitset whose length differs from the container's, a negative count,
+    or to grow a container created with BitDB_load.
+*/
+extern int BitDB_append(T_DB set, T bitset);
+extern int BitDB_append_many(T_DB set, int n, void *buffer);
+extern void BitDB_insert_at(T_DB set, int index, T bitset);
+extern void BitDB_reserve(T_DB set, int capacity);
+extern int BitDB_capacity(T_DB set);
+
+/*
+    Row change log, for replicas that should receive the rows that changed
+    rather than the whole container. While a container is tracked, every
+    row written by BitDB_put_at, BitDB_replace_at, BitDB_clear_at,
+    BitDB_clear or the append functions keeps the XOR of its contents at
+    the last export and now, and a delta carries only those rows. Deltas
+    are XORs, so a replica applies them in place; the rows it changes are
+    the only ones an attached device copy then uploads (see
+    BitDB_device_attach).
+
+    * BitDB_track_changes : Starts (enable) or stops logging the rows
+                            written; starting forgets any earlier log, and
+                            the rows as they are become the base.
+    * BitDB_changed_rows  : Rows written since the base (0 if untracked).
+    * BitDB_export_delta  : Sets *delta to a new buffer (release with free)
+                            holding the changes since the base, returns its
+                            size in bytes, and makes the rows as they are
+                            the new base. Rows written back to what they
+                            were are left out. Returns 0 with *delta NULL
+                            when rows were moved since the base
+                            (BitDB_insert_at, BitDB_sort_by_count): the
+                            replicas need the whole container once more.
+    * BitDB_apply_delta   : Applies a delta to a replica that holds the
+                            base it was exported from, appending the rows
+                            it adds. Returns 0, or -1, leaving set as it
+                            was, if the delta is corrupt or was exported
+                            from another base (another length or number of
+                            rows). A tracked replica logs the rows in turn.
+
+    Writes through views of the rows (BitDB_view_at) or through the
+    storage of BitDB_load bypass the log. It is a checked runtime error to
+    pass a NULL set, delta or *delta pointer, to export from a container
+    that is not tracked, or to apply to a read-only one.
+*/
+extern void BitDB_track_changes(T_DB set, bool enable);
+extern int BitDB_changed_rows(T_DB set);
+extern size_t BitDB_export_delta(T_DB set, void **delta);
+extern int BitDB_apply_delta(T_DB set, const void *delta, size_t bytes);
+
+/*
+    Concurrent readers and writers. By default a query that runs while
+    another thread writes rows of the same container may count a row half
+    written. A concurrent container guards every 64 rows with a sequence
+    lock (seqlock): the row writers (BitDB_put_at, BitDB_replace_at,
+    BitDB_clear_at, BitDB_clear, the append and insert functions,
+    BitDB_apply_delta and BitDB_sort_by_count) make its sequence odd while
+    they write and even again after, and writers of the same 64 rows take
+    turns. Readers never wait for writers: the CPU SETOP counts of two
+    containers (the _store, typed, tile, file and search functions) note
+    the sequences of the rows of every tile they count and count the tile
+    again if a writer was inside, and BitDB_get_from and BitDB_extract_from
+    copy the row again. Writers of different rows never wait for each other.
+
+    * BitDB_concurrent    : Turns the sequence locks on (enable) or off.
+                            Call it while no other thread uses the set.
+    * BitDB_is_concurrent : Whether they are on.
+    * BitDB_read_begin    : A token for the rows [first, first + n), for
+                            readers of the rows themselves (e.g. through
+                            BitDB_view_at or the GPU functions).
+    * BitDB_read_retry    : Whether the rows may have been written since
+                            the token was taken; read them again if so.
+                            Always false if the set is not concurrent.
+
+    Growing the storage moves every row: appends beyond BitDB_capacity and
+    BitDB_reserve may not run alongside readers, so reserve the rows ahead.
+    The GPU counts and counts of rows against single bitsets do not check
+    the sequences. It is a checked runtime error to pass a NULL set or rows
+    outside it.
+*/
+extern void BitDB_concurrent(T_DB set, bool enable);
+extern bool BitDB_is_concurrent(T_DB set);
+extern uint64_t BitDB_read_begin(T_DB set, int first, int n);
+extern bool BitDB_read_retry(T_DB set, int first, int n, uint64_t token);
+
+/*
+    Snapshots. A long query that must not see a bulk rewrite in progress can
+    run on a snapshot: a read-only container with the rows of set as they
+    were when it was taken, which later writes to set leave alone. On Linux
+    the first snapshot moves the rows of set into a memory file
+    (memfd_create); snapshots map that file read-only, and set maps it
+    privately, so that its writes copy only the 4 KiB pages they touch.
+    Snapshots taken before set is written again share the same pages. Once
+    all the snapshots of a generation are freed, the next one writes the
+    rows changed since back into the file, which frees their private pages.
+    Where memory files are not available, and while older snapshots are
+    open and set has changed, a snapshot is a copy of the rows.
+
+    * BitDB_snapshot : A snapshot of set, freed with BitDB_free in any order
+                       with set. It keeps no popcount, summary or other
+                       caches of set.
+
+    The first snapshot moves the rows of a container that lives on the heap,
+    and every snapshot remaps them in place: BitDB_snapshot may run
+    alongside readers of set only once set has a snapshot, and never
+    alongside writers. It is a checked runtime error to pass a NULL set, or
+    a set whose rows the library does not own, or that lives on pinned or
+    huge pages.
+*/
+extern T_DB BitDB_snapshot(T_DB set);
+
 /*
     Functions that perform SETOP counts between two packed containers
     of bitsets (Bit_DB). Note the following error checking:
@@ -352,31 +2050,41 @@ extern void BitDB_clear_at(T_DB set, int index);
     of the containers to be NULL.
     2. For the load functions, it is a checked runtime error to pass
     a NULL buffer.
+
+    A count over one segment of the rows (a sub-fingerprint: bits 0-1023
+    ECFP, 1024-1190 MACCS) sets opts.bit_lo and opts.bit_hi: only the bits
+    in [bit_lo, bit_hi) are counted. The words of the segment are copied
+    into rows of their own, with the bits outside it masked off at either
+    end, so the kernels read the segment and nothing more. The CPU int count stores honor the segment
+    (BitDB_SETOP_count_cpu, BitDB_SETOP_count_store_cpu, and
+    BitDB_count_store_typed_cpu with BIT_COUNTS_I32); other functions
+    count the whole rows. It is a checked runtime error to pass a segment
+    that is empty or does not lie within the rows.
 */
 
 #define BitDB_inter_count(bit, bits, opts, TARGET)                             \
   BitDB_inter_count_##TARGET((bit), (bits), (opts))
 
 #define BitDB_inter_count_store(bit, bits, opts, results, TARGET)              \
-  BitDB_inter_count_store_##TARGET((bit), (bits), (opts), (results))
+  BitDB_inter_count_store_##TARGET((bit), (bits), (results), (opts))
 
 #define BitDB_union_count(bit, bits, opts, TARGET)                             \
   BitDB_union_count_##TARGET((bit), (bits), (opts))
 
 #define BitDB_union_count_store(bit, bits, opts, results, TARGET)              \
-  BitDB_union_count_store_##TARGET((bit), (bits), (opts), (results))
+  BitDB_union_count_store_##TARGET((bit), (bits), (results), (opts))
 
 #define BitDB_diff_count(bit, bits, opts, TARGET)                              \
   BitDB_diff_count_##TARGET((bit), (bits), (opts))
 
 #define BitDB_diff_count_store(bit, bits, opts, results, TARGET)               \
-  BitDB_diff_count_store_##TARGET((bit), (bits), (opts), (results))
+  BitDB_diff_count_store_##TARGET((bit), (bits), (results), (opts))
 
 #define BitDB_minus_count(bit, bits, opts, TARGET)                             \
   BitDB_minus_count_##TARGET((bit), (bits), (opts))
 
 #define BitDB_minus_count_store(bit, bits, opts, results, TARGET)              \
-  BitDB_minus_count_store_##TARGET((bit), (bits), (opts), (results))
+  BitDB_minus_count_store_##TARGET((bit), (bits), (results), (opts))
 
 extern void BitDB_inter_count_store_cpu(T_DB bit, T_DB bits, int *buffer,
                                         SETOP_COUNT_OPTS opts);
@@ -406,8 +2114,2657 @@ extern void BitDB_minus_count_store_gpu(T_DB bit, T_DB bits, int *buffer,
 extern int *BitDB_minus_count_cpu(T_DB bit, T_DB bits, SETOP_COUNT_OPTS opts);
 extern int *BitDB_minus_count_gpu(T_DB bit, T_DB bits, SETOP_COUNT_OPTS opts);
 
+/*
+    The hybrid target (TARGET hybrid in the macros above) counts on the GPU
+    and the CPU at once: the first rows of bits go to opts.device_id, driven
+    by one host thread, and the rest to the other opts.num_cpu_threads - 1
+    threads. The split follows the rates measured in each call, so that
+    both sides finish together. The first call on a device splits its rows
+    evenly and calibrates the share; later calls adapt it by averaging.
+    The device keeps all of bits (as for the gpu target), so a moving split
+    needs no new upload.
+
+    * BitDB_SETOP_count_hybrid       : Same as BitDB_SETOP_count_gpu.
+    * BitDB_SETOP_count_store_hybrid : Same as BitDB_SETOP_count_store_gpu.
+    * BitDB_hybrid_share             : The share of the rows the next hybrid
+                            call gives to device_id (0.5 before the first
+                            call, 0 without a GPU).
+
+    Without a GPU, with fewer than 2 CPU threads or targets, or if
+    opts.device_id is not a device, the counts are done on the CPU alone.
+    The checked runtime errors are those of the gpu target.
+*/
+extern void BitDB_inter_count_store_hybrid(T_DB bit, T_DB bits, int *buffer,
+                                           SETOP_COUNT_OPTS opts);
+extern int *BitDB_inter_count_hybrid(T_DB bit, T_DB bits,
+                                     SETOP_COUNT_OPTS opts);
+extern void BitDB_union_count_store_hybrid(T_DB bit, T_DB bits, int *buffer,
+                                           SETOP_COUNT_OPTS opts);
+extern int *BitDB_union_count_hybrid(T_DB bit, T_DB bits,
+                                     SETOP_COUNT_OPTS opts);
+extern void BitDB_diff_count_store_hybrid(T_DB bit, T_DB bits, int *buffer,
+                                          SETOP_COUNT_OPTS opts);
+extern int *BitDB_diff_count_hybrid(T_DB bit, T_DB bits,
+                                    SETOP_COUNT_OPTS opts);
+extern void BitDB_minus_count_store_hybrid(T_DB bit, T_DB bits, int *buffer,
+                                           SETOP_COUNT_OPTS opts);
+extern int *BitDB_minus_count_hybrid(T_DB bit, T_DB bits,
+                                     SETOP_COUNT_OPTS opts);
+
+/*
+    The auto target (TARGET auto in the macros above) runs each call on the
+    CPU or on opts.device_id, whichever a cost model expects to finish
+    first. The model times the counts of either engine as word pairs
+    (queries x targets x words of a row) over a rate measured by earlier
+    auto calls with a similar number of queries, and adds to the GPU the
+    copies of the operands that are not on the device yet (mapped, or
+    attached with BitDB_device_attach) and of the counts back, at
+    bandwidths probed once per device. Until both rates of a class of
+    query counts are measured, its calls run on the engine that lacks one,
+    the GPU first.
+
+    * BitDB_SETOP_count_auto       : Same as BitDB_SETOP_count_gpu.
+    * BitDB_SETOP_count_store_auto : Same as BitDB_SETOP_count_store_gpu.
+    * BitDB_auto_uses_gpu          : Whether the next auto call of bit
+                            against bits would run on the GPU.
+
+    Every call is logged in Bit_gpu_stats: auto_cpu_calls and
+    auto_gpu_calls count the decisions, and auto_cpu_estimate and
+    auto_gpu_estimate hold the seconds the model gave each engine for the
+    last one (0 while it was calibrating). Without a GPU, or if
+    opts.device_id is not a device, or under a cancellation token or
+    deadline, the counts are done on the CPU. The checked runtime errors
+    are those of the gpu target.
+*/
+extern void BitDB_inter_count_store_auto(T_DB bit, T_DB bits, int *buffer,
+                                         SETOP_COUNT_OPTS opts);
+extern int *BitDB_inter_count_auto(T_DB bit, T_DB bits, SETOP_COUNT_OPTS opts);
+extern void BitDB_union_count_store_auto(T_DB bit, T_DB bits, int *buffer,
+                                         SETOP_COUNT_OPTS opts);
+extern int *BitDB_union_count_auto(T_DB bit, T_DB bits, SETOP_COUNT_OPTS opts);
+extern void BitDB_diff_count_store_auto(T_DB bit, T_DB bits, int *buffer,
+                                        SETOP_COUNT_OPTS opts);
+extern int *BitDB_diff_count_auto(T_DB bit, T_DB bits, SETOP_COUNT_OPTS opts);
+extern void BitDB_minus_count_store_auto(T_DB bit, T_DB bits, int *buffer,
+                                         SETOP_COUNT_OPTS opts);
+extern int *BitDB_minus_count_auto(T_DB bit, T_DB bits, SETOP_COUNT_OPTS opts);
+extern bool BitDB_auto_uses_gpu(T_DB bit, T_DB bits, SETOP_COUNT_OPTS opts);
+extern double BitDB_hybrid_share(int device_id);
+
+/*
+    Cost estimates for schedulers. BitDB_estimate predicts the runtime,
+    the bytes moved and the memory held by a count call of a given shape
+    without running it, so that a scheduler can pack calls onto the CPUs
+    and GPUs of a host and turn away those that would miss their latency
+    targets. It uses the same rates as the auto target: a count takes
+    word pairs (queries x targets x words of a row, times the ops counted)
+    over a rate, and the kernels cannot stream the rows and counts faster
+    than the memory bandwidth.
+
+    The CPU rate and bandwidth are those of the current tuning at
+    opts.num_cpu_threads threads. Bit_tuning_autotune records the rate of
+    its winner; teams it did not time are calibrated on their first
+    estimate, which runs intersection counts of small random containers
+    and one query against 32 MiB of rows (a few tens of milliseconds).
+    The GPU rate of a class of query counts is the one the auto calls on
+    opts.device_id measured, or failing that the one of the nearest class
+    that was measured, and the copies are those of the operands that are
+    not resident and of the counts back, at the probed bandwidths.
+
+    * BitDB_estimate : The estimate of op (a Bit_count_ops value, several
+                       or-ed together for BitDB_multi_count_store) over
+                       shape on target. A top-k (shape.k above 0) keeps k
+                       pairs of count and index per query instead of the
+                       count matrix. For BIT_ESTIMATE_AUTO the estimate of
+                       the faster engine is returned, and gpu tells which.
+                       Without a GPU, or if opts.device_id is not a device,
+                       the GPU target is estimated on the CPU, as its
+                       calls run. calibrated is false for a GPU estimate
+                       before any auto call measured a GPU rate; seconds
+                       then assume the CPU rate.
+
+    It is a checked runtime error to pass a shape with a count or length
+    below 1 or a negative k, or an op that is not a non-empty set of
+    Bit_count_ops values.
+*/
+extern Bit_estimate BitDB_estimate(Bit_count_ops op, Bit_estimate_shape shape,
+                                   SETOP_COUNT_OPTS opts,
+                                   Bit_estimate_target target);
+
+/*
+    The SETOP count buffers hold BitDB_nelem(bit) * BitDB_nelem(bits)
+    entries, which overflows int (and unsigned int) arithmetic long before
+    either container reaches its own size limit: a self-join of 65536 rows
+    already has 2^32 entries. Size buffers and index results in size_t:
+
+    * BitDB_counts_size   : Entries in the count buffer of bit against bits;
+                            allocate store buffers with it.
+    * BitDB_counts_offset : Offset of the count of row i of bit against row j
+                            of bits, i.e. (size_t)i * BitDB_nelem(bits) + j.
+                            It is a checked runtime error to pass a negative
+                            i or j, or a j not less than BitDB_nelem(bits).
+
+    It is a checked runtime error to pass a NULL container.
+*/
+extern size_t BitDB_counts_size(T_DB bit, T_DB bits);
+extern size_t BitDB_counts_offset(T_DB bits, int i, int j);
+
+/*
+    Narrow count matrices. A count never exceeds the length of the rows, so
+    for most fingerprints (length <= 65535, often <= 255) an int per pair
+    wastes two or three of its four bytes, and the matrix, which is often
+    larger than both containers, costs that much more bandwidth to write
+    and to copy back from a GPU.
+
+    * BitDB_counts_type             : Resolves type for containers of
+                            BitDB_length(set): the narrowest type that
+                            holds every count if type is BIT_COUNTS_AUTO,
+                            type itself otherwise.
+    * BitDB_counts_bytes            : Bytes of the count buffer of bit
+                            against bits with elements of type.
+    * BitDB_count_store_typed_cpu,
+      BitDB_count_store_typed_gpu   : The op counts (one Bit_count_ops value)
+                            of bit against bits, in the layout of the
+                            BitDB_SETOP_count_store functions, with elements
+                            of type. Return the resolved type. The CPU form
+                            narrows every tile of counts while it is in
+                            cache; the GPU form writes the narrow type on
+                            the device, so only that many bytes come back.
+
+    It is a checked runtime error to pass a NULL container or buffer, an op
+    that is not a single Bit_count_ops value, or a type too narrow for the
+    length of the containers.
+*/
+extern Bit_counts_type BitDB_counts_type(T_DB set, Bit_counts_type type);
+extern size_t BitDB_counts_bytes(T_DB bit, T_DB bits, Bit_counts_type type);
+extern Bit_counts_type BitDB_count_store_typed_cpu(T_DB bit, T_DB bits,
+                                                   Bit_count_ops op,
+                                                   void *counts,
+                                                   Bit_counts_type type,
+                                                   SETOP_COUNT_OPTS opts);
+extern Bit_counts_type BitDB_count_store_typed_gpu(T_DB bit, T_DB bits,
+                                                   Bit_count_ops op,
+                                                   void *counts,
+                                                   Bit_counts_type type,
+                                                   SETOP_COUNT_OPTS opts);
+
+/*
+    Count matrices too large to hold: 100000 queries against 10^7 targets
+    make 4 TB of ints. These count bit against bits one cache tile at a
+    time, the tiles of the search modes, and give every tile away as soon
+    as it is counted, so memory stays at a tile per thread.
+
+    * BitDB_count_tiles_cpu      : Calls sink with every tile of the op
+                            counts (one Bit_count_ops value): the counts of
+                            queries [first_query, first_query + nquery)
+                            against targets [first_target, first_target +
+                            ntarget), as a row major nquery x ntarget
+                            matrix, tile[i * ntarget + j]. The tile is
+                            reused once sink returns. sink runs on the
+                            counting threads at once; all tiles of the same
+                            queries come from one thread, in increasing
+                            target order, so per-query state needs no lock.
+    * BitDB_count_store_file_cpu : Writes the op counts to the file at path
+                            in the layout of the BitDB_SETOP_count_store
+                            functions, with elements of type as resolved by
+                            BitDB_counts_type, so that the file can be
+                            mapped and indexed with BitDB_counts_offset.
+                            Returns 0, or -1 if the file cannot be written,
+                            and always on systems without POSIX files.
+
+    It is a checked runtime error to pass a NULL container, sink or path,
+    containers of different lengths, an op that is not a single
+    Bit_count_ops value, or a type too narrow for the length of the
+    containers. opts.num_cpu_threads sets the number of threads.
+*/
+extern void BitDB_count_tiles_cpu(T_DB bit, T_DB bits, Bit_count_ops op,
+                                  void sink(void *cl, int first_query,
+                                            int nquery, int first_target,
+                                            int ntarget, const int *tile),
+                                  void *cl, SETOP_COUNT_OPTS opts);
+extern int BitDB_count_store_file_cpu(T_DB bit, T_DB bits, Bit_count_ops op,
+                                      Bit_counts_type type, const char *path,
+                                      SETOP_COUNT_OPTS opts);
+
+/*
+    Incremental all-pairs files. A library that grows by a few rows between
+    runs need not recount its whole matrix: a file written by
+    BitDB_count_store_file_cpu(set, set, ...) is brought up to date by
+    counting only the rows that changed or were appended since, against
+    every row, with the tiles of BitDB_count_tiles_cpu.
+
+    * BitDB_count_update_file_cpu : Updates the file at path in place. The
+                            rows set had when the file was written follow
+                            from its size. The file grows to the rows set
+                            has now, the old rows of counts moved to their
+                            new places, and the rows and columns of the
+                            dirty rows are stored: the nrows rows listed in
+                            rows and every row appended since. With a NULL
+                            rows, the dirty rows are those of the change
+                            log of set (see BitDB_track_changes), which the
+                            update leaves alone, and all of them if rows
+                            were moved since its base. Returns 0, or -1 if
+                            the file cannot be updated, if its size is not
+                            that of a square matrix of type, or if it holds
+                            more rows than set, and always on systems
+                            without POSIX files.
+
+    The symmetric ops store the column of a dirty row from its row; MINUS
+    counts the column of dirty rows separately. type must be the type the
+    file was written with. It is a checked runtime error to pass a NULL set
+    or path, a NULL rows with nrows above 0 or for an untracked set, a
+    negative nrows, rows outside set, or an op that is not a single
+    Bit_count_ops value.
+*/
+extern int BitDB_count_update_file_cpu(T_DB set, Bit_count_ops op,
+                                       Bit_counts_type type, const char *path,
+                                       const int rows[], int nrows,
+                                       SETOP_COUNT_OPTS opts);
+
+/*
+    Count histograms: the distribution of the op counts of bit against bits
+    (significance thresholds, score distributions) without the counts
+    themselves. hist[c] is the number of (query, target) pairs whose count
+    is c, over BitDB_length(bit) + 1 bins, so the output is (length + 1)
+    bins instead of BitDB_nelem(bit) x BitDB_nelem(bits) ints.
+
+    * BitDB_count_histogram_cpu : Adds every tile of BitDB_count_tiles_cpu
+                            into the bins as it is counted: into the bins
+                            of its queries, or into bins of the counting
+                            thread that are summed at the end.
+    * BitDB_count_histogram_gpu : The same on opts.device_id, with the
+                            operands mapped, updated and released as by
+                            BitDB_inter_count_store_gpu. Every count is
+                            added to the bins of its query with a device
+                            atomic; for a global histogram the bins of a
+                            block of 4096 queries are summed on the device,
+                            so only the bins cross to the host. Without a
+                            GPU it calls the CPU function.
+
+    With per_query, hist holds BitDB_nelem(bit) x (BitDB_length(bit) + 1)
+    bins, those of query q from hist[q * (BitDB_length(bit) + 1)]; without,
+    BitDB_length(bit) + 1. It is a checked runtime error to pass a NULL
+    container or hist, containers of different lengths, or an op that is
+    not a single Bit_count_ops value. opts.num_cpu_threads sets the number
+    of threads.
+*/
+extern void BitDB_count_histogram_cpu(T_DB bit, T_DB bits, Bit_count_ops op,
+                                      bool per_query, uint64_t *hist,
+                                      SETOP_COUNT_OPTS opts);
+extern void BitDB_count_histogram_gpu(T_DB bit, T_DB bits, Bit_count_ops op,
+                                      bool per_query, uint64_t *hist,
+                                      SETOP_COUNT_OPTS opts);
+
+/*
+    Count statistics: the mean, variance, min and max of the op counts of
+    every query of bit against every row of bits (z-scores of similarities,
+    per-query cutoffs), gathered while the counts are produced rather than
+    in a second pass over the matrix. stats holds BitDB_nelem(bit) entries;
+    a query against an empty bits has all of them 0.
+
+    * BitDB_count_stats_cpu : Adds every tile of BitDB_count_tiles_cpu into
+                        running sums of its queries while the tile is in
+                        cache, and copies it into counts when counts is not
+                        NULL.
+    * BitDB_count_stats_gpu : The same on opts.device_id, with the operands
+                        mapped, updated and released as by
+                        BitDB_inter_count_store_gpu. A team counts a query
+                        against every target and reduces the sums in its
+                        threads, so only the statistics cross to the host,
+                        and the counts too when counts is not NULL. Without
+                        a GPU it calls the CPU function.
+
+    counts, when not NULL, is filled as by BitDB_SETOP_count_store. It is a
+    checked runtime error to pass a NULL container or stats, containers of
+    different lengths, or an op that is not a single Bit_count_ops value.
+    opts.num_cpu_threads sets the number of threads.
+*/
+extern void BitDB_count_stats_cpu(T_DB bit, T_DB bits, Bit_count_ops op,
+                                  Bit_count_stats *stats, int *counts,
+                                  SETOP_COUNT_OPTS opts);
+extern void BitDB_count_stats_gpu(T_DB bit, T_DB bits, Bit_count_ops op,
+                                  Bit_count_stats *stats, int *counts,
+                                  SETOP_COUNT_OPTS opts);
+
+/*
+    Tiled count files: a count matrix on disk as fixed tiles of tile_rows
+    queries x tile_cols targets (the register tile of the count kernels,
+    32 x 32 by default), each a whole number of cache lines, the counts
+    past the edges of the matrix zero. A lookup touches one tile of the
+    file instead of a row of the matrix, and the tiles of a compressed file
+    decode independently. Raw tiles are written with non-temporal stores
+    into a shared mapping of the file, since the writer never reads them.
+
+    * BitDB_count_store_tiled_cpu : Writes the op counts (one Bit_count_ops
+                            value) of bit against bits to the file at path,
+                            with elements of type as resolved by
+                            BitDB_counts_type. flags BIT_TILES_COMPRESSED
+                            leaves out the zero bytes of every tile, as
+                            BitDB_save_compressed does for rows. Returns 0,
+                            or -1 if the file cannot be written, and always
+                            on systems without POSIX files.
+    * BitDB_tiles_open          : Maps a tiled count file read only. Returns
+                            NULL if it cannot be opened or is not a valid
+                            tiled count file.
+    * BitDB_tiles_close         : Unmaps the file and zeros the pointer.
+    * BitDB_tiles_size          : The type of the counts; stores the number
+                            of queries and targets and the tile shape in
+                            whichever pointers are not NULL.
+    * BitDB_tiles_get           : The count of query against target. A
+                            compressed tile is decoded only up to that count.
+    * BitDB_tiles_block         : Decodes tile (row, col) into counts,
+                            tile_rows x tile_cols ints, row major. Returns 0,
+                            or -1 if the tile fails its checksum.
+
+    It is a checked runtime error to pass a NULL container, path, handle or
+    buffer, containers of different lengths, an op that is not a single
+    Bit_count_ops value, a type too narrow for the length of the
+    containers, or a query, target or tile outside the matrix.
+*/
+#define BIT_TILES_COMPRESSED 1 // BitDB_count_store_tiled_cpu flags
+
+extern int BitDB_count_store_tiled_cpu(T_DB bit, T_DB bits, Bit_count_ops op,
+                                       Bit_counts_type type, const char *path,
+                                       int flags, SETOP_COUNT_OPTS opts);
+extern Bit_tiles_T BitDB_tiles_open(const char *path);
+extern void BitDB_tiles_close(Bit_tiles_T *tiles);
+extern Bit_counts_type BitDB_tiles_size(Bit_tiles_T tiles, int *nqueries,
+                                        int *ntargets, int *tile_rows,
+                                        int *tile_cols);
+extern int BitDB_tiles_get(Bit_tiles_T tiles, int query, int target);
+extern int BitDB_tiles_block(Bit_tiles_T tiles, int row, int col,
+                             int *counts);
+
+/*
+    Asynchronous GPU counts. The BitDB_SETOP_count_store_gpu functions copy
+    the containers in, count and copy the counts out before they return.
+    The async form queues the same work as deferred target tasks and returns
+    at once, so the host can prepare the next call meanwhile. The targets
+    (bits) are cut into chunks of chunk_rows rows, and the upload of chunk
+    c + 1, the counts of chunk c and the download of the counts of chunk
+    c - 1 depend only on each other, so the copies overlap with the kernels.
+
+    * BitDB_count_store_gpu_async : Starts the op counts (one Bit_count_ops
+                            value) of bit against bits into counts, in the
+                            layout of BitDB_SETOP_count_store_gpu, and
+                            returns the handle of the call. A chunk_rows of
+                            0 takes BIT_ASYNC_CHUNK_ROWS. opts are honored
+                            as by the synchronous functions; the releases
+                            take place in BitDB_async_wait.
+    * BitDB_async_wait            : Waits until counts are complete, then
+                            frees the handle (*task becomes NULL). Must be
+                            called from the thread (task) that started it.
+
+    Neither container nor counts may be touched until the wait. Without a
+    GPU, or if opts.device_id is not one, the counts are done on the CPU
+    before the handle is returned. It is
+    a checked runtime error to pass a NULL container, buffer or task, an op
+    that is not a single Bit_count_ops value or a negative chunk_rows.
+*/
+#define BIT_ASYNC_CHUNK_ROWS 8192
+extern Bit_async_T BitDB_count_store_gpu_async(T_DB bit, T_DB bits,
+                                               Bit_count_ops op, int *counts,
+                                               int chunk_rows,
+                                               SETOP_COUNT_OPTS opts);
+extern void BitDB_async_wait(Bit_async_T *task);
+
+/*
+    Multi-GPU counts. The rows of bits are cut into one contiguous shard per
+    device of devices, in proportion to weights (say, the throughputs of
+    the cards; NULL for equal shares), and the shards are counted against
+    bit concurrently, one host thread per device. Each device writes its
+    block of counts straight into its columns of counts, in the layout of
+    BitDB_SETOP_count_store_gpu.
+
+    * BitDB_count_store_gpu_multi : The op counts (one Bit_count_ops value)
+                            of bit against bits on ndevices devices. The
+                            same bits, devices and weights give the same
+                            shards, so the shards (and bit) stay on their
+                            devices across calls unless opts releases them;
+                            upd_1st_operand/upd_2nd_operand refresh them.
+                            opts.device_id is ignored, and the host device
+                            (omp_get_initial_device()) may take a share.
+
+    Without a GPU the counts are done on the CPU. It is a checked runtime
+    error to pass a NULL container, buffer or device list, ndevices < 1, a
+    negative weight or weights that sum to zero, an op that is not a single
+    Bit_count_ops value, or containers that share rows.
+*/
+extern void BitDB_count_store_gpu_multi(T_DB bit, T_DB bits, Bit_count_ops op,
+                                        int *counts, const int *devices,
+                                        const double *weights, int ndevices,
+                                        SETOP_COUNT_OPTS opts);
+
+/*
+    K-split counts of few long rows. When the rows of a CPU count store make
+    fewer cache tiles than the team has threads (a handful of rows of
+    millions of bits, say), the words of the rows are split over the threads
+    instead: each counts every pair over an aligned range of the words, and
+    the partial counts are summed into the matrix. The CPU count stores do
+    that by themselves, except under a cancellation token, deadline or
+    hooks, whose tiles are whole rows. On a GPU the K_SPLIT algorithm does
+    the same with at least GPU_KSPLIT_PARTS ranges (32 by default), more
+    when the pairs are too few to fill GPU_KSPLIT_TEAMS teams (4096), as
+    long as a range keeps GPU_KSPLIT_MIN_WORDS words (1024). The threads of
+    a team sum the words of a long range, and a second kernel sums the
+    partials, a team per count when the ranges are many. The default
+    algorithm (TRANSPOSED_TEAM_PARALLEL_SIMD, on 64-bit device words) runs
+    K_SPLIT by itself for fewer than GPU_KSPLIT_AUTO_PAIRS pairs (4096) of
+    rows of GPU_KSPLIT_AUTO_WORDS words or more (16384). Across devices,
+    the rows are split into containers of their own first:
+
+    * BitDB_column_partition : Cuts the rows of set into up to nparts
+                            contiguous word ranges, each a multiple of
+                            ALIGNMENT bytes but the last, and stores each as
+                            a new container of set->nelem rows in parts
+                            (to be freed with BitDB_free). Returns how many
+                            were made, fewer than nparts when the rows have
+                            too few words.
+    * BitDB_count_store_gpu_parts : The op counts (one Bit_count_ops value)
+                            of the whole rows, from nparts pairs of parts:
+                            part p of bit_parts against part p of
+                            bits_parts is counted on devices[p]
+                            (opts.device_id for all if devices is NULL),
+                            one host thread per part, and the partial
+                            matrices are summed on the host into counts, in
+                            the layout of BitDB_SETOP_count_store_gpu.
+
+    Any op counts as the sum of its counts over disjoint word ranges, as the
+    padding past the end of the rows is zero. Without a GPU the parts are
+    counted on the CPU. It is a checked runtime error to pass a NULL
+    container, part list or buffer, nparts < 1, parts of unequal row counts
+    or of unequal lengths within a pair, or an op that is not a single
+    Bit_count_ops value.
+*/
+extern int BitDB_column_partition(T_DB set, int nparts, T_DB parts[],
+                                  SETOP_COUNT_OPTS opts);
+extern void BitDB_count_store_gpu_parts(T_DB bit_parts[], T_DB bits_parts[],
+                                        int nparts, Bit_count_ops op,
+                                        int *counts, const int *devices,
+                                        SETOP_COUNT_OPTS opts);
+
+/*
+    Device-resident containers. An attached container keeps a copy of its
+    rows on one device and remembers which rows BitDB_put_at,
+    BitDB_replace_at, BitDB_clear_at (and the other row writers: clear,
+    append, insert, sort) changed since the copy was last brought up to
+    date. The GPU set operations sync an attached operand on its device by
+    pushing only those rows, one transfer per run of consecutive rows,
+    whatever upd_1st_operand/upd_2nd_operand say.
+
+    * BitDB_device_attach : Maps the rows (the whole capacity, so appends fit)
+                            to device_id and starts tracking dirty rows.
+    * BitDB_device_sync   : Pushes the dirty rows now and returns how many
+                            there were. Set operations call it themselves.
+    * BitDB_device_detach : Drops the device copy and stops the tracking.
+                            BitDB_free detaches an attached container.
+
+    Growing the capacity of an attached container maps its new rows afresh.
+    Writes through BitDB_view_at handles or the buffer of BitDB_load are not
+    seen; attached containers are synced on their own device only. Without
+    a GPU, or in a unified shared memory build (USM=1) where the device
+    reads the host rows in place, the rows are still tracked, so
+    BitDB_device_sync only counts them.
+    It is a checked runtime error to pass a NULL container, to attach an
+    attached container, or to sync or detach one that is not attached.
+*/
+extern void BitDB_device_attach(T_DB set, int device_id);
+extern int BitDB_device_sync(T_DB set);
+extern void BitDB_device_detach(T_DB set);
+
+/*
+    Row counts, column counts and reductions on the GPU, read from the copy
+    of the rows the set operations left on the device (or from an attached
+    container, after a sync), so that normalizing a similarity needs no
+    host scan of the rows. Rows not yet on opts.device_id are mapped there
+    and stay until a release; opts.upd_1st_operand re-uploads resident
+    rows, and opts.release_1st_operand (and _2nd_ for bits) releases them
+    afterwards, as for the GPU set operations. Results are copied to host
+    arrays; nothing but them comes back.
+
+    * BitDB_count_store_gpu       : BitDB_count_store on the device; a
+                                    container with a popcount cache
+                                    (BitDB_cache_counts) copies it.
+    * BitDB_count_store_cards_gpu : The op counts of bit against bits, as
+                                    BitDB_SETOP_count_store_gpu, and the row
+                                    counts of bit and of bits into bit_cards
+                                    and bits_cards, either of which may be
+                                    NULL. Both cardinalities take a single
+                                    launch while the rows are resident.
+    * BitDB_column_counts_gpu     : BitDB_column_counts on the device.
+    * BitDB_reduce_gpu            : BitDB_reduce of the rows into out on the
+                                    device; BIT_REDUCE_ATLEAST and
+                                    BIT_REDUCE_MAJORITY threshold the column
+                                    counts.
+
+    Without a GPU (NOGPU builds) these are the host functions.
+    It is a checked runtime error to pass what the host functions reject,
+    or an op that is not a single Bit_count_ops value.
+*/
+extern void BitDB_count_store_gpu(T_DB set, int *counts,
+                                  SETOP_COUNT_OPTS opts);
+extern void BitDB_count_store_cards_gpu(T_DB bit, T_DB bits, Bit_count_ops op,
+                                        int *counts, int *bit_cards,
+                                        int *bits_cards,
+                                        SETOP_COUNT_OPTS opts);
+extern void BitDB_column_counts_gpu(T_DB set, uint32_t *out,
+                                    SETOP_COUNT_OPTS opts);
+extern void BitDB_reduce_gpu(T_DB set, Bit_reduce_op op, int k, T out,
+                             SETOP_COUNT_OPTS opts);
+
+/*
+    GPU telemetry. Process-wide counters of what the GPU functions did on
+    all devices, kept with relaxed atomics so that they cost next to
+    nothing; a scheduler that sees transitions climbing between the same
+    two layouts, or bytes copied again for the same containers, is
+    thrashing and can pin the algorithm or attach the container instead.
+
+    * Bit_gpu_stats_get    : A snapshot of the counters. Layout transitions
+                             are counted per step of the path the layout
+                             router takes, by base layout (the narrowed
+                             32-bit word states count as their base), so
+                             a detour through a third layout shows as two.
+                             Bytes are those of the map and update
+                             transfers the functions ask for, asynchronous
+                             ones included.
+    * Bit_gpu_stats_reset  : Zeroes the counters and timers.
+    * Bit_gpu_stats_timers : Turns the timers on or off (off at start) and
+                             returns the previous setting. Timed regions
+                             read the wall clock on entry and exit, and
+                             kernel_seconds includes the wait for the
+                             device; asynchronous copies are not timed.
+
+    Without a GPU, and for the unified shared memory build (USM=1) where
+    nothing is copied, the counters that do not apply stay at zero.
+*/
+extern Bit_gpu_stats Bit_gpu_stats_get(void);
+extern void Bit_gpu_stats_reset(void);
+extern bool Bit_gpu_stats_timers(bool enable);
+
+/*
+    Device memory budgets. Containers stay mapped on a device after a GPU
+    call unless it releases them, so rotating through more of them than the
+    device holds ends in failed allocations. With a budget set, the layout
+    registry treats the device as a cache over the host containers: before
+    mapping a buffer it unmaps the least recently used ones that no call is
+    using, in whatever layout their device copy was left, until the new one
+    fits. A container that was evicted is uploaded again, row-major, by the
+    next call that needs it; an attached one by its next BitDB_device_sync.
+
+    * Bit_gpu_budget_set     : Sets the budget of device_id in bytes; 0, the
+                               default, turns budgeting off.
+    * Bit_gpu_budget_get     : The budget of device_id.
+    * Bit_gpu_resident_bytes : Bytes of the buffers counted against the
+                               budget that are still mapped on device_id.
+
+    Only buffers mapped while a budget is set count against it, and the
+    scratch of the layout transitions never does, so leave some headroom.
+    The operands and counts of a call in flight are never evicted: a call
+    whose own buffers exceed the budget still maps them. Evictions are
+    counted in Bit_gpu_stats. Without a GPU, or in a unified shared memory
+    build (USM=1), nothing is mapped and the budget is only recorded.
+*/
+extern void Bit_gpu_budget_set(int device_id, size_t bytes);
+extern size_t Bit_gpu_budget_get(int device_id);
+extern size_t Bit_gpu_resident_bytes(int device_id);
+
+/*
+    Device word width. The TRANSPOSED_TEAM_PARALLEL_SIMD kernel reads the
+    targets as 64-bit words, or, on devices whose 64-bit integer ops are
+    slow, as 32-bit words: the device copy of the targets is then narrowed
+    to column-major 32-bit halves (low half first) instead of transposed.
+    The build picks the width of every device from the target
+    architectures (make GPU_WORD_BITS=auto, 32 or 64).
+
+    * Bit_gpu_word_bits_set : Sets the width of device_id to 32 or 64 bits,
+                              or back to the build's choice with 0.
+    * Bit_gpu_word_bits     : The width device_id uses.
+
+    It is a checked runtime error to pass a negative device_id or another
+    width. Device ids past the first 64 keep the build's choice.
+*/
+extern void Bit_gpu_word_bits_set(int device_id, int bits);
+extern int Bit_gpu_word_bits(int device_id);
+
+/*
+    Native GPU backends. The NATIVE_COARSENED algorithm of the
+    BitDB_SETOP_count_gpu and BitDB_SETOP_count_store_gpu functions runs the
+    coarsened CUDA/HIP popcount kernel of the native benchmarks instead of
+    the OpenMP offload kernels, so it does not depend on the offload support
+    of the compiler. The kernel lives in optional libraries, libbit_cuda.so
+    (make libbit_cuda, needs nvcc) and libbit_hip.so (make libbit_hip, needs
+    hipcc), that libbit loads on the first such call: the one named by the
+    environment variable BIT_NATIVE_BACKEND (a library name or path, or
+    "none" to never load one), else the first of the two found on the
+    library search path that drives a device.
+
+    Every kernel of the backend counts each of the four ops, and
+    BitDB_multi_count_store_gpu runs one that counts all four at once.
+    Batches of 32 queries or more run a register-blocked variant, in which
+    each thread counts a 4 x 4 block of queries x targets (OUTER_ROW_NUM x
+    OUTER_COL_NUM at build time) from words it reuses in registers, and rows
+    of at most 32 words a kernel that broadcasts the query words from the
+    registers of a warp with shuffles. On NVIDIA sm_75 and later, when the
+    backend was built for such an arch, the counts run on the binary tensor
+    cores instead for the inter and diff counts (b1 matrix products of
+    8-row x 128-bit fragments, with AND or XOR and popcount accumulation). The environment variable
+    BIT_NATIVE_KERNEL ("coarsened", "outer", "shuffle" or "bmma") forces one
+    kernel where the device and the rows allow it. The coarsened kernel runs
+    the GPU_TILE_J x GPU_ILP pair recorded in the sweeps of
+    benchmark_GPU_params for the arch of the device, or else the pair that
+    timed fastest on its first count of rows that long
+    (BIT_NATIVE_AUTOTUNE=1 always self-tunes, 0 never does).
+
+    Query operands that must be uploaded and exceed a 16 MB chunk are
+    streamed through pinned memory in chunks, on three streams that overlap
+    transfers and kernels, so they need not fit in device memory. With
+    BIT_NATIVE_GRAPH=1, smaller batches replay a graph of the upload, kernel
+    and download captured once per shape instead of issuing them one by one.
+
+    * Bit_gpu_native_backend : "cuda" or "hip", or NULL when no backend
+                               was loaded.
+
+    The backend keeps its own device copies of the operands, the targets
+    transposed, and reuses them while the same containers come back
+    unchanged, so repeated counts against a fixed reference container pay
+    for its upload and transpose once. A container written through the
+    BitDB functions since its upload is uploaded again by itself;
+    upd_*_operand forces that (say, after writes to the buffer of BitDB_load)
+    and release_*_operand frees the copy after the call, as for the OpenMP
+    kernels. The copies are not shared with those kernels, nor counted in
+    Bit_gpu_stats or the device budgets. Device ids are those of
+    the CUDA or HIP runtime. Without a backend for opts.device_id, or if the
+    backend fails, the count runs the TRANSPOSED_TEAM_PARALLEL_SIMD kernel.
+    BitDB_inter_count_threshold_gpu runs the native kernels as well, with
+    the matches emitted from their registers. The other GPU functions
+    (typed, asynchronous, multi-GPU and top-k counts) treat
+    NATIVE_COARSENED as TRANSPOSED_TEAM_PARALLEL_SIMD.
+*/
+extern const char *Bit_gpu_native_backend(void);
+
+/*
+    Self-joins: SETOP counts of every row of set against every row of set,
+    for the symmetric ops (inter, union, diff). Only the pairs i <= j are
+    counted, which halves the work and the row traffic of passing the same
+    container as both operands of BitDB_SETOP_count_store_cpu.
+
+    * BitDB_SETOP_count_self_cpu : Writes the counts to counts in layout:
+                            BIT_SELF_MIRROR fills the whole n x n matrix of
+                            BitDB_SETOP_count_store_cpu, copying each count
+                            to (i, j) and (j, i); BIT_SELF_PACKED stores the
+                            upper triangle, diagonal included, row by row.
+    * BitDB_self_counts_size   : Entries of the counts buffer of a layout.
+    * BitDB_self_counts_offset : Offset of the pair (i, j), in either order
+                            for BIT_SELF_PACKED.
+
+    It is a checked runtime error to pass a NULL container or buffer, an
+    unknown layout, or row indices out of range. Only the num_cpu_threads
+    field of opts (and its tuning) is used.
+*/
+extern void BitDB_inter_count_self_cpu(T_DB set, int *counts,
+                                       Bit_self_layout layout,
+                                       SETOP_COUNT_OPTS opts);
+extern void BitDB_union_count_self_cpu(T_DB set, int *counts,
+                                       Bit_self_layout layout,
+                                       SETOP_COUNT_OPTS opts);
+extern void BitDB_diff_count_self_cpu(T_DB set, int *counts,
+                                      Bit_self_layout layout,
+                                      SETOP_COUNT_OPTS opts);
+extern size_t BitDB_self_counts_size(T_DB set, Bit_self_layout layout);
+extern size_t BitDB_self_counts_offset(T_DB set, int i, int j,
+                                       Bit_self_layout layout);
+
+/*
+    Streaming SETOP counts of every bitset of bit against a second side that
+    is never resident as a whole: its rows arrive in blocks of at most
+    block_rows packed bitsets of BitDB_length(bit) bits. The next block is
+    read on a separate thread while the current one is counted, so I/O and
+    counting overlap; only two blocks are ever held in memory.
+
+    * next_block          : Copies up to max_rows rows of row_bytes bytes
+                            each into rows and returns how many it copied.
+                            A return of 0, or fewer than max_rows, ends the
+                            stream. It runs concurrently with the counting,
+                            but never concurrently with itself or emit.
+    * emit                : Receives the counts of the block whose first
+                            row has index first_row in the stream, as a
+                            BitDB_nelem(bit) x nrows row major tile: the
+                            count of bitset i against row first_row + j is
+                            counts[(size_t)i * nrows + j]. The tile is
+                            reused once emit returns.
+    * BitDB_stream_read_file : A next_block for a FILE * (passed as cl)
+                            positioned at the first row of packed rows, such
+                            as a BitDB_save file of a BitDB_new container
+                            after skipping its 4096 byte header.
+
+    It is a checked runtime error to pass a NULL bit, next_block or emit,
+    or a block_rows less than 1. opts.num_cpu_threads sets the threads of
+    the counting team; one more thread reads ahead.
+*/
+extern void BitDB_inter_count_stream_cpu(
+    T_DB bit, int next_block(void *cl, void *rows, int max_rows, int row_bytes),
+    void *block_cl, int block_rows,
+    void emit(void *cl, size_t first_row, int nrows, const int *counts),
+    void *emit_cl, SETOP_COUNT_OPTS opts);
+extern void BitDB_union_count_stream_cpu(
+    T_DB bit, int next_block(void *cl, void *rows, int max_rows, int row_bytes),
+    void *block_cl, int block_rows,
+    void emit(void *cl, size_t first_row, int nrows, const int *counts),
+    void *emit_cl, SETOP_COUNT_OPTS opts);
+extern void BitDB_diff_count_stream_cpu(
+    T_DB bit, int next_block(void *cl, void *rows, int max_rows, int row_bytes),
+    void *block_cl, int block_rows,
+    void emit(void *cl, size_t first_row, int nrows, const int *counts),
+    void *emit_cl, SETOP_COUNT_OPTS opts);
+extern void BitDB_minus_count_stream_cpu(
+    T_DB bit, int next_block(void *cl, void *rows, int max_rows, int row_bytes),
+    void *block_cl, int block_rows,
+    void emit(void *cl, size_t first_row, int nrows, const int *counts),
+    void *emit_cl, SETOP_COUNT_OPTS opts);
+extern int BitDB_stream_read_file(void *file, void *rows, int max_rows,
+                                  int row_bytes);
+
+/*
+    Search modes for intersection counts. Both count bit (the queries)
+    against bits (the targets) one cache-sized tile at a time and fold each
+    tile into per-query results right away, so the
+    BitDB_nelem(bit) x BitDB_nelem(bits) matrix is never formed.
+
+    * BitDB_inter_count_topk      : For every query q, writes its k targets
+                            with the largest counts to out_idx[q * k + r]
+                            and out_count[q * k + r], r = 0 being the best;
+                            ties go to the lower target index. Both buffers
+                            hold BitDB_nelem(bit) * k ints. Slots beyond the
+                            number of targets get index and count -1.
+    * BitDB_inter_count_threshold : Finds, for every query, all targets with
+                            a count of at least threshold, in increasing
+                            target order. The matches of query q are
+                            (*out_idx)[m] and (*out_count)[m] for m in
+                            [offsets[q], offsets[q + 1]); offsets holds
+                            BitDB_nelem(bit) + 1 entries. *out_idx and
+                            *out_count are allocated by the library and
+                            freed by the caller. Returns the total number
+                            of matches.
+
+    A search restricted to a subset of the targets (a tenant, a date range)
+    passes it as opts.row_mask, a bitset over the rows of bits: only the
+    targets whose bit is set are searched, and the others are never
+    counted. The selected rows are first gathered into a packed container,
+    so the tiles are as dense as those of an unrestricted search. The
+    results keep the target indices of bits. The similarity search modes
+    and the GPU search modes below take the same mask.
+
+    It is a checked runtime error to pass NULL containers or output
+    buffers, containers of different lengths, a k less than 1, or a
+    row_mask whose length is not BitDB_nelem(bits).
+    opts.num_cpu_threads sets the number of threads.
+*/
+extern void BitDB_inter_count_topk(T_DB bit, T_DB bits, int k,
+                                   SETOP_COUNT_OPTS opts, int *out_idx,
+                                   int *out_count);
+extern size_t BitDB_inter_count_threshold(T_DB bit, T_DB bits, int threshold,
+                                          SETOP_COUNT_OPTS opts,
+                                          size_t *offsets, int **out_idx,
+                                          int **out_count);
+
+/*
+    Screened threshold searches for long rows at low hit rates. Every pair
+    is first counted over a sample of nwords word positions only; the
+    intersection is counted in full, by the SIMD kernels, just for the
+    targets that the sampled count says may reach threshold. A 16 kbit row
+    sampled at 32 of its 256 words costs an eighth of the bytes for every
+    target the screen drops.
+
+    * BitDB_screen_words         : Picks nwords word positions of the rows
+                            of set into words, in increasing order, and
+                            returns how many (nwords, or the words of a row
+                            if fewer). Whole 64-byte lines of 8 words are
+                            taken, those whose bit counts vary most over
+                            the rows (up to 4096 of them) with by_variance,
+                            random ones from seed otherwise.
+    * BitDB_inter_count_screened : Writes what BitDB_inter_count_threshold
+                            writes, for the targets that pass the screen.
+                            BIT_SCREEN_BOUND passes a target if its sampled
+                            count plus the bits the query or the target
+                            (whichever has fewer) have outside the sample
+                            reaches threshold, so the results are exact.
+                            BIT_SCREEN_ESTIMATE passes it if the sampled
+                            count, scaled to the whole row, comes within 3
+                            standard deviations of threshold; it drops more
+                            targets and may lose matches.
+
+    The row popcounts come from the count caches when those are enabled
+    (BitDB_cache_counts). opts.num_cpu_threads sets the number of threads;
+    row_mask is not taken. It is a checked runtime error to pass NULL
+    containers, words or output buffers, containers of different lengths,
+    a non-positive nwords, words outside the row, or a mode not listed
+    above.
+*/
+extern int BitDB_screen_words(T_DB set, int nwords, bool by_variance,
+                              unsigned int seed, int *words);
+extern size_t BitDB_inter_count_screened(T_DB bit, T_DB bits, int threshold,
+                                         const int words[], int nwords,
+                                         Bit_screen_mode mode,
+                                         SETOP_COUNT_OPTS opts,
+                                         size_t *offsets, int **out_idx,
+                                         int **out_count);
+
+/*
+    Folded screening. A folded companion of a container ORs every row onto
+    a shorter one, bit i onto bit i mod folded_length (2048 bits onto 256,
+    say), and the folded searches read only the folded targets for most
+    pairs. From the folded target and the number of query bits that fold
+    onto each of its positions they bound the intersection from above, and
+    count the full rows only for the targets the bound lets through, so the
+    results are exact.
+
+    * BitDB_fold            : A new container of the rows of set folded to
+                            folded_length bits. It is not kept in step with
+                            set; fold again after writing to set.
+    * BitDB_inter_count_threshold_folded : Writes what
+                            BitDB_inter_count_threshold writes, screening
+                            the targets of bits through folded, a fold of
+                            bits.
+    * BitDB_inter_count_topk_folded : Writes what BitDB_inter_count_topk
+                            writes, counting a target in full only while
+                            its bound exceeds the k-th count kept so far.
+
+    The folded intersection count itself is no bound (shared bits collide
+    with others), which is why the bound weighs the folded target bits by
+    the query. opts.num_cpu_threads sets the number of threads; row_mask is
+    not taken. It is a checked runtime error to pass NULL containers or
+    output buffers, containers of different lengths, a k less than 1, a
+    folded_length that is not a positive multiple of 64 or exceeds the
+    length of set, or a folded container whose rows are not those of bits
+    or whose length is not such a multiple.
+*/
+extern T_DB BitDB_fold(T_DB set, int folded_length, SETOP_COUNT_OPTS opts);
+extern size_t BitDB_inter_count_threshold_folded(T_DB bit, T_DB bits,
+                                                 T_DB folded, int threshold,
+                                                 SETOP_COUNT_OPTS opts,
+                                                 size_t *offsets,
+                                                 int **out_idx,
+                                                 int **out_count);
+extern void BitDB_inter_count_topk_folded(T_DB bit, T_DB bits, T_DB folded,
+                                          int k, SETOP_COUNT_OPTS opts,
+                                          int *out_idx, int *out_count);
+
+/*
+    The same search modes on the GPU (opts.device_id), with the selection
+    done on the device, so only the results cross to the host instead of
+    the BitDB_nelem(bit) x BitDB_nelem(bits) count matrix. The results,
+    their layout and the checked runtime errors are those of the CPU
+    functions above; the operands are mapped, updated and released as by
+    BitDB_inter_count_store_gpu. With opts.row_mask, the indices of the
+    selected targets are copied to the device. The kernels then loop over
+    those indices only, and the targets stay resident as before.
+
+    * BitDB_inter_count_topk_gpu      : Every query's targets are split
+                            among up to 65536 / BitDB_nelem(bit) device
+                            threads, each of which keeps its own k best;
+                            one thread per query then merges those lists.
+    * BitDB_inter_count_threshold_gpu : Matches are appended atomically to
+                            one device list of (query, target, count); the
+                            host sorts them into the CSR layout. With
+                            NATIVE_COARSENED and a native backend, the
+                            count kernel compares its counts with threshold
+                            in registers and each warp reserves the slots
+                            of its matches with one atomic; a list that
+                            overflows is completed by a second launch from
+                            the first query that lost a match. A
+                            row_mask runs the OpenMP kernel instead.
+
+    Without a GPU both call the CPU functions.
+*/
+extern void BitDB_inter_count_topk_gpu(T_DB bit, T_DB bits, int k,
+                                       SETOP_COUNT_OPTS opts, int *out_idx,
+                                       int *out_count);
+extern size_t BitDB_inter_count_threshold_gpu(T_DB bit, T_DB bits,
+                                              int threshold,
+                                              SETOP_COUNT_OPTS opts,
+                                              size_t *offsets, int **out_idx,
+                                              int **out_count);
+
+/*
+    Thresholded bit matrix of intersection counts, for graph construction
+    and other uses that only ask whether a pair reaches threshold. Row q of
+    the result is a bitset of BitDB_nelem(bits) bits, bit i set iff the
+    intersection count of query q and target i is at least threshold: the
+    adjacency matrix of the threshold graph, 32 times smaller than the int
+    counts, and a container the set operations and counts of this library
+    take as it is (BitDB_inter_count_store_cpu of the result against
+    itself counts the common neighbours of every two queries, say, and
+    BitDB_transpose gives the neighbours of every target).
+
+    * BitDB_inter_count_threshold_bits     : Counts one tile at a time, as
+                            the search modes above, and packs every tile
+                            row into the result with one vector compare to
+                            a lane mask per vector of counts.
+    * BitDB_inter_count_threshold_bits_gpu : Every device thread packs the
+                            compares of the 64 targets of one result word,
+                            as a warp ballot would; only the bit matrix
+                            crosses to the host. Without a GPU it calls
+                            the CPU function.
+
+    Rows and bits follow the row IDs of the queries and targets (see
+    BitDB_reorder). With opts.row_mask only the selected targets are
+    counted, and the bits of the others stay clear. The result is a new
+    container freed by the caller with BitDB_free; a threshold of 0 or less
+    sets every bit of the selected targets. It is a checked runtime error
+    to pass NULL containers, containers of different lengths, or a
+    row_mask whose length is not BitDB_nelem(bits).
+*/
+extern T_DB BitDB_inter_count_threshold_bits(T_DB bit, T_DB bits,
+                                             int threshold,
+                                             SETOP_COUNT_OPTS opts);
+extern T_DB BitDB_inter_count_threshold_bits_gpu(T_DB bit, T_DB bits,
+                                                 int threshold,
+                                                 SETOP_COUNT_OPTS opts);
+
+/*
+    Similarity coefficients of every query in bit against every target in
+    bits. The row popcounts are taken from the count caches when those are
+    enabled (see BitDB_cache_counts) and computed once per call
+    otherwise; every tile of intersection counts is turned into
+    similarities while still in cache, so the count matrix is never
+    materialized. A coefficient whose denominator is zero (e.g. two empty
+    rows) is reported as 0.
+
+    * BitDB_similarity_store_cpu     : Writes the similarity of query i and
+                            target j to out[BitDB_counts_offset(bits, i, j)];
+                            out holds BitDB_counts_size(bit, bits) floats.
+    * BitDB_similarity_u16_store_cpu : Same, as 16 bit fixed point values
+                            rounded from similarity * 65535, which halves
+                            the output size.
+    * BitDB_similarity_topk          : The k most similar targets of every
+                            query, laid out and tie-broken as in
+                            BitDB_inter_count_topk; empty slots get index -1
+                            and similarity -1.
+    * BitDB_similarity_threshold     : All targets with a similarity of at
+                            least cutoff, in the CSR layout of
+                            BitDB_inter_count_threshold. Returns the total
+                            number of matches.
+    * BitDB_sort_by_count            : Reorders the rows of set by increasing
+                            popcount (ties keep their order) and, if perm is
+                            not NULL, writes the old index of every new row
+                            to perm[0 .. BitDB_nelem(set)). The count cache
+                            follows the rows.
+    * BitDB_reorder                  : Reorders the rows of set by key and
+                            gives every row an ID, its index before the
+                            first reorder. BIT_ORDER_COUNT sorts as
+                            BitDB_sort_by_count. BIT_ORDER_GRAY puts rows in
+                            Gray-code order (bit 0 the most significant), so
+                            rows sharing their leading bits are neighbours.
+                            BIT_ORDER_COUNT_GRAY does both: popcount first,
+                            then Gray-code order among rows of a popcount.
+                            perm receives the old index of every new row as
+                            for BitDB_sort_by_count (it may be NULL), except
+                            with BIT_ORDER_PERM, where the caller passes the
+                            permutation in perm: row perm[i] moves to i.
+                            The top-k and threshold searches (intersection
+                            counts and similarities, on the CPU and the GPU)
+                            report and order the rows of reordered
+                            containers, queries and targets, by their IDs,
+                            so they return what they did before the
+                            reorder; the GPU top-k may break ties at the
+                            k-th place differently. Other functions index
+                            rows by their place, e.g. count matrices and
+                            BitDB_get_from. Rows added later take the next
+                            IDs, and later sorts keep the IDs.
+    * BitDB_row_ids                  : IDs of the rows of set, indexed by
+                            row, or NULL when set was never reordered (the
+                            IDs are the rows themselves). The array belongs
+                            to set and changes with it.
+    * BitDB_reset_row_ids            : Makes the rows their own IDs again.
+
+    The top-k and threshold searches skip every tile of targets whose
+    popcounts rule out a match for all of the queries of the tile: a
+    similarity cannot exceed its value at |A & B| = min(|A|, |B|), e.g.
+    min(|A|, |B|) / max(|A|, |B|) for Tanimoto. On a container sorted by
+    popcount a tile covers a narrow range of popcounts, so most tiles are
+    skipped; sorting the queries as well makes the bound of each query block
+    tighter. Results are the same with or without sorting, up to the row
+    order.
+
+    The checked runtime errors of the intersection search modes apply;
+    BitDB_sort_by_count and BitDB_reorder may not be called on a read only
+    container, and BitDB_reorder checks that a BIT_ORDER_PERM perm is a
+    permutation of the rows.
+    Only the num_cpu_threads field of opts is used, and the row_mask field
+    by the top-k and threshold searches.
+*/
+extern void BitDB_similarity_store_cpu(T_DB bit, T_DB bits,
+                                       Bit_similarity sim, float *out,
+                                       SETOP_COUNT_OPTS opts);
+extern void BitDB_similarity_u16_store_cpu(T_DB bit, T_DB bits,
+                                           Bit_similarity sim, uint16_t *out,
+                                           SETOP_COUNT_OPTS opts);
+extern void BitDB_similarity_topk(T_DB bit, T_DB bits, Bit_similarity sim,
+                                  int k, SETOP_COUNT_OPTS opts, int *out_idx,
+                                  float *out_sim);
+extern size_t BitDB_similarity_threshold(T_DB bit, T_DB bits,
+                                         Bit_similarity sim, float cutoff,
+                                         SETOP_COUNT_OPTS opts,
+                                         size_t *offsets, int **out_idx,
+                                         float **out_sim);
+extern void BitDB_sort_by_count(T_DB set, int *perm, SETOP_COUNT_OPTS opts);
+extern void BitDB_reorder(T_DB set, Bit_row_order key, int *perm,
+                          SETOP_COUNT_OPTS opts);
+extern const int *BitDB_row_ids(T_DB set);
+extern void BitDB_reset_row_ids(T_DB set);
+
+/*
+    Similarity self-joins by prefix filtering (AllPairs, PPJoin). At a high
+    cutoff (a Tanimoto of 0.8, say) most pairs of rows cannot match, and
+    counting all of them, as BitDB_similarity_threshold(set, set, ...)
+    does, is mostly wasted. The join orders the bits by their column counts
+    (BitDB_column_counts), rarest first. A cutoff fixes the number of bits
+    alpha two rows of given popcounts must share, and such rows share one
+    of the first |x| - alpha + 1 bits of each. Only those prefixes go into
+    inverted lists of rows. Each row is probed in parallel against the
+    lists of the rows of no greater popcount. Rows too short to reach the
+    cutoff are skipped, as are candidates that cannot reach alpha with the
+    bits left after the positions where they met. The candidates left are
+    counted with the intersection kernel.
+
+    * BitDB_similarity_join : All pairs of rows of set with a similarity
+                            of at least cutoff, each once, under the lower
+                            of the two rows: the matches of row i are the
+                            rows j > i, in increasing order, in the CSR
+                            layout of BitDB_inter_count_threshold (offsets
+                            holds BitDB_nelem(set) + 1 entries). Rows are
+                            reported by their IDs, as by the searches of a
+                            reordered container. Returns the total number
+                            of pairs.
+
+    The results are those of BitDB_similarity_threshold(set, set, ...)
+    restricted to j > i. The join pays off on sparse rows and high cutoffs;
+    at low cutoffs the prefixes cover most of every row. Only the
+    num_cpu_threads field of opts is used. It is a checked runtime error to
+    pass a NULL set or output, a Tversky metric, or a cutoff outside
+    (0, 1].
+*/
+extern size_t BitDB_similarity_join(T_DB set, Bit_similarity sim,
+                                    float cutoff, SETOP_COUNT_OPTS opts,
+                                    size_t *offsets, int **out_idx,
+                                    float **out_sim);
+
+/*
+    Row deduplication. Libraries of fingerprints hold many identical rows,
+    and every copy costs a full row of work against every query. Count
+    against the distinct rows instead and expand the results to the rows
+    they stand for: the expansion copies results and never counts.
+
+    * BitDB_dedup                  : New container of the distinct rows of
+                            set, in order of first appearance; map[i] (one
+                            entry per row of set) becomes the row of the
+                            new container equal to row i. Rows are hashed in
+                            parallel (BitDB_hash_rows, seed 0, so its cache
+                            is used) and the rows of a hash are compared
+                            word by word, so collisions never merge rows.
+    * BitDB_dedup_expand_counts    : Expands a count matrix of nunique
+                            columns into out, nrows x ncols: out[i * ncols +
+                            j] = counts[row_map[i] * nunique + col_map[j]].
+                            row_map and col_map are BitDB_dedup maps of the
+                            queries and the targets; NULL for a side that
+                            was not deduplicated. Reading
+                            counts[row_map[i] * nunique + col_map[j]]
+                            directly avoids the expanded matrix altogether.
+    * BitDB_dedup_expand_topk      : Expands the results of
+                            BitDB_inter_count_topk against the distinct rows
+                            into those of the original rows: out_idx and
+                            out_count hold nrows * k ints, with the order
+                            and ties of BitDB_inter_count_topk, as if the
+                            original containers had been searched.
+    * BitDB_dedup_expand_threshold : Same for the results of
+                            BitDB_inter_count_threshold: every match of a
+                            distinct target becomes a match of each row it
+                            stands for, in increasing row order. out_offsets
+                            holds nrows + 1 entries; *out_idx and *out_count
+                            are allocated by the library and freed by the
+                            caller. Returns the total number of matches.
+
+    nrows and ncols are the rows of the original queries and targets (the
+    lengths of row_map and col_map when they are given). It is a checked
+    runtime error to pass a NULL set, map or buffer, or an empty set.
+    opts.num_cpu_threads sets the number of threads.
+*/
+extern T_DB BitDB_dedup(T_DB set, int *map, SETOP_COUNT_OPTS opts);
+extern void BitDB_dedup_expand_counts(const int *counts, int nunique,
+                                      const int *row_map, int nrows,
+                                      const int *col_map, int ncols, int *out,
+                                      SETOP_COUNT_OPTS opts);
+extern void BitDB_dedup_expand_topk(const int *idx, const int *count, int k,
+                                    const int *row_map, int nrows,
+                                    const int *col_map, int ncols,
+                                    int *out_idx, int *out_count);
+extern size_t BitDB_dedup_expand_threshold(const size_t *offsets,
+                                           const int *idx, const int *count,
+                                           const int *row_map, int nrows,
+                                           const int *col_map, int ncols,
+                                           size_t *out_offsets, int **out_idx,
+                                           int **out_count);
+
+/*
+    BitDB_multi_count_store fills the count buffer of every op selected in
+    ops (an or of Bit_count_ops) from one pass over both containers. Only
+    the intersection is counted; union, diff and minus follow from it and
+    from the row popcounts (cached ones are used when BitDB_cache_counts is
+    on), so asking for more ops costs no further loads. Every selected
+    buffer holds BitDB_counts_size(bit, bits) ints in the layout of the
+    BitDB_SETOP_count_store_cpu functions; buffers of unselected ops are
+    ignored and may be NULL. It is a checked runtime error for ops to be 0
+    or to have bits outside BIT_COUNT_ALL, and for the buffer of a selected
+    op to be NULL. Only the num_cpu_threads field of opts is used.
+*/
+extern void BitDB_multi_count_store(T_DB bit, T_DB bits, unsigned int ops,
+                                    int *inter, int *unions, int *diff,
+                                    int *minus, SETOP_COUNT_OPTS opts);
+
+/*
+    BitDB_multi_count_store_gpu is BitDB_multi_count_store on the GPU of
+    opts.device_id, with the buffers and checks of the CPU function. With
+    the NATIVE_COARSENED algorithm and a native backend for the device, a
+    single kernel counts every selected op as it loads each pair of words;
+    otherwise the selected ops are counted one after the other by the
+    BitDB_SETOP_count_store_gpu functions, the first of which honours the
+    upd_*_operand options and the last the release_*_operand ones.
+*/
+extern void BitDB_multi_count_store_gpu(T_DB bit, T_DB bits, unsigned int ops,
+                                        int *inter, int *unions, int *diff,
+                                        int *minus, SETOP_COUNT_OPTS opts);
+
+/*
+    BitDB_query_count_store writes the op count of one bitset q against
+    every row of db to counts[0 .. BitDB_nelem(db)), op being one of the
+    Bit_count_ops (not an or of them). It is the single query form of the
+    BitDB_SETOP_count_store_cpu functions, built for streaming rather than
+    tile reuse: q stays in L1, every thread counts one contiguous range of
+    rows and prefetches ahead of it with a non-temporal hint, so the call
+    runs at memory bandwidth instead of through a one row tile. It is a
+    checked runtime error to pass a NULL q, db or counts, a q whose length
+    is not BitDB_length(db), or an op that is not a single Bit_count_ops
+    value. Only the num_cpu_threads field of opts is used.
+*/
+extern void BitDB_query_count_store(T q, T_DB db, Bit_count_ops op,
+                                    int *counts, SETOP_COUNT_OPTS opts);
+
+/*
+    Containment searches, e.g. substructure screening. Both set bit r of
+    out when row r of db passes the test, and clear it when it does not.
+    A row is read a few words at a time and dropped at the first word that
+    breaks the test, so most rows are rejected after reading a fraction of
+    their words. The rows are spread over opts.num_cpu_threads threads (all
+    available if 0). When opts.row_mask is set, only the rows it selects
+    are tested; the others are cleared.
+
+    * BitDB_superset_search : The rows that hold every bit of q
+                              (Bit_leq(q, row)). Only the non-empty words
+                              of q are read.
+    * BitDB_subset_search   : The rows whose bits are all in q
+                              (Bit_leq(row, q)).
+
+    column_counts, when not NULL, holds how many rows have each bit, as
+    written by BitDB_column_counts. The words are then read in the order
+    most likely to reject a row first. A superset test starts with the
+    words whose rarest bit of q is rarest. A subset test starts with the
+    words where the most rows hold bits outside q. With NULL, the words
+    are read in order. The counts only steer the order of the reads, so
+    stale counts do not change the result.
+
+    It is a checked runtime error to pass a NULL q, db or out, a q whose
+    length is not BitDB_length(db), or an out or row_mask whose length is
+    not BitDB_nelem(db).
+*/
+extern void BitDB_superset_search(T q, T_DB db, const uint32_t *column_counts,
+                                  T out, SETOP_COUNT_OPTS opts);
+extern void BitDB_subset_search(T q, T_DB db, const uint32_t *column_counts,
+                                T out, SETOP_COUNT_OPTS opts);
+
+/*
+    Micro-batching queues. Single queries submitted from many threads are
+    gathered into batches of up to max_batch rows, and every batch is
+    counted against db in one tiled pass, so that N queries cost one scan
+    of db rather than N. There is no service thread: the submission that
+    fills a batch counts it, and so does a waiter whose batch has been open
+    for max_wait seconds, which bounds the latency of a query at max_wait
+    plus one pass.
+
+    * BitDB_queue_new    : Creates a queue of op counts (one of the
+                           Bit_count_ops) against db. A max_batch <= 0
+                           takes the tile of the active tuning; opts are
+                           those of the counting passes. db must not change
+                           while the queue is in use.
+    * BitDB_query_submit : Copies q into the open batch and returns its
+                           ticket. Thread safe.
+    * BitDB_query_wait   : Waits for the batch of *ticket, writes the
+                           BitDB_nelem(db) counts of the query to counts
+                           and frees the ticket (*ticket becomes NULL).
+                           Thread safe.
+    * BitDB_queue_free   : Frees the queue.
+
+    It is a checked runtime error to pass a NULL db, queue, q, ticket or
+    counts, an op that is not a single Bit_count_ops value, a negative
+    max_wait, a q whose length is not BitDB_length(db), or to free a queue
+    with tickets that have not been waited for.
+*/
+extern Bit_queue_T BitDB_queue_new(T_DB db, Bit_count_ops op, int max_batch,
+                                   double max_wait, SETOP_COUNT_OPTS opts);
+extern Bit_query_T BitDB_query_submit(Bit_queue_T queue, T q);
+extern void BitDB_query_wait(Bit_query_T *ticket, int *counts);
+extern void BitDB_queue_free(Bit_queue_T *queue);
+
+/*
+    Fused count expressions over every bitset (row) of a container against a
+    fixed set of operands (see Bit_expr_count): BIT_EXPR_PUSH_ROW pushes the
+    current row, and counts[i] receives the count of the expression for row
+    i, so the buffer must hold BitDB_nelem(bits) integers. Only the
+    num_cpu_threads field of opts is used; there is no GPU variant.
+    The checked runtime errors of Bit_expr_count apply, except that the
+    program may (and normally will) use BIT_EXPR_PUSH_ROW, and the operands
+    must have the length of the container rows.
+*/
+extern void BitDB_expr_count_store_cpu(T_DB bits, const Bit_expr_op program[],
+                                       int nops, T operands[], int noperands,
+                                       int *counts, SETOP_COUNT_OPTS opts);
+extern int *BitDB_expr_count_cpu(T_DB bits, const Bit_expr_op program[],
+                                 int nops, T operands[], int noperands,
+                                 SETOP_COUNT_OPTS opts);
+
+/*
+    Run time tuning of the CPU count kernels (the BitDB_SETOP_count*_cpu
+    functions and everything built on them). Every register block of
+    Bit_tuning_block is compiled into the library for every instruction set,
+    and the cache tile sizes are plain loop bounds, so a tuning can change
+    without a rebuild. The process-wide tuning starts as Bit_tuning_defaults
+    (the CPU_TILE, BITVECTOR_TILE, OUTER_ROW_NUM and OUTER_COL_NUM of the
+    build); if the environment variable BIT_TUNING_PROFILE names a profile
+    saved by Bit_tuning_save, that profile is loaded on first use instead.
+    A single call can override it through SETOP_COUNT_OPTS.tuning.
+
+    BIT_TUNING_BLOCK_SLICED is a layout rather than a register block: every
+    tile of targets (tile rows, rounded up to a multiple of 64) is copied
+    into a bit-sliced scratch, where word k of 64 consecutive rows is stored
+    contiguously. Each query word is then broadcast against 64 targets at
+    once, with one count per SIMD lane and no horizontal reductions. It
+    pays off for short rows and many queries, where the register blocks
+    spend much of their time reducing.
+
+    BIT_TUNING_BLOCK_RECURSIVE does without cache tiles: it halves the
+    longest side of the queries x targets x words block (measured in leaves
+    of 16 rows by 128 words) until a leaf fits the L1 cache, and runs the
+    default register block over each leaf. Some level of the recursion
+    fits every cache level of the host, so tile and k_block are unused and
+    the same profile serves machines of different cache sizes. Halves of
+    the rows run as OpenMP tasks. For a token, a deadline or the hooks the
+    whole count is a single tile: it stops between leaves, and on_tile
+    runs once when it is done.
+
+    Rows of a tile are a stride apart, so the hardware prefetcher loses the
+    stream at every row and tile boundary. With a prefetch of p, the
+    register block kernels prefetch the first p cache lines of each row
+    that the next pass reads, while they count the last rows of a tile:
+    the next k_block of its rows, or after the last one the first words of
+    the rows of the next target tile. 0 turns it off; the sliced,
+    recursive and fixed-width kernels do not prefetch.
+
+    * Bit_tuning_defaults : The compiled-in tuning; its prefetch is the
+                            CPU_PREFETCH of the build.
+    * Bit_tuning_get      : The process-wide tuning.
+    * Bit_tuning_set      : Replaces the process-wide tuning. Not thread
+                            safe against count kernels running concurrently.
+    * Bit_tuning_save     : Writes a tuning profile (a small text file that
+                            also records the kernel ISA) to path. Returns 0 on
+                            success and -1 if the file could not be written.
+    * Bit_tuning_load     : Reads a profile and makes it the process-wide
+                            tuning. Returns -1, keeping the current tuning,
+                            if the file cannot be read, is malformed, or was
+                            tuned for another kernel ISA; 0 otherwise.
+    * Bit_tuning_autotune : Times every candidate block and a range of tile
+                            sizes on this host with intersection counts of
+                            two random nelem x length containers, then a
+                            range of prefetch distances for the fastest,
+                            makes the winner the process-wide tuning and
+                            returns it.
+                            If path is not NULL the winner is also saved
+                            there. opts.num_cpu_threads sets the threads of
+                            the timing runs; opts.tuning is ignored.
+
+    It is a checked runtime error to pass an invalid tuning (a block out of
+    range, a tile below 1, a k_block that is not a positive multiple of 8,
+    or a prefetch below 0 or above BIT_TUNING_MAX_PREFETCH), a NULL path
+    to Bit_tuning_save or Bit_tuning_load, or a length or nelem below 1 to
+    Bit_tuning_autotune.
+*/
+#define BIT_TUNING_MAX_PREFETCH 64
+extern Bit_tuning Bit_tuning_defaults(void);
+extern Bit_tuning Bit_tuning_get(void);
+extern void Bit_tuning_set(Bit_tuning tuning);
+extern int Bit_tuning_save(const char *path, Bit_tuning tuning);
+extern int Bit_tuning_load(const char *path);
+extern Bit_tuning Bit_tuning_autotune(int length, int nelem,
+                                      SETOP_COUNT_OPTS opts, const char *path);
+
+/*
+    Generated count kernels. At build time scripts/gen_kernels.pl writes one
+    register block kernel for every block of the make variable
+    KERNEL_BLOCKS (RxCxV: R queries by C targets per call, V vectors of
+    every row per step of the word loop), every set op and both load types,
+    with the loop over the words unrolled and one accumulator per pair.
+    Every instruction set tier compiles them with its own vector path and
+    lists them in its kernel table, so a new block is a make variable
+    rather than a new macro:
+
+        make KERNEL_BLOCKS="1x1x4 2x4x2 4x4x1 3x8x1"
+
+    The BitDB_SETOP_count functions keep picking their kernels by the
+    tuning; a generated kernel only runs when asked for by index, which is
+    how the benchmarks time each one on its own.
+
+    * Bit_kernel_variants : Copies the descriptions of the generated kernels
+                            of the active tier, at most room of them, into
+                            variants and returns how many there are;
+                            variants may be NULL with a room of 0.
+    * BitDB_count_variant : The counts of every row of bit against every
+                            row of bits by kernel variant (an index into
+                            Bit_kernel_variants), with the op of that
+                            kernel, into counts (nelem(bit) x nelem(bits),
+                            row major). The tiles, k_block and prefetch are
+                            those of the tuning of opts; the rows are read
+                            through pointers, as by BitIDB_count_store.
+
+    It is a checked runtime error to pass a negative room, NULL variants
+    with a positive room, NULL containers or counts, containers of different
+    lengths, a variant out of range, or rows that are not ALIGNMENT-aligned
+    to an aligned variant.
+*/
+extern int Bit_kernel_variants(Bit_kernel_variant variants[], int room);
+extern void BitDB_count_variant(T_DB bit, T_DB bits, int variant, int *counts,
+                                SETOP_COUNT_OPTS opts);
+
+/*
+    Kernel tier per call. A core that runs AVX-512 drops to a lower clock
+    for a while, and so do the services that share it. A long count pays
+    that back; a short one can end up slower than the AVX2 kernels, and
+    slows its neighbours for nothing. On a host whose kernel tier is
+    AVX-512 (unless BIT_FORCE_ISA in the environment picked a lower one),
+    the CPU count stores (BitDB_SETOP_count_store_cpu,
+    BitDB_count_store_typed_cpu) and the tiled counts of the search,
+    similarity and multi-count functions pick their tier per call by
+    SETOP_COUNT_OPTS.isa:
+
+    * BIT_ISA_AUTO   : AVX2 when the work of the call, queries x targets x
+                       64-bit words of a row, is below the process-wide
+                       threshold; the host's tier otherwise.
+    * BIT_ISA_WIDEST : The host's tier.
+    * BIT_ISA_NARROW : AVX2.
+
+    The threshold is 0, so that BIT_ISA_AUTO is BIT_ISA_WIDEST, until it is
+    set, calibrated, or read from the environment variable
+    BIT_ISA_THRESHOLD at load time. On other hosts every policy runs the
+    host's tier and the threshold is not used.
+
+    * Bit_isa_threshold_get : The current threshold.
+    * Bit_isa_threshold_set : Sets it; 0 turns the AVX2 tier off for
+                              BIT_ISA_AUTO.
+    * Bit_isa_calibrate     : Times intersection counts of random square
+                              containers of rows of length bits, 8 to 512
+                              rows a side, on both tiers, with calls back to
+                              back so that the clock changes are paid. The
+                              threshold becomes the least work from which
+                              AVX-512 wins at every larger size, and is
+                              returned. opts.num_cpu_threads and
+                              opts.tuning set the team and tiles of the runs.
+                              On hosts without the two tiers it sets and
+                              returns 0.
+
+    It is a checked runtime error to pass a length below 1 to
+    Bit_isa_calibrate.
+*/
+extern uint64_t Bit_isa_threshold_get(void);
+extern void Bit_isa_threshold_set(uint64_t work);
+extern uint64_t Bit_isa_calibrate(int length, SETOP_COUNT_OPTS opts);
+
+/*
+    Output stores of the count kernels. The register block kernels of the
+    CPU count stores add the counts of every k_block pass of a tile into the
+    counts matrix, which they zero first. When the matrix is much larger
+    than the last level cache, every line of it is read in, written and
+    evicted again, and pushes out the rows of the tiles being reused.
+    SETOP_COUNT_OPTS.store picks how BitDB_SETOP_count_store_cpu and
+    BitDB_SETOP_count_cpu write the counts:
+
+    * BIT_STORE_CACHED : Through the caches, as above.
+    * BIT_STORE_STREAM : A tile accumulates in a local buffer and is written
+                         once, with non-temporal stores, when it is final.
+                         The fixed-width kernels stream each count as it is
+                         computed. BitDB_SETOP_count_cpu then allocates the
+                         matrix without zeroing it, unless a token, a
+                         deadline or a hook may leave tiles unwritten.
+    * BIT_STORE_AUTO   : BIT_STORE_STREAM when the counts take more bytes
+                         than the process-wide threshold, BIT_STORE_CACHED
+                         otherwise.
+
+    The bit-sliced and recursive kernels (BIT_TUNING_BLOCK_SLICED and
+    BIT_TUNING_BLOCK_RECURSIVE) always write through the caches. Streamed counts bypass the caches, so a caller that reads
+    the matrix right away is better served by BIT_STORE_CACHED.
+
+    * Bit_store_threshold_get : The threshold in bytes. It starts as the
+                                size of the last level cache, 32 MiB if it
+                                is unknown, or as the environment variable
+                                BIT_STORE_THRESHOLD at load time.
+    * Bit_store_threshold_set : Sets it.
+*/
+extern uint64_t Bit_store_threshold_get(void);
+extern void Bit_store_threshold_set(uint64_t bytes);
+
+/*
+    Long single bitsets. One core streams a bitset at a fraction of the
+    bandwidth of the memory, so the counts, set operations and comparisons
+    of Bit_T (Bit_count, Bit_SETOP, Bit_SETOP_into, Bit_SETOP_count, Bit_eq,
+    Bit_leq, Bit_lt, Bit_intersects and their kin) split bitsets of at
+    least a threshold of bytes into contiguous, aligned word ranges, one per
+    thread of the OpenMP team (omp_get_max_threads), each at least 1 MiB.
+    The ranges are the same from call to call, so with OMP_PROC_BIND set
+    each stays with the thread, and the NUMA node, that first touched it.
+    The runtime keeps its threads between parallel regions, so a split call
+    wakes the team rather than forks it. Calls made inside a parallel region
+    stay on their thread, and the block summaries of Bit_cache_summary take
+    precedence when they pay.
+
+    * Bit_parallel_threshold_get : The threshold in bytes. It starts as
+                                   8 MiB, or as the environment variable
+                                   BIT_PARALLEL_THRESHOLD at load time.
+    * Bit_parallel_threshold_set : Sets it; UINT64_MAX keeps every call on
+                                   its thread.
+*/
+extern uint64_t Bit_parallel_threshold_get(void);
+extern void Bit_parallel_threshold_set(uint64_t bytes);
+
+/*
+    Execution contexts for repeated calls. A Bit_ctx_T fixes the CPU team
+    size, GPU device and tuning of the calls made with it, and owns the
+    scratch they would otherwise allocate on every call: the per-thread
+    tiles of the search, similarity, multi-count and self-join functions,
+    and a result buffer for the *_store functions. Pass it through
+    SETOP_COUNT_OPTS.ctx, most simply with the options of Bit_ctx_opts.
+    The CPU count kernels size their team with a num_threads clause, so no
+    call changes the caller's OpenMP settings, with or without a context.
+
+    * Bit_ctx_new    : Creates a context for num_cpu_threads threads (all
+                       available if <= 0) on GPU device_id, with a copy of
+                       tuning (the process-wide tuning if NULL). The thread
+                       team is started once here, so that the first call
+                       does not pay for it.
+    * Bit_ctx_opts   : Options for the calls made with the context.
+    * Bit_ctx_counts : A buffer of at least ncounts integers owned by the
+                       context, kept between calls; it is valid until the
+                       next call to Bit_ctx_counts or Bit_ctx_free.
+    * Bit_ctx_free   : Frees the context and its buffers.
+    * Bit_ctx_budget_set : Caps the bytes the context keeps (0, the default:
+                       no cap). A scratch slot that would take it over
+                       the cap is allocated for the call and freed after
+                       it, and Bit_ctx_counts returns NULL instead of a
+                       buffer that would, so that a service can turn the
+                       request away or count into its own buffer.
+    * Bit_ctx_bytes  : The bytes the context keeps now, scratch and
+                       counts buffer.
+
+    A context is not thread safe: use one context per calling thread. It is
+    a checked runtime error to pass an invalid tuning to Bit_ctx_new, or a
+    NULL context to the other functions.
+*/
+extern Bit_ctx_T Bit_ctx_new(int num_cpu_threads, int device_id,
+                             const Bit_tuning *tuning);
+extern SETOP_COUNT_OPTS Bit_ctx_opts(Bit_ctx_T ctx);
+extern int *Bit_ctx_counts(Bit_ctx_T ctx, size_t ncounts);
+extern void Bit_ctx_free(Bit_ctx_T *ctx);
+extern void Bit_ctx_budget_set(Bit_ctx_T ctx, size_t bytes);
+extern size_t Bit_ctx_bytes(Bit_ctx_T ctx);
+
+/*
+    Calls from a parallel region. A CPU count store called from inside the
+    caller's own OpenMP parallel region starts a nested team, which runs on
+    one thread when nested parallelism is off and oversubscribes the cores
+    when it is on. With SETOP_COUNT_OPTS.exec = BIT_EXEC_TASKS such a call
+    makes no team: the cache tiles of BitDB_SETOP_count_store_cpu (and of
+    the I32 form of BitDB_count_store_typed_cpu) become OpenMP tasks, one
+    per tile, of a taskloop on the calling thread. The threads of the
+    caller's team that are idle at a barrier or a taskwait run them, and
+    the call returns once every tile is counted. Called outside a parallel
+    region, or with BIT_EXEC_TEAM, the call makes its team as before.
+
+    A thread pool other than OpenMP is best served by one call per worker,
+    each on a container of its share of the queries, with
+    opts.num_cpu_threads = 1. Tasks take the tiles in any order, so the
+    static placement of BIT_NUMA_FIRST_TOUCH rows is not kept; the token,
+    deadline and hooks of opts work as with a team. Other functions make
+    their own team whatever exec says.
+*/
+
+/*
+    Thread affinity of the CPU count stores. OpenMP places its threads once,
+    from OMP_PLACES and OMP_PROC_BIND, for the whole process. A count store
+    can instead be kept to some of the cores, away from the latency-critical
+    threads of the application, or to one hardware thread per core, since
+    two threads of a core share its popcount ports. Set
+    SETOP_COUNT_OPTS.affinity to a Bit_affinity:
+
+    * cpus, ncpus : The logical CPUs to use, in the order the team takes
+                    them; all of them if cpus is NULL.
+    * sockets     : The packages (physical_package_id) to use, as a bit mask;
+                    all of them if 0.
+    * smt         : BIT_SMT_ONE_PER_CORE keeps the first CPU of each core of
+                    those left; BIT_SMT_ALL keeps them all.
+
+    Only CPUs the calling thread may run on are kept. For the length of the
+    call thread t of the team of BitDB_SETOP_count_store_cpu and
+    BitDB_count_store_typed_cpu runs on CPU t of the list alone, round robin
+    when there are more threads than CPUs; every thread, the calling one
+    included, gets its own affinity back before the call returns. With
+    opts.num_cpu_threads 0 the team has a thread per CPU of the list. An
+    affinity that keeps no CPU (a package the host does not have, CPUs
+    outside the allowed set) pins nothing, and the call runs on the usual
+    team. Dynamic adjustment (omp_set_dynamic) is off for the length of a
+    pinned call, so that the masks are given back by the team that was
+    pinned: OpenMP does not promise that two teams are made of the same
+    threads, and a runtime that did not reuse its pool in order could leave
+    a thread of the team on its CPU. The
+    calls with BIT_EXEC_TASKS from a parallel region make no team and
+    ignore affinity, as do the other functions. The topology is read from
+    sysfs once; CPUs without it count as cores of package 0 of their own.
+
+    * Bit_affinity_cpus : Stores the first max CPUs of the list of affinity
+                          in cpus and returns how many there are. Returns 0
+                          where threads cannot be pinned (other than Linux),
+                          and then affinity is ignored.
+
+    It is a checked runtime error to pass a NULL affinity to
+    Bit_affinity_cpus, cpus NULL with max above 0, or a negative ncpus.
+*/
+extern int Bit_affinity_cpus(const Bit_affinity *affinity, int cpus[],
+                             int max);
+
+/*
+    Cooperative cancellation of long count stores. A count of two large
+    containers can run for minutes; a caller whose request timed out can
+    stop it and take its cores back. Set SETOP_COUNT_OPTS.cancel to a token
+    that another thread cancels, and/or SETOP_COUNT_OPTS.deadline to an
+    absolute omp_get_wtime() time, e.g. omp_get_wtime() + 0.5.
+
+    The CPU count kernels (BitDB_SETOP_count_store_cpu and the I32 form of
+    BitDB_count_store_typed_cpu) look at both before each tile: once the
+    token is cancelled or the deadline passed, the threads skip the tiles
+    they have not started and the call returns after the tiles in flight.
+    The GPU count stores (BitDB_SETOP_count_store_gpu,
+    BitDB_count_store_typed_gpu) launch their kernels over blocks of
+    BIT_STOP_GPU_ROWS queries when either is set, and look before every
+    launch; a launched block runs to the end. The hybrid target counts on
+    the CPU alone when either is set; without a GPU build the GPU count
+    stores are the CPU ones. Other functions ignore both.
+
+    If opts.progress is not NULL the call stores how far it got there: the
+    counts of the first queries_done rows of bit are complete, so the call
+    can be resumed on the rest. The other counts are unspecified when
+    stopped is true. Without a token or a deadline nothing is looked at, and
+    progress reports every query done.
+
+    * Bit_cancel_new       : A token that is not cancelled.
+    * Bit_cancel_request   : Cancels the token; safe from any thread or
+                             while calls that use it run.
+    * Bit_cancel_requested : Whether the token is cancelled.
+    * Bit_cancel_reset     : Makes the token usable again.
+    * Bit_cancel_free      : Frees the token; no call may still use it.
+
+    The same count stores call two hooks of opts, if set, with opts.hook_cl
+    as cl, so that a consumer (a top-k, a writer) can start on the counts
+    that are done while the rest are counted:
+
+    * on_tile     : The counts of queries [first_query, first_query +
+                    nquery) against targets [first_target, first_target +
+                    ntarget) are final in counts.
+    * on_progress : tiles_done of the tiles_total tiles of the call are
+                    counted, having read bytes_scanned bytes of rows.
+
+    On the CPU both run on the counting threads, at once, after each cache
+    tile, so they must be thread safe and quick; calls to on_progress may
+    arrive out of order, each with the totals as of its own tile. On the
+    GPU a tile is a launch of BIT_STOP_GPU_ROWS queries against every
+    target, copied back to counts before the hooks run on the calling
+    thread. Tiles skipped after a stop are not reported. Hooks, like a
+    token, make the hybrid target count on the CPU alone.
+
+    It is a checked runtime error to pass a NULL token.
+*/
+#define BIT_STOP_GPU_ROWS 1024
+extern Bit_cancel_T Bit_cancel_new(void);
+extern void Bit_cancel_request(Bit_cancel_T token);
+extern bool Bit_cancel_requested(Bit_cancel_T token);
+extern void Bit_cancel_reset(Bit_cancel_T token);
+extern void Bit_cancel_free(Bit_cancel_T *token);
+
+/*
+    Hot-path profile. A library built with PROFILE=1 (-DBIT_PROFILE=1)
+    counts, for every public function on the hot path (the single bitset
+    counts and set operations, the member array operations, and the CPU
+    and GPU container counts, searches and similarities), its calls, the
+    ticks spent in them and the bytes of the operands it reads and the
+    results it writes. The count kernels also count whether they took the
+    aligned or the unaligned load path and which register block ran. The
+    counters are relaxed atomics shared by all threads; ticks come from the
+    time stamp counter on x86 and from CLOCK_MONOTONIC elsewhere, and
+    include the time of the profiled functions a function calls. In the
+    default build the instrumentation compiles to nothing.
+
+    * Bit_stats_snapshot : The counters, with the functions called since the
+                           last reset sorted by name (at most
+                           BIT_STATS_CALLS of them). enabled is false and
+                           every counter zero without PROFILE=1; isa and
+                           simd are always set.
+    * Bit_stats_reset    : Zeroes the counters.
+*/
+extern Bit_stats Bit_stats_snapshot(void);
+extern void Bit_stats_reset(void);
+
+/*
+    Workload capture. While a capture runs, every container count store and
+    search of the list of Bit_capture_call, on the CPU or a GPU and from any
+    thread, appends one Bit_capture_record to a file: the call, the shapes
+    of its containers, the fields of opts that pick its kernels, its start
+    and its time. A call made from inside a recorded call is not recorded.
+    bench_replay plays a capture back with the same threads, on synthetic
+    or snapshot rows of the same shapes, so that tuning and kernels can be
+    compared on the traffic of a real process. Outside a capture a call
+    pays one relaxed atomic load. Setting BIT_CAPTURE_FILE starts a capture
+    to that file at the first such call of the process, which ends at exit
+    (BIT_CAPTURE_DATA=1 adds the flag).
+
+    * Bit_capture_start : Starts a capture to path (truncated), flags 0 or
+                          BIT_CAPTURE_DATA, which hashes and popcounts the
+                          rows of both containers of every call, a pass
+                          over them outside the recorded time. Returns false
+                          if the file cannot be created.
+    * Bit_capture_stop  : Ends the capture and closes the file. Returns the
+                          records written, or -1 if a write failed.
+    * Bit_capture_load  : The records of the capture file at path, in the
+                          order the calls returned, as an array to free(),
+                          with their number in *n and the flags of the
+                          capture in *flags (may be NULL); NULL if the file
+                          cannot be read or is not a capture.
+
+    It is a checked runtime error to start a capture while one runs, to
+    stop one that does not, or to pass a NULL path or n.
+*/
+extern bool Bit_capture_start(const char *path, unsigned int flags);
+extern int64_t Bit_capture_stop(void);
+extern Bit_capture_record *Bit_capture_load(const char *path, size_t *n,
+                                            unsigned int *flags);
+
+/*
+    Memory accounting. The library keeps a count of the bytes it holds, by
+    Bit_mem_category, for capacity planning and admission control. Host
+    storage is counted where it is allocated and freed, with relaxed
+    atomics and a high-water mark per category: bitsets and pools,
+    container rows (as their capacity, including growth), mapped files
+    and snapshots, context buffers and the buffers of Bit_pinned_alloc and
+    Bit_huge_alloc. Buffers the caller allocates and hands to the library
+    (BitDB_load, Bit_load, counts matrices) and the short-lived scratch of
+    a single call are not counted, nor are the buffers returned to be
+    free()d (threshold search results). On a GPU, every buffer mapped by
+    enter data is counted while it stays mapped, whether or not a budget is
+    set (Bit_gpu_budget_set), and so is the scratch of layout transitions.
+
+    * Bit_memory_stats       : Fills stats with the bytes held now and the
+                               high-water marks since the start of the
+                               process or the last Bit_memory_reset_peaks.
+                               The device categories are summed over the
+                               first ndevices devices, which are also
+                               reported one by one. The categories are read
+                               one after the other, not as one snapshot.
+    * Bit_memory_reset_peaks : Lowers every high-water mark to the bytes
+                               held now.
+
+    Without a GPU the device fields are zero. It is a checked runtime error
+    to pass a NULL stats.
+*/
+extern void Bit_memory_stats(Bit_mem_stats *stats);
+extern void Bit_memory_reset_peaks(void);
+
+/*
+    Configuration of the library in this process, for callers that pick a
+    code path by what the build and the host support (print_Bit_configuration
+    prints the same to stdout).
+
+    * Bit_get_configuration : Fills config. popcount names the bulk popcount
+                              of the CPU kernels: libpopcnt's choice on this
+                              host ("libpopcnt-avx512", "libpopcnt-avx2",
+                              "libpopcnt-popcnt", "libpopcnt-neon",
+                              "libpopcnt-sve" or "libpopcnt-bitwise"), or
+                              "wwg" in a LIBPOPCNT=0 build. gpu_archs lists
+                              the GPU_ARCH targets of the build ("" for
+                              none, or when the compiler picks the default),
+                              and gpu_algorithms has bit 1u << a set for
+                              each SETOP_COUNT_OPTS algorithm a that runs as
+                              such; the others fall back as documented
+                              above. Without offload, gpu is false and
+                              gpu_algorithms 0. Querying the native backend
+                              loads it, as the first NATIVE_COARSENED count
+                              would.
+
+    It is a checked runtime error to pass a NULL config.
+*/
+extern void Bit_get_configuration(Bit_config *config);
+
+/*
+    Compressed bitsets. A Bit_C_T holds the bits of a Bit_T of the same
+    length, split into chunks of 65536 bits that each live in the smallest
+    of three containers, as in Roaring bitmaps: a sorted array of the
+    offsets of at most 4096 set bits, a bitmap of 1024 qwords, or sorted
+    runs of consecutive set bits. Empty chunks take no space, so sets with
+    few or clustered set bits cost in proportion to those rather than to
+    their length, and can be mixed with dense Bit_T operands without a
+    conversion. Bitmap containers and the chunks of Bit_T operands go
+    through the same SIMD set operation and popcount kernels as Bit_T;
+    array containers intersect through a SIMD kernel of their own.
+
+    * Bit_C_new          : An empty compressed bitset of length bits.
+    * Bit_C_free         : Frees the set and zeroes the pointer.
+    * Bit_C_from_bit     : Compressed copy of a Bit_T, in the smallest
+                           containers.
+    * Bit_C_to_bit       : Bit_T copy of a compressed bitset.
+    * Bit_C_length       : Length in bits.
+    * Bit_C_count        : Set bits; O(chunks).
+    * Bit_C_size_in_bytes: Bytes of the set and its containers.
+    * Bit_C_optimize     : Moves every chunk to its smallest container,
+                           runs included. Member operations keep arrays and
+                           bitmaps by their count of set bits only, so
+                           call it after building a set bit by bit.
+    * Bit_C_get, Bit_C_put, Bit_C_bset, Bit_C_bclear, Bit_C_aset,
+      Bit_C_set, Bit_C_clear, Bit_C_next_set, Bit_C_eq
+                         : As their Bit_T namesakes. Bit_C_set stores the
+                           chunks a range covers as runs.
+    * Bit_C_diff, Bit_C_inter, Bit_C_minus, Bit_C_union
+                         : New compressed set of s XOR t, s AND t,
+                           s AND NOT t and s OR t.
+    * Bit_C_*_count      : Set bits of the same, without forming it.
+    * Bit_C_*_bit, Bit_C_*_count_bit
+                         : The same against a Bit_T t. The intersection,
+                           s AND NOT t and the intersection count only read
+                           the chunks of t where s has set bits; the others
+                           read all of t, as the result depends on it.
+
+    It is a checked runtime error to pass a NULL set or bitset, a length
+    outside (0, INT_MAX), indices or ranges outside [0, length), or operands
+    of different lengths. A Bit_C_T is not thread safe for writes.
+*/
+extern T_C Bit_C_new(int length);
+extern void Bit_C_free(T_C *set);
+extern T_C Bit_C_from_bit(T set);
+extern T Bit_C_to_bit(T_C set);
+extern int Bit_C_length(T_C set);
+extern int Bit_C_count(T_C set);
+extern size_t Bit_C_size_in_bytes(T_C set);
+extern void Bit_C_optimize(T_C set);
+
+extern int Bit_C_get(T_C set, int index);
+extern int Bit_C_put(T_C set, int n, int val);
+extern void Bit_C_bset(T_C set, int index);
+extern void Bit_C_bclear(T_C set, int index);
+extern void Bit_C_aset(T_C set, int indices[], int n);
+extern void Bit_C_set(T_C set, int lo, int hi);
+extern void Bit_C_clear(T_C set, int lo, int hi);
+extern int Bit_C_next_set(T_C set, int from);
+extern int Bit_C_eq(T_C s, T_C t);
+
+extern T_C Bit_C_diff(T_C s, T_C t);  // s XOR t
+extern T_C Bit_C_inter(T_C s, T_C t); // s AND t
+extern T_C Bit_C_minus(T_C s, T_C t); // s AND NOT t
+extern T_C Bit_C_union(T_C s, T_C t); // s OR t
+extern int Bit_C_diff_count(T_C s, T_C t);
+extern int Bit_C_inter_count(T_C s, T_C t);
+extern int Bit_C_minus_count(T_C s, T_C t);
+extern int Bit_C_union_count(T_C s, T_C t);
+
+extern T_C Bit_C_diff_bit(T_C s, T t);
+extern T_C Bit_C_inter_bit(T_C s, T t);
+extern T_C Bit_C_minus_bit(T_C s, T t);
+extern T_C Bit_C_union_bit(T_C s, T t);
+extern int Bit_C_diff_count_bit(T_C s, T t);
+extern int Bit_C_inter_count_bit(T_C s, T t);
+extern int Bit_C_minus_count_bit(T_C s, T t);
+extern int Bit_C_union_count_bit(T_C s, T t);
+
+/*
+    Packed containers with sparse rows. A Bit_SDB_T holds the rows of a
+    Bit_DB_T, each one either as the sorted list of its set bits (a sparse
+    row) or packed with the other dense rows. A row is sparse when it has at
+    most threshold set bits; a negative threshold keeps every row in the
+    smaller of the two forms (below length / 32 set bits). A count of a
+    sparse row against a dense one reads only the words at its positions,
+    with gathers where the kernels have them, so rows of a few set bits in
+    wide containers cost in proportion to those bits both in memory and in
+    count time. Dense rows go through the count kernels of Bit_DB_T.
+
+    * BitSDB_new               : A sparse-row copy of the rows of db.
+    * BitSDB_free              : Frees the container and zeroes the pointer.
+    * BitSDB_nelem             : Rows.
+    * BitSDB_length            : Length in bits of every row.
+    * BitSDB_nsparse           : Rows stored as position lists.
+    * BitSDB_count_at          : Set bits of a row.
+    * BitSDB_is_sparse_at      : Whether a row is stored as a position list.
+    * BitSDB_size_in_bytes     : Bytes of the container and its rows.
+    * BitSDB_get_from          : A new Bit_T copy of a row.
+    * BitSDB_count_store       : The op counts (one Bit_count_ops value) of
+                                 every row of bit against every row of bits,
+                                 laid out as by BitDB_counts_offset.
+    * BitSDB_query_count_store : The op counts of q against every row of db,
+                                 as BitDB_query_count_store.
+
+    It is a checked runtime error to pass a NULL container, bitset or counts
+    buffer, a row index outside [0, nelem), operands of different lengths, or
+    an op that is not a single Bit_count_ops value. Only the num_cpu_threads
+    field of opts is used by the sparse rows.
+*/
+extern T_SDB BitSDB_new(T_DB db, int threshold);
+extern void BitSDB_free(T_SDB *set);
+extern int BitSDB_nelem(T_SDB set);
+extern int BitSDB_length(T_SDB set);
+extern int BitSDB_nsparse(T_SDB set);
+extern int BitSDB_count_at(T_SDB set, int index);
+extern bool BitSDB_is_sparse_at(T_SDB set, int index);
+extern size_t BitSDB_size_in_bytes(T_SDB set);
+extern T BitSDB_get_from(T_SDB set, int index);
+extern void BitSDB_count_store(T_SDB bit, T_DB bits, Bit_count_ops op,
+                               int *counts, SETOP_COUNT_OPTS opts);
+extern void BitSDB_query_count_store(T q, T_SDB db, Bit_count_ops op,
+                                     int *counts, SETOP_COUNT_OPTS opts);
+
+/*
+    Packed containers of rows of different lengths. Every row of a Bit_DB_T
+    has the length of the container, so sets that range from a hundred to a
+    million bits are either padded to the longest or kept as separate
+    Bit_T. A Bit_RDB_T lays rows of any lengths end to end, each starting on
+    an ALIGNMENT boundary and padded with zeros to the next one, and finds
+    them through an array of offsets. A count of two rows reads the words
+    they have in common: the bits past the end of the shorter row count as
+    zero. The queries are counted longest first, in blocks of queries and
+    targets that the threads take one at a time, so rows of very different
+    lengths still keep every thread busy.
+
+    * BitRDB_new               : A container of n rows of the given lengths,
+                                 all clear.
+    * BitRDB_from_bitsets      : A container of copies of n bitsets, each of
+                                 its own length.
+    * BitRDB_free              : Frees the container and zeroes the pointer.
+    * BitRDB_nelem             : Rows.
+    * BitRDB_length_at         : Length in bits of a row.
+    * BitRDB_count_at          : Set bits of a row.
+    * BitRDB_size_in_bytes     : Bytes of the container and its rows.
+    * BitRDB_replace_at        : Copies a bitset of the length of a row into
+                                 the row.
+    * BitRDB_get_from          : A new Bit_T copy of a row.
+    * BitRDB_count_store       : The op counts (one Bit_count_ops value) of
+                                 every row of bit against every row of bits,
+                                 laid out as by BitDB_counts_offset.
+    * BitRDB_query_count_store : The op counts of q, of any length, against
+                                 every row of db, as BitDB_query_count_store.
+
+    It is a checked runtime error to pass a NULL container, bitset, lengths
+    or counts buffer, a length less than 1, a row index outside [0, nelem),
+    a bitset of another length than the row it replaces, or an op that is
+    not a single Bit_count_ops value. Only the num_cpu_threads field of opts
+    is used. BitRDB_replace_at may run on different rows at once.
+*/
+extern T_RDB BitRDB_new(const int lengths[], int n);
+extern T_RDB BitRDB_from_bitsets(T rows[], int n);
+extern void BitRDB_free(T_RDB *set);
+extern int BitRDB_nelem(T_RDB set);
+extern int BitRDB_length_at(T_RDB set, int index);
+extern int BitRDB_count_at(T_RDB set, int index);
+extern size_t BitRDB_size_in_bytes(T_RDB set);
+extern void BitRDB_replace_at(T_RDB set, int index, T bit);
+extern T BitRDB_get_from(T_RDB set, int index);
+extern void BitRDB_count_store(T_RDB bit, T_RDB bits, Bit_count_ops op,
+                               int *counts, SETOP_COUNT_OPTS opts);
+extern void BitRDB_query_count_store(T q, T_RDB db, Bit_count_ops op,
+                                     int *counts, SETOP_COUNT_OPTS opts);
+
+/*
+    Indirect containers of Bit_T rows. Callers that hold their sets as an
+    array of Bit_T must copy them into a Bit_DB_T before the tiled count
+    kernels can reuse rows in cache. A Bit_IDB_T keeps pointers to the
+    bitsets instead, without copying them, and BitIDB_count_store runs the
+    tiles, k_block and register block of the current tuning over them: a
+    tile is a slice of the pointer arrays, and the register block reads
+    its rows through the pointers. As no hardware prefetcher follows rows
+    scattered over the heap, each pass prefetches the first lines (the
+    prefetch of the tuning) of what the next pass reads: the next k_block
+    of the tile's rows, or the start of the rows of the next target tile.
+
+    * BitIDB_from_bitsets : A container of n bitsets of the same length,
+                            which stay the caller's: the container must be
+                            freed before they are, and sees their bits as
+                            they are at the time of a count.
+    * BitIDB_free         : Frees the container (not the bitsets) and
+                            zeroes the pointer.
+    * BitIDB_nelem        : Rows.
+    * BitIDB_length       : Length in bits of the rows.
+    * BitIDB_get_at       : The bitset of a row (not a copy).
+    * BitIDB_replace_at   : Points a row at another bitset of the length of
+                            the container.
+    * BitIDB_count_store  : The op counts (one Bit_count_ops value) of every
+                            row of bit against every row of bits, laid out
+                            as by BitDB_counts_offset.
+
+    It is a checked runtime error to pass a NULL container, bitset or counts
+    buffer, an n below 1, bitsets of different lengths, a row index outside
+    [0, nelem), or an op that is not a single Bit_count_ops value. Only the
+    num_cpu_threads and tuning fields of opts are used.
+*/
+extern T_IDB BitIDB_from_bitsets(T rows[], int n);
+extern void BitIDB_free(T_IDB *set);
+extern int BitIDB_nelem(T_IDB set);
+extern int BitIDB_length(T_IDB set);
+extern T BitIDB_get_at(T_IDB set, int index);
+extern void BitIDB_replace_at(T_IDB set, int index, T bit);
+extern void BitIDB_count_store(T_IDB bit, T_IDB bits, Bit_count_ops op,
+                               int *counts, SETOP_COUNT_OPTS opts);
+
+/*
+    Packed containers of short rows. Every row of a Bit_DB_T takes a whole,
+    aligned stride, so rows of a few bits (16-bit signatures, hashes, small
+    feature masks) spend most of their memory and bandwidth on padding. A
+    Bit_PDB_T holds rows of at most BIT_PDB_MAX_LENGTH bits in lanes of 8,
+    16 or 32 bits, the narrowest that holds the length, so a 64-bit word
+    carries 8, 4 or 2 rows. Counts repeat a query row in every lane of a
+    word and count a word of targets at a time, all of its lanes at once.
+    Rows that share a word are not safe to change from different threads.
+
+    * BitPDB_new           : A container of nelem empty rows of length bits.
+    * BitPDB_from_db       : A packed copy of the rows of db.
+    * BitPDB_free          : Frees the container and zeroes the pointer.
+    * BitPDB_nelem         : Rows.
+    * BitPDB_length        : Length in bits of every row.
+    * BitPDB_lane_bits     : Bits of the lane of a row: 8, 16 or 32.
+    * BitPDB_size_in_bytes : Bytes of the container and its rows.
+    * BitPDB_get_word      : A row as an integer, bit b of the row in bit b.
+    * BitPDB_put_word      : Sets a row from such an integer.
+    * BitPDB_get_from      : A new Bit_T copy of a row.
+    * BitPDB_put_at        : Sets a row from a Bit_T.
+    * BitPDB_count_store   : The op counts (one Bit_count_ops value) of every
+                             row of bit against every row of bits, laid out
+                             as by BitDB_counts_offset. Only the
+                             num_cpu_threads field of opts is used.
+
+    It is a checked runtime error to pass a length outside
+    [1, BIT_PDB_MAX_LENGTH] or a negative nelem to BitPDB_new, a container
+    of longer rows to BitPDB_from_db, a NULL container, bitset or counts
+    buffer, a row index outside [0, nelem), a word with bits at or past the
+    length, operands of different lengths, or an op that is not a single
+    Bit_count_ops value.
+*/
+#define BIT_PDB_MAX_LENGTH 32
+extern T_PDB BitPDB_new(int length, int nelem);
+extern T_PDB BitPDB_from_db(T_DB db);
+extern void BitPDB_free(T_PDB *set);
+extern int BitPDB_nelem(T_PDB set);
+extern int BitPDB_length(T_PDB set);
+extern int BitPDB_lane_bits(T_PDB set);
+extern size_t BitPDB_size_in_bytes(T_PDB set);
+extern uint32_t BitPDB_get_word(T_PDB set, int index);
+extern void BitPDB_put_word(T_PDB set, int index, uint32_t bits);
+extern T BitPDB_get_from(T_PDB set, int index);
+extern void BitPDB_put_at(T_PDB set, int index, T bitset);
+extern void BitPDB_count_store(T_PDB bit, T_PDB bits, Bit_count_ops op,
+                               int *counts, SETOP_COUNT_OPTS opts);
+
+/*
+    Weighted counts. With a weight w_b for every bit position b (say, the
+    inverse frequency of a feature), the weighted count of a set is the sum
+    of w_b over its set bits, and the weighted Jaccard of A and B is the
+    weighted count of A & B over that of A | B. A Bit_W_T holds the weights
+    of one length as nibble tables, the 16 partial sums of every 4 positions,
+    so that a 64-bit word of a row is summed with 16 lookups. Rows are read
+    as packed bits instead of being expanded to floats. Sums are floats, in
+    the order of the words, so they may differ from a sum in another order
+    in the last bits.
+
+    * Bit_W_new           : Weights of the length bit positions of a bitset,
+                            copied from weights[0 .. length - 1].
+    * Bit_W_free          : Frees the weights and zeroes the pointer.
+    * Bit_W_length        : Positions weighted.
+    * Bit_W_count         : The weighted count of s.
+    * Bit_W_setop_count   : The weighted count of op(s, t), for one
+                            Bit_count_ops value.
+    * BitDB_W_count_store : The weighted counts of op of every row of bit
+                            with every row of bits, into sums laid out as
+                            by BitDB_counts_offset. Only the num_cpu_threads
+                            field of opts is used.
+
+    It is a checked runtime error to pass NULL weights, a length less than
+    1, a NULL set, container or sums buffer, bitsets or containers of a
+    length other than that of the weights, or an op that is not a single
+    Bit_count_ops value.
+*/
+extern T_W Bit_W_new(const float *weights, int length);
+extern void Bit_W_free(T_W *w);
+extern int Bit_W_length(T_W w);
+extern float Bit_W_count(T_W w, T s);
+extern float Bit_W_setop_count(T_W w, T s, T t, Bit_count_ops op);
+extern void BitDB_W_count_store(T_W w, T_DB bit, T_DB bits, Bit_count_ops op,
+                                float *sums, SETOP_COUNT_OPTS opts);
+
+/*
+    SETOP counts as int8 matrix products, for accelerators that multiply
+    int8 matrices fast but lack a fast popcount (TPUs, NPUs, AMX through
+    oneDNN). Over {0,1} entries an intersection count is a dot product, so
+    the counts of a block of queries against a block of targets are the
+    product of the unpacked blocks. The library unpacks the rows one byte
+    per bit, 256 queries by 1024 targets by 4096 bits at a time
+    (BIT_GEMM_BLOCK_QUERIES, BIT_GEMM_BLOCK_TARGETS, BIT_GEMM_BLOCK_BITS at
+    build time), and leaves the product to a GEMM the caller registers.
+    Union, symmetric difference and difference counts follow from the
+    intersection and the row popcounts.
+
+    * Bit_gemm_backend_set   : Registers backend (copied), or none if NULL.
+                               Not to be called while a count runs.
+    * Bit_gemm_backend_name  : The name of the registered backend, or NULL.
+    * BitDB_count_store_gemm : The counts of op of every row of bit with
+                               every row of bits into counts, laid out as by
+                               BitDB_counts_offset, through the backend.
+                               Returns true if the backend computed them;
+                               without a backend, or if its GEMM returns
+                               non-zero, the popcount kernels of
+                               BitDB_SETOP_count_store_cpu compute them and
+                               it returns false.
+
+    The backend is called from the calling thread, one product at a time;
+    opts.num_cpu_threads threads unpack the rows. It is a checked runtime
+    error to register a backend with a NULL gemm, or to pass NULL
+    containers or counts, containers of different lengths, or an op that
+    is not a single Bit_count_ops value.
+*/
+extern void Bit_gemm_backend_set(const Bit_gemm_backend *backend);
+extern const char *Bit_gemm_backend_name(void);
+extern bool BitDB_count_store_gemm(T_DB bit, T_DB bits, Bit_count_ops op,
+                                   int *counts, SETOP_COUNT_OPTS opts);
+
+/*
+    Bitsets of 64-bit length. A Bit_L_T is a Bit_T whose length and indices
+    are int64_t, for sets past the INT_MAX bits of a Bit_T (a genome-wide
+    mask of 10 Gbit is 1.25 GB). The storage has the layout of a Bit_T
+    (aligned qwords, the bits past the length zero), so Bit_L_load and
+    Bit_L_extract exchange it with Bit_T sized buffers of Bit_L_buffer_size
+    bytes. The whole-set operations (count, comparisons, set operations and
+    their counts, ranges, and the clearing of new sets) run the Bit_T SIMD
+    kernels on blocks of 8 MiB, spread over the OpenMP threads once a set
+    reaches 16 MiB; BIT_L_BLOCK_QWORDS and BIT_L_PARALLEL_QWORDS set the two
+    at build time.
+
+    * Bit_L_new, Bit_L_free, Bit_L_load, Bit_L_extract, Bit_L_buffer_size,
+      Bit_L_length, Bit_L_count
+                         : As their Bit_T namesakes.
+    * Bit_L_get, Bit_L_put, Bit_L_bset, Bit_L_bclear, Bit_L_aset,
+      Bit_L_aclear, Bit_L_set, Bit_L_clear, Bit_L_not, Bit_L_next_set,
+      Bit_L_prev_set     : As their Bit_T namesakes; ranges are [lo, hi].
+    * Bit_L_eq, Bit_L_leq, Bit_L_lt
+                         : As their Bit_T namesakes.
+    * Bit_L_diff, Bit_L_inter, Bit_L_minus, Bit_L_union, and their _count
+      forms              : As their Bit_T namesakes, the counts in int64_t.
+
+    It is a checked runtime error to pass a NULL set or buffer, a
+    non-positive length, indices or ranges outside [0, length), or operands
+    of different lengths. Member operations are not thread safe, as for
+    Bit_T.
+*/
+extern T_L Bit_L_new(int64_t length);
+extern void *Bit_L_free(T_L *set);
+extern T_L Bit_L_load(int64_t length, void *buffer);
+extern size_t Bit_L_extract(T_L set, void *buffer);
+extern size_t Bit_L_buffer_size(int64_t length);
+extern int64_t Bit_L_length(T_L set);
+extern int64_t Bit_L_count(T_L set);
+
+extern int Bit_L_get(T_L set, int64_t index);
+extern int Bit_L_put(T_L set, int64_t index, int val);
+extern void Bit_L_bset(T_L set, int64_t index);
+extern void Bit_L_bclear(T_L set, int64_t index);
+extern void Bit_L_aset(T_L set, const int64_t indices[], size_t n);
+extern void Bit_L_aclear(T_L set, const int64_t indices[], size_t n);
+extern void Bit_L_set(T_L set, int64_t lo, int64_t hi);
+extern void Bit_L_clear(T_L set, int64_t lo, int64_t hi);
+extern void Bit_L_not(T_L set, int64_t lo, int64_t hi);
+extern int64_t Bit_L_next_set(T_L set, int64_t from);
+extern int64_t Bit_L_prev_set(T_L set, int64_t from);
+
+extern int Bit_L_eq(T_L s, T_L t);
+extern int Bit_L_leq(T_L s, T_L t);
+extern int Bit_L_lt(T_L s, T_L t);
+
+extern T_L Bit_L_diff(T_L s, T_L t);  // s XOR t
+extern T_L Bit_L_inter(T_L s, T_L t); // s AND t
+extern T_L Bit_L_minus(T_L s, T_L t); // s AND NOT t
+extern T_L Bit_L_union(T_L s, T_L t); // s OR t
+extern int64_t Bit_L_diff_count(T_L s, T_L t);
+extern int64_t Bit_L_inter_count(T_L s, T_L t);
+extern int64_t Bit_L_minus_count(T_L s, T_L t);
+extern int64_t Bit_L_union_count(T_L s, T_L t);
+
+/*
+    Device-resident Bit_L_T sets. A whole-set operation on a 10-Gbit mask
+    reads gigabytes at host memory bandwidth; an attached set keeps a copy
+    of its bits on a device, and the _gpu functions run on the copies of
+    attached sets only, so a chain of them stays on the device and only
+    counts and comparison results cross the bus. The host bits and the
+    device copy are brought together explicitly: a set written on the host
+    is pushed before the _gpu functions read it, and one written by them is
+    pulled before the host reads it. A Bit_T joins through Bit_L_load over
+    its qwords (Bit_extract or the buffer it was loaded from).
+
+    * Bit_L_device_attach : Copies the bits to device_id. The copy counts
+                            against the budget of the device
+                            (Bit_gpu_budget_set), and is pinned until the
+                            detach, so an eviction never drops it.
+    * Bit_L_device_push   : Copies the host bits to the device copy.
+    * Bit_L_device_pull   : Copies the device copy to the host bits.
+    * Bit_L_device_detach : Drops the device copy without pulling it.
+                            Bit_L_free detaches an attached set.
+    * Bit_L_device        : Device of an attached set, -1 if not attached.
+    * Bit_L_diff_into_gpu, Bit_L_inter_into_gpu, Bit_L_minus_into_gpu,
+      Bit_L_union_into_gpu : dst = s op t on the device; dst may be s or t.
+    * Bit_L_count_gpu, and Bit_L_diff_count_gpu, Bit_L_inter_count_gpu,
+      Bit_L_minus_count_gpu, Bit_L_union_count_gpu
+                          : As their Bit_L_T namesakes, on the device.
+    * Bit_L_set_gpu, Bit_L_clear_gpu, Bit_L_not_gpu
+                          : Ranges [lo, hi] written on the device.
+    * Bit_L_eq_gpu, Bit_L_leq_gpu
+                          : As their Bit_L_T namesakes; the words are or-ed
+                            on the device, never counted.
+
+    Copies and kernels show in the GPU telemetry (Bit_gpu_stats_get).
+    Without a GPU (NOGPU builds) the device copy is the host bits: push and
+    pull do nothing, and the _gpu functions run the Bit_L_T kernels.
+    It is a checked runtime error to pass a NULL set, to attach an attached
+    set or to a negative device, to push, pull, detach or run a _gpu
+    function on a set that is not attached, to pass operands attached to
+    different devices or of different lengths, or ranges outside
+    [0, length).
+*/
+extern void Bit_L_device_attach(T_L set, int device_id);
+extern void Bit_L_device_push(T_L set);
+extern void Bit_L_device_pull(T_L set);
+extern void Bit_L_device_detach(T_L set);
+extern int Bit_L_device(T_L set);
+extern void Bit_L_diff_into_gpu(T_L dst, T_L s, T_L t);
+extern void Bit_L_inter_into_gpu(T_L dst, T_L s, T_L t);
+extern void Bit_L_minus_into_gpu(T_L dst, T_L s, T_L t);
+extern void Bit_L_union_into_gpu(T_L dst, T_L s, T_L t);
+extern int64_t Bit_L_count_gpu(T_L set);
+extern int64_t Bit_L_diff_count_gpu(T_L s, T_L t);
+extern int64_t Bit_L_inter_count_gpu(T_L s, T_L t);
+extern int64_t Bit_L_minus_count_gpu(T_L s, T_L t);
+extern int64_t Bit_L_union_count_gpu(T_L s, T_L t);
+extern void Bit_L_set_gpu(T_L set, int64_t lo, int64_t hi);
+extern void Bit_L_clear_gpu(T_L set, int64_t lo, int64_t hi);
+extern void Bit_L_not_gpu(T_L set, int64_t lo, int64_t hi);
+extern int Bit_L_eq_gpu(T_L s, T_L t);
+extern int Bit_L_leq_gpu(T_L s, T_L t);
+
+/*
+    Blocked Bloom filters. A Bit_BF_T keeps its bits in a Bit_T of 512-bit
+    blocks, and every key sets k of the 512 bits of a single block that its
+    hash selects (one bit in each of k of the block's 32-bit lanes). A probe
+    then misses the cache at most once, where a Bloom filter spread over the
+    whole set misses k times. The k bits of a key are generated together in
+    vector registers on the AVX2 and AVX-512 kernels. The batched forms hash
+    and prefetch the blocks of 16 keys before probing them, so the cache
+    misses of a batch overlap. Keys are 64-bit; hash other keys to 64 bits
+    first.
+
+    * Bit_BF_new         : A filter of length bits (rounded up to a multiple
+                           of 512) setting k bits per key, 1 <= k <= 16.
+    * Bit_BF_wrap        : A filter over the bits of an existing Bit_T, whose
+                           length must be a multiple of 512. The caller keeps
+                           the Bit_T, e.g. a BitDB_view_at row of a container
+                           saved with BitDB_save and mapped back with
+                           BitDB_open_mmap, which is how filters persist.
+    * Bit_BF_free        : Frees the filter, and its bits if Bit_BF_new
+                           allocated them.
+    * Bit_BF_bits        : The Bit_T of the filter (Bit_count, Bit_extract,
+                           BitDB_put_at and the set operations apply; the
+                           union of two filters with the same length and k
+                           holds the keys of both).
+    * Bit_BF_k           : Bits set per key.
+    * Bit_BF_insert, Bit_BF_insert_many
+                         : Adds one or n keys.
+    * Bit_BF_contains, Bit_BF_contains_many
+                         : 1 if a key may have been inserted and 0 if it
+                           certainly was not. The batched form stores that
+                           in out[i] for keys[i] (out may be NULL) and
+                           returns the number of keys that may be present.
+
+    The same key maps to the same bits in every filter with the same length
+    and k, on every ISA variant of a little-endian host. It is a checked
+    runtime error to pass a NULL filter or Bit_T, a k outside [1, 16], a
+    negative n, or a NULL keys array with n > 0. Inserts are not thread
+    safe; probes are, while no insert runs.
+*/
+extern T_BF Bit_BF_new(int length, int k);
+extern T_BF Bit_BF_wrap(T bits, int k);
+extern void Bit_BF_free(T_BF *filter);
+extern T Bit_BF_bits(T_BF filter);
+extern int Bit_BF_k(T_BF filter);
+extern void Bit_BF_insert(T_BF filter, uint64_t key);
+extern int Bit_BF_contains(T_BF filter, uint64_t key);
+extern void Bit_BF_insert_many(T_BF filter, const uint64_t keys[], int n);
+extern int Bit_BF_contains_many(T_BF filter, const uint64_t keys[], int n,
+                                int out[]);
+
+/*
+    Bit matrices. A Bit_DB_T of n rows of length m is an n x m matrix over
+    the booleans: bit j of row i is the entry in row i and column j.
+
+    * BitDB_transpose         : The m x n transpose, a new container of m
+                                rows of length n. Moves 64 x 64 blocks
+                                through a SIMD butterfly transpose.
+    * BitDB_matrix_product    : The n x p product of an n x m matrix a and
+                                an m x p matrix b, a new container of n rows
+                                of length p. BIT_MATRIX_BOOLEAN ORs the rows
+                                of b that a row of a selects, BIT_MATRIX_GF2
+                                XORs them (the product over GF(2)). Uses the
+                                Method of Four Russians: the sums of every
+                                subset of 8 rows of b are tabulated once, in
+                                tiles of columns that stay in cache, so that
+                                each row of a does one row operation per 8 of
+                                its columns.
+    * BitDB_matrix_count_store: The n x p integer product of a and b into
+                                counts (row major, like BitDB_count_store),
+                                i.e. counts[i * p + k] is the number of j
+                                with a[i][j] and b[j][k]. Intersection counts
+                                of the rows of a against the transpose of b.
+    * BitDB_matrix_closure    : The transitive closure of the n x n adjacency
+                                matrix set, by repeated squaring: bit j of
+                                row i is set when a path of one or more edges
+                                leads from i to j. Set the diagonal of set
+                                first for the reflexive closure.
+
+    The products and the closure run on opts.num_cpu_threads threads (all
+    available if 0); the other fields of opts are ignored. It is a checked
+    runtime error to pass NULL containers or counts, to multiply matrices
+    whose inner dimensions (the length of a and the rows of b) differ, or
+    to take the closure of a matrix that is not square.
+*/
+extern T_DB BitDB_transpose(T_DB set);
+extern T_DB BitDB_matrix_product(T_DB a, T_DB b, Bit_matrix_ring ring,
+                                 SETOP_COUNT_OPTS opts);
+extern void BitDB_matrix_count_store(T_DB a, T_DB b, int *counts,
+                                     SETOP_COUNT_OPTS opts);
+extern T_DB BitDB_matrix_closure(T_DB set, SETOP_COUNT_OPTS opts);
+
+/*
+    Approximate similarity search. Exact counts of all pairs of rows cost
+    BitDB_nelem(bit) x BitDB_nelem(bits) row scans; sketches and banding
+    narrow them down to the pairs likely to be similar, whose exact counts
+    then come from BitDB_pairs_count.
+
+    * BitDB_minhash        : The k-entry MinHash signature of every row of
+                             set into signatures[i * k + b], by
+                             one-permutation hashing (one hash per set bit,
+                             k bins, empty bins densified). The signatures of
+                             rows of the same length are comparable across
+                             containers and calls; empty rows get UINT32_MAX
+                             in every entry.
+    * Bit_minhash_jaccard  : The fraction of entries two signatures share,
+                             an estimate of the Jaccard (Tanimoto)
+                             similarity of their rows with a standard error
+                             of about sqrt(J (1 - J) / k).
+    * BitDB_lsh_candidates : Banded LSH over signatures of k entries: each of
+                             the bands of k / bands entries is hashed, and a
+                             query and a target whose hashes agree in at
+                             least one band are a candidate pair. A pair of
+                             similarity J is found with probability
+                             1 - (1 - J^r)^bands, r = k / bands. Writes the
+                             pairs to *pairs, allocated by the library and
+                             freed by the caller, as (query, target) ints in
+                             increasing order, and returns their number. With
+                             targets NULL the queries are matched against
+                             themselves and only pairs query < target are
+                             reported.
+    * BitDB_pairs_count    : counts[m] = |bit[pairs[2m]] & bits[pairs[2m+1]]|
+                             for the n pairs of a pairs array, e.g. the
+                             candidates of BitDB_lsh_candidates.
+
+    The functions run on opts.num_cpu_threads threads (all available if 0);
+    the other fields of opts are ignored. It is a checked runtime error to
+    pass NULL containers, signatures or output arrays, a k less than 1, a
+    number of bands that does not divide k, rows outside their containers,
+    or containers of different lengths to BitDB_pairs_count.
+*/
+extern void BitDB_minhash(T_DB set, int k, uint32_t *signatures,
+                          SETOP_COUNT_OPTS opts);
+extern double Bit_minhash_jaccard(const uint32_t *s, const uint32_t *t, int k);
+extern size_t BitDB_lsh_candidates(const uint32_t *queries, int nqueries,
+                                   const uint32_t *targets, int ntargets,
+                                   int k, int bands, SETOP_COUNT_OPTS opts,
+                                   int **pairs);
+extern void BitDB_pairs_count(T_DB bit, T_DB bits, const int pairs[],
+                              size_t n, int *counts, SETOP_COUNT_OPTS opts);
+
+/*
+    Bit-sliced indices. A Bit_BSI_T stores an unsigned integer column of
+    length rows with values below 2^bits as bits Bit_T slices of length
+    bits each: slice b holds bit b of every value. Predicates come back as
+    Bit_T masks of the rows that satisfy them, which compose with the set
+    operations and counts of Bit_T and with other indices of the same rows.
+    A comparison takes one pass over the slices, 64 rows per qword
+    operation, instead of a pass over the values.
+
+    * Bit_BSI_new     : An index of length rows, all 0, of values of bits
+                        bits, 1 <= bits <= 64.
+    * Bit_BSI_free    : Frees the index and its slices.
+    * Bit_BSI_length, Bit_BSI_bits
+                      : Rows and slices of the index.
+    * Bit_BSI_slice   : Slice b (borrowed, 0 is the least significant).
+    * Bit_BSI_put, Bit_BSI_get
+                      : Value of one row.
+    * Bit_BSI_load    : Values of all rows from values[0 .. length - 1],
+                        transposed into the slices 64 rows at a time.
+    * Bit_BSI_compare : New mask of the rows whose value compares to value
+                        as op asks (see Bit_bsi_op).
+    * Bit_BSI_between : New mask of the rows with lo <= value <= hi (empty if
+                        lo > hi).
+    * Bit_BSI_sum     : Sum of the values of the rows in mask (all rows if
+                        mask is NULL), modulo 2^64, from one intersection
+                        count per slice.
+    * Bit_BSI_topk    : New mask of the k rows of mask (all rows if NULL)
+                        with the largest values, ties going to the lower
+                        rows; all of them if mask has k rows or fewer.
+
+    It is a checked runtime error to pass a NULL index, a length or bits out
+    of range, a row or slice outside the index, a value of more than bits
+    bits, a NULL values array, a mask of another length, or a negative k.
+    The queries may run concurrently; Bit_BSI_put and Bit_BSI_load may not.
+*/
+extern T_BSI Bit_BSI_new(int length, int bits);
+extern void Bit_BSI_free(T_BSI *bsi);
+extern int Bit_BSI_length(T_BSI bsi);
+extern int Bit_BSI_bits(T_BSI bsi);
+extern T Bit_BSI_slice(T_BSI bsi, int b);
+extern void Bit_BSI_put(T_BSI bsi, int index, uint64_t value);
+extern uint64_t Bit_BSI_get(T_BSI bsi, int index);
+extern void Bit_BSI_load(T_BSI bsi, const uint64_t values[]);
+extern T Bit_BSI_compare(T_BSI bsi, Bit_bsi_op op, uint64_t value);
+extern T Bit_BSI_between(T_BSI bsi, uint64_t lo, uint64_t hi);
+extern uint64_t Bit_BSI_sum(T_BSI bsi, T mask);
+extern T Bit_BSI_topk(T_BSI bsi, T mask, int k);
+
+/*
+    Apache Arrow C Data Interface. The structures below are those of the
+    Arrow specification, which any Arrow implementation (C++, Rust, Python,
+    R, ...) exports and imports. Arrow boolean buffers pack bits least
+    significant first, as a Bit_T does, so the library hands its rows over
+    without copying them and takes Arrow buffers as they are when they
+    start on a qword. Other buffers are repacked 64 bits at a time.
+
+    * Bit_to_arrow      : Fills array and schema with a boolean array ("b")
+                          of the bits of set, which views its storage. The
+                          consumer calls their release callbacks; set must
+                          outlive the array.
+    * Bit_from_arrow    : A Bit_T of the boolean array, or NULL if it is not
+                          one or is empty. Nulls are not members. Without
+                          nulls, with the bits starting on an 8 byte aligned
+                          qword and the bits past the length in their last
+                          qword zero, the Bit_T views the buffer, as
+                          Bit_load does (Bit_free then returns it); the
+                          array must outlive it. When the length is not a
+                          multiple of 64 that needs BIT_ARROW_PADDED, the
+                          promise that the buffer extends to the end of the
+                          qword, as Arrow C++, arrow-rs and pyarrow
+                          allocate it. Otherwise the bits are copied.
+    * BitDB_to_arrow    : Fills array and schema with the rows of set as a
+                          column of one entry per row, viewing the rows.
+                          BIT_ARROW_BINARY makes it fixed size binary
+                          ("w:<bytes>") of the row stride, the padding zero,
+                          with the length in bits in the schema metadata
+                          (key "bit.length"). BIT_ARROW_BOOL_LIST makes it a
+                          fixed size list of length booleans ("+w:<length>"),
+                          which is a view when the rows have no padding
+                          (length a multiple of 64 and packed rows) and a
+                          repacked copy owned by the array otherwise.
+    * BitDB_from_arrow  : A Bit_DB_T of a column of either kind, of rows of
+                          length bits: a length of 0 takes it from the
+                          "bit.length" metadata, else from the width of the
+                          column. A null row is empty, a null boolean not a
+                          member. Without nulls, and with rows that are
+                          packed qwords aligned to 8 bytes and end in zeros,
+                          the container views the column, as BitDB_load
+                          does, and the array must outlive it; otherwise
+                          the rows are copied. NULL if the column is of
+                          another type, is empty, or is narrower than
+                          length.
+
+    The import functions only read the array; releasing it stays with the
+    caller. It is a checked runtime error to pass a NULL set, array or
+    schema, a released array or schema, or a negative length.
+*/
+#ifndef ARROW_C_DATA_INTERFACE
+#define ARROW_C_DATA_INTERFACE
+
+#define ARROW_FLAG_DICTIONARY_ORDERED 1
+#define ARROW_FLAG_NULLABLE 2
+#define ARROW_FLAG_MAP_KEYS_SORTED 4
+
+struct ArrowSchema {
+  // Array type description
+  const char *format;
+  const char *name;
+  const char *metadata;
+  int64_t flags;
+  int64_t n_children;
+  struct ArrowSchema **children;
+  struct ArrowSchema *dictionary;
+
+  // Release callback
+  void (*release)(struct ArrowSchema *);
+  // Opaque producer-specific data
+  void *private_data;
+};
+
+struct ArrowArray {
+  // Array data description
+  int64_t length;
+  int64_t null_count;
+  int64_t offset;
+  int64_t n_buffers;
+  int64_t n_children;
+  const void **buffers;
+  struct ArrowArray **children;
+  struct ArrowArray *dictionary;
+
+  // Release callback
+  void (*release)(struct ArrowArray *);
+  // Opaque producer-specific data
+  void *private_data;
+};
+
+#endif // ARROW_C_DATA_INTERFACE
+
+/* Columns BitDB_to_arrow exports */
+typedef enum {
+  BIT_ARROW_BINARY = 0,    // fixed size binary, one entry per row
+  BIT_ARROW_BOOL_LIST = 1, // fixed size list of booleans
+} Bit_arrow_layout;
+
+enum {
+  BIT_ARROW_PADDED = 1 // Arrow buffers extend to a whole qword
+};
+extern void Bit_to_arrow(T set, struct ArrowArray *array,
+                         struct ArrowSchema *schema);
+extern T Bit_from_arrow(const struct ArrowArray *array,
+                        const struct ArrowSchema *schema, int flags);
+extern void BitDB_to_arrow(T_DB set, Bit_arrow_layout layout,
+                           struct ArrowArray *array,
+                           struct ArrowSchema *schema);
+extern T_DB BitDB_from_arrow(const struct ArrowArray *array,
+                             const struct ArrowSchema *schema, int length);
+
+/*
+    Multi-index hashing for Hamming distance (diff count) searches of
+    binary embeddings. The index cuts every row of a container into m
+    substrings of nearly equal width, and keeps a hash table for each
+    substring that maps a value to the rows holding it. Two rows within
+    distance r agree to within r / m bits on at least one substring.
+    Probing each table with the values near the query's substring
+    therefore finds every neighbour. Only those candidates have their full
+    distance counted, instead of every row of the container. Small radii
+    over many rows benefit most. Each probe that would cost more than a
+    scan falls back to one, so results are exact at any radius.
+
+    * Bit_MIH_new        : Indexes the rows of db, which the index borrows.
+                           m is the number of substrings, with substrings of
+                           at most 64 bits; with m <= 0 it is picked so that
+                           substrings have about log2(BitDB_nelem(db))
+                           bits. The tables are built in parallel. Rows
+                           written after that are only seen by a new index.
+    * Bit_MIH_free       : Frees the index (not db).
+    * Bit_MIH_substrings : The number of substrings m.
+    * Bit_MIH_knn        : For every row q of queries, its k nearest rows of
+                           db in out_idx[q * k + r] and out_dist[q * k + r],
+                           r = 0 the nearest, ties to the lower index, as
+                           in BitDB_inter_count_topk; slots beyond the rows
+                           of db get -1.
+    * Bit_MIH_radius     : For every query, all rows of db within distance
+                           r, in increasing row order, in the CSR layout of
+                           BitDB_inter_count_threshold (offsets holds
+                           BitDB_nelem(queries) + 1 entries, *out_idx and
+                           *out_dist are allocated by the library and freed
+                           by the caller). Returns the total number of
+                           matches.
+
+    The queries are spread over opts.num_cpu_threads threads (all available
+    if 0). It is a checked runtime error to pass a NULL index, container or
+    output, an m that leaves substrings wider than 64 bits, queries of
+    another length than db, a k less than 1, or a negative r.
+*/
+extern T_MIH Bit_MIH_new(T_DB db, int m, SETOP_COUNT_OPTS opts);
+extern void Bit_MIH_free(T_MIH *mih);
+extern int Bit_MIH_substrings(T_MIH mih);
+extern void Bit_MIH_knn(T_MIH mih, T_DB queries, int k, SETOP_COUNT_OPTS opts,
+                        int *out_idx, int *out_dist);
+extern size_t Bit_MIH_radius(T_MIH mih, T_DB queries, int r,
+                             SETOP_COUNT_OPTS opts, size_t *offsets,
+                             int **out_idx, int **out_dist);
+
+#ifdef BIT_MPI
+#include <mpi.h>
+
+typedef struct Bit_mpi_grid_T *Bit_mpi_grid_T;
+
+/* The count block of one rank of Bit_mpi_count_tile_cpu/_gpu */
+typedef struct {
+  int first_query, nquery;   // global queries [first, first + n)
+  int first_target, ntarget; // global targets [first, first + n)
+  int *counts;               // row major nquery x ntarget, freed by caller
+} Bit_mpi_tile;
+
+/*
+    All-pairs counts of containers too large for one node, on the ranks of
+    an MPI communicator (library built with MPI=1, callers compiled with
+    -DBIT_MPI). The ranks form a grid_rows x grid_cols grid, rank r sitting
+    at row r / grid_cols and column r % grid_cols. Every rank holds a panel
+    of the queries (bit) and one of the targets (bits). The queries are
+    numbered across the panels in rank order, so grid row i holds query
+    block i; the targets in column-major rank order ((0, 0), (1, 0), ...),
+    so grid column j holds target block j. Rank (i, j) counts query block i
+    against target block j: in the manner of SUMMA, the query panels are
+    broadcast along the grid rows and the target panels along the grid
+    columns, and each pair of panels is counted by the tiled kernels of one
+    node. The broadcast of the next panel is in flight (MPI_Ibcast) while
+    the current pair is counted, which hides it as far as the MPI library
+    progresses messages in the background.
+
+    * Bit_mpi_grid_new   : The grid over comm, which must have grid_rows x
+                           grid_cols ranks; a 0 in either is filled in by
+                           MPI_Dims_create. Collective.
+    * Bit_mpi_grid_free  : Frees the grid. Collective.
+    * Bit_mpi_grid_shape : The shape of the grid and the row and column of
+                           the calling rank; NULL outputs are skipped.
+    * Bit_mpi_scatter    : Spreads the rows of db on rank root (the others
+                           pass NULL) as even panels, in the order of
+                           queries, or of targets if targets is true. Returns
+                           the panel of the calling rank. Collective.
+    * Bit_mpi_count_tile_cpu,
+      Bit_mpi_count_tile_gpu   : The op counts (one Bit_count_ops value) of
+                           this rank's count block, into *tile.
+    * Bit_mpi_inter_count_topk,
+      Bit_mpi_inter_count_topk_gpu : The k best targets of every query of the
+                           calling rank's panel bit, with global target
+                           indices, in the layout and tie order of
+                           BitDB_inter_count_topk. The lists of the blocks
+                           of a grid row are merged on the rank owning the
+                           queries (MPI_Ireduce), each panel's as soon as
+                           its pairs are counted.
+    * Bit_mpi_inter_count_threshold,
+      Bit_mpi_inter_count_threshold_gpu : The targets with a count of at
+                           least threshold of every query of the panel bit,
+                           with global target indices, in the CSR layout of
+                           BitDB_inter_count_threshold. Returns the number
+                           of matches of the calling rank.
+
+    The counting functions are collective over the grid. The _gpu forms
+    count on opts.device_id, copy each panel to the device once and release
+    it after its last pair, whatever the upd and release flags of opts.
+    It is a checked runtime error to pass a NULL grid, container or output,
+    a grid that does not match the size of comm, an empty panel, rows of
+    different lengths on any rank, a k less than 1, an opts.row_mask, or to
+    scatter fewer rows than ranks.
+*/
+extern Bit_mpi_grid_T Bit_mpi_grid_new(MPI_Comm comm, int grid_rows,
+                                       int grid_cols);
+extern void Bit_mpi_grid_free(Bit_mpi_grid_T *grid);
+extern void Bit_mpi_grid_shape(Bit_mpi_grid_T grid, int *grid_rows,
+                               int *grid_cols, int *row, int *col);
+extern T_DB Bit_mpi_scatter(Bit_mpi_grid_T grid, T_DB db, int root,
+                            bool targets);
+extern void Bit_mpi_count_tile_cpu(Bit_mpi_grid_T grid, T_DB bit, T_DB bits,
+                                   Bit_count_ops op, SETOP_COUNT_OPTS opts,
+                                   Bit_mpi_tile *tile);
+extern void Bit_mpi_count_tile_gpu(Bit_mpi_grid_T grid, T_DB bit, T_DB bits,
+                                   Bit_count_ops op, SETOP_COUNT_OPTS opts,
+                                   Bit_mpi_tile *tile);
+extern void Bit_mpi_inter_count_topk(Bit_mpi_grid_T grid, T_DB bit, T_DB bits,
+                                     int k, SETOP_COUNT_OPTS opts,
+                                     int *out_idx, int *out_count);
+extern void Bit_mpi_inter_count_topk_gpu(Bit_mpi_grid_T grid, T_DB bit,
+                                         T_DB bits, int k,
+                                         SETOP_COUNT_OPTS opts, int *out_idx,
+                                         int *out_count);
+extern size_t Bit_mpi_inter_count_threshold(Bit_mpi_grid_T grid, T_DB bit,
+                                            T_DB bits, int threshold,
+                                            SETOP_COUNT_OPTS opts,
+                                            size_t *offsets, int **out_idx,
+                                            int **out_count);
+extern size_t Bit_mpi_inter_count_threshold_gpu(Bit_mpi_grid_T grid,
+                                                T_DB bit, T_DB bits,
+                                                int threshold,
+                                                SETOP_COUNT_OPTS opts,
+                                                size_t *offsets,
+                                                int **out_idx,
+                                                int **out_count);
+#endif
+
 #undef T
 #undef T_DB
+#undef T_C
+#undef T_SDB
+#undef T_PDB
+#undef T_W
+#undef T_L
+#undef T_BF
+#undef T_BSI
+#undef T_MIH
+#undef T_RDB
+#undef T_IDB
 
 void print_Bit_configuration(void);
 #endif
@@ -0,0 +1,126 @@
+/*
+    Inline single-bit accessors of Bit_T. OPT-IN: bit.h keeps struct Bit_T
+    opaque, and only a translation unit that includes this header sees its
+    layout. The price is that such a unit must be rebuilt whenever the
+    library changes the layout; everyone else keeps the opaque ABI.
+
+    * Bit_get_inline    : Bit_get
+    * Bit_bset_inline   : Bit_bset
+    * Bit_bclear_inline : Bit_bclear
+    * Bit_put_inline    : Bit_put
+    * Bit_*_unchecked   : the same four without the assertions, for loops
+                          whose indices are known to be in range
+
+    The accessors address the qword of a bit rather than its byte, and
+    compile to a load, a shift and (for the writers) a store, so the
+    compiler may inline them and hoist the qword pointer out of a loop. The
+    bits of a set are the same bits whichever way they are addressed. The
+    writers keep the library caches coherent as Bit_bset and friends do: the
+    rank/select index goes stale, a cached Bit_count is kept exact, a set
+    bit marks its block in a cached summary, and a cleared bit leaves the
+    summary to be rebuilt on its next use.
+
+    The checked accessors assert exactly what Bit_get and friends do (so
+    NDEBUG removes the checks from both); the unchecked ones never check.
+    As with the library functions, nothing here is thread safe: use
+    Bit_bset_atomic for bits that several threads set at once.
+
+    * Author : Christos Argyropoulos
+    * Created : October 2026
+    * License : BSD-2
+*/
+
+#ifndef BIT_INLINE_INCLUDED
+#define BIT_INLINE_INCLUDED
+
+#include "bit.h"
+#include <assert.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+/* Layout of a Bit_T; src/bit_internal.h takes it from here */
+struct Bit_T {
+  unsigned int length;         // capacity of the bitset in bits
+  unsigned int size_in_bytes;  // number of bytes of the 8 bit container
+  unsigned int size_in_qwords; // number of qwords of the 64 bit container
+  unsigned char *bytes;        // pointer to the first byte
+  uint64_t *qwords;            // pointer to the first qword
+  bool is_Bit_T_allocated;     // true if allocated by the library
+  uint32_t *rank;              // rank/select index (NULL until first built)
+  bool rank_valid;             // false once the bits changed after a build
+  uint64_t *summary;           // non-empty 512-bit blocks, one bit each
+                               // (NULL unless Bit_cache_summary enabled it)
+  bool summary_valid;          // false once a bulk write left it stale
+  int count;                   // cached Bit_count (when count_valid)
+  bool count_valid;            // false once the bits changed after a count
+  struct Bit_pool_T *pool;     // owning pool, or NULL
+};
+
+/* Bits per summary block: RANK_BLOCK_QWORDS qwords of the library */
+#define BIT_INLINE_SUMMARY_BITS 512
+
+static inline int Bit_get_unchecked(Bit_T set, int index) {
+  const unsigned int i = (unsigned int)index;
+  return (int)((set->qwords[i / 64] >> (i % 64)) & 1);
+}
+
+static inline void Bit_bset_unchecked(Bit_T set, int index) {
+  const unsigned int i = (unsigned int)index;
+  uint64_t *const word = &set->qwords[i / 64];
+  const uint64_t bit = UINT64_C(1) << (i % 64);
+  set->rank_valid = false;
+  if (set->count_valid && !(*word & bit))
+    set->count++;
+  *word |= bit;
+  if (set->summary != NULL && set->summary_valid) {
+    const unsigned int b = i / BIT_INLINE_SUMMARY_BITS;
+    set->summary[b / 64] |= UINT64_C(1) << (b % 64);
+  }
+}
+
+static inline void Bit_bclear_unchecked(Bit_T set, int index) {
+  const unsigned int i = (unsigned int)index;
+  uint64_t *const word = &set->qwords[i / 64];
+  const uint64_t bit = UINT64_C(1) << (i % 64);
+  set->rank_valid = false;
+  set->summary_valid = false;
+  if (set->count_valid && (*word & bit))
+    set->count--;
+  *word &= ~bit;
+}
+
+static inline int Bit_put_unchecked(Bit_T set, int index, int bit) {
+  const int prev = Bit_get_unchecked(set, index);
+  if (bit)
+    Bit_bset_unchecked(set, index);
+  else
+    Bit_bclear_unchecked(set, index);
+  return prev;
+}
+
+static inline int Bit_get_inline(Bit_T set, int index) {
+  assert(set);
+  assert(index >= 0 && index < (int)set->length);
+  return Bit_get_unchecked(set, index);
+}
+
+static inline void Bit_bset_inline(Bit_T set, int index) {
+  assert(set);
+  assert(index >= 0 && index < (int)set->length);
+  Bit_bset_unchecked(set, index);
+}
+
+static inline void Bit_bclear_inline(Bit_T set, int index) {
+  assert(set);
+  assert(index >= 0 && index < (int)set->length);
+  Bit_bclear_unchecked(set, index);
+}
+
+static inline int Bit_put_inline(Bit_T set, int index, int bit) {
+  assert(set);
+  assert(bit == 0 || bit == 1);
+  assert(0 <= index && (unsigned int)index < set->length);
+  return Bit_put_unchecked(set, index, bit);
+}
+
+#endif
@@ -40,6 +40,33 @@
 #define BIT_SIMD_PATH_SCALAR 1
 #endif
 
+/*
+ * SVE vectors have no compile-time width, so they cannot stand in for
+ * VECTOR_TYPE. An SVE build (e.g. -march=armv8.2-a+sve) keeps the 128-bit
+ * NEON path for the generic vector macros, and BIT_SIMD_PATH_SVE swaps in
+ * vector-length-agnostic set op, count and DB tile kernels (bit_internal.h).
+ * -DBIT_NO_SVE keeps the NEON kernels.
+ */
+#if defined(BIT_SIMD_PATH_128) && defined(__ARM_FEATURE_SVE) &&                \
+    !defined(BIT_NO_SVE)
+#define BIT_SIMD_PATH_SVE 1
+#include <arm_sve.h>
+#endif
+
+/*
+ * AArch64 without SVE (Apple M-series, Neoverse N1) runs the generic macros
+ * through SIMDe's SSE-on-NEON translation, whose simde_mm_popcnt_epi64
+ * widens the byte counts of every vector to 64-bit lanes. BIT_SIMD_PATH_NEON
+ * adds native count kernels (bit_internal.h) that keep the vcntq_u8 byte
+ * counts in 16-bit accumulators and widen them once per block.
+ * -DBIT_NO_NEON keeps the SIMDe kernels.
+ */
+#if defined(BIT_SIMD_PATH_128) && !defined(BIT_SIMD_PATH_SVE) &&               \
+    defined(__ARM_NEON) && defined(__ARM_64BIT_STATE) && !defined(BIT_NO_NEON)
+#define BIT_SIMD_PATH_NEON 1
+#include <arm_neon.h>
+#endif
+
 // ------------------------------------------------------------------------
 // Path Configurations
 // ------------------------------------------------------------------------
@@ -66,6 +93,7 @@
 #define SIMDe_VECTOR_ADD simde_mm512_add_epi64
 #define SIMDe_STORE_VECTOR(ptr, vec)                                           \
   simde_mm512_storeu_si512((void *)(ptr), (vec))
+#define SIMDe_TEST_ZERO(vec) (simde_mm512_test_epi64_mask((vec), (vec)) == 0)
 
 #elif defined(BIT_SIMD_PATH_AVX2)
 #include <simde/x86/avx2.h>
@@ -89,6 +117,7 @@
 #define SIMDe_VECTOR_ADD simde_mm256_add_epi64
 #define SIMDe_STORE_VECTOR(ptr, vec)                                           \
   simde_mm256_storeu_si256((simde__m256i *)(ptr), (vec))
+#define SIMDe_TEST_ZERO(vec) simde_mm256_testz_si256((vec), (vec))
 
 #elif defined(BIT_SIMD_PATH_128)
 // AVX1, SSE4.2, NEON, and RISC-V all map through this 128-bit execution path
@@ -113,12 +142,43 @@
 #define SIMDe_VECTOR_ADD simde_mm_add_epi64
 #define SIMDe_STORE_VECTOR(ptr, vec)                                           \
   simde_mm_storeu_si128((simde__m128i *)(ptr), (vec))
+#define SIMDe_TEST_ZERO(vec) simde_mm_testz_si128((vec), (vec))
 
 #else
 #define VECTOR_BYTES 0
 #define VECTOR_QWORDS 0
 #endif
 
+// ------------------------------------------------------------------------
+// Non-temporal stores
+// ------------------------------------------------------------------------
+
+// Streams STREAM_BYTES from src to dst (both aligned to STREAM_BYTES) past
+// the caches; STREAM_FENCE orders the streamed stores before later ones.
+// STREAM_INT streams one int to any int aligned dst; runs of them fill
+// whole lines in the write-combining buffers.
+// SIMDe has no 512-bit streaming store: the AVX-512 path streams 256 bits.
+#if defined(BIT_SIMD_PATH_AVX512) || defined(BIT_SIMD_PATH_AVX2)
+#define STREAM_BYTES 32
+#define STREAM_COPY(dst, src)                                                  \
+  simde_mm256_stream_si256((simde__m256i *)(dst),                              \
+                           simde_mm256_load_si256((const simde__m256i *)(src)))
+#define STREAM_INT(dst, v) simde_mm_stream_si32((int32_t *)(dst), (v))
+#define STREAM_FENCE() simde_mm_sfence()
+#elif defined(BIT_SIMD_PATH_128)
+#define STREAM_BYTES 16
+#define STREAM_COPY(dst, src)                                                  \
+  simde_mm_stream_si128((simde__m128i *)(dst),                                 \
+                        simde_mm_load_si128((const simde__m128i *)(src)))
+#define STREAM_INT(dst, v) simde_mm_stream_si32((int32_t *)(dst), (v))
+#define STREAM_FENCE() simde_mm_sfence()
+#else
+#define STREAM_BYTES 8
+#define STREAM_COPY(dst, src) (*(uint64_t *)(dst) = *(const uint64_t *)(src))
+#define STREAM_INT(dst, v) (*(dst) = (v))
+#define STREAM_FENCE() ((void)0)
+#endif
+
 // ------------------------------------------------------------------------
 // Diagnostics
 // ------------------------------------------------------------------------
@@ -131,6 +191,12 @@
 BIT_SIMD_PRAGMA_MESSAGE(message("[bit] SIMD path selected: AVX-512 (SIMDe)"))
 #elif defined(BIT_SIMD_PATH_AVX2)
 BIT_SIMD_PRAGMA_MESSAGE(message("[bit] SIMD path selected: AVX2 (SIMDe)"))
+#elif defined(BIT_SIMD_PATH_SVE)
+BIT_SIMD_PRAGMA_MESSAGE(
+    message("[bit] SIMD path selected: SVE, vector-length agnostic + NEON"))
+#elif defined(BIT_SIMD_PATH_NEON)
+BIT_SIMD_PRAGMA_MESSAGE(
+    message("[bit] SIMD path selected: 128-bit NEON, native popcount"))
 #elif defined(BIT_SIMD_PATH_128)
 BIT_SIMD_PRAGMA_MESSAGE(
     message("[bit] SIMD path selected: 128-bit AVX/SSE/NEON (SIMDe)"))
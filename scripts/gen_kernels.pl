@@ -0,0 +1,202 @@
+#!/usr/bin/env perl
+# Generator of the register block count kernels of src/bit_kernels.c
+# (Bit_kernel_variants, BitDB_count_variant in include/bit.h).
+#
+# Examples:
+#   ./scripts/gen_kernels.pl -o build/bit_kernels_gen.h 4x4x1 2x4x2
+#   make KERNEL_BLOCKS="1x1x4 4x4x1 3x8x1"
+#
+# Every block RxCxV (R queries by C targets per call, V vectors of every row
+# per step of the word loop) is written out for each set op and load type
+# (aligned, unaligned) as two functions:
+#
+#   gen_block_<op>_<R>x<C>x<V>_<load>  the microkernel, words [k_b, k_max)
+#                                      of R rows against C rows, with one
+#                                      named accumulator per pair and the
+#                                      word loop unrolled V vectors deep
+#   gen_rows_<op>_<R>x<C>x<V>_<load>   ni rows against nj rows through row
+#                                      pointers (SETOP_BLOCK_TILES), the
+#                                      signature of bit_kernel_table's
+#                                      setop_count_rows
+#
+# and registered in gen_count_variants, which every kernel table exports as
+# count_variants. The header is included once per instruction set tier, so
+# the vector type, loads and popcount of the unrolled code are those of the
+# tier. Where the tier's outer product kernel is not the vector accumulator
+# form (Harley-Seal, staged libpopcnt, NEON and SVE, see
+# setop_count_db_cpu_kernel_outer) the microkernel expands that macro at the
+# same shape instead.
+
+use strict;
+use warnings;
+use Getopt::Long qw(GetOptions);
+
+# name in the kernel, op macro suffix, bit_setop_id
+my @OPS = (
+    [ 'and',     '_AND',     'BIT_OP_AND' ],
+    [ 'or',      '_OR',      'BIT_OP_OR' ],
+    [ 'xor',     '_XOR',     'BIT_OP_XOR' ],
+    [ 'and_not', '_AND_NOT', 'BIT_OP_AND_NOT' ],
+);
+
+# name in the kernel, load macro, aligned
+my @LOADS = (
+    [ 'aligned',   'BIT_GEN_ALIGNED_LOAD',  'true' ],
+    [ 'unaligned', 'VECTOR_UNALIGNED_LOAD', 'false' ],
+);
+
+# Accumulators a microkernel may keep, R x C
+my $MAX_PAIRS = 64;
+
+my $out;
+GetOptions( 'o=s' => \$out )
+  or die "Usage: $0 [-o header] RxCxV...\n";
+die "Usage: $0 [-o header] RxCxV...\n" unless @ARGV;
+
+my ( @blocks, %seen );
+for my $spec ( map { split ' ' } @ARGV ) {
+    my ( $r, $c, $v ) = $spec =~ /^(\d+)x(\d+)x(\d+)$/
+      or die "$0: '$spec' is not a register block RxCxV\n";
+    die "$0: '$spec' has a zero dimension\n" unless $r && $c && $v;
+    die "$0: '$spec' keeps more than $MAX_PAIRS accumulators\n"
+      if $r * $c > $MAX_PAIRS;
+    push @blocks, [ $r + 0, $c + 0, $v + 0 ] unless $seen{"$r x $c x $v"}++;
+}
+
+sub kernel_tag {
+    my ( $op, $block, $load ) = @_;
+    my ( $r, $c, $v ) = @$block;
+    return "$op->[0]_${r}x${c}x${v}_$load->[0]";
+}
+
+# The vector accumulator form of one microkernel
+sub vector_body {
+    my ( $op, $block, $load ) = @_;
+    my ( $r, $c, $v ) = @$block;
+    my ( $opm, $lm ) = ( $op->[1], $load->[1] );
+    my @lines;
+    push @lines, "  const size_t step = $v * VECTOR_QWORDS;";
+    push @lines, '  CHUNK_LIMIT(limit, k_b, k_max, step)';
+    for my $x ( 0 .. $r - 1 ) {
+        push @lines, "  VECTOR_TYPE s${x}_$_ = SIMDe_ZERO_VECTOR;" for 0 .. $c - 1;
+    }
+    push @lines, '  size_t k = k_b;';
+    push @lines, '  for (; k < limit; k += step) {';
+    for my $u ( 0 .. $v - 1 ) {
+        push @lines, '    {';
+        for my $x ( 0 .. $r - 1 ) {
+            push @lines,
+              "      const VECTOR_TYPE a$x ="
+              . " $lm((VECTOR_TYPE *)&a[$x][k + VECTOR_OFFSET($u)]);";
+        }
+        for my $y ( 0 .. $c - 1 ) {
+            push @lines,
+              "      const VECTOR_TYPE b$y ="
+              . " $lm((VECTOR_TYPE *)&b[$y][k + VECTOR_OFFSET($u)]);";
+        }
+        for my $x ( 0 .. $r - 1 ) {
+            for my $y ( 0 .. $c - 1 ) {
+                push @lines,
+                  "      s${x}_$y = SIMDe_VECTOR_ADD("
+                  . "s${x}_$y, SIMDe_POPCOUNT(BIT$opm(a$x, b$y)));";
+            }
+        }
+        push @lines, '    }';
+    }
+    push @lines, '  }';
+    for my $x ( 0 .. $r - 1 ) {
+        push @lines, "  uint64_t c${x}_$_ = gen_lanes_sum(s${x}_$_);" for 0 .. $c - 1;
+    }
+    push @lines, '  for (; k < k_max; k++) {';
+    push @lines, "    const uint64_t a$_ = a[$_][k];" for 0 .. $r - 1;
+    push @lines, "    const uint64_t b$_ = b[$_][k];" for 0 .. $c - 1;
+    for my $x ( 0 .. $r - 1 ) {
+        for my $y ( 0 .. $c - 1 ) {
+            push @lines, "    c${x}_$y += POPCOUNT(BIT_SCALAR$opm(a$x, b$y));";
+        }
+    }
+    push @lines, '  }';
+    for my $x ( 0 .. $r - 1 ) {
+        push @lines, "  results[$x][$_] = (int)c${x}_$_;" for 0 .. $c - 1;
+    }
+    return @lines;
+}
+
+sub kernel {
+    my ( $op, $block, $load ) = @_;
+    my ( $r, $c, $v ) = @$block;
+    my $tag = kernel_tag( $op, $block, $load );
+    my $vectors = $v == 1 ? '1 vector' : "$v vectors";
+    my @lines = (
+        "/* $op->[0], ${r}x$c register block, $vectors a step,"
+          . " $load->[0] loads */",
+        "static inline void gen_block_$tag(",
+        '    const uint64_t *restrict const *a,'
+          . ' const uint64_t *restrict const *b,',
+        "    size_t k_b, size_t k_max, int results[$r][$c]) {",
+        '#if BIT_GEN_VECTOR_BLOCKS',
+        vector_body( $op, $block, $load ),
+        '#else',
+        "  setop_count_db_cpu_kernel_outer($r, $c, $v, a, b, k_b, k_max,"
+          . " results, $op->[1],",
+        '                                  OMP_CPU_SIMD_ALIGN_BUFFER('
+          . 'ALIGNMENT, setop_buffer),',
+        "                                  $load->[1]);",
+        '#endif',
+        '}',
+        '',
+        "static void gen_rows_$tag(const uint64_t *const *a, int ni,",
+        '    const uint64_t *const *b, int nj, size_t k_b, size_t k_max,',
+        '    int *restrict counts, size_t ld) {',
+        "  SETOP_BLOCK_TILES($op->[1], $load->[1], SETOP_INDIRECT_A,"
+          . " SETOP_INDIRECT_B, $r, $c,",
+        "                    gen_block_$tag(a_rows, b_rows, k_b, k_max,"
+          . ' results))',
+        '}',
+        '',
+    );
+    return @lines;
+}
+
+my @variants;
+my @text = (
+    '/*',
+    '    Register block count kernels of KERNEL_BLOCKS="'
+      . join( ' ', map { join 'x', @$_ } @blocks ) . '",',
+    '    written by scripts/gen_kernels.pl; do not edit. Included once per',
+    '    instruction set tier by src/bit_kernels.c.',
+    '*/',
+    '',
+);
+for my $block (@blocks) {
+    for my $op (@OPS) {
+        for my $load (@LOADS) {
+            push @text, kernel( $op, $block, $load );
+            my $tag = kernel_tag( $op, $block, $load );
+            push @variants,
+              "    {\"$tag\", $op->[2], $block->[0], $block->[1], $block->[2],"
+              . " $load->[2],\n     gen_rows_$tag},";
+        }
+    }
+}
+push @text,
+  '#define BIT_GEN_COUNT_VARIANTS ' . scalar(@variants),
+  'static const bit_count_variant gen_count_variants[BIT_GEN_COUNT_VARIANTS]'
+  . ' = {',
+  @variants,
+  '};',
+  '';
+
+# written next to the target and renamed, so that a failed run leaves no
+# half header behind for make to trust
+my $fh = \*STDOUT;
+my $tmp;
+if ( defined $out ) {
+    $tmp = "$out.tmp";
+    open $fh, '>', $tmp or die "$0: cannot write $tmp: $!\n";
+}
+print {$fh} join( "\n", @text );
+if ( defined $out ) {
+    close $fh or die "$0: cannot write $tmp: $!\n";
+    rename $tmp, $out or die "$0: cannot rename $tmp to $out: $!\n";
+}
@@ -0,0 +1,252 @@
+#!/usr/bin/env perl
+# Performance regression check of the Bit kernels against a stored per-host
+# baseline (make perfcheck).
+#
+# Examples:
+#   make perfcheck                         # compare, recording the baseline if none
+#   PERFCHECK_UPDATE=1 make perfcheck      # record a new baseline for this host
+#   PERFCHECK_REPS=30 CORES=2 ./scripts/perfcheck.pl
+#
+# A fixed workload matrix (the single-bitset kernels of `benchmark`, and the
+# count kernels of `openmp_bit_nogpu` and `openmp_bit_container` on a few
+# container shapes) runs through the benchmark harness, and the timed
+# repetitions of every case are compared with the baseline's by a one-sided
+# Mann-Whitney U test. A case regresses when it is slower with p < ALPHA and
+# its median grew by more than MIN_CHANGE, so that both noise and
+# statistically real but negligible shifts pass. The check exits with status
+# 1 when a case regresses or computes a different check value.
+#
+# Baselines live in tuning-results/baselines/<host>.json, the host being
+# named as by sweep_cpu_tuning.pl (ARCH_TAG overrides it). The sweep
+# summaries next to them keep only the best and mean time of each
+# configuration, too little for a noise-aware test, so perfcheck records its
+# own samples.
+
+use strict;
+use warnings;
+use Cwd        qw(abs_path);
+use File::Path qw(make_path);
+use File::Spec;
+use File::Temp qw(tempdir);
+use JSON::PP;
+use POSIX qw(erfc strftime);
+
+my $root = abs_path( File::Spec->catdir( File::Spec->curdir() ) );
+die "Run this script from the repository root (Makefile not found).\n"
+  unless -f File::Spec->catfile( $root, 'Makefile' );
+
+sub path_tag {
+    my ($value) = @_;
+    $value = lc( $value // '' );
+    $value =~ s/[^a-z0-9]+/-/g;
+    $value =~ s/^-+|-+$//g;
+    return substr( $value, 0, 96 );
+}
+
+sub detected_arch_tag {
+    chomp( my $arch = `uname -m` // '' );
+    my $cpu = 'unknown-cpu';
+    if ( open my $fh, '<', '/proc/cpuinfo' ) {
+        while ( my $line = <$fh> ) {
+            if ( $line =~ /^model name\s*:\s*(.+)$/ ) {
+                $cpu = $1;
+                last;
+            }
+        }
+        close $fh;
+    }
+    return path_tag("$arch-$cpu") || 'unknown-architecture';
+}
+
+my $build_dir  = $ENV{BUILD_DIR}            // 'build';
+my $reps       = $ENV{PERFCHECK_REPS}       // 15;
+my $warmup     = $ENV{PERFCHECK_WARMUP}     // 2;
+my $threads    = $ENV{PERFCHECK_THREADS}    // 1;
+my $alpha      = $ENV{PERFCHECK_ALPHA}      // 0.01;
+my $min_change = $ENV{PERFCHECK_MIN_CHANGE} // 0.10;
+my $update     = $ENV{PERFCHECK_UPDATE}     // 0;
+my $cores      = $ENV{CORES}                // '';
+my $arch_tag   = path_tag( $ENV{ARCH_TAG} // '' ) || detected_arch_tag();
+my $baseline_path = $ENV{PERFCHECK_BASELINE}
+  // File::Spec->catfile( $root, 'tuning-results', 'baselines',
+    "$arch_tag.json" );
+
+for ( [ PERFCHECK_REPS => $reps ], [ PERFCHECK_WARMUP => $warmup ],
+    [ PERFCHECK_THREADS => $threads ] )
+{
+    die "$_->[0] must be a non-negative integer\n"
+      unless $_->[1] =~ /^\d+$/;
+}
+die "PERFCHECK_REPS must be at least 5 for the rank test\n" if $reps < 5;
+die "PERFCHECK_ALPHA must be in (0, 1)\n"
+  unless $alpha =~ /^[\d.eE-]+$/ && $alpha > 0 && $alpha < 1;
+die "PERFCHECK_MIN_CHANGE must be a non-negative fraction\n"
+  unless $min_change =~ /^[\d.eE-]+$/ && $min_change >= 0;
+
+# The workload matrix: program and arguments. Kept small enough to run in a
+# few minutes, and fixed, since a changed matrix invalidates the baselines.
+my @matrix = (
+    [ 'benchmark' ],
+    [ 'openmp_bit_nogpu', 1024, 1000, 10000, $threads ],
+    [ 'openmp_bit_nogpu', 16384, 200, 2000, $threads ],
+    [ 'openmp_bit_container', 1024, 1000, 10000, $threads, $reps ],
+    [ 'openmp_bit_container', 65536, 256, 1024, $threads, $reps ],
+);
+
+# Timed samples of every case of the matrix, keyed by program, name and
+# params
+sub run_matrix {
+    my $tmp = tempdir( CLEANUP => 1 );
+    my %cases;
+    for my $entry (@matrix) {
+        my ( $program, @args ) = @$entry;
+        my $exec = File::Spec->catfile( $root, $build_dir, $program );
+        die "$exec not found; build it with make bench\n" unless -x $exec;
+        my $json = File::Spec->catfile( $tmp, "$program.json" );
+        unlink $json;
+        local $ENV{BENCH_FORMAT}      = 'json';
+        local $ENV{BENCH_OUTPUT}      = $json;
+        local $ENV{BENCH_REPETITIONS} = $reps;
+        local $ENV{BENCH_WARMUP}      = $warmup;
+        local $ENV{BENCH_ROOFLINE}    = 0;
+        local $ENV{BENCH_PERF}        = '';
+        my @command = ( $exec, @args );
+        unshift @command, 'taskset', '-c', $cores if length $cores;
+        print "Running @command\n";
+        system("@command >/dev/null") == 0
+          or die "Benchmark failed: @command\n";
+        open my $fh, '<', $json or die "No results from $program: $!\n";
+        my $results = decode_json( do { local $/; <$fh> } );
+        close $fh;
+        for my $result ( @{ $results->{results} } ) {
+            next unless @{ $result->{samples_ns} };
+            my $key = join ' | ', $program, $result->{name}, $result->{params};
+            $cases{$key} = {
+                samples => $result->{samples_ns},
+                median  => $result->{median_ns},
+                check   => $result->{check},
+            };
+        }
+    }
+    return \%cases;
+}
+
+sub median {
+    my @sorted = sort { $a <=> $b } @_;
+    my $mid    = int( @sorted / 2 );
+    return @sorted % 2 ? $sorted[$mid]
+      : ( $sorted[ $mid - 1 ] + $sorted[$mid] ) / 2;
+}
+
+# One-sided Mann-Whitney U test that the samples of x tend to be larger
+# than those of y: normal approximation with tie and continuity corrections,
+# close enough from 5 samples a side for a pass/fail threshold
+sub mann_whitney_greater {
+    my ( $x, $y ) = @_;
+    my @all = sort { $a->[0] <=> $b->[0] } ( map { [ $_, 0 ] } @$x ),
+      ( map { [ $_, 1 ] } @$y );
+    my $n = @all;
+    my ( $rank_x, $ties ) = ( 0, 0 );
+    for ( my $i = 0 ; $i < $n ; ) {
+        my $j = $i;
+        $j++ while $j + 1 < $n && $all[ $j + 1 ][0] == $all[$i][0];
+        my $rank = ( $i + $j ) / 2 + 1;    # average rank of the tie
+        my $t    = $j - $i + 1;
+        $ties += $t**3 - $t;
+        $rank_x += $rank for grep { $all[$_][1] == 0 } $i .. $j;
+        $i = $j + 1;
+    }
+    my ( $nx, $ny ) = ( scalar @$x, scalar @$y );
+    my $u     = $rank_x - $nx * ( $nx + 1 ) / 2;
+    my $mean  = $nx * $ny / 2;
+    my $var   = $nx * $ny / 12 * ( ( $n + 1 ) - $ties / ( $n * ( $n - 1 ) ) );
+    return $u > $mean ? 0.0 : 1.0 if $var <= 0;    # all samples tied
+    my $z = ( $u - $mean - 0.5 ) / sqrt($var);
+    return 0.5 * erfc( $z / sqrt(2) );
+}
+
+sub git_revision {
+    chomp( my $revision = `git -C '$root' rev-parse --short HEAD 2>/dev/null`
+          // '' );
+    return $revision || 'unknown';
+}
+
+sub write_baseline {
+    my ($cases) = @_;
+    my ( undef, $dir ) = File::Spec->splitpath($baseline_path);
+    make_path($dir) if length $dir;
+    my %baseline = (
+        schema   => 'bit-perfcheck/1',
+        host     => $arch_tag,
+        date     => strftime( '%Y-%m-%dT%H:%M:%SZ', gmtime ),
+        revision => git_revision(),
+        threads  => $threads,
+        cases    => $cases,
+    );
+    open my $fh, '>', $baseline_path
+      or die "Cannot write $baseline_path: $!\n";
+    print {$fh} JSON::PP->new->canonical->pretty->encode( \%baseline );
+    close $fh;
+    print "Recorded the baseline of $arch_tag in $baseline_path\n";
+}
+
+my $cases = run_matrix();
+if ( $update || !-f $baseline_path ) {
+    print "No baseline for $arch_tag yet\n" unless $update;
+    write_baseline($cases);
+    exit 0;
+}
+
+open my $fh, '<', $baseline_path or die "Cannot read $baseline_path: $!\n";
+my $baseline = decode_json( do { local $/; <$fh> } );
+close $fh;
+warn "Warning: the baseline ran with $baseline->{threads} threads, this "
+  . "check with $threads\n"
+  if ( $baseline->{threads} // $threads ) != $threads;
+
+printf "\nBaseline: %s, revision %s, %s\n", $baseline->{host},
+  $baseline->{revision}, $baseline->{date};
+printf "Regression: slower with p < %g and a median change above %.1f%%\n\n",
+  $alpha, 100 * $min_change;
+printf "%-60s %12s %12s %8s %9s  %s\n", 'case', 'base ns', 'now ns',
+  'change', 'p', 'verdict';
+
+my ( $regressions, $improvements, $mismatches ) = ( 0, 0, 0 );
+for my $key ( sort keys %$cases ) {
+    my $now  = $cases->{$key};
+    my $base = $baseline->{cases}{$key};
+    unless ($base) {
+        printf "%-60s %12s %12.0f %8s %9s  %s\n", $key, '-', $now->{median},
+          '-', '-', 'new';
+        next;
+    }
+    my $base_median = median( @{ $base->{samples} } );
+    my $now_median  = median( @{ $now->{samples} } );
+    my $change = $base_median > 0 ? $now_median / $base_median - 1 : 0;
+    my $slower = mann_whitney_greater( $now->{samples}, $base->{samples} );
+    my $faster = mann_whitney_greater( $base->{samples}, $now->{samples} );
+    my ( $p, $verdict ) = ( $slower, 'ok' );
+    if ( $now->{check} != $base->{check} ) {
+        $verdict = "CHECK $base->{check} -> $now->{check}";
+        $mismatches++;
+    }
+    elsif ( $slower < $alpha && $change > $min_change ) {
+        $verdict = 'REGRESSION';
+        $regressions++;
+    }
+    elsif ( $faster < $alpha && -$change > $min_change ) {
+        ( $p, $verdict ) = ( $faster, 'faster' );
+        $improvements++;
+    }
+    printf "%-60s %12.0f %12.0f %+7.1f%% %9.2g  %s\n", $key, $base_median,
+      $now_median, 100 * $change, $p, $verdict;
+}
+for my $key ( sort keys %{ $baseline->{cases} } ) {
+    printf "%-60s %12s %12s %8s %9s  %s\n", $key, '-', '-', '-', '-',
+      'missing'
+      unless $cases->{$key};
+}
+
+printf "\n%d regressions, %d improvements, %d check mismatches\n",
+  $regressions, $improvements, $mismatches;
+exit( $regressions || $mismatches ? 1 : 0 );
@@ -1,6 +1,8 @@
 #!/usr/bin/env bash
 # Run comparable single- and dual-socket CPU tuning sweeps on the dual-socket
 # Xeon E5-2697 v4 system. Run this script from any directory.
+# Thread and socket scaling of the count kernel does not need this script:
+# build/openmp_bit_scaling detects the nodes and binds its runs itself.
 set -euo pipefail
 
 root=$(cd -- "$(dirname -- "${BASH_SOURCE[0]}")/.." && pwd)
@@ -6,7 +6,14 @@
 #   ELEVATE=always CORES=0-9 REPS=5 PERF_REPS=5 ./scripts/sweep_cpu_tuning.pl
 #   LIBPOPCNT_MODES=0,1 CPU_TILES=4,8,16 K_BLOCKS=256,512,1024 \
 #     ./scripts/sweep_cpu_tuning.pl
+#   PREFETCHES=0,2,4,8 ./scripts/sweep_cpu_tuning.pl
 #   PERF_PROFILES=summary,cache-l1,cache-l2,buffers-pending ./scripts/sweep_cpu_tuning.pl
+#   PERF_MODE=harness HARNESS_PERF=core,cache,tlb ./scripts/sweep_cpu_tuning.pl
+#
+# PERF_MODE=stat (the default) runs every configuration once per perf profile
+# under `perf stat`; PERF_MODE=harness runs it once and reads the counter
+# groups of HARNESS_PERF (see benchmark/bench_perf.h) inside the benchmark,
+# around the timed count calls only.
 #
 # All comma-separated sweep variables may be overridden through the environment.
 # The default is intentionally a direct-SIMD sweep (LIBPOPCNT=0); include mode 1
@@ -77,6 +84,7 @@ my @k_blocks        = csv_values( 'K_BLOCKS',        '256,512,768,1024' );
 my @shapes          = csv_values( 'SHAPES',          '1x1,2x2,2x4,4x2' );
 my @unrolls         = csv_values( 'UNROLLS',         '1,2,4' );
 my @buffer_sizes    = csv_values( 'BUFFER_SIZES',    '16,32,64,128' );
+my @prefetches      = csv_values( 'PREFETCHES',      '0' );
 
 my $cc          = $ENV{CC}        // 'clang';
 my $cores       = $ENV{CORES}     // '0-9';
@@ -86,6 +94,8 @@ my $right_count = $ENV{RIGHT}     // 1000;
 my $threads     = $ENV{THREADS}   // 10;
 my $reps        = $ENV{REPS}      // 5;
 my $perf_reps   = $ENV{PERF_REPS} // 3;
+my $perf_mode   = lc( $ENV{PERF_MODE} // 'stat' );
+my $harness_perf = $ENV{HARNESS_PERF} // 'all';
 my $elevate     = lc( $ENV{ELEVATE}  // 'auto' );
 my $priority    = lc( $ENV{PRIORITY} // 'nice' );
 my $limit       = $ENV{MAX_CONFIGS} // 0;
@@ -362,8 +372,16 @@ my @perf_profile_names = csv_values(
 'summary,cache-l1,cache-l2,cache-l3-dram,cache-stalls,buffers-pending,buffers-store,execution-uops,execution-ports,frontend,frequency,vectorization,tlb,uncore-numa,power-rapl',
 );
 
+die "PERF_MODE must be stat or harness\n"
+  unless $perf_mode =~ /^(?:stat|harness)$/;
+if ( $perf_mode eq 'harness' ) {
+    @perf_profile_names        = ('harness');
+    $perf_profiles{harness}   = "BENCH_PERF=$harness_perf";
+    $profile_purpose{harness} =
+      'In-process counter groups around the timed count calls.';
+}
 unshift @perf_profile_names, 'summary'
-  unless grep { $_ eq 'summary' } @perf_profile_names;
+  unless grep { $_ eq 'summary' || $_ eq 'harness' } @perf_profile_names;
 for my $profile (@perf_profile_names) {
     die "Unknown PERF_PROFILES value '$profile'\n"
       unless exists $perf_profiles{$profile};
@@ -462,18 +480,37 @@ sub parse_perf {
     return \%metrics;
 }
 
+# Last result of the harness CSV (one row per perf repetition)
 sub parse_benchmark {
     my ($path) = @_;
     my %values;
     open my $fh, '<', $path or return \%values;
+    my $header = <$fh>;
+    return \%values unless defined $header;
+    chomp $header;
+    my @names = split /,/, $header;
+    my %row;
     while ( my $line = <$fh> ) {
-        $values{best_ns} = $1 if $line =~ /^best:\s+(\d+)\s+ns/;
-        $values{avg_ns}  = $1 if $line =~ /^average:\s+([\d.]+)\s+ns/;
-        $values{gqps}    = $1
-          if $line =~ /^average:.*\(([\d.]+)\s+Gqword-pairs\/s\)/;
-        $values{checksum} = $1 if $line =~ /^checksum:\s+(\d+)/;
+        chomp $line;
+        my @fields = split /,/, $line;
+        @row{@names} = @fields if @fields == @names;
     }
     close $fh;
+    return \%values unless defined $row{mean_ns};
+    $values{best_ns}   = $row{min_ns};
+    $values{avg_ns}    = $row{mean_ns};
+    $values{median_ns} = $row{median_ns};
+    $values{p95_ns}    = $row{p95_ns};
+    $values{gqps}      = $row{words} / $row{mean_ns} if $row{mean_ns} > 0;
+    $values{checksum}  = $row{check};
+
+    # BENCH_PERF counters per repetition, as name=value;name=value
+    for my $pair ( split /;/, $row{counters} // '' ) {
+        my ( $event, $value ) = split /=/, $pair, 2;
+        next unless defined $value;
+        $event =~ s/[^A-Za-z0-9]+/_/g;
+        $values{"perf_$event"} = $value;
+    }
     return \%values;
 }
 
@@ -490,6 +527,10 @@ for my $lib (@libpopcnt_modes) {
     die "LIBPOPCNT_MODES values must be 0 or 1\n" unless $lib =~ /^[01]$/;
     my @mode_unrolls = $lib ? ('-')         : @unrolls;
     my @mode_buffers = $lib ? @buffer_sizes : ('-');
+    # buffer size x prefetch distance, in cache lines (CPU_PREFETCH)
+    my @mode_variants =
+      map { my $buffer = $_; map { [ $buffer, $_ ] } @prefetches }
+      @mode_buffers;
 
     for my $tile (@cpu_tiles) {
         for my $k_block (@k_blocks) {
@@ -498,12 +539,15 @@ for my $lib (@libpopcnt_modes) {
                 die "Invalid SHAPES value '$shape'; use ROWSxCOLS, e.g. 2x4\n"
                   unless defined $rows && $rows > 0 && $cols > 0;
                 for my $unroll (@mode_unrolls) {
-                    for my $buffer (@mode_buffers) {
+                    for my $variant (@mode_variants) {
+                        my ( $buffer, $prefetch ) = @$variant;
                         last if $limit && $index >= $limit;
                         ++$index;
-                        my $tag = sprintf( '%03d-lib%d-t%s-k%s-r%sc%s-u%s-b%s',
-                            $index,  $lib, $tile, $k_block, $rows, $cols,
-                            $unroll, $buffer );
+                        my $tag =
+                          sprintf( '%03d-lib%d-t%s-k%s-p%s-r%sc%s-u%s-b%s',
+                            $index,    $lib,  $tile, $k_block,
+                            $prefetch, $rows, $cols, $unroll,
+                            $buffer );
                         print "[$index] $tag\n";
 
                         my @make_args = (
@@ -512,7 +556,8 @@ for my $lib (@libpopcnt_modes) {
                             'GPU=NONE',                "CC=$cc",
                             "CPU_TILE=$tile",          "LIBPOPCNT=$lib",
                             "BITVECTOR_TILE=$k_block", "OUTER_ROW_NUM=$rows",
-                            "OUTER_COL_NUM=$cols",     'bench_omp',
+                            "OUTER_COL_NUM=$cols",     "CPU_PREFETCH=$prefetch",
+                            'bench_omp',
                             'APPLY_LTO=1',             'SIMD_DIAGNOSTICS=1',
                         );
                         push @make_args, "OUTER_VEC_BLK=$unroll" if !$lib;
@@ -527,6 +572,7 @@ for my $lib (@libpopcnt_modes) {
                             libpopcnt    => $lib,
                             cpu_tile     => $tile,
                             k_block      => $k_block,
+                            prefetch     => $prefetch,
                             rows         => $rows,
                             cols         => $cols,
                             unroll       => $unroll,
@@ -581,10 +627,19 @@ for my $lib (@libpopcnt_modes) {
                             $profile_key =~ s/[^A-Za-z0-9]+/_/g;
                             my $bench_log = File::Spec->catfile( $out_dir,
                                 "$tag.$profile.benchmark.log" );
+                            my $bench_csv = File::Spec->catfile( $out_dir,
+                                "$tag.$profile.benchmark.csv" );
+                            unlink $bench_csv;
                             my $perf_log = File::Spec->catfile( $out_dir,
                                 "$tag.$profile.perf.csv" );
 
-                            my $command = join( '',
+                            my $command = $perf_mode eq 'harness'
+                              ? shell_quote(
+                                'env',                  'BENCH_ROOFLINE=0',
+                                'BENCH_FORMAT=csv',     "BENCH_OUTPUT=$bench_csv",
+                                "BENCH_PERF=$harness_perf", @run_args
+                              )
+                              : join( '',
                                 $sudo,
                                 'env LC_ALL=C perf stat -x, -r ',
                                 $perf_reps,
@@ -593,15 +648,21 @@ for my $lib (@libpopcnt_modes) {
                                 ' -o ',
                                 shell_quote($perf_log),
                                 ' -- ',
-                                shell_quote(@run_args) );
+                                shell_quote(
+                                    'env', 'BENCH_ROOFLINE=0',
+                                    'BENCH_FORMAT=csv',
+                                    "BENCH_OUTPUT=$bench_csv", @run_args
+                                ) );
 
                             my $ran = run_command( $command, $bench_log );
                             $result{"profile_$profile_key"} =
                               $ran ? 'ok' : 'failed';
-                            $summary_ran = $ran if $profile eq 'summary';
+                            my $timed = $profile eq 'summary'
+                              || $profile eq 'harness';
+                            $summary_ran = $ran if $timed;
 
-                            if ( $profile eq 'summary' ) {
-                                my $bench = parse_benchmark($bench_log);
+                            if ($timed) {
+                                my $bench = parse_benchmark($bench_csv);
                                 $result{$_} = $bench->{$_} for keys %$bench;
                             }
                             my $perf = parse_perf($perf_log);
@@ -633,7 +694,7 @@ for my $lib (@libpopcnt_modes) {
 }
 
 my @columns =
-  qw(tag build_status run_status libpopcnt cpu_tile k_block rows cols unroll buffer_size best_ns avg_ns gqps checksum perf_cycles perf_instructions perf_branches perf_branch_misses perf_cache_references perf_cache_misses);
+  qw(tag build_status run_status libpopcnt cpu_tile k_block prefetch rows cols unroll buffer_size best_ns avg_ns gqps checksum perf_cycles perf_instructions perf_branches perf_branch_misses perf_cache_references perf_cache_misses);
 my %base_columns = map { $_ => 1 } @columns;
 for my $row (@results) {
     push @columns, sort grep { !$base_columns{$_}++ } keys %$row;
@@ -666,7 +727,9 @@ print {$report} "- Priority: `$priority`; elevated execution: ",
   ( $sudo ? 'yes' : 'no' ), "\n";
 print {$report}
 "- Benchmark: `openmp_bit_container $bit_length $left_count $right_count $threads $reps`\n";
-print {$report} "- Perf repetitions per configuration: $perf_reps\n";
+print {$report} $perf_mode eq 'harness'
+  ? "- Counters: read in process around the timed calls, one run per configuration\n"
+  : "- Perf repetitions per configuration: $perf_reps\n";
 print {$report} "- Perf profiles: `", join( ', ', @perf_profile_names ), "`\n";
 
 for my $profile (@perf_profile_names) {
@@ -677,9 +740,9 @@ print {$report} "- Configurations requested: ",  scalar(@results), "\n";
 print {$report} "- Successful configurations: ", scalar(@valid),   "\n\n";
 print {$report} "## Ranked successful configurations\n\n";
 print {$report}
-"| Rank | Mode | CPU tile | K block | Shape | Unroll | Buffer | Average ns | Gqword-pairs/s | IPC | Cache miss % | Branch miss % |\n";
+"| Rank | Mode | CPU tile | K block | Prefetch | Shape | Unroll | Buffer | Average ns | Gqword-pairs/s | IPC | Cache miss % | Branch miss % |\n";
 print {$report}
-  "|---:|---:|---:|---:|:---:|---:|---:|---:|---:|---:|---:|---:|\n";
+  "|---:|---:|---:|---:|---:|:---:|---:|---:|---:|---:|---:|---:|---:|\n";
 my $rank = 0;
 for my $row (@valid) {
     ++$rank;
@@ -693,9 +756,9 @@ for my $row (@valid) {
     my $cache_rate    = $cache_refs ? 100 * $cache_misses / $cache_refs : 0;
     my $branch_rate   = $branches   ? 100 * $branch_misses / $branches  : 0;
     printf {$report}
-"| %d | %d | %s | %s | %dx%d | %s | %s | %.0f | %.3f | %.3f | %.3f | %.3f |\n",
+"| %d | %d | %s | %s | %s | %dx%d | %s | %s | %.0f | %.3f | %.3f | %.3f | %.3f |\n",
       $rank, $row->{libpopcnt}, $row->{cpu_tile}, $row->{k_block},
-      $row->{rows}, $row->{cols}, $row->{unroll}, $row->{buffer_size},
+      $row->{prefetch}, $row->{rows}, $row->{cols}, $row->{unroll}, $row->{buffer_size},
       number( $row->{avg_ns} ), number( $row->{gqps} ), $ipc, $cache_rate,
       $branch_rate;
 }
@@ -17,17 +17,24 @@
    ===========================================================================
  */
 
+#if defined(__linux__) && !defined(_GNU_SOURCE)
+#define _GNU_SOURCE // for mremap, must precede every system header
+#endif
+
 #include "bit.h"               // Contains your public API declarations
 #include "omp.h"               // For OpenMP parallelization
 #include "simde_integration.h" // For SIMD operations
 #include <assert.h>            // For assert() validation
+#include <errno.h>             // For errno (streaming writes)
 #include <limits.h>            // For INT_MAX
+#include <math.h>              // For sqrt
 #include <stdatomic.h>         // For atomic operations
 #include <stdbool.h>           // For bool type (is_Bit_T_allocated)
 #include <stdint.h>            // For uintptr_t and UINT64_C macros
 #include <stdio.h>             // For printf (if needed for debugging)
 #include <stdlib.h>            // For malloc, free
 #include <string.h>            // For memset
+#include <time.h>              // For nanosleep (queue waiters)
 /*---------------------------------------------------------------------------
   Environmental and configuration macros/defines and enums
 ----------------------------------------------------------------------------*/
@@ -40,6 +47,182 @@
 #else
 #endif
 
+/* Large growable containers live in anonymous mappings on Linux, so that
+   growing them is an mremap rather than a copy */
+#if defined(__linux__)
+#include <sys/mman.h>    // For mmap, mremap, munmap
+#include <sched.h>       // For sched_setaffinity (count store affinity)
+#include <sys/syscall.h> // For SYS_mbind (NUMA interleaving)
+#include <unistd.h>      // For syscall
+#define BIT_DB_MREMAP 1
+#else
+#define BIT_DB_MREMAP 0
+#endif
+
+/* SVE support of an AArch64 host, for the runtime ISA dispatch */
+#if defined(__linux__) && defined(__aarch64__)
+#include <sys/auxv.h> // For getauxval(AT_HWCAP) & HWCAP_SVE
+#endif
+#ifndef BIT_DB_MMAP_THRESHOLD
+#define BIT_DB_MMAP_THRESHOLD (1u << 20) // bytes of row storage
+#endif
+
+/* Search modes (top-k, threshold) count one tile of query x target rows at a
+   time; each tile of counts stays cache resident until it has been folded */
+#ifndef BIT_SEARCH_QUERY_BLOCK
+#define BIT_SEARCH_QUERY_BLOCK 64
+#endif
+#ifndef BIT_SEARCH_TARGET_BLOCK
+#define BIT_SEARCH_TARGET_BLOCK 1024
+#endif
+
+/* Screened searches (BitDB_inter_count_screened): rows read to rank the
+   lines of words by variance, and how many standard deviations below the
+   threshold an estimate from the sample may fall and still be counted */
+#ifndef BIT_SCREEN_SAMPLE_ROWS
+#define BIT_SCREEN_SAMPLE_ROWS 4096
+#endif
+#ifndef BIT_SCREEN_SIGMAS
+#define BIT_SCREEN_SIGMAS 3.0
+#endif
+
+/* Batched pair counts go parallel once the pairs span this many qwords */
+#ifndef BIT_BATCH_PARALLEL_QWORDS
+#define BIT_BATCH_PARALLEL_QWORDS (1u << 16)
+#endif
+
+/* Bulk row imports (BitDB_put_many) go parallel once they copy this many
+   bytes */
+#ifndef BIT_PUT_PARALLEL_BYTES
+#define BIT_PUT_PARALLEL_BYTES (1u << 20)
+#endif
+
+/* Single-bitset kernels split the words of a bitset over the threads once
+   it has this many bytes (BIT_PARALLEL_THRESHOLD overrides it at load
+   time), in chunks of at least BIT_PARALLEL_CHUNK_BYTES */
+#ifndef BIT_PARALLEL_BYTES
+#define BIT_PARALLEL_BYTES (8u << 20)
+#endif
+
+#ifndef BIT_PARALLEL_CHUNK_BYTES
+#define BIT_PARALLEL_CHUNK_BYTES (1u << 20)
+#endif
+
+/* Bit_to_indices decodes in parallel once a bitset has this many qwords */
+#ifndef BIT_DECODE_PARALLEL_QWORDS
+#define BIT_DECODE_PARALLEL_QWORDS (1u << 15)
+#endif
+
+/* Row gathers prefetch the first lines of the row this many rows ahead */
+#ifndef BIT_GATHER_PREFETCH_ROWS
+#define BIT_GATHER_PREFETCH_ROWS 8
+#endif
+
+/* N-way reductions produce the output a block of qwords at a time from all
+   the inputs; with the bit-sliced counters of BIT_REDUCE_ATLEAST (up to 32
+   of them) a block stays within L1 */
+#ifndef BIT_REDUCE_BLOCK
+#define BIT_REDUCE_BLOCK 128 // qwords
+#endif
+
+/* Words of a row a containment test reads between checks for a violation
+   (BitDB_superset_search, BitDB_subset_search): one AVX-512 vector */
+#ifndef BIT_CONTAIN_CHUNK
+#define BIT_CONTAIN_CHUNK 8
+#endif
+
+/* Rows added into one set of bit-sliced counters before they are
+   transposed into column counts (BitDB_column_counts): 16 slices */
+#ifndef BIT_COLUMN_COUNT_ROWS
+#define BIT_COLUMN_COUNT_ROWS 65535
+#endif
+
+/* Shards are merged a chunk of qwords at a time, so that the chunk of the
+   destination stays in L1 while every shard is ORed into it */
+#ifndef BIT_SHARDS_CHUNK
+#define BIT_SHARDS_CHUNK 512 // qwords
+#endif
+
+/* Self-joins count square blocks of rows against each other, upper triangle
+   of blocks only */
+#ifndef BIT_SELF_BLOCK
+#define BIT_SELF_BLOCK 128
+#endif
+
+/* Queries accumulate column postings instead of scanning the rows while the
+   postings of their bits hold fewer than one entry per BIT_POSTINGS_COST
+   qwords of rows: an entry is a scattered increment, a qword a streamed load */
+#ifndef BIT_POSTINGS_COST
+#define BIT_POSTINGS_COST 8
+#endif
+
+/* Staging buffer of BitDB_writer_open: rows reach the file in writes of
+   this many bytes (a multiple of the header page) */
+#ifndef BIT_DB_WRITER_BUFFER
+#define BIT_DB_WRITER_BUFFER (8u << 20)
+#endif
+_Static_assert(BIT_DB_WRITER_BUFFER % 4096 == 0,
+               "BIT_DB_WRITER_BUFFER must be whole pages");
+
+/* Read-ahead of BitDB_reader_open: BIT_DB_READER_DEPTH chunks of
+   BIT_DB_READER_CHUNK bytes are in flight at a time, about the queue depth
+   that keeps an NVMe device busy */
+#ifndef BIT_DB_READER_CHUNK
+#define BIT_DB_READER_CHUNK (1u << 20)
+#endif
+#ifndef BIT_DB_READER_DEPTH
+#define BIT_DB_READER_DEPTH 8
+#endif
+_Static_assert(BIT_DB_READER_CHUNK % 4096 == 0,
+               "BIT_DB_READER_CHUNK must be whole pages");
+
+/* Tiles of the count files of BitDB_count_store_tiled_cpu: the register
+   tile of the count kernels, CPU_TILE_BIT x CPU_TILE_BITS, where it divides
+   the tiles db_count_tiles hands out (so that one fold fills every file
+   tile it touches), else those tiles */
+#define BIT_TILE_ROWS                                                          \
+  (BIT_SEARCH_QUERY_BLOCK % CPU_TILE_BIT ? BIT_SEARCH_QUERY_BLOCK : CPU_TILE_BIT)
+#define BIT_TILE_COLS                                                          \
+  (BIT_SEARCH_TARGET_BLOCK % CPU_TILE_BITS ? BIT_SEARCH_TARGET_BLOCK           \
+                                           : CPU_TILE_BITS)
+
+/* Saved containers are mapped straight from their files on POSIX systems */
+#if defined(__unix__) || defined(__APPLE__)
+#include <fcntl.h>    // For open
+#include <sys/stat.h> // For fstat
+#include <unistd.h>   // For close
+#if !BIT_DB_MREMAP
+#include <sys/mman.h> // For mmap, madvise, munmap
+#endif
+#define BIT_DB_MMAP_FILES 1
+#else
+#define BIT_DB_MMAP_FILES 0
+#endif
+
+/* Saved containers are read ahead through io_uring on Linux, by its system
+   calls (no liburing); BitDB_reader_open falls back to pread where the
+   kernel refuses them */
+#if BIT_DB_MMAP_FILES && defined(__linux__) && defined(__has_include)
+#if __has_include(<linux/io_uring.h>)
+#include <linux/io_uring.h> // For the io_uring rings and opcodes
+#include <sys/uio.h>        // For struct iovec (registered buffers)
+#if defined(__NR_io_uring_setup) && defined(IORING_FEAT_CUR_PERSONALITY)
+#define BIT_DB_IO_URING 1
+#endif
+#endif
+#endif
+#ifndef BIT_DB_IO_URING
+#define BIT_DB_IO_URING 0
+#endif
+
+/* Snapshots share the rows of a container through a memory file on Linux
+   (memfd_create), and are copies elsewhere */
+#if BIT_DB_MMAP_FILES && BIT_DB_MREMAP && defined(MFD_CLOEXEC)
+#define BIT_DB_COW 1
+#else
+#define BIT_DB_COW 0
+#endif
+
 /* --- End Section 1: INCLUDES --- */
 
 #include "bit_internal.h"
@@ -50,13 +233,54 @@
    ===========================================================================
  */
 
-// Byte masks used by the bit-range API (Bit_set, Bit_clear, Bit_not)
-static unsigned const char msbmask[] = {
-    0xFF, 0xFE, 0xFC, 0xF8, 0xF0, 0xE0, 0xC0, 0x80,
-};
+// Operations applied by the bit-range kernel (Bit_set, Bit_clear, Bit_not)
+typedef enum { RANGE_SET, RANGE_CLEAR, RANGE_FLIP } range_op;
+
+// ISA variants of src/bit_kernels.c linked into the library, best first.
+// BIT_ISA_DISPATCH is set by the Makefile when the x86 or the AArch64
+// variants are built, otherwise a single variant compiled for the build
+// host is available.
+#if BIT_ISA_DISPATCH && defined(__aarch64__)
+extern const bit_kernel_table bit_kernels_sve;
+extern const bit_kernel_table bit_kernels_neon;
+#elif BIT_ISA_DISPATCH
+extern const bit_kernel_table bit_kernels_avx512vpopcnt;
+extern const bit_kernel_table bit_kernels_avx512;
+extern const bit_kernel_table bit_kernels_avx2;
+extern const bit_kernel_table bit_kernels_sse42;
+extern const bit_kernel_table bit_kernels_scalar;
+#else
+extern const bit_kernel_table bit_kernels_native;
+#endif
+
+// Kernel table picked for this host by select_kernels()
+static const bit_kernel_table *bit_kernels = NULL;
+
+// Kernel table of the counts that avoid AVX-512 (see count_kernels): AVX2
+// on a host whose table is an AVX-512 one, bit_kernels otherwise
+static const bit_kernel_table *bit_kernels_narrow = NULL;
+
+// Work below which BIT_ISA_AUTO counts take bit_kernels_narrow; 0 until
+// set, calibrated, or read from BIT_ISA_THRESHOLD by init_kernels()
+static _Atomic uint64_t bit_isa_threshold;
+
+// Bytes of counts above which BIT_STORE_AUTO streams; the last level cache,
+// or BIT_STORE_THRESHOLD, from init_kernels()
+static _Atomic uint64_t bit_store_threshold;
 
-static unsigned const char lsbmask[] = {0x01, 0x03, 0x07, 0x0F,
-                                        0x1F, 0x3F, 0x7F, 0xFF};
+// Bytes of a bitset above which its single-bitset kernels run on the
+// threads; BIT_PARALLEL_BYTES, or BIT_PARALLEL_THRESHOLD, from init_kernels()
+static _Atomic uint64_t bit_parallel_threshold;
+
+// Process-wide tuning of the CPU count kernels, set up by init_tuning()
+static Bit_tuning bit_tuning;
+static bool bit_tuning_ready = false;
+
+// Profile names of the Bit_tuning_block variants
+#define TUNING_BLOCK_NAME(arg, tag, rows, cols, vec_blk) #tag,
+static const char *const bit_tuning_block_names[] = {
+    BIT_TUNING_BLOCKS(TUNING_BLOCK_NAME, _) "sliced", "recursive"};
+#undef TUNING_BLOCK_NAME
 
 /* --- End Section 6: STATIC DATA --- */
 
@@ -67,10 +291,81 @@ static unsigned const char lsbmask[] = {0x01, 0x03, 0x07, 0x0F,
    ===========================================================================
  */
 
-// Bitset copy helper (used by single-bitset set-operation macros)
+// Bitset copy helpers (used by the destination-supplied set operations)
 // Forward declarations
-static T copy(T t);
+static inline void copy_into(T dst, T src);
+static inline void clear_into(T dst);
 static void *portable_aligned_calloc(size_t alignment, size_t size);
+static void portable_aligned_free(void *ptr);
+static void bitset_init(T set, int length, uint64_t *qwords);
+static void pool_grow(Bit_pool_T pool);
+static inline void pool_release(Bit_pool_T pool, T set);
+static const bit_kernel_table *select_kernels(void);
+static void init_kernels(void) __attribute__((constructor));
+static inline void range_apply(T set, int lo, int hi, range_op op);
+static void expr_validate(const Bit_expr_op program[], int nops,
+                          T operands[], int noperands, unsigned int length,
+                          bool allow_row);
+static inline int select_in_word(uint64_t word, int k);
+static inline int db_row_count(T_DB set, unsigned int index);
+static void db_storage_free(T_DB set);
+static void *pinned_calloc(size_t size);
+static void pinned_free(void *ptr);
+static void *huge_calloc(size_t size, Bit_page_policy pages);
+static Bit_page_policy huge_pages(const void *ptr);
+static void huge_free(void *ptr);
+static void db_grow(T_DB set, size_t capacity);
+#if BIT_DB_COW
+static void db_cow_grow(T_DB set, size_t capacity);
+#endif
+static uint64_t db_checksum(const void *data, size_t nbytes);
+static void db_wrap(T_DB set, unsigned int length, unsigned int nelem,
+                    void *rows);
+static void db_count_stream(bit_setop_id op, T_DB bit,
+                            int next_block(void *cl, void *rows, int max_rows,
+                                           int row_bytes),
+                            void *block_cl, int block_rows,
+                            void emit(void *cl, size_t first_row, int nrows,
+                                      const int *counts),
+                            void *emit_cl, SETOP_COUNT_OPTS opts);
+static void db_slice(T_DB slice, T_DB set, unsigned int first,
+                     unsigned int nelem);
+static void db_count_tiles(bit_setop_id op, T_DB bit, T_DB bits,
+                           SETOP_COUNT_OPTS opts,
+                           void fold(void *cl, int first_query, int nquery,
+                                     int first_target, int ntarget,
+                                     const int *tile),
+                           void *cl);
+static int *db_row_cards(T_DB set, SETOP_COUNT_OPTS opts);
+static void db_count_store(bit_setop_id op, T_DB bit, T_DB bits, int *counts,
+                           SETOP_COUNT_OPTS opts);
+static inline bool tuning_valid(Bit_tuning tuning);
+static void init_tuning(void);
+static double tuning_time(T_DB bit, T_DB bits, int *counts,
+                          SETOP_COUNT_OPTS opts);
+static inline size_t self_packed_offset(size_t n, size_t i, size_t j);
+static void db_count_self(bit_setop_id op, T_DB set, int *counts,
+                          Bit_self_layout layout, SETOP_COUNT_OPTS opts);
+static uint64_t *bit_summary(T set);
+static inline void summary_touch_set(T set, size_t lo, size_t hi);
+static inline void summary_touch_changed(T set, size_t lo, size_t hi);
+static void summary_touch_indices(T set, const int indices[], int n,
+                                  bool set_bits);
+static void bit_setop_into(bit_setop_id op, T dst, T s, T t);
+#if BIT_DB_MMAP_FILES
+static bool writer_pwrite(int fd, const void *data, size_t n, off_t offset);
+#endif
+static void db_summary_rows(T_DB set, size_t first, size_t n);
+static void db_make_room(T_DB set, size_t n);
+static void db_log_row(T_DB set, size_t index, bool before);
+static void changes_free(bit_db_changes *log);
+static void db_query_count_summary(bit_setop_id op, T q, const uint64_t *a,
+                                   T_DB db, int *counts,
+                                   SETOP_COUNT_OPTS opts);
+static void postings_free(bit_db_postings *postings);
+static void hashes_free(bit_db_hashes *hashes);
+static bool db_query_count_postings(bit_setop_id op, T q, T_DB db,
+                                    int *counts, SETOP_COUNT_OPTS opts);
 
 /* TODO: add new CPU/GPU helper forward declarations here */
 
@@ -84,14 +379,16 @@ static void *portable_aligned_calloc(size_t alignment, size_t size);
 
 /* --- 8a. Bitset copy --- */
 
-static T copy(T t) {
-  T set;
-  assert(t);
-  set = Bit_new(t->length);
-  if (t->length > 0) {
-    memcpy(set->bytes, t->bytes, t->size_in_bytes);
+static inline void copy_into(T dst, T src) {
+  if (dst != src) {
+    memcpy(dst->qwords, src->qwords, src->size_in_qwords * sizeof(uint64_t));
+    SUMMARY_INVALIDATE(dst);
   }
-  return set;
+}
+
+static inline void clear_into(T dst) {
+  memset(dst->qwords, 0, dst->size_in_qwords * sizeof(uint64_t));
+  SUMMARY_INVALIDATE(dst);
 }
 
 /* --- 8b. Portable aligned calloc ---
@@ -127,570 +424,9340 @@ static void *portable_aligned_calloc(size_t alignment, size_t size) {
   return ptr;
 }
 
-/* --- End Section 8: INTERNAL HELPER FUNCTION DEFINITIONS --- */
-
-/* ===========================================================================
-   SECTION 10: PUBLIC API — SINGLE BITSET (Bit_T)
-   ===========================================================================
- */
-
-/* --- 10a. Lifecycle: create, destroy, load from external buffer --- */
+/* Releases a block obtained from portable_aligned_calloc */
+static void portable_aligned_free(void *ptr) {
+  if (ptr)
+    free(*((void **)ptr - 1));
+}
 
-T Bit_new(int length) {
-  assert(length > 0);
-  assert(length < INT_MAX); // limit to 2^30 bits
-  T set = malloc(sizeof(*set));
+/* Fills in a header whose payload lives at qwords */
+static void bitset_init(T set, int length, uint64_t *qwords) {
   set->length = length;
-
   set->size_in_qwords = nqwords(length);
   set->size_in_bytes = set->size_in_qwords * BPQW / BPB;
+  set->qwords = qwords;
+  set->bytes = (unsigned char *)qwords;
+  set->rank = NULL;
+  set->rank_valid = false;
+  set->summary = NULL;
+  set->summary_valid = false;
+  set->count_valid = false;
+  set->pool = NULL;
+}
 
-  set->qwords = calloc(set->size_in_bytes, sizeof(unsigned char));
-  assert(set->qwords != NULL);
+/* --- 8b'. Bitset pool slabs ---
+   A slab is one aligned block of per_slab [header | payload] strides, laid
+   out exactly as a Bit_new allocation. Free bitsets are kept on a LIFO
+   stack, so both Bit_pool_get and Bit_free of a pooled bitset are O(1).
+*/
 
-  set->bytes = (unsigned char *)set->qwords;
+static void pool_grow(Bit_pool_T pool) {
+  size_t stride = BIT_HEADER_SIZE + pool->size_in_qwords * sizeof(uint64_t);
+  unsigned char *slab =
+      portable_aligned_calloc(ALIGNMENT, stride * pool->per_slab);
+  assert(slab != NULL);
+  bit_mem_charge(BIT_MEM_BITSETS, (int64_t)(stride * pool->per_slab));
 
-  set->is_Bit_T_allocated = true; // allocated by the library
-  return set;
-}
+  pool->slabs = realloc(pool->slabs, (pool->nslabs + 1) * sizeof(void *));
+  assert(pool->slabs != NULL);
+  pool->slabs[pool->nslabs++] = slab;
+  pool->free_list = realloc(pool->free_list, (size_t)pool->nslabs *
+                                                 pool->per_slab * sizeof(T));
+  assert(pool->free_list != NULL);
 
-// return a pointer to the original buffer (if externally loaded) or NULL
-// otherwise
-void *Bit_free(T *set) {
-  assert(set && *set);
-  void *original_location = (void *)(*set)->qwords;
-  if ((*set)->is_Bit_T_allocated) {
-    original_location = NULL;
-    free((*set)->qwords);
-    (*set)->qwords = NULL;
-    (*set)->bytes = NULL; // set bytes to NULL after freeing qwords
+  // push in reverse so that bitsets are handed out in address order
+  for (unsigned int i = pool->per_slab; i-- > 0;) {
+    T set = (T)(slab + i * stride);
+    bitset_init(set, pool->length,
+                (uint64_t *)((unsigned char *)set + BIT_HEADER_SIZE));
+    set->is_Bit_T_allocated = true;
+    set->pool = pool;
+    pool->free_list[pool->nfree++] = set;
   }
-  free(*set);
-  *set = NULL;
-  return original_location;
 }
 
-T Bit_load(int length, void *buffer) {
-  assert(length > 0);
-  assert(length < INT_MAX); // limit to 2^30 bits
-  assert(buffer != NULL);
+static inline void pool_release(Bit_pool_T pool, T set) {
+  pool->free_list[pool->nfree++] = set;
+}
 
-  T set = malloc(sizeof(*set));
-  set->length = length;
+/* --- 8c. Runtime ISA dispatch ---
+   Picks the widest kernel variant the CPU supports. The environment variable
+   BIT_FORCE_ISA=<name> overrides the choice with any variant that is also
+   supported (e.g. to compare AVX2 and AVX-512 on the same host).
+*/
 
-  set->size_in_qwords = nqwords(length);
-  set->size_in_bytes = set->size_in_qwords * BPQW / BPB;
+static const bit_kernel_table *select_kernels(void) {
+#if BIT_ISA_DISPATCH && defined(__aarch64__)
+  static const bit_kernel_table *const variants[] = {&bit_kernels_sve,
+                                                     &bit_kernels_neon};
+  const int nvariants = sizeof(variants) / sizeof(variants[0]);
+#if defined(__linux__) && defined(HWCAP_SVE)
+  bool sve = (getauxval(AT_HWCAP) & HWCAP_SVE) != 0;
+#else
+  bool sve = false;
+#endif
+  bool supported[] = {sve, true};
+  const char *forced = getenv("BIT_FORCE_ISA");
+  for (int i = 0; forced && i < nvariants; i++) {
+    if (supported[i] && strcmp(forced, variants[i]->isa) == 0)
+      return variants[i];
+  }
+  return sve ? &bit_kernels_sve : &bit_kernels_neon;
+#elif BIT_ISA_DISPATCH
+  static const bit_kernel_table *const variants[] = {
+      &bit_kernels_avx512vpopcnt, &bit_kernels_avx512, &bit_kernels_avx2,
+      &bit_kernels_sse42, &bit_kernels_scalar};
+  const int nvariants = sizeof(variants) / sizeof(variants[0]);
+  __builtin_cpu_init();
+  bool avx512 = __builtin_cpu_supports("avx512f") &&
+                __builtin_cpu_supports("avx512bw") &&
+                __builtin_cpu_supports("avx512dq") &&
+                __builtin_cpu_supports("avx512vl");
+  bool supported[] = {
+      avx512 && __builtin_cpu_supports("avx512vpopcntdq"),
+      avx512,
+      __builtin_cpu_supports("avx2") && __builtin_cpu_supports("bmi2") &&
+          __builtin_cpu_supports("fma"),
+      __builtin_cpu_supports("sse4.2") && __builtin_cpu_supports("popcnt"),
+      true,
+  };
+  const char *forced = getenv("BIT_FORCE_ISA");
+  for (int i = 0; forced && i < nvariants; i++) {
+    if (supported[i] && strcmp(forced, variants[i]->isa) == 0)
+      return variants[i];
+  }
+  for (int i = 0; i < nvariants; i++) {
+    if (supported[i])
+      return variants[i];
+  }
+  return &bit_kernels_scalar;
+#else
+  return &bit_kernels_native;
+#endif
+}
 
-  set->bytes = (unsigned char *)buffer;
-  set->qwords = (uint64_t *)buffer; // set qwords to point to the buffer
-  set->is_Bit_T_allocated = false;  // not allocated by the library
-  return set;
+/* The AVX2 table of a host whose widest table is an AVX-512 one, which
+   runs AVX2 as well; widest itself elsewhere */
+static const bit_kernel_table *select_narrow(const bit_kernel_table *widest) {
+#if BIT_ISA_DISPATCH && !defined(__aarch64__)
+  if (strncmp(widest->isa, "avx512", 6) == 0)
+    return &bit_kernels_avx2;
+#endif
+  return widest;
 }
 
-int Bit_extract(T set, void *buffer) {
-  assert(set);
-  assert(buffer != NULL);
-  // Copy the bytes from the bitset to the buffer
-  memcpy(buffer, set->bytes, set->size_in_bytes);
-  return set->size_in_bytes; // return the number of bytes written
+/* Bytes of the last level cache of this host, or 32 MiB if unknown */
+static uint64_t llc_bytes(void) {
+  long bytes = -1;
+#ifdef _SC_LEVEL3_CACHE_SIZE
+  bytes = sysconf(_SC_LEVEL3_CACHE_SIZE);
+  if (bytes <= 0)
+    bytes = sysconf(_SC_LEVEL2_CACHE_SIZE);
+#endif
+  return bytes > 0 ? (uint64_t)bytes : UINT64_C(32) << 20;
 }
 
-/* --- 10b. Properties --- */
+static void init_kernels(void) {
+  if (!bit_kernels) {
+    const bit_kernel_table *widest = select_kernels();
+    bit_kernels_narrow = select_narrow(widest);
+    const char *threshold = getenv("BIT_ISA_THRESHOLD");
+    if (threshold)
+      atomic_store_explicit(&bit_isa_threshold, strtoull(threshold, NULL, 10),
+                            memory_order_relaxed);
+    const char *store = getenv("BIT_STORE_THRESHOLD");
+    atomic_store_explicit(&bit_store_threshold,
+                          store ? strtoull(store, NULL, 10) : llc_bytes(),
+                          memory_order_relaxed);
+    const char *parallel = getenv("BIT_PARALLEL_THRESHOLD");
+    atomic_store_explicit(&bit_parallel_threshold,
+                          parallel ? strtoull(parallel, NULL, 10)
+                                   : BIT_PARALLEL_BYTES,
+                          memory_order_relaxed);
+    bit_kernels = widest;
+  }
+}
 
-int Bit_length(T set) {
-  assert(set);
-  return set->length;
+/* Kernel table of a count of bit against bits: the narrow one by
+   opts.isa, or for BIT_ISA_AUTO when the work is below the threshold */
+static const bit_kernel_table *count_kernels(T_DB bit, T_DB bits,
+                                             SETOP_COUNT_OPTS opts) {
+  init_kernels();
+  if (opts.isa == BIT_ISA_NARROW)
+    return bit_kernels_narrow;
+  if (opts.isa == BIT_ISA_WIDEST)
+    return bit_kernels;
+  const uint64_t work =
+      (uint64_t)bit->nelem * bits->nelem * bit->size_in_qwords;
+  return work < atomic_load_explicit(&bit_isa_threshold, memory_order_relaxed)
+             ? bit_kernels_narrow
+             : bit_kernels;
 }
 
-int Bit_count(T set) {
-  assert(set);
-  int length = 0;
-#if !USE_LIBPOPCNT
-size_t limit = (set->size_in_qwords / VECTOR_BLOCK_SIZE) * VECTOR_BLOCK_SIZE;
-  size_t i = 0;
+const bit_kernel_table *bit_kernels_active(void) {
+  init_kernels();
+  return bit_kernels;
+}
 
-  VECTOR_TYPE sum0 = SIMDe_ZERO_VECTOR;
-  VECTOR_TYPE sum1 = SIMDe_ZERO_VECTOR;
-  VECTOR_TYPE sum2 = SIMDe_ZERO_VECTOR;
-  VECTOR_TYPE sum3 = SIMDe_ZERO_VECTOR;
+/* --- 8c'. CPU tile tuning ---
+   The process-wide tuning is set up on first use: from the profile named by
+   BIT_TUNING_PROFILE if it loads, from the compiled-in values otherwise.
+*/
 
-  for (; i < limit; i += VECTOR_BLOCK_SIZE) {
-    sum0 = SIMDe_VECTOR_ADD(sum0, SIMDe_POPCOUNT(
-        VECTOR_UNALIGNED_LOAD((VECTOR_TYPE *)&set->qwords[i + VECTOR_OFFSET(0)])));
-    
-    sum1 = SIMDe_VECTOR_ADD(sum1, SIMDe_POPCOUNT(
-        VECTOR_UNALIGNED_LOAD((VECTOR_TYPE *)&set->qwords[i + VECTOR_OFFSET(1)])));
-    
-    sum2 = SIMDe_VECTOR_ADD(sum2, SIMDe_POPCOUNT(
-        VECTOR_UNALIGNED_LOAD((VECTOR_TYPE *)&set->qwords[i + VECTOR_OFFSET(2)])));
-    
-    sum3 = SIMDe_VECTOR_ADD(sum3, SIMDe_POPCOUNT(
-        VECTOR_UNALIGNED_LOAD((VECTOR_TYPE *)&set->qwords[i + VECTOR_OFFSET(3)])));
-  }
+static inline bool tuning_valid(Bit_tuning tuning) {
+  return tuning.block >= 0 && tuning.block < BIT_TUNING_BLOCK_COUNT &&
+         tuning.tile >= 1 && tuning.k_block >= 8 && tuning.k_block % 8 == 0 &&
+         tuning.prefetch >= 0 && tuning.prefetch <= BIT_TUNING_MAX_PREFETCH;
+}
 
-  // Reduce 4 accumulators down to 1 (Optimal binary reduction tree)
-  sum0 = SIMDe_VECTOR_ADD(sum0, sum1);
-  sum2 = SIMDe_VECTOR_ADD(sum2, sum3);
-  sum0 = SIMDe_VECTOR_ADD(sum0, sum2);
+static void init_tuning(void) {
+  if (bit_tuning_ready)
+    return;
+  bit_tuning = Bit_tuning_defaults();
+  bit_tuning_ready = true;
+  const char *profile = getenv("BIT_TUNING_PROFILE");
+  if (profile)
+    Bit_tuning_load(profile);
+}
 
-  // Extract vector elements to scalar
-  uint64_t sum_array[VECTOR_QWORDS];
-  SIMDe_STORE_VECTOR(sum_array, sum0); 
-  
-  for (size_t j = 0; j < VECTOR_QWORDS; j++) {
-    length += sum_array[j];
+Bit_tuning bit_tuning_resolve(SETOP_COUNT_OPTS opts) {
+  if (opts.tuning) {
+    assert(tuning_valid(*opts.tuning));
+    return *opts.tuning;
   }
+  if (opts.ctx)
+    return opts.ctx->tuning;
+  init_tuning();
+  return bit_tuning;
+}
 
-  // Handle remaining elements (Fringe)
-  for (; i < set->size_in_qwords; i++) {
-    length += POPCOUNT(set->qwords[i]);
+/* A container of nelem random rows of length bits, from the xorshift64
+   state, for the timing runs */
+static T_DB tuning_random_db(int length, int nelem, uint64_t *state) {
+  T_DB set = BitDB_new(length, nelem);
+  for (unsigned int i = 0; i < set->nelem; i++) {
+    uint64_t *row = set->qwords + (size_t)i * set->stride_in_qwords;
+    for (unsigned int w = 0; w < set->size_in_qwords; w++) {
+      *state ^= *state << 13; // xorshift64
+      *state ^= *state >> 7;
+      *state ^= *state << 17;
+      row[w] = *state;
+    }
+    if (length % BPQW) // keep the bits past the length clear
+      row[set->size_in_qwords - 1] &= (UINT64_C(1) << (length % BPQW)) - 1;
   }
-#else
-  length = (int)popcnt(set->bytes, set->size_in_bytes);
-#endif
-  return length;
+  return set;
 }
 
-int Bit_buffer_size(int length) {
-  assert(length > 0);
-  return nqwords(length) * BPQW / BPB;
+/* Best of three timed intersection count runs, after a warm-up run */
+static double tuning_time(T_DB bit, T_DB bits, int *counts,
+                          SETOP_COUNT_OPTS opts) {
+  const bit_kernel_table *k = bit_kernels_active();
+  double best = -1;
+  k->setop_count_db[BIT_OP_AND](bit, bits, counts, opts);
+  for (int run = 0; run < 3; run++) {
+    double start = omp_get_wtime();
+    k->setop_count_db[BIT_OP_AND](bit, bits, counts, opts);
+    double elapsed = omp_get_wtime() - start;
+    if (best < 0 || elapsed < best)
+      best = elapsed;
+  }
+  return best;
 }
 
-/* --- 10c. Member operations (set, clear, get, map individual bits) --- */
+/* --- 8c'''. Calibrated CPU throughput ---
+   Word pairs per second of the intersection counts of the process-wide
+   tuning, and bytes per second of rows streamed past a single query, by
+   team size. Bit_tuning_autotune records the rate of its winner, the rest
+   is measured on the first BitDB_estimate of a team, and Bit_tuning_set
+   drops both. */
+#ifndef BIT_CALIBRATION_THREADS
+#define BIT_CALIBRATION_THREADS 256
+#endif
+#ifndef BIT_CALIBRATION_STREAM_BYTES
+#define BIT_CALIBRATION_STREAM_BYTES (32u << 20)
+#endif
 
-void Bit_aset(T set, int indices[], int n) {
-  assert(set);
-  assert(indices);
-  for ( int i = 0; i < n; i++) {
-    assert(indices[i] >= 0 && indices[i] < (int)set->length);
-    set->bytes[indices[i] / BPB] |= 1 << (indices[i] % BPB);
-  }
+typedef struct {
+  double rate;      // word pairs per second, 0: not measured
+  double bandwidth; // bytes per second, 0: not measured
+} cpu_calibration;
+
+// under critical(bit_calibration)
+static cpu_calibration cpu_calibrations[BIT_CALIBRATION_THREADS + 1];
+
+static int calibration_slot(SETOP_COUNT_OPTS opts) {
+  const int threads = cpu_threads(opts);
+  return threads < BIT_CALIBRATION_THREADS ? threads : BIT_CALIBRATION_THREADS;
 }
-void Bit_aclear(T set, int indices[], int n) {
-  assert(set);
-  assert(indices);
-  for ( int i = 0; i < n; i++) {
-    assert(indices[i] >= 0 && indices[i] < (int)set->length);
-    set->bytes[indices[i] / BPB] &= ~(1 << (indices[i] % BPB));
+
+void bit_cpu_calibration(SETOP_COUNT_OPTS opts, double *rate,
+                         double *bandwidth) {
+  const int slot = calibration_slot(opts);
+  cpu_calibration calibration;
+#pragma omp critical(bit_calibration)
+  calibration = cpu_calibrations[slot];
+  opts = bit_stop_ignored(opts);
+  opts.tuning = NULL;
+  opts.ctx = NULL;
+  uint64_t state = UINT64_C(0x9E3779B97F4A7C15);
+  if (calibration.rate == 0) { // 256 x 256 rows of 1024 bits stay in cache
+    T_DB queries = tuning_random_db(1024, 256, &state);
+    T_DB targets = tuning_random_db(1024, 256, &state);
+    int *counts = malloc(BitDB_counts_size(queries, targets) * sizeof(int));
+    assert(counts != NULL);
+    const double elapsed = tuning_time(queries, targets, counts, opts);
+    calibration.rate = (double)queries->nelem * targets->nelem *
+                       queries->size_in_qwords /
+                       (elapsed > 0 ? elapsed : 1e-9);
+    free(counts);
+    BitDB_free(&queries);
+    BitDB_free(&targets);
   }
-}
-void Bit_bset(T set, int index) {
-  assert(set);
-  assert(index >= 0 && index < (int)set->length);
-  set->bytes[index / BPB] |= 1 << (index % BPB);
+  if (calibration.bandwidth == 0) { // one query past rows no cache holds
+    const int nelem = BIT_CALIBRATION_STREAM_BYTES / 128; // 1024-bit rows
+    T_DB query = tuning_random_db(1024, 1, &state);
+    T_DB rows = tuning_random_db(1024, nelem, &state);
+    int *counts = malloc((size_t)nelem * sizeof(int));
+    assert(counts != NULL);
+    const double elapsed = tuning_time(query, rows, counts, opts);
+    calibration.bandwidth = (double)rows->nelem * rows->stride_in_qwords *
+                            sizeof(uint64_t) / (elapsed > 0 ? elapsed : 1e-9);
+    free(counts);
+    BitDB_free(&query);
+    BitDB_free(&rows);
+  }
+#pragma omp critical(bit_calibration)
+  cpu_calibrations[slot] = calibration;
+  *rate = calibration.rate;
+  *bandwidth = calibration.bandwidth;
 }
 
-void Bit_bclear(T set, int index) {
-  assert(set);
-  assert(index >= 0 && index < (int)set->length);
-  set->bytes[index / BPB] &= ~(1 << (index % BPB));
+/* --- 8c''. Word-range splits of long bitsets ---
+   One core streams a bitset at a fraction of the bandwidth of the memory,
+   so past the threshold the single-bitset kernels run over contiguous,
+   aligned word ranges, one per thread, through stack Bit_T headers. The
+   ranges are the same from call to call, so with bound threads each range
+   stays with the core, and the NUMA node, that first touched it; the
+   runtime keeps its team between calls, so a split costs a wake-up, not a
+   fork. Calls from inside a parallel region stay on their thread.
+*/
+
+/* Word ranges of a bitset of nq qwords: 1 below the threshold */
+static int split_chunks(size_t nq) {
+  init_kernels();
+  const uint64_t bytes = (uint64_t)nq * sizeof(uint64_t);
+  if (bytes < atomic_load_explicit(&bit_parallel_threshold,
+                                   memory_order_relaxed) ||
+      omp_in_parallel())
+    return 1;
+  const uint64_t most = bytes / BIT_PARALLEL_CHUNK_BYTES;
+  const int threads = omp_get_max_threads();
+  return most < 2 ? 1 : most < (uint64_t)threads ? (int)most : threads;
 }
 
-void Bit_clear(T set, int lo, int hi) {
-  assert(set);
-  assert(0 <= lo && hi < (int)set->length);
-  assert(lo <= hi);
-  if (lo / 8 < hi / 8) {
-    // clear the most significant bits in byte lo/8
-    set->bytes[lo / 8] &= ~msbmask[lo % 8];
-    // clear the least significant bits in byte hi/8
-    set->bytes[hi / 8] &= ~lsbmask[hi % 8];
-    // clear the bits in between
-    for (int i = lo / 8 + 1; i < hi / 8; i++)
-      set->bytes[i] = 0;
-
-  } else // lo and hi are in the same byte
-    set->bytes[lo / 8] &= ~(msbmask[lo % 8] & lsbmask[hi % 8]);
+/* Stack Bit_T header over qwords [first, first + nq) of set */
+static struct T split_view(T set, size_t first, size_t nq) {
+  return (struct T){.length = (unsigned int)(nq * BPQW),
+                    .size_in_bytes = (unsigned int)(nq * sizeof(uint64_t)),
+                    .size_in_qwords = (unsigned int)nq,
+                    .bytes = (unsigned char *)(set->qwords + first),
+                    .qwords = set->qwords + first};
 }
-int Bit_get(T set, int index) {
-  assert(set);
-  assert(index >= 0 && index < (int)set->length);
-  return ((set->bytes[index / BPB] >> (index % BPB)) & 1);
+
+/* Qwords [*first, *first + *nq) of range c of n over nq qwords, whole
+   ALIGNMENT blocks but for the last */
+static void split_range(size_t nq, int n, int c, size_t *first, size_t *len) {
+  const size_t align = ALIGNMENT / sizeof(uint64_t);
+  const size_t per = ((nq + (size_t)n - 1) / (size_t)n + align - 1) / align *
+                     align;
+  *first = (size_t)c * per < nq ? (size_t)c * per : nq;
+  *len = *first + per < nq ? per : nq - *first;
 }
 
-void Bit_map(T set, void apply(int n, int bit, void *cl), void *cl) {
-  assert(set);
-  for (unsigned int i = 0; i < set->length; i++) {
-    apply(i, ((set->bytes[i / BPB] >> (i % BPB)) & 1), cl);
+static int split_count(T set) {
+  int (*count)(T) = bit_kernels_active()->count;
+  const int n = split_chunks(set->size_in_qwords);
+  if (n == 1)
+    return count(set);
+  int total = 0;
+#pragma omp parallel for num_threads(n) schedule(static) reduction(+ : total)
+  for (int c = 0; c < n; c++) {
+    size_t first, len;
+    split_range(set->size_in_qwords, n, c, &first, &len);
+    struct T v = split_view(set, first, len);
+    total += len ? count(&v) : 0;
   }
+  return total;
 }
 
-void Bit_not(T set, int lo, int hi) {
-  assert(set);
-  assert(0 <= lo && hi < (int)set->length);
-  assert(lo <= hi);
-  if (lo / 8 < hi / 8) {
-    // clear the most significant bits in byte lo/8
-    set->bytes[lo / 8] ^= msbmask[lo % 8];
-    // clear the least significant bits in byte hi/8
-    set->bytes[hi / 8] ^= lsbmask[hi % 8];
-    // clear the bits in between
-    for (int i = lo / 8 + 1; i < hi / 8; i++)
-      set->bytes[i] = ~set->bytes[i];
-
-  } else // lo and hi are in the same byte
-    set->bytes[lo / 8] ^= (msbmask[lo % 8] & lsbmask[hi % 8]);
-}
-int Bit_put(T set, int index, int bit) {
-  int prev;
-  assert(set);
-  assert(bit == 0 || bit == 1);
-  assert(0 <= index && (unsigned int)index < set->length);
-  prev = ((set->bytes[index / BPB] >> (index % BPB)) & 1);
-  if (bit == 1)
-    set->bytes[index / BPB] |= 1 << (index % BPB);
-  else
-    set->bytes[index / BPB] &= ~(1 << (index % BPB));
-  return prev;
+static int split_setop_count(bit_setop_id op, T s, T t) {
+  int (*kernel)(T, T) = bit_kernels_active()->setop_count[op];
+  const int n = split_chunks(s->size_in_qwords);
+  if (n == 1)
+    return kernel(s, t);
+  int total = 0;
+#pragma omp parallel for num_threads(n) schedule(static) reduction(+ : total)
+  for (int c = 0; c < n; c++) {
+    size_t first, len;
+    split_range(s->size_in_qwords, n, c, &first, &len);
+    struct T a = split_view(s, first, len), b = split_view(t, first, len);
+    total += len ? kernel(&a, &b) : 0;
+  }
+  return total;
 }
 
-void Bit_set(T set, int lo, int hi) {
-  assert(set);
-  assert(0 <= lo && hi < (int)set->length);
-  assert(lo <= hi);
-  if (lo / 8 < hi / 8) {
-    // set the most significant bits in byte lo/8
-    set->bytes[lo / 8] |= msbmask[lo % 8];
-    // clear the least significant bits in byte hi/8
-    set->bytes[hi / 8] |= lsbmask[hi % 8];
-    // clear the bits in between
-    for (int i = lo / 8 + 1; i < hi / 8; i++)
-      set->bytes[i] = 0xFF;
-
-  } else // lo and hi are in the same byte
-    set->bytes[lo / 8] |= (msbmask[lo % 8] & lsbmask[hi % 8]);
+static int split_setop_any(bit_setop_id op, T s, T t) {
+  int (*kernel)(T, T) = bit_kernels_active()->setop_any[op];
+  const int n = split_chunks(s->size_in_qwords);
+  if (n == 1)
+    return kernel(s, t);
+  _Atomic int found = 0;
+#pragma omp parallel for num_threads(n) schedule(static)
+  for (int c = 0; c < n; c++) {
+    size_t first, len;
+    split_range(s->size_in_qwords, n, c, &first, &len);
+    // a range another thread settled the answer for is skipped
+    if (len == 0 || atomic_load_explicit(&found, memory_order_relaxed))
+      continue;
+    struct T a = split_view(s, first, len), b = split_view(t, first, len);
+    if (kernel(&a, &b))
+      atomic_store_explicit(&found, 1, memory_order_relaxed);
+  }
+  return atomic_load(&found);
 }
-/* --- 10d. Comparisons --- */
 
-int Bit_eq(T s, T t) {
-  assert(s && t);
-  assert(s->length == t->length);
-  for ( int i = s->size_in_qwords; --i >= 0;)
-    if (s->qwords[i] != t->qwords[i])
-      return 0;
-  return 1;
+static void split_setop(bit_setop_id op, T dst, T s, T t) {
+  void (*kernel)(T, T, T) = bit_kernels_active()->setop[op];
+  const int n = split_chunks(dst->size_in_qwords);
+  if (n == 1) {
+    kernel(dst, s, t);
+    return;
+  }
+#pragma omp parallel for num_threads(n) schedule(static)
+  for (int c = 0; c < n; c++) {
+    size_t first, len;
+    split_range(dst->size_in_qwords, n, c, &first, &len);
+    if (len == 0)
+      continue;
+    struct T d = split_view(dst, first, len), a = split_view(s, first, len),
+             b = split_view(t, first, len);
+    kernel(&d, &a, &b);
+  }
 }
 
-int Bit_leq(T s, T t) {
-  assert(s && t);
-  assert(s->length == t->length);
-  for ( int i = s->size_in_qwords; --i >= 0;)
-    if ((s->qwords[i] & ~t->qwords[i]) != 0)
-      return 0;
-  return 1;
+/* --- 8d. Qword range kernel ---
+   Applies op to the bits [lo, hi]. The partial head and tail qwords are
+   updated through masks; the full qwords in between are filled with memset
+   (set/clear) or inverted in a SIMD loop (flip).
+*/
+
+static inline void range_apply(T set, int lo, int hi, range_op op) {
+  RANK_INVALIDATE(set);
+  uint64_t *qwords = set->qwords;
+  size_t lo_word = (size_t)lo / BPQW;
+  size_t hi_word = (size_t)hi / BPQW;
+  uint64_t head = ~UINT64_C(0) << (lo % BPQW);
+  uint64_t tail = ~UINT64_C(0) >> (BPQW - 1 - hi % BPQW);
+
+  if (lo_word == hi_word) {
+    head &= tail;
+    tail = 0;
+  }
+  switch (op) {
+  case RANGE_SET:
+    qwords[lo_word] |= head;
+    qwords[hi_word] |= tail;
+    break;
+  case RANGE_CLEAR:
+    qwords[lo_word] &= ~head;
+    qwords[hi_word] &= ~tail;
+    break;
+  case RANGE_FLIP:
+    qwords[lo_word] ^= head;
+    qwords[hi_word] ^= tail;
+    break;
+  }
+  if (hi_word > lo_word + 1) {
+    uint64_t *middle = qwords + lo_word + 1;
+    size_t nwords = hi_word - lo_word - 1;
+    switch (op) {
+    case RANGE_SET:
+      memset(middle, 0xFF, nwords * sizeof(uint64_t));
+      break;
+    case RANGE_CLEAR:
+      memset(middle, 0, nwords * sizeof(uint64_t));
+      break;
+    case RANGE_FLIP:
+      OMP_CPU_SIMD
+      for (size_t i = 0; i < nwords; i++)
+        middle[i] = ~middle[i];
+      break;
+    }
+  }
+  if (op == RANGE_SET)
+    summary_touch_set(set, (size_t)lo, (size_t)hi);
+  else
+    summary_touch_changed(set, (size_t)lo, (size_t)hi);
 }
 
-int Bit_lt(T s, T t) {
-  assert(s && t);
-  assert(s->length == t->length);
-  int lt = 0;
-  for ( int i = s->size_in_qwords; --i >= 0;)
-    if ((s->qwords[i] & ~t->qwords[i]) != 0)
-      return 0;
-    else if ((s->qwords[i] & t->qwords[i]) != 0)
-      lt |= 1;
-  return lt;
+/* --- 8e. Fused count expression validation ---
+   Walks the program once to check the stack discipline and the operands,
+   so that the ISA kernels can run it without any checks.
+*/
+
+static void expr_validate(const Bit_expr_op program[], int nops,
+                          T operands[], int noperands, unsigned int length,
+                          bool allow_row) {
+  assert(program && nops > 0);
+  assert(noperands == 0 || operands);
+  int depth = 0, next = 0;
+  for (int p = 0; p < nops; p++) {
+    switch (program[p]) {
+    case BIT_EXPR_PUSH:
+      assert(next < noperands);
+      assert(operands[next] && operands[next]->length == length);
+      next++;
+      depth++;
+      break;
+    case BIT_EXPR_PUSH_ROW:
+      assert(allow_row);
+      depth++;
+      break;
+    case BIT_EXPR_NOT:
+      assert(depth >= 1);
+      break;
+    case BIT_EXPR_AND:
+    case BIT_EXPR_OR:
+    case BIT_EXPR_XOR:
+    case BIT_EXPR_AND_NOT:
+      assert(depth >= 2);
+      depth--;
+      break;
+    default:
+      assert(!"unknown Bit_expr_op");
+    }
+    assert(depth <= BIT_EXPR_MAX_DEPTH);
+  }
+  assert(depth == 1 && next == noperands);
+  (void)depth;
+  (void)next;
+  (void)allow_row;
 }
-/* --- 10e. Set operations (return a new Bit_T) --- */
 
-T Bit_diff(T s, T t) {
-  setop_validate(Bit_new(s->length), copy(t), copy(s));
-  T set = Bit_new(s->length);
-  setop(set, _XOR, s, t);
-  return set;
+/* --- 8e'. N-way reductions ---
+   The inputs are the rows of a container or an array of bitsets. The
+   output is cut into blocks of BIT_REDUCE_BLOCK qwords, and each block is
+   folded from every input while it is cache resident. When the blocks are
+   fewer than the threads, the inputs are also cut into groups whose
+   partial results are combined at the end. BIT_REDUCE_ATLEAST keeps, for
+   every bit of the block, how many inputs have it as a bit-sliced counter
+   (slice b holds bit b of the counts), adds each input with a ripple carry
+   that stops once no carry is left, and compares the counters with k the
+   way a bit-sliced index compares with a constant.
+*/
+
+typedef struct {
+  const uint64_t *base; // rows of a container, stride qwords apart
+  size_t stride;
+  T *list;              // or bitsets
+  size_t n, nq;         // inputs, qwords of each
+} reduce_src;
+
+static inline const uint64_t *reduce_row(const reduce_src *src, size_t r) {
+  return src->list ? src->list[r]->qwords : src->base + r * src->stride;
 }
-T Bit_minus(T s, T t) {
-  setop_validate(Bit_new(s->length), Bit_new(t->length), copy(s));
-  T set = Bit_new(s->length);
-  setop(set, _AND_NOT, s, t);
-  return set;
+
+/* acc = the op of rows [r0, r1) over qwords [lo, lo + w) */
+static void reduce_fold(const reduce_src *src, Bit_reduce_op op, size_t r0,
+                        size_t r1, size_t lo, size_t w, uint64_t *acc) {
+  const uint64_t init = op == BIT_REDUCE_AND ? ~UINT64_C(0) : 0;
+  for (size_t q = 0; q < w; q++)
+    acc[q] = init;
+  for (size_t r = r0; r < r1; r++) {
+    const uint64_t *row = reduce_row(src, r) + lo;
+    if (r + 1 < r1)
+      __builtin_prefetch(reduce_row(src, r + 1) + lo, 0);
+    if (op == BIT_REDUCE_OR) {
+      OMP_CPU_SIMD
+      for (size_t q = 0; q < w; q++)
+        acc[q] |= row[q];
+    } else if (op == BIT_REDUCE_AND) {
+      OMP_CPU_SIMD
+      for (size_t q = 0; q < w; q++)
+        acc[q] &= row[q];
+    } else {
+      OMP_CPU_SIMD
+      for (size_t q = 0; q < w; q++)
+        acc[q] ^= row[q];
+    }
+  }
 }
-T Bit_inter(T s, T t) {
-  setop_validate(copy(t), Bit_new(t->length), Bit_new(s->length));
-  T set = Bit_new(s->length);
-  setop(set, _AND, s, t);
-  return set;
+
+/* cnt (nslices slices of w qwords) = how many of rows [r0, r1) have each
+   bit of qwords [lo, lo + w) */
+static void reduce_count(const reduce_src *src, size_t r0, size_t r1,
+                         size_t lo, size_t w, int nslices, uint64_t *cnt) {
+  uint64_t carry[BIT_REDUCE_BLOCK];
+  memset(cnt, 0, (size_t)nslices * w * sizeof(uint64_t));
+  for (size_t r = r0; r < r1; r++) {
+    const uint64_t *row = reduce_row(src, r) + lo;
+    if (r + 1 < r1)
+      __builtin_prefetch(reduce_row(src, r + 1) + lo, 0);
+    memcpy(carry, row, w * sizeof(uint64_t));
+    for (int b = 0; b < nslices; b++) {
+      uint64_t *slice = cnt + (size_t)b * w, any = 0;
+#pragma omp simd reduction(| : any)
+      for (size_t q = 0; q < w; q++) {
+        const uint64_t c = slice[q] & carry[q];
+        slice[q] ^= carry[q];
+        carry[q] = c;
+        any |= c;
+      }
+      if (!any)
+        break;
+    }
+  }
 }
 
-T Bit_union(T s, T t) {
-  setop_validate(copy(t), copy(t), copy(s));
-  T set = Bit_new(s->length);
-  setop(set, _OR, s, t);
-  return set;
+/* acc += add, both nslices slices of w qwords */
+static void reduce_slices_add(uint64_t *acc, const uint64_t *add, int nslices,
+                              size_t w) {
+  uint64_t carry[BIT_REDUCE_BLOCK] = {0};
+  for (int b = 0; b < nslices; b++) {
+    uint64_t *x = acc + (size_t)b * w;
+    const uint64_t *y = add + (size_t)b * w;
+    OMP_CPU_SIMD
+    for (size_t q = 0; q < w; q++) {
+      const uint64_t half = x[q] ^ y[q];
+      const uint64_t c = (x[q] & y[q]) | (carry[q] & half);
+      x[q] = half ^ carry[q];
+      carry[q] = c;
+    }
+  }
 }
 
-/* --- 10f. Set operations (return population count of result) --- */
+/* out = the bits whose counter is at least k */
+static void reduce_atleast(const uint64_t *cnt, int nslices, size_t w,
+                           uint64_t k, uint64_t *out) {
+  if (nslices < 64 && k >> nslices) { // more than any counter holds
+    memset(out, 0, w * sizeof(uint64_t));
+    return;
+  }
+  uint64_t lt[BIT_REDUCE_BLOCK], eq[BIT_REDUCE_BLOCK];
+  for (size_t q = 0; q < w; q++) {
+    lt[q] = 0;
+    eq[q] = ~UINT64_C(0);
+  }
+  for (int b = nslices - 1; b >= 0; b--) {
+    const uint64_t *slice = cnt + (size_t)b * w;
+    if ((k >> b) & 1) { // counters with a 0 here fall below k
+      OMP_CPU_SIMD
+      for (size_t q = 0; q < w; q++) {
+        lt[q] |= eq[q] & ~slice[q];
+        eq[q] &= slice[q];
+      }
+    } else {
+      OMP_CPU_SIMD
+      for (size_t q = 0; q < w; q++)
+        eq[q] &= ~slice[q];
+    }
+  }
+  OMP_CPU_SIMD
+  for (size_t q = 0; q < w; q++)
+    out[q] = ~lt[q];
+}
 
-int Bit_diff_count(T s, T t) {
-  setop_validate(0, Bit_count(t), Bit_count(s));
-  setop_count(_XOR, s, t);
+static void reduce_run(const reduce_src *src, Bit_reduce_op op, int k, T out,
+                       int nthreads) {
+  const size_t n = src->n, nq = src->nq;
+  const size_t nblocks = (nq + BIT_REDUCE_BLOCK - 1) / BIT_REDUCE_BLOCK;
+  const bool count = op == BIT_REDUCE_ATLEAST || op == BIT_REDUCE_MAJORITY;
+  const uint64_t atleast = op == BIT_REDUCE_MAJORITY ? n / 2 + 1 : (uint64_t)k;
+  const int nslices = 64 - __builtin_clzll((unsigned long long)n);
+  size_t groups = nblocks >= (size_t)nthreads
+                      ? 1
+                      : ((size_t)nthreads + nblocks - 1) / nblocks;
+  if (groups > n)
+    groups = n;
+  // the partial result of every group and block, (nslices x) a block each
+  const size_t cap = (count ? (size_t)nslices : 1) * BIT_REDUCE_BLOCK;
+  uint64_t *part = portable_aligned_calloc(
+      ALIGNMENT, groups * nblocks * cap * sizeof(uint64_t));
+  assert(part != NULL);
+  const long long ntasks = (long long)(groups * nblocks);
+  const bool parallel = n * nq > BIT_BATCH_PARALLEL_QWORDS;
+#pragma omp parallel for num_threads(nthreads) schedule(dynamic) if (parallel)
+  for (long long task = 0; task < ntasks; task++) {
+    const size_t g = (size_t)task / nblocks, blk = (size_t)task % nblocks;
+    const size_t lo = blk * BIT_REDUCE_BLOCK;
+    const size_t w = nq - lo < BIT_REDUCE_BLOCK ? nq - lo : BIT_REDUCE_BLOCK;
+    const size_t r0 = n * g / groups, r1 = n * (g + 1) / groups;
+    uint64_t *mine = part + (size_t)task * cap;
+    if (count)
+      reduce_count(src, r0, r1, lo, w, nslices, mine);
+    else
+      reduce_fold(src, op, r0, r1, lo, w, mine);
+  }
+#pragma omp parallel for num_threads(nthreads) schedule(static) if (parallel)
+  for (long long blk = 0; blk < (long long)nblocks; blk++) {
+    const size_t lo = (size_t)blk * BIT_REDUCE_BLOCK;
+    const size_t w = nq - lo < BIT_REDUCE_BLOCK ? nq - lo : BIT_REDUCE_BLOCK;
+    uint64_t *acc = part + (size_t)blk * cap, *dst = out->qwords + lo;
+    for (size_t g = 1; g < groups; g++) {
+      const uint64_t *other = part + (g * nblocks + (size_t)blk) * cap;
+      if (count) {
+        reduce_slices_add(acc, other, nslices, w);
+      } else if (op == BIT_REDUCE_OR) {
+        OMP_CPU_SIMD
+        for (size_t q = 0; q < w; q++)
+          acc[q] |= other[q];
+      } else if (op == BIT_REDUCE_AND) {
+        OMP_CPU_SIMD
+        for (size_t q = 0; q < w; q++)
+          acc[q] &= other[q];
+      } else {
+        OMP_CPU_SIMD
+        for (size_t q = 0; q < w; q++)
+          acc[q] ^= other[q];
+      }
+    }
+    if (count)
+      reduce_atleast(acc, nslices, w, atleast, dst);
+    else
+      memcpy(dst, acc, w * sizeof(uint64_t));
+  }
+  portable_aligned_free(part);
+  // bits past the length: zero in every input, but not in a NOT of a count
+  if (out->length % BPQW)
+    out->qwords[nq - 1] &= (UINT64_C(1) << (out->length % BPQW)) - 1;
+  RANK_INVALIDATE(out);
+  SUMMARY_INVALIDATE(out);
 }
-int Bit_minus_count(T s, T t) {
-  setop_validate(0, 0, Bit_count(s));
-  setop_count(_AND_NOT, s, t);
+
+/* Column counts of rows [r0, r1) over qwords [lo, lo + w): acc[64 q + j]
+   += how many of the rows have bit j of qword lo + q. The rows are added
+   into bit-sliced counters BIT_COLUMN_COUNT_ROWS at a time; the slices of a
+   qword then make a 64 x 64 block whose transpose holds one counter per
+   bit. cnt has room for 16 slices of w qwords. */
+static void column_counts_block(const reduce_src *src, size_t r0, size_t r1,
+                                size_t lo, size_t w, uint64_t *cnt,
+                                uint32_t *acc) {
+  void (*transpose64)(uint64_t *) = bit_kernels_active()->transpose64;
+  for (size_t s = r0; s < r1; s += BIT_COLUMN_COUNT_ROWS) {
+    const size_t e =
+        r1 - s < BIT_COLUMN_COUNT_ROWS ? r1 : s + BIT_COLUMN_COUNT_ROWS;
+    const int nslices = 64 - __builtin_clzll((unsigned long long)(e - s));
+    reduce_count(src, s, e, lo, w, nslices, cnt);
+    for (size_t q = 0; q < w; q++) {
+      uint64_t block[64] = {0};
+      for (int b = 0; b < nslices; b++)
+        block[b] = cnt[(size_t)b * w + q];
+      transpose64(block);
+      uint32_t *dst = acc + q * BPQW;
+      OMP_CPU_SIMD
+      for (int j = 0; j < 64; j++)
+        dst[j] += (uint32_t)block[j];
+    }
+  }
 }
-int Bit_inter_count(T s, T t) {
-  setop_validate(Bit_count(t), 0, 0);
-  setop_count(_AND, s, t);
+
+/* --- 8f. Rank/select helpers --- */
+
+/* Position of the k-th (0-based) set bit of word; word has more than k */
+static inline int select_in_word(uint64_t word, int k) {
+  int pos = 0;
+  for (int width = 32; width >= 8; width /= 2) {
+    uint64_t low = word & ((UINT64_C(1) << width) - 1);
+    int c = (int)POPCOUNT(low);
+    if (k >= c) {
+      k -= c;
+      word >>= width;
+      pos += width;
+    } else {
+      word = low;
+    }
+  }
+  for (; k > 0; k--)
+    word &= word - 1;
+  return pos + __builtin_ctzll(word);
 }
-int Bit_union_count(T s, T t) {
-  setop_validate(Bit_count(t), Bit_count(t), Bit_count(s));
-  setop_count(_OR, s, t);
+
+/* --- 8g. Bitset database helpers --- */
+
+/* Kernel of a single Bit_count_ops value */
+static bit_setop_id count_op_id(Bit_count_ops op) {
+  switch (op) {
+  case BIT_COUNT_INTER:
+    return BIT_OP_AND;
+  case BIT_COUNT_UNION:
+    return BIT_OP_OR;
+  case BIT_COUNT_DIFF:
+    return BIT_OP_XOR;
+  case BIT_COUNT_MINUS:
+    return BIT_OP_AND_NOT;
+  default:
+    assert(!"op must be a single Bit_count_ops value");
+    return BIT_OP_AND;
+  }
 }
 
-void print_Bit_configuration(void) {
-    printf("==========================================\n");
-    printf("        System Bit Configuration          \n");
-    printf("==========================================\n");
-    
-    // Using fixed-width specifiers for clean alignment (e.g., %-20s)
-    printf(" %-20s : %d\n", "CPU_TILE_BIT",      CPU_TILE_BIT);
-    printf(" %-20s : %d\n", "CPU_TILE_BITS",     CPU_TILE_BITS);
-    printf(" %-20s : %d\n", "GPU_TILE_J",        GPU_TILE_J);
-    printf(" %-20s : %d\n", "GPU_ILP",           GPU_ILP);
-    printf(" %-20s : %d\n", "K_BLOCK",           K_BLOCK);
-    printf(" %-20s : %d\n", "SETOP_BUFFER_SIZE", SETOP_BUFFER_SIZE);
-    printf(" %-20s : %d\n", "OUTER_ROW_NUM", OUTER_ROW_NUM);
-    printf(" %-20s : %d\n", "OUTER_COL_NUM", OUTER_COL_NUM);
-    printf(" %-20s : %d\n", "OUTER_VEC_BLK", OUTER_VEC_BLK);
-    
-    printf("------------------------------------------\n");
-    printf(" %-20s : %s\n", "Using LIBPOPCNT",     USE_LIBPOPCNT ? "Yes" : "No");
-    printf("==========================================\n");
+/* Scratch of nints integers for the calling thread of a parallel region:
+   the thread's slot of opts.ctx, grown if needed, or a fresh allocation
+   without a context. Release it with db_scratch_done. */
+static int *db_scratch(SETOP_COUNT_OPTS opts, size_t nints) {
+  int slot = omp_get_thread_num();
+  if (opts.ctx == NULL || slot >= opts.ctx->nslots) {
+    int *buffer = malloc(nints * sizeof(int));
+    assert(buffer != NULL);
+    return buffer;
+  }
+  Bit_ctx_T ctx = opts.ctx;
+  if (ctx->scratch_ints[slot] < nints) {
+    const size_t had = ctx->scratch_ints[slot] * sizeof(int);
+    const size_t want = nints * sizeof(int);
+    // reserve first, so that slots growing together respect the budget
+    const size_t kept = atomic_fetch_add(&ctx->bytes, want) + want - had;
+    if (ctx->budget && kept > ctx->budget) {
+      atomic_fetch_sub(&ctx->bytes, want);
+      int *buffer = malloc(want); // the call's own, see db_scratch_done
+      assert(buffer != NULL);
+      return buffer;
+    }
+    free(ctx->scratch[slot]);
+    atomic_fetch_sub(&ctx->bytes, had);
+    bit_mem_charge(BIT_MEM_SCRATCH, (int64_t)want - (int64_t)had);
+    ctx->scratch[slot] = malloc(want);
+    assert(ctx->scratch[slot] != NULL);
+    ctx->scratch_ints[slot] = nints;
+  }
+  return ctx->scratch[slot];
 }
-/* --- End Section 10: PUBLIC API — SINGLE BITSET --- */
 
-/* ===========================================================================
-   SECTION 11: PUBLIC API — BITSET DATABASE (Bit_DB_T)
-   ===========================================================================
- */
+static void db_scratch_done(SETOP_COUNT_OPTS opts, int *buffer) {
+  int slot = omp_get_thread_num();
+  if (opts.ctx == NULL || slot >= opts.ctx->nslots ||
+      opts.ctx->scratch[slot] != buffer)
+    free(buffer);
+}
 
-/* --- 11a. Lifecycle: create, destroy, load --- */
+/* Population count of one row with the active SIMD count kernel */
+static inline int db_row_count(T_DB set, unsigned int index) {
+  return bit_kernels_active()->count_qwords(
+      set->qwords + (uint64_t)index * set->stride_in_qwords,
+      set->size_in_qwords);
+}
 
-T_DB BitDB_new(int length, int num_of_bitsets) {
-  assert(length > 0);
-  assert(num_of_bitsets > 0);
-  assert(num_of_bitsets < INT_MAX); // limit to 2^30 bitsets
-  assert(length < INT_MAX);         // limit to 2^30 bits
+/* --- 8g'. Bulk row copies ---
+   A bulk import is bandwidth bound and its rows are rarely read right
+   after, so past the store threshold of the count matrices
+   (Bit_store_threshold_get) they are streamed past the caches, in
+   STREAM_BYTES pieces when both ends are aligned for it. The calling
+   thread fences its own streamed stores.
+*/
+static inline void db_copy_row(unsigned char *dst, const unsigned char *src,
+                               size_t bytes, bool stream) {
+  size_t b = 0;
+  if (stream && ((uintptr_t)dst | (uintptr_t)src) % STREAM_BYTES == 0)
+    for (; b + STREAM_BYTES <= bytes; b += STREAM_BYTES)
+      STREAM_COPY(dst + b, src + b);
+  memcpy(dst + b, src + b, bytes - b);
+}
 
-  T_DB set = malloc(sizeof(*set));
-  set->length = length;
-  set->nelem = num_of_bitsets;
+/* Rows rows[0 .. n - 1] of src into rows 0 .. n - 1 of dst, in parallel
+   once they span BIT_BATCH_PARALLEL_QWORDS. The rows are scattered over
+   src, so each thread prefetches the first lines of the row it copies
+   BIT_GATHER_PREFETCH_ROWS later; a row a writer tore is copied again */
+static void db_gather_rows(T_DB dst, T_DB src, const int *rows, size_t n,
+                           int nthreads) {
+  const bool parallel = n * src->size_in_qwords > BIT_BATCH_PARALLEL_QWORDS;
+  const size_t lines = src->size_in_bytes < 256 ? 1 : 4;
+#pragma omp parallel for num_threads(nthreads) schedule(static) if (parallel)
+  for (long long j = 0; j < (long long)n; j++) {
+    if ((size_t)j + BIT_GATHER_PREFETCH_ROWS < n) {
+      const char *ahead =
+          (const char *)(src->qwords +
+                         (size_t)rows[j + BIT_GATHER_PREFETCH_ROWS] *
+                             src->stride_in_qwords);
+      for (size_t l = 0; l < lines; l++)
+        __builtin_prefetch(ahead + l * 64, 0, 0);
+    }
+    const size_t row = (size_t)rows[j];
+    uint64_t seen;
+    do {
+      seen = db_seq_read_begin(src, row, 1);
+      memcpy(dst->qwords + (size_t)j * dst->stride_in_qwords,
+             src->qwords + row * src->stride_in_qwords, src->size_in_bytes);
+    } while (db_seq_read_retry(src, row, 1, seen));
+  }
+}
 
-  set->size_in_qwords = nqwords(length);
-  set->size_in_bytes = set->size_in_qwords * BPQW / BPB;
+/* --- 8h. Growable container storage ---
+   Library-owned rows start on the aligned heap. When a container grows past
+   BIT_DB_MMAP_THRESHOLD bytes on Linux its rows move, once, to a page
+   aligned anonymous mapping, which further growth extends with mremap.
+*/
 
-  size_t size_in_bytes = (size_t)set->size_in_bytes * num_of_bitsets;
+#if BIT_DB_MREMAP
+static size_t db_mapped_bytes(T_DB set, size_t capacity) {
+  size_t page = 4096;
+  return ((capacity * set->stride_in_bytes + page - 1) / page) * page;
+}
+#endif
 
-  // Allocate aligned memory for the bitsets in the database
-  set->qwords = portable_aligned_calloc(ALIGNMENT, size_in_bytes);
-  assert(set->qwords != NULL);
+static void db_storage_free(T_DB set) {
+  if (set->is_pinned) {
+    pinned_free(set->qwords);
+    return;
+  }
+  if (set->is_huge) {
+    huge_free(set->qwords);
+    return;
+  }
+#if BIT_DB_MREMAP
+  if (set->is_mmapped) {
+    munmap(set->qwords, db_mapped_bytes(set, set->capacity));
+    return;
+  }
+#endif
+  portable_aligned_free(set->qwords);
+}
 
-  set->bytes = (unsigned char *)set->qwords;
-  set->is_Bit_T_allocated = true; // allocated by the library
-  return set;
+/* Charges the storage of set to the memory accounts in place of what it
+   was charged before: the capacity of rows the library allocated, or the
+   file mapping of the rows of a file or snapshot */
+static void db_charge(T_DB set) {
+  const size_t bytes = set->is_Bit_T_allocated
+                           ? (size_t)set->capacity * set->stride_in_bytes
+                       : set->mapping ? set->mapping_bytes
+                                      : 0;
+  bit_mem_charge(set->is_Bit_T_allocated ? BIT_MEM_CONTAINERS
+                                         : BIT_MEM_MAPPED,
+                 (int64_t)bytes - (int64_t)set->charged_bytes);
+  set->charged_bytes = bytes;
 }
 
-// return a pointer to the original buffer (if externally loaded) or NULL
-// otherwise
-void *BitDB_free(T_DB *set) {
-  assert(set && *set);
-  void *original_location = (void *)(*set)->qwords;
-  // complex deallocation logic to handle aligned allocation and external
-  // buffers
-  if ((*set)->is_Bit_T_allocated) {
-    original_location = (void *)((void **)(*set)->qwords - 1);
-    void *original_block = *(void **)original_location;
-    free(original_block);
-    original_block = original_location = NULL;
-    (*set)->qwords = NULL;
-    (*set)->bytes = NULL; // set bytes to NULL after freeing qwords
+static void db_grow(T_DB set, size_t capacity) {
+  assert(set->is_Bit_T_allocated); // external buffers cannot grow
+  assert(capacity < INT_MAX);
+  // the device copy is keyed by the old rows: map the new ones afresh
+  const bool attached = set->dirty_rows != NULL;
+  const int device_id = set->device_id;
+  if (attached)
+    BitDB_device_detach(set);
+  size_t new_bytes = capacity * set->stride_in_bytes;
+  void *qwords = NULL;
+  if (set->is_pinned) { // pinned rows are not remapped: locked afresh
+    qwords = pinned_calloc(new_bytes);
+    assert(qwords != NULL);
+    memcpy(qwords, set->qwords, (size_t)set->nelem * set->stride_in_bytes);
+    db_storage_free(set);
+  } else if (set->is_huge) { // huge rows move to a larger block of the same
+    qwords = huge_calloc(new_bytes, huge_pages(set->qwords));
+    assert(qwords != NULL);
+    memcpy(qwords, set->qwords, (size_t)set->nelem * set->stride_in_bytes);
+    db_storage_free(set);
   }
-  free(*set);
-  *set = NULL;
-  return original_location;
+#if BIT_DB_MREMAP
+  if (qwords == NULL &&
+      (new_bytes >= BIT_DB_MMAP_THRESHOLD || set->is_mmapped)) {
+#if BIT_DB_COW
+    if (set->cow)
+      db_cow_grow(set, capacity);
+#endif
+    if (set->is_mmapped) {
+      qwords = mremap(set->qwords, db_mapped_bytes(set, set->capacity),
+                      db_mapped_bytes(set, capacity), MREMAP_MAYMOVE);
+    } else {
+      qwords = mmap(NULL, db_mapped_bytes(set, capacity),
+                    PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1,
+                    0);
+      if (qwords != MAP_FAILED) {
+        memcpy(qwords, set->qwords, (size_t)set->nelem * set->stride_in_bytes);
+        portable_aligned_free(set->qwords);
+      }
+    }
+    assert(qwords != MAP_FAILED);
+    set->is_mmapped = true;
+  }
+#endif
+  if (qwords == NULL) {
+    qwords = portable_aligned_calloc(ALIGNMENT, new_bytes);
+    assert(qwords != NULL);
+    memcpy(qwords, set->qwords, (size_t)set->nelem * set->stride_in_bytes);
+    db_storage_free(set);
+  }
+  if (set->row_seqs) { // readers may not run while the rows move
+    const size_t had = db_seq_blocks(set->capacity);
+    const size_t blocks = db_seq_blocks(capacity);
+    set->row_seqs =
+        realloc((void *)set->row_seqs, blocks * sizeof(*set->row_seqs));
+    assert(set->row_seqs != NULL);
+    for (size_t b = had; b < blocks; b++)
+      atomic_init(&set->row_seqs[b], 0);
+  }
+  set->qwords = qwords;
+  set->bytes = (unsigned char *)qwords;
+  set->capacity = capacity;
+  if (set->row_counts) {
+    set->row_counts = realloc(set->row_counts, capacity * sizeof(int));
+    assert(set->row_counts != NULL);
+  }
+  if (set->row_ids) {
+    set->row_ids = realloc(set->row_ids, capacity * sizeof(int));
+    assert(set->row_ids != NULL);
+  }
+  if (set->row_summaries) {
+    set->row_summaries =
+        realloc(set->row_summaries,
+                capacity * summary_nwords(set->size_in_qwords) *
+                    sizeof(uint64_t));
+    assert(set->row_summaries != NULL);
+  }
+  db_charge(set);
+  if (attached)
+    BitDB_device_attach(set, device_id);
 }
 
-T_DB BitDB_load(int length, int num_of_bitsets, void *buffer) {
-  assert(length > 0);
-  assert(num_of_bitsets > 0);
-  assert(num_of_bitsets < INT_MAX); // limit to 2^30 bitsets
-  assert(length < INT_MAX);         // limit to 2^30 bits
-  assert(buffer != NULL);
+/* --- 8h'. Copy-on-write snapshots ---
+   The first BitDB_snapshot of a container moves its rows into a memory
+   file. A snapshot maps the file read-only, and the container maps it
+   privately, so that its writes copy the pages they touch and the file
+   keeps the generation of the snapshots. A snapshot taken once all of a
+   generation are closed first writes the rows back to the file and maps
+   it shared again, which drops the private pages.
+*/
 
-  T_DB set = malloc(sizeof(*set));
-  set->length = length;
-  set->nelem = num_of_bitsets;
+#if BIT_DB_COW
+static void db_cow_release(bit_db_cow *cow) {
+  if (atomic_fetch_sub(&cow->refs, 1) != 1)
+    return;
+  close(cow->fd);
+  free(cow);
+}
+
+/* Maps the memory file over the rows of set, in place */
+static void db_cow_map(T_DB set, bool private) {
+  void *rows = mmap(set->qwords, db_mapped_bytes(set, set->capacity),
+                    PROT_READ | PROT_WRITE,
+                    (private ? MAP_PRIVATE : MAP_SHARED) | MAP_FIXED,
+                    set->cow->fd, 0);
+  assert(rows == (void *)set->qwords);
+  set->cow->diverged = private;
+}
+
+/* Moves the rows of set into a memory file mapped shared; false if the
+   file cannot be made */
+static bool db_cow_start(T_DB set) {
+  const size_t bytes = db_mapped_bytes(set, set->capacity);
+  int fd = memfd_create("bit_db_rows", MFD_CLOEXEC);
+  if (fd < 0)
+    return false;
+  bit_db_cow *cow = calloc(1, sizeof(*cow));
+  if (cow == NULL || ftruncate(fd, (off_t)bytes) != 0 ||
+      !writer_pwrite(fd, set->bytes,
+                     (size_t)set->nelem * set->stride_in_bytes, 0)) {
+    free(cow);
+    close(fd);
+    return false;
+  }
+  // the device copy is keyed by the old rows: map the new ones afresh
+  const bool attached = set->dirty_rows != NULL;
+  const int device_id = set->device_id;
+  if (attached)
+    BitDB_device_detach(set);
+  // a mapping is replaced where it is; heap rows move
+  void *mapped = mmap(set->is_mmapped ? set->qwords : NULL, bytes,
+                      PROT_READ | PROT_WRITE,
+                      MAP_SHARED | (set->is_mmapped ? MAP_FIXED : 0), fd, 0);
+  assert(mapped != MAP_FAILED);
+  if (!set->is_mmapped)
+    db_storage_free(set);
+  set->qwords = mapped;
+  set->bytes = mapped;
+  set->is_mmapped = true;
+  cow->fd = fd;
+  atomic_init(&cow->refs, 1);
+  atomic_init(&cow->open, 0);
+  set->cow = cow;
+  if (attached)
+    BitDB_device_attach(set, device_id);
+  return true;
+}
+
+/* Writes the rows of set back to the memory file, whose generation no
+   snapshot maps any more, and maps it shared. All of them are written: a
+   private page may diverge through a row view (BitDB_view_at) as well as
+   through the BitDB writers, and remapping drops every one of them */
+static void db_cow_merge(T_DB set) {
+  bool ok = writer_pwrite(set->cow->fd, set->bytes,
+                          (size_t)set->nelem * set->stride_in_bytes, 0);
+  assert(ok);
+  (void)ok;
+  db_cow_map(set, false);
+}
+
+/* Makes room in the memory file for capacity rows */
+static void db_cow_grow(T_DB set, size_t capacity) {
+  int failed = ftruncate(set->cow->fd, (off_t)db_mapped_bytes(set, capacity));
+  assert(failed == 0);
+  (void)failed;
+}
+#endif
 
+/* A read-only copy of the rows of set */
+static T_DB db_copy_readonly(T_DB set) {
+  T_DB copy = BitDB_new(set->length, set->nelem);
+  for (size_t r = 0; r < set->nelem; r++)
+    memcpy(copy->bytes + r * copy->stride_in_bytes,
+           set->bytes + r * set->stride_in_bytes, set->size_in_bytes);
+  copy->is_readonly = true;
+  return copy;
+}
+
+/* --- 8i. Checksum of saved containers ---
+   FNV-1a over 64-bit words: cheap enough to run over a whole file when
+   BIT_DB_MMAP_VERIFY asks for it. nbytes is always a multiple of 8; words
+   are read with memcpy since the header is not an array of qwords.
+*/
+
+/* The checksum of data following bytes whose checksum is hash */
+static uint64_t db_checksum_update(uint64_t hash, const void *data,
+                                   size_t nbytes) {
+  const unsigned char *bytes = data;
+  for (size_t i = 0; i < nbytes; i += sizeof(uint64_t)) {
+    uint64_t word;
+    memcpy(&word, bytes + i, sizeof(word));
+    hash ^= word;
+    hash *= UINT64_C(0x100000001b3);
+  }
+  return hash;
+}
+
+static uint64_t db_checksum(const void *data, size_t nbytes) {
+  return db_checksum_update(UINT64_C(0xcbf29ce484222325), data, nbytes);
+}
+
+/* Header of a saved container of bytes bytes, fit to be trusted */
+static bool db_file_header_valid(const bit_db_file_header *header,
+                                 size_t bytes) {
+  return memcmp(header->magic, BIT_DB_FILE_MAGIC, sizeof(BIT_DB_FILE_MAGIC)) ==
+             0 &&
+         header->byte_order == BIT_DB_FILE_BYTE_ORDER &&
+         header->version == BIT_DB_FILE_VERSION &&
+         header->header_checksum ==
+             db_checksum(header,
+                         offsetof(bit_db_file_header, header_checksum)) &&
+         header->header_size >= sizeof(*header) &&
+         header->header_size % ALIGNMENT == 0 &&
+         header->header_size <= bytes && header->length > 0 &&
+         header->length < INT_MAX && header->nelem > 0 &&
+         header->nelem < INT_MAX &&
+         header->stride_in_bytes >=
+             nqwords(header->length) * sizeof(uint64_t) &&
+         header->stride_in_bytes % sizeof(uint64_t) == 0 &&
+         bytes - header->header_size >=
+             (size_t)header->nelem * header->stride_in_bytes;
+}
+
+/* --- 8j. Containers over rows the library does not own --- */
+
+static void db_wrap(T_DB set, unsigned int length, unsigned int nelem,
+                    void *rows) {
+  set->length = length;
+  set->nelem = nelem;
   set->size_in_qwords = nqwords(length);
   set->size_in_bytes = set->size_in_qwords * BPQW / BPB;
+  set->stride_in_qwords = set->size_in_qwords; // packed unless told otherwise
+  set->stride_in_bytes = set->size_in_bytes;
+  set->bytes = (unsigned char *)rows;
+  set->qwords = (uint64_t *)rows;
+  set->is_Bit_T_allocated = false; // not allocated by the library
+  set->charged_bytes = 0;
+  set->row_counts = NULL;
+  set->row_summaries = NULL;
+  set->postings = NULL;
+  set->row_hashes = NULL;
+  set->row_ids = NULL;
+  set->capacity = nelem;
+  set->is_mmapped = false;
+  set->mapping = NULL;
+  set->mapping_bytes = 0;
+  set->is_readonly = false;
+  set->numa_policy = BIT_NUMA_LOCAL;
+  set->is_pinned = false;
+  set->is_huge = false;
+  set->changes = NULL;
+  set->row_seqs = NULL;
+  set->dirty_rows = NULL;
+  set->device_id = -1;
+  set->device_nelem = 0;
+  set->stamp = db_new_stamp();
+  set->cow = NULL;
+}
 
-  set->bytes = (unsigned char *)buffer;
-  set->qwords = (uint64_t *)buffer; // set qwords to point to the buffer
-  set->is_Bit_T_allocated = false;  // not allocated by the library
-  return set;
+uint64_t db_new_stamp(void) {
+  static _Atomic uint64_t last_stamp;
+  return atomic_fetch_add_explicit(&last_stamp, 1, memory_order_relaxed) + 1;
 }
 
-/* --- 11b. Properties --- */
+/* --- 8k. Streaming SETOP counts ---
+   The bits side arrives as blocks of packed rows from next_block(). Two block
+   buffers alternate: while the tiled kernel counts the current block on
+   its own (nested) team, a second thread of a two-way sections region reads
+   the next one, so I/O overlaps the counting. The tile of counts for each
+   block is handed to emit() before the buffers swap.
+*/
 
-int BitDB_length(T_DB set) {
-  assert(set);
-  return set->length;
+static void db_count_stream(bit_setop_id op, T_DB bit,
+                            int next_block(void *cl, void *rows, int max_rows,
+                                           int row_bytes),
+                            void *block_cl, int block_rows,
+                            void emit(void *cl, size_t first_row, int nrows,
+                                      const int *counts),
+                            void *emit_cl, SETOP_COUNT_OPTS opts) {
+  assert(bit);
+  assert(next_block && emit);
+  assert(block_rows > 0);
+  int row_bytes = (int)bit->size_in_bytes;
+  size_t block_bytes = (size_t)block_rows * row_bytes;
+  void *buffers[2] = {portable_aligned_calloc(ALIGNMENT, block_bytes),
+                      portable_aligned_calloc(ALIGNMENT, block_bytes)};
+  int *counts = malloc((size_t)bit->nelem * block_rows * sizeof(int));
+  assert(buffers[0] && buffers[1] && counts);
+
+  int levels = omp_get_max_active_levels();
+  if (levels < 2)
+    omp_set_max_active_levels(2); // the kernel team nests in its section
+  opts.store = BIT_STORE_CACHED;  // emit() reads the counts back at once
+  const bit_kernel_table *k = bit_kernels_active();
+  size_t first_row = 0;
+  int current = 0;
+  int nrows = next_block(block_cl, buffers[current], block_rows, row_bytes);
+  while (nrows > 0) {
+    assert(nrows <= block_rows);
+    struct T_DB block;
+    db_wrap(&block, bit->length, nrows, buffers[current]);
+    int next_rows = 0;
+#pragma omp parallel sections num_threads(2)
+    {
+#pragma omp section
+      k->setop_count_db[op](bit, &block, counts, opts);
+#pragma omp section
+      if (nrows == block_rows) // a short block is the last one
+        next_rows =
+            next_block(block_cl, buffers[1 - current], block_rows, row_bytes);
+    }
+    emit(emit_cl, first_row, nrows, counts);
+    first_row += nrows;
+    nrows = next_rows;
+    current = 1 - current;
+  }
+  if (levels < 2)
+    omp_set_max_active_levels(levels);
+  portable_aligned_free(buffers[0]);
+  portable_aligned_free(buffers[1]);
+  free(counts);
 }
 
-int BitDB_nelem(T_DB set) {
-  assert(set);
-  return set->nelem;
+/* --- 8l. Tiled SETOP counts for the search modes ---
+   Query blocks are spread over the threads; each thread counts its block
+   against one target block at a time into a private tile and hands the
+   tile to fold(). All tiles of a query block go to the same thread, so fold
+   may keep per-query state without locking. A skip() callback, when given,
+   is asked first and may drop a tile that cannot change the result; a
+   start() callback names a target row to begin with, the target blocks then
+   being visited outwards from it (otherwise in increasing order).
+*/
+
+static void db_slice(T_DB slice, T_DB set, unsigned int first,
+                     unsigned int nelem) {
+  db_wrap(slice, set->length, nelem,
+          set->qwords + (size_t)first * set->stride_in_qwords);
+  slice->stride_in_qwords = set->stride_in_qwords;
+  slice->stride_in_bytes = set->stride_in_bytes;
 }
 
-int BitDB_count_at(T_DB set, int index) {
-  assert(set);
-  assert(index >= 0 && (unsigned int)index < set->nelem);
-  int count = 0;
-#if !USE_LIBPOPCNT
-  uint64_t *qwords = set->qwords + index * set->size_in_qwords;
-  for (unsigned int i = 0; i < set->size_in_qwords; i++)
-    count += POPCOUNT(qwords[i]);
-#else
-  count =
-      (int)popcnt(set->bytes + index * set->size_in_bytes, set->size_in_bytes);
-#endif
-  return count;
+static void db_count_tiles_pruned(
+    bit_setop_id op, T_DB bit, T_DB bits, SETOP_COUNT_OPTS opts,
+    int start(void *cl, int first_query, int nquery),
+    bool skip(void *cl, int first_query, int nquery, int first_target,
+              int ntarget),
+    void fold(void *cl, int first_query, int nquery, int first_target,
+              int ntarget, const int *tile),
+    void *cl) {
+  SETOP_DB_CHECKS(bit, bits)
+  const bit_kernel_table *k = count_kernels(bit, bits, opts);
+  int nqueries = (int)bit->nelem, ntargets = (int)bits->nelem;
+  SETOP_COUNT_OPTS serial = opts;
+  serial.num_cpu_threads = 1; // the tiles themselves are the parallel work
+  serial.store = BIT_STORE_CACHED; // the tile is read back at once
+#pragma omp parallel num_threads(cpu_threads(opts))
+  {
+    int *tile = db_scratch(opts, (size_t)BIT_SEARCH_QUERY_BLOCK *
+                                     BIT_SEARCH_TARGET_BLOCK);
+#pragma omp for schedule(dynamic)
+    for (int q = 0; q < nqueries; q += BIT_SEARCH_QUERY_BLOCK) {
+      int nq = nqueries - q < BIT_SEARCH_QUERY_BLOCK ? nqueries - q
+                                                     : BIT_SEARCH_QUERY_BLOCK;
+      struct T_DB queries;
+      db_slice(&queries, bit, q, nq);
+      // target blocks in order of distance from the one holding start()
+      int nblocks = (ntargets + BIT_SEARCH_TARGET_BLOCK - 1) /
+                    BIT_SEARCH_TARGET_BLOCK;
+      int pivot = start ? start(cl, q, nq) / BIT_SEARCH_TARGET_BLOCK : 0;
+      for (int step = 0, seen = 0; seen < nblocks; step++) {
+        int d = (step + 1) / 2;
+        int block = step % 2 ? pivot + d : pivot - d;
+        if (block < 0 || block >= nblocks)
+          continue;
+        seen++;
+        int t = block * BIT_SEARCH_TARGET_BLOCK;
+        int nt = ntargets - t < BIT_SEARCH_TARGET_BLOCK
+                     ? ntargets - t
+                     : BIT_SEARCH_TARGET_BLOCK;
+        if (skip && skip(cl, q, nq, t, nt))
+          continue;
+        struct T_DB targets;
+        db_slice(&targets, bits, t, nt);
+        // a tile a writer tore is counted again (see BitDB_concurrent)
+        uint64_t seen_q, seen_t;
+        do {
+          seen_q = db_seq_read_begin(bit, q, nq);
+          seen_t = db_seq_read_begin(bits, t, nt);
+          k->setop_count_db[op](&queries, &targets, tile, serial);
+        } while (db_seq_read_retry(bit, q, nq, seen_q) |
+                 db_seq_read_retry(bits, t, nt, seen_t));
+        fold(cl, q, nq, t, nt, tile);
+      }
+    }
+    db_scratch_done(opts, tile);
+  }
 }
 
-int *BitDB_count(T_DB set) {
-  assert(set);
-  int *counts = malloc(set->nelem * sizeof(int));
-  assert(counts != NULL);
-#if !USE_LIBPOPCNT
-  uint64_t *qwords = set->qwords;
-  for (unsigned int i = 0; i < set->nelem; i++, qwords += set->size_in_qwords) {
-    int count = 0;
-    for (unsigned int j = 0; j < set->size_in_qwords; j++)
-      count += POPCOUNT(qwords[j]);
-    counts[i] = count;
+static void db_count_tiles(bit_setop_id op, T_DB bit, T_DB bits,
+                           SETOP_COUNT_OPTS opts,
+                           void fold(void *cl, int first_query, int nquery,
+                                     int first_target, int ntarget,
+                                     const int *tile),
+                           void *cl) {
+  db_count_tiles_pruned(op, bit, bits, opts, NULL, NULL, fold, cl);
+}
+
+/* --- 8m. Search modes: bounded top-k heaps and threshold match lists ---
+   DEFINE_SEARCH_MODE(name, score_t, SCORE, BOUND) generates the top-k and
+   threshold drivers for one kind of score; SCORE(ctx, count, query, target)
+   derives it from an intersection count. Each query keeps its k best (score,
+   index) pairs in its own slice of the output arrays, as a min-heap on
+   "worse": a lower score, or an equal score with a higher index. Empty slots
+   hold score -1, which every match beats. When the target popcounts are
+   known, BOUND(ctx, query, lo, hi), the best score any target of popcount in
+   [lo, hi] could reach, prunes whole tiles: on a container sorted by
+   popcount (BitDB_sort_by_count) a tile spans a narrow range of popcounts,
+   and most of them fall outside what a threshold or a full heap still admits.
+   Queries and targets are reported, and ties broken, by their row IDs
+   (SEARCH_ID), so a reordered container gives the results it gave before.
+*/
+
+typedef struct {
+  const int *query_cards;  // per-row popcounts of the queries, or NULL
+  const int *target_cards; // per-row popcounts of the targets, or NULL
+  Bit_similarity sim;      // coefficient of similarity scores
+  int ntargets;            // rows behind target_cards
+  const int *query_ids;    // ID reported for every query, or NULL (its row)
+  const int *target_ids;   // same for every target of the tiles
+} search_ctx;
+
+/* Row IDs of the results: those of BitDB_reorder, and rows of bits for
+   targets gathered under a row_mask */
+#define SEARCH_ID(ids, row) ((ids) ? (ids)[row] : (row))
+
+/* Least and greatest popcount of n target rows from first */
+static void search_card_range(const int *cards, int first, int n, int *lo,
+                              int *hi) {
+  int min = cards[first], max = cards[first];
+  for (int j = first + 1; j < first + n; j++) {
+    min = cards[j] < min ? cards[j] : min;
+    max = cards[j] > max ? cards[j] : max;
   }
-#else
-  unsigned char *bytes = set->bytes;
-  for (unsigned int i = 0; i < set->nelem; i++, bytes += set->size_in_bytes)
-    counts[i] = (int)popcnt(bytes, set->size_in_bytes);
+  *lo = min;
+  *hi = max;
+}
 
-#endif
-  return counts;
+/* First target whose popcount is at least that of query, if the targets
+   are sorted by popcount (any target otherwise) */
+static int search_card_start(const search_ctx *ctx, int query) {
+  int card = ctx->query_cards[query], lo = 0, hi = ctx->ntargets;
+  while (lo < hi) {
+    int mid = lo + (hi - lo) / 2;
+    if (ctx->target_cards[mid] < card)
+      lo = mid + 1;
+    else
+      hi = mid;
+  }
+  return lo < ctx->ntargets ? lo : ctx->ntargets - 1;
 }
 
-/* --- 11c. Element access and bulk operations --- */
+/* The targets opts.row_mask selects, gathered into a packed container so
+   that the tiles stay as dense as without a mask; the popcounts of ctx
+   follow the gathered rows, and the target IDs of ctx become the IDs of
+   the rows of bits they came from */
+typedef struct {
+  T_DB targets; // bits itself without a mask, NULL if no row is selected
+  int *map;     // ID of every gathered target, NULL without a mask
+  int *cards;   // popcounts of the gathered targets, or NULL
+} search_rows;
 
-void BitDB_clear_at(T_DB set, int index) {
-  assert(set);
-  assert(index >= 0 && (unsigned int)index < set->nelem);
-  size_t shift = (size_t)index;
-  shift *= set->size_in_bytes; // calculate the offset
-  memset(set->bytes + shift, 0, set->size_in_bytes);
+static search_rows search_rows_select(T_DB bits, search_ctx *ctx,
+                                      SETOP_COUNT_OPTS opts) {
+  search_rows rows = {bits, NULL, NULL};
+  ctx->target_ids = bits->row_ids;
+  if (opts.row_mask == NULL)
+    return rows;
+  rows.map = malloc((bits->nelem ? bits->nelem : 1) * sizeof(int));
+  assert(rows.map != NULL);
+  const size_t n = db_mask_rows(bits, opts.row_mask, rows.map);
+  ctx->ntargets = (int)n;
+  if (n == 0) {
+    rows.targets = NULL;
+    return rows;
+  }
+  rows.targets = BitDB_new(bits->length, (int)n);
+  db_gather_rows(rows.targets, bits, rows.map, n, cpu_threads(opts));
+  if (ctx->target_cards) {
+    rows.cards = malloc(n * sizeof(int));
+    assert(rows.cards != NULL);
+    for (size_t j = 0; j < n; j++)
+      rows.cards[j] = ctx->target_cards[rows.map[j]];
+    ctx->target_cards = rows.cards;
+  }
+  for (size_t j = 0; j < n; j++)
+    rows.map[j] = SEARCH_ID(bits->row_ids, rows.map[j]);
+  ctx->target_ids = rows.map;
+  return rows;
 }
 
-void BitDB_clear(T_DB set) {
-  assert(set);
-  size_t size_in_bytes = (size_t)set->nelem;
-  size_in_bytes *= set->size_in_bytes; // calculate the total size
-  memset(set->bytes, 0, size_in_bytes);
+static void search_rows_done(search_rows *rows) {
+  if (rows->map && rows->targets)
+    BitDB_free(&rows->targets);
+  free(rows->map);
+  free(rows->cards);
 }
 
-T BitDB_get_from(T_DB set, int index) {
-  assert(set);
-  assert(index >= 0 && (unsigned int)index < set->nelem);
-  T bitset = Bit_new(set->length);
-  size_t shift = (size_t)index;
-  shift *= set->size_in_bytes; // calculate the offset
-  // Copy the bytes from the set to the new bitset
-  memcpy(bitset->bytes, set->bytes + shift, set->size_in_bytes);
-  return bitset;
+#define DEFINE_SEARCH_MODE(name, score_t, SCORE, BOUND)                        \
+  static inline bool name##_worse(const int *idx, const score_t *score,        \
+                                  int a, int b) {                              \
+    return score[a] < score[b] || (score[a] == score[b] && idx[a] > idx[b]);   \
+  }                                                                            \
+  static inline void name##_swap(int *idx, score_t *score, int a, int b) {     \
+    int i = idx[a];                                                            \
+    score_t s = score[a];                                                      \
+    idx[a] = idx[b];                                                           \
+    score[a] = score[b];                                                       \
+    idx[b] = i;                                                                \
+    score[b] = s;                                                              \
+  }                                                                            \
+  static inline void name##_sift_down(int *idx, score_t *score, int k,         \
+                                      int at) {                                \
+    for (;;) {                                                                 \
+      int worst = at, l = 2 * at + 1, r = l + 1;                               \
+      if (l < k && name##_worse(idx, score, l, worst))                         \
+        worst = l;                                                             \
+      if (r < k && name##_worse(idx, score, r, worst))                         \
+        worst = r;                                                             \
+      if (worst == at)                                                         \
+        return;                                                                \
+      name##_swap(idx, score, at, worst);                                      \
+      at = worst;                                                              \
+    }                                                                          \
+  }                                                                            \
+                                                                               \
+  typedef struct {                                                             \
+    search_ctx ctx;                                                            \
+    int k;                                                                     \
+    int *idx;       /* nqueries x k */                                         \
+    score_t *score; /* nqueries x k */                                         \
+  } name##_topk_state;                                                         \
+                                                                               \
+  static void name##_topk_fold(void *cl, int first_query, int nquery,          \
+                               int first_target, int ntarget,                  \
+                               const int *tile) {                              \
+    name##_topk_state *state = cl;                                             \
+    int k = state->k;                                                          \
+    for (int i = 0; i < nquery; i++) {                                         \
+      int q = first_query + i;                                                 \
+      size_t slot = (size_t)SEARCH_ID(state->ctx.query_ids, q) * k;            \
+      int *idx = state->idx + slot;                                            \
+      score_t *score = state->score + slot;                                    \
+      const int *row = tile + (size_t)i * ntarget;                             \
+      /* target blocks may come in any order: ties go to the lower ID */       \
+      for (int j = 0; j < ntarget; j++) {                                      \
+        score_t s = SCORE(&state->ctx, row[j], q, first_target + j);           \
+        int id = SEARCH_ID(state->ctx.target_ids, first_target + j);           \
+        if (s > score[0] || (s == score[0] && id < idx[0])) {                  \
+          idx[0] = id;                                                         \
+          score[0] = s;                                                        \
+          name##_sift_down(idx, score, k, 0);                                  \
+        }                                                                      \
+      }                                                                        \
+    }                                                                          \
+  }                                                                            \
+                                                                               \
+  /* a tile none of whose targets can beat the worst kept score of any of   \
+     the queries is skipped; BOUND is the best score that popcounts in      \
+     [lo, hi] allow */                                                      \
+  static bool name##_topk_skip(void *cl, int first_query, int nquery,          \
+                               int first_target, int ntarget) {                \
+    name##_topk_state *state = cl;                                             \
+    int lo, hi;                                                                \
+    search_card_range(state->ctx.target_cards, first_target, ntarget, &lo,     \
+                      &hi);                                                    \
+    for (int q = first_query; q < first_query + nquery; q++) {                 \
+      score_t worst =                                                          \
+          state->score[(size_t)SEARCH_ID(state->ctx.query_ids, q) * state->k]; \
+      if (!(BOUND(&state->ctx, q, lo, hi) < worst))                            \
+        return false;                                                          \
+    }                                                                          \
+    return true;                                                               \
+  }                                                                            \
+                                                                               \
+  /* heaps fill fastest, and so prune hardest, from the targets nearest in  \
+     popcount to the middle query of the block */                           \
+  static int name##_topk_start(void *cl, int first_query, int nquery) {       \
+    name##_topk_state *state = cl;                                             \
+    return search_card_start(&state->ctx, first_query + nquery / 2);         \
+  }                                                                            \
+                                                                               \
+  static void name##_topk(T_DB bit, T_DB bits, int k, search_ctx ctx,          \
+                          SETOP_COUNT_OPTS opts, int *out_idx,                 \
+                          score_t *out_score) {                                \
+    assert(k > 0);                                                             \
+    assert(out_idx && out_score);                                              \
+    size_t slots = (size_t)bit->nelem * k;                                     \
+    for (size_t s = 0; s < slots; s++) {                                       \
+      out_idx[s] = -1;                                                         \
+      out_score[s] = -1;                                                       \
+    }                                                                          \
+    search_rows rows = search_rows_select(bits, &ctx, opts);                   \
+    ctx.query_ids = bit->row_ids;                                              \
+    name##_topk_state state = {ctx, k, out_idx, out_score};                    \
+    bool prune = ctx.target_cards != NULL;                                     \
+    if (rows.targets)                                                          \
+      db_count_tiles_pruned(BIT_OP_AND, bit, rows.targets, opts,               \
+                            prune ? name##_topk_start : NULL,                  \
+                            prune ? name##_topk_skip : NULL,                   \
+                            name##_topk_fold, &state);                         \
+    /* heap-sort every query's slots, best first */                            \
+    _Pragma(STRINGIFY(omp parallel for num_threads(cpu_threads(opts))))        \
+    for (int q = 0; q < (int)bit->nelem; q++) {                                \
+      int *idx = out_idx + (size_t)q * k;                                      \
+      score_t *score = out_score + (size_t)q * k;                              \
+      for (int n = k - 1; n > 0; n--) {                                        \
+        name##_swap(idx, score, 0, n);                                         \
+        name##_sift_down(idx, score, n, 0);                                    \
+      }                                                                        \
+    }                                                                          \
+    search_rows_done(&rows);                                                   \
+  }                                                                            \
+                                                                               \
+  typedef struct {                                                             \
+    search_ctx ctx;                                                            \
+    score_t threshold;                                                         \
+    int **idx;       /* per query match indices, grown on demand */            \
+    score_t **score; /* per query match scores */                              \
+    size_t *nmatch;  /* per query number of matches */                         \
+    size_t *cap;     /* per query allocated slots */                           \
+  } name##_threshold_state;                                                    \
+                                                                               \
+  static void name##_threshold_fold(void *cl, int first_query, int nquery,     \
+                                    int first_target, int ntarget,             \
+                                    const int *tile) {                         \
+    name##_threshold_state *state = cl;                                        \
+    for (int i = 0; i < nquery; i++) {                                         \
+      int q = first_query + i;                                                 \
+      int slot = SEARCH_ID(state->ctx.query_ids, q); /* the lists of q */      \
+      const int *row = tile + (size_t)i * ntarget;                             \
+      for (int j = 0; j < ntarget; j++) {                                      \
+        score_t s = SCORE(&state->ctx, row[j], q, first_target + j);           \
+        if (s < state->threshold)                                              \
+          continue;                                                            \
+        if (state->nmatch[slot] == state->cap[slot]) {                         \
+          state->cap[slot] = state->cap[slot] ? 2 * state->cap[slot] : 16;     \
+          state->idx[slot] =                                                   \
+              realloc(state->idx[slot], state->cap[slot] * sizeof(int));       \
+          state->score[slot] =                                                 \
+              realloc(state->score[slot], state->cap[slot] * sizeof(score_t)); \
+          assert(state->idx[slot] && state->score[slot]);                      \
+        }                                                                      \
+        state->idx[slot][state->nmatch[slot]] =                                \
+            SEARCH_ID(state->ctx.target_ids, first_target + j);                \
+        state->score[slot][state->nmatch[slot]++] = s;                         \
+      }                                                                        \
+    }                                                                          \
+  }                                                                            \
+                                                                               \
+  typedef struct {                                                             \
+    int idx;                                                                   \
+    score_t score;                                                             \
+  } name##_match;                                                              \
+                                                                               \
+  static int name##_match_compare(const void *a, const void *b) {              \
+    const name##_match *x = a, *y = b;                                         \
+    return (x->idx > y->idx) - (x->idx < y->idx);                              \
+  }                                                                            \
+                                                                               \
+  /* the matches of a query by increasing target ID */                         \
+  static void name##_sort_matches(int *idx, score_t *score, size_t n) {        \
+    name##_match *matches = malloc(n * sizeof(name##_match));                  \
+    assert(matches != NULL);                                                   \
+    for (size_t m = 0; m < n; m++)                                             \
+      matches[m] = (name##_match){idx[m], score[m]};                           \
+    qsort(matches, n, sizeof(*matches), name##_match_compare);                 \
+    for (size_t m = 0; m < n; m++) {                                           \
+      idx[m] = matches[m].idx;                                                 \
+      score[m] = matches[m].score;                                             \
+    }                                                                          \
+    free(matches);                                                             \
+  }                                                                            \
+                                                                               \
+  static bool name##_threshold_skip(void *cl, int first_query, int nquery,     \
+                                    int first_target, int ntarget) {           \
+    name##_threshold_state *state = cl;                                        \
+    int lo, hi;                                                                \
+    search_card_range(state->ctx.target_cards, first_target, ntarget, &lo,     \
+                      &hi);                                                    \
+    for (int q = first_query; q < first_query + nquery; q++) {                 \
+      if (!(BOUND(&state->ctx, q, lo, hi) < state->threshold))                 \
+        return false;                                                          \
+    }                                                                          \
+    return true;                                                               \
+  }                                                                            \
+                                                                               \
+  static size_t name##_threshold(T_DB bit, T_DB bits, score_t threshold,       \
+                                 search_ctx ctx, SETOP_COUNT_OPTS opts,        \
+                                 size_t *offsets, int **out_idx,               \
+                                 score_t **out_score) {                        \
+    assert(offsets && out_idx && out_score);                                   \
+    search_rows rows = search_rows_select(bits, &ctx, opts);                   \
+    ctx.query_ids = bit->row_ids;                                              \
+    size_t nqueries = bit->nelem;                                              \
+    name##_threshold_state state = {ctx,                                       \
+                                    threshold,                                 \
+                                    calloc(nqueries, sizeof(int *)),           \
+                                    calloc(nqueries, sizeof(score_t *)),       \
+                                    calloc(nqueries, sizeof(size_t)),          \
+                                    calloc(nqueries, sizeof(size_t))};         \
+    assert(state.idx && state.score && state.nmatch && state.cap);             \
+    if (rows.targets)                                                          \
+      db_count_tiles_pruned(BIT_OP_AND, bit, rows.targets, opts, NULL,         \
+                            ctx.target_cards ? name##_threshold_skip : NULL,   \
+                            name##_threshold_fold, &state);                    \
+    /* compact the per-query lists into one CSR layout */                      \
+    offsets[0] = 0;                                                            \
+    for (size_t q = 0; q < nqueries; q++)                                      \
+      offsets[q + 1] = offsets[q] + state.nmatch[q];                           \
+    size_t total = offsets[nqueries];                                          \
+    *out_idx = malloc((total ? total : 1) * sizeof(int));                      \
+    *out_score = malloc((total ? total : 1) * sizeof(score_t));                \
+    assert(*out_idx && *out_score);                                            \
+    for (size_t q = 0; q < nqueries; q++) {                                    \
+      if (state.nmatch[q] && bits->row_ids) /* IDs came in any order */        \
+        name##_sort_matches(state.idx[q], state.score[q], state.nmatch[q]);    \
+      if (state.nmatch[q]) {                                                   \
+        memcpy(*out_idx + offsets[q], state.idx[q],                            \
+               state.nmatch[q] * sizeof(int));                                 \
+        memcpy(*out_score + offsets[q], state.score[q],                        \
+               state.nmatch[q] * sizeof(score_t));                             \
+      }                                                                        \
+      free(state.idx[q]);                                                      \
+      free(state.score[q]);                                                    \
+    }                                                                          \
+    free(state.idx);                                                           \
+    free(state.score);                                                         \
+    free(state.nmatch);                                                        \
+    free(state.cap);                                                           \
+    search_rows_done(&rows);                                                   \
+    return total;                                                              \
+  }
+
+/* Best coefficient a query of popcount a can reach against popcounts in
+   [lo, hi]: every coefficient grows with the shared bits c <= min(a, b),
+   and at c = min(a, b) peaks at b = a, so the nearest b in range is best */
+static inline float similarity_bound(Bit_similarity sim, int a, int lo,
+                                     int hi) {
+  int b = a < lo ? lo : a > hi ? hi : a;
+  return similarity_eval(sim, a < b ? a : b, a, b);
 }
 
-void BitDB_put_at(T_DB set, int index, T bitset) {
-  assert(set);
-  assert(index >= 0 && (unsigned int)index < set->nelem);
-  assert(bitset);
-  assert(bitset->length == set->length);
-  // Copy the bytes from the bitset to the set
-  size_t shift = (size_t)index;
-  shift *= set->size_in_bytes; // calculate the offset
-  memcpy(set->bytes + shift, bitset->bytes, set->size_in_bytes);
+#define COUNT_SCORE(ctx, count, query, target) ((void)(ctx), (count))
+#define COUNT_BOUND(ctx, query, lo, hi) ((void)(ctx), (void)(query), (hi))
+#define SIMILARITY_SCORE(ctx, count, query, target)                            \
+  similarity_eval((ctx)->sim, (count), (ctx)->query_cards[query],              \
+                  (ctx)->target_cards[target])
+#define SIMILARITY_BOUND(ctx, query, lo, hi)                                   \
+  similarity_bound((ctx)->sim, (ctx)->query_cards[query], (lo), (hi))
+
+DEFINE_SEARCH_MODE(count_search, int, COUNT_SCORE, COUNT_BOUND)
+DEFINE_SEARCH_MODE(similarity_search, float, SIMILARITY_SCORE,
+                   SIMILARITY_BOUND)
+
+/* --- 8m'. Screened threshold searches ---
+   A target is counted in full only if a count over a sample of the word
+   positions lets it reach the threshold. With c_s the count over the
+   sample and q_s, t_s the bits of the query and target there, the words
+   outside it add at most min(|q| - q_s, |t| - t_s): an upper bound that
+   never drops a match. The estimate c_s * nq / nwords with a margin of
+   BIT_SCREEN_SIGMAS binomial deviations drops more targets, and with them
+   matches that the sample misses. The words are taken in whole 64-byte
+   lines, so that the sample costs the bandwidth of its own words only.
+*/
+
+#define SCREEN_LINE_WORDS 8
+
+/* Bits of a row over the sampled words */
+static inline int screen_count(const uint64_t *row, const int *words,
+                               int nwords) {
+  int c = 0;
+  for (int m = 0; m < nwords; m++)
+    c += POPCOUNT(row[words[m]]);
+  return c;
 }
 
-void BitDB_extract_from(T_DB set, int index, void *buffer) {
-  assert(set);
-  assert(index >= 0 && (unsigned int)index < set->nelem);
-  assert(buffer != NULL);
-  // Copy the bytes from the set to the buffer
-  size_t shift = (size_t)index;
-  shift *= set->size_in_bytes; // calculate the offset
-  memcpy(buffer, set->bytes + shift, set->size_in_bytes);
+static inline bool screen_pass(Bit_screen_mode mode, int c_s, int q_rest,
+                               int t_rest, double scale, int threshold) {
+  if (mode == BIT_SCREEN_BOUND)
+    return c_s + (q_rest < t_rest ? q_rest : t_rest) >= threshold;
+  const double estimate = c_s * scale;
+  return estimate + BIT_SCREEN_SIGMAS * scale * sqrt(c_s + 1.0) >= threshold;
 }
 
-void BitDB_replace_at(T_DB set, int index, void *buffer) {
-  assert(set);
-  assert(index >= 0 && (unsigned int)index < set->nelem);
-  assert(buffer != NULL);
-  // Copy the bytes from the buffer to the set
-  size_t shift = (size_t)index;
-  shift *= set->size_in_bytes; // calculate the offset
-  memcpy(set->bytes + shift, buffer, set->size_in_bytes);
+/* Variance over (up to BIT_SCREEN_SAMPLE_ROWS of) the rows of set of the
+   bits of every line of words, into score */
+static void screen_line_variance(T_DB set, size_t nlines, double *score) {
+  const size_t n = set->nelem, nq = set->size_in_qwords;
+  const size_t step =
+      n > BIT_SCREEN_SAMPLE_ROWS ? n / BIT_SCREEN_SAMPLE_ROWS : 1;
+  for (size_t l = 0; l < nlines; l++) {
+    double sum = 0, sum2 = 0;
+    size_t rows = 0;
+    for (size_t i = 0; i < n; i += step, rows++) {
+      const uint64_t *row = set->qwords + i * set->stride_in_qwords;
+      int c = 0;
+      for (size_t w = l * SCREEN_LINE_WORDS;
+           w < nq && w < (l + 1) * SCREEN_LINE_WORDS; w++)
+        c += POPCOUNT(row[w]);
+      sum += c;
+      sum2 += (double)c * c;
+    }
+    score[l] = rows ? sum2 / rows - (sum / rows) * (sum / rows) : 0;
+  }
 }
 
-/* --- 11d. CPU set operations (allocate and return counts buffer) --- */
+/* Matches of every query, as the threshold searches keep them */
+typedef struct {
+  int **idx, **cnt;
+  size_t *nmatch, *cap;
+} screen_lists;
 
-int *BitDB_inter_count_cpu(T_DB bit, T_DB bits, SETOP_COUNT_OPTS opts) {
+static screen_lists screen_lists_new(int nqueries) {
+  const size_t n = nqueries ? (size_t)nqueries : 1;
+  screen_lists lists = {calloc(n, sizeof(int *)), calloc(n, sizeof(int *)),
+                        calloc(n, sizeof(size_t)), calloc(n, sizeof(size_t))};
+  assert(lists.idx && lists.cnt && lists.nmatch && lists.cap);
+  return lists;
+}
 
-  int *counts = (int *)calloc(bit->nelem * bits->nelem, sizeof(int));
-  assert(counts != NULL);
-  BitDB_inter_count_store_cpu(bit, bits, counts, opts);
-  return counts;
+/* Only the thread of query q adds to its list */
+static inline void screen_lists_add(screen_lists *lists, int q, int t,
+                                    int c) {
+  if (lists->nmatch[q] == lists->cap[q]) {
+    lists->cap[q] = lists->cap[q] ? 2 * lists->cap[q] : 16;
+    lists->idx[q] = realloc(lists->idx[q], lists->cap[q] * sizeof(int));
+    lists->cnt[q] = realloc(lists->cnt[q], lists->cap[q] * sizeof(int));
+    assert(lists->idx[q] && lists->cnt[q]);
+  }
+  lists->idx[q][lists->nmatch[q]] = t;
+  lists->cnt[q][lists->nmatch[q]++] = c;
 }
 
-void BitDB_inter_count_store_cpu(T_DB bit, T_DB bits, int *counts,
-                                 SETOP_COUNT_OPTS opts) {
+/* The lists into the CSR layout of BitDB_inter_count_threshold, freeing
+   them; returns the number of matches */
+static size_t screen_lists_csr(screen_lists *lists, int nqueries,
+                               size_t *offsets, int **out_idx,
+                               int **out_count) {
+  offsets[0] = 0;
+  for (int q = 0; q < nqueries; q++)
+    offsets[q + 1] = offsets[q] + lists->nmatch[q];
+  const size_t total = offsets[nqueries];
+  *out_idx = malloc((total ? total : 1) * sizeof(int));
+  *out_count = malloc((total ? total : 1) * sizeof(int));
+  assert(*out_idx && *out_count);
+  for (int q = 0; q < nqueries; q++) {
+    if (lists->nmatch[q]) {
+      memcpy(*out_idx + offsets[q], lists->idx[q],
+             lists->nmatch[q] * sizeof(int));
+      memcpy(*out_count + offsets[q], lists->cnt[q],
+             lists->nmatch[q] * sizeof(int));
+    }
+    free(lists->idx[q]);
+    free(lists->cnt[q]);
+  }
+  free(lists->idx);
+  free(lists->cnt);
+  free(lists->nmatch);
+  free(lists->cap);
+  return total;
+}
 
-  setop_count_db_cpu(bit, bits, counts, _AND, opts);
+static int screen_compare_int(const void *a, const void *b) {
+  const int x = *(const int *)a, y = *(const int *)b;
+  return (x > y) - (x < y);
 }
 
-int *BitDB_union_count_cpu(T_DB bit, T_DB bits, SETOP_COUNT_OPTS opts) {
+/* --- 8m''. Folded screening ---
+   Bit i of a row folds onto bit i mod L' of its folded row, with L' a
+   multiple of 64, so word w ORs into word w mod L'/64. A folded
+   intersection bounds nothing by itself, since shared bits can collide
+   with others, but with m[j] the number of query bits that fold onto
+   position j, a target shares at most the query bits landing on its own
+   folded bits: |A & B| <= sum of m[j] over the set bits j of fold(B). That
+   sum is a weighted count of the folded target, with nibble tables of the
+   query's m[j] (see Bit_W_T), so the screen reads the folded rows only.
+*/
 
-  int *counts = (int *)calloc(bit->nelem * bits->nelem, sizeof(int));
-  assert(counts != NULL);
-  BitDB_union_count_store_cpu(bit, bits, counts, opts);
-  return counts;
+static void fold_row(const uint64_t *row, size_t nq, uint64_t *folded,
+                     size_t nqf) {
+  memset(folded, 0, nqf * sizeof(uint64_t));
+  for (size_t w = 0; w < nq; w++)
+    folded[w % nqf] |= row[w];
 }
 
-void BitDB_union_count_store_cpu(T_DB bit, T_DB bits, int *counts,
-                                 SETOP_COUNT_OPTS opts) {
-  setop_count_db_cpu(bit, bits, counts, _OR, opts);
+/* Nibble tables (256 floats per folded word) of the bit multiplicities of
+   the folded query row; the sums are exact integers below 2^24 */
+static void fold_bound_tables(const uint64_t *row, size_t nq, size_t nqf,
+                              float *tables) {
+  float m[64];
+  for (size_t f = 0; f < nqf; f++) {
+    for (int b = 0; b < 64; b++)
+      m[b] = 0.0f;
+    for (size_t w = f; w < nq; w += nqf)
+      for (uint64_t x = row[w]; x; x &= x - 1)
+        m[__builtin_ctzll(x)] += 1.0f;
+    for (int nib = 0; nib < 16; nib++) {
+      float *t = tables + f * 256 + (size_t)nib * 16;
+      t[0] = 0.0f;
+      for (int v = 1; v < 16; v++)
+        t[v] = t[v & (v - 1)] + m[nib * 4 + __builtin_ctz((unsigned int)v)];
+    }
+  }
 }
 
-int *BitDB_diff_count_cpu(T_DB bit, T_DB bits, SETOP_COUNT_OPTS opts) {
+#define FOLDED_CHECKS(bit, bits, folded)                                       \
+  SETOP_DB_CHECKS(bit, bits)                                                   \
+  assert(folded != NULL);                                                      \
+  assert(folded->nelem == bits->nelem);                                        \
+  assert(folded->length % 64 == 0 && folded->length <= bits->length);
 
-  int *counts = (int *)calloc(bit->nelem * bits->nelem, sizeof(int));
-  assert(counts != NULL);
-  BitDB_diff_count_store_cpu(bit, bits, counts, opts);
-  return counts;
+/* Bound on the intersection of the query of tables with folded row frow */
+#define FOLDED_BOUND(weighted_count, frow, nqf, tables)                        \
+  ((int)((weighted_count)(BIT_OP_AND, frow, frow, nqf, tables) + 0.5f))
+
+/* --- 8n. Full similarity matrices ---
+   Like the search modes, every tile of counts becomes similarities while it
+   is still in cache; only the float (or 16 bit fixed point) matrix is
+   written.
+*/
+
+typedef struct {
+  search_ctx ctx;
+  size_t ntargets;     // row length of the output matrix
+  float *out;          // float output, or NULL
+  uint16_t *out_fixed; // fixed point output (65535 = 1.0), or NULL
+} similarity_store_state;
+
+static void similarity_store_fold(void *cl, int first_query, int nquery,
+                                  int first_target, int ntarget,
+                                  const int *tile) {
+  similarity_store_state *state = cl;
+  for (int i = 0; i < nquery; i++) {
+    int q = first_query + i;
+    const int *row = tile + (size_t)i * ntarget;
+    size_t shift = (size_t)q * state->ntargets + first_target;
+    for (int j = 0; j < ntarget; j++) {
+      float s = SIMILARITY_SCORE(&state->ctx, row[j], q, first_target + j);
+      if (state->out)
+        state->out[shift + j] = s;
+      else
+        state->out_fixed[shift + j] = (uint16_t)(s * 65535.0f + 0.5f);
+    }
+  }
 }
 
-void BitDB_diff_count_store_cpu(T_DB bit, T_DB bits, int *counts,
-                                SETOP_COUNT_OPTS opts) {
-  setop_count_db_cpu(bit, bits, counts, _XOR, opts);
+/* Row popcounts of a container, from its count cache when it has one */
+static int *db_row_cards(T_DB set, SETOP_COUNT_OPTS opts) {
+  int *cards = malloc((size_t)set->nelem * sizeof(int));
+  assert(cards != NULL);
+  if (set->row_counts)
+    memcpy(cards, set->row_counts, (size_t)set->nelem * sizeof(int));
+  else
+    BitDB_count_store(set, cards, opts);
+  return cards;
 }
 
-int *BitDB_minus_count_cpu(T_DB bit, T_DB bits, SETOP_COUNT_OPTS opts) {
+/* --- 8o. One-pass multi-operation counts ---
+   With c = |A & B| and the row popcounts a = |A|, b = |B|, every other
+   count follows from inclusion-exclusion: |A | B| = a + b - c,
+   |A ^ B| = a + b - 2c and |A & ~B| = a - c. A single intersection pass
+   therefore serves any subset of the four ops.
+*/
 
-  int *counts = (int *)calloc(bit->nelem * bits->nelem, sizeof(int));
-  assert(counts != NULL);
-  BitDB_minus_count_store_cpu(bit, bits, counts, opts);
-  return counts;
+typedef struct {
+  const int *query_cards;  // |A| of every query row
+  const int *target_cards; // |B| of every target row
+  size_t ntargets;         // row length of the outputs
+  int *out[BIT_OP_COUNT];  // per op output, NULL if not requested
+} multi_count_state;
+
+static void multi_count_fold(void *cl, int first_query, int nquery,
+                             int first_target, int ntarget, const int *tile) {
+  multi_count_state *state = cl;
+  for (int i = 0; i < nquery; i++) {
+    int q = first_query + i;
+    int a = state->query_cards[q];
+    const int *row = tile + (size_t)i * ntarget;
+    const int *b = state->target_cards + first_target;
+    size_t shift = (size_t)q * state->ntargets + first_target;
+    if (state->out[BIT_OP_AND])
+      memcpy(state->out[BIT_OP_AND] + shift, row, ntarget * sizeof(int));
+    if (state->out[BIT_OP_OR]) {
+      int *out = state->out[BIT_OP_OR] + shift;
+      for (int j = 0; j < ntarget; j++)
+        out[j] = a + b[j] - row[j];
+    }
+    if (state->out[BIT_OP_XOR]) {
+      int *out = state->out[BIT_OP_XOR] + shift;
+      for (int j = 0; j < ntarget; j++)
+        out[j] = a + b[j] - 2 * row[j];
+    }
+    if (state->out[BIT_OP_AND_NOT]) {
+      int *out = state->out[BIT_OP_AND_NOT] + shift;
+      for (int j = 0; j < ntarget; j++)
+        out[j] = a - row[j];
+    }
+  }
 }
 
-void BitDB_minus_count_store_cpu(T_DB bit, T_DB bits, int *counts,
-                                 SETOP_COUNT_OPTS opts) {
-  setop_count_db_cpu(bit, bits, counts, _AND_NOT, opts);
+/* --- 8p. Symmetric self-joins ---
+   The rows are cut into blocks of BIT_SELF_BLOCK and only block pairs
+   (bi, bj) with bi <= bj are counted. The pairs are numbered column by
+   column, p = bj (bj + 1) / 2 + bi, and handed out dynamically, so all
+   threads draw from one queue of equally sized tiles whatever the shape of
+   the triangle. Diagonal blocks are counted in full and folded above the
+   diagonal only.
+*/
+
+/* Offset of (i, j), i <= j, in the row-major packed upper triangle */
+static inline size_t self_packed_offset(size_t n, size_t i, size_t j) {
+  return i * n - i * (i - 1) / 2 + (j - i);
+}
+
+static void db_count_self(bit_setop_id op, T_DB set, int *counts,
+                          Bit_self_layout layout, SETOP_COUNT_OPTS opts) {
+  assert(set && counts);
+  assert(layout == BIT_SELF_MIRROR || layout == BIT_SELF_PACKED);
+  const bit_kernel_table *k = bit_kernels_active();
+  size_t n = set->nelem;
+  long nblocks = (long)((n + BIT_SELF_BLOCK - 1) / BIT_SELF_BLOCK);
+  long npairs = nblocks * (nblocks + 1) / 2;
+  SETOP_COUNT_OPTS serial = opts;
+  serial.num_cpu_threads = 1; // the block pairs are the parallel work
+  serial.store = BIT_STORE_CACHED; // the tile is read back at once
+#pragma omp parallel num_threads(cpu_threads(opts))
+  {
+    int *tile = db_scratch(opts, (size_t)BIT_SELF_BLOCK * BIT_SELF_BLOCK);
+#pragma omp for schedule(dynamic)
+    for (long p = 0; p < npairs; p++) {
+      long bj = (long)((sqrt(8.0 * p + 1) - 1) / 2);
+      while (bj * (bj + 1) / 2 > p) // mend floating point rounding
+        bj--;
+      while ((bj + 1) * (bj + 2) / 2 <= p)
+        bj++;
+      long bi = p - bj * (bj + 1) / 2;
+      size_t first_i = (size_t)bi * BIT_SELF_BLOCK;
+      size_t first_j = (size_t)bj * BIT_SELF_BLOCK;
+      int ni = (int)(n - first_i < BIT_SELF_BLOCK ? n - first_i
+                                                  : BIT_SELF_BLOCK);
+      int nj = (int)(n - first_j < BIT_SELF_BLOCK ? n - first_j
+                                                  : BIT_SELF_BLOCK);
+      struct T_DB rows_i, rows_j;
+      db_slice(&rows_i, set, first_i, ni);
+      db_slice(&rows_j, set, first_j, nj);
+      k->setop_count_db[op](&rows_i, &rows_j, tile, serial);
+      for (int x = 0; x < ni; x++) {
+        size_t i = first_i + x;
+        int y = bi == bj ? x : 0; // upper triangle of a diagonal block
+        const int *row = tile + (size_t)x * nj;
+        if (layout == BIT_SELF_PACKED) {
+          memcpy(counts + self_packed_offset(n, i, first_j + y), row + y,
+                 (nj - y) * sizeof(int));
+          continue;
+        }
+        for (; y < nj; y++) {
+          size_t j = first_j + y;
+          counts[i * n + j] = row[y];
+          counts[j * n + i] = row[y];
+        }
+      }
+    }
+    db_scratch_done(opts, tile);
+  }
+}
+
+/* --- 8q. NUMA placement of container rows ---
+   Pages of an anonymous mapping land on the node of the thread that first
+   writes them, unless an mbind policy says otherwise. The first touch walks
+   the rows in the tiles of the active tuning, statically partitioned over
+   the threads of opts: the same partition setop_count_db_cpu gives the rows
+   of its first operand when that operand was placed this way. The policy is
+   set through the raw system call, so that there is no libnuma dependency.
+*/
+
+#if BIT_DB_MREMAP
+#define BIT_MPOL_INTERLEAVE 3 // from <linux/mempolicy.h>
+
+static void db_numa_interleave(void *rows, size_t bytes) {
+  FILE *online = fopen("/sys/devices/system/node/online", "r");
+  if (online == NULL)
+    return; // no NUMA support: the pages stay where they are touched
+  unsigned long nodes = 0; // up to 64 nodes
+  int first, last, nnodes = 0;
+  while (fscanf(online, "%d", &first) == 1) {
+    last = first;
+    if (fscanf(online, "-%d", &last) != 1)
+      last = first;
+    for (int node = first; node <= last && node < 64; node++, nnodes++)
+      nodes |= 1ul << node;
+    if (fgetc(online) != ',')
+      break;
+  }
+  fclose(online);
+  if (nnodes > 1) // a failed mbind leaves the default policy, still correct
+    (void)syscall(SYS_mbind, rows, bytes, BIT_MPOL_INTERLEAVE, &nodes,
+                  (unsigned long)65, 0u);
+}
+
+static void db_numa_first_touch(T_DB set, SETOP_COUNT_OPTS opts) {
+  const int tile = bit_tuning_resolve(opts).tile;
+  const int ntiles = (int)((set->capacity + tile - 1) / tile);
+#pragma omp parallel for schedule(static) num_threads(cpu_threads(opts))
+  for (int t = 0; t < ntiles; t++) {
+    size_t first = (size_t)t * tile;
+    size_t nrows = set->capacity - first < (size_t)tile ? set->capacity - first
+                                                        : (size_t)tile;
+    memset(set->bytes + first * set->stride_in_bytes, 0,
+           nrows * set->stride_in_bytes);
+  }
+}
+#endif
+
+/* --- 8q'. Thread affinity of the count teams ---
+   A Bit_affinity resolves to a list of logical CPUs: those the calling
+   thread may run on, narrowed to the listed CPUs and packages, and to one
+   hardware thread per core. Thread t of the team is pinned to CPU t of the
+   list for the call, in a parallel region of its own before the kernel,
+   and a second region after it gives every thread its mask back. OpenMP
+   reuses the threads of its pool, so the mask a thread had is kept in
+   thread-local storage between the two. The topology is read from sysfs
+   once, for the CPUs the system was configured with.
+*/
+
+#if BIT_DB_MREMAP
+static int cpu_package[CPU_SETSIZE], cpu_core[CPU_SETSIZE];
+static int cpu_topology_cpus; // CPUs with an entry in the two above
+static atomic_bool cpu_topology_read;
+static _Thread_local cpu_set_t affinity_saved; // mask before affinity_pin
+static _Thread_local bool affinity_pinned;
+static _Thread_local int affinity_dynamic; // omp_get_dynamic() of the caller
+
+static int sysfs_topology(int cpu, const char *field, int fallback) {
+  char path[96];
+  snprintf(path, sizeof(path), "/sys/devices/system/cpu/cpu%d/topology/%s",
+           cpu, field);
+  FILE *file = fopen(path, "r");
+  if (file == NULL)
+    return fallback;
+  int value;
+  if (fscanf(file, "%d", &value) != 1 || value < 0)
+    value = fallback;
+  fclose(file);
+  return value;
+}
+
+static void cpu_topology(void) {
+  if (atomic_load_explicit(&cpu_topology_read, memory_order_acquire))
+    return;
+#pragma omp critical(bit_cpu_topology)
+  if (!atomic_load_explicit(&cpu_topology_read, memory_order_relaxed)) {
+    long ncpus = sysconf(_SC_NPROCESSORS_CONF);
+    cpu_topology_cpus = ncpus < 1            ? 0
+                        : ncpus > CPU_SETSIZE ? CPU_SETSIZE
+                                              : (int)ncpus;
+    for (int cpu = 0; cpu < cpu_topology_cpus; cpu++) {
+      cpu_package[cpu] = sysfs_topology(cpu, "physical_package_id", 0);
+      cpu_core[cpu] = sysfs_topology(cpu, "core_id", cpu);
+    }
+    atomic_store_explicit(&cpu_topology_read, true, memory_order_release);
+  }
+}
+
+/* The CPUs of affinity, in team order, into cpus (CPU_SETSIZE entries) */
+static int affinity_resolve(const Bit_affinity *affinity, int *cpus) {
+  assert(affinity->ncpus >= 0 && (affinity->cpus || !affinity->ncpus));
+  cpu_set_t allowed, kept;
+  if (sched_getaffinity(0, sizeof(allowed), &allowed) != 0)
+    return 0;
+  cpu_topology();
+  CPU_ZERO(&kept);
+  int n = 0;
+  const int ncandidates = affinity->cpus ? affinity->ncpus : CPU_SETSIZE;
+  for (int c = 0; c < ncandidates; c++) {
+    const int cpu = affinity->cpus ? affinity->cpus[c] : c;
+    if (cpu < 0 || cpu >= CPU_SETSIZE || !CPU_ISSET(cpu, &allowed) ||
+        CPU_ISSET(cpu, &kept))
+      continue;
+    const bool known = cpu < cpu_topology_cpus;
+    const int package = known ? cpu_package[cpu] : 0;
+    const int core = known ? cpu_core[cpu] : cpu;
+    if (affinity->sockets &&
+        (package >= 64 || !(affinity->sockets >> package & 1)))
+      continue;
+    bool sibling = false;
+    if (affinity->smt == BIT_SMT_ONE_PER_CORE)
+      for (int k = 0; k < n && !sibling; k++)
+        sibling = cpus[k] < cpu_topology_cpus &&
+                  cpu_package[cpus[k]] == package && cpu_core[cpus[k]] == core;
+    if (sibling)
+      continue;
+    CPU_SET(cpu, &kept);
+    cpus[n++] = cpu;
+  }
+  return n;
+}
+
+static void affinity_pin(const int *cpus, int ncpus, int nthreads) {
+#pragma omp parallel num_threads(nthreads)
+  {
+    cpu_set_t one;
+    CPU_ZERO(&one);
+    CPU_SET(cpus[omp_get_thread_num() % ncpus], &one);
+    affinity_pinned =
+        sched_getaffinity(0, sizeof(affinity_saved), &affinity_saved) == 0 &&
+        sched_setaffinity(0, sizeof(one), &one) == 0;
+  }
+}
+
+/* OpenMP does not promise that a team is made of the same pool threads as
+   the one before it. With dynamic adjustment off for the length of the call
+   (count_team_pin) the runtimes reuse their pool in order, so the team that
+   restores the masks is the team that pinned and counted; a runtime that
+   hands other threads to it would leave those of the pin on their CPU */
+static void affinity_unpin(int nthreads) {
+#pragma omp parallel num_threads(nthreads)
+  if (affinity_pinned) {
+    (void)sched_setaffinity(0, sizeof(affinity_saved), &affinity_saved);
+    affinity_pinned = false;
+  }
+}
+#endif
+
+/* Pins the team of a count store made with *opts, sizing it to the CPUs of
+   opts->affinity if it has no size; returns the threads to unpin, or 0. An
+   affinity that keeps no CPU (a package or CPUs the process does not have)
+   leaves the team as it is, unpinned */
+static int count_team_pin(SETOP_COUNT_OPTS *opts) {
+#if BIT_DB_MREMAP
+  if (opts->affinity == NULL || bit_exec_tasks(*opts))
+    return 0;
+  int *cpus = malloc(CPU_SETSIZE * sizeof(int));
+  assert(cpus != NULL);
+  const int ncpus = affinity_resolve(opts->affinity, cpus);
+  if (ncpus == 0) {
+    free(cpus);
+    return 0;
+  }
+  if (opts->num_cpu_threads <= 0)
+    opts->num_cpu_threads = ncpus;
+  affinity_dynamic = omp_get_dynamic();
+  omp_set_dynamic(0); // the same team pins, counts and unpins
+  affinity_pin(cpus, ncpus, opts->num_cpu_threads);
+  free(cpus);
+  return opts->num_cpu_threads;
+#else
+  (void)opts;
+  return 0;
+#endif
+}
+
+static void count_team_unpin(int nthreads) {
+#if BIT_DB_MREMAP
+  if (nthreads > 0) {
+    affinity_unpin(nthreads);
+    omp_set_dynamic(affinity_dynamic);
+  }
+#else
+  (void)nthreads;
+#endif
+}
+
+/* --- 8r. Micro-batching queues ---
+   The lock of a queue guards its open batch and the done flag of every
+   batch; the counts of a batch are written by the one thread that took the
+   batch off the queue, before it sets done under the lock. Waiters poll
+   with a short sleep, as a batch is open for microseconds to milliseconds.
+*/
+
+static void queue_pause(void) {
+#if BIT_DB_MMAP_FILES
+  nanosleep(&(struct timespec){0, 20000}, NULL); // 20 us
+#endif
+}
+
+static void queue_run(Bit_queue_T queue, bit_batch *batch) {
+  struct T_DB queries;
+  db_slice(&queries, batch->rows, 0, batch->nrows);
+  int *counts = malloc((size_t)batch->nrows * queue->db->nelem * sizeof(int));
+  assert(counts != NULL);
+  db_count_store(queue->op, &queries, queue->db, counts, queue->opts);
+  omp_set_lock(&queue->lock);
+  batch->counts = counts;
+  batch->done = true;
+  omp_unset_lock(&queue->lock);
+}
+
+/* --- 8s. Row order by popcount --- */
+
+typedef struct {
+  int card; // popcount of the row
+  int row;  // its index before sorting
+} card_row;
+
+static int card_row_compare(const void *a, const void *b) {
+  const card_row *x = a, *y = b;
+  if (x->card != y->card)
+    return x->card < y->card ? -1 : 1;
+  return (x->row > y->row) - (x->row < y->row); // stable
+}
+
+/* Gray-code order of two rows of nq qwords, bit 0 the most significant:
+   the rows are compared by the rank of the reflected Gray code each one
+   is. At the first bit p where they differ, the rank bit is that bit
+   XORed with the parity of the bits before p, which the rows share */
+static int gray_compare(const uint64_t *a, const uint64_t *b, size_t nq) {
+  unsigned int parity = 0;
+  for (size_t w = 0; w < nq; w++) {
+    const uint64_t diff = a[w] ^ b[w];
+    if (diff == 0) {
+      parity ^= (unsigned int)__builtin_popcountll(a[w]) & 1;
+      continue;
+    }
+    const int p = __builtin_ctzll(diff);
+    parity ^= (unsigned int)__builtin_popcountll(
+                  a[w] & ((UINT64_C(1) << p) - 1)) & 1;
+    return ((a[w] >> p) & 1) ^ parity ? 1 : -1;
+  }
+  return 0;
+}
+
+typedef struct {
+  int card;               // popcount of the row, or 0 when not ordered by it
+  int row;                // its index before sorting
+  const uint64_t *qwords; // its bits
+  size_t nq;
+} gray_row;
+
+static int gray_row_compare(const void *a, const void *b) {
+  const gray_row *x = a, *y = b;
+  if (x->card != y->card)
+    return x->card < y->card ? -1 : 1;
+  const int order = gray_compare(x->qwords, y->qwords, x->nq);
+  if (order != 0)
+    return order;
+  return (x->row > y->row) - (x->row < y->row); // stable
+}
+
+/* --- 8s'. Row deduplication ---
+   Rows are grouped by hash, and rows of a group are compared word by word
+   with the distinct rows found in it so far, so a collision never merges
+   different rows. Results counted against the distinct rows are expanded
+   back to the rows they stand for.
+*/
+
+typedef struct {
+  uint64_t hash; // BitDB_hash_rows of the row
+  int row;       // its index
+} hash_row;
+
+static int hash_row_compare(const void *a, const void *b) {
+  const hash_row *x = a, *y = b;
+  if (x->hash != y->hash)
+    return x->hash < y->hash ? -1 : 1;
+  return (x->row > y->row) - (x->row < y->row); // first row first
+}
+
+typedef struct {
+  int idx;   // target row
+  int count; // its count
+} dedup_match;
+
+static int dedup_match_by_idx(const void *a, const void *b) {
+  const dedup_match *x = a, *y = b;
+  return (x->idx > y->idx) - (x->idx < y->idx);
+}
+
+/* Rows that map to every distinct row: rows[offsets[u]] ..
+   rows[offsets[u + 1] - 1], increasing. A NULL map is the identity. */
+typedef struct {
+  int nunique;
+  int *offsets; // nunique + 1 entries
+  int *rows;
+} dedup_members;
+
+static dedup_members dedup_members_new(const int *map, int n) {
+  dedup_members m = {0};
+  for (int i = 0; i < n; i++) {
+    const int u = map ? map[i] : i;
+    if (u >= m.nunique)
+      m.nunique = u + 1;
+  }
+  m.offsets = calloc((size_t)m.nunique + 1, sizeof(int));
+  m.rows = malloc(((size_t)n ? (size_t)n : 1) * sizeof(int));
+  assert(m.offsets && m.rows);
+  for (int i = 0; i < n; i++)
+    m.offsets[(map ? map[i] : i) + 1]++;
+  for (int u = 0; u < m.nunique; u++)
+    m.offsets[u + 1] += m.offsets[u];
+  int *next = malloc(((size_t)m.nunique ? (size_t)m.nunique : 1) *
+                     sizeof(int));
+  assert(next != NULL);
+  memcpy(next, m.offsets, (size_t)m.nunique * sizeof(int));
+  for (int i = 0; i < n; i++)
+    m.rows[next[map ? map[i] : i]++] = i;
+  free(next);
+  return m;
+}
+
+static void dedup_members_free(dedup_members *m) {
+  free(m->offsets);
+  free(m->rows);
+}
+
+/* --- 8t. Narrow count matrices ---
+   Tiles of int counts from db_count_tiles are narrowed into the output as
+   they come, like the similarity matrices of 8n.
+*/
+
+typedef struct {
+  size_t ntargets;      // row length of the output matrix
+  Bit_counts_type type; // BIT_COUNTS_U8, BIT_COUNTS_U16 or BIT_COUNTS_I32
+  void *out;
+} typed_store_state;
+
+static void typed_store_fold(void *cl, int first_query, int nquery,
+                             int first_target, int ntarget, const int *tile) {
+  typed_store_state *state = cl;
+  for (int i = 0; i < nquery; i++) {
+    const int *row = tile + (size_t)i * ntarget;
+    size_t shift = (size_t)(first_query + i) * state->ntargets + first_target;
+    if (state->type == BIT_COUNTS_U8) {
+      uint8_t *out = (uint8_t *)state->out + shift;
+      OMP_CPU_SIMD
+      for (int j = 0; j < ntarget; j++)
+        out[j] = (uint8_t)row[j];
+    } else if (state->type == BIT_COUNTS_I32) {
+      memcpy((int *)state->out + shift, row, (size_t)ntarget * sizeof(int));
+    } else {
+      uint16_t *out = (uint16_t *)state->out + shift;
+      OMP_CPU_SIMD
+      for (int j = 0; j < ntarget; j++)
+        out[j] = (uint16_t)row[j];
+    }
+  }
+}
+
+/* The int count matrix of bit against bits. Concurrent containers take the
+   tiles of db_count_tiles, which count again what a writer tore, instead of
+   the one pass of the kernel. */
+static void db_count_store(bit_setop_id op, T_DB bit, T_DB bits, int *counts,
+                           SETOP_COUNT_OPTS opts) {
+  const int pinned = count_team_pin(&opts);
+  if (bit->row_seqs || bits->row_seqs) {
+    typed_store_state state = {bits->nelem, BIT_COUNTS_I32, counts};
+    db_count_tiles(op, bit, bits, opts, typed_store_fold, &state);
+  } else {
+    count_kernels(bit, bits, opts)->setop_count_db[op](bit, bits, counts,
+                                                       opts);
+  }
+  count_team_unpin(pinned);
+}
+
+/* The stop state of the CPU count store running on this thread, until its
+   kernel takes it (see bit_stop) */
+_Thread_local bit_stop *bit_stop_armed;
+
+void bit_stop_begin(bit_stop *stop, SETOP_COUNT_OPTS opts, int nqueries,
+                    size_t row_bytes) {
+  stop->cancel = opts.cancel;
+  stop->deadline = opts.deadline;
+  atomic_init(&stop->stopped, false);
+  stop->nqueries = nqueries;
+  stop->tile = 1;
+  stop->tiles_per_row = 0;
+  stop->done = NULL;
+  stop->on_tile = opts.on_tile;
+  stop->on_progress = opts.on_progress;
+  stop->hook_cl = opts.hook_cl;
+  stop->row_bytes = row_bytes;
+  stop->tiles_total = 0;
+  atomic_init(&stop->tiles_done, 0);
+  atomic_init(&stop->bytes_done, 0);
+}
+
+/* The hooks of a counted tile, on the thread that counted it */
+void bit_stop_notify(bit_stop *stop, int first_query, int nquery,
+                     int first_target, int ntarget) {
+  if (stop->on_tile)
+    stop->on_tile(stop->hook_cl, first_query, nquery, first_target, ntarget);
+  if (stop->on_progress) {
+    const uint64_t bytes = (uint64_t)(nquery + ntarget) * stop->row_bytes;
+    const size_t tiles =
+        atomic_fetch_add_explicit(&stop->tiles_done, 1, memory_order_relaxed);
+    const uint64_t scanned = atomic_fetch_add_explicit(
+        &stop->bytes_done, bytes, memory_order_relaxed);
+    stop->on_progress(stop->hook_cl, tiles + 1, stop->tiles_total,
+                      scanned + bytes);
+  }
+}
+
+/* The armed stop state, disarmed, for a kernel of query tiles of tile rows
+   and tiles_per_row target tiles each; NULL if none is armed */
+bit_stop *bit_stop_take(int tile, int tiles_per_row) {
+  bit_stop *stop = bit_stop_armed;
+  if (stop == NULL)
+    return NULL;
+  bit_stop_armed = NULL;
+  assert(tile > 0);
+  int ntiles = (stop->nqueries + tile - 1) / tile;
+  stop->tile = tile;
+  stop->tiles_per_row = tiles_per_row;
+  stop->tiles_total = (size_t)ntiles * (size_t)tiles_per_row;
+  stop->done = calloc(ntiles > 0 ? ntiles : 1, sizeof(*stop->done));
+  assert(stop->done != NULL);
+  return stop;
+}
+
+/* The leading queries whose tiles were all counted */
+int bit_stop_end(bit_stop *stop) {
+  int done = stop->nqueries;
+  if (stop->done != NULL &&
+      atomic_load_explicit(&stop->stopped, memory_order_relaxed)) {
+    const int ntiles = (stop->nqueries + stop->tile - 1) / stop->tile;
+    int t = 0;
+    while (t < ntiles &&
+           atomic_load_explicit(&stop->done[t], memory_order_relaxed) ==
+               stop->tiles_per_row)
+      t++;
+    if ((long)t * stop->tile < done)
+      done = t * stop->tile;
+  }
+  free((void *)stop->done);
+  stop->done = NULL;
+  return done;
+}
+
+void bit_stop_report(Bit_progress *progress, int nqueries, int done) {
+  if (progress != NULL)
+    *progress = (Bit_progress){done < nqueries, done};
+}
+
+/* Segment counts (opts.bit_lo, opts.bit_hi): the kernels take the stride
+   of the rows for their width, so the words of the segment are copied into
+   rows of their own, the words at its ends masked. The copy reads each row
+   once, against the pairs of rows of the count */
+static T_DB range_rows(T_DB set, int lo, int hi, int nthreads) {
+  const size_t w0 = (size_t)lo / 64, nw = ((size_t)hi + 63) / 64 - w0;
+  const uint64_t head = ~UINT64_C(0) << (lo % 64);
+  const uint64_t tail = hi % 64 ? (UINT64_C(1) << (hi % 64)) - 1
+                                : ~UINT64_C(0);
+  T_DB rows = BitDB_new((int)(nw * 64), (int)set->nelem);
+  const int nrows = (int)set->nelem;
+#pragma omp parallel for num_threads(nthreads) schedule(static)
+  for (int r = 0; r < nrows; r++) {
+    const uint64_t *src = set->qwords + (size_t)r * set->stride_in_qwords + w0;
+    uint64_t *dst = rows->qwords + (size_t)r * rows->stride_in_qwords;
+    memcpy(dst, src, nw * sizeof(uint64_t));
+    dst[0] &= head;
+    dst[nw - 1] &= tail;
+  }
+  return rows;
+}
+
+/* K-split counts of few long rows: when the rows make fewer cache tiles
+   than the team has threads, the tile loop of the kernels leaves threads
+   idle however long the rows are, so the words are split instead. Each
+   thread takes an aligned word range of every row (split_range) and counts
+   the pairs over it, k_block qwords of the rows at a time so that the
+   slices of all the rows stay in cache, into partial counts of its own;
+   the partials are then added into the zeroed counts atomically, a few
+   per thread. The ranges get BIT_PARALLEL_CHUNK_BYTES of pair work each
+   at least */
+static int ksplit_ranges(T_DB bit, T_DB bits, SETOP_COUNT_OPTS opts) {
+  const int threads = cpu_threads(opts);
+  if (threads < 2 || omp_in_parallel() || bit->row_seqs || bits->row_seqs)
+    return 1;
+  const size_t tile = (size_t)bit_tuning_resolve(opts).tile;
+  const size_t tiles = (bit->nelem + tile - 1) / tile *
+                       ((bits->nelem + tile - 1) / tile);
+  if (tiles >= (size_t)threads)
+    return 1;
+  const uint64_t work = (uint64_t)bit->nelem * bits->nelem *
+                        bit->size_in_qwords * sizeof(uint64_t);
+  const uint64_t most = work / BIT_PARALLEL_CHUNK_BYTES;
+  const uint64_t blocks = bit->size_in_qwords / (ALIGNMENT / sizeof(uint64_t));
+  const uint64_t n = most < blocks ? most : blocks;
+  return n < 2 ? 1 : n < (uint64_t)threads ? (int)n : threads;
+}
+
+/* Stack Bit_T header over qwords [first, first + nq) of row r of set */
+static struct T ksplit_view(T_DB set, int r, size_t first, size_t nq) {
+  uint64_t *row = set->qwords + (size_t)r * set->stride_in_qwords + first;
+  return (struct T){.length = (unsigned int)(nq * BPQW),
+                    .size_in_bytes = (unsigned int)(nq * sizeof(uint64_t)),
+                    .size_in_qwords = (unsigned int)nq,
+                    .bytes = (unsigned char *)row,
+                    .qwords = row};
+}
+
+static void db_count_ksplit(bit_setop_id op, T_DB bit, T_DB bits,
+                            int *counts, int nranges, SETOP_COUNT_OPTS opts) {
+  int (*kernel)(T, T) = count_kernels(bit, bits, opts)->setop_count[op];
+  const int nqueries = (int)bit->nelem, ntargets = (int)bits->nelem;
+  const size_t pairs = (size_t)nqueries * ntargets;
+  const size_t nq = bit->size_in_qwords;
+  const size_t k_block = (size_t)bit_tuning_resolve(opts).k_block;
+  memset(counts, 0, pairs * sizeof(int));
+  const int pinned = count_team_pin(&opts);
+#pragma omp parallel num_threads(nranges)
+  {
+    // the team may come out smaller than asked for: split by its size
+    const int c = omp_get_thread_num(), n = omp_get_num_threads();
+    size_t first, len;
+    split_range(nq, n, c, &first, &len);
+    int *partial = calloc(pairs, sizeof(int));
+    assert(partial != NULL);
+    for (size_t k = first; k < first + len; k += k_block) {
+      const size_t w = first + len - k < k_block ? first + len - k : k_block;
+      for (int i = 0; i < nqueries; i++) {
+        struct T a = ksplit_view(bit, i, k, w);
+        for (int j = 0; j < ntargets; j++) {
+          struct T b = ksplit_view(bits, j, k, w);
+          partial[(size_t)i * ntargets + j] += kernel(&a, &b);
+        }
+      }
+    }
+    if (len > 0)
+      for (size_t p = 0; p < pairs; p++) {
+#pragma omp atomic update
+        counts[p] += partial[p];
+      }
+    free(partial);
+  }
+  count_team_unpin(pinned);
+}
+
+/* db_count_store for the count stores that honor opts.cancel,
+   opts.deadline and the hooks. Containers with row_seqs take the tiles,
+   which do not */
+static void db_count_store_stoppable(bit_setop_id op, T_DB bit, T_DB bits,
+                                     int *counts, SETOP_COUNT_OPTS opts) {
+  const int nqueries = (int)bit->nelem;
+  if (opts.bit_hi != 0) {
+    const int lo = opts.bit_lo, hi = opts.bit_hi;
+    assert(lo >= 0 && lo < hi && (unsigned int)hi <= bit->length);
+    opts.bit_lo = opts.bit_hi = 0;
+    T_DB rows = range_rows(bit, lo, hi, cpu_threads(opts));
+    T_DB targets = bit == bits ? rows : range_rows(bits, lo, hi,
+                                                   cpu_threads(opts));
+    db_count_store_stoppable(op, rows, targets, counts, opts);
+    if (targets != rows)
+      BitDB_free(&targets);
+    BitDB_free(&rows);
+    return;
+  }
+  if (!bit_stop_active(opts) || bit->row_seqs || bits->row_seqs) {
+    const int nranges = ksplit_ranges(bit, bits, opts);
+    if (nranges > 1)
+      db_count_ksplit(op, bit, bits, counts, nranges, opts);
+    else
+      db_count_store(op, bit, bits, counts, opts);
+    bit_stop_report(opts.progress, nqueries, nqueries);
+    return;
+  }
+  bit_stop stop;
+  bit_stop_begin(&stop, opts, nqueries, bit->size_in_bytes);
+  bit_stop_armed = &stop;
+  db_count_store(op, bit, bits, counts, opts);
+  bit_stop_armed = NULL;
+  bit_stop_report(opts.progress, nqueries, bit_stop_end(&stop));
+}
+
+/* A count matrix written to a file tile by tile (BitDB_count_store_file_cpu):
+   each row of a tile is narrowed into a buffer on the stack and written at
+   its place in the matrix, so no more than a tile is ever held */
+typedef struct {
+  int fd;
+  size_t ntargets;
+  Bit_counts_type type;
+  _Atomic bool failed;
+} file_store_state;
+
+#if BIT_DB_MMAP_FILES
+static void file_store_fold(void *cl, int first_query, int nquery,
+                            int first_target, int ntarget, const int *tile) {
+  file_store_state *state = cl;
+  const size_t size = state->type == BIT_COUNTS_U8    ? sizeof(uint8_t)
+                      : state->type == BIT_COUNTS_U16 ? sizeof(uint16_t)
+                                                      : sizeof(int);
+  unsigned char narrow[BIT_SEARCH_TARGET_BLOCK * sizeof(int)];
+  for (int i = 0; i < nquery && !atomic_load(&state->failed); i++) {
+    const int *row = tile + (size_t)i * ntarget;
+    if (state->type == BIT_COUNTS_U8) {
+      OMP_CPU_SIMD
+      for (int j = 0; j < ntarget; j++)
+        narrow[j] = (uint8_t)row[j];
+    } else if (state->type == BIT_COUNTS_U16) {
+      uint16_t *out = (uint16_t *)narrow;
+      OMP_CPU_SIMD
+      for (int j = 0; j < ntarget; j++)
+        out[j] = (uint16_t)row[j];
+    } else {
+      memcpy(narrow, row, (size_t)ntarget * sizeof(int));
+    }
+    const size_t at = (size_t)(first_query + i) * state->ntargets + first_target;
+    if (!writer_pwrite(state->fd, narrow, (size_t)ntarget * size,
+                       (off_t)(at * size)))
+      atomic_store(&state->failed, true);
+  }
+}
+
+/* The all-pairs matrix of a file of BitDB_count_store_file_cpu brought up to
+   date (BitDB_count_update_file_cpu): the tiles of the dirty rows against
+   every row are stored into a shared mapping of the file. rows puts tile
+   row i at matrix row dirty[first_query + i]; mirror stores it down the
+   column of that row as well, except at the dirty rows, which their own
+   tiles write. columns puts tile column j at matrix column
+   dirty[first_target + j], for the queries of every row (the MINUS counts,
+   which do not mirror). */
+typedef struct {
+  unsigned char *matrix;
+  size_t nelem;
+  Bit_counts_type type;
+  const int *dirty;
+  const unsigned char *is_dirty; // one byte per row
+  bool mirror, columns;
+} file_update_state;
+
+static inline void file_update_put(const file_update_state *state, size_t at,
+                                   int count) {
+  if (state->type == BIT_COUNTS_U8)
+    state->matrix[at] = (uint8_t)count;
+  else if (state->type == BIT_COUNTS_U16)
+    ((uint16_t *)state->matrix)[at] = (uint16_t)count;
+  else
+    ((int *)state->matrix)[at] = count;
+}
+
+static void file_update_fold(void *cl, int first_query, int nquery,
+                             int first_target, int ntarget, const int *tile) {
+  const file_update_state *state = cl;
+  const size_t n = state->nelem;
+  for (int i = 0; i < nquery; i++) {
+    const int *row = tile + (size_t)i * ntarget;
+    if (state->columns) {
+      const size_t at = (size_t)(first_query + i) * n;
+      for (int j = 0; j < ntarget; j++)
+        file_update_put(state, at + (size_t)state->dirty[first_target + j],
+                        row[j]);
+      continue;
+    }
+    const size_t r = (size_t)state->dirty[first_query + i];
+    for (int j = 0; j < ntarget; j++)
+      file_update_put(state, r * n + (size_t)(first_target + j), row[j]);
+    if (state->mirror)
+      for (int j = 0; j < ntarget; j++)
+        if (!state->is_dirty[first_target + j])
+          file_update_put(state, (size_t)(first_target + j) * n + r, row[j]);
+  }
+}
+#endif
+
+/* --- 8u. Page-locked (pinned) storage ---
+   Pinned blocks come from an OpenMP allocator with the pinned trait where
+   the runtime implements it (an offloading runtime then registers the pages
+   for DMA), else, on Linux, from an anonymous mapping locked with mlock. A
+   header of one ALIGNMENT unit in front of the payload records which, and
+   the size of the block, for pinned_free. When neither can lock the pages
+   (e.g. past RLIMIT_MEMLOCK) the block is ordinary aligned heap memory.
+*/
+
+typedef enum { PINNED_NONE, PINNED_OMP, PINNED_MLOCK } pinned_kind;
+
+typedef struct {
+  size_t bytes; // of the whole block, header included
+  pinned_kind kind;
+} pinned_header;
+
+static omp_allocator_handle_t pinned_allocator(void) {
+  static omp_allocator_handle_t allocator = omp_null_allocator;
+  static bool initialized = false;
+#pragma omp critical(bit_pinned_allocator)
+  if (!initialized) {
+    omp_alloctrait_t traits[] = {{omp_atk_pinned, omp_atv_true},
+                                 {omp_atk_alignment, ALIGNMENT},
+                                 {omp_atk_fallback, omp_atv_null_fb}};
+    allocator = omp_init_allocator(omp_default_mem_space, 3, traits);
+    initialized = true;
+  }
+  return allocator;
+}
+
+static void *pinned_calloc(size_t size) {
+  const size_t bytes = size + ALIGNMENT;
+  pinned_header *block = NULL;
+  pinned_kind kind = PINNED_OMP;
+  omp_allocator_handle_t allocator = pinned_allocator();
+  if (allocator != omp_null_allocator) {
+    block = omp_alloc(bytes, allocator);
+    if (block)
+      memset(block, 0, bytes);
+  }
+#if BIT_DB_MREMAP
+  if (block == NULL) {
+    kind = PINNED_MLOCK;
+    void *map = mmap(NULL, bytes, PROT_READ | PROT_WRITE,
+                     MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (map != MAP_FAILED && mlock(map, bytes) == 0)
+      block = map;
+    else if (map != MAP_FAILED)
+      munmap(map, bytes);
+  }
+#endif
+  if (block == NULL) {
+    kind = PINNED_NONE;
+    block = portable_aligned_calloc(ALIGNMENT, bytes);
+    if (block == NULL)
+      return NULL;
+  }
+  block->bytes = bytes;
+  block->kind = kind;
+  return (unsigned char *)block + ALIGNMENT;
+}
+
+static inline pinned_header *pinned_block(const void *ptr) {
+  return (pinned_header *)((unsigned char *)ptr - ALIGNMENT);
+}
+
+static void pinned_free(void *ptr) {
+  if (ptr == NULL)
+    return;
+  pinned_header *block = pinned_block(ptr);
+  switch (block->kind) {
+  case PINNED_OMP:
+    omp_free(block, omp_null_allocator);
+    break;
+#if BIT_DB_MREMAP
+  case PINNED_MLOCK:
+    munmap(block, block->bytes); // also unlocks the pages
+    break;
+#endif
+  default:
+    portable_aligned_free(block);
+  }
+}
+
+/* --- 8u'. Huge page storage ---
+   Huge blocks are anonymous mappings: of reserved huge pages (MAP_HUGETLB)
+   when those are asked for and the pool has them, else 2 MiB aligned and
+   advised MADV_HUGEPAGE, so that the kernel backs them with transparent
+   huge pages. A header of one ALIGNMENT unit in front of the payload
+   records the pages obtained and the extent of the mapping, for huge_free.
+   Off Linux the block is ordinary aligned heap memory.
+*/
+
+#define HUGE_PAGE_2M ((size_t)2 << 20)
+#define HUGE_PAGE_1G ((size_t)1 << 30)
+
+typedef struct {
+  void *base;            // of the mapping (or heap block)
+  size_t bytes;          // of the mapping (or heap block)
+  Bit_page_policy pages; // pages obtained
+} huge_header;
+
+#if BIT_DB_MREMAP
+/* A reserved huge page mapping of bytes bytes, or NULL */
+static void *huge_map_hugetlb(size_t bytes, size_t page) {
+  int flags = MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB;
+#ifdef MAP_HUGE_SHIFT
+  flags |= (page == HUGE_PAGE_1G ? 30 : 21) << MAP_HUGE_SHIFT;
+#endif
+  void *map = mmap(NULL, bytes, PROT_READ | PROT_WRITE, flags, -1, 0);
+  return map == MAP_FAILED ? NULL : map;
+}
+
+/* A 2 MiB aligned mapping of bytes bytes (a multiple of 2 MiB), or NULL:
+   the slack mapped around it is given back */
+static void *huge_map_aligned(size_t bytes) {
+  unsigned char *map = mmap(NULL, bytes + HUGE_PAGE_2M, PROT_READ | PROT_WRITE,
+                            MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+  if (map == MAP_FAILED)
+    return NULL;
+  const size_t head = (HUGE_PAGE_2M - (uintptr_t)map % HUGE_PAGE_2M) %
+                      HUGE_PAGE_2M;
+  if (head)
+    munmap(map, head);
+  if (HUGE_PAGE_2M - head)
+    munmap(map + head + bytes, HUGE_PAGE_2M - head);
+#ifdef MADV_HUGEPAGE
+  madvise(map + head, bytes, MADV_HUGEPAGE);
+#endif
+  return map + head;
+}
+#endif
+
+static void *huge_calloc(size_t size, Bit_page_policy pages) {
+  const size_t bytes = size + ALIGNMENT;
+  void *base = NULL;
+  size_t mapped = 0;
+#if BIT_DB_MREMAP
+  // each policy falls back to the next smaller pages
+  if (pages == BIT_PAGES_HUGETLB_1G) {
+    mapped = (bytes + HUGE_PAGE_1G - 1) / HUGE_PAGE_1G * HUGE_PAGE_1G;
+    base = huge_map_hugetlb(mapped, HUGE_PAGE_1G);
+    if (base == NULL)
+      pages = BIT_PAGES_HUGETLB;
+  }
+  if (base == NULL && pages == BIT_PAGES_HUGETLB) {
+    mapped = (bytes + HUGE_PAGE_2M - 1) / HUGE_PAGE_2M * HUGE_PAGE_2M;
+    base = huge_map_hugetlb(mapped, HUGE_PAGE_2M);
+    if (base == NULL)
+      pages = BIT_PAGES_HUGE;
+  }
+  if (base == NULL && pages == BIT_PAGES_HUGE) {
+    mapped = (bytes + HUGE_PAGE_2M - 1) / HUGE_PAGE_2M * HUGE_PAGE_2M;
+    base = huge_map_aligned(mapped);
+  }
+#endif
+  if (base == NULL) {
+    pages = BIT_PAGES_DEFAULT;
+    mapped = bytes; // only unmapped for other policies
+    base = portable_aligned_calloc(ALIGNMENT, bytes);
+    if (base == NULL)
+      return NULL;
+  }
+  huge_header *header = base;
+  header->base = base;
+  header->bytes = mapped;
+  header->pages = pages;
+  return (unsigned char *)base + ALIGNMENT;
+}
+
+static inline huge_header *huge_block(const void *ptr) {
+  return (huge_header *)((unsigned char *)ptr - ALIGNMENT);
+}
+
+static Bit_page_policy huge_pages(const void *ptr) {
+  return huge_block(ptr)->pages;
+}
+
+static void huge_free(void *ptr) {
+  if (ptr == NULL)
+    return;
+  huge_header *header = huge_block(ptr);
+#if BIT_DB_MREMAP
+  if (header->pages != BIT_PAGES_DEFAULT) {
+    munmap(header->base, header->bytes);
+    return;
+  }
+#endif
+  portable_aligned_free(header->base);
+}
+
+/* --- 8v. Non-empty block summaries ---
+   A summary has one bit per rank block of RANK_BLOCK_QWORDS qwords (512
+   bits), set iff the block holds a set bit. The bits beyond the last block
+   stay zero. The skipping paths walk the runs of blocks where op(s, t) can
+   be non-zero (both summaries for AND, s for AND_NOT, either for OR/XOR)
+   and hand every run to the ordinary kernels as a stack view, so clustered
+   sparse operands never bring their empty cache lines in. They are taken
+   when the runs cover at most half of the blocks; past that the single
+   streaming pass of the kernels is cheaper.
+*/
+
+/* Recomputes the summary bits of blocks [first, end) of nq qwords */
+static void summary_refresh(uint64_t *summary, const uint64_t *qwords,
+                            size_t nq, size_t first, size_t end) {
+  for (size_t b = first; b < end; b++) {
+    const size_t lo = b * RANK_BLOCK_QWORDS;
+    const size_t hi = lo + RANK_BLOCK_QWORDS < nq ? lo + RANK_BLOCK_QWORDS : nq;
+    uint64_t any = 0;
+    for (size_t i = lo; i < hi; i++)
+      any |= qwords[i];
+    if (any)
+      summary[b / 64] |= UINT64_C(1) << (b % 64);
+    else
+      summary[b / 64] &= ~(UINT64_C(1) << (b % 64));
+  }
+}
+
+static void summary_build(uint64_t *summary, const uint64_t *qwords,
+                          size_t nq) {
+  memset(summary, 0, summary_nwords(nq) * sizeof(uint64_t));
+  summary_refresh(summary, qwords, nq, 0, rank_nblocks(nq));
+}
+
+/* The summary of set, rebuilt if a bulk write left it stale; NULL if the
+   set keeps none */
+static uint64_t *bit_summary(T set) {
+  if (set->summary == NULL)
+    return NULL;
+  if (!set->summary_valid) {
+    summary_build(set->summary, set->qwords, set->size_in_qwords);
+    set->summary_valid = true;
+  }
+  return set->summary;
+}
+
+/* Member operations: the bits [lo, hi] of set were set (touch_set) or
+   changed in any other way (touch_changed); stale summaries wait for the
+   rebuild of their next use */
+static inline void summary_touch_set(T set, size_t lo, size_t hi) {
+  if (set->summary == NULL || !set->summary_valid)
+    return;
+  const size_t block_bits = RANK_BLOCK_QWORDS * BPQW;
+  for (size_t b = lo / block_bits; b <= hi / block_bits; b++)
+    set->summary[b / 64] |= UINT64_C(1) << (b % 64);
+}
+
+/* summary_touch_set for a bit set by an atomic member operation; other
+   threads may set bits of the same summary word */
+static inline void summary_touch_set_atomic(T set, size_t index) {
+  if (set->summary == NULL || !set->summary_valid)
+    return;
+  const size_t b = index / (RANK_BLOCK_QWORDS * BPQW);
+  __atomic_fetch_or(&set->summary[b / 64], UINT64_C(1) << (b % 64),
+                    __ATOMIC_RELAXED);
+}
+
+static inline void summary_touch_changed(T set, size_t lo, size_t hi) {
+  if (set->summary == NULL || !set->summary_valid)
+    return;
+  const size_t block_bits = RANK_BLOCK_QWORDS * BPQW;
+  summary_refresh(set->summary, set->qwords, set->size_in_qwords,
+                  lo / block_bits, hi / block_bits + 1);
+}
+
+static void summary_touch_indices(T set, const int indices[], int n,
+                                  bool set_bits) {
+  if (set->summary == NULL || !set->summary_valid)
+    return;
+  for (int i = 0; i < n; i++)
+    if (set_bits)
+      summary_touch_set(set, (size_t)indices[i], (size_t)indices[i]);
+    else
+      summary_touch_changed(set, (size_t)indices[i], (size_t)indices[i]);
+}
+
+/* Word w of the summary of the blocks where op(s, t) may be non-zero, from
+   the summaries a of s and b of t */
+static inline uint64_t summary_word(bit_setop_id op, const uint64_t *a,
+                                    const uint64_t *b, size_t w) {
+  switch (op) {
+  case BIT_OP_AND:
+    return a[w] & b[w];
+  case BIT_OP_AND_NOT:
+    return a[w];
+  default: // OR, XOR
+    return a[w] | b[w];
+  }
+}
+
+/* Blocks where op(s, t) may be non-zero */
+static size_t summary_candidates(bit_setop_id op, const uint64_t *a,
+                                 const uint64_t *b, size_t nblocks) {
+  size_t n = 0;
+  for (size_t w = 0; w < (nblocks + 63) / 64; w++)
+    n += (size_t)POPCOUNT(summary_word(op, a, b, w));
+  return n;
+}
+
+static inline bool summary_pays(size_t candidates, size_t nblocks) {
+  return 2 * candidates <= nblocks;
+}
+
+/* The next run [*first, *end) of candidate blocks at or after *first;
+   false when there are none left */
+static bool summary_next_run(bit_setop_id op, const uint64_t *a,
+                             const uint64_t *b, size_t nblocks, size_t *first,
+                             size_t *end) {
+  const size_t nwords = (nblocks + 63) / 64;
+  size_t w = *first / 64;
+  if (w >= nwords)
+    return false;
+  uint64_t m = summary_word(op, a, b, w) & (~UINT64_C(0) << (*first % 64));
+  while (m == 0) {
+    if (++w == nwords)
+      return false;
+    m = summary_word(op, a, b, w);
+  }
+  const size_t start = w * 64 + (size_t)__builtin_ctzll(m);
+  m = ~summary_word(op, a, b, w) & (~UINT64_C(0) << (start % 64));
+  while (m == 0) {
+    if (++w == nwords)
+      break;
+    m = ~summary_word(op, a, b, w);
+  }
+  size_t stop = w == nwords ? nblocks : w * 64 + (size_t)__builtin_ctzll(m);
+  *first = start;
+  *end = stop < nblocks ? stop : nblocks;
+  return true;
+}
+
+/* Qwords [lo, hi) of a run as a bitset for the kernels */
+static inline struct T summary_view(const uint64_t *qwords, size_t lo,
+                                    size_t hi) {
+  return (struct T){.length = (unsigned int)((hi - lo) * BPQW),
+                    .size_in_bytes =
+                        (unsigned int)((hi - lo) * sizeof(uint64_t)),
+                    .size_in_qwords = (unsigned int)(hi - lo),
+                    .bytes = (unsigned char *)(qwords + lo),
+                    .qwords = (uint64_t *)(qwords + lo)};
+}
+
+#define SUMMARY_FOREACH_RUN(op, a, b, nq, lo, hi)                              \
+  for (size_t first_ = 0, end_ = 0, lo = 0, hi = 0;                            \
+       summary_next_run(op, a, b, rank_nblocks(nq), &first_, &end_) &&         \
+       ((lo = first_ * RANK_BLOCK_QWORDS),                                     \
+        (hi = end_ * RANK_BLOCK_QWORDS < (nq) ? end_ * RANK_BLOCK_QWORDS       \
+                                               : (nq)),                        \
+        true);                                                                 \
+       first_ = end_)
+
+/* Population count of op(s, t) over the qwords nq of s and t, visiting only
+   the candidate blocks of their summaries a and b */
+static int summary_setop_count(bit_setop_id op, const uint64_t *s,
+                               const uint64_t *t, const uint64_t *a,
+                               const uint64_t *b, size_t nq) {
+  int (*kernel)(T, T) = bit_kernels_active()->setop_count[op];
+  int count = 0;
+  SUMMARY_FOREACH_RUN(op, a, b, nq, lo, hi) {
+    struct T x = summary_view(s, lo, hi), y = summary_view(t, lo, hi);
+    count += kernel(&x, &y);
+  }
+  return count;
+}
+
+/* 1 iff op(s, t) is non-empty, for summarized bitsets (the summaries are
+   exact, so differing ones already answer XOR and AND_NOT) */
+static int summary_setop_any(bit_setop_id op, T s, T t, const uint64_t *a,
+                             const uint64_t *b) {
+  const size_t nq = s->size_in_qwords;
+  for (size_t w = 0; w < summary_nwords(nq); w++)
+    if ((op == BIT_OP_XOR && a[w] != b[w]) ||
+        (op == BIT_OP_AND_NOT && (a[w] & ~b[w])))
+      return 1;
+  int (*kernel)(T, T) = bit_kernels_active()->setop_any[op];
+  SUMMARY_FOREACH_RUN(op, a, b, nq, lo, hi) {
+    struct T x = summary_view(s->qwords, lo, hi),
+             y = summary_view(t->qwords, lo, hi);
+    if (kernel(&x, &y))
+      return 1;
+  }
+  return 0;
+}
+
+/* dst = op(s, t) over the candidate blocks only, when s, t and dst keep
+   summaries and the runs pay; the blocks of dst outside the runs that may
+   hold bits are cleared and its summary stays current. false if the caller
+   must run the full kernel. dst may alias s or t: the candidate blocks do
+   not change as the summary of dst is narrowed to them. */
+static bool summary_setop_into(bit_setop_id op, T dst, T s, T t) {
+  const size_t nq = dst->size_in_qwords, nblocks = rank_nblocks(nq);
+  const uint64_t *a = bit_summary(s), *b = bit_summary(t);
+  if (a == NULL || b == NULL || dst->summary == NULL ||
+      !summary_pays(summary_candidates(op, a, b, nblocks), nblocks))
+    return false;
+  uint64_t *d = (uint64_t *)bit_summary(dst);
+  for (size_t w = 0; w < summary_nwords(nq); w++) {
+    const uint64_t keep = summary_word(op, a, b, w);
+    for (uint64_t stale = d[w] & ~keep; stale; stale &= stale - 1) {
+      const size_t lo =
+          (w * 64 + (size_t)__builtin_ctzll(stale)) * RANK_BLOCK_QWORDS;
+      const size_t hi =
+          lo + RANK_BLOCK_QWORDS < nq ? lo + RANK_BLOCK_QWORDS : nq;
+      memset(dst->qwords + lo, 0, (hi - lo) * sizeof(uint64_t));
+    }
+    d[w] &= keep;
+  }
+  void (*kernel)(T, T, T) = bit_kernels_active()->setop[op];
+  SUMMARY_FOREACH_RUN(op, a, b, nq, lo, hi) {
+    struct T x = summary_view(dst->qwords, lo, hi),
+             y = summary_view(s->qwords, lo, hi),
+             z = summary_view(t->qwords, lo, hi);
+    kernel(&x, &y, &z);
+    summary_refresh(d, dst->qwords, nq, lo / RANK_BLOCK_QWORDS,
+                    rank_nblocks(hi));
+  }
+  return true;
+}
+
+/* Runs op on dst, s and t: through the summaries when it pays */
+static void bit_setop_into(bit_setop_id op, T dst, T s, T t) {
+  if (summary_setop_into(op, dst, s, t))
+    return;
+  split_setop(op, dst, s, t);
+  SUMMARY_INVALIDATE(dst);
+}
+
+/* Rebuilds the summaries of rows [first, first + n) of a container that
+   keeps them */
+static void db_summary_rows(T_DB set, size_t first, size_t n) {
+  if (set->row_summaries == NULL)
+    return;
+  const size_t nwords = summary_nwords(set->size_in_qwords);
+  for (size_t i = first; i < first + n; i++)
+    summary_build(set->row_summaries + i * nwords,
+                  set->qwords + i * set->stride_in_qwords,
+                  set->size_in_qwords);
+}
+
+/* BitDB_query_count_store over summarized rows: every row skips the blocks
+   its op with q leaves empty, or is streamed whole when too few are */
+static void db_query_count_summary(bit_setop_id op, T q, const uint64_t *a,
+                                   T_DB db, int *counts,
+                                   SETOP_COUNT_OPTS opts) {
+  const size_t nq = db->size_in_qwords, nblocks = rank_nblocks(nq);
+  const size_t nwords = summary_nwords(nq);
+  int (*kernel)(T, T) = bit_kernels_active()->setop_count[op];
+  int n = (int)db->nelem;
+#pragma omp parallel for num_threads(cpu_threads(opts)) schedule(dynamic, 64)
+  for (int i = 0; i < n; i++) {
+    const uint64_t *row = db->qwords + (size_t)i * db->stride_in_qwords;
+    const uint64_t *b = db->row_summaries + (size_t)i * nwords;
+    if (summary_pays(summary_candidates(op, a, b, nblocks), nblocks)) {
+      counts[i] = summary_setop_count(op, q->qwords, row, a, b, nq);
+    } else {
+      struct T x = summary_view(q->qwords, 0, nq), y = summary_view(row, 0, nq);
+      counts[i] = kernel(&x, &y);
+    }
+  }
+}
+
+/* --- 8w. Column postings ---
+   For every bit position, the rows that hold it. A query with few bits
+   counts against a container by visiting the postings of its bits only,
+   one increment per entry, instead of streaming every row.
+*/
+
+static void postings_free(bit_db_postings *postings) {
+  if (postings == NULL)
+    return;
+  free(postings->offsets);
+  free(postings->rows);
+  free(postings);
+}
+
+static void hashes_free(bit_db_hashes *hashes) {
+  if (hashes == NULL)
+    return;
+  free(hashes->values);
+  free(hashes);
+}
+
+/* (Re)builds the postings of set: every thread owns a range of qwords, i.e.
+   of columns, and walks it down the rows twice, to count and to fill, so
+   the postings come out in row order without any merging */
+static void postings_build(T_DB set, SETOP_COUNT_OPTS opts) {
+  bit_db_postings *postings = set->postings;
+  const size_t length = set->length, nq = set->size_in_qwords;
+  const int n = (int)set->nelem;
+  size_t *offsets = postings->offsets;
+  memset(offsets, 0, (length + 1) * sizeof(size_t));
+#pragma omp parallel for num_threads(cpu_threads(opts)) schedule(static)
+  for (size_t q = 0; q < nq; q++)
+    for (int i = 0; i < n; i++)
+      for (uint64_t w = set->qwords[(size_t)i * set->stride_in_qwords + q]; w;
+           w &= w - 1)
+        offsets[q * BPQW + (size_t)__builtin_ctzll(w) + 1]++;
+  for (size_t j = 0; j < length; j++)
+    offsets[j + 1] += offsets[j];
+  free(postings->rows);
+  postings->rows =
+      malloc((offsets[length] ? offsets[length] : 1) * sizeof(uint32_t));
+  size_t *next = malloc(length * sizeof(size_t));
+  assert(postings->rows != NULL && next != NULL);
+  memcpy(next, offsets, length * sizeof(size_t));
+#pragma omp parallel for num_threads(cpu_threads(opts)) schedule(static)
+  for (size_t q = 0; q < nq; q++)
+    for (int i = 0; i < n; i++)
+      for (uint64_t w = set->qwords[(size_t)i * set->stride_in_qwords + q]; w;
+           w &= w - 1)
+        postings->rows[next[q * BPQW + (size_t)__builtin_ctzll(w)]++] =
+            (uint32_t)i;
+  free(next);
+  postings->stamp = set->stamp;
+}
+
+/* BitDB_query_count_store through the postings of db, when the query's
+   bits select few enough entries to beat a scan; false otherwise. Ops
+   other than AND come from the intersection and the cached row counts. */
+static bool db_query_count_postings(bit_setop_id op, T q, T_DB db,
+                                    int *counts, SETOP_COUNT_OPTS opts) {
+  if (op != BIT_OP_AND && db->row_counts == NULL)
+    return false;
+  bit_db_postings *postings = db->postings;
+  if (postings->stamp != db->stamp)
+    postings_build(db, opts); // written since, through the BitDB API
+  const size_t budget =
+      (size_t)db->nelem * db->size_in_qwords / BIT_POSTINGS_COST;
+  size_t entries = 0;
+  int qcount = 0;
+  for (size_t w = 0; w < q->size_in_qwords && entries <= budget; w++)
+    for (uint64_t word = q->qwords[w]; word; word &= word - 1) {
+      const size_t j = w * BPQW + (size_t)__builtin_ctzll(word);
+      entries += postings->offsets[j + 1] - postings->offsets[j];
+      qcount++;
+    }
+  if (entries > budget)
+    return false;
+  const int n = (int)db->nelem;
+  memset(counts, 0, (size_t)n * sizeof(int));
+  for (size_t w = 0; w < q->size_in_qwords; w++)
+    for (uint64_t word = q->qwords[w]; word; word &= word - 1) {
+      const size_t j = w * BPQW + (size_t)__builtin_ctzll(word);
+      const uint32_t *rows = postings->rows + postings->offsets[j];
+      const size_t nrows = postings->offsets[j + 1] - postings->offsets[j];
+      for (size_t r = 0; r < nrows; r++)
+        counts[rows[r]]++;
+    }
+  if (op == BIT_OP_AND)
+    return true;
+  const int *cards = db->row_counts;
+#pragma omp parallel for num_threads(cpu_threads(opts)) schedule(static)
+  for (int i = 0; i < n; i++) {
+    const int c = counts[i];
+    counts[i] = op == BIT_OP_OR    ? qcount + cards[i] - c
+                : op == BIT_OP_XOR ? qcount + cards[i] - 2 * c
+                                   : qcount - c; // BIT_OP_AND_NOT
+  }
+  return true;
+}
+
+/* --- 8w'. Containment searches ---
+   A row fails a containment test at its first word with a bit on the wrong
+   side: a bit of q the row lacks (superset search) or a bit of the row q
+   lacks (subset search). The words a test has to read are listed once per
+   query, most likely to fail first when column counts are given, and every
+   row is read BIT_CONTAIN_CHUNK words at a time, stopping at the first
+   chunk with a violation. Rows are taken 64 at a time, so that each thread
+   writes whole words of the output mask.
+*/
+
+/* Words a test reads, and the words of q there (of ~q for a subset test) */
+typedef struct {
+  uint32_t *words;
+  uint64_t *want;
+  size_t n;
+} contain_plan;
+
+typedef struct {
+  uint32_t word;
+  uint64_t cost; // lower words are read first
+} contain_rank;
+
+static int contain_rank_compare(const void *x, const void *y) {
+  const contain_rank *a = x, *b = y;
+  if (a->cost != b->cost)
+    return a->cost < b->cost ? -1 : 1;
+  return (a->word > b->word) - (a->word < b->word);
+}
+
+/* A superset test reads the non-empty words of q, and a word is likelier to
+   fail the rarer its rarest bit; a subset test reads every word, and a word
+   is likelier to fail the more rows hold bits q lacks */
+static contain_plan contain_plan_new(T q, bool superset,
+                                     const uint32_t *column_counts) {
+  const size_t nq = q->size_in_qwords;
+  contain_rank *rank = malloc(nq * sizeof(contain_rank));
+  assert(rank != NULL);
+  size_t n = 0;
+  for (size_t w = 0; w < nq; w++) {
+    const uint64_t bits = superset ? q->qwords[w] : ~q->qwords[w];
+    if (superset && bits == 0)
+      continue;
+    uint64_t cost = 0;
+    if (column_counts) {
+      uint64_t mask = bits;
+      if (!superset && w == nq - 1 && q->length % BPQW)
+        mask &= (UINT64_C(1) << (q->length % BPQW)) - 1;
+      cost = superset ? UINT64_MAX : 0;
+      for (; mask; mask &= mask - 1) {
+        const uint64_t c =
+            column_counts[w * BPQW + (size_t)__builtin_ctzll(mask)];
+        if (superset)
+          cost = c < cost ? c : cost;
+        else
+          cost += c;
+      }
+      if (!superset)
+        cost = UINT64_MAX - cost;
+    }
+    rank[n++] = (contain_rank){(uint32_t)w, cost};
+  }
+  if (column_counts)
+    qsort(rank, n, sizeof(contain_rank), contain_rank_compare);
+  contain_plan plan = {malloc((n ? n : 1) * sizeof(uint32_t)),
+                       malloc((n ? n : 1) * sizeof(uint64_t)), n};
+  assert(plan.words && plan.want);
+  for (size_t i = 0; i < n; i++) {
+    const uint64_t word = q->qwords[rank[i].word];
+    plan.words[i] = rank[i].word;
+    plan.want[i] = superset ? word : ~word;
+  }
+  free(rank);
+  return plan;
+}
+
+/* Whether a row passes: no word of the plan holds a bit of want */
+static inline bool contain_row(const uint64_t *row, const contain_plan *plan,
+                               bool superset) {
+  for (size_t c = 0; c < plan->n; c += BIT_CONTAIN_CHUNK) {
+    const size_t e = plan->n - c < BIT_CONTAIN_CHUNK ? plan->n
+                                                     : c + BIT_CONTAIN_CHUNK;
+    uint64_t bad = 0;
+#pragma omp simd reduction(| : bad)
+    for (size_t i = c; i < e; i++) {
+      const uint64_t r = row[plan->words[i]];
+      bad |= superset ? plan->want[i] & ~r : plan->want[i] & r;
+    }
+    if (bad)
+      return false;
+  }
+  return true;
+}
+
+static void contain_search(T q, T_DB db, bool superset,
+                           const uint32_t *column_counts, T out,
+                           SETOP_COUNT_OPTS opts) {
+  assert(q && db && out);
+  assert(q->length == db->length);
+  assert((size_t)out->length == db->nelem);
+  assert(opts.row_mask == NULL ||
+         (size_t)opts.row_mask->length == db->nelem);
+  contain_plan plan = contain_plan_new(q, superset, column_counts);
+  const size_t n = db->nelem;
+  const long long nwords = (long long)out->size_in_qwords;
+#pragma omp parallel for num_threads(cpu_threads(opts)) schedule(dynamic, 16)
+  for (long long w = 0; w < nwords; w++) {
+    const size_t first = (size_t)w * BPQW;
+    const size_t nrows = n - first < BPQW ? n - first : BPQW;
+    const uint64_t select = opts.row_mask ? opts.row_mask->qwords[w]
+                                          : ~UINT64_C(0);
+    uint64_t pass, seen; // rows a writer tore are tested again
+    do {
+      seen = db_seq_read_begin(db, first, nrows);
+      pass = 0;
+      for (size_t r = 0; r < nrows; r++) {
+        if (!((select >> r) & 1))
+          continue;
+        const uint64_t *row = db->qwords + (first + r) * db->stride_in_qwords;
+        if (r + 1 < nrows)
+          __builtin_prefetch(row + db->stride_in_qwords, 0);
+        pass |= (uint64_t)contain_row(row, &plan, superset) << r;
+      }
+    } while (db_seq_read_retry(db, first, nrows, seen));
+    out->qwords[w] = pass;
+  }
+  free(plan.words);
+  free(plan.want);
+  RANK_INVALIDATE(out);
+  SUMMARY_INVALIDATE(out);
+}
+
+/* --- 8x. Text fingerprint formats ---
+   BitDB_load_text splits its input at line starts into chunks, counts the
+   records of every chunk in parallel, then decodes every chunk straight
+   into the rows after those of the chunks before it.
+*/
+
+/* First line start at or after at */
+static size_t text_line_start(const char *text, size_t size, size_t at) {
+  while (at > 0 && at < size && text[at - 1] != '\n')
+    at++;
+  return at;
+}
+
+static inline bool text_blank(char c) {
+  return c == ' ' || c == '\t' || c == '\r';
+}
+
+/* Start of the record of the line [*line, end), past leading blanks, or
+   NULL for blank lines and '#' comments (e.g. the header of an FPS file) */
+static inline const char *text_record(const char *line, const char *end) {
+  while (line < end && text_blank(*line))
+    line++;
+  return line < end && *line != '#' ? line : NULL;
+}
+
+/* Decodes the 2 * n hex digits at hex into n bytes (high nibble first);
+   false if any of them is not a hex digit. Branch free, so it vectorizes. */
+static bool text_decode_hex(const char *hex, size_t n, unsigned char *out) {
+  unsigned char bad = 0;
+#pragma omp simd reduction(| : bad)
+  for (size_t i = 0; i < 2 * n; i++) {
+    const unsigned char c = (unsigned char)hex[i], lower = c | 0x20;
+    bad |= (unsigned char)(c - '0') > 9 && (unsigned char)(lower - 'a') > 5;
+  }
+  if (bad)
+    return false;
+  OMP_CPU_SIMD
+  for (size_t i = 0; i < n; i++) {
+    const unsigned char hi = (unsigned char)hex[2 * i],
+                        lo = (unsigned char)hex[2 * i + 1];
+    out[i] = (unsigned char)((((hi & 0xf) + 9 * (hi >> 6)) << 4) |
+                             ((lo & 0xf) + 9 * (lo >> 6)));
+  }
+  return true;
+}
+
+/* Hex digits of a record: up to the first blank (an FPS id may follow) */
+static inline size_t text_hex_digits(const char *record, const char *end) {
+  const char *p = record;
+  while (p < end && !text_blank(*p))
+    p++;
+  return (size_t)(p - record);
+}
+
+/* Parses the indices of a record separated by blanks, commas or
+   semicolons. Sets them in row (if not NULL) and returns the largest, -1
+   for none, or -2 if the record is malformed or one is >= limit. */
+static long long text_indices(const char *p, const char *end, long long limit,
+                              uint64_t *row) {
+  long long largest = -1;
+  while (p < end) {
+    if (text_blank(*p) || *p == ',' || *p == ';') {
+      p++;
+      continue;
+    }
+    if (*p < '0' || *p > '9')
+      return -2;
+    long long index = 0;
+    for (; p < end && *p >= '0' && *p <= '9'; p++)
+      if ((index = index * 10 + (*p - '0')) >= limit)
+        return -2;
+    if (row)
+      row[index / BPQW] |= UINT64_C(1) << (index % BPQW);
+    largest = index > largest ? index : largest;
+  }
+  return largest;
+}
+
+/* Counts (rows NULL) or decodes (into rows from first_row) the records of
+   text[lo, hi). Returns the records, or -1 if one is malformed; the
+   largest index of an index list goes to *largest. */
+static long long text_chunk(const char *text, size_t lo, size_t hi,
+                            Bit_text_format format, size_t nbytes,
+                            long long limit, T_DB rows, size_t first_row,
+                            long long *largest) {
+  long long records = 0;
+  for (size_t at = lo; at < hi;) {
+    const char *line = text + at, *end = memchr(line, '\n', hi - at);
+    end = end ? end : text + hi;
+    at = (size_t)(end - text) + 1;
+    const char *record = text_record(line, end);
+    if (record == NULL)
+      continue;
+    const size_t r = first_row + (size_t)records++;
+    if (format == BIT_TEXT_HEX) {
+      if (text_hex_digits(record, end) != 2 * nbytes)
+        return -1;
+      if (rows && !text_decode_hex(record, nbytes,
+                                   rows->bytes + r * rows->stride_in_bytes))
+        return -1;
+    } else {
+      long long top = text_indices(
+          record, end, limit,
+          rows ? rows->qwords + r * rows->stride_in_qwords : NULL);
+      if (top == -2)
+        return -1;
+      *largest = top > *largest ? top : *largest;
+    }
+  }
+  return records;
+}
+
+/* --- 8x'. Rows from CSR index lists ---
+   Each thread owns the rows of a contiguous range, cut so that the ranges
+   hold about as many indices (plus one per row, for the empty ones), and
+   writes them with plain stores. Indices that fall in the same word in a
+   row, as sorted lists do, are ORed into a register and stored once.
+*/
+
+/* First row r in [lo, hi] whose cost row_ptr[r] - row_ptr[0] + r reaches
+   target */
+static size_t csr_split(const size_t row_ptr[], size_t lo, size_t hi,
+                        size_t target) {
+  while (lo < hi) {
+    size_t mid = lo + (hi - lo) / 2;
+    if (row_ptr[mid] - row_ptr[0] + mid < target)
+      lo = mid + 1;
+    else
+      hi = mid;
+  }
+  return lo;
+}
+
+/* Sets the bits of n indices in a row of length bits; false if one is out
+   of range */
+static bool csr_row_fill(uint64_t *row, const int *idx, size_t n, int length) {
+  size_t k = 0;
+  while (k < n) {
+    if (idx[k] < 0 || idx[k] >= length)
+      return false;
+    const unsigned int w = (unsigned int)idx[k] / BPQW;
+    uint64_t mask = 0;
+    for (; k < n && idx[k] >= 0 && (unsigned int)idx[k] / BPQW == w; k++)
+      mask |= UINT64_C(1) << (idx[k] % BPQW);
+    row[w] |= mask;
+  }
+  return true;
+}
+
+/* --- 8y. Streaming writes of saved containers ---
+   A writer stages rows in a page aligned buffer and writes it out whole,
+   so a flush is one large write whatever the row size; with O_DIRECT the
+   last, partial buffer is padded to a page and the file cut back after.
+*/
+
+#if BIT_DB_MMAP_FILES
+/* Writes n bytes at offset, across short writes; false on an error */
+static bool writer_pwrite(int fd, const void *data, size_t n, off_t offset) {
+  const unsigned char *bytes = data;
+  while (n > 0) {
+    ssize_t done = pwrite(fd, bytes, n, offset);
+    if (done < 0 && errno == EINTR)
+      continue;
+    if (done <= 0)
+      return false;
+    bytes += done;
+    n -= (size_t)done;
+    offset += done;
+  }
+  return true;
+}
+
+/* Writes the staged rows out: whole pages only, unless last */
+static void writer_flush(Bit_writer_T writer, bool last) {
+  size_t n = writer->used;
+  if (n == 0 || writer->failed)
+    return;
+  writer->checksum = db_checksum_update(writer->checksum, writer->buffer, n);
+  if (writer->direct && last && n % BIT_DB_FILE_HEADER_SIZE) {
+    size_t padded = (n + BIT_DB_FILE_HEADER_SIZE - 1) /
+                    BIT_DB_FILE_HEADER_SIZE * BIT_DB_FILE_HEADER_SIZE;
+    memset(writer->buffer + n, 0, padded - n);
+    n = padded;
+  }
+  if (!writer_pwrite(writer->fd, writer->buffer, n,
+                     (off_t)(BIT_DB_FILE_HEADER_SIZE + writer->written)))
+    writer->failed = true;
+  writer->written += writer->used;
+  writer->used = 0;
+}
+
+/* Stages n bytes of rows, flushing every time the buffer fills up */
+static void writer_stage(Bit_writer_T writer, const void *data, size_t n) {
+  const unsigned char *bytes = data;
+  while (n > 0 && !writer->failed) {
+    size_t room = writer->capacity - writer->used;
+    size_t take = n < room ? n : room;
+    memcpy(writer->buffer + writer->used, bytes, take);
+    writer->used += take;
+    bytes += take;
+    n -= take;
+    if (writer->used == writer->capacity)
+      writer_flush(writer, false);
+  }
+}
+#endif
+
+/* --- 8z. Compressed container files ---
+   Blocks of rows are compressed one per thread and written in order; a
+   read decompresses the blocks it spans on a team of threads, each with
+   its own staging buffer for the compressed bytes. The control bytes of a
+   block come first so that its size is known from them alone.
+*/
+
+/* Control byte of a qword: bit b set when byte b is not zero */
+static inline unsigned int zblock_control(uint64_t w) {
+  w |= w >> 4;
+  w |= w >> 2;
+  w |= w >> 1;
+  w &= UINT64_C(0x0101010101010101);
+  return (unsigned int)((w * UINT64_C(0x0102040810204080)) >> 56);
+}
+
+/* Writes the BIT_DB_ZBLOCK_BYTES form of nq qwords to out (room for 9 bytes
+   a qword) and returns its size */
+static size_t zblock_encode(const uint64_t *in, size_t nq,
+                            unsigned char *out) {
+  unsigned char *control = out, *payload = out + nq;
+  OMP_CPU_SIMD
+  for (size_t q = 0; q < nq; q++)
+    control[q] = (unsigned char)zblock_control(in[q]);
+  for (size_t q = 0; q < nq; q++)
+    for (uint64_t w = in[q]; w; w >>= 8)
+      if (w & 0xff)
+        *payload++ = (unsigned char)w;
+  return (size_t)(payload - out);
+}
+
+/* Decodes the BIT_DB_ZBLOCK_BYTES form in bytes of data into nq qwords;
+   false if it does not hold exactly that many */
+static bool zblock_decode(const unsigned char *data, size_t bytes,
+                          uint64_t *out, size_t nq) {
+  if (bytes < nq)
+    return false;
+  size_t payload_bytes = 0;
+#pragma omp simd reduction(+ : payload_bytes)
+  for (size_t q = 0; q < nq; q++)
+    payload_bytes += (size_t)__builtin_popcount(data[q]);
+  if (payload_bytes != bytes - nq)
+    return false;
+  const unsigned char *payload = data + nq;
+  for (size_t q = 0; q < nq; q++) {
+    uint64_t w = 0;
+    for (unsigned int c = data[q]; c; c &= c - 1)
+      w |= (uint64_t)*payload++ << (8 * __builtin_ctz(c));
+    out[q] = w;
+  }
+  return true;
+}
+
+#if BIT_DB_MMAP_FILES
+/* Reads up to n bytes at offset, across short reads; the bytes read (fewer
+   at the end of the file) or -1 on an error */
+static int64_t db_pread(int fd, void *data, size_t n, off_t offset) {
+  unsigned char *bytes = data;
+  size_t got = 0;
+  while (got < n) {
+    ssize_t done = pread(fd, bytes + got, n - got, offset + (off_t)got);
+    if (done < 0 && errno == EINTR)
+      continue;
+    if (done < 0)
+      return -1;
+    if (done == 0)
+      break;
+    got += (size_t)done;
+  }
+  return (int64_t)got;
+}
+
+/* Reads n bytes at offset; false on an error or EOF */
+static bool zreader_pread(int fd, void *data, size_t n, off_t offset) {
+  return db_pread(fd, data, n, offset) == (int64_t)n;
+}
+
+/* Rows of block b into rows, through the staging buffer compressed (room
+   for the largest block); false if it cannot be read or is corrupt */
+static bool zreader_block(Bit_zreader_T reader, size_t b,
+                          unsigned char *compressed, void *rows) {
+  const bit_db_zblock *block = &reader->index[b];
+  const size_t first = b * reader->block_rows;
+  const size_t nrows = reader->nelem - first < reader->block_rows
+                           ? reader->nelem - first
+                           : reader->block_rows;
+  const size_t nbytes = nrows * reader->row_bytes;
+  bool ok;
+  if (block->codec == BIT_DB_ZBLOCK_RAW)
+    ok = block->bytes == nbytes &&
+         zreader_pread(reader->fd, rows, nbytes, (off_t)block->offset);
+  else
+    ok = block->codec == BIT_DB_ZBLOCK_BYTES &&
+         zreader_pread(reader->fd, compressed, block->bytes,
+                       (off_t)block->offset) &&
+         zblock_decode(compressed, block->bytes, rows,
+                       nbytes / sizeof(uint64_t));
+  return ok && db_checksum(rows, nbytes) == block->checksum;
+}
+#endif
+
+/* --- 8z'. Read-ahead of saved containers ---
+   A reader keeps depth chunks of the rows of a file in flight. With
+   io_uring they are fixed buffer reads (plain reads if the slots cannot be
+   registered) that the kernel completes while the caller counts, and a
+   chunk is waited for only when the stream reaches it. Without io_uring a
+   chunk is read with pread when the stream reaches it, the kernel having
+   been told beforehand that it will be needed.
+*/
+
+#define READER_PENDING INT64_MIN // a slot whose read is in flight
+
+#if BIT_DB_IO_URING
+struct db_uring {
+  int fd;                                      // the ring
+  unsigned int *sq_tail, *sq_mask, *sq_array;  // submission ring
+  unsigned int *cq_head, *cq_tail, *cq_mask;   // completion ring
+  struct io_uring_sqe *sqes;                   // submission entries
+  struct io_uring_cqe *cqes;                   // completion entries
+  void *sq_ring, *cq_ring;                     // mappings of the rings
+  size_t sq_ring_bytes, cq_ring_bytes, sqes_bytes;
+  bool fixed;                                  // the slots are registered
+};
+
+static void uring_free(struct db_uring *ring) {
+  if (ring->sqes)
+    munmap(ring->sqes, ring->sqes_bytes);
+  if (ring->cq_ring)
+    munmap(ring->cq_ring, ring->cq_ring_bytes);
+  if (ring->sq_ring)
+    munmap(ring->sq_ring, ring->sq_ring_bytes);
+  close(ring->fd);
+  free(ring);
+}
+
+static void *uring_map(int fd, size_t bytes, off_t offset) {
+  void *p = mmap(NULL, bytes, PROT_READ | PROT_WRITE,
+                 MAP_SHARED | MAP_POPULATE, fd, offset);
+  return p == MAP_FAILED ? NULL : p;
+}
+
+/* A ring for reads into the nslots slots of buffers, or NULL where the
+   kernel refuses io_uring */
+static struct db_uring *uring_new(unsigned int entries,
+                                  unsigned char *buffers, size_t nslots) {
+  struct io_uring_params params;
+  memset(&params, 0, sizeof(params));
+  int fd = (int)syscall(__NR_io_uring_setup, entries, &params);
+  if (fd < 0)
+    return NULL;
+  if (!(params.features & IORING_FEAT_CUR_PERSONALITY)) {
+    close(fd); // a kernel before 5.6, without IORING_OP_READ
+    return NULL;
+  }
+  struct db_uring *ring = calloc(1, sizeof(*ring));
+  assert(ring != NULL);
+  ring->fd = fd;
+  ring->sq_ring_bytes =
+      params.sq_off.array + params.sq_entries * sizeof(unsigned int);
+  ring->cq_ring_bytes =
+      params.cq_off.cqes + params.cq_entries * sizeof(struct io_uring_cqe);
+  ring->sqes_bytes = params.sq_entries * sizeof(struct io_uring_sqe);
+  ring->sq_ring = uring_map(fd, ring->sq_ring_bytes, IORING_OFF_SQ_RING);
+  ring->cq_ring = uring_map(fd, ring->cq_ring_bytes, IORING_OFF_CQ_RING);
+  ring->sqes = uring_map(fd, ring->sqes_bytes, IORING_OFF_SQES);
+  if (!ring->sq_ring || !ring->cq_ring || !ring->sqes) {
+    uring_free(ring);
+    return NULL;
+  }
+  unsigned char *sq = ring->sq_ring, *cq = ring->cq_ring;
+  ring->sq_tail = (unsigned int *)(sq + params.sq_off.tail);
+  ring->sq_mask = (unsigned int *)(sq + params.sq_off.ring_mask);
+  ring->sq_array = (unsigned int *)(sq + params.sq_off.array);
+  ring->cq_head = (unsigned int *)(cq + params.cq_off.head);
+  ring->cq_tail = (unsigned int *)(cq + params.cq_off.tail);
+  ring->cq_mask = (unsigned int *)(cq + params.cq_off.ring_mask);
+  ring->cqes = (struct io_uring_cqe *)(cq + params.cq_off.cqes);
+
+  // registered slots spare the kernel mapping them on every read
+  struct iovec *iov = malloc(nslots * sizeof(struct iovec));
+  assert(iov != NULL);
+  for (size_t i = 0; i < nslots; i++)
+    iov[i] = (struct iovec){buffers + i * BIT_DB_READER_CHUNK,
+                            BIT_DB_READER_CHUNK};
+  ring->fixed = syscall(__NR_io_uring_register, fd, IORING_REGISTER_BUFFERS,
+                        iov, (unsigned int)nslots) == 0;
+  free(iov);
+  return ring;
+}
+
+/* Submits a read of bytes bytes at offset into slot; false if the kernel
+   did not take it */
+static bool uring_read(struct db_uring *ring, int fd, unsigned char *buffer,
+                       size_t bytes, uint64_t offset, size_t slot) {
+  const unsigned int tail = *ring->sq_tail; // only this thread moves it
+  const unsigned int index = tail & *ring->sq_mask;
+  struct io_uring_sqe *sqe = &ring->sqes[index];
+  memset(sqe, 0, sizeof(*sqe));
+  sqe->opcode = ring->fixed ? IORING_OP_READ_FIXED : IORING_OP_READ;
+  sqe->fd = fd;
+  sqe->addr = (uint64_t)(uintptr_t)buffer;
+  sqe->len = (uint32_t)bytes;
+  sqe->off = offset;
+  if (ring->fixed)
+    sqe->buf_index = (uint16_t)slot;
+  sqe->user_data = slot;
+  ring->sq_array[index] = index;
+  __atomic_store_n(ring->sq_tail, tail + 1, __ATOMIC_RELEASE);
+  return syscall(__NR_io_uring_enter, ring->fd, 1, 0, 0, NULL, 0) == 1;
+}
+
+/* Files the completed reads in ready (bytes read or -errno), waiting for
+   one if there are none; the number filed, or -1 on an error */
+static long uring_reap(struct db_uring *ring, int64_t *ready) {
+  unsigned int head = *ring->cq_head;
+  unsigned int tail = __atomic_load_n(ring->cq_tail, __ATOMIC_ACQUIRE);
+  if (head == tail) {
+    if (syscall(__NR_io_uring_enter, ring->fd, 0, 1, IORING_ENTER_GETEVENTS,
+                NULL, 0) < 0)
+      return errno == EINTR ? 0 : -1;
+    tail = __atomic_load_n(ring->cq_tail, __ATOMIC_ACQUIRE);
+  }
+  long n = 0;
+  for (; head != tail; head++, n++) {
+    const struct io_uring_cqe *cqe = &ring->cqes[head & *ring->cq_mask];
+    ready[cqe->user_data] = cqe->res;
+  }
+  __atomic_store_n(ring->cq_head, head, __ATOMIC_RELEASE);
+  return n;
+}
+#endif
+
+#if BIT_DB_MMAP_FILES
+/* Bytes of the rows in chunk c */
+static size_t reader_chunk_bytes(Bit_reader_T r, size_t c) {
+  const uint64_t first = (uint64_t)c * BIT_DB_READER_CHUNK;
+  return r->data_bytes - first < BIT_DB_READER_CHUNK
+             ? (size_t)(r->data_bytes - first)
+             : BIT_DB_READER_CHUNK;
+}
+
+/* Bytes to ask for to get n: whole pages under O_DIRECT */
+static size_t reader_request(Bit_reader_T r, size_t n) {
+  return r->direct ? (n + 4095) / 4096 * 4096 : n;
+}
+
+/* Starts reading chunk c into its slot */
+static void reader_submit(Bit_reader_T r, size_t c) {
+  if (c >= r->nchunks)
+    return;
+  const size_t slot = c % r->depth;
+  const uint64_t offset = r->data_offset + (uint64_t)c * BIT_DB_READER_CHUNK;
+  const size_t bytes = reader_chunk_bytes(r, c);
+#if BIT_DB_IO_URING
+  if (r->uring) {
+    r->ready[slot] = READER_PENDING;
+    if (uring_read(r->uring, r->fd, r->buffers + slot * BIT_DB_READER_CHUNK,
+                   reader_request(r, bytes), offset, slot))
+      r->inflight++;
+    else
+      r->ready[slot] = 0; // read it when needed
+    return;
+  }
+#endif
+  r->ready[slot] = 0; // nothing read yet; reader_wait reads it
+#ifdef POSIX_FADV_WILLNEED
+  posix_fadvise(r->fd, (off_t)offset, (off_t)bytes, POSIX_FADV_WILLNEED);
+#endif
+}
+
+/* The slot of chunk c once it is read in whole, or NULL if it cannot be */
+static unsigned char *reader_wait(Bit_reader_T r, size_t c) {
+  const size_t slot = c % r->depth;
+  unsigned char *buffer = r->buffers + slot * BIT_DB_READER_CHUNK;
+#if BIT_DB_IO_URING
+  while (r->uring && r->ready[slot] == READER_PENDING) {
+    long done = uring_reap(r->uring, r->ready);
+    if (done < 0)
+      return NULL;
+    r->inflight -= (size_t)done;
+  }
+#endif
+  // what the ring did not read is read here: all of it without a ring or
+  // after a failed ring read, the rest after a short one
+  const size_t need = reader_chunk_bytes(r, c);
+  int64_t got = r->ready[slot] < 0 ? 0 : r->ready[slot];
+  if (got >= 0 && (size_t)got < need) {
+    const uint64_t offset =
+        r->data_offset + (uint64_t)c * BIT_DB_READER_CHUNK + (uint64_t)got;
+    int64_t more = db_pread(r->fd, buffer + got,
+                            reader_request(r, need - (size_t)got),
+                            (off_t)offset);
+    got = more < 0 ? more : got + more;
+    r->ready[slot] = got;
+  }
+  return got >= (int64_t)need ? buffer : NULL;
+}
+
+/* Copies the next n bytes of the rows into dst, or skips them if dst is
+   NULL; false if a chunk cannot be read */
+static bool reader_take(Bit_reader_T r, unsigned char *dst, size_t n) {
+  while (n > 0) {
+    const unsigned char *chunk = reader_wait(r, r->chunk);
+    if (chunk == NULL)
+      return false;
+    const size_t bytes = reader_chunk_bytes(r, r->chunk);
+    const size_t take = n < bytes - r->offset ? n : bytes - r->offset;
+    if (dst) {
+      memcpy(dst, chunk + r->offset, take);
+      dst += take;
+    }
+    r->offset += take;
+    n -= take;
+    if (r->offset == bytes) { // the slot moves on to depth chunks ahead
+      reader_submit(r, r->chunk + r->depth);
+      r->chunk++;
+      r->offset = 0;
+    }
+  }
+  return true;
+}
+#endif
+
+/* --- 8z''. Row change log ---
+   Writers of rows call db_log_row on each row they write, once before the
+   write and once after: both xor the row into its delta, so the delta ends
+   up as the XOR of the row before its first write and after its last. A
+   row that did not exist at the last export starts from zero. Writes that
+   move rows set moved instead.
+*/
+
+static void changes_free(bit_db_changes *log) {
+  if (log == NULL)
+    return;
+  free(log->slot);
+  free(log->rows);
+  free(log->deltas);
+  free(log);
+}
+
+/* Forgets every delta: the rows as they are become the base */
+static void changes_reset(bit_db_changes *log, unsigned int nelem) {
+  for (size_t k = 0; k < log->used; k++)
+    log->slot[log->rows[k]] = -1;
+  log->used = 0;
+  log->base_nelem = nelem;
+  log->moved = false;
+}
+
+/* The delta of row index, made zero on its first write (*fresh) */
+static uint64_t *changes_delta(T_DB set, size_t index, bool *fresh) {
+  bit_db_changes *log = set->changes;
+  const size_t nq = set->size_in_qwords;
+  if (index >= log->nslots) {
+    size_t nslots = 2 * log->nslots > index + 1 ? 2 * log->nslots : index + 1;
+    log->slot = realloc(log->slot, nslots * sizeof(int));
+    assert(log->slot != NULL);
+    for (size_t i = log->nslots; i < nslots; i++)
+      log->slot[i] = -1;
+    log->nslots = nslots;
+  }
+  *fresh = log->slot[index] < 0;
+  if (*fresh) {
+    if (log->used == log->allocated) {
+      log->allocated = log->allocated ? 2 * log->allocated : 64;
+      log->rows = realloc(log->rows, log->allocated * sizeof(uint32_t));
+      log->deltas = realloc(log->deltas,
+                            log->allocated * nq * sizeof(uint64_t));
+      assert(log->rows != NULL && log->deltas != NULL);
+    }
+    assert(log->used < INT_MAX);
+    log->slot[index] = (int)log->used;
+    log->rows[log->used] = (uint32_t)index;
+    memset(log->deltas + log->used * nq, 0, nq * sizeof(uint64_t));
+    log->used++;
+  }
+  return log->deltas + (size_t)log->slot[index] * nq;
+}
+
+/* Whether slot k changes its row: a row written back to what it was does
+   not, unless it is new */
+static bool changes_live(const bit_db_changes *log, size_t k, size_t nq) {
+  const uint64_t *d = log->deltas + k * nq;
+  uint64_t any = 0;
+  for (size_t q = 0; q < nq; q++)
+    any |= d[q];
+  return any || log->rows[k] >= log->base_nelem;
+}
+
+static void db_log_row(T_DB set, size_t index, bool before) {
+  if (set->changes == NULL)
+    return;
+  bool fresh;
+  uint64_t *delta = changes_delta(set, index, &fresh);
+  if (before && fresh && index >= set->changes->base_nelem)
+    return; // a new row: its old contents are not part of the base
+  const uint64_t *row = set->qwords + index * set->stride_in_qwords;
+  OMP_CPU_SIMD
+  for (size_t q = 0; q < set->size_in_qwords; q++)
+    delta[q] ^= row[q];
+}
+
+/* --- 8z'''. Tiled count files ---
+   Every fold of db_count_tiles fills whole file tiles: each is narrowed
+   into an aligned staging tile, zero past the edges of the matrix. Raw
+   tiles are streamed into their slots of a shared mapping of the file with
+   non-temporal stores, since nothing reads them back. Compressed tiles take
+   the next free offset of the file and are written with pwrite; the index
+   records where.
+*/
+
+typedef struct {
+  unsigned char *mapping; // raw tiles: the file, mapped
+  int fd;                 // compressed tiles: the file
+  bit_db_zblock *index;   // compressed tiles: one entry per tile
+  _Atomic uint64_t end;   // compressed tiles: first free byte of the file
+  size_t ncols;           // tiles across the matrix
+  size_t tile_bytes;
+  Bit_counts_type type;
+  _Atomic bool failed;
+} tiled_store_state;
+
+static inline size_t counts_size(Bit_counts_type type) {
+  return type == BIT_COUNTS_U8    ? sizeof(uint8_t)
+         : type == BIT_COUNTS_U16 ? sizeof(uint16_t)
+                                  : sizeof(int);
+}
+
+#if BIT_DB_MMAP_FILES
+/* Narrows rows x cols counts of a tile of db_count_tiles, ntarget across,
+   into a file tile */
+static void tile_stage(const int *tile, int ntarget, int rows, int cols,
+                       Bit_counts_type type, unsigned char *stage) {
+  for (int i = 0; i < rows; i++) {
+    const int *row = tile + (size_t)i * ntarget;
+    const size_t at = (size_t)i * BIT_TILE_COLS;
+    if (type == BIT_COUNTS_U8) {
+      OMP_CPU_SIMD
+      for (int j = 0; j < cols; j++)
+        stage[at + j] = (uint8_t)row[j];
+    } else if (type == BIT_COUNTS_U16) {
+      uint16_t *out = (uint16_t *)stage + at;
+      OMP_CPU_SIMD
+      for (int j = 0; j < cols; j++)
+        out[j] = (uint16_t)row[j];
+    } else {
+      memcpy((int *)stage + at, row, (size_t)cols * sizeof(int));
+    }
+  }
+}
+
+static void tiled_store_fold(void *cl, int first_query, int nquery,
+                             int first_target, int ntarget, const int *tile) {
+  tiled_store_state *state = cl;
+  const size_t tb = state->tile_bytes;
+  unsigned char *stage = portable_aligned_calloc(64, tb);
+  unsigned char *encoded = state->mapping ? NULL : malloc(tb / 8 * 9);
+  assert(stage != NULL && (state->mapping || encoded));
+  for (int r0 = 0; r0 < nquery; r0 += BIT_TILE_ROWS) {
+    for (int c0 = 0; c0 < ntarget; c0 += BIT_TILE_COLS) {
+      const int rows =
+          nquery - r0 < BIT_TILE_ROWS ? nquery - r0 : BIT_TILE_ROWS;
+      const int cols =
+          ntarget - c0 < BIT_TILE_COLS ? ntarget - c0 : BIT_TILE_COLS;
+      if (rows < BIT_TILE_ROWS || cols < BIT_TILE_COLS)
+        memset(stage, 0, tb); // an edge tile
+      tile_stage(tile + (size_t)r0 * ntarget + c0, ntarget, rows, cols,
+                 state->type, stage);
+      const size_t t =
+          (size_t)(first_query + r0) / BIT_TILE_ROWS * state->ncols +
+          (size_t)(first_target + c0) / BIT_TILE_COLS;
+      if (state->mapping) {
+        unsigned char *slot =
+            state->mapping + BIT_DB_FILE_HEADER_SIZE + t * tb;
+        for (size_t b = 0; b < tb; b += STREAM_BYTES)
+          STREAM_COPY(slot + b, stage + b);
+        continue;
+      }
+      // the raw tile stays when encoding does not pay
+      size_t nbytes = zblock_encode((const uint64_t *)stage, tb / 8, encoded);
+      const bool raw = nbytes >= tb;
+      bit_db_zblock block = {
+          .bytes = (uint32_t)(raw ? tb : nbytes),
+          .codec = raw ? BIT_DB_ZBLOCK_RAW : BIT_DB_ZBLOCK_BYTES,
+          .checksum = db_checksum(stage, tb)};
+      block.offset = atomic_fetch_add(&state->end, block.bytes);
+      state->index[t] = block;
+      if (!writer_pwrite(state->fd, raw ? stage : encoded, block.bytes,
+                         (off_t)block.offset))
+        atomic_store(&state->failed, true);
+    }
+  }
+  if (state->mapping)
+    STREAM_FENCE();
+  portable_aligned_free(stage);
+  free(encoded);
+}
+#endif
+
+/* Qword q of compressed tile t, decoding nothing else: its payload starts
+   after the payload bytes of the qwords before it */
+static uint64_t tiles_zqword(Bit_tiles_T tiles, size_t t, size_t q) {
+  const bit_db_zblock *block = &tiles->index[t];
+  const unsigned char *data =
+      (const unsigned char *)tiles->mapping + block->offset;
+  if (block->codec == BIT_DB_ZBLOCK_RAW) {
+    uint64_t w;
+    memcpy(&w, data + q * sizeof(uint64_t), sizeof(w));
+    return w;
+  }
+  const size_t nq = tiles->header->tile_bytes / 8;
+  size_t skip = 0;
+#pragma omp simd reduction(+ : skip)
+  for (size_t i = 0; i < q; i++)
+    skip += (size_t)__builtin_popcount(data[i]);
+  const unsigned char *payload = data + nq + skip;
+  uint64_t w = 0;
+  for (unsigned int c = data[q]; c; c &= c - 1) {
+    if (payload >= data + block->bytes)
+      return 0; // a corrupt tile; BitDB_tiles_block reports it
+    w |= (uint64_t)*payload++ << (8 * __builtin_ctz(c));
+  }
+  return w;
+}
+
+/* Tile t whole, checked against its checksum if compressed, into out
+   (tile_bytes) */
+static bool tiles_load(Bit_tiles_T tiles, size_t t, void *out) {
+  const bit_tile_file_header *h = tiles->header;
+  const unsigned char *base = tiles->mapping;
+  if (tiles->index == NULL) {
+    memcpy(out, base + h->header_size + t * h->tile_bytes, h->tile_bytes);
+    return true;
+  }
+  const bit_db_zblock *block = &tiles->index[t];
+  if (block->codec == BIT_DB_ZBLOCK_RAW)
+    memcpy(out, base + block->offset, h->tile_bytes);
+  else if (!zblock_decode(base + block->offset, block->bytes, out,
+                          h->tile_bytes / 8))
+    return false;
+  return db_checksum(out, h->tile_bytes) == block->checksum;
+}
+
+/* --- 8z''''. Count histograms ---
+   The fold adds the counts of every tile into bins: those of its queries,
+   which only the thread counting them touches, or the global bins of the
+   thread, which are summed once every tile is counted.
+*/
+
+typedef struct {
+  uint64_t *bins;  // per query: nbins per query; global: nbins per thread
+  size_t nbins;    // length + 1
+  bool per_query;
+} histogram_state;
+
+static void histogram_fold(void *cl, int first_query, int nquery,
+                           int first_target, int ntarget, const int *tile) {
+  (void)first_target;
+  const histogram_state *state = cl;
+  for (int i = 0; i < nquery; i++) {
+    const size_t at = state->per_query ? (size_t)(first_query + i)
+                                       : (size_t)omp_get_thread_num();
+    uint64_t *bins = state->bins + at * state->nbins;
+    const int *row = tile + (size_t)i * ntarget;
+    for (int j = 0; j < ntarget; j++)
+      bins[row[j]]++;
+  }
+}
+
+/* --- 8z'''''. Count statistics ---
+   The fold adds every row of a tile into the running sums of its query,
+   which only the thread counting its block touches, and copies it into the
+   counts when the caller keeps them.
+*/
+
+typedef struct {
+  bit_stats_acc *acc; // one per query
+  int *counts;        // NULL unless the counts are kept
+  size_t ntargets;
+} stats_state;
+
+static void stats_fold(void *cl, int first_query, int nquery,
+                       int first_target, int ntarget, const int *tile) {
+  const stats_state *state = cl;
+  for (int i = 0; i < nquery; i++) {
+    const int *row = tile + (size_t)i * ntarget;
+    // a row of a tile sums in 64 bits without loss
+    int64_t sum = 0, sumsq = 0;
+    int lo = row[0], hi = row[0];
+#pragma omp simd reduction(+ : sum, sumsq) reduction(min : lo) \
+    reduction(max : hi)
+    for (int j = 0; j < ntarget; j++) {
+      sum += row[j];
+      sumsq += (int64_t)row[j] * row[j];
+      lo = row[j] < lo ? row[j] : lo;
+      hi = row[j] > hi ? row[j] : hi;
+    }
+    bit_stats_acc *acc = &state->acc[first_query + i];
+    acc->n += (uint64_t)ntarget;
+    acc->sum += (uint64_t)sum;
+    acc->sumsq += (double)sumsq;
+    acc->min = lo < acc->min ? lo : acc->min;
+    acc->max = hi > acc->max ? hi : acc->max;
+    if (state->counts)
+      memcpy(state->counts +
+                 (size_t)(first_query + i) * state->ntargets + first_target,
+             row, (size_t)ntarget * sizeof(int));
+  }
+}
+
+/* --- End Section 8: INTERNAL HELPER FUNCTION DEFINITIONS --- */
+
+/* ===========================================================================
+   SECTION 10: PUBLIC API — SINGLE BITSET (Bit_T)
+   ===========================================================================
+ */
+
+/* --- 10a. Lifecycle: create, destroy, load from external buffer --- */
+
+T Bit_new(int length) {
+  assert(length > 0);
+  assert(length < INT_MAX); // limit to 2^30 bits
+  unsigned int size_in_qwords = nqwords(length);
+
+  // header and payload share one aligned block, see BIT_HEADER_SIZE
+  T set = portable_aligned_calloc(ALIGNMENT, BIT_HEADER_SIZE +
+                                                 size_in_qwords *
+                                                     sizeof(uint64_t));
+  assert(set != NULL);
+  bitset_init(set, length,
+              (uint64_t *)((unsigned char *)set + BIT_HEADER_SIZE));
+  set->is_Bit_T_allocated = true; // allocated by the library
+  bit_mem_charge(BIT_MEM_BITSETS,
+                 BIT_HEADER_SIZE + (int64_t)size_in_qwords * sizeof(uint64_t));
+  return set;
+}
+
+// return a pointer to the original buffer (if externally loaded) or NULL
+// otherwise
+void *Bit_free(T *set) {
+  assert(set && *set);
+  T s = *set;
+  void *original_location = s->is_Bit_T_allocated ? NULL : (void *)s->qwords;
+  if (s->pool) {
+    free(s->summary); // summaries are opted into by each user
+    s->summary = NULL;
+    pool_release(s->pool, s); // keeps its rank index for the next user
+  } else {
+    free(s->rank);
+    free(s->summary);
+    if (s->is_Bit_T_allocated) {
+      bit_mem_charge(BIT_MEM_BITSETS,
+                     -(BIT_HEADER_SIZE +
+                       (int64_t)s->size_in_qwords * sizeof(uint64_t)));
+      portable_aligned_free(s);
+    } else
+      free(s);
+  }
+  *set = NULL;
+  return original_location;
+}
+
+T Bit_load(int length, void *buffer) {
+  assert(length > 0);
+  assert(length < INT_MAX); // limit to 2^30 bits
+  assert(buffer != NULL);
+
+  T set = malloc(sizeof(*set));
+  assert(set != NULL);
+  bitset_init(set, length, (uint64_t *)buffer);
+  set->is_Bit_T_allocated = false; // not allocated by the library
+  return set;
+}
+
+int Bit_extract(T set, void *buffer) {
+  assert(set);
+  assert(buffer != NULL);
+  // Copy the bytes from the bitset to the buffer
+  memcpy(buffer, set->bytes, set->size_in_bytes);
+  return set->size_in_bytes; // return the number of bytes written
+}
+
+/* --- 10b. Properties --- */
+
+int Bit_length(T set) {
+  assert(set);
+  return set->length;
+}
+
+int Bit_count(T set) {
+  assert(set);
+  if (set->count_valid)
+    return set->count;
+  BIT_PROFILE_CALL(bit_profile_bytes(set));
+  const size_t nblocks = rank_nblocks(set->size_in_qwords);
+  const uint64_t *a;
+  if (set->rank_valid) // the index ends with the total
+    set->count = (int)set->rank[nblocks];
+  else if ((a = bit_summary(set)) != NULL &&
+           summary_pays(summary_candidates(BIT_OP_AND, a, a, nblocks), nblocks))
+    set->count = summary_setop_count(BIT_OP_AND, set->qwords, set->qwords, a,
+                                     a, set->size_in_qwords);
+  else
+    set->count = split_count(set);
+  set->count_valid = true;
+  return set->count;
+}
+
+void Bit_touch(T set) {
+  assert(set);
+  RANK_INVALIDATE(set);
+  SUMMARY_INVALIDATE(set);
+}
+
+/* Seed of the hash of a set or row: sets of different lengths whose qwords
+   agree still hash apart */
+static inline uint64_t hash_seed(uint64_t seed, unsigned int length) {
+  return seed ^ (uint64_t)length * UINT64_C(0xc2b2ae3d27d4eb4f);
+}
+
+uint64_t Bit_hash64(T set, uint64_t seed) {
+  assert(set);
+  BIT_PROFILE_CALL(bit_profile_bytes(set));
+  return bit_kernels_active()->hash_qwords(set->qwords, set->size_in_qwords,
+                                           hash_seed(seed, set->length));
+}
+
+int Bit_buffer_size(int length) {
+  assert(length > 0);
+  return nqwords(length) * BPQW / BPB;
+}
+
+/* --- 10c. Member operations (set, clear, get, map individual bits) --- */
+
+/* Bit index of set is about to become bit: the rank index goes stale, a
+   cached count stays exact */
+static inline void bit_write_one(T set, int index, int bit) {
+  set->rank_valid = false;
+  if (set->count_valid)
+    set->count += bit - ((set->bytes[index / BPB] >> (index % BPB)) & 1);
+}
+
+void Bit_aset(T set, int indices[], int n) {
+  assert(set);
+  BIT_PROFILE_CALL((uint64_t)n * sizeof(int));
+  RANK_INVALIDATE(set);
+  assert(indices);
+  for (int i = 0; i < n; i++) {
+    PREFETCH_INDEX(set, indices, i, n, 1);
+    assert(indices[i] >= 0 && indices[i] < (int)set->length);
+    set->qwords[indices[i] / BPQW] |= UINT64_C(1) << (indices[i] % BPQW);
+  }
+  summary_touch_indices(set, indices, n, true);
+}
+void Bit_aclear(T set, int indices[], int n) {
+  assert(set);
+  BIT_PROFILE_CALL((uint64_t)n * sizeof(int));
+  RANK_INVALIDATE(set);
+  assert(indices);
+  for (int i = 0; i < n; i++) {
+    PREFETCH_INDEX(set, indices, i, n, 1);
+    assert(indices[i] >= 0 && indices[i] < (int)set->length);
+    set->qwords[indices[i] / BPQW] &= ~(UINT64_C(1) << (indices[i] % BPQW));
+  }
+  summary_touch_indices(set, indices, n, false);
+}
+void Bit_aget(T set, int indices[], int n, int out[]) {
+  assert(set);
+  BIT_PROFILE_CALL((uint64_t)n * 2 * sizeof(int));
+  assert(indices && out);
+  for (int i = 0; i < n; i++) {
+    PREFETCH_INDEX(set, indices, i, n, 0);
+    assert(indices[i] >= 0 && indices[i] < (int)set->length);
+    out[i] = (set->qwords[indices[i] / BPQW] >> (indices[i] % BPQW)) & 1;
+  }
+}
+void Bit_aset_sorted(T set, int indices[], int n) {
+  assert(set);
+  RANK_INVALIDATE(set);
+  assert(indices);
+  SORTED_INDEX_APPLY(set, indices, n, APPLY_OR);
+  summary_touch_indices(set, indices, n, true);
+}
+void Bit_aclear_sorted(T set, int indices[], int n) {
+  assert(set);
+  RANK_INVALIDATE(set);
+  assert(indices);
+  SORTED_INDEX_APPLY(set, indices, n, APPLY_ANDN);
+  summary_touch_indices(set, indices, n, false);
+}
+void Bit_bset(T set, int index) {
+  assert(set);
+  assert(index >= 0 && index < (int)set->length);
+  bit_write_one(set, index, 1);
+  set->bytes[index / BPB] |= 1 << (index % BPB);
+  summary_touch_set(set, (size_t)index, (size_t)index);
+}
+
+void Bit_bclear(T set, int index) {
+  assert(set);
+  assert(index >= 0 && index < (int)set->length);
+  bit_write_one(set, index, 0);
+  set->bytes[index / BPB] &= ~(1 << (index % BPB));
+  summary_touch_changed(set, (size_t)index, (size_t)index);
+}
+
+void Bit_clear(T set, int lo, int hi) {
+  assert(set);
+  assert(0 <= lo && hi < (int)set->length);
+  assert(lo <= hi);
+  range_apply(set, lo, hi, RANGE_CLEAR);
+}
+
+void Bit_clear_ranges(T set, int lo[], int hi[], int n) {
+  assert(set);
+  assert(lo && hi);
+  for (int i = 0; i < n; i++) {
+    assert(0 <= lo[i] && hi[i] < (int)set->length);
+    assert(lo[i] <= hi[i]);
+    range_apply(set, lo[i], hi[i], RANGE_CLEAR);
+  }
+}
+int Bit_get(T set, int index) {
+  assert(set);
+  assert(index >= 0 && index < (int)set->length);
+  return ((set->bytes[index / BPB] >> (index % BPB)) & 1);
+}
+
+void Bit_map(T set, void apply(int n, int bit, void *cl), void *cl) {
+  assert(set);
+  for (unsigned int i = 0; i < set->length; i++) {
+    apply(i, ((set->bytes[i / BPB] >> (i % BPB)) & 1), cl);
+  }
+}
+
+int Bit_next_set(T set, int from) {
+  assert(set);
+  assert(from >= 0);
+  if (from >= (int)set->length)
+    return -1;
+  unsigned int w = from / BPQW;
+  uint64_t word = set->qwords[w] & (~UINT64_C(0) << (from % BPQW));
+  while (word == 0) {
+    if (++w == set->size_in_qwords)
+      return -1;
+    word = set->qwords[w];
+  }
+  unsigned int index = w * BPQW + __builtin_ctzll(word);
+  return index < set->length ? (int)index : -1;
+}
+
+int Bit_prev_set(T set, int from) {
+  assert(set);
+  assert(from < (int)set->length);
+  if (from < 0)
+    return -1;
+  unsigned int w = from / BPQW;
+  uint64_t word = set->qwords[w] & (~UINT64_C(0) >> (BPQW - 1 - from % BPQW));
+  while (word == 0) {
+    if (w-- == 0)
+      return -1;
+    word = set->qwords[w];
+  }
+  return (int)(w * BPQW + BPQW - 1 - __builtin_clzll(word));
+}
+
+void Bit_foreach_set(T set, void apply(int n, void *cl), void *cl) {
+  assert(set);
+  unsigned int nq = set->size_in_qwords;
+  for (unsigned int w = 0; w < nq; w++) {
+    uint64_t word = set->qwords[w];
+    if (w == nq - 1 && set->length % BPQW)
+      word &= (UINT64_C(1) << (set->length % BPQW)) - 1;
+    while (word) {
+      apply((int)(w * BPQW + __builtin_ctzll(word)), cl);
+      word &= word - 1; // clear the lowest set bit
+    }
+  }
+}
+
+int Bit_to_indices(T set, int *out, int max) {
+  assert(set);
+  assert(max >= 0);
+  assert(max == 0 || out != NULL);
+  const bit_kernel_table *k = bit_kernels_active();
+  const size_t nq = set->size_in_qwords;
+  const int nthreads = omp_get_max_threads();
+  if (nq < BIT_DECODE_PARALLEL_QWORDS || nthreads == 1 || omp_in_parallel()) {
+    k->decode_qwords(set->qwords, nq, 0, out, (size_t)max);
+    return Bit_count(set);
+  }
+  // each range decodes at the prefix sum of the counts of those before it
+  size_t *at = malloc(((size_t)nthreads + 1) * sizeof(size_t));
+  assert(at != NULL);
+  at[0] = 0;
+  int team = 1; // threads the runtime gave
+#pragma omp parallel num_threads(nthreads)
+  {
+    const int c = omp_get_thread_num(), n = omp_get_num_threads();
+    size_t first, len;
+    split_range(nq, n, c, &first, &len);
+    at[c + 1] = (size_t)k->count_qwords(set->qwords + first, len);
+#pragma omp barrier
+#pragma omp single
+    {
+      team = n;
+      for (int r = 0; r < n; r++)
+        at[r + 1] += at[r];
+    }
+    // the room of a range ends where the next begins: the table kernels
+    // store past their last position while they have room to spare
+    const size_t end = at[c + 1] < (size_t)max ? at[c + 1] : (size_t)max;
+    if (at[c] < end)
+      k->decode_qwords(set->qwords + first, len, (int)(first * BPQW),
+                       out + at[c], end - at[c]);
+  }
+  const int total = (int)at[team];
+  free(at);
+  return total;
+}
+
+void Bit_not(T set, int lo, int hi) {
+  assert(set);
+  assert(0 <= lo && hi < (int)set->length);
+  assert(lo <= hi);
+  range_apply(set, lo, hi, RANGE_FLIP);
+}
+
+void Bit_not_ranges(T set, int lo[], int hi[], int n) {
+  assert(set);
+  assert(lo && hi);
+  for (int i = 0; i < n; i++) {
+    assert(0 <= lo[i] && hi[i] < (int)set->length);
+    assert(lo[i] <= hi[i]);
+    range_apply(set, lo[i], hi[i], RANGE_FLIP);
+  }
+}
+int Bit_put(T set, int index, int bit) {
+  int prev;
+  assert(set);
+  assert(bit == 0 || bit == 1);
+  assert(0 <= index && (unsigned int)index < set->length);
+  prev = ((set->bytes[index / BPB] >> (index % BPB)) & 1);
+  bit_write_one(set, index, bit);
+  if (bit == 1) {
+    set->bytes[index / BPB] |= 1 << (index % BPB);
+    summary_touch_set(set, (size_t)index, (size_t)index);
+  } else {
+    set->bytes[index / BPB] &= ~(1 << (index % BPB));
+    summary_touch_changed(set, (size_t)index, (size_t)index);
+  }
+  return prev;
+}
+
+void Bit_set(T set, int lo, int hi) {
+  assert(set);
+  assert(0 <= lo && hi < (int)set->length);
+  assert(lo <= hi);
+  range_apply(set, lo, hi, RANGE_SET);
+}
+
+void Bit_set_ranges(T set, int lo[], int hi[], int n) {
+  assert(set);
+  assert(lo && hi);
+  for (int i = 0; i < n; i++) {
+    assert(0 <= lo[i] && hi[i] < (int)set->length);
+    assert(lo[i] <= hi[i]);
+    range_apply(set, lo[i], hi[i], RANGE_SET);
+  }
+}
+/* --- 10c'. Rank and select --- */
+
+void Bit_rank_build(T set) {
+  assert(set);
+  if (set->rank_valid)
+    return;
+  if (set->rank == NULL) {
+    set->rank =
+        malloc((rank_nblocks(set->size_in_qwords) + 1) * sizeof(uint32_t));
+    assert(set->rank != NULL);
+  }
+  bit_kernels_active()->rank_build(set->qwords, set->size_in_qwords,
+                                   set->rank);
+  set->rank_valid = true;
+}
+
+int Bit_rank(T set, int index) {
+  assert(set);
+  assert(index >= 0 && index <= (int)set->length);
+  Bit_rank_build(set);
+  unsigned int w = index / BPQW;
+  unsigned int block = w / RANK_BLOCK_QWORDS;
+  int rank = (int)set->rank[block];
+  for (unsigned int i = block * RANK_BLOCK_QWORDS; i < w; i++)
+    rank += (int)POPCOUNT(set->qwords[i]);
+  if (index % BPQW)
+    rank += (int)POPCOUNT(set->qwords[w] &
+                          ((UINT64_C(1) << (index % BPQW)) - 1));
+  return rank;
+}
+
+int Bit_select(T set, int k) {
+  assert(set);
+  assert(k >= 0);
+  Bit_rank_build(set);
+  unsigned int nblocks = rank_nblocks(set->size_in_qwords);
+  if ((uint32_t)k >= set->rank[nblocks])
+    return -1;
+  // last block whose cumulative count does not exceed k
+  unsigned int lo = 0, hi = nblocks - 1;
+  while (lo < hi) {
+    unsigned int mid = lo + (hi - lo + 1) / 2;
+    if (set->rank[mid] <= (uint32_t)k)
+      lo = mid;
+    else
+      hi = mid - 1;
+  }
+  k -= (int)set->rank[lo];
+  for (unsigned int w = lo * RANK_BLOCK_QWORDS;; w++) {
+    int c = (int)POPCOUNT(set->qwords[w]);
+    if (k < c) {
+      unsigned int index = w * BPQW + select_in_word(set->qwords[w], k);
+      return index < set->length ? (int)index : -1;
+    }
+    k -= c;
+  }
+}
+
+/* --- 10c''. Non-empty block summaries --- */
+
+void Bit_cache_summary(T set, bool enable) {
+  assert(set);
+  if (!enable) {
+    free(set->summary);
+    set->summary = NULL;
+  } else if (set->summary == NULL) {
+    set->summary = malloc(summary_nwords(set->size_in_qwords) *
+                          sizeof(uint64_t));
+    assert(set->summary != NULL);
+  }
+  SUMMARY_INVALIDATE(set);
+  bit_summary(set);
+}
+
+/* --- 10c'''. Atomic member operations --- */
+
+void Bit_bset_atomic(T set, int index) {
+  assert(set);
+  assert(index >= 0 && index < (int)set->length);
+  RANK_INVALIDATE(set);
+  __atomic_fetch_or(&set->qwords[index / BPQW], UINT64_C(1) << (index % BPQW),
+                    __ATOMIC_RELAXED);
+  summary_touch_set_atomic(set, (size_t)index);
+}
+
+void Bit_aset_atomic(T set, int indices[], int n) {
+  assert(set);
+  assert(indices || n == 0);
+  RANK_INVALIDATE(set);
+  for (int i = 0; i < n; i++) {
+    PREFETCH_INDEX(set, indices, i, n, 1);
+    assert(indices[i] >= 0 && indices[i] < (int)set->length);
+    const uint64_t bit = UINT64_C(1) << (indices[i] % BPQW);
+    uint64_t *word = &set->qwords[indices[i] / BPQW];
+    // bits already set (the common case when marking seen items) skip the
+    // locked instruction and keep the line shared
+    if (!(__atomic_load_n(word, __ATOMIC_RELAXED) & bit)) {
+      __atomic_fetch_or(word, bit, __ATOMIC_RELAXED);
+      summary_touch_set_atomic(set, (size_t)indices[i]);
+    }
+  }
+}
+
+int Bit_test_and_set(T set, int index) {
+  assert(set);
+  assert(index >= 0 && index < (int)set->length);
+  const uint64_t bit = UINT64_C(1) << (index % BPQW);
+  uint64_t *word = &set->qwords[index / BPQW];
+  if (__atomic_load_n(word, __ATOMIC_RELAXED) & bit)
+    return 1;
+  RANK_INVALIDATE(set);
+  if (__atomic_fetch_or(word, bit, __ATOMIC_RELAXED) & bit)
+    return 1; // another thread was first
+  summary_touch_set_atomic(set, (size_t)index);
+  return 0;
+}
+
+/* --- 10d. Comparisons --- */
+
+/* 1 iff op(s, t) has a set bit, skipping empty blocks when both keep
+   summaries */
+static int setop_any_of(bit_setop_id op, T s, T t) {
+  const uint64_t *a = bit_summary(s), *b = bit_summary(t);
+  if (a != NULL && b != NULL)
+    return summary_setop_any(op, s, t, a, b);
+  return split_setop_any(op, s, t);
+}
+
+int Bit_eq(T s, T t) {
+  assert(s && t);
+  assert(s->length == t->length);
+  return !setop_any_of(BIT_OP_XOR, s, t);
+}
+
+int Bit_leq(T s, T t) {
+  assert(s && t);
+  assert(s->length == t->length);
+  return !setop_any_of(BIT_OP_AND_NOT, s, t);
+}
+
+int Bit_lt(T s, T t) {
+  assert(s && t);
+  assert(s->length == t->length);
+  return !setop_any_of(BIT_OP_AND_NOT, s, t) &&
+         setop_any_of(BIT_OP_AND_NOT, t, s);
+}
+
+int Bit_intersects(T s, T t) {
+  assert(s && t);
+  assert(s->length == t->length);
+  return setop_any_of(BIT_OP_AND, s, t);
+}
+
+int Bit_disjoint(T s, T t) { return !Bit_intersects(s, t); }
+/* --- 10e. Set operations (return a new Bit_T, see 10e' for the work) --- */
+
+/* Results of summarized operands keep a summary too, which starts out
+   current since the new bitset is empty */
+static void summary_inherit(T set, T s, T t) {
+  if (s && t && s->summary && t->summary) {
+    set->summary = calloc(summary_nwords(set->size_in_qwords),
+                          sizeof(uint64_t));
+    assert(set->summary != NULL);
+    set->summary_valid = true;
+  }
+}
+
+T Bit_diff(T s, T t) {
+  assert(s || t);
+  T set = Bit_new((s ? s : t)->length);
+  summary_inherit(set, s, t);
+  Bit_diff_into(set, s, t);
+  return set;
+}
+T Bit_minus(T s, T t) {
+  assert(s || t);
+  T set = Bit_new((s ? s : t)->length);
+  summary_inherit(set, s, t);
+  Bit_minus_into(set, s, t);
+  return set;
+}
+T Bit_inter(T s, T t) {
+  assert(s || t);
+  T set = Bit_new((s ? s : t)->length);
+  summary_inherit(set, s, t);
+  Bit_inter_into(set, s, t);
+  return set;
+}
+
+T Bit_union(T s, T t) {
+  assert(s || t);
+  T set = Bit_new((s ? s : t)->length);
+  summary_inherit(set, s, t);
+  Bit_union_into(set, s, t);
+  return set;
+}
+
+/* --- 10e'. Set operations into caller-supplied storage ---
+   The kernels are element-wise, so dst may alias s or t; the *_assign forms
+   are simply dst == s.
+*/
+
+void Bit_diff_into(T dst, T s, T t) {
+  BIT_PROFILE_CALL(bit_profile_bytes(dst) + bit_profile_bytes(s) +
+                   bit_profile_bytes(t));
+  setop_into_validate(clear_into(dst), copy_into(dst, t), copy_into(dst, s));
+  bit_setop_into(BIT_OP_XOR, dst, s, t);
+}
+void Bit_minus_into(T dst, T s, T t) {
+  BIT_PROFILE_CALL(bit_profile_bytes(dst) + bit_profile_bytes(s) +
+                   bit_profile_bytes(t));
+  setop_into_validate(clear_into(dst), clear_into(dst), copy_into(dst, s));
+  bit_setop_into(BIT_OP_AND_NOT, dst, s, t);
+}
+void Bit_inter_into(T dst, T s, T t) {
+  BIT_PROFILE_CALL(bit_profile_bytes(dst) + bit_profile_bytes(s) +
+                   bit_profile_bytes(t));
+  setop_into_validate(copy_into(dst, t), clear_into(dst), clear_into(dst));
+  bit_setop_into(BIT_OP_AND, dst, s, t);
+}
+void Bit_union_into(T dst, T s, T t) {
+  BIT_PROFILE_CALL(bit_profile_bytes(dst) + bit_profile_bytes(s) +
+                   bit_profile_bytes(t));
+  setop_into_validate(copy_into(dst, t), copy_into(dst, t),
+                      copy_into(dst, s));
+  bit_setop_into(BIT_OP_OR, dst, s, t);
+}
+
+void Bit_diff_assign(T s, T t) { Bit_diff_into(s, s, t); }
+void Bit_minus_assign(T s, T t) { Bit_minus_into(s, s, t); }
+void Bit_inter_assign(T s, T t) { Bit_inter_into(s, s, t); }
+void Bit_union_assign(T s, T t) { Bit_union_into(s, s, t); }
+
+/* --- 10e''. Shifts, rotations and dilation ---
+   Word-level funnel shifts of the kernel table; "left" moves bit i to
+   i + k, as << does within a qword. Bits moved past the length are cleared
+   from the last qword.
+*/
+
+static inline void shift_tail_clear(T set) {
+  if (set->length % BPQW)
+    set->qwords[set->size_in_qwords - 1] &=
+        (UINT64_C(1) << (set->length % BPQW)) - 1;
+}
+
+static void shift_into(T dst, T s, long long shift) {
+  assert(dst && s && dst->length == s->length);
+  BIT_PROFILE_CALL(bit_profile_bytes(dst) + bit_profile_bytes(s));
+  bit_kernels_active()->shift_qwords(dst->qwords, s->qwords,
+                                     s->size_in_qwords, shift, false);
+  shift_tail_clear(dst);
+  RANK_INVALIDATE(dst);
+  SUMMARY_INVALIDATE(dst);
+}
+
+/* A rotation is the OR of two shifts of s; in place, the second one reads
+   a copy of s */
+static void rotate_into(T dst, T s, long long k) {
+  assert(dst && s && dst->length == s->length);
+  BIT_PROFILE_CALL(bit_profile_bytes(dst) + bit_profile_bytes(s));
+  const long long length = s->length;
+  k %= length;
+  if (k < 0)
+    k += length;
+  const size_t nq = s->size_in_qwords;
+  const uint64_t *src = s->qwords;
+  uint64_t *copy = NULL;
+  if (dst == s && k != 0) {
+    copy = malloc(nq * sizeof(uint64_t));
+    assert(copy != NULL);
+    memcpy(copy, s->qwords, nq * sizeof(uint64_t));
+    src = copy;
+  }
+  const bit_kernel_table *kernels = bit_kernels_active();
+  kernels->shift_qwords(dst->qwords, src, nq, k, false);
+  shift_tail_clear(dst);
+  if (k != 0)
+    kernels->shift_qwords(dst->qwords, src, nq, k - length, true);
+  free(copy);
+  RANK_INVALIDATE(dst);
+  SUMMARY_INVALIDATE(dst);
+}
+
+void Bit_shift_left_into(T dst, T s, int k) {
+  assert(k >= 0);
+  shift_into(dst, s, k);
+}
+void Bit_shift_right_into(T dst, T s, int k) {
+  assert(k >= 0);
+  shift_into(dst, s, -(long long)k);
+}
+void Bit_rotate_left_into(T dst, T s, int k) {
+  assert(k >= 0);
+  rotate_into(dst, s, k);
+}
+void Bit_rotate_right_into(T dst, T s, int k) {
+  assert(k >= 0);
+  rotate_into(dst, s, -(long long)k);
+}
+
+void Bit_shift_left(T set, int k) { Bit_shift_left_into(set, set, k); }
+void Bit_shift_right(T set, int k) { Bit_shift_right_into(set, set, k); }
+void Bit_rotate_left(T set, int k) { Bit_rotate_left_into(set, set, k); }
+void Bit_rotate_right(T set, int k) { Bit_rotate_right_into(set, set, k); }
+
+/* The window [i - before, i + after] grows by doubling: once dst is the OR
+   of the shifts 0 .. c of s, ORing in dst shifted by up to c + 1 more covers
+   0 .. 2c + 1, so each direction takes log2 passes over the set */
+void Bit_dilate_into(T dst, T s, int before, int after) {
+  assert(dst && s && dst->length == s->length);
+  assert(before >= 0 && after >= 0);
+  BIT_PROFILE_CALL(bit_profile_bytes(dst) + bit_profile_bytes(s));
+  copy_into(dst, s);
+  const bit_kernel_table *kernels = bit_kernels_active();
+  const size_t nq = dst->size_in_qwords;
+  const long long span[2] = {
+      before < (int)dst->length ? before : (int)dst->length,
+      after < (int)dst->length ? after : (int)dst->length};
+  for (int direction = 0; direction < 2; direction++) {
+    for (long long covered = 0; covered < span[direction];) {
+      const long long step = covered + 1 < span[direction] - covered
+                                 ? covered + 1
+                                 : span[direction] - covered;
+      kernels->shift_qwords(dst->qwords, dst->qwords, nq,
+                            direction == 0 ? step : -step, true);
+      covered += step;
+    }
+  }
+  shift_tail_clear(dst);
+  RANK_INVALIDATE(dst);
+  SUMMARY_INVALIDATE(dst);
+}
+
+void Bit_dilate(T set, int before, int after) {
+  Bit_dilate_into(set, set, before, after);
+}
+
+/* --- 10f. Set operations (return population count of result) --- */
+
+/* Population count of op(s, t), skipping empty blocks when both keep
+   summaries and the candidate blocks are few enough */
+static int setop_count_of(bit_setop_id op, T s, T t) {
+  const uint64_t *a = bit_summary(s), *b = bit_summary(t);
+  const size_t nq = s->size_in_qwords, nblocks = rank_nblocks(nq);
+  if (a != NULL && b != NULL &&
+      summary_pays(summary_candidates(op, a, b, nblocks), nblocks))
+    return summary_setop_count(op, s->qwords, t->qwords, a, b, nq);
+  return split_setop_count(op, s, t);
+}
+
+int Bit_diff_count(T s, T t) {
+  BIT_PROFILE_CALL(bit_profile_bytes(s) + bit_profile_bytes(t));
+  setop_validate(0, Bit_count(t), Bit_count(s));
+  return setop_count_of(BIT_OP_XOR, s, t);
+}
+int Bit_minus_count(T s, T t) {
+  BIT_PROFILE_CALL(bit_profile_bytes(s) + bit_profile_bytes(t));
+  setop_validate(0, 0, Bit_count(s));
+  return setop_count_of(BIT_OP_AND_NOT, s, t);
+}
+int Bit_inter_count(T s, T t) {
+  BIT_PROFILE_CALL(bit_profile_bytes(s) + bit_profile_bytes(t));
+  setop_validate(Bit_count(t), 0, 0);
+  return setop_count_of(BIT_OP_AND, s, t);
+}
+int Bit_union_count(T s, T t) {
+  BIT_PROFILE_CALL(bit_profile_bytes(s) + bit_profile_bytes(t));
+  setop_validate(Bit_count(t), Bit_count(t), Bit_count(s));
+  return setop_count_of(BIT_OP_OR, s, t);
+}
+
+/* Counts of op over n pairs: the kernel is looked up once, and while pair i
+   is counted the words of pair i + 1 and the headers of pair i + 2 are
+   prefetched, since every pair lives in its own allocation */
+static void setop_count_batch(bit_setop_id op, T a[], T b[], int n,
+                              int out[]) {
+  assert(n >= 0);
+  assert(n == 0 || (a && b && out));
+  if (n == 0)
+    return;
+  int (*kernel)(T, T) = bit_kernels_active()->setop_count[op];
+  const size_t nq = a[0]->size_in_qwords;
+  const size_t bytes = nq * sizeof(uint64_t);
+  const size_t ahead = bytes < 512 ? bytes : 512; // bytes of the next pair
+  BIT_PROFILE_CALL((uint64_t)n * 2 * nq * sizeof(uint64_t));
+#pragma omp parallel for schedule(static)                                      \
+    if ((size_t)n * nq > BIT_BATCH_PARALLEL_QWORDS)
+  for (int i = 0; i < n; i++) {
+    if (i + 2 < n) {
+      __builtin_prefetch(a[i + 2], 0);
+      __builtin_prefetch(b[i + 2], 0);
+    }
+    if (i + 1 < n) {
+      for (size_t at = 0; at < ahead; at += 64) {
+        __builtin_prefetch((const unsigned char *)a[i + 1]->qwords + at, 0);
+        __builtin_prefetch((const unsigned char *)b[i + 1]->qwords + at, 0);
+      }
+    }
+    assert(a[i] && b[i]);
+    assert(a[i]->length == a[0]->length && b[i]->length == a[0]->length);
+    out[i] = kernel(a[i], b[i]);
+  }
+}
+
+void Bit_diff_count_batch(T a[], T b[], int n, int out[]) {
+  setop_count_batch(BIT_OP_XOR, a, b, n, out);
+}
+void Bit_inter_count_batch(T a[], T b[], int n, int out[]) {
+  setop_count_batch(BIT_OP_AND, a, b, n, out);
+}
+void Bit_minus_count_batch(T a[], T b[], int n, int out[]) {
+  setop_count_batch(BIT_OP_AND_NOT, a, b, n, out);
+}
+void Bit_union_count_batch(T a[], T b[], int n, int out[]) {
+  setop_count_batch(BIT_OP_OR, a, b, n, out);
+}
+
+int Bit_expr_count(const Bit_expr_op program[], int nops, T operands[],
+                   int noperands) {
+  assert(noperands > 0 && operands && operands[0]);
+  T first = operands[0];
+  BIT_PROFILE_CALL((uint64_t)noperands * bit_profile_bytes(first));
+  expr_validate(program, nops, operands, noperands, first->length, false);
+  return bit_kernels_active()->expr_count(program, nops, operands, NULL,
+                                          first->size_in_qwords,
+                                          first->length);
+}
+
+void Bit_get_configuration(Bit_config *config) {
+  assert(config);
+  const bit_kernel_table *k = bit_kernels_active();
+  *config = (Bit_config){
+      .isa = k->isa,
+      .simd = k->simd,
+      .popcount = k->popcount(),
+#if BIT_ISA_DISPATCH
+      .isa_dispatch = true,
+#endif
+      .alignment = ALIGNMENT,
+      .tuning = Bit_tuning_get(),
+      .cpu_tile_bit = CPU_TILE_BIT,
+      .cpu_tile_bits = CPU_TILE_BITS,
+      .k_block = K_BLOCK,
+      .setop_buffer_size = SETOP_BUFFER_SIZE,
+      .outer_rows = OUTER_ROW_NUM,
+      .outer_cols = OUTER_COL_NUM,
+      .outer_vec_blk = OUTER_VEC_BLK,
+      .omp_max_threads = omp_get_max_threads(),
+      .omp_thread_limit = omp_get_thread_limit(),
+      .omp_num_procs = omp_get_num_procs(),
+#if defined(BIT_PROFILE) && (BIT_PROFILE)
+      .profile = true,
+#endif
+#if defined(BIT_TRACE) && (BIT_TRACE)
+      .trace = true,
+#endif
+  };
+  bit_gpu_configuration(config);
+}
+
+void print_Bit_configuration(void) {
+    Bit_config config;
+    Bit_get_configuration(&config);
+    printf("==========================================\n");
+    printf("        System Bit Configuration          \n");
+    printf("==========================================\n");
+    
+    // Using fixed-width specifiers for clean alignment (e.g., %-20s)
+    printf(" %-20s : %d\n", "CPU_TILE_BIT",      config.cpu_tile_bit);
+    printf(" %-20s : %d\n", "CPU_TILE_BITS",     config.cpu_tile_bits);
+    printf(" %-20s : %d\n", "GPU_TILE_J",        config.gpu_tile_j);
+    printf(" %-20s : %d\n", "GPU_ILP",           config.gpu_ilp);
+    printf(" %-20s : %d\n", "K_BLOCK",           config.k_block);
+    printf(" %-20s : %d\n", "SETOP_BUFFER_SIZE", config.setop_buffer_size);
+    printf(" %-20s : %d\n", "OUTER_ROW_NUM", config.outer_rows);
+    printf(" %-20s : %d\n", "OUTER_COL_NUM", config.outer_cols);
+    printf(" %-20s : %d\n", "OUTER_VEC_BLK", config.outer_vec_blk);
+    printf(" %-20s : %d\n", "ALIGNMENT",     config.alignment);
+    
+    printf("------------------------------------------\n");
+    printf(" %-20s : %s\n", "Using LIBPOPCNT",     USE_LIBPOPCNT ? "Yes" : "No");
+    printf(" %-20s : %s\n", "Popcount",            config.popcount);
+    printf(" %-20s : %s (%s)\n", "Kernel ISA",     config.isa, config.simd);
+    printf(" %-20s : %s, tile %d, k_block %d, prefetch %d\n",
+           "Active tuning", bit_tuning_block_names[config.tuning.block],
+           config.tuning.tile, config.tuning.k_block, config.tuning.prefetch);
+    printf(" %-20s : %d of %d processors\n", "OpenMP threads",
+           config.omp_max_threads, config.omp_num_procs);
+    printf("------------------------------------------\n");
+    printf(" %-20s : %s\n", "GPU offload",         config.gpu ? "Yes" : "No");
+    printf(" %-20s : %d\n", "GPU devices",         config.gpu_devices);
+    printf(" %-20s : %s\n", "GPU architectures",
+           *config.gpu_archs ? config.gpu_archs : "default");
+    printf(" %-20s : %d\n", "GPU word bits",       config.gpu_word_bits);
+    printf(" %-20s : %s\n", "Native backend",
+           config.native_backend ? config.native_backend : "none");
+    printf("==========================================\n");
+}
+/* --- 10f'. N-way reductions --- */
+
+void Bit_reduce(T in[], int n, Bit_reduce_op op, int k, T out) {
+  assert(in && out);
+  assert(n > 0);
+  assert(op >= BIT_REDUCE_OR && op <= BIT_REDUCE_MAJORITY);
+  assert(op != BIT_REDUCE_ATLEAST || k >= 0);
+  for (int i = 0; i < n; i++)
+    assert(in[i] && in[i]->length == out->length);
+  reduce_src src = {.list = in, .n = (size_t)n, .nq = out->size_in_qwords};
+  BIT_PROFILE_CALL(((uint64_t)n + 1) * bit_profile_bytes(out));
+  reduce_run(&src, op, k, out, omp_get_max_threads());
+}
+
+/* --- 10f''. Range-restricted and complement counts ---
+   The head and tail qwords of [lo, hi] are masked and counted inline, the
+   qwords in between by the SIMD kernels, so nothing is materialized.
+*/
+
+static inline uint64_t setop_word(bit_setop_id op, uint64_t a, uint64_t b) {
+  switch (op) {
+  case BIT_OP_AND:
+    return a & b;
+  case BIT_OP_OR:
+    return a | b;
+  case BIT_OP_XOR:
+    return a ^ b;
+  default: // AND_NOT
+    return a & ~b;
+  }
+}
+
+/* Population count of op(s, t) over the bits [lo, hi]; t == NULL counts s */
+static int setop_count_range(bit_setop_id op, T s, T t, int lo, int hi) {
+  assert(s && (t == NULL || t->length == s->length));
+  assert(0 <= lo && lo <= hi && hi < (int)s->length);
+  const bit_kernel_table *kernels = bit_kernels_active();
+  const uint64_t *a = s->qwords, *b = t ? t->qwords : s->qwords;
+  const size_t lo_word = (size_t)lo / BPQW, hi_word = (size_t)hi / BPQW;
+  const uint64_t head = ~UINT64_C(0) << (lo % BPQW);
+  const uint64_t tail = ~UINT64_C(0) >> (BPQW - 1 - hi % BPQW);
+  if (lo_word == hi_word)
+    return (int)POPCOUNT(setop_word(op, a[lo_word], b[lo_word]) & head &
+                         tail);
+  int count = (int)POPCOUNT(setop_word(op, a[lo_word], b[lo_word]) & head) +
+              (int)POPCOUNT(setop_word(op, a[hi_word], b[hi_word]) & tail);
+  if (hi_word > lo_word + 1) {
+    if (t == NULL)
+      return count + kernels->count_qwords(a + lo_word + 1,
+                                           hi_word - lo_word - 1);
+    struct T x = summary_view(a, lo_word + 1, hi_word),
+             y = summary_view(b, lo_word + 1, hi_word);
+    count += kernels->setop_count[op](&x, &y);
+  }
+  return count;
+}
+
+int Bit_count_range(T set, int lo, int hi) {
+  assert(set);
+  assert(0 <= lo && lo <= hi && hi < (int)set->length);
+  BIT_PROFILE_CALL((uint64_t)(hi / BPQW - lo / BPQW + 1) * sizeof(uint64_t));
+  if (set->rank_valid) // two O(1) rank lookups
+    return Bit_rank(set, hi + 1) - Bit_rank(set, lo);
+  return setop_count_range(BIT_OP_AND, set, NULL, lo, hi);
+}
+int Bit_count_not(T set) {
+  assert(set);
+  return (int)set->length - Bit_count(set);
+}
+int Bit_count_not_range(T set, int lo, int hi) {
+  return hi - lo + 1 - Bit_count_range(set, lo, hi);
+}
+
+int Bit_diff_count_range(T s, T t, int lo, int hi) {
+  assert(s && t);
+  BIT_PROFILE_CALL(2 * (uint64_t)(hi / BPQW - lo / BPQW + 1) *
+                   sizeof(uint64_t));
+  return setop_count_range(BIT_OP_XOR, s, t, lo, hi);
+}
+int Bit_minus_count_range(T s, T t, int lo, int hi) {
+  assert(s && t);
+  BIT_PROFILE_CALL(2 * (uint64_t)(hi / BPQW - lo / BPQW + 1) *
+                   sizeof(uint64_t));
+  return setop_count_range(BIT_OP_AND_NOT, s, t, lo, hi);
+}
+int Bit_inter_count_range(T s, T t, int lo, int hi) {
+  assert(s && t);
+  BIT_PROFILE_CALL(2 * (uint64_t)(hi / BPQW - lo / BPQW + 1) *
+                   sizeof(uint64_t));
+  return setop_count_range(BIT_OP_AND, s, t, lo, hi);
+}
+int Bit_union_count_range(T s, T t, int lo, int hi) {
+  assert(s && t);
+  BIT_PROFILE_CALL(2 * (uint64_t)(hi / BPQW - lo / BPQW + 1) *
+                   sizeof(uint64_t));
+  return setop_count_range(BIT_OP_OR, s, t, lo, hi);
+}
+
+/* --- 10g. Bitset pools --- */
+
+Bit_pool_T Bit_pool_new(int length, int per_slab) {
+  assert(length > 0 && length < INT_MAX);
+  assert(per_slab > 0);
+  Bit_pool_T pool = calloc(1, sizeof(*pool));
+  assert(pool != NULL);
+  pool->length = length;
+  pool->size_in_qwords = nqwords(length);
+  pool->per_slab = per_slab;
+  return pool;
+}
+
+T Bit_pool_get(Bit_pool_T pool) {
+  assert(pool);
+  if (pool->nfree == 0)
+    pool_grow(pool);
+  T set = pool->free_list[--pool->nfree];
+  memset(set->qwords, 0, set->size_in_qwords * sizeof(uint64_t));
+  RANK_INVALIDATE(set);
+  return set;
+}
+
+void Bit_pool_free(Bit_pool_T *pool) {
+  assert(pool && *pool);
+  Bit_pool_T p = *pool;
+  size_t stride = BIT_HEADER_SIZE + p->size_in_qwords * sizeof(uint64_t);
+  for (unsigned int k = 0; k < p->nslabs; k++) {
+    for (unsigned int i = 0; i < p->per_slab; i++) {
+      T set = (T)((unsigned char *)p->slabs[k] + i * stride);
+      free(set->rank);
+      free(set->summary);
+    }
+    portable_aligned_free(p->slabs[k]);
+  }
+  bit_mem_charge(BIT_MEM_BITSETS, -(int64_t)(stride * p->per_slab * p->nslabs));
+  free(p->slabs);
+  free(p->free_list);
+  free(p);
+  *pool = NULL;
+}
+
+/* --- 10h. Sharded construction --- */
+
+Bit_shards_T Bit_shards_new(int length, int nshards) {
+  assert(length > 0 && length < INT_MAX);
+  assert(nshards > 0);
+  Bit_shards_T shards = calloc(1, sizeof(*shards));
+  assert(shards != NULL);
+  shards->nshards = nshards;
+  shards->shards = malloc((size_t)nshards * sizeof(T));
+  assert(shards->shards != NULL);
+  for (int s = 0; s < nshards; s++)
+    shards->shards[s] = Bit_new(length);
+  return shards;
+}
+
+T Bit_shards_get(Bit_shards_T shards, int shard) {
+  assert(shards);
+  assert(shard >= 0 && shard < shards->nshards);
+  return shards->shards[shard];
+}
+
+void Bit_shards_merge(Bit_shards_T shards, T set) {
+  assert(shards && set);
+  assert(set->length == shards->shards[0]->length);
+  const size_t nq = set->size_in_qwords;
+  const long long nchunks =
+      (long long)((nq + BIT_SHARDS_CHUNK - 1) / BIT_SHARDS_CHUNK);
+  BIT_PROFILE_CALL((uint64_t)(shards->nshards + 1) * nq * sizeof(uint64_t));
+#pragma omp parallel for schedule(static) if (nchunks > 4)
+  for (long long chunk = 0; chunk < nchunks; chunk++) {
+    const size_t lo = (size_t)chunk * BIT_SHARDS_CHUNK;
+    const size_t w = nq - lo < BIT_SHARDS_CHUNK ? nq - lo : BIT_SHARDS_CHUNK;
+    uint64_t *dst = set->qwords + lo;
+    for (int s = 0; s < shards->nshards; s++) {
+      uint64_t *src = shards->shards[s]->qwords + lo;
+      OMP_CPU_SIMD
+      for (size_t q = 0; q < w; q++) {
+        dst[q] |= src[q];
+        src[q] = 0; // the shard starts the next round empty
+      }
+    }
+  }
+  for (int s = 0; s < shards->nshards; s++) {
+    RANK_INVALIDATE(shards->shards[s]);
+    SUMMARY_INVALIDATE(shards->shards[s]);
+  }
+  RANK_INVALIDATE(set);
+  SUMMARY_INVALIDATE(set);
+}
+
+void Bit_shards_free(Bit_shards_T *shards) {
+  assert(shards && *shards);
+  for (int s = 0; s < (*shards)->nshards; s++)
+    Bit_free(&(*shards)->shards[s]);
+  free((*shards)->shards);
+  free(*shards);
+  *shards = NULL;
+}
+
+/* --- End Section 10: PUBLIC API — SINGLE BITSET --- */
+
+/* ===========================================================================
+   SECTION 11: PUBLIC API — BITSET DATABASE (Bit_DB_T)
+   ===========================================================================
+ */
+
+/* --- 11a. Lifecycle: create, destroy, load --- */
+
+T_DB BitDB_new(int length, int num_of_bitsets) {
+  return BitDB_new_padded(length, num_of_bitsets, 0);
+}
+
+T_DB BitDB_new_padded(int length, int num_of_bitsets, int row_align) {
+  assert(length > 0);
+  assert(num_of_bitsets > 0);
+  assert(num_of_bitsets < INT_MAX); // limit to 2^30 bitsets
+  assert(length < INT_MAX);         // limit to 2^30 bits
+  assert(row_align >= 0 && (row_align & (row_align - 1)) == 0);
+  assert(row_align <= 4096);
+
+  T_DB set = malloc(sizeof(*set));
+  set->length = length;
+  set->nelem = num_of_bitsets;
+
+  set->size_in_qwords = nqwords(length);
+  set->size_in_bytes = set->size_in_qwords * BPQW / BPB;
+  unsigned int align_qwords =
+      row_align > (int)(BPQW / BPB) ? (unsigned int)row_align / (BPQW / BPB)
+                                    : 1;
+  set->stride_in_qwords =
+      (set->size_in_qwords + align_qwords - 1) / align_qwords * align_qwords;
+  set->stride_in_bytes = set->stride_in_qwords * BPQW / BPB;
+
+  size_t size_in_bytes = (size_t)set->stride_in_bytes * num_of_bitsets;
+
+  // Allocate aligned memory for the bitsets in the database
+  set->qwords = portable_aligned_calloc(ALIGNMENT, size_in_bytes);
+  assert(set->qwords != NULL);
+
+  set->bytes = (unsigned char *)set->qwords;
+  set->is_Bit_T_allocated = true; // allocated by the library
+  set->row_counts = NULL;
+  set->row_summaries = NULL;
+  set->postings = NULL;
+  set->row_hashes = NULL;
+  set->row_ids = NULL;
+  set->capacity = num_of_bitsets;
+  set->is_mmapped = false;
+  set->mapping = NULL;
+  set->mapping_bytes = 0;
+  set->is_readonly = false;
+  set->numa_policy = BIT_NUMA_LOCAL;
+  set->is_pinned = false;
+  set->is_huge = false;
+  set->changes = NULL;
+  set->row_seqs = NULL;
+  set->dirty_rows = NULL;
+  set->device_id = -1;
+  set->device_nelem = 0;
+  set->stamp = db_new_stamp();
+  set->cow = NULL;
+  set->charged_bytes = 0;
+  db_charge(set);
+  return set;
+}
+
+T_DB BitDB_new_numa(int length, int num_of_bitsets, int row_align,
+                    Bit_numa_policy policy, SETOP_COUNT_OPTS opts) {
+  assert(policy >= BIT_NUMA_LOCAL && policy <= BIT_NUMA_INTERLEAVE);
+  assert(num_of_bitsets > 0);
+#if BIT_DB_MREMAP
+  if (policy != BIT_NUMA_LOCAL) {
+    // geometry and checks of a padded container, rows moved to a mapping
+    T_DB set = BitDB_new_padded(length, 1, row_align);
+    db_storage_free(set);
+    set->nelem = num_of_bitsets;
+    set->capacity = num_of_bitsets;
+    size_t bytes = db_mapped_bytes(set, set->capacity);
+    void *rows = mmap(NULL, bytes, PROT_READ | PROT_WRITE,
+                      MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    assert(rows != MAP_FAILED);
+    set->qwords = rows;
+    set->bytes = (unsigned char *)rows;
+    set->is_mmapped = true;
+    set->numa_policy = policy;
+    db_charge(set);
+    if (policy == BIT_NUMA_INTERLEAVE)
+      db_numa_interleave(rows, bytes);
+    else
+      db_numa_first_touch(set, opts);
+    return set;
+  }
+#endif
+  (void)opts;
+  return BitDB_new_padded(length, num_of_bitsets, row_align);
+}
+
+T_DB BitDB_new_pinned(int length, int num_of_bitsets, int row_align) {
+  assert(num_of_bitsets > 0);
+  // geometry and checks of a padded container, rows moved to pinned storage
+  T_DB set = BitDB_new_padded(length, 1, row_align);
+  db_storage_free(set);
+  set->nelem = num_of_bitsets;
+  set->capacity = num_of_bitsets;
+  set->qwords = pinned_calloc((size_t)set->stride_in_bytes * num_of_bitsets);
+  assert(set->qwords != NULL);
+  set->bytes = (unsigned char *)set->qwords;
+  set->is_pinned = true;
+  db_charge(set);
+  return set;
+}
+
+T_DB BitDB_new_huge(int length, int num_of_bitsets, int row_align,
+                    Bit_page_policy pages) {
+  assert(pages >= BIT_PAGES_DEFAULT && pages <= BIT_PAGES_HUGETLB_1G);
+  assert(num_of_bitsets > 0);
+  // geometry and checks of a padded container, rows moved to huge pages
+  T_DB set = BitDB_new_padded(length, 1, row_align);
+  db_storage_free(set);
+  set->nelem = num_of_bitsets;
+  set->capacity = num_of_bitsets;
+  set->qwords =
+      huge_calloc((size_t)set->stride_in_bytes * num_of_bitsets, pages);
+  assert(set->qwords != NULL);
+  set->bytes = (unsigned char *)set->qwords;
+  set->is_huge = true;
+  db_charge(set);
+  return set;
+}
+
+void *Bit_huge_alloc(size_t nbytes, Bit_page_policy pages) {
+  assert(nbytes > 0);
+  assert(pages >= BIT_PAGES_DEFAULT && pages <= BIT_PAGES_HUGETLB_1G);
+  void *ptr = huge_calloc(nbytes, pages);
+  assert(ptr != NULL);
+  bit_mem_charge(BIT_MEM_RESULTS, (int64_t)huge_block(ptr)->bytes);
+  return ptr;
+}
+
+void Bit_huge_free(void *ptr) {
+  if (ptr)
+    bit_mem_charge(BIT_MEM_RESULTS, -(int64_t)huge_block(ptr)->bytes);
+  huge_free(ptr);
+}
+
+Bit_page_policy Bit_huge_pages(const void *ptr) {
+  assert(ptr != NULL);
+  return huge_pages(ptr);
+}
+
+void *Bit_pinned_alloc(size_t nbytes) {
+  assert(nbytes > 0);
+  void *ptr = pinned_calloc(nbytes);
+  assert(ptr != NULL);
+  bit_mem_charge(BIT_MEM_RESULTS, (int64_t)pinned_block(ptr)->bytes);
+  return ptr;
+}
+
+void Bit_pinned_free(void *ptr) {
+  if (ptr)
+    bit_mem_charge(BIT_MEM_RESULTS, -(int64_t)pinned_block(ptr)->bytes);
+  pinned_free(ptr);
+}
+
+// return a pointer to the original buffer (if externally loaded) or NULL
+// otherwise
+void *BitDB_free(T_DB *set) {
+  assert(set && *set);
+  if ((*set)->dirty_rows)
+    BitDB_device_detach(*set);
+  void *original_location = (void *)(*set)->qwords;
+  bit_mem_charge((*set)->is_Bit_T_allocated ? BIT_MEM_CONTAINERS
+                                            : BIT_MEM_MAPPED,
+                 -(int64_t)(*set)->charged_bytes);
+  // complex deallocation logic to handle aligned allocation and external
+  // buffers
+#if BIT_DB_MMAP_FILES
+  if ((*set)->mapping) {
+    munmap((*set)->mapping, (*set)->mapping_bytes);
+    original_location = NULL;
+  }
+#endif
+  if ((*set)->is_Bit_T_allocated) {
+    db_storage_free(*set);
+    original_location = NULL;
+    (*set)->qwords = NULL;
+    (*set)->bytes = NULL; // set bytes to NULL after freeing qwords
+  }
+  free((*set)->row_counts);
+  free((*set)->row_summaries);
+  postings_free((*set)->postings);
+  hashes_free((*set)->row_hashes);
+  free((*set)->row_ids);
+  changes_free((*set)->changes);
+  free((void *)(*set)->row_seqs);
+#if BIT_DB_COW
+  if ((*set)->cow) {
+    if (!(*set)->is_Bit_T_allocated) // a snapshot closes its generation
+      atomic_fetch_sub(&(*set)->cow->open, 1);
+    db_cow_release((*set)->cow);
+  }
+#endif
+  free(*set);
+  *set = NULL;
+  return original_location;
+}
+
+T_DB BitDB_load(int length, int num_of_bitsets, void *buffer) {
+  assert(length > 0);
+  assert(num_of_bitsets > 0);
+  assert(num_of_bitsets < INT_MAX); // limit to 2^30 bitsets
+  assert(length < INT_MAX);         // limit to 2^30 bits
+  assert(buffer != NULL);
+
+  T_DB set = malloc(sizeof(*set));
+  assert(set != NULL);
+  db_wrap(set, length, num_of_bitsets, buffer); // loaded rows are packed
+  return set;
+}
+
+T_DB BitDB_build_from_csr(int length, int nrows, const size_t row_ptr[],
+                          const int col_idx[], SETOP_COUNT_OPTS opts) {
+  assert(length > 0);
+  assert(nrows > 0);
+  assert(row_ptr != NULL);
+  assert(col_idx != NULL || row_ptr[nrows] == row_ptr[0]);
+  T_DB set = BitDB_new(length, nrows);
+  const int nthreads = cpu_threads(opts);
+  const size_t total = row_ptr[nrows] - row_ptr[0] + (size_t)nrows;
+  _Atomic bool valid = true;
+  BIT_PROFILE_CALL((row_ptr[nrows] - row_ptr[0]) * sizeof(int) +
+                   (size_t)nrows * set->size_in_bytes);
+#pragma omp parallel num_threads(nthreads)
+  {
+    const int t = omp_get_thread_num(), nt = omp_get_num_threads();
+    const size_t lo =
+        csr_split(row_ptr, 0, nrows, total / nt * t + total % nt * t / nt);
+    const size_t hi =
+        t == nt - 1 ? (size_t)nrows
+                    : csr_split(row_ptr, 0, nrows,
+                                total / nt * (t + 1) +
+                                    total % nt * (t + 1) / nt);
+    for (size_t r = lo; r < hi; r++) {
+      assert(row_ptr[r] <= row_ptr[r + 1]);
+      if (!csr_row_fill(set->qwords + r * set->stride_in_qwords,
+                        col_idx + row_ptr[r], row_ptr[r + 1] - row_ptr[r],
+                        length))
+        valid = false;
+    }
+  }
+  if (!valid)
+    BitDB_free(&set);
+  return set;
+}
+
+/* --- 11a'. Persistence: files and shared memory --- */
+
+/* The file header of the rows of set, checksummed */
+static bit_db_file_header db_file_header_of(T_DB set) {
+  size_t nbytes = (size_t)set->nelem * set->stride_in_bytes;
+  bit_db_file_header header = {.magic = BIT_DB_FILE_MAGIC,
+                                .byte_order = BIT_DB_FILE_BYTE_ORDER,
+                                .version = BIT_DB_FILE_VERSION,
+                                .header_size = BIT_DB_FILE_HEADER_SIZE,
+                                .nelem = set->nelem,
+                                .length = set->length,
+                                .stride_in_bytes = set->stride_in_bytes};
+  header.alignment = set->stride_in_bytes & -set->stride_in_bytes;
+  if (header.alignment > BIT_DB_FILE_HEADER_SIZE)
+    header.alignment = BIT_DB_FILE_HEADER_SIZE;
+  header.checksum = db_checksum(set->qwords, nbytes);
+  header.header_checksum =
+      db_checksum(&header, offsetof(bit_db_file_header, header_checksum));
+  return header;
+}
+
+int BitDB_save(T_DB set, const char *path) {
+  assert(set);
+  assert(path != NULL);
+  size_t nbytes = (size_t)set->nelem * set->stride_in_bytes;
+  bit_db_file_header header = db_file_header_of(set);
+  unsigned char page[BIT_DB_FILE_HEADER_SIZE] = {0};
+  memcpy(page, &header, sizeof(header));
+
+  FILE *file = fopen(path, "wb");
+  if (file == NULL)
+    return -1;
+  bool ok = fwrite(page, 1, sizeof(page), file) == sizeof(page) &&
+            fwrite(set->bytes, 1, nbytes, file) == nbytes;
+  ok = fclose(file) == 0 && ok;
+  return ok ? 0 : -1;
+}
+
+T_DB BitDB_open_mmap(const char *path, int flags) {
+  assert(path != NULL);
+#if BIT_DB_MMAP_FILES
+  int fd = open(path, O_RDONLY);
+  if (fd < 0)
+    return NULL;
+  struct stat st;
+  if (fstat(fd, &st) != 0 || (size_t)st.st_size < BIT_DB_FILE_HEADER_SIZE) {
+    close(fd);
+    return NULL;
+  }
+  size_t bytes = (size_t)st.st_size;
+  bool private = flags & BIT_DB_MMAP_PRIVATE; // copy-on-write rows
+  void *mapping = mmap(NULL, bytes, PROT_READ | (private ? PROT_WRITE : 0),
+                       private ? MAP_PRIVATE : MAP_SHARED, fd, 0);
+  close(fd); // the mapping keeps the file referenced
+  if (mapping == MAP_FAILED)
+    return NULL;
+
+  // Trust the fields only once the header checks out
+  const bit_db_file_header *header = mapping;
+  bool valid = db_file_header_valid(header, bytes);
+  unsigned char *rows = (unsigned char *)mapping + header->header_size;
+  if (valid && (flags & BIT_DB_MMAP_VERIFY))
+    valid = header->checksum ==
+            db_checksum(rows, (size_t)header->nelem * header->stride_in_bytes);
+  if (!valid) {
+    munmap(mapping, bytes);
+    return NULL;
+  }
+#ifdef MADV_SEQUENTIAL
+  /* advice values are not flags (MADV_SEQUENTIAL | MADV_WILLNEED is
+     MADV_WILLNEED): one call each. SEQUENTIAL stays on the mapping ("sr" in
+     its smaps VmFlags), WILLNEED starts the read-ahead now */
+  if (flags & BIT_DB_MMAP_SEQUENTIAL) {
+    madvise(mapping, bytes, MADV_SEQUENTIAL);
+    madvise(mapping, bytes, MADV_WILLNEED);
+  }
+#endif
+#ifdef MADV_HUGEPAGE
+  if (flags & BIT_DB_MMAP_HUGE)
+    madvise(mapping, bytes, MADV_HUGEPAGE);
+#endif
+
+  T_DB set = malloc(sizeof(*set));
+  assert(set != NULL);
+  db_wrap(set, header->length, header->nelem, rows); // rows belong to the file
+  set->stride_in_bytes = header->stride_in_bytes;
+  set->stride_in_qwords = set->stride_in_bytes / sizeof(uint64_t);
+  set->mapping = mapping;
+  set->mapping_bytes = bytes;
+  db_charge(set);
+  set->is_readonly = !private;
+  return set;
+#else
+  (void)flags;
+  return NULL;
+#endif
+}
+
+/* Shared memory containers: a POSIX shared memory object laid out as a
+   saved file, whose header page also holds the generation of the rows
+   (see bit_db_shared_state). The generation works as a sequence lock:
+   odd while the creator writes the rows, even once it publishes them. */
+
+#if BIT_DB_MMAP_FILES
+static uint64_t *shared_generation(T_DB set) {
+  return (uint64_t *)((unsigned char *)set->mapping +
+                      BIT_DB_SHARED_STATE_OFFSET +
+                      offsetof(bit_db_shared_state, generation));
+}
+#endif
+
+T_DB BitDB_create_shared(const char *name, int length, int num_of_bitsets,
+                         int flags) {
+  assert(name != NULL);
+  assert(length > 0 && length < INT_MAX);
+  assert(num_of_bitsets > 0 && num_of_bitsets < INT_MAX);
+#if BIT_DB_MMAP_FILES
+  const size_t stride = (size_t)nqwords(length) * sizeof(uint64_t);
+  const size_t bytes =
+      BIT_DB_FILE_HEADER_SIZE + (size_t)num_of_bitsets * stride;
+  int fd = shm_open(name, O_RDWR | O_CREAT | O_EXCL, 0600);
+  if (fd < 0)
+    return NULL;
+  void *mapping = MAP_FAILED;
+  if (ftruncate(fd, (off_t)bytes) == 0) // the new object reads as zeros
+    mapping = mmap(NULL, bytes, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  close(fd);
+  if (mapping == MAP_FAILED) {
+    shm_unlink(name);
+    return NULL;
+  }
+#ifdef MADV_HUGEPAGE
+  if (flags & BIT_DB_SHARED_HUGE)
+    madvise(mapping, bytes, MADV_HUGEPAGE);
+#endif
+
+  T_DB set = malloc(sizeof(*set));
+  assert(set != NULL);
+  db_wrap(set, (unsigned int)length, (unsigned int)num_of_bitsets,
+          (unsigned char *)mapping + BIT_DB_FILE_HEADER_SIZE);
+  set->mapping = mapping;
+  set->mapping_bytes = bytes;
+  db_charge(set);
+  // the creator writes the first generation until it publishes it
+  bit_db_file_header header = db_file_header_of(set);
+  memcpy(mapping, &header, sizeof(header));
+  __atomic_store_n(shared_generation(set), 1, __ATOMIC_RELEASE);
+  return set;
+#else
+  (void)flags;
+  return NULL;
+#endif
+}
+
+T_DB BitDB_attach_shared(const char *name) {
+  assert(name != NULL);
+#if BIT_DB_MMAP_FILES
+  int fd = shm_open(name, O_RDONLY, 0);
+  if (fd < 0)
+    return NULL;
+  struct stat st;
+  if (fstat(fd, &st) != 0 || (size_t)st.st_size < BIT_DB_FILE_HEADER_SIZE) {
+    close(fd);
+    return NULL;
+  }
+  size_t bytes = (size_t)st.st_size;
+  void *mapping = mmap(NULL, bytes, PROT_READ, MAP_SHARED, fd, 0);
+  close(fd);
+  if (mapping == MAP_FAILED)
+    return NULL;
+  const bit_db_file_header *header = mapping;
+  const bit_db_shared_state *state =
+      (const void *)((unsigned char *)mapping + BIT_DB_SHARED_STATE_OFFSET);
+  // rows that were never published are not attached to
+  if (!db_file_header_valid(header, bytes) ||
+      __atomic_load_n(&state->generation, __ATOMIC_ACQUIRE) < 2) {
+    munmap(mapping, bytes);
+    return NULL;
+  }
+
+  T_DB set = malloc(sizeof(*set));
+  assert(set != NULL);
+  db_wrap(set, header->length, header->nelem,
+          (unsigned char *)mapping + header->header_size);
+  set->stride_in_bytes = header->stride_in_bytes;
+  set->stride_in_qwords = set->stride_in_bytes / sizeof(uint64_t);
+  set->mapping = mapping;
+  set->mapping_bytes = bytes;
+  db_charge(set);
+  set->is_readonly = true;
+  return set;
+#else
+  return NULL;
+#endif
+}
+
+uint64_t BitDB_shared_generation(T_DB set) {
+  assert(set);
+#if BIT_DB_MMAP_FILES
+  if (set->mapping == NULL)
+    return 0;
+  // the rows read before this call precede the load (sequence lock read)
+  __atomic_thread_fence(__ATOMIC_ACQUIRE);
+  return __atomic_load_n(shared_generation(set), __ATOMIC_ACQUIRE);
+#else
+  return 0;
+#endif
+}
+
+void BitDB_shared_begin_write(T_DB set) {
+  assert(set);
+#if BIT_DB_MMAP_FILES
+  assert(set->mapping != NULL && !set->is_readonly);
+  uint64_t *generation = shared_generation(set);
+  uint64_t g = __atomic_load_n(generation, __ATOMIC_RELAXED);
+  assert(g % 2 == 0); // not already being written
+  __atomic_store_n(generation, g + 1, __ATOMIC_RELAXED);
+  // readers see the odd generation before any of the writes that follow
+  __atomic_thread_fence(__ATOMIC_RELEASE);
+#endif
+}
+
+uint64_t BitDB_shared_publish(T_DB set) {
+  assert(set);
+#if BIT_DB_MMAP_FILES
+  assert(set->mapping != NULL && !set->is_readonly);
+  uint64_t *generation = shared_generation(set);
+  uint64_t g = __atomic_load_n(generation, __ATOMIC_RELAXED);
+  assert(g % 2 == 1); // BitDB_shared_begin_write, or just created
+  bit_db_file_header header = db_file_header_of(set);
+  memcpy(set->mapping, &header, sizeof(header));
+  __atomic_store_n(generation, g + 1, __ATOMIC_RELEASE);
+  return g + 1;
+#else
+  return 0;
+#endif
+}
+
+int BitDB_unlink_shared(const char *name) {
+  assert(name != NULL);
+#if BIT_DB_MMAP_FILES
+  return shm_unlink(name);
+#else
+  return -1;
+#endif
+}
+
+/* --- 11a''. Text fingerprint formats --- */
+
+T_DB BitDB_load_text(const char *path, Bit_text_format format, int length,
+                     SETOP_COUNT_OPTS opts) {
+  assert(path != NULL);
+  assert(format == BIT_TEXT_HEX || format == BIT_TEXT_INDICES);
+  assert(length >= 0);
+  size_t size = 0;
+  char *text = NULL;
+#if BIT_DB_MMAP_FILES
+  int fd = open(path, O_RDONLY);
+  if (fd < 0)
+    return NULL;
+  struct stat st;
+  if (fstat(fd, &st) != 0 || st.st_size == 0) {
+    close(fd);
+    return NULL;
+  }
+  size = (size_t)st.st_size;
+  text = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+  close(fd);
+  if (text == MAP_FAILED)
+    return NULL;
+#ifdef MADV_SEQUENTIAL
+  madvise(text, size, MADV_SEQUENTIAL); // values, not flags: one call each
+  madvise(text, size, MADV_WILLNEED);
+#endif
+#else
+  FILE *file = fopen(path, "rb");
+  if (file == NULL)
+    return NULL;
+  if (fseek(file, 0, SEEK_END) == 0 && ftell(file) > 0) {
+    size = (size_t)ftell(file);
+    text = malloc(size);
+    rewind(file);
+    if (text && fread(text, 1, size, file) != size) {
+      free(text);
+      text = NULL;
+    }
+  }
+  fclose(file);
+  if (text == NULL)
+    return NULL;
+#endif
+
+  // a hex length comes from the first record when not given
+  size_t nbytes = ((size_t)length + BPB - 1) / BPB;
+  if (format == BIT_TEXT_HEX && length == 0) {
+    for (size_t at = 0; at < size && length == 0;) {
+      const char *line = text + at, *end = memchr(line, '\n', size - at);
+      end = end ? end : text + size;
+      at = (size_t)(end - text) + 1;
+      const char *record = text_record(line, end);
+      if (record) {
+        size_t digits = text_hex_digits(record, end);
+        length = digits % 2 || digits / 2 * BPB >= INT_MAX
+                     ? -1
+                     : (int)(digits / 2 * BPB);
+        nbytes = digits / 2;
+      }
+    }
+  }
+
+  // chunks of whole lines, a few per thread to even out line lengths
+  const int threads = cpu_threads(opts);
+  size_t nchunks = (size_t)threads * 4;
+  if (nchunks > size / 4096 + 1)
+    nchunks = size / 4096 + 1;
+  size_t *bounds = malloc((nchunks + 1) * sizeof(size_t));
+  long long *records = malloc(nchunks * sizeof(long long));
+  assert(bounds && records);
+  for (size_t c = 0; c <= nchunks; c++)
+    bounds[c] = text_line_start(text, size, size / nchunks * c);
+  bounds[nchunks] = size;
+
+  const long long limit = length > 0 ? length : INT_MAX - 1;
+  long long largest = -1;
+  bool valid = length >= 0;
+  if (valid) {
+#pragma omp parallel for num_threads(threads) schedule(dynamic, 1) \
+    reduction(max : largest) reduction(&& : valid)
+    for (size_t c = 0; c < nchunks; c++) {
+      records[c] = text_chunk(text, bounds[c], bounds[c + 1], format, nbytes,
+                              limit, NULL, 0, &largest);
+      valid = valid && records[c] >= 0;
+    }
+  }
+  size_t nrows = 0;
+  for (size_t c = 0; valid && c < nchunks; c++) {
+    const size_t n = (size_t)records[c];
+    records[c] = (long long)nrows; // first row of the chunk
+    nrows += n;
+  }
+  if (format == BIT_TEXT_INDICES && length == 0)
+    length = largest >= 0 ? (int)largest + 1 : 0;
+
+  T_DB set = NULL;
+  if (valid && nrows > 0 && nrows < INT_MAX && length > 0) {
+    set = BitDB_new(length, (int)nrows);
+#pragma omp parallel for num_threads(threads) schedule(dynamic, 1) \
+    reduction(&& : valid)
+    for (size_t c = 0; c < nchunks; c++) {
+      long long top = -1;
+      valid = valid && text_chunk(text, bounds[c], bounds[c + 1], format,
+                                  nbytes, limit, set, (size_t)records[c],
+                                  &top) >= 0;
+    }
+    // hex digits past the length are not bits of the rows
+    if (valid && format == BIT_TEXT_HEX && length % BPQW)
+      for (size_t i = 0; i < nrows; i++)
+        set->qwords[i * set->stride_in_qwords + set->size_in_qwords - 1] &=
+            (UINT64_C(1) << (length % BPQW)) - 1;
+    if (!valid)
+      BitDB_free(&set);
+  }
+  free(bounds);
+  free(records);
+#if BIT_DB_MMAP_FILES
+  munmap(text, size);
+#else
+  free(text);
+#endif
+  return set;
+}
+
+/* --- 11a'''. Streaming writes and compressed files --- */
+
+Bit_writer_T BitDB_writer_open(const char *path, int length, int flags) {
+  assert(path != NULL);
+  assert(length > 0 && length < INT_MAX);
+#if BIT_DB_MMAP_FILES
+  int fd = -1;
+  bool direct = false;
+#ifdef O_DIRECT
+  if (flags & BIT_DB_WRITER_DIRECT) {
+    fd = open(path, O_WRONLY | O_CREAT | O_TRUNC | O_DIRECT, 0644);
+    direct = fd >= 0; // file systems without O_DIRECT get buffered writes
+  }
+#endif
+  if (fd < 0)
+    fd = open(path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+  if (fd < 0)
+    return NULL;
+  Bit_writer_T writer = calloc(1, sizeof(*writer));
+  assert(writer != NULL);
+  writer->fd = fd;
+  writer->length = (unsigned int)length;
+  writer->row_bytes = (unsigned int)Bit_buffer_size(length);
+  writer->capacity = BIT_DB_WRITER_BUFFER;
+  writer->buffer = portable_aligned_calloc(BIT_DB_FILE_HEADER_SIZE,
+                                           writer->capacity);
+  assert(writer->buffer != NULL);
+  writer->checksum = db_checksum(NULL, 0);
+  writer->direct = direct;
+  return writer;
+#else
+  (void)flags;
+  return NULL;
+#endif
+}
+
+int BitDB_writer_put(Bit_writer_T writer, T set) {
+  assert(writer && set);
+  assert(set->length == writer->length);
+  return BitDB_writer_put_many(writer, 1, set->bytes);
+}
+
+int BitDB_writer_put_many(Bit_writer_T writer, int n, const void *buffer) {
+  assert(writer);
+  assert(n >= 0);
+  assert(buffer != NULL || n == 0);
+#if BIT_DB_MMAP_FILES
+  if (writer->nelem + (uint64_t)n >= INT_MAX) {
+    errno = EFBIG; // past the rows a Bit_DB file may hold
+    writer->failed = true;
+  }
+  if (writer->failed)
+    return -1;
+  writer_stage(writer, buffer, (size_t)n * writer->row_bytes);
+  writer->nelem += (uint64_t)n;
+  return writer->failed ? -1 : 0;
+#else
+  return -1;
+#endif
+}
+
+int BitDB_writer_close(Bit_writer_T *writer) {
+  assert(writer && *writer);
+  Bit_writer_T w = *writer;
+  bool ok = false;
+#if BIT_DB_MMAP_FILES
+  writer_flush(w, true);
+  bit_db_file_header header = {.magic = BIT_DB_FILE_MAGIC,
+                                .byte_order = BIT_DB_FILE_BYTE_ORDER,
+                                .version = BIT_DB_FILE_VERSION,
+                                .header_size = BIT_DB_FILE_HEADER_SIZE,
+                                .nelem = w->nelem,
+                                .length = w->length,
+                                .stride_in_bytes = w->row_bytes,
+                                .checksum = w->checksum};
+  header.alignment = w->row_bytes & -w->row_bytes;
+  if (header.alignment > BIT_DB_FILE_HEADER_SIZE)
+    header.alignment = BIT_DB_FILE_HEADER_SIZE;
+  header.header_checksum =
+      db_checksum(&header, offsetof(bit_db_file_header, header_checksum));
+  // the header page goes through the aligned buffer too, for O_DIRECT
+  memset(w->buffer, 0, BIT_DB_FILE_HEADER_SIZE);
+  memcpy(w->buffer, &header, sizeof(header));
+  ok = !w->failed &&
+       ftruncate(w->fd, (off_t)(BIT_DB_FILE_HEADER_SIZE + w->written)) == 0 &&
+       writer_pwrite(w->fd, w->buffer, BIT_DB_FILE_HEADER_SIZE, 0);
+  ok = close(w->fd) == 0 && ok;
+#endif
+  portable_aligned_free(w->buffer);
+  free(w);
+  *writer = NULL;
+  return ok ? 0 : -1;
+}
+
+int BitDB_save_compressed(T_DB set, const char *path, int block_rows,
+                          SETOP_COUNT_OPTS opts) {
+  assert(set);
+  assert(path != NULL);
+  assert(block_rows > 0);
+  const size_t row_qwords = set->size_in_qwords;
+  const size_t block_bytes = (size_t)block_rows * set->size_in_bytes;
+  assert(block_bytes <= UINT32_MAX / 2); // the index holds 32-bit sizes
+  const long long nblocks =
+      (long long)((set->nelem + (size_t)block_rows - 1) / block_rows);
+  bit_db_zblock *index =
+      calloc(nblocks ? (size_t)nblocks : 1, sizeof(bit_db_zblock));
+  assert(index != NULL);
+  FILE *file = fopen(path, "wb");
+  if (file == NULL) {
+    free(index);
+    return -1;
+  }
+  unsigned char page[BIT_DB_FILE_HEADER_SIZE] = {0};
+  bool ok = fwrite(page, 1, sizeof(page), file) == sizeof(page);
+  uint64_t offset = BIT_DB_FILE_HEADER_SIZE;
+
+  // blocks are compressed in parallel and written in order
+#pragma omp parallel num_threads(cpu_threads(opts)) if (nblocks > 1)
+  {
+    uint64_t *rows = portable_aligned_calloc(ALIGNMENT, block_bytes);
+    unsigned char *out = malloc(block_bytes / sizeof(uint64_t) * 9);
+    assert(rows && out);
+#pragma omp for ordered schedule(static, 1)
+    for (long long b = 0; b < nblocks; b++) {
+      const size_t first = (size_t)b * block_rows;
+      const size_t nrows = set->nelem - first < (size_t)block_rows
+                               ? set->nelem - first
+                               : (size_t)block_rows;
+      for (size_t r = 0; r < nrows; r++) // packed, whatever the stride
+        memcpy(rows + r * row_qwords,
+               set->qwords + (first + r) * set->stride_in_qwords,
+               set->size_in_bytes);
+      const size_t nq = nrows * row_qwords;
+      const size_t bytes = zblock_encode(rows, nq, out);
+      const bool raw = bytes >= nq * sizeof(uint64_t);
+      bit_db_zblock *block = &index[b];
+      block->codec = raw ? BIT_DB_ZBLOCK_RAW : BIT_DB_ZBLOCK_BYTES;
+      block->bytes = (uint32_t)(raw ? nq * sizeof(uint64_t) : bytes);
+      block->checksum = db_checksum(rows, nq * sizeof(uint64_t));
+#pragma omp ordered
+      {
+        block->offset = offset;
+        offset += block->bytes;
+        ok = ok && fwrite(raw ? (void *)rows : (void *)out, 1, block->bytes,
+                          file) == block->bytes;
+      }
+    }
+    portable_aligned_free(rows);
+    free(out);
+  }
+
+  bit_db_zfile_header header = {.magic = BIT_DB_ZFILE_MAGIC,
+                                 .byte_order = BIT_DB_FILE_BYTE_ORDER,
+                                 .version = BIT_DB_ZFILE_VERSION,
+                                 .nelem = set->nelem,
+                                 .length = set->length,
+                                 .block_rows = (uint32_t)block_rows,
+                                 .nblocks = (uint64_t)nblocks,
+                                 .index_offset = offset};
+  header.header_checksum =
+      db_checksum(&header, offsetof(bit_db_zfile_header, header_checksum));
+  memcpy(page, &header, sizeof(header));
+  ok = ok &&
+       fwrite(index, sizeof(bit_db_zblock), (size_t)nblocks, file) ==
+           (size_t)nblocks &&
+       fseek(file, 0, SEEK_SET) == 0 &&
+       fwrite(page, 1, sizeof(page), file) == sizeof(page);
+  ok = fclose(file) == 0 && ok;
+  free(index);
+  return ok ? 0 : -1;
+}
+
+Bit_zreader_T BitDB_zreader_open(const char *path, SETOP_COUNT_OPTS opts) {
+  assert(path != NULL);
+#if BIT_DB_MMAP_FILES
+  int fd = open(path, O_RDONLY);
+  if (fd < 0)
+    return NULL;
+  // Trust the fields only once the header checks out
+  struct stat st;
+  bit_db_zfile_header header;
+  bool valid =
+      fstat(fd, &st) == 0 && (size_t)st.st_size >= BIT_DB_FILE_HEADER_SIZE &&
+      zreader_pread(fd, &header, sizeof(header), 0) &&
+      memcmp(header.magic, BIT_DB_ZFILE_MAGIC, sizeof(BIT_DB_ZFILE_MAGIC)) ==
+          0 &&
+      header.byte_order == BIT_DB_FILE_BYTE_ORDER &&
+      header.version == BIT_DB_ZFILE_VERSION &&
+      header.header_checksum ==
+          db_checksum(&header, offsetof(bit_db_zfile_header, header_checksum)) &&
+      header.length > 0 && header.length < INT_MAX &&
+      header.nelem > 0 && header.nelem < INT_MAX && header.block_rows > 0 &&
+      header.nblocks ==
+          (header.nelem + header.block_rows - 1) / header.block_rows &&
+      header.index_offset >= BIT_DB_FILE_HEADER_SIZE &&
+      header.index_offset <= (uint64_t)st.st_size &&
+      ((uint64_t)st.st_size - header.index_offset) / sizeof(bit_db_zblock) >=
+          header.nblocks;
+  bit_db_zblock *index = NULL;
+  if (valid) {
+    index = malloc(header.nblocks ? header.nblocks * sizeof(bit_db_zblock)
+                                  : 1);
+    assert(index != NULL);
+    valid = zreader_pread(fd, index, header.nblocks * sizeof(bit_db_zblock),
+                          (off_t)header.index_offset);
+  }
+  // every block lies between the header and the index
+  size_t largest = 0;
+  for (uint64_t b = 0; valid && b < header.nblocks; b++) {
+    valid = index[b].offset >= BIT_DB_FILE_HEADER_SIZE &&
+            index[b].offset <= header.index_offset &&
+            index[b].bytes <= header.index_offset - index[b].offset;
+    largest = index[b].bytes > largest ? index[b].bytes : largest;
+  }
+  if (!valid) {
+    free(index);
+    close(fd);
+    return NULL;
+  }
+
+  Bit_zreader_T reader = calloc(1, sizeof(*reader));
+  assert(reader != NULL);
+  reader->fd = fd;
+  reader->length = header.length;
+  reader->row_bytes = (unsigned int)(nqwords(header.length) * sizeof(uint64_t));
+  reader->block_rows = header.block_rows;
+  reader->nelem = header.nelem;
+  reader->nblocks = header.nblocks;
+  reader->largest = largest;
+  reader->index = index;
+  reader->threads = cpu_threads(opts);
+  return reader;
+#else
+  (void)opts;
+  return NULL;
+#endif
+}
+
+int BitDB_zreader_length(Bit_zreader_T reader) {
+  assert(reader);
+  return (int)reader->length;
+}
+
+int BitDB_zreader_nelem(Bit_zreader_T reader) {
+  assert(reader);
+  return (int)reader->nelem;
+}
+
+int BitDB_zreader_read(void *reader, void *rows, int max_rows,
+                       int row_bytes) {
+  Bit_zreader_T r = reader;
+  assert(r && rows);
+  assert(max_rows >= 0);
+  assert((unsigned int)row_bytes == r->row_bytes);
+#if BIT_DB_MMAP_FILES
+  const size_t first = r->next_row;
+  const size_t last = r->nelem - first < (size_t)max_rows
+                          ? r->nelem
+                          : first + (size_t)max_rows;
+  if (r->failed || first >= last)
+    return 0;
+  const long long b0 = (long long)(first / r->block_rows);
+  const long long b1 = (long long)((last - 1) / r->block_rows);
+  const size_t block_bytes = (size_t)r->block_rows * r->row_bytes;
+  bool failed = false;
+#pragma omp parallel num_threads(r->threads) if (b1 > b0) reduction(|| : failed)
+  {
+    unsigned char *compressed = malloc(r->largest ? r->largest : 1);
+    void *scratch = NULL; // blocks only partly in the read
+    assert(compressed != NULL);
+#pragma omp for schedule(dynamic, 1)
+    for (long long b = b0; b <= b1; b++) {
+      const size_t start = (size_t)b * r->block_rows;
+      const size_t end = start + r->block_rows < r->nelem
+                             ? start + r->block_rows
+                             : r->nelem;
+      const size_t from = start > first ? start : first;
+      const size_t to = end < last ? end : last;
+      unsigned char *dst =
+          (unsigned char *)rows + (from - first) * r->row_bytes;
+      if (from == start && to == end) {
+        failed = failed || !zreader_block(r, (size_t)b, compressed, dst);
+        continue;
+      }
+      if (scratch == NULL)
+        scratch = portable_aligned_calloc(ALIGNMENT, block_bytes);
+      assert(scratch != NULL);
+      failed = failed || !zreader_block(r, (size_t)b, compressed, scratch);
+      memcpy(dst, (unsigned char *)scratch + (from - start) * r->row_bytes,
+             (to - from) * r->row_bytes);
+    }
+    free(compressed);
+    portable_aligned_free(scratch);
+  }
+  if (failed) {
+    r->failed = true;
+    return 0;
+  }
+  r->next_row = last;
+  return (int)(last - first);
+#else
+  return 0;
+#endif
+}
+
+int BitDB_zreader_close(Bit_zreader_T *reader) {
+  assert(reader && *reader);
+  Bit_zreader_T r = *reader;
+  bool ok = !r->failed;
+#if BIT_DB_MMAP_FILES
+  ok = close(r->fd) == 0 && ok;
+#endif
+  free(r->index);
+  free(r);
+  *reader = NULL;
+  return ok ? 0 : -1;
+}
+
+T_DB BitDB_load_compressed(const char *path, SETOP_COUNT_OPTS opts) {
+  assert(path != NULL);
+  Bit_zreader_T reader = BitDB_zreader_open(path, opts);
+  if (reader == NULL)
+    return NULL;
+  T_DB set = BitDB_new((int)reader->length, (int)reader->nelem);
+  assert(set->stride_in_bytes == reader->row_bytes); // rows come packed
+  bool ok = BitDB_zreader_read(reader, set->qwords, (int)reader->nelem,
+                               (int)reader->row_bytes) == (int)reader->nelem;
+  ok = BitDB_zreader_close(&reader) == 0 && ok;
+  if (!ok)
+    BitDB_free(&set);
+  return set;
+}
+
+Bit_reader_T BitDB_reader_open(const char *path, int flags) {
+  assert(path != NULL);
+#if BIT_DB_MMAP_FILES
+  int fd = open(path, O_RDONLY);
+  if (fd < 0)
+    return NULL;
+  struct stat st;
+  bit_db_file_header header;
+  bool valid = fstat(fd, &st) == 0 &&
+               (size_t)st.st_size >= BIT_DB_FILE_HEADER_SIZE &&
+               zreader_pread(fd, &header, sizeof(header), 0) &&
+               db_file_header_valid(&header, (size_t)st.st_size);
+  if (!valid) {
+    close(fd);
+    return NULL;
+  }
+  bool direct = false;
+#ifdef O_DIRECT
+  if ((flags & BIT_DB_READER_DIRECT) && header.header_size % 4096 == 0) {
+    int direct_fd = open(path, O_RDONLY | O_DIRECT);
+    direct = direct_fd >= 0; // file systems without O_DIRECT read buffered
+    if (direct) {
+      close(fd);
+      fd = direct_fd;
+    }
+  }
+#endif
+
+  Bit_reader_T r = calloc(1, sizeof(*r));
+  assert(r != NULL);
+  r->fd = fd;
+  r->length = header.length;
+  r->row_bytes = (unsigned int)(nqwords(header.length) * sizeof(uint64_t));
+  r->stride = header.stride_in_bytes;
+  r->nelem = header.nelem;
+  r->data_offset = header.header_size;
+  r->data_bytes = header.nelem * header.stride_in_bytes;
+  r->nchunks = (size_t)((r->data_bytes + BIT_DB_READER_CHUNK - 1) /
+                        BIT_DB_READER_CHUNK);
+  r->depth = r->nchunks < BIT_DB_READER_DEPTH ? r->nchunks
+                                              : BIT_DB_READER_DEPTH;
+  r->buffers = portable_aligned_calloc(4096, r->depth * BIT_DB_READER_CHUNK);
+  r->ready = malloc(r->depth * sizeof(int64_t));
+  assert(r->buffers && r->ready);
+  r->direct = direct;
+#if BIT_DB_IO_URING
+  if (!(flags & BIT_DB_READER_PREAD))
+    r->uring = uring_new((unsigned int)r->depth, r->buffers, r->depth);
+#endif
+  for (size_t c = 0; c < r->depth; c++)
+    reader_submit(r, c);
+  return r;
+#else
+  (void)flags;
+  return NULL;
+#endif
+}
+
+int BitDB_reader_length(Bit_reader_T reader) {
+  assert(reader);
+  return (int)reader->length;
+}
+
+int BitDB_reader_nelem(Bit_reader_T reader) {
+  assert(reader);
+  return (int)reader->nelem;
+}
+
+int BitDB_reader_read(void *reader, void *rows, int max_rows, int row_bytes) {
+  Bit_reader_T r = reader;
+  assert(r && rows);
+  assert(max_rows >= 0);
+  assert((unsigned int)row_bytes == r->row_bytes);
+#if BIT_DB_MMAP_FILES
+  const size_t n = r->nelem - r->next_row < (size_t)max_rows
+                       ? r->nelem - r->next_row
+                       : (size_t)max_rows;
+  if (r->failed)
+    return 0;
+  unsigned char *dst = rows;
+  bool ok = true;
+  if (r->stride == r->row_bytes) {
+    ok = reader_take(r, dst, n * r->row_bytes);
+  } else { // rows padded in the file: drop the padding
+    for (size_t i = 0; i < n && ok; i++)
+      ok = reader_take(r, dst + i * r->row_bytes, r->row_bytes) &&
+           reader_take(r, NULL, r->stride - r->row_bytes);
+  }
+  if (!ok) {
+    r->failed = true;
+    return 0;
+  }
+  r->next_row += n;
+  return (int)n;
+#else
+  return 0;
+#endif
+}
+
+int BitDB_reader_close(Bit_reader_T *reader) {
+  assert(reader && *reader);
+  Bit_reader_T r = *reader;
+  bool ok = !r->failed;
+#if BIT_DB_IO_URING
+  if (r->uring) { // the kernel may still be reading into the slots
+    while (r->inflight > 0) {
+      long done = uring_reap(r->uring, r->ready);
+      if (done < 0)
+        break;
+      r->inflight -= (size_t)done;
+    }
+    uring_free(r->uring);
+  }
+#endif
+#if BIT_DB_MMAP_FILES
+  ok = close(r->fd) == 0 && ok;
+#endif
+  portable_aligned_free(r->buffers);
+  free(r->ready);
+  free(r);
+  *reader = NULL;
+  return ok ? 0 : -1;
+}
+
+/* --- 11b. Properties --- */
+
+int BitDB_length(T_DB set) {
+  assert(set);
+  return set->length;
+}
+
+int BitDB_nelem(T_DB set) {
+  assert(set);
+  return set->nelem;
+}
+
+Bit_page_policy BitDB_pages(T_DB set) {
+  assert(set);
+  return set->is_huge ? huge_pages(set->qwords) : BIT_PAGES_DEFAULT;
+}
+
+bool BitDB_is_pinned(T_DB set) {
+  assert(set);
+  return set->is_pinned && pinned_block(set->qwords)->kind != PINNED_NONE;
+}
+
+int BitDB_count_at(T_DB set, int index) {
+  assert(set);
+  assert(index >= 0 && (unsigned int)index < set->nelem);
+  if (set->row_counts)
+    return set->row_counts[index];
+  return db_row_count(set, index);
+}
+
+int *BitDB_count(T_DB set) {
+  assert(set);
+  int *counts = malloc((size_t)set->nelem * sizeof(int));
+  assert(counts != NULL);
+  BitDB_count_store(set, counts, (SETOP_COUNT_OPTS){0});
+  return counts;
+}
+
+void BitDB_count_store(T_DB set, int *counts, SETOP_COUNT_OPTS opts) {
+  assert(set && counts);
+  if (set->row_counts) {
+    memcpy(counts, set->row_counts, (size_t)set->nelem * sizeof(int));
+    return;
+  }
+  int n = (int)set->nelem;
+#pragma omp parallel for num_threads(cpu_threads(opts)) schedule(static)
+  for (int i = 0; i < n; i++)
+    counts[i] = db_row_count(set, i);
+}
+
+void BitDB_cache_counts(T_DB set, bool enable, SETOP_COUNT_OPTS opts) {
+  assert(set);
+  if (!enable) {
+    free(set->row_counts);
+    set->row_counts = NULL;
+  } else if (set->row_counts == NULL) {
+    int *row_counts = malloc((size_t)set->capacity * sizeof(int));
+    assert(row_counts != NULL);
+    BitDB_count_store(set, row_counts, opts);
+    set->row_counts = row_counts;
+  }
+}
+
+void BitDB_cache_summary(T_DB set, bool enable, SETOP_COUNT_OPTS opts) {
+  assert(set);
+  if (!enable) {
+    free(set->row_summaries);
+    set->row_summaries = NULL;
+    return;
+  }
+  const size_t nwords = summary_nwords(set->size_in_qwords);
+  if (set->row_summaries == NULL) {
+    set->row_summaries = malloc(
+        ((size_t)set->capacity ? set->capacity : 1) * nwords *
+        sizeof(uint64_t));
+    assert(set->row_summaries != NULL);
+  }
+  int n = (int)set->nelem;
+#pragma omp parallel for num_threads(cpu_threads(opts)) schedule(static)
+  for (int i = 0; i < n; i++)
+    summary_build(set->row_summaries + (size_t)i * nwords,
+                  set->qwords + (size_t)i * set->stride_in_qwords,
+                  set->size_in_qwords);
+}
+
+void BitDB_cache_postings(T_DB set, bool enable, SETOP_COUNT_OPTS opts) {
+  assert(set);
+  if (!enable) {
+    postings_free(set->postings);
+    set->postings = NULL;
+    return;
+  }
+  if (set->postings == NULL) {
+    set->postings = calloc(1, sizeof(bit_db_postings));
+    assert(set->postings != NULL);
+    set->postings->offsets =
+        malloc(((size_t)set->length + 1) * sizeof(size_t));
+    assert(set->postings->offsets != NULL);
+  }
+  postings_build(set, opts);
+}
+
+void BitDB_hash_rows(T_DB set, uint64_t seed, uint64_t *out,
+                     SETOP_COUNT_OPTS opts) {
+  assert(set && out);
+  bit_db_hashes *cache = set->row_hashes;
+  if (cache != NULL && cache->stamp == set->stamp && cache->seed == seed &&
+      cache->nelem == set->nelem) {
+    memcpy(out, cache->values, (size_t)set->nelem * sizeof(uint64_t));
+    return;
+  }
+  uint64_t (*hash_qwords)(const uint64_t *, size_t, uint64_t) =
+      bit_kernels_active()->hash_qwords;
+  const uint64_t row_seed = hash_seed(seed, set->length);
+  int n = (int)set->nelem;
+#pragma omp parallel for num_threads(cpu_threads(opts)) schedule(static)
+  for (int i = 0; i < n; i++)
+    out[i] = hash_qwords(set->qwords + (size_t)i * set->stride_in_qwords,
+                         set->size_in_qwords, row_seed);
+  if (cache == NULL)
+    return;
+  if (cache->nelem != set->nelem) {
+    free(cache->values);
+    cache->values = malloc(((size_t)n ? (size_t)n : 1) * sizeof(uint64_t));
+    assert(cache->values != NULL);
+    cache->nelem = set->nelem;
+  }
+  memcpy(cache->values, out, (size_t)n * sizeof(uint64_t));
+  cache->seed = seed;
+  cache->stamp = set->stamp;
+}
+
+void BitDB_cache_hashes(T_DB set, bool enable) {
+  assert(set);
+  if (!enable) {
+    hashes_free(set->row_hashes);
+    set->row_hashes = NULL;
+  } else if (set->row_hashes == NULL) {
+    set->row_hashes = calloc(1, sizeof(bit_db_hashes)); // stamp 0: stale
+    assert(set->row_hashes != NULL);
+  }
+}
+
+/* --- 11c. Element access and bulk operations --- */
+
+void BitDB_clear_at(T_DB set, int index) {
+  assert(set);
+  assert(!set->is_readonly);
+  assert(index >= 0 && (unsigned int)index < set->nelem);
+  size_t shift = (size_t)index;
+  shift *= set->stride_in_bytes; // calculate the offset
+  db_seq_write_begin(set, index, 1);
+  db_log_row(set, index, true);
+  memset(set->bytes + shift, 0, set->size_in_bytes);
+  db_log_row(set, index, false);
+  if (set->row_counts)
+    set->row_counts[index] = 0;
+  db_summary_rows(set, index, 1);
+  db_mark_dirty(set, index, 1);
+  db_seq_write_end(set, index, 1);
+}
+
+void BitDB_clear(T_DB set) {
+  assert(set);
+  assert(!set->is_readonly);
+  size_t size_in_bytes = (size_t)set->nelem;
+  size_in_bytes *= set->stride_in_bytes; // calculate the total size
+  db_seq_write_begin(set, 0, set->nelem);
+  for (size_t i = 0; set->changes && i < set->nelem; i++)
+    db_log_row(set, i, true); // every row goes to zero: its delta is itself
+  memset(set->bytes, 0, size_in_bytes);
+  if (set->row_counts)
+    memset(set->row_counts, 0, (size_t)set->nelem * sizeof(int));
+  if (set->row_summaries)
+    memset(set->row_summaries, 0,
+           (size_t)set->nelem * summary_nwords(set->size_in_qwords) *
+               sizeof(uint64_t));
+  db_mark_dirty(set, 0, set->nelem);
+  db_seq_write_end(set, 0, set->nelem);
+}
+
+T BitDB_get_from(T_DB set, int index) {
+  assert(set);
+  assert(index >= 0 && (unsigned int)index < set->nelem);
+  T bitset = Bit_new(set->length);
+  size_t shift = (size_t)index;
+  shift *= set->stride_in_bytes; // calculate the offset
+  // Copy the bytes from the set to the new bitset, again if a writer tore them
+  uint64_t seen;
+  do {
+    seen = db_seq_read_begin(set, index, 1);
+    memcpy(bitset->bytes, set->bytes + shift, set->size_in_bytes);
+  } while (db_seq_read_retry(set, index, 1, seen));
+  return bitset;
+}
+
+void BitDB_view_at(T_DB set, int index, T *out) {
+  assert(set);
+  assert(index >= 0 && (unsigned int)index < set->nelem);
+  assert(out);
+  uint64_t *row = set->qwords + (size_t)index * set->stride_in_qwords;
+  T view = *out;
+  if (view == NULL) {
+    *out = Bit_load(set->length, row);
+    return;
+  }
+  // Only handles over external storage can be re-pointed
+  assert(!view->is_Bit_T_allocated && view->pool == NULL);
+  if (view->length != set->length) {
+    free(view->rank);
+    free(view->summary);
+    bitset_init(view, set->length, row);
+  } else {
+    view->qwords = row;
+    view->bytes = (unsigned char *)row;
+    RANK_INVALIDATE(view);
+    SUMMARY_INVALIDATE(view);
+  }
+}
+
+void BitDB_put_at(T_DB set, int index, T bitset) {
+  assert(set);
+  assert(!set->is_readonly);
+  assert(index >= 0 && (unsigned int)index < set->nelem);
+  assert(bitset);
+  assert(bitset->length == set->length);
+  // Copy the bytes from the bitset to the set
+  size_t shift = (size_t)index;
+  shift *= set->stride_in_bytes; // calculate the offset
+  db_seq_write_begin(set, index, 1);
+  db_log_row(set, index, true);
+  memcpy(set->bytes + shift, bitset->bytes, set->size_in_bytes);
+  db_log_row(set, index, false);
+  if (set->row_counts)
+    set->row_counts[index] = db_row_count(set, index);
+  db_summary_rows(set, index, 1);
+  db_mark_dirty(set, index, 1);
+  db_seq_write_end(set, index, 1);
+}
+
+void BitDB_put_many(T_DB set, int first_index, T rows[], int n) {
+  assert(set);
+  assert(!set->is_readonly);
+  assert(rows != NULL || n == 0);
+  assert(n >= 0 && first_index >= 0 &&
+         (size_t)first_index + (size_t)n <= set->nelem);
+  for (int i = 0; i < n; i++)
+    assert(rows[i] && rows[i]->length == set->length);
+  if (n == 0)
+    return;
+  const size_t bytes = (size_t)n * set->size_in_bytes;
+  const bool stream = bytes > Bit_store_threshold_get();
+  const int nthreads =
+      bytes >= BIT_PUT_PARALLEL_BYTES ? omp_get_max_threads() : 1;
+  db_seq_write_begin(set, first_index, n);
+  for (int i = 0; set->changes && i < n; i++) // the log is not thread safe
+    db_log_row(set, first_index + i, true);
+#pragma omp parallel num_threads(nthreads)
+  {
+#pragma omp for schedule(static) nowait
+    for (int i = 0; i < n; i++) {
+      const size_t index = (size_t)first_index + i;
+      db_copy_row(set->bytes + index * set->stride_in_bytes, rows[i]->bytes,
+                  set->size_in_bytes, stream);
+    }
+    if (stream)
+      STREAM_FENCE();
+#pragma omp barrier
+#pragma omp for schedule(static)
+    for (int i = 0; i < n; i++) {
+      const size_t index = (size_t)first_index + i;
+      if (set->row_counts)
+        set->row_counts[index] = db_row_count(set, (unsigned int)index);
+      db_summary_rows(set, index, 1);
+    }
+  }
+  for (int i = 0; set->changes && i < n; i++)
+    db_log_row(set, first_index + i, false);
+  db_mark_dirty(set, first_index, n);
+  db_seq_write_end(set, first_index, n);
+}
+
+T_DB BitDB_from_bitsets(T rows[], int n) {
+  assert(rows != NULL);
+  assert(n > 0);
+  assert(rows[0] != NULL);
+  T_DB set = BitDB_new(rows[0]->length, n);
+  BitDB_put_many(set, 0, rows, n);
+  return set;
+}
+
+T_DB BitDB_gather(T_DB set, const int rows[], int n, T_DB out,
+                  SETOP_COUNT_OPTS opts) {
+  assert(set);
+  assert(rows != NULL || n == 0);
+  assert(n >= 0);
+  for (int j = 0; j < n; j++)
+    assert(rows[j] >= 0 && (unsigned int)rows[j] < set->nelem);
+  if (out == NULL) {
+    out = BitDB_new(set->length, n);
+  } else {
+    assert(out != set && out->length == set->length);
+    assert(!out->is_readonly && out->changes == NULL &&
+           out->dirty_rows == NULL);
+    if ((size_t)n > out->capacity)
+      db_make_room(out, (size_t)n - out->nelem);
+    out->nelem = (unsigned int)n;
+  }
+  if (n == 0)
+    return out;
+  db_seq_write_begin(out, 0, n);
+  db_gather_rows(out, set, rows, (size_t)n, cpu_threads(opts));
+  if (out->row_ids == NULL) {
+    out->row_ids = malloc(out->capacity * sizeof(int));
+    assert(out->row_ids != NULL);
+  }
+  for (int j = 0; j < n; j++) // the IDs of the rows in set
+    out->row_ids[j] = set->row_ids ? set->row_ids[rows[j]] : rows[j];
+  if (out->row_counts)
+    for (int j = 0; j < n; j++)
+      out->row_counts[j] = set->row_counts ? set->row_counts[rows[j]]
+                                           : db_row_count(out, j);
+  db_summary_rows(out, 0, n);
+  db_mark_dirty(out, 0, n);
+  db_seq_write_end(out, 0, n);
+  return out;
+}
+
+void BitDB_scatter(T_DB set, const int rows[], int n, T_DB from,
+                   SETOP_COUNT_OPTS opts) {
+  assert(set && from);
+  assert(!set->is_readonly);
+  assert(set != from && from->length == set->length);
+  assert(rows != NULL || n == 0);
+  assert(n >= 0 && (unsigned int)n <= from->nelem);
+  uint64_t *seen = calloc(set->nelem / 64 + 1, sizeof(uint64_t));
+  assert(seen != NULL);
+  for (int j = 0; j < n; j++) { // in range, and no row written twice
+    assert(rows[j] >= 0 && (unsigned int)rows[j] < set->nelem);
+    assert(!(seen[rows[j] / 64] >> (rows[j] % 64) & 1));
+    seen[rows[j] / 64] |= UINT64_C(1) << (rows[j] % 64);
+  }
+  free(seen);
+  const bool parallel = (size_t)n * set->size_in_qwords >
+                            BIT_BATCH_PARALLEL_QWORDS &&
+                        !set->changes; // the log is not thread safe
+#pragma omp parallel for num_threads(cpu_threads(opts)) if (parallel)
+  for (int j = 0; j < n; j++) {
+    const size_t row = (size_t)rows[j];
+    db_seq_write_begin(set, row, 1);
+    db_log_row(set, row, true);
+    memcpy(set->qwords + row * set->stride_in_qwords,
+           from->qwords + (size_t)j * from->stride_in_qwords,
+           set->size_in_bytes);
+    db_log_row(set, row, false);
+    if (set->row_counts)
+      set->row_counts[row] = db_row_count(set, (unsigned int)row);
+    db_summary_rows(set, row, 1);
+    db_seq_write_end(set, row, 1);
+  }
+  for (int j = 0; j < n; j++)
+    db_mark_dirty(set, rows[j], 1);
+}
+
+int BitDB_column_partition(T_DB set, int nparts, T_DB parts[],
+                           SETOP_COUNT_OPTS opts) {
+  assert(set && parts);
+  assert(nparts > 0);
+  const size_t nq = set->size_in_qwords;
+  const int nrows = (int)set->nelem;
+  int made = 0;
+  for (int c = 0; c < nparts; c++) {
+    size_t first, len;
+    split_range(nq, nparts, c, &first, &len);
+    if (len == 0)
+      continue;
+    const unsigned int bits = first + len == nq
+                                  ? set->length - (unsigned int)(first * BPQW)
+                                  : (unsigned int)(len * BPQW);
+    T_DB part = BitDB_new((int)bits, nrows);
+#pragma omp parallel for num_threads(cpu_threads(opts)) schedule(static)
+    for (int r = 0; r < nrows; r++)
+      memcpy(part->qwords + (size_t)r * part->stride_in_qwords,
+             set->qwords + (size_t)r * set->stride_in_qwords + first,
+             len * sizeof(uint64_t));
+    parts[made++] = part;
+  }
+  return made;
+}
+
+void BitDB_extract_from(T_DB set, int index, void *buffer) {
+  assert(set);
+  assert(index >= 0 && (unsigned int)index < set->nelem);
+  assert(buffer != NULL);
+  // Copy the bytes from the set to the buffer, again if a writer tore them
+  size_t shift = (size_t)index;
+  shift *= set->stride_in_bytes; // calculate the offset
+  uint64_t seen;
+  do {
+    seen = db_seq_read_begin(set, index, 1);
+    memcpy(buffer, set->bytes + shift, set->size_in_bytes);
+  } while (db_seq_read_retry(set, index, 1, seen));
+}
+
+void BitDB_replace_at(T_DB set, int index, void *buffer) {
+  assert(set);
+  assert(!set->is_readonly);
+  assert(index >= 0 && (unsigned int)index < set->nelem);
+  assert(buffer != NULL);
+  // Copy the bytes from the buffer to the set
+  size_t shift = (size_t)index;
+  shift *= set->stride_in_bytes; // calculate the offset
+  db_seq_write_begin(set, index, 1);
+  db_log_row(set, index, true);
+  memcpy(set->bytes + shift, buffer, set->size_in_bytes);
+  db_log_row(set, index, false);
+  if (set->row_counts)
+    set->row_counts[index] = db_row_count(set, index);
+  db_summary_rows(set, index, 1);
+  db_mark_dirty(set, index, 1);
+  db_seq_write_end(set, index, 1);
+}
+
+/* --- 11c'. Growth: reserve, append and insert rows --- */
+
+int BitDB_capacity(T_DB set) {
+  assert(set);
+  return (int)set->capacity;
+}
+
+void BitDB_reserve(T_DB set, int capacity) {
+  assert(set);
+  assert(capacity >= 0);
+  if ((unsigned int)capacity > set->capacity)
+    db_grow(set, capacity);
+}
+
+/* Makes room for n more rows, growing the capacity geometrically */
+static void db_make_room(T_DB set, size_t n) {
+  size_t needed = (size_t)set->nelem + n;
+  assert(needed < INT_MAX);
+  if (needed <= set->capacity)
+    return;
+  size_t capacity = (size_t)set->capacity + set->capacity / 2 + 1;
+  if (capacity < needed)
+    capacity = needed;
+  if (capacity >= INT_MAX)
+    capacity = INT_MAX - 1;
+  db_grow(set, capacity);
+}
+
+int BitDB_append(T_DB set, T bitset) {
+  assert(set);
+  assert(bitset);
+  assert(bitset->length == set->length);
+  db_make_room(set, 1);
+  int index = (int)set->nelem++;
+  if (set->row_ids)
+    set->row_ids[index] = index; // IDs are a permutation of the rows
+  BitDB_put_at(set, index, bitset);
+  return index;
+}
+
+int BitDB_append_many(T_DB set, int n, void *buffer) {
+  assert(set);
+  assert(n >= 0);
+  db_make_room(set, n);
+  int first = (int)set->nelem;
+  size_t shift = (size_t)first * set->stride_in_bytes;
+  db_seq_write_begin(set, first, n);
+  if (buffer == NULL)
+    memset(set->bytes + shift, 0, (size_t)n * set->stride_in_bytes);
+  else if (set->stride_in_bytes == set->size_in_bytes)
+    memcpy(set->bytes + shift, buffer, (size_t)n * set->size_in_bytes);
+  else
+    for (int i = 0; i < n; i++) // packed rows into padded ones
+      memcpy(set->bytes + shift + (size_t)i * set->stride_in_bytes,
+             (unsigned char *)buffer + (size_t)i * set->size_in_bytes,
+             set->size_in_bytes);
+  set->nelem += n;
+  for (int i = first; set->row_ids && i < first + n; i++)
+    set->row_ids[i] = i;
+  for (int i = first; set->changes && i < first + n; i++)
+    db_log_row(set, i, false);
+  if (set->row_counts)
+    for (int i = first; i < first + n; i++)
+      set->row_counts[i] = buffer ? db_row_count(set, i) : 0;
+  db_summary_rows(set, first, n);
+  db_mark_dirty(set, first, n);
+  db_seq_write_end(set, first, n);
+  return first;
+}
+
+void BitDB_insert_at(T_DB set, int index, T bitset) {
+  assert(set);
+  assert(index >= 0 && (unsigned int)index <= set->nelem);
+  assert(bitset);
+  assert(bitset->length == set->length);
+  db_make_room(set, 1);
+  const size_t moved = set->nelem + 1 - index; // with the row of bitset
+  db_seq_write_begin(set, index, moved);
+  size_t shift = (size_t)index * set->stride_in_bytes;
+  memmove(set->bytes + shift + set->stride_in_bytes, set->bytes + shift,
+          (size_t)(set->nelem - index) * set->stride_in_bytes);
+  if (set->row_counts)
+    memmove(set->row_counts + index + 1, set->row_counts + index,
+            (set->nelem - index) * sizeof(int));
+  if (set->row_ids) { // the new row takes the next ID
+    memmove(set->row_ids + index + 1, set->row_ids + index,
+            (set->nelem - index) * sizeof(int));
+    set->row_ids[index] = (int)set->nelem;
+  }
+  if (set->row_summaries) {
+    const size_t nwords = summary_nwords(set->size_in_qwords);
+    memmove(set->row_summaries + (index + 1) * nwords,
+            set->row_summaries + index * nwords,
+            (set->nelem - index) * nwords * sizeof(uint64_t));
+  }
+  set->nelem++;
+  if (set->changes)
+    set->changes->moved = true;
+  db_mark_dirty(set, index, set->nelem - index); // the rows moved down
+  db_seq_write_end(set, index, moved);
+  BitDB_put_at(set, index, bitset);
+}
+
+/* --- 11c''. Row change log and deltas --- */
+
+void BitDB_track_changes(T_DB set, bool enable) {
+  assert(set);
+  changes_free(set->changes);
+  set->changes = NULL;
+  if (!enable)
+    return;
+  set->changes = calloc(1, sizeof(bit_db_changes));
+  assert(set->changes != NULL);
+  changes_reset(set->changes, set->nelem);
+}
+
+int BitDB_changed_rows(T_DB set) {
+  assert(set);
+  return set->changes ? (int)set->changes->used : 0;
+}
+
+size_t BitDB_export_delta(T_DB set, void **delta) {
+  assert(set);
+  assert(delta != NULL);
+  assert(set->changes != NULL); // BitDB_track_changes
+  bit_db_changes *log = set->changes;
+  *delta = NULL;
+  if (log->moved) { // replicas need the whole container
+    changes_reset(log, set->nelem);
+    return 0;
+  }
+  // rows written back to what they were carry no delta
+  const size_t nq = set->size_in_qwords;
+  size_t nrows = 0;
+  for (size_t k = 0; k < log->used; k++) {
+    nrows += changes_live(log, k, nq);
+  }
+  const size_t index_bytes = (nrows + nrows % 2) * sizeof(uint32_t);
+  const size_t bytes = sizeof(bit_db_delta_header) + index_bytes +
+                       nrows * nq * sizeof(uint64_t);
+  unsigned char *out = calloc(1, bytes);
+  assert(out != NULL);
+  uint32_t *rows = (uint32_t *)(out + sizeof(bit_db_delta_header));
+  uint64_t *deltas = (uint64_t *)((unsigned char *)rows + index_bytes);
+  size_t m = 0;
+  for (size_t k = 0; k < log->used; k++) {
+    if (!changes_live(log, k, nq))
+      continue;
+    rows[m] = log->rows[k];
+    memcpy(deltas + m * nq, log->deltas + k * nq, nq * sizeof(uint64_t));
+    m++;
+  }
+  bit_db_delta_header header = {.magic = BIT_DB_DELTA_MAGIC,
+                                .byte_order = BIT_DB_FILE_BYTE_ORDER,
+                                .length = set->length,
+                                .base_nelem = log->base_nelem,
+                                .nelem = set->nelem,
+                                .nrows = nrows};
+  header.checksum = db_checksum(rows, bytes - sizeof(header));
+  memcpy(out, &header, sizeof(header));
+  changes_reset(log, set->nelem);
+  *delta = out;
+  return bytes;
+}
+
+int BitDB_apply_delta(T_DB set, const void *delta, size_t bytes) {
+  assert(set);
+  assert(!set->is_readonly);
+  assert(delta != NULL);
+  bit_db_delta_header header;
+  if (bytes < sizeof(header))
+    return -1;
+  memcpy(&header, delta, sizeof(header));
+  const size_t nq = set->size_in_qwords;
+  // the delta must be whole and meant for the container as it is now
+  if (memcmp(header.magic, BIT_DB_DELTA_MAGIC, sizeof(BIT_DB_DELTA_MAGIC)) ||
+      header.byte_order != BIT_DB_FILE_BYTE_ORDER ||
+      header.length != set->length || header.base_nelem != set->nelem ||
+      header.nelem < header.base_nelem || header.nelem >= INT_MAX ||
+      header.nrows > header.nelem)
+    return -1;
+  const size_t nrows = header.nrows;
+  const size_t index_bytes = (nrows + nrows % 2) * sizeof(uint32_t);
+  if (bytes != sizeof(header) + index_bytes + nrows * nq * sizeof(uint64_t))
+    return -1;
+  const unsigned char *body = (const unsigned char *)delta + sizeof(header);
+  if (db_checksum(body, bytes - sizeof(header)) != header.checksum)
+    return -1;
+  const uint32_t *rows = (const uint32_t *)body;
+  const uint64_t *deltas = (const uint64_t *)(body + index_bytes);
+  for (size_t k = 0; k < nrows; k++)
+    if (rows[k] >= header.nelem)
+      return -1;
+
+  if (header.nelem > set->nelem) // the appended rows start from zero
+    BitDB_append_many(set, (int)(header.nelem - set->nelem), NULL);
+  const long long n = (long long)nrows;
+#pragma omp parallel for schedule(static) if (n > 64 && !set->changes)
+  for (long long k = 0; k < n; k++) {
+    uint64_t *row = set->qwords + (size_t)rows[k] * set->stride_in_qwords;
+    const uint64_t *d = deltas + (size_t)k * nq;
+    db_seq_write_begin(set, rows[k], 1);
+    db_log_row(set, rows[k], true); // a replica may be tracked in turn
+    OMP_CPU_SIMD
+    for (size_t q = 0; q < nq; q++)
+      row[q] ^= d[q];
+    db_log_row(set, rows[k], false);
+    db_seq_write_end(set, rows[k], 1);
+  }
+  for (size_t k = 0; k < nrows; k++) {
+    db_seq_write_begin(set, rows[k], 1);
+    if (set->row_counts)
+      set->row_counts[rows[k]] = db_row_count(set, rows[k]);
+    db_summary_rows(set, rows[k], 1);
+    db_mark_dirty(set, rows[k], 1); // device copies sync these rows only
+    db_seq_write_end(set, rows[k], 1);
+  }
+  return 0;
+}
+
+/* --- 11c'''. Concurrent readers and writers --- */
+
+void BitDB_concurrent(T_DB set, bool enable) {
+  assert(set);
+  free((void *)set->row_seqs);
+  set->row_seqs = NULL;
+  if (!enable)
+    return;
+  set->row_seqs = calloc(db_seq_blocks(set->capacity), sizeof(uint64_t));
+  assert(set->row_seqs != NULL);
+}
+
+bool BitDB_is_concurrent(T_DB set) {
+  assert(set);
+  return set->row_seqs != NULL;
+}
+
+uint64_t BitDB_read_begin(T_DB set, int first, int n) {
+  assert(set);
+  assert(first >= 0 && n >= 0 && (size_t)first + n <= set->nelem);
+  return db_seq_read_begin(set, first, n);
+}
+
+bool BitDB_read_retry(T_DB set, int first, int n, uint64_t token) {
+  assert(set);
+  assert(first >= 0 && n >= 0 && (size_t)first + n <= set->nelem);
+  return db_seq_read_retry(set, first, n, token);
+}
+
+T_DB BitDB_snapshot(T_DB set) {
+  assert(set);
+  assert(set->is_Bit_T_allocated);
+  assert(!set->is_pinned && !set->is_huge);
+#if BIT_DB_COW
+  if (set->cow == NULL && !db_cow_start(set))
+    return db_copy_readonly(set);
+  bit_db_cow *cow = set->cow;
+  if (cow->diverged && atomic_load(&cow->open) > 0 && cow->stamp != set->stamp)
+    return db_copy_readonly(set); // an older generation is still mapped
+  if (cow->diverged && atomic_load(&cow->open) == 0)
+    db_cow_merge(set);
+  const size_t bytes = db_mapped_bytes(set, set->nelem);
+  void *mapping = mmap(NULL, bytes, PROT_READ, MAP_SHARED, cow->fd, 0);
+  if (mapping == MAP_FAILED)
+    return db_copy_readonly(set);
+  if (!cow->diverged) // writes from now on leave the file to the snapshots
+    db_cow_map(set, true);
+  cow->stamp = set->stamp;
+  atomic_fetch_add(&cow->open, 1);
+  atomic_fetch_add(&cow->refs, 1);
+  T_DB snapshot = malloc(sizeof(*snapshot));
+  assert(snapshot != NULL);
+  db_wrap(snapshot, set->length, set->nelem, mapping);
+  snapshot->stride_in_bytes = set->stride_in_bytes;
+  snapshot->stride_in_qwords = set->stride_in_qwords;
+  snapshot->mapping = mapping;
+  snapshot->mapping_bytes = bytes;
+  db_charge(snapshot);
+  snapshot->is_readonly = true;
+  snapshot->cow = cow;
+  return snapshot;
+#else
+  return db_copy_readonly(set);
+#endif
+}
+
+/* --- 11c''''. N-way reductions over the rows --- */
+
+void BitDB_reduce(T_DB set, Bit_reduce_op op, int k, T out,
+                  SETOP_COUNT_OPTS opts) {
+  assert(set && out);
+  assert(set->nelem > 0);
+  assert(out->length == set->length);
+  assert(op >= BIT_REDUCE_OR && op <= BIT_REDUCE_MAJORITY);
+  assert(op != BIT_REDUCE_ATLEAST || k >= 0);
+  reduce_src src = {.base = set->qwords,
+                    .stride = set->stride_in_qwords,
+                    .n = set->nelem,
+                    .nq = set->size_in_qwords};
+  BIT_PROFILE_CALL((uint64_t)set->nelem * set->size_in_bytes);
+  reduce_run(&src, op, k, out, cpu_threads(opts));
+}
+
+/* --- 11c'''''. Column counts over the rows --- */
+
+void BitDB_column_counts(T_DB set, uint32_t *out, SETOP_COUNT_OPTS opts) {
+  assert(set);
+  assert(out != NULL);
+  const size_t n = set->nelem, nq = set->size_in_qwords;
+  const int nthreads = cpu_threads(opts);
+  if (n == 0) {
+    memset(out, 0, (size_t)set->length * sizeof(uint32_t));
+    return;
+  }
+  reduce_src src = {.base = set->qwords,
+                    .stride = set->stride_in_qwords,
+                    .n = n,
+                    .nq = nq};
+  BIT_PROFILE_CALL((uint64_t)n * set->size_in_bytes);
+  // blocks of columns, and groups of rows when the blocks are too few
+  const size_t nblocks = (nq + BIT_REDUCE_BLOCK - 1) / BIT_REDUCE_BLOCK;
+  size_t groups = nblocks >= (size_t)nthreads
+                      ? 1
+                      : ((size_t)nthreads + nblocks - 1) / nblocks;
+  if (groups > n)
+    groups = n;
+  const size_t cap = (size_t)BIT_REDUCE_BLOCK * BPQW;
+  uint32_t *part = portable_aligned_calloc(
+      ALIGNMENT, groups * nblocks * cap * sizeof(uint32_t));
+  assert(part != NULL);
+  const long long ntasks = (long long)(groups * nblocks);
+  const bool parallel = n * nq > BIT_BATCH_PARALLEL_QWORDS;
+#pragma omp parallel num_threads(nthreads) if (parallel)
+  {
+    uint64_t *cnt = portable_aligned_calloc(
+        ALIGNMENT, 16 * BIT_REDUCE_BLOCK * sizeof(uint64_t));
+    assert(cnt != NULL);
+#pragma omp for schedule(dynamic)
+    for (long long task = 0; task < ntasks; task++) {
+      const size_t g = (size_t)task / nblocks, blk = (size_t)task % nblocks;
+      const size_t lo = blk * BIT_REDUCE_BLOCK;
+      const size_t w = nq - lo < BIT_REDUCE_BLOCK ? nq - lo : BIT_REDUCE_BLOCK;
+      column_counts_block(&src, n * g / groups, n * (g + 1) / groups, lo, w,
+                          cnt, part + (size_t)task * cap);
+    }
+    portable_aligned_free(cnt);
+  }
+  // the counts of every group are added into the first group's, then out
+  const size_t length = (size_t)set->length;
+#pragma omp parallel for num_threads(nthreads) schedule(static) if (parallel)
+  for (long long blk = 0; blk < (long long)nblocks; blk++) {
+    const size_t first = (size_t)blk * cap;
+    const size_t m = length - first < cap ? length - first : cap;
+    uint32_t *acc = part + first;
+    for (size_t g = 1; g < groups; g++) {
+      const uint32_t *other = part + (g * nblocks + (size_t)blk) * cap;
+      OMP_CPU_SIMD
+      for (size_t j = 0; j < m; j++)
+        acc[j] += other[j];
+    }
+    memcpy(out + first, acc, m * sizeof(uint32_t));
+  }
+  portable_aligned_free(part);
+}
+
+/* --- 11d. CPU set operations (allocate and return counts buffer) --- */
+
+size_t BitDB_counts_size(T_DB bit, T_DB bits) {
+  assert(bit && bits);
+  return (size_t)bit->nelem * bits->nelem;
+}
+
+size_t BitDB_counts_offset(T_DB bits, int i, int j) {
+  assert(bits);
+  assert(i >= 0 && j >= 0 && (unsigned int)j < bits->nelem);
+  return (size_t)i * bits->nelem + (size_t)j;
+}
+
+/* The counts matrix of BitDB_SETOP_count_cpu, left unzeroed. The kernels
+   write every count unless a stop skips tiles, and they zero each tile on
+   the thread that counts it, so the pages of the matrix are first touched,
+   and placed on a NUMA node, by the thread that writes them. Only a count
+   that can stop needs zeros for the tiles it skips: the team of the count
+   writes them, a block of rows each */
+static int *counts_alloc(T_DB bit, T_DB bits, SETOP_COUNT_OPTS opts) {
+  const size_t size = BitDB_counts_size(bit, bits);
+  int *counts = malloc((size ? size : 1) * sizeof(int));
+  assert(counts != NULL);
+  if (bit_stop_active(opts)) {
+    const int nrows = (int)bit->nelem;
+    const size_t ncols = bits->nelem;
+#pragma omp parallel for num_threads(cpu_threads(opts)) schedule(static)
+    for (int i = 0; i < nrows; i++)
+      memset(counts + (size_t)i * ncols, 0, ncols * sizeof(int));
+  }
+  return counts;
+}
+
+int *BitDB_inter_count_cpu(T_DB bit, T_DB bits, SETOP_COUNT_OPTS opts) {
+
+  int *counts = counts_alloc(bit, bits, opts);
+  BitDB_inter_count_store_cpu(bit, bits, counts, opts);
+  return counts;
+}
+
+void BitDB_inter_count_store_cpu(T_DB bit, T_DB bits, int *counts,
+                                 SETOP_COUNT_OPTS opts) {
+  BIT_PROFILE_CALL(bit_profile_db_bytes(bit, bits));
+  SETOP_DB_CHECKS(bit, bits)
+  BIT_CAPTURE_CALL(BIT_CAPTURE_COUNT_CPU, bit, bits, BIT_COUNT_INTER, 0, 0,
+                   BIT_COUNTS_I32, opts);
+  db_count_store_stoppable(BIT_OP_AND, bit, bits, counts, opts);
+}
+
+int *BitDB_union_count_cpu(T_DB bit, T_DB bits, SETOP_COUNT_OPTS opts) {
+
+  int *counts = counts_alloc(bit, bits, opts);
+  BitDB_union_count_store_cpu(bit, bits, counts, opts);
+  return counts;
+}
+
+void BitDB_union_count_store_cpu(T_DB bit, T_DB bits, int *counts,
+                                 SETOP_COUNT_OPTS opts) {
+  BIT_PROFILE_CALL(bit_profile_db_bytes(bit, bits));
+  SETOP_DB_CHECKS(bit, bits)
+  BIT_CAPTURE_CALL(BIT_CAPTURE_COUNT_CPU, bit, bits, BIT_COUNT_UNION, 0, 0,
+                   BIT_COUNTS_I32, opts);
+  db_count_store_stoppable(BIT_OP_OR, bit, bits, counts, opts);
+}
+
+int *BitDB_diff_count_cpu(T_DB bit, T_DB bits, SETOP_COUNT_OPTS opts) {
+
+  int *counts = counts_alloc(bit, bits, opts);
+  BitDB_diff_count_store_cpu(bit, bits, counts, opts);
+  return counts;
+}
+
+void BitDB_diff_count_store_cpu(T_DB bit, T_DB bits, int *counts,
+                                SETOP_COUNT_OPTS opts) {
+  BIT_PROFILE_CALL(bit_profile_db_bytes(bit, bits));
+  SETOP_DB_CHECKS(bit, bits)
+  BIT_CAPTURE_CALL(BIT_CAPTURE_COUNT_CPU, bit, bits, BIT_COUNT_DIFF, 0, 0,
+                   BIT_COUNTS_I32, opts);
+  db_count_store_stoppable(BIT_OP_XOR, bit, bits, counts, opts);
+}
+
+int *BitDB_minus_count_cpu(T_DB bit, T_DB bits, SETOP_COUNT_OPTS opts) {
+
+  int *counts = counts_alloc(bit, bits, opts);
+  BitDB_minus_count_store_cpu(bit, bits, counts, opts);
+  return counts;
+}
+
+void BitDB_minus_count_store_cpu(T_DB bit, T_DB bits, int *counts,
+                                 SETOP_COUNT_OPTS opts) {
+  BIT_PROFILE_CALL(bit_profile_db_bytes(bit, bits));
+  SETOP_DB_CHECKS(bit, bits)
+  BIT_CAPTURE_CALL(BIT_CAPTURE_COUNT_CPU, bit, bits, BIT_COUNT_MINUS, 0, 0,
+                   BIT_COUNTS_I32, opts);
+  db_count_store_stoppable(BIT_OP_AND_NOT, bit, bits, counts, opts);
+}
+
+/* --- 11d'. Set operations of row pairs into a container ---
+   Row m of out gets op of a pair of rows: pairs[2m] of bit and
+   pairs[2m + 1] of bits, or, without pairs, query m / nt and target m % nt
+   of all the pairs in count-matrix order. The setop kernel writes the rows
+   of out in place, one pair per iteration, with no Bit_T in between.
+*/
+
+static void db_setop_store(bit_setop_id op, T_DB bit, T_DB bits,
+                           const int pairs[], size_t n, T_DB out,
+                           SETOP_COUNT_OPTS opts) {
+  assert(bit && bits && out);
+  assert(!out->is_readonly);
+  assert(out != bit && out != bits);
+  assert(bit->length == bits->length && out->length == bit->length);
+  const size_t nt = bits->nelem, nq = out->size_in_qwords;
+  if (pairs == NULL)
+    n = BitDB_counts_size(bit, bits);
+  assert(n <= out->nelem);
+  void (*kernel)(T, T, T) = bit_kernels_active()->setop[op];
+  BIT_PROFILE_CALL((uint64_t)n * 3 * out->size_in_bytes);
+  const long long nrows = (long long)n;
+  // the change log hands out its slots serially
+#pragma omp parallel for num_threads(cpu_threads(opts)) schedule(static)          if (!out->changes)
+  for (long long m = 0; m < nrows; m++) {
+    const size_t i = pairs ? (size_t)pairs[2 * m] : (size_t)m / nt;
+    const size_t j = pairs ? (size_t)pairs[2 * m + 1] : (size_t)m % nt;
+    assert(i < bit->nelem && j < bits->nelem);
+    struct T x = summary_view(out->qwords + m * out->stride_in_qwords, 0, nq),
+             y = summary_view(bit->qwords + i * bit->stride_in_qwords, 0, nq),
+             z = summary_view(bits->qwords + j * bits->stride_in_qwords, 0,
+                              nq);
+    db_seq_write_begin(out, (size_t)m, 1);
+    db_log_row(out, (size_t)m, true);
+    kernel(&x, &y, &z);
+    db_log_row(out, (size_t)m, false);
+    if (out->row_counts)
+      out->row_counts[m] = db_row_count(out, (unsigned int)m);
+    db_summary_rows(out, (size_t)m, 1);
+    db_seq_write_end(out, (size_t)m, 1);
+  }
+  db_mark_dirty(out, 0, n);
+}
+
+void BitDB_inter_store(T_DB bit, T_DB bits, const int pairs[], size_t n,
+                       T_DB out, SETOP_COUNT_OPTS opts) {
+  db_setop_store(BIT_OP_AND, bit, bits, pairs, n, out, opts);
+}
+
+void BitDB_union_store(T_DB bit, T_DB bits, const int pairs[], size_t n,
+                       T_DB out, SETOP_COUNT_OPTS opts) {
+  db_setop_store(BIT_OP_OR, bit, bits, pairs, n, out, opts);
+}
+
+void BitDB_diff_store(T_DB bit, T_DB bits, const int pairs[], size_t n,
+                      T_DB out, SETOP_COUNT_OPTS opts) {
+  db_setop_store(BIT_OP_XOR, bit, bits, pairs, n, out, opts);
+}
+
+void BitDB_minus_store(T_DB bit, T_DB bits, const int pairs[], size_t n,
+                       T_DB out, SETOP_COUNT_OPTS opts) {
+  db_setop_store(BIT_OP_AND_NOT, bit, bits, pairs, n, out, opts);
+}
+
+/* --- 11d''. Masks applied to every row in place ---
+   Each row is combined with the mask by the setop kernel, and recounted
+   for the popcount cache and resummarized while it is still in cache.
+*/
+
+void BitDB_apply_range(T_DB set, int first, int n, Bit_count_ops op, T mask,
+                       SETOP_COUNT_OPTS opts) {
+  assert(set && mask);
+  assert(!set->is_readonly);
+  assert(mask->length == set->length);
+  assert(first >= 0 && n >= 0 && (unsigned int)first + n <= set->nelem);
+  void (*kernel)(T, T, T) = bit_kernels_active()->setop[count_op_id(op)];
+  const size_t nq = set->size_in_qwords;
+  BIT_PROFILE_CALL((uint64_t)n * 2 * set->size_in_bytes);
+  // the change log hands out its slots serially
+#pragma omp parallel for num_threads(cpu_threads(opts)) schedule(static)          if (!set->changes)
+  for (int r = first; r < first + n; r++) {
+    struct T row = summary_view(
+        set->qwords + (size_t)r * set->stride_in_qwords, 0, nq);
+    db_seq_write_begin(set, (size_t)r, 1);
+    db_log_row(set, (size_t)r, true);
+    kernel(&row, &row, mask);
+    db_log_row(set, (size_t)r, false);
+    if (set->row_counts)
+      set->row_counts[r] = db_row_count(set, (unsigned int)r);
+    db_summary_rows(set, (size_t)r, 1);
+    db_seq_write_end(set, (size_t)r, 1);
+  }
+  db_mark_dirty(set, (size_t)first, (size_t)n);
+}
+
+void BitDB_apply(T_DB set, Bit_count_ops op, T mask, SETOP_COUNT_OPTS opts) {
+  assert(set);
+  BitDB_apply_range(set, 0, (int)set->nelem, op, mask, opts);
+}
+
+/* --- 11e. Fused count expressions over every row --- */
+
+int *BitDB_expr_count_cpu(T_DB bits, const Bit_expr_op program[], int nops,
+                          T operands[], int noperands, SETOP_COUNT_OPTS opts) {
+  assert(bits);
+  int *counts = (int *)calloc(bits->nelem, sizeof(int));
+  assert(counts != NULL);
+  BitDB_expr_count_store_cpu(bits, program, nops, operands, noperands, counts,
+                             opts);
+  return counts;
+}
+
+void BitDB_expr_count_store_cpu(T_DB bits, const Bit_expr_op program[],
+                                int nops, T operands[], int noperands,
+                                int *counts, SETOP_COUNT_OPTS opts) {
+  assert(bits && counts);
+  BIT_PROFILE_CALL(bit_profile_rows_bytes(bits, NULL) +
+                   (uint64_t)bits->nelem * sizeof(int));
+  expr_validate(program, nops, operands, noperands, bits->length, true);
+  const bit_kernel_table *k = bit_kernels_active();
+  int n = (int)bits->nelem;
+  unsigned int size_in_qwords = bits->size_in_qwords;
+  unsigned int stride = bits->stride_in_qwords;
+#pragma omp parallel for num_threads(cpu_threads(opts)) schedule(static)
+  for (int i = 0; i < n; i++)
+    counts[i] = k->expr_count(program, nops, operands,
+                              bits->qwords + (uint64_t)i * stride,
+                              size_in_qwords, bits->length);
+}
+
+/* --- 11f. Streaming SETOP counts against rows read in blocks --- */
+
+int BitDB_stream_read_file(void *file, void *rows, int max_rows,
+                           int row_bytes) {
+  assert(file && rows);
+  return (int)fread(rows, (size_t)row_bytes, (size_t)max_rows, (FILE *)file);
+}
+
+#define DEFINE_COUNT_STREAM(name, op)                                          \
+  void BitDB_##name##_count_stream_cpu(                                        \
+      T_DB bit,                                                                \
+      int next_block(void *cl, void *rows, int max_rows, int row_bytes),       \
+      void *block_cl, int block_rows,                                          \
+      void emit(void *cl, size_t first_row, int nrows, const int *counts),     \
+      void *emit_cl, SETOP_COUNT_OPTS opts) {                                  \
+    db_count_stream(op, bit, next_block, block_cl, block_rows, emit, emit_cl,  \
+                    opts);                                                     \
+  }
+
+DEFINE_COUNT_STREAM(inter, BIT_OP_AND)
+DEFINE_COUNT_STREAM(union, BIT_OP_OR)
+DEFINE_COUNT_STREAM(diff, BIT_OP_XOR)
+DEFINE_COUNT_STREAM(minus, BIT_OP_AND_NOT)
+
+/* --- 11g. Search modes: top-k and threshold SETOP counts --- */
+
+void BitDB_inter_count_topk(T_DB bit, T_DB bits, int k, SETOP_COUNT_OPTS opts,
+                            int *out_idx, int *out_count) {
+  BIT_PROFILE_CALL(bit_profile_rows_bytes(bit, bits));
+  SETOP_DB_CHECKS(bit, bits)
+  BIT_CAPTURE_CALL(BIT_CAPTURE_TOPK_CPU, bit, bits, BIT_COUNT_INTER, k, 0, 0,
+                   opts);
+  count_search_topk(bit, bits, k, (search_ctx){0}, opts, out_idx, out_count);
+}
+
+size_t BitDB_inter_count_threshold(T_DB bit, T_DB bits, int threshold,
+                                   SETOP_COUNT_OPTS opts, size_t *offsets,
+                                   int **out_idx, int **out_count) {
+  BIT_PROFILE_CALL(bit_profile_rows_bytes(bit, bits));
+  SETOP_DB_CHECKS(bit, bits)
+  BIT_CAPTURE_CALL(BIT_CAPTURE_THRESHOLD_CPU, bit, bits, BIT_COUNT_INTER,
+                   threshold, 0, 0, opts);
+  return count_search_threshold(bit, bits, threshold, (search_ctx){0}, opts,
+                                offsets, out_idx, out_count);
+}
+
+/* Every row of a tile is packed by the kernel's compare to a lane mask into
+   the words of a query row, then shifted into place at first_target; a
+   target block need not start on a word. Gathered targets (row_mask) go bit
+   by bit to the rows of bits they came from. The query block of a tile
+   belongs to one thread, so the rows it writes are its own */
+typedef struct {
+  T_DB out;
+  search_ctx ctx;
+  int threshold;
+  void (*pack)(const int *counts, size_t n, int threshold, uint64_t *words);
+} threshold_bits_state;
+
+static void threshold_bits_fold(void *cl, int first_query, int nquery,
+                                int first_target, int ntarget,
+                                const int *tile) {
+  threshold_bits_state *s = cl;
+  uint64_t words[BIT_SEARCH_TARGET_BLOCK / 64 + 1];
+  const unsigned int nwords = ((unsigned int)ntarget + 63) / 64;
+  const unsigned int at = (unsigned int)first_target % 64;
+  for (int i = 0; i < nquery; i++) {
+    const int *counts = tile + (size_t)i * ntarget;
+    uint64_t *row = s->out->qwords +
+                    (size_t)SEARCH_ID(s->ctx.query_ids, first_query + i) *
+                        s->out->stride_in_qwords;
+    if (s->ctx.target_ids) {
+      for (int j = 0; j < ntarget; j++)
+        if (counts[j] >= s->threshold) {
+          const int t = s->ctx.target_ids[first_target + j];
+          row[t / 64] |= UINT64_C(1) << (t % 64);
+        }
+      continue;
+    }
+    s->pack(counts, (size_t)ntarget, s->threshold, words);
+    uint64_t *dst = row + first_target / 64;
+    for (unsigned int w = 0; w < nwords; w++) {
+      dst[w] |= words[w] << at;
+      if (at && words[w] >> (64 - at))
+        dst[w + 1] |= words[w] >> (64 - at);
+    }
+  }
+}
+
+T_DB BitDB_inter_count_threshold_bits(T_DB bit, T_DB bits, int threshold,
+                                      SETOP_COUNT_OPTS opts) {
+  BIT_PROFILE_CALL(bit_profile_rows_bytes(bit, bits));
+  SETOP_DB_CHECKS(bit, bits)
+  threshold_bits_state state = {
+      BitDB_new((int)bits->nelem, (int)bit->nelem), {0}, threshold,
+      bit_kernels_active()->threshold_pack};
+  state.ctx.ntargets = (int)bits->nelem;
+  state.ctx.query_ids = bit->row_ids;
+  search_rows rows = search_rows_select(bits, &state.ctx, opts);
+  if (rows.targets)
+    db_count_tiles(BIT_OP_AND, bit, rows.targets, opts, threshold_bits_fold,
+                   &state);
+  search_rows_done(&rows);
+  return state.out;
+}
+
+/* --- 11g'. Screened threshold searches --- */
+
+int BitDB_screen_words(T_DB set, int nwords, bool by_variance,
+                       unsigned int seed, int *words) {
+  assert(set && words);
+  assert(nwords > 0);
+  const size_t nq = set->size_in_qwords;
+  const size_t nlines = (nq + SCREEN_LINE_WORDS - 1) / SCREEN_LINE_WORDS;
+  size_t *order = malloc(nlines * sizeof(size_t));
+  double *score = malloc(nlines * sizeof(double));
+  assert(order && score);
+  for (size_t l = 0; l < nlines; l++)
+    order[l] = l;
+  if (by_variance) {
+    screen_line_variance(set, nlines, score);
+    // highest variance first, by insertion: a row has few lines
+    for (size_t l = 1; l < nlines; l++) {
+      const size_t at = order[l];
+      size_t m = l;
+      for (; m > 0 && score[order[m - 1]] < score[at]; m--)
+        order[m] = order[m - 1];
+      order[m] = at;
+    }
+  } else {
+    uint64_t x = seed ? seed : 0x9E3779B97F4A7C15ull; // a shuffle, xorshift
+    for (size_t l = nlines; l > 1; l--) {
+      x ^= x << 13;
+      x ^= x >> 7;
+      x ^= x << 17;
+      const size_t m = (size_t)(x % l), at = order[l - 1];
+      order[l - 1] = order[m];
+      order[m] = at;
+    }
+  }
+  int n = 0;
+  for (size_t l = 0; l < nlines && n < nwords; l++)
+    for (size_t w = order[l] * SCREEN_LINE_WORDS;
+         w < nq && w < (order[l] + 1) * SCREEN_LINE_WORDS && n < nwords; w++)
+      words[n++] = (int)w;
+  qsort(words, (size_t)n, sizeof(int), screen_compare_int);
+  free(order);
+  free(score);
+  return n;
+}
+
+size_t BitDB_inter_count_screened(T_DB bit, T_DB bits, int threshold,
+                                  const int words[], int nwords,
+                                  Bit_screen_mode mode, SETOP_COUNT_OPTS opts,
+                                  size_t *offsets, int **out_idx,
+                                  int **out_count) {
+  SETOP_DB_CHECKS(bit, bits)
+  assert(words != NULL && nwords > 0);
+  assert(mode == BIT_SCREEN_BOUND || mode == BIT_SCREEN_ESTIMATE);
+  assert(offsets && out_idx && out_count);
+  const size_t nq = bit->size_in_qwords;
+  for (int m = 0; m < nwords; m++)
+    assert(words[m] >= 0 && (size_t)words[m] < nq);
+  BIT_PROFILE_CALL((uint64_t)bit->nelem * bit->size_in_bytes +
+                   (uint64_t)bits->nelem * nwords * sizeof(uint64_t));
+  const int nqueries = (int)bit->nelem, ntargets = (int)bits->nelem;
+  int *q_cards = db_row_cards(bit, opts);
+  int *t_cards = bit == bits ? q_cards : db_row_cards(bits, opts);
+  int *t_sample = malloc((ntargets ? ntargets : 1) * sizeof(int));
+  assert(t_sample != NULL);
+  screen_lists lists = screen_lists_new(nqueries);
+  const int nthreads = cpu_threads(opts);
+#pragma omp parallel for num_threads(nthreads) schedule(static)
+  for (int t = 0; t < ntargets; t++)
+    t_sample[t] = screen_count(
+        bits->qwords + (size_t)t * bits->stride_in_qwords, words, nwords);
+  int (*count)(T, T) = bit_kernels_active()->setop_count[BIT_OP_AND];
+  const double scale = (double)nq / nwords;
+#pragma omp parallel for num_threads(nthreads) schedule(dynamic)
+  for (int q = 0; q < nqueries; q++) {
+    const uint64_t *qrow = bit->qwords + (size_t)q * bit->stride_in_qwords;
+    const int q_rest = q_cards[q] - screen_count(qrow, words, nwords);
+    struct T vq = summary_view(qrow, 0, nq);
+    for (int t = 0; t < ntargets; t++) {
+      const uint64_t *trow =
+          bits->qwords + (size_t)t * bits->stride_in_qwords;
+      int c_s = 0;
+      for (int m = 0; m < nwords; m++)
+        c_s += POPCOUNT(qrow[words[m]] & trow[words[m]]);
+      if (!screen_pass(mode, c_s, q_rest, t_cards[t] - t_sample[t], scale,
+                       threshold))
+        continue;
+      struct T vt = summary_view(trow, 0, nq);
+      const int c = count(&vq, &vt);
+      if (c >= threshold)
+        screen_lists_add(&lists, q, t, c);
+    }
+  }
+  free(t_sample);
+  if (t_cards != q_cards)
+    free(t_cards);
+  free(q_cards);
+  return screen_lists_csr(&lists, nqueries, offsets, out_idx, out_count);
+}
+
+/* --- 11g''. Folded screening --- */
+
+T_DB BitDB_fold(T_DB set, int folded_length, SETOP_COUNT_OPTS opts) {
+  assert(set != NULL);
+  assert(folded_length > 0 && folded_length % 64 == 0);
+  assert((unsigned int)folded_length <= set->length);
+  T_DB folded = BitDB_new(folded_length, (int)set->nelem);
+  const size_t nq = set->size_in_qwords, nqf = folded->size_in_qwords;
+  const int nrows = (int)set->nelem;
+#pragma omp parallel for num_threads(cpu_threads(opts)) schedule(static)
+  for (int r = 0; r < nrows; r++)
+    fold_row(set->qwords + (size_t)r * set->stride_in_qwords, nq,
+             folded->qwords + (size_t)r * folded->stride_in_qwords, nqf);
+  return folded;
+}
+
+size_t BitDB_inter_count_threshold_folded(T_DB bit, T_DB bits, T_DB folded,
+                                          int threshold, SETOP_COUNT_OPTS opts,
+                                          size_t *offsets, int **out_idx,
+                                          int **out_count) {
+  FOLDED_CHECKS(bit, bits, folded)
+  assert(offsets && out_idx && out_count);
+  BIT_PROFILE_CALL((uint64_t)bit->nelem * bit->size_in_bytes +
+                   (uint64_t)bits->nelem * folded->size_in_bytes);
+  const size_t nq = bit->size_in_qwords, nqf = folded->size_in_qwords;
+  const int nqueries = (int)bit->nelem, ntargets = (int)bits->nelem;
+  screen_lists lists = screen_lists_new(nqueries);
+  int (*count)(T, T) = bit_kernels_active()->setop_count[BIT_OP_AND];
+  float (*weighted_count)(bit_setop_id, const uint64_t *, const uint64_t *,
+                          size_t, const float *) =
+      bit_kernels_active()->weighted_count;
+#pragma omp parallel num_threads(cpu_threads(opts))
+  {
+    float *tables = malloc(nqf * 256 * sizeof(float));
+    assert(tables != NULL);
+#pragma omp for schedule(dynamic)
+    for (int q = 0; q < nqueries; q++) {
+      const uint64_t *qrow = bit->qwords + (size_t)q * bit->stride_in_qwords;
+      fold_bound_tables(qrow, nq, nqf, tables);
+      struct T vq = summary_view(qrow, 0, nq);
+      for (int t = 0; t < ntargets; t++) {
+        const uint64_t *frow =
+            folded->qwords + (size_t)t * folded->stride_in_qwords;
+        if (FOLDED_BOUND(weighted_count, frow, nqf, tables) < threshold)
+          continue;
+        struct T vt = summary_view(
+            bits->qwords + (size_t)t * bits->stride_in_qwords, 0, nq);
+        const int c = count(&vq, &vt);
+        if (c >= threshold)
+          screen_lists_add(&lists, q, t, c);
+      }
+    }
+    free(tables);
+  }
+  return screen_lists_csr(&lists, nqueries, offsets, out_idx, out_count);
+}
+
+void BitDB_inter_count_topk_folded(T_DB bit, T_DB bits, T_DB folded, int k,
+                                   SETOP_COUNT_OPTS opts, int *out_idx,
+                                   int *out_count) {
+  FOLDED_CHECKS(bit, bits, folded)
+  assert(k >= 1);
+  assert(out_idx && out_count);
+  BIT_PROFILE_CALL((uint64_t)bit->nelem * bit->size_in_bytes +
+                   (uint64_t)bits->nelem * folded->size_in_bytes);
+  const size_t nq = bit->size_in_qwords, nqf = folded->size_in_qwords;
+  const int nqueries = (int)bit->nelem, ntargets = (int)bits->nelem;
+  int (*count)(T, T) = bit_kernels_active()->setop_count[BIT_OP_AND];
+  float (*weighted_count)(bit_setop_id, const uint64_t *, const uint64_t *,
+                          size_t, const float *) =
+      bit_kernels_active()->weighted_count;
+#pragma omp parallel num_threads(cpu_threads(opts))
+  {
+    float *tables = malloc(nqf * 256 * sizeof(float));
+    assert(tables != NULL);
+#pragma omp for schedule(dynamic)
+    for (int q = 0; q < nqueries; q++) {
+      const uint64_t *qrow = bit->qwords + (size_t)q * bit->stride_in_qwords;
+      int *idx = out_idx + (size_t)q * k, *cnt = out_count + (size_t)q * k;
+      for (int r = 0; r < k; r++)
+        idx[r] = cnt[r] = -1;
+      fold_bound_tables(qrow, nq, nqf, tables);
+      struct T vq = summary_view(qrow, 0, nq);
+      for (int t = 0; t < ntargets; t++) {
+        // targets come in increasing order, so a tie never displaces
+        if (cnt[k - 1] >= 0) {
+          const uint64_t *frow =
+              folded->qwords + (size_t)t * folded->stride_in_qwords;
+          if (FOLDED_BOUND(weighted_count, frow, nqf, tables) <= cnt[k - 1])
+            continue;
+        }
+        struct T vt = summary_view(
+            bits->qwords + (size_t)t * bits->stride_in_qwords, 0, nq);
+        const int c = count(&vq, &vt);
+        if (c <= cnt[k - 1])
+          continue;
+        int r = k - 1;
+        for (; r > 0 && c > cnt[r - 1]; r--) {
+          idx[r] = idx[r - 1];
+          cnt[r] = cnt[r - 1];
+        }
+        idx[r] = t;
+        cnt[r] = c;
+      }
+    }
+    free(tables);
+  }
+}
+
+/* --- 11h. Similarity coefficients --- */
+
+#define SIMILARITY_BEGIN(bit, bits, sim, opts)                                 \
+  SETOP_DB_CHECKS(bit, bits)                                                   \
+  int *_query_cards = db_row_cards(bit, opts);                                 \
+  int *_target_cards = bit == bits ? _query_cards : db_row_cards(bits, opts);  \
+  search_ctx ctx = {.query_cards = _query_cards,                               \
+                    .target_cards = _target_cards,                             \
+                    .sim = sim,                                                \
+                    .ntargets = (int)(bits)->nelem};
+
+#define SIMILARITY_END                                                         \
+  if (_target_cards != _query_cards)                                           \
+    free(_target_cards);                                                       \
+  free(_query_cards);
+
+void BitDB_similarity_store_cpu(T_DB bit, T_DB bits, Bit_similarity sim,
+                                float *out, SETOP_COUNT_OPTS opts) {
+  assert(out != NULL);
+  BIT_PROFILE_CALL(bit_profile_db_bytes(bit, bits));
+  SIMILARITY_BEGIN(bit, bits, sim, opts)
+  similarity_store_state state = {ctx, bits->nelem, out, NULL};
+  db_count_tiles(BIT_OP_AND, bit, bits, opts, similarity_store_fold, &state);
+  SIMILARITY_END
+}
+
+void BitDB_similarity_u16_store_cpu(T_DB bit, T_DB bits, Bit_similarity sim,
+                                    uint16_t *out, SETOP_COUNT_OPTS opts) {
+  assert(out != NULL);
+  BIT_PROFILE_CALL(bit_profile_rows_bytes(bit, bits) +
+                   BitDB_counts_size(bit, bits) * sizeof(uint16_t));
+  SIMILARITY_BEGIN(bit, bits, sim, opts)
+  similarity_store_state state = {ctx, bits->nelem, NULL, out};
+  db_count_tiles(BIT_OP_AND, bit, bits, opts, similarity_store_fold, &state);
+  SIMILARITY_END
+}
+
+void BitDB_similarity_topk(T_DB bit, T_DB bits, Bit_similarity sim, int k,
+                           SETOP_COUNT_OPTS opts, int *out_idx,
+                           float *out_sim) {
+  BIT_PROFILE_CALL(bit_profile_rows_bytes(bit, bits));
+  BIT_CAPTURE_CALL(BIT_CAPTURE_SIMILARITY_TOPK, bit, bits, sim.metric, k, 0,
+                   0, opts);
+  SIMILARITY_BEGIN(bit, bits, sim, opts)
+  similarity_search_topk(bit, bits, k, ctx, opts, out_idx, out_sim);
+  SIMILARITY_END
+}
+
+size_t BitDB_similarity_threshold(T_DB bit, T_DB bits, Bit_similarity sim,
+                                  float cutoff, SETOP_COUNT_OPTS opts,
+                                  size_t *offsets, int **out_idx,
+                                  float **out_sim) {
+  BIT_PROFILE_CALL(bit_profile_rows_bytes(bit, bits));
+  BIT_CAPTURE_CALL(BIT_CAPTURE_SIMILARITY_THRESHOLD, bit, bits, sim.metric, 0,
+                   cutoff, 0, opts);
+  SIMILARITY_BEGIN(bit, bits, sim, opts)
+  size_t total = similarity_search_threshold(bit, bits, cutoff, ctx, opts,
+                                             offsets, out_idx, out_sim);
+  SIMILARITY_END
+  return total;
+}
+
+/* --- 11i. One-pass multi-operation counts --- */
+
+void BitDB_multi_count_store(T_DB bit, T_DB bits, unsigned int ops,
+                             int *inter, int *unions, int *diff, int *minus,
+                             SETOP_COUNT_OPTS opts) {
+  SETOP_DB_CHECKS(bit, bits)
+  assert(ops != 0 && (ops & ~(unsigned int)BIT_COUNT_ALL) == 0);
+  BIT_PROFILE_CALL(bit_profile_rows_bytes(bit, bits) +
+                   __builtin_popcount(ops) * BitDB_counts_size(bit, bits) *
+                       sizeof(int));
+  assert(!(ops & BIT_COUNT_INTER) || inter);
+  assert(!(ops & BIT_COUNT_UNION) || unions);
+  assert(!(ops & BIT_COUNT_DIFF) || diff);
+  assert(!(ops & BIT_COUNT_MINUS) || minus);
+  /* inclusion-exclusion needs no popcounts for the intersection alone */
+  if (ops == BIT_COUNT_INTER) {
+    BitDB_inter_count_store_cpu(bit, bits, inter, bit_stop_ignored(opts));
+    return;
+  }
+  int *query_cards = db_row_cards(bit, opts);
+  int *target_cards = bit == bits ? query_cards : db_row_cards(bits, opts);
+  multi_count_state state = {query_cards, target_cards, bits->nelem, {NULL}};
+  state.out[BIT_OP_AND] = ops & BIT_COUNT_INTER ? inter : NULL;
+  state.out[BIT_OP_OR] = ops & BIT_COUNT_UNION ? unions : NULL;
+  state.out[BIT_OP_XOR] = ops & BIT_COUNT_DIFF ? diff : NULL;
+  state.out[BIT_OP_AND_NOT] = ops & BIT_COUNT_MINUS ? minus : NULL;
+  db_count_tiles(BIT_OP_AND, bit, bits, opts, multi_count_fold, &state);
+  if (target_cards != query_cards)
+    free(target_cards);
+  free(query_cards);
+}
+
+/* --- 11j. CPU tile tuning --- */
+
+Bit_tuning Bit_tuning_defaults(void) {
+  return (Bit_tuning){BIT_TUNING_BLOCK_DEFAULT, CPU_TILE_BIT, K_BLOCK,
+                      CPU_PREFETCH};
+}
+
+Bit_tuning Bit_tuning_get(void) {
+  init_tuning();
+  return bit_tuning;
+}
+
+void Bit_tuning_set(Bit_tuning tuning) {
+  assert(tuning_valid(tuning));
+  bit_tuning = tuning;
+  bit_tuning_ready = true;
+#pragma omp critical(bit_calibration)
+  memset(cpu_calibrations, 0, sizeof(cpu_calibrations));
+}
+
+int Bit_tuning_save(const char *path, Bit_tuning tuning) {
+  assert(path != NULL);
+  assert(tuning_valid(tuning));
+  FILE *file = fopen(path, "w");
+  if (file == NULL)
+    return -1;
+  bool ok = fprintf(file,
+                    "# Bit CPU count kernel tuning\n"
+                    "isa %s\nblock %s\ntile %d\nk_block %d\nprefetch %d\n",
+                    bit_kernels_active()->isa,
+                    bit_tuning_block_names[tuning.block], tuning.tile,
+                    tuning.k_block, tuning.prefetch) > 0;
+  ok = fclose(file) == 0 && ok;
+  return ok ? 0 : -1;
+}
+
+int Bit_tuning_load(const char *path) {
+  assert(path != NULL);
+  FILE *file = fopen(path, "r");
+  if (file == NULL)
+    return -1;
+  Bit_tuning tuning = {BIT_TUNING_BLOCK_COUNT, 0, 0, 0}; // older: no prefetch
+  bool same_isa = false;
+  char line[128], key[32], value[64];
+  while (fgets(line, sizeof(line), file)) {
+    if (line[0] == '#' || sscanf(line, "%31s %63s", key, value) != 2)
+      continue;
+    if (strcmp(key, "isa") == 0)
+      same_isa = strcmp(value, bit_kernels_active()->isa) == 0;
+    else if (strcmp(key, "block") == 0) {
+      for (int b = 0; b < BIT_TUNING_BLOCK_COUNT; b++)
+        if (strcmp(value, bit_tuning_block_names[b]) == 0)
+          tuning.block = (Bit_tuning_block)b;
+    } else if (strcmp(key, "tile") == 0)
+      tuning.tile = atoi(value);
+    else if (strcmp(key, "k_block") == 0)
+      tuning.k_block = atoi(value);
+    else if (strcmp(key, "prefetch") == 0)
+      tuning.prefetch = atoi(value);
+  }
+  fclose(file);
+  if (!same_isa || !tuning_valid(tuning))
+    return -1;
+  bit_tuning = tuning;
+  bit_tuning_ready = true;
+  return 0;
+}
+
+Bit_tuning Bit_tuning_autotune(int length, int nelem, SETOP_COUNT_OPTS opts,
+                               const char *path) {
+  assert(length > 0 && nelem > 0);
+  static const int tiles[] = {16, 32, 64};
+  static const int k_blocks[] = {256, 1024, 4096};
+  const int ntiles = sizeof(tiles) / sizeof(tiles[0]);
+  const int nk_blocks = sizeof(k_blocks) / sizeof(k_blocks[0]);
+  static const int prefetches[] = {0, 2, 4, 8};
+  const int nprefetches = sizeof(prefetches) / sizeof(prefetches[0]);
+
+  uint64_t state = UINT64_C(0x9E3779B97F4A7C15);
+  T_DB queries = tuning_random_db(length, nelem, &state);
+  T_DB targets = tuning_random_db(length, nelem, &state);
+  int *counts = malloc(BitDB_counts_size(queries, targets) * sizeof(int));
+  assert(counts != NULL);
+
+  Bit_tuning best = Bit_tuning_defaults();
+  opts.tuning = &best;
+  double best_time = tuning_time(queries, targets, counts, opts);
+  for (int b = 0; b < BIT_TUNING_BLOCK_COUNT; b++)
+    for (int t = 0; t < ntiles; t++)
+      for (int k = 0; k < nk_blocks; k++) {
+        // k_blocks past the row length all run the same loop
+        if (k > 0 && (unsigned int)k_blocks[k - 1] >= queries->size_in_qwords)
+          break;
+        // and the recursive kernel uses neither size
+        if (b == BIT_TUNING_BLOCK_RECURSIVE && (t > 0 || k > 0))
+          break;
+        Bit_tuning candidate = {(Bit_tuning_block)b, tiles[t], k_blocks[k],
+                                best.prefetch};
+        opts.tuning = &candidate;
+        double elapsed = tuning_time(queries, targets, counts, opts);
+        if (elapsed < best_time) {
+          best_time = elapsed;
+          best = candidate;
+        }
+      }
+  // then how far ahead the winner prefetches
+  for (int p = 0; p < nprefetches; p++) {
+    Bit_tuning candidate = best;
+    candidate.prefetch = prefetches[p];
+    if (candidate.prefetch == best.prefetch)
+      continue;
+    opts.tuning = &candidate;
+    double elapsed = tuning_time(queries, targets, counts, opts);
+    if (elapsed < best_time) {
+      best_time = elapsed;
+      best = candidate;
+    }
+  }
+
+  const double rate = (double)queries->nelem * targets->nelem *
+                      queries->size_in_qwords /
+                      (best_time > 0 ? best_time : 1e-9);
+  free(counts);
+  BitDB_free(&queries);
+  BitDB_free(&targets);
+  Bit_tuning_set(best);
+  // the winner's rate feeds BitDB_estimate at this team size
+  const int slot = calibration_slot(opts);
+#pragma omp critical(bit_calibration)
+  cpu_calibrations[slot].rate = rate;
+  if (path)
+    Bit_tuning_save(path, best);
+  return best;
+}
+
+/* --- 11j'. Kernel tier per call --- */
+
+uint64_t Bit_isa_threshold_get(void) {
+  init_kernels();
+  return atomic_load_explicit(&bit_isa_threshold, memory_order_relaxed);
+}
+
+void Bit_isa_threshold_set(uint64_t work) {
+  init_kernels();
+  atomic_store_explicit(&bit_isa_threshold, work, memory_order_relaxed);
+}
+
+uint64_t Bit_isa_calibrate(int length, SETOP_COUNT_OPTS opts) {
+  assert(length > 0);
+  init_kernels();
+  if (bit_kernels_narrow == bit_kernels) { // one tier: nothing to choose
+    Bit_isa_threshold_set(0);
+    return 0;
+  }
+  opts = bit_stop_ignored(opts);
+  enum { MIN_ROWS = 8, MAX_ROWS = 512, ROUNDS = 5 };
+  uint64_t state = UINT64_C(0x9E3779B97F4A7C15), threshold = 0;
+  bool wide_wins = true; // at every size above the current one
+  // largest size first, so that a loss ends the sizes AVX-512 wins from
+  for (int rows = MAX_ROWS; rows >= MIN_ROWS && wide_wins; rows /= 2) {
+    T_DB queries = tuning_random_db(length, rows, &state);
+    T_DB targets = tuning_random_db(length, rows, &state);
+    int *counts = malloc(BitDB_counts_size(queries, targets) * sizeof(int));
+    assert(counts != NULL);
+    // back to back, alternating, so that each tier pays its clock changes
+    double elapsed[2] = {0, 0};
+    const bit_kernel_table *tiers[2] = {bit_kernels_narrow, bit_kernels};
+    for (int round = 0; round < ROUNDS; round++)
+      for (int t = 0; t < 2; t++) {
+        double start = omp_get_wtime();
+        tiers[t]->setop_count_db[BIT_OP_AND](queries, targets, counts, opts);
+        elapsed[t] += omp_get_wtime() - start;
+      }
+    const uint64_t work = (uint64_t)queries->nelem * targets->nelem *
+                          queries->size_in_qwords;
+    if (elapsed[1] <= elapsed[0])
+      threshold = work; // AVX-512 wins from here up
+    else
+      wide_wins = false;
+    if (rows == MAX_ROWS && !wide_wins)
+      threshold = work + 1; // AVX2 wins at every size tried
+    free(counts);
+    BitDB_free(&queries);
+    BitDB_free(&targets);
+  }
+  if (wide_wins)
+    threshold = 0; // AVX-512 wins even at the smallest size
+  Bit_isa_threshold_set(threshold);
+  return threshold;
+}
+
+/* --- 11j''. Output stores of the count kernels --- */
+
+uint64_t Bit_store_threshold_get(void) {
+  init_kernels();
+  return atomic_load_explicit(&bit_store_threshold, memory_order_relaxed);
+}
+
+void Bit_store_threshold_set(uint64_t bytes) {
+  init_kernels();
+  atomic_store_explicit(&bit_store_threshold, bytes, memory_order_relaxed);
+}
+
+uint64_t Bit_parallel_threshold_get(void) {
+  init_kernels();
+  return atomic_load_explicit(&bit_parallel_threshold, memory_order_relaxed);
+}
+
+void Bit_parallel_threshold_set(uint64_t bytes) {
+  init_kernels();
+  atomic_store_explicit(&bit_parallel_threshold, bytes, memory_order_relaxed);
+}
+
+/* --- 11k. Symmetric self-joins --- */
+
+size_t BitDB_self_counts_size(T_DB set, Bit_self_layout layout) {
+  assert(set);
+  size_t n = set->nelem;
+  return layout == BIT_SELF_PACKED ? n * (n + 1) / 2 : n * n;
+}
+
+size_t BitDB_self_counts_offset(T_DB set, int i, int j,
+                                Bit_self_layout layout) {
+  assert(set);
+  assert(i >= 0 && j >= 0);
+  assert((unsigned int)i < set->nelem && (unsigned int)j < set->nelem);
+  if (layout != BIT_SELF_PACKED)
+    return (size_t)i * set->nelem + (size_t)j;
+  if (i > j) {
+    int swap = i;
+    i = j;
+    j = swap;
+  }
+  return self_packed_offset(set->nelem, i, j);
+}
+
+void BitDB_inter_count_self_cpu(T_DB set, int *counts, Bit_self_layout layout,
+                                SETOP_COUNT_OPTS opts) {
+  BIT_PROFILE_CALL(bit_profile_rows_bytes(set, NULL) +
+                   (set ? BitDB_self_counts_size(set, layout) * sizeof(int)
+                        : 0));
+  db_count_self(BIT_OP_AND, set, counts, layout, opts);
+}
+
+void BitDB_union_count_self_cpu(T_DB set, int *counts, Bit_self_layout layout,
+                                SETOP_COUNT_OPTS opts) {
+  BIT_PROFILE_CALL(bit_profile_rows_bytes(set, NULL) +
+                   (set ? BitDB_self_counts_size(set, layout) * sizeof(int)
+                        : 0));
+  db_count_self(BIT_OP_OR, set, counts, layout, opts);
+}
+
+void BitDB_diff_count_self_cpu(T_DB set, int *counts, Bit_self_layout layout,
+                               SETOP_COUNT_OPTS opts) {
+  BIT_PROFILE_CALL(bit_profile_rows_bytes(set, NULL) +
+                   (set ? BitDB_self_counts_size(set, layout) * sizeof(int)
+                        : 0));
+  db_count_self(BIT_OP_XOR, set, counts, layout, opts);
+}
+
+/* --- 11l. Execution contexts --- */
+
+Bit_ctx_T Bit_ctx_new(int num_cpu_threads, int device_id,
+                      const Bit_tuning *tuning) {
+  Bit_ctx_T ctx = calloc(1, sizeof(*ctx));
+  assert(ctx != NULL);
+  ctx->num_cpu_threads =
+      num_cpu_threads > 0 ? num_cpu_threads : omp_get_max_threads();
+  ctx->device_id = device_id;
+  ctx->tuning = tuning ? *tuning : Bit_tuning_get();
+  assert(tuning_valid(ctx->tuning));
+  ctx->nslots = ctx->num_cpu_threads;
+  ctx->scratch = calloc(ctx->nslots, sizeof(*ctx->scratch));
+  ctx->scratch_ints = calloc(ctx->nslots, sizeof(*ctx->scratch_ints));
+  assert(ctx->scratch && ctx->scratch_ints);
+#pragma omp parallel num_threads(ctx->num_cpu_threads)
+  { // start the team now rather than on the first call
+  }
+  return ctx;
+}
+
+SETOP_COUNT_OPTS Bit_ctx_opts(Bit_ctx_T ctx) {
+  assert(ctx);
+  return (SETOP_COUNT_OPTS){.num_cpu_threads = ctx->num_cpu_threads,
+                            .device_id = ctx->device_id,
+                            .tuning = &ctx->tuning,
+                            .ctx = ctx};
+}
+
+int *Bit_ctx_counts(Bit_ctx_T ctx, size_t ncounts) {
+  assert(ctx);
+  if (ctx->counts_ints < ncounts) {
+    const size_t had = ctx->counts_ints * sizeof(int);
+    const size_t want = ncounts * sizeof(int);
+    if (ctx->budget && atomic_load(&ctx->bytes) - had + want > ctx->budget)
+      return NULL; // the buffer kept so far stays valid
+    free(ctx->counts);
+    ctx->counts = malloc(want);
+    assert(ctx->counts != NULL);
+    ctx->counts_ints = ncounts;
+    atomic_fetch_add(&ctx->bytes, want - had);
+    bit_mem_charge(BIT_MEM_RESULTS, (int64_t)want - (int64_t)had);
+  }
+  return ctx->counts;
+}
+
+void Bit_ctx_budget_set(Bit_ctx_T ctx, size_t bytes) {
+  assert(ctx);
+  ctx->budget = bytes;
+}
+
+size_t Bit_ctx_bytes(Bit_ctx_T ctx) {
+  assert(ctx);
+  return atomic_load(&ctx->bytes);
+}
+
+void Bit_ctx_free(Bit_ctx_T *ctx) {
+  assert(ctx && *ctx);
+  const size_t counts = (*ctx)->counts_ints * sizeof(int);
+  bit_mem_charge(BIT_MEM_RESULTS, -(int64_t)counts);
+  bit_mem_charge(BIT_MEM_SCRATCH,
+                 -(int64_t)(atomic_load(&(*ctx)->bytes) - counts));
+  for (int slot = 0; slot < (*ctx)->nslots; slot++)
+    free((*ctx)->scratch[slot]);
+  free((*ctx)->scratch);
+  free((*ctx)->scratch_ints);
+  free((*ctx)->counts);
+  free(*ctx);
+  *ctx = NULL;
+}
+
+/* --- 11m. Single query counts --- */
+
+void BitDB_query_count_store(T q, T_DB db, Bit_count_ops op, int *counts,
+                             SETOP_COUNT_OPTS opts) {
+  assert(q && db);
+  assert(counts != NULL);
+  assert(q->length == db->length);
+  BIT_PROFILE_CALL(bit_profile_bytes(q) + bit_profile_rows_bytes(db, NULL) +
+                   (uint64_t)db->nelem * sizeof(int));
+  if (db->postings != NULL &&
+      db_query_count_postings(count_op_id(op), q, db, counts, opts))
+    return;
+  const uint64_t *a = bit_summary(q);
+  if (a != NULL && db->row_summaries != NULL) {
+    db_query_count_summary(count_op_id(op), q, a, db, counts, opts);
+    return;
+  }
+  bit_kernels_active()->setop_count_query[count_op_id(op)](q, db, counts,
+                                                          opts);
+}
+
+/* --- 11m'. Containment searches --- */
+
+void BitDB_superset_search(T q, T_DB db, const uint32_t *column_counts,
+                           T out, SETOP_COUNT_OPTS opts) {
+  BIT_PROFILE_CALL(bit_profile_bytes(q) + bit_profile_rows_bytes(db, NULL));
+  contain_search(q, db, true, column_counts, out, opts);
+}
+
+void BitDB_subset_search(T q, T_DB db, const uint32_t *column_counts, T out,
+                         SETOP_COUNT_OPTS opts) {
+  BIT_PROFILE_CALL(bit_profile_bytes(q) + bit_profile_rows_bytes(db, NULL));
+  contain_search(q, db, false, column_counts, out, opts);
+}
+
+/* --- 11n. Micro-batching queues --- */
+
+Bit_queue_T BitDB_queue_new(T_DB db, Bit_count_ops op, int max_batch,
+                            double max_wait, SETOP_COUNT_OPTS opts) {
+  assert(db);
+  assert(max_wait >= 0);
+  Bit_queue_T queue = calloc(1, sizeof(*queue));
+  assert(queue != NULL);
+  queue->op = count_op_id(op);
+  queue->db = db;
+  queue->max_batch = max_batch > 0 ? max_batch : bit_tuning_resolve(opts).tile;
+  queue->max_wait = max_wait;
+  queue->opts = opts;
+  omp_init_lock(&queue->lock);
+  return queue;
+}
+
+Bit_query_T BitDB_query_submit(Bit_queue_T queue, T q) {
+  assert(queue && q);
+  assert(q->length == queue->db->length);
+  Bit_query_T ticket = malloc(sizeof(*ticket));
+  assert(ticket != NULL);
+  omp_set_lock(&queue->lock);
+  bit_batch *batch = queue->open;
+  if (batch == NULL) {
+    batch = calloc(1, sizeof(*batch));
+    assert(batch != NULL);
+    batch->rows = BitDB_new(q->length, queue->max_batch);
+    batch->opened = omp_get_wtime();
+    queue->open = batch;
+  }
+  ticket->queue = queue;
+  ticket->batch = batch;
+  ticket->row = batch->nrows++;
+  BitDB_put_at(batch->rows, ticket->row, q);
+  batch->refs++;
+  queue->outstanding++;
+  bool full = batch->nrows == queue->max_batch;
+  if (full)
+    queue->open = NULL;
+  omp_unset_lock(&queue->lock);
+  if (full)
+    queue_run(queue, batch);
+  return ticket;
+}
+
+void BitDB_query_wait(Bit_query_T *ticket, int *counts) {
+  assert(ticket && *ticket);
+  assert(counts != NULL);
+  Bit_queue_T queue = (*ticket)->queue;
+  bit_batch *batch = (*ticket)->batch;
+  size_t n = queue->db->nelem;
+  for (;;) {
+    omp_set_lock(&queue->lock);
+    if (batch->done) {
+      memcpy(counts, batch->counts + (size_t)(*ticket)->row * n,
+             n * sizeof(int));
+      bool last = --batch->refs == 0;
+      queue->outstanding--;
+      omp_unset_lock(&queue->lock);
+      if (last) {
+        BitDB_free(&batch->rows);
+        free(batch->counts);
+        free(batch);
+      }
+      free(*ticket);
+      *ticket = NULL;
+      return;
+    }
+    // a batch that waited long enough is counted by its first waiter
+    bool run = queue->open == batch &&
+               omp_get_wtime() - batch->opened >= queue->max_wait;
+    if (run)
+      queue->open = NULL;
+    omp_unset_lock(&queue->lock);
+    if (run)
+      queue_run(queue, batch);
+    else
+      queue_pause();
+  }
+}
+
+void BitDB_queue_free(Bit_queue_T *queue) {
+  assert(queue && *queue);
+  assert((*queue)->outstanding == 0);
+  omp_destroy_lock(&(*queue)->lock);
+  free(*queue);
+  *queue = NULL;
+}
+
+/* --- 11o. Row order: popcount, Gray code, caller permutation --- */
+
+/* Moves row order[i] of set to row i, for every i, with the caches and the
+   row IDs following the rows */
+static void db_permute(T_DB set, const int *order, SETOP_COUNT_OPTS opts) {
+  int n = (int)set->nelem;
+  size_t row_bytes = set->stride_in_bytes;
+  db_seq_write_begin(set, 0, n); // every row may move
+  unsigned char *rows = malloc((size_t)n * row_bytes);
+  int *moved = malloc((size_t)n * sizeof(int));
+  assert(rows && moved);
+  memcpy(rows, set->bytes, (size_t)n * row_bytes);
+  if (set->changes)
+    set->changes->moved = true;
+#pragma omp parallel for num_threads(cpu_threads(opts)) schedule(static)
+  for (int i = 0; i < n; i++)
+    memcpy(set->bytes + (size_t)i * row_bytes,
+           rows + (size_t)order[i] * row_bytes, row_bytes);
+  int *follow[] = {set->row_counts, set->row_ids};
+  for (size_t f = 0; f < sizeof(follow) / sizeof(follow[0]); f++) {
+    if (follow[f] == NULL)
+      continue;
+    memcpy(moved, follow[f], (size_t)n * sizeof(int));
+    for (int i = 0; i < n; i++)
+      follow[f][i] = moved[order[i]];
+  }
+  for (int i = 0; i < n; i++)
+    if (order[i] != i) {
+      db_summary_rows(set, i, 1);
+      db_mark_dirty(set, i, 1);
+    }
+  db_seq_write_end(set, 0, n);
+  free(rows);
+  free(moved);
+}
+
+void BitDB_sort_by_count(T_DB set, int *perm, SETOP_COUNT_OPTS opts) {
+  assert(set);
+  assert(!set->is_readonly);
+  int n = (int)set->nelem;
+  int *cards = db_row_cards(set, opts);
+  card_row *order = malloc((size_t)n * sizeof(*order));
+  int *rows = perm ? perm : malloc((size_t)n * sizeof(int));
+  assert(order && rows);
+  for (int i = 0; i < n; i++)
+    order[i] = (card_row){cards[i], i};
+  qsort(order, n, sizeof(*order), card_row_compare);
+  for (int i = 0; i < n; i++)
+    rows[i] = order[i].row;
+  db_permute(set, rows, opts);
+  free(cards);
+  free(order);
+  if (rows != perm)
+    free(rows);
+}
+
+void BitDB_reorder(T_DB set, Bit_row_order key, int *perm,
+                   SETOP_COUNT_OPTS opts) {
+  assert(set);
+  assert(!set->is_readonly);
+  assert(key != BIT_ORDER_PERM || perm != NULL);
+  int n = (int)set->nelem;
+  if (set->row_ids == NULL) { // the rows are their own IDs until now
+    set->row_ids =
+        malloc(((size_t)set->capacity ? set->capacity : 1) * sizeof(int));
+    assert(set->row_ids != NULL);
+    for (int i = 0; i < n; i++)
+      set->row_ids[i] = i;
+  }
+  if (key == BIT_ORDER_COUNT) {
+    BitDB_sort_by_count(set, perm, opts);
+    return;
+  }
+  if (key == BIT_ORDER_PERM) {
+    unsigned char *seen = calloc((size_t)n ? (size_t)n : 1, 1);
+    assert(seen != NULL);
+    for (int i = 0; i < n; i++) {
+      assert(perm[i] >= 0 && perm[i] < n && !seen[perm[i]]);
+      seen[perm[i]] = 1;
+    }
+    free(seen);
+    db_permute(set, perm, opts);
+    return;
+  }
+  int *cards = key == BIT_ORDER_COUNT_GRAY ? db_row_cards(set, opts) : NULL;
+  gray_row *order = malloc(((size_t)n ? (size_t)n : 1) * sizeof(*order));
+  int *rows = perm ? perm : malloc(((size_t)n ? (size_t)n : 1) * sizeof(int));
+  assert(order && rows);
+  for (int i = 0; i < n; i++)
+    order[i] = (gray_row){cards ? cards[i] : 0, i,
+                          set->qwords + (size_t)i * set->stride_in_qwords,
+                          set->size_in_qwords};
+  qsort(order, n, sizeof(*order), gray_row_compare);
+  for (int i = 0; i < n; i++)
+    rows[i] = order[i].row;
+  db_permute(set, rows, opts);
+  free(cards);
+  free(order);
+  if (rows != perm)
+    free(rows);
+}
+
+const int *BitDB_row_ids(T_DB set) {
+  assert(set);
+  return set->row_ids;
+}
+
+void BitDB_reset_row_ids(T_DB set) {
+  assert(set);
+  free(set->row_ids);
+  set->row_ids = NULL;
+}
+
+/* --- 11p. Narrow count matrices --- */
+
+Bit_counts_type BitDB_counts_type(T_DB set, Bit_counts_type type) {
+  assert(set);
+  assert(type >= BIT_COUNTS_AUTO && type <= BIT_COUNTS_I32);
+  if (type == BIT_COUNTS_AUTO)
+    return set->length <= UINT8_MAX    ? BIT_COUNTS_U8
+           : set->length <= UINT16_MAX ? BIT_COUNTS_U16
+                                       : BIT_COUNTS_I32;
+  assert(type != BIT_COUNTS_U8 || set->length <= UINT8_MAX);
+  assert(type != BIT_COUNTS_U16 || set->length <= UINT16_MAX);
+  return type;
+}
+
+size_t BitDB_counts_bytes(T_DB bit, T_DB bits, Bit_counts_type type) {
+  static const size_t element[] = {0, sizeof(uint8_t), sizeof(uint16_t),
+                                   sizeof(int)};
+  return BitDB_counts_size(bit, bits) * element[BitDB_counts_type(bit, type)];
+}
+
+Bit_counts_type BitDB_count_store_typed_cpu(T_DB bit, T_DB bits,
+                                            Bit_count_ops op, void *counts,
+                                            Bit_counts_type type,
+                                            SETOP_COUNT_OPTS opts) {
+  SETOP_DB_CHECKS(bit, bits)
+  assert(counts != NULL);
+  bit_setop_id id = count_op_id(op);
+  type = BitDB_counts_type(bit, type);
+  BIT_PROFILE_CALL(bit_profile_rows_bytes(bit, bits) +
+                   BitDB_counts_bytes(bit, bits, type));
+  BIT_CAPTURE_CALL(BIT_CAPTURE_COUNT_CPU, bit, bits, op, 0, 0, type, opts);
+  if (type == BIT_COUNTS_I32) {
+    db_count_store_stoppable(id, bit, bits, counts, opts);
+  } else {
+    assert(opts.bit_hi == 0);
+    typed_store_state state = {bits->nelem, type, counts};
+    const int pinned = count_team_pin(&opts);
+    db_count_tiles(id, bit, bits, opts, typed_store_fold, &state);
+    count_team_unpin(pinned);
+    bit_stop_report(opts.progress, (int)bit->nelem, (int)bit->nelem);
+  }
+  return type;
+}
+
+/* --- 11p'. Count tiles handed to sinks --- */
+
+void BitDB_count_tiles_cpu(T_DB bit, T_DB bits, Bit_count_ops op,
+                           void sink(void *cl, int first_query, int nquery,
+                                     int first_target, int ntarget,
+                                     const int *tile),
+                           void *cl, SETOP_COUNT_OPTS opts) {
+  SETOP_DB_CHECKS(bit, bits)
+  assert(sink != NULL);
+  BIT_PROFILE_CALL(bit_profile_rows_bytes(bit, bits));
+  db_count_tiles(count_op_id(op), bit, bits, opts, sink, cl);
+}
+
+int BitDB_count_store_file_cpu(T_DB bit, T_DB bits, Bit_count_ops op,
+                               Bit_counts_type type, const char *path,
+                               SETOP_COUNT_OPTS opts) {
+  SETOP_DB_CHECKS(bit, bits)
+  assert(path != NULL);
+  bit_setop_id id = count_op_id(op);
+  type = BitDB_counts_type(bit, type);
+#if BIT_DB_MMAP_FILES
+  int fd = open(path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+  if (fd < 0)
+    return -1;
+  file_store_state state = {fd, bits->nelem, type, false};
+  // the file takes its full size up front; tiles then land anywhere in it
+  if (ftruncate(fd, (off_t)BitDB_counts_bytes(bit, bits, type)) != 0)
+    state.failed = true;
+  else
+    db_count_tiles(id, bit, bits, opts, file_store_fold, &state);
+  bool ok = close(fd) == 0 && !state.failed;
+  return ok ? 0 : -1;
+#else
+  (void)id;
+  return -1;
+#endif
+}
+
+int BitDB_count_update_file_cpu(T_DB set, Bit_count_ops op,
+                                Bit_counts_type type, const char *path,
+                                const int rows[], int nrows,
+                                SETOP_COUNT_OPTS opts) {
+  assert(set && path);
+  assert(nrows >= 0 && (rows != NULL || nrows == 0));
+  assert(rows != NULL || set->changes != NULL); // BitDB_track_changes
+  bit_setop_id id = count_op_id(op);
+  type = BitDB_counts_type(set, type);
+#if BIT_DB_MMAP_FILES
+  const size_t n = set->nelem;
+  const size_t size = type == BIT_COUNTS_U8    ? sizeof(uint8_t)
+                      : type == BIT_COUNTS_U16 ? sizeof(uint16_t)
+                                               : sizeof(int);
+  int fd = open(path, O_RDWR);
+  if (fd < 0)
+    return -1;
+  // the file is the square matrix of the rows set had when it was written
+  struct stat st;
+  size_t m = 0;
+  bool ok = fstat(fd, &st) == 0 && (size_t)st.st_size % size == 0;
+  if (ok) {
+    const size_t entries = (size_t)st.st_size / size;
+    m = (size_t)sqrt((double)entries);
+    while (m * m > entries)
+      m--;
+    while ((m + 1) * (m + 1) <= entries)
+      m++;
+    ok = m * m == entries && m <= n;
+  }
+  if (!ok) {
+    close(fd);
+    return -1;
+  }
+
+  // dirty: the rows listed (or logged) and every row appended since
+  unsigned char *is_dirty = calloc(n ? n : 1, 1);
+  int *dirty = malloc((n ? n : 1) * sizeof(int));
+  assert(is_dirty && dirty);
+  for (int k = 0; k < nrows; k++) {
+    assert(rows[k] >= 0 && (size_t)rows[k] < n);
+    is_dirty[rows[k]] = 1;
+  }
+  if (rows == NULL) {
+    const bit_db_changes *log = set->changes;
+    if (log->moved) // every row may have moved
+      memset(is_dirty, 1, n);
+    for (size_t k = 0; k < log->used && !log->moved; k++)
+      if (log->rows[k] < n && changes_live(log, k, set->size_in_qwords))
+        is_dirty[log->rows[k]] = 1;
+  }
+  if (n > m)
+    memset(is_dirty + m, 1, n - m);
+  int ndirty = 0;
+  for (size_t r = 0; r < n; r++)
+    if (is_dirty[r])
+      dirty[ndirty++] = (int)r;
+
+  const size_t bytes = n * n * size;
+  if (bytes > (size_t)st.st_size)
+    ok = ftruncate(fd, (off_t)bytes) == 0;
+  if (ok && bytes > 0) {
+    unsigned char *matrix =
+        mmap(NULL, bytes, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    ok = matrix != MAP_FAILED;
+    if (ok) {
+      // rows of m counts spread out to rows of n, the last first since they
+      // only move up
+      for (size_t i = m; n > m && i-- > 1;)
+        memmove(matrix + i * n * size, matrix + i * m * size, m * size);
+      if (ndirty > 0) {
+        T_DB sub = BitDB_gather(set, dirty, ndirty, NULL, opts);
+        file_update_state state = {matrix,   n, type, dirty,
+                                   is_dirty, op != BIT_COUNT_MINUS, false};
+        db_count_tiles(id, sub, set, opts, file_update_fold, &state);
+        if (op == BIT_COUNT_MINUS) {
+          state.columns = true;
+          db_count_tiles(id, set, sub, opts, file_update_fold, &state);
+        }
+        BitDB_free(&sub);
+      }
+      ok = munmap(matrix, bytes) == 0;
+    }
+  }
+  free(is_dirty);
+  free(dirty);
+  ok = close(fd) == 0 && ok;
+  return ok ? 0 : -1;
+#else
+  (void)id;
+  (void)rows;
+  return -1;
+#endif
+}
+
+void BitDB_count_histogram_cpu(T_DB bit, T_DB bits, Bit_count_ops op,
+                               bool per_query, uint64_t *hist,
+                               SETOP_COUNT_OPTS opts) {
+  SETOP_DB_CHECKS(bit, bits)
+  assert(hist != NULL);
+  BIT_PROFILE_CALL(bit_profile_rows_bytes(bit, bits));
+  const bit_setop_id id = count_op_id(op);
+  const size_t nbins = (size_t)bit->length + 1;
+  if (per_query) {
+    memset(hist, 0, (size_t)bit->nelem * nbins * sizeof(uint64_t));
+    histogram_state state = {hist, nbins, true};
+    db_count_tiles(id, bit, bits, opts, histogram_fold, &state);
+    return;
+  }
+  const int nthreads = cpu_threads(opts);
+  uint64_t *bins = calloc((size_t)nthreads * nbins, sizeof(uint64_t));
+  assert(bins != NULL);
+  histogram_state state = {bins, nbins, false};
+  db_count_tiles(id, bit, bits, opts, histogram_fold, &state);
+  for (size_t b = 0; b < nbins; b++) {
+    uint64_t sum = 0;
+    for (int t = 0; t < nthreads; t++)
+      sum += bins[(size_t)t * nbins + b];
+    hist[b] = sum;
+  }
+  free(bins);
+}
+
+void BitDB_count_stats_cpu(T_DB bit, T_DB bits, Bit_count_ops op,
+                           Bit_count_stats *stats, int *counts,
+                           SETOP_COUNT_OPTS opts) {
+  SETOP_DB_CHECKS(bit, bits)
+  assert(stats != NULL);
+  BIT_PROFILE_CALL(bit_profile_rows_bytes(bit, bits));
+  const size_t nq = bit->nelem;
+  bit_stats_acc *acc = malloc((nq ? nq : 1) * sizeof(*acc));
+  assert(acc != NULL);
+  for (size_t q = 0; q < nq; q++)
+    acc[q] = (bit_stats_acc){0, 0, 0.0, INT_MAX, INT_MIN};
+  stats_state state = {acc, counts, bits->nelem};
+  db_count_tiles(count_op_id(op), bit, bits, opts, stats_fold, &state);
+  for (size_t q = 0; q < nq; q++)
+    bit_stats_finish(&acc[q], &stats[q]);
+  free(acc);
+}
+
+/* --- 11p''. Tiled count files --- */
+
+int BitDB_count_store_tiled_cpu(T_DB bit, T_DB bits, Bit_count_ops op,
+                                Bit_counts_type type, const char *path,
+                                int flags, SETOP_COUNT_OPTS opts) {
+  SETOP_DB_CHECKS(bit, bits)
+  assert(path != NULL);
+  assert((flags & ~BIT_TILES_COMPRESSED) == 0);
+  bit_setop_id id = count_op_id(op);
+  type = BitDB_counts_type(bit, type);
+#if BIT_DB_MMAP_FILES
+  const size_t size = counts_size(type);
+  const size_t tb = (BIT_TILE_ROWS * BIT_TILE_COLS * size + 63) / 64 * 64;
+  const size_t nrows = (bit->nelem + BIT_TILE_ROWS - 1) / BIT_TILE_ROWS;
+  const size_t ncols = (bits->nelem + BIT_TILE_COLS - 1) / BIT_TILE_COLS;
+  const size_t ntiles = nrows * ncols;
+  int fd = open(path, O_RDWR | O_CREAT | O_TRUNC, 0644);
+  if (fd < 0)
+    return -1;
+  tiled_store_state state = {.fd = fd, .ncols = ncols, .tile_bytes = tb,
+                             .type = type};
+  bit_tile_file_header header = {.magic = BIT_TILE_FILE_MAGIC,
+                                 .byte_order = BIT_DB_FILE_BYTE_ORDER,
+                                 .version = BIT_TILE_FILE_VERSION,
+                                 .header_size = BIT_DB_FILE_HEADER_SIZE,
+                                 .nqueries = bit->nelem,
+                                 .ntargets = bits->nelem,
+                                 .tile_rows = BIT_TILE_ROWS,
+                                 .tile_cols = BIT_TILE_COLS,
+                                 .count_type = (uint32_t)type,
+                                 .count_size = (uint32_t)size,
+                                 .tile_bytes = tb};
+  bool ok = true;
+  if (flags & BIT_TILES_COMPRESSED) {
+    state.index = calloc(ntiles, sizeof(bit_db_zblock));
+    assert(state.index != NULL);
+    atomic_init(&state.end, BIT_DB_FILE_HEADER_SIZE);
+    db_count_tiles(id, bit, bits, opts, tiled_store_fold, &state);
+    // the index follows the last tile, qword aligned for readers that map it
+    header.index_offset = (atomic_load(&state.end) + 7) / 8 * 8;
+    ok = !atomic_load(&state.failed) &&
+         writer_pwrite(fd, state.index, ntiles * sizeof(bit_db_zblock),
+                       (off_t)header.index_offset);
+    free(state.index);
+  } else {
+    const size_t bytes = BIT_DB_FILE_HEADER_SIZE + ntiles * tb;
+    ok = ftruncate(fd, (off_t)bytes) == 0;
+    void *mapping = ok ? mmap(NULL, bytes, PROT_READ | PROT_WRITE, MAP_SHARED,
+                              fd, 0)
+                       : MAP_FAILED;
+    ok = mapping != MAP_FAILED;
+    if (ok) {
+      state.mapping = mapping;
+      db_count_tiles(id, bit, bits, opts, tiled_store_fold, &state);
+      ok = munmap(mapping, bytes) == 0;
+    }
+  }
+  // the header goes last: a file cut short never passes for a whole one
+  header.header_checksum =
+      db_checksum(&header, offsetof(bit_tile_file_header, header_checksum));
+  ok = ok && writer_pwrite(fd, &header, sizeof(header), 0);
+  ok = close(fd) == 0 && ok;
+  return ok ? 0 : -1;
+#else
+  (void)id, (void)flags;
+  return -1;
+#endif
+}
+
+Bit_tiles_T BitDB_tiles_open(const char *path) {
+  assert(path != NULL);
+#if BIT_DB_MMAP_FILES
+  int fd = open(path, O_RDONLY);
+  if (fd < 0)
+    return NULL;
+  struct stat st;
+  void *mapping = MAP_FAILED;
+  if (fstat(fd, &st) == 0 && (size_t)st.st_size >= BIT_DB_FILE_HEADER_SIZE)
+    mapping = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+  close(fd); // the mapping keeps the file
+  if (mapping == MAP_FAILED)
+    return NULL;
+  // Trust the fields only once the header checks out
+  const size_t bytes = (size_t)st.st_size;
+  const bit_tile_file_header *h = mapping;
+  const uint64_t nrows = h->tile_rows ? (h->nqueries + h->tile_rows - 1) /
+                                            h->tile_rows
+                                      : 0;
+  const uint64_t ncols = h->tile_cols ? (h->ntargets + h->tile_cols - 1) /
+                                            h->tile_cols
+                                      : 0;
+  bool valid =
+      memcmp(h->magic, BIT_TILE_FILE_MAGIC, sizeof(BIT_TILE_FILE_MAGIC)) ==
+          0 &&
+      h->byte_order == BIT_DB_FILE_BYTE_ORDER &&
+      h->version == BIT_TILE_FILE_VERSION &&
+      h->header_checksum ==
+          db_checksum(h, offsetof(bit_tile_file_header, header_checksum)) &&
+      h->header_size == BIT_DB_FILE_HEADER_SIZE &&
+      h->nqueries > 0 && h->nqueries < INT_MAX && h->ntargets > 0 &&
+      h->ntargets < INT_MAX && h->tile_rows > 0 && h->tile_cols > 0 &&
+      h->count_type >= BIT_COUNTS_U8 && h->count_type <= BIT_COUNTS_I32 &&
+      h->count_size == counts_size((Bit_counts_type)h->count_type) &&
+      h->tile_bytes % 64 == 0 &&
+      h->tile_bytes >= (uint64_t)h->tile_rows * h->tile_cols * h->count_size &&
+      h->tile_bytes <= UINT32_MAX;
+  const uint64_t ntiles = nrows * ncols;
+  const bit_db_zblock *index = NULL;
+  if (valid && h->index_offset == 0) { // raw tiles, all in place
+    valid = ntiles <= (bytes - h->header_size) / h->tile_bytes;
+  } else if (valid) {
+    valid = h->index_offset % 8 == 0 && h->index_offset <= bytes &&
+            (bytes - h->index_offset) / sizeof(bit_db_zblock) >= ntiles;
+    index = (const bit_db_zblock *)((const unsigned char *)mapping +
+                                    (valid ? h->index_offset : 0));
+    // every tile lies between the header and the index
+    for (uint64_t t = 0; valid && t < ntiles; t++)
+      valid = index[t].offset >= h->header_size &&
+              index[t].offset <= h->index_offset &&
+              index[t].bytes <= h->index_offset - index[t].offset &&
+              (index[t].codec == BIT_DB_ZBLOCK_BYTES
+                   ? index[t].bytes >= h->tile_bytes / 8
+                   : index[t].codec == BIT_DB_ZBLOCK_RAW &&
+                         index[t].bytes == h->tile_bytes);
+  }
+  if (!valid) {
+    munmap(mapping, bytes);
+    return NULL;
+  }
+  Bit_tiles_T tiles = calloc(1, sizeof(*tiles));
+  assert(tiles != NULL);
+  tiles->mapping = mapping;
+  tiles->bytes = bytes;
+  tiles->header = h;
+  tiles->index = index;
+  tiles->ncols = (size_t)ncols;
+  return tiles;
+#else
+  return NULL;
+#endif
+}
+
+void BitDB_tiles_close(Bit_tiles_T *tiles) {
+  assert(tiles && *tiles);
+#if BIT_DB_MMAP_FILES
+  munmap((*tiles)->mapping, (*tiles)->bytes);
+#endif
+  free(*tiles);
+  *tiles = NULL;
+}
+
+Bit_counts_type BitDB_tiles_size(Bit_tiles_T tiles, int *nqueries,
+                                 int *ntargets, int *tile_rows,
+                                 int *tile_cols) {
+  assert(tiles);
+  const bit_tile_file_header *h = tiles->header;
+  if (nqueries)
+    *nqueries = (int)h->nqueries;
+  if (ntargets)
+    *ntargets = (int)h->ntargets;
+  if (tile_rows)
+    *tile_rows = (int)h->tile_rows;
+  if (tile_cols)
+    *tile_cols = (int)h->tile_cols;
+  return (Bit_counts_type)h->count_type;
+}
+
+int BitDB_tiles_get(Bit_tiles_T tiles, int query, int target) {
+  assert(tiles);
+  const bit_tile_file_header *h = tiles->header;
+  assert(query >= 0 && (uint64_t)query < h->nqueries);
+  assert(target >= 0 && (uint64_t)target < h->ntargets);
+  const size_t t = (size_t)query / h->tile_rows * tiles->ncols +
+                   (size_t)target / h->tile_cols;
+  const size_t at = ((size_t)query % h->tile_rows * h->tile_cols +
+                     (size_t)target % h->tile_cols) *
+                    h->count_size;
+  unsigned char count[sizeof(uint64_t)];
+  if (tiles->index == NULL) {
+    memcpy(count,
+           (const unsigned char *)tiles->mapping + h->header_size +
+               t * h->tile_bytes + at,
+           h->count_size);
+  } else { // counts never straddle a qword
+    uint64_t w = tiles_zqword(tiles, t, at / 8);
+    memcpy(count, (const unsigned char *)&w + at % 8, h->count_size);
+  }
+  if (h->count_type == BIT_COUNTS_U8)
+    return count[0];
+  if (h->count_type == BIT_COUNTS_U16) {
+    uint16_t c;
+    memcpy(&c, count, sizeof(c));
+    return c;
+  }
+  int c;
+  memcpy(&c, count, sizeof(c));
+  return c;
+}
+
+int BitDB_tiles_block(Bit_tiles_T tiles, int row, int col, int *counts) {
+  assert(tiles);
+  assert(counts != NULL);
+  const bit_tile_file_header *h = tiles->header;
+  const uint64_t nrows = (h->nqueries + h->tile_rows - 1) / h->tile_rows;
+  assert(row >= 0 && (uint64_t)row < nrows);
+  assert(col >= 0 && (size_t)col < tiles->ncols);
+  (void)nrows;
+  unsigned char *tile = portable_aligned_calloc(64, h->tile_bytes);
+  assert(tile != NULL);
+  if (!tiles_load(tiles, (size_t)row * tiles->ncols + (size_t)col, tile)) {
+    portable_aligned_free(tile);
+    return -1;
+  }
+  const size_t n = (size_t)h->tile_rows * h->tile_cols;
+  if (h->count_type == BIT_COUNTS_U8) {
+    OMP_CPU_SIMD
+    for (size_t i = 0; i < n; i++)
+      counts[i] = tile[i];
+  } else if (h->count_type == BIT_COUNTS_U16) {
+    const uint16_t *c = (const uint16_t *)tile;
+    OMP_CPU_SIMD
+    for (size_t i = 0; i < n; i++)
+      counts[i] = c[i];
+  } else {
+    memcpy(counts, tile, n * sizeof(int));
+  }
+  portable_aligned_free(tile);
+  return 0;
+}
+
+/* --- 11q. Row deduplication --- */
+
+T_DB BitDB_dedup(T_DB set, int *map, SETOP_COUNT_OPTS opts) {
+  assert(set && map);
+  assert(set->nelem > 0);
+  const int n = (int)set->nelem;
+  uint64_t *hashes = malloc((size_t)n * sizeof(uint64_t));
+  hash_row *order = malloc((size_t)n * sizeof(hash_row));
+  int *groups = malloc(((size_t)n + 1) * sizeof(int));
+  assert(hashes && order && groups);
+  BitDB_hash_rows(set, 0, hashes, opts);
+  for (int i = 0; i < n; i++)
+    order[i] = (hash_row){hashes[i], i};
+  qsort(order, n, sizeof(*order), hash_row_compare);
+  int ngroups = 0;
+  for (int i = 0; i < n; i++)
+    if (i == 0 || order[i].hash != order[i - 1].hash)
+      groups[ngroups++] = i;
+  groups[ngroups] = n;
+
+  // map[i]: the first row equal to row i, found within its hash group
+#pragma omp parallel for num_threads(cpu_threads(opts)) schedule(dynamic, 64)
+  for (int g = 0; g < ngroups; g++)
+    for (int a = groups[g]; a < groups[g + 1]; a++) {
+      const int row = order[a].row;
+      map[row] = row;
+      for (int b = groups[g]; b < a; b++) {
+        const int other = order[b].row;
+        if (map[other] == other &&
+            memcmp(set->bytes + (size_t)row * set->stride_in_bytes,
+                   set->bytes + (size_t)other * set->stride_in_bytes,
+                   set->size_in_bytes) == 0) {
+          map[row] = other;
+          break;
+        }
+      }
+    }
+
+  // number the distinct rows in order of first appearance
+  int *firsts = groups; // the first row of every distinct row
+  int nunique = 0;
+  for (int i = 0; i < n; i++)
+    if (map[i] == i) {
+      firsts[nunique] = i;
+      map[i] = nunique++;
+    } else {
+      map[i] = map[map[i]]; // map[i] < i is numbered already
+    }
+  T_DB unique = BitDB_new((int)set->length, nunique);
+#pragma omp parallel for num_threads(cpu_threads(opts)) schedule(static)
+  for (int u = 0; u < nunique; u++)
+    memcpy(unique->bytes + (size_t)u * unique->stride_in_bytes,
+           set->bytes + (size_t)firsts[u] * set->stride_in_bytes,
+           set->size_in_bytes);
+  free(hashes);
+  free(order);
+  free(groups);
+  return unique;
+}
+
+void BitDB_dedup_expand_counts(const int *counts, int nunique,
+                               const int *row_map, int nrows,
+                               const int *col_map, int ncols, int *out,
+                               SETOP_COUNT_OPTS opts) {
+  assert(counts && out);
+  assert(nunique > 0 && nrows >= 0 && ncols >= 0);
+#pragma omp parallel for num_threads(cpu_threads(opts)) schedule(static)
+  for (int i = 0; i < nrows; i++) {
+    const int *from = counts + (size_t)(row_map ? row_map[i] : i) * nunique;
+    int *to = out + (size_t)i * ncols;
+    if (col_map == NULL)
+      memcpy(to, from, (size_t)ncols * sizeof(int));
+    else
+      for (int j = 0; j < ncols; j++)
+        to[j] = from[col_map[j]];
+  }
+}
+
+void BitDB_dedup_expand_topk(const int *idx, const int *count, int k,
+                             const int *row_map, int nrows,
+                             const int *col_map, int ncols, int *out_idx,
+                             int *out_count) {
+  assert(idx && count && out_idx && out_count);
+  assert(k > 0 && nrows >= 0 && ncols >= 0);
+  dedup_members members = dedup_members_new(col_map, ncols);
+#pragma omp parallel
+  {
+    dedup_match *run = NULL; // the targets of a run of equal counts
+    size_t room = 0;
+#pragma omp for schedule(static)
+    for (int i = 0; i < nrows; i++) {
+      const int q = row_map ? row_map[i] : i;
+      const int *uidx = idx + (size_t)q * k, *ucount = count + (size_t)q * k;
+      int *oidx = out_idx + (size_t)i * k, *ocount = out_count + (size_t)i * k;
+      int filled = 0;
+      /* the distinct targets come by decreasing count and, within a count,
+         by increasing first row, so the k best rows are among their first
+         k - filled rows, and only a run of equal counts needs sorting */
+      for (int r = 0, end; r < k && uidx[r] >= 0 && filled < k; r = end) {
+        size_t nrun = 0;
+        for (end = r; end < k && uidx[end] >= 0 && ucount[end] == ucount[r];
+             end++) {
+          const int u = uidx[end];
+          const int lo = members.offsets[u];
+          const int take = members.offsets[u + 1] - lo < k - filled
+                               ? members.offsets[u + 1] - lo
+                               : k - filled;
+          if (nrun + (size_t)take > room) {
+            room = 2 * (nrun + (size_t)take);
+            run = realloc(run, room * sizeof(dedup_match));
+            assert(run != NULL);
+          }
+          for (int m = 0; m < take; m++)
+            run[nrun++] = (dedup_match){members.rows[lo + m], ucount[r]};
+        }
+        qsort(run, nrun, sizeof(*run), dedup_match_by_idx);
+        for (size_t m = 0; m < nrun && filled < k; m++, filled++) {
+          oidx[filled] = run[m].idx;
+          ocount[filled] = run[m].count;
+        }
+      }
+      for (; filled < k; filled++)
+        oidx[filled] = ocount[filled] = -1;
+    }
+    free(run);
+  }
+  dedup_members_free(&members);
+}
+
+size_t BitDB_dedup_expand_threshold(const size_t *offsets, const int *idx,
+                                    const int *count, const int *row_map,
+                                    int nrows, const int *col_map, int ncols,
+                                    size_t *out_offsets, int **out_idx,
+                                    int **out_count) {
+  assert(offsets && idx && count && out_offsets && out_idx && out_count);
+  assert(nrows >= 0 && ncols >= 0);
+  dedup_members members = dedup_members_new(col_map, ncols);
+  out_offsets[0] = 0;
+#pragma omp parallel for schedule(static)
+  for (int i = 0; i < nrows; i++) {
+    const int q = row_map ? row_map[i] : i;
+    size_t total = 0;
+    for (size_t m = offsets[q]; m < offsets[q + 1]; m++)
+      total += (size_t)(members.offsets[idx[m] + 1] - members.offsets[idx[m]]);
+    out_offsets[i + 1] = total;
+  }
+  for (int i = 0; i < nrows; i++)
+    out_offsets[i + 1] += out_offsets[i];
+  const size_t nmatches = out_offsets[nrows];
+  dedup_match *matches =
+      malloc((nmatches ? nmatches : 1) * sizeof(dedup_match));
+  *out_idx = malloc((nmatches ? nmatches : 1) * sizeof(int));
+  *out_count = malloc((nmatches ? nmatches : 1) * sizeof(int));
+  assert(matches && *out_idx && *out_count);
+#pragma omp parallel for schedule(dynamic, 16)
+  for (int i = 0; i < nrows; i++) {
+    const int q = row_map ? row_map[i] : i;
+    dedup_match *mine = matches + out_offsets[i];
+    size_t n = 0;
+    for (size_t m = offsets[q]; m < offsets[q + 1]; m++)
+      for (int r = members.offsets[idx[m]]; r < members.offsets[idx[m] + 1];
+           r++)
+        mine[n++] = (dedup_match){members.rows[r], count[m]};
+    qsort(mine, n, sizeof(*mine), dedup_match_by_idx);
+    for (size_t m = 0; m < n; m++) {
+      (*out_idx)[out_offsets[i] + m] = mine[m].idx;
+      (*out_count)[out_offsets[i] + m] = mine[m].count;
+    }
+  }
+  free(matches);
+  dedup_members_free(&members);
+  return nmatches;
+}
+
+/* --- 11q'. Cancellation and deadlines of count stores --- */
+
+Bit_cancel_T Bit_cancel_new(void) {
+  Bit_cancel_T token = malloc(sizeof(*token));
+  assert(token != NULL);
+  atomic_init(&token->requested, false);
+  return token;
+}
+
+void Bit_cancel_request(Bit_cancel_T token) {
+  assert(token);
+  atomic_store_explicit(&token->requested, true, memory_order_relaxed);
+}
+
+bool Bit_cancel_requested(Bit_cancel_T token) {
+  assert(token);
+  return atomic_load_explicit(&token->requested, memory_order_relaxed);
+}
+
+void Bit_cancel_reset(Bit_cancel_T token) {
+  assert(token);
+  atomic_store_explicit(&token->requested, false, memory_order_relaxed);
+}
+
+void Bit_cancel_free(Bit_cancel_T *token) {
+  assert(token && *token);
+  free(*token);
+  *token = NULL;
+}
+
+/* --- 11q''. Thread affinity of count stores --- */
+
+int Bit_affinity_cpus(const Bit_affinity *affinity, int cpus[], int max) {
+  assert(affinity && (cpus || max <= 0));
+#if BIT_DB_MREMAP
+  int *all = malloc(CPU_SETSIZE * sizeof(int));
+  assert(all != NULL);
+  const int n = affinity_resolve(affinity, all);
+  if (max > 0)
+    memcpy(cpus, all, (size_t)(n < max ? n : max) * sizeof(int));
+  free(all);
+  return n;
+#else
+  assert(affinity->ncpus >= 0 && (affinity->cpus || !affinity->ncpus));
+  return 0;
+#endif
+}
+
+/* --- 11y''. Workload capture ---
+   A capture file is a capture_header, then one Bit_capture_record per
+   call in the order the calls returned. capture_state is 0 until the first
+   recorded function looked at BIT_CAPTURE_FILE, then 1 (off) or 2 (on);
+   the lock guards the file, the record count and the thread numbers.
+*/
+
+#define CAPTURE_MAGIC "BITCAP01"
+
+typedef struct {
+  char magic[8];         // CAPTURE_MAGIC
+  uint32_t record_bytes; // sizeof(Bit_capture_record)
+  uint32_t flags;        // of Bit_capture_start
+} capture_header;
+
+static _Atomic int capture_state;
+static _Atomic bool capture_env_seen;
+static omp_lock_t capture_lock;
+static _Atomic bool capture_lock_ready;
+static FILE *capture_file;
+static unsigned int capture_flags;
+static uint64_t capture_epoch_ns;  // clock at Bit_capture_start
+static int64_t capture_records;    // written, -1 after a failed write
+static uint32_t capture_threads;   // threads numbered so far
+static uint64_t capture_generation; // bumped by every Bit_capture_start
+static _Thread_local int capture_depth;
+static _Thread_local uint32_t capture_thread;
+static _Thread_local uint64_t capture_thread_generation;
+
+static uint64_t capture_clock(void) {
+  struct timespec now;
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  return (uint64_t)now.tv_sec * UINT64_C(1000000000) + (uint64_t)now.tv_nsec;
+}
+
+static void capture_at_exit(void) {
+  if (atomic_load(&capture_state) == 2)
+    (void)Bit_capture_stop();
+}
+
+/* Starts the capture of BIT_CAPTURE_FILE, once per process */
+static void capture_from_env(void) {
+  if (atomic_exchange(&capture_env_seen, true))
+    return;
+  const char *path = getenv("BIT_CAPTURE_FILE");
+  const char *data = getenv("BIT_CAPTURE_DATA");
+  if (path && *path &&
+      Bit_capture_start(path, data && atoi(data) ? BIT_CAPTURE_DATA : 0)) {
+    atexit(capture_at_exit);
+    return;
+  }
+  int unknown = 0;
+  atomic_compare_exchange_strong(&capture_state, &unknown, 1);
+}
+
+/* Set bits and row hash of a container, for BIT_CAPTURE_DATA */
+static void capture_data(T_DB set, SETOP_COUNT_OPTS opts, uint64_t *ones,
+                         uint64_t *hash) {
+  const bit_kernel_table *k = bit_kernels_active();
+  uint64_t *hashes = malloc((set->nelem ? set->nelem : 1) * sizeof(uint64_t));
+  assert(hashes != NULL);
+  BitDB_hash_rows(set, 0, hashes, opts);
+  uint64_t n = 0, h = UINT64_C(0xcbf29ce484222325);
+  for (unsigned int r = 0; r < set->nelem; r++) {
+    n += (uint64_t)k->count_qwords(set->qwords + (size_t)r *
+                                                     set->stride_in_qwords,
+                                   set->size_in_qwords);
+    h = (h ^ hashes[r]) * UINT64_C(0x100000001b3);
+  }
+  free(hashes);
+  *ones = n;
+  *hash = h;
+}
+
+bit_capture_scope bit_capture_enter(Bit_capture_call call, T_DB bit,
+                                    T_DB bits, int op, int k, float cutoff,
+                                    int counts_type, SETOP_COUNT_OPTS opts) {
+  bit_capture_scope scope = {.active = false};
+  int state = atomic_load_explicit(&capture_state, memory_order_relaxed);
+  if (state == 0) {
+    capture_from_env();
+    state = atomic_load(&capture_state);
+  }
+  if (state != 2)
+    return scope;
+  scope.counted = true;
+  if (capture_depth++ > 0)
+    return scope;
+  Bit_capture_record *r = &scope.record;
+  r->call = (uint16_t)call;
+  r->op = (uint16_t)op;
+  r->nqueries = bit ? bit->nelem : 0;
+  r->ntargets = bits ? bits->nelem : 0;
+  r->length = bit ? bit->length : 0;
+  r->k = k;
+  r->cutoff = cutoff;
+  r->num_cpu_threads = opts.num_cpu_threads;
+  r->device_id = opts.device_id;
+  r->bit_lo = opts.bit_lo;
+  r->bit_hi = opts.bit_hi;
+  r->algorithm = (uint8_t)opts.algorithm;
+  r->isa = (uint8_t)opts.isa;
+  r->store = (uint8_t)opts.store;
+  r->exec = (uint8_t)opts.exec;
+  r->counts_type = (uint8_t)counts_type;
+  r->self = bit == bits;
+  if ((capture_flags & BIT_CAPTURE_DATA) && bit && bits) {
+    capture_data(bit, opts, &r->ones_q, &r->hash_q);
+    if (bits == bit) {
+      r->ones_t = r->ones_q;
+      r->hash_t = r->hash_q;
+    } else {
+      capture_data(bits, opts, &r->ones_t, &r->hash_t);
+    }
+  }
+  scope.active = true;
+  r->start_ns = capture_clock(); // set last: the data pass is not timed
+  return scope;
+}
+
+void bit_capture_leave(bit_capture_scope *scope) {
+  if (!scope->counted)
+    return;
+  capture_depth--;
+  if (!scope->active)
+    return;
+  Bit_capture_record *r = &scope->record;
+  const uint64_t end = capture_clock();
+  r->elapsed_ns = end - r->start_ns;
+  omp_set_lock(&capture_lock);
+  if (capture_file != NULL) { // the capture may have stopped meanwhile
+    if (capture_thread_generation != capture_generation) {
+      capture_thread_generation = capture_generation;
+      capture_thread = capture_threads++;
+    }
+    r->thread = capture_thread;
+    r->start_ns = r->start_ns > capture_epoch_ns
+                      ? r->start_ns - capture_epoch_ns
+                      : 0;
+    if (capture_records >= 0)
+      capture_records = fwrite(r, sizeof(*r), 1, capture_file) == 1
+                            ? capture_records + 1
+                            : -1;
+  }
+  omp_unset_lock(&capture_lock);
+}
+
+bool Bit_capture_start(const char *path, unsigned int flags) {
+  assert(path);
+  assert((flags & ~BIT_CAPTURE_DATA) == 0);
+  if (!atomic_exchange(&capture_lock_ready, true))
+    omp_init_lock(&capture_lock);
+  omp_set_lock(&capture_lock);
+  assert(capture_file == NULL);
+  FILE *file = fopen(path, "wb");
+  capture_header header = {.record_bytes = sizeof(Bit_capture_record),
+                           .flags = flags};
+  memcpy(header.magic, CAPTURE_MAGIC, sizeof(header.magic));
+  if (file && fwrite(&header, sizeof(header), 1, file) != 1) {
+    fclose(file);
+    file = NULL;
+  }
+  if (file) {
+    capture_file = file;
+    capture_flags = flags;
+    capture_records = 0;
+    capture_threads = 0;
+    capture_generation++;
+    capture_epoch_ns = capture_clock();
+    atomic_store(&capture_env_seen, true); // an explicit capture wins
+    atomic_store(&capture_state, 2);
+  }
+  omp_unset_lock(&capture_lock);
+  return file != NULL;
+}
+
+int64_t Bit_capture_stop(void) {
+  assert(atomic_load(&capture_lock_ready));
+  omp_set_lock(&capture_lock);
+  assert(capture_file != NULL);
+  atomic_store(&capture_state, 1);
+  int64_t written = capture_records;
+  if (fclose(capture_file) != 0)
+    written = -1;
+  capture_file = NULL;
+  omp_unset_lock(&capture_lock);
+  return written;
+}
+
+Bit_capture_record *Bit_capture_load(const char *path, size_t *n,
+                                     unsigned int *flags) {
+  assert(path && n);
+  *n = 0;
+  FILE *file = fopen(path, "rb");
+  if (file == NULL)
+    return NULL;
+  capture_header header;
+  Bit_capture_record *records = NULL;
+  if (fread(&header, sizeof(header), 1, file) == 1 &&
+      memcmp(header.magic, CAPTURE_MAGIC, sizeof(header.magic)) == 0 &&
+      header.record_bytes == sizeof(Bit_capture_record)) {
+    size_t count = 0, room = 1024;
+    records = malloc(room * sizeof(*records));
+    assert(records != NULL);
+    while (fread(records + count, sizeof(*records), 1, file) == 1) {
+      if (++count == room) {
+        room *= 2;
+        records = realloc(records, room * sizeof(*records));
+        assert(records != NULL);
+      }
+    }
+    *n = count;
+    if (flags)
+      *flags = header.flags;
+  }
+  fclose(file);
+  return records;
+}
+
+/* --- 11y'''. Memory accounting ---
+   One counter and one high-water mark per host category, and the same for
+   their sum, all relaxed atomics: a charge is a fetch-add, and raising a
+   mark a compare-exchange only when the count passes it. Counts are
+   signed so that a release racing ahead of its charge stays consistent.
+*/
+
+static _Atomic int64_t mem_bytes[BIT_MEM_CATEGORIES];
+static _Atomic int64_t mem_peak[BIT_MEM_CATEGORIES];
+static _Atomic int64_t mem_host_bytes, mem_host_peak;
+
+static void mem_raise(_Atomic int64_t *peak, int64_t now) {
+  int64_t seen = atomic_load_explicit(peak, memory_order_relaxed);
+  while (now > seen &&
+         !atomic_compare_exchange_weak_explicit(peak, &seen, now,
+                                                memory_order_relaxed,
+                                                memory_order_relaxed))
+    ;
+}
+
+static size_t mem_read(_Atomic int64_t *counter) {
+  const int64_t bytes = atomic_load_explicit(counter, memory_order_relaxed);
+  return bytes > 0 ? (size_t)bytes : 0;
+}
+
+void bit_mem_charge(Bit_mem_category category, int64_t delta) {
+  assert(category >= BIT_MEM_BITSETS && category < BIT_MEM_DEVICE);
+  if (delta == 0)
+    return;
+  const int64_t bytes = atomic_fetch_add_explicit(&mem_bytes[category], delta,
+                                                  memory_order_relaxed) +
+                        delta;
+  const int64_t host = atomic_fetch_add_explicit(&mem_host_bytes, delta,
+                                                 memory_order_relaxed) +
+                       delta;
+  if (delta > 0) {
+    mem_raise(&mem_peak[category], bytes);
+    mem_raise(&mem_host_peak, host);
+  }
+}
+
+void Bit_memory_stats(Bit_mem_stats *stats) {
+  assert(stats);
+  memset(stats, 0, sizeof(*stats));
+  for (int c = BIT_MEM_BITSETS; c < BIT_MEM_DEVICE; c++) {
+    stats->bytes[c] = mem_read(&mem_bytes[c]);
+    stats->peak[c] = mem_read(&mem_peak[c]);
+  }
+  stats->host_bytes = mem_read(&mem_host_bytes);
+  stats->host_peak = mem_read(&mem_host_peak);
+  bit_mem_devices(stats, false);
+}
+
+void Bit_memory_reset_peaks(void) {
+  for (int c = BIT_MEM_BITSETS; c < BIT_MEM_DEVICE; c++)
+    atomic_store_explicit(&mem_peak[c],
+                          atomic_load_explicit(&mem_bytes[c],
+                                               memory_order_relaxed),
+                          memory_order_relaxed);
+  atomic_store_explicit(&mem_host_peak,
+                        atomic_load_explicit(&mem_host_bytes,
+                                             memory_order_relaxed),
+                        memory_order_relaxed);
+  Bit_mem_stats devices;
+  bit_mem_devices(&devices, true);
+}
+
+/* --- 11z. Hot-path profile --- */
+
+#if defined(BIT_PROFILE) && (BIT_PROFILE)
+bit_profile_site *_Atomic bit_profile_sites;
+bit_profile_path_counts bit_profile_paths;
+
+static int stats_call_cmp(const void *a, const void *b) {
+  return strcmp(((const Bit_stats_call *)a)->name,
+                ((const Bit_stats_call *)b)->name);
+}
+#endif
+
+Bit_stats Bit_stats_snapshot(void) {
+  const bit_kernel_table *k = bit_kernels_active();
+  Bit_stats stats = {.isa = k->isa, .simd = k->simd, .ticks_unit = ""};
+#if defined(BIT_PROFILE) && (BIT_PROFILE)
+#define STAT_LOAD(counter) atomic_load_explicit(&counter, memory_order_relaxed)
+  stats.enabled = true;
+  stats.ticks_unit = BIT_PROFILE_TICKS;
+  for (bit_profile_site *site = atomic_load(&bit_profile_sites);
+       site && stats.ncalls < BIT_STATS_CALLS; site = site->next) {
+    Bit_stats_call call = {site->name, STAT_LOAD(site->calls),
+                           STAT_LOAD(site->ticks), STAT_LOAD(site->bytes)};
+    if (call.calls)
+      stats.calls[stats.ncalls++] = call;
+  }
+  qsort(stats.calls, stats.ncalls, sizeof(Bit_stats_call), stats_call_cmp);
+  stats.db_aligned = STAT_LOAD(bit_profile_paths.db_loads[1]);
+  stats.db_unaligned = STAT_LOAD(bit_profile_paths.db_loads[0]);
+  stats.setop_aligned = STAT_LOAD(bit_profile_paths.setop_loads[1]);
+  stats.setop_unaligned = STAT_LOAD(bit_profile_paths.setop_loads[0]);
+  for (int block = 0; block < BIT_TUNING_BLOCK_COUNT; block++)
+    stats.blocks[block] = STAT_LOAD(bit_profile_paths.blocks[block]);
+#undef STAT_LOAD
+#endif
+  return stats;
+}
+
+void Bit_stats_reset(void) {
+#if defined(BIT_PROFILE) && (BIT_PROFILE)
+#define STAT_CLEAR(counter)                                                    \
+  atomic_store_explicit(&counter, 0, memory_order_relaxed)
+  for (bit_profile_site *site = atomic_load(&bit_profile_sites); site;
+       site = site->next) {
+    STAT_CLEAR(site->calls);
+    STAT_CLEAR(site->ticks);
+    STAT_CLEAR(site->bytes);
+  }
+  for (int path = 0; path < 2; path++) {
+    STAT_CLEAR(bit_profile_paths.db_loads[path]);
+    STAT_CLEAR(bit_profile_paths.setop_loads[path]);
+  }
+  for (int block = 0; block < BIT_TUNING_BLOCK_COUNT; block++)
+    STAT_CLEAR(bit_profile_paths.blocks[block]);
+#undef STAT_CLEAR
+#endif
 }
 
 /* --- End Section 11: PUBLIC API — BITSET DATABASE --- */
@@ -0,0 +1,396 @@
+/*
+    Apache Arrow C Data Interface import and export of Bit_T and Bit_DB_T
+    (see Bit_to_arrow in include/bit.h).
+
+    Arrow boolean buffers are bit-packed least significant bit first, which
+    is the byte layout of a Bit_T, so an export hands the rows to the
+    consumer as they are, and an import wraps the producer's buffer when it
+    starts on a qword boundary and the bits past the length are known to be
+    zero. Other buffers are repacked: the bits are moved 64 at a time, by a
+    shift of two neighbouring qwords, rather than one at a time.
+
+    * License : BSD-2
+*/
+
+/* ==========================================================================
+   SECTION 1: INCLUDES
+   Standard library headers first, then project headers.
+   ========================================================================== */
+
+#include "bit.h"
+#include "omp.h"
+#include <assert.h>
+#include <limits.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "bit_internal.h"
+
+/* --- End Section 1: INCLUDES --- */
+
+/* ==========================================================================
+   SECTION 2: COMPILE-TIME CONFIGURATION
+   File-local compile-time constants, build-time defaults, and feature flags.
+   ========================================================================== */
+
+/* Schema metadata key of the bits per row of an exported Bit_DB_T */
+#define ARROW_LENGTH_KEY "bit.length"
+
+/* --- End Section 2: COMPILE-TIME CONFIGURATION --- */
+
+/* ==========================================================================
+   SECTION 5: INTERNAL DATA STRUCTURES AND ENUMS
+   Types used only inside this translation unit.
+   ========================================================================== */
+
+/* Everything an exported array points to, freed by its release callback */
+typedef struct {
+  const void *buffers[2];       // validity (always NULL) and values
+  void *owned;                  // repacked values, or NULL for a view
+  struct ArrowArray child;      // the booleans of a list export
+  const void *child_buffers[2];
+  struct ArrowArray *children[1];
+} arrow_array_data;
+
+/* Same for an exported schema */
+typedef struct {
+  char format[32];
+  char metadata[64];            // ARROW_LENGTH_KEY and its value, encoded
+  struct ArrowSchema child;
+  struct ArrowSchema *children[1];
+} arrow_schema_data;
+
+/* --- End Section 5: INTERNAL DATA STRUCTURES AND ENUMS --- */
+
+/* ==========================================================================
+   SECTION 8: INTERNAL HELPER FUNCTION DEFINITIONS
+   ========================================================================== */
+
+/* --- 8a. Bit moves --- */
+
+/* Bits [first, first + 64) of src, those at or past end read as 0. Reads
+   no byte past the one holding bit end - 1. */
+static inline uint64_t arrow_bits_at(const unsigned char *src, size_t first,
+                                     size_t end) {
+  if (first >= end)
+    return 0;
+  const size_t byte = first / BPB, shift = first % BPB;
+  const size_t last = (end + BPB - 1) / BPB; // bytes holding bits
+  uint64_t w = 0;
+  if (byte + 9 <= last) {
+    memcpy(&w, src + byte, sizeof(w));
+    w >>= shift;
+    if (shift)
+      w |= (uint64_t)src[byte + 8] << (BPQW - shift);
+  } else {
+    for (size_t k = 0; byte + k < last && 8 * k < BPQW + shift; k++) {
+      uint64_t b = src[byte + k];
+      w |= 8 * k >= shift ? b << (8 * k - shift) : b >> (shift - 8 * k);
+    }
+  }
+  const size_t n = end - first;
+  return n < BPQW ? w & ((UINT64_C(1) << n) - 1) : w;
+}
+
+/* dst = bits [first, first + nbits) of src, and the bits of dst past
+   nbits zero; an absent validity keeps every bit */
+static void arrow_copy_bits(uint64_t *dst, const unsigned char *src,
+                            const unsigned char *validity,
+                            size_t first, size_t nbits, size_t vfirst) {
+  const size_t nq = (nbits + BPQW - 1) / BPQW;
+  for (size_t q = 0; q < nq; q++) {
+    const size_t at = q * BPQW;
+    uint64_t w = arrow_bits_at(src, first + at, first + nbits);
+    if (validity) // a null is not a member
+      w &= arrow_bits_at(validity, vfirst + at, vfirst + nbits);
+    dst[q] = w;
+  }
+}
+
+/* Ors the nbits bits of src into dst from bit at on */
+static inline void arrow_put_bits(uint64_t *dst, size_t at,
+                                  const uint64_t *src, size_t nbits) {
+  const size_t shift = at % BPQW;
+  uint64_t *to = dst + at / BPQW;
+  for (size_t q = 0; q * BPQW < nbits; q++) {
+    const size_t n = nbits - q * BPQW < BPQW ? nbits - q * BPQW : BPQW;
+    const uint64_t w = src[q];
+    to[q] |= w << shift;
+    if (shift && shift + n > BPQW)
+      to[q + 1] |= w >> (BPQW - shift);
+  }
+}
+
+/* Whether the bits of the last qword of every row past length are zero, so
+   that the rows can be taken as they are */
+static bool arrow_tails_clear(const uint64_t *rows, size_t nrows,
+                              size_t stride_in_qwords, size_t length) {
+  if (length % BPQW == 0)
+    return true;
+  const uint64_t tail = ~((UINT64_C(1) << (length % BPQW)) - 1);
+  const size_t last = length / BPQW;
+  for (size_t i = 0; i < nrows; i++)
+    if (rows[i * stride_in_qwords + last] & tail)
+      return false;
+  return true;
+}
+
+/* --- 8b. Export --- */
+
+static void arrow_child_release(struct ArrowArray *array) {
+  array->release = NULL; // the parent owns the memory
+}
+
+static void arrow_array_release(struct ArrowArray *array) {
+  arrow_array_data *data = array->private_data;
+  if (data->child.release)
+    data->child.release(&data->child);
+  free(data->owned);
+  free(data);
+  array->release = NULL;
+}
+
+static void arrow_child_schema_release(struct ArrowSchema *schema) {
+  schema->release = NULL;
+}
+
+static void arrow_schema_release(struct ArrowSchema *schema) {
+  arrow_schema_data *data = schema->private_data;
+  if (data->child.release)
+    data->child.release(&data->child);
+  free(data);
+  schema->release = NULL;
+}
+
+static arrow_array_data *arrow_array_init(struct ArrowArray *array,
+                                          int64_t length,
+                                          const void *values, void *owned) {
+  arrow_array_data *data = calloc(1, sizeof(*data));
+  assert(data != NULL);
+  data->buffers[1] = values;
+  data->owned = owned;
+  *array = (struct ArrowArray){.length = length,
+                               .n_buffers = 2,
+                               .buffers = data->buffers,
+                               .release = arrow_array_release,
+                               .private_data = data};
+  return data;
+}
+
+/* A schema of format; a non-zero length is recorded in the metadata */
+static arrow_schema_data *arrow_schema_init(struct ArrowSchema *schema,
+                                            const char *format,
+                                            int32_t length) {
+  arrow_schema_data *data = calloc(1, sizeof(*data));
+  assert(data != NULL);
+  snprintf(data->format, sizeof(data->format), "%s", format);
+  *schema = (struct ArrowSchema){.format = data->format,
+                                 .name = "",
+                                 .release = arrow_schema_release,
+                                 .private_data = data};
+  if (length > 0) {
+    // int32 pairs, then key and value: the Arrow metadata encoding
+    char value[16];
+    const int32_t npairs = 1, nkey = (int32_t)strlen(ARROW_LENGTH_KEY);
+    const int32_t nvalue = (int32_t)snprintf(value, sizeof(value), "%d",
+                                             (int)length);
+    char *at = data->metadata;
+    memcpy(at, &npairs, 4), at += 4;
+    memcpy(at, &nkey, 4), at += 4;
+    memcpy(at, ARROW_LENGTH_KEY, (size_t)nkey), at += nkey;
+    memcpy(at, &nvalue, 4), at += 4;
+    memcpy(at, value, (size_t)nvalue);
+    schema->metadata = data->metadata;
+  }
+  return data;
+}
+
+/* --- 8c. Import --- */
+
+/* The value of ARROW_LENGTH_KEY in metadata, or 0 */
+static int arrow_metadata_length(const char *metadata) {
+  if (metadata == NULL)
+    return 0;
+  int32_t npairs, n;
+  memcpy(&npairs, metadata, 4);
+  metadata += 4;
+  for (int32_t p = 0; p < npairs; p++) {
+    memcpy(&n, metadata, 4);
+    const bool match = (size_t)n == strlen(ARROW_LENGTH_KEY) &&
+                       memcmp(metadata + 4, ARROW_LENGTH_KEY, (size_t)n) == 0;
+    metadata += 4 + n;
+    memcpy(&n, metadata, 4);
+    if (match) {
+      char value[16] = {0};
+      memcpy(value, metadata + 4, n < 15 ? (size_t)n : 15);
+      return atoi(value);
+    }
+    metadata += 4 + n;
+  }
+  return 0;
+}
+
+/* The validity buffer of array, or NULL when every slot is valid */
+static const unsigned char *arrow_validity(const struct ArrowArray *array) {
+  return array->null_count != 0 ? array->buffers[0] : NULL;
+}
+
+/* A boolean array: two buffers, no children */
+static bool arrow_is_boolean(const struct ArrowArray *array,
+                             const struct ArrowSchema *schema) {
+  return strcmp(schema->format, "b") == 0 && array->n_buffers == 2 &&
+         array->buffers[1] != NULL && array->offset >= 0;
+}
+
+/* --- End Section 8: INTERNAL HELPER FUNCTION DEFINITIONS --- */
+
+/* ==========================================================================
+   SECTION 9: PUBLIC API
+   ========================================================================== */
+
+void Bit_to_arrow(T set, struct ArrowArray *array,
+                  struct ArrowSchema *schema) {
+  assert(set);
+  assert(array != NULL && schema != NULL);
+  arrow_array_init(array, set->length, set->bytes, NULL);
+  arrow_schema_init(schema, "b", 0);
+}
+
+T Bit_from_arrow(const struct ArrowArray *array,
+                 const struct ArrowSchema *schema, int flags) {
+  assert(array != NULL && schema != NULL);
+  assert(array->release != NULL && schema->release != NULL);
+  if (!arrow_is_boolean(array, schema) || array->length <= 0 ||
+      array->length >= INT_MAX)
+    return NULL;
+  const unsigned char *values = array->buffers[1];
+  const unsigned char *validity = arrow_validity(array);
+  const size_t first = (size_t)array->offset, nbits = (size_t)array->length;
+  const uint64_t *start = (const uint64_t *)(values + first / BPB);
+  // a view reads whole qwords: the last one must exist and end in zeros
+  const bool whole = nbits % BPQW == 0 || (flags & BIT_ARROW_PADDED);
+  if (validity == NULL && first % BPQW == 0 &&
+      (uintptr_t)start % sizeof(uint64_t) == 0 && whole &&
+      arrow_tails_clear(start, 1, 0, nbits))
+    return Bit_load((int)nbits, (void *)start);
+  T set = Bit_new((int)nbits);
+  arrow_copy_bits(set->qwords, values, validity, first, nbits, first);
+  RANK_INVALIDATE(set);
+  SUMMARY_INVALIDATE(set);
+  return set;
+}
+
+void BitDB_to_arrow(T_DB set, Bit_arrow_layout layout,
+                    struct ArrowArray *array, struct ArrowSchema *schema) {
+  assert(set);
+  assert(array != NULL && schema != NULL);
+  assert(layout == BIT_ARROW_BINARY || layout == BIT_ARROW_BOOL_LIST);
+  const size_t n = set->nelem, length = set->length;
+  char format[32];
+  if (layout == BIT_ARROW_BINARY) {
+    // rows of stride bytes, the padding zero: always the rows as they are
+    snprintf(format, sizeof(format), "w:%u", set->stride_in_bytes);
+    arrow_array_init(array, (int64_t)n, set->bytes, NULL);
+    arrow_schema_init(schema, format, (int32_t)length);
+    return;
+  }
+
+  // lists of length booleans, all in one child array end to end
+  snprintf(format, sizeof(format), "+w:%zu", length);
+  const void *bits = set->bytes;
+  void *owned = NULL;
+  if ((size_t)set->stride_in_bytes * BPB != length) {
+    const size_t nq = (n * length + BPQW - 1) / BPQW;
+    uint64_t *packed = calloc(nq ? nq : 1, sizeof(uint64_t));
+    assert(packed != NULL);
+    for (size_t i = 0; i < n; i++)
+      arrow_put_bits(packed, i * length,
+                     set->qwords + i * set->stride_in_qwords, length);
+    bits = owned = packed;
+  }
+  arrow_array_data *data = arrow_array_init(array, (int64_t)n, NULL, owned);
+  array->n_buffers = 1; // validity only, absent
+  data->child_buffers[1] = bits;
+  data->child = (struct ArrowArray){.length = (int64_t)(n * length),
+                                    .n_buffers = 2,
+                                    .buffers = data->child_buffers,
+                                    .release = arrow_child_release};
+  data->children[0] = &data->child;
+  array->n_children = 1;
+  array->children = data->children;
+
+  arrow_schema_data *sdata = arrow_schema_init(schema, format, 0);
+  sdata->child = (struct ArrowSchema){.format = "b",
+                                      .name = "item",
+                                      .release = arrow_child_schema_release};
+  sdata->children[0] = &sdata->child;
+  schema->n_children = 1;
+  schema->children = sdata->children;
+}
+
+T_DB BitDB_from_arrow(const struct ArrowArray *array,
+                      const struct ArrowSchema *schema, int length) {
+  assert(array != NULL && schema != NULL);
+  assert(array->release != NULL && schema->release != NULL);
+  assert(length >= 0);
+  if (array->length <= 0 || array->length >= INT_MAX || array->offset < 0)
+    return NULL;
+  const size_t n = (size_t)array->length, first = (size_t)array->offset;
+  const unsigned char *nulls = arrow_validity(array);
+  if (length == 0)
+    length = arrow_metadata_length(schema->metadata);
+
+  size_t width, start; // bits per row in the values and bit of row 0
+  const unsigned char *values, *validity;
+  if (strncmp(schema->format, "w:", 2) == 0) {
+    const long bytes = strtol(schema->format + 2, NULL, 10);
+    if (bytes <= 0 || array->n_buffers != 2 || array->buffers[1] == NULL)
+      return NULL;
+    width = (size_t)bytes * BPB;
+    start = first * width;
+    values = array->buffers[1];
+    validity = NULL;
+  } else if (strncmp(schema->format, "+w:", 3) == 0) {
+    const long bits = strtol(schema->format + 3, NULL, 10);
+    if (bits <= 0 || array->n_children != 1 || schema->n_children != 1 ||
+        !arrow_is_boolean(array->children[0], schema->children[0]))
+      return NULL;
+    const struct ArrowArray *child = array->children[0];
+    width = (size_t)bits;
+    start = (size_t)child->offset + first * width;
+    values = child->buffers[1];
+    validity = arrow_validity(child);
+  } else {
+    return NULL;
+  }
+  if (length == 0)
+    length = width < INT_MAX ? (int)width : 0;
+  if (length <= 0 || (size_t)length > width)
+    return NULL;
+
+  // a view needs packed rows that start on qwords and end in zeros
+  const size_t row_bytes = (size_t)nqwords(length) * sizeof(uint64_t);
+  const uint64_t *rows = (const uint64_t *)(values + start / BPB);
+  if (nulls == NULL && validity == NULL && width == row_bytes * BPB &&
+      start % BPQW == 0 && (uintptr_t)rows % sizeof(uint64_t) == 0 &&
+      arrow_tails_clear(rows, n, row_bytes / sizeof(uint64_t),
+                        (size_t)length))
+    return BitDB_load(length, (int)n, (void *)rows);
+
+  T_DB set = BitDB_new(length, (int)n);
+  const long long nrows = (long long)n;
+#pragma omp parallel for schedule(static) if (nrows > 1024)
+  for (long long i = 0; i < nrows; i++) {
+    uint64_t *row = set->qwords + (size_t)i * set->stride_in_qwords;
+    if (nulls && !((nulls[(first + i) / BPB] >> ((first + i) % BPB)) & 1))
+      continue; // a null row is empty
+    const size_t at = start + (size_t)i * width;
+    arrow_copy_bits(row, values, validity, at, (size_t)length, at);
+  }
+  return set;
+}
+
+/* --- End Section 9: PUBLIC API --- */
@@ -0,0 +1,140 @@
+/*
+    Blocked Bloom filters on Bit_T storage (Bit_BF_T, see include/bit.h).
+
+    The bits of a filter are a Bit_T whose length is a multiple of 512: each
+    key sets and tests bits of a single 512-bit block, i.e. one cache line,
+    instead of k lines scattered over the whole set. The probes are the
+    bloom_insert and bloom_contains kernels of the active ISA variant. A
+    filter either owns its Bit_T or wraps one that the caller owns, such as
+    a row of a Bit_DB_T, which is how filters are saved and mapped back with
+    BitDB_save and BitDB_open_mmap.
+
+    * License : BSD-2
+*/
+
+/* ==========================================================================
+   SECTION 1: INCLUDES
+   Standard library headers first, then project headers.
+   ========================================================================== */
+
+#include "bit.h"
+#include "omp.h"
+#include <assert.h>
+#include <limits.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+
+#include "bit_internal.h"
+
+/* --- End Section 1: INCLUDES --- */
+
+/* ==========================================================================
+   SECTION 2: COMPILE-TIME CONFIGURATION
+   File-local compile-time constants, build-time defaults, and feature flags.
+   ========================================================================== */
+
+#define BLOOM_BLOCK_BITS 512
+#define BLOOM_MAX_K 16 // one bit in each of the 32-bit lanes of a block
+
+/* --- End Section 2: COMPILE-TIME CONFIGURATION --- */
+
+/* ==========================================================================
+   SECTION 5: INTERNAL DATA STRUCTURES AND ENUMS
+   Types used only inside this translation unit.
+   ========================================================================== */
+
+struct T_BF {
+  T bits;           // the blocks of the filter
+  uint32_t nblocks; // 512-bit blocks
+  int k;            // bits set per key
+  bool owns_bits;   // bits were allocated by Bit_BF_new
+};
+
+/* --- End Section 5: INTERNAL DATA STRUCTURES AND ENUMS --- */
+
+/* ==========================================================================
+   SECTION 8: INTERNAL HELPER FUNCTION DEFINITIONS
+   ========================================================================== */
+
+static T_BF bloom_make(T bits, int k, bool owns_bits) {
+  assert(k >= 1 && k <= BLOOM_MAX_K);
+  T_BF filter = malloc(sizeof(*filter));
+  assert(filter != NULL);
+  filter->bits = bits;
+  filter->nblocks = bits->length / BLOOM_BLOCK_BITS;
+  filter->k = k;
+  filter->owns_bits = owns_bits;
+  return filter;
+}
+
+/* Inserts write the Bit_T behind the back of its member operations */
+static void bloom_written(T_BF filter) {
+  RANK_INVALIDATE(filter->bits);
+  SUMMARY_INVALIDATE(filter->bits);
+}
+
+/* --- End Section 8: INTERNAL HELPER FUNCTION DEFINITIONS --- */
+
+/* ==========================================================================
+   SECTION 9: PUBLIC API
+   ========================================================================== */
+
+T_BF Bit_BF_new(int length, int k) {
+  assert(length > 0);
+  assert(length <= INT_MAX - BLOOM_BLOCK_BITS);
+  const int blocks = (length + BLOOM_BLOCK_BITS - 1) / BLOOM_BLOCK_BITS;
+  return bloom_make(Bit_new(blocks * BLOOM_BLOCK_BITS), k, true);
+}
+
+T_BF Bit_BF_wrap(T bits, int k) {
+  assert(bits);
+  assert(bits->length % BLOOM_BLOCK_BITS == 0);
+  return bloom_make(bits, k, false);
+}
+
+void Bit_BF_free(T_BF *filter) {
+  assert(filter && *filter);
+  if ((*filter)->owns_bits)
+    Bit_free(&(*filter)->bits);
+  free(*filter);
+  *filter = NULL;
+}
+
+T Bit_BF_bits(T_BF filter) {
+  assert(filter);
+  return filter->bits;
+}
+
+int Bit_BF_k(T_BF filter) {
+  assert(filter);
+  return filter->k;
+}
+
+void Bit_BF_insert(T_BF filter, uint64_t key) {
+  Bit_BF_insert_many(filter, &key, 1);
+}
+
+int Bit_BF_contains(T_BF filter, uint64_t key) {
+  return Bit_BF_contains_many(filter, &key, 1, NULL);
+}
+
+void Bit_BF_insert_many(T_BF filter, const uint64_t keys[], int n) {
+  assert(filter);
+  assert(keys != NULL || n == 0);
+  assert(n >= 0);
+  bit_kernels_active()->bloom_insert(filter->bits->qwords, filter->nblocks,
+                                     filter->k, keys, n);
+  bloom_written(filter);
+}
+
+int Bit_BF_contains_many(T_BF filter, const uint64_t keys[], int n,
+                         int out[]) {
+  assert(filter);
+  assert(keys != NULL || n == 0);
+  assert(n >= 0);
+  return bit_kernels_active()->bloom_contains(
+      filter->bits->qwords, filter->nblocks, filter->k, keys, n, out);
+}
+
+/* --- End Section 9: PUBLIC API --- */
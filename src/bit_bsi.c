@@ -0,0 +1,282 @@
+/*
+    Bit-sliced indices of unsigned integer columns (Bit_BSI_T, see
+    include/bit.h).
+
+    Row i of the column has value v_i < 2^B, stored as bit i of B Bit_T
+    slices: slice b holds bit b of every value. A comparison with a constant
+    walks the slices from the most significant one down, keeping per row
+    whether the value is already known to be below the constant and whether
+    it still equals its leading bits (O'Neil and Quass), i.e. 64 rows per
+    qword operation instead of one row at a time. The walk runs one chunk of
+    qwords at a time, so the masks of the chunk stay in L1 while every slice
+    streams through it once. Sums and top-k selection are built from the
+    setop and count kernels over whole slices.
+
+    * License : BSD-2
+*/
+
+/* ==========================================================================
+   SECTION 1: INCLUDES
+   Standard library headers first, then project headers.
+   ========================================================================== */
+
+#include "bit.h"
+#include "omp.h"
+#include <assert.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "bit_internal.h"
+
+/* --- End Section 1: INCLUDES --- */
+
+/* ==========================================================================
+   SECTION 2: COMPILE-TIME CONFIGURATION
+   File-local compile-time constants, build-time defaults, and feature flags.
+   ========================================================================== */
+
+/* Qwords of rows per comparison chunk: the two running masks of a chunk
+   take 2 x 4 KiB */
+#define BSI_CHUNK_QWORDS 512
+
+/* --- End Section 2: COMPILE-TIME CONFIGURATION --- */
+
+/* ==========================================================================
+   SECTION 5: INTERNAL DATA STRUCTURES AND ENUMS
+   Types used only inside this translation unit.
+   ========================================================================== */
+
+struct T_BSI {
+  int length;   // rows
+  int bits;     // slices, 1 to 64
+  T slices[64]; // slices[b] holds bit b of every value
+};
+
+/* --- End Section 5: INTERNAL DATA STRUCTURES AND ENUMS --- */
+
+/* ==========================================================================
+   SECTION 8: INTERNAL HELPER FUNCTION DEFINITIONS
+   ========================================================================== */
+
+/* Slices written around their member operations */
+static void bsi_written(T_BSI bsi) {
+  for (int b = 0; b < bsi->bits; b++) {
+    RANK_INVALIDATE(bsi->slices[b]);
+    SUMMARY_INVALIDATE(bsi->slices[b]);
+  }
+}
+
+/* Bits of the last qword of a set that are rows */
+static inline uint64_t bsi_tail_mask(int length) {
+  return length % BPQW ? (UINT64_C(1) << (length % BPQW)) - 1 : ~UINT64_C(0);
+}
+
+/* out = the rows whose value compares to c as op asks. Constants past the
+   slices are settled up front; the others are walked from the top slice. */
+static void bsi_compare_into(T_BSI bsi, Bit_bsi_op op, uint64_t c, T out) {
+  const size_t nq = out->size_in_qwords;
+  const bool fits = bsi->bits == 64 || c >> bsi->bits == 0;
+  if (!fits) { // every value is below c
+    bool all = op == BIT_BSI_LT || op == BIT_BSI_LE || op == BIT_BSI_NE;
+    memset(out->qwords, all ? 0xff : 0, nq * sizeof(uint64_t));
+    out->qwords[nq - 1] &= bsi_tail_mask(bsi->length);
+    return;
+  }
+  // x < c, x <= c, x > c, x >= c, x == c, x != c from lt and eq
+  const bool negate = op == BIT_BSI_GE || op == BIT_BSI_GT ||
+                      op == BIT_BSI_NE;
+  const bool with_eq = op == BIT_BSI_LE || op == BIT_BSI_GT ||
+                       op == BIT_BSI_EQ || op == BIT_BSI_NE;
+  const bool with_lt = op != BIT_BSI_EQ && op != BIT_BSI_NE;
+  const long long nchunks =
+      (long long)((nq + BSI_CHUNK_QWORDS - 1) / BSI_CHUNK_QWORDS);
+#pragma omp parallel for schedule(static) if (nchunks > 4)
+  for (long long chunk = 0; chunk < nchunks; chunk++) {
+    const size_t lo = (size_t)chunk * BSI_CHUNK_QWORDS;
+    const size_t w = nq - lo < BSI_CHUNK_QWORDS ? nq - lo : BSI_CHUNK_QWORDS;
+    uint64_t lt[BSI_CHUNK_QWORDS], eq[BSI_CHUNK_QWORDS];
+    OMP_CPU_SIMD
+    for (size_t q = 0; q < w; q++) {
+      lt[q] = 0;
+      eq[q] = ~UINT64_C(0);
+    }
+    for (int b = bsi->bits - 1; b >= 0; b--) {
+      const uint64_t *slice = bsi->slices[b]->qwords + lo;
+      if ((c >> b) & 1) { // rows with a 0 here fall below c
+        OMP_CPU_SIMD
+        for (size_t q = 0; q < w; q++) {
+          lt[q] |= eq[q] & ~slice[q];
+          eq[q] &= slice[q];
+        }
+      } else {
+        OMP_CPU_SIMD
+        for (size_t q = 0; q < w; q++)
+          eq[q] &= ~slice[q];
+      }
+    }
+    uint64_t *dst = out->qwords + lo;
+    OMP_CPU_SIMD
+    for (size_t q = 0; q < w; q++) {
+      uint64_t x = (with_lt ? lt[q] : 0) | (with_eq ? eq[q] : 0);
+      dst[q] = negate ? ~x : x;
+    }
+  }
+  out->qwords[nq - 1] &= bsi_tail_mask(bsi->length);
+}
+
+/* --- End Section 8: INTERNAL HELPER FUNCTION DEFINITIONS --- */
+
+/* ==========================================================================
+   SECTION 9: PUBLIC API
+   ========================================================================== */
+
+T_BSI Bit_BSI_new(int length, int bits) {
+  assert(length > 0);
+  assert(bits >= 1 && bits <= 64);
+  T_BSI bsi = calloc(1, sizeof(*bsi));
+  assert(bsi != NULL);
+  bsi->length = length;
+  bsi->bits = bits;
+  for (int b = 0; b < bits; b++)
+    bsi->slices[b] = Bit_new(length);
+  return bsi;
+}
+
+void Bit_BSI_free(T_BSI *bsi) {
+  assert(bsi && *bsi);
+  for (int b = 0; b < (*bsi)->bits; b++)
+    Bit_free(&(*bsi)->slices[b]);
+  free(*bsi);
+  *bsi = NULL;
+}
+
+int Bit_BSI_length(T_BSI bsi) {
+  assert(bsi);
+  return bsi->length;
+}
+
+int Bit_BSI_bits(T_BSI bsi) {
+  assert(bsi);
+  return bsi->bits;
+}
+
+T Bit_BSI_slice(T_BSI bsi, int b) {
+  assert(bsi);
+  assert(b >= 0 && b < bsi->bits);
+  return bsi->slices[b];
+}
+
+void Bit_BSI_put(T_BSI bsi, int index, uint64_t value) {
+  assert(bsi);
+  assert(index >= 0 && index < bsi->length);
+  assert(bsi->bits == 64 || value >> bsi->bits == 0);
+  for (int b = 0; b < bsi->bits; b++)
+    Bit_put(bsi->slices[b], index, (int)((value >> b) & 1));
+}
+
+uint64_t Bit_BSI_get(T_BSI bsi, int index) {
+  assert(bsi);
+  assert(index >= 0 && index < bsi->length);
+  uint64_t value = 0;
+  for (int b = 0; b < bsi->bits; b++)
+    value |= (uint64_t)Bit_get(bsi->slices[b], index) << b;
+  return value;
+}
+
+void Bit_BSI_load(T_BSI bsi, const uint64_t values[]) {
+  assert(bsi);
+  assert(values != NULL);
+  void (*transpose64)(uint64_t *) = bit_kernels_active()->transpose64;
+  const int nq = (int)bsi->slices[0]->size_in_qwords;
+  // 64 values make a 64 x 64 block; its transpose is one qword per slice
+#pragma omp parallel for schedule(static) if (nq > 2048)
+  for (int q = 0; q < nq; q++) {
+    uint64_t block[64];
+    for (int r = 0; r < 64; r++) {
+      const int row = q * 64 + r;
+      block[r] = row < bsi->length ? values[row] : 0;
+      assert(bsi->bits == 64 || block[r] >> bsi->bits == 0);
+    }
+    transpose64(block);
+    for (int b = 0; b < bsi->bits; b++)
+      bsi->slices[b]->qwords[q] = block[b];
+  }
+  bsi_written(bsi);
+}
+
+T Bit_BSI_compare(T_BSI bsi, Bit_bsi_op op, uint64_t value) {
+  assert(bsi);
+  assert(op >= BIT_BSI_LT && op <= BIT_BSI_NE);
+  T out = Bit_new(bsi->length);
+  bsi_compare_into(bsi, op, value, out);
+  return out;
+}
+
+T Bit_BSI_between(T_BSI bsi, uint64_t lo, uint64_t hi) {
+  assert(bsi);
+  T out = Bit_new(bsi->length);
+  if (lo > hi)
+    return out;
+  T below = Bit_new(bsi->length);
+  bsi_compare_into(bsi, BIT_BSI_GE, lo, out);
+  bsi_compare_into(bsi, BIT_BSI_LE, hi, below);
+  bit_kernels_active()->setop[BIT_OP_AND](out, out, below);
+  Bit_free(&below);
+  return out;
+}
+
+uint64_t Bit_BSI_sum(T_BSI bsi, T mask) {
+  assert(bsi);
+  assert(mask == NULL || Bit_length(mask) == bsi->length);
+  const bit_kernel_table *k = bit_kernels_active();
+  uint64_t sum = 0;
+  for (int b = 0; b < bsi->bits; b++) {
+    const uint64_t count = (uint64_t)(
+        mask ? k->setop_count[BIT_OP_AND](bsi->slices[b], mask)
+             : k->count(bsi->slices[b]));
+    sum += count << b;
+  }
+  return sum;
+}
+
+T Bit_BSI_topk(T_BSI bsi, T mask, int k) {
+  assert(bsi);
+  assert(mask == NULL || Bit_length(mask) == bsi->length);
+  assert(k >= 0);
+  const bit_kernel_table *kt = bit_kernels_active();
+  // above: rows known to be among the k largest; tied: rows still equal to
+  // the largest values in the slices walked so far
+  T above = Bit_new(bsi->length), tied = Bit_new(bsi->length);
+  T with = Bit_new(bsi->length);
+  if (mask)
+    kt->setop[BIT_OP_OR](tied, tied, mask);
+  else
+    Bit_set(tied, 0, bsi->length - 1);
+  int nabove = 0;
+  for (int b = bsi->bits - 1; b >= 0 && nabove < k; b--) {
+    // the tied rows with a 1 here beat the tied rows with a 0
+    kt->setop[BIT_OP_AND](with, tied, bsi->slices[b]);
+    const int nwith = kt->count(with);
+    if (nabove + nwith <= k) {
+      kt->setop[BIT_OP_OR](above, above, with);
+      nabove += nwith;
+      if (nwith > 0) // the rest of the tied rows have a 0 here
+        kt->setop[BIT_OP_AND_NOT](tied, tied, bsi->slices[b]);
+    } else {
+      kt->setop[BIT_OP_AND](tied, tied, bsi->slices[b]);
+    }
+  }
+  // the rows still tied fill up the remaining places by increasing index
+  for (int i = Bit_next_set(tied, 0); i >= 0 && nabove < k;
+       i = Bit_next_set(tied, i + 1), nabove++)
+    Bit_bset(above, i);
+  Bit_free(&tied);
+  Bit_free(&with);
+  RANK_INVALIDATE(above);
+  SUMMARY_INVALIDATE(above);
+  return above;
+}
+
+/* --- End Section 9: PUBLIC API --- */
@@ -0,0 +1,1013 @@
+/*
+    Compressed bitsets of the Bit library (Bit_C_T, see include/bit.h).
+
+    Every chunk of CHUNK_BITS bits with a set bit is one container: a sorted
+    array of the offsets of at most ARRAY_MAX set bits, a bitmap of
+    CHUNK_QWORDS qwords, or sorted runs [start, last] of set bits. A set
+    keeps its containers sorted by chunk, so the binary operations merge the
+    two lists and combine the containers of the chunks they share. Bitmaps
+    go through the set operation and popcount kernels of
+    bit_kernels_active() behind stack Bit_T headers, and so do the chunks of
+    Bit_T operands, which are read in place.
+
+    * License : BSD-2
+*/
+
+/* ==========================================================================
+   SECTION 1: INCLUDES
+   Standard library headers first, then project headers.
+   ========================================================================== */
+
+#include "bit.h"
+#include "omp.h"
+#include <assert.h>
+#include <limits.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "bit_internal.h"
+
+/* --- End Section 1: INCLUDES --- */
+
+/* ==========================================================================
+   SECTION 2: COMPILE-TIME CONFIGURATION
+   File-local compile-time constants, build-time defaults, and feature flags.
+   ========================================================================== */
+
+#define CHUNK_SHIFT 16
+#define CHUNK_BITS (1u << CHUNK_SHIFT)
+#define CHUNK_QWORDS (CHUNK_BITS / 64)
+#define CHUNK_BYTES (CHUNK_QWORDS * sizeof(uint64_t))
+
+/* Set bits of the largest array container; past it a bitmap is smaller */
+#define ARRAY_MAX 4096
+
+/* --- End Section 2: COMPILE-TIME CONFIGURATION --- */
+
+/* ==========================================================================
+   SECTION 3: INFRASTRUCTURAL MACROS
+   Private macros used by helper functions and low-level operations.
+   ========================================================================== */
+
+#define CHUNK_OF(n) ((uint32_t)(n) >> CHUNK_SHIFT)
+#define OFFSET_OF(n) ((unsigned int)(n) & (CHUNK_BITS - 1))
+
+/* --- End Section 3: INFRASTRUCTURAL MACROS --- */
+
+/* ==========================================================================
+   SECTION 5: INTERNAL DATA STRUCTURES AND ENUMS
+   Types used only inside this translation unit.
+   ========================================================================== */
+
+typedef enum { C_ARRAY = 0, C_BITMAP, C_RUN } container_kind;
+
+/* Set bits start to last, offsets in the chunk */
+typedef struct {
+  uint16_t start;
+  uint16_t last;
+} c_run;
+
+typedef struct {
+  uint32_t key; // chunk: bits [key * CHUNK_BITS, (key + 1) * CHUNK_BITS)
+  container_kind kind;
+  int card;     // set bits, at least 1 in a set
+  int n;        // values of an array or runs of a run container
+  int capacity; // values or runs allocated
+  union {
+    uint16_t *values; // C_ARRAY, sorted offsets
+    uint64_t *words;  // C_BITMAP, CHUNK_QWORDS aligned to ALIGNMENT
+    c_run *runs;      // C_RUN, sorted and neither overlapping nor adjacent
+  };
+} container;
+
+struct T_C {
+  unsigned int length; // capacity of the bitset in bits
+  int n;               // containers in use
+  int capacity;        // containers allocated
+  container *c;        // sorted by key
+};
+
+/* --- End Section 5: INTERNAL DATA STRUCTURES AND ENUMS --- */
+
+/* ==========================================================================
+   SECTION 8: INTERNAL HELPER FUNCTION DEFINITIONS
+   Containers, their conversions and the operations on pairs of them.
+   ========================================================================== */
+
+/* Stack Bit_T header over nq qwords, for the kernels */
+static struct T words_view(const uint64_t *words, unsigned int nq) {
+  return (struct T){.length = nq * (unsigned int)BPQW,
+                    .size_in_bytes = nq * (unsigned int)sizeof(uint64_t),
+                    .size_in_qwords = nq,
+                    .bytes = (unsigned char *)words,
+                    .qwords = (uint64_t *)words};
+}
+
+static int words_count(const uint64_t *words) {
+  return bit_kernels_active()->count_qwords(words, CHUNK_QWORDS);
+}
+
+static uint64_t *bitmap_alloc(void) {
+  uint64_t *words = aligned_alloc(ALIGNMENT, CHUNK_BYTES);
+  assert(words != NULL);
+  memset(words, 0, CHUNK_BYTES);
+  return words;
+}
+
+static void *checked_malloc(size_t bytes) {
+  void *p = malloc(bytes ? bytes : 1);
+  assert(p != NULL);
+  return p;
+}
+
+/* Sets (set) or clears bits start to last of words */
+static void words_range(uint64_t *words, unsigned int start, unsigned int last,
+                        bool set) {
+  const unsigned int w0 = start / 64, w1 = last / 64;
+  uint64_t first = ~UINT64_C(0) << (start % 64);
+  const uint64_t final = ~UINT64_C(0) >> (63 - last % 64);
+  if (w0 == w1)
+    first &= final;
+  words[w0] = set ? words[w0] | first : words[w0] & ~first;
+  if (w0 == w1)
+    return;
+  for (unsigned int w = w0 + 1; w < w1; w++)
+    words[w] = set ? ~UINT64_C(0) : 0;
+  words[w1] = set ? words[w1] | final : words[w1] & ~final;
+}
+
+/* Set bits of words in start to last */
+static int words_range_count(const uint64_t *words, unsigned int start,
+                             unsigned int last) {
+  const unsigned int w0 = start / 64, w1 = last / 64;
+  uint64_t first = ~UINT64_C(0) << (start % 64);
+  const uint64_t final = ~UINT64_C(0) >> (63 - last % 64);
+  if (w0 == w1)
+    return (int)POPCOUNT(words[w0] & first & final);
+  int count = (int)POPCOUNT(words[w0] & first) +
+              (int)POPCOUNT(words[w1] & final);
+  if (w1 > w0 + 1)
+    count += bit_kernels_active()->count_qwords(words + w0 + 1, w1 - w0 - 1);
+  return count;
+}
+
+/* First set (set) or clear bit of words at or after v, CHUNK_BITS if none */
+static unsigned int words_next(const uint64_t *words, unsigned int v,
+                               bool set) {
+  if (v >= CHUNK_BITS)
+    return CHUNK_BITS;
+  unsigned int w = v / 64;
+  uint64_t word = (set ? words[w] : ~words[w]) & (~UINT64_C(0) << (v % 64));
+  while (!word) {
+    if (++w == CHUNK_QWORDS)
+      return CHUNK_BITS;
+    word = set ? words[w] : ~words[w];
+  }
+  return w * 64 + (unsigned int)__builtin_ctzll(word);
+}
+
+/* Runs of set bits in words */
+static int words_runs(const uint64_t *words) {
+  int runs = 0;
+  uint64_t carry = 0;
+  for (unsigned int w = 0; w < CHUNK_QWORDS; w++) {
+    runs += (int)POPCOUNT(words[w] & ~((words[w] << 1) | carry));
+    carry = words[w] >> 63;
+  }
+  return runs;
+}
+
+/* Index of the first of the n sorted values that is not below v */
+static int lower_bound(const uint16_t *values, int n, unsigned int v) {
+  int lo = 0, hi = n;
+  while (lo < hi) {
+    const int mid = lo + (hi - lo) / 2;
+    if (values[mid] < v)
+      lo = mid + 1;
+    else
+      hi = mid;
+  }
+  return lo;
+}
+
+/* Index of the first of the n sorted runs that ends at or after v */
+static int run_bound(const c_run *runs, int n, unsigned int v) {
+  int lo = 0, hi = n;
+  while (lo < hi) {
+    const int mid = lo + (hi - lo) / 2;
+    if (runs[mid].last < v)
+      lo = mid + 1;
+    else
+      hi = mid;
+  }
+  return lo;
+}
+
+static bool container_contains(const container *c, unsigned int v) {
+  switch (c->kind) {
+  case C_ARRAY: {
+    const int i = lower_bound(c->values, c->n, v);
+    return i < c->n && c->values[i] == v;
+  }
+  case C_BITMAP:
+    return (c->words[v / 64] >> (v % 64)) & 1;
+  default: {
+    const int i = run_bound(c->runs, c->n, v);
+    return i < c->n && c->runs[i].start <= v;
+  }
+  }
+}
+
+/* Smallest set offset of c at or after v, or -1 */
+static int container_next(const container *c, unsigned int v) {
+  switch (c->kind) {
+  case C_ARRAY: {
+    const int i = lower_bound(c->values, c->n, v);
+    return i < c->n ? c->values[i] : -1;
+  }
+  case C_BITMAP: {
+    const unsigned int next = words_next(c->words, v, true);
+    return next < CHUNK_BITS ? (int)next : -1;
+  }
+  default: {
+    const int i = run_bound(c->runs, c->n, v);
+    if (i == c->n)
+      return -1;
+    return c->runs[i].start > v ? c->runs[i].start : (int)v;
+  }
+  }
+}
+
+/* The set bits of c into words, which need not be clear */
+static void container_to_words(const container *c, uint64_t *words) {
+  if (c->kind == C_BITMAP) {
+    memcpy(words, c->words, CHUNK_BYTES);
+    return;
+  }
+  memset(words, 0, CHUNK_BYTES);
+  if (c->kind == C_ARRAY) {
+    for (int i = 0; i < c->n; i++)
+      words[c->values[i] / 64] |= UINT64_C(1) << (c->values[i] % 64);
+  } else {
+    for (int i = 0; i < c->n; i++)
+      words_range(words, c->runs[i].start, c->runs[i].last, true);
+  }
+}
+
+/* c, whose storage was released, as the card > 0 set bits of words: an
+   array that leaves words to the caller, or a bitmap that takes them over
+   (own) or copies them */
+static void container_from_words(container *c, uint64_t *words, int card,
+                                 bool own) {
+  c->card = card;
+  if (card <= ARRAY_MAX) {
+    uint16_t *values = checked_malloc((size_t)card * sizeof(uint16_t));
+    int n = 0;
+    for (unsigned int w = 0; w < CHUNK_QWORDS; w++)
+      for (uint64_t word = words[w]; word; word &= word - 1)
+        values[n++] = (uint16_t)(w * 64 + (unsigned int)__builtin_ctzll(word));
+    if (own)
+      free(words);
+    c->kind = C_ARRAY;
+    c->values = values;
+    c->n = c->capacity = card;
+  } else {
+    if (!own) {
+      uint64_t *copy = bitmap_alloc();
+      memcpy(copy, words, CHUNK_BYTES);
+      words = copy;
+    }
+    c->kind = C_BITMAP;
+    c->words = words;
+    c->n = 0;
+    c->capacity = CHUNK_QWORDS;
+  }
+}
+
+/* Run container c as runs of the set bits of words */
+static void container_runs_from_words(container *c, const uint64_t *words,
+                                      int nruns) {
+  c_run *runs = checked_malloc((size_t)nruns * sizeof(c_run));
+  int n = 0;
+  for (unsigned int v = words_next(words, 0, true); v < CHUNK_BITS;
+       v = words_next(words, v, true)) {
+    const unsigned int end = words_next(words, v, false);
+    runs[n++] = (c_run){(uint16_t)v, (uint16_t)(end - 1)};
+    v = end;
+  }
+  free(c->values);
+  c->kind = C_RUN;
+  c->runs = runs;
+  c->n = c->capacity = n;
+}
+
+/* An array or a bitmap by the set bits of a run container */
+static void container_flatten(container *c) {
+  if (c->kind != C_RUN)
+    return;
+  uint64_t *words = bitmap_alloc();
+  container_to_words(c, words);
+  free(c->runs);
+  container_from_words(c, words, c->card, true);
+}
+
+/* The smallest form of c: runs take 4 bytes each, an array 2 per set bit,
+   a bitmap CHUNK_BYTES */
+static void container_optimize(container *c) {
+  int nruns = c->n;
+  if (c->kind == C_ARRAY) {
+    nruns = c->n > 0;
+    for (int i = 1; i < c->n; i++)
+      nruns += c->values[i] != c->values[i - 1] + 1;
+  } else if (c->kind == C_BITMAP) {
+    nruns = words_runs(c->words);
+  }
+  const size_t flat = c->card <= ARRAY_MAX
+                          ? (size_t)c->card * sizeof(uint16_t)
+                          : CHUNK_BYTES;
+  const bool runs = (size_t)nruns * sizeof(c_run) < flat;
+  if (runs == (c->kind == C_RUN))
+    return;
+  if (!runs) {
+    container_flatten(c);
+    return;
+  }
+  uint64_t *words = c->kind == C_BITMAP ? c->words : bitmap_alloc();
+  if (c->kind != C_BITMAP)
+    container_to_words(c, words);
+  else
+    c->words = NULL; // released below with the array storage
+  container_runs_from_words(c, words, nruns);
+  free(words);
+}
+
+static void container_copy(container *dst, const container *src) {
+  *dst = *src;
+  size_t bytes = CHUNK_BYTES;
+  if (src->kind == C_BITMAP) {
+    dst->words = bitmap_alloc();
+  } else {
+    bytes = (size_t)src->n *
+            (src->kind == C_ARRAY ? sizeof(uint16_t) : sizeof(c_run));
+    dst->values = checked_malloc(bytes);
+    dst->capacity = src->n;
+  }
+  memcpy(dst->values, src->values, bytes);
+}
+
+/* out = op(a, b) of two sorted arrays; an empty out has card 0 */
+static void array_op(container *out, const container *a, const container *b,
+                     bit_setop_id op) {
+  const uint16_t *x = a->values, *y = b->values;
+  const int nx = a->n, ny = b->n;
+  uint16_t *values = checked_malloc(
+      (size_t)(op == BIT_OP_AND ? (nx < ny ? nx : ny)
+               : op == BIT_OP_AND_NOT ? nx
+                                      : nx + ny) *
+      sizeof(uint16_t));
+  int n = 0, i = 0, j = 0;
+  if (op == BIT_OP_AND) {
+    n = bit_kernels_active()->array_inter(x, nx, y, ny, values);
+  } else {
+    while (i < nx && j < ny) {
+      if (x[i] < y[j]) {
+        values[n++] = x[i++];
+      } else if (y[j] < x[i]) {
+        if (op != BIT_OP_AND_NOT)
+          values[n++] = y[j];
+        j++;
+      } else {
+        if (op == BIT_OP_OR)
+          values[n++] = x[i];
+        i++, j++;
+      }
+    }
+    while (i < nx)
+      values[n++] = x[i++];
+    while (op != BIT_OP_AND_NOT && j < ny)
+      values[n++] = y[j++];
+  }
+  out->card = n;
+  if (n == 0) {
+    free(values);
+  } else if (n <= ARRAY_MAX) {
+    out->kind = C_ARRAY;
+    out->values = values;
+    out->n = out->capacity = n;
+  } else {
+    uint64_t *words = bitmap_alloc();
+    for (int k = 0; k < n; k++)
+      words[values[k] / 64] |= UINT64_C(1) << (values[k] % 64);
+    free(values);
+    out->kind = C_BITMAP;
+    out->words = words;
+    out->n = 0;
+    out->capacity = CHUNK_QWORDS;
+  }
+}
+
+/* out = a AND b (keep) or a AND NOT b (!keep) for an array a */
+static void array_filter(container *out, const container *a,
+                         const container *b, bool keep) {
+  uint16_t *values = checked_malloc((size_t)a->n * sizeof(uint16_t));
+  int n = 0;
+  for (int i = 0; i < a->n; i++)
+    if (container_contains(b, a->values[i]) == keep)
+      values[n++] = a->values[i];
+  out->card = n;
+  if (n == 0) {
+    free(values);
+    return;
+  }
+  out->kind = C_ARRAY;
+  out->values = values;
+  out->n = out->capacity = n;
+}
+
+/* out = a AND b (union false) or a OR b of two run containers */
+static void run_op(container *out, const container *a, const container *b,
+                   bool union_) {
+  c_run *runs = checked_malloc((size_t)(a->n + b->n) * sizeof(c_run));
+  int n = 0, card = 0, i = 0, j = 0;
+  if (!union_) {
+    while (i < a->n && j < b->n) {
+      const c_run x = a->runs[i], y = b->runs[j];
+      const unsigned int start = x.start > y.start ? x.start : y.start;
+      const unsigned int last = x.last < y.last ? x.last : y.last;
+      if (start <= last)
+        runs[n++] = (c_run){(uint16_t)start, (uint16_t)last};
+      if (x.last <= y.last)
+        i++;
+      if (y.last <= x.last)
+        j++;
+    }
+  } else {
+    while (i < a->n || j < b->n) {
+      const c_run next = j == b->n || (i < a->n && a->runs[i].start <
+                                                       b->runs[j].start)
+                             ? a->runs[i++]
+                             : b->runs[j++];
+      if (n > 0 && next.start <= (unsigned int)runs[n - 1].last + 1) {
+        if (next.last > runs[n - 1].last)
+          runs[n - 1].last = next.last;
+      } else {
+        runs[n++] = next;
+      }
+    }
+  }
+  for (int k = 0; k < n; k++)
+    card += runs[k].last - runs[k].start + 1;
+  out->card = card;
+  if (n == 0) {
+    free(runs);
+    return;
+  }
+  out->kind = C_RUN;
+  out->runs = runs;
+  out->n = out->capacity = n;
+  container_optimize(out);
+}
+
+/* out = op(a, b) for containers of the same chunk; out has a's key and
+   owns its storage, and an empty out has card 0 */
+static void container_op(container *out, const container *a,
+                         const container *b, bit_setop_id op) {
+  *out = (container){.key = a->key};
+  if (a->kind == C_ARRAY && b->kind == C_ARRAY) {
+    array_op(out, a, b, op);
+    return;
+  }
+  if (op == BIT_OP_AND && (a->kind == C_ARRAY || b->kind == C_ARRAY)) {
+    if (a->kind == C_ARRAY)
+      array_filter(out, a, b, true);
+    else
+      array_filter(out, b, a, true);
+    return;
+  }
+  if (op == BIT_OP_AND_NOT && a->kind == C_ARRAY) {
+    array_filter(out, a, b, false);
+    return;
+  }
+  if (a->kind == C_RUN && b->kind == C_RUN &&
+      (op == BIT_OP_AND || op == BIT_OP_OR)) {
+    run_op(out, a, b, op == BIT_OP_OR);
+    return;
+  }
+  // bitmap of the result: the words of a, then b applied to them; OR and
+  // XOR commute, so an array goes on the right where it is applied value
+  // by value
+  if (a->kind == C_ARRAY && op != BIT_OP_AND_NOT) {
+    const container *swap = a;
+    a = b;
+    b = swap;
+  }
+  uint64_t *words = bitmap_alloc();
+  container_to_words(a, words);
+  if (b->kind == C_ARRAY) {
+    for (int i = 0; i < b->n; i++) {
+      const uint64_t bit = UINT64_C(1) << (b->values[i] % 64);
+      uint64_t *word = &words[b->values[i] / 64];
+      *word = op == BIT_OP_OR    ? *word | bit
+              : op == BIT_OP_XOR ? *word ^ bit
+                                 : *word & ~bit;
+    }
+  } else {
+    uint64_t *scratch = NULL;
+    const uint64_t *b_words = b->words;
+    if (b->kind == C_RUN) {
+      scratch = bitmap_alloc();
+      container_to_words(b, scratch);
+      b_words = scratch;
+    }
+    struct T dst = words_view(words, CHUNK_QWORDS);
+    struct T rhs = words_view(b_words, CHUNK_QWORDS);
+    bit_kernels_active()->setop[op](&dst, &dst, &rhs);
+    free(scratch);
+  }
+  const int card = words_count(words);
+  out->card = card;
+  if (card == 0)
+    free(words);
+  else
+    container_from_words(out, words, card, true);
+}
+
+/* Set bits of a AND b for containers of the same chunk */
+static int container_inter_count(const container *a, const container *b) {
+  if (a->kind > b->kind) {
+    const container *swap = a;
+    a = b;
+    b = swap;
+  }
+  int count = 0;
+  if (a->kind == C_ARRAY) {
+    if (b->kind == C_ARRAY)
+      return bit_kernels_active()->array_inter(a->values, a->n, b->values,
+                                               b->n, NULL);
+    for (int i = 0; i < a->n; i++)
+      count += container_contains(b, a->values[i]);
+  } else if (a->kind == C_BITMAP) {
+    if (b->kind == C_BITMAP) {
+      struct T x = words_view(a->words, CHUNK_QWORDS);
+      struct T y = words_view(b->words, CHUNK_QWORDS);
+      return bit_kernels_active()->setop_count[BIT_OP_AND](&x, &y);
+    }
+    for (int i = 0; i < b->n; i++)
+      count += words_range_count(a->words, b->runs[i].start, b->runs[i].last);
+  } else {
+    for (int i = 0, j = 0; i < a->n && j < b->n;) {
+      const c_run x = a->runs[i], y = b->runs[j];
+      const int start = x.start > y.start ? x.start : y.start;
+      const int last = x.last < y.last ? x.last : y.last;
+      if (start <= last)
+        count += last - start + 1;
+      if (x.last <= y.last)
+        i++;
+      if (y.last <= x.last)
+        j++;
+    }
+  }
+  return count;
+}
+
+static T_C set_alloc(unsigned int length) {
+  T_C set = calloc(1, sizeof(*set));
+  assert(set != NULL);
+  set->length = length;
+  return set;
+}
+
+/* Index of the container of chunk key, or -(its insertion point) - 1 */
+static int set_find(T_C set, uint32_t key) {
+  int lo = 0, hi = set->n;
+  while (lo < hi) {
+    const int mid = lo + (hi - lo) / 2;
+    if (set->c[mid].key < key)
+      lo = mid + 1;
+    else
+      hi = mid;
+  }
+  return lo < set->n && set->c[lo].key == key ? lo : -lo - 1;
+}
+
+static void set_reserve(T_C set, int n) {
+  if (n <= set->capacity)
+    return;
+  set->capacity = set->capacity ? 2 * set->capacity : 4;
+  if (set->capacity < n)
+    set->capacity = n;
+  set->c = realloc(set->c, (size_t)set->capacity * sizeof(container));
+  assert(set->c != NULL);
+}
+
+/* An empty array container for chunk key at pos; pointers to the
+   containers of set are invalidated */
+static container *set_insert(T_C set, int pos, uint32_t key) {
+  set_reserve(set, set->n + 1);
+  memmove(&set->c[pos + 1], &set->c[pos],
+          (size_t)(set->n - pos) * sizeof(container));
+  set->n++;
+  set->c[pos] = (container){.key = key, .kind = C_ARRAY};
+  return &set->c[pos];
+}
+
+static void set_remove(T_C set, int pos) {
+  free(set->c[pos].values);
+  memmove(&set->c[pos], &set->c[pos + 1],
+          (size_t)(set->n - pos - 1) * sizeof(container));
+  set->n--;
+}
+
+/* Appends c, of a key past the last container, unless it is empty */
+static void set_append(T_C set, const container *c) {
+  if (c->card == 0)
+    return;
+  set_reserve(set, set->n + 1);
+  set->c[set->n++] = *c;
+}
+
+/* Chunk key of bitset t as a bitmap container, read in place unless it is
+   a partial last chunk, which is copied to scratch */
+static container bit_chunk(T t, uint32_t key, uint64_t *scratch) {
+  const size_t w = (size_t)key * CHUNK_QWORDS;
+  const size_t nq = t->size_in_qwords - w < CHUNK_QWORDS
+                        ? t->size_in_qwords - w
+                        : CHUNK_QWORDS;
+  container c = {.key = key, .kind = C_BITMAP, .words = t->qwords + w};
+  if (nq < CHUNK_QWORDS) {
+    memset(scratch, 0, CHUNK_BYTES);
+    memcpy(scratch, t->qwords + w, nq * sizeof(uint64_t));
+    c.words = scratch;
+  }
+  return c;
+}
+
+static uint32_t bit_chunks(T t) {
+  return (t->size_in_qwords + CHUNK_QWORDS - 1) / CHUNK_QWORDS;
+}
+
+static T_C set_op(T_C s, T_C t, bit_setop_id op) {
+  assert(s && t);
+  assert(s->length == t->length);
+  T_C out = set_alloc(s->length);
+  int i = 0, j = 0;
+  while (i < s->n || j < t->n) {
+    container r;
+    if (j == t->n || (i < s->n && s->c[i].key < t->c[j].key)) {
+      if (op == BIT_OP_AND) {
+        i++;
+        continue;
+      }
+      container_copy(&r, &s->c[i++]);
+    } else if (i == s->n || t->c[j].key < s->c[i].key) {
+      if (op == BIT_OP_AND || op == BIT_OP_AND_NOT) {
+        j++;
+        continue;
+      }
+      container_copy(&r, &t->c[j++]);
+    } else {
+      container_op(&r, &s->c[i++], &t->c[j++], op);
+    }
+    set_append(out, &r);
+  }
+  return out;
+}
+
+static T_C set_op_bit(T_C s, T t, bit_setop_id op) {
+  assert(s && t);
+  assert(s->length == t->length);
+  T_C out = set_alloc(s->length);
+  uint64_t *scratch = bitmap_alloc();
+  if (op == BIT_OP_AND || op == BIT_OP_AND_NOT) {
+    // only the chunks of s can have set bits
+    for (int i = 0; i < s->n; i++) {
+      const container b = bit_chunk(t, s->c[i].key, scratch);
+      container r;
+      container_op(&r, &s->c[i], &b, op);
+      set_append(out, &r);
+    }
+  } else {
+    for (uint32_t key = 0, i = 0; key < bit_chunks(t); key++) {
+      const container b = bit_chunk(t, key, scratch);
+      container r = {.key = key};
+      if (i < (uint32_t)s->n && s->c[i].key == key) {
+        container_op(&r, &s->c[i++], &b, op);
+      } else {
+        r.card = words_count(b.words);
+        if (r.card)
+          container_from_words(&r, b.words, r.card, false);
+      }
+      set_append(out, &r);
+    }
+  }
+  free(scratch);
+  return out;
+}
+
+static int set_inter_count(T_C s, T_C t) {
+  assert(s && t);
+  assert(s->length == t->length);
+  int count = 0;
+  for (int i = 0, j = 0; i < s->n && j < t->n;) {
+    if (s->c[i].key < t->c[j].key)
+      i++;
+    else if (t->c[j].key < s->c[i].key)
+      j++;
+    else
+      count += container_inter_count(&s->c[i++], &t->c[j++]);
+  }
+  return count;
+}
+
+static int set_inter_count_bit(T_C s, T t) {
+  assert(s && t);
+  assert(s->length == t->length);
+  uint64_t *scratch = bitmap_alloc();
+  int count = 0;
+  for (int i = 0; i < s->n; i++) {
+    const container b = bit_chunk(t, s->c[i].key, scratch);
+    count += container_inter_count(&s->c[i], &b);
+  }
+  free(scratch);
+  return count;
+}
+
+/* Sets (set) or clears bits lo to hi */
+static void set_range(T_C set, int lo, int hi, bool val) {
+  assert(set);
+  assert(lo >= 0 && lo <= hi && (unsigned int)hi < set->length);
+  for (uint32_t key = CHUNK_OF(lo); key <= CHUNK_OF(hi); key++) {
+    const unsigned int start = key == CHUNK_OF(lo) ? OFFSET_OF(lo) : 0;
+    const unsigned int last =
+        key == CHUNK_OF(hi) ? OFFSET_OF(hi) : CHUNK_BITS - 1;
+    int pos = set_find(set, key);
+    if (pos < 0 && !val)
+      continue;
+    if (start == 0 && last == CHUNK_BITS - 1) { // the whole chunk
+      if (!val) {
+        set_remove(set, pos);
+        continue;
+      }
+      container *c = pos >= 0 ? &set->c[pos] : set_insert(set, -pos - 1, key);
+      free(c->values);
+      c->kind = C_RUN;
+      c->runs = checked_malloc(sizeof(c_run));
+      c->runs[0] = (c_run){0, CHUNK_BITS - 1};
+      c->n = c->capacity = 1;
+      c->card = CHUNK_BITS;
+      continue;
+    }
+    if (pos < 0)
+      pos = -set_find(set, key) - 1, set_insert(set, pos, key);
+    container *c = &set->c[pos];
+    uint64_t *words = bitmap_alloc();
+    container_to_words(c, words);
+    words_range(words, start, last, val);
+    free(c->values);
+    c->values = NULL;
+    const int card = words_count(words);
+    if (card == 0) {
+      free(words);
+      set_remove(set, pos);
+      continue;
+    }
+    container_from_words(c, words, card, true);
+    container_optimize(c);
+  }
+}
+
+/* --- End Section 8: INTERNAL HELPER FUNCTION DEFINITIONS --- */
+
+/* ==========================================================================
+   SECTION 9: PUBLIC API
+   ========================================================================== */
+
+T_C Bit_C_new(int length) {
+  assert(length > 0 && length < INT_MAX);
+  return set_alloc((unsigned int)length);
+}
+
+void Bit_C_free(T_C *set) {
+  assert(set && *set);
+  for (int i = 0; i < (*set)->n; i++)
+    free((*set)->c[i].values);
+  free((*set)->c);
+  free(*set);
+  *set = NULL;
+}
+
+T_C Bit_C_from_bit(T bit) {
+  assert(bit);
+  T_C set = set_alloc(bit->length);
+  uint64_t *scratch = bitmap_alloc();
+  for (uint32_t key = 0; key < bit_chunks(bit); key++) {
+    const container b = bit_chunk(bit, key, scratch);
+    container c = {.key = key, .card = words_count(b.words)};
+    if (c.card == 0)
+      continue;
+    container_from_words(&c, b.words, c.card, false);
+    container_optimize(&c);
+    set_append(set, &c);
+  }
+  free(scratch);
+  return set;
+}
+
+T Bit_C_to_bit(T_C set) {
+  assert(set);
+  T bit = Bit_new((int)set->length);
+  for (int i = 0; i < set->n; i++) {
+    const container *c = &set->c[i];
+    uint64_t *words = bit->qwords + (size_t)c->key * CHUNK_QWORDS;
+    if (c->kind == C_ARRAY) {
+      for (int k = 0; k < c->n; k++)
+        words[c->values[k] / 64] |= UINT64_C(1) << (c->values[k] % 64);
+    } else if (c->kind == C_BITMAP) {
+      const size_t w = (size_t)c->key * CHUNK_QWORDS;
+      const size_t nq = bit->size_in_qwords - w < CHUNK_QWORDS
+                            ? bit->size_in_qwords - w
+                            : CHUNK_QWORDS;
+      memcpy(words, c->words, nq * sizeof(uint64_t));
+    } else {
+      for (int k = 0; k < c->n; k++)
+        words_range(words, c->runs[k].start, c->runs[k].last, true);
+    }
+  }
+  return bit;
+}
+
+int Bit_C_length(T_C set) {
+  assert(set);
+  return (int)set->length;
+}
+
+int Bit_C_count(T_C set) {
+  assert(set);
+  int count = 0;
+  for (int i = 0; i < set->n; i++)
+    count += set->c[i].card;
+  return count;
+}
+
+size_t Bit_C_size_in_bytes(T_C set) {
+  assert(set);
+  size_t bytes = sizeof(*set) + (size_t)set->capacity * sizeof(container);
+  for (int i = 0; i < set->n; i++) {
+    const container *c = &set->c[i];
+    bytes += c->kind == C_BITMAP ? CHUNK_BYTES
+             : c->kind == C_ARRAY
+                 ? (size_t)c->capacity * sizeof(uint16_t)
+                 : (size_t)c->capacity * sizeof(c_run);
+  }
+  return bytes;
+}
+
+void Bit_C_optimize(T_C set) {
+  assert(set);
+  for (int i = 0; i < set->n; i++)
+    container_optimize(&set->c[i]);
+}
+
+int Bit_C_get(T_C set, int index) {
+  assert(set);
+  assert(index >= 0 && (unsigned int)index < set->length);
+  const int pos = set_find(set, CHUNK_OF(index));
+  return pos >= 0 && container_contains(&set->c[pos], OFFSET_OF(index));
+}
+
+int Bit_C_put(T_C set, int n, int val) {
+  assert(set);
+  assert(n >= 0 && (unsigned int)n < set->length);
+  assert(val == 0 || val == 1);
+  const unsigned int v = OFFSET_OF(n);
+  int pos = set_find(set, CHUNK_OF(n));
+  if (pos < 0) {
+    if (val) {
+      container *c = set_insert(set, -pos - 1, CHUNK_OF(n));
+      c->values = checked_malloc(4 * sizeof(uint16_t));
+      c->values[0] = (uint16_t)v;
+      c->n = c->card = 1;
+      c->capacity = 4;
+    }
+    return 0;
+  }
+  container *c = &set->c[pos];
+  const int prev = container_contains(c, v);
+  if (prev == val)
+    return prev;
+  container_flatten(c);
+  if (c->kind == C_ARRAY && val && c->n == ARRAY_MAX) {
+    uint64_t *words = bitmap_alloc();
+    container_to_words(c, words);
+    free(c->values);
+    container_from_words(c, words, c->card, true);
+  }
+  if (c->kind == C_ARRAY) {
+    const int i = lower_bound(c->values, c->n, v);
+    if (val) {
+      if (c->n == c->capacity) {
+        c->capacity = 2 * c->capacity < ARRAY_MAX ? 2 * c->capacity
+                                                  : ARRAY_MAX;
+        c->values = realloc(c->values, (size_t)c->capacity * sizeof(uint16_t));
+        assert(c->values != NULL);
+      }
+      memmove(&c->values[i + 1], &c->values[i],
+              (size_t)(c->n - i) * sizeof(uint16_t));
+      c->values[i] = (uint16_t)v;
+      c->n++, c->card++;
+    } else {
+      memmove(&c->values[i], &c->values[i + 1],
+              (size_t)(c->n - i - 1) * sizeof(uint16_t));
+      c->n--, c->card--;
+      if (c->card == 0)
+        set_remove(set, pos);
+    }
+  } else {
+    c->words[v / 64] ^= UINT64_C(1) << (v % 64);
+    c->card += val ? 1 : -1;
+    if (c->card <= ARRAY_MAX) { // back to an array
+      uint64_t *words = c->words;
+      container_from_words(c, words, c->card, true);
+    }
+  }
+  return prev;
+}
+
+void Bit_C_bset(T_C set, int index) { Bit_C_put(set, index, 1); }
+
+void Bit_C_bclear(T_C set, int index) { Bit_C_put(set, index, 0); }
+
+void Bit_C_aset(T_C set, int indices[], int n) {
+  assert(set && (indices || n == 0));
+  for (int i = 0; i < n; i++)
+    Bit_C_put(set, indices[i], 1);
+}
+
+void Bit_C_set(T_C set, int lo, int hi) { set_range(set, lo, hi, true); }
+
+void Bit_C_clear(T_C set, int lo, int hi) { set_range(set, lo, hi, false); }
+
+int Bit_C_next_set(T_C set, int from) {
+  assert(set);
+  assert(from >= 0);
+  if ((unsigned int)from >= set->length)
+    return -1;
+  int pos = set_find(set, CHUNK_OF(from));
+  unsigned int v = OFFSET_OF(from);
+  if (pos < 0) {
+    pos = -pos - 1;
+    v = 0;
+  }
+  for (; pos < set->n; pos++, v = 0) {
+    const container *c = &set->c[pos];
+    const int next = container_next(c, c->key == CHUNK_OF(from) ? v : 0);
+    if (next >= 0)
+      return (int)(c->key << CHUNK_SHIFT) + next;
+  }
+  return -1;
+}
+
+int Bit_C_eq(T_C s, T_C t) {
+  const int count = Bit_C_count(s);
+  return count == Bit_C_count(t) && set_inter_count(s, t) == count;
+}
+
+T_C Bit_C_diff(T_C s, T_C t) { return set_op(s, t, BIT_OP_XOR); }
+T_C Bit_C_inter(T_C s, T_C t) { return set_op(s, t, BIT_OP_AND); }
+T_C Bit_C_minus(T_C s, T_C t) { return set_op(s, t, BIT_OP_AND_NOT); }
+T_C Bit_C_union(T_C s, T_C t) { return set_op(s, t, BIT_OP_OR); }
+
+int Bit_C_diff_count(T_C s, T_C t) {
+  const int inter = set_inter_count(s, t);
+  return Bit_C_count(s) + Bit_C_count(t) - 2 * inter;
+}
+int Bit_C_inter_count(T_C s, T_C t) { return set_inter_count(s, t); }
+int Bit_C_minus_count(T_C s, T_C t) {
+  return Bit_C_count(s) - set_inter_count(s, t);
+}
+int Bit_C_union_count(T_C s, T_C t) {
+  const int inter = set_inter_count(s, t);
+  return Bit_C_count(s) + Bit_C_count(t) - inter;
+}
+
+T_C Bit_C_diff_bit(T_C s, T t) { return set_op_bit(s, t, BIT_OP_XOR); }
+T_C Bit_C_inter_bit(T_C s, T t) { return set_op_bit(s, t, BIT_OP_AND); }
+T_C Bit_C_minus_bit(T_C s, T t) { return set_op_bit(s, t, BIT_OP_AND_NOT); }
+T_C Bit_C_union_bit(T_C s, T t) { return set_op_bit(s, t, BIT_OP_OR); }
+
+int Bit_C_diff_count_bit(T_C s, T t) {
+  const int inter = set_inter_count_bit(s, t);
+  return Bit_C_count(s) + Bit_count(t) - 2 * inter;
+}
+int Bit_C_inter_count_bit(T_C s, T t) { return set_inter_count_bit(s, t); }
+int Bit_C_minus_count_bit(T_C s, T t) {
+  return Bit_C_count(s) - set_inter_count_bit(s, t);
+}
+int Bit_C_union_count_bit(T_C s, T t) {
+  const int inter = set_inter_count_bit(s, t);
+  return Bit_C_count(s) + Bit_count(t) - inter;
+}
+
+/* --- End Section 9: PUBLIC API --- */
@@ -0,0 +1,230 @@
+/*
+    SETOP counts as int8 matrix products (see Bit_gemm_backend in
+    include/bit.h).
+
+    Over {0,1} entries, the intersection count of two rows is the dot
+    product of their bits, so the counts of a block of queries against a
+    block of targets are the product of the unpacked query block with the
+    transpose of the unpacked target block. Accelerators without a fast
+    popcount (TPUs, NPUs, AMX through oneDNN) still run that int8 product at
+    full rate. The rows are unpacked one byte per bit, a block at a time,
+    through a table of the 8 bytes of every byte value, and the product is
+    left to the GEMM the caller registers. Union, symmetric difference and
+    difference counts follow from the intersection and the row popcounts.
+
+    * License : BSD-2
+*/
+
+/* ==========================================================================
+   SECTION 1: INCLUDES
+   Standard library headers first, then project headers.
+   ========================================================================== */
+
+#include "bit.h"
+#include "omp.h"
+#include <assert.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "bit_internal.h"
+
+/* --- End Section 1: INCLUDES --- */
+
+/* ==========================================================================
+   SECTION 2: COMPILE-TIME CONFIGURATION
+   ========================================================================== */
+
+/* Queries and targets of a product: the int8 blocks take rows x bits bytes
+   and the output rows x rows int32 entries */
+#ifndef BIT_GEMM_BLOCK_QUERIES
+#define BIT_GEMM_BLOCK_QUERIES 256
+#endif
+
+#ifndef BIT_GEMM_BLOCK_TARGETS
+#define BIT_GEMM_BLOCK_TARGETS 1024
+#endif
+
+/* Inner dimension of a product, in bits (a multiple of 64) */
+#ifndef BIT_GEMM_BLOCK_BITS
+#define BIT_GEMM_BLOCK_BITS 4096
+#endif
+
+/* --- End Section 2: COMPILE-TIME CONFIGURATION --- */
+
+/* ==========================================================================
+   SECTION 6: STATIC DATA
+   ========================================================================== */
+
+static Bit_gemm_backend gemm_backend; // gemm NULL for none
+
+/* The 8 bytes, 0 or 1, of the bits of every byte value, low bit first;
+   filled when a backend is set */
+static int8_t gemm_unpack_table[256][8];
+
+/* --- End Section 6: STATIC DATA --- */
+
+/* ==========================================================================
+   SECTION 8: INTERNAL HELPER FUNCTION DEFINITIONS
+   ========================================================================== */
+
+static bool is_count_op(Bit_count_ops op) {
+  return op == BIT_COUNT_INTER || op == BIT_COUNT_UNION ||
+         op == BIT_COUNT_DIFF || op == BIT_COUNT_MINUS;
+}
+
+/* Words [w0, w0 + nw) of rows [r0, r1) of set into dst, one row of
+   nw * 64 bytes after another */
+static void gemm_unpack(T_DB set, int r0, int r1, size_t w0, size_t nw,
+                        int8_t *dst, int nthreads) {
+#pragma omp parallel for num_threads(nthreads) schedule(static)
+  for (int r = r0; r < r1; r++) {
+    const uint64_t *row = set->qwords + (size_t)r * set->stride_in_qwords;
+    int8_t *out = dst + (size_t)(r - r0) * nw * 64;
+    for (size_t w = 0; w < nw; w++) {
+      const uint64_t x = row[w0 + w];
+      for (int b = 0; b < 8; b++)
+        memcpy(out + w * 64 + b * 8, gemm_unpack_table[(x >> (8 * b)) & 0xff],
+               8);
+    }
+  }
+}
+
+static int *gemm_row_cards(T_DB set, int nthreads) {
+  int *cards = malloc((set->nelem ? set->nelem : 1) * sizeof(int));
+  assert(cards != NULL);
+  int (*count_qwords)(const uint64_t *, size_t) =
+      bit_kernels_active()->count_qwords;
+  const int nrows = (int)set->nelem;
+#pragma omp parallel for num_threads(nthreads) schedule(static)
+  for (int r = 0; r < nrows; r++)
+    cards[r] = count_qwords(set->qwords + (size_t)r * set->stride_in_qwords,
+                            set->size_in_qwords);
+  return cards;
+}
+
+/* The intersection counts of bit against bits through the backend; false
+   if the backend failed, leaving counts undefined */
+static bool gemm_inter_counts(T_DB bit, T_DB bits, int *counts,
+                              int nthreads) {
+  const int nq = (int)bit->nelem, nt = (int)bits->nelem;
+  const size_t nwords = bit->size_in_qwords;
+  const size_t block_words = BIT_GEMM_BLOCK_BITS / 64;
+  const int bq = nq < BIT_GEMM_BLOCK_QUERIES ? nq : BIT_GEMM_BLOCK_QUERIES;
+  const int bt = nt < BIT_GEMM_BLOCK_TARGETS ? nt : BIT_GEMM_BLOCK_TARGETS;
+  const size_t bw = nwords < block_words ? nwords : block_words;
+  int8_t *a = malloc((size_t)bq * bw * 64);
+  int8_t *b = malloc((size_t)bt * bw * 64);
+  int32_t *c = malloc((size_t)bq * bt * sizeof(int32_t));
+  assert(a && b && c);
+  bool ok = true;
+  // a query block is unpacked once per word block and meets every target
+  for (int q0 = 0; q0 < nq && ok; q0 += bq) {
+    const int q1 = q0 + bq < nq ? q0 + bq : nq;
+    for (size_t w0 = 0; w0 < nwords && ok; w0 += bw) {
+      const size_t nw = w0 + bw < nwords ? bw : nwords - w0;
+      gemm_unpack(bit, q0, q1, w0, nw, a, nthreads);
+      for (int t0 = 0; t0 < nt && ok; t0 += bt) {
+        const int t1 = t0 + bt < nt ? t0 + bt : nt;
+        gemm_unpack(bits, t0, t1, w0, nw, b, nthreads);
+        ok = gemm_backend.gemm(gemm_backend.ctx, q1 - q0, t1 - t0,
+                               (int)(nw * 64), a, b, c) == 0;
+        if (!ok)
+          break;
+        // the word blocks of a pair add up in counts
+#pragma omp parallel for num_threads(nthreads) schedule(static)
+        for (int q = q0; q < q1; q++) {
+          int *out = counts + (size_t)q * nt + t0;
+          const int32_t *in = c + (size_t)(q - q0) * (t1 - t0);
+          if (w0 == 0)
+            for (int t = 0; t < t1 - t0; t++)
+              out[t] = in[t];
+          else
+            for (int t = 0; t < t1 - t0; t++)
+              out[t] += in[t];
+        }
+      }
+    }
+  }
+  free(a);
+  free(b);
+  free(c);
+  return ok;
+}
+
+static void gemm_popcount_store(T_DB bit, T_DB bits, Bit_count_ops op,
+                                int *counts, SETOP_COUNT_OPTS opts) {
+  switch (op) {
+  case BIT_COUNT_INTER:
+    BitDB_inter_count_store_cpu(bit, bits, counts, opts);
+    break;
+  case BIT_COUNT_UNION:
+    BitDB_union_count_store_cpu(bit, bits, counts, opts);
+    break;
+  case BIT_COUNT_DIFF:
+    BitDB_diff_count_store_cpu(bit, bits, counts, opts);
+    break;
+  default: // BIT_COUNT_MINUS
+    BitDB_minus_count_store_cpu(bit, bits, counts, opts);
+    break;
+  }
+}
+
+/* --- End Section 8: INTERNAL HELPER FUNCTION DEFINITIONS --- */
+
+/* ==========================================================================
+   SECTION 9: PUBLIC API
+   ========================================================================== */
+
+void Bit_gemm_backend_set(const Bit_gemm_backend *backend) {
+  assert(backend == NULL || backend->gemm != NULL);
+  if (backend) {
+    for (int v = 0; v < 256; v++)
+      for (int b = 0; b < 8; b++)
+        gemm_unpack_table[v][b] = (int8_t)((v >> b) & 1);
+    gemm_backend = *backend;
+  } else
+    memset(&gemm_backend, 0, sizeof(gemm_backend));
+}
+
+const char *Bit_gemm_backend_name(void) {
+  return gemm_backend.gemm ? gemm_backend.name : NULL;
+}
+
+bool BitDB_count_store_gemm(T_DB bit, T_DB bits, Bit_count_ops op,
+                            int *counts, SETOP_COUNT_OPTS opts) {
+  assert(bit && bits && counts);
+  assert(bit->length == bits->length);
+  assert(is_count_op(op));
+  if (gemm_backend.gemm == NULL || bit->nelem == 0 || bits->nelem == 0) {
+    gemm_popcount_store(bit, bits, op, counts, opts);
+    return false;
+  }
+  const int nthreads = cpu_threads(opts);
+  if (!gemm_inter_counts(bit, bits, counts, nthreads)) {
+    gemm_popcount_store(bit, bits, op, counts, opts);
+    return false;
+  }
+  if (op == BIT_COUNT_INTER)
+    return true;
+  int *q_cards = gemm_row_cards(bit, nthreads);
+  int *t_cards = bit == bits ? q_cards : gemm_row_cards(bits, nthreads);
+  const int nq = (int)bit->nelem, nt = (int)bits->nelem;
+#pragma omp parallel for num_threads(nthreads) schedule(static)
+  for (int q = 0; q < nq; q++) {
+    int *out = counts + (size_t)q * nt;
+    for (int t = 0; t < nt; t++) {
+      const int inter = out[t];
+      out[t] = op == BIT_COUNT_UNION  ? q_cards[q] + t_cards[t] - inter
+               : op == BIT_COUNT_DIFF ? q_cards[q] + t_cards[t] - 2 * inter
+                                      : q_cards[q] - inter; // MINUS
+    }
+  }
+  if (t_cards != q_cards)
+    free(t_cards);
+  free(q_cards);
+  return true;
+}
+
+/* --- End Section 9: PUBLIC API --- */
@@ -10,7 +10,9 @@
 #include "bit.h"               // Public API declarations
 #include "omp.h"               // OpenMP parallelization
 #include <assert.h>            // assert() validation
+#include <dlfcn.h>             // dlopen of the native backends
 #include <limits.h>            // INT_MAX
+#include <stdatomic.h>         // telemetry counters
 #include <stdbool.h>           // bool type
 #include <stdint.h>            // uintptr_t and UINT64_C macros
 #include <stdlib.h>            // calloc, free
@@ -27,96 +29,2963 @@
 #define T Bit_T
 #define T_DB Bit_DB_T
 
+#ifndef NOGPU
+#include "gpu_layout_registry.h" // device layouts of the operands
+#endif
+
 #include "bit_internal.h"
+#include "bit_native.h" // native CUDA/HIP backends
 
 // Make popcount functions available on GPU device targets
 #pragma omp declare target(count_WWG)
 #pragma omp declare target(tree_adder)
-// GPU popcount alias
+/*
+  GPU popcount alias. By default the device kernels use the compiler builtin,
+  which the nvptx and amdgcn backends lower to the native popc.b64 and
+  v_bcnt_u32_b32 instructions. Building with USE_BUILTIN_POPCOUNT=0 (or with a
+  compiler that lacks the builtin) falls back to the portable WWG emulation.
+*/
+#if defined(__has_builtin)
+#if !__has_builtin(__builtin_popcountll)
+#undef USE_BUILTIN_POPCOUNT
+#endif
+#endif
+#ifdef USE_BUILTIN_POPCOUNT
+#define POPCOUNT_GPU(x) ((uint64_t)__builtin_popcountll(x))
+#define POPCOUNT32_GPU(x) ((uint32_t)__builtin_popcount(x))
+#else
 #define POPCOUNT_GPU count_WWG
+#define POPCOUNT32_GPU(x) ((uint32_t)count_WWG((uint32_t)(x)))
+#endif
+
+/* Offload architectures of the build (GPU_ARCH), a comma-separated list
+   the Makefile passes unquoted */
+#ifndef BIT_GPU_ARCHS
+#define BIT_GPU_ARCHS
+#endif
+#define GPU_ARCHS_STR(...) #__VA_ARGS__
+#define GPU_ARCHS_XSTR(...) GPU_ARCHS_STR(__VA_ARGS__)
+
+/* Devices with their own word width and memory budget; higher ids get the
+   defaults */
+#define GPU_MAX_DEVICES 64
+
+/* Word width of the default GPU kernel per device, 0 for GPU_WORD_BITS */
+static _Atomic int gpu_word_bits[GPU_MAX_DEVICES];
+
+static int gpu_device_word_bits(int device_id) {
+  const int bits =
+      device_id >= 0 && device_id < GPU_MAX_DEVICES
+          ? atomic_load_explicit(&gpu_word_bits[device_id],
+                                 memory_order_relaxed)
+          : 0;
+  return bits ? bits : GPU_WORD_BITS;
+}
+
+static bool native_count_store(T_DB bit, T_DB bits, int *counts,
+                               bit_setop_id op, SETOP_COUNT_OPTS opts);
+static bool native_multi_count_store(T_DB bit, T_DB bits, unsigned int ops,
+                                     int *const *counts,
+                                     SETOP_COUNT_OPTS opts);
+static bool native_threshold(T_DB bit, T_DB bits, int threshold,
+                             SETOP_COUNT_OPTS opts, size_t *total,
+                             int **host_q, int **host_i, int **host_c);
+
+/* NATIVE_COARSENED runs in the native backend when one is loaded and drives
+   the device; otherwise, or under a cancellation token or deadline, which
+   the backend does not look at, the OpenMP kernels count with the default
+   algorithm */
+#define NATIVE_COUNT_STORE(bit, bits, counts, op, opts)                        \
+  if ((opts).algorithm == NATIVE_COARSENED) {                                  \
+    if (!bit_stop_active(opts) &&                                              \
+        native_count_store(bit, bits, counts, op, opts))                       \
+      return;                                                                  \
+    (opts).algorithm = TRANSPOSED_TEAM_PARALLEL_SIMD;                          \
+  }
 
 /* --- 11d. GPU set operations (allocate and return counts buffer) --- */
 
 int *BitDB_inter_count_gpu(T_DB bit, T_DB bits, SETOP_COUNT_OPTS opts) {
 
-  int *counts = (int *)calloc(bit->nelem * bits->nelem, sizeof(int));
+  int *counts = (int *)calloc(BitDB_counts_size(bit, bits), sizeof(int));
   assert(counts != NULL);
-#ifndef NOGPU
   BitDB_inter_count_store_gpu(bit, bits, counts, opts);
-#else
-  BitDB_inter_count_store_cpu(bit, bits, counts, opts);
-#endif
   return counts;
 }
 
 void BitDB_inter_count_store_gpu(T_DB bit, T_DB bits, int *counts,
                                  SETOP_COUNT_OPTS opts) {
+  BIT_PROFILE_CALL(bit_profile_db_bytes(bit, bits));
+  BIT_CAPTURE_CALL(BIT_CAPTURE_COUNT_GPU, bit, bits, BIT_COUNT_INTER, 0, 0,
+                   BIT_COUNTS_I32, opts);
+  NATIVE_COUNT_STORE(bit, bits, counts, BIT_OP_AND, opts)
 #ifndef NOGPU
-  setop_count_db_gpu(bit, bits, counts, &, opts);
+  setop_count_db_gpu(bit, bits, counts, int, &, opts);
 #else
-  setop_count_db_cpu(bit, bits, counts, _AND, opts);
+  BitDB_inter_count_store_cpu(bit, bits, counts, opts);
 #endif
 }
 
 int *BitDB_union_count_gpu(T_DB bit, T_DB bits, SETOP_COUNT_OPTS opts) {
 
-  int *counts = (int *)calloc(bit->nelem * bits->nelem, sizeof(int));
+  int *counts = (int *)calloc(BitDB_counts_size(bit, bits), sizeof(int));
   assert(counts != NULL);
-#ifndef NOGPU
   BitDB_union_count_store_gpu(bit, bits, counts, opts);
-#else
-  BitDB_union_count_store_cpu(bit, bits, counts, opts);
-#endif
   return counts;
 }
 
 void BitDB_union_count_store_gpu(T_DB bit, T_DB bits, int *counts,
                                  SETOP_COUNT_OPTS opts) {
+  BIT_PROFILE_CALL(bit_profile_db_bytes(bit, bits));
+  BIT_CAPTURE_CALL(BIT_CAPTURE_COUNT_GPU, bit, bits, BIT_COUNT_UNION, 0, 0,
+                   BIT_COUNTS_I32, opts);
+  NATIVE_COUNT_STORE(bit, bits, counts, BIT_OP_OR, opts)
 #ifndef NOGPU
-  setop_count_db_gpu(bit, bits, counts, |, opts);
+  setop_count_db_gpu(bit, bits, counts, int, |, opts);
 #else
-  setop_count_db_cpu(bit, bits, counts, _OR, opts);
+  BitDB_union_count_store_cpu(bit, bits, counts, opts);
 #endif
 }
 
 int *BitDB_diff_count_gpu(T_DB bit, T_DB bits, SETOP_COUNT_OPTS opts) {
 
-  int *counts = (int *)calloc(bit->nelem * bits->nelem, sizeof(int));
+  int *counts = (int *)calloc(BitDB_counts_size(bit, bits), sizeof(int));
   assert(counts != NULL);
-#ifndef NOGPU
   BitDB_diff_count_store_gpu(bit, bits, counts, opts);
-#else
-  BitDB_diff_count_store_cpu(bit, bits, counts, opts);
-#endif
   return counts;
 }
 
 void BitDB_diff_count_store_gpu(T_DB bit, T_DB bits, int *counts,
                                 SETOP_COUNT_OPTS opts) {
+  BIT_PROFILE_CALL(bit_profile_db_bytes(bit, bits));
+  BIT_CAPTURE_CALL(BIT_CAPTURE_COUNT_GPU, bit, bits, BIT_COUNT_DIFF, 0, 0,
+                   BIT_COUNTS_I32, opts);
+  NATIVE_COUNT_STORE(bit, bits, counts, BIT_OP_XOR, opts)
 #ifndef NOGPU
-  setop_count_db_gpu(bit, bits, counts, ^, opts);
+  setop_count_db_gpu(bit, bits, counts, int, ^, opts);
 #else
-  setop_count_db_cpu(bit, bits, counts, _XOR, opts);
+  BitDB_diff_count_store_cpu(bit, bits, counts, opts);
 #endif
 }
 
 int *BitDB_minus_count_gpu(T_DB bit, T_DB bits, SETOP_COUNT_OPTS opts) {
 
-  int *counts = (int *)calloc(bit->nelem * bits->nelem, sizeof(int));
+  int *counts = (int *)calloc(BitDB_counts_size(bit, bits), sizeof(int));
   assert(counts != NULL);
-#ifndef NOGPU
   BitDB_minus_count_store_gpu(bit, bits, counts, opts);
+  return counts;
+}
+
+void BitDB_minus_count_store_gpu(T_DB bit, T_DB bits, int *counts,
+                                 SETOP_COUNT_OPTS opts) {
+  BIT_PROFILE_CALL(bit_profile_db_bytes(bit, bits));
+  BIT_CAPTURE_CALL(BIT_CAPTURE_COUNT_GPU, bit, bits, BIT_COUNT_MINUS, 0, 0,
+                   BIT_COUNTS_I32, opts);
+  NATIVE_COUNT_STORE(bit, bits, counts, BIT_OP_AND_NOT, opts)
+#ifndef NOGPU
+  setop_count_db_gpu(bit, bits, counts, int, &~, opts);
 #else
   BitDB_minus_count_store_cpu(bit, bits, counts, opts);
 #endif
-  return counts;
 }
 
-void BitDB_minus_count_store_gpu(T_DB bit, T_DB bits, int *counts,
+void BitDB_multi_count_store_gpu(T_DB bit, T_DB bits, unsigned int ops,
+                                 int *inter, int *unions, int *diff,
+                                 int *minus, SETOP_COUNT_OPTS opts) {
+  SETOP_DB_CHECKS(bit, bits)
+  assert(ops != 0 && (ops & ~(unsigned int)BIT_COUNT_ALL) == 0);
+  assert(!(ops & BIT_COUNT_INTER) || inter);
+  assert(!(ops & BIT_COUNT_UNION) || unions);
+  assert(!(ops & BIT_COUNT_DIFF) || diff);
+  assert(!(ops & BIT_COUNT_MINUS) || minus);
+  BIT_PROFILE_CALL(bit_profile_rows_bytes(bit, bits) +
+                   __builtin_popcount(ops) * BitDB_counts_size(bit, bits) *
+                       sizeof(int));
+  /* in Bit_count_ops order */
+  int *const out[] = {inter, unions, diff, minus};
+  if (opts.algorithm == NATIVE_COARSENED) {
+    if (native_multi_count_store(bit, bits, ops, out, opts))
+      return;
+    opts.algorithm = TRANSPOSED_TEAM_PARALLEL_SIMD;
+  }
+  /* one op after the other: the first count uploads the operands, the
+     last one releases them */
+  static void (*const store[])(T_DB, T_DB, int *, SETOP_COUNT_OPTS) = {
+      BitDB_inter_count_store_gpu, BitDB_union_count_store_gpu,
+      BitDB_diff_count_store_gpu, BitDB_minus_count_store_gpu};
+  for (unsigned int op = 0, left = ops; op < 4; op++) {
+    if (!(ops & 1u << op))
+      continue;
+    left &= ~(1u << op);
+    SETOP_COUNT_OPTS step = bit_stop_ignored(opts);
+    if (left)
+      step.release_1st_operand = step.release_2nd_operand = false;
+    store[op](bit, bits, out[op], step);
+    opts.upd_1st_operand = opts.upd_2nd_operand = false;
+  }
+}
+
+/* --- 11p. Narrow count matrices --- */
+
+#ifndef NOGPU
+/* One expansion of the GPU kernel per element type and op */
+#define TYPED_STORE_GPU(count_t)                                               \
+  do {                                                                         \
+    count_t *typed = counts;                                                   \
+    switch (op) {                                                              \
+    case BIT_COUNT_INTER: {                                                    \
+      setop_count_db_gpu(bit, bits, typed, count_t, &, opts);                  \
+    } break;                                                                   \
+    case BIT_COUNT_UNION: {                                                    \
+      setop_count_db_gpu(bit, bits, typed, count_t, |, opts);                  \
+    } break;                                                                   \
+    case BIT_COUNT_DIFF: {                                                     \
+      setop_count_db_gpu(bit, bits, typed, count_t, ^, opts);                  \
+    } break;                                                                   \
+    case BIT_COUNT_MINUS: {                                                    \
+      setop_count_db_gpu(bit, bits, typed, count_t, &~, opts);                 \
+    } break;                                                                   \
+    default:                                                                   \
+      assert(!"op must be a single Bit_count_ops value");                      \
+    }                                                                          \
+  } while (0)
+#endif
+
+Bit_counts_type BitDB_count_store_typed_gpu(T_DB bit, T_DB bits,
+                                            Bit_count_ops op, void *counts,
+                                            Bit_counts_type type,
+                                            SETOP_COUNT_OPTS opts) {
+#ifndef NOGPU
+  assert(bit && counts != NULL);
+  type = BitDB_counts_type(bit, type);
+  BIT_PROFILE_CALL(bit_profile_rows_bytes(bit, bits) +
+                   BitDB_counts_bytes(bit, bits, type));
+  BIT_CAPTURE_CALL(BIT_CAPTURE_COUNT_GPU, bit, bits, op, 0, 0, type, opts);
+  if (type == BIT_COUNTS_U8)
+    TYPED_STORE_GPU(uint8_t);
+  else if (type == BIT_COUNTS_U16)
+    TYPED_STORE_GPU(uint16_t);
+  else
+    TYPED_STORE_GPU(int);
+  return type;
+#else
+  return BitDB_count_store_typed_cpu(bit, bits, op, counts, type, opts);
+#endif
+}
+
+/* --- 11q. Asynchronous GPU counts --- */
+
+#ifndef NOGPU
+/* Counts of every query against target rows [first, first + rows), as a
+   deferred target task after the uploads of the queries and of the chunk */
+#define ASYNC_CHUNK_GPU(op)                                                    \
+  _Pragma(STRINGIFY(omp target teams distribute parallel for collapse(2)       \
+                        device(dev_id) nowait                                  \
+                        depend(in : task->queries_ready)                       \
+                        depend(inout : deps[c])))                              \
+  for (unsigned int k = 0; k < num_targets; k++) {                             \
+    for (unsigned int i = first; i < first + rows; i++) {                      \
+      int total_sum_for_i = 0;                                                 \
+      OMP_GPU_SIMD_REDUCTION(+, total_sum_for_i)                               \
+      for (unsigned int j = 0; j < bit_size_in_qwords; j++) {                  \
+        uint64_t x = GPU_QUERY_WORD(k, j) op GPU_TARGET_WORD(i, j);            \
+        total_sum_for_i += (uint32_t)POPCOUNT_GPU(x);                          \
+      }                                                                        \
+      counts[(uint64_t)k * n + i] = total_sum_for_i;                           \
+    }                                                                          \
+  }
+#endif
+
+Bit_async_T BitDB_count_store_gpu_async(T_DB bit, T_DB bits,
+                                        Bit_count_ops op, int *counts,
+                                        int chunk_rows,
+                                        SETOP_COUNT_OPTS opts) {
+  SETOP_DB_CHECKS(bit, bits)
+  assert(counts != NULL);
+  assert(chunk_rows >= 0);
+  Bit_async_T task = calloc(1, sizeof(*task));
+  assert(task != NULL);
+  task->bit = bit;
+  task->bits = bits;
+  task->counts = counts;
+  task->opts = opts;
+#ifndef NOGPU
+  const int dev_id = opts.device_id;
+  const bool on_device = dev_id >= 0 && dev_id < omp_get_num_devices();
+  if (!on_device) { // deferred host fallbacks gain nothing (and can hang)
+    BitDB_count_store_typed_cpu(bit, bits, op, counts, BIT_COUNTS_I32,
+                                bit_stop_ignored(opts));
+    return task;
+  }
+  task->queued = true;
+  SETOP_VAR_INIT(bit, bits, bit_qwords, bits_qwords, bit_size_in_qwords,
+                 num_targets, n)
+  const size_t bit_span = bit_stride * num_targets;
+  const size_t counts_span = (size_t)num_targets * n;
+  const unsigned int chunk = chunk_rows ? chunk_rows : BIT_ASYNC_CHUNK_ROWS;
+  const unsigned int nchunks = (n + chunk - 1) / chunk;
+  const bool shared_buffer = bit_qwords == bits_qwords;
+  task->deps = malloc(nchunks + 1);
+  assert(task->deps != NULL);
+  char *deps = task->deps;
+  registry_pin(bit_qwords, dev_id); // until BitDB_async_wait
+  registry_pin(bits_qwords, dev_id);
+  registry_pin(counts, dev_id);
+
+  /* Device buffers are allocated up front without copies: the copies are
+     the deferred tasks below, but for the dirty rows of attached operands */
+  if (DB_ATTACHED(bit, dev_id))
+    BitDB_device_sync(bit);
+  if (DB_ATTACHED(bits, dev_id))
+    BitDB_device_sync(bits);
+  bool upload_bit = opts.upd_1st_operand && !DB_ATTACHED(bit, dev_id);
+  if (!omp_target_is_present(bit_qwords, dev_id)) {
+    TARGET_GPU_ARRAY(enter, alloc, bit_qwords, 0, bit_span, dev_id)
+    upload_bit = true;
+  }
+  bool upload_bits =
+      opts.upd_2nd_operand && !shared_buffer && !DB_ATTACHED(bits, dev_id);
+  if (!omp_target_is_present(bits_qwords, dev_id)) {
+    TARGET_GPU_ARRAY(enter, alloc, bits_qwords, 0, bits_stride * n, dev_id)
+    upload_bits = true;
+  }
+  if (!omp_target_is_present(counts, dev_id)) {
+    TARGET_GPU_ARRAY(enter, alloc, counts, 0, counts_span, dev_id)
+  }
+  if (upload_bit) {
+    GPU_LAYOUT_UPLOADED(bit_qwords, dev_id);
+    _Pragma(STRINGIFY(omp target update to(bit_qwords[0:bit_span])
+                          device(dev_id) nowait
+                          depend(out : task->queries_ready)))
+    GPU_STAT_COPY(to, bit_qwords, bit_span, 0);
+  }
+  if (upload_bits)
+    GPU_LAYOUT_UPLOADED(bits_qwords, dev_id);
+
+  /* Both operands are read in the layout the registry recorded, as by
+     setop_count_db_gpu, but are never transposed: a transpose needs the
+     whole container on the device before the first chunk can start */
+  task->bits_layout = true;
+  task->bit_layout = !shared_buffer;
+  uint32_t bits_layout, bit_layout = LAYOUT_ROW_MAJOR;
+  GPU_CHECKOUT_READABLE(bits_layout, bits_qwords, n, bits_stride, dev_id);
+  if (!shared_buffer)
+    GPU_CHECKOUT_READABLE(bit_layout, bit_qwords, num_targets, bit_stride,
+                          dev_id);
+  const bool transposed = bits_layout == LAYOUT_COL_MAJOR;
+  const bool queries_transposed =
+      shared_buffer ? transposed : bit_layout == LAYOUT_COL_MAJOR;
+  const uint64_t t_row = transposed ? 1 : bits_stride;
+  const uint64_t t_col = transposed ? n : 1;
+  const uint64_t q_row = queries_transposed ? 1 : bit_stride;
+  const uint64_t q_col = queries_transposed ? (shared_buffer ? n : num_targets)
+                                            : 1;
+
+  int(*counts_rows)[n] = (int(*)[n])counts;
+  for (unsigned int c = 0; c < nchunks; c++) {
+    const unsigned int first = c * chunk;
+    const unsigned int rows = n - first < chunk ? n - first : chunk;
+    if (upload_bits) {
+      const size_t offset = (size_t)first * bits_stride;
+      const size_t span = (size_t)rows * bits_stride;
+      _Pragma(STRINGIFY(omp target update to(bits_qwords[offset:span])
+                            device(dev_id) nowait depend(out : deps[c])))
+      GPU_STAT_COPY(to, bits_qwords, span, 0);
+    }
+    switch (op) {
+    case BIT_COUNT_INTER:
+      ASYNC_CHUNK_GPU(&)
+      break;
+    case BIT_COUNT_UNION:
+      ASYNC_CHUNK_GPU(|)
+      break;
+    case BIT_COUNT_DIFF:
+      ASYNC_CHUNK_GPU(^)
+      break;
+    case BIT_COUNT_MINUS:
+      ASYNC_CHUNK_GPU(&~)
+      break;
+    default:
+      assert(!"op must be a single Bit_count_ops value");
+    }
+    _Pragma(STRINGIFY(omp target update from(counts_rows[0:num_targets]
+                                                        [first:rows])
+                          device(dev_id) nowait depend(in : deps[c])
+                          depend(inout : task->done)))
+    GPU_STAT_COPY(from, counts, (size_t)num_targets * rows, 0);
+  }
+#else
+  BitDB_count_store_typed_cpu(bit, bits, op, counts, BIT_COUNTS_I32,
+                              bit_stop_ignored(opts));
+#endif
+  return task;
+}
+
+void BitDB_async_wait(Bit_async_T *task) {
+  assert(task && *task);
+  Bit_async_T async = *task;
+#ifndef NOGPU
+  if (async->queued) {
+    T_DB bit = async->bit, bits = async->bits;
+    const SETOP_COUNT_OPTS opts = async->opts;
+    const size_t counts_span = BitDB_counts_size(bit, bits);
+    _Pragma(STRINGIFY(omp taskwait depend(inout : async->done)))
+    if (async->bit_layout)
+      release_gpu_layout(bit->qwords, opts.device_id);
+    if (async->bits_layout)
+      release_gpu_layout(bits->qwords, opts.device_id);
+    registry_unpin(bit->qwords, opts.device_id);
+    registry_unpin(bits->qwords, opts.device_id);
+    registry_unpin(async->counts, opts.device_id);
+    SETOP_FINALIZE_GPU(release, async->counts, 0, counts_span,
+                       opts.device_id)
+    if (opts.release_1st_operand) {
+      SETOP_FINALIZE_GPU(release, bit->qwords, 0,
+                         (size_t)bit->stride_in_qwords * bit->nelem,
+                         opts.device_id)
+    }
+    if (opts.release_2nd_operand) {
+      SETOP_FINALIZE_GPU(release, bits->qwords, 0,
+                         (size_t)bits->stride_in_qwords * bits->nelem,
+                         opts.device_id)
+    }
+    if (opts.release_counts) {
+      SETOP_FINALIZE_GPU(release, async->counts, 0, counts_span,
+                         opts.device_id)
+    }
+  }
+#endif
+  free(async->deps);
+  free(async);
+  *task = NULL;
+}
+
+/* --- 11r. Multi-GPU counts --- */
+
+#ifndef NOGPU
+/* Counts of every query against the first nrows rows of one shard, into
+   the num_targets x nrows device buffer shard_counts */
+#define SHARD_GPU(op)                                                          \
+  _Pragma(STRINGIFY(omp target teams distribute parallel for collapse(2)       \
+                        device(dev_id) is_device_ptr(shard_counts)))           \
+  for (unsigned int k = 0; k < num_targets; k++) {                             \
+    for (unsigned int i = 0; i < nrows; i++) {                                 \
+      int total_sum_for_i = 0;                                                 \
+      OMP_GPU_SIMD_REDUCTION(+, total_sum_for_i)                               \
+      for (unsigned int j = 0; j < bit_size_in_qwords; j++) {                  \
+        uint64_t x = GPU_QUERY_WORD(k, j) op GPU_TARGET_WORD(i, j);            \
+        total_sum_for_i += (uint32_t)POPCOUNT_GPU(x);                          \
+      }                                                                        \
+      shard_counts[(uint64_t)k * nrows + i] = total_sum_for_i;                 \
+    }                                                                          \
+  }
+
+/* Word strides of the operands of a kernel, for GPU_QUERY_WORD and
+   GPU_TARGET_WORD, and whether the targets were turned column-major */
+typedef struct {
+  bool transposed;
+  uint64_t q_row, q_col, t_row, t_col;
+} gpu_operands;
+
+/* Brings bit and bits up to date on dev_id, as SETOP_INIT_GPU does for the
+   kernels that keep no counts matrix on the device, and on a device turns
+   bits column-major. Both stay checked out and pinned until
+   gpu_operands_exit */
+static gpu_operands gpu_operands_enter(T_DB bit, T_DB bits, int dev_id,
+                                       SETOP_COUNT_OPTS opts) {
+  uint64_t *bit_qwords = bit->qwords, *bits_qwords = bits->qwords;
+  const size_t bit_span = (size_t)bit->stride_in_qwords * bit->nelem;
+  const size_t bits_span = (size_t)bits->stride_in_qwords * bits->nelem;
+  const bool shared_buffer = bit_qwords == bits_qwords;
+  gpu_operands ops;
+  ops.transposed = GPU_TRANSPOSED(dev_id);
+  registry_pin(bit_qwords, dev_id);
+  registry_pin(bits_qwords, dev_id);
+  if (DB_ATTACHED(bit, dev_id)) {
+    BitDB_device_sync(bit);
+  } else if (!omp_target_is_present(bit_qwords, dev_id)) {
+    TARGET_GPU_ARRAY(enter, to, bit_qwords, 0, bit_span, dev_id)
+    GPU_LAYOUT_UPLOADED(bit_qwords, dev_id);
+  } else if (opts.upd_1st_operand) {
+    UPDATE_GPU_ARRAY(to, bit_qwords, 0, bit_span, dev_id)
+    GPU_LAYOUT_UPLOADED(bit_qwords, dev_id);
+  }
+  if (DB_ATTACHED(bits, dev_id)) {
+    BitDB_device_sync(bits);
+  } else if (!omp_target_is_present(bits_qwords, dev_id)) {
+    TARGET_GPU_ARRAY(enter, to, bits_qwords, 0, bits_span, dev_id)
+    GPU_LAYOUT_UPLOADED(bits_qwords, dev_id);
+  } else if (opts.upd_2nd_operand) {
+    UPDATE_GPU_ARRAY(to, bits_qwords, 0, bits_span, dev_id)
+    GPU_LAYOUT_UPLOADED(bits_qwords, dev_id);
+  }
+  if (ops.transposed)
+    ENSURE_GPU_LAYOUT(bits_qwords, bits->nelem, bits->stride_in_qwords,
+                      LAYOUT_COL_MAJOR, dev_id, NULL, 0);
+  uint32_t bit_layout = LAYOUT_ROW_MAJOR;
+  if (ops.transposed && !shared_buffer)
+    GPU_CHECKOUT_READABLE(bit_layout, bit_qwords, bit->nelem,
+                          bit->stride_in_qwords, dev_id);
+  const bool queries_transposed =
+      ops.transposed && (shared_buffer || bit_layout == LAYOUT_COL_MAJOR);
+  ops.t_row = ops.transposed ? 1 : bits->stride_in_qwords;
+  ops.t_col = ops.transposed ? bits->nelem : 1;
+  ops.q_row = queries_transposed ? 1 : bit->stride_in_qwords;
+  ops.q_col = queries_transposed ? (shared_buffer ? bits->nelem : bit->nelem)
+                                 : 1;
+  return ops;
+}
+
+/* Checks the operands back in and releases those that opts asks for */
+static void gpu_operands_exit(T_DB bit, T_DB bits, int dev_id,
+                              gpu_operands ops, SETOP_COUNT_OPTS opts) {
+  uint64_t *bit_qwords = bit->qwords, *bits_qwords = bits->qwords;
+  const size_t bit_span = (size_t)bit->stride_in_qwords * bit->nelem;
+  const size_t bits_span = (size_t)bits->stride_in_qwords * bits->nelem;
+  if (ops.transposed && bit_qwords != bits_qwords)
+    release_gpu_layout(bit_qwords, dev_id);
+  if (ops.transposed)
+    release_gpu_layout(bits_qwords, dev_id);
+  registry_unpin(bit_qwords, dev_id);
+  registry_unpin(bits_qwords, dev_id);
+  if (opts.release_1st_operand) {
+    SETOP_FINALIZE_GPU(release, bit_qwords, 0, bit_span, dev_id)
+  }
+  if (opts.release_2nd_operand) {
+    SETOP_FINALIZE_GPU(release, bits_qwords, 0, bits_span, dev_id)
+  }
+}
+
+/* Counts bit against the first nrows rows of one shard of the targets on
+   dev_id, into columns [first, first + nrows) of the ncols wide host
+   counts. The shard stays on the device (column-major) unless it is
+   released */
+static void shard_count_gpu(T_DB bit, T_DB shard, Bit_count_ops op,
+                            int *counts, size_t first, size_t ncols,
+                            unsigned int nrows, int dev_id,
+                            SETOP_COUNT_OPTS opts) {
+  SETOP_VAR_INIT(bit, shard, bit_qwords, bits_qwords, bit_size_in_qwords,
+                 num_targets, n)
+  const gpu_operands ops = gpu_operands_enter(bit, shard, dev_id, opts);
+  const uint64_t t_row = ops.t_row, t_col = ops.t_col;
+  const uint64_t q_row = ops.q_row, q_col = ops.q_col;
+  assert(nrows <= n);
+
+  int *shard_counts =
+      omp_target_alloc((size_t)num_targets * nrows * sizeof(int), dev_id);
+  assert(shard_counts != NULL);
+  switch (op) {
+  case BIT_COUNT_INTER:
+    SHARD_GPU(&)
+    break;
+  case BIT_COUNT_UNION:
+    SHARD_GPU(|)
+    break;
+  case BIT_COUNT_DIFF:
+    SHARD_GPU(^)
+    break;
+  case BIT_COUNT_MINUS:
+    SHARD_GPU(&~)
+    break;
+  default:
+    assert(!"op must be a single Bit_count_ops value");
+  }
+  // the shard's block of counts goes straight into its host columns
+  const size_t volume[2] = {num_targets, nrows};
+  const size_t dst_offsets[2] = {0, first}, src_offsets[2] = {0, 0};
+  const size_t dst_dims[2] = {num_targets, ncols};
+  const size_t src_dims[2] = {num_targets, nrows};
+  omp_target_memcpy_rect(counts, shard_counts, sizeof(int), 2, volume,
+                         dst_offsets, src_offsets, dst_dims, src_dims,
+                         omp_get_initial_device(), dev_id);
+  omp_target_free(shard_counts, dev_id);
+  gpu_operands_exit(bit, shard, dev_id, ops, opts);
+}
+#endif
+
+void BitDB_count_store_gpu_multi(T_DB bit, T_DB bits, Bit_count_ops op,
+                                 int *counts, const int *devices,
+                                 const double *weights, int ndevices,
                                  SETOP_COUNT_OPTS opts) {
+  SETOP_DB_CHECKS(bit, bits)
+  assert(counts != NULL && devices != NULL && ndevices > 0);
+  BIT_PROFILE_CALL(bit_profile_db_bytes(bit, bits));
+  assert(bit->qwords + (size_t)bit->stride_in_qwords * bit->nelem <=
+             bits->qwords ||
+         bits->qwords + (size_t)bits->stride_in_qwords * bits->nelem <=
+             bit->qwords);
+  double total = 0;
+  for (int d = 0; d < ndevices; d++) {
+    assert(weights == NULL || weights[d] >= 0);
+    total += weights ? weights[d] : 1.0;
+  }
+  assert(total > 0);
+#ifndef NOGPU
+
+  // shard d holds the target rows [bounds[d], bounds[d + 1])
+  const unsigned int n = bits->nelem;
+  unsigned int *bounds = malloc((ndevices + 1) * sizeof(unsigned int));
+  assert(bounds != NULL);
+  double share = 0;
+  bounds[0] = 0;
+  for (int d = 0; d < ndevices; d++) {
+    share += weights ? weights[d] : 1.0;
+    bounds[d + 1] =
+        d + 1 == ndevices ? n : (unsigned int)(n * (share / total) + 0.5);
+  }
+
+  // attached operands are synced once, before the device threads start
+  if (bit->dirty_rows)
+    BitDB_device_sync(bit);
+  if (bits->dirty_rows)
+    BitDB_device_sync(bits);
+  OMP_CPU_LOOP_TEAM(1, static, ndevices)
+  for (int d = 0; d < ndevices; d++) {
+    if (bounds[d + 1] > bounds[d]) {
+      struct T_DB shard = *bits; // a view of the shard's rows
+      shard.nelem = bounds[d + 1] - bounds[d];
+      shard.qwords = bits->qwords + (size_t)bounds[d] * bits->stride_in_qwords;
+      shard.bytes = (unsigned char *)shard.qwords;
+      shard.row_counts = NULL;
+      shard.row_summaries = NULL;
+      shard.postings = NULL;
+      shard.row_hashes = NULL;
+      shard.dirty_rows = NULL; // shards are never attached themselves
+      shard_count_gpu(bit, &shard, op, counts, bounds[d], n, shard.nelem,
+                      devices[d], opts);
+    }
+  }
+  free(bounds);
+  /* the first shard starts at the rows of bits, so the layout the registry
+     holds for them is the shard's: an attached bits is pushed whole */
+  if (bits->dirty_rows)
+    db_mark_dirty(bits, 0, bits->nelem);
+#else
+  BitDB_count_store_typed_cpu(bit, bits, op, counts, BIT_COUNTS_I32,
+                              bit_stop_ignored(opts));
+#endif
+}
+
+/* --- 11r'. K-split counts over column partitions ---
+   Part p of the containers (the words of one range of BitDB_column_partition)
+   is counted on devices[p], one host thread per part, into a partial matrix
+   of its own; the partials are added up on the host once every device is
+   done, so no two devices ever write the same counts. Part 0 counts
+   straight into counts. */
+
+void BitDB_count_store_gpu_parts(T_DB bit_parts[], T_DB bits_parts[],
+                                 int nparts, Bit_count_ops op, int *counts,
+                                 const int *devices, SETOP_COUNT_OPTS opts) {
+  assert(bit_parts && bits_parts && counts);
+  assert(nparts > 0);
+  const unsigned int nq = bit_parts[0]->nelem, nt = bits_parts[0]->nelem;
+  for (int p = 0; p < nparts; p++) {
+    SETOP_DB_CHECKS(bit_parts[p], bits_parts[p])
+    assert(bit_parts[p]->nelem == nq && bits_parts[p]->nelem == nt);
+  }
+  const size_t size = (size_t)nq * nt;
+  int *partials =
+      nparts > 1 ? malloc((size ? size : 1) * (nparts - 1) * sizeof(int))
+                 : NULL;
+  assert(nparts == 1 || partials != NULL);
+  opts = bit_stop_ignored(opts);
+  OMP_CPU_LOOP_TEAM(1, static, nparts)
+  for (int p = 0; p < nparts; p++) {
+    SETOP_COUNT_OPTS part = opts;
+    if (devices)
+      part.device_id = devices[p];
+    BitDB_count_store_typed_gpu(bit_parts[p], bits_parts[p], op,
+                                p ? partials + (p - 1) * size : counts,
+                                BIT_COUNTS_I32, part);
+  }
+  if (nparts > 1) {
+    const long long n = (long long)size;
+    const int numthreads =
+        opts.num_cpu_threads > 0 ? opts.num_cpu_threads : omp_get_max_threads();
+#pragma omp parallel for num_threads(numthreads) schedule(static)
+    for (long long c = 0; c < n; c++) {
+      int sum = counts[c];
+      for (int p = 1; p < nparts; p++)
+        sum += partials[(size_t)(p - 1) * size + (size_t)c];
+      counts[c] = sum;
+    }
+  }
+  free(partials);
+}
+
+/* --- 11s. Device-resident containers --- */
+
+void BitDB_device_attach(T_DB set, int device_id) {
+  assert(set);
+  assert(set->dirty_rows == NULL);
+  set->dirty_rows = calloc((set->capacity + 63) / 64, sizeof(uint64_t));
+  assert(set->dirty_rows != NULL);
+  set->device_id = device_id;
+  set->device_nelem = set->nelem;
+#ifndef NOGPU
+  // the whole capacity is mapped, so that appended rows are pushed as well
+  uint64_t *qwords = set->qwords;
+  const size_t span = (size_t)set->stride_in_qwords * set->capacity;
+  if (omp_target_is_present(qwords, device_id)) {
+    // mapped (by nelem rows) in an earlier count: map the capacity instead
+    TARGET_GPU_ARRAY(exit, delete, qwords, 0,
+                     (size_t)set->stride_in_qwords * set->nelem, device_id)
+  }
+  TARGET_GPU_ARRAY(enter, to, qwords, 0, span, device_id)
+  GPU_LAYOUT_UPLOADED(qwords, device_id);
+#endif
+}
+
+int BitDB_device_sync(T_DB set) {
+  assert(set);
+  assert(set->dirty_rows != NULL);
+  const size_t nwords = (set->capacity + 63) / 64;
+  uint64_t *dirty = set->dirty_rows;
+  size_t ndirty = 0;
+  for (size_t w = 0; w < nwords; w++)
+    ndirty += POPCOUNT(dirty[w]);
+#ifndef NOGPU
+  const int dev_id = set->device_id;
+  uint64_t *qwords = set->qwords;
+  const size_t stride = set->stride_in_qwords;
+  const bool present = omp_target_is_present(qwords, dev_id);
+  if (ndirty == 0 && present)
+    return 0;
+  if (!present) {
+    // a count released the rows or the device budget evicted them: map
+    // them afresh
+    TARGET_GPU_ARRAY(enter, to, qwords, 0, stride * set->capacity, dev_id)
+    GPU_LAYOUT_UPLOADED(qwords, dev_id);
+  } else if (ndirty >= set->nelem) {
+    UPDATE_GPU_ARRAY(to, qwords, 0, stride * set->nelem, dev_id)
+    GPU_LAYOUT_UPLOADED(qwords, dev_id);
+  } else {
+    /* rows are pushed row-major: a copy the kernels transposed is turned
+       back first, on the device, in the geometry of the last sync */
+    const bool transposed = GPU_TRANSPOSED(dev_id);
+    if (transposed)
+      ENSURE_GPU_LAYOUT(qwords, set->device_nelem, stride, LAYOUT_ROW_MAJOR,
+                        dev_id, NULL, 0);
+    size_t i = 0;
+    while (i < set->nelem) {
+      if (dirty[i / 64] == 0) {
+        i = (i / 64 + 1) * 64;
+        continue;
+      }
+      if (!(dirty[i / 64] >> (i % 64) & 1)) {
+        i++;
+        continue;
+      }
+      // one update per run of consecutive dirty rows
+      const size_t first = i;
+      while (i < set->nelem && dirty[i / 64] >> (i % 64) & 1)
+        i++;
+      const size_t offset = first * stride;
+      const size_t span = (i - first) * stride;
+      UPDATE_GPU_ARRAY(to, qwords, offset, span, dev_id)
+    }
+    if (transposed)
+      release_gpu_layout(qwords, dev_id);
+  }
+#endif
+  memset(dirty, 0, nwords * sizeof(uint64_t));
+  set->device_nelem = set->nelem;
+  return (int)ndirty;
+}
+
+void BitDB_device_detach(T_DB set) {
+  assert(set);
+  assert(set->dirty_rows != NULL);
+#ifndef NOGPU
+  uint64_t *qwords = set->qwords;
+  const int dev_id = set->device_id;
+  const size_t span = (size_t)set->stride_in_qwords * set->capacity;
+  if (omp_target_is_present(qwords, dev_id)) {
+    TARGET_GPU_ARRAY(exit, delete, qwords, 0, span, dev_id)
+    registry_forget(qwords, dev_id);
+  }
+#endif
+  free(set->dirty_rows);
+  set->dirty_rows = NULL;
+}
+
+/* --- 11s'. Device row counts, column counts and reductions --- */
+
+#ifndef NOGPU
+/* Maps the rows of set to dev_id for reading, as SETOP_INIT_GPU maps an
+   operand (an attached set pushes its dirty rows), pins them, and checks
+   them out row- or column-major: word j of row i is then at
+   i * *row + j * *col */
+static void db_read_begin_gpu(T_DB set, int dev_id, bool upd, uint64_t *row,
+                              uint64_t *col) {
+  uint64_t *qwords = set->qwords;
+  const size_t span = (size_t)set->stride_in_qwords * set->nelem;
+  registry_pin(qwords, dev_id);
+  if (DB_ATTACHED(set, dev_id)) {
+    BitDB_device_sync(set);
+  } else if (omp_target_is_present(qwords, dev_id)) {
+    if (upd) {
+      UPDATE_GPU_ARRAY(to, qwords, 0, span, dev_id)
+      GPU_LAYOUT_UPLOADED(qwords, dev_id);
+    }
+  } else {
+    TARGET_GPU_ARRAY(enter, to, qwords, 0, span, dev_id)
+    GPU_LAYOUT_UPLOADED(qwords, dev_id);
+  }
+  uint32_t layout = LAYOUT_ROW_MAJOR;
+  if (GPU_TRANSPOSED(dev_id))
+    GPU_CHECKOUT_READABLE(layout, qwords, set->nelem, set->stride_in_qwords,
+                          dev_id);
+  *row = layout == LAYOUT_COL_MAJOR ? 1 : set->stride_in_qwords;
+  *col = layout == LAYOUT_COL_MAJOR ? set->nelem : 1;
+}
+
+/* Undoes db_read_begin_gpu; the rows stay resident unless release asks
+   otherwise, and an attached set always keeps them */
+static void db_read_end_gpu(T_DB set, int dev_id, bool release) {
+  uint64_t *qwords = set->qwords;
+  if (GPU_TRANSPOSED(dev_id))
+    release_gpu_layout(qwords, dev_id);
+  registry_unpin(qwords, dev_id);
+  if (release && !DB_ATTACHED(set, dev_id)) {
+    SETOP_FINALIZE_GPU(release, qwords, 0,
+                       (size_t)set->stride_in_qwords * set->nelem, dev_id)
+  }
+}
+
+/* Device counts of the columns of the n rows at qwords into d_counts, one
+   thread per column reading word c / 64 of every row */
+static void column_counts_gpu(const uint64_t *qwords, unsigned int n,
+                              unsigned int length, uint64_t row, uint64_t col,
+                              uint32_t *d_counts, int dev_id) {
+  _Pragma(STRINGIFY(omp target teams distribute parallel for device(dev_id)
+                        is_device_ptr(d_counts)))
+  for (unsigned int c = 0; c < length; c++) {
+    const uint64_t w = c / 64;
+    const unsigned int b = c % 64;
+    uint32_t sum = 0;
+    for (unsigned int i = 0; i < n; i++)
+      sum += (uint32_t)(qwords[i * row + w * col] >> b & 1);
+    d_counts[c] = sum;
+  }
+}
+#endif
+
+/* Row counts of a and of b into the arrays that are not NULL, read where
+   the rows are resident, in a single launch over the rows of both; a set
+   with a popcount cache is copied from it instead */
+static void db_row_counts_gpu(T_DB a, int *a_counts, T_DB b, int *b_counts,
+                              SETOP_COUNT_OPTS opts) {
+  const bool count_a = a_counts && a->row_counts == NULL;
+  const bool count_b = b_counts && b->row_counts == NULL;
+  if (a_counts && !count_a)
+    memcpy(a_counts, a->row_counts, (size_t)a->nelem * sizeof(int));
+  if (b_counts && !count_b)
+    memcpy(b_counts, b->row_counts, (size_t)b->nelem * sizeof(int));
+#ifndef NOGPU
+  const int dev_id = opts.device_id;
+  const unsigned int na = count_a ? a->nelem : 0;
+  const unsigned int nb = count_b ? b->nelem : 0;
+  if (na + nb == 0)
+    return;
+  // a set counted with itself has its rows read once
+  const bool shared = count_a && count_b && a->qwords == b->qwords;
+  const uint64_t *qa = a->qwords, *qb = count_b ? b->qwords : a->qwords;
+  uint64_t a_row = 0, a_col = 0, b_row = 0, b_col = 0;
+  if (count_a)
+    db_read_begin_gpu(a, dev_id, opts.upd_1st_operand, &a_row, &a_col);
+  if (count_b && !shared)
+    db_read_begin_gpu(b, dev_id, opts.upd_2nd_operand, &b_row, &b_col);
+  if (shared) {
+    b_row = a_row;
+    b_col = a_col;
+  }
+  const unsigned int nq = a->size_in_qwords;
+  int *d_counts = omp_target_alloc((size_t)(na + nb) * sizeof(int), dev_id);
+  assert(d_counts != NULL);
+  const uint64_t _kernel_start = gpu_stat_clock();
+  _Pragma(STRINGIFY(omp target teams distribute parallel for device(dev_id)
+                        is_device_ptr(d_counts)))
+  for (unsigned int r = 0; r < na + nb; r++) {
+    const bool in_a = r < na;
+    const uint64_t *rows = in_a ? qa : qb;
+    const uint64_t i = in_a ? r : r - na;
+    const uint64_t row = in_a ? a_row : b_row, col = in_a ? a_col : b_col;
+    int sum = 0;
+    for (unsigned int j = 0; j < nq; j++)
+      sum += (int)POPCOUNT_GPU(rows[i * row + j * col]);
+    d_counts[r] = sum;
+  }
+  GPU_STAT_TIME(kernel_ns, _kernel_start);
+  const int host = omp_get_initial_device();
+  if (na)
+    omp_target_memcpy(a_counts, d_counts, (size_t)na * sizeof(int), 0, 0,
+                      host, dev_id);
+  if (nb)
+    omp_target_memcpy(b_counts, d_counts, (size_t)nb * sizeof(int), 0,
+                      (size_t)na * sizeof(int), host, dev_id);
+  omp_target_free(d_counts, dev_id);
+  if (count_a)
+    db_read_end_gpu(a, dev_id, opts.release_1st_operand);
+  if (count_b && !shared)
+    db_read_end_gpu(b, dev_id, opts.release_2nd_operand);
+#else
+  if (count_a)
+    BitDB_count_store(a, a_counts, opts);
+  if (count_b)
+    BitDB_count_store(b, b_counts, opts);
+#endif
+}
+
+void BitDB_count_store_gpu(T_DB set, int *counts, SETOP_COUNT_OPTS opts) {
+  assert(set && counts);
+  BIT_PROFILE_CALL((uint64_t)set->nelem * set->size_in_bytes);
+  db_row_counts_gpu(set, counts, set, NULL, opts);
+}
+
+void BitDB_count_store_cards_gpu(T_DB bit, T_DB bits, Bit_count_ops op,
+                                 int *counts, int *bit_cards,
+                                 int *bits_cards, SETOP_COUNT_OPTS opts) {
+  assert(bit && bits && counts);
+  assert(op == BIT_COUNT_INTER || op == BIT_COUNT_UNION ||
+         op == BIT_COUNT_DIFF || op == BIT_COUNT_MINUS);
+  /* in Bit_count_ops order */
+  static void (*const store[])(T_DB, T_DB, int *, SETOP_COUNT_OPTS) = {
+      BitDB_inter_count_store_gpu, BitDB_union_count_store_gpu,
+      BitDB_diff_count_store_gpu, BitDB_minus_count_store_gpu};
+  if (!bit_cards && !bits_cards) {
+    store[__builtin_ctz((unsigned int)op)](bit, bits, counts, opts);
+    return;
+  }
+  // the operands stay for the cardinalities, which read them as they are
+  SETOP_COUNT_OPTS step = opts;
+  step.release_1st_operand = step.release_2nd_operand = false;
+  store[__builtin_ctz((unsigned int)op)](bit, bits, counts, step);
+  step.upd_1st_operand = step.upd_2nd_operand = false;
+  db_row_counts_gpu(bit, bit_cards, bits, bits_cards, step);
+#ifndef NOGPU
+  const int dev_id = opts.device_id;
+  if (opts.release_1st_operand && !DB_ATTACHED(bit, dev_id)) {
+    SETOP_FINALIZE_GPU(release, bit->qwords, 0,
+                       (size_t)bit->stride_in_qwords * bit->nelem, dev_id)
+  }
+  if (opts.release_2nd_operand && !DB_ATTACHED(bits, dev_id)) {
+    SETOP_FINALIZE_GPU(release, bits->qwords, 0,
+                       (size_t)bits->stride_in_qwords * bits->nelem, dev_id)
+  }
+#endif
+}
+
+void BitDB_column_counts_gpu(T_DB set, uint32_t *out, SETOP_COUNT_OPTS opts) {
+  assert(set);
+  assert(out != NULL);
+  BIT_PROFILE_CALL((uint64_t)set->nelem * set->size_in_bytes);
 #ifndef NOGPU
-  setop_count_db_gpu(bit, bits, counts, &~, opts);
+  const int dev_id = opts.device_id;
+  if (set->nelem == 0) {
+    memset(out, 0, (size_t)set->length * sizeof(uint32_t));
+    return;
+  }
+  uint64_t row, col;
+  db_read_begin_gpu(set, dev_id, opts.upd_1st_operand, &row, &col);
+  uint32_t *d_counts =
+      omp_target_alloc((size_t)set->length * sizeof(uint32_t), dev_id);
+  assert(d_counts != NULL);
+  const uint64_t _kernel_start = gpu_stat_clock();
+  column_counts_gpu(set->qwords, set->nelem, set->length, row, col, d_counts,
+                    dev_id);
+  GPU_STAT_TIME(kernel_ns, _kernel_start);
+  omp_target_memcpy(out, d_counts, (size_t)set->length * sizeof(uint32_t), 0,
+                    0, omp_get_initial_device(), dev_id);
+  omp_target_free(d_counts, dev_id);
+  db_read_end_gpu(set, dev_id, opts.release_1st_operand);
 #else
-  setop_count_db_cpu(bit, bits, counts, _AND_NOT, opts);
+  BitDB_column_counts(set, out, opts);
 #endif
 }
+
+void BitDB_reduce_gpu(T_DB set, Bit_reduce_op op, int k, T out,
+                      SETOP_COUNT_OPTS opts) {
+  assert(set && out);
+  assert(set->nelem > 0);
+  assert(out->length == set->length);
+  assert(op >= BIT_REDUCE_OR && op <= BIT_REDUCE_MAJORITY);
+  assert(op != BIT_REDUCE_ATLEAST || k >= 0);
+  BIT_PROFILE_CALL((uint64_t)set->nelem * set->size_in_bytes);
+#ifndef NOGPU
+  const int dev_id = opts.device_id;
+  const unsigned int n = set->nelem, nq = set->size_in_qwords;
+  const unsigned int length = set->length;
+  uint64_t row, col;
+  db_read_begin_gpu(set, dev_id, opts.upd_1st_operand, &row, &col);
+  const uint64_t *qwords = set->qwords;
+  uint64_t *d_out = omp_target_alloc((size_t)nq * sizeof(uint64_t), dev_id);
+  assert(d_out != NULL);
+  const uint64_t _kernel_start = gpu_stat_clock();
+  if (op == BIT_REDUCE_ATLEAST || op == BIT_REDUCE_MAJORITY) {
+    // a bit is kept when its column count reaches the threshold
+    const uint32_t at_least =
+        op == BIT_REDUCE_MAJORITY ? n / 2 + 1 : (uint32_t)k;
+    uint32_t *d_counts =
+        omp_target_alloc((size_t)length * sizeof(uint32_t), dev_id);
+    assert(d_counts != NULL);
+    column_counts_gpu(qwords, n, length, row, col, d_counts, dev_id);
+    _Pragma(STRINGIFY(omp target teams distribute parallel for device(dev_id)
+                          is_device_ptr(d_counts, d_out)))
+    for (unsigned int w = 0; w < nq; w++) {
+      uint64_t word = 0;
+      for (unsigned int b = 0; b < 64 && w * 64 + b < length; b++)
+        word |= (uint64_t)(d_counts[w * 64 + b] >= at_least) << b;
+      d_out[w] = word;
+    }
+    omp_target_free(d_counts, dev_id);
+  } else {
+    _Pragma(STRINGIFY(omp target teams distribute parallel for device(dev_id)
+                          is_device_ptr(d_out)))
+    for (unsigned int w = 0; w < nq; w++) {
+      uint64_t word = qwords[w * col];
+      for (unsigned int i = 1; i < n; i++) {
+        const uint64_t x = qwords[i * row + w * col];
+        word = op == BIT_REDUCE_OR    ? word | x
+               : op == BIT_REDUCE_AND ? word & x
+                                      : word ^ x;
+      }
+      d_out[w] = word;
+    }
+  }
+  GPU_STAT_TIME(kernel_ns, _kernel_start);
+  omp_target_memcpy(out->qwords, d_out, (size_t)nq * sizeof(uint64_t), 0, 0,
+                    omp_get_initial_device(), dev_id);
+  omp_target_free(d_out, dev_id);
+  db_read_end_gpu(set, dev_id, opts.release_1st_operand);
+#else
+  BitDB_reduce(set, op, k, out, opts);
+#endif
+}
+
+/* --- 11s''. Count histograms --- */
+
+#ifndef NOGPU
+/* Queries whose bins are on the device at a time in a global histogram */
+#define GPU_HISTOGRAM_QUERIES 4096
+
+/* Adds the op count of every query of [k0, k1) against every target to
+   bin d_bins[(k - k0) * nbins + count]; the bins of a query take the
+   atomics of its threads only */
+#define HISTOGRAM_KERNEL_GPU(op)                                               \
+  _Pragma(STRINGIFY(omp target teams distribute parallel for collapse(2)       \
+                        device(dev_id) is_device_ptr(d_bins)))                 \
+  for (unsigned int k = k0; k < k1; k++) {                                     \
+    for (unsigned int i = 0; i < nt; i++) {                                    \
+      unsigned int c = 0;                                                      \
+      for (unsigned int j = 0; j < nq; j++)                                    \
+        c += (unsigned int)POPCOUNT_GPU(q[k * q_row + j * q_col] op            \
+                                        t[i * t_row + j * t_col]);             \
+      _Pragma("omp atomic") d_bins[(uint64_t)(k - k0) * nbins + c]++;          \
+    }                                                                          \
+  }
+#endif
+
+void BitDB_count_histogram_gpu(T_DB bit, T_DB bits, Bit_count_ops op,
+                               bool per_query, uint64_t *hist,
+                               SETOP_COUNT_OPTS opts) {
+#ifndef NOGPU
+  SETOP_DB_CHECKS(bit, bits)
+  assert(hist != NULL);
+  assert(op == BIT_COUNT_INTER || op == BIT_COUNT_UNION ||
+         op == BIT_COUNT_DIFF || op == BIT_COUNT_MINUS);
+  BIT_PROFILE_CALL(bit_profile_rows_bytes(bit, bits));
+  const int dev_id = opts.device_id;
+  const unsigned int nk = bit->nelem, nt = bits->nelem;
+  const unsigned int nq = bit->size_in_qwords;
+  const uint64_t nbins = (uint64_t)bit->length + 1;
+  const bool shared = bit->qwords == bits->qwords;
+  uint64_t q_row, q_col, t_row, t_col;
+  db_read_begin_gpu(bit, dev_id, opts.upd_1st_operand, &q_row, &q_col);
+  if (shared) {
+    t_row = q_row;
+    t_col = q_col;
+  } else {
+    db_read_begin_gpu(bits, dev_id, opts.upd_2nd_operand, &t_row, &t_col);
+  }
+  const uint64_t *q = bit->qwords, *t = bits->qwords;
+  // a global histogram sums the bins of a block of queries at a time
+  const unsigned int step =
+      per_query ? (nk ? nk : 1) : GPU_HISTOGRAM_QUERIES;
+  const unsigned int rows = nk < step ? nk : step; // of bins on the device
+  uint64_t *d_bins = omp_target_alloc(
+      (size_t)(rows ? rows : 1) * nbins * sizeof(uint64_t), dev_id);
+  uint64_t *d_total =
+      per_query ? NULL : omp_target_alloc(nbins * sizeof(uint64_t), dev_id);
+  assert(d_bins != NULL && (per_query || d_total != NULL));
+  if (!per_query) {
+    _Pragma(STRINGIFY(omp target teams distribute parallel for device(dev_id)
+                          is_device_ptr(d_total)))
+    for (uint64_t b = 0; b < nbins; b++)
+      d_total[b] = 0;
+  }
+  const uint64_t _kernel_start = gpu_stat_clock();
+  for (unsigned int k0 = 0; k0 < nk; k0 += step) {
+    const unsigned int k1 = nk - k0 > step ? k0 + step : nk;
+    const uint64_t span = (uint64_t)(k1 - k0) * nbins;
+    _Pragma(STRINGIFY(omp target teams distribute parallel for device(dev_id)
+                          is_device_ptr(d_bins)))
+    for (uint64_t b = 0; b < span; b++)
+      d_bins[b] = 0;
+    switch (op) {
+    case BIT_COUNT_INTER:
+      HISTOGRAM_KERNEL_GPU(&)
+      break;
+    case BIT_COUNT_UNION:
+      HISTOGRAM_KERNEL_GPU(|)
+      break;
+    case BIT_COUNT_DIFF:
+      HISTOGRAM_KERNEL_GPU(^)
+      break;
+    default: // BIT_COUNT_MINUS
+      HISTOGRAM_KERNEL_GPU(&~)
+      break;
+    }
+    if (!per_query) {
+      // the bins of the block are merged on the device, one thread a bin
+      const unsigned int nblock = k1 - k0;
+      _Pragma(STRINGIFY(omp target teams distribute parallel for
+                            device(dev_id) is_device_ptr(d_bins, d_total)))
+      for (uint64_t b = 0; b < nbins; b++) {
+        uint64_t sum = 0;
+        for (unsigned int k = 0; k < nblock; k++)
+          sum += d_bins[(uint64_t)k * nbins + b];
+        d_total[b] += sum;
+      }
+    }
+  }
+  GPU_STAT_TIME(kernel_ns, _kernel_start);
+  const int host = omp_get_initial_device();
+  if (per_query)
+    omp_target_memcpy(hist, d_bins, (size_t)nk * nbins * sizeof(uint64_t), 0,
+                      0, host, dev_id);
+  else
+    omp_target_memcpy(hist, d_total, nbins * sizeof(uint64_t), 0, 0, host,
+                      dev_id);
+  omp_target_free(d_bins, dev_id);
+  if (d_total)
+    omp_target_free(d_total, dev_id);
+  db_read_end_gpu(bit, dev_id, opts.release_1st_operand);
+  if (!shared)
+    db_read_end_gpu(bits, dev_id, opts.release_2nd_operand);
+#else
+  BitDB_count_histogram_cpu(bit, bits, op, per_query, hist, opts);
+#endif
+}
+
+/* --- 11s'''. Count statistics --- */
+
+#ifndef NOGPU
+/* Counts a block of queries keeps on the device, when they are kept */
+#define GPU_STATS_COUNTS (1u << 24)
+
+/* A team per query of [k0, k1): its threads count the query against every
+   target, store the counts in d_counts unless it is NULL, and reduce their
+   sums into d_acc[k - k0] */
+#define STATS_KERNEL_GPU(op)                                                   \
+  _Pragma(STRINGIFY(omp target teams distribute device(dev_id)                 \
+                        is_device_ptr(d_acc, d_counts)))                       \
+  for (unsigned int k = k0; k < k1; k++) {                                     \
+    uint64_t sum = 0;                                                          \
+    double sumsq = 0.0;                                                        \
+    int lo = INT_MAX, hi = INT_MIN;                                            \
+    _Pragma("omp parallel for reduction(+ : sum, sumsq) reduction(min : lo) \
+             reduction(max : hi)")                                            \
+    for (unsigned int i = 0; i < nt; i++) {                                    \
+      int c = 0;                                                               \
+      for (unsigned int j = 0; j < nq; j++)                                    \
+        c += (int)POPCOUNT_GPU(q[k * q_row + j * q_col] op                     \
+                               t[i * t_row + j * t_col]);                      \
+      if (d_counts)                                                            \
+        d_counts[(uint64_t)(k - k0) * nt + i] = c;                             \
+      sum += (uint64_t)c;                                                      \
+      sumsq += (double)c * c;                                                  \
+      lo = c < lo ? c : lo;                                                    \
+      hi = c > hi ? c : hi;                                                    \
+    }                                                                          \
+    d_acc[k - k0] = (bit_stats_acc){nt, sum, sumsq, lo, hi};                   \
+  }
+#endif
+
+void BitDB_count_stats_gpu(T_DB bit, T_DB bits, Bit_count_ops op,
+                           Bit_count_stats *stats, int *counts,
+                           SETOP_COUNT_OPTS opts) {
+#ifndef NOGPU
+  SETOP_DB_CHECKS(bit, bits)
+  assert(stats != NULL);
+  assert(op == BIT_COUNT_INTER || op == BIT_COUNT_UNION ||
+         op == BIT_COUNT_DIFF || op == BIT_COUNT_MINUS);
+  BIT_PROFILE_CALL(bit_profile_rows_bytes(bit, bits));
+  const int dev_id = opts.device_id;
+  const unsigned int nk = bit->nelem, nt = bits->nelem;
+  const unsigned int nq = bit->size_in_qwords;
+  const bool shared = bit->qwords == bits->qwords;
+  uint64_t q_row, q_col, t_row, t_col;
+  db_read_begin_gpu(bit, dev_id, opts.upd_1st_operand, &q_row, &q_col);
+  if (shared) {
+    t_row = q_row;
+    t_col = q_col;
+  } else {
+    db_read_begin_gpu(bits, dev_id, opts.upd_2nd_operand, &t_row, &t_col);
+  }
+  const uint64_t *q = bit->qwords, *t = bits->qwords;
+  // the counts, when kept, come back a block of queries at a time
+  unsigned int step = nk ? nk : 1;
+  if (counts && nt && GPU_STATS_COUNTS / nt < step)
+    step = GPU_STATS_COUNTS / nt > 0 ? GPU_STATS_COUNTS / nt : 1;
+  const unsigned int rows = nk < step ? nk : step;
+  bit_stats_acc *acc = malloc((size_t)(nk ? nk : 1) * sizeof(*acc));
+  bit_stats_acc *d_acc =
+      omp_target_alloc((size_t)(rows ? rows : 1) * sizeof(*d_acc), dev_id);
+  int *d_counts =
+      counts && nt ? omp_target_alloc((size_t)(rows ? rows : 1) * nt *
+                                          sizeof(int),
+                                      dev_id)
+                   : NULL;
+  assert(acc != NULL && d_acc != NULL && (!counts || !nt || d_counts));
+  const int host = omp_get_initial_device();
+  const uint64_t _kernel_start = gpu_stat_clock();
+  for (unsigned int k0 = 0; k0 < nk; k0 += step) {
+    const unsigned int k1 = nk - k0 > step ? k0 + step : nk;
+    switch (op) {
+    case BIT_COUNT_INTER:
+      STATS_KERNEL_GPU(&)
+      break;
+    case BIT_COUNT_UNION:
+      STATS_KERNEL_GPU(|)
+      break;
+    case BIT_COUNT_DIFF:
+      STATS_KERNEL_GPU(^)
+      break;
+    default: // BIT_COUNT_MINUS
+      STATS_KERNEL_GPU(&~)
+      break;
+    }
+    omp_target_memcpy(acc + k0, d_acc, (size_t)(k1 - k0) * sizeof(*acc), 0, 0,
+                      host, dev_id);
+    if (d_counts)
+      omp_target_memcpy(counts + (size_t)k0 * nt, d_counts,
+                        (size_t)(k1 - k0) * nt * sizeof(int), 0, 0, host,
+                        dev_id);
+  }
+  GPU_STAT_TIME(kernel_ns, _kernel_start);
+  for (unsigned int k = 0; k < nk; k++)
+    bit_stats_finish(&acc[k], &stats[k]);
+  free(acc);
+  omp_target_free(d_acc, dev_id);
+  if (d_counts)
+    omp_target_free(d_counts, dev_id);
+  db_read_end_gpu(bit, dev_id, opts.release_1st_operand);
+  if (!shared)
+    db_read_end_gpu(bits, dev_id, opts.release_2nd_operand);
+#else
+  BitDB_count_stats_cpu(bit, bits, op, stats, counts, opts);
+#endif
+}
+
+/* --- 11t. GPU search modes: top-k and threshold counts --- */
+
+#ifndef NOGPU
+/* Threads that keep candidate lists in the first pass of the top-k search */
+#define GPU_TOPK_THREADS 65536
+
+/* Intersection count of query k and target i, into the int c */
+#define GPU_INTER_COUNT(k, i, c)                                               \
+  c = 0;                                                                       \
+  for (unsigned int j = 0; j < bit_size_in_qwords; j++)                        \
+    c += (int)POPCOUNT_GPU(GPU_QUERY_WORD(k, j) & GPU_TARGET_WORD(i, j));
+
+/* Inserts (i, c) into the k slots idx/count, kept best first (ties to the
+   lower index), if it beats the last one; empty slots hold -1 */
+#define GPU_TOPK_INSERT(idx, count, k, i, c)                                   \
+  if ((c) > (count)[(k) - 1] ||                                                \
+      ((c) == (count)[(k) - 1] && (int)(i) < (idx)[(k) - 1])) {                \
+    int r = (k) - 1;                                                           \
+    while (r > 0 && ((c) > (count)[r - 1] ||                                   \
+                     ((c) == (count)[r - 1] && (int)(i) < (idx)[r - 1]))) {    \
+      (idx)[r] = (idx)[r - 1];                                                 \
+      (count)[r] = (count)[r - 1];                                             \
+      r--;                                                                     \
+    }                                                                          \
+    (idx)[r] = (int)(i);                                                       \
+    (count)[r] = (c);                                                          \
+  }
+
+/* Device list of the targets opts.row_mask selects, and their number in
+   *nsel; NULL, with all n targets in *nsel, without a mask */
+static int *gpu_row_select(T_DB bits, SETOP_COUNT_OPTS opts, int dev_id,
+                           unsigned int *nsel) {
+  *nsel = (unsigned int)bits->nelem;
+  if (opts.row_mask == NULL)
+    return NULL;
+  int *rows = malloc((bits->nelem ? bits->nelem : 1) * sizeof(int));
+  assert(rows != NULL);
+  *nsel = (unsigned int)db_mask_rows(bits, opts.row_mask, rows);
+  int *sel = omp_target_alloc((*nsel ? *nsel : 1) * sizeof(int), dev_id);
+  assert(sel != NULL);
+  omp_target_memcpy(sel, rows, *nsel * sizeof(int), 0, 0, dev_id,
+                    omp_get_initial_device());
+  free(rows);
+  return sel;
+}
+#endif
+
+typedef struct {
+  int idx, count;
+} gpu_match;
+
+static int gpu_match_compare(const void *a, const void *b) {
+  return ((const gpu_match *)a)->idx - ((const gpu_match *)b)->idx;
+}
+
+/* Threshold lists from the total matches (host_q[m], host_i[m], host_c[m])
+   of num_queries queries, found in any order: taken to the row IDs of the
+   queries and targets (see BitDB_reorder), bucketed by query into offsets,
+   then sorted by target. host_i and host_c become *out_idx and *out_count,
+   and host_q is freed */
+static size_t threshold_lists(T_DB bit, T_DB bits, size_t total, int *host_q,
+                              int *host_i, int *host_c, size_t *offsets,
+                              int **out_idx, int **out_count) {
+  const size_t num_queries = bit->nelem;
+  gpu_match *matches = malloc((total ? total : 1) * sizeof(gpu_match));
+  size_t *cursor = malloc((num_queries + 1) * sizeof(size_t));
+  assert(matches && cursor);
+  for (size_t m = 0; bit->row_ids && m < total; m++)
+    host_q[m] = bit->row_ids[host_q[m]];
+  for (size_t m = 0; bits->row_ids && m < total; m++)
+    host_i[m] = bits->row_ids[host_i[m]];
+  memset(offsets, 0, (num_queries + 1) * sizeof(size_t));
+  for (size_t m = 0; m < total; m++)
+    offsets[host_q[m] + 1]++;
+  for (size_t q = 0; q < num_queries; q++)
+    offsets[q + 1] += offsets[q];
+  memcpy(cursor, offsets, (num_queries + 1) * sizeof(size_t));
+  for (size_t m = 0; m < total; m++)
+    matches[cursor[host_q[m]]++] = (gpu_match){host_i[m], host_c[m]};
+  for (size_t q = 0; q < num_queries; q++)
+    qsort(matches + offsets[q], offsets[q + 1] - offsets[q],
+          sizeof(gpu_match), gpu_match_compare);
+  // the index and count lists take over the buffers of the copies
+  for (size_t m = 0; m < total; m++) {
+    host_i[m] = matches[m].idx;
+    host_c[m] = matches[m].count;
+  }
+  *out_idx = host_i;
+  *out_count = host_c;
+  free(cursor);
+  free(matches);
+  free(host_q);
+  return total;
+}
+
+#ifndef NOGPU
+/* Top-k lists of the rows of bit taken to the row IDs of the queries and
+   targets (see BitDB_reorder): every list moves to the slot of its query's
+   ID, and targets of equal counts are put back in order of their IDs */
+static void topk_row_ids(T_DB bit, T_DB bits, int k, int *out_idx,
+                         int *out_count) {
+  const size_t nslots = (size_t)bit->nelem * k;
+  int *idx = malloc(nslots * sizeof(int));
+  int *count = malloc(nslots * sizeof(int));
+  assert(idx && count);
+  memcpy(idx, out_idx, nslots * sizeof(int));
+  memcpy(count, out_count, nslots * sizeof(int));
+  for (size_t q = 0; q < bit->nelem; q++) {
+    const size_t slot = (size_t)(bit->row_ids ? bit->row_ids[q] : (int)q) * k;
+    for (int r = 0; r < k; r++) {
+      int i = idx[q * k + r], c = count[q * k + r];
+      if (i >= 0 && bits->row_ids)
+        i = bits->row_ids[i];
+      int at = r; // insertion by decreasing count, then increasing ID
+      while (at > 0 && c >= 0 &&
+             (out_count[slot + at - 1] < c ||
+              (out_count[slot + at - 1] == c && out_idx[slot + at - 1] > i))) {
+        out_idx[slot + at] = out_idx[slot + at - 1];
+        out_count[slot + at] = out_count[slot + at - 1];
+        at--;
+      }
+      out_idx[slot + at] = i;
+      out_count[slot + at] = c;
+    }
+  }
+  free(idx);
+  free(count);
+}
+#endif
+
+void BitDB_inter_count_topk_gpu(T_DB bit, T_DB bits, int k,
+                                SETOP_COUNT_OPTS opts, int *out_idx,
+                                int *out_count) {
+  SETOP_DB_CHECKS(bit, bits)
+  assert(k > 0);
+  assert(out_idx && out_count);
+  BIT_PROFILE_CALL(bit_profile_rows_bytes(bit, bits));
+  BIT_CAPTURE_CALL(BIT_CAPTURE_TOPK_GPU, bit, bits, BIT_COUNT_INTER, k, 0, 0,
+                   opts);
+#ifndef NOGPU
+  SETOP_VAR_INIT(bit, bits, bit_qwords, bits_qwords, bit_size_in_qwords,
+                 num_targets, n)
+  const int dev_id = opts.device_id;
+  const gpu_operands ops = gpu_operands_enter(bit, bits, dev_id, opts);
+  const uint64_t t_row = ops.t_row, t_col = ops.t_col;
+  const uint64_t q_row = ops.q_row, q_col = ops.q_col;
+  unsigned int nsel; // targets searched, sel[m] if there is a row_mask
+  int *sel = gpu_row_select(bits, opts, dev_id, &nsel);
+
+  /* first pass: thread (q, s) keeps the k best of the targets s, s + nseg,
+     ..., so that neighbouring threads read neighbouring target columns */
+  unsigned int nseg = GPU_TOPK_THREADS / num_targets;
+  if (nseg > nsel / (unsigned int)k)
+    nseg = nsel / (unsigned int)k;
+  if (nseg == 0)
+    nseg = 1;
+  const size_t nslots = (size_t)num_targets * k;
+  const size_t ncand = nslots * nseg;
+  int *cand_idx = omp_target_alloc(ncand * sizeof(int), dev_id);
+  int *cand_count = omp_target_alloc(ncand * sizeof(int), dev_id);
+  int *top_idx = omp_target_alloc(nslots * sizeof(int), dev_id);
+  int *top_count = omp_target_alloc(nslots * sizeof(int), dev_id);
+  assert(cand_idx && cand_count && top_idx && top_count);
+  _Pragma(STRINGIFY(omp target teams distribute parallel for collapse(2)
+                        device(dev_id)
+                        is_device_ptr(cand_idx, cand_count, sel)))
+  for (unsigned int q = 0; q < num_targets; q++) {
+    for (unsigned int s = 0; s < nseg; s++) {
+      int *idx = cand_idx + ((size_t)q * nseg + s) * k;
+      int *count = cand_count + ((size_t)q * nseg + s) * k;
+      for (int r = 0; r < k; r++)
+        idx[r] = count[r] = -1;
+      for (unsigned int m = s; m < nsel; m += nseg) {
+        const unsigned int i = sel ? (unsigned int)sel[m] : m;
+        int c;
+        GPU_INTER_COUNT(q, i, c)
+        GPU_TOPK_INSERT(idx, count, k, i, c)
+      }
+    }
+  }
+  // second pass: the nseg lists of every query merge into its k best
+  _Pragma(STRINGIFY(omp target teams distribute parallel for device(dev_id)
+                        is_device_ptr(cand_idx, cand_count, top_idx,
+                                      top_count)))
+  for (unsigned int q = 0; q < num_targets; q++) {
+    int *idx = top_idx + (size_t)q * k;
+    int *count = top_count + (size_t)q * k;
+    for (int r = 0; r < k; r++)
+      idx[r] = count[r] = -1;
+    for (size_t m = (size_t)q * nseg * k; m < (size_t)(q + 1) * nseg * k;
+         m++) {
+      const int i = cand_idx[m], c = cand_count[m];
+      if (i >= 0) {
+        GPU_TOPK_INSERT(idx, count, k, i, c)
+      }
+    }
+  }
+  // only the k results of every query cross to the host
+  omp_target_memcpy(out_idx, top_idx, nslots * sizeof(int), 0, 0,
+                    omp_get_initial_device(), dev_id);
+  omp_target_memcpy(out_count, top_count, nslots * sizeof(int), 0, 0,
+                    omp_get_initial_device(), dev_id);
+  omp_target_free(cand_idx, dev_id);
+  omp_target_free(cand_count, dev_id);
+  omp_target_free(top_idx, dev_id);
+  omp_target_free(top_count, dev_id);
+  if (sel)
+    omp_target_free(sel, dev_id);
+  gpu_operands_exit(bit, bits, dev_id, ops, opts);
+  if (bit->row_ids || bits->row_ids)
+    topk_row_ids(bit, bits, k, out_idx, out_count);
+#else
+  BitDB_inter_count_topk(bit, bits, k, opts, out_idx, out_count);
+#endif
+}
+
+size_t BitDB_inter_count_threshold_gpu(T_DB bit, T_DB bits, int threshold,
+                                       SETOP_COUNT_OPTS opts, size_t *offsets,
+                                       int **out_idx, int **out_count) {
+  SETOP_DB_CHECKS(bit, bits)
+  assert(offsets && out_idx && out_count);
+  BIT_PROFILE_CALL(bit_profile_rows_bytes(bit, bits));
+  BIT_CAPTURE_CALL(BIT_CAPTURE_THRESHOLD_GPU, bit, bits, BIT_COUNT_INTER,
+                   threshold, 0, 0, opts);
+  size_t total;
+  int *host_q, *host_i, *host_c;
+  if (opts.algorithm == NATIVE_COARSENED && opts.row_mask == NULL) {
+    if (native_threshold(bit, bits, threshold, opts, &total, &host_q, &host_i,
+                         &host_c))
+      return threshold_lists(bit, bits, total, host_q, host_i, host_c,
+                             offsets, out_idx, out_count);
+    opts.algorithm = TRANSPOSED_TEAM_PARALLEL_SIMD;
+  }
+#ifndef NOGPU
+  SETOP_VAR_INIT(bit, bits, bit_qwords, bits_qwords, bit_size_in_qwords,
+                 num_targets, n)
+  const int dev_id = opts.device_id;
+  const gpu_operands ops = gpu_operands_enter(bit, bits, dev_id, opts);
+  const uint64_t t_row = ops.t_row, t_col = ops.t_col;
+  const uint64_t q_row = ops.q_row, q_col = ops.q_col;
+  unsigned int nsel; // targets searched, sel[m] if there is a row_mask
+  int *sel = gpu_row_select(bits, opts, dev_id, &nsel);
+
+  /* matches are appended to one device list as they are found; a list that
+     overflows still counts them all, so one more pass fits them exactly */
+  size_t capacity = (size_t)num_targets * 64;
+  int *match_q, *match_i, *match_c;
+  for (;;) {
+    match_q = omp_target_alloc(capacity * sizeof(int), dev_id);
+    match_i = omp_target_alloc(capacity * sizeof(int), dev_id);
+    match_c = omp_target_alloc(capacity * sizeof(int), dev_id);
+    assert(match_q && match_i && match_c);
+    total = 0;
+    _Pragma(STRINGIFY(omp target teams distribute parallel for collapse(2)
+                          device(dev_id) map(tofrom : total)
+                          is_device_ptr(match_q, match_i, match_c, sel)))
+    for (unsigned int q = 0; q < num_targets; q++) {
+      for (unsigned int m = 0; m < nsel; m++) {
+        const unsigned int i = sel ? (unsigned int)sel[m] : m;
+        int c;
+        GPU_INTER_COUNT(q, i, c)
+        if (c >= threshold) {
+          size_t slot;
+          _Pragma("omp atomic capture")
+          slot = total++;
+          if (slot < capacity) {
+            match_q[slot] = (int)q;
+            match_i[slot] = (int)i;
+            match_c[slot] = c;
+          }
+        }
+      }
+    }
+    if (total <= capacity)
+      break;
+    omp_target_free(match_q, dev_id);
+    omp_target_free(match_i, dev_id);
+    omp_target_free(match_c, dev_id);
+    capacity = total;
+  }
+  host_q = malloc((total ? total : 1) * sizeof(int));
+  host_i = malloc((total ? total : 1) * sizeof(int));
+  host_c = malloc((total ? total : 1) * sizeof(int));
+  assert(host_q && host_i && host_c);
+  const int host = omp_get_initial_device();
+  omp_target_memcpy(host_q, match_q, total * sizeof(int), 0, 0, host, dev_id);
+  omp_target_memcpy(host_i, match_i, total * sizeof(int), 0, 0, host, dev_id);
+  omp_target_memcpy(host_c, match_c, total * sizeof(int), 0, 0, host, dev_id);
+  omp_target_free(match_q, dev_id);
+  omp_target_free(match_i, dev_id);
+  omp_target_free(match_c, dev_id);
+  if (sel)
+    omp_target_free(sel, dev_id);
+  gpu_operands_exit(bit, bits, dev_id, ops, opts);
+  return threshold_lists(bit, bits, total, host_q, host_i, host_c, offsets,
+                         out_idx, out_count);
+#else
+  return BitDB_inter_count_threshold(bit, bits, threshold, opts, offsets,
+                                     out_idx, out_count);
+#endif
+}
+
+#ifndef NOGPU
+/* Rows and columns of a bit matrix of BitDB_inter_count_threshold_bits_gpu
+   taken to the row IDs of the queries and targets (see BitDB_reorder) */
+static T_DB threshold_bits_row_ids(T_DB bit, T_DB bits, T_DB found) {
+  T_DB out = BitDB_new((int)bits->nelem, (int)bit->nelem);
+  for (size_t q = 0; q < bit->nelem; q++) {
+    const uint64_t *src = found->qwords + q * found->stride_in_qwords;
+    uint64_t *dst =
+        out->qwords +
+        (size_t)(bit->row_ids ? bit->row_ids[q] : (int)q) *
+            out->stride_in_qwords;
+    for (size_t w = 0; w < found->size_in_qwords; w++)
+      for (uint64_t word = src[w]; word; word &= word - 1) {
+        const int i = (int)(w * 64) + __builtin_ctzll(word);
+        const int t = bits->row_ids ? bits->row_ids[i] : i;
+        dst[t / 64] |= UINT64_C(1) << (t % 64);
+      }
+  }
+  BitDB_free(&found);
+  return out;
+}
+#endif
+
+T_DB BitDB_inter_count_threshold_bits_gpu(T_DB bit, T_DB bits, int threshold,
+                                          SETOP_COUNT_OPTS opts) {
+  SETOP_DB_CHECKS(bit, bits)
+  BIT_PROFILE_CALL(bit_profile_rows_bytes(bit, bits));
+#ifndef NOGPU
+  SETOP_VAR_INIT(bit, bits, bit_qwords, bits_qwords, bit_size_in_qwords,
+                 num_targets, n)
+  const int dev_id = opts.device_id;
+  const gpu_operands ops = gpu_operands_enter(bit, bits, dev_id, opts);
+  const uint64_t t_row = ops.t_row, t_col = ops.t_col;
+  const uint64_t q_row = ops.q_row, q_col = ops.q_col;
+  T_DB found = BitDB_new((int)bits->nelem, (int)num_targets);
+  const unsigned int nwords = found->size_in_qwords;
+  const unsigned int stride = found->stride_in_qwords;
+  const size_t nout = (size_t)num_targets * stride;
+  const int host = omp_get_initial_device();
+  uint64_t *words = omp_target_alloc(nout * sizeof(uint64_t), dev_id);
+  assert(words != NULL);
+  uint64_t *mask = NULL; // the words of row_mask, one per output word
+  if (opts.row_mask) {
+    assert((size_t)opts.row_mask->length == bits->nelem);
+    mask = omp_target_alloc(nwords * sizeof(uint64_t), dev_id);
+    assert(mask != NULL);
+    omp_target_memcpy(mask, opts.row_mask->qwords, nwords * sizeof(uint64_t),
+                      0, 0, dev_id, host);
+  }
+
+  /* thread (q, w) writes word w of query q's row: the compares of its 64
+     targets against threshold packed into one word, as a warp ballot would,
+     for the targets the mask leaves in it; the padding of a row is zero */
+  _Pragma(STRINGIFY(omp target teams distribute parallel for collapse(2)
+                        device(dev_id) is_device_ptr(words, mask)))
+  for (unsigned int q = 0; q < num_targets; q++) {
+    for (unsigned int w = 0; w < stride; w++) {
+      uint64_t live = 0, word = 0;
+      if (w < nwords) {
+        live = n - w * 64 >= 64 ? ~UINT64_C(0)
+                                : (UINT64_C(1) << (n - w * 64)) - 1;
+        if (mask)
+          live &= mask[w];
+      }
+      for (; live; live &= live - 1) {
+        const unsigned int l = (unsigned int)__builtin_ctzll(live);
+        const unsigned int i = w * 64 + l;
+        int c;
+        GPU_INTER_COUNT(q, i, c)
+        word |= (uint64_t)(c >= threshold) << l;
+      }
+      words[(size_t)q * stride + w] = word;
+    }
+  }
+  // only the bit matrix crosses to the host, 1/32 of the int counts
+  omp_target_memcpy(found->qwords, words, nout * sizeof(uint64_t), 0, 0, host,
+                    dev_id);
+  omp_target_free(words, dev_id);
+  if (mask)
+    omp_target_free(mask, dev_id);
+  gpu_operands_exit(bit, bits, dev_id, ops, opts);
+  if (bit->row_ids || bits->row_ids)
+    found = threshold_bits_row_ids(bit, bits, found);
+  return found;
+#else
+  return BitDB_inter_count_threshold_bits(bit, bits, threshold, opts);
+#endif
+}
+
+/* --- 11u. Hybrid CPU + GPU counts --- */
+
+#ifndef NOGPU
+/* Calibrated share of the target rows given to each device, 0 until its
+   first hybrid call; shared by every thread, updated after each call */
+#define BIT_HYBRID_DEVICES 64
+static double hybrid_share[BIT_HYBRID_DEVICES];
+#endif
+
+double BitDB_hybrid_share(int device_id) {
+#ifndef NOGPU
+  if (device_id < 0 || device_id >= BIT_HYBRID_DEVICES)
+    return 0.5;
+  double share;
+  _Pragma("omp atomic read")
+  share = hybrid_share[device_id];
+  return share > 0 ? share : 0.5;
+#else
+  (void)device_id;
+  return 0;
+#endif
+}
+
+/* Splits the target rows: [0, split) are counted on opts.device_id by one
+   host thread while the others count [split, n) on the CPU. The device has
+   the whole of bits, in its usual column-major copy, so the split may move
+   from call to call without a new upload */
+static void hybrid_count(T_DB bit, T_DB bits, Bit_count_ops op, int *counts,
+                         SETOP_COUNT_OPTS opts) {
+  SETOP_DB_CHECKS(bit, bits)
+  assert(counts != NULL);
+#ifndef NOGPU
+  const int dev_id = opts.device_id;
+  const unsigned int n = bits->nelem, nq = bit->nelem;
+  const int numthreads =
+      opts.num_cpu_threads > 0 ? opts.num_cpu_threads : omp_get_max_threads();
+  if (dev_id < 0 || dev_id >= omp_get_num_devices() ||
+      dev_id >= BIT_HYBRID_DEVICES || n < 2 || numthreads < 2 ||
+      bit_stop_active(opts)) { // a stop is looked at on the CPU alone
+    BitDB_count_store_typed_cpu(bit, bits, op, counts, BIT_COUNTS_I32, opts);
+    return;
+  }
+  const double share = BitDB_hybrid_share(dev_id);
+  unsigned int split = (unsigned int)(n * share + 0.5);
+  if (split < 1) // both sides keep a row, so that both rates are measured
+    split = 1;
+  if (split > n - 1)
+    split = n - 1;
+
+  // the CPU side counts a view of its rows into a block of its own
+  struct T_DB cpu_rows = *bits;
+  cpu_rows.nelem = n - split;
+  cpu_rows.qwords = bits->qwords + (size_t)split * bits->stride_in_qwords;
+  cpu_rows.bytes = (unsigned char *)cpu_rows.qwords;
+  cpu_rows.row_counts = NULL;
+  cpu_rows.row_summaries = NULL;
+  cpu_rows.postings = NULL;
+  cpu_rows.row_hashes = NULL;
+  cpu_rows.dirty_rows = NULL;
+  int *cpu_counts = malloc((size_t)nq * cpu_rows.nelem * sizeof(int));
+  assert(cpu_counts != NULL);
+  SETOP_COUNT_OPTS cpu_opts = opts;
+  cpu_opts.num_cpu_threads = numthreads - 1;
+
+  double gpu_time = 0, cpu_time = 0;
+  int levels = omp_get_max_active_levels();
+  if (levels < 2)
+    omp_set_max_active_levels(2); // the CPU team nests in its section
+#pragma omp parallel sections num_threads(2)
+  {
+#pragma omp section
+    {
+      double start = omp_get_wtime();
+      shard_count_gpu(bit, bits, op, counts, 0, n, split, dev_id, opts);
+      gpu_time = omp_get_wtime() - start;
+    }
+#pragma omp section
+    {
+      double start = omp_get_wtime();
+      BitDB_count_store_typed_cpu(bit, &cpu_rows, op, cpu_counts,
+                                  BIT_COUNTS_I32, cpu_opts);
+      cpu_time = omp_get_wtime() - start;
+    }
+  }
+  if (levels < 2)
+    omp_set_max_active_levels(levels);
+  for (unsigned int k = 0; k < nq; k++)
+    memcpy(counts + (size_t)k * n + split,
+           cpu_counts + (size_t)k * cpu_rows.nelem,
+           cpu_rows.nelem * sizeof(int));
+  free(cpu_counts);
+
+  /* the share that would have finished both sides together, averaged with
+     the previous one; the first (warm-up) call sets it outright */
+  const double gpu_rate = split / (gpu_time > 0 ? gpu_time : 1e-9);
+  const double cpu_rate = (n - split) / (cpu_time > 0 ? cpu_time : 1e-9);
+  double measured = gpu_rate / (gpu_rate + cpu_rate);
+  double old;
+  _Pragma("omp atomic read")
+  old = hybrid_share[dev_id];
+  if (old > 0)
+    measured = 0.5 * (old + measured);
+  _Pragma("omp atomic write")
+  hybrid_share[dev_id] = measured;
+#else
+  BitDB_count_store_typed_cpu(bit, bits, op, counts, BIT_COUNTS_I32, opts);
+#endif
+}
+
+#define DEFINE_COUNT_HYBRID(name, op)                                          \
+  int *BitDB_##name##_count_hybrid(T_DB bit, T_DB bits,                        \
+                                   SETOP_COUNT_OPTS opts) {                    \
+    int *counts = (int *)calloc(BitDB_counts_size(bit, bits), sizeof(int));    \
+    assert(counts != NULL);                                                    \
+    hybrid_count(bit, bits, op, counts, opts);                                 \
+    return counts;                                                             \
+  }                                                                            \
+  void BitDB_##name##_count_store_hybrid(T_DB bit, T_DB bits, int *counts,     \
+                                         SETOP_COUNT_OPTS opts) {              \
+    hybrid_count(bit, bits, op, counts, opts);                                 \
+  }
+
+DEFINE_COUNT_HYBRID(inter, BIT_COUNT_INTER)
+DEFINE_COUNT_HYBRID(union, BIT_COUNT_UNION)
+DEFINE_COUNT_HYBRID(diff, BIT_COUNT_DIFF)
+DEFINE_COUNT_HYBRID(minus, BIT_COUNT_MINUS)
+
+/* --- 11u'. Automatic CPU / GPU target ---
+   The auto target routes each call to the engine a cost model says is
+   faster. Counting takes work / rate on either side, with work the word
+   pairs nq x nt x words and the rates measured by earlier auto calls of
+   the same class of query counts (1, 2-3, 4-7, ..., 128 and more: small
+   batches do not fill a GPU). The GPU side adds the copies: the operands
+   not already on the device and the count matrix back, at bandwidths
+   probed once per device. A class whose rate on either side is not yet
+   measured runs there, GPU first, so the first calls calibrate the model.
+*/
+
+/* Bytes copied each way by the bandwidth probe of a device */
+#ifndef BIT_AUTO_PROBE_BYTES
+#define BIT_AUTO_PROBE_BYTES (8u << 20)
+#endif
+
+/* Decisions and their estimates, under omp critical(bit_auto) */
+static uint64_t auto_calls[2];       // [0] CPU, [1] GPU
+static double auto_last_estimate[2]; // seconds of the last decision
+
+#ifndef NOGPU
+#define BIT_AUTO_SHAPES 8
+
+typedef struct {
+  double cpu_rate[BIT_AUTO_SHAPES]; // word pairs per second, 0: unmeasured
+  double gpu_rate[BIT_AUTO_SHAPES]; // of the kernels alone
+  double h2d_rate, d2h_rate;        // bytes per second, 0: not probed
+} auto_model;
+
+static auto_model auto_models[GPU_MAX_DEVICES]; // under critical(bit_auto)
+
+static int auto_shape(unsigned int nq) {
+  int shape = 0;
+  for (; nq > 1 && shape < BIT_AUTO_SHAPES - 1; nq >>= 1)
+    shape++;
+  return shape;
+}
+
+/* Host <-> device bandwidths of dev_id, from one copy each way after a
+   warm-up copy */
+static void auto_probe(int dev_id, double *h2d_rate, double *d2h_rate) {
+  const size_t bytes = BIT_AUTO_PROBE_BYTES;
+  const int host = omp_get_initial_device();
+  void *buffer = calloc(1, bytes);
+  void *device = omp_target_alloc(bytes, dev_id);
+  assert(buffer != NULL);
+  if (device == NULL) { // no room to probe: copies cost nothing to the model
+    free(buffer);
+    *h2d_rate = *d2h_rate = 1e12;
+    return;
+  }
+  omp_target_memcpy(device, buffer, bytes, 0, 0, dev_id, host);
+  const double t0 = omp_get_wtime();
+  omp_target_memcpy(device, buffer, bytes, 0, 0, dev_id, host);
+  const double t1 = omp_get_wtime();
+  omp_target_memcpy(buffer, device, bytes, 0, 0, host, dev_id);
+  const double t2 = omp_get_wtime();
+  omp_target_free(device, dev_id);
+  free(buffer);
+  *h2d_rate = bytes / (t1 - t0 > 0 ? t1 - t0 : 1e-9);
+  *d2h_rate = bytes / (t2 - t1 > 0 ? t2 - t1 : 1e-9);
+}
+
+/* Bytes of set still to be copied to dev_id for a count */
+static double auto_upload_bytes(T_DB set, int dev_id) {
+  if (GPU_USM || DB_ATTACHED(set, dev_id) ||
+      omp_target_is_present(set->qwords, dev_id))
+    return 0;
+  return (double)set->nelem * set->stride_in_qwords * sizeof(uint64_t);
+}
+
+/* The model of dev_id, its bandwidths probed on first use */
+static auto_model auto_model_get(int dev_id) {
+  auto_model model;
+#pragma omp critical(bit_auto)
+  model = auto_models[dev_id];
+  if (model.h2d_rate == 0) {
+    auto_probe(dev_id, &model.h2d_rate, &model.d2h_rate);
+#pragma omp critical(bit_auto)
+    {
+      auto_models[dev_id].h2d_rate = model.h2d_rate;
+      auto_models[dev_id].d2h_rate = model.d2h_rate;
+    }
+  }
+  return model;
+}
+#endif
+
+/* Whether the auto target sends bit against bits to the GPU, with the
+   modelled seconds of both engines in estimate (0 when not modelled) and
+   the seconds of the copies the GPU side pays in copies */
+static bool auto_decide(T_DB bit, T_DB bits, SETOP_COUNT_OPTS opts,
+                        double estimate[2], double *copies) {
+  estimate[0] = estimate[1] = *copies = 0;
+#ifndef NOGPU
+  const int dev_id = opts.device_id;
+  if (dev_id < 0 || dev_id >= omp_get_num_devices() ||
+      dev_id >= GPU_MAX_DEVICES || bit_stop_active(opts))
+    return false;
+  const auto_model model = auto_model_get(dev_id);
+  const int shape = auto_shape(bit->nelem);
+  const double work =
+      (double)bit->nelem * bits->nelem * bit->size_in_qwords;
+  *copies = (auto_upload_bytes(bit, dev_id) +
+             (bits == bit ? 0 : auto_upload_bytes(bits, dev_id))) /
+                model.h2d_rate +
+            (double)bit->nelem * bits->nelem * sizeof(int) / model.d2h_rate;
+  if (model.gpu_rate[shape] == 0)
+    return true;
+  if (model.cpu_rate[shape] == 0)
+    return false;
+  estimate[0] = work / model.cpu_rate[shape];
+  estimate[1] = *copies + work / model.gpu_rate[shape];
+  return estimate[1] < estimate[0];
+#else
+  (void)bit, (void)bits, (void)opts;
+  return false;
+#endif
+}
+
+static void auto_count(T_DB bit, T_DB bits, Bit_count_ops op, int *counts,
+                       SETOP_COUNT_OPTS opts) {
+  SETOP_DB_CHECKS(bit, bits)
+  assert(counts != NULL);
+  double estimate[2], copies;
+  const bool gpu = auto_decide(bit, bits, opts, estimate, &copies);
+  const double start = omp_get_wtime();
+  if (gpu)
+    BitDB_count_store_typed_gpu(bit, bits, op, counts, BIT_COUNTS_I32, opts);
+  else
+    BitDB_count_store_typed_cpu(bit, bits, op, counts, BIT_COUNTS_I32, opts);
+  double seconds = omp_get_wtime() - start;
+#pragma omp critical(bit_auto)
+  {
+    auto_calls[gpu]++;
+    auto_last_estimate[0] = estimate[0];
+    auto_last_estimate[1] = estimate[1];
+  }
+#ifndef NOGPU
+  const int dev_id = opts.device_id;
+  if (dev_id < 0 || dev_id >= GPU_MAX_DEVICES || bit_stop_active(opts))
+    return;
+  /* the kernels of a GPU call take what the copies leave, at least a tenth;
+     the rate is averaged with the previous one, as the hybrid share is */
+  if (gpu)
+    seconds = seconds - copies > 0.1 * seconds ? seconds - copies
+                                               : 0.1 * seconds;
+  const double rate = (double)bit->nelem * bits->nelem *
+                      bit->size_in_qwords / (seconds > 0 ? seconds : 1e-9);
+  const int shape = auto_shape(bit->nelem);
+#pragma omp critical(bit_auto)
+  {
+    double *old = gpu ? &auto_models[dev_id].gpu_rate[shape]
+                      : &auto_models[dev_id].cpu_rate[shape];
+    *old = *old > 0 ? 0.5 * (*old + rate) : rate;
+  }
+#endif
+}
+
+bool BitDB_auto_uses_gpu(T_DB bit, T_DB bits, SETOP_COUNT_OPTS opts) {
+  SETOP_DB_CHECKS(bit, bits)
+  double estimate[2], copies;
+  return auto_decide(bit, bits, opts, estimate, &copies);
+}
+
+/* --- 11u''. Cost estimates ---
+   BitDB_estimate prices a call from its shape with the rates of the auto
+   target: work over the calibrated CPU rate, bounded below by the rows
+   and counts over the streaming bandwidth, or work over the GPU rate the
+   auto calls measured plus the copies at the probed bandwidths.
+*/
+
+static Bit_estimate estimate_cpu(Bit_estimate_shape shape, double work,
+                                 double rows_q, double rows_t, double results,
+                                 SETOP_COUNT_OPTS opts) {
+  double rate, bandwidth;
+  bit_cpu_calibration(opts, &rate, &bandwidth);
+  // each tile of queries streams the targets once
+  const int tile = bit_tuning_resolve(opts).tile;
+  const double passes = (double)((shape.nqueries + tile - 1) / tile);
+  const double memory = rows_q + rows_t * passes + results;
+  const double compute = work / rate, stream = memory / bandwidth;
+  Bit_estimate estimate = {0};
+  estimate.seconds = compute > stream ? compute : stream;
+  estimate.memory_bytes = (uint64_t)memory;
+  estimate.peak_bytes = (size_t)results;
+  estimate.calibrated = true;
+  return estimate;
+}
+
+Bit_estimate BitDB_estimate(Bit_count_ops op, Bit_estimate_shape shape,
+                            SETOP_COUNT_OPTS opts,
+                            Bit_estimate_target target) {
+  assert(op > 0 && (op & ~BIT_COUNT_ALL) == 0);
+  assert(shape.nqueries > 0 && shape.ntargets > 0 && shape.length > 0);
+  assert(shape.k >= 0);
+  assert(target >= BIT_ESTIMATE_CPU && target <= BIT_ESTIMATE_AUTO);
+  const double words = (double)((shape.length + BPQW - 1) / BPQW);
+  const double rows_q = shape.nqueries * words * sizeof(uint64_t);
+  const double rows_t = shape.ntargets * words * sizeof(uint64_t);
+  const double results =
+      shape.k > 0 ? (double)shape.nqueries * shape.k * 2 * sizeof(int)
+                  : (double)shape.nqueries * shape.ntargets * sizeof(int);
+  const double work = (double)shape.nqueries * shape.ntargets * words *
+                      __builtin_popcount((unsigned int)op);
+  const Bit_estimate cpu =
+      estimate_cpu(shape, work, rows_q, rows_t, results, opts);
+  if (target == BIT_ESTIMATE_CPU)
+    return cpu;
+#ifndef NOGPU
+  const int dev_id = opts.device_id;
+  if (dev_id < 0 || dev_id >= omp_get_num_devices() ||
+      dev_id >= GPU_MAX_DEVICES)
+    return cpu;
+  const auto_model model = auto_model_get(dev_id);
+  // the rate of the class, or else of the nearest measured one
+  const int shape_class = auto_shape((unsigned int)shape.nqueries);
+  double rate = model.gpu_rate[shape_class];
+  for (int d = 1; rate == 0 && d < BIT_AUTO_SHAPES; d++) {
+    if (shape_class - d >= 0 && model.gpu_rate[shape_class - d] > 0)
+      rate = model.gpu_rate[shape_class - d];
+    else if (shape_class + d < BIT_AUTO_SHAPES)
+      rate = model.gpu_rate[shape_class + d];
+  }
+  Bit_estimate gpu = {0};
+  gpu.gpu = true;
+  gpu.calibrated = rate > 0;
+  if (rate == 0) // no GPU call measured yet: assume the CPU rate
+    rate = work / (cpu.seconds > 0 ? cpu.seconds : 1e-9);
+  const double upload =
+      GPU_USM ? 0
+              : (shape.queries_resident ? 0 : rows_q) +
+                    (shape.targets_resident ? 0 : rows_t);
+  const double download = GPU_USM ? 0 : results;
+  gpu.copy_seconds = upload / model.h2d_rate + download / model.d2h_rate;
+  gpu.copy_bytes = (uint64_t)(upload + download);
+  gpu.seconds = gpu.copy_seconds + work / rate;
+  gpu.memory_bytes = (uint64_t)(rows_q + rows_t + results);
+  // the host results, their device buffer and the operands mapped for
+  // the call
+  gpu.peak_bytes = (size_t)(2 * results + upload);
+  if (target == BIT_ESTIMATE_GPU || gpu.seconds < cpu.seconds)
+    return gpu;
+#endif
+  return cpu;
+}
+
+#define DEFINE_COUNT_AUTO(name, op)                                            \
+  int *BitDB_##name##_count_auto(T_DB bit, T_DB bits, SETOP_COUNT_OPTS opts) { \
+    int *counts = (int *)calloc(BitDB_counts_size(bit, bits), sizeof(int));    \
+    assert(counts != NULL);                                                    \
+    auto_count(bit, bits, op, counts, opts);                                   \
+    return counts;                                                             \
+  }                                                                            \
+  void BitDB_##name##_count_store_auto(T_DB bit, T_DB bits, int *counts,       \
+                                       SETOP_COUNT_OPTS opts) {                \
+    auto_count(bit, bits, op, counts, opts);                                   \
+  }
+
+DEFINE_COUNT_AUTO(inter, BIT_COUNT_INTER)
+DEFINE_COUNT_AUTO(union, BIT_COUNT_UNION)
+DEFINE_COUNT_AUTO(diff, BIT_COUNT_DIFF)
+DEFINE_COUNT_AUTO(minus, BIT_COUNT_MINUS)
+
+/* --- 11v. GPU telemetry --- */
+
+#ifndef NOGPU
+GPUTelemetry gpu_telemetry;
+_Static_assert(BIT_GPU_LAYOUTS == LAYOUT_BIT_SLICED + 1,
+               "Bit_gpu_stats must count every device layout");
+#else
+static _Atomic bool gpu_stats_timers; // kept for Bit_gpu_stats_timers only
+#endif
+
+Bit_gpu_stats Bit_gpu_stats_get(void) {
+  Bit_gpu_stats stats = {0};
+#ifndef NOGPU
+#define STAT_LOAD(counter)                                                     \
+  atomic_load_explicit(&gpu_telemetry.counter, memory_order_relaxed)
+  stats.layout_hits = STAT_LOAD(layout_hits);
+  stats.layout_misses = STAT_LOAD(layout_misses);
+  for (int from = 0; from < BIT_GPU_LAYOUTS; from++)
+    for (int to = 0; to < BIT_GPU_LAYOUTS; to++)
+      stats.transitions[from][to] = STAT_LOAD(transitions[from][to]);
+  stats.h2d_bytes = STAT_LOAD(h2d_bytes);
+  stats.d2h_bytes = STAT_LOAD(d2h_bytes);
+  stats.h2d_transfers = STAT_LOAD(h2d_transfers);
+  stats.d2h_transfers = STAT_LOAD(d2h_transfers);
+  stats.evictions = STAT_LOAD(evictions);
+  stats.evicted_bytes = STAT_LOAD(evicted_bytes);
+  stats.transition_seconds = STAT_LOAD(transition_ns) * 1e-9;
+  stats.transfer_seconds = STAT_LOAD(transfer_ns) * 1e-9;
+  stats.kernel_seconds = STAT_LOAD(kernel_ns) * 1e-9;
+#undef STAT_LOAD
+#endif
+#pragma omp critical(bit_auto)
+  {
+    stats.auto_cpu_calls = auto_calls[0];
+    stats.auto_gpu_calls = auto_calls[1];
+    stats.auto_cpu_estimate = auto_last_estimate[0];
+    stats.auto_gpu_estimate = auto_last_estimate[1];
+  }
+  return stats;
+}
+
+void Bit_gpu_stats_reset(void) {
+#ifndef NOGPU
+#define STAT_CLEAR(counter)                                                    \
+  atomic_store_explicit(&gpu_telemetry.counter, 0, memory_order_relaxed)
+  STAT_CLEAR(layout_hits);
+  STAT_CLEAR(layout_misses);
+  for (int from = 0; from < BIT_GPU_LAYOUTS; from++)
+    for (int to = 0; to < BIT_GPU_LAYOUTS; to++)
+      STAT_CLEAR(transitions[from][to]);
+  STAT_CLEAR(h2d_bytes);
+  STAT_CLEAR(d2h_bytes);
+  STAT_CLEAR(h2d_transfers);
+  STAT_CLEAR(d2h_transfers);
+  STAT_CLEAR(evictions);
+  STAT_CLEAR(evicted_bytes);
+  STAT_CLEAR(transition_ns);
+  STAT_CLEAR(transfer_ns);
+  STAT_CLEAR(kernel_ns);
+#undef STAT_CLEAR
+#endif
+#pragma omp critical(bit_auto)
+  {
+    auto_calls[0] = auto_calls[1] = 0;
+    auto_last_estimate[0] = auto_last_estimate[1] = 0;
+  }
+}
+
+bool Bit_gpu_stats_timers(bool enable) {
+#ifndef NOGPU
+  return atomic_exchange_explicit(&gpu_telemetry.timers, enable,
+                                  memory_order_relaxed);
+#else
+  return atomic_exchange_explicit(&gpu_stats_timers, enable,
+                                  memory_order_relaxed);
+#endif
+}
+
+/* --- 11w. Device memory budgets --- */
+
+#ifdef NOGPU
+static _Atomic size_t gpu_budgets[GPU_MAX_DEVICES]; // nothing is mapped
+#endif
+
+void Bit_gpu_budget_set(int device_id, size_t bytes) {
+  assert(device_id >= 0);
+#ifndef NOGPU
+  registry_set_budget(device_id, bytes);
+#else
+  if (device_id < GPU_MAX_DEVICES)
+    atomic_store_explicit(&gpu_budgets[device_id], bytes,
+                          memory_order_relaxed);
+#endif
+}
+
+size_t Bit_gpu_budget_get(int device_id) {
+#ifndef NOGPU
+  return registry_budget(device_id);
+#else
+  return device_id >= 0 && device_id < GPU_MAX_DEVICES
+             ? atomic_load_explicit(&gpu_budgets[device_id],
+                                    memory_order_relaxed)
+             : 0;
+#endif
+}
+
+size_t Bit_gpu_resident_bytes(int device_id) {
+#ifndef NOGPU
+  return registry_resident_bytes(device_id);
+#else
+  (void)device_id;
+  return 0;
+#endif
+}
+
+/* The device categories of Bit_memory_stats, from the layout registry */
+void bit_mem_devices(Bit_mem_stats *stats, bool reset_peaks) {
+#ifndef NOGPU
+  int ndevices = omp_get_num_devices();
+  if (ndevices > BIT_MEM_MAX_DEVICES)
+    ndevices = BIT_MEM_MAX_DEVICES;
+  for (int d = 0; d < ndevices; d++) {
+    if (reset_peaks) {
+      registry_reset_peaks(d);
+      continue;
+    }
+    size_t mapped, mapped_peak, scratch, scratch_peak, peak;
+    registry_memory(d, &mapped, &mapped_peak, &scratch, &scratch_peak, &peak);
+    stats->bytes[BIT_MEM_DEVICE] += mapped;
+    stats->peak[BIT_MEM_DEVICE] += mapped_peak;
+    stats->bytes[BIT_MEM_TRANSPOSED] += scratch;
+    stats->peak[BIT_MEM_TRANSPOSED] += scratch_peak;
+    stats->device_bytes[d] = mapped + scratch;
+    stats->device_peak[d] = peak;
+  }
+  if (!reset_peaks)
+    stats->ndevices = ndevices;
+#else
+  (void)stats, (void)reset_peaks;
+#endif
+}
+
+/* --- 11x. Device word width --- */
+
+void Bit_gpu_word_bits_set(int device_id, int bits) {
+  assert(device_id >= 0);
+  assert(bits == 0 || bits == 32 || bits == 64);
+  if (device_id < GPU_MAX_DEVICES)
+    atomic_store_explicit(&gpu_word_bits[device_id], bits,
+                          memory_order_relaxed);
+}
+
+int Bit_gpu_word_bits(int device_id) {
+  return gpu_device_word_bits(device_id);
+}
+
+/* --- 11y. Native CUDA/HIP backends --- */
+
+/* Backend found by the first NATIVE_COARSENED count (NULL: none), and the
+   devices it drives */
+static const bit_native_backend *native_backend;
+static int native_devices;
+static _Atomic bool native_probed;
+
+/* Load the backend named by BIT_NATIVE_BACKEND (a library name or path, or
+   "none"), else the first of libbit_cuda.so and libbit_hip.so on the search
+   path that drives at least one device */
+static const bit_native_backend *native_backend_load(void) {
+  if (atomic_load_explicit(&native_probed, memory_order_acquire))
+    return native_backend;
+#pragma omp critical(bit_native_backend)
+  if (!atomic_load_explicit(&native_probed, memory_order_relaxed)) {
+    static const char *const libraries[] = {"libbit_cuda.so",
+                                            "libbit_hip.so"};
+    const char *forced = getenv("BIT_NATIVE_BACKEND");
+    const int nlibraries = forced ? 1 : 2;
+    for (int i = 0; i < nlibraries && !native_backend; i++) {
+      const char *name = forced ? forced : libraries[i];
+      if (strcmp(name, "none") == 0)
+        break;
+      void *library = dlopen(name, RTLD_NOW | RTLD_LOCAL);
+      if (!library)
+        continue;
+      bit_native_entry entry;
+      *(void **)&entry = dlsym(library, BIT_NATIVE_ENTRY);
+      const bit_native_backend *backend = entry ? entry() : NULL;
+      const int devices = backend && backend->abi == BIT_NATIVE_ABI
+                              ? backend->device_count()
+                              : 0;
+      if (devices > 0) {
+        native_backend = backend;
+        native_devices = devices;
+      } else {
+        dlclose(library);
+      }
+    }
+    atomic_store_explicit(&native_probed, true, memory_order_release);
+  }
+  return native_backend;
+}
+
+/* Rows and stamp of the queries and the targets the backend of each device
+   kept from the last native count, NULL rows for none. The backend reuses
+   its copy (for targets, transposed) of the same rows without an upload
+   flag, so a container restamped by a write since gets the flag whatever
+   upd_*_operand says, and a reference container that is not written pays
+   for its upload and transpose once */
+typedef struct {
+  const uint64_t *rows;
+  uint64_t stamp;
+} native_copy;
+static native_copy native_copies[GPU_MAX_DEVICES][2];
+
+/* Flags of a native count of bit against bits for opts */
+static unsigned int native_flags(T_DB bit, T_DB bits, SETOP_COUNT_OPTS opts) {
+  bool stale[2] = {true, true};
+  if (opts.device_id < GPU_MAX_DEVICES) {
+#pragma omp critical(bit_native_copies)
+    for (int i = 0; i < 2; i++) {
+      const native_copy *copy = &native_copies[opts.device_id][i];
+      const T_DB set = i ? bits : bit;
+      stale[i] = copy->rows != set->qwords || copy->stamp != set->stamp;
+    }
+  }
+  return (opts.upd_1st_operand || stale[0] ? BIT_NATIVE_UPLOAD_QUERIES : 0) |
+         (opts.upd_2nd_operand || stale[1] ? BIT_NATIVE_UPLOAD_TARGETS : 0) |
+         (opts.release_1st_operand ? BIT_NATIVE_RELEASE_QUERIES : 0) |
+         (opts.release_2nd_operand ? BIT_NATIVE_RELEASE_TARGETS : 0);
+}
+
+/* Record what the backend kept after a native count, which ok tells if it
+   succeeded (a failed count frees both copies) */
+static void native_kept(T_DB bit, T_DB bits, SETOP_COUNT_OPTS opts, bool ok) {
+  if (opts.device_id >= GPU_MAX_DEVICES)
+    return;
+#pragma omp critical(bit_native_copies)
+  for (int i = 0; i < 2; i++) {
+    native_copy *copy = &native_copies[opts.device_id][i];
+    const T_DB set = i ? bits : bit;
+    const bool released =
+        !ok || (i ? opts.release_2nd_operand : opts.release_1st_operand);
+    *copy = released ? (native_copy){NULL, 0}
+                     : (native_copy){set->qwords, set->stamp};
+  }
+}
+
+/* Count through the native backend. Its kernels count every op, but a
+   backend may refuse one (BIT_NATIVE_UNSUPPORTED); the op then follows from
+   the AND counts and the populations of the rows, as
+   |a | b| = |a| + |b| - |a & b|, |a ^ b| = |a| + |b| - 2 |a & b| and
+   |a & ~b| = |a| - |a & b|. Returns false when no backend drives
+   opts.device_id, or the backend failed, and counts is to be computed by
+   the caller */
+static bool native_count_store(T_DB bit, T_DB bits, int *counts,
+                               bit_setop_id op, SETOP_COUNT_OPTS opts) {
+  SETOP_DB_CHECKS(bit, bits)
+  const bit_native_backend *backend = native_backend_load();
+  if (!backend || opts.device_id < 0 || opts.device_id >= native_devices)
+    return false;
+  const size_t num_queries = (size_t)bit->nelem;
+  const size_t num_targets = (size_t)bits->nelem;
+  const size_t words = bit->stride_in_qwords < bits->stride_in_qwords
+                           ? bit->stride_in_qwords
+                           : bits->stride_in_qwords;
+  const unsigned int flags = native_flags(bit, bits, opts);
+#define NATIVE_COUNT(native_op)                                                \
+  backend->count(native_op, bit->qwords, num_queries, bit->stride_in_qwords,   \
+                 bits->qwords, num_targets, bits->stride_in_qwords, words,     \
+                 counts, opts.device_id, flags)
+  int status = NATIVE_COUNT(op == BIT_OP_AND   ? BIT_NATIVE_OP_AND
+                            : op == BIT_OP_OR  ? BIT_NATIVE_OP_OR
+                            : op == BIT_OP_XOR ? BIT_NATIVE_OP_XOR
+                                               : BIT_NATIVE_OP_AND_NOT);
+  const bool derive = status == BIT_NATIVE_UNSUPPORTED && op != BIT_OP_AND;
+  if (derive)
+    status = NATIVE_COUNT(BIT_NATIVE_OP_AND);
+#undef NATIVE_COUNT
+  native_kept(bit, bits, opts, status == 0);
+  if (status != 0)
+    return false;
+  if (!derive)
+    return true;
+
+  int *population = (int *)malloc((num_queries + num_targets) * sizeof(int));
+  assert(population != NULL);
+  const bit_kernel_table *kernels = bit_kernels_active();
+  for (size_t k = 0; k < num_queries; k++)
+    population[k] =
+        kernels->count_qwords(bit->qwords + k * bit->stride_in_qwords, words);
+  for (size_t i = 0; i < num_targets; i++)
+    population[num_queries + i] =
+        kernels->count_qwords(bits->qwords + i * bits->stride_in_qwords, words);
+  const int numthreads =
+      opts.num_cpu_threads > 0 ? opts.num_cpu_threads : omp_get_max_threads();
+#pragma omp parallel for num_threads(numthreads) schedule(static)
+  for (size_t k = 0; k < num_queries; k++) {
+    const int pop_query = population[k];
+    int *row = counts + k * num_targets;
+    for (size_t i = 0; i < num_targets; i++) {
+      const int pop_target = population[num_queries + i];
+      row[i] = op == BIT_OP_OR    ? pop_query + pop_target - row[i]
+               : op == BIT_OP_XOR ? pop_query + pop_target - 2 * row[i]
+                                  : pop_query - row[i];
+    }
+  }
+  free(population);
+  return true;
+}
+
+/* Fused counts of the Bit_count_ops of ops, counts[] in Bit_count_ops
+   order, through the native backend: one kernel over the pairs for all of
+   them. Returns false as native_count_store */
+static bool native_multi_count_store(T_DB bit, T_DB bits, unsigned int ops,
+                                     int *const *counts,
+                                     SETOP_COUNT_OPTS opts) {
+  const bit_native_backend *backend = native_backend_load();
+  if (!backend || opts.device_id < 0 || opts.device_id >= native_devices)
+    return false;
+  int *out[BIT_NATIVE_OPS] = {NULL};
+  unsigned int native_ops = 0;
+  static const unsigned int native_op[] = {
+      BIT_NATIVE_OP_AND, BIT_NATIVE_OP_OR, BIT_NATIVE_OP_XOR,
+      BIT_NATIVE_OP_AND_NOT};
+  for (int op = 0; op < 4; op++)
+    if (ops & 1u << op) {
+      native_ops |= 1u << native_op[op];
+      out[native_op[op]] = counts[op];
+    }
+  const size_t words = bit->stride_in_qwords < bits->stride_in_qwords
+                           ? bit->stride_in_qwords
+                           : bits->stride_in_qwords;
+  const bool ok =
+      backend->count_ops(native_ops, bit->qwords, (size_t)bit->nelem,
+                         bit->stride_in_qwords, bits->qwords,
+                         (size_t)bits->nelem, bits->stride_in_qwords, words,
+                         out, opts.device_id,
+                         native_flags(bit, bits, opts)) == 0;
+  native_kept(bit, bits, opts, ok);
+  return ok;
+}
+
+/* Pairs with at least threshold intersections through the native backend,
+   as the queries, targets and counts of the *total matches, in any order.
+   Returns false as native_count_store */
+static bool native_threshold(T_DB bit, T_DB bits, int threshold,
+                             SETOP_COUNT_OPTS opts, size_t *total,
+                             int **host_q, int **host_i, int **host_c) {
+  const bit_native_backend *backend = native_backend_load();
+  if (!backend || opts.device_id < 0 || opts.device_id >= native_devices)
+    return false;
+  const size_t words = bit->stride_in_qwords < bits->stride_in_qwords
+                           ? bit->stride_in_qwords
+                           : bits->stride_in_qwords;
+  bit_native_match *matches = NULL;
+  size_t found = 0;
+  const bool ok =
+      backend->count_threshold(
+          BIT_NATIVE_OP_AND, bit->qwords, (size_t)bit->nelem,
+          bit->stride_in_qwords, bits->qwords, (size_t)bits->nelem,
+          bits->stride_in_qwords, words, threshold, &matches, &found,
+          opts.device_id, native_flags(bit, bits, opts)) == 0;
+  native_kept(bit, bits, opts, ok);
+  if (!ok)
+    return false;
+  *host_q = malloc((found ? found : 1) * sizeof(int));
+  *host_i = malloc((found ? found : 1) * sizeof(int));
+  *host_c = malloc((found ? found : 1) * sizeof(int));
+  assert(*host_q && *host_i && *host_c);
+  for (size_t m = 0; m < found; m++) {
+    (*host_q)[m] = matches[m].query;
+    (*host_i)[m] = matches[m].target;
+    (*host_c)[m] = matches[m].count;
+  }
+  free(matches);
+  *total = found;
+  return true;
+}
+
+const char *Bit_gpu_native_backend(void) {
+  const bit_native_backend *backend = native_backend_load();
+  return backend ? backend->name : NULL;
+}
+
+void bit_gpu_configuration(Bit_config *config) {
+#ifndef NOGPU
+  config->gpu = true;
+  config->gpu_algorithms = 1u << TRANSPOSED_TEAM_PARALLEL_SIMD |
+                           1u << SHARED_TILE_ILP | 1u << ZCURVE_TILED |
+                           1u << BIT_SLICED | 1u << K_SPLIT;
+#endif
+  config->gpu_devices = omp_get_num_devices();
+  config->gpu_default_device = omp_get_default_device();
+  config->gpu_archs = GPU_ARCHS_XSTR(BIT_GPU_ARCHS);
+  config->gpu_tile_j = GPU_TILE_J;
+  config->gpu_ilp = GPU_ILP;
+  config->gpu_word_bits = gpu_device_word_bits(config->gpu_default_device);
+  const bit_native_backend *backend = native_backend_load();
+  if (backend) {
+    config->native_backend = backend->name;
+    config->native_devices = native_devices;
+    config->gpu_algorithms |= 1u << NATIVE_COARSENED;
+  }
+}
+
+/* --- 11y'. Device-resident long bitsets --- */
+
+#ifndef NOGPU
+/* d = a op b over the nq words of device copies */
+#define L_SETOP_GPU(op)                                                        \
+  _Pragma(STRINGIFY(omp target teams distribute parallel for device(dev_id)))  \
+  for (uint64_t w = 0; w < nq; w++)                                            \
+    d[w] = a[w] op b[w];
+
+/* The uint64_t count of the bits of a op b over the nq words */
+#define L_COUNT_GPU(op)                                                        \
+  _Pragma(STRINGIFY(omp target teams distribute parallel for device(dev_id)    \
+                        map(tofrom : count) reduction(+ : count)))             \
+  for (uint64_t w = 0; w < nq; w++)                                            \
+    count += POPCOUNT_GPU(a[w] op b[w]);
+
+/* The uint64_t any, non-zero iff a op b has a bit set */
+#define L_ANY_GPU(op)                                                          \
+  _Pragma(STRINGIFY(omp target teams distribute parallel for device(dev_id)    \
+                        map(tofrom : any) reduction(| : any)))                 \
+  for (uint64_t w = 0; w < nq; w++)                                            \
+    any |= a[w] op b[w];
+#endif
+
+/* What a range operation does to the bits of its range */
+typedef enum { L_RANGE_SET, L_RANGE_CLEAR, L_RANGE_NOT } l_range_op;
+
+/* Device both operands are attached to */
+static int large_device_pair(T_L s, T_L t) {
+  assert(s && t);
+  assert(s->device_id >= 0 && s->device_id == t->device_id);
+  assert(s->length == t->length);
+  return s->device_id;
+}
+
+static void large_setop_gpu(T_L dst, T_L s, T_L t, bit_setop_id op) {
+  const int dev_id = large_device_pair(s, t);
+  assert(dst);
+  assert(dst->device_id == dev_id && dst->length == s->length);
+#ifndef NOGPU
+  uint64_t *d = dst->qwords;
+  const uint64_t *a = s->qwords, *b = t->qwords;
+  const uint64_t nq = s->size_in_qwords;
+  switch (op) {
+  case BIT_OP_AND:
+    L_SETOP_GPU(&)
+    break;
+  case BIT_OP_OR:
+    L_SETOP_GPU(|)
+    break;
+  case BIT_OP_XOR:
+    L_SETOP_GPU(^)
+    break;
+  default: // BIT_OP_AND_NOT
+    L_SETOP_GPU(&~)
+    break;
+  }
+#else
+  (void)dev_id;
+  bit_large_setop_into(dst, s, t, op);
+#endif
+}
+
+static int64_t large_setop_count_gpu(T_L s, T_L t, bit_setop_id op) {
+  const int dev_id = large_device_pair(s, t);
+#ifndef NOGPU
+  const uint64_t *a = s->qwords, *b = t->qwords;
+  const uint64_t nq = s->size_in_qwords;
+  uint64_t count = 0;
+  switch (op) {
+  case BIT_OP_AND:
+    L_COUNT_GPU(&)
+    break;
+  case BIT_OP_OR:
+    L_COUNT_GPU(|)
+    break;
+  case BIT_OP_XOR:
+    L_COUNT_GPU(^)
+    break;
+  default: // BIT_OP_AND_NOT
+    L_COUNT_GPU(&~)
+    break;
+  }
+  return (int64_t)count;
+#else
+  (void)dev_id;
+  switch (op) {
+  case BIT_OP_AND:
+    return Bit_L_inter_count(s, t);
+  case BIT_OP_OR:
+    return Bit_L_union_count(s, t);
+  case BIT_OP_XOR:
+    return Bit_L_diff_count(s, t);
+  default: // BIT_OP_AND_NOT
+    return Bit_L_minus_count(s, t);
+  }
+#endif
+}
+
+static void large_range_gpu(T_L set, int64_t lo, int64_t hi, l_range_op op) {
+  assert(set);
+  assert(set->device_id >= 0);
+  assert(0 <= lo && lo <= hi && hi < set->length);
+#ifndef NOGPU
+  const int dev_id = set->device_id;
+  uint64_t *d = set->qwords;
+  const uint64_t w0 = (uint64_t)lo / BPQW, w1 = (uint64_t)hi / BPQW;
+  const uint64_t first = ~UINT64_C(0) << (lo % BPQW);
+  const uint64_t last = ~UINT64_C(0) >> (BPQW - 1 - hi % BPQW);
+  _Pragma(STRINGIFY(omp target teams distribute parallel for device(dev_id)))
+  for (uint64_t w = w0; w <= w1; w++) {
+    const uint64_t mask =
+        (w == w0 ? first : ~UINT64_C(0)) & (w == w1 ? last : ~UINT64_C(0));
+    d[w] = op == L_RANGE_SET     ? d[w] | mask
+           : op == L_RANGE_CLEAR ? d[w] & ~mask
+                                 : d[w] ^ mask;
+  }
+#else
+  if (op == L_RANGE_SET)
+    Bit_L_set(set, lo, hi);
+  else if (op == L_RANGE_CLEAR)
+    Bit_L_clear(set, lo, hi);
+  else
+    Bit_L_not(set, lo, hi);
+#endif
+}
+
+/* Whether s op t is empty: the words are or-ed, never counted */
+static int large_empty_gpu(T_L s, T_L t, bit_setop_id op) {
+  const int dev_id = large_device_pair(s, t);
+#ifndef NOGPU
+  const uint64_t *a = s->qwords, *b = t->qwords;
+  const uint64_t nq = s->size_in_qwords;
+  uint64_t any = 0;
+  if (op == BIT_OP_XOR) {
+    L_ANY_GPU(^)
+  } else { // BIT_OP_AND_NOT
+    L_ANY_GPU(&~)
+  }
+  return any == 0;
+#else
+  (void)dev_id;
+  return op == BIT_OP_XOR ? Bit_L_eq(s, t) : Bit_L_leq(s, t);
+#endif
+}
+
+void Bit_L_device_attach(T_L set, int device_id) {
+  assert(set);
+  assert(set->device_id < 0);
+  assert(device_id >= 0);
+  set->device_id = device_id;
+#ifndef NOGPU
+  /* the copy counts against the budget of the device, and stays pinned:
+     between a write on the device and the next pull it is the only copy
+     of the bits, which an eviction would lose */
+  uint64_t *qwords = set->qwords;
+  TARGET_GPU_ARRAY(enter, to, qwords, 0, set->size_in_qwords, device_id)
+  GPU_LAYOUT_UPLOADED(qwords, device_id);
+  registry_pin(qwords, device_id);
+#endif
+}
+
+void Bit_L_device_push(T_L set) {
+  assert(set);
+  assert(set->device_id >= 0);
+#ifndef NOGPU
+  uint64_t *qwords = set->qwords;
+  UPDATE_GPU_ARRAY(to, qwords, 0, set->size_in_qwords, set->device_id)
+#endif
+}
+
+void Bit_L_device_pull(T_L set) {
+  assert(set);
+  assert(set->device_id >= 0);
+#ifndef NOGPU
+  uint64_t *qwords = set->qwords;
+  UPDATE_GPU_ARRAY(from, qwords, 0, set->size_in_qwords, set->device_id)
+#endif
+}
+
+void Bit_L_device_detach(T_L set) {
+  assert(set);
+  assert(set->device_id >= 0);
+#ifndef NOGPU
+  uint64_t *qwords = set->qwords;
+  const int dev_id = set->device_id;
+  registry_unpin(qwords, dev_id);
+  if (omp_target_is_present(qwords, dev_id)) {
+    TARGET_GPU_ARRAY(exit, delete, qwords, 0, set->size_in_qwords, dev_id)
+    registry_forget(qwords, dev_id);
+  }
+#endif
+  set->device_id = -1;
+}
+
+int Bit_L_device(T_L set) {
+  assert(set);
+  return set->device_id;
+}
+
+void Bit_L_diff_into_gpu(T_L dst, T_L s, T_L t) {
+  large_setop_gpu(dst, s, t, BIT_OP_XOR);
+}
+
+void Bit_L_inter_into_gpu(T_L dst, T_L s, T_L t) {
+  large_setop_gpu(dst, s, t, BIT_OP_AND);
+}
+
+void Bit_L_minus_into_gpu(T_L dst, T_L s, T_L t) {
+  large_setop_gpu(dst, s, t, BIT_OP_AND_NOT);
+}
+
+void Bit_L_union_into_gpu(T_L dst, T_L s, T_L t) {
+  large_setop_gpu(dst, s, t, BIT_OP_OR);
+}
+
+int64_t Bit_L_count_gpu(T_L set) {
+  return large_setop_count_gpu(set, set, BIT_OP_AND);
+}
+
+int64_t Bit_L_diff_count_gpu(T_L s, T_L t) {
+  return large_setop_count_gpu(s, t, BIT_OP_XOR);
+}
+
+int64_t Bit_L_inter_count_gpu(T_L s, T_L t) {
+  return large_setop_count_gpu(s, t, BIT_OP_AND);
+}
+
+int64_t Bit_L_minus_count_gpu(T_L s, T_L t) {
+  return large_setop_count_gpu(s, t, BIT_OP_AND_NOT);
+}
+
+int64_t Bit_L_union_count_gpu(T_L s, T_L t) {
+  return large_setop_count_gpu(s, t, BIT_OP_OR);
+}
+
+void Bit_L_set_gpu(T_L set, int64_t lo, int64_t hi) {
+  large_range_gpu(set, lo, hi, L_RANGE_SET);
+}
+
+void Bit_L_clear_gpu(T_L set, int64_t lo, int64_t hi) {
+  large_range_gpu(set, lo, hi, L_RANGE_CLEAR);
+}
+
+void Bit_L_not_gpu(T_L set, int64_t lo, int64_t hi) {
+  large_range_gpu(set, lo, hi, L_RANGE_NOT);
+}
+
+int Bit_L_eq_gpu(T_L s, T_L t) { return large_empty_gpu(s, t, BIT_OP_XOR); }
+
+int Bit_L_leq_gpu(T_L s, T_L t) {
+  return large_empty_gpu(s, t, BIT_OP_AND_NOT);
+}
+
+/* --- 11z'. Offload trace (OMPT) --- */
+
+#if defined(BIT_TRACE) && (BIT_TRACE)
+#if !__has_include(<omp-tools.h>)
+#error "TRACE=1 needs an OpenMP runtime with OMPT (omp-tools.h), e.g. libomp"
+#endif
+#include <omp-tools.h>
+#include <stdio.h>
+#include <time.h>
+
+#define TRACE_DEFAULT_EVENTS (1 << 20)
+
+/* One span ("X") or, where the runtime reports a single endpoint, instant
+   ("i") of the trace */
+typedef struct {
+  const char *name;
+  const char *cat;
+  uint64_t ts, dur; // ns
+  uint64_t bytes;
+  int device;
+  int tid;
+  bool instant;
+} trace_event;
+
+static struct {
+  _Atomic bool recording;
+  _Atomic bool written;
+  const char *path;
+  trace_event *events;
+  size_t capacity;
+  _Atomic size_t next;
+  _Atomic int next_tid;
+  uint64_t origin;
+  ompt_set_callback_t set_callback;
+} trace;
+
+static _Thread_local int trace_tid;
+static _Thread_local uint64_t trace_target_start; // non-EMI target regions
+
+static uint64_t trace_clock(void) {
+  struct timespec now;
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  return (uint64_t)now.tv_sec * UINT64_C(1000000000) + (uint64_t)now.tv_nsec;
+}
+
+static void trace_add(const char *name, const char *cat, uint64_t start,
+                      uint64_t end, uint64_t bytes, int device, bool instant) {
+  const size_t slot = atomic_fetch_add_explicit(&trace.next, 1,
+                                                memory_order_relaxed);
+  if (slot >= trace.capacity)
+    return; // counted as dropped when written
+  if (!trace_tid)
+    trace_tid = atomic_fetch_add(&trace.next_tid, 1) + 1;
+  trace.events[slot] = (trace_event){name,  cat,    start,     end - start,
+                                     bytes, device, trace_tid, instant};
+}
+
+static const char *trace_target_name(ompt_target_t kind) {
+  switch (kind & ~(ompt_target_t)8) { // the nowait variants
+  case ompt_target_enter_data:
+    return "target enter data";
+  case ompt_target_exit_data:
+    return "target exit data";
+  case ompt_target_update:
+    return "target update";
+  default:
+    return "target";
+  }
+}
+
+static const char *trace_data_op_name(ompt_target_data_op_t op) {
+  switch (op & ~(ompt_target_data_op_t)16) { // the async variants
+  case ompt_target_data_alloc:
+    return "alloc";
+  case ompt_target_data_transfer_to_device:
+    return "transfer to device";
+  case ompt_target_data_transfer_from_device:
+    return "transfer from device";
+  case ompt_target_data_delete:
+    return "delete";
+  case ompt_target_data_associate:
+    return "associate";
+  default:
+    return "disassociate";
+  }
+}
+
+/* The device of a data operation: the end that is not the host */
+static int trace_op_device(int src_device, int dest_device) {
+  return dest_device != omp_get_initial_device() ? dest_device : src_device;
+}
+
+/* OpenMP 5.1 callbacks, which report both endpoints: the tool keeps the
+   start in the data the runtime hands back at the end */
+static void trace_target_emi(ompt_target_t kind, ompt_scope_endpoint_t endpoint,
+                             int device_num, ompt_data_t *task_data,
+                             ompt_data_t *target_task_data,
+                             ompt_data_t *target_data, const void *codeptr_ra) {
+  (void)task_data, (void)target_task_data, (void)codeptr_ra;
+  if (endpoint == ompt_scope_begin)
+    target_data->value = trace_clock();
+  else
+    trace_add(trace_target_name(kind), "target", target_data->value,
+              trace_clock(), 0, device_num, false);
+}
+
+static void trace_data_op_emi(ompt_scope_endpoint_t endpoint,
+                              ompt_data_t *target_task_data,
+                              ompt_data_t *target_data, ompt_id_t *host_op_id,
+                              ompt_target_data_op_t optype, void *src_addr,
+                              int src_device_num, void *dest_addr,
+                              int dest_device_num, size_t bytes,
+                              const void *codeptr_ra) {
+  (void)target_task_data, (void)target_data, (void)src_addr, (void)dest_addr;
+  (void)codeptr_ra;
+  if (endpoint == ompt_scope_begin)
+    *host_op_id = trace_clock();
+  else
+    trace_add(trace_data_op_name(optype), "data", *host_op_id, trace_clock(),
+              bytes, trace_op_device(src_device_num, dest_device_num), false);
+}
+
+static void trace_submit_emi(ompt_scope_endpoint_t endpoint,
+                             ompt_data_t *target_data, ompt_id_t *host_op_id,
+                             unsigned int requested_num_teams) {
+  (void)target_data, (void)requested_num_teams;
+  if (endpoint == ompt_scope_begin)
+    *host_op_id = trace_clock();
+  else
+    trace_add("kernel", "kernel", *host_op_id, trace_clock(), 0, -1, false);
+}
+
+/* OpenMP 5.0 callbacks, for runtimes without the EMI ones: target regions
+   do not nest on a thread, and data operations and submissions are
+   instants */
+static void trace_target(ompt_target_t kind, ompt_scope_endpoint_t endpoint,
+                         int device_num, ompt_data_t *task_data,
+                         ompt_id_t target_id, const void *codeptr_ra) {
+  (void)task_data, (void)target_id, (void)codeptr_ra;
+  if (endpoint == ompt_scope_begin)
+    trace_target_start = trace_clock();
+  else
+    trace_add(trace_target_name(kind), "target", trace_target_start,
+              trace_clock(), 0, device_num, false);
+}
+
+static void trace_data_op(ompt_id_t target_id, ompt_id_t host_op_id,
+                          ompt_target_data_op_t optype, void *src_addr,
+                          int src_device_num, void *dest_addr,
+                          int dest_device_num, size_t bytes,
+                          const void *codeptr_ra) {
+  (void)target_id, (void)host_op_id, (void)src_addr, (void)dest_addr;
+  (void)codeptr_ra;
+  const uint64_t now = trace_clock();
+  trace_add(trace_data_op_name(optype), "data", now, now, bytes,
+            trace_op_device(src_device_num, dest_device_num), true);
+}
+
+static void trace_submit(ompt_id_t target_id, ompt_id_t host_op_id,
+                         unsigned int requested_num_teams) {
+  (void)target_id, (void)host_op_id, (void)requested_num_teams;
+  const uint64_t now = trace_clock();
+  trace_add("kernel", "kernel", now, now, 0, -1, true);
+}
+
+/* The EMI callback if the runtime dispatches it, else the 5.0 one */
+static void trace_register(ompt_callbacks_t emi, ompt_callback_t emi_fn,
+                           ompt_callbacks_t plain, ompt_callback_t plain_fn) {
+  const ompt_set_result_t result = trace.set_callback(emi, emi_fn);
+  if (result == ompt_set_error || result == ompt_set_never)
+    trace.set_callback(plain, plain_fn);
+}
+
+/* Chrome trace event format, which Perfetto and chrome://tracing read */
+static void trace_write(void) {
+  if (atomic_exchange(&trace.written, true))
+    return;
+  atomic_store(&trace.recording, false);
+  FILE *out = fopen(trace.path, "w");
+  if (!out) {
+    fprintf(stderr, "Warning: cannot write the offload trace %s\n",
+            trace.path);
+    return;
+  }
+  const size_t recorded = atomic_load(&trace.next);
+  const size_t n = recorded < trace.capacity ? recorded : trace.capacity;
+  fputs("{\"displayTimeUnit\": \"ns\", \"traceEvents\": [\n", out);
+  for (size_t i = 0; i < n; i++) {
+    const trace_event *e = &trace.events[i];
+    fprintf(out,
+            "%s{\"name\": \"%s\", \"cat\": \"%s\", \"ph\": \"%s\", "
+            "\"ts\": %.3f, ",
+            i ? ",\n" : "", e->name, e->cat, e->instant ? "i\", \"s\": \"t" : "X",
+            (double)(e->ts - trace.origin) / 1e3);
+    if (!e->instant)
+      fprintf(out, "\"dur\": %.3f, ", (double)e->dur / 1e3);
+    fprintf(out, "\"pid\": 1, \"tid\": %d, \"args\": {\"device\": %d",
+            e->tid, e->device);
+    if (e->bytes)
+      fprintf(out, ", \"bytes\": %llu", (unsigned long long)e->bytes);
+    fputs("}}", out);
+  }
+  fprintf(out, "\n], \"otherData\": {\"dropped_events\": %zu}}\n",
+          recorded - n);
+  fclose(out);
+}
+
+static int trace_initialize(ompt_function_lookup_t lookup,
+                            int initial_device_num, ompt_data_t *tool_data) {
+  (void)initial_device_num, (void)tool_data;
+  trace.set_callback = (ompt_set_callback_t)lookup("ompt_set_callback");
+  const char *events = getenv("BIT_TRACE_EVENTS");
+  trace.capacity = events && atol(events) > 0 ? (size_t)atol(events)
+                                              : TRACE_DEFAULT_EVENTS;
+  trace.events = malloc(trace.capacity * sizeof(trace_event));
+  if (!trace.set_callback || !trace.events) {
+    free(trace.events);
+    return 0; // the runtime then drops the tool
+  }
+  trace_register(ompt_callback_target_emi, (ompt_callback_t)trace_target_emi,
+                 ompt_callback_target, (ompt_callback_t)trace_target);
+  trace_register(ompt_callback_target_data_op_emi,
+                 (ompt_callback_t)trace_data_op_emi,
+                 ompt_callback_target_data_op, (ompt_callback_t)trace_data_op);
+  trace_register(ompt_callback_target_submit_emi,
+                 (ompt_callback_t)trace_submit_emi,
+                 ompt_callback_target_submit, (ompt_callback_t)trace_submit);
+  trace.origin = trace_clock();
+  atomic_store(&trace.recording, true);
+  atexit(trace_write); // in case the runtime never finalizes the tool
+  return 1;
+}
+
+static void trace_finalize(ompt_data_t *tool_data) {
+  (void)tool_data;
+  trace_write();
+}
+
+/* Found by the OpenMP runtime in the process; the tool only starts when
+   BIT_TRACE_FILE names the output */
+ompt_start_tool_result_t *ompt_start_tool(unsigned int omp_version,
+                                          const char *runtime_version) {
+  (void)omp_version, (void)runtime_version;
+  static ompt_start_tool_result_t tool = {trace_initialize, trace_finalize,
+                                          {0}};
+  trace.path = getenv("BIT_TRACE_FILE");
+  return trace.path && *trace.path ? &tool : NULL;
+}
+
+bit_trace_scope bit_trace_enter(const char *name) {
+  return (bit_trace_scope){
+      name, atomic_load_explicit(&trace.recording, memory_order_relaxed)
+                ? trace_clock()
+                : 0};
+}
+
+void bit_trace_leave(bit_trace_scope *scope) {
+  if (scope->start)
+    trace_add(scope->name, "call", scope->start, trace_clock(), 0, -1, false);
+}
+#endif
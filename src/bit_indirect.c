@@ -0,0 +1,239 @@
+/*
+    Indirect containers of Bit_T rows (Bit_IDB_T, see include/bit.h).
+
+    A Bit_IDB_T is an array of pointers to the qwords of bitsets the caller
+    owns, so that an array of Bit_T can be counted by the tiled engine
+    without being copied into a Bit_DB_T. The tiles are those of the
+    current tuning: a tile of queries and one of targets are slices of the
+    two pointer arrays, counted k_block words at a time by the default
+    register block of bit_kernels_active(), which reads its row pointers
+    from the arrays. No hardware prefetcher follows rows scattered over the
+    heap, so before each pass the first lines of the words the next pass
+    reads are prefetched through the pointers: the next k_block of the
+    tile, or after its last one the start of the next target tile.
+
+    The same tile loop runs a single generated register block kernel
+    (Bit_kernel_variants) over the rows of two Bit_DB_T for
+    BitDB_count_variant, through pointers to their rows.
+
+    * License : BSD-2
+*/
+
+/* ==========================================================================
+   SECTION 1: INCLUDES
+   Standard library headers first, then project headers.
+   ========================================================================== */
+
+#include "bit.h"
+#include "omp.h"
+#include <assert.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "bit_internal.h"
+
+/* --- End Section 1: INCLUDES --- */
+
+/* ==========================================================================
+   SECTION 5: INTERNAL DATA STRUCTURES AND ENUMS
+   Types used only inside this translation unit.
+   ========================================================================== */
+
+struct T_IDB {
+  unsigned int nelem;          // rows
+  unsigned int length;         // bits of every row
+  unsigned int size_in_qwords; // qwords of every row
+  T *bitsets;                  // the caller's bitsets
+  const uint64_t **rows;       // their qwords, in the same order
+};
+
+/* --- End Section 5: INTERNAL DATA STRUCTURES AND ENUMS --- */
+
+/* ==========================================================================
+   SECTION 8: INTERNAL HELPER FUNCTION DEFINITIONS
+   ========================================================================== */
+
+/* Kernel of a single Bit_count_ops value, or BIT_OP_COUNT if op is not one */
+static bit_setop_id idb_op_id(Bit_count_ops op) {
+  switch (op) {
+  case BIT_COUNT_INTER:
+    return BIT_OP_AND;
+  case BIT_COUNT_UNION:
+    return BIT_OP_OR;
+  case BIT_COUNT_DIFF:
+    return BIT_OP_XOR;
+  case BIT_COUNT_MINUS:
+    return BIT_OP_AND_NOT;
+  default:
+    return BIT_OP_COUNT;
+  }
+}
+
+/* Prefetches the first lines cache lines of words [k, size) of n rows */
+static inline void idb_prefetch(const uint64_t *const *rows, int n, size_t k,
+                                size_t size, int lines) {
+  size_t k_end = k + (size_t)lines * 8;
+  if (k_end > size)
+    k_end = size;
+  for (int r = 0; r < n; r++)
+    for (size_t w = k; w < k_end; w += 8)
+      __builtin_prefetch(rows[r] + w, 0, 3);
+}
+
+void bit_rows_count_tiled(const uint64_t *const *a, int nq,
+                          const uint64_t *const *b, int nt, size_t size,
+                          bit_count_rows_fn count_rows, int *counts,
+                          SETOP_COUNT_OPTS opts) {
+  const Bit_tuning tuning = bit_tuning_resolve(opts);
+  const size_t k_block = (size_t)tuning.k_block;
+  const int threads = cpu_threads(opts);
+  const int tile_q = tuning.tile;
+  int tile_t = tuning.tile;
+  // fewer tiles than threads: narrow the target tiles, as the packed
+  // kernels do
+  while (tile_t > OUTER_COL_NUM &&
+         (size_t)((nq + tile_q - 1) / tile_q) *
+                 (size_t)((nt + tile_t - 1) / tile_t) <
+             (size_t)threads)
+    tile_t /= 2;
+  const int prefetch = tuning.prefetch;
+#pragma omp parallel for collapse(2) schedule(dynamic) num_threads(threads)
+  for (int i_b = 0; i_b < nq; i_b += tile_q) {
+    for (int j_b = 0; j_b < nt; j_b += tile_t) {
+      const int ni = i_b + tile_q < nq ? tile_q : nq - i_b;
+      const int nj = j_b + tile_t < nt ? tile_t : nt - j_b;
+      const uint64_t *const *a_tile = a + i_b;
+      const uint64_t *const *b_tile = b + j_b;
+      int *out = counts + (size_t)i_b * nt + j_b;
+      for (size_t k_b = 0; k_b < size; k_b += k_block) {
+        const size_t k_max = k_b + k_block < size ? k_b + k_block : size;
+        if (prefetch > 0) {
+          if (k_max < size) {
+            idb_prefetch(a_tile, ni, k_max, size, prefetch);
+            idb_prefetch(b_tile, nj, k_max, size, prefetch);
+          } else if (j_b + tile_t < nt) {
+            const int next_j = j_b + tile_t;
+            const int next = next_j + tile_t < nt ? tile_t : nt - next_j;
+            idb_prefetch(b_tile + tile_t, next, 0, size, prefetch);
+          }
+        }
+        count_rows(a_tile, ni, b_tile, nj, k_b, k_max, out, (size_t)nt);
+      }
+    }
+  }
+}
+
+/* --- End Section 8: INTERNAL HELPER FUNCTION DEFINITIONS --- */
+
+/* ==========================================================================
+   SECTION 9: PUBLIC API
+   ========================================================================== */
+
+T_IDB BitIDB_from_bitsets(T rows[], int n) {
+  assert(rows != NULL && n > 0);
+  T_IDB set = calloc(1, sizeof(*set));
+  assert(set != NULL);
+  set->nelem = (unsigned int)n;
+  set->bitsets = malloc((size_t)n * sizeof(T));
+  set->rows = malloc((size_t)n * sizeof(uint64_t *));
+  assert(set->bitsets && set->rows);
+  assert(rows[0] != NULL);
+  set->length = rows[0]->length;
+  set->size_in_qwords = rows[0]->size_in_qwords;
+  for (int i = 0; i < n; i++)
+    BitIDB_replace_at(set, i, rows[i]);
+  return set;
+}
+
+void BitIDB_free(T_IDB *set) {
+  assert(set && *set);
+  free((*set)->bitsets);
+  free((*set)->rows);
+  free(*set);
+  *set = NULL;
+}
+
+int BitIDB_nelem(T_IDB set) {
+  assert(set);
+  return (int)set->nelem;
+}
+
+int BitIDB_length(T_IDB set) {
+  assert(set);
+  return (int)set->length;
+}
+
+T BitIDB_get_at(T_IDB set, int index) {
+  assert(set);
+  assert(index >= 0 && (unsigned int)index < set->nelem);
+  return set->bitsets[index];
+}
+
+void BitIDB_replace_at(T_IDB set, int index, T bit) {
+  assert(set && bit);
+  assert(index >= 0 && (unsigned int)index < set->nelem);
+  assert(bit->length == set->length);
+  set->bitsets[index] = bit;
+  set->rows[index] = bit->qwords;
+}
+
+void BitIDB_count_store(T_IDB bit, T_IDB bits, Bit_count_ops op, int *counts,
+                        SETOP_COUNT_OPTS opts) {
+  assert(bit && bits);
+  assert(counts != NULL);
+  assert(bit->length == bits->length);
+  const bit_setop_id id = idb_op_id(op);
+  assert(id != BIT_OP_COUNT);
+  bit_rows_count_tiled(bit->rows, (int)bit->nelem, bits->rows,
+                       (int)bits->nelem, bit->size_in_qwords,
+                       bit_kernels_active()->setop_count_rows[id], counts,
+                       opts);
+}
+
+int Bit_kernel_variants(Bit_kernel_variant variants[], int room) {
+  assert(room >= 0);
+  assert(variants != NULL || room == 0);
+  static const Bit_count_ops ops[BIT_OP_COUNT] = {
+      BIT_COUNT_INTER, BIT_COUNT_UNION, BIT_COUNT_DIFF, BIT_COUNT_MINUS};
+  const bit_kernel_table *kernels = bit_kernels_active();
+  for (int v = 0; v < kernels->ncount_variants && v < room; v++) {
+    const bit_count_variant *k = &kernels->count_variants[v];
+    variants[v] = (Bit_kernel_variant){.name = k->name,
+                                       .op = ops[k->op],
+                                       .rows = k->rows,
+                                       .cols = k->cols,
+                                       .vec_blk = k->vec_blk,
+                                       .aligned = k->aligned};
+  }
+  return kernels->ncount_variants;
+}
+
+void BitDB_count_variant(T_DB bit, T_DB bits, int variant, int *counts,
+                         SETOP_COUNT_OPTS opts) {
+  assert(bit && bits);
+  assert(counts != NULL);
+  assert(bit->length == bits->length);
+  const bit_kernel_table *kernels = bit_kernels_active();
+  assert(variant >= 0 && variant < kernels->ncount_variants);
+  const bit_count_variant *k = &kernels->count_variants[variant];
+  // every row, not just the first, must be aligned for aligned loads
+  assert(!k->aligned ||
+         (ALIGN_CHECK(bit->qwords) && ALIGN_CHECK(bits->qwords) &&
+          ALIGN_CHECK(bit->qwords + bit->stride_in_qwords) &&
+          ALIGN_CHECK(bits->qwords + bits->stride_in_qwords)));
+  const int nq = (int)bit->nelem, nt = (int)bits->nelem;
+  const uint64_t **a = malloc(((size_t)nq + nt) * sizeof(uint64_t *));
+  assert(a != NULL);
+  const uint64_t **b = a + nq;
+  for (int i = 0; i < nq; i++)
+    a[i] = bit->qwords + (size_t)i * bit->stride_in_qwords;
+  for (int j = 0; j < nt; j++)
+    b[j] = bits->qwords + (size_t)j * bits->stride_in_qwords;
+  bit_rows_count_tiled(a, nq, b, nt, bit->size_in_qwords, k->count_rows,
+                       counts, opts);
+  free(a);
+}
+
+/* --- End Section 9: PUBLIC API --- */
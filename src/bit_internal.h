@@ -8,8 +8,11 @@
     * License : BSD-2
 */
 #pragma once
+#include "bit.h"
 #include "simde_integration.h"
 #include <assert.h>
+#include <math.h>
+#include <stdatomic.h>
 #include <stdbool.h>
 #include <stdint.h>
 
@@ -26,6 +29,16 @@
 
 #define T Bit_T
 #define T_DB Bit_DB_T
+#define T_C Bit_C_T
+#define T_SDB Bit_SDB_T
+#define T_PDB Bit_PDB_T
+#define T_W Bit_W_T
+#define T_L Bit_L_T
+#define T_BF Bit_BF_T
+#define T_BSI Bit_BSI_T
+#define T_MIH Bit_MIH_T
+#define T_RDB Bit_RDB_T
+#define T_IDB Bit_IDB_T
 
 /* --- Universal bitwise alignment check (Alignment must be a power of 2) --- */
 #define IS_ALIGNED_64(ptr) (((uintptr_t)(const void *)(ptr) & 63) == 0)
@@ -76,6 +89,12 @@
 #define K_BLOCK BITVECTOR_TILE
 #endif
 
+/* Cache lines of each row the register block kernels prefetch ahead of the
+   next tile pass; 0 leaves it to the hardware prefetcher */
+#ifndef CPU_PREFETCH
+#define CPU_PREFETCH 0
+#endif
+
 /* --- Default popcount buffer sizing --- */
 #ifndef SETOP_BUFFER_SIZE
 #ifndef BUFFER_SIZE
@@ -85,21 +104,226 @@
 #endif
 #endif
 
+/* --- Index-list prefetch distance (in indices) for Bit_aset/aclear/aget --- */
+#ifndef BIT_PREFETCH_DISTANCE
+#define BIT_PREFETCH_DISTANCE 16
+#endif
+
 /* Default in case the makefile was not used */
 #ifndef USE_LIBPOPCNT
 #define USE_LIBPOPCNT 1
 #endif
 
-/* --- Concrete representations of opaque types defined in bit.h --- */
-struct T {
-  unsigned int length;         // capacity of the bitset in bits
-  unsigned int size_in_bytes;  // number of bytes of the 8 bit container
-  unsigned int size_in_qwords; // number of qwords of the 64 bit container
-  unsigned char *bytes;        // pointer to the first byte
-  uint64_t *qwords;            // pointer to the first qword
-  bool is_Bit_T_allocated;     // true if allocated by the library
+/* --- Concrete representations of opaque types defined in bit.h; the
+   layout of struct T is public through the opt-in bit_inline.h --- */
+#include "bit_inline.h"
+
+/* Library-allocated bitsets keep the header and the payload in one aligned
+   block; the payload starts at the first ALIGNMENT boundary past the header */
+#define BIT_HEADER_SIZE                                                        \
+  (((sizeof(struct T) + ALIGNMENT - 1) / ALIGNMENT) * ALIGNMENT)
+
+struct Bit_pool_T {
+  unsigned int length;         // length in bits of every bitset in the pool
+  unsigned int size_in_qwords; // payload size of every bitset
+  unsigned int per_slab;       // bitsets carved from each slab
+  unsigned int nslabs;         // number of slabs allocated so far
+  void **slabs;                // aligned slab blocks
+  T *free_list;                // stack of available bitsets
+  unsigned int nfree;          // number of bitsets on the stack
+};
+
+/* Private bitsets of the threads building one (Bit_shards_new) */
+struct Bit_shards_T {
+  int nshards;
+  T *shards;
+};
+
+struct Bit_ctx_T {
+  int num_cpu_threads;  // team size of the calls made with the context
+  int device_id;        // GPU device of those calls
+  Bit_tuning tuning;    // CPU tile sizes, copied at creation
+  int nslots;           // per-thread scratch slots (= num_cpu_threads)
+  int **scratch;        // slot buffers, grown on demand by their thread
+  size_t *scratch_ints; // capacity of each slot in ints
+  int *counts;          // result buffer of Bit_ctx_counts
+  size_t counts_ints;   // its capacity in ints
+  size_t budget;        // cap on the bytes kept, 0: none
+  _Atomic size_t bytes; // kept now, slots and counts buffer
+};
+
+struct Bit_cancel_T {
+  _Atomic bool requested; // set by Bit_cancel_request
 };
 
+/* One batch of queued queries, counted together (see BitDB_queue_new) */
+typedef struct bit_batch {
+  T_DB rows;     // the queries, max_batch rows
+  int nrows;     // rows submitted so far
+  int *counts;   // nrows x BitDB_nelem(db) counts, once done
+  double opened; // omp_get_wtime() of the first submission
+  bool done;     // counts are ready
+  int refs;      // tickets not yet waited for
+} bit_batch;
+
+struct Bit_queue_T {
+  T_DB db;               // container every query is counted against
+  int op;                // bit_setop_id of the counts
+  int max_batch;         // rows per batch
+  double max_wait;       // seconds a batch may stay open
+  SETOP_COUNT_OPTS opts; // options of the counting passes
+  omp_lock_t lock;       // guards open, outstanding and every batch
+  bit_batch *open;       // batch taking submissions, or NULL
+  int outstanding;       // tickets not yet waited for
+};
+
+struct Bit_query_T {
+  Bit_queue_T queue;
+  bit_batch *batch;
+  int row; // of the query in its batch
+};
+
+/* A file in the Bit_DB format being written row by row (BitDB_writer_open).
+   Rows are staged in an aligned buffer and written a whole buffer at a
+   time; the header goes in last, at offset 0. */
+struct Bit_writer_T {
+  int fd;                 // the file
+  unsigned int length;    // bits per row
+  unsigned int row_bytes; // bytes per row, whole qwords
+  unsigned char *buffer;  // page aligned staging buffer
+  size_t capacity, used;  // its size (whole pages) and staged bytes
+  size_t written;         // row bytes flushed so far
+  uint64_t nelem;         // rows put so far
+  uint64_t checksum;      // running db_checksum of the flushed rows
+  bool direct;            // opened with O_DIRECT: whole page writes only
+  bool failed;            // a write failed, BitDB_writer_close reports it
+};
+
+/* A compressed Bit_DB file open for reading (BitDB_zreader_open) */
+struct Bit_zreader_T {
+  int fd;                      // the file
+  unsigned int length;         // bits per row
+  unsigned int row_bytes;      // bytes per row, whole qwords
+  unsigned int block_rows;     // rows per compressed block
+  size_t nelem;                // rows in the file
+  size_t nblocks;              // compressed blocks
+  size_t next_row;             // first row of the next read
+  size_t largest;              // bytes of the largest compressed block
+  struct bit_db_zblock *index; // where every block is
+  int threads;                 // decompression threads
+  bool failed;                 // a read failed, BitDB_zreader_close reports it
+};
+
+/* A saved Bit_DB file read ahead in chunks (BitDB_reader_open). The rows
+   of the file are a stream of bytes cut into chunks; chunk c is read into
+   slot c % depth, and read again into it, depth chunks on, once used. */
+struct Bit_reader_T {
+  int fd;                  // the file
+  unsigned int length;     // bits per row
+  unsigned int row_bytes;  // bytes per row handed out, whole qwords
+  unsigned int stride;     // bytes between rows in the file
+  size_t nelem;            // rows in the file
+  size_t next_row;         // first row of the next read
+  uint64_t data_offset;    // of the rows in the file
+  uint64_t data_bytes;     // of the rows in the file
+  size_t nchunks;          // chunks of the rows
+  size_t depth;            // chunks read ahead
+  unsigned char *buffers;  // depth page aligned chunks
+  int64_t *ready;          // bytes read into each slot, -1 while in flight
+  size_t chunk;            // chunk of the next byte of the stream
+  size_t offset;           // of that byte in its chunk
+  size_t inflight;         // reads submitted and not yet completed
+  struct db_uring *uring;  // the ring, or NULL to read with pread
+  bool direct;             // opened with O_DIRECT: whole page reads only
+  bool failed;             // a read failed, BitDB_reader_close reports it
+};
+
+/* A mapped tiled count matrix (BitDB_tiles_open) */
+struct Bit_tiles_T {
+  void *mapping;                     // the whole file
+  size_t bytes;                      // size of the mapping
+  const struct bit_tile_file_header *header; // at the start of mapping
+  const struct bit_db_zblock *index; // of compressed tiles, NULL if raw
+  size_t ncols;                      // tiles across the matrix
+};
+
+/* One asynchronous GPU count (see BitDB_count_store_gpu_async) */
+struct Bit_async_T {
+  T_DB bit, bits;        // operands of the call
+  int *counts;           // its result buffer
+  SETOP_COUNT_OPTS opts; // releases are carried out by the wait
+  char *deps;            // dependence object of each chunk of targets
+  char queries_ready;    // dependence object of the query upload
+  char done;             // dependence object of the count downloads
+  bool queued;           // deferred target tasks were started
+  bool bit_layout;       // bit and bits are checked out of the layout
+  bool bits_layout;      // registry until the wait
+};
+
+/* --- Rank/select index: cumulative popcounts per 512-bit block --- */
+#define RANK_BLOCK_QWORDS 8
+#define rank_nblocks(size_in_qwords)                                           \
+  (((size_in_qwords) + RANK_BLOCK_QWORDS - 1) / RANK_BLOCK_QWORDS)
+/* Every write to the bits of a set marks both its rank index and its cached
+   Bit_count stale */
+#define RANK_INVALIDATE(set) ((set)->rank_valid = false, COUNT_INVALIDATE(set))
+_Static_assert(RANK_BLOCK_QWORDS * 64 == BIT_INLINE_SUMMARY_BITS,
+               "bit_inline.h marks summary blocks of RANK_BLOCK_QWORDS");
+
+/* --- Cached Bit_count: computed on first use, dropped by RANK_INVALIDATE
+   and kept exact by the single-bit writers --- */
+#define COUNT_INVALIDATE(set) ((set)->count_valid = false)
+
+/* --- Non-empty block summaries: one bit per rank block, set iff the block
+   has a set bit (Bit_cache_summary, BitDB_cache_summary) --- */
+#define summary_nwords(size_in_qwords)                                         \
+  ((rank_nblocks(size_in_qwords) + 63) / 64)
+#define SUMMARY_INVALIDATE(set) ((set)->summary_valid = false)
+
+/* Column postings of a container (BitDB_cache_postings): the rows holding
+   bit j are rows[offsets[j]] .. rows[offsets[j + 1] - 1], in increasing
+   order. Current while stamp matches the stamp of the container. */
+typedef struct {
+  size_t *offsets; // length + 1 entries
+  uint32_t *rows;  // offsets[length] entries
+  uint64_t stamp;  // contents stamp of the container when built
+} bit_db_postings;
+
+/* Row hashes of BitDB_hash_rows (BitDB_cache_hashes): the hash of every row
+   for seed. Current while stamp matches the stamp of the container. */
+typedef struct {
+  uint64_t *values; // nelem entries
+  size_t nelem;     // rows hashed
+  uint64_t seed;    // seed they were hashed with
+  uint64_t stamp;   // contents stamp of the container when hashed
+} bit_db_hashes;
+
+/* Change log of BitDB_track_changes: every row written since the last
+   export has a slot holding the XOR of its contents then and now (rows
+   appended since start from zero). Slots are handed out on first write. */
+typedef struct {
+  int *slot;               // slot of each row, -1 if unwritten
+  size_t nslots;           // rows slot covers
+  uint32_t *rows;          // row of each slot in use
+  uint64_t *deltas;        // size_in_qwords per slot
+  size_t used, allocated;  // slots in use and room for them
+  unsigned int base_nelem; // rows at the last export
+  bool moved;              // rows moved: the deltas no longer describe them
+} bit_db_changes;
+
+/* Copy-on-write state of a container with snapshots (BitDB_snapshot): its
+   rows live in a memory file that holds the generation of the snapshots.
+   While one of them is open the container maps the file privately, so its
+   writes take pages of their own. The container and its snapshots share
+   the state; the last of them to go frees it. */
+typedef struct {
+  int fd;           // memory file of the rows
+  _Atomic int refs; // the container and its snapshots
+  _Atomic int open; // snapshots of the generation in the file
+  bool diverged;    // the container maps the file privately
+  uint64_t stamp;   // contents stamp of the container at the last snapshot
+} bit_db_cow;
+
 struct T_DB {
   unsigned int nelem;          // number of bitsets in the packed container
   unsigned int length;         // capacity of the bitset in bits
@@ -108,8 +332,362 @@ struct T_DB {
   unsigned char *bytes;        // pointer to the first byte
   uint64_t *qwords;            // pointer to the first qword
   bool is_Bit_T_allocated;     // true if allocated by the library
+  int *row_counts;             // per-row popcount cache, or NULL if disabled
+  uint64_t *row_summaries;     // per-row non-empty block summaries
+                               // (summary_nwords each), or NULL if disabled
+  bit_db_postings *postings;   // column postings, or NULL if disabled
+  bit_db_hashes *row_hashes;   // row hashes, or NULL if disabled
+  int *row_ids;                // ID of every row (capacity entries) since
+                               // BitDB_reorder, or NULL: IDs are the rows
+  unsigned int capacity;       // rows the storage can hold (>= nelem)
+  bool is_mmapped;             // rows live in an anonymous mapping
+  unsigned int stride_in_bytes;  // distance between rows (>= size_in_bytes)
+  unsigned int stride_in_qwords; // same, in qwords; the padding stays zero
+  void *mapping;               // file mapping of BitDB_open_mmap, or NULL
+  size_t mapping_bytes;        // size of that mapping
+  bool is_readonly;            // rows may not be written (shared mapping)
+  Bit_numa_policy numa_policy; // placement of the rows, see BitDB_new_numa
+  bool is_pinned;              // rows from pinned_calloc (BitDB_new_pinned)
+  bool is_huge;                // rows from huge_calloc (BitDB_new_huge)
+  uint64_t *dirty_rows;        // rows written since the last device sync,
+                               // one bit each; NULL unless attached
+  int device_id;               // device of BitDB_device_attach
+  unsigned int device_nelem;   // rows on the device as of the last sync
+  uint64_t stamp;              // contents stamp, see db_new_stamp
+  bit_db_changes *changes;     // change log, or NULL unless tracked
+  _Atomic uint64_t *row_seqs;  // seqlock of every BIT_DB_SEQ_ROWS rows of
+                               // the capacity, NULL unless concurrent
+  bit_db_cow *cow;             // rows shared with snapshots, or NULL
+  size_t charged_bytes;        // storage counted by bit_mem_charge
+};
+
+/* Bitsets of 64-bit length (src/bit_large.c); the device functions of
+   src/bit_gpu.c read them as well */
+struct T_L {
+  int64_t length;          // bits
+  uint64_t size_in_qwords; // qwords of the bits
+  uint64_t *qwords;        // ALIGNMENT-aligned, zero past length
+  bool is_Bit_T_allocated; // true if the qwords belong to the library
+  int device_id;           // device of Bit_L_device_attach, -1 if none
 };
 
+/* Stamps unique in the process: a container takes a new one when it is
+   created and on every write through the BitDB API, so that a device copy
+   tagged with the stamp of its upload is current while the stamps match */
+uint64_t db_new_stamp(void);
+
+/* Writes restamp the container; attached ones also remember the rows
+   written since their last sync */
+static inline void db_mark_dirty(T_DB set, size_t first, size_t count) {
+  set->stamp = db_new_stamp();
+  if (set->dirty_rows == NULL)
+    return;
+  for (size_t i = first; i < first + count; i++)
+    set->dirty_rows[i / 64] |= UINT64_C(1) << (i % 64);
+}
+
+#define DB_ATTACHED(set, dev_id)                                               \
+  ((set)->dirty_rows != NULL && (set)->device_id == (dev_id))
+
+/* --- Row-block seqlocks (BitDB_concurrent) ---
+   Every BIT_DB_SEQ_ROWS rows share a sequence number that is odd while a
+   writer is inside them. Writers of the same block take turns on it, taking
+   blocks in increasing order; readers never wait. They note the sequences
+   of their rows, read, and read again if any of them moved or was odd. */
+#define BIT_DB_SEQ_ROWS 64
+
+static inline size_t db_seq_blocks(size_t capacity) {
+  return capacity ? (capacity + BIT_DB_SEQ_ROWS - 1) / BIT_DB_SEQ_ROWS : 1;
+}
+
+static inline void db_seq_write_begin(T_DB set, size_t first, size_t n) {
+  if (set->row_seqs == NULL || n == 0)
+    return;
+  for (size_t b = first / BIT_DB_SEQ_ROWS;
+       b <= (first + n - 1) / BIT_DB_SEQ_ROWS; b++) {
+    for (;;) {
+      uint64_t s = atomic_load_explicit(&set->row_seqs[b],
+                                        memory_order_relaxed);
+      if (!(s & 1) && atomic_compare_exchange_weak_explicit(
+                          &set->row_seqs[b], &s, s + 1, memory_order_acquire,
+                          memory_order_relaxed))
+        break;
+    }
+  }
+  // the odd sequences are seen before any of the row stores
+  atomic_thread_fence(memory_order_release);
+}
+
+static inline void db_seq_write_end(T_DB set, size_t first, size_t n) {
+  if (set->row_seqs == NULL || n == 0)
+    return;
+  for (size_t b = first / BIT_DB_SEQ_ROWS;
+       b <= (first + n - 1) / BIT_DB_SEQ_ROWS; b++)
+    atomic_fetch_add_explicit(&set->row_seqs[b], 1, memory_order_release);
+}
+
+/* Twice the sum of the sequences of the rows (they only grow, so the sum
+   moves whenever one does), plus one if a writer is inside */
+static inline uint64_t db_seq_sum(T_DB set, size_t first, size_t n,
+                                  memory_order order) {
+  uint64_t sum = 0, odd = 0;
+  for (size_t b = first / BIT_DB_SEQ_ROWS;
+       n && b <= (first + n - 1) / BIT_DB_SEQ_ROWS; b++) {
+    uint64_t s = atomic_load_explicit(&set->row_seqs[b], order);
+    sum += s;
+    odd |= s & 1;
+  }
+  return 2 * sum + odd;
+}
+
+static inline uint64_t db_seq_read_begin(T_DB set, size_t first, size_t n) {
+  return set->row_seqs ? db_seq_sum(set, first, n, memory_order_acquire) : 0;
+}
+
+/* Whether what was read of the rows since db_seq_read_begin may be torn */
+static inline bool db_seq_read_retry(T_DB set, size_t first, size_t n,
+                                     uint64_t seen) {
+  if (set->row_seqs == NULL)
+    return false;
+  atomic_thread_fence(memory_order_acquire); // the row loads come first
+  return (seen & 1) ||
+         db_seq_sum(set, first, n, memory_order_relaxed) != seen;
+}
+
+/* The rows of set a search row_mask selects (see SETOP_COUNT_OPTS), in
+   increasing order; rows holds nelem ints. Returns how many there are. */
+static inline size_t db_mask_rows(T_DB set, T mask, int *rows) {
+  assert(mask != NULL);
+  assert((size_t)mask->length == set->nelem);
+  size_t n = 0;
+  for (size_t q = 0; q < mask->size_in_qwords; q++)
+    for (uint64_t w = mask->qwords[q]; w; w &= w - 1)
+      rows[n++] = (int)(q * BPQW + (size_t)__builtin_ctzll(w));
+  return n;
+}
+
+/* --- Cancellation and deadlines of count stores (Bit_cancel_new) ---
+   The stop state of one count store with a token or a deadline. The CPU
+   count stores arm it on the calling thread (bit_stop_armed) around the
+   one kernel they run, which takes it before its team starts, so the
+   kernels that other functions run ignore both. The kernel looks at it
+   before each (query tile, target tile) and counts the target tiles done
+   in each query tile; bit_stop_end turns that into the leading queries
+   whose counts are complete. The tile and progress hooks of opts ride
+   along, so a call with hooks but no token arms it too. */
+typedef struct {
+  Bit_cancel_T cancel;  // token, or NULL
+  double deadline;      // omp_get_wtime() to stop at, or 0
+  _Atomic bool stopped; // a poll found the token cancelled or the deadline
+  int nqueries;         // rows of bit
+  int tile;             // queries per query tile of the kernel
+  int tiles_per_row;    // target tiles per query tile
+  _Atomic int *done;    // target tiles counted per query tile, once taken
+  void (*on_tile)(void *cl, int first_query, int nquery, int first_target,
+                  int ntarget);
+  void (*on_progress)(void *cl, size_t tiles_done, size_t tiles_total,
+                      uint64_t bytes_scanned);
+  void *hook_cl;
+  size_t row_bytes;             // bytes read of every query and target row
+  size_t tiles_total;           // tiles of the call
+  _Atomic size_t tiles_done;    // tiles reported so far
+  _Atomic uint64_t bytes_done;  // row bytes those tiles read
+} bit_stop;
+
+extern _Thread_local bit_stop *bit_stop_armed;
+extern void bit_stop_begin(bit_stop *stop, SETOP_COUNT_OPTS opts,
+                           int nqueries, size_t row_bytes);
+extern void bit_stop_notify(bit_stop *stop, int first_query, int nquery,
+                            int first_target, int ntarget);
+extern bit_stop *bit_stop_take(int tile, int tiles_per_row);
+extern int bit_stop_end(bit_stop *stop);
+extern void bit_stop_report(Bit_progress *progress, int nqueries, int done);
+
+/* Whether a count store needs a stop state: a token, deadline or hook */
+static inline bool bit_stop_active(SETOP_COUNT_OPTS opts) {
+  return opts.cancel != NULL || opts.deadline > 0 || opts.on_tile != NULL ||
+         opts.on_progress != NULL;
+}
+
+/* Whether a CPU count store of ncounts counts writes them with
+   non-temporal stores (see Bit_store_threshold_get) */
+extern uint64_t Bit_store_threshold_get(void);
+static inline bool bit_store_streams(SETOP_COUNT_OPTS opts, size_t ncounts) {
+  return opts.store == BIT_STORE_STREAM ||
+         (opts.store == BIT_STORE_AUTO &&
+          ncounts * sizeof(int) > Bit_store_threshold_get());
+}
+
+/* Similarity coefficient of two rows with popcounts a and b sharing c bits;
+   0 when the coefficient is undefined (empty rows). The searches of bit.c
+   and the joins of bit_join.c compare the same value against a cutoff */
+static inline float similarity_eval(Bit_similarity sim, int c, int a, int b) {
+  double num = c, den;
+  switch (sim.metric) {
+  case BIT_SIMILARITY_DICE:
+    num = 2.0 * c;
+    den = (double)a + b;
+    break;
+  case BIT_SIMILARITY_COSINE:
+    den = sqrt((double)a * b);
+    break;
+  case BIT_SIMILARITY_TVERSKY:
+    den = c + sim.alpha * (a - c) + sim.beta * (b - c);
+    break;
+  default: // BIT_SIMILARITY_TANIMOTO
+    den = (double)a + b - c;
+    break;
+  }
+  return den > 0 ? (float)(num / den) : 0.0f;
+}
+
+/* opts for a count store that a function which ignores the token, the
+   deadline and the hooks makes on its own behalf */
+static inline SETOP_COUNT_OPTS bit_stop_ignored(SETOP_COUNT_OPTS opts) {
+  opts.cancel = NULL;
+  opts.deadline = 0;
+  opts.progress = NULL;
+  opts.on_tile = NULL;
+  opts.on_progress = NULL;
+  return opts;
+}
+
+/* Whether the call should stop; once it should, every later poll agrees */
+static inline bool bit_stop_poll(bit_stop *stop) {
+  if (stop == NULL)
+    return false;
+  if (atomic_load_explicit(&stop->stopped, memory_order_relaxed))
+    return true;
+  if ((stop->cancel != NULL &&
+       atomic_load_explicit(&stop->cancel->requested,
+                            memory_order_relaxed)) ||
+      (stop->deadline > 0 && omp_get_wtime() >= stop->deadline)) {
+    atomic_store_explicit(&stop->stopped, true, memory_order_relaxed);
+    return true;
+  }
+  return false;
+}
+
+/* The tile of queries [i_b, i_max) and targets [j_b, j_max) is counted */
+static inline void bit_stop_tile_done(bit_stop *stop, int i_b, int i_max,
+                                      int j_b, int j_max) {
+  if (stop == NULL)
+    return;
+  atomic_fetch_add_explicit(&stop->done[i_b / stop->tile], 1,
+                            memory_order_relaxed);
+  if (stop->on_tile != NULL || stop->on_progress != NULL)
+    bit_stop_notify(stop, i_b, i_max - i_b, j_b, j_max - j_b);
+}
+
+/* --- On-disk layout of a saved Bit_DB (BitDB_save, BitDB_open_mmap) ---
+   A BIT_DB_FILE_HEADER_SIZE byte header, then nelem rows stride_in_bytes
+   apart, in host byte order. The header fills a page, so that mapped rows
+   keep the alignment they had in memory. */
+#define BIT_DB_FILE_MAGIC "BIT_DB1"
+#define BIT_DB_FILE_VERSION 1u
+#define BIT_DB_FILE_BYTE_ORDER UINT32_C(0x01020304)
+#define BIT_DB_FILE_HEADER_SIZE 4096u
+
+typedef struct {
+  char magic[8];            // BIT_DB_FILE_MAGIC, NUL terminated
+  uint32_t byte_order;      // BIT_DB_FILE_BYTE_ORDER as the writer saw it
+  uint32_t version;         // BIT_DB_FILE_VERSION
+  uint64_t header_size;     // offset of the first row
+  uint64_t nelem;           // number of rows
+  uint32_t length;          // bits per row
+  uint32_t stride_in_bytes; // distance between rows
+  uint32_t alignment;       // every row starts at a multiple of this
+  uint32_t reserved;        // zero
+  uint64_t checksum;        // db_checksum of the row bytes
+  uint64_t header_checksum; // db_checksum of the fields above
+} bit_db_file_header;
+
+/* --- Shared memory Bit_DB (BitDB_create_shared, BitDB_attach_shared) ---
+   The layout of a saved file in a POSIX shared memory object. The rest of
+   the header page holds the state below at BIT_DB_SHARED_STATE_OFFSET: the
+   generation of the rows is 1 until their first publication, odd while the
+   creator writes them and even once it has published them. Saved files
+   leave it zero. */
+#define BIT_DB_SHARED_STATE_OFFSET 2048u
+
+typedef struct {
+  uint64_t generation; // accessed atomically
+} bit_db_shared_state;
+
+/* --- Layout of a row delta (BitDB_export_delta, BitDB_apply_delta) ---
+   The header, then the uint32_t indices of the nrows rows that changed
+   (padded with zeros to a multiple of 2), then their XOR deltas of
+   nqwords(length) qwords each. */
+#define BIT_DB_DELTA_MAGIC "BIT_DDL"
+
+typedef struct {
+  char magic[8];        // BIT_DB_DELTA_MAGIC, NUL terminated
+  uint32_t byte_order;  // BIT_DB_FILE_BYTE_ORDER as the writer saw it
+  uint32_t length;      // bits per row
+  uint64_t base_nelem;  // rows of the container the delta applies to
+  uint64_t nelem;       // rows once it is applied
+  uint64_t nrows;       // rows changed
+  uint64_t checksum;    // db_checksum of the indices and deltas
+} bit_db_delta_header;
+
+/* --- On-disk layout of a compressed Bit_DB (BitDB_save_compressed) ---
+   A BIT_DB_FILE_HEADER_SIZE byte header, then blocks of block_rows packed
+   rows, each compressed on its own, then the index of the blocks at
+   index_offset. A block in BIT_DB_ZBLOCK_BYTES form holds one control byte
+   per qword, whose bit b is set when byte b of the qword is not zero,
+   followed by the bytes that are not zero, in order. */
+#define BIT_DB_ZFILE_MAGIC "BIT_DBZ"
+#define BIT_DB_ZFILE_VERSION 1u
+#define BIT_DB_ZBLOCK_RAW 0u   // the rows as they are
+#define BIT_DB_ZBLOCK_BYTES 1u // zero bytes left out, see above
+
+typedef struct {
+  char magic[8];            // BIT_DB_ZFILE_MAGIC, NUL terminated
+  uint32_t byte_order;      // BIT_DB_FILE_BYTE_ORDER as the writer saw it
+  uint32_t version;         // BIT_DB_ZFILE_VERSION
+  uint64_t nelem;           // number of rows
+  uint32_t length;          // bits per row
+  uint32_t block_rows;      // rows per block, the last may have fewer
+  uint64_t nblocks;         // number of blocks
+  uint64_t index_offset;    // of the nblocks entries of the index
+  uint64_t header_checksum; // db_checksum of the fields above
+} bit_db_zfile_header;
+
+typedef struct bit_db_zblock {
+  uint64_t offset;   // of the compressed block in the file
+  uint32_t bytes;    // its compressed size
+  uint32_t codec;    // BIT_DB_ZBLOCK_RAW or BIT_DB_ZBLOCK_BYTES
+  uint64_t checksum; // db_checksum of its rows, uncompressed
+} bit_db_zblock;
+
+/* --- On-disk layout of a tiled count matrix (BitDB_count_store_tiled_cpu)
+   A BIT_DB_FILE_HEADER_SIZE byte header, then tiles of tile_rows x
+   tile_cols counts of count_size bytes, row-major within the tile, the
+   counts past the edges of the matrix zero; a tile takes tile_bytes, a
+   multiple of 64. Raw tiles sit in row-major order of the tiles, so tile
+   (r, c) starts at header_size + (r * ncols + c) * tile_bytes, ncols being
+   the tiles across. Compressed tiles are zblocks anywhere in the file,
+   found through the index at index_offset, one bit_db_zblock per tile in
+   the same order. */
+#define BIT_TILE_FILE_MAGIC "BIT_TCM"
+#define BIT_TILE_FILE_VERSION 1u
+
+typedef struct bit_tile_file_header {
+  char magic[8];            // BIT_TILE_FILE_MAGIC, NUL terminated
+  uint32_t byte_order;      // BIT_DB_FILE_BYTE_ORDER as the writer saw it
+  uint32_t version;         // BIT_TILE_FILE_VERSION
+  uint64_t header_size;     // offset of the first raw tile
+  uint64_t nqueries;        // rows of the matrix
+  uint64_t ntargets;        // columns of the matrix
+  uint32_t tile_rows;       // counts down a tile
+  uint32_t tile_cols;       // counts across a tile
+  uint32_t count_type;      // Bit_counts_type, never BIT_COUNTS_AUTO
+  uint32_t count_size;      // bytes per count
+  uint64_t tile_bytes;      // bytes of a tile, uncompressed
+  uint64_t index_offset;    // of the zblock index, 0 for raw tiles
+  uint64_t header_checksum; // db_checksum of the fields above
+} bit_tile_file_header;
+
 /* --- Fast inline WWG and Tree-Adder popcount algorithms --- */
 #define C1_WWG UINT64_C(0X5555555555555555)
 #define C2_WWG UINT64_C(0x3333333333333333)
@@ -158,9 +736,31 @@ static inline uint64_t tree_adder(uint64_t v) {
 #define OMP_CPU_LOOP(levels, sched)                                            \
   _Pragma(STRINGIFY(omp parallel for collapse(levels) schedule(sched)))
 
+/* Same, on a team of nthreads threads (leaves the caller's ICVs alone) */
+#define OMP_CPU_LOOP_TEAM(levels, sched, nthreads)                             \
+  _Pragma(STRINGIFY(omp parallel for collapse(levels) schedule(sched)          \
+                        num_threads(nthreads)))
+
 #define OMP_CPU_LOOP_STATIC(levels, chunk)                                     \
   _Pragma(STRINGIFY(omp parallel for collapse(levels) schedule(static, chunk)))
 
+/* Collapse `levels` loops into tasks of the encountering team, one task per
+   iteration; the loop returns once every task is done */
+#define OMP_CPU_TASKLOOP(levels)                                               \
+  _Pragma(STRINGIFY(omp taskloop collapse(levels) grainsize(1)))
+
+/* Whether a CPU count store runs its tiles as tasks of the caller's team
+   (BIT_EXEC_TASKS from inside a parallel region) instead of a team */
+static inline bool bit_exec_tasks(SETOP_COUNT_OPTS opts) {
+  return opts.exec == BIT_EXEC_TASKS && omp_in_parallel();
+}
+
+/* Number of CPU threads requested by opts (<= 0 means all available) */
+static inline int cpu_threads(SETOP_COUNT_OPTS opts) {
+  return opts.num_cpu_threads > 0 ? opts.num_cpu_threads
+                                  : omp_get_max_threads();
+}
+
 /* SIMD vectorization directive (unaligned) */
 #define OMP_CPU_SIMD _Pragma(STRINGIFY(omp simd))
 
@@ -169,15 +769,73 @@ static inline uint64_t tree_adder(uint64_t v) {
   _Pragma(STRINGIFY(omp simd aligned(__VA_ARGS__ : alignment)))
 
 #ifndef NOGPU
+#ifndef BIT_USM
+/* Telemetry of a copy of count elements of array, started at the
+   gpu_stat_clock reading start, by the map type or motion of its clause
+   (see Bit_gpu_stats_get); alloc, release and delete copy nothing */
+#define GPU_STAT_COPY(dir, array, count, start)                                \
+  GPU_STAT_COPY_##dir(sizeof((array)[0]) * (size_t)(count), start)
+#define GPU_STAT_COPY_to(bytes, start)                                         \
+  do {                                                                         \
+    GPU_STAT_ADD(h2d_bytes, bytes);                                            \
+    GPU_STAT_ADD(h2d_transfers, 1);                                            \
+    GPU_STAT_TIME(transfer_ns, start);                                         \
+  } while (0)
+#define GPU_STAT_COPY_from(bytes, start)                                       \
+  do {                                                                         \
+    GPU_STAT_ADD(d2h_bytes, bytes);                                            \
+    GPU_STAT_ADD(d2h_transfers, 1);                                            \
+    GPU_STAT_TIME(transfer_ns, start);                                         \
+  } while (0)
+#define GPU_STAT_COPY_alloc(bytes, start) ((void)(start))
+#define GPU_STAT_COPY_release(bytes, start) ((void)(start))
+#define GPU_STAT_COPY_delete(bytes, start) ((void)(start))
+
+/* A buffer mapped by enter data counts against the memory budget of its
+   device, which may evict other buffers to make room (see
+   Bit_gpu_budget_set), and in Bit_memory_stats; exit data leaves the
+   record to the registry */
+#define GPU_ADMIT_enter(array, count, dev_id)                                  \
+  registry_admit((array), (dev_id), sizeof((array)[0]) * (size_t)(count))
+#define GPU_ADMIT_exit(array, count, dev_id) ((void)0)
+
 /* Update a device array from the host (or vice versa) */
 #define UPDATE_GPU_ARRAY(dir, array, index1, index2, dev_id)                   \
-  _Pragma(                                                                     \
-      STRINGIFY(omp target update dir(array [index1:index2]) device(dev_id)))
+  {                                                                            \
+    const uint64_t _copy_start = gpu_stat_clock();                             \
+    _Pragma(STRINGIFY(omp target update dir(array [index1:index2])             \
+                          device(dev_id)))                                     \
+    GPU_STAT_COPY(dir, array, index2, _copy_start);                            \
+  }
 
 /* Map or unmap a device array via enter/exit data */
 #define TARGET_GPU_ARRAY(point, dir, array, index1, index2, dev_id)            \
-  _Pragma(STRINGIFY(omp target point data map(dir : array [index1:index2])     \
-                        device(dev_id)))
+  {                                                                            \
+    GPU_ADMIT_##point(array, index2, dev_id);                                  \
+    const uint64_t _copy_start = gpu_stat_clock();                             \
+    _Pragma(STRINGIFY(omp target point data map(dir : array [index1:index2])   \
+                          device(dev_id)))                                     \
+    GPU_STAT_COPY(dir, array, index2, _copy_start);                            \
+  }
+#define GPU_USM 0
+#else
+/* Unified shared memory (make USM=1): the kernels read and write the host
+   buffers in place, so there is nothing to map, update or unmap */
+#define UPDATE_GPU_ARRAY(dir, array, index1, index2, dev_id)                   \
+  {                                                                            \
+    (void)(array), (void)(index1), (void)(index2), (void)(dev_id);             \
+  }
+#define GPU_STAT_COPY(dir, array, count, start) ((void)(start))
+#define TARGET_GPU_ARRAY(point, dir, array, index1, index2, dev_id)            \
+  UPDATE_GPU_ARRAY(dir, array, index1, index2, dev_id)
+#define GPU_USM 1
+#endif
+
+/* Whether the kernels on dev_id read the targets column-major: only the
+   private copy of a real device is transposed, never the host data of a
+   host fallback or of unified shared memory */
+#define GPU_TRANSPOSED(dev_id)                                                 \
+  (!GPU_USM && (dev_id) >= 0 && (dev_id) < omp_get_num_devices())
 #endif
 
 /* --- End Section 1: OPENMP CPU PARALLELIZATION HELPERS --- */
@@ -209,6 +867,92 @@ static inline uint64_t tree_adder(uint64_t v) {
 #define BIT_SCALAR_XOR(op1, op2) ((op1) ^ (op2))
 #define BIT_SCALAR_AND_NOT(op1, op2) ((op1) & ~(op2))
 
+#if BIT_SIMD_PATH_SVE
+// Predicated SVE bitwise operations (pg selects the active lanes)
+#define BIT_SVE_AND(pg, op1, op2) svand_u64_x((pg), (op1), (op2))
+#define BIT_SVE_OR(pg, op1, op2) svorr_u64_x((pg), (op1), (op2))
+#define BIT_SVE_XOR(pg, op1, op2) sveor_u64_x((pg), (op1), (op2))
+#define BIT_SVE_AND_NOT(pg, op1, op2) svbic_u64_x((pg), (op1), (op2))
+
+/* count = popcount of op(a[l], b[l]) over l in [lo, hi), vector-length
+   agnostic: two accumulators over whole vectors, then one svwhilelt
+   predicated vector per remaining step instead of a scalar fringe */
+#define BIT_SVE_COUNT(op, a, b, lo, hi, count)                                 \
+  do {                                                                         \
+    const size_t _vl = svcntd();                                               \
+    const svbool_t _all = svptrue_b64();                                       \
+    svuint64_t _sum0 = svdup_n_u64(0), _sum1 = svdup_n_u64(0);                 \
+    size_t _l = (lo);                                                          \
+    for (; _l + 2 * _vl <= (hi); _l += 2 * _vl) {                              \
+      _sum0 = svadd_u64_x(                                                     \
+          _all, _sum0,                                                         \
+          svcnt_u64_x(_all, BIT_SVE##op(_all, svld1_u64(_all, &(a)[_l]),       \
+                                        svld1_u64(_all, &(b)[_l]))));          \
+      _sum1 = svadd_u64_x(                                                     \
+          _all, _sum1,                                                         \
+          svcnt_u64_x(_all,                                                    \
+                      BIT_SVE##op(_all, svld1_u64(_all, &(a)[_l + _vl]),       \
+                                  svld1_u64(_all, &(b)[_l + _vl]))));          \
+    }                                                                          \
+    for (; _l < (hi); _l += _vl) {                                             \
+      const svbool_t _pg = svwhilelt_b64_u64(_l, (hi));                        \
+      _sum0 = svadd_u64_m(                                                     \
+          _pg, _sum0,                                                          \
+          svcnt_u64_x(_pg, BIT_SVE##op(_pg, svld1_u64(_pg, &(a)[_l]),          \
+                                       svld1_u64(_pg, &(b)[_l]))));            \
+    }                                                                          \
+    count = svaddv_u64(_all, svadd_u64_x(_all, _sum0, _sum1));                 \
+  } while (0)
+#endif
+
+#if BIT_SIMD_PATH_NEON
+// Native NEON bitwise operations on uint64x2_t
+#define BIT_NEON_AND(op1, op2) vandq_u64((op1), (op2))
+#define BIT_NEON_OR(op1, op2) vorrq_u64((op1), (op2))
+#define BIT_NEON_XOR(op1, op2) veorq_u64((op1), (op2))
+#define BIT_NEON_AND_NOT(op1, op2) vbicq_u64((op1), (op2))
+
+/* Byte counts of one vector, added pairwise into the 16-bit lanes of acc.
+   A lane gains at most 16 per vector, so BIT_NEON_FLUSH vectors fit in it
+   before the lanes are widened */
+#define BIT_NEON_CNT_ACC(acc, v)                                               \
+  vpadalq_u8((acc), vcntq_u8(vreinterpretq_u8_u64(v)))
+#define BIT_NEON_FLUSH 2048
+
+/* count = popcount of op(a[l], b[l]) over l in [lo, hi): four independent
+   16-bit accumulators over 8 qwords per step, widened into 64 bits once
+   every BIT_NEON_FLUSH steps rather than once per vector */
+#define BIT_NEON_COUNT(op, a, b, lo, hi, count)                                \
+  do {                                                                         \
+    uint64x2_t _total = vdupq_n_u64(0);                                        \
+    size_t _l = (lo);                                                          \
+    const size_t _hi = (hi);                                                   \
+    while (_l + 8 <= _hi) {                                                    \
+      const size_t _left = (_hi - _l) / 8;                                     \
+      const size_t _steps = _left < BIT_NEON_FLUSH ? _left : BIT_NEON_FLUSH;   \
+      uint16x8_t _s0 = vdupq_n_u16(0), _s1 = vdupq_n_u16(0);                   \
+      uint16x8_t _s2 = vdupq_n_u16(0), _s3 = vdupq_n_u16(0);                   \
+      for (size_t _k = 0; _k < _steps; _k++, _l += 8) {                        \
+        _s0 = BIT_NEON_CNT_ACC(_s0, BIT_NEON##op(vld1q_u64(&(a)[_l]),          \
+                                                 vld1q_u64(&(b)[_l])));        \
+        _s1 = BIT_NEON_CNT_ACC(_s1, BIT_NEON##op(vld1q_u64(&(a)[_l + 2]),      \
+                                                 vld1q_u64(&(b)[_l + 2])));    \
+        _s2 = BIT_NEON_CNT_ACC(_s2, BIT_NEON##op(vld1q_u64(&(a)[_l + 4]),      \
+                                                 vld1q_u64(&(b)[_l + 4])));    \
+        _s3 = BIT_NEON_CNT_ACC(_s3, BIT_NEON##op(vld1q_u64(&(a)[_l + 6]),      \
+                                                 vld1q_u64(&(b)[_l + 6])));    \
+      }                                                                        \
+      _total = vpadalq_u32(                                                    \
+          _total, vaddq_u32(vaddq_u32(vpaddlq_u16(_s0), vpaddlq_u16(_s1)),     \
+                            vaddq_u32(vpaddlq_u16(_s2), vpaddlq_u16(_s3))));   \
+    }                                                                          \
+    uint64_t _c = vaddvq_u64(_total);                                          \
+    for (; _l < _hi; _l++)                                                     \
+      _c += (uint64_t)__builtin_popcountll(BIT_SCALAR##op((a)[_l], (b)[_l]));  \
+    count = _c;                                                                \
+  } while (0)
+#endif
+
 /* Set operation that creates a new Bit_T result (modified from Hanson's book)
  */
 #define setop_validate(sequal, snull, tnull)                                   \
@@ -224,9 +968,112 @@ static inline uint64_t tree_adder(uint64_t v) {
     assert(s->length == t->length);                                            \
   }
 
-#if !USE_LIBPOPCNT
+/* Random index lists are latency bound, so the word touched
+   BIT_PREFETCH_DISTANCE indices ahead is prefetched (prefetches never fault,
+   so the index is only validated when it is actually used) */
+#define PREFETCH_INDEX(set, indices, i, n, rw)                                 \
+  if ((i) + BIT_PREFETCH_DISTANCE < (n))                                       \
+    __builtin_prefetch(                                                        \
+        &(set)->qwords[(unsigned int)(indices)[(i) + BIT_PREFETCH_DISTANCE] /  \
+                       BPQW],                                                  \
+        rw)
+
+/* Sorted index lists: indices landing in the same qword are folded into one
+   mask and applied with a single read-modify-write */
+#define SORTED_INDEX_APPLY(set, indices, n, APPLY)                             \
+  do {                                                                         \
+    int i = 0;                                                                 \
+    while (i < (n)) {                                                          \
+      assert((indices)[i] >= 0 && (indices)[i] < (int)(set)->length);         \
+      unsigned int w = (indices)[i] / BPQW;                                    \
+      uint64_t mask = 0;                                                       \
+      int prev = (indices)[i];                                                 \
+      for (; i < (n) && (unsigned int)(indices)[i] / BPQW == w; i++) {         \
+        assert((indices)[i] >= prev);                                          \
+        prev = (indices)[i];                                                   \
+        mask |= UINT64_C(1) << ((indices)[i] % BPQW);                          \
+      }                                                                        \
+      if (i < (n))                                                             \
+        assert((indices)[i] >= prev);                                          \
+      APPLY((set)->qwords[w], mask);                                           \
+    }                                                                          \
+  } while (0)
+#define APPLY_OR(word, mask) ((word) |= (mask))
+#define APPLY_ANDN(word, mask) ((word) &= ~(mask))
+
+
+/* Destination-supplied counterpart of setop_validate: the shortcut arms are
+   statements applied to dst and are only evaluated on the branch taken */
+#define setop_into_validate(sequal, snull, tnull)                              \
+  assert(dst);                                                                 \
+  RANK_INVALIDATE(dst);                                                        \
+  if (s == t) {                                                                \
+    assert(s && s->length == dst->length);                                     \
+    sequal;                                                                    \
+    return;                                                                    \
+  } else if (s == NULL) {                                                      \
+    assert(t && t->length == dst->length);                                     \
+    snull;                                                                     \
+    return;                                                                    \
+  } else if (t == NULL) {                                                      \
+    assert(s->length == dst->length);                                          \
+    tnull;                                                                     \
+    return;                                                                    \
+  } else {                                                                     \
+    assert(s->length == t->length && s->length == dst->length);                \
+  }
+
+/* Popcount strategy of the DB count microkernels. Scalar builds stage the op
+   results in setop_buffer for POPULATION_COUNT. Vector popcounts accumulate
+   directly where they are native (AVX-512 VPOPCNTDQ) and, without libpopcnt,
+   on 128-bit hosts. AVX2 and AVX-512BW hosts without VPOPCNTDQ emulate every
+   vector popcount, so they feed the op results through a Harley-Seal carry
+   save adder tree and pay one popcount per BIT_HS_VECTORS result vectors.
+   With libpopcnt 128-bit hosts use the POPCNT instruction.
+   The outer product kernel keeps a Harley-Seal tree per (x, y) pair, which
+   only fits the register file of AVX-512; with libpopcnt AVX2 and 128-bit
+   builds stage its results for libpopcnt (BIT_DB_OUTER_STAGED), which
+   measured faster there, and without it AVX2 accumulates vector popcounts */
+#if BIT_SIMD_PATH_SVE
+#define BIT_DB_POPCOUNT_SVE 1
+#elif BIT_SIMD_PATH_NEON
+#define BIT_DB_POPCOUNT_NEON 1
+#elif BIT_SIMD_PATH_SCALAR
+#define BIT_DB_POPCOUNT_STAGED 1
+#elif defined(__AVX512VPOPCNTDQ__) || (!USE_LIBPOPCNT && BIT_SIMD_PATH_128)
+#define BIT_DB_POPCOUNT_VECTOR 1
+#elif BIT_SIMD_PATH_128
+#define BIT_DB_POPCOUNT_SCALAR 1
+#else
+#define BIT_DB_POPCOUNT_HARLEY_SEAL 1
+#endif
+
+#if BIT_DB_POPCOUNT_STAGED || BIT_DB_POPCOUNT_SCALAR ||                        \
+    (BIT_DB_POPCOUNT_HARLEY_SEAL && !BIT_SIMD_PATH_AVX512 && USE_LIBPOPCNT)
+#define BIT_DB_OUTER_STAGED 1
+#elif BIT_DB_POPCOUNT_HARLEY_SEAL && BIT_SIMD_PATH_AVX512
+#define BIT_DB_OUTER_HARLEY_SEAL 1
+#endif
+
+#if BIT_SIMD_PATH_SVE
+#define setop_count_ls(op, s, t, LOAD)                                         \
+  do {                                                                         \
+    uint64_t count;                                                            \
+    BIT_SVE_COUNT(op, s->qwords, t->qwords, 0, (size_t)s->size_in_qwords,     \
+                  count);                                                      \
+    return (int)count;                                                         \
+  } while (0)
+#elif BIT_SIMD_PATH_NEON
+#define setop_count_ls(op, s, t, LOAD)                                         \
+  do {                                                                         \
+    uint64_t count;                                                            \
+    BIT_NEON_COUNT(op, s->qwords, t->qwords, 0, (size_t)s->size_in_qwords,    \
+                   count);                                                     \
+    return (int)count;                                                         \
+  } while (0)
+#elif !USE_LIBPOPCNT
 #if BIT_SIMD_PATH_SCALAR
-#define setop_count(op, s, t)                                                  \
+#define setop_count_ls(op, s, t, LOAD)                                         \
   do {                                                                         \
     uint64_t count = 0;                                                        \
     unsigned int bit_size_in_qwords = s->size_in_qwords;                       \
@@ -236,8 +1083,17 @@ static inline uint64_t tree_adder(uint64_t v) {
     }                                                                          \
     return (int)count;                                                         \
   } while (0)
+#elif BIT_DB_POPCOUNT_HARLEY_SEAL
+#define setop_count_ls(op, s, t, LOAD)                                         \
+  do {                                                                         \
+    int _hs_count; /* not count, which the kernel declares */                \
+    setop_count_db_cpu_kernel(s->qwords, t->qwords, (size_t)0,                 \
+                              (size_t)s->size_in_qwords, _hs_count, op, ,      \
+                              LOAD);                                           \
+    return _hs_count;                                                          \
+  } while (0)
 #else
-#define setop_count(op, s, t)                                                  \
+#define setop_count_ls(op, s, t, LOAD)                                         \
   do {                                                                         \
     uint64_t count = 0;                                                        \
     unsigned int bit_size_in_qwords = s->size_in_qwords;                       \
@@ -254,30 +1110,30 @@ static inline uint64_t tree_adder(uint64_t v) {
       /* Inline loads, op, and popcount to minimize live register state */     \
       sum0 = SIMDe_VECTOR_ADD(                                                 \
           sum0, SIMDe_POPCOUNT(BIT##op(                                        \
-                    VECTOR_UNALIGNED_LOAD(                                     \
+                    LOAD(                                                      \
                         (VECTOR_TYPE *)&s->qwords[i + VECTOR_OFFSET(0)]),      \
-                    VECTOR_UNALIGNED_LOAD(                                     \
+                    LOAD(                                                      \
                         (VECTOR_TYPE *)&t->qwords[i + VECTOR_OFFSET(0)]))));   \
                                                                                \
       sum1 = SIMDe_VECTOR_ADD(                                                 \
           sum1, SIMDe_POPCOUNT(BIT##op(                                        \
-                    VECTOR_UNALIGNED_LOAD(                                     \
+                    LOAD(                                                      \
                         (VECTOR_TYPE *)&s->qwords[i + VECTOR_OFFSET(1)]),      \
-                    VECTOR_UNALIGNED_LOAD(                                     \
+                    LOAD(                                                      \
                         (VECTOR_TYPE *)&t->qwords[i + VECTOR_OFFSET(1)]))));   \
                                                                                \
       sum2 = SIMDe_VECTOR_ADD(                                                 \
           sum2, SIMDe_POPCOUNT(BIT##op(                                        \
-                    VECTOR_UNALIGNED_LOAD(                                     \
+                    LOAD(                                                      \
                         (VECTOR_TYPE *)&s->qwords[i + VECTOR_OFFSET(2)]),      \
-                    VECTOR_UNALIGNED_LOAD(                                     \
+                    LOAD(                                                      \
                         (VECTOR_TYPE *)&t->qwords[i + VECTOR_OFFSET(2)]))));   \
                                                                                \
       sum3 = SIMDe_VECTOR_ADD(                                                 \
           sum3, SIMDe_POPCOUNT(BIT##op(                                        \
-                    VECTOR_UNALIGNED_LOAD(                                     \
+                    LOAD(                                                      \
                         (VECTOR_TYPE *)&s->qwords[i + VECTOR_OFFSET(3)]),      \
-                    VECTOR_UNALIGNED_LOAD(                                     \
+                    LOAD(                                                      \
                         (VECTOR_TYPE *)&t->qwords[i + VECTOR_OFFSET(3)]))));   \
     }                                                                          \
     /* Horizontal sum of the vector elements */                                \
@@ -296,7 +1152,7 @@ static inline uint64_t tree_adder(uint64_t v) {
   } while (0)
 #endif
 #else
-#define setop_count(op, s, t)                                                  \
+#define setop_count_ls(op, s, t, LOAD)                                         \
   do {                                                                         \
     uint64_t count = 0;                                                        \
     unsigned int bit_size_in_qwords = s->size_in_qwords;                       \
@@ -317,17 +1173,84 @@ static inline uint64_t tree_adder(uint64_t v) {
   } while (0)
 #endif
 
+// early-exit predicate: returns 1 as soon as op(s, t) has a set bit, i.e. the
+// vector path tests one OR-reduced VECTOR_BLOCK_SIZE block per iteration
+#if BIT_SIMD_PATH_SVE
+#define setop_any_ls(op, s, t, LOAD)                                           \
+  do {                                                                         \
+    const size_t _n = s->size_in_qwords;                                       \
+    for (size_t i = 0; i < _n; i += svcntd()) {                                \
+      const svbool_t pg = svwhilelt_b64_u64(i, _n);                            \
+      svuint64_t r = BIT_SVE##op(pg, svld1_u64(pg, &s->qwords[i]),             \
+                                 svld1_u64(pg, &t->qwords[i]));                \
+      if (svptest_any(pg, svcmpne_n_u64(pg, r, 0)))                            \
+        return 1;                                                              \
+    }                                                                          \
+    return 0;                                                                  \
+  } while (0)
+#elif BIT_SIMD_PATH_SCALAR
+#define setop_any_ls(op, s, t, LOAD)                                           \
+  do {                                                                         \
+    unsigned int bit_size_in_qwords = s->size_in_qwords;                       \
+    for (unsigned int i = 0; i < bit_size_in_qwords; i++)                      \
+      if (BIT_SCALAR##op(s->qwords[i], t->qwords[i]) != 0)                     \
+        return 1;                                                              \
+    return 0;                                                                  \
+  } while (0)
+#else
+#define setop_any_ls(op, s, t, LOAD)                                           \
+  do {                                                                         \
+    unsigned int bit_size_in_qwords = s->size_in_qwords;                       \
+    size_t limit =                                                             \
+        (bit_size_in_qwords / VECTOR_BLOCK_SIZE) * VECTOR_BLOCK_SIZE;          \
+    size_t i = 0;                                                              \
+    for (; i < limit; i += VECTOR_BLOCK_SIZE) {                                \
+      VECTOR_TYPE r0 = BIT##op(                                                \
+          LOAD((VECTOR_TYPE *)&s->qwords[i + VECTOR_OFFSET(0)]),               \
+          LOAD((VECTOR_TYPE *)&t->qwords[i + VECTOR_OFFSET(0)]));              \
+      VECTOR_TYPE r1 = BIT##op(                                                \
+          LOAD((VECTOR_TYPE *)&s->qwords[i + VECTOR_OFFSET(1)]),               \
+          LOAD((VECTOR_TYPE *)&t->qwords[i + VECTOR_OFFSET(1)]));              \
+      VECTOR_TYPE r2 = BIT##op(                                                \
+          LOAD((VECTOR_TYPE *)&s->qwords[i + VECTOR_OFFSET(2)]),               \
+          LOAD((VECTOR_TYPE *)&t->qwords[i + VECTOR_OFFSET(2)]));              \
+      VECTOR_TYPE r3 = BIT##op(                                                \
+          LOAD((VECTOR_TYPE *)&s->qwords[i + VECTOR_OFFSET(3)]),               \
+          LOAD((VECTOR_TYPE *)&t->qwords[i + VECTOR_OFFSET(3)]));              \
+      r0 = BIT_OR(BIT_OR(r0, r1), BIT_OR(r2, r3));                             \
+      if (!SIMDe_TEST_ZERO(r0))                                                \
+        return 1;                                                              \
+    }                                                                          \
+    for (; i < bit_size_in_qwords; i++)                                        \
+      if (BIT_SCALAR##op(s->qwords[i], t->qwords[i]) != 0)                     \
+        return 1;                                                              \
+    return 0;                                                                  \
+  } while (0)
+#endif
+
 // unified macro for intersection, union, minus and difference operations
 // note we can support scalar paths!
-#if BIT_SIMD_PATH_SCALAR
-#define setop(set, op, s, t)                                                   \
+#if BIT_SIMD_PATH_SVE
+#define setop_ls(set, op, s, t, LOAD, STORE)                                   \
+  do {                                                                         \
+    const size_t _n = s->size_in_qwords;                                       \
+    for (size_t i = 0; i < _n; i += svcntd()) {                                \
+      const svbool_t pg = svwhilelt_b64_u64(i, _n);                            \
+      svst1_u64(pg, &set->qwords[i],                                           \
+                BIT_SVE##op(pg, svld1_u64(pg, &s->qwords[i]),                  \
+                            svld1_u64(pg, &t->qwords[i])));                    \
+    }                                                                          \
+  } while (0)
+#elif BIT_SIMD_PATH_SCALAR
+#define setop_ls(set, op, s, t, LOAD, STORE)                                   \
   do {                                                                         \
+    unsigned int bit_size_in_qwords = s->size_in_qwords;                       \
     _Pragma(STRINGIFY(omp simd)) /* SIMD directive for the set operation */    \
         for (unsigned int i = 0; i < bit_size_in_qwords; i++)                  \
             set->qwords[i] = BIT_SCALAR##op(s->qwords[i], t->qwords[i]);       \
   } while (0)
 #else
-#define setop(set, op, s, t)                                                   \
+#define setop_ls(set, op, s, t, LOAD, STORE)                                   \
   do {                                                                         \
     size_t limit =                                                             \
         (s->size_in_qwords / VECTOR_BLOCK_SIZE) * VECTOR_BLOCK_SIZE;           \
@@ -335,39 +1258,39 @@ static inline uint64_t tree_adder(uint64_t v) {
     size_t i = 0;                                                              \
     for (; i < limit; i += VECTOR_BLOCK_SIZE) {                                \
       /* Load First operand */                                                 \
-      VECTOR_TYPE a0 = VECTOR_UNALIGNED_LOAD(                                  \
+      VECTOR_TYPE a0 = LOAD(                                                   \
           (VECTOR_TYPE *)&s->qwords[i + VECTOR_OFFSET(0)]);                    \
-      VECTOR_TYPE b0 = VECTOR_UNALIGNED_LOAD(                                  \
+      VECTOR_TYPE b0 = LOAD(                                                   \
           (VECTOR_TYPE *)&t->qwords[i + VECTOR_OFFSET(0)]);                    \
       VECTOR_TYPE r0 = BIT##op(a0, b0);                                        \
-      VECTOR_UNALIGNED_STORE(                                                  \
+      STORE(                                                                   \
           (VECTOR_TYPE *)&set->qwords[i + VECTOR_OFFSET(0)], r0);              \
                                                                                \
       /* Load Second operand */                                                \
-      a0 = VECTOR_UNALIGNED_LOAD(                                              \
+      a0 = LOAD(                                                               \
           (VECTOR_TYPE *)&s->qwords[i + VECTOR_OFFSET(1)]);                    \
-      b0 = VECTOR_UNALIGNED_LOAD(                                              \
+      b0 = LOAD(                                                               \
           (VECTOR_TYPE *)&t->qwords[i + VECTOR_OFFSET(1)]);                    \
       r0 = BIT##op(a0, b0);                                                    \
-      VECTOR_UNALIGNED_STORE(                                                  \
+      STORE(                                                                   \
           (VECTOR_TYPE *)&set->qwords[i + VECTOR_OFFSET(1)], r0);              \
                                                                                \
       /* Load Third operand */                                                 \
-      a0 = VECTOR_UNALIGNED_LOAD(                                              \
+      a0 = LOAD(                                                               \
           (VECTOR_TYPE *)&s->qwords[i + VECTOR_OFFSET(2)]);                    \
-      b0 = VECTOR_UNALIGNED_LOAD(                                              \
+      b0 = LOAD(                                                               \
           (VECTOR_TYPE *)&t->qwords[i + VECTOR_OFFSET(2)]);                    \
       r0 = BIT##op(a0, b0);                                                    \
-      VECTOR_UNALIGNED_STORE(                                                  \
+      STORE(                                                                   \
           (VECTOR_TYPE *)&set->qwords[i + VECTOR_OFFSET(2)], r0);              \
                                                                                \
       /* Load Fourth operand */                                                \
-      a0 = VECTOR_UNALIGNED_LOAD(                                              \
+      a0 = LOAD(                                                               \
           (VECTOR_TYPE *)&s->qwords[i + VECTOR_OFFSET(3)]);                    \
-      b0 = VECTOR_UNALIGNED_LOAD(                                              \
+      b0 = LOAD(                                                               \
           (VECTOR_TYPE *)&t->qwords[i + VECTOR_OFFSET(3)]);                    \
       r0 = BIT##op(a0, b0);                                                    \
-      VECTOR_UNALIGNED_STORE(                                                  \
+      STORE(                                                                   \
           (VECTOR_TYPE *)&set->qwords[i + VECTOR_OFFSET(3)], r0);              \
     }                                                                          \
                                                                                \
@@ -377,6 +1300,19 @@ static inline uint64_t tree_adder(uint64_t v) {
     }                                                                          \
   } while (0)
 #endif
+
+/* Unaligned forms; the *_ls forms take the vector load (and store) macros so
+   that kernels can dispatch to VECTOR_ALIGNED_* when every operand is
+   ALIGNMENT-aligned */
+#define setop_count(op, s, t) setop_count_ls(op, s, t, VECTOR_UNALIGNED_LOAD)
+#define setop_any(op, s, t) setop_any_ls(op, s, t, VECTOR_UNALIGNED_LOAD)
+#define setop(set, op, s, t)                                                   \
+  setop_ls(set, op, s, t, VECTOR_UNALIGNED_LOAD, VECTOR_UNALIGNED_STORE)
+
+/* True if aligned vector loads/stores are safe on all of the qword buffers */
+#define ALIGNED_OPERANDS3(a, b, c)                                             \
+  (!ARCH_32BIT && ALIGN_CHECK(a) && ALIGN_CHECK(b) && ALIGN_CHECK(c))
+#define ALIGNED_OPERANDS(a, b) ALIGNED_OPERANDS3(a, b, b)
 /* --- End Section 3: SINGLE-BITSET SET OPERATION MACROS --- */
 
 /* ===========================================================================
@@ -389,12 +1325,18 @@ static inline uint64_t tree_adder(uint64_t v) {
   assert(bit &&bits);                                                          \
   assert(bit->length == bits->length);
 
-/* Extract raw pointers and dimensions from two Bit_DB_T operands */
+/* Extract raw pointers and dimensions from two Bit_DB_T operands. Rows are
+   zero padded up to their stride, so the count loops run over the common
+   stride: with row strides that are a multiple of the vector step the scalar
+   fringes never execute */
 #define SETOP_VAR_INIT(bit, bits, bit_qwords, bits_qwords, bit_size_in_qwords, \
                        num_targets, n)                                         \
   uint64_t *bit_qwords = bit->qwords;                                          \
   uint64_t *bits_qwords = bits->qwords;                                        \
-  unsigned int bit_size_in_qwords = bit->size_in_qwords;                       \
+  const size_t bit_stride = bit->stride_in_qwords;                             \
+  const size_t bits_stride = bits->stride_in_qwords;                           \
+  unsigned int bit_size_in_qwords =                                            \
+      (unsigned int)(bit_stride < bits_stride ? bit_stride : bits_stride);     \
   unsigned int num_targets = bit->nelem;                                       \
   unsigned int n = bits->nelem;
 
@@ -402,8 +1344,8 @@ static inline uint64_t tree_adder(uint64_t v) {
 #if !USE_LIBPOPCNT
 
 #define POPULATION_COUNT(count, setop_buffer, buffer_size)                     \
-  /* SIMD SYNCHRONIZATION DIRECTIVE */                                         \
-  OMP_CPU_SIMD_ALIGN_BUFFER(ALIGNMENT, setop_buffer)                           \
+  /* SIMD directive; buffer may be a sub-array, so no aligned() clause */      \
+  OMP_CPU_SIMD                                                                 \
   for (int k = 0; k < buffer_size; k++) {                                      \
     count += POPCOUNT(setop_buffer[k]);                                        \
   }
@@ -415,8 +1357,165 @@ static inline uint64_t tree_adder(uint64_t v) {
 
 #endif
 
+/* Accumulate the popcounts of n tile buffers of buffer_size qwords each,
+   laid out back to back, into counts[0 .. n). POPULATION_COUNT_BATCH names
+   the buffers once, ahead of the chunk loop; libpopcnt then makes its CPUID
+   checks once per chunk for all of them (popcnt_many) rather than once per
+   buffer */
+#if !USE_LIBPOPCNT
+
+#define POPULATION_COUNT_BATCH(batch, setop_buffers, n, buffer_size)          \
+  uint64_t *const batch##_base = (setop_buffers);                              \
+  const size_t batch##_qwords = (size_t)(buffer_size);
+
+#define POPULATION_COUNT_MANY(counts, batch, n)                                \
+  for (int m_ = 0; m_ < (n); m_++) {                                           \
+    POPULATION_COUNT((counts)[m_], (batch##_base + m_ * batch##_qwords),       \
+                     (int)batch##_qwords)                                      \
+  }
+
+#else
+
+#define POPULATION_COUNT_BATCH(batch, setop_buffers, n, buffer_size)          \
+  const void *batch##_buffers[n];                                              \
+  uint64_t batch##_sizes[n];                                                   \
+  for (int m_ = 0; m_ < (n); m_++) {                                           \
+    batch##_buffers[m_] = (setop_buffers) + (size_t)m_ * (buffer_size);        \
+    batch##_sizes[m_] = (uint64_t)(buffer_size) * sizeof(uint64_t);            \
+  }
+
+#define POPULATION_COUNT_MANY(counts, batch, n)                                \
+  do {                                                                         \
+    uint64_t batch##_counts[n];                                                \
+    popcnt_many(batch##_buffers, batch##_sizes, (n), batch##_counts);          \
+    for (int m_ = 0; m_ < (n); m_++)                                           \
+      (counts)[m_] += batch##_counts[m_];                                      \
+  } while (0);
+
+#endif
+
+#if BIT_DB_POPCOUNT_SCALAR || BIT_DB_POPCOUNT_HARLEY_SEAL
+#if defined(__GNUC__) || defined(__clang__)
+#define BIT_DB_POPCNT64(x) ((uint64_t)__builtin_popcountll(x))
+#else
+#define BIT_DB_POPCNT64(x) POPCOUNT(x)
+#endif
+#endif
+
+#if BIT_DB_POPCOUNT_HARLEY_SEAL
+/* Result vectors per step of the adder tree: 16 (the default without
+   libpopcnt) or 8, which keeps more rows on the tree than the scalar fringe
+   and was the measured choice of the libpopcnt builds */
+#ifndef BIT_HS_VECTORS
+#if USE_LIBPOPCNT
+#define BIT_HS_VECTORS 8
+#else
+#define BIT_HS_VECTORS 16
+#endif
+#endif
+#if BIT_HS_VECTORS != 8 && BIT_HS_VECTORS != 16
+#error "BIT_HS_VECTORS must be 8 or 16"
+#endif
+
+/* Qwords consumed per step of the adder tree */
+#define BIT_HS_STEP_QWORDS (BIT_HS_VECTORS * VECTOR_QWORDS)
+
+/* Carry-save adder: h:l = a + b + c, bitwise */
+#define BIT_CSA(h, l, a, b, c)                                                 \
+  do {                                                                         \
+    VECTOR_TYPE _csa_u = BIT_XOR((a), (b));                                    \
+    (h) = BIT_OR(BIT_AND((a), (b)), BIT_AND(_csa_u, (c)));                     \
+    (l) = BIT_XOR(_csa_u, (c));                                                \
+  } while (0)
+
+/* Result vector u of op over the rows a and b */
+#define BIT_HS_OP(op, LOAD_MACRO, a, b, u)                                     \
+  BIT##op(LOAD_MACRO((VECTOR_TYPE *)&(a)[VECTOR_OFFSET(u)]),                   \
+          LOAD_MACRO((VECTOR_TYPE *)&(b)[VECTOR_OFFSET(u)]))
+
+/* Feed the result vectors u0 .. u0 + 7 of op over the rows a and b into
+   ones, twos and fours; carry is their weight 8 part */
+#define BIT_HS_EIGHT(carry, ones, twos, fours, op, LOAD_MACRO, a, b, u0)       \
+  do {                                                                         \
+    VECTOR_TYPE _hs_twos_a, _hs_twos_b, _hs_fours_a, _hs_fours_b;              \
+    BIT_CSA(_hs_twos_a, ones, ones, BIT_HS_OP(op, LOAD_MACRO, a, b, (u0) + 0), \
+            BIT_HS_OP(op, LOAD_MACRO, a, b, (u0) + 1));                        \
+    BIT_CSA(_hs_twos_b, ones, ones, BIT_HS_OP(op, LOAD_MACRO, a, b, (u0) + 2), \
+            BIT_HS_OP(op, LOAD_MACRO, a, b, (u0) + 3));                        \
+    BIT_CSA(_hs_fours_a, twos, twos, _hs_twos_a, _hs_twos_b);                  \
+    BIT_CSA(_hs_twos_a, ones, ones, BIT_HS_OP(op, LOAD_MACRO, a, b, (u0) + 4), \
+            BIT_HS_OP(op, LOAD_MACRO, a, b, (u0) + 5));                        \
+    BIT_CSA(_hs_twos_b, ones, ones, BIT_HS_OP(op, LOAD_MACRO, a, b, (u0) + 6), \
+            BIT_HS_OP(op, LOAD_MACRO, a, b, (u0) + 7));                        \
+    BIT_CSA(_hs_fours_b, twos, twos, _hs_twos_a, _hs_twos_b);                  \
+    BIT_CSA(carry, fours, fours, _hs_fours_a, _hs_fours_b);                    \
+  } while (0)
+
+/* Feed the BIT_HS_VECTORS result vectors of op over the rows a and b into
+   the adder tree of one count; top accumulates the popcounts of the carries
+   out of its last level (eights stays zero in the 8 vector tree) */
+#if BIT_HS_VECTORS == 16
+#define BIT_HARLEY_SEAL_STEP(ones, twos, fours, eights, top, op, LOAD_MACRO,   \
+                             a, b)                                             \
+  do {                                                                         \
+    VECTOR_TYPE _hs_eights_a, _hs_eights_b, _hs_sixteens;                      \
+    BIT_HS_EIGHT(_hs_eights_a, ones, twos, fours, op, LOAD_MACRO, a, b, 0);    \
+    BIT_HS_EIGHT(_hs_eights_b, ones, twos, fours, op, LOAD_MACRO, a, b, 8);    \
+    BIT_CSA(_hs_sixteens, eights, eights, _hs_eights_a, _hs_eights_b);         \
+    top = SIMDe_VECTOR_ADD(top, SIMDe_POPCOUNT(_hs_sixteens));                 \
+  } while (0)
+#else
+#define BIT_HARLEY_SEAL_STEP(ones, twos, fours, eights, top, op, LOAD_MACRO,   \
+                             a, b)                                             \
+  do {                                                                         \
+    VECTOR_TYPE _hs_eights;                                                    \
+    BIT_HS_EIGHT(_hs_eights, ones, twos, fours, op, LOAD_MACRO, a, b, 0);      \
+    top = SIMDe_VECTOR_ADD(top, SIMDe_POPCOUNT(_hs_eights));                   \
+  } while (0)
+#endif
+
+/* Sum of the per-qword lanes of a vector of popcounts */
+#define BIT_VECTOR_LANES_SUM(sum, vec)                                         \
+  do {                                                                         \
+    uint64_t _lanes[VECTOR_QWORDS];                                            \
+    SIMDe_STORE_VECTOR(_lanes, (vec));                                         \
+    for (size_t _lane = 0; _lane < VECTOR_QWORDS; _lane++)                     \
+      sum += _lanes[_lane];                                                    \
+  } while (0)
+
+/* Total of an adder tree: BIT_HS_VECTORS top + 8 eights + 4 fours + 2 twos
+   + ones */
+#define BIT_HARLEY_SEAL_TOTAL(count, ones, twos, fours, eights, top)           \
+  do {                                                                         \
+    uint64_t _hs_top = 0, _hs_eights = 0, _hs_fours = 0, _hs_twos = 0;         \
+    BIT_VECTOR_LANES_SUM(_hs_top, top);                                        \
+    BIT_VECTOR_LANES_SUM(_hs_eights, SIMDe_POPCOUNT(eights));                  \
+    BIT_VECTOR_LANES_SUM(_hs_fours, SIMDe_POPCOUNT(fours));                    \
+    BIT_VECTOR_LANES_SUM(_hs_twos, SIMDe_POPCOUNT(twos));                      \
+    count += BIT_HS_VECTORS * _hs_top + 8 * _hs_eights + 4 * _hs_fours +       \
+             2 * _hs_twos;                                                     \
+    BIT_VECTOR_LANES_SUM(count, SIMDe_POPCOUNT(ones));                         \
+  } while (0)
+#endif
+
 /* --- 1x1 Microkernel (Strictly used for fringes and 1x1 fast path) --- */
-#if USE_LIBPOPCNT || BIT_SIMD_PATH_SCALAR
+#if BIT_DB_POPCOUNT_SVE
+#define setop_count_db_cpu_kernel(a_row, b_row, k_b, k_max, result, op,        \
+                                  SIMD_DIRECTIVE, LOAD_MACRO)                  \
+  do {                                                                         \
+    uint64_t count;                                                            \
+    BIT_SVE_COUNT(op, a_row, b_row, (size_t)(k_b), (size_t)(k_max), count);    \
+    result = (int)count;                                                       \
+  } while (0)
+#elif BIT_DB_POPCOUNT_NEON
+#define setop_count_db_cpu_kernel(a_row, b_row, k_b, k_max, result, op,        \
+                                  SIMD_DIRECTIVE, LOAD_MACRO)                  \
+  do {                                                                         \
+    uint64_t count;                                                            \
+    BIT_NEON_COUNT(op, a_row, b_row, (size_t)(k_b), (size_t)(k_max), count);   \
+    result = (int)count;                                                       \
+  } while (0)
+#elif BIT_DB_POPCOUNT_STAGED
 #define setop_count_db_cpu_kernel(a_row, b_row, k_b, k_max, result, op,        \
                                   SIMD_DIRECTIVE, LOAD_MACRO)                  \
   do {                                                                         \
@@ -436,6 +1535,36 @@ static inline uint64_t tree_adder(uint64_t v) {
     }                                                                          \
     result = (int)count;                                                       \
   } while (0)
+#elif BIT_DB_POPCOUNT_SCALAR
+#define setop_count_db_cpu_kernel(a_row, b_row, k_b, k_max, result, op,        \
+                                  SIMD_DIRECTIVE, LOAD_MACRO)                  \
+  do {                                                                         \
+    uint64_t count = 0;                                                        \
+    for (size_t l = k_b; l < k_max; l++) {                                     \
+      count += BIT_DB_POPCNT64(BIT_SCALAR##op(a_row[l], b_row[l]));            \
+    }                                                                          \
+    result = (int)count;                                                       \
+  } while (0)
+#elif BIT_DB_POPCOUNT_HARLEY_SEAL
+#define setop_count_db_cpu_kernel(a_row, b_row, k_b, k_max, result, op,        \
+                                  SIMD_DIRECTIVE, LOAD_MACRO)                  \
+  do {                                                                         \
+    uint64_t count = 0;                                                        \
+    size_t k_idx = k_b;                                                        \
+    CHUNK_LIMIT(limit, k_b, k_max, BIT_HS_STEP_QWORDS)                         \
+    VECTOR_TYPE ones = SIMDe_ZERO_VECTOR, twos = SIMDe_ZERO_VECTOR;            \
+    VECTOR_TYPE fours = SIMDe_ZERO_VECTOR, eights = SIMDe_ZERO_VECTOR;         \
+    VECTOR_TYPE top = SIMDe_ZERO_VECTOR;                                       \
+    for (; k_idx < limit; k_idx += BIT_HS_STEP_QWORDS) {                       \
+      BIT_HARLEY_SEAL_STEP(ones, twos, fours, eights, top, op, LOAD_MACRO,     \
+                           &a_row[k_idx], &b_row[k_idx]);                      \
+    }                                                                          \
+    BIT_HARLEY_SEAL_TOTAL(count, ones, twos, fours, eights, top);              \
+    for (; k_idx < k_max; k_idx++) {                                           \
+      count += BIT_DB_POPCNT64(BIT_SCALAR##op(a_row[k_idx], b_row[k_idx]));    \
+    }                                                                          \
+    result = (int)count;                                                       \
+  } while (0)
 #else
 #define setop_count_db_cpu_kernel(a_row, b_row, k_b, k_max, result, op,        \
                                   SIMD_DIRECTIVE, LOAD_MACRO)                  \
@@ -482,82 +1611,195 @@ static inline uint64_t tree_adder(uint64_t v) {
 #endif
 
 /* --- Parameterized Generic Outer Product Microkernel --- */
-#if USE_LIBPOPCNT || BIT_SIMD_PATH_SCALAR
-#define setop_count_db_cpu_kernel_outer(a_rows, b_rows, k_b, k_max, results,   \
-                                        op, SIMD_DIRECTIVE, LOAD_MACRO)        \
+#if BIT_DB_POPCOUNT_SVE
+/* Sizeless SVE vectors cannot form the [ROWS][COLS] accumulator arrays of
+   an outer product, so each (x, y) pair runs the 1x1 kernel over the k
+   block; the block's rows stay in L1 between the pairs that reload them */
+#define setop_count_db_cpu_kernel_outer(ROWS, COLS, VEC_BLK, a_rows, b_rows,   \
+                                        k_b, k_max, results, op,               \
+                                        SIMD_DIRECTIVE, LOAD_MACRO)            \
   do {                                                                         \
-    /* Per-output contiguous buffer for libpopcnt bulk reduction. */           \
+    for (int x = 0; x < ROWS; x++) {                                           \
+      for (int y = 0; y < COLS; y++) {                                         \
+        setop_count_db_cpu_kernel(a_rows[x], b_rows[y], k_b, k_max,            \
+                                  results[x][y], op, SIMD_DIRECTIVE,           \
+                                  LOAD_MACRO);                                 \
+      }                                                                        \
+    }                                                                          \
+  } while (0)
+#elif BIT_DB_POPCOUNT_NEON
+/* One 16-bit accumulator per (x, y) pair: every step loads VEC_BLK vectors
+   of each row once and adds the byte counts of all ROWS x COLS products;
+   the accumulators are widened once per BIT_NEON_FLUSH / VEC_BLK steps */
+#define setop_count_db_cpu_kernel_outer(ROWS, COLS, VEC_BLK, a_rows, b_rows,   \
+                                        k_b, k_max, results, op,               \
+                                        SIMD_DIRECTIVE, LOAD_MACRO)            \
+  do {                                                                         \
+    uint64_t c[ROWS][COLS] = {0};                                              \
+    const size_t step_size = (size_t)(2 * VEC_BLK);                            \
+    size_t k_idx = k_b;                                                        \
+    while (k_idx + step_size <= (size_t)(k_max)) {                             \
+      const size_t left = ((size_t)(k_max) - k_idx) / step_size;               \
+      const size_t steps = left < BIT_NEON_FLUSH / VEC_BLK                     \
+                               ? left                                          \
+                               : BIT_NEON_FLUSH / VEC_BLK;                     \
+      uint16x8_t acc[ROWS][COLS];                                              \
+      for (int x = 0; x < ROWS; x++)                                           \
+        for (int y = 0; y < COLS; y++)                                         \
+          acc[x][y] = vdupq_n_u16(0);                                          \
+      for (size_t s = 0; s < steps; s++, k_idx += step_size) {                 \
+        for (int u = 0; u < VEC_BLK; u++) {                                    \
+          uint64x2_t a_vectors[ROWS], b_vectors[COLS];                         \
+          for (int x = 0; x < ROWS; x++)                                       \
+            a_vectors[x] = vld1q_u64(&a_rows[x][k_idx + 2 * u]);               \
+          for (int y = 0; y < COLS; y++)                                       \
+            b_vectors[y] = vld1q_u64(&b_rows[y][k_idx + 2 * u]);               \
+          for (int x = 0; x < ROWS; x++)                                       \
+            for (int y = 0; y < COLS; y++)                                     \
+              acc[x][y] = BIT_NEON_CNT_ACC(                                    \
+                  acc[x][y], BIT_NEON##op(a_vectors[x], b_vectors[y]));        \
+        }                                                                      \
+      }                                                                        \
+      for (int x = 0; x < ROWS; x++)                                           \
+        for (int y = 0; y < COLS; y++)                                         \
+          c[x][y] += vaddlvq_u16(acc[x][y]);                                   \
+    }                                                                          \
+    /* Scalar Fringe */                                                        \
+    for (; k_idx < (size_t)(k_max); k_idx++) {                                 \
+      for (int x = 0; x < ROWS; x++) {                                         \
+        for (int y = 0; y < COLS; y++) {                                       \
+          c[x][y] += (uint64_t)__builtin_popcountll(                           \
+              BIT_SCALAR##op(a_rows[x][k_idx], b_rows[y][k_idx]));             \
+        }                                                                      \
+      }                                                                        \
+    }                                                                          \
+    for (int x = 0; x < ROWS; x++) {                                           \
+      for (int y = 0; y < COLS; y++) {                                         \
+        results[x][y] = (int)c[x][y];                                          \
+      }                                                                        \
+    }                                                                          \
+  } while (0)
+#elif BIT_DB_OUTER_STAGED
+#define setop_count_db_cpu_kernel_outer(ROWS, COLS, VEC_BLK, a_rows, b_rows,   \
+                                        k_b, k_max, results, op,               \
+                                        SIMD_DIRECTIVE, LOAD_MACRO)            \
+  do {                                                                         \
+    /* Per-output contiguous buffers for one libpopcnt batch per chunk */     \
     const int BUF_SZ = SETOP_BUFFER_SIZE;                                      \
     _Alignas(ALIGNMENT)                                                        \
-        uint64_t setop_buffer[OUTER_ROW_NUM][OUTER_COL_NUM][BUF_SZ];           \
-    uint64_t c[OUTER_ROW_NUM][OUTER_COL_NUM] = {0};                            \
+        uint64_t setop_buffer[ROWS][COLS][BUF_SZ];                             \
+    uint64_t c[ROWS][COLS] = {0};                                              \
     size_t l = k_b;                                                            \
     CHUNK_LIMIT(limit, k_b, k_max, BUF_SZ)                                     \
+    POPULATION_COUNT_BATCH(staged, &setop_buffer[0][0][0], ROWS * COLS, BUF_SZ) \
     for (; l < limit; l += BUF_SZ) {                                           \
       SIMD_DIRECTIVE                                                           \
       for (int k = 0; k < BUF_SZ; k++) {                                       \
-        uint64_t a_values[OUTER_ROW_NUM];                                      \
-        uint64_t b_values[OUTER_COL_NUM];                                      \
-        for (int x = 0; x < OUTER_ROW_NUM; ++x)                                \
+        uint64_t a_values[ROWS];                                               \
+        uint64_t b_values[COLS];                                               \
+        for (int x = 0; x < ROWS; ++x)                                         \
           a_values[x] = a_rows[x][l + k];                                      \
                                                                                \
-        for (int y = 0; y < OUTER_COL_NUM; ++y)                                \
+        for (int y = 0; y < COLS; ++y)                                         \
           b_values[y] = b_rows[y][l + k];                                      \
                                                                                \
-        for (int x = 0; x < OUTER_ROW_NUM; ++x)                                \
-          for (int y = 0; y < OUTER_COL_NUM; ++y)                              \
+        for (int x = 0; x < ROWS; ++x)                                         \
+          for (int y = 0; y < COLS; ++y)                                       \
             setop_buffer[x][y][k] = BIT_SCALAR##op(a_values[x], b_values[y]);  \
       }                                                                        \
-      for (int x = 0; x < OUTER_ROW_NUM; x++) {                                \
-        for (int y = 0; y < OUTER_COL_NUM; y++) {                              \
-          POPULATION_COUNT(c[x][y], setop_buffer[x][y], BUF_SZ)                \
-        }                                                                      \
-      }                                                                        \
+      POPULATION_COUNT_MANY(&c[0][0], staged, ROWS * COLS)                     \
     }                                                                          \
     for (; l < k_max; l++) {                                                   \
-      for (int x = 0; x < OUTER_ROW_NUM; x++) {                                \
-        for (int y = 0; y < OUTER_COL_NUM; y++) {                              \
+      for (int x = 0; x < ROWS; x++) {                                         \
+        for (int y = 0; y < COLS; y++) {                                       \
           c[x][y] += POPCOUNT(BIT_SCALAR##op(a_rows[x][l], b_rows[y][l]));     \
         }                                                                      \
       }                                                                        \
     }                                                                          \
-    for (int x = 0; x < OUTER_ROW_NUM; x++) {                                  \
-      for (int y = 0; y < OUTER_COL_NUM; y++) {                                \
+    for (int x = 0; x < ROWS; x++) {                                           \
+      for (int y = 0; y < COLS; y++) {                                         \
+        results[x][y] = (int)c[x][y];                                          \
+      }                                                                        \
+    }                                                                          \
+  } while (0)
+#elif BIT_DB_OUTER_HARLEY_SEAL
+#define setop_count_db_cpu_kernel_outer(ROWS, COLS, VEC_BLK, a_rows, b_rows,   \
+                                        k_b, k_max, results, op,               \
+                                        SIMD_DIRECTIVE, LOAD_MACRO)            \
+  do {                                                                         \
+    uint64_t c[ROWS][COLS] = {0};                                              \
+    size_t k_idx = k_b;                                                        \
+    CHUNK_LIMIT(limit, k_b, k_max, BIT_HS_STEP_QWORDS)                         \
+    VECTOR_TYPE ones[ROWS][COLS], twos[ROWS][COLS];                            \
+    VECTOR_TYPE fours[ROWS][COLS], eights[ROWS][COLS], top[ROWS][COLS];        \
+    for (int x = 0; x < ROWS; x++) {                                           \
+      for (int y = 0; y < COLS; y++) {                                         \
+        ones[x][y] = twos[x][y] = SIMDe_ZERO_VECTOR;                           \
+        fours[x][y] = eights[x][y] = top[x][y] = SIMDe_ZERO_VECTOR;            \
+      }                                                                        \
+    }                                                                          \
+    for (; k_idx < limit; k_idx += BIT_HS_STEP_QWORDS) {                       \
+      for (int x = 0; x < ROWS; x++) {                                         \
+        for (int y = 0; y < COLS; y++) {                                       \
+          BIT_HARLEY_SEAL_STEP(ones[x][y], twos[x][y], fours[x][y],            \
+                               eights[x][y], top[x][y], op, LOAD_MACRO,        \
+                               &a_rows[x][k_idx], &b_rows[y][k_idx]);          \
+        }                                                                      \
+      }                                                                        \
+    }                                                                          \
+    for (int x = 0; x < ROWS; x++) {                                           \
+      for (int y = 0; y < COLS; y++) {                                         \
+        BIT_HARLEY_SEAL_TOTAL(c[x][y], ones[x][y], twos[x][y], fours[x][y],    \
+                              eights[x][y], top[x][y]);                        \
+      }                                                                        \
+    }                                                                          \
+    /* Scalar Fringe */                                                        \
+    for (; k_idx < k_max; k_idx++) {                                           \
+      for (int x = 0; x < ROWS; x++) {                                         \
+        for (int y = 0; y < COLS; y++) {                                       \
+          c[x][y] += BIT_DB_POPCNT64(                                          \
+              BIT_SCALAR##op(a_rows[x][k_idx], b_rows[y][k_idx]));            \
+        }                                                                      \
+      }                                                                        \
+    }                                                                          \
+    for (int x = 0; x < ROWS; x++) {                                           \
+      for (int y = 0; y < COLS; y++) {                                         \
         results[x][y] = (int)c[x][y];                                          \
       }                                                                        \
     }                                                                          \
   } while (0)
 #else
-#define setop_count_db_cpu_kernel_outer(a_rows, b_rows, k_b, k_max, results,   \
-                                        op, SIMD_DIRECTIVE, LOAD_MACRO)        \
+#define setop_count_db_cpu_kernel_outer(ROWS, COLS, VEC_BLK, a_rows, b_rows,   \
+                                        k_b, k_max, results, op,               \
+                                        SIMD_DIRECTIVE, LOAD_MACRO)            \
   do {                                                                         \
-    uint64_t c[OUTER_ROW_NUM][OUTER_COL_NUM] = {0};                            \
+    uint64_t c[ROWS][COLS] = {0};                                              \
     size_t k_idx = k_b;                                                        \
     /* FIX: Multiply the unroll factor by the vector word width */             \
-    const size_t step_size = (size_t)(OUTER_VEC_BLK * VECTOR_QWORDS);          \
+    const size_t step_size = (size_t)(VEC_BLK * VECTOR_QWORDS);                \
     CHUNK_LIMIT(limit, k_b, k_max, step_size)                                  \
-    VECTOR_TYPE sum[OUTER_ROW_NUM][OUTER_COL_NUM];                             \
-    for (int x = 0; x < OUTER_ROW_NUM; x++) {                                  \
-      for (int y = 0; y < OUTER_COL_NUM; y++) {                                \
+    VECTOR_TYPE sum[ROWS][COLS];                                               \
+    for (int x = 0; x < ROWS; x++) {                                           \
+      for (int y = 0; y < COLS; y++) {                                         \
         sum[x][y] = SIMDe_ZERO_VECTOR;                                         \
       }                                                                        \
     }                                                                          \
     for (; k_idx < limit; k_idx += step_size) {                                \
-      for (int u = 0; u < OUTER_VEC_BLK; u++) {                                \
-        VECTOR_TYPE a_vectors[OUTER_ROW_NUM];                                  \
-        VECTOR_TYPE b_vectors[OUTER_COL_NUM];                                  \
+      for (int u = 0; u < VEC_BLK; u++) {                                      \
+        VECTOR_TYPE a_vectors[ROWS];                                           \
+        VECTOR_TYPE b_vectors[COLS];                                           \
                                                                                \
-        for (int x = 0; x < OUTER_ROW_NUM; x++) {                              \
+        for (int x = 0; x < ROWS; x++) {                                       \
           a_vectors[x] =                                                       \
               LOAD_MACRO((VECTOR_TYPE *)&a_rows[x][k_idx + VECTOR_OFFSET(u)]); \
         }                                                                      \
-        for (int y = 0; y < OUTER_COL_NUM; y++) {                              \
+        for (int y = 0; y < COLS; y++) {                                       \
           b_vectors[y] =                                                       \
               LOAD_MACRO((VECTOR_TYPE *)&b_rows[y][k_idx + VECTOR_OFFSET(u)]); \
         }                                                                      \
                                                                                \
-        for (int x = 0; x < OUTER_ROW_NUM; x++) {                              \
-          for (int y = 0; y < OUTER_COL_NUM; y++) {                            \
+        for (int x = 0; x < ROWS; x++) {                                       \
+          for (int y = 0; y < COLS; y++) {                                     \
             sum[x][y] = SIMDe_VECTOR_ADD(                                      \
                 sum[x][y],                                                     \
                 SIMDe_POPCOUNT(BIT##op(a_vectors[x], b_vectors[y])));          \
@@ -566,9 +1808,9 @@ static inline uint64_t tree_adder(uint64_t v) {
       }                                                                        \
     }                                                                          \
     /* Extract Phase */                                                        \
-    uint64_t sum_array[OUTER_ROW_NUM][OUTER_COL_NUM][VECTOR_QWORDS];           \
-    for (int x = 0; x < OUTER_ROW_NUM; x++) {                                  \
-      for (int y = 0; y < OUTER_COL_NUM; y++) {                                \
+    uint64_t sum_array[ROWS][COLS][VECTOR_QWORDS];                             \
+    for (int x = 0; x < ROWS; x++) {                                           \
+      for (int y = 0; y < COLS; y++) {                                         \
         SIMDe_STORE_VECTOR(sum_array[x][y], sum[x][y]);                        \
         for (size_t v = 0; v < VECTOR_QWORDS; v++) {                           \
           c[x][y] += sum_array[x][y][v];                                       \
@@ -577,176 +1819,263 @@ static inline uint64_t tree_adder(uint64_t v) {
     }                                                                          \
     /* Scalar Fringe */                                                        \
     for (; k_idx < k_max; k_idx++) {                                           \
-      for (int x = 0; x < OUTER_ROW_NUM; x++) {                                \
-        for (int y = 0; y < OUTER_COL_NUM; y++) {                              \
+      for (int x = 0; x < ROWS; x++) {                                         \
+        for (int y = 0; y < COLS; y++) {                                       \
           c[x][y] +=                                                           \
               POPCOUNT(BIT_SCALAR##op(a_rows[x][k_idx], b_rows[y][k_idx]));    \
         }                                                                      \
       }                                                                        \
     }                                                                          \
-    for (int x = 0; x < OUTER_ROW_NUM; x++) {                                  \
-      for (int y = 0; y < OUTER_COL_NUM; y++) {                                \
+    for (int x = 0; x < ROWS; x++) {                                           \
+      for (int y = 0; y < COLS; y++) {                                         \
         results[x][y] = (int)c[x][y];                                          \
       }                                                                        \
     }                                                                          \
   } while (0)
 #endif
 
-/* MACRO ARCHITECTURE AND LOOP DISPATCH */
-#if (OUTER_ROW_NUM == 1 && OUTER_COL_NUM == 1)
+/* Prefetches the first lines cache lines of words [k, size) of nrows rows
+   stride qwords apart, for reading */
+static inline void bit_prefetch_rows(const uint64_t *row, size_t stride,
+                                     int nrows, size_t k, size_t size,
+                                     int lines) {
+  size_t k_end = k + (size_t)lines * 8;
+  if (k_end > size)
+    k_end = size;
+  for (int r = 0; r < nrows; r++, row += stride)
+    for (size_t w = k; w < k_end; w += 8)
+      __builtin_prefetch(row + w, 0, 3);
+}
 
-/* Fast-path Architecture for 1x1 dimensions (Zero fringes, direct 1x1 kernel
- * dispatch) */
-#define OMP_CPU_TILE_START_OUTER                                               \
-  OMP_CPU_LOOP(1, dynamic)                                                     \
-  for (int i_b = 0; i_b < num_targets; i_b += CPU_TILE_BIT) {                  \
-    for (int j_b = 0; j_b < n; j_b += CPU_TILE_BITS) {                         \
-                                                                               \
-      int i_max = (i_b + CPU_TILE_BIT < num_targets) ? i_b + CPU_TILE_BIT      \
-                                                     : num_targets;            \
-      int j_max = (j_b + CPU_TILE_BITS < n) ? j_b + CPU_TILE_BITS : n;         \
-                                                                               \
-      for (int i = i_b; i < i_max; i++) {                                      \
-        for (int j = j_b; j < j_max; j++) {                                    \
-          counts[(uint64_t)i * n + j] = 0;                                     \
-        }                                                                      \
-      }                                                                        \
-                                                                               \
-      for (size_t k_b = 0; k_b < bit_size_in_qwords; k_b += K_BLOCK) {         \
-        size_t k_max = (k_b + K_BLOCK < bit_size_in_qwords)                    \
-                           ? k_b + K_BLOCK                                     \
-                           : bit_size_in_qwords;                               \
-                                                                               \
-        for (int i = i_b; i < i_max; i++) {                                    \
-          const uint64_t *restrict a_row =                                     \
-              bit_qwords + (uint64_t)i * bit_size_in_qwords;                   \
-          for (int j = j_b; j < j_max; j++) {                                  \
-            const uint64_t *restrict b_row =                                   \
-                bits_qwords + (uint64_t)j * bit_size_in_qwords;
-
-#define OMP_CPU_TILE_END_OUTER(op, SIMD_DIR, LOAD_MACRO)                       \
-  int result = 0;                                                              \
-  setop_count_db_cpu_kernel(a_row, b_row, k_b, k_max, result, op, SIMD_DIR,    \
-                            LOAD_MACRO);                                       \
-  counts[(uint64_t)i * n + j] += result;                                       \
-  }                                                                            \
-  }                                                                            \
-  }                                                                            \
-  }                                                                            \
+/* Running sums of the counts of a query (BitDB_count_stats_*): the sum is
+   exact, and so are the squares while they stay below 2^53 */
+typedef struct {
+  uint64_t n, sum;
+  double sumsq;
+  int min, max;
+} bit_stats_acc;
+
+static inline void bit_stats_finish(const bit_stats_acc *acc,
+                                    Bit_count_stats *out) {
+  if (acc->n == 0) {
+    *out = (Bit_count_stats){0.0, 0.0, 0, 0};
+    return;
   }
+  const double n = (double)acc->n, mean = (double)acc->sum / n;
+  const double variance = acc->sumsq / n - mean * mean;
+  *out = (Bit_count_stats){mean, variance > 0.0 ? variance : 0.0, acc->min,
+                           acc->max};
+}
 
-#else
+/* Ints of the largest tile a streaming count kernel accumulates on the
+   stack; larger tiles are allocated */
+#define BIT_STREAM_TILE_INTS 4096
+
+/* Streams the n ints of src to dst past the caches */
+static inline void bit_stream_ints(int *dst, const int *src, int n) {
+  for (int j = 0; j < n; j++)
+    STREAM_INT(dst + j, src[j]);
+}
 
-/* Generic Tiled Architecture for dimensions > 1 (Outer product arrays + fringe
- * handling) */
-#define OMP_CPU_TILE_START_OUTER                                               \
-  OMP_CPU_LOOP(1, dynamic)                                                     \
-  for (int i_b = 0; i_b < num_targets; i_b += CPU_TILE_BIT) {                  \
-    for (int j_b = 0; j_b < n; j_b += CPU_TILE_BITS) {                         \
+/* MACRO ARCHITECTURE AND LOOP DISPATCH
+   Tiled architecture for a ROWS x COLS register block (outer product arrays
+   + fringe handling). The tile sizes tile_bit, tile_bits and k_block are
+   run time values, supplied by setop_count_db_cpu from the active tuning;
+   the schedule of the tile loop is set there too (see BitDB_new_numa). The
+   i_b and j_b tile loops are collapsed, so that a handful of queries against
+   many targets still spreads over the team instead of being one tile. A
+   tile is skipped once tile_stop (NULL without a stop) says to stop. LOOP
+   is the directive of the tile loops: a team, or OMP_CPU_TASKLOOP. With
+   prefetch_lines above 0, the last register rows of a tile pass prefetch
+   what the next pass reads: the next k_block of the rows, or after the
+   last k_block the start of the target rows of the next tile. The counts
+   of a tile accumulate in tile_out, tile_ld ints a row: in place in
+   counts, or with stream_tiles in a local tile that is streamed to counts
+   once it is final, so that the counts neither evict the rows being
+   reused nor are read in for the increments */
+#define OMP_CPU_TILE_START_OUTER(ROWS, COLS, LOOP)                             \
+  LOOP                                                                         \
+  for (int i_b = 0; i_b < num_targets; i_b += tile_bit) {                      \
+    for (int j_b = 0; j_b < n; j_b += tile_bits) {                             \
+      if (bit_stop_poll(tile_stop))                                            \
+        continue;                                                              \
                                                                                \
-      int i_max = (i_b + CPU_TILE_BIT < num_targets) ? i_b + CPU_TILE_BIT      \
-                                                     : num_targets;            \
-      int j_max = (j_b + CPU_TILE_BITS < n) ? j_b + CPU_TILE_BITS : n;         \
+      int i_max = (i_b + tile_bit < (int)num_targets) ? i_b + tile_bit         \
+                                                          : (int)num_targets;  \
+      int j_max = (j_b + tile_bits < (int)n) ? j_b + tile_bits : (int)n;       \
+      int tile_stack[BIT_STREAM_TILE_INTS];                                    \
+      int *tile_out = counts + (uint64_t)i_b * n + j_b;                        \
+      size_t tile_ld = n;                                                      \
+      if (stream_tiles) {                                                      \
+        tile_ld = (size_t)(j_max - j_b);                                       \
+        tile_out = (size_t)(i_max - i_b) * tile_ld <= BIT_STREAM_TILE_INTS     \
+                       ? tile_stack                                            \
+                       : malloc((size_t)(i_max - i_b) * tile_ld *              \
+                                sizeof(int));                                  \
+        assert(tile_out != NULL);                                              \
+      }                                                                        \
                                                                                \
       for (int i = i_b; i < i_max; i++) {                                      \
         for (int j = j_b; j < j_max; j++) {                                    \
-          counts[(uint64_t)i * n + j] = 0;                                     \
+          tile_out[(size_t)(i - i_b) * tile_ld + (j - j_b)] = 0;               \
         }                                                                      \
       }                                                                        \
                                                                                \
-      for (size_t k_b = 0; k_b < bit_size_in_qwords; k_b += K_BLOCK) {         \
-        size_t k_max = (k_b + K_BLOCK < bit_size_in_qwords)                    \
-                           ? k_b + K_BLOCK                                     \
+      for (size_t k_b = 0; k_b < bit_size_in_qwords; k_b += k_block) {         \
+        size_t k_max = (k_b + k_block < bit_size_in_qwords)                    \
+                           ? k_b + k_block                                     \
                            : bit_size_in_qwords;                               \
                                                                                \
         int i = i_b;                                                           \
-        for (; i <= i_max - OUTER_ROW_NUM; i += OUTER_ROW_NUM) {               \
-          const uint64_t *restrict a_rows[OUTER_ROW_NUM];                      \
-          for (int x = 0; x < OUTER_ROW_NUM; x++) {                            \
-            a_rows[x] = bit_qwords + (uint64_t)(i + x) * bit_size_in_qwords;   \
+        for (; i <= i_max - ROWS; i += ROWS) {                                 \
+          const uint64_t *restrict a_rows[ROWS];                               \
+          for (int x = 0; x < ROWS; x++) {                                     \
+            a_rows[x] = bit_qwords + (uint64_t)(i + x) * bit_stride;           \
           }                                                                    \
                                                                                \
           int j = j_b;                                                         \
-          for (; j <= j_max - OUTER_COL_NUM; j += OUTER_COL_NUM) {             \
-            const uint64_t *restrict b_rows[OUTER_COL_NUM];                    \
-            for (int y = 0; y < OUTER_COL_NUM; y++) {                          \
+          for (; j <= j_max - COLS; j += COLS) {                               \
+            const uint64_t *restrict b_rows[COLS];                             \
+            for (int y = 0; y < COLS; y++) {                                   \
               b_rows[y] =                                                      \
-                  bits_qwords + (uint64_t)(j + y) * bit_size_in_qwords;        \
+                  bits_qwords + (uint64_t)(j + y) * bits_stride;               \
             }                                                                  \
-            int results[OUTER_ROW_NUM][OUTER_COL_NUM];
+            if (prefetch_lines > 0 && i + 2 * ROWS > i_max) {                  \
+              if (k_max < bit_size_in_qwords) {                                \
+                bit_prefetch_rows(b_rows[0], bits_stride, COLS, k_max,         \
+                                  bit_size_in_qwords, prefetch_lines);         \
+                if (j == j_b)                                                  \
+                  bit_prefetch_rows(bit_qwords + (uint64_t)i_b * bit_stride,   \
+                                    bit_stride, i_max - i_b, k_max,            \
+                                    bit_size_in_qwords, prefetch_lines);       \
+              } else if (j + tile_bits + COLS <= (int)n) {                     \
+                bit_prefetch_rows(                                             \
+                    b_rows[0] + (uint64_t)tile_bits * bits_stride,             \
+                    bits_stride, COLS, 0, bit_size_in_qwords, prefetch_lines); \
+              }                                                                \
+            }                                                                  \
+            int results[ROWS][COLS];
 
-#define OMP_CPU_TILE_END_OUTER(op, SIMD_DIR, LOAD_MACRO)                       \
-  setop_count_db_cpu_kernel_outer(a_rows, b_rows, k_b, k_max, results, op,     \
-                                  SIMD_DIR, LOAD_MACRO);                       \
+#define OMP_CPU_TILE_END_OUTER(ROWS, COLS, VEC_BLK, op, SIMD_DIR, LOAD_MACRO)  \
+  setop_count_db_cpu_kernel_outer(ROWS, COLS, VEC_BLK, a_rows, b_rows, k_b,    \
+                                  k_max, results, op, SIMD_DIR, LOAD_MACRO);   \
                                                                                \
-  for (int x = 0; x < OUTER_ROW_NUM; x++) {                                    \
-    for (int y = 0; y < OUTER_COL_NUM; y++) {                                  \
-      counts[(uint64_t)(i + x) * n + (j + y)] += results[x][y];                \
+  for (int x = 0; x < ROWS; x++) {                                             \
+    for (int y = 0; y < COLS; y++) {                                           \
+      tile_out[(size_t)(i + x - i_b) * tile_ld + (j + y - j_b)] +=             \
+          results[x][y];                                                       \
     }                                                                          \
   }                                                                            \
   }                                                                            \
   /* J-FRINGE: Resolve the remaining columns using 1x1 kernel */               \
   for (; j < j_max; j++) {                                                     \
     const uint64_t *restrict b_row_f =                                         \
-        bits_qwords + (uint64_t)j * bit_size_in_qwords;                        \
-    for (int x = 0; x < OUTER_ROW_NUM; x++) {                                  \
+        bits_qwords + (uint64_t)j * bits_stride;                               \
+    for (int x = 0; x < ROWS; x++) {                                           \
       int rf = 0;                                                              \
       setop_count_db_cpu_kernel(a_rows[x], b_row_f, k_b, k_max, rf, op,        \
                                 SIMD_DIR, LOAD_MACRO);                         \
-      counts[(uint64_t)(i + x) * n + j] += rf;                                 \
+      tile_out[(size_t)(i + x - i_b) * tile_ld + (j - j_b)] += rf;             \
     }                                                                          \
   }                                                                            \
   }                                                                            \
   /* I-FRINGE: Resolve the remaining rows using 1x1 kernel */                  \
   for (; i < i_max; i++) {                                                     \
     const uint64_t *restrict a_row_f =                                         \
-        bit_qwords + (uint64_t)i * bit_size_in_qwords;                         \
+        bit_qwords + (uint64_t)i * bit_stride;                                 \
     for (int j_f = j_b; j_f < j_max; j_f++) {                                  \
       const uint64_t *restrict b_row_f =                                       \
-          bits_qwords + (uint64_t)j_f * bit_size_in_qwords;                    \
+          bits_qwords + (uint64_t)j_f * bits_stride;                           \
       int rff = 0;                                                             \
       setop_count_db_cpu_kernel(a_row_f, b_row_f, k_b, k_max, rff, op,         \
                                 SIMD_DIR, LOAD_MACRO);                         \
-      counts[(uint64_t)i * n + j_f] += rff;                                    \
+      tile_out[(size_t)(i - i_b) * tile_ld + (j_f - j_b)] += rff;              \
     }                                                                          \
   }                                                                            \
   }                                                                            \
+  if (stream_tiles) {                                                          \
+    for (int i = i_b; i < i_max; i++)                                          \
+      bit_stream_ints(counts + (uint64_t)i * n + j_b,                          \
+                      tile_out + (size_t)(i - i_b) * tile_ld, j_max - j_b);    \
+    STREAM_FENCE();                                                            \
+    if (tile_out != tile_stack)                                                \
+      free(tile_out);                                                          \
+  }                                                                            \
+  bit_stop_tile_done(tile_stop, i_b, i_max, j_b, j_max);                       \
   }                                                                            \
   }
 
-#endif
 
-/* Top-level DB CPU set-operation dispatch (architecture and alignment aware) */
-#define setop_count_db_cpu(bit, bits, counts, op, opts)                        \
+/* Top-level DB CPU set-operation dispatch (architecture and alignment aware)
+   for one register block shape; tuning supplies the cache tile sizes */
+#define setop_count_db_cpu(bit, bits, counts, op, opts, tuning, ROWS, COLS,    \
+                           VEC_BLK)                                            \
   SETOP_DB_CHECKS(bit, bits)                                                   \
   SETOP_VAR_INIT(bit, bits, bit_qwords, bits_qwords, bit_size_in_qwords,       \
                  num_targets, n)                                               \
                                                                                \
-  bool aligned = ALIGN_CHECK(bit_qwords) && ALIGN_CHECK(bits_qwords);          \
+  /* every row, not just the first, must be aligned for aligned loads */       \
+  bool aligned = ALIGN_CHECK(bit_qwords) && ALIGN_CHECK(bits_qwords) &&        \
+                 ALIGN_CHECK(bit_qwords + bit_stride) &&                       \
+                 ALIGN_CHECK(bits_qwords + bits_stride);                       \
+  /* tasks of the caller's team, or a team of numthreads threads */          \
+  const bool tasks = bit_exec_tasks(opts);                                     \
   int numthreads = opts.num_cpu_threads;                                       \
-  if (numthreads <= 0) {                                                       \
+  if (tasks) {                                                                 \
+    numthreads = omp_get_num_threads();                                        \
+  } else if (numthreads <= 0) {                                                \
     numthreads = omp_get_max_threads();                                        \
   }                                                                            \
-  omp_set_num_threads(numthreads);                                             \
+  /* first touch placed the rows of bit in a static partition of the tiles */ \
+  omp_sched_t saved_sched;                                                     \
+  int saved_chunk;                                                             \
+  omp_get_schedule(&saved_sched, &saved_chunk);                                \
+  bool first_touch = bit->numa_policy == BIT_NUMA_FIRST_TOUCH;                 \
+  omp_set_schedule(first_touch ? omp_sched_static : omp_sched_dynamic, 0);     \
+  const int tile_bit = (tuning).tile;                                          \
+  int tile_bits = (tuning).tile;                                               \
+  /* fewer tiles than threads: narrow the target tiles, down to COLS rows */   \
+  while (tile_bits > COLS &&                                                   \
+         (size_t)((num_targets + tile_bit - 1) / tile_bit) *                   \
+                 (size_t)((n + tile_bits - 1) / tile_bits) <                   \
+             (size_t)numthreads) {                                             \
+    tile_bits /= 2;                                                            \
+  }                                                                            \
+  bit_stop *tile_stop =                                                        \
+      bit_stop_take(tile_bit, (int)((n + tile_bits - 1) / tile_bits));         \
+  const size_t k_block = (size_t)(tuning).k_block;                             \
+  const int prefetch_lines = (tuning).prefetch;                                \
+  const bool stream_tiles = bit_store_streams(opts, (size_t)num_targets * n);  \
+  BIT_PROFILE_PATH(db_loads[!ARCH_32BIT && aligned && !tasks]);                \
                                                                                \
-  if (ARCH_32BIT) {                                                            \
-    OMP_CPU_TILE_START_OUTER                                                   \
-    OMP_CPU_TILE_END_OUTER(op,                                                 \
+  if (tasks) {                                                                 \
+    /* the unaligned loads read any rows; one more copy of the tile loop */    \
+    OMP_CPU_TILE_START_OUTER(ROWS, COLS, OMP_CPU_TASKLOOP(2))                  \
+    OMP_CPU_TILE_END_OUTER(ROWS, COLS, VEC_BLK, op,                            \
+                           OMP_CPU_SIMD_ALIGN_BUFFER(ALIGNMENT, setop_buffer), \
+                           VECTOR_UNALIGNED_LOAD)                              \
+  } else if (ARCH_32BIT) {                                                     \
+    OMP_CPU_TILE_START_OUTER(ROWS, COLS,                                       \
+                             OMP_CPU_LOOP_TEAM(2, runtime, numthreads))        \
+    OMP_CPU_TILE_END_OUTER(ROWS, COLS, VEC_BLK, op,                            \
                            OMP_CPU_SIMD_ALIGN_BUFFER(ALIGNMENT, setop_buffer), \
                            VECTOR_UNALIGNED_LOAD)                              \
   } else {                                                                     \
     if (aligned) {                                                             \
-      OMP_CPU_TILE_START_OUTER                                                 \
-      OMP_CPU_TILE_END_OUTER(                                                  \
+      OMP_CPU_TILE_START_OUTER(ROWS, COLS,                                     \
+                               OMP_CPU_LOOP_TEAM(2, runtime, numthreads))      \
+      OMP_CPU_TILE_END_OUTER(ROWS, COLS, VEC_BLK,                              \
           op, OMP_CPU_SIMD_ALIGN_BUFFER(ALIGNMENT, setop_buffer),              \
           VECTOR_ALIGNED_LOAD)                                                 \
     } else {                                                                   \
-      OMP_CPU_TILE_START_OUTER                                                 \
-      OMP_CPU_TILE_END_OUTER(                                                  \
+      OMP_CPU_TILE_START_OUTER(ROWS, COLS,                                     \
+                               OMP_CPU_LOOP_TEAM(2, runtime, numthreads))      \
+      OMP_CPU_TILE_END_OUTER(ROWS, COLS, VEC_BLK,                              \
           op, OMP_CPU_SIMD_ALIGN_BUFFER(ALIGNMENT, setop_buffer),              \
           VECTOR_UNALIGNED_LOAD)                                               \
     }                                                                          \
-  }
+  }                                                                            \
+  omp_set_schedule(saved_sched, saved_chunk);
 
 /* --- End Section 4: DB SET OPERATION MACROS — CPU --- */
 
@@ -756,35 +2085,74 @@ static inline uint64_t tree_adder(uint64_t v) {
  */
 #ifndef NOGPU
 
-/* Ensure both operands and counts are present on the target device */
-#define SETOP_INIT_GPU(bit, bits, counts, opts)                                \
+/* A host copy was just written to the device: its layout is row-major again,
+   whatever the layout registry remembered from an earlier kernel */
+#define GPU_LAYOUT_UPLOADED(buffer, dev_id)                                    \
+  do {                                                                         \
+    GPUAllocationState *_node = registry_claim_transition((buffer), (dev_id)); \
+    registry_commit_transition(_node, MAKE_STATE(LAYOUT_ROW_MAJOR, FLAG_NONE));\
+    release_gpu_layout((buffer), (dev_id));                                    \
+  } while (0)
+
+/* Checks a buffer of rows x stride words out in the layout the registry
+   recorded for it, and stores that layout in the uint32_t lvalue layout.
+   Only the ZCURVE_TILED and BIT_SLICED kernels read Z-curve tiles and
+   bit-sliced groups, and no kernel reads narrowed words, so a buffer left
+   in any of these is turned back row-major for every other reader */
+#define GPU_CHECKOUT_READABLE(layout, buffer, rows, stride, dev_id)            \
+  do {                                                                         \
+    layout = registry_checkout_layout((buffer), (dev_id)) & MASK_WORD_LAYOUT;  \
+    if (layout != LAYOUT_ROW_MAJOR && layout != LAYOUT_COL_MAJOR) {            \
+      release_gpu_layout((buffer), (dev_id));                                  \
+      ENSURE_GPU_LAYOUT((buffer), (rows), (stride), LAYOUT_ROW_MAJOR,          \
+                        (dev_id), NULL, 0);                                    \
+      layout = LAYOUT_ROW_MAJOR;                                               \
+    }                                                                          \
+  } while (0)
+
+/* Ensure both operands and counts are present on the target device; an
+   operand attached there (BitDB_device_attach) pushes only its dirty rows.
+   All three are pinned first, so that mapping one cannot evict another */
+#define SETOP_INIT_GPU(bit, bits, counts, count_t, opts)                       \
   const int _setop_dev_id = (opts).device_id;                                  \
   const int _setop_upd_1st = (opts).upd_1st_operand;                           \
   const int _setop_upd_2nd = (opts).upd_2nd_operand;                           \
   uint64_t *_setop_bit_qwords = (bit)->qwords;                                 \
   uint64_t *_setop_bits_qwords = (bits)->qwords;                               \
-  int *_setop_counts = (counts);                                               \
-  const size_t _setop_bit_span = (size_t)(bit)->size_in_qwords * (bit)->nelem; \
+  count_t *_setop_counts = (counts);                                           \
+  registry_pin(_setop_bit_qwords, _setop_dev_id);                              \
+  registry_pin(_setop_bits_qwords, _setop_dev_id);                             \
+  registry_pin(_setop_counts, _setop_dev_id);                                  \
+  const size_t _setop_bit_span =                                               \
+      (size_t)(bit)->stride_in_qwords * (bit)->nelem;                          \
   const size_t _setop_bits_span =                                              \
-      (size_t)(bits)->size_in_qwords * (bits)->nelem;                          \
+      (size_t)(bits)->stride_in_qwords * (bits)->nelem;                        \
   const size_t _setop_counts_span = (size_t)(bit)->nelem * (bits)->nelem;      \
-  if (omp_target_is_present(_setop_bit_qwords, _setop_dev_id)) {               \
+  if (DB_ATTACHED(bit, _setop_dev_id)) {                                       \
+    BitDB_device_sync(bit);                                                    \
+  } else if (omp_target_is_present(_setop_bit_qwords, _setop_dev_id)) {        \
     if (_setop_upd_1st) {                                                      \
       UPDATE_GPU_ARRAY(to, _setop_bit_qwords, 0, _setop_bit_span,              \
                        _setop_dev_id)                                          \
+      GPU_LAYOUT_UPLOADED(_setop_bit_qwords, _setop_dev_id);                   \
     }                                                                          \
   } else {                                                                     \
     TARGET_GPU_ARRAY(enter, to, _setop_bit_qwords, 0, _setop_bit_span,         \
                      _setop_dev_id)                                            \
+    GPU_LAYOUT_UPLOADED(_setop_bit_qwords, _setop_dev_id);                     \
   }                                                                            \
-  if (omp_target_is_present(_setop_bits_qwords, _setop_dev_id)) {              \
+  if (DB_ATTACHED(bits, _setop_dev_id)) {                                      \
+    BitDB_device_sync(bits);                                                   \
+  } else if (omp_target_is_present(_setop_bits_qwords, _setop_dev_id)) {       \
     if (_setop_upd_2nd) {                                                      \
       UPDATE_GPU_ARRAY(to, _setop_bits_qwords, 0, _setop_bits_span,            \
                        _setop_dev_id)                                          \
+      GPU_LAYOUT_UPLOADED(_setop_bits_qwords, _setop_dev_id);                  \
     }                                                                          \
   } else {                                                                     \
     TARGET_GPU_ARRAY(enter, to, _setop_bits_qwords, 0, _setop_bits_span,       \
                      _setop_dev_id)                                            \
+    GPU_LAYOUT_UPLOADED(_setop_bits_qwords, _setop_dev_id);                    \
   }                                                                            \
   if (!omp_target_is_present(_setop_counts, _setop_dev_id)) {                  \
     TARGET_GPU_ARRAY(enter, to, _setop_counts, 0, _setop_counts_span,          \
@@ -806,49 +2174,788 @@ static inline uint64_t tree_adder(uint64_t v) {
 /* Workshare loop division without an implicit barrier */
 #define OMP_GPU_FOR_NOWAIT _Pragma(STRINGIFY(omp for nowait))
 
-/* Release or delete a device array after use */
+/* Release or delete a device array after use; the layout record of an
+   array that left the device goes with it */
 #define SETOP_FINALIZE_GPU(action, buffer, index1, index2, dev_id)             \
   if (omp_target_is_present(buffer, dev_id)) {                                 \
     _Pragma(STRINGIFY(omp target exit data map(                                \
         action : buffer [index1:index2]) device(dev_id)))                      \
+    if (!omp_target_is_present(buffer, dev_id))                                \
+      registry_forget(buffer, dev_id);                                         \
   }
 
-/* Full GPU DB set-operation kernel (team-parallel, SIMD inner loop) */
-#define setop_count_db_gpu(bit, bits, counts, op, opts)                        \
-  SETOP_DB_CHECKS(bit, bits)                                                   \
-  SETOP_VAR_INIT(bit, bits, bit_qwords, bits_qwords, bit_size_in_qwords,       \
-                 num_targets, n)                                               \
-  SETOP_INIT_GPU(bit, bits, counts, opts)                                      \
-  OMP_GPU_TEAMS(num_targets, opts.device_id)                                   \
-  for (int k = 0; k < num_targets; k++) {                                      \
-    uint64_t shift_k = k * bit_size_in_qwords;                                 \
+/* Threads per team of the SHARED_TILE_ILP kernel; each thread counts GPU_ILP
+   target columns */
+#ifndef GPU_BLOCK_DIM
+#define GPU_BLOCK_DIM 256
+#endif
+
+/* Word width (32 or 64) of the TRANSPOSED_TEAM_PARALLEL_SIMD kernel on
+   devices that Bit_gpu_word_bits_set left alone; make picks it from the
+   target architectures (GPU_WORD_BITS=auto) */
+#ifndef GPU_WORD_BITS
+#define GPU_WORD_BITS 64
+#endif
+
+/* Launch a target region with one team per iteration of `level` loops */
+#define OMP_GPU_TEAMS_LEVEL(level, n_thread_limit, dev_id)                     \
+  _Pragma(STRINGIFY(omp target teams distribute collapse(level)                \
+                        thread_limit(n_thread_limit) device(dev_id)))
+
+/* Barrier between the threads of a team */
+#define OMP_GPU_BARRIER _Pragma(STRINGIFY(omp barrier))
+
+/* Word j of query row k and of target row i. The targets are column-major
+   on a device; the queries are read in the layout the registry recorded */
+#define GPU_QUERY_WORD(k, j) bit_qwords[(uint64_t)(k) * q_row + (j) * q_col]
+#define GPU_TARGET_WORD(i, j) bits_qwords[(uint64_t)(i) * t_row + (j) * t_col]
+
+/* TRANSPOSED_TEAM_PARALLEL_SIMD: one team per query row; consecutive
+   threads read consecutive target columns of the column-major targets */
+#define SETOP_KERNEL_GPU_TRANSPOSED(counts, count_t, op, opts)                 \
+  OMP_GPU_TEAMS(gpu_k_last - gpu_k_first, opts.device_id)                      \
+  for (unsigned int k = gpu_k_first; k < gpu_k_last; k++) {                    \
     OMP_GPU_PARALLEL(n) {                                                      \
       OMP_GPU_FOR_NOWAIT                                                       \
       for (unsigned int i = 0; i < n; i++) {                                   \
-        uint64_t shift_i = i * bit_size_in_qwords;                             \
         int total_sum_for_i = 0;                                               \
         OMP_GPU_SIMD_REDUCTION(+, total_sum_for_i)                             \
         for (unsigned int j = 0; j < bit_size_in_qwords; j++) {                \
-          uint64_t x = bit_qwords[shift_k + j] op bits_qwords[shift_i + j];    \
+          uint64_t x = GPU_QUERY_WORD(k, j) op GPU_TARGET_WORD(i, j);          \
           total_sum_for_i += (uint32_t)POPCOUNT_GPU(x);                        \
         }                                                                      \
-        counts[k * n + i] = total_sum_for_i;                                   \
+        counts[(uint64_t)k * n + i] = (count_t)total_sum_for_i;                \
+      }                                                                        \
+    }                                                                          \
+  }
+
+/* Half h (low half first) of 64-bit word h / 2 of target row i, and of
+   query row k, when the targets were narrowed to column-major 32-bit words
+   (LAYOUT_COL_MAJOR with FLAG_TRANSFORM); queries that share the targets'
+   buffer are narrowed with it */
+#define GPU_TARGET_HALF(i, h)                                                  \
+  ((const uint32_t *)bits_qwords)[(uint64_t)(h) * n + (i)]
+#define GPU_QUERY_HALF(k, h)                                                   \
+  (shared_buffer ? GPU_TARGET_HALF(k, h)                                       \
+                 : (uint32_t)(GPU_QUERY_WORD(k, (h) / 2) >> ((h) % 2 * 32)))
+
+/* TRANSPOSED_TEAM_PARALLEL_SIMD on 32-bit words, for devices whose 64-bit
+   integer ops run at a fraction of the 32-bit rate: the same teams and
+   threads, twice the inner iterations on half-width words */
+#define SETOP_KERNEL_GPU_NARROW(counts, count_t, op, opts)                     \
+  OMP_GPU_TEAMS(gpu_k_last - gpu_k_first, opts.device_id)                      \
+  for (unsigned int k = gpu_k_first; k < gpu_k_last; k++) {                    \
+    OMP_GPU_PARALLEL(n) {                                                      \
+      OMP_GPU_FOR_NOWAIT                                                       \
+      for (unsigned int i = 0; i < n; i++) {                                   \
+        int total_sum_for_i = 0;                                               \
+        OMP_GPU_SIMD_REDUCTION(+, total_sum_for_i)                             \
+        for (unsigned int h = 0; h < 2 * bit_size_in_qwords; h++) {            \
+          uint32_t x = GPU_QUERY_HALF(k, h) op GPU_TARGET_HALF(i, h);          \
+          total_sum_for_i += POPCOUNT32_GPU(x);                                \
+        }                                                                      \
+        counts[(uint64_t)k * n + i] = (count_t)total_sum_for_i;                \
+      }                                                                        \
+    }                                                                          \
+  }
+
+/* SHARED_TILE_ILP: one team per (query row, block of GPU_BLOCK_DIM * GPU_ILP
+   targets). The team stages GPU_TILE_J words of the query row in team-local
+   memory, and each thread keeps GPU_ILP independent sums in flight. A team
+   granted fewer than GPU_BLOCK_DIM threads covers its block in rounds. */
+#define SETOP_KERNEL_GPU_SHARED_TILE(counts, count_t, op, opts)                \
+  const unsigned int cols_per_block = GPU_BLOCK_DIM * GPU_ILP;                 \
+  const unsigned int blocks_per_row =                                          \
+      (n + cols_per_block - 1) / cols_per_block;                               \
+  OMP_GPU_TEAMS_LEVEL(2, GPU_BLOCK_DIM, opts.device_id)                        \
+  for (unsigned int k = gpu_k_first; k < gpu_k_last; k++) {                    \
+    for (unsigned int b = 0; b < blocks_per_row; b++) {                        \
+      const unsigned int i_base = b * cols_per_block;                          \
+      const unsigned int i_end =                                               \
+          i_base + cols_per_block < n ? i_base + cols_per_block : n;           \
+      uint64_t shared_k_tile[GPU_TILE_J];                                      \
+      OMP_GPU_PARALLEL(GPU_BLOCK_DIM) {                                        \
+        const unsigned int tid = omp_get_thread_num();                         \
+        const unsigned int bdim = omp_get_num_threads();                       \
+        const unsigned int rounds =                                            \
+            (cols_per_block + bdim * GPU_ILP - 1) / (bdim * GPU_ILP);          \
+        const bool full = rounds == 1 && i_end == i_base + cols_per_block;     \
+        for (unsigned int r = 0; r < rounds; r++) {                            \
+          int sum[GPU_ILP] = {0};                                              \
+          unsigned int i_idx[GPU_ILP];                                         \
+          for (int u = 0; u < GPU_ILP; u++)                                    \
+            i_idx[u] = i_base + (r * GPU_ILP + u) * bdim + tid;                \
+          for (unsigned int j_tile = 0; j_tile < bit_size_in_qwords;           \
+               j_tile += GPU_TILE_J) {                                         \
+            const unsigned int tile_size =                                     \
+                bit_size_in_qwords - j_tile < GPU_TILE_J                       \
+                    ? bit_size_in_qwords - j_tile                              \
+                    : GPU_TILE_J;                                              \
+            for (unsigned int v = tid; v < tile_size; v += bdim)               \
+              shared_k_tile[v] = GPU_QUERY_WORD(k, j_tile + v);                \
+            OMP_GPU_BARRIER                                                    \
+            if (full) { /* no bounds checks in whole blocks */                 \
+              for (unsigned int j = 0; j < tile_size; j++) {                   \
+                const uint64_t sk = shared_k_tile[j];                          \
+                for (int u = 0; u < GPU_ILP; u++)                              \
+                  sum[u] += (int)POPCOUNT_GPU(                                 \
+                      sk op GPU_TARGET_WORD(i_idx[u], j_tile + j));            \
+              }                                                                \
+            } else {                                                           \
+              for (unsigned int j = 0; j < tile_size; j++) {                   \
+                const uint64_t sk = shared_k_tile[j];                          \
+                for (int u = 0; u < GPU_ILP; u++)                              \
+                  if (i_idx[u] < i_end)                                        \
+                    sum[u] += (int)POPCOUNT_GPU(                               \
+                        sk op GPU_TARGET_WORD(i_idx[u], j_tile + j));          \
+              }                                                                \
+            }                                                                  \
+            OMP_GPU_BARRIER                                                    \
+          }                                                                    \
+          for (int u = 0; u < GPU_ILP; u++)                                    \
+            if (i_idx[u] < i_end)                                              \
+              counts[(uint64_t)k * n + i_idx[u]] = (count_t)sum[u];            \
+        }                                                                      \
+      }                                                                        \
+    }                                                                          \
+  }
+
+/* ZCURVE_TILED: one team per (query row, tile row of the Z-curve targets);
+   thread li of the team counts target li of the tile row across the word
+   tiles of the row. Each tile is one contiguous word-major block, so the
+   threads of a team read consecutive words, and the tiles a team walks lie
+   close together in the buffer. Without a transpose (host fallback) the
+   targets are read row-major through GPU_TARGET_WORD. A container counted
+   against itself reads its queries from the tiles as well */
+#define SETOP_KERNEL_GPU_ZCURVE(counts, count_t, op, opts)                     \
+  const unsigned int tile_rows = (n + ZCURVE_TILE_ROWS - 1) / ZCURVE_TILE_ROWS; \
+  OMP_GPU_TEAMS_LEVEL(2, ZCURVE_TILE_ROWS, opts.device_id)                     \
+  for (unsigned int k = gpu_k_first; k < gpu_k_last; k++) {                    \
+    for (unsigned int bi = 0; bi < tile_rows; bi++) {                          \
+      const unsigned int i0 = bi * ZCURVE_TILE_ROWS;                           \
+      const unsigned int h =                                                   \
+          n - i0 < ZCURVE_TILE_ROWS ? n - i0 : ZCURVE_TILE_ROWS;               \
+      OMP_GPU_PARALLEL(ZCURVE_TILE_ROWS) {                                     \
+        const unsigned int tid = omp_get_thread_num();                         \
+        const unsigned int bdim = omp_get_num_threads();                       \
+        for (unsigned int li = tid; li < h; li += bdim) {                      \
+          int sum = 0;                                                         \
+          for (unsigned int j0 = 0; j0 < bit_size_in_qwords;                   \
+               j0 += ZCURVE_TILE_WORDS) {                                      \
+            const unsigned int w = bit_size_in_qwords - j0 < ZCURVE_TILE_WORDS \
+                                       ? bit_size_in_qwords - j0               \
+                                       : ZCURVE_TILE_WORDS;                    \
+            const uint64_t *tile =                                             \
+                transposed ? bits_qwords +                                     \
+                                 zcurve_tile_offset(bi, j0 / ZCURVE_TILE_WORDS, \
+                                                    n, bits_stride) +          \
+                                 li                                            \
+                           : &GPU_TARGET_WORD(i0 + li, j0);                    \
+            const size_t step = transposed ? h : 1;                            \
+            for (unsigned int lj = 0; lj < w; lj++) {                          \
+              const uint64_t q =                                               \
+                  queries_tiled                                                \
+                      ? bits_qwords[zcurve_word_index(k, j0 + lj, n,           \
+                                                      bits_stride)]            \
+                      : GPU_QUERY_WORD(k, j0 + lj);                            \
+              sum += (int)POPCOUNT_GPU(q op tile[lj * step]);                  \
+            }                                                                  \
+          }                                                                    \
+          counts[(uint64_t)k * n + i0 + li] = (count_t)sum;                    \
+        }                                                                      \
       }                                                                        \
     }                                                                          \
+  }
+
+/* BIT_SLICED: one team per (query row, group of BIT_SLICE_ROWS bit-sliced
+   targets); thread l of the team counts target l of the group. The query
+   word is the same for the whole team and the group's word j of its h
+   targets is one run of h words, so consecutive threads read consecutive
+   words. Without a transpose (host fallback) the targets are read row-major
+   through GPU_TARGET_WORD. A container counted against itself reads its
+   queries from the slices as well */
+#define SETOP_KERNEL_GPU_SLICED(counts, count_t, op, opts)                     \
+  const unsigned int groups = (n + BIT_SLICE_ROWS - 1) / BIT_SLICE_ROWS;       \
+  OMP_GPU_TEAMS_LEVEL(2, BIT_SLICE_ROWS, opts.device_id)                       \
+  for (unsigned int k = gpu_k_first; k < gpu_k_last; k++) {                    \
+    for (unsigned int g = 0; g < groups; g++) {                                \
+      const unsigned int i0 = g * BIT_SLICE_ROWS;                              \
+      const unsigned int h =                                                   \
+          n - i0 < BIT_SLICE_ROWS ? n - i0 : BIT_SLICE_ROWS;                   \
+      OMP_GPU_PARALLEL(BIT_SLICE_ROWS) {                                       \
+        const unsigned int tid = omp_get_thread_num();                         \
+        const unsigned int bdim = omp_get_num_threads();                       \
+        for (unsigned int l = tid; l < h; l += bdim) {                         \
+          const uint64_t *group =                                              \
+              transposed ? bits_qwords + (uint64_t)i0 * bits_stride + l        \
+                         : &GPU_TARGET_WORD(i0 + l, 0);                        \
+          const size_t step = transposed ? h : 1;                              \
+          int sum = 0;                                                         \
+          for (unsigned int j = 0; j < bit_size_in_qwords; j++) {             \
+            const uint64_t q =                                                 \
+                queries_tiled                                                  \
+                    ? bits_qwords[sliced_word_index(k, j, n, bits_stride)]     \
+                    : GPU_QUERY_WORD(k, j);                                    \
+            sum += (int)POPCOUNT_GPU(q op group[j * step]);                    \
+          }                                                                    \
+          counts[(uint64_t)k * n + i0 + l] = (count_t)sum;                     \
+        }                                                                      \
+      }                                                                        \
+    }                                                                          \
+  }
+
+/* Word ranges of the K_SPLIT kernel, at least */
+#ifndef GPU_KSPLIT_PARTS
+#define GPU_KSPLIT_PARTS 32
+#endif
+
+/* Teams K_SPLIT aims to fill the device with, and the fewest words of a
+   range that a team, rather than a thread, counts */
+#ifndef GPU_KSPLIT_TEAMS
+#define GPU_KSPLIT_TEAMS 4096
+#endif
+#ifndef GPU_KSPLIT_MIN_WORDS
+#define GPU_KSPLIT_MIN_WORDS 1024
+#endif
+
+/* Launches of the default algorithm that go to K_SPLIT instead: fewer
+   pairs than GPU_KSPLIT_AUTO_PAIRS, of rows of GPU_KSPLIT_AUTO_WORDS words
+   or more */
+#ifndef GPU_KSPLIT_AUTO_PAIRS
+#define GPU_KSPLIT_AUTO_PAIRS 4096
+#endif
+#ifndef GPU_KSPLIT_AUTO_WORDS
+#define GPU_KSPLIT_AUTO_WORDS 16384
+#endif
+
+/* Word ranges of a K_SPLIT launch of pairs pairs of rows of words words:
+   GPU_KSPLIT_PARTS, or more if it takes more (range, pair) items to reach
+   GPU_KSPLIT_TEAMS while the ranges keep GPU_KSPLIT_MIN_WORDS words; never
+   more ranges than words */
+static inline unsigned int gpu_ksplit_parts(uint64_t pairs,
+                                            unsigned int words) {
+  uint64_t parts = pairs ? (GPU_KSPLIT_TEAMS + pairs - 1) / pairs : 1;
+  const uint64_t most = words / GPU_KSPLIT_MIN_WORDS;
+  if (parts > most)
+    parts = most;
+  if (parts < GPU_KSPLIT_PARTS)
+    parts = GPU_KSPLIT_PARTS;
+  if (parts > words)
+    parts = words ? words : 1;
+  return (unsigned int)parts;
+}
+
+/* K_SPLIT: for few long rows, where one team per query row would leave
+   most of the device idle. The words are cut into word ranges (see
+   gpu_ksplit_parts) and every (range, query row, target) is a work item of
+   its own, which writes its partial count to a device buffer of ranges x
+   rows x targets; a second pass adds the ranges of every count up and
+   narrows it to count_t. The sums are hierarchical once the ranges are
+   long: the threads of a team reduce the words of an item, and a team per
+   count reduces its many ranges; short ones take a thread per item and
+   per count. The two passes need no atomics, so the narrow count types
+   take the kernel as they are */
+#define SETOP_KERNEL_GPU_KSPLIT(counts, count_t, op, opts)                     \
+  const uint64_t ks_span = (uint64_t)(gpu_k_last - gpu_k_first) * n;           \
+  const unsigned int ks_parts =                                                \
+      gpu_ksplit_parts(ks_span, bit_size_in_qwords);                           \
+  const unsigned int ks_words =                                                \
+      (bit_size_in_qwords + ks_parts - 1) / ks_parts;                          \
+  int *ks_partial = omp_target_alloc(                                          \
+      (ks_span ? ks_span : 1) * ks_parts * sizeof(int), opts.device_id);       \
+  assert(ks_partial != NULL);                                                  \
+  if (ks_words >= GPU_KSPLIT_MIN_WORDS) {                                      \
+    _Pragma(STRINGIFY(omp target teams distribute collapse(3)                  \
+                          device(opts.device_id) is_device_ptr(ks_partial)))   \
+    for (unsigned int p = 0; p < ks_parts; p++) {                              \
+      for (unsigned int k = gpu_k_first; k < gpu_k_last; k++) {                \
+        for (unsigned int i = 0; i < n; i++) {                                 \
+          const unsigned int j0 = p * ks_words;                                \
+          const unsigned int j1 = j0 + ks_words < bit_size_in_qwords           \
+                                      ? j0 + ks_words                          \
+                                      : bit_size_in_qwords;                    \
+          int sum = 0;                                                         \
+          _Pragma("omp parallel for reduction(+ : sum)")                       \
+          for (unsigned int j = j0; j < j1; j++)                               \
+            sum += (int)POPCOUNT_GPU(GPU_QUERY_WORD(k, j) op                   \
+                                     GPU_TARGET_WORD(i, j));                   \
+          ks_partial[(uint64_t)p * ks_span +                                   \
+                     (uint64_t)(k - gpu_k_first) * n + i] = sum;               \
+        }                                                                      \
+      }                                                                        \
+    }                                                                          \
+  } else {                                                                     \
+    _Pragma(STRINGIFY(omp target teams distribute parallel for collapse(3)     \
+                          device(opts.device_id) is_device_ptr(ks_partial)))   \
+    for (unsigned int p = 0; p < ks_parts; p++) {                              \
+      for (unsigned int k = gpu_k_first; k < gpu_k_last; k++) {                \
+        for (unsigned int i = 0; i < n; i++) {                                 \
+          const unsigned int j0 = p * ks_words;                                \
+          const unsigned int j1 = j0 + ks_words < bit_size_in_qwords           \
+                                      ? j0 + ks_words                          \
+                                      : bit_size_in_qwords;                    \
+          int sum = 0;                                                         \
+          for (unsigned int j = j0; j < j1; j++)                               \
+            sum += (int)POPCOUNT_GPU(GPU_QUERY_WORD(k, j) op                   \
+                                     GPU_TARGET_WORD(i, j));                   \
+          ks_partial[(uint64_t)p * ks_span +                                   \
+                     (uint64_t)(k - gpu_k_first) * n + i] = sum;               \
+        }                                                                      \
+      }                                                                        \
+    }                                                                          \
+  }                                                                            \
+  if (ks_parts > GPU_KSPLIT_PARTS) {                                           \
+    _Pragma(STRINGIFY(omp target teams distribute device(opts.device_id)       \
+                          is_device_ptr(ks_partial)))                          \
+    for (uint64_t c = 0; c < ks_span; c++) {                                   \
+      int sum = 0;                                                             \
+      _Pragma("omp parallel for reduction(+ : sum)")                           \
+      for (unsigned int p = 0; p < ks_parts; p++)                              \
+        sum += ks_partial[(uint64_t)p * ks_span + c];                          \
+      counts[(uint64_t)gpu_k_first * n + c] = (count_t)sum;                    \
+    }                                                                          \
+  } else {                                                                     \
+    _Pragma(STRINGIFY(omp target teams distribute parallel for                 \
+                          device(opts.device_id) is_device_ptr(ks_partial)))   \
+    for (uint64_t c = 0; c < ks_span; c++) {                                   \
+      int sum = 0;                                                             \
+      for (unsigned int p = 0; p < ks_parts; p++)                              \
+        sum += ks_partial[(uint64_t)p * ks_span + c];                          \
+      counts[(uint64_t)gpu_k_first * n + c] = (count_t)sum;                    \
+    }                                                                          \
   }                                                                            \
+  omp_target_free(ks_partial, opts.device_id);
+
+/* Full GPU DB set-operation kernel, as selected by opts.algorithm. The
+   first two algorithms and K_SPLIT read the targets column-major, ZCURVE_TILED reads
+   them in Z-curve tiles and BIT_SLICED in bit-sliced groups, so the device
+   copy of bits is turned into that layout in place (once; the layout
+   registry remembers it). The queries
+   are read in whichever layout the registry recorded for them, so a
+   container that alternates between the two roles is not transposed back
+   and forth. When the target region falls back to the host, or under
+   unified shared memory, the "device copy" is the host data, which is then
+   read row-major as it is. A launch of the default algorithm over few
+   pairs of long rows runs K_SPLIT, which reads the same layouts (see
+   GPU_KSPLIT_AUTO_PAIRS). The counts are stored as count_t (int, or a
+   narrower type, see BitDB_count_store_typed_gpu) */
+#define setop_count_db_gpu(bit, bits, counts, count_t, op, opts)               \
+  SETOP_DB_CHECKS(bit, bits)                                                   \
+  BIT_TRACE_CALL();                                                            \
+  SETOP_VAR_INIT(bit, bits, bit_qwords, bits_qwords, bit_size_in_qwords,       \
+                 num_targets, n)                                               \
+  SETOP_INIT_GPU(bit, bits, counts, count_t, opts)                             \
+  const bool transposed = GPU_TRANSPOSED(opts.device_id);                     \
+  const bool shared_buffer = bit_qwords == bits_qwords;                        \
+  const bool zcurve = opts.algorithm == ZCURVE_TILED;                          \
+  const bool sliced = opts.algorithm == BIT_SLICED;                            \
+  const bool narrow = (opts.algorithm == TRANSPOSED_TEAM_PARALLEL_SIMD ||     \
+                       opts.algorithm == NATIVE_COARSENED) &&                  \
+                      gpu_device_word_bits(opts.device_id) == 32;              \
+  if (transposed)                                                              \
+    ENSURE_GPU_LAYOUT(bits_qwords, n, bits_stride,                             \
+                      zcurve   ? LAYOUT_Z_CURVE                                \
+                      : sliced ? LAYOUT_BIT_SLICED                             \
+                      : narrow ? MAKE_STATE(LAYOUT_COL_MAJOR, FLAG_TRANSFORM)  \
+                               : LAYOUT_COL_MAJOR,                             \
+                      opts.device_id, NULL, 0);                                \
+  uint32_t bit_layout = LAYOUT_ROW_MAJOR;                                      \
+  if (transposed && !shared_buffer)                                            \
+    GPU_CHECKOUT_READABLE(bit_layout, bit_qwords, num_targets, bit_stride,     \
+                          opts.device_id);                                     \
+  const bool queries_tiled = transposed && shared_buffer && (zcurve || sliced); \
+  const bool queries_transposed =                                              \
+      transposed && (shared_buffer ? !(zcurve || sliced)                       \
+                                   : bit_layout == LAYOUT_COL_MAJOR);          \
+  const uint64_t t_row = transposed ? 1 : bits_stride;                         \
+  const uint64_t t_col = transposed ? n : 1;                                   \
+  const uint64_t q_row = queries_transposed ? 1 : bit_stride;                  \
+  const uint64_t q_col =                                                       \
+      queries_transposed ? (shared_buffer ? n : num_targets) : 1;              \
+  const uint64_t _kernel_start = gpu_stat_clock();                             \
+  /* one launch over every query, or launches of BIT_STOP_GPU_ROWS queries */  \
+  /* with a stop looked at before each and the hooks run after each */         \
+  bit_stop gpu_stop;                                                           \
+  bit_stop_begin(&gpu_stop, opts, (int)num_targets,                            \
+                 (size_t)bit_size_in_qwords * sizeof(uint64_t));               \
+  const unsigned int gpu_k_step =                                              \
+      bit_stop_active(opts) ? BIT_STOP_GPU_ROWS : num_targets;                 \
+  gpu_stop.tiles_total =                                                       \
+      gpu_k_step ? (num_targets + gpu_k_step - 1) / gpu_k_step : 0;            \
+  unsigned int gpu_k_first = 0;                                                \
+  while (gpu_k_first < num_targets && !bit_stop_poll(&gpu_stop)) {             \
+    const unsigned int gpu_k_last = num_targets - gpu_k_first > gpu_k_step     \
+                                        ? gpu_k_first + gpu_k_step             \
+                                        : num_targets;                         \
+    if (opts.algorithm == SHARED_TILE_ILP) {                                   \
+      SETOP_KERNEL_GPU_SHARED_TILE(counts, count_t, op, opts)                  \
+    } else if (zcurve) {                                                       \
+      SETOP_KERNEL_GPU_ZCURVE(counts, count_t, op, opts)                       \
+    } else if (sliced) {                                                       \
+      SETOP_KERNEL_GPU_SLICED(counts, count_t, op, opts)                       \
+    } else if (opts.algorithm == K_SPLIT ||                                    \
+               (opts.algorithm == TRANSPOSED_TEAM_PARALLEL_SIMD && !narrow &&  \
+                (uint64_t)(gpu_k_last - gpu_k_first) * n <                     \
+                    GPU_KSPLIT_AUTO_PAIRS &&                                   \
+                bit_size_in_qwords >= GPU_KSPLIT_AUTO_WORDS)) {                \
+      SETOP_KERNEL_GPU_KSPLIT(counts, count_t, op, opts)                       \
+    } else if (transposed && narrow) {                                         \
+      SETOP_KERNEL_GPU_NARROW(counts, count_t, op, opts)                       \
+    } else {                                                                   \
+      SETOP_KERNEL_GPU_TRANSPOSED(counts, count_t, op, opts)                   \
+    }                                                                          \
+    if (gpu_stop.on_tile != NULL) {                                            \
+      const uint64_t gpu_tile_first = (uint64_t)gpu_k_first * n;               \
+      const uint64_t gpu_tile_span =                                           \
+          (uint64_t)(gpu_k_last - gpu_k_first) * n;                            \
+      const uint64_t gpu_tile_start = gpu_stat_clock();                        \
+      _Pragma(STRINGIFY(omp target update from(                                \
+          counts [gpu_tile_first:gpu_tile_span]) device(opts.device_id)))      \
+      GPU_STAT_COPY(from, counts, gpu_tile_span, gpu_tile_start);              \
+    }                                                                          \
+    if (gpu_stop.on_tile != NULL || gpu_stop.on_progress != NULL)              \
+      bit_stop_notify(&gpu_stop, (int)gpu_k_first,                             \
+                      (int)(gpu_k_last - gpu_k_first), 0, (int)n);             \
+    gpu_k_first = gpu_k_last;                                                  \
+  }                                                                            \
+  bit_stop_report(opts.progress, (int)num_targets, (int)gpu_k_first);          \
+  GPU_STAT_TIME(kernel_ns, _kernel_start);                                     \
+  if (transposed && !shared_buffer)                                            \
+    release_gpu_layout(bit_qwords, opts.device_id);                            \
+  if (transposed)                                                              \
+    release_gpu_layout(bits_qwords, opts.device_id);                           \
+  const uint64_t _copy_start = gpu_stat_clock();                               \
   _Pragma(STRINGIFY(omp target exit data map(                                  \
-      from : counts [0:num_targets * n]))) if (opts.release_1st_operand) {     \
-    SETOP_FINALIZE_GPU(release, bit->qwords, 0,                                \
-                       bit_size_in_qwords * num_targets, opts.device_id)       \
+      from : counts [0:_setop_counts_span])))                                  \
+  GPU_STAT_COPY(from, counts, _setop_counts_span, _copy_start);                \
+  registry_unpin(_setop_bit_qwords, _setop_dev_id);                            \
+  registry_unpin(_setop_bits_qwords, _setop_dev_id);                           \
+  registry_unpin(_setop_counts, _setop_dev_id);                                \
+  if (opts.release_1st_operand) {                                              \
+    SETOP_FINALIZE_GPU(release, bit->qwords, 0, _setop_bit_span,               \
+                       opts.device_id)                                         \
   }                                                                            \
   if (opts.release_2nd_operand) {                                              \
-    SETOP_FINALIZE_GPU(release, bits->qwords, 0, bit_size_in_qwords * n,       \
+    SETOP_FINALIZE_GPU(release, bits->qwords, 0, _setop_bits_span,             \
                        opts.device_id)                                         \
   }                                                                            \
   if (opts.release_counts) {                                                   \
-    SETOP_FINALIZE_GPU(release, counts, 0, num_targets * n, opts.device_id)    \
+    SETOP_FINALIZE_GPU(release, counts, 0, _setop_counts_span, opts.device_id) \
   }
 
 #endif /* NOGPU */
 
 /* --- End Section 5: DB SET OPERATION MACROS — GPU --- */
+
+/* ===========================================================================
+   SECTION 6: RUNTIME KERNEL DISPATCH
+   Every ISA variant of src/bit_kernels.c exports one of these tables; bit.c
+   selects the best one supported by the host once, at load time.
+   ===========================================================================
+ */
+
+typedef enum {
+  BIT_OP_AND = 0, // intersection
+  BIT_OP_OR,      // union
+  BIT_OP_XOR,     // symmetric difference
+  BIT_OP_AND_NOT, // difference
+  BIT_OP_COUNT
+} bit_setop_id;
+
+/* ni rows a[] against nj rows b[] over words [k_b, k_max), stored
+   (k_b == 0) or added to counts, ld ints a row */
+typedef void (*bit_count_rows_fn)(const uint64_t *const *a, int ni,
+                                  const uint64_t *const *b, int nj,
+                                  size_t k_b, size_t k_max, int *counts,
+                                  size_t ld);
+
+/* One register block count kernel of scripts/gen_kernels.pl */
+typedef struct {
+  const char *name; // op_RxCxV_load, see Bit_kernel_variant
+  bit_setop_id op;
+  int rows, cols, vec_blk;
+  bool aligned; // aligned vector loads: every row ALIGNMENT-aligned
+  bit_count_rows_fn count_rows;
+} bit_count_variant;
+
+typedef struct {
+  const char *isa; // name of the instruction set the variant was built for
+  const char *simd; // vector path of its kernels: avx512, avx2, 128, scalar
+  const char *(*popcount)(void); // bulk popcount it runs on this host
+  void (*setop[BIT_OP_COUNT])(T set, T s, T t);
+  int (*setop_count[BIT_OP_COUNT])(T s, T t);
+  int (*setop_any[BIT_OP_COUNT])(T s, T t); // 1 iff op(s, t) is non-empty
+  int (*count)(T set);
+  int (*count_qwords)(const uint64_t *qwords, size_t nq);
+  void (*rank_build)(const uint64_t *qwords, unsigned int size_in_qwords,
+                     uint32_t *rank); // rank[b] = popcount before block b
+  int (*expr_count)(const Bit_expr_op *program, int nops, T *operands,
+                    const uint64_t *row, unsigned int size_in_qwords,
+                    unsigned int length);
+  int (*array_inter)(const uint16_t *a, int na, const uint16_t *b, int nb,
+                     uint16_t *out); // sorted arrays, out may be NULL
+  int (*sparse_count)(const uint32_t *pos, int n,
+                      const uint64_t *row); // bits of row at pos
+  // the positions base + i of the set bits i of nq qwords, at most room
+  size_t (*decode_qwords)(const uint64_t *qwords, size_t nq, int base,
+                          int *out, size_t room);
+  void (*packed_count)(bit_setop_id op, int lane_bits, uint64_t q,
+                       const uint64_t *words, size_t nwords,
+                       int *counts); // short rows in lanes, against q
+  float (*weighted_count)(bit_setop_id op, const uint64_t *a,
+                          const uint64_t *b, size_t nwords,
+                          const float *table); // nibble tables of a Bit_W_T
+  void (*threshold_pack)(const int *counts, size_t n, int threshold,
+                         uint64_t *words); // bit i: counts[i] >= threshold
+  void (*bloom_insert)(uint64_t *blocks, uint32_t nblocks, int k,
+                       const uint64_t *keys, int n);
+  int (*bloom_contains)(const uint64_t *blocks, uint32_t nblocks, int k,
+                        const uint64_t *keys, int n,
+                        int *out); // keys that may be present
+  void (*transpose64)(uint64_t block[64]); // 64 x 64 bits, in place
+  void (*shift_qwords)(uint64_t *dst, const uint64_t *src, size_t nq,
+                       long long shift, bool accumulate); // dst may be src
+  uint64_t (*hash_qwords)(const uint64_t *qwords, size_t nq,
+                          uint64_t seed); // the same on every tier
+  void (*setop_count_db[BIT_OP_COUNT])(T_DB bit, T_DB bits, int *counts,
+                                       SETOP_COUNT_OPTS opts);
+  void (*setop_count_query[BIT_OP_COUNT])(T q, T_DB db, int *counts,
+                                          SETOP_COUNT_OPTS opts);
+  // ni rows a[] against nj rows b[] over words [k_b, k_max), stored
+  // (k_b == 0) or added to counts, ld ints a row (Bit_IDB_T)
+  void (*setop_count_rows[BIT_OP_COUNT])(const uint64_t *const *a, int ni,
+                                         const uint64_t *const *b, int nj,
+                                         size_t k_b, size_t k_max,
+                                         int *counts, size_t ld);
+  const bit_count_variant *count_variants; // the generated register blocks
+  int ncount_variants;
+} bit_kernel_table;
+
+/* Kernel table selected for this host (never NULL) */
+extern const bit_kernel_table *bit_kernels_active(void);
+
+/* dst = s op t of Bit_L_T sets, by blocks of the host kernels */
+extern void bit_large_setop_into(T_L dst, T_L s, T_L t, bit_setop_id op);
+
+/* nq rows a[] against nt rows b[] of size qwords into counts (nq x nt),
+   tiled by the tuning of opts, every tile pass counted by count_rows
+   (bit_indirect.c) */
+extern void bit_rows_count_tiled(const uint64_t *const *a, int nq,
+                                 const uint64_t *const *b, int nt,
+                                 size_t size, bit_count_rows_fn count_rows,
+                                 int *counts, SETOP_COUNT_OPTS opts);
+
+/* Tuning a DB count kernel call runs with: opts.tuning, or else the
+   process-wide one */
+extern Bit_tuning bit_tuning_resolve(SETOP_COUNT_OPTS opts);
+
+/* CPU word pairs and bytes per second of the process-wide tuning at the
+   team size of opts, measured on first use (see BitDB_estimate) */
+extern void bit_cpu_calibration(SETOP_COUNT_OPTS opts, double *rate,
+                                double *bandwidth);
+
+/* GPU fields of Bit_get_configuration, filled by bit_gpu.c */
+extern void bit_gpu_configuration(Bit_config *config);
+
+/* Register blocks compiled into every kernel table, in Bit_tuning_block
+   order: X(arg, tag, rows, cols, vector unroll of the K loop). The
+   bit-sliced kernel, BIT_TUNING_BLOCK_SLICED, follows them */
+#define BIT_TUNING_BLOCKS(X, arg)                                              \
+  X(arg, default, OUTER_ROW_NUM, OUTER_COL_NUM, OUTER_VEC_BLK)                 \
+  X(arg, 1x1, 1, 1, 4)                                                         \
+  X(arg, 2x2, 2, 2, 2)                                                         \
+  X(arg, 4x2, 4, 2, 1)                                                         \
+  X(arg, 4x4, 4, 4, 1)
+
+
+/* Rows interleaved word by word in a bit-sliced group, the lanes of the
+   BIT_TUNING_BLOCK_SLICED kernel */
+#ifndef BIT_SLICE_ROWS
+#define BIT_SLICE_ROWS 64
+#endif
+
+/* --- End Section 6: RUNTIME KERNEL DISPATCH --- */
+
+/*
+   ===========================================================================
+   SECTION 7: HOT-PATH PROFILE (make PROFILE=1)
+   With BIT_PROFILE the public entry points count their calls, the ticks
+   spent in them (inclusive of nested entry points) and the bytes of the
+   operands they read and the results they write, and the kernels count
+   the load path and register block they took; Bit_stats_snapshot reads it
+   all back. Without it every macro below expands to nothing.
+   ===========================================================================
+ */
+
+#if defined(BIT_PROFILE) && (BIT_PROFILE)
+#include <stdatomic.h>
+#include <time.h>
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#define BIT_PROFILE_TICKS "cycles"
+#else
+#define BIT_PROFILE_TICKS "ns"
+#endif
+
+/* One profiled function; it links itself into bit_profile_sites on its
+   first call */
+typedef struct bit_profile_site {
+  const char *name;
+  _Atomic uint64_t calls, ticks, bytes;
+  _Atomic bool registered;
+  struct bit_profile_site *next;
+} bit_profile_site;
+
+/* Kernel paths: [0] unaligned, [1] aligned loads */
+typedef struct {
+  _Atomic uint64_t db_loads[2];    // setop_count_db_cpu
+  _Atomic uint64_t setop_loads[2]; // single bitset set ops and counts
+  _Atomic uint64_t blocks[BIT_TUNING_BLOCK_COUNT]; // DB count register block
+} bit_profile_path_counts;
+
+/* bit.c owns both */
+extern bit_profile_site *_Atomic bit_profile_sites;
+extern bit_profile_path_counts bit_profile_paths;
+
+/* Time stamp counter on x86, monotonic nanoseconds elsewhere */
+static inline uint64_t bit_profile_clock(void) {
+#if defined(__x86_64__) || defined(__i386__)
+  return __rdtsc();
+#else
+  struct timespec now;
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  return (uint64_t)now.tv_sec * UINT64_C(1000000000) + (uint64_t)now.tv_nsec;
+#endif
+}
+
+typedef struct {
+  bit_profile_site *site;
+  uint64_t start;
+} bit_profile_scope;
+
+static inline bit_profile_scope bit_profile_enter(bit_profile_site *site,
+                                                  uint64_t bytes) {
+  if (!atomic_load_explicit(&site->registered, memory_order_acquire) &&
+      !atomic_exchange(&site->registered, true)) {
+    site->next = atomic_load(&bit_profile_sites);
+    while (!atomic_compare_exchange_weak(&bit_profile_sites, &site->next,
+                                         site))
+      ;
+  }
+  atomic_fetch_add_explicit(&site->calls, 1, memory_order_relaxed);
+  atomic_fetch_add_explicit(&site->bytes, bytes, memory_order_relaxed);
+  return (bit_profile_scope){site, bit_profile_clock()};
+}
+
+static inline void bit_profile_leave(bit_profile_scope *scope) {
+  atomic_fetch_add_explicit(&scope->site->ticks,
+                            bit_profile_clock() - scope->start,
+                            memory_order_relaxed);
+}
+
+/* Bytes of a bitset, of the rows of one or two containers (bits may be
+   NULL), and of those rows and their count matrix; 0 for what is NULL, so
+   that the checks of the profiled function still catch it */
+static inline uint64_t bit_profile_bytes(T set) {
+  return set ? (uint64_t)set->size_in_qwords * sizeof(uint64_t) : 0;
+}
+static inline uint64_t bit_profile_rows_bytes(T_DB bit, T_DB bits) {
+  uint64_t rows = (bit ? bit->nelem : 0) + (bits ? bits->nelem : 0);
+  return bit ? rows * bit->size_in_qwords * sizeof(uint64_t) : 0;
+}
+static inline uint64_t bit_profile_db_bytes(T_DB bit, T_DB bits) {
+  if (!bit || !bits)
+    return 0;
+  return bit_profile_rows_bytes(bit, bits) +
+         (uint64_t)bit->nelem * bits->nelem * sizeof(int);
+}
+
+/* First statement of a profiled function: counts the call and nbytes, and
+   adds the ticks to the function when it returns */
+#define BIT_PROFILE_CALL(nbytes)                                               \
+  static bit_profile_site _profile_site = {.name = __func__};                  \
+  __attribute__((cleanup(bit_profile_leave))) bit_profile_scope               \
+      _profile_scope = bit_profile_enter(&_profile_site, (uint64_t)(nbytes))
+#define BIT_PROFILE_PATH(counter)                                              \
+  atomic_fetch_add_explicit(&bit_profile_paths.counter, 1,                     \
+                            memory_order_relaxed)
+#else
+#define BIT_PROFILE_CALL(nbytes) ((void)0)
+#define BIT_PROFILE_PATH(counter) ((void)0)
+#endif
+
+/* --- End Section 7: HOT-PATH PROFILE --- */
+
+/* ===========================================================================
+   SECTION 8: OFFLOAD TRACE (make TRACE=1)
+   With BIT_TRACE, bit_gpu.c carries an OMPT tool that the OpenMP runtime
+   starts when BIT_TRACE_FILE names an output: it records the target
+   regions, data operations and kernel submissions of the offload path, and
+   BIT_TRACE_CALL brackets every setop_count_db_gpu with a span of the
+   calling function, so that they nest in a Chrome trace. Without it the
+   macro expands to nothing.
+   ===========================================================================
+ */
+
+#if defined(BIT_TRACE) && (BIT_TRACE)
+typedef struct {
+  const char *name;
+  uint64_t start; // 0 when the tool is not recording
+} bit_trace_scope;
+
+bit_trace_scope bit_trace_enter(const char *name);
+void bit_trace_leave(bit_trace_scope *scope);
+
+#define BIT_TRACE_CALL()                                                       \
+  __attribute__((cleanup(bit_trace_leave))) bit_trace_scope _trace_scope =    \
+      bit_trace_enter(__func__)
+#else
+#define BIT_TRACE_CALL() ((void)0)
+#endif
+
+/* --- End Section 8: OFFLOAD TRACE --- */
+
+/* ===========================================================================
+   SECTION 9: WORKLOAD CAPTURE (Bit_capture_start)
+   BIT_CAPTURE_CALL is a declaration at the top of a recorded function, after
+   the checks of its operands. Outside a capture bit_capture_enter returns at
+   once; during one it fills the record of the call, and bit_capture_leave
+   times it and appends it to the file when the function returns. Calls from
+   inside a recorded call on the same thread are left out.
+   ===========================================================================
+ */
+
+typedef struct {
+  bool active;  // the record goes to the file when the call returns
+  bool counted; // the call is the outermost recorded one of its thread
+  Bit_capture_record record;
+} bit_capture_scope;
+
+extern bit_capture_scope bit_capture_enter(Bit_capture_call call, T_DB bit,
+                                           T_DB bits, int op, int k,
+                                           float cutoff, int counts_type,
+                                           SETOP_COUNT_OPTS opts);
+extern void bit_capture_leave(bit_capture_scope *scope);
+
+#define BIT_CAPTURE_CALL(call, bit, bits, op, k, cutoff, counts_type, opts)    \
+  __attribute__((cleanup(bit_capture_leave))) bit_capture_scope               \
+      _capture_scope = bit_capture_enter((call), (bit), (bits), (int)(op),     \
+                                         (k), (cutoff), (int)(counts_type),    \
+                                         (opts))
+
+/* --- End Section 9: WORKLOAD CAPTURE --- */
+
+/* ===========================================================================
+   SECTION 10: MEMORY ACCOUNTING (Bit_memory_stats)
+   bit_mem_charge adds delta bytes (negative to release) to a host category
+   and raises its high-water mark. Storage is charged where it is allocated
+   and released where it is freed, for the size it was charged with. The
+   device categories are counted by the layout registry and read through
+   bit_mem_devices (src/bit_gpu.c).
+   ===========================================================================
+ */
+
+extern void bit_mem_charge(Bit_mem_category category, int64_t delta);
+extern void bit_mem_devices(Bit_mem_stats *stats, bool reset_peaks);
+
+/* --- End Section 10: MEMORY ACCOUNTING --- */
@@ -0,0 +1,362 @@
+/*
+    Similarity self-joins of Bit_DB_T rows by prefix filtering (see
+    BitDB_similarity_join in include/bit.h), after AllPairs (Bayardo, Ma
+    and Srikant) and PPJoin (Xiao, Wang, Lin and Yu).
+
+    The bits of every row are taken rarest first, by the column counts of
+    the container. Two rows that share at least alpha bits then share one of
+    the first |x| - alpha + 1 bits of each, their prefixes, so only the
+    prefixes go into the inverted lists. A cutoff on the similarity fixes
+    alpha for every pair of popcounts. The rows are probed in parallel, in
+    increasing popcount, against the lists of the rows before them: the
+    rows too short to reach the cutoff are skipped (length filter), and a
+    candidate whose shared bits so far plus the bits left after the current
+    positions cannot reach alpha is dropped (positional filter). The
+    candidates that remain are verified with the intersection count kernel.
+
+    * License : BSD-2
+*/
+
+/* ==========================================================================
+   SECTION 1: INCLUDES
+   Standard library headers first, then project headers.
+   ========================================================================== */
+
+#include "bit.h"
+#include "omp.h"
+#include <assert.h>
+#include <math.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "bit_internal.h"
+
+/* --- End Section 1: INCLUDES --- */
+
+/* ==========================================================================
+   SECTION 2: COMPILE-TIME CONFIGURATION
+   File-local compile-time constants, build-time defaults, and feature flags.
+   ========================================================================== */
+
+/* The filters run at cutoff - JOIN_SLACK, so that rounding in the bounds
+   never drops a pair that the verification would keep */
+#define JOIN_SLACK 1e-6
+
+#define JOIN_PROBE_CHUNK 64 // probe rows a thread takes at a time
+#define JOIN_PAIRS_SLOTS 64 // initial pairs of a thread
+
+/* --- End Section 2: COMPILE-TIME CONFIGURATION --- */
+
+/* ==========================================================================
+   SECTION 5: INTERNAL DATA STRUCTURES AND ENUMS
+   Types used only inside this translation unit.
+   ========================================================================== */
+
+/* A column by its count, for the rarest-first order of the bits */
+typedef struct {
+  uint32_t count;
+  int column;
+} join_column;
+
+/* A row by its popcount, for the probe order */
+typedef struct {
+  int card;
+  int row;
+} join_row;
+
+/* A prefix bit of the row at place p of the probe order, at position pos
+   of its bits */
+typedef struct {
+  uint32_t p, pos;
+} join_posting;
+
+/* A pair of row IDs, lo < hi, and their similarity */
+typedef struct {
+  int lo, hi;
+  float sim;
+} join_pair;
+
+/* The pairs one thread found */
+typedef struct {
+  join_pair *pairs;
+  size_t n, cap;
+} join_pairs;
+
+/* --- End Section 5: INTERNAL DATA STRUCTURES AND ENUMS --- */
+
+/* ==========================================================================
+   SECTION 8: INTERNAL HELPER FUNCTION DEFINITIONS
+   ========================================================================== */
+
+static int join_column_compare(const void *a, const void *b) {
+  const join_column *x = a, *y = b;
+  if (x->count != y->count)
+    return (x->count > y->count) - (x->count < y->count);
+  return (x->column > y->column) - (x->column < y->column);
+}
+
+static int join_row_compare(const void *a, const void *b) {
+  const join_row *x = a, *y = b;
+  if (x->card != y->card)
+    return (x->card > y->card) - (x->card < y->card);
+  return (x->row > y->row) - (x->row < y->row);
+}
+
+static int join_int_compare(const void *a, const void *b) {
+  const int x = *(const int *)a, y = *(const int *)b;
+  return (x > y) - (x < y);
+}
+
+static int join_pair_compare(const void *a, const void *b) {
+  const join_pair *x = a, *y = b;
+  if (x->lo != y->lo)
+    return (x->lo > y->lo) - (x->lo < y->lo);
+  return (x->hi > y->hi) - (x->hi < y->hi);
+}
+
+/* The least popcount of a row that can reach similarity t with a row of
+   popcount a; also the least bits the two then share */
+static double join_min_card(Bit_similarity_metric metric, double t, int a) {
+  switch (metric) {
+  case BIT_SIMILARITY_DICE:
+    return t / (2.0 - t) * a;
+  case BIT_SIMILARITY_COSINE:
+    return t * t * a;
+  default: // BIT_SIMILARITY_TANIMOTO
+    return t * a;
+  }
+}
+
+/* The least bits rows of popcounts a and b share at similarity t */
+static double join_overlap(Bit_similarity_metric metric, double t, int a,
+                           int b) {
+  switch (metric) {
+  case BIT_SIMILARITY_DICE:
+    return t * ((double)a + b) / 2.0;
+  case BIT_SIMILARITY_COSINE:
+    return t * sqrt((double)a * b);
+  default: // BIT_SIMILARITY_TANIMOTO
+    return t / (1.0 + t) * ((double)a + b);
+  }
+}
+
+/* The first n - ceil(alpha) + 1 bits of a row of n bits, at most n */
+static inline int join_prefix(int n, double alpha) {
+  const int need = (int)ceil(alpha);
+  const int prefix = n - (need > 0 ? need : 0) + 1;
+  return prefix < n ? prefix : n;
+}
+
+static void join_pairs_push(join_pairs *out, int x, int y, float sim) {
+  if (out->n == out->cap) {
+    out->cap = out->cap ? 2 * out->cap : JOIN_PAIRS_SLOTS;
+    out->pairs = realloc(out->pairs, out->cap * sizeof(join_pair));
+    assert(out->pairs != NULL);
+  }
+  out->pairs[out->n++] =
+      x < y ? (join_pair){x, y, sim} : (join_pair){y, x, sim};
+}
+
+/* --- End Section 8: INTERNAL HELPER FUNCTION DEFINITIONS --- */
+
+/* ==========================================================================
+   SECTION 9: PUBLIC API
+   ========================================================================== */
+
+size_t BitDB_similarity_join(T_DB set, Bit_similarity sim, float cutoff,
+                             SETOP_COUNT_OPTS opts, size_t *offsets,
+                             int **out_idx, float **out_sim) {
+  assert(set);
+  assert(offsets && out_idx && out_sim);
+  assert(sim.metric == BIT_SIMILARITY_TANIMOTO ||
+         sim.metric == BIT_SIMILARITY_DICE ||
+         sim.metric == BIT_SIMILARITY_COSINE);
+  assert(cutoff > 0.0f && cutoff <= 1.0f);
+  const int n = (int)set->nelem, length = (int)set->length;
+  const size_t nq = set->size_in_qwords, stride = set->stride_in_qwords;
+  const int nthreads = cpu_threads(opts);
+  const double t = (double)cutoff - JOIN_SLACK;
+  const bit_kernel_table *kernels = bit_kernels_active();
+
+  // every column ranked by its count, the rarest first
+  uint32_t *column_counts = malloc((size_t)length * sizeof(uint32_t));
+  join_column *columns = malloc((size_t)length * sizeof(join_column));
+  int *rank = malloc((size_t)length * sizeof(int));
+  assert(column_counts && columns && rank);
+  BitDB_column_counts(set, column_counts, opts);
+  for (int c = 0; c < length; c++)
+    columns[c] = (join_column){column_counts[c], c};
+  qsort(columns, (size_t)length, sizeof(join_column), join_column_compare);
+  for (int c = 0; c < length; c++)
+    rank[columns[c].column] = c;
+  free(columns);
+  free(column_counts);
+
+  // the bits of every row as ranks, in increasing rank
+  int *cards = malloc(((size_t)n + 1) * sizeof(int));
+  size_t *starts = malloc(((size_t)n + 1) * sizeof(size_t));
+  assert(cards && starts);
+#pragma omp parallel for num_threads(nthreads) schedule(static)
+  for (int r = 0; r < n; r++)
+    cards[r] = kernels->count_qwords(set->qwords + (size_t)r * stride, nq);
+  starts[0] = 0;
+  for (int r = 0; r < n; r++)
+    starts[r + 1] = starts[r] + (size_t)cards[r];
+  int *tokens = malloc((starts[n] ? starts[n] : 1) * sizeof(int));
+  assert(tokens != NULL);
+#pragma omp parallel for num_threads(nthreads) schedule(dynamic, 64)
+  for (int r = 0; r < n; r++) {
+    int *row = tokens + starts[r];
+    kernels->decode_qwords(set->qwords + (size_t)r * stride, nq, 0, row,
+                           (size_t)cards[r]);
+    for (int i = 0; i < cards[r]; i++)
+      row[i] = rank[row[i]];
+    qsort(row, (size_t)cards[r], sizeof(int), join_int_compare);
+  }
+  free(rank);
+
+  // the probe order: increasing popcount, ties in row order
+  join_row *order = malloc(((size_t)n + 1) * sizeof(join_row));
+  assert(order != NULL);
+  for (int r = 0; r < n; r++)
+    order[r] = (join_row){cards[r], r};
+  qsort(order, (size_t)n, sizeof(join_row), join_row_compare);
+
+  /* The inverted lists of the index prefixes, in probe order. A row is only
+     probed against rows no longer than itself, so its index prefix is cut
+     for a partner of its own popcount */
+  size_t *lists = calloc((size_t)length + 1, sizeof(size_t));
+  assert(lists != NULL);
+  for (int p = 0; p < n; p++) {
+    const int b = order[p].card;
+    const int prefix = join_prefix(b, join_overlap(sim.metric, t, b, b));
+    const int *row = tokens + starts[order[p].row];
+    for (int i = 0; i < prefix; i++)
+      lists[row[i] + 1]++;
+  }
+  for (int c = 0; c < length; c++)
+    lists[c + 1] += lists[c];
+  join_posting *postings =
+      malloc((lists[length] ? lists[length] : 1) * sizeof(join_posting));
+  size_t *fill = malloc(((size_t)length + 1) * sizeof(size_t));
+  assert(postings && fill);
+  memcpy(fill, lists, ((size_t)length + 1) * sizeof(size_t));
+  for (int p = 0; p < n; p++) {
+    const int b = order[p].card;
+    const int prefix = join_prefix(b, join_overlap(sim.metric, t, b, b));
+    const int *row = tokens + starts[order[p].row];
+    for (int i = 0; i < prefix; i++)
+      postings[fill[row[i]]++] = (join_posting){(uint32_t)p, (uint32_t)i};
+  }
+  free(fill);
+
+  join_pairs *found = calloc((size_t)nthreads, sizeof(join_pairs));
+  assert(found != NULL);
+  const int *ids = set->row_ids;
+#pragma omp parallel num_threads(nthreads)
+  {
+    join_pairs *out = &found[omp_get_thread_num()];
+    // shared bits of every candidate so far, -1 once it is filtered out
+    int *shared = calloc((size_t)n + 1, sizeof(int));
+    uint32_t *touched = malloc(((size_t)n + 1) * sizeof(uint32_t));
+    assert(shared && touched);
+#pragma omp for schedule(dynamic, JOIN_PROBE_CHUNK)
+    for (int p = 0; p < n; p++) {
+      const int a = order[p].card, x = order[p].row;
+      if (a == 0)
+        continue;
+      const int *row = tokens + starts[x];
+      const int least = (int)ceil(join_min_card(sim.metric, t, a));
+      const int prefix =
+          join_prefix(a, join_overlap(sim.metric, t, a, least));
+      size_t ntouched = 0;
+      for (int i = 0; i < prefix; i++) {
+        const join_posting *list = postings + lists[row[i]];
+        const size_t len = lists[row[i] + 1] - lists[row[i]];
+        size_t lo = 0, hi = len;
+        // the rows before p too short to reach the cutoff come first
+        while (lo < hi) {
+          const size_t mid = lo + (hi - lo) / 2;
+          if (order[list[mid].p].card < least)
+            lo = mid + 1;
+          else
+            hi = mid;
+        }
+        for (size_t e = lo; e < len && list[e].p < (uint32_t)p; e++) {
+          const uint32_t q = list[e].p;
+          if (shared[q] < 0)
+            continue;
+          const int b = order[q].card;
+          const int rest_a = a - i - 1, rest_b = b - (int)list[e].pos - 1;
+          const int alpha = (int)ceil(join_overlap(sim.metric, t, a, b));
+          if (shared[q] == 0)
+            touched[ntouched++] = q;
+          if (shared[q] + 1 + (rest_a < rest_b ? rest_a : rest_b) >= alpha)
+            shared[q]++;
+          else
+            shared[q] = -1;
+        }
+      }
+      // the candidates left, counted in full
+      struct T xs = {.length = (unsigned int)(nq * BPQW),
+                     .size_in_bytes = (unsigned int)(nq * sizeof(uint64_t)),
+                     .size_in_qwords = (unsigned int)nq,
+                     .qwords = set->qwords + (size_t)x * stride};
+      xs.bytes = (unsigned char *)xs.qwords;
+      for (size_t k = 0; k < ntouched; k++) {
+        const uint32_t q = touched[k];
+        if (shared[q] > 0) {
+          const int y = order[q].row;
+          struct T ys = xs;
+          ys.qwords = set->qwords + (size_t)y * stride;
+          ys.bytes = (unsigned char *)ys.qwords;
+          const int c = kernels->setop_count[BIT_OP_AND](&xs, &ys);
+          const float s = similarity_eval(sim, c, a, order[q].card);
+          if (s >= cutoff)
+            join_pairs_push(out, ids ? ids[x] : x, ids ? ids[y] : y, s);
+        }
+        shared[q] = 0;
+      }
+    }
+    free(shared);
+    free(touched);
+  }
+  free(postings);
+  free(lists);
+  free(order);
+  free(tokens);
+  free(starts);
+  free(cards);
+
+  // the pairs under the lower ID, by increasing higher ID
+  size_t total = 0;
+  for (int th = 0; th < nthreads; th++)
+    total += found[th].n;
+  join_pair *pairs = malloc((total ? total : 1) * sizeof(join_pair));
+  assert(pairs != NULL);
+  for (size_t th = 0, at = 0; th < (size_t)nthreads; th++) {
+    if (found[th].n)
+      memcpy(pairs + at, found[th].pairs, found[th].n * sizeof(join_pair));
+    at += found[th].n;
+    free(found[th].pairs);
+  }
+  free(found);
+  qsort(pairs, total, sizeof(join_pair), join_pair_compare);
+  *out_idx = malloc((total ? total : 1) * sizeof(int));
+  *out_sim = malloc((total ? total : 1) * sizeof(float));
+  assert(*out_idx && *out_sim);
+  memset(offsets, 0, ((size_t)n + 1) * sizeof(size_t));
+  for (size_t m = 0; m < total; m++) {
+    offsets[pairs[m].lo + 1]++;
+    (*out_idx)[m] = pairs[m].hi;
+    (*out_sim)[m] = pairs[m].sim;
+  }
+  for (int r = 0; r < n; r++)
+    offsets[r + 1] += offsets[r];
+  free(pairs);
+  return total;
+}
+
+/* --- End Section 9: PUBLIC API --- */
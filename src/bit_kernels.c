@@ -0,0 +1,1633 @@
+/*
+    ISA-specific kernels of the Bit library.
+
+    This translation unit is compiled once per instruction set (see
+    BIT_KERNEL_VARIANTS in the Makefile). Each build sees a different
+    BIT_SIMD_PATH_* selection in simde_integration.h, so the same setop,
+    setop_count, popcount and DB tile macros expand to AVX-512, AVX2, 128-bit
+    or scalar code. The only exported symbol of every build is its kernel
+    table, named bit_kernels_<BIT_KERNEL_ISA>.
+
+    * Author : Christos Argyropoulos
+    * Created : October 2026
+    * Copyright : (c) 2025 - 2026
+    * License : BSD-2
+*/
+
+/* ==========================================================================
+   SECTION 1: INCLUDES
+   Standard library headers first, then project headers.
+   ========================================================================== */
+
+#include "bit.h"
+#include "omp.h"
+#include "simde_integration.h"
+#include <assert.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifndef USE_LIBPOPCNT
+#define USE_LIBPOPCNT 1
+#endif
+
+#if USE_LIBPOPCNT
+#include "libpopcnt.h"
+#endif
+
+#include "bit_internal.h"
+
+/* --- End Section 1: INCLUDES --- */
+
+/* ==========================================================================
+   SECTION 2: COMPILE-TIME CONFIGURATION
+   File-local compile-time constants, build-time defaults, and feature flags.
+   ========================================================================== */
+
+/* Name of the variant; the Makefile passes one per ISA build */
+#ifndef BIT_KERNEL_ISA
+#define BIT_KERNEL_ISA native
+#endif
+
+/* Qwords of every operand evaluated per pass of a fused count expression */
+#ifndef BIT_EXPR_CHUNK
+#define BIT_EXPR_CHUNK 128
+#endif
+
+/* Bytes ahead of the current row that single-query counts prefetch */
+#ifndef BIT_QUERY_PREFETCH
+#define BIT_QUERY_PREFETCH 1024
+#endif
+
+/* Fully unrolled count kernels for the widths of BIT_FIXED_WIDTH_LIST;
+   0 leaves every width to the generic kernels */
+#ifndef BIT_FIXED_WIDTHS
+#define BIT_FIXED_WIDTHS 1
+#endif
+
+/* Leaf of the BIT_TUNING_BLOCK_RECURSIVE kernel: at most this many rows of
+   each container by this many words of a row, a multiple of 8. 16 + 16
+   rows of 128 words are 32 KiB, within the L1 data cache */
+#ifndef BIT_RECURSIVE_ROWS
+#define BIT_RECURSIVE_ROWS 16
+#endif
+#ifndef BIT_RECURSIVE_QWORDS
+#define BIT_RECURSIVE_QWORDS 128
+#endif
+
+/* Pairs of rows from which the recursive kernel counts the halves of a
+   block as separate tasks */
+#ifndef BIT_RECURSIVE_TASK_PAIRS
+#define BIT_RECURSIVE_TASK_PAIRS 4096
+#endif
+
+/* --- End Section 2: COMPILE-TIME CONFIGURATION --- */
+
+/* ==========================================================================
+   SECTION 3: INFRASTRUCTURAL MACROS
+   Private macros used by helper functions and internal operations.
+   ========================================================================== */
+
+#define BIT_KERNEL_CAT_(a, b) a##_##b
+#define BIT_KERNEL_CAT(a, b) BIT_KERNEL_CAT_(a, b)
+#define BIT_KERNEL_XSTR(x) STRINGIFY(x)
+#define BIT_KERNEL_FIRST(a, b) a
+#define BIT_KERNEL_SECOND(a, b) b
+
+/* Row widths, in qwords, that get their own count kernels: 166 bit MACCS
+   keys (3 qwords) and 512, 1024 and 2048 bit fingerprints */
+#define BIT_FIXED_WIDTH_LIST(X, arg) X(arg, 3) X(arg, 8) X(arg, 16) X(arg, 32)
+
+/* --- End Section 3: INFRASTRUCTURAL MACROS --- */
+
+/* ==========================================================================
+   SECTION 4: PRIVATE IMPLEMENTATION MACROS
+   File-local operational macros and helper wrappers.
+   ========================================================================== */
+
+/* One register block variant of the DB count kernel of a set op; arg is
+   (name, op) */
+#define DEFINE_SETOP_DB_BLOCK(arg, tag, rows, cols, vec_blk)                   \
+  DEFINE_SETOP_DB_BLOCK_(BIT_KERNEL_FIRST arg, BIT_KERNEL_SECOND arg, tag,     \
+                         rows, cols, vec_blk)
+#define DEFINE_SETOP_DB_BLOCK_(name, op, tag, rows, cols, vec_blk)             \
+  DEFINE_SETOP_DB_BLOCK__(name, op, tag, rows, cols, vec_blk)
+#define DEFINE_SETOP_DB_BLOCK__(name, op, tag, rows, cols, vec_blk)            \
+  static void setop_count_db_##name##_##tag(T_DB bit, T_DB bits, int *counts, \
+                                            SETOP_COUNT_OPTS opts,             \
+                                            Bit_tuning tuning) {               \
+    setop_count_db_cpu(bit, bits, counts, op, opts, tuning, rows, cols,        \
+                       vec_blk);                                               \
+  }
+#define SETOP_DB_BLOCK_REF(name, tag, rows, cols, vec_blk)                     \
+  setop_count_db_##name##_##tag,
+
+/* BIT_TUNING_BLOCK_SLICED: each (query tile, target tile) pass slices its
+   k_block words of the targets into per-thread scratch (slice_rows), then
+   counts every query of the tile against BIT_SLICE_ROWS targets at a time.
+   A query word is broadcast across the lanes, so each lane accumulates the
+   count of its own target and nothing is reduced across lanes. Target
+   tiles are whole groups; lanes past the last target count zero padding
+   and are dropped. As tasks of the caller's team (bit_exec_tasks) each
+   tile allocates its own scratch */
+#define SETOP_DB_SLICED_TILE(op)                                               \
+  if (bit_stop_poll(tile_stop))                                                \
+    continue;                                                                  \
+  const int i_max =                                                            \
+      i_b + tile_bit < (int)num_targets ? i_b + tile_bit : (int)num_targets;   \
+  const int rows = j_b + tile_bits < (int)n ? tile_bits : (int)n - j_b;        \
+  for (int i = i_b; i < i_max; i++)                                            \
+    for (int j = 0; j < rows; j++)                                             \
+      counts[(uint64_t)i * n + j_b + j] = 0;                                   \
+  for (size_t k_b = 0; k_b < bit_size_in_qwords; k_b += k_block) {             \
+    const size_t k_len = k_b + k_block < bit_size_in_qwords                    \
+                             ? k_block                                         \
+                             : bit_size_in_qwords - k_b;                       \
+    slice_rows(bits_qwords + (uint64_t)j_b * bits_stride + k_b, bits_stride,   \
+               rows, k_len, slices);                                           \
+    for (int i = i_b; i < i_max; i++) {                                        \
+      const uint64_t *restrict a_row =                                         \
+          bit_qwords + (uint64_t)i * bit_stride + k_b;                         \
+      int *restrict out = counts + (uint64_t)i * n + j_b;                      \
+      for (int g = 0; g < rows; g += BIT_SLICE_ROWS) {                         \
+        const uint64_t *restrict group = slices + (size_t)g * k_len;           \
+        uint64_t lanes[BIT_SLICE_ROWS] = {0};                                  \
+        for (size_t k = 0; k < k_len; k++) {                                   \
+          const uint64_t q = a_row[k];                                         \
+          const uint64_t *restrict word = group + k * BIT_SLICE_ROWS;          \
+          OMP_CPU_SIMD                                                         \
+          for (int l = 0; l < BIT_SLICE_ROWS; l++)                             \
+            lanes[l] += POPCOUNT(BIT_SCALAR##op(q, word[l]));                  \
+        }                                                                      \
+        const int h =                                                          \
+            rows - g < BIT_SLICE_ROWS ? rows - g : BIT_SLICE_ROWS;             \
+        for (int l = 0; l < h; l++)                                            \
+          out[g + l] += (int)lanes[l];                                         \
+      }                                                                        \
+    }                                                                          \
+  }                                                                            \
+  bit_stop_tile_done(tile_stop, i_b, i_max, j_b, j_b + rows);
+
+#define DEFINE_SETOP_DB_SLICED(name, op)                                       \
+  static void setop_count_db_##name##_sliced(T_DB bit, T_DB bits,             \
+                                             int *counts,                      \
+                                             SETOP_COUNT_OPTS opts,            \
+                                             Bit_tuning tuning) {              \
+    SETOP_DB_CHECKS(bit, bits)                                                 \
+    SETOP_VAR_INIT(bit, bits, bit_qwords, bits_qwords, bit_size_in_qwords,     \
+                   num_targets, n)                                             \
+    int numthreads = opts.num_cpu_threads > 0 ? opts.num_cpu_threads           \
+                                              : omp_get_max_threads();         \
+    const int tile_bit = tuning.tile;                                          \
+    const int tile_bits =                                                      \
+        (tuning.tile + BIT_SLICE_ROWS - 1) / BIT_SLICE_ROWS * BIT_SLICE_ROWS;  \
+    const size_t k_block = (size_t)tuning.k_block;                             \
+    const size_t slice_bytes = (size_t)tile_bits * k_block * sizeof(uint64_t); \
+    bit_stop *tile_stop =                                                      \
+        bit_stop_take(tile_bit, (int)((n + tile_bits - 1) / tile_bits));       \
+    if (bit_exec_tasks(opts)) {                                                \
+      OMP_CPU_TASKLOOP(2)                                                      \
+      for (int i_b = 0; i_b < (int)num_targets; i_b += tile_bit) {             \
+        for (int j_b = 0; j_b < (int)n; j_b += tile_bits) {                    \
+          uint64_t *slices = malloc(slice_bytes);                              \
+          assert(slices != NULL);                                              \
+          do {                                                                 \
+            SETOP_DB_SLICED_TILE(op)                                           \
+          } while (0);                                                         \
+          free(slices);                                                        \
+        }                                                                      \
+      }                                                                        \
+      return;                                                                  \
+    }                                                                          \
+    /* first touch placed the rows of bit in a static partition of the tiles */ \
+    omp_sched_t saved_sched;                                                   \
+    int saved_chunk;                                                           \
+    omp_get_schedule(&saved_sched, &saved_chunk);                              \
+    omp_set_schedule(bit->numa_policy == BIT_NUMA_FIRST_TOUCH                  \
+                         ? omp_sched_static                                    \
+                         : omp_sched_dynamic,                                  \
+                     0);                                                       \
+    _Pragma(STRINGIFY(omp parallel num_threads(numthreads))) {                 \
+      uint64_t *slices = malloc(slice_bytes);                                  \
+      assert(slices != NULL);                                                  \
+      _Pragma(STRINGIFY(omp for collapse(2) schedule(runtime)))                \
+      for (int i_b = 0; i_b < (int)num_targets; i_b += tile_bit) {             \
+        for (int j_b = 0; j_b < (int)n; j_b += tile_bits) {                    \
+          SETOP_DB_SLICED_TILE(op)                                             \
+        }                                                                      \
+      }                                                                        \
+      free(slices);                                                            \
+    }                                                                          \
+    omp_set_schedule(saved_sched, saved_chunk);                                \
+  }
+
+/* Words [k_b, k_max) of ni rows against nj rows, into counts, ld ints a
+   row, by ROWS x COLS register blocks, with A_ROW(r) and B_ROW(r) the
+   qwords of row r of either side. BLOCK is the call of the register block:
+   it counts a_rows against b_rows into results[ROWS][COLS]. The rows and
+   columns left over run the 1x1 kernel. The first pass over the words
+   (k_b == 0) stores its counts and the later ones add to them, so the
+   counts are never zeroed first */
+#define SETOP_BLOCK_TILES(op, LOAD_MACRO, A_ROW, B_ROW, ROWS, COLS, BLOCK)     \
+  int i = 0;                                                                   \
+  for (; i <= ni - (ROWS); i += (ROWS)) {                                      \
+    const uint64_t *restrict a_rows[ROWS];                                     \
+    for (int x = 0; x < (ROWS); x++)                                           \
+      a_rows[x] = A_ROW(i + x);                                                \
+    int j = 0;                                                                 \
+    for (; j <= nj - (COLS); j += (COLS)) {                                    \
+      const uint64_t *restrict b_rows[COLS];                                   \
+      for (int y = 0; y < (COLS); y++)                                         \
+        b_rows[y] = B_ROW(j + y);                                              \
+      int results[ROWS][COLS];                                                 \
+      BLOCK;                                                                   \
+      for (int x = 0; x < (ROWS); x++)                                         \
+        for (int y = 0; y < (COLS); y++)                                       \
+          counts[(size_t)(i + x) * ld + j + y] =                               \
+              (k_b ? counts[(size_t)(i + x) * ld + j + y] : 0) +               \
+              results[x][y];                                                   \
+    }                                                                          \
+    for (; j < nj; j++)                                                        \
+      for (int x = 0; x < (ROWS); x++) {                                       \
+        int rf = 0;                                                            \
+        setop_count_db_cpu_kernel(                                             \
+            a_rows[x], B_ROW(j), k_b, k_max, rf, op,                           \
+            OMP_CPU_SIMD_ALIGN_BUFFER(ALIGNMENT, setop_buffer), LOAD_MACRO);   \
+        counts[(size_t)(i + x) * ld + j] =                                     \
+            (k_b ? counts[(size_t)(i + x) * ld + j] : 0) + rf;                 \
+      }                                                                        \
+  }                                                                            \
+  for (; i < ni; i++)                                                          \
+    for (int j = 0; j < nj; j++) {                                             \
+      const uint64_t *restrict a_row_f = A_ROW(i);                             \
+      const uint64_t *restrict b_row_f = B_ROW(j);                             \
+      int rf = 0;                                                              \
+      setop_count_db_cpu_kernel(                                               \
+          a_row_f, b_row_f, k_b, k_max, rf, op,                                \
+          OMP_CPU_SIMD_ALIGN_BUFFER(ALIGNMENT, setop_buffer), LOAD_MACRO);     \
+      counts[(size_t)i * ld + j] =                                             \
+          (k_b ? counts[(size_t)i * ld + j] : 0) + rf;                         \
+    }
+
+/* The same with the default register block */
+#define SETOP_BLOCK_LEAF(op, LOAD_MACRO, A_ROW, B_ROW)                         \
+  SETOP_BLOCK_TILES(                                                           \
+      op, LOAD_MACRO, A_ROW, B_ROW, OUTER_ROW_NUM, OUTER_COL_NUM,              \
+      setop_count_db_cpu_kernel_outer(                                         \
+          OUTER_ROW_NUM, OUTER_COL_NUM, OUTER_VEC_BLK, a_rows, b_rows, k_b,    \
+          k_max, results, op,                                                  \
+          OMP_CPU_SIMD_ALIGN_BUFFER(ALIGNMENT, setop_buffer), LOAD_MACRO))
+
+/* A leaf of the recursive kernel: ni rows a, a_stride apart, against nj
+   rows b */
+#define SETOP_STRIDED_A(r) (a + (size_t)(r) * a_stride)
+#define SETOP_STRIDED_B(r) (b + (size_t)(r) * b_stride)
+#define SETOP_RECURSIVE_LEAF(op, LOAD_MACRO)                                   \
+  SETOP_BLOCK_LEAF(op, LOAD_MACRO, SETOP_STRIDED_A, SETOP_STRIDED_B)
+
+/* BIT_TUNING_BLOCK_RECURSIVE: a cache-oblivious count of all the pairs (see
+   recursive_count). Its leaves run the default register block with
+   aligned loads when every row is aligned; the tile and k_block of the
+   tuning are not used. The whole matrix is a single tile for the stop
+   state: the call stops between leaves, and on_tile runs once at the end */
+#define DEFINE_SETOP_DB_RECURSIVE(name, op)                                    \
+  static void recursive_leaf_##name(                                           \
+      const uint64_t *restrict a, size_t a_stride, int ni,                     \
+      const uint64_t *restrict b, size_t b_stride, int nj, size_t k_b,         \
+      size_t k_max, int *restrict counts, size_t ld) {                         \
+    SETOP_RECURSIVE_LEAF(op, VECTOR_UNALIGNED_LOAD)                            \
+  }                                                                            \
+  static void recursive_leaf_##name##_aligned(                                 \
+      const uint64_t *restrict a, size_t a_stride, int ni,                     \
+      const uint64_t *restrict b, size_t b_stride, int nj, size_t k_b,         \
+      size_t k_max, int *restrict counts, size_t ld) {                         \
+    SETOP_RECURSIVE_LEAF(op, VECTOR_ALIGNED_LOAD)                              \
+  }                                                                            \
+  static void setop_count_db_##name##_recursive(T_DB bit, T_DB bits,          \
+                                                int *counts,                   \
+                                                SETOP_COUNT_OPTS opts,         \
+                                                Bit_tuning tuning) {           \
+    SETOP_DB_CHECKS(bit, bits)                                                 \
+    SETOP_VAR_INIT(bit, bits, bit_qwords, bits_qwords, bit_size_in_qwords,     \
+                   num_targets, n)                                             \
+    (void)tuning;                                                              \
+    const bool aligned = !ARCH_32BIT && ALIGN_CHECK(bit_qwords) &&             \
+                         ALIGN_CHECK(bits_qwords) &&                           \
+                         ALIGN_CHECK(bit_qwords + bit_stride) &&               \
+                         ALIGN_CHECK(bits_qwords + bits_stride);               \
+    BIT_PROFILE_PATH(db_loads[aligned]);                                       \
+    recursive_block block = {                                                  \
+        aligned ? recursive_leaf_##name##_aligned : recursive_leaf_##name,     \
+        bit_qwords, bit_stride, bits_qwords, bits_stride, counts, n,           \
+        bit_stop_take(num_targets > 0 ? (int)num_targets : 1, 1)};             \
+    if (bit_exec_tasks(opts)) {                                                \
+      recursive_count(&block, 0, (int)num_targets, 0, (int)n, 0,               \
+                      bit_size_in_qwords);                                     \
+    } else {                                                                   \
+      int numthreads = opts.num_cpu_threads > 0 ? opts.num_cpu_threads         \
+                                                : omp_get_max_threads();       \
+      _Pragma(STRINGIFY(omp parallel num_threads(numthreads)))                 \
+      _Pragma("omp single")                                                    \
+      recursive_count(&block, 0, (int)num_targets, 0, (int)n, 0,               \
+                      bit_size_in_qwords);                                     \
+    }                                                                          \
+    if (!bit_stop_poll(block.stop))                                            \
+      bit_stop_tile_done(block.stop, 0, (int)num_targets, 0, (int)n);          \
+  }
+
+/* The tile loops of a fixed-width DB kernel under the directive LOOP, a
+   team or OMP_CPU_TASKLOOP. Every count is written once, so stream_tiles
+   streams it straight to counts */
+#define SETOP_FIXED_TILES(name, nq, LOOP)                                      \
+  LOOP                                                                         \
+  for (int i_b = 0; i_b < (int)num_targets; i_b += tile_bit) {                 \
+    for (int j_b = 0; j_b < (int)n; j_b += tile_bits) {                        \
+      if (bit_stop_poll(tile_stop))                                            \
+        continue;                                                              \
+      const int i_max = i_b + tile_bit < (int)num_targets ? i_b + tile_bit     \
+                                                          : (int)num_targets;  \
+      const int j_max = j_b + tile_bits < (int)n ? j_b + tile_bits : (int)n;   \
+      for (int i = i_b; i < i_max; i++) {                                      \
+        uint64_t q[nq];                                                        \
+        memcpy(q, bit_qwords + (uint64_t)i * bit_stride, sizeof(q));           \
+        int *restrict out = counts + (uint64_t)i * n;                          \
+        for (int j = j_b; j < j_max; j++) {                                    \
+          const int count = fixed_count_##name##_##nq(                         \
+              q, bits_qwords + (uint64_t)j * bits_stride);                     \
+          if (stream_tiles)                                                    \
+            STREAM_INT(out + j, count);                                        \
+          else                                                                 \
+            out[j] = count;                                                    \
+        }                                                                      \
+      }                                                                        \
+      if (stream_tiles)                                                        \
+        STREAM_FENCE();                                                        \
+      bit_stop_tile_done(tile_stop, i_b, i_max, j_b, j_max);                   \
+    }                                                                          \
+  }
+
+/* Fixed-width count kernels of a set op, one set per width nq of
+   BIT_FIXED_WIDTH_LIST; arg is (name, op). The word loop of
+   fixed_count_<name>_<nq> has a compile-time trip count, so it unrolls
+   completely with no tail, and the DB and query kernels copy each query row
+   into a local array first, which the unrolled loop keeps in registers
+   while the target rows stream past. Rows are read over size_in_qwords
+   words only: the zero padding up to the stride counts nothing */
+#define DEFINE_SETOP_FIXED(arg, nq)                                            \
+  DEFINE_SETOP_FIXED_(BIT_KERNEL_FIRST arg, BIT_KERNEL_SECOND arg, nq)
+#define DEFINE_SETOP_FIXED_(name, op, nq) DEFINE_SETOP_FIXED__(name, op, nq)
+#define DEFINE_SETOP_FIXED__(name, op, nq)                                     \
+  static inline int fixed_count_##name##_##nq(const uint64_t *restrict a,     \
+                                              const uint64_t *restrict b) {   \
+    uint64_t count = 0;                                                        \
+    _Pragma(STRINGIFY(GCC unroll nq))                                          \
+    for (int k = 0; k < nq; k++)                                               \
+      count += POPCOUNT(BIT_SCALAR##op(a[k], b[k]));                           \
+    return (int)count;                                                         \
+  }                                                                            \
+  static void setop_count_db_##name##_w##nq(T_DB bit, T_DB bits, int *counts, \
+                                            SETOP_COUNT_OPTS opts,             \
+                                            Bit_tuning tuning) {               \
+    SETOP_DB_CHECKS(bit, bits)                                                 \
+    SETOP_VAR_INIT(bit, bits, bit_qwords, bits_qwords, bit_size_in_qwords,     \
+                   num_targets, n)                                             \
+    (void)bit_size_in_qwords;                                                  \
+    const bool tasks = bit_exec_tasks(opts);                                   \
+    int numthreads = tasks ? omp_get_num_threads()                             \
+                     : opts.num_cpu_threads > 0 ? opts.num_cpu_threads         \
+                                                : omp_get_max_threads();       \
+    const int tile_bit = tuning.tile;                                          \
+    int tile_bits = tuning.tile;                                               \
+    while (tile_bits > 1 &&                                                    \
+           (size_t)((num_targets + tile_bit - 1) / tile_bit) *                 \
+                   (size_t)((n + tile_bits - 1) / tile_bits) <                 \
+               (size_t)numthreads)                                             \
+      tile_bits /= 2;                                                          \
+    bit_stop *tile_stop =                                                      \
+        bit_stop_take(tile_bit, (int)((n + tile_bits - 1) / tile_bits));       \
+    const bool stream_tiles =                                                  \
+        bit_store_streams(opts, (size_t)num_targets * n);                      \
+    if (tasks) {                                                               \
+      SETOP_FIXED_TILES(name, nq, OMP_CPU_TASKLOOP(2))                         \
+      return;                                                                  \
+    }                                                                          \
+    omp_sched_t saved_sched;                                                   \
+    int saved_chunk;                                                           \
+    omp_get_schedule(&saved_sched, &saved_chunk);                              \
+    omp_set_schedule(bit->numa_policy == BIT_NUMA_FIRST_TOUCH                  \
+                         ? omp_sched_static                                    \
+                         : omp_sched_dynamic,                                  \
+                     0);                                                       \
+    SETOP_FIXED_TILES(name, nq, OMP_CPU_LOOP_TEAM(2, runtime, numthreads))     \
+    omp_set_schedule(saved_sched, saved_chunk);                                \
+  }                                                                            \
+  static void setop_count_query_##name##_w##nq(                                \
+      const uint64_t *q_row, const uint64_t *rows, size_t stride, int nrows,   \
+      int *counts, int numthreads) {                                           \
+    _Pragma(STRINGIFY(omp parallel num_threads(numthreads))) {                 \
+      uint64_t q[nq];                                                          \
+      memcpy(q, q_row, sizeof(q));                                             \
+      _Pragma(STRINGIFY(omp for schedule(static)))                             \
+      for (int r = 0; r < nrows; r++) {                                        \
+        const uint64_t *restrict row = rows + (size_t)r * stride;              \
+        __builtin_prefetch((const char *)row + BIT_QUERY_PREFETCH, 0, 0);      \
+        counts[r] = fixed_count_##name##_##nq(q, row);                         \
+      }                                                                        \
+    }                                                                          \
+  }
+
+/* Switch cases that hand a width of BIT_FIXED_WIDTH_LIST to its kernels;
+   SETOP_FIXED_WIDTHS is the switch itself, and expands to nothing when the
+   fixed widths are compiled out */
+#define SETOP_FIXED_PAIR_CASE(name, nq)                                        \
+  case nq:                                                                     \
+    return fixed_count_##name##_##nq(s->qwords, t->qwords);
+#define SETOP_FIXED_DB_CASE(name, nq)                                          \
+  case nq:                                                                     \
+    setop_count_db_##name##_w##nq(bit, bits, counts, opts, tuning);            \
+    return;
+#define SETOP_FIXED_QUERY_CASE(name, nq)                                       \
+  case nq:                                                                     \
+    setop_count_query_##name##_w##nq(q_row, rows, stride, nrows, counts,       \
+                                     numthreads);                              \
+    return;
+#if BIT_FIXED_WIDTHS
+#define DEFINE_SETOP_FIXED_KERNELS(name, op)                                   \
+  BIT_FIXED_WIDTH_LIST(DEFINE_SETOP_FIXED, (name, op))
+#define SETOP_FIXED_WIDTHS(nq, CASE, name)                                     \
+  switch (nq) {                                                                \
+    BIT_FIXED_WIDTH_LIST(CASE, name)                                           \
+  default:                                                                     \
+    break;                                                                     \
+  }
+#else
+#define DEFINE_SETOP_FIXED_KERNELS(name, op)
+#define SETOP_FIXED_WIDTHS(nq, CASE, name)
+#endif
+
+/* Instantiate the materializing, counting, predicate and DB kernels of one
+   set op; the single bitset kernels take the aligned load/store path when
+   every operand is ALIGNMENT-aligned (always the case for Bit_new storage) */
+#define DEFINE_SETOP_KERNELS(name, op)                                         \
+  DEFINE_SETOP_FIXED_KERNELS(name, op)                                         \
+  static void setop_##name(T set, T s, T t) {                                  \
+    BIT_PROFILE_PATH(                                                          \
+        setop_loads[ALIGNED_OPERANDS3(set->qwords, s->qwords, t->qwords)]);    \
+    if (ALIGNED_OPERANDS3(set->qwords, s->qwords, t->qwords))                  \
+      setop_ls(set, op, s, t, VECTOR_ALIGNED_LOAD, VECTOR_ALIGNED_STORE);      \
+    else                                                                       \
+      setop(set, op, s, t);                                                    \
+  }                                                                            \
+  static int setop_count_##name(T s, T t) {                                    \
+    SETOP_FIXED_WIDTHS(s->size_in_qwords, SETOP_FIXED_PAIR_CASE, name)         \
+    BIT_PROFILE_PATH(setop_loads[ALIGNED_OPERANDS(s->qwords, t->qwords)]);     \
+    if (ALIGNED_OPERANDS(s->qwords, t->qwords))                                \
+      setop_count_ls(op, s, t, VECTOR_ALIGNED_LOAD);                           \
+    else                                                                       \
+      setop_count(op, s, t);                                                   \
+  }                                                                            \
+  static int setop_any_##name(T s, T t) {                                      \
+    BIT_PROFILE_PATH(setop_loads[ALIGNED_OPERANDS(s->qwords, t->qwords)]);     \
+    if (ALIGNED_OPERANDS(s->qwords, t->qwords))                                \
+      setop_any_ls(op, s, t, VECTOR_ALIGNED_LOAD);                             \
+    else                                                                       \
+      setop_any(op, s, t);                                                     \
+  }                                                                            \
+  BIT_TUNING_BLOCKS(DEFINE_SETOP_DB_BLOCK, (name, op))                         \
+  DEFINE_SETOP_DB_SLICED(name, op)                                             \
+  DEFINE_SETOP_DB_RECURSIVE(name, op)                                          \
+  static void setop_count_db_##name(T_DB bit, T_DB bits, int *counts,          \
+                                    SETOP_COUNT_OPTS opts) {                   \
+    static void (*const blocks[])(T_DB, T_DB, int *, SETOP_COUNT_OPTS,         \
+                                  Bit_tuning) = {                              \
+        BIT_TUNING_BLOCKS(SETOP_DB_BLOCK_REF, name)                            \
+            setop_count_db_##name##_sliced,                                    \
+        setop_count_db_##name##_recursive};                                    \
+    Bit_tuning tuning = bit_tuning_resolve(opts);                              \
+    BIT_PROFILE_PATH(blocks[tuning.block]);                                    \
+    /* the sliced layout is asked for by name; every register block of a */   \
+    /* fixed width runs its unrolled kernel instead */                         \
+    if (tuning.block != BIT_TUNING_BLOCK_SLICED) {                             \
+      SETOP_FIXED_WIDTHS(bit->size_in_qwords, SETOP_FIXED_DB_CASE, name)       \
+    }                                                                          \
+    blocks[tuning.block](bit, bits, counts, opts, tuning);                     \
+  }                                                                            \
+  DEFINE_SETOP_QUERY_KERNEL(name, op)                                          \
+  DEFINE_SETOP_ROWS_KERNEL(name, op)
+
+/* Rows anywhere in memory (Bit_IDB_T): ni rows a[] against nj rows b[],
+   the register blocks reading their row pointers from the arrays. The
+   loads are unaligned, as the rows of a Bit_T made by Bit_load need not
+   be aligned */
+#define SETOP_INDIRECT_A(r) (a[r])
+#define SETOP_INDIRECT_B(r) (b[r])
+#define DEFINE_SETOP_ROWS_KERNEL(name, op)                                     \
+  static void setop_count_rows_##name(                                         \
+      const uint64_t *const *a, int ni, const uint64_t *const *b, int nj,      \
+      size_t k_b, size_t k_max, int *restrict counts, size_t ld) {             \
+    SETOP_BLOCK_LEAF(op, VECTOR_UNALIGNED_LOAD, SETOP_INDIRECT_A,              \
+                     SETOP_INDIRECT_B)                                         \
+  }
+
+/* One query against every row of a container. The query is the only
+   operand read more than once, so it stays in L1 while each thread streams
+   one contiguous range of rows past it; the bytes BIT_QUERY_PREFETCH ahead
+   of every row are prefetched with a non-temporal hint (no row is reused) */
+#define DEFINE_SETOP_QUERY_KERNEL(name, op)                                    \
+  static void setop_count_query_##name(T q, T_DB db, int *counts,              \
+                                       SETOP_COUNT_OPTS opts) {                \
+    const uint64_t *restrict q_row = q->qwords;                                \
+    const uint64_t *restrict rows = db->qwords;                                \
+    const size_t stride = db->stride_in_qwords;                                \
+    const size_t nq = db->size_in_qwords;                                      \
+    const size_t row_bytes = nq * sizeof(uint64_t);                            \
+    const int nrows = (int)db->nelem;                                          \
+    bool aligned = !ARCH_32BIT && ALIGN_CHECK(q_row) && ALIGN_CHECK(rows) &&   \
+                   ALIGN_CHECK(rows + stride);                                 \
+    int numthreads = opts.num_cpu_threads > 0 ? opts.num_cpu_threads           \
+                                              : omp_get_max_threads();         \
+    SETOP_FIXED_WIDTHS(nq, SETOP_FIXED_QUERY_CASE, name)                       \
+    _Pragma(STRINGIFY(omp parallel for schedule(static)                        \
+                          num_threads(numthreads)))                            \
+    for (int r = 0; r < nrows; r++) {                                          \
+      const uint64_t *restrict row = rows + (size_t)r * stride;                \
+      const char *ahead = (const char *)row + BIT_QUERY_PREFETCH;              \
+      for (size_t line = 0; line < row_bytes; line += 64)                      \
+        __builtin_prefetch(ahead + line, 0, 0);                                \
+      int row_count = 0;                                                       \
+      if (aligned) {                                                           \
+        setop_count_db_cpu_kernel(                                             \
+            q_row, row, 0, nq, row_count, op,                                  \
+            OMP_CPU_SIMD_ALIGN_BUFFER(ALIGNMENT, setop_buffer),                \
+            VECTOR_ALIGNED_LOAD);                                              \
+      } else {                                                                 \
+        setop_count_db_cpu_kernel(                                             \
+            q_row, row, 0, nq, row_count, op,                                  \
+            OMP_CPU_SIMD_ALIGN_BUFFER(ALIGNMENT, setop_buffer),                \
+            VECTOR_UNALIGNED_LOAD);                                            \
+      }                                                                        \
+      counts[r] = row_count;                                                   \
+    }                                                                          \
+  }
+
+/* dst[0..len) = op(a, b) for one chunk of a fused count expression */
+#if BIT_SIMD_PATH_SCALAR
+#define EXPR_BINARY(op, dst, a, b, len)                                        \
+  do {                                                                         \
+    OMP_CPU_SIMD                                                               \
+    for (size_t k = 0; k < (len); k++)                                         \
+      (dst)[k] = BIT_SCALAR##op((a)[k], (b)[k]);                               \
+  } while (0)
+#else
+#define EXPR_BINARY(op, dst, a, b, len)                                        \
+  do {                                                                         \
+    size_t k = 0;                                                              \
+    for (; k + VECTOR_QWORDS <= (len); k += VECTOR_QWORDS)                     \
+      VECTOR_UNALIGNED_STORE(                                                  \
+          (VECTOR_TYPE *)&(dst)[k],                                            \
+          BIT##op(VECTOR_UNALIGNED_LOAD((VECTOR_TYPE *)&(a)[k]),               \
+                  VECTOR_UNALIGNED_LOAD((VECTOR_TYPE *)&(b)[k])));             \
+    for (; k < (len); k++)                                                     \
+      (dst)[k] = BIT_SCALAR##op((a)[k], (b)[k]);                               \
+  } while (0)
+#endif
+
+/* --- End Section 4: PRIVATE IMPLEMENTATION MACROS --- */
+
+/* ==========================================================================
+   SECTION 6: STATIC DATA
+   ========================================================================== */
+
+#if defined(BIT_SIMD_PATH_AVX2) || defined(BIT_SIMD_PATH_128)
+/* The positions of the set bits of every byte value, one per byte from the
+   low end, for decode_qwords */
+static const uint64_t decode_bytes[256] = {
+    0x0, 0x0, 0x1, 0x100, 0x2, 0x200, 0x201, 0x20100, 0x3, 0x300, 0x301,
+    0x30100, 0x302, 0x30200, 0x30201, 0x3020100, 0x4, 0x400, 0x401, 0x40100,
+    0x402, 0x40200, 0x40201, 0x4020100, 0x403, 0x40300, 0x40301, 0x4030100,
+    0x40302, 0x4030200, 0x4030201, 0x403020100, 0x5, 0x500, 0x501, 0x50100,
+    0x502, 0x50200, 0x50201, 0x5020100, 0x503, 0x50300, 0x50301, 0x5030100,
+    0x50302, 0x5030200, 0x5030201, 0x503020100, 0x504, 0x50400, 0x50401,
+    0x5040100, 0x50402, 0x5040200, 0x5040201, 0x504020100, 0x50403, 0x5040300,
+    0x5040301, 0x504030100, 0x5040302, 0x504030200, 0x504030201, 0x50403020100,
+    0x6, 0x600, 0x601, 0x60100, 0x602, 0x60200, 0x60201, 0x6020100, 0x603,
+    0x60300, 0x60301, 0x6030100, 0x60302, 0x6030200, 0x6030201, 0x603020100,
+    0x604, 0x60400, 0x60401, 0x6040100, 0x60402, 0x6040200, 0x6040201,
+    0x604020100, 0x60403, 0x6040300, 0x6040301, 0x604030100, 0x6040302,
+    0x604030200, 0x604030201, 0x60403020100, 0x605, 0x60500, 0x60501, 0x6050100,
+    0x60502, 0x6050200, 0x6050201, 0x605020100, 0x60503, 0x6050300, 0x6050301,
+    0x605030100, 0x6050302, 0x605030200, 0x605030201, 0x60503020100, 0x60504,
+    0x6050400, 0x6050401, 0x605040100, 0x6050402, 0x605040200, 0x605040201,
+    0x60504020100, 0x6050403, 0x605040300, 0x605040301, 0x60504030100,
+    0x605040302, 0x60504030200, 0x60504030201, 0x6050403020100, 0x7, 0x700,
+    0x701, 0x70100, 0x702, 0x70200, 0x70201, 0x7020100, 0x703, 0x70300, 0x70301,
+    0x7030100, 0x70302, 0x7030200, 0x7030201, 0x703020100, 0x704, 0x70400,
+    0x70401, 0x7040100, 0x70402, 0x7040200, 0x7040201, 0x704020100, 0x70403,
+    0x7040300, 0x7040301, 0x704030100, 0x7040302, 0x704030200, 0x704030201,
+    0x70403020100, 0x705, 0x70500, 0x70501, 0x7050100, 0x70502, 0x7050200,
+    0x7050201, 0x705020100, 0x70503, 0x7050300, 0x7050301, 0x705030100,
+    0x7050302, 0x705030200, 0x705030201, 0x70503020100, 0x70504, 0x7050400,
+    0x7050401, 0x705040100, 0x7050402, 0x705040200, 0x705040201, 0x70504020100,
+    0x7050403, 0x705040300, 0x705040301, 0x70504030100, 0x705040302,
+    0x70504030200, 0x70504030201, 0x7050403020100, 0x706, 0x70600, 0x70601,
+    0x7060100, 0x70602, 0x7060200, 0x7060201, 0x706020100, 0x70603, 0x7060300,
+    0x7060301, 0x706030100, 0x7060302, 0x706030200, 0x706030201, 0x70603020100,
+    0x70604, 0x7060400, 0x7060401, 0x706040100, 0x7060402, 0x706040200,
+    0x706040201, 0x70604020100, 0x7060403, 0x706040300, 0x706040301,
+    0x70604030100, 0x706040302, 0x70604030200, 0x70604030201, 0x7060403020100,
+    0x70605, 0x7060500, 0x7060501, 0x706050100, 0x7060502, 0x706050200,
+    0x706050201, 0x70605020100, 0x7060503, 0x706050300, 0x706050301,
+    0x70605030100, 0x706050302, 0x70605030200, 0x70605030201, 0x7060503020100,
+    0x7060504, 0x706050400, 0x706050401, 0x70605040100, 0x706050402,
+    0x70605040200, 0x70605040201, 0x7060504020100, 0x706050403, 0x70605040300,
+    0x70605040301, 0x7060504030100, 0x70605040302, 0x7060504030200,
+    0x7060504030201, 0x706050403020100,
+};
+#endif
+
+/* --- End Section 6: STATIC DATA --- */
+
+/* ==========================================================================
+   SECTION 8: INTERNAL HELPER FUNCTION DEFINITIONS
+   Kernel instantiations for this ISA.
+   ========================================================================== */
+
+/* Copies k_len words of nrows rows (stride apart) into bit-sliced groups of
+   BIT_SLICE_ROWS rows: word k of row r of group g lands at
+   (g * k_len + k) * BIT_SLICE_ROWS + r, and the rows past nrows in the last
+   group are zero */
+static void slice_rows(const uint64_t *restrict rows, size_t stride,
+                       int nrows, size_t k_len, uint64_t *restrict slices) {
+  for (int g = 0; g < nrows; g += BIT_SLICE_ROWS) {
+    uint64_t *restrict group = slices + (size_t)g * k_len;
+    const int h = nrows - g < BIT_SLICE_ROWS ? nrows - g : BIT_SLICE_ROWS;
+    for (int r = 0; r < h; r++) {
+      const uint64_t *restrict row = rows + (size_t)(g + r) * stride;
+      for (size_t k = 0; k < k_len; k++)
+        group[k * BIT_SLICE_ROWS + r] = row[k];
+    }
+    for (int r = h; r < BIT_SLICE_ROWS; r++)
+      for (size_t k = 0; k < k_len; k++)
+        group[k * BIT_SLICE_ROWS + r] = 0;
+  }
+}
+
+/* A block of the recursive kernel's pairs: the leaf count of its set op,
+   the two containers, and their counts */
+typedef struct {
+  void (*leaf)(const uint64_t *restrict a, size_t a_stride, int ni,
+               const uint64_t *restrict b, size_t b_stride, int nj,
+               size_t k_b, size_t k_max, int *restrict counts, size_t ld);
+  const uint64_t *a;
+  size_t a_stride;
+  const uint64_t *b;
+  size_t b_stride;
+  int *counts;
+  size_t ld;
+  bit_stop *stop;
+} recursive_block;
+
+/* Counts rows [i_b, i_max) against rows [j_b, j_max) over words
+   [k_b, k_max). The dimension that is the most times its leaf size is
+   halved (words at a multiple of 8) until the block is a leaf, so that the
+   working set fits each cache level at some depth without the recursion
+   knowing its size. The halves of the rows are independent, and count as
+   tasks while the block has more than BIT_RECURSIVE_TASK_PAIRS pairs; the
+   halves of the words add to the same counts, in order */
+static void recursive_count(const recursive_block *blk, int i_b, int i_max,
+                            int j_b, int j_max, size_t k_b, size_t k_max) {
+  if (bit_stop_poll(blk->stop))
+    return;
+  const int ni = i_max - i_b, nj = j_max - j_b;
+  const size_t nk = k_max - k_b;
+  const size_t wi = ni > BIT_RECURSIVE_ROWS ? (size_t)ni * BIT_RECURSIVE_QWORDS
+                                            : 0;
+  const size_t wj = nj > BIT_RECURSIVE_ROWS ? (size_t)nj * BIT_RECURSIVE_QWORDS
+                                            : 0;
+  const size_t wk = nk > BIT_RECURSIVE_QWORDS ? nk * BIT_RECURSIVE_ROWS : 0;
+  if (wi == 0 && wj == 0 && wk == 0) {
+    blk->leaf(blk->a + (size_t)i_b * blk->a_stride, blk->a_stride, ni,
+              blk->b + (size_t)j_b * blk->b_stride, blk->b_stride, nj, k_b,
+              k_max, blk->counts + (size_t)i_b * blk->ld + j_b, blk->ld);
+    return;
+  }
+  if (wk >= wi && wk >= wj) {
+    const size_t k_mid = k_b + (nk / 2 & ~(size_t)7);
+    recursive_count(blk, i_b, i_max, j_b, j_max, k_b, k_mid);
+    recursive_count(blk, i_b, i_max, j_b, j_max, k_mid, k_max);
+    return;
+  }
+  const bool split_i = wi >= wj;
+  const int mid = split_i ? i_b + ni / 2 : j_b + nj / 2;
+#pragma omp task if ((size_t)ni * nj > BIT_RECURSIVE_TASK_PAIRS)
+  recursive_count(blk, i_b, split_i ? mid : i_max, j_b, split_i ? j_max : mid,
+                  k_b, k_max);
+  recursive_count(blk, split_i ? mid : i_b, i_max, split_i ? j_b : mid, j_max,
+                  k_b, k_max);
+#pragma omp taskwait
+}
+
+DEFINE_SETOP_KERNELS(and, _AND)
+DEFINE_SETOP_KERNELS(or, _OR)
+DEFINE_SETOP_KERNELS(xor, _XOR)
+DEFINE_SETOP_KERNELS(and_not, _AND_NOT)
+
+/* Register block kernels of KERNEL_BLOCKS (scripts/gen_kernels.pl). They
+   spell out the outer product of setop_count_db_cpu_kernel_outer where it
+   accumulates vector popcounts; on the Harley-Seal, staged, NEON and SVE
+   paths they expand that macro at their shape instead. Aligned loads fall
+   back to unaligned ones on 32-bit targets, as in setop_count_db_cpu */
+#if !BIT_DB_POPCOUNT_SVE && !BIT_DB_POPCOUNT_NEON && !BIT_DB_OUTER_STAGED &&   \
+    !BIT_DB_OUTER_HARLEY_SEAL
+#define BIT_GEN_VECTOR_BLOCKS 1
+static inline uint64_t gen_lanes_sum(VECTOR_TYPE v) {
+  uint64_t lanes[VECTOR_QWORDS], sum = 0;
+  SIMDe_STORE_VECTOR(lanes, v);
+  for (size_t l = 0; l < VECTOR_QWORDS; l++)
+    sum += lanes[l];
+  return sum;
+}
+#else
+#define BIT_GEN_VECTOR_BLOCKS 0
+#endif
+#if ARCH_32BIT
+#define BIT_GEN_ALIGNED_LOAD VECTOR_UNALIGNED_LOAD
+#else
+#define BIT_GEN_ALIGNED_LOAD VECTOR_ALIGNED_LOAD
+#endif
+#include "bit_kernels_gen.h"
+
+/* Population count of nq consecutive qwords */
+static int count_qwords(const uint64_t *qwords, size_t nq) {
+  int length = 0;
+#if !USE_LIBPOPCNT && BIT_SIMD_PATH_SVE
+  svuint64_t sum = svdup_n_u64(0);
+  for (size_t i = 0; i < nq; i += svcntd()) {
+    const svbool_t pg = svwhilelt_b64_u64(i, nq);
+    sum = svadd_u64_m(pg, sum, svcnt_u64_x(pg, svld1_u64(pg, &qwords[i])));
+  }
+  length = (int)svaddv_u64(svptrue_b64(), sum);
+#elif !USE_LIBPOPCNT && BIT_SIMD_PATH_NEON
+  size_t i = 0;
+  uint64x2_t total = vdupq_n_u64(0);
+  while (i + 2 <= nq) {
+    uint16x8_t sum = vdupq_n_u16(0);
+    for (size_t k = 0; k < BIT_NEON_FLUSH && i + 2 <= nq; k++, i += 2)
+      sum = BIT_NEON_CNT_ACC(sum, vld1q_u64(&qwords[i]));
+    total = vpadalq_u32(total, vpaddlq_u16(sum));
+  }
+  length = (int)vaddvq_u64(total);
+  for (; i < nq; i++)
+    length += POPCOUNT(qwords[i]);
+#elif !USE_LIBPOPCNT && !BIT_SIMD_PATH_SCALAR
+  size_t limit = (nq / VECTOR_BLOCK_SIZE) * VECTOR_BLOCK_SIZE;
+  size_t i = 0;
+
+  VECTOR_TYPE sum0 = SIMDe_ZERO_VECTOR;
+  VECTOR_TYPE sum1 = SIMDe_ZERO_VECTOR;
+  VECTOR_TYPE sum2 = SIMDe_ZERO_VECTOR;
+  VECTOR_TYPE sum3 = SIMDe_ZERO_VECTOR;
+
+  for (; i < limit; i += VECTOR_BLOCK_SIZE) {
+    sum0 = SIMDe_VECTOR_ADD(sum0, SIMDe_POPCOUNT(VECTOR_UNALIGNED_LOAD(
+                                      (VECTOR_TYPE *)&qwords[i + VECTOR_OFFSET(0)])));
+
+    sum1 = SIMDe_VECTOR_ADD(sum1, SIMDe_POPCOUNT(VECTOR_UNALIGNED_LOAD(
+                                      (VECTOR_TYPE *)&qwords[i + VECTOR_OFFSET(1)])));
+
+    sum2 = SIMDe_VECTOR_ADD(sum2, SIMDe_POPCOUNT(VECTOR_UNALIGNED_LOAD(
+                                      (VECTOR_TYPE *)&qwords[i + VECTOR_OFFSET(2)])));
+
+    sum3 = SIMDe_VECTOR_ADD(sum3, SIMDe_POPCOUNT(VECTOR_UNALIGNED_LOAD(
+                                      (VECTOR_TYPE *)&qwords[i + VECTOR_OFFSET(3)])));
+  }
+
+  // Reduce 4 accumulators down to 1 (Optimal binary reduction tree)
+  sum0 = SIMDe_VECTOR_ADD(sum0, sum1);
+  sum2 = SIMDe_VECTOR_ADD(sum2, sum3);
+  sum0 = SIMDe_VECTOR_ADD(sum0, sum2);
+
+  // Extract vector elements to scalar
+  uint64_t sum_array[VECTOR_QWORDS];
+  SIMDe_STORE_VECTOR(sum_array, sum0);
+
+  for (size_t j = 0; j < VECTOR_QWORDS; j++) {
+    length += sum_array[j];
+  }
+
+  // Handle remaining elements (Fringe)
+  for (; i < nq; i++) {
+    length += POPCOUNT(qwords[i]);
+  }
+#elif !USE_LIBPOPCNT
+  for (size_t i = 0; i < nq; i++) {
+    length += POPCOUNT(qwords[i]);
+  }
+#else
+  length = (int)popcnt(qwords, nq * sizeof(uint64_t));
+#endif
+  return length;
+}
+
+static int bitset_count(T set) {
+  return count_qwords(set->qwords, set->size_in_qwords);
+}
+
+/* Cumulative per-block popcounts of the rank/select index; rank[] has
+   rank_nblocks + 1 entries, the last one being the total */
+static void rank_build(const uint64_t *qwords, unsigned int size_in_qwords,
+                       uint32_t *rank) {
+  unsigned int nblocks = rank_nblocks(size_in_qwords);
+  uint32_t total = 0;
+  for (unsigned int b = 0; b < nblocks; b++) {
+    rank[b] = total;
+    unsigned int lo = b * RANK_BLOCK_QWORDS;
+    unsigned int hi = lo + RANK_BLOCK_QWORDS < size_in_qwords
+                          ? lo + RANK_BLOCK_QWORDS
+                          : size_in_qwords;
+    uint32_t block = 0;
+#pragma omp simd reduction(+ : block)
+    for (unsigned int w = lo; w < hi; w++)
+      block += (uint32_t)__builtin_popcountll(qwords[w]);
+    total += block;
+  }
+  rank[nblocks] = total;
+}
+
+/* Stack machine for a (validated) fused count expression. Each pass loads
+   BIT_EXPR_CHUNK qwords of every operand; pushes are pointers into the
+   operands, and only op results are written to the per-depth scratch rows */
+static int expr_count(const Bit_expr_op *program, int nops, T *operands,
+                      const uint64_t *row, unsigned int size_in_qwords,
+                      unsigned int length) {
+  _Alignas(ALIGNMENT) uint64_t scratch[BIT_EXPR_MAX_DEPTH][BIT_EXPR_CHUNK];
+  const uint64_t *stack[BIT_EXPR_MAX_DEPTH];
+  uint64_t tail = (length % BPQW) ? (UINT64_C(1) << (length % BPQW)) - 1
+                                  : ~UINT64_C(0);
+  int count = 0;
+
+  for (size_t k_b = 0; k_b < size_in_qwords; k_b += BIT_EXPR_CHUNK) {
+    size_t len = (k_b + BIT_EXPR_CHUNK < size_in_qwords) ? BIT_EXPR_CHUNK
+                                                         : size_in_qwords - k_b;
+    int depth = 0, next = 0;
+    for (int p = 0; p < nops; p++) {
+      uint64_t *dst;
+      switch (program[p]) {
+      case BIT_EXPR_PUSH:
+        stack[depth++] = operands[next++]->qwords + k_b;
+        continue;
+      case BIT_EXPR_PUSH_ROW:
+        stack[depth++] = row + k_b;
+        continue;
+      case BIT_EXPR_NOT:
+        dst = scratch[depth - 1];
+        OMP_CPU_SIMD
+        for (size_t k = 0; k < len; k++)
+          dst[k] = ~stack[depth - 1][k];
+        stack[depth - 1] = dst;
+        continue;
+      default:
+        break;
+      }
+      depth--;
+      dst = scratch[depth - 1];
+      switch (program[p]) {
+      case BIT_EXPR_AND:
+        EXPR_BINARY(_AND, dst, stack[depth - 1], stack[depth], len);
+        break;
+      case BIT_EXPR_OR:
+        EXPR_BINARY(_OR, dst, stack[depth - 1], stack[depth], len);
+        break;
+      case BIT_EXPR_XOR:
+        EXPR_BINARY(_XOR, dst, stack[depth - 1], stack[depth], len);
+        break;
+      default: // BIT_EXPR_AND_NOT
+        EXPR_BINARY(_AND_NOT, dst, stack[depth - 1], stack[depth], len);
+        break;
+      }
+      stack[depth - 1] = dst;
+    }
+    // NOT may have set the padding bits past length in the last qword
+    if (k_b + len == size_in_qwords) {
+      count += count_qwords(stack[0], len - 1);
+      count += (int)POPCOUNT(stack[0][len - 1] & tail);
+    } else {
+      count += count_qwords(stack[0], len);
+    }
+  }
+  return count;
+}
+
+/* Values common to the sorted, duplicate-free arrays a and b, in order into
+   out (unless NULL); returns how many. Blocks of 8 values of a are compared
+   with the 8 rotations of the current block of b, as in the vectorized
+   intersection of Roaring, and the block with the smaller last value moves
+   on; the tails past the last whole blocks merge */
+static int array_inter(const uint16_t *a, int na, const uint16_t *b, int nb,
+                       uint16_t *out) {
+  int i = 0, j = 0, n = 0;
+#if !BIT_SIMD_PATH_SCALAR
+  const int a_blocks = na & ~7, b_blocks = nb & ~7;
+  while (i < a_blocks && j < b_blocks) {
+    const simde__m128i va = simde_mm_loadu_si128((const simde__m128i *)&a[i]);
+    const simde__m128i vb = simde_mm_loadu_si128((const simde__m128i *)&b[j]);
+    simde__m128i eq = simde_mm_cmpeq_epi16(va, vb);
+    eq = simde_mm_or_si128(
+        eq, simde_mm_cmpeq_epi16(va, simde_mm_alignr_epi8(vb, vb, 2)));
+    eq = simde_mm_or_si128(
+        eq, simde_mm_cmpeq_epi16(va, simde_mm_alignr_epi8(vb, vb, 4)));
+    eq = simde_mm_or_si128(
+        eq, simde_mm_cmpeq_epi16(va, simde_mm_alignr_epi8(vb, vb, 6)));
+    eq = simde_mm_or_si128(
+        eq, simde_mm_cmpeq_epi16(va, simde_mm_alignr_epi8(vb, vb, 8)));
+    eq = simde_mm_or_si128(
+        eq, simde_mm_cmpeq_epi16(va, simde_mm_alignr_epi8(vb, vb, 10)));
+    eq = simde_mm_or_si128(
+        eq, simde_mm_cmpeq_epi16(va, simde_mm_alignr_epi8(vb, vb, 12)));
+    eq = simde_mm_or_si128(
+        eq, simde_mm_cmpeq_epi16(va, simde_mm_alignr_epi8(vb, vb, 14)));
+    // two mask bits per matching lane of a
+    for (unsigned int mask = (unsigned int)simde_mm_movemask_epi8(eq); mask;
+         mask &= mask - 1, mask &= mask - 1) {
+      if (out)
+        out[n] = a[i + __builtin_ctz(mask) / 2];
+      n++;
+    }
+    const uint16_t a_last = a[i + 7], b_last = b[j + 7];
+    if (a_last <= b_last)
+      i += 8;
+    if (b_last <= a_last)
+      j += 8;
+  }
+#endif
+  while (i < na && j < nb) {
+    if (a[i] < b[j]) {
+      i++;
+    } else if (b[j] < a[i]) {
+      j++;
+    } else {
+      if (out)
+        out[n] = a[i];
+      n++, i++, j++;
+    }
+  }
+  return n;
+}
+
+/* Set bits of row at the n positions of pos. The AVX2 and AVX-512 tiers
+   gather the 32-bit word of 8 positions at a time, instead of streaming the
+   whole row (SIMDe has no 512-bit gather) */
+static int sparse_count(const uint32_t *pos, int n, const uint64_t *row) {
+  int i = 0, count = 0;
+#if defined(BIT_SIMD_PATH_AVX512) || defined(BIT_SIMD_PATH_AVX2)
+  const simde__m256i low = simde_mm256_set1_epi32(31);
+  const simde__m256i one = simde_mm256_set1_epi32(1);
+  simde__m256i sum = simde_mm256_setzero_si256();
+  for (; i + 8 <= n; i += 8) {
+    const simde__m256i p =
+        simde_mm256_loadu_si256((const simde__m256i *)&pos[i]);
+    const simde__m256i words = simde_mm256_i32gather_epi32(
+        (const int32_t *)row, simde_mm256_srli_epi32(p, 5), 4);
+    sum = simde_mm256_add_epi32(
+        sum, simde_mm256_and_si256(
+                 simde_mm256_srlv_epi32(words, simde_mm256_and_si256(p, low)),
+                 one));
+  }
+  int32_t lanes[8];
+  simde_mm256_storeu_si256((simde__m256i *)lanes, sum);
+  for (int k = 0; k < 8; k++)
+    count += lanes[k];
+#endif
+  for (; i < n; i++)
+    count += (int)((row[pos[i] / 64] >> (pos[i] % 64)) & 1);
+  return count;
+}
+
+/* The positions base + i of the set bits i of nq qwords into out, in
+   increasing order, at most room of them; returns how many. The AVX-512
+   tier compresses 16 lane indices under each 16 bits of a word
+   (vpcompressd); the AVX2 and 128-bit tiers widen the positions of each
+   byte from decode_bytes and store 8 of them whatever the byte holds, so
+   a word is decoded that way only with 8 ints to spare past its positions */
+static size_t decode_qwords(const uint64_t *qwords, size_t nq, int base,
+                            int *out, size_t room) {
+  size_t n = 0;
+#if defined(BIT_SIMD_PATH_AVX512)
+  const simde__m512i iota = simde_mm512_setr_epi32(
+      0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15);
+#endif
+  for (size_t w = 0; w < nq && n < room; w++) {
+    uint64_t word = qwords[w];
+    if (word == 0)
+      continue;
+    const int at = base + (int)(w * 64);
+    if (n + (size_t)POPCOUNT(word) + 8 > room) { // the last positions
+      for (; word && n < room; word &= word - 1)
+        out[n++] = at + __builtin_ctzll(word);
+      continue;
+    }
+#if defined(BIT_SIMD_PATH_AVX512)
+    for (int k = 0; k < 4; k++) {
+      const simde__mmask16 mask = (simde__mmask16)(word >> (16 * k));
+      if (mask == 0)
+        continue;
+      simde_mm512_mask_compressstoreu_epi32(
+          out + n, mask,
+          simde_mm512_add_epi32(iota, simde_mm512_set1_epi32(at + 16 * k)));
+      n += (size_t)POPCOUNT((uint64_t)mask);
+    }
+#elif defined(BIT_SIMD_PATH_AVX2)
+    for (int b = 0; b < 8; b++) {
+      const unsigned int v = (unsigned int)(word >> (8 * b)) & 0xFF;
+      if (v == 0)
+        continue;
+      const simde__m256i p = simde_mm256_cvtepu8_epi32(
+          simde_mm_cvtsi64_si128((int64_t)decode_bytes[v]));
+      simde_mm256_storeu_si256(
+          (simde__m256i *)(out + n),
+          simde_mm256_add_epi32(p, simde_mm256_set1_epi32(at + 8 * b)));
+      n += (size_t)POPCOUNT((uint64_t)v);
+    }
+#elif defined(BIT_SIMD_PATH_128)
+    for (int b = 0; b < 8; b++) {
+      const unsigned int v = (unsigned int)(word >> (8 * b)) & 0xFF;
+      if (v == 0)
+        continue;
+      const simde__m128i bytes =
+          simde_mm_cvtsi64_si128((int64_t)decode_bytes[v]);
+      const simde__m128i offset = simde_mm_set1_epi32(at + 8 * b);
+      simde_mm_storeu_si128(
+          (simde__m128i *)(out + n),
+          simde_mm_add_epi32(simde_mm_cvtepu8_epi32(bytes), offset));
+      simde_mm_storeu_si128(
+          (simde__m128i *)(out + n + 4),
+          simde_mm_add_epi32(
+              simde_mm_cvtepu8_epi32(simde_mm_srli_si128(bytes, 4)), offset));
+      n += (size_t)POPCOUNT((uint64_t)v);
+    }
+#else
+    for (; word; word &= word - 1)
+      out[n++] = at + __builtin_ctzll(word);
+#endif
+  }
+  return n;
+}
+
+/* Counts of the lanes of a packed short-row word: op of q, the query in
+   every lane, and the word, popcounted lane by lane by halving the fields
+   of the usual SWAR popcount down to LANE bits. A lane counts at most 32
+   bits, so its low byte holds the count. LANE is a constant, so the word
+   loop vectorizes on every tier */
+#define PACKED_COUNT_LOOP(op, LANE)                                            \
+  OMP_CPU_SIMD                                                                 \
+  for (size_t w = 0; w < nwords; w++) {                                        \
+    uint64_t x = BIT_SCALAR##op(q, words[w]);                                  \
+    x = x - ((x >> 1) & UINT64_C(0x5555555555555555));                         \
+    x = (x & UINT64_C(0x3333333333333333)) +                                   \
+        ((x >> 2) & UINT64_C(0x3333333333333333));                             \
+    x = (x + (x >> 4)) & UINT64_C(0x0F0F0F0F0F0F0F0F);                         \
+    if (LANE >= 16)                                                            \
+      x = (x + (x >> 8)) & UINT64_C(0x00FF00FF00FF00FF);                       \
+    if (LANE >= 32)                                                            \
+      x = (x + (x >> 16)) & UINT64_C(0x0000FFFF0000FFFF);                      \
+    for (int l = 0; l < 64 / LANE; l++)                                        \
+      counts[w * (64 / LANE) + l] = (int)((x >> (LANE * l)) & 0xFF);           \
+  }
+
+#define PACKED_COUNT_CASES(op)                                                 \
+  switch (lane_bits) {                                                         \
+  case 8:                                                                      \
+    PACKED_COUNT_LOOP(op, 8)                                                   \
+    break;                                                                     \
+  case 16:                                                                     \
+    PACKED_COUNT_LOOP(op, 16)                                                  \
+    break;                                                                     \
+  default:                                                                     \
+    PACKED_COUNT_LOOP(op, 32)                                                  \
+    break;                                                                     \
+  }
+
+/* Op counts of the 64 / lane_bits rows of each of nwords words of a packed
+   short-row container (Bit_PDB_T) against q, a row repeated in every lane,
+   into counts, one per lane */
+static void packed_count(bit_setop_id op, int lane_bits, uint64_t q,
+                         const uint64_t *restrict words, size_t nwords,
+                         int *restrict counts) {
+  switch (op) {
+  case BIT_OP_AND:
+    PACKED_COUNT_CASES(_AND)
+    break;
+  case BIT_OP_OR:
+    PACKED_COUNT_CASES(_OR)
+    break;
+  case BIT_OP_XOR:
+    PACKED_COUNT_CASES(_XOR)
+    break;
+  default: // BIT_OP_AND_NOT
+    PACKED_COUNT_CASES(_AND_NOT)
+    break;
+  }
+}
+
+/* Weighted count of op(a, b) over nwords words: the sum of the weights of
+   its set bits, read nibble by nibble from the tables of a Bit_W_T (16
+   partial sums per nibble of the row, 256 per word). The sixteen lookups of
+   a word are gathers once the word loop vectorizes */
+#define WEIGHTED_COUNT_LOOP(op)                                                \
+  _Pragma("omp simd reduction(+ : sum)")                                       \
+  for (size_t w = 0; w < nwords; w++) {                                        \
+    const uint64_t x = BIT_SCALAR##op(a[w], b[w]);                             \
+    const float *t = table + w * 256;                                          \
+    for (int n = 0; n < 16; n++)                                               \
+      sum += t[n * 16 + ((x >> (4 * n)) & 15)];                                \
+  }
+
+static float weighted_count(bit_setop_id op, const uint64_t *restrict a,
+                            const uint64_t *restrict b, size_t nwords,
+                            const float *restrict table) {
+  float sum = 0.0f;
+  switch (op) {
+  case BIT_OP_AND:
+    WEIGHTED_COUNT_LOOP(_AND)
+    break;
+  case BIT_OP_OR:
+    WEIGHTED_COUNT_LOOP(_OR)
+    break;
+  case BIT_OP_XOR:
+    WEIGHTED_COUNT_LOOP(_XOR)
+    break;
+  default: // BIT_OP_AND_NOT
+    WEIGHTED_COUNT_LOOP(_AND_NOT)
+    break;
+  }
+  return sum;
+}
+
+/* Bit i of words set iff counts[i] >= threshold, for n counts; the
+   ceil(n / 64) words are written whole, bits past n clear. Counts are never
+   negative, so the test is count > below with below >= -1, one compare to
+   a lane mask per vector (vpcmpd on the AVX-512 tier, pcmpgtd and a sign
+   movemask on the others) */
+static void threshold_pack(const int *restrict counts, size_t n, int threshold,
+                           uint64_t *restrict words) {
+  const int below = threshold > 0 ? threshold - 1 : -1;
+  size_t i = 0;
+  for (; i + 64 <= n; i += 64) {
+    uint64_t word = 0;
+#if defined(BIT_SIMD_PATH_AVX512)
+    const simde__m512i t = simde_mm512_set1_epi32(below);
+    for (int k = 0; k < 4; k++)
+      word |= (uint64_t)simde_mm512_cmpgt_epi32_mask(
+                  simde_mm512_loadu_si512(counts + i + 16 * k), t)
+              << (16 * k);
+#elif defined(BIT_SIMD_PATH_AVX2)
+    const simde__m256i t = simde_mm256_set1_epi32(below);
+    for (int k = 0; k < 8; k++)
+      word |= (uint64_t)(unsigned int)simde_mm256_movemask_ps(
+                  simde_mm256_castsi256_ps(simde_mm256_cmpgt_epi32(
+                      simde_mm256_loadu_si256(
+                          (const simde__m256i *)(counts + i + 8 * k)),
+                      t)))
+              << (8 * k);
+#elif defined(BIT_SIMD_PATH_128)
+    const simde__m128i t = simde_mm_set1_epi32(below);
+    for (int k = 0; k < 16; k++)
+      word |= (uint64_t)(unsigned int)simde_mm_movemask_ps(
+                  simde_mm_castsi128_ps(simde_mm_cmpgt_epi32(
+                      simde_mm_loadu_si128(
+                          (const simde__m128i *)(counts + i + 4 * k)),
+                      t)))
+              << (4 * k);
+#else
+    for (int k = 0; k < 64; k++)
+      word |= (uint64_t)(counts[i + k] > below) << k;
+#endif
+    words[i / 64] = word;
+  }
+  if (i < n) { // the last, partial word
+    uint64_t word = 0;
+    for (size_t k = 0; i + k < n; k++)
+      word |= (uint64_t)(counts[i + k] > below) << k;
+    words[i / 64] = word;
+  }
+}
+
+/* Blocked Bloom filter probes (Bit_BF_T). A key picks one 512-bit block
+   and sets one bit in k of its 16 32-bit lanes, the lanes starting at a
+   hashed one and wrapping around. The bit of lane i is the top 5 bits of
+   the low hash word times an odd salt, so all 16 come out of one multiply
+   and shift on the AVX-512 tier (two on the AVX2 tier). Batches hash and
+   prefetch BLOOM_BATCH keys before probing any of them, so the cache
+   misses of a batch overlap instead of following each other */
+#define BLOOM_BATCH 16
+
+static const uint32_t bloom_salts[16] = {
+    0x47b6137bU, 0x44974d91U, 0x8824ad5bU, 0xa2b7289dU,
+    0x705495c7U, 0x2df1424bU, 0x9efc4947U, 0x5c6bfb31U,
+    0x9e3779b1U, 0x85ebca77U, 0xc2b2ae3dU, 0x27d4eb2fU,
+    0x165667b1U, 0xd3a2646dU, 0xfd7046c5U, 0xb55a4f09U};
+
+static inline uint64_t bloom_hash(uint64_t key) { // splitmix64 finalizer
+  key ^= key >> 30;
+  key *= UINT64_C(0xbf58476d1ce4e5b9);
+  key ^= key >> 27;
+  key *= UINT64_C(0x94d049bb133111eb);
+  return key ^ (key >> 31);
+}
+
+static inline uint64_t *bloom_block(uint64_t *blocks, uint32_t nblocks,
+                                    uint64_t h) {
+  return blocks + (((h >> 32) * nblocks) >> 32) * 8;
+}
+
+/* The k lanes of the key of hash h, one bit each */
+static inline uint32_t bloom_lanes(uint64_t h, int k) {
+  const uint32_t first = (uint32_t)(h >> 32) & 15;
+  const uint32_t lanes = (UINT32_C(1) << k) - 1;
+  return (lanes << first | lanes >> (16 - first)) & 0xffff;
+}
+
+/* The bits of the key of hash h in its block */
+static inline void bloom_bits(uint64_t h, int k, uint64_t bits[8]) {
+  const uint32_t lanes = bloom_lanes(h, k);
+#if defined(BIT_SIMD_PATH_AVX512)
+  const simde__m512i shift = simde_mm512_srli_epi32(
+      simde_mm512_mullo_epi32(simde_mm512_set1_epi32((int32_t)h),
+                              simde_mm512_loadu_si512(bloom_salts)),
+      27);
+  simde_mm512_storeu_si512(
+      bits, simde_mm512_maskz_mov_epi32(
+                (simde__mmask16)lanes,
+                simde_mm512_sllv_epi32(simde_mm512_set1_epi32(1), shift)));
+#elif defined(BIT_SIMD_PATH_AVX2)
+  const simde__m256i lane = simde_mm256_setr_epi32(1, 2, 4, 8, 16, 32, 64, 128);
+  for (int half = 0; half < 2; half++) {
+    const simde__m256i shift = simde_mm256_srli_epi32(
+        simde_mm256_mullo_epi32(
+            simde_mm256_set1_epi32((int32_t)h),
+            simde_mm256_loadu_si256(
+                (const simde__m256i *)(bloom_salts + 8 * half))),
+        27);
+    const simde__m256i on = simde_mm256_cmpeq_epi32(
+        simde_mm256_and_si256(
+            simde_mm256_set1_epi32((int32_t)(lanes >> (8 * half))), lane),
+        lane);
+    simde_mm256_storeu_si256(
+        (simde__m256i *)(bits + 4 * half),
+        simde_mm256_and_si256(
+            simde_mm256_sllv_epi32(simde_mm256_set1_epi32(1), shift), on));
+  }
+#else
+  for (int w = 0; w < 8; w++)
+    bits[w] = 0;
+  for (int i = 0; i < 16; i++)
+    if (lanes >> i & 1)
+      bits[i / 2] |= (uint64_t)(UINT32_C(1) << ((uint32_t)h * bloom_salts[i] >>
+                                                 27))
+                     << (32 * (i & 1));
+#endif
+}
+
+static void bloom_insert(uint64_t *blocks, uint32_t nblocks, int k,
+                         const uint64_t *keys, int n) {
+  uint64_t h[BLOOM_BATCH];
+  for (int i = 0; i < n; i += BLOOM_BATCH) {
+    const int m = n - i < BLOOM_BATCH ? n - i : BLOOM_BATCH;
+    for (int j = 0; j < m; j++) {
+      h[j] = bloom_hash(keys[i + j]);
+      __builtin_prefetch(bloom_block(blocks, nblocks, h[j]), 1, 3);
+    }
+    for (int j = 0; j < m; j++) {
+      uint64_t bits[8], *block = bloom_block(blocks, nblocks, h[j]);
+      bloom_bits(h[j], k, bits);
+      for (int w = 0; w < 8; w++)
+        block[w] |= bits[w];
+    }
+  }
+}
+
+/* Keys that may be in the filter; out[i] is 1 for them and 0 for the
+   others (out may be NULL) */
+static int bloom_contains(const uint64_t *blocks, uint32_t nblocks, int k,
+                          const uint64_t *keys, int n, int *out) {
+  uint64_t h[BLOOM_BATCH];
+  int found = 0;
+  for (int i = 0; i < n; i += BLOOM_BATCH) {
+    const int m = n - i < BLOOM_BATCH ? n - i : BLOOM_BATCH;
+    for (int j = 0; j < m; j++) {
+      h[j] = bloom_hash(keys[i + j]);
+      __builtin_prefetch(bloom_block((uint64_t *)blocks, nblocks, h[j]), 0, 3);
+    }
+    for (int j = 0; j < m; j++) {
+      uint64_t bits[8], missing = 0;
+      const uint64_t *block = bloom_block((uint64_t *)blocks, nblocks, h[j]);
+      bloom_bits(h[j], k, bits);
+      for (int w = 0; w < 8; w++)
+        missing |= bits[w] & ~block[w];
+      found += missing == 0;
+      if (out)
+        out[i + j] = missing == 0;
+    }
+  }
+  return found;
+}
+
+/* Transposes a 64 x 64 bit block in place: bit c of a[r] trades places
+   with bit r of a[c]. Six rounds swap the off-diagonal halves of ever
+   smaller sub-blocks, each as 32 independent masked swaps that the simd
+   loop runs a vector of rows at a time */
+static void transpose64(uint64_t a[64]) {
+  uint64_t m = UINT64_C(0x00000000ffffffff);
+  for (int j = 32; j != 0; j >>= 1, m ^= m << j) {
+    OMP_CPU_SIMD
+    for (int i = 0; i < 32; i++) {
+      const int k = (i & ~(j - 1)) * 2 + (i & (j - 1));
+      const uint64_t t = ((a[k] >> j) ^ a[k + j]) & m;
+      a[k] ^= t << j;
+      a[k + j] ^= t;
+    }
+  }
+}
+
+/* Funnel shift of a bitset: dst = src moved by shift bit positions towards
+   the higher ones (a negative shift moves towards the lower ones), over nq
+   qwords, with zeros shifted in; with accumulate dst |= that instead. Each
+   output qword joins two neighbouring input qwords, which the vector tiers
+   load unaligned and join with one 64-bit shift each. dst may be src: a
+   left shift walks down from the top qword and a right shift walks up from
+   the bottom, so every qword is read before it is overwritten */
+#if defined(BIT_SIMD_PATH_AVX512)
+#define SHIFT_SLL simde_mm512_sll_epi64
+#define SHIFT_SRL simde_mm512_srl_epi64
+#elif defined(BIT_SIMD_PATH_AVX2)
+#define SHIFT_SLL simde_mm256_sll_epi64
+#define SHIFT_SRL simde_mm256_srl_epi64
+#elif !BIT_SIMD_PATH_SCALAR
+#define SHIFT_SLL simde_mm_sll_epi64
+#define SHIFT_SRL simde_mm_srl_epi64
+#endif
+
+static inline uint64_t shift_word(const uint64_t *src, size_t nq, size_t w,
+                                  size_t words, unsigned int bits, bool left) {
+  uint64_t near = 0, far = 0; // the qword w comes from, the one beyond it
+  if (left) {
+    near = w >= words ? src[w - words] : 0;
+    far = w >= words + 1 ? src[w - words - 1] : 0;
+    return bits ? near << bits | far >> (64 - bits) : near;
+  }
+  near = w + words < nq ? src[w + words] : 0;
+  far = w + words + 1 < nq ? src[w + words + 1] : 0;
+  return bits ? near >> bits | far << (64 - bits) : near;
+}
+
+static void shift_qwords(uint64_t *dst, const uint64_t *src, size_t nq,
+                         long long shift, bool accumulate) {
+  const bool left = shift >= 0;
+  const unsigned long long distance =
+      left ? (unsigned long long)shift : 0ULL - (unsigned long long)shift;
+  const size_t words =
+      distance / 64 < nq ? (size_t)(distance / 64) : nq; // all zeros past nq
+  const unsigned int bits = (unsigned int)(distance % 64);
+  size_t w = 0; // left: qwords [0, w) remain; right: [0, w) are done
+#ifdef SHIFT_SLL
+  const simde__m128i near_count = simde_mm_cvtsi64_si128((long long)bits);
+  const simde__m128i far_count = simde_mm_cvtsi64_si128(64 - (long long)bits);
+#endif
+  if (left) {
+    w = nq;
+#ifdef SHIFT_SLL
+    // vectors whose far qwords are all inside src
+    for (; w >= words + 1 + VECTOR_QWORDS; w -= VECTOR_QWORDS) {
+      const size_t lo = w - VECTOR_QWORDS;
+      const VECTOR_TYPE near =
+          VECTOR_UNALIGNED_LOAD((const VECTOR_TYPE *)&src[lo - words]);
+      const VECTOR_TYPE far =
+          VECTOR_UNALIGNED_LOAD((const VECTOR_TYPE *)&src[lo - words - 1]);
+      VECTOR_TYPE v = BIT_OR(SHIFT_SLL(near, near_count),
+                             SHIFT_SRL(far, far_count));
+      if (accumulate)
+        v = BIT_OR(v, VECTOR_UNALIGNED_LOAD((const VECTOR_TYPE *)&dst[lo]));
+      VECTOR_UNALIGNED_STORE((VECTOR_TYPE *)&dst[lo], v);
+    }
+#endif
+    while (w-- > 0) {
+      const uint64_t v = shift_word(src, nq, w, words, bits, true);
+      dst[w] = accumulate ? dst[w] | v : v;
+    }
+    return;
+  }
+#ifdef SHIFT_SLL
+  for (; w + words + 1 + VECTOR_QWORDS <= nq; w += VECTOR_QWORDS) {
+    const VECTOR_TYPE near =
+        VECTOR_UNALIGNED_LOAD((const VECTOR_TYPE *)&src[w + words]);
+    const VECTOR_TYPE far =
+        VECTOR_UNALIGNED_LOAD((const VECTOR_TYPE *)&src[w + words + 1]);
+    VECTOR_TYPE v =
+        BIT_OR(SHIFT_SRL(near, near_count), SHIFT_SLL(far, far_count));
+    if (accumulate)
+      v = BIT_OR(v, VECTOR_UNALIGNED_LOAD((const VECTOR_TYPE *)&dst[w]));
+    VECTOR_UNALIGNED_STORE((VECTOR_TYPE *)&dst[w], v);
+  }
+#endif
+  for (; w < nq; w++) {
+    const uint64_t v = shift_word(src, nq, w, words, bits, false);
+    dst[w] = accumulate ? dst[w] | v : v;
+  }
+}
+
+/* Word-at-a-time hash of nq qwords: eight 64-bit lanes, each taking every
+   eighth qword of the stripes of eight qwords, accumulate the product of
+   the 32-bit halves of data ^ key plus the data (an xxh3-style round), and
+   are scrambled after every HASH_BLOCK_STRIPES stripes. The lanes and the
+   qwords past the last full stripe are then folded in order through the
+   splitmix64 finalizer. The lanes are fixed, so a vector tier runs them one
+   (AVX-512), two (AVX2) or four (128-bit) vectors at a time and every tier
+   returns the same hash */
+#define HASH_LANES 8
+#define HASH_BLOCK_STRIPES 16
+#define HASH_STEP UINT64_C(0x9e3779b97f4a7c15)
+#define HASH_PRIME32 UINT64_C(0x9e3779b1)
+
+static const uint64_t hash_secret[HASH_LANES] = {
+    UINT64_C(0xbe4ba423396cfeb8), UINT64_C(0x1cad21f72c81017c),
+    UINT64_C(0xdb979083e96dd4de), UINT64_C(0x1f67b3b7a4a44072),
+    UINT64_C(0x78e5c0cc4ee679cb), UINT64_C(0x2172ffcc7dd05a82),
+    UINT64_C(0x8e2443f7744608b8), UINT64_C(0x4c263a81e69035e0)};
+
+#if defined(BIT_SIMD_PATH_AVX512)
+#define HASH_MUL32 simde_mm512_mul_epu32
+#define HASH_SRLI simde_mm512_srli_epi64
+#define HASH_SLLI simde_mm512_slli_epi64
+#define HASH_SET1(x) simde_mm512_set1_epi64((int64_t)(x))
+#elif defined(BIT_SIMD_PATH_AVX2)
+#define HASH_MUL32 simde_mm256_mul_epu32
+#define HASH_SRLI simde_mm256_srli_epi64
+#define HASH_SLLI simde_mm256_slli_epi64
+#define HASH_SET1(x) simde_mm256_set1_epi64x((int64_t)(x))
+#elif !BIT_SIMD_PATH_SCALAR
+#define HASH_MUL32 simde_mm_mul_epu32
+#define HASH_SRLI simde_mm_srli_epi64
+#define HASH_SLLI simde_mm_slli_epi64
+#define HASH_SET1(x) simde_mm_set1_epi64x((int64_t)(x))
+#endif
+
+static uint64_t hash_qwords(const uint64_t *qwords, size_t nq, uint64_t seed) {
+  const size_t stripes = nq / HASH_LANES;
+  uint64_t acc[HASH_LANES];
+#ifdef HASH_MUL32
+  enum { NV = HASH_LANES / VECTOR_QWORDS };
+  VECTOR_TYPE vacc[NV], secret[NV];
+  const VECTOR_TYPE prime = HASH_SET1(HASH_PRIME32);
+  for (int v = 0; v < NV; v++) {
+    secret[v] = VECTOR_UNALIGNED_LOAD(
+        (const VECTOR_TYPE *)&hash_secret[v * VECTOR_QWORDS]);
+    vacc[v] = BIT_XOR(secret[v], HASH_SET1(seed));
+  }
+  for (size_t s = 0; s < stripes; s++) {
+    const VECTOR_TYPE step = HASH_SET1((s % HASH_BLOCK_STRIPES) * HASH_STEP);
+    for (int v = 0; v < NV; v++) {
+      const VECTOR_TYPE data = VECTOR_UNALIGNED_LOAD(
+          (const VECTOR_TYPE *)&qwords[s * HASH_LANES + v * VECTOR_QWORDS]);
+      const VECTOR_TYPE dk = BIT_XOR(data, SIMDe_VECTOR_ADD(secret[v], step));
+      vacc[v] = SIMDe_VECTOR_ADD(
+          vacc[v], SIMDe_VECTOR_ADD(HASH_MUL32(dk, HASH_SRLI(dk, 32)), data));
+    }
+    if (s % HASH_BLOCK_STRIPES == HASH_BLOCK_STRIPES - 1)
+      for (int v = 0; v < NV; v++) {
+        const VECTOR_TYPE t =
+            BIT_XOR(BIT_XOR(vacc[v], HASH_SRLI(vacc[v], 47)), secret[v]);
+        vacc[v] = SIMDe_VECTOR_ADD(
+            HASH_MUL32(t, prime), HASH_SLLI(HASH_MUL32(HASH_SRLI(t, 32), prime),
+                                            32)); // t * prime, 64 bits
+      }
+  }
+  for (int v = 0; v < NV; v++)
+    VECTOR_UNALIGNED_STORE((VECTOR_TYPE *)&acc[v * VECTOR_QWORDS], vacc[v]);
+#else
+  for (int l = 0; l < HASH_LANES; l++)
+    acc[l] = hash_secret[l] ^ seed;
+  for (size_t s = 0; s < stripes; s++) {
+    const uint64_t step = (s % HASH_BLOCK_STRIPES) * HASH_STEP;
+    OMP_CPU_SIMD
+    for (int l = 0; l < HASH_LANES; l++) {
+      const uint64_t data = qwords[s * HASH_LANES + l];
+      const uint64_t dk = data ^ (hash_secret[l] + step);
+      acc[l] += (dk & UINT32_MAX) * (dk >> 32) + data;
+    }
+    if (s % HASH_BLOCK_STRIPES == HASH_BLOCK_STRIPES - 1)
+      for (int l = 0; l < HASH_LANES; l++)
+        acc[l] = (acc[l] ^ acc[l] >> 47 ^ hash_secret[l]) * HASH_PRIME32;
+  }
+#endif
+  uint64_t h = seed ^ (uint64_t)nq * HASH_STEP;
+  for (int l = 0; l < HASH_LANES; l++)
+    h = bloom_hash(h ^ acc[l]);
+  for (size_t i = stripes * HASH_LANES; i < nq; i++)
+    h = bloom_hash(h ^ (qwords[i] + hash_secret[i % HASH_LANES]));
+  return h;
+}
+
+/* --- End Section 8: INTERNAL HELPER FUNCTION DEFINITIONS --- */
+
+/* ==========================================================================
+   SECTION 9: PUBLIC API
+   Kernel table exported by this ISA variant.
+   ========================================================================== */
+
+/* Bulk popcount of POPULATION_COUNT: the branch libpopcnt's popcnt takes
+   for large buffers, fixed by the flags of this variant where they enable
+   it and by CPUID otherwise */
+static const char *popcount_algorithm(void) {
+#if !USE_LIBPOPCNT
+  return "wwg";
+#elif defined(LIBPOPCNT_X86_OR_X64)
+#if defined(LIBPOPCNT_HAVE_CPUID)
+  const int cpuid = get_cpuid();
+#endif
+#if defined(LIBPOPCNT_HAVE_AVX512)
+#if defined(__AVX512__) ||                                                      \
+    (defined(__AVX512F__) && defined(__AVX512BW__) &&                          \
+     defined(__AVX512VPOPCNTDQ__))
+  return "libpopcnt-avx512";
+#elif defined(LIBPOPCNT_HAVE_CPUID)
+  if (cpuid & LIBPOPCNT_BIT_AVX512_VPOPCNTDQ)
+    return "libpopcnt-avx512";
+#endif
+#endif
+#if defined(LIBPOPCNT_HAVE_AVX2)
+#if defined(__AVX2__)
+  return "libpopcnt-avx2";
+#elif defined(LIBPOPCNT_HAVE_CPUID)
+  if (cpuid & LIBPOPCNT_BIT_AVX2)
+    return "libpopcnt-avx2";
+#endif
+#endif
+#if defined(LIBPOPCNT_HAVE_POPCNT)
+#if defined(__POPCNT__)
+  return "libpopcnt-popcnt";
+#elif defined(LIBPOPCNT_HAVE_CPUID)
+  if (cpuid & LIBPOPCNT_BIT_POPCNT)
+    return "libpopcnt-popcnt";
+#endif
+#endif
+  return "libpopcnt-bitwise";
+#elif defined(__ARM_FEATURE_SVE) && __has_include(<arm_sve.h>)
+  return "libpopcnt-sve";
+#elif (defined(__ARM_NEON) || defined(__aarch64__) || defined(_M_ARM64)) && \
+    __has_include(<arm_neon.h>)
+  return "libpopcnt-neon";
+#else
+  return "libpopcnt-bitwise";
+#endif
+}
+
+#if defined(BIT_SIMD_PATH_SVE)
+#define BIT_KERNEL_SIMD "sve"
+#elif defined(BIT_SIMD_PATH_NEON)
+#define BIT_KERNEL_SIMD "neon"
+#elif defined(BIT_SIMD_PATH_AVX512)
+#define BIT_KERNEL_SIMD "avx512"
+#elif defined(BIT_SIMD_PATH_AVX2)
+#define BIT_KERNEL_SIMD "avx2"
+#elif defined(BIT_SIMD_PATH_128)
+#define BIT_KERNEL_SIMD "128"
+#else
+#define BIT_KERNEL_SIMD "scalar"
+#endif
+
+const bit_kernel_table BIT_KERNEL_CAT(bit_kernels, BIT_KERNEL_ISA) = {
+    .isa = BIT_KERNEL_XSTR(BIT_KERNEL_ISA),
+    .simd = BIT_KERNEL_SIMD,
+    .popcount = popcount_algorithm,
+    .setop = {setop_and, setop_or, setop_xor, setop_and_not},
+    .setop_count = {setop_count_and, setop_count_or, setop_count_xor,
+                    setop_count_and_not},
+    .setop_any = {setop_any_and, setop_any_or, setop_any_xor,
+                  setop_any_and_not},
+    .count = bitset_count,
+    .count_qwords = count_qwords,
+    .rank_build = rank_build,
+    .expr_count = expr_count,
+    .array_inter = array_inter,
+    .sparse_count = sparse_count,
+    .decode_qwords = decode_qwords,
+    .packed_count = packed_count,
+    .weighted_count = weighted_count,
+    .threshold_pack = threshold_pack,
+    .bloom_insert = bloom_insert,
+    .bloom_contains = bloom_contains,
+    .transpose64 = transpose64,
+    .shift_qwords = shift_qwords,
+    .hash_qwords = hash_qwords,
+    .setop_count_db = {setop_count_db_and, setop_count_db_or,
+                       setop_count_db_xor, setop_count_db_and_not},
+    .setop_count_query = {setop_count_query_and, setop_count_query_or,
+                          setop_count_query_xor, setop_count_query_and_not},
+    .setop_count_rows = {setop_count_rows_and, setop_count_rows_or,
+                         setop_count_rows_xor, setop_count_rows_and_not},
+    .count_variants = gen_count_variants,
+    .ncount_variants = BIT_GEN_COUNT_VARIANTS,
+};
+
+/* --- End Section 9: PUBLIC API --- */
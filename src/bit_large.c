@@ -0,0 +1,365 @@
+/*
+    Bitsets of 64-bit length (Bit_L_T, see include/bit.h).
+
+    A Bit_L_T is a Bit_T past INT_MAX bits: qwords aligned to ALIGNMENT with
+    the bits past the length kept zero, indexed by int64_t. Whole-set
+    operations split the qwords into blocks of BIT_L_BLOCK_QWORDS that go
+    through the set operation and popcount kernels of bit_kernels_active()
+    behind stack Bit_T headers, one OpenMP thread per block once a set has
+    BIT_L_PARALLEL_QWORDS qwords, as a single core cannot stream a set of
+    gigabytes at the bandwidth of the memory.
+
+    * License : BSD-2
+*/
+
+/* ==========================================================================
+   SECTION 1: INCLUDES
+   Standard library headers first, then project headers.
+   ========================================================================== */
+
+#include "bit.h"
+#include "omp.h"
+#include <assert.h>
+#include <limits.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "bit_internal.h"
+
+/* --- End Section 1: INCLUDES --- */
+
+/* ==========================================================================
+   SECTION 2: COMPILE-TIME CONFIGURATION
+   File-local compile-time constants, build-time defaults, and feature flags.
+   ========================================================================== */
+
+/* Qwords per kernel call: 8 MiB, so that counts of a block fit an int */
+#ifndef BIT_L_BLOCK_QWORDS
+#define BIT_L_BLOCK_QWORDS (1u << 20)
+#endif
+
+/* Sets smaller than this (16 MiB) stay on the calling thread */
+#ifndef BIT_L_PARALLEL_QWORDS
+#define BIT_L_PARALLEL_QWORDS (UINT64_C(1) << 21)
+#endif
+
+/* --- End Section 2: COMPILE-TIME CONFIGURATION --- */
+
+/* ==========================================================================
+   SECTION 3: INFRASTRUCTURAL MACROS
+   Private macros used by helper functions and low-level operations.
+   ========================================================================== */
+
+#define L_NQWORDS(length) (((uint64_t)(length) + BPQW - 1) / BPQW)
+#define L_NBLOCKS(nq) (((nq) + BIT_L_BLOCK_QWORDS - 1) / BIT_L_BLOCK_QWORDS)
+#define L_PARALLEL(nq) ((nq) >= BIT_L_PARALLEL_QWORDS)
+
+/* --- End Section 3: INFRASTRUCTURAL MACROS --- */
+
+/* ==========================================================================
+   SECTION 5: INTERNAL DATA STRUCTURES AND ENUMS
+   Types used only inside this translation unit.
+   ========================================================================== */
+
+/* struct T_L is in bit_internal.h, for the device functions of bit_gpu.c */
+
+/* What a range operation does to the bits of its range */
+typedef enum { RANGE_SET, RANGE_CLEAR, RANGE_NOT } range_op;
+
+/* --- End Section 5: INTERNAL DATA STRUCTURES AND ENUMS --- */
+
+/* ==========================================================================
+   SECTION 8: INTERNAL HELPER FUNCTION DEFINITIONS
+   ========================================================================== */
+
+/* Stack Bit_T header over block b of set */
+static struct T block_view(T_L set, uint64_t b) {
+  const uint64_t first = b * BIT_L_BLOCK_QWORDS;
+  const uint64_t nq = set->size_in_qwords - first < BIT_L_BLOCK_QWORDS
+                          ? set->size_in_qwords - first
+                          : BIT_L_BLOCK_QWORDS;
+  return (struct T){.length = (unsigned int)(nq * BPQW),
+                    .size_in_bytes = (unsigned int)(nq * sizeof(uint64_t)),
+                    .size_in_qwords = (unsigned int)nq,
+                    .bytes = (unsigned char *)(set->qwords + first),
+                    .qwords = set->qwords + first};
+}
+
+static T_L large_alloc(int64_t length) {
+  assert(length > 0);
+  T_L set = malloc(sizeof(*set));
+  assert(set != NULL);
+  set->length = length;
+  set->size_in_qwords = L_NQWORDS(length);
+  // aligned_alloc wants a multiple of the alignment
+  const size_t bytes = (set->size_in_qwords * sizeof(uint64_t) + ALIGNMENT -
+                        1) / ALIGNMENT * ALIGNMENT;
+  set->qwords = aligned_alloc(ALIGNMENT, bytes);
+  assert(set->qwords != NULL);
+  set->is_Bit_T_allocated = true;
+  set->device_id = -1;
+  return set;
+}
+
+/* Clears the qwords of set in parallel, so that the first touch spreads the
+   pages of a new set over the threads that will use it */
+static void large_clear(T_L set) {
+  const uint64_t nq = set->size_in_qwords, nblocks = L_NBLOCKS(nq);
+#pragma omp parallel for schedule(static) if (L_PARALLEL(nq))
+  for (uint64_t b = 0; b < nblocks; b++) {
+    const struct T v = block_view(set, b);
+    memset(v.qwords, 0, v.size_in_bytes);
+  }
+}
+
+static inline uint64_t range_apply(uint64_t word, uint64_t mask, range_op op) {
+  return op == RANGE_SET ? word | mask
+         : op == RANGE_CLEAR ? word & ~mask
+                             : word ^ mask;
+}
+
+static void large_range(T_L set, int64_t lo, int64_t hi, range_op op) {
+  assert(set);
+  assert(0 <= lo && lo <= hi && hi < set->length);
+  const uint64_t w0 = (uint64_t)lo / BPQW, w1 = (uint64_t)hi / BPQW;
+  uint64_t first = ~UINT64_C(0) << (lo % BPQW);
+  const uint64_t last = ~UINT64_C(0) >> (BPQW - 1 - hi % BPQW);
+  if (w0 == w1) {
+    set->qwords[w0] = range_apply(set->qwords[w0], first & last, op);
+    return;
+  }
+  set->qwords[w0] = range_apply(set->qwords[w0], first, op);
+  set->qwords[w1] = range_apply(set->qwords[w1], last, op);
+  const uint64_t nq = w1 - w0 - 1;
+#pragma omp parallel for schedule(static) if (L_PARALLEL(nq))
+  for (uint64_t w = w0 + 1; w < w1; w++)
+    set->qwords[w] = range_apply(set->qwords[w], ~UINT64_C(0), op);
+}
+
+void bit_large_setop_into(T_L dst, T_L s, T_L t, bit_setop_id op) {
+  assert(dst && s && t);
+  assert(s->length == t->length && dst->length == s->length);
+  const uint64_t nq = s->size_in_qwords, nblocks = L_NBLOCKS(nq);
+  void (*kernel)(T, T, T) = bit_kernels_active()->setop[op];
+#pragma omp parallel for schedule(static) if (L_PARALLEL(nq))
+  for (uint64_t b = 0; b < nblocks; b++) {
+    struct T vd = block_view(dst, b), vs = block_view(s, b),
+             vt = block_view(t, b);
+    kernel(&vd, &vs, &vt);
+  }
+}
+
+static T_L large_setop(T_L s, T_L t, bit_setop_id op) {
+  assert(s && t);
+  assert(s->length == t->length);
+  T_L set = large_alloc(s->length);
+  bit_large_setop_into(set, s, t, op);
+  return set;
+}
+
+static int64_t large_setop_count(T_L s, T_L t, bit_setop_id op) {
+  assert(s && t);
+  assert(s->length == t->length);
+  const uint64_t nq = s->size_in_qwords, nblocks = L_NBLOCKS(nq);
+  int (*kernel)(T, T) = bit_kernels_active()->setop_count[op];
+  int64_t count = 0;
+#pragma omp parallel for schedule(static) reduction(+ : count)                \
+    if (L_PARALLEL(nq))
+  for (uint64_t b = 0; b < nblocks; b++) {
+    struct T vs = block_view(s, b), vt = block_view(t, b);
+    count += kernel(&vs, &vt);
+  }
+  return count;
+}
+
+/* --- End Section 8: INTERNAL HELPER FUNCTION DEFINITIONS --- */
+
+/* ==========================================================================
+   SECTION 9: PUBLIC API
+   ========================================================================== */
+
+/* --- 9a. Creation, destruction, load and extract --- */
+
+T_L Bit_L_new(int64_t length) {
+  T_L set = large_alloc(length);
+  large_clear(set);
+  return set;
+}
+
+void *Bit_L_free(T_L *set) {
+  assert(set && *set);
+  if ((*set)->device_id >= 0)
+    Bit_L_device_detach(*set);
+  void *buffer = NULL;
+  if ((*set)->is_Bit_T_allocated)
+    free((*set)->qwords);
+  else
+    buffer = (*set)->qwords;
+  free(*set);
+  *set = NULL;
+  return buffer;
+}
+
+T_L Bit_L_load(int64_t length, void *buffer) {
+  assert(length > 0);
+  assert(buffer != NULL);
+  T_L set = malloc(sizeof(*set));
+  assert(set != NULL);
+  set->length = length;
+  set->size_in_qwords = L_NQWORDS(length);
+  set->qwords = buffer;
+  set->is_Bit_T_allocated = false;
+  set->device_id = -1;
+  return set;
+}
+
+size_t Bit_L_extract(T_L set, void *buffer) {
+  assert(set);
+  assert(buffer != NULL);
+  const size_t bytes = set->size_in_qwords * sizeof(uint64_t);
+  memcpy(buffer, set->qwords, bytes);
+  return bytes;
+}
+
+size_t Bit_L_buffer_size(int64_t length) {
+  assert(length > 0);
+  return L_NQWORDS(length) * sizeof(uint64_t);
+}
+
+/* --- 9b. Properties --- */
+
+int64_t Bit_L_length(T_L set) {
+  assert(set);
+  return set->length;
+}
+
+int64_t Bit_L_count(T_L set) {
+  assert(set);
+  const uint64_t nq = set->size_in_qwords, nblocks = L_NBLOCKS(nq);
+  int (*count_qwords)(const uint64_t *, size_t) =
+      bit_kernels_active()->count_qwords;
+  int64_t count = 0;
+#pragma omp parallel for schedule(static) reduction(+ : count)                \
+    if (L_PARALLEL(nq))
+  for (uint64_t b = 0; b < nblocks; b++) {
+    const struct T v = block_view(set, b);
+    count += count_qwords(v.qwords, v.size_in_qwords);
+  }
+  return count;
+}
+
+/* --- 9c. Member operations --- */
+
+int Bit_L_get(T_L set, int64_t index) {
+  assert(set);
+  assert(index >= 0 && index < set->length);
+  return (int)((set->qwords[index / BPQW] >> (index % BPQW)) & 1);
+}
+
+int Bit_L_put(T_L set, int64_t index, int val) {
+  assert(set);
+  assert(index >= 0 && index < set->length);
+  assert(val == 0 || val == 1);
+  uint64_t *word = &set->qwords[index / BPQW];
+  const int prev = (int)((*word >> (index % BPQW)) & 1);
+  if (val)
+    *word |= UINT64_C(1) << (index % BPQW);
+  else
+    *word &= ~(UINT64_C(1) << (index % BPQW));
+  return prev;
+}
+
+void Bit_L_bset(T_L set, int64_t index) { Bit_L_put(set, index, 1); }
+
+void Bit_L_bclear(T_L set, int64_t index) { Bit_L_put(set, index, 0); }
+
+void Bit_L_aset(T_L set, const int64_t indices[], size_t n) {
+  assert(set && (indices || n == 0));
+  for (size_t i = 0; i < n; i++)
+    Bit_L_put(set, indices[i], 1);
+}
+
+void Bit_L_aclear(T_L set, const int64_t indices[], size_t n) {
+  assert(set && (indices || n == 0));
+  for (size_t i = 0; i < n; i++)
+    Bit_L_put(set, indices[i], 0);
+}
+
+void Bit_L_set(T_L set, int64_t lo, int64_t hi) {
+  large_range(set, lo, hi, RANGE_SET);
+}
+
+void Bit_L_clear(T_L set, int64_t lo, int64_t hi) {
+  large_range(set, lo, hi, RANGE_CLEAR);
+}
+
+void Bit_L_not(T_L set, int64_t lo, int64_t hi) {
+  large_range(set, lo, hi, RANGE_NOT);
+}
+
+int64_t Bit_L_next_set(T_L set, int64_t from) {
+  assert(set);
+  assert(from >= 0);
+  if (from >= set->length)
+    return -1;
+  uint64_t w = (uint64_t)from / BPQW;
+  uint64_t word = set->qwords[w] & (~UINT64_C(0) << (from % BPQW));
+  while (!word) {
+    if (++w == set->size_in_qwords)
+      return -1;
+    word = set->qwords[w];
+  }
+  return (int64_t)(w * BPQW) + __builtin_ctzll(word);
+}
+
+int64_t Bit_L_prev_set(T_L set, int64_t from) {
+  assert(set);
+  if (from < 0)
+    return -1;
+  if (from >= set->length)
+    from = set->length - 1;
+  uint64_t w = (uint64_t)from / BPQW;
+  uint64_t word = set->qwords[w] & (~UINT64_C(0) >> (BPQW - 1 - from % BPQW));
+  while (!word) {
+    if (w-- == 0)
+      return -1;
+    word = set->qwords[w];
+  }
+  return (int64_t)(w * BPQW) + (int64_t)(BPQW - 1) - __builtin_clzll(word);
+}
+
+/* --- 9d. Comparisons --- */
+
+int Bit_L_eq(T_L s, T_L t) {
+  return large_setop_count(s, t, BIT_OP_XOR) == 0;
+}
+
+int Bit_L_leq(T_L s, T_L t) {
+  return large_setop_count(s, t, BIT_OP_AND_NOT) == 0;
+}
+
+int Bit_L_lt(T_L s, T_L t) { return Bit_L_leq(s, t) && !Bit_L_eq(s, t); }
+
+/* --- 9e. Set operations --- */
+
+T_L Bit_L_diff(T_L s, T_L t) { return large_setop(s, t, BIT_OP_XOR); }
+T_L Bit_L_inter(T_L s, T_L t) { return large_setop(s, t, BIT_OP_AND); }
+T_L Bit_L_minus(T_L s, T_L t) { return large_setop(s, t, BIT_OP_AND_NOT); }
+T_L Bit_L_union(T_L s, T_L t) { return large_setop(s, t, BIT_OP_OR); }
+
+int64_t Bit_L_diff_count(T_L s, T_L t) {
+  return large_setop_count(s, t, BIT_OP_XOR);
+}
+int64_t Bit_L_inter_count(T_L s, T_L t) {
+  return large_setop_count(s, t, BIT_OP_AND);
+}
+int64_t Bit_L_minus_count(T_L s, T_L t) {
+  return large_setop_count(s, t, BIT_OP_AND_NOT);
+}
+int64_t Bit_L_union_count(T_L s, T_L t) {
+  return large_setop_count(s, t, BIT_OP_OR);
+}
+
+/* --- End Section 9: PUBLIC API --- */
@@ -0,0 +1,201 @@
+/*
+    Bit matrices over Bit_DB_T storage (see BitDB_transpose and
+    BitDB_matrix_product in include/bit.h). Row i of a container is row i
+    of the matrix and bit j of the row its column j, so an n x m matrix is a
+    container of n rows of length m.
+
+    Transposes move 64 x 64 bit blocks through the transpose64 kernel.
+    Products use the Method of Four Russians: the rows of B are taken 8 at
+    a time, the 256 sums (OR or XOR) of their subsets are tabulated once,
+    and every row of A then adds the table entry its byte of columns picks,
+    i.e. one row operation per 8 columns of A instead of up to 8. Tables
+    cover BIT_MATRIX_TILE_QWORDS qwords of the rows of B, so that they stay
+    in cache while the threads sweep the rows of A. The counting form is the
+    intersection count of A against the transpose of B, through the tiled
+    popcount kernels.
+
+    * License : BSD-2
+*/
+
+/* ==========================================================================
+   SECTION 1: INCLUDES
+   Standard library headers first, then project headers.
+   ========================================================================== */
+
+#include "bit.h"
+#include "omp.h"
+#include <assert.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "bit_internal.h"
+
+/* --- End Section 1: INCLUDES --- */
+
+/* ==========================================================================
+   SECTION 2: COMPILE-TIME CONFIGURATION
+   File-local compile-time constants, build-time defaults, and feature flags.
+   ========================================================================== */
+
+/* Qwords of the rows of B per product table: 256 entries of 1 KiB each,
+   i.e. a 256 KiB table, for the L2 cache */
+#ifndef BIT_MATRIX_TILE_QWORDS
+#define BIT_MATRIX_TILE_QWORDS 128
+#endif
+
+/* --- End Section 2: COMPILE-TIME CONFIGURATION --- */
+
+/* ==========================================================================
+   SECTION 8: INTERNAL HELPER FUNCTION DEFINITIONS
+   ========================================================================== */
+
+static inline uint64_t *db_row(T_DB db, size_t index) {
+  return db->qwords + index * db->stride_in_qwords;
+}
+
+/* out = the product of a and b (into a zeroed container); see the header
+   comment. The threads share each table: they fill it one subset size at
+   a time, then split the rows of a between them. */
+static void matrix_product(T_DB out, T_DB a, T_DB b, Bit_matrix_ring ring,
+                           SETOP_COUNT_OPTS opts) {
+  const size_t pq = b->size_in_qwords;
+  const int n = (int)a->nelem, m = (int)a->length;
+  const bool gf2 = ring == BIT_MATRIX_GF2;
+  uint64_t *table =
+      aligned_alloc(ALIGNMENT, 256 * BIT_MATRIX_TILE_QWORDS * sizeof(uint64_t));
+  assert(table != NULL);
+#pragma omp parallel num_threads(cpu_threads(opts))
+  for (size_t c0 = 0; c0 < pq; c0 += BIT_MATRIX_TILE_QWORDS) {
+    const size_t w =
+        pq - c0 < BIT_MATRIX_TILE_QWORDS ? pq - c0 : BIT_MATRIX_TILE_QWORDS;
+    for (int g = 0; g < m; g += 8) {
+      const int rows = m - g < 8 ? m - g : 8;
+#pragma omp single
+      memset(table, 0, w * sizeof(uint64_t)); // the empty subset
+      for (int bit = 0; bit < rows; bit++) {
+        const uint64_t *brow = db_row(b, (size_t)(g + bit)) + c0;
+#pragma omp for schedule(static)
+        for (int x = 1 << bit; x < 2 << bit; x++) {
+          const uint64_t *from =
+              table + (size_t)(x - (1 << bit)) * BIT_MATRIX_TILE_QWORDS;
+          uint64_t *to = table + (size_t)x * BIT_MATRIX_TILE_QWORDS;
+          if (gf2) {
+            OMP_CPU_SIMD
+            for (size_t q = 0; q < w; q++)
+              to[q] = from[q] ^ brow[q];
+          } else {
+            OMP_CPU_SIMD
+            for (size_t q = 0; q < w; q++)
+              to[q] = from[q] | brow[q];
+          }
+        }
+      }
+#pragma omp for schedule(static)
+      for (int i = 0; i < n; i++) {
+        // the bits of a past its length are zero: no unfilled entry is read
+        const unsigned int byte =
+            (unsigned int)(db_row(a, (size_t)i)[g / 64] >> (g % 64)) & 0xff;
+        if (byte == 0)
+          continue;
+        const uint64_t *entry = table + (size_t)byte * BIT_MATRIX_TILE_QWORDS;
+        uint64_t *row = db_row(out, (size_t)i) + c0;
+        if (gf2) {
+          OMP_CPU_SIMD
+          for (size_t q = 0; q < w; q++)
+            row[q] ^= entry[q];
+        } else {
+          OMP_CPU_SIMD
+          for (size_t q = 0; q < w; q++)
+            row[q] |= entry[q];
+        }
+      }
+    }
+  }
+  free(table);
+}
+
+/* Ors the rows of from into those of to; true if any bit was new */
+static bool matrix_or_into(T_DB to, T_DB from) {
+  bool changed = false;
+  const int n = (int)to->nelem;
+#pragma omp parallel for schedule(static) reduction(|| : changed)
+  for (int i = 0; i < n; i++) {
+    uint64_t *dst = db_row(to, (size_t)i);
+    const uint64_t *src = db_row(from, (size_t)i);
+    uint64_t added = 0;
+    for (size_t q = 0; q < to->size_in_qwords; q++) {
+      added |= src[q] & ~dst[q];
+      dst[q] |= src[q];
+    }
+    changed = changed || added != 0;
+  }
+  return changed;
+}
+
+/* --- End Section 8: INTERNAL HELPER FUNCTION DEFINITIONS --- */
+
+/* ==========================================================================
+   SECTION 9: PUBLIC API
+   ========================================================================== */
+
+T_DB BitDB_transpose(T_DB set) {
+  assert(set);
+  const size_t n = set->nelem, m = set->length;
+  const size_t row_blocks = (n + 63) / 64;
+  T_DB out = BitDB_new((int)n, (int)m);
+  void (*transpose64)(uint64_t *) = bit_kernels_active()->transpose64;
+  const int nq = (int)set->size_in_qwords;
+  // every column block of set fills 64 rows of out of its own
+#pragma omp parallel for schedule(dynamic, 1)
+  for (int cq = 0; cq < nq; cq++) {
+    uint64_t block[64];
+    for (size_t rb = 0; rb < row_blocks; rb++) {
+      for (size_t r = 0; r < 64; r++)
+        block[r] = rb * 64 + r < n ? db_row(set, rb * 64 + r)[cq] : 0;
+      transpose64(block);
+      for (size_t c = 0; c < 64 && (size_t)cq * 64 + c < m; c++)
+        db_row(out, (size_t)cq * 64 + c)[rb] = block[c];
+    }
+  }
+  return out;
+}
+
+T_DB BitDB_matrix_product(T_DB a, T_DB b, Bit_matrix_ring ring,
+                          SETOP_COUNT_OPTS opts) {
+  assert(a && b);
+  assert(a->length == b->nelem);
+  assert(ring == BIT_MATRIX_BOOLEAN || ring == BIT_MATRIX_GF2);
+  T_DB out = BitDB_new((int)b->length, (int)a->nelem);
+  matrix_product(out, a, b, ring, opts);
+  return out;
+}
+
+void BitDB_matrix_count_store(T_DB a, T_DB b, int *counts,
+                              SETOP_COUNT_OPTS opts) {
+  assert(a && b);
+  assert(counts != NULL);
+  assert(a->length == b->nelem);
+  T_DB columns = BitDB_transpose(b);
+  BitDB_inter_count_store_cpu(a, columns, counts, bit_stop_ignored(opts));
+  BitDB_free(&columns);
+}
+
+T_DB BitDB_matrix_closure(T_DB set, SETOP_COUNT_OPTS opts) {
+  assert(set);
+  assert(set->length == set->nelem);
+  T_DB reach = BitDB_new((int)set->length, (int)set->nelem);
+  for (unsigned int i = 0; i < set->nelem; i++)
+    memcpy(db_row(reach, i), db_row(set, i), set->size_in_bytes);
+  // paths of up to 2^k edges after k squarings
+  for (bool changed = true; changed;) {
+    T_DB square = BitDB_new((int)set->length, (int)set->nelem);
+    matrix_product(square, reach, reach, BIT_MATRIX_BOOLEAN, opts);
+    changed = matrix_or_into(reach, square);
+    BitDB_free(&square);
+  }
+  return reach;
+}
+
+/* --- End Section 9: PUBLIC API --- */
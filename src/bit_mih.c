@@ -0,0 +1,492 @@
+/*
+    Multi-index hashing of Bit_DB_T rows for Hamming distance searches
+    (Bit_MIH_T, see include/bit.h), after Norouzi, Punjani and Fleet.
+
+    Every row is cut into m substrings, and table i maps each value of
+    substring i to the rows holding it. If two rows are within distance r,
+    at least one of their m substrings differs in at most r / m bits. A
+    search therefore probes every table with the values at distance 0, 1,
+    ... from the query's substring, and counts the full distance of the
+    rows it finds with the diff count kernel. A k-NN search stops at probe
+    distance s once its k-th best distance is below m * s, the least
+    distance of any row not yet found. When the values to probe at some
+    distance outnumber the rows, the rest of the search is one scan.
+
+    * License : BSD-2
+*/
+
+/* ==========================================================================
+   SECTION 1: INCLUDES
+   Standard library headers first, then project headers.
+   ========================================================================== */
+
+#include "bit.h"
+#include "omp.h"
+#include <assert.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "bit_internal.h"
+
+/* --- End Section 1: INCLUDES --- */
+
+/* ==========================================================================
+   SECTION 2: COMPILE-TIME CONFIGURATION
+   File-local compile-time constants, build-time defaults, and feature flags.
+   ========================================================================== */
+
+#define MIH_MAX_BITS 64  // widest substring: a key is one qword
+#define MIH_EMPTY 0      // free slot of a table
+#define MIH_SEEN_SLOTS 64 // initial slots of the set of rows a query found
+
+/* --- End Section 2: COMPILE-TIME CONFIGURATION --- */
+
+/* ==========================================================================
+   SECTION 5: INTERNAL DATA STRUCTURES AND ENUMS
+   Types used only inside this translation unit.
+   ========================================================================== */
+
+/* The rows of every value of one substring: distinct value u is keys[u] and
+   its rows are rows[offsets[u] .. offsets[u + 1]), in increasing order.
+   slots is an open-addressing table of u + 1 by value (MIH_EMPTY if free). */
+typedef struct {
+  int first, bits; // bits [first, first + bits) of every row
+  size_t nkeys;
+  uint64_t *keys;
+  size_t *offsets;
+  uint32_t *rows;
+  uint32_t *slots;
+  int log_slots;
+} mih_table;
+
+struct T_MIH {
+  T_DB db; // borrowed
+  int m;
+  mih_table *tables;
+};
+
+/* Rows a query has found: an open-addressing set of row + 1 */
+typedef struct {
+  uint32_t *slots;
+  size_t cap, n;
+} mih_seen;
+
+/* The k best (distance, row) of a query, best first; empty slots hold -1 */
+typedef struct {
+  int k;
+  int *idx, *dist;
+} mih_best;
+
+/* --- End Section 5: INTERNAL DATA STRUCTURES AND ENUMS --- */
+
+/* ==========================================================================
+   SECTION 8: INTERNAL HELPER FUNCTION DEFINITIONS
+   ========================================================================== */
+
+/* Bits [first, first + bits) of a row as an integer */
+static inline uint64_t mih_key(const uint64_t *row, int first, int bits) {
+  const int w = first / BPQW, off = first % BPQW;
+  uint64_t x = row[w] >> off;
+  if (off && off + bits > (int)BPQW)
+    x |= row[w + 1] << (BPQW - off);
+  return bits == (int)BPQW ? x : x & ((UINT64_C(1) << bits) - 1);
+}
+
+static inline size_t mih_hash(uint64_t key, int log_slots) {
+  return (size_t)((key * 0x9e3779b97f4a7c15ULL) >> (64 - log_slots));
+}
+
+/* Distinct value of a table holding key, or -1 */
+static inline long long mih_find(const mih_table *t, uint64_t key) {
+  const size_t mask = ((size_t)1 << t->log_slots) - 1;
+  for (size_t s = mih_hash(key, t->log_slots);; s = (s + 1) & mask) {
+    const uint32_t u = t->slots[s];
+    if (u == MIH_EMPTY)
+      return -1;
+    if (t->keys[u - 1] == key)
+      return (long long)u - 1;
+  }
+}
+
+/* Counts the rows of every value, then files the rows in order */
+static void mih_table_build(mih_table *t, T_DB db) {
+  const size_t n = db->nelem;
+  const size_t most = t->bits < 32 && ((size_t)1 << t->bits) < n
+                          ? (size_t)1 << t->bits
+                          : n;
+  t->log_slots = 1;
+  while (((size_t)1 << t->log_slots) < 2 * most)
+    t->log_slots++;
+  const size_t mask = ((size_t)1 << t->log_slots) - 1;
+  t->slots = calloc(mask + 1, sizeof(uint32_t));
+  t->keys = malloc((most ? most : 1) * sizeof(uint64_t));
+  uint32_t *key_of = malloc((n ? n : 1) * sizeof(uint32_t)); // value per row
+  size_t *counts = calloc(most + 1, sizeof(size_t));
+  assert(t->slots && t->keys && key_of && counts);
+  t->nkeys = 0;
+  for (size_t r = 0; r < n; r++) {
+    const uint64_t key =
+        mih_key(db->qwords + r * db->stride_in_qwords, t->first, t->bits);
+    size_t s = mih_hash(key, t->log_slots);
+    while (t->slots[s] != MIH_EMPTY && t->keys[t->slots[s] - 1] != key)
+      s = (s + 1) & mask;
+    if (t->slots[s] == MIH_EMPTY) {
+      t->keys[t->nkeys] = key;
+      t->slots[s] = (uint32_t)++t->nkeys;
+    }
+    key_of[r] = t->slots[s] - 1;
+    counts[key_of[r] + 1]++;
+  }
+  for (size_t u = 0; u < t->nkeys; u++)
+    counts[u + 1] += counts[u];
+  t->offsets = counts;
+  t->rows = malloc((n ? n : 1) * sizeof(uint32_t));
+  size_t *cursor = malloc((t->nkeys ? t->nkeys : 1) * sizeof(size_t));
+  assert(t->rows && cursor);
+  memcpy(cursor, counts, t->nkeys * sizeof(size_t));
+  for (size_t r = 0; r < n; r++)
+    t->rows[cursor[key_of[r]]++] = (uint32_t)r;
+  free(cursor);
+  free(key_of);
+}
+
+/* Adds row to the set; false if it was there */
+static bool mih_seen_add(mih_seen *seen, uint32_t row) {
+  if (2 * (seen->n + 1) > seen->cap) {
+    mih_seen bigger = {calloc(2 * seen->cap, sizeof(uint32_t)),
+                       2 * seen->cap, 0};
+    assert(bigger.slots != NULL);
+    for (size_t s = 0; s < seen->cap; s++)
+      if (seen->slots[s] != MIH_EMPTY)
+        mih_seen_add(&bigger, seen->slots[s] - 1);
+    free(seen->slots);
+    *seen = bigger;
+  }
+  const size_t mask = seen->cap - 1;
+  size_t s = (size_t)(((uint64_t)row * 0x9e3779b97f4a7c15ULL) >> 32) & mask;
+  for (; seen->slots[s] != MIH_EMPTY; s = (s + 1) & mask)
+    if (seen->slots[s] == row + 1)
+      return false;
+  seen->slots[s] = row + 1;
+  seen->n++;
+  return true;
+}
+
+static inline void mih_best_insert(mih_best *best, int row, int d) {
+  const int k = best->k;
+  int *idx = best->idx, *dist = best->dist;
+  if (idx[k - 1] >= 0 &&
+      (d > dist[k - 1] || (d == dist[k - 1] && row > idx[k - 1])))
+    return;
+  int r = k - 1;
+  while (r > 0 && (idx[r - 1] < 0 || d < dist[r - 1] ||
+                   (d == dist[r - 1] && row < idx[r - 1]))) {
+    idx[r] = idx[r - 1];
+    dist[r] = dist[r - 1];
+    r--;
+  }
+  idx[r] = row;
+  dist[r] = d;
+}
+
+/* Number of values within exactly s bits of a value of bits bits */
+static double mih_ball(int bits, int s) {
+  double c = 1;
+  for (int i = 0; i < s; i++)
+    c = c * (bits - i) / (i + 1);
+  return c;
+}
+
+/* A query's view of the index: the row behind it, its substrings and the
+   diff count kernel that verifies the candidates */
+typedef struct {
+  T_MIH mih;
+  struct T query, row;
+  uint64_t *keys; // substring values of the query
+  int (*distance)(T, T);
+} mih_probe;
+
+static inline int mih_distance(mih_probe *p, uint32_t r) {
+  T_DB db = p->mih->db;
+  p->row.qwords = db->qwords + (size_t)r * db->stride_in_qwords;
+  p->row.bytes = (unsigned char *)p->row.qwords;
+  return p->distance(&p->query, &p->row);
+}
+
+/* Calls visit for every row of table i whose value is within exactly s bits
+   of the query's: the flipped positions run through the combinations of s
+   of the substring's bits */
+static void mih_probe_table(mih_probe *p, int i, int s,
+                            void visit(mih_probe *p, uint32_t row, void *cl),
+                            void *cl) {
+  const mih_table *t = &p->mih->tables[i];
+  int pos[MIH_MAX_BITS];
+  for (int j = 0; j < s; j++)
+    pos[j] = j;
+  for (;;) {
+    uint64_t key = p->keys[i];
+    for (int j = 0; j < s; j++)
+      key ^= UINT64_C(1) << pos[j];
+    const long long u = mih_find(t, key);
+    if (u >= 0)
+      for (size_t e = t->offsets[u]; e < t->offsets[u + 1]; e++)
+        visit(p, t->rows[e], cl);
+    // next combination: bump the last position that can still move
+    int j = s - 1;
+    while (j >= 0 && pos[j] == t->bits - s + j)
+      j--;
+    if (j < 0)
+      return;
+    pos[j]++;
+    for (int l = j + 1; l < s; l++)
+      pos[l] = pos[l - 1] + 1;
+  }
+}
+
+static void mih_probe_init(mih_probe *p, T_MIH mih, T_DB queries,
+                           size_t q) {
+  T_DB db = mih->db;
+  p->mih = mih;
+  p->query = (struct T){.length = db->length,
+                        .size_in_bytes = db->size_in_bytes,
+                        .size_in_qwords = db->size_in_qwords};
+  p->row = p->query;
+  p->query.qwords = queries->qwords + q * queries->stride_in_qwords;
+  p->query.bytes = (unsigned char *)p->query.qwords;
+  p->keys = malloc((size_t)mih->m * sizeof(uint64_t));
+  assert(p->keys != NULL);
+  for (int i = 0; i < mih->m; i++)
+    p->keys[i] = mih_key(p->query.qwords, mih->tables[i].first,
+                         mih->tables[i].bits);
+  p->distance = bit_kernels_active()->setop_count[BIT_OP_XOR];
+}
+
+/* Whether probing every table at distance s costs more than a scan */
+static bool mih_scan_cheaper(T_MIH mih, int s) {
+  double probes = 0;
+  for (int i = 0; i < mih->m; i++)
+    probes += mih_ball(mih->tables[i].bits, s);
+  return probes > (double)mih->db->nelem;
+}
+
+typedef struct {
+  mih_seen seen;
+  mih_best best;
+} mih_knn_state;
+
+static void mih_knn_visit(mih_probe *p, uint32_t row, void *cl) {
+  mih_knn_state *state = cl;
+  if (mih_seen_add(&state->seen, row))
+    mih_best_insert(&state->best, (int)row, mih_distance(p, row));
+}
+
+typedef struct {
+  mih_seen seen;
+  int r;
+  int *idx, *dist;
+  size_t n, cap;
+} mih_radius_state;
+
+static void mih_radius_push(mih_radius_state *state, int row, int d) {
+  if (state->n == state->cap) {
+    state->cap = state->cap ? 2 * state->cap : 16;
+    state->idx = realloc(state->idx, state->cap * sizeof(int));
+    state->dist = realloc(state->dist, state->cap * sizeof(int));
+    assert(state->idx && state->dist);
+  }
+  state->idx[state->n] = row;
+  state->dist[state->n++] = d;
+}
+
+static void mih_radius_visit(mih_probe *p, uint32_t row, void *cl) {
+  mih_radius_state *state = cl;
+  if (!mih_seen_add(&state->seen, row))
+    return;
+  const int d = mih_distance(p, row);
+  if (d <= state->r)
+    mih_radius_push(state, (int)row, d);
+}
+
+typedef struct {
+  int idx, dist;
+} mih_match;
+
+static int mih_match_compare(const void *x, const void *y) {
+  const mih_match *a = x, *b = y;
+  return (a->idx > b->idx) - (a->idx < b->idx);
+}
+
+static int mih_min_bits(T_MIH mih) {
+  int bits = MIH_MAX_BITS;
+  for (int i = 0; i < mih->m; i++)
+    bits = mih->tables[i].bits < bits ? mih->tables[i].bits : bits;
+  return bits;
+}
+
+/* --- End Section 8: INTERNAL HELPER FUNCTION DEFINITIONS --- */
+
+/* ==========================================================================
+   SECTION 9: PUBLIC API
+   ========================================================================== */
+
+T_MIH Bit_MIH_new(T_DB db, int m, SETOP_COUNT_OPTS opts) {
+  assert(db);
+  assert(db->nelem < UINT32_MAX);
+  const int length = db->length;
+  if (m <= 0) { // substrings of about log2(rows) bits
+    int bits = 1;
+    while (bits < 32 && ((size_t)1 << bits) < db->nelem)
+      bits++;
+    bits = bits < 8 ? 8 : bits;
+    m = (length + bits - 1) / bits;
+  }
+  assert(m >= 1 && m <= length);
+  assert((length + m - 1) / m <= MIH_MAX_BITS);
+  T_MIH mih = calloc(1, sizeof(*mih));
+  assert(mih != NULL);
+  mih->db = db;
+  mih->m = m;
+  mih->tables = calloc((size_t)m, sizeof(mih_table));
+  assert(mih->tables != NULL);
+#pragma omp parallel for num_threads(cpu_threads(opts)) schedule(dynamic)
+  for (int i = 0; i < m; i++) {
+    const int first = (int)((long long)length * i / m);
+    mih->tables[i].first = first;
+    mih->tables[i].bits = (int)((long long)length * (i + 1) / m) - first;
+    mih_table_build(&mih->tables[i], db);
+  }
+  return mih;
+}
+
+void Bit_MIH_free(T_MIH *mih) {
+  assert(mih && *mih);
+  for (int i = 0; i < (*mih)->m; i++) {
+    mih_table *t = &(*mih)->tables[i];
+    free(t->keys);
+    free(t->offsets);
+    free(t->rows);
+    free(t->slots);
+  }
+  free((*mih)->tables);
+  free(*mih);
+  *mih = NULL;
+}
+
+int Bit_MIH_substrings(T_MIH mih) {
+  assert(mih);
+  return mih->m;
+}
+
+void Bit_MIH_knn(T_MIH mih, T_DB queries, int k, SETOP_COUNT_OPTS opts,
+                 int *out_idx, int *out_dist) {
+  assert(mih && queries);
+  assert(out_idx && out_dist);
+  assert(k >= 1);
+  assert(queries->length == mih->db->length);
+  const int nqueries = (int)queries->nelem, m = mih->m;
+  const int min_bits = mih_min_bits(mih);
+  const size_t n = mih->db->nelem;
+#pragma omp parallel for num_threads(cpu_threads(opts)) schedule(dynamic)
+  for (int q = 0; q < nqueries; q++) {
+    mih_probe p;
+    mih_probe_init(&p, mih, queries, (size_t)q);
+    mih_knn_state state = {
+        {calloc(MIH_SEEN_SLOTS, sizeof(uint32_t)), MIH_SEEN_SLOTS, 0},
+        {k, out_idx + (size_t)q * k, out_dist + (size_t)q * k}};
+    assert(state.seen.slots != NULL);
+    for (int r = 0; r < k; r++)
+      state.best.idx[r] = state.best.dist[r] = -1;
+    // every row not found by probe distance s is at least m * s away
+    for (int s = 0; s <= min_bits; s++) {
+      const int kth = state.best.dist[k - 1];
+      if (state.best.idx[k - 1] >= 0 && kth < m * s)
+        break;
+      if (mih_scan_cheaper(mih, s)) { // start over with every row
+        for (int r = 0; r < k; r++)
+          state.best.idx[r] = state.best.dist[r] = -1;
+        for (size_t row = 0; row < n; row++)
+          mih_best_insert(&state.best, (int)row,
+                          mih_distance(&p, (uint32_t)row));
+        break;
+      }
+      for (int i = 0; i < m; i++)
+        mih_probe_table(&p, i, s, mih_knn_visit, &state);
+    }
+    free(state.seen.slots);
+    free(p.keys);
+  }
+}
+
+size_t Bit_MIH_radius(T_MIH mih, T_DB queries, int r, SETOP_COUNT_OPTS opts,
+                      size_t *offsets, int **out_idx, int **out_dist) {
+  assert(mih && queries);
+  assert(offsets && out_idx && out_dist);
+  assert(r >= 0);
+  assert(queries->length == mih->db->length);
+  const int nqueries = (int)queries->nelem;
+  const int reach = r / mih->m; // some substring is this close
+  const size_t n = mih->db->nelem;
+  mih_radius_state *states = calloc(nqueries ? nqueries : 1,
+                                    sizeof(mih_radius_state));
+  assert(states != NULL);
+#pragma omp parallel for num_threads(cpu_threads(opts)) schedule(dynamic)
+  for (int q = 0; q < nqueries; q++) {
+    mih_probe p;
+    mih_probe_init(&p, mih, queries, (size_t)q);
+    mih_radius_state *state = &states[q];
+    state->seen = (mih_seen){calloc(MIH_SEEN_SLOTS, sizeof(uint32_t)),
+                             MIH_SEEN_SLOTS, 0};
+    assert(state->seen.slots != NULL);
+    state->r = r;
+    bool scan = false;
+    for (int s = 0; s <= reach && s <= mih_min_bits(mih) && !scan; s++)
+      scan = mih_scan_cheaper(mih, s);
+    if (scan) { // every row is a candidate, and found once
+      for (size_t row = 0; row < n; row++) {
+        const int d = mih_distance(&p, (uint32_t)row);
+        if (d <= r)
+          mih_radius_push(state, (int)row, d);
+      }
+    } else {
+      for (int s = 0; s <= reach; s++)
+        for (int i = 0; i < mih->m; i++)
+          if (s <= mih->tables[i].bits)
+            mih_probe_table(&p, i, s, mih_radius_visit, state);
+    }
+    free(state->seen.slots);
+    free(p.keys);
+    // the tables hand out rows by value: put them in row order
+    mih_match *matches = malloc((state->n ? state->n : 1) * sizeof(mih_match));
+    assert(matches != NULL);
+    for (size_t e = 0; e < state->n; e++)
+      matches[e] = (mih_match){state->idx[e], state->dist[e]};
+    qsort(matches, state->n, sizeof(mih_match), mih_match_compare);
+    for (size_t e = 0; e < state->n; e++) {
+      state->idx[e] = matches[e].idx;
+      state->dist[e] = matches[e].dist;
+    }
+    free(matches);
+  }
+  offsets[0] = 0;
+  for (int q = 0; q < nqueries; q++)
+    offsets[q + 1] = offsets[q] + states[q].n;
+  const size_t total = offsets[nqueries];
+  *out_idx = malloc((total ? total : 1) * sizeof(int));
+  *out_dist = malloc((total ? total : 1) * sizeof(int));
+  assert(*out_idx && *out_dist);
+  for (int q = 0; q < nqueries; q++) {
+    if (states[q].n) {
+      memcpy(*out_idx + offsets[q], states[q].idx, states[q].n * sizeof(int));
+      memcpy(*out_dist + offsets[q], states[q].dist,
+             states[q].n * sizeof(int));
+    }
+    free(states[q].idx);
+    free(states[q].dist);
+  }
+  free(states);
+  return total;
+}
+
+/* --- End Section 9: PUBLIC API --- */
@@ -0,0 +1,688 @@
+/*
+    All-pairs counts of two Bit_DB_T containers spread over the ranks of an
+    MPI communicator (Bit_mpi_grid_T, see include/bit.h). Built only with
+    MPI=1.
+
+    The ranks form a grid_rows x grid_cols grid. Query block i (the queries
+    of grid row i) and target block j (the targets of grid column j) meet
+    on rank (i, j), which owns their block of the count matrix. Each block
+    starts spread over the ranks of its grid row or column, one panel per
+    rank, so no rank holds more than its share of either container. A
+    sweep then broadcasts, as in SUMMA, the query panels along the grid
+    rows and the target panels along the grid columns, and counts every
+    pair of panels with the tiled CPU or GPU kernels of one node. The
+    broadcast of the next panel is posted (MPI_Ibcast) before the current
+    pair is counted, so the network moves it while the cores or the GPU
+    count. Target panels are kept for the rest of the sweep, query panels
+    only until their row of pairs is counted.
+
+    * License : BSD-2
+*/
+
+/* ==========================================================================
+   SECTION 1: INCLUDES
+   Standard library headers first, then project headers.
+   ========================================================================== */
+
+#include "bit.h"
+#include "omp.h"
+#include <assert.h>
+#include <limits.h>
+#include <mpi.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "bit_internal.h"
+
+/* --- End Section 1: INCLUDES --- */
+
+/* ==========================================================================
+   SECTION 5: INTERNAL DATA STRUCTURES AND ENUMS
+   Types used only inside this translation unit.
+   ========================================================================== */
+
+struct Bit_mpi_grid_T {
+  MPI_Comm comm;     // duplicate of the communicator of the grid
+  MPI_Comm row_comm; // the ranks of this grid row, by column
+  MPI_Comm col_comm; // the ranks of this grid column, by row
+  int rows, cols;    // shape of the grid
+  int row, col;      // coordinates of this rank
+};
+
+/* Where every panel sits. Queries are numbered in rank order, so query
+   block i is contiguous; targets in column-major rank order, so target
+   block j is. qoff[a] is the first row of the panel of rank (row, a)
+   within query block row, toff[b] that of rank (b, col) within target
+   block col. */
+typedef struct {
+  int length;            // bits of every row
+  int *qsize, *tsize;    // rows of the panels of every rank
+  int *qoff, *toff;      // cols + 1 and rows + 1 panel offsets
+  int first_query;       // global index of the first query of the block
+  int first_target;      // global index of the first target of the block
+  MPI_Datatype row_type; // one packed row
+} mpi_layout;
+
+/* Counts one pair of panels: queries of panel a, targets of panel b */
+typedef void mpi_pair_fn(void *cl, int a, T_DB queries, int b, T_DB targets,
+                         SETOP_COUNT_OPTS opts);
+
+typedef struct {
+  const mpi_layout *lay;
+  Bit_count_ops op;
+  bool gpu;
+  int *counts;  // the count block of this rank
+  int ntarget;  // its width
+  int *scratch; // counts of one pair of panels
+} mpi_tile_state;
+
+typedef struct {
+  const mpi_layout *lay;
+  Bit_mpi_grid_T grid;
+  int k;
+  bool gpu;
+  int *best;           // 2k ints per query of the block: indices, counts
+  int *idx, *count;    // top-k of one pair of panels
+  MPI_Datatype type;   // the 2k ints of one query
+  MPI_Op op;           // merge of two lists of one query
+  MPI_Request *reduce; // reduction of every query panel to its owner
+} mpi_topk_state;
+
+/* Matches of one query: target and count pairs, in increasing target order
+   because the pairs of a query are counted in increasing target order */
+typedef struct {
+  int *pairs;
+  size_t n, cap;
+} mpi_matches;
+
+typedef struct {
+  const mpi_layout *lay;
+  int threshold;
+  bool gpu;
+  mpi_matches *matches; // every query of the block
+  size_t *offsets;      // CSR of one pair of panels
+} mpi_threshold_state;
+
+/* --- End Section 5: INTERNAL DATA STRUCTURES AND ENUMS --- */
+
+/* ==========================================================================
+   SECTION 8: INTERNAL HELPER FUNCTION DEFINITIONS
+   ========================================================================== */
+
+/* Rank of grid position (r, c) */
+static inline int grid_rank(Bit_mpi_grid_T grid, int r, int c) {
+  return r * grid->cols + c;
+}
+
+/* Shares the panel sizes of bit and bits and checks that every row has the
+   same length */
+static void mpi_layout_init(mpi_layout *lay, Bit_mpi_grid_T grid, T_DB bit,
+                            T_DB bits) {
+  const int size = grid->rows * grid->cols;
+  const int mine[3] = {(int)bit->nelem, (int)bits->nelem, (int)bit->length};
+  int *all = malloc(3 * (size_t)size * sizeof(int));
+  assert(all);
+  MPI_Allgather(mine, 3, MPI_INT, all, 3, MPI_INT, grid->comm);
+  lay->length = all[2];
+  lay->qsize = malloc((size_t)size * sizeof(int));
+  lay->tsize = malloc((size_t)size * sizeof(int));
+  lay->qoff = malloc((size_t)(grid->cols + 1) * sizeof(int));
+  lay->toff = malloc((size_t)(grid->rows + 1) * sizeof(int));
+  assert(lay->qsize && lay->tsize && lay->qoff && lay->toff);
+  for (int r = 0; r < size; r++) {
+    lay->qsize[r] = all[3 * r];
+    lay->tsize[r] = all[3 * r + 1];
+    assert(all[3 * r + 2] == lay->length);
+    assert(lay->qsize[r] > 0 && lay->tsize[r] > 0);
+  }
+  free(all);
+  size_t first = 0;
+  for (int r = 0; r < grid->row * grid->cols; r++)
+    first += lay->qsize[r];
+  lay->qoff[0] = 0;
+  for (int a = 0; a < grid->cols; a++)
+    lay->qoff[a + 1] =
+        lay->qoff[a] + lay->qsize[grid_rank(grid, grid->row, a)];
+  assert(first + lay->qoff[grid->cols] <= INT_MAX);
+  lay->first_query = (int)first;
+  first = 0;
+  for (int c = 0; c < grid->col; c++)
+    for (int r = 0; r < grid->rows; r++)
+      first += lay->tsize[grid_rank(grid, r, c)];
+  lay->toff[0] = 0;
+  for (int b = 0; b < grid->rows; b++)
+    lay->toff[b + 1] =
+        lay->toff[b] + lay->tsize[grid_rank(grid, b, grid->col)];
+  assert(first + lay->toff[grid->rows] <= INT_MAX);
+  lay->first_target = (int)first;
+  MPI_Type_contiguous((int)(nqwords(lay->length) * (BPQW / BPB)), MPI_BYTE,
+                      &lay->row_type);
+  MPI_Type_commit(&lay->row_type);
+}
+
+static void mpi_layout_free(mpi_layout *lay) {
+  MPI_Type_free(&lay->row_type);
+  free(lay->qsize);
+  free(lay->tsize);
+  free(lay->qoff);
+  free(lay->toff);
+}
+
+/* set itself if its rows are packed, else a packed copy */
+static T_DB mpi_packed(T_DB set) {
+  if (set->stride_in_bytes == set->size_in_bytes)
+    return set;
+  T_DB copy = BitDB_new((int)set->length, (int)set->nelem);
+  for (unsigned int r = 0; r < set->nelem; r++)
+    memcpy(copy->bytes + (size_t)r * copy->size_in_bytes,
+           set->bytes + (size_t)r * set->stride_in_bytes, set->size_in_bytes);
+  return copy;
+}
+
+/* Posts the broadcast of panel root of comm (own on the root) into a new
+   container of nrows rows elsewhere */
+static T_DB mpi_panel_post(const mpi_layout *lay, MPI_Comm comm, int root,
+                           int me, T_DB own, int nrows, MPI_Request *req) {
+  T_DB panel = root == me ? mpi_packed(own) : BitDB_new(lay->length, nrows);
+  MPI_Ibcast(panel->bytes, nrows, lay->row_type, root, comm, req);
+  return panel;
+}
+
+static void mpi_panel_free(T_DB panel, T_DB own) {
+  if (panel != own)
+    BitDB_free(&panel);
+}
+
+/* The SUMMA sweep: every query panel of this grid row against every target
+   panel of this grid column, broadcasting the next panel while pair_fn
+   counts the current one. The GPU flags of opts are set so that each
+   panel is copied to the device on its first pair and released after its
+   last. done, if not NULL, is called once the pairs of query panel a are
+   all counted. */
+static void mpi_sweep(Bit_mpi_grid_T grid, const mpi_layout *lay, T_DB bit,
+                      T_DB bits, SETOP_COUNT_OPTS opts, mpi_pair_fn *pair_fn,
+                      void done(void *cl, int a), void *cl) {
+  const int rows = grid->rows, cols = grid->cols;
+  T_DB *targets = malloc((size_t)rows * sizeof(T_DB));
+  MPI_Request *target_req = malloc((size_t)rows * sizeof(MPI_Request));
+  T_DB queries[2];
+  MPI_Request query_req[2];
+  assert(targets && target_req);
+  queries[0] = mpi_panel_post(lay, grid->row_comm, 0, grid->col, bit,
+                              lay->qsize[grid_rank(grid, grid->row, 0)],
+                              &query_req[0]);
+  targets[0] = mpi_panel_post(lay, grid->col_comm, 0, grid->row, bits,
+                              lay->tsize[grid_rank(grid, 0, grid->col)],
+                              &target_req[0]);
+  for (int a = 0; a < cols; a++) {
+    MPI_Wait(&query_req[a % 2], MPI_STATUS_IGNORE);
+    if (a + 1 < cols)
+      queries[(a + 1) % 2] = mpi_panel_post(
+          lay, grid->row_comm, a + 1, grid->col, bit,
+          lay->qsize[grid_rank(grid, grid->row, a + 1)],
+          &query_req[(a + 1) % 2]);
+    for (int b = 0; b < rows; b++) {
+      if (a == 0) {
+        MPI_Wait(&target_req[b], MPI_STATUS_IGNORE);
+        if (b + 1 < rows)
+          targets[b + 1] = mpi_panel_post(
+              lay, grid->col_comm, b + 1, grid->row, bits,
+              lay->tsize[grid_rank(grid, b + 1, grid->col)],
+              &target_req[b + 1]);
+      }
+      SETOP_COUNT_OPTS step = opts;
+      step.upd_1st_operand = b == 0;
+      step.release_1st_operand = b == rows - 1;
+      step.upd_2nd_operand = a == 0;
+      step.release_2nd_operand = a == cols - 1;
+      pair_fn(cl, a, queries[a % 2], b, targets[b], step);
+    }
+    if (done)
+      done(cl, a);
+    mpi_panel_free(queries[a % 2], bit);
+  }
+  for (int b = 0; b < rows; b++)
+    mpi_panel_free(targets[b], bits);
+  free(targets);
+  free(target_req);
+}
+
+static void mpi_tile_pair(void *cl, int a, T_DB queries, int b,
+                          T_DB targets, SETOP_COUNT_OPTS opts) {
+  mpi_tile_state *s = cl;
+  const int nq = (int)queries->nelem, nt = (int)targets->nelem;
+  if (s->gpu)
+    BitDB_count_store_typed_gpu(queries, targets, s->op, s->scratch,
+                                BIT_COUNTS_I32, bit_stop_ignored(opts));
+  else
+    BitDB_count_store_typed_cpu(queries, targets, s->op, s->scratch,
+                                BIT_COUNTS_I32, bit_stop_ignored(opts));
+  int *out = s->counts + (size_t)s->lay->qoff[a] * s->ntarget +
+             s->lay->toff[b];
+  for (int q = 0; q < nq; q++)
+    memcpy(out + (size_t)q * s->ntarget, s->scratch + (size_t)q * nt,
+           (size_t)nt * sizeof(int));
+}
+
+/* Whether slot (i1, c1) ranks above slot (i2, c2): larger count, then
+   lower target; empty slots (index -1) rank last */
+static inline bool topk_above(int i1, int c1, int i2, int c2) {
+  if (i2 < 0)
+    return i1 >= 0;
+  if (i1 < 0)
+    return false;
+  return c1 > c2 || (c1 == c2 && i1 < i2);
+}
+
+/* Merges list in (k indices, then k counts) into list inout */
+static void topk_merge(int *inout, const int *in, int k, int *scratch) {
+  int x = 0, y = 0;
+  for (int r = 0; r < k; r++) {
+    if (topk_above(in[y], in[k + y], inout[x], inout[k + x])) {
+      scratch[r] = in[y];
+      scratch[k + r] = in[k + y++];
+    } else {
+      scratch[r] = inout[x];
+      scratch[k + r] = inout[k + x++];
+    }
+  }
+  memcpy(inout, scratch, 2 * (size_t)k * sizeof(int));
+}
+
+static void mpi_topk_op(void *in, void *inout, int *len,
+                        MPI_Datatype *type) {
+  int bytes;
+  MPI_Type_size(*type, &bytes);
+  const int k = bytes / (int)(2 * sizeof(int));
+  int *scratch = malloc(2 * (size_t)k * sizeof(int));
+  assert(scratch);
+  for (int q = 0; q < *len; q++)
+    topk_merge((int *)inout + 2 * (size_t)k * q,
+               (const int *)in + 2 * (size_t)k * q, k, scratch);
+  free(scratch);
+}
+
+static void mpi_topk_pair(void *cl, int a, T_DB queries, int b,
+                          T_DB targets, SETOP_COUNT_OPTS opts) {
+  mpi_topk_state *s = cl;
+  const int k = s->k, first = s->lay->first_target + s->lay->toff[b];
+  if (s->gpu)
+    BitDB_inter_count_topk_gpu(queries, targets, k, opts, s->idx, s->count);
+  else
+    BitDB_inter_count_topk(queries, targets, k, opts, s->idx, s->count);
+  int *list = malloc(4 * (size_t)k * sizeof(int));
+  assert(list);
+  for (unsigned int q = 0; q < queries->nelem; q++) {
+    for (int r = 0; r < k; r++) {
+      const int i = s->idx[(size_t)q * k + r];
+      list[r] = i < 0 ? -1 : first + i;
+      list[k + r] = s->count[(size_t)q * k + r];
+    }
+    topk_merge(s->best + 2 * (size_t)k * (s->lay->qoff[a] + q), list, k,
+               list + 2 * k);
+  }
+  free(list);
+}
+
+/* Posts the reduction of the lists of query panel a to its owner, rank
+   (row, a), while the next panels are counted */
+static void mpi_topk_done(void *cl, int a) {
+  mpi_topk_state *s = cl;
+  const Bit_mpi_grid_T grid = s->grid;
+  int *lists = s->best + 2 * (size_t)s->k * s->lay->qoff[a];
+  const int n = s->lay->qsize[grid_rank(grid, grid->row, a)];
+  MPI_Ireduce(a == grid->col ? MPI_IN_PLACE : lists, lists, n, s->type,
+              s->op, a, grid->row_comm, &s->reduce[a]);
+}
+
+static void mpi_matches_push(mpi_matches *m, int target, int count) {
+  if (m->n == m->cap) {
+    m->cap = m->cap ? 2 * m->cap : 8;
+    m->pairs = realloc(m->pairs, 2 * m->cap * sizeof(int));
+    assert(m->pairs);
+  }
+  m->pairs[2 * m->n] = target;
+  m->pairs[2 * m->n + 1] = count;
+  m->n++;
+}
+
+static void mpi_threshold_pair(void *cl, int a, T_DB queries, int b,
+                               T_DB targets, SETOP_COUNT_OPTS opts) {
+  mpi_threshold_state *s = cl;
+  const int first = s->lay->first_target + s->lay->toff[b];
+  int *idx, *count;
+  if (s->gpu)
+    BitDB_inter_count_threshold_gpu(queries, targets, s->threshold, opts,
+                                    s->offsets, &idx, &count);
+  else
+    BitDB_inter_count_threshold(queries, targets, s->threshold, opts,
+                                s->offsets, &idx, &count);
+  for (unsigned int q = 0; q < queries->nelem; q++) {
+    mpi_matches *m = &s->matches[s->lay->qoff[a] + q];
+    for (size_t e = s->offsets[q]; e < s->offsets[q + 1]; e++)
+      mpi_matches_push(m, first + idx[e], count[e]);
+  }
+  free(idx);
+  free(count);
+}
+
+static void mpi_count_pairs(Bit_mpi_grid_T grid, T_DB bit, T_DB bits,
+                            Bit_count_ops op, bool gpu,
+                            SETOP_COUNT_OPTS opts, Bit_mpi_tile *tile) {
+  assert(grid && bit && bits && tile);
+  assert(bit->length == bits->length);
+  assert(op == BIT_COUNT_INTER || op == BIT_COUNT_UNION ||
+         op == BIT_COUNT_DIFF || op == BIT_COUNT_MINUS);
+  assert(opts.row_mask == NULL);
+  mpi_layout lay;
+  mpi_layout_init(&lay, grid, bit, bits);
+  const int nquery = lay.qoff[grid->cols], ntarget = lay.toff[grid->rows];
+  int max_query = 0, max_target = 0;
+  for (int a = 0; a < grid->cols; a++)
+    max_query = lay.qoff[a + 1] - lay.qoff[a] > max_query
+                    ? lay.qoff[a + 1] - lay.qoff[a]
+                    : max_query;
+  for (int b = 0; b < grid->rows; b++)
+    max_target = lay.toff[b + 1] - lay.toff[b] > max_target
+                     ? lay.toff[b + 1] - lay.toff[b]
+                     : max_target;
+  mpi_tile_state s = {.lay = &lay, .op = op, .gpu = gpu, .ntarget = ntarget};
+  s.counts = malloc((size_t)nquery * ntarget * sizeof(int));
+  s.scratch = malloc((size_t)max_query * max_target * sizeof(int));
+  assert(s.counts && s.scratch);
+  mpi_sweep(grid, &lay, bit, bits, opts, mpi_tile_pair, NULL, &s);
+  free(s.scratch);
+  *tile = (Bit_mpi_tile){.first_query = lay.first_query,
+                         .nquery = nquery,
+                         .first_target = lay.first_target,
+                         .ntarget = ntarget,
+                         .counts = s.counts};
+  mpi_layout_free(&lay);
+}
+
+static void mpi_topk(Bit_mpi_grid_T grid, T_DB bit, T_DB bits, int k,
+                     bool gpu, SETOP_COUNT_OPTS opts, int *out_idx,
+                     int *out_count) {
+  assert(grid && bit && bits && out_idx && out_count);
+  assert(bit->length == bits->length);
+  assert(k >= 1);
+  assert(opts.row_mask == NULL);
+  mpi_layout lay;
+  mpi_layout_init(&lay, grid, bit, bits);
+  const size_t nquery = lay.qoff[grid->cols];
+  int max_query = 0;
+  for (int a = 0; a < grid->cols; a++)
+    if (lay.qoff[a + 1] - lay.qoff[a] > max_query)
+      max_query = lay.qoff[a + 1] - lay.qoff[a];
+  mpi_topk_state s = {.lay = &lay, .grid = grid, .k = k, .gpu = gpu};
+  s.best = malloc(2 * nquery * k * sizeof(int));
+  s.idx = malloc((size_t)max_query * k * sizeof(int));
+  s.count = malloc((size_t)max_query * k * sizeof(int));
+  s.reduce = malloc((size_t)grid->cols * sizeof(MPI_Request));
+  assert(s.best && s.idx && s.count && s.reduce);
+  for (size_t e = 0; e < 2 * nquery * k; e++)
+    s.best[e] = -1;
+  MPI_Type_contiguous(2 * k, MPI_INT, &s.type);
+  MPI_Type_commit(&s.type);
+  MPI_Op_create(mpi_topk_op, 1, &s.op);
+  mpi_sweep(grid, &lay, bit, bits, opts, mpi_topk_pair, mpi_topk_done, &s);
+  MPI_Waitall(grid->cols, s.reduce, MPI_STATUSES_IGNORE);
+  const int *mine = s.best + 2 * (size_t)k * lay.qoff[grid->col];
+  for (unsigned int q = 0; q < bit->nelem; q++) {
+    memcpy(out_idx + (size_t)q * k, mine + 2 * (size_t)k * q,
+           (size_t)k * sizeof(int));
+    memcpy(out_count + (size_t)q * k, mine + 2 * (size_t)k * q + k,
+           (size_t)k * sizeof(int));
+  }
+  MPI_Op_free(&s.op);
+  MPI_Type_free(&s.type);
+  free(s.best);
+  free(s.idx);
+  free(s.count);
+  free(s.reduce);
+  mpi_layout_free(&lay);
+}
+
+static size_t mpi_threshold(Bit_mpi_grid_T grid, T_DB bit, T_DB bits,
+                            int threshold, bool gpu, SETOP_COUNT_OPTS opts,
+                            size_t *offsets, int **out_idx,
+                            int **out_count) {
+  assert(grid && bit && bits && offsets && out_idx && out_count);
+  assert(bit->length == bits->length);
+  assert(opts.row_mask == NULL);
+  mpi_layout lay;
+  mpi_layout_init(&lay, grid, bit, bits);
+  const int cols = grid->cols, nquery = lay.qoff[cols];
+  int max_query = 0;
+  for (int a = 0; a < cols; a++)
+    if (lay.qoff[a + 1] - lay.qoff[a] > max_query)
+      max_query = lay.qoff[a + 1] - lay.qoff[a];
+  mpi_threshold_state s = {.lay = &lay, .threshold = threshold, .gpu = gpu};
+  s.matches = calloc((size_t)nquery, sizeof(mpi_matches));
+  s.offsets = malloc(((size_t)max_query + 1) * sizeof(size_t));
+  assert(s.matches && s.offsets);
+  mpi_sweep(grid, &lay, bit, bits, opts, mpi_threshold_pair, NULL, &s);
+
+  /* Gather the matches of every query panel on its owner: first how many
+     each rank of the grid row found per query, then the pairs, which come
+     in increasing target order because target block j precedes j + 1 */
+  const int nmine = (int)bit->nelem;
+  int *found = malloc((size_t)cols * nmine * sizeof(int));
+  int *totals = malloc((size_t)cols * sizeof(int));
+  int *displs = malloc((size_t)cols * sizeof(int));
+  int *pairs = NULL;
+  assert(found && totals && displs);
+  for (int a = 0; a < cols; a++) {
+    const int first = lay.qoff[a], n = lay.qoff[a + 1] - first;
+    int *sent = malloc(((size_t)n + 1) * sizeof(int));
+    assert(sent);
+    size_t total = 0;
+    for (int q = 0; q < n; q++) {
+      assert(s.matches[first + q].n <= INT_MAX);
+      sent[q] = (int)s.matches[first + q].n;
+      total += s.matches[first + q].n;
+    }
+    assert(total <= INT_MAX / 2);
+    int *packed = malloc((2 * total + 1) * sizeof(int));
+    assert(packed);
+    total = 0;
+    for (int q = 0; q < n; q++) {
+      mpi_matches *m = &s.matches[first + q];
+      if (m->n)
+        memcpy(packed + 2 * total, m->pairs, 2 * m->n * sizeof(int));
+      total += m->n;
+      free(m->pairs);
+    }
+    MPI_Gather(sent, n, MPI_INT, found, n, MPI_INT, a, grid->row_comm);
+    if (a == grid->col) {
+      size_t all = 0;
+      for (int j = 0; j < cols; j++) {
+        size_t t = 0;
+        for (int q = 0; q < n; q++)
+          t += found[(size_t)j * n + q];
+        assert(all + t <= INT_MAX / 2);
+        displs[j] = 2 * (int)all;
+        totals[j] = 2 * (int)t;
+        all += t;
+      }
+      pairs = malloc((2 * all + 1) * sizeof(int));
+      assert(pairs);
+    }
+    MPI_Gatherv(packed, 2 * (int)total, MPI_INT, pairs, totals, displs,
+                MPI_INT, a, grid->row_comm);
+    free(packed);
+    free(sent);
+  }
+
+  /* Lay the pairs out query by query, rank j's before rank j + 1's */
+  size_t *cursor = malloc((size_t)cols * sizeof(size_t));
+  assert(cursor);
+  offsets[0] = 0;
+  for (int q = 0; q < nmine; q++) {
+    size_t n = 0;
+    for (int j = 0; j < cols; j++)
+      n += found[(size_t)j * nmine + q];
+    offsets[q + 1] = offsets[q] + n;
+  }
+  const size_t total = offsets[nmine];
+  *out_idx = malloc((total ? total : 1) * sizeof(int));
+  *out_count = malloc((total ? total : 1) * sizeof(int));
+  assert(*out_idx && *out_count);
+  for (int j = 0; j < cols; j++)
+    cursor[j] = (size_t)displs[j] / 2;
+  for (int q = 0; q < nmine; q++) {
+    size_t e = offsets[q];
+    for (int j = 0; j < cols; j++)
+      for (int m = 0; m < found[(size_t)j * nmine + q]; m++, e++) {
+        (*out_idx)[e] = pairs[2 * cursor[j]];
+        (*out_count)[e] = pairs[2 * cursor[j] + 1];
+        cursor[j]++;
+      }
+  }
+  free(cursor);
+  free(pairs);
+  free(found);
+  free(totals);
+  free(displs);
+  free(s.matches);
+  free(s.offsets);
+  mpi_layout_free(&lay);
+  return total;
+}
+
+/* --- End Section 8: INTERNAL HELPER FUNCTION DEFINITIONS --- */
+
+/* ==========================================================================
+   SECTION 9: PUBLIC API
+   ========================================================================== */
+
+Bit_mpi_grid_T Bit_mpi_grid_new(MPI_Comm comm, int grid_rows,
+                                int grid_cols) {
+  int size, rank;
+  assert(grid_rows >= 0 && grid_cols >= 0);
+  MPI_Comm_size(comm, &size);
+  MPI_Comm_rank(comm, &rank);
+  if (grid_rows > 0 && grid_cols > 0)
+    assert(grid_rows * grid_cols == size);
+  else
+    assert(size % (grid_rows + grid_cols ? grid_rows + grid_cols : 1) == 0);
+  int dims[2] = {grid_rows, grid_cols};
+  MPI_Dims_create(size, 2, dims);
+  Bit_mpi_grid_T grid = malloc(sizeof(*grid));
+  assert(grid);
+  grid->rows = dims[0];
+  grid->cols = dims[1];
+  grid->row = rank / grid->cols;
+  grid->col = rank % grid->cols;
+  MPI_Comm_dup(comm, &grid->comm);
+  MPI_Comm_split(grid->comm, grid->row, grid->col, &grid->row_comm);
+  MPI_Comm_split(grid->comm, grid->col, grid->row, &grid->col_comm);
+  return grid;
+}
+
+void Bit_mpi_grid_free(Bit_mpi_grid_T *grid) {
+  assert(grid && *grid);
+  MPI_Comm_free(&(*grid)->row_comm);
+  MPI_Comm_free(&(*grid)->col_comm);
+  MPI_Comm_free(&(*grid)->comm);
+  free(*grid);
+  *grid = NULL;
+}
+
+void Bit_mpi_grid_shape(Bit_mpi_grid_T grid, int *grid_rows, int *grid_cols,
+                        int *row, int *col) {
+  assert(grid);
+  if (grid_rows)
+    *grid_rows = grid->rows;
+  if (grid_cols)
+    *grid_cols = grid->cols;
+  if (row)
+    *row = grid->row;
+  if (col)
+    *col = grid->col;
+}
+
+T_DB Bit_mpi_scatter(Bit_mpi_grid_T grid, T_DB db, int root, bool targets) {
+  assert(grid);
+  int size, rank;
+  MPI_Comm_size(grid->comm, &size);
+  MPI_Comm_rank(grid->comm, &rank);
+  assert(root >= 0 && root < size);
+  assert(rank != root || db);
+  int shape[2] = {db ? (int)db->nelem : 0, db ? (int)db->length : 0};
+  MPI_Bcast(shape, 2, MPI_INT, root, grid->comm);
+  const int nelem = shape[0], length = shape[1];
+  assert(nelem >= size);
+
+  /* Rows in order of rank for queries, of column-major rank for targets */
+  int *counts = malloc((size_t)size * sizeof(int));
+  int *displs = malloc((size_t)size * sizeof(int));
+  assert(counts && displs);
+  int first = 0;
+  for (int p = 0; p < size; p++) {
+    const int r = targets ? grid_rank(grid, p % grid->rows, p / grid->rows)
+                          : p;
+    counts[r] = nelem / size + (p < nelem % size);
+    displs[r] = first;
+    first += counts[r];
+  }
+  MPI_Datatype row_type;
+  MPI_Type_contiguous((int)(nqwords(length) * (BPQW / BPB)), MPI_BYTE,
+                      &row_type);
+  MPI_Type_commit(&row_type);
+  T_DB local = BitDB_new(length, counts[rank]);
+  T_DB source = rank == root ? mpi_packed(db) : NULL;
+  MPI_Scatterv(source ? source->bytes : NULL, counts, displs, row_type,
+               local->bytes, counts[rank], row_type, root, grid->comm);
+  if (source && source != db)
+    BitDB_free(&source);
+  MPI_Type_free(&row_type);
+  free(counts);
+  free(displs);
+  return local;
+}
+
+void Bit_mpi_count_tile_cpu(Bit_mpi_grid_T grid, T_DB bit, T_DB bits,
+                            Bit_count_ops op, SETOP_COUNT_OPTS opts,
+                            Bit_mpi_tile *tile) {
+  mpi_count_pairs(grid, bit, bits, op, false, opts, tile);
+}
+
+void Bit_mpi_count_tile_gpu(Bit_mpi_grid_T grid, T_DB bit, T_DB bits,
+                            Bit_count_ops op, SETOP_COUNT_OPTS opts,
+                            Bit_mpi_tile *tile) {
+  mpi_count_pairs(grid, bit, bits, op, true, opts, tile);
+}
+
+void Bit_mpi_inter_count_topk(Bit_mpi_grid_T grid, T_DB bit, T_DB bits,
+                              int k, SETOP_COUNT_OPTS opts, int *out_idx,
+                              int *out_count) {
+  mpi_topk(grid, bit, bits, k, false, opts, out_idx, out_count);
+}
+
+void Bit_mpi_inter_count_topk_gpu(Bit_mpi_grid_T grid, T_DB bit, T_DB bits,
+                                  int k, SETOP_COUNT_OPTS opts, int *out_idx,
+                                  int *out_count) {
+  mpi_topk(grid, bit, bits, k, true, opts, out_idx, out_count);
+}
+
+size_t Bit_mpi_inter_count_threshold(Bit_mpi_grid_T grid, T_DB bit,
+                                     T_DB bits, int threshold,
+                                     SETOP_COUNT_OPTS opts, size_t *offsets,
+                                     int **out_idx, int **out_count) {
+  return mpi_threshold(grid, bit, bits, threshold, false, opts, offsets,
+                       out_idx, out_count);
+}
+
+size_t Bit_mpi_inter_count_threshold_gpu(Bit_mpi_grid_T grid, T_DB bit,
+                                         T_DB bits, int threshold,
+                                         SETOP_COUNT_OPTS opts,
+                                         size_t *offsets, int **out_idx,
+                                         int **out_count) {
+  return mpi_threshold(grid, bit, bits, threshold, true, opts, offsets,
+                       out_idx, out_count);
+}
+
+/* --- End Section 9: PUBLIC API --- */
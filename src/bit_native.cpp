@@ -0,0 +1,1223 @@
+/*
+    Native CUDA / HIP backend of the Bit library: runs the coarsened popcount
+    kernel of benchmark/gpu_kernels.h, or on NVIDIA sm_75 and later a binary
+    tensor-core kernel, behind the NATIVE_COARSENED algorithm of the
+    BitDB_*_count_store_gpu functions. Built as libbit_cuda.so by nvcc
+    (make libbit_cuda) or as libbit_hip.so by hipcc (make libbit_hip), and
+    loaded by libbit at run time, see bit_native.h.
+
+    * Author : Christos Argyropoulos
+    * Created : October 15th 2026
+    * Copyright : (c) 2025 - 2026
+    * License : BSD-2
+*/
+
+#if defined(__HIP__)
+#include <hip/hip_runtime.h>
+#else
+#include <cuda_runtime.h>
+#include <mma.h> // b1 matrix fragments of the tensor-core kernel
+#endif
+
+#include <limits.h> // INT_MAX
+#include <mutex>    // one count at a time per process
+#include <stdint.h> // uint64_t
+#include <stdio.h>  // fprintf
+#include <stdlib.h> // getenv
+#include <string.h> // strcmp
+
+#if defined(__HIP__)
+typedef hipError_t gpu_error_t;
+#define GPU_SUCCESS hipSuccess
+#define GPU_ERROR_MEMORY hipErrorOutOfMemory
+#define GPU_ERROR_STRING hipGetErrorString
+#define GPU_GET_DEVICE_COUNT hipGetDeviceCount
+#define GPU_MALLOC hipMalloc
+#define GPU_FREE hipFree
+#define GPU_MEMCPY hipMemcpy
+#define GPU_MEMCPY_2D hipMemcpy2D
+#define GPU_MEMCPY_ASYNC hipMemcpyAsync
+#define GPU_MEMSET hipMemset
+#define GPU_MALLOC_HOST(p, n) hipHostMalloc(p, n, hipHostMallocDefault)
+#define GPU_FREE_HOST hipHostFree
+#define GPU_STREAM_CREATE hipStreamCreate
+#define GPU_STREAM_DESTROY hipStreamDestroy
+#define GPU_STREAM_SYNC hipStreamSynchronize
+typedef hipGraph_t gpu_graph_t;
+typedef hipGraphExec_t gpu_graph_exec_t;
+#define GPU_STREAM_BEGIN_CAPTURE(s)                                            \
+  hipStreamBeginCapture(s, hipStreamCaptureModeThreadLocal)
+#define GPU_STREAM_END_CAPTURE hipStreamEndCapture
+#define GPU_GRAPH_INSTANTIATE(e, g) hipGraphInstantiateWithFlags(e, g, 0)
+#define GPU_GRAPH_LAUNCH hipGraphLaunch
+#define GPU_GRAPH_DESTROY hipGraphDestroy
+#define GPU_GRAPH_EXEC_DESTROY hipGraphExecDestroy
+#define GPU_MEMCPY_H2D hipMemcpyHostToDevice
+#define GPU_MEMCPY_D2H hipMemcpyDeviceToHost
+#define BACKEND_NAME "hip"
+#else
+typedef cudaError_t gpu_error_t;
+#define GPU_SUCCESS cudaSuccess
+#define GPU_ERROR_MEMORY cudaErrorMemoryAllocation
+#define GPU_ERROR_STRING cudaGetErrorString
+#define GPU_GET_DEVICE_COUNT cudaGetDeviceCount
+#define GPU_MALLOC cudaMalloc
+#define GPU_FREE cudaFree
+#define GPU_MEMCPY cudaMemcpy
+#define GPU_MEMCPY_2D cudaMemcpy2D
+#define GPU_MEMCPY_ASYNC cudaMemcpyAsync
+#define GPU_MEMSET cudaMemset
+#define GPU_MALLOC_HOST cudaMallocHost
+#define GPU_FREE_HOST cudaFreeHost
+#define GPU_STREAM_CREATE cudaStreamCreate
+#define GPU_STREAM_DESTROY cudaStreamDestroy
+#define GPU_STREAM_SYNC cudaStreamSynchronize
+typedef cudaGraph_t gpu_graph_t;
+typedef cudaGraphExec_t gpu_graph_exec_t;
+#define GPU_STREAM_BEGIN_CAPTURE(s)                                            \
+  cudaStreamBeginCapture(s, cudaStreamCaptureModeThreadLocal)
+#define GPU_STREAM_END_CAPTURE cudaStreamEndCapture
+#define GPU_GRAPH_INSTANTIATE(e, g) cudaGraphInstantiateWithFlags(e, g, 0)
+#define GPU_GRAPH_LAUNCH cudaGraphLaunch
+#define GPU_GRAPH_DESTROY cudaGraphDestroy
+#define GPU_GRAPH_EXEC_DESTROY cudaGraphExecDestroy
+#define GPU_MEMCPY_H2D cudaMemcpyHostToDevice
+#define GPU_MEMCPY_D2H cudaMemcpyDeviceToHost
+#define BACKEND_NAME "cuda"
+#endif
+
+/* First failed runtime call of the count in progress. Unlike the benchmark
+   harness, a failure does not exit: the count reports it, and libbit runs
+   the OpenMP kernels instead */
+static gpu_error_t native_status = GPU_SUCCESS;
+#define GPU_CHECK(call)                                                        \
+  do {                                                                         \
+    gpu_error_t _err = (call);                                                 \
+    if (_err != GPU_SUCCESS && native_status == GPU_SUCCESS) {                 \
+      fprintf(stderr, "libbit_" BACKEND_NAME ": %s at %s:%d\n",                \
+              GPU_ERROR_STRING(_err), __FILE__, __LINE__);                     \
+      native_status = _err;                                                    \
+    }                                                                          \
+  } while (0)
+
+#include "bit_native.h"
+#include "gpu_kernels.h"
+
+/* Devices with their own operand cache; higher ids are refused */
+#define NATIVE_MAX_DEVICES 64
+
+/* Fragments of the tensor-core kernel: BMMA_ROWS rows by BMMA_BITS bits
+   (BMMA_WORDS words), one aligned 128-byte block each; a warp counts one
+   BMMA_ROWS x BMMA_ROWS tile of pairs, BMMA_WARPS warps per block */
+#define BMMA_ROWS 8
+#define BMMA_BITS 128
+#define BMMA_WORDS (BMMA_BITS / 64)
+#define BMMA_WARPS 4
+
+/* Queries from which the register-blocked kernel beats the coarsened one:
+   below that most of its R query rows per block would be padding */
+#ifndef NATIVE_OUTER_MIN_QUERIES
+#define NATIVE_OUTER_MIN_QUERIES (8 * GPU_OUTER_ROWS)
+#endif
+
+typedef enum {
+  NATIVE_KERNEL_AUTO,
+  NATIVE_KERNEL_COARSENED, // compute_setop_popcount_coarsened_kernel
+  NATIVE_KERNEL_OUTER,     // compute_setop_popcount_outer_kernel
+  NATIVE_KERNEL_SHUFFLE,   // compute_setop_popcount_shuffle_kernel
+  NATIVE_KERNEL_BMMA,      // bmma_count_kernel
+} NativeKernel;
+
+/* Device representations of an operand */
+typedef enum {
+  NATIVE_ROWS,       // rows packed words wide (coarsened kernel queries)
+  NATIVE_WORD_MAJOR, // words x rows (coarsened kernel targets)
+  NATIVE_BMMA_TILES, // fragments of 8-row tiles (tensor-core kernel)
+} NativeLayout;
+
+/* Device copy of one operand, kept for the next call with the same host
+   rows. Tiled operands are padded with zero rows and words to whole
+   fragments, and carry the population of every row */
+typedef struct {
+  const uint64_t *host;
+  size_t rows;
+  size_t stride;
+  size_t words;
+  NativeLayout layout;
+  uint64_t *data;
+  int *population;
+} NativeOperand;
+
+/* Streams of the chunked query pipeline, each with pinned staging of one
+   chunk and its device buffers, created on first use */
+#ifndef NATIVE_STREAMS
+#define NATIVE_STREAMS 3
+#endif
+/* Bytes of query rows and counts per chunk */
+#ifndef NATIVE_CHUNK_BYTES
+#define NATIVE_CHUNK_BYTES (16u << 20)
+#endif
+
+typedef struct {
+  gpu_stream_t stream;
+  gpu_event_t done; // chunk counts are in host_counts
+  uint64_t *host_queries;
+  int *host_counts;
+  uint64_t *queries;
+  int *counts;
+  size_t queries_capacity; // words of host_queries and queries
+  size_t counts_capacity;  // ints of host_counts and counts
+  size_t first;            // query of the chunk in flight
+  size_t rows;             // its rows, 0 if none
+} NativeStream;
+
+/* Shapes of graph mode counts kept instantiated per device */
+#ifndef NATIVE_GRAPHS
+#define NATIVE_GRAPHS 4
+#endif
+
+/* Instantiations of the kernels per set operation: BIT_NATIVE_OP_* for a
+   single op, NATIVE_OP_FUSED for the fused kernel on SetOpAll, which
+   writes the counts of every op, one matrix per op in BIT_NATIVE_OP_*
+   order */
+#define NATIVE_OP_FUSED BIT_NATIVE_OPS
+#define NATIVE_OP_SLOTS 5
+static_assert(1u << BIT_NATIVE_OP_AND == GPU_OP_INTER &&
+                  1u << BIT_NATIVE_OP_OR == GPU_OP_UNION &&
+                  1u << BIT_NATIVE_OP_XOR == GPU_OP_DIFF &&
+                  1u << BIT_NATIVE_OP_AND_NOT == GPU_OP_MINUS,
+              "fused count matrices in BIT_NATIVE_OP_* order");
+
+/* Instantiations of the coarsened kernel for one GPU_TILE_J x GPU_ILP, and
+   of the shuffle kernel for the ILP, with dense counts and, per single op,
+   with the threshold matches as output */
+typedef void (*native_launch)(const uint64_t *, const uint64_t *, int *, int,
+                              int, int, gpu_stream_t);
+typedef void (*native_match_launch)(const uint64_t *, const uint64_t *,
+                                    MatchesOut, int, int, int, gpu_stream_t);
+typedef struct {
+  int tile_j;
+  int ilp;
+  native_launch coarsened[NATIVE_OP_SLOTS];
+  native_launch shuffle[NATIVE_OP_SLOTS];
+  native_match_launch coarsened_matches[BIT_NATIVE_OPS];
+  native_match_launch shuffle_matches[BIT_NATIVE_OPS];
+} NativeVariant;
+
+static_assert(sizeof(bit_native_match) == sizeof(GpuMatch),
+              "matches are copied to the caller as they are");
+
+/* Counters of a threshold launch (see MatchesOut) */
+typedef struct {
+  unsigned long long total;
+  int resume;
+} NativeMatchState;
+
+/* Upload, count and download of one batch, captured from the first stream,
+   with the buffers, shape and kernel it was captured for */
+typedef struct {
+  gpu_graph_exec_t exec;
+  const uint64_t *queries;
+  const uint64_t *targets;
+  const int *counts;
+  size_t rows;
+  size_t num_targets;
+  size_t words;
+  native_launch launch;
+} NativeGraph;
+
+/* Word counts told apart by the tile and ILP choice: powers of two up to
+   2^(NATIVE_WORD_BUCKETS - 1) words, and everything longer */
+#define NATIVE_WORD_BUCKETS 24
+
+typedef struct {
+  NativeOperand queries;
+  NativeOperand targets;
+  int *counts;
+  size_t counts_capacity;
+  GpuMatch *matches;
+  size_t matches_capacity;
+  NativeMatchState *match_state;
+  char arch[32];                         // "sm_70", "gfx1010", ...
+  // variant + 1 of the coarsened and the shuffle kernel, 0 unset
+  unsigned char tile[2][NATIVE_WORD_BUCKETS];
+  NativeStream streams[NATIVE_STREAMS];
+  NativeGraph graphs[NATIVE_GRAPHS];
+  unsigned int next_graph; // replaced when a new shape is captured
+  bool probed; // bmma is known
+  bool bmma;   // the tensor-core kernel runs on the device
+} NativeDevice;
+
+static NativeDevice native_devices[NATIVE_MAX_DEVICES];
+static std::mutex native_lock;
+
+/* --- Tensor-core kernel (NVIDIA sm_75 and later) --- */
+
+/* Cut rows x words (rows a multiple of BMMA_ROWS, words of BMMA_WORDS)
+   into fragments: every 8-row tile slice by slice, the BMMA_WORDS words of
+   its 8 rows one after the other */
+GPU_KERNEL void bmma_tile_kernel(const uint64_t *in, uint64_t *out,
+                                 size_t rows, size_t words) {
+  const size_t slices = words / BMMA_WORDS;
+  for (size_t idx = blockIdx.x * (size_t)blockDim.x + threadIdx.x;
+       idx < rows * words; idx += (size_t)gridDim.x * blockDim.x) {
+    const size_t r = idx / words, w = idx % words;
+    out[((r / BMMA_ROWS) * slices + w / BMMA_WORDS) * BMMA_ROWS * BMMA_WORDS +
+        (r % BMMA_ROWS) * BMMA_WORDS + w % BMMA_WORDS] = in[idx];
+  }
+}
+
+GPU_KERNEL void row_popcount_kernel(const uint64_t *in, size_t rows,
+                                    size_t words, int *population) {
+  for (size_t r = blockIdx.x * (size_t)blockDim.x + threadIdx.x; r < rows;
+       r += (size_t)gridDim.x * blockDim.x) {
+    int sum = 0;
+    for (size_t w = 0; w < words; w++)
+      sum += (int)popcount_uint64(in[r * words + w]);
+    population[r] = sum;
+  }
+}
+
+/* One warp per 8 x 8 tile of pairs: b1 matrix products of the query and
+   target fragments with OP and popcount accumulation. AND needs sm_80;
+   sm_75 counts XOR and recovers |a & b| = (|a| + |b| - |a ^ b|) / 2 from
+   the row populations. Compiled for older archs the kernel is empty, and
+   bmma_usable() keeps it from running */
+template <unsigned int OP>
+GPU_KERNEL void bmma_count_kernel(const uint64_t *queries,
+                                  const uint64_t *targets,
+                                  const int *query_population,
+                                  const int *target_population, int *counts,
+                                  size_t query_tiles, size_t target_tiles,
+                                  size_t slices) {
+#if defined(__CUDA_ARCH__) && __CUDA_ARCH__ >= 750
+  using namespace nvcuda;
+  const size_t ldc = target_tiles * BMMA_ROWS;
+  const size_t warps = blockDim.x / 32;
+  for (size_t tile = blockIdx.x * warps + threadIdx.x / 32;
+       tile < query_tiles * target_tiles; tile += (size_t)gridDim.x * warps) {
+    const size_t tq = tile / target_tiles, tt = tile % target_tiles;
+    wmma::fragment<wmma::matrix_a, BMMA_ROWS, BMMA_ROWS, BMMA_BITS,
+                   wmma::experimental::precision::b1, wmma::row_major>
+        a;
+    wmma::fragment<wmma::matrix_b, BMMA_ROWS, BMMA_ROWS, BMMA_BITS,
+                   wmma::experimental::precision::b1, wmma::col_major>
+        b;
+    wmma::fragment<wmma::accumulator, BMMA_ROWS, BMMA_ROWS, BMMA_BITS, int>
+        acc;
+    wmma::fill_fragment(acc, 0);
+    const uint64_t *qa = queries + tq * slices * BMMA_ROWS * BMMA_WORDS;
+    const uint64_t *tb = targets + tt * slices * BMMA_ROWS * BMMA_WORDS;
+    for (size_t sl = 0; sl < slices; sl++) {
+      wmma::load_matrix_sync(a, qa + sl * BMMA_ROWS * BMMA_WORDS, BMMA_BITS);
+      wmma::load_matrix_sync(b, tb + sl * BMMA_ROWS * BMMA_WORDS, BMMA_BITS);
+#if __CUDA_ARCH__ >= 800
+      wmma::bmma_sync(acc, a, b, acc,
+                      OP == BIT_NATIVE_OP_AND
+                          ? wmma::experimental::bmmaBitOpAND
+                          : wmma::experimental::bmmaBitOpXOR,
+                      wmma::experimental::bmmaAccumulateOpPOPC);
+#else
+      wmma::bmma_sync(acc, a, b, acc, wmma::experimental::bmmaBitOpXOR,
+                      wmma::experimental::bmmaAccumulateOpPOPC);
+#endif
+    }
+    int *out = counts + tq * BMMA_ROWS * ldc + tt * BMMA_ROWS;
+    wmma::store_matrix_sync(out, acc, (unsigned int)ldc, wmma::mem_row_major);
+#if __CUDA_ARCH__ < 800
+    if (OP == BIT_NATIVE_OP_AND) {
+      __syncwarp();
+      for (unsigned int e = threadIdx.x % 32; e < BMMA_ROWS * BMMA_ROWS;
+           e += 32) {
+        const unsigned int r = e / BMMA_ROWS, c = e % BMMA_ROWS;
+        out[r * ldc + c] = (query_population[tq * BMMA_ROWS + r] +
+                            target_population[tt * BMMA_ROWS + c] -
+                            out[r * ldc + c]) /
+                           2;
+      }
+    }
+#endif
+    __syncwarp();
+  }
+#endif
+}
+
+/* Whether the device runs the tensor-core kernel: compiled for sm_75 or
+   later (the binary picked for this device, not only the device itself) */
+static bool bmma_usable(int device_id) {
+#if defined(__CUDACC__)
+  int major = 0, minor = 0;
+  cudaFuncAttributes attributes;
+  if (cudaDeviceGetAttribute(&major, cudaDevAttrComputeCapabilityMajor,
+                             device_id) != cudaSuccess ||
+      cudaDeviceGetAttribute(&minor, cudaDevAttrComputeCapabilityMinor,
+                             device_id) != cudaSuccess ||
+      cudaFuncGetAttributes(&attributes,
+                            bmma_count_kernel<BIT_NATIVE_OP_XOR>) !=
+          cudaSuccess) {
+    cudaGetLastError(); // not sticky, and not the caller's failure
+    return false;
+  }
+  return major * 10 + minor >= 75 && attributes.binaryVersion >= 75;
+#else
+  (void)device_id; // AMD has no 1-bit matrix instructions
+  return false;
+#endif
+}
+
+/* --- Kernel choice --- */
+
+/* Kernel named by BIT_NATIVE_KERNEL ("coarsened", "outer", "shuffle" or
+   "bmma"), read once; anything else, or a kernel the device or the rows
+   cannot run, picks per call */
+static NativeKernel forced_kernel(void) {
+  static const NativeKernel kernel = [] {
+    const char *name = getenv("BIT_NATIVE_KERNEL");
+    if (name && strcmp(name, "coarsened") == 0)
+      return NATIVE_KERNEL_COARSENED;
+    if (name && strcmp(name, "outer") == 0)
+      return NATIVE_KERNEL_OUTER;
+    if (name && strcmp(name, "shuffle") == 0)
+      return NATIVE_KERNEL_SHUFFLE;
+    if (name && strcmp(name, "bmma") == 0)
+      return NATIVE_KERNEL_BMMA;
+    return NATIVE_KERNEL_AUTO;
+  }();
+  return kernel;
+}
+
+/* The tensor cores where the device has them, they count the op (AND or
+   XOR alone) and the counts are dense (the tiles have no threshold
+   output); else the shuffle kernel for rows a warp holds, the
+   register-blocked kernel for batches of queries that fill its row blocks,
+   and the coarsened kernel for a few queries */
+static NativeKernel pick_kernel(const NativeDevice *dev, unsigned int ops,
+                                bool dense, size_t num_queries,
+                                size_t words) {
+  const bool bmma = dev->bmma && dense &&
+                    (ops == 1u << BIT_NATIVE_OP_AND ||
+                     ops == 1u << BIT_NATIVE_OP_XOR);
+  const bool short_rows = words <= GPU_SHUFFLE_WORDS;
+  const NativeKernel forced = forced_kernel();
+  if (forced == NATIVE_KERNEL_BMMA      ? bmma
+      : forced == NATIVE_KERNEL_SHUFFLE ? short_rows
+                                        : forced != NATIVE_KERNEL_AUTO)
+    return forced;
+  if (bmma)
+    return NATIVE_KERNEL_BMMA;
+  if (short_rows)
+    return NATIVE_KERNEL_SHUFFLE;
+  return num_queries >= NATIVE_OUTER_MIN_QUERIES ? NATIVE_KERNEL_OUTER
+                                                 : NATIVE_KERNEL_COARSENED;
+}
+
+/* --- Operand uploads --- */
+
+static void release_operand(NativeOperand *op) {
+  if (op->data)
+    GPU_CHECK(GPU_FREE(op->data));
+  if (op->population)
+    GPU_CHECK(GPU_FREE(op->population));
+  *op = NativeOperand();
+}
+
+static size_t round_up(size_t value, size_t multiple) {
+  return (value + multiple - 1) / multiple * multiple;
+}
+
+static bool operand_cached(const NativeOperand *op, const uint64_t *host,
+                           size_t rows, size_t stride, size_t words,
+                           NativeLayout layout) {
+  return op->data && op->host == host && op->rows == rows &&
+         op->stride == stride && op->words == words && op->layout == layout;
+}
+
+/* Bring the device copy of rows x words of host (stride words apart) in
+   layout up to date: the rows are packed (and padded) into scratch on the
+   device, then transposed or tiled into place */
+static void upload_operand(NativeOperand *op, const uint64_t *host,
+                           size_t rows, size_t stride, size_t words,
+                           NativeLayout layout, bool upload) {
+  if (native_status != GPU_SUCCESS)
+    return;
+  const bool same = operand_cached(op, host, rows, stride, words, layout);
+  if (same && !upload)
+    return;
+  const bool tiled = layout == NATIVE_BMMA_TILES;
+  const size_t padded_rows = tiled ? round_up(rows, BMMA_ROWS) : rows;
+  const size_t padded_words = tiled ? round_up(words, BMMA_WORDS) : words;
+  const size_t bytes = padded_rows * padded_words * sizeof(uint64_t);
+  if (!same) {
+    release_operand(op);
+    GPU_CHECK(GPU_MALLOC((void **)&op->data, bytes));
+    if (tiled)
+      GPU_CHECK(
+          GPU_MALLOC((void **)&op->population, padded_rows * sizeof(int)));
+    if (native_status != GPU_SUCCESS) {
+      release_operand(op);
+      return;
+    }
+    op->host = host;
+    op->rows = rows;
+    op->stride = stride;
+    op->words = words;
+    op->layout = layout;
+  }
+  uint64_t *scratch = nullptr;
+  uint64_t *packed = op->data;
+  if (layout != NATIVE_ROWS) {
+    GPU_CHECK(GPU_MALLOC((void **)&scratch, bytes));
+    packed = scratch;
+  }
+  if (tiled && native_status == GPU_SUCCESS)
+    GPU_CHECK(GPU_MEMSET(packed, 0, bytes));
+  if (native_status == GPU_SUCCESS)
+    GPU_CHECK(GPU_MEMCPY_2D(packed, padded_words * sizeof(uint64_t), host,
+                            stride * sizeof(uint64_t),
+                            words * sizeof(uint64_t), rows, GPU_MEMCPY_H2D));
+  if (layout == NATIVE_WORD_MAJOR && native_status == GPU_SUCCESS) {
+    const dim3 grid((unsigned int)((words + GPU_TILE_DIM - 1) / GPU_TILE_DIM),
+                    (unsigned int)((rows + GPU_TILE_DIM - 1) / GPU_TILE_DIM),
+                    1);
+    const dim3 block(GPU_TILE_DIM, GPU_BLOCK_ROWS, 1);
+    GPU_LAUNCH_KERNEL(transpose_kernel<uint64_t>, grid, block, 0, 0, packed,
+                      op->data, (int)words, (int)rows);
+    GPU_CHECK(GPU_GET_LAST_ERROR);
+  } else if (tiled && native_status == GPU_SUCCESS) {
+    const size_t total = padded_rows * padded_words;
+    const dim3 grid((unsigned int)((total + 255) / 256 < 65536
+                                       ? (total + 255) / 256
+                                       : 65536));
+    GPU_LAUNCH_KERNEL(row_popcount_kernel, grid, dim3(256), 0, 0, packed,
+                      padded_rows, padded_words, op->population);
+    GPU_LAUNCH_KERNEL(bmma_tile_kernel, grid, dim3(256), 0, 0, packed,
+                      op->data, padded_rows, padded_words);
+    GPU_CHECK(GPU_GET_LAST_ERROR);
+  }
+  if (scratch)
+    GPU_CHECK(GPU_FREE(scratch));
+  if (native_status != GPU_SUCCESS)
+    release_operand(op);
+}
+
+static void reserve_counts(NativeDevice *dev, size_t size) {
+  if (native_status != GPU_SUCCESS || dev->counts_capacity >= size)
+    return;
+  if (dev->counts)
+    GPU_CHECK(GPU_FREE(dev->counts));
+  dev->counts = nullptr;
+  dev->counts_capacity = 0;
+  GPU_CHECK(GPU_MALLOC((void **)&dev->counts, size * sizeof(int)));
+  if (native_status == GPU_SUCCESS)
+    dev->counts_capacity = size;
+}
+
+/* --- Tile and ILP choice --- */
+
+/* The coarsened kernel at the build's GPU_TILE_J x GPU_ILP, then the pairs
+   that won the benchmark_GPU_params sweeps, and their neighbours, which
+   the self-tuning also tries */
+#define NATIVE_OP_LAUNCHES(launch, ...)                                        \
+  {                                                                            \
+    launch<uint64_t, SetOpInter, __VA_ARGS__>,                               \
+        launch<uint64_t, SetOpUnion, __VA_ARGS__>,                           \
+        launch<uint64_t, SetOpDiff, __VA_ARGS__>,                            \
+        launch<uint64_t, SetOpMinus, __VA_ARGS__>,                           \
+        launch<uint64_t, SetOpAll, __VA_ARGS__>                              \
+  }
+#define NATIVE_MATCH_LAUNCHES(launch, ...)                                     \
+  {                                                                            \
+    launch<uint64_t, SetOpInter, __VA_ARGS__, MatchesOut>,                   \
+        launch<uint64_t, SetOpUnion, __VA_ARGS__, MatchesOut>,               \
+        launch<uint64_t, SetOpDiff, __VA_ARGS__, MatchesOut>,                \
+        launch<uint64_t, SetOpMinus, __VA_ARGS__, MatchesOut>                \
+  }
+#define NATIVE_VARIANT(tile_j, ilp)                                            \
+  {                                                                            \
+    tile_j, ilp, NATIVE_OP_LAUNCHES(launch_setop_coarsened, tile_j, ilp),      \
+        NATIVE_OP_LAUNCHES(launch_setop_shuffle, ilp),                         \
+        NATIVE_MATCH_LAUNCHES(launch_setop_coarsened_out, tile_j, ilp),        \
+        NATIVE_MATCH_LAUNCHES(launch_setop_shuffle_out, ilp)                   \
+  }
+static const NativeVariant native_variants[] = {
+    NATIVE_VARIANT(GPU_TILE_J, GPU_ILP), NATIVE_VARIANT(512, 4),
+    NATIVE_VARIANT(512, 8),              NATIVE_VARIANT(512, 16),
+    NATIVE_VARIANT(1024, 4),             NATIVE_VARIANT(1024, 8),
+    NATIVE_VARIANT(1024, 16),            NATIVE_VARIANT(2048, 4),
+    NATIVE_VARIANT(2048, 8),             NATIVE_VARIANT(2048, 16),
+    NATIVE_VARIANT(4096, 4),             NATIVE_VARIANT(4096, 8),
+    NATIVE_VARIANT(4096, 16),
+};
+#define NATIVE_VARIANTS                                                        \
+  (int)(sizeof(native_variants) / sizeof(native_variants[0]))
+
+/* Fastest tile and ILP of the sweeps in benchmark_GPU_params (10000 queries
+   x 1024 targets), by arch and 64-bit words per row, ascending */
+typedef struct {
+  const char *arch;
+  size_t words;
+  int tile_j;
+  int ilp;
+} NativeTuning;
+static const NativeTuning native_tunings[] = {
+    {"gfx1010", 4, 1024, 4}, {"gfx1010", 16, 512, 4},
+    {"gfx1010", 64, 2048, 4}, {"gfx1010", 256, 2048, 4},
+    {"gfx1010", 1024, 4096, 4}, {"sm_52", 4, 2048, 4},
+    {"sm_52", 16, 1024, 4},     {"sm_52", 64, 2048, 4},
+    {"sm_52", 256, 1024, 4},    {"sm_52", 1024, 4096, 4},
+    {"sm_70", 4, 1024, 4},      {"sm_70", 16, 512, 4},
+    {"sm_70", 64, 1024, 4},     {"sm_70", 256, 512, 4},
+    {"sm_70", 1024, 512, 4},    {"sm_70", 4096, 512, 8},
+};
+
+/* "sm_<major><minor>" or the gfx name of the device, "" if unknown */
+static void device_arch(int device_id, char *arch, size_t size) {
+  arch[0] = '\0';
+#if defined(__HIP__)
+  hipDeviceProp_t prop;
+  if (hipGetDeviceProperties(&prop, device_id) == hipSuccess) {
+    snprintf(arch, size, "%s", prop.gcnArchName);
+    arch[strcspn(arch, ":")] = '\0'; // drop the target features
+  }
+#else
+  int major = 0, minor = 0;
+  if (cudaDeviceGetAttribute(&major, cudaDevAttrComputeCapabilityMajor,
+                             device_id) == cudaSuccess &&
+      cudaDeviceGetAttribute(&minor, cudaDevAttrComputeCapabilityMinor,
+                             device_id) == cudaSuccess)
+    snprintf(arch, size, "sm_%d%d", major, minor);
+#endif
+}
+
+static int word_bucket(size_t words) {
+  int bucket = 0;
+  while (bucket < NATIVE_WORD_BUCKETS - 1 && ((size_t)1 << bucket) < words)
+    bucket++;
+  return bucket;
+}
+
+/* Variant the sweeps recorded for arch at the nearest longer row, or the
+   longest one; -1 for an arch without sweeps */
+static int recorded_variant(const char *arch, size_t words) {
+  const NativeTuning *best = nullptr;
+  for (const NativeTuning &t : native_tunings)
+    if (strcmp(t.arch, arch) == 0 && (!best || best->words < words))
+      best = &t;
+  if (!best)
+    return -1;
+  for (int v = 1; v < NATIVE_VARIANTS; v++)
+    if (native_variants[v].tile_j == best->tile_j &&
+        native_variants[v].ilp == best->ilp)
+      return v;
+  return -1;
+}
+
+/* BIT_NATIVE_AUTOTUNE, read once: "0" keeps the build's tile and ILP for
+   devices without sweeps, "1" self-tunes every device */
+static int autotune_mode(void) {
+  static const int mode = [] {
+    const char *value = getenv("BIT_NATIVE_AUTOTUNE");
+    return !value ? -1 : strcmp(value, "1") == 0 ? 1 : 0;
+  }();
+  return mode;
+}
+
+/* The register-blocked kernel has a single instantiation per op */
+static const native_launch native_outer[NATIVE_OP_SLOTS] = {
+    launch_setop_outer<uint64_t, SetOpInter>,
+    launch_setop_outer<uint64_t, SetOpUnion>,
+    launch_setop_outer<uint64_t, SetOpDiff>,
+    launch_setop_outer<uint64_t, SetOpMinus>,
+    launch_setop_outer<uint64_t, SetOpAll>,
+};
+static const native_match_launch native_outer_matches[BIT_NATIVE_OPS] = {
+    launch_setop_outer_out<uint64_t, SetOpInter, MatchesOut>,
+    launch_setop_outer_out<uint64_t, SetOpUnion, MatchesOut>,
+    launch_setop_outer_out<uint64_t, SetOpDiff, MatchesOut>,
+    launch_setop_outer_out<uint64_t, SetOpMinus, MatchesOut>,
+};
+
+/* Slot of the instantiations that count ops, an or of 1u << BIT_NATIVE_OP_* */
+static int op_slot(unsigned int ops) {
+  for (int op = 0; op < BIT_NATIVE_OPS; op++)
+    if (ops == 1u << op)
+      return op;
+  return NATIVE_OP_FUSED;
+}
+
+/* Count matrices the kernel for ops writes */
+static size_t op_planes(unsigned int ops) {
+  return op_slot(ops) == NATIVE_OP_FUSED ? SetOpAll::COUNTS : 1;
+}
+
+/* Offset of the counts of op among the planes of planes_size ints */
+static size_t plane_offset(unsigned int ops, int op, size_t plane_size) {
+  return op_slot(ops) == NATIVE_OP_FUSED ? op * plane_size : 0;
+}
+
+static native_launch variant_launch(const NativeVariant *variant,
+                                    NativeKernel kernel, int slot) {
+  if (kernel == NATIVE_KERNEL_OUTER)
+    return native_outer[slot];
+  return kernel == NATIVE_KERNEL_SHUFFLE ? variant->shuffle[slot]
+                                         : variant->coarsened[slot];
+}
+
+/* Time every variant of kernel on the resident targets, standing in for
+   the queries as well (only the shape matters, so the intersection stands
+   in for every op), and return the fastest */
+static int self_tune(NativeDevice *dev, NativeKernel kernel,
+                     size_t num_queries, size_t num_targets, size_t words) {
+  const size_t rows = num_queries < 256 ? num_queries : 256;
+  const int k = (int)(rows < num_targets ? rows : num_targets);
+  reserve_counts(dev, (size_t)k * num_targets);
+  gpu_event_t start = nullptr, stop = nullptr;
+  GPU_CHECK(GPU_EVENT_CREATE(&start));
+  GPU_CHECK(GPU_EVENT_CREATE(&stop));
+  int best = 0;
+  float best_ms = 0.0f;
+  for (int v = 0; v < NATIVE_VARIANTS && native_status == GPU_SUCCESS; v++) {
+    float ms = 0.0f;
+    for (int run = 0; run < 2; run++) { // the first one warms up
+      GPU_CHECK(GPU_EVENT_RECORD(start, 0));
+      variant_launch(&native_variants[v], kernel, BIT_NATIVE_OP_AND)(
+          dev->targets.data, dev->targets.data, dev->counts, k,
+          (int)num_targets, (int)words, 0);
+      GPU_CHECK(GPU_EVENT_RECORD(stop, 0));
+      GPU_CHECK(GPU_EVENT_SYNC(stop));
+      GPU_CHECK(GPU_EVENT_ELAPSED_TIME(&ms, start, stop));
+    }
+    if (v == 0 || ms < best_ms) {
+      best = v;
+      best_ms = ms;
+    }
+  }
+  if (start)
+    GPU_EVENT_DESTROY(start);
+  if (stop)
+    GPU_EVENT_DESTROY(stop);
+  return best;
+}
+
+/* Variant of the coarsened or shuffle kernel for rows of words words on
+   the device: the sweeps' choice for its arch, else the fastest on the
+   first call with such rows, remembered per power of two of words */
+static const NativeVariant *pick_variant(NativeDevice *dev,
+                                         NativeKernel kernel,
+                                         size_t num_queries,
+                                         size_t num_targets, size_t words) {
+  unsigned char *slot =
+      &dev->tile[kernel == NATIVE_KERNEL_SHUFFLE][word_bucket(words)];
+  if (!*slot) {
+    int v = autotune_mode() == 1 ? -1 : recorded_variant(dev->arch, words);
+    if (v < 0)
+      v = autotune_mode() == 0
+              ? 0
+              : self_tune(dev, kernel, num_queries, num_targets, words);
+    if (native_status != GPU_SUCCESS)
+      return &native_variants[0];
+    *slot = (unsigned char)(v + 1);
+  }
+  return &native_variants[*slot - 1];
+}
+
+/* Launcher of kernel for the op slot, at the tile and ILP of the shape;
+   nullptr once the count failed */
+static native_launch pick_launch(NativeDevice *dev, NativeKernel kernel,
+                                 int slot, size_t num_queries,
+                                 size_t num_targets, size_t words) {
+  const NativeVariant *variant =
+      native_status == GPU_SUCCESS && kernel != NATIVE_KERNEL_OUTER
+          ? pick_variant(dev, kernel, num_queries, num_targets, words)
+          : nullptr;
+  return native_status == GPU_SUCCESS ? variant_launch(variant, kernel, slot)
+                                      : nullptr;
+}
+
+/* --- Streamed counts --- */
+
+/* Grow the buffers of a stream to words query words and size counts */
+static void reserve_stream(NativeStream *s, size_t words, size_t size) {
+  if (native_status != GPU_SUCCESS)
+    return;
+  if (!s->stream) {
+    GPU_CHECK(GPU_STREAM_CREATE(&s->stream));
+    GPU_CHECK(GPU_EVENT_CREATE(&s->done));
+  }
+  if (s->queries_capacity < words) {
+    if (s->queries)
+      GPU_CHECK(GPU_FREE(s->queries));
+    if (s->host_queries)
+      GPU_CHECK(GPU_FREE_HOST(s->host_queries));
+    s->queries = s->host_queries = nullptr;
+    s->queries_capacity = 0;
+    GPU_CHECK(GPU_MALLOC((void **)&s->queries, words * sizeof(uint64_t)));
+    GPU_CHECK(
+        GPU_MALLOC_HOST((void **)&s->host_queries, words * sizeof(uint64_t)));
+    if (native_status == GPU_SUCCESS)
+      s->queries_capacity = words;
+  }
+  if (s->counts_capacity < size) {
+    if (s->counts)
+      GPU_CHECK(GPU_FREE(s->counts));
+    if (s->host_counts)
+      GPU_CHECK(GPU_FREE_HOST(s->host_counts));
+    s->counts = s->host_counts = nullptr;
+    s->counts_capacity = 0;
+    GPU_CHECK(GPU_MALLOC((void **)&s->counts, size * sizeof(int)));
+    GPU_CHECK(GPU_MALLOC_HOST((void **)&s->host_counts, size * sizeof(int)));
+    if (native_status == GPU_SUCCESS)
+      s->counts_capacity = size;
+  }
+}
+
+/* Copy the size counts of every op of ops from the matrices the kernel for
+   ops wrote at planes to counts[op] + offset */
+static void scatter_counts(unsigned int ops, const int *planes, size_t size,
+                           size_t offset, int *const *counts) {
+  for (int op = 0; op < BIT_NATIVE_OPS; op++)
+    if (ops & 1u << op)
+      memcpy(counts[op] + offset, planes + plane_offset(ops, op, size),
+             size * sizeof(int));
+}
+
+/* Wait for the chunk in flight on a stream and move its counts in place */
+static void drain_stream(NativeStream *s, unsigned int ops, size_t num_targets,
+                         int *const *counts) {
+  if (!s->rows)
+    return;
+  GPU_CHECK(GPU_EVENT_SYNC(s->done));
+  if (native_status == GPU_SUCCESS)
+    scatter_counts(ops, s->host_counts, s->rows * num_targets,
+                   s->first * num_targets, counts);
+  s->rows = 0;
+}
+
+/* Copy rows packed queries from the staging of a stream, count them and
+   copy the planes of counts back, all on the stream */
+static void enqueue_chunk(NativeStream *s, const uint64_t *targets,
+                          native_launch launch, size_t planes, size_t rows,
+                          size_t num_targets, size_t words) {
+  GPU_CHECK(GPU_MEMCPY_ASYNC(s->queries, s->host_queries,
+                             rows * words * sizeof(uint64_t), GPU_MEMCPY_H2D,
+                             s->stream));
+  launch(s->queries, targets, s->counts, (int)rows, (int)num_targets,
+         (int)words, s->stream);
+  GPU_CHECK(GPU_MEMCPY_ASYNC(s->host_counts, s->counts,
+                             planes * rows * num_targets * sizeof(int),
+                             GPU_MEMCPY_D2H, s->stream));
+}
+
+/* Queries per chunk of the pipeline, a multiple of the register block */
+static size_t chunk_rows(size_t num_targets, size_t words, size_t planes) {
+  size_t rows = NATIVE_CHUNK_BYTES / (words * sizeof(uint64_t) +
+                                      planes * num_targets * sizeof(int));
+  if (rows > GPU_OUTER_ROWS)
+    rows -= rows % GPU_OUTER_ROWS;
+  return rows ? rows : 1;
+}
+
+/* Count the queries chunk by chunk against the resident word-major targets,
+   round robin over the streams: the rows of a chunk are packed into pinned
+   memory and copied, counted and copied back on its stream while the host
+   packs the next, so the transfers of one chunk overlap the kernels of the
+   others, and the queries never need to fit on the device at once */
+static void stream_count(NativeDevice *dev, native_launch launch,
+                         unsigned int ops, const uint64_t *queries,
+                         size_t num_queries, size_t query_stride,
+                         size_t num_targets, size_t words,
+                         int *const *counts) {
+  const size_t planes = op_planes(ops);
+  const size_t rows = chunk_rows(num_targets, words, planes);
+  for (size_t first = 0, c = 0;
+       first < num_queries && native_status == GPU_SUCCESS;
+       first += rows, c++) {
+    NativeStream *s = &dev->streams[c % NATIVE_STREAMS];
+    drain_stream(s, ops, num_targets, counts);
+    reserve_stream(s, rows * words, planes * rows * num_targets);
+    if (native_status != GPU_SUCCESS)
+      break;
+    const size_t n = num_queries - first < rows ? num_queries - first : rows;
+    for (size_t k = 0; k < n; k++)
+      memcpy(s->host_queries + k * words, queries + (first + k) * query_stride,
+             words * sizeof(uint64_t));
+    enqueue_chunk(s, dev->targets.data, launch, planes, n, num_targets, words);
+    GPU_CHECK(GPU_EVENT_RECORD(s->done, s->stream));
+    s->first = first;
+    s->rows = n;
+  }
+  for (int i = 0; i < NATIVE_STREAMS; i++)
+    drain_stream(&dev->streams[i], ops, num_targets, counts);
+}
+
+/* --- Graph mode --- */
+
+/* BIT_NATIVE_GRAPH=1, read once: batches of uploaded queries that fit one
+   chunk replay a graph captured once per shape, one launch per call
+   instead of two copies and a kernel launch with their setup */
+static bool graph_mode(void) {
+  static const bool on = [] {
+    const char *value = getenv("BIT_NATIVE_GRAPH");
+    return value && strcmp(value, "1") == 0;
+  }();
+  return on;
+}
+
+static NativeGraph *capture_graph(NativeDevice *dev, NativeStream *s,
+                                  native_launch launch, size_t planes,
+                                  size_t rows, size_t num_targets,
+                                  size_t words) {
+  for (int i = 0; i < NATIVE_GRAPHS; i++) {
+    NativeGraph *g = &dev->graphs[i];
+    if (g->exec && g->queries == s->queries &&
+        g->targets == dev->targets.data && g->counts == s->counts &&
+        g->rows == rows && g->num_targets == num_targets &&
+        g->words == words && g->launch == launch)
+      return g;
+  }
+  NativeGraph *g = &dev->graphs[dev->next_graph++ % NATIVE_GRAPHS];
+  if (g->exec)
+    GPU_CHECK(GPU_GRAPH_EXEC_DESTROY(g->exec));
+  *g = NativeGraph();
+  gpu_graph_t graph = nullptr;
+  GPU_CHECK(GPU_STREAM_BEGIN_CAPTURE(s->stream));
+  if (native_status != GPU_SUCCESS)
+    return nullptr;
+  enqueue_chunk(s, dev->targets.data, launch, planes, rows, num_targets,
+                words);
+  GPU_CHECK(GPU_STREAM_END_CAPTURE(s->stream, &graph));
+  if (native_status == GPU_SUCCESS)
+    GPU_CHECK(GPU_GRAPH_INSTANTIATE(&g->exec, graph));
+  if (graph)
+    GPU_CHECK(GPU_GRAPH_DESTROY(graph));
+  if (native_status != GPU_SUCCESS) {
+    if (g->exec)
+      GPU_GRAPH_EXEC_DESTROY(g->exec);
+    g->exec = nullptr;
+    return nullptr;
+  }
+  g->queries = s->queries;
+  g->targets = dev->targets.data;
+  g->counts = s->counts;
+  g->rows = rows;
+  g->num_targets = num_targets;
+  g->words = words;
+  g->launch = launch;
+  return g;
+}
+
+/* Count a batch against the resident word-major targets by replaying its
+   graph on the first stream, through that stream's staging buffers */
+static void graph_count(NativeDevice *dev, native_launch launch,
+                        unsigned int ops, const uint64_t *queries,
+                        size_t num_queries, size_t query_stride,
+                        size_t num_targets, size_t words,
+                        int *const *counts) {
+  const size_t planes = op_planes(ops);
+  NativeStream *s = &dev->streams[0];
+  reserve_stream(s, num_queries * words, planes * num_queries * num_targets);
+  if (native_status != GPU_SUCCESS)
+    return;
+  const NativeGraph *g = capture_graph(dev, s, launch, planes, num_queries,
+                                       num_targets, words);
+  if (!g)
+    return;
+  for (size_t k = 0; k < num_queries; k++)
+    memcpy(s->host_queries + k * words, queries + k * query_stride,
+           words * sizeof(uint64_t));
+  GPU_CHECK(GPU_GRAPH_LAUNCH(g->exec, s->stream));
+  GPU_CHECK(GPU_STREAM_SYNC(s->stream));
+  if (native_status == GPU_SUCCESS)
+    scatter_counts(ops, s->host_counts, num_queries * num_targets, 0, counts);
+}
+
+/* --- Threshold counts --- */
+
+/* Room for matches per query of the first launch, the guess of the OpenMP
+   threshold search */
+#ifndef NATIVE_MATCHES_PER_QUERY
+#define NATIVE_MATCHES_PER_QUERY 64
+#endif
+
+/* Grow the match buffer of the device to size matches */
+static void reserve_matches(NativeDevice *dev, size_t size) {
+  if (native_status == GPU_SUCCESS && !dev->match_state)
+    GPU_CHECK(GPU_MALLOC((void **)&dev->match_state, sizeof(NativeMatchState)));
+  if (native_status != GPU_SUCCESS || dev->matches_capacity >= size)
+    return;
+  if (dev->matches)
+    GPU_CHECK(GPU_FREE(dev->matches));
+  dev->matches = nullptr;
+  dev->matches_capacity = 0;
+  GPU_CHECK(GPU_MALLOC((void **)&dev->matches, size * sizeof(GpuMatch)));
+  if (native_status == GPU_SUCCESS)
+    dev->matches_capacity = size;
+}
+
+/* Launcher of kernel with the threshold output for op */
+static native_match_launch variant_match_launch(const NativeVariant *variant,
+                                                NativeKernel kernel,
+                                                unsigned int op) {
+  if (kernel == NATIVE_KERNEL_OUTER)
+    return native_outer_matches[op];
+  return kernel == NATIVE_KERNEL_SHUFFLE ? variant->shuffle_matches[op]
+                                         : variant->coarsened_matches[op];
+}
+
+/* Matches of the resident queries against the resident targets into a
+   malloc'ed *matches of *num_matches. A launch that overflows the buffer
+   keeps the queries below its resume point, which are complete, and the
+   next launch starts there with room for exactly the matches left, so a
+   search takes two launches at most */
+static void collect_matches(NativeDevice *dev, native_match_launch launch,
+                            int threshold, size_t num_queries,
+                            size_t num_targets, size_t words,
+                            bit_native_match **matches, size_t *num_matches) {
+  size_t first = 0, found = 0;
+  size_t room = num_queries * NATIVE_MATCHES_PER_QUERY;
+  bit_native_match *list = nullptr;
+  while (native_status == GPU_SUCCESS) {
+    reserve_matches(dev, room);
+    NativeMatchState state = {0, INT_MAX};
+    GPU_CHECK(GPU_MEMCPY(dev->match_state, &state, sizeof(state),
+                         GPU_MEMCPY_H2D));
+    if (native_status != GPU_SUCCESS)
+      break;
+    const MatchesOut out = {dev->matches,        dev->matches_capacity,
+                            &dev->match_state->total,
+                            &dev->match_state->resume, threshold,
+                            (int)first};
+    launch(dev->queries.data + first * words, dev->targets.data, out,
+           (int)(num_queries - first), (int)num_targets, (int)words, 0);
+    GPU_CHECK(GPU_MEMCPY(&state, dev->match_state, sizeof(state),
+                         GPU_MEMCPY_D2H));
+    const size_t stored = state.total < dev->matches_capacity
+                              ? (size_t)state.total
+                              : dev->matches_capacity;
+    if (native_status != GPU_SUCCESS || !stored)
+      break;
+    bit_native_match *grown = (bit_native_match *)realloc(
+        list, (found + stored) * sizeof(bit_native_match));
+    if (!grown) {
+      native_status = GPU_ERROR_MEMORY;
+      break;
+    }
+    list = grown;
+    GPU_CHECK(GPU_MEMCPY(list + found, dev->matches,
+                         stored * sizeof(bit_native_match), GPU_MEMCPY_D2H));
+    if (state.total <= dev->matches_capacity) {
+      found += stored;
+      break;
+    }
+    size_t kept = 0;
+    for (size_t m = found; m < found + stored; m++)
+      if (list[m].query < state.resume)
+        list[found + kept++] = list[m];
+    found += kept;
+    room = (size_t)state.total - kept;
+    first = (size_t)state.resume;
+  }
+  if (native_status != GPU_SUCCESS) {
+    free(list);
+    list = nullptr;
+    found = 0;
+  }
+  *matches = list;
+  *num_matches = found;
+}
+
+/* --- Backend entry points --- */
+
+static int native_device_count(void) {
+  int count = 0;
+  return GPU_GET_DEVICE_COUNT(&count) == GPU_SUCCESS ? count : 0;
+}
+
+/* Make device_id current and learn what it runs on first use; nullptr,
+   with native_status set, on failure. The caller holds native_lock */
+static NativeDevice *open_device(int device_id) {
+  NativeDevice *dev = &native_devices[device_id];
+  native_status = GPU_SUCCESS;
+  GPU_CHECK(GPU_SET_DEVICE(device_id));
+  if (native_status != GPU_SUCCESS)
+    return nullptr;
+  if (!dev->probed) {
+    dev->bmma = bmma_usable(device_id);
+    device_arch(device_id, dev->arch, sizeof(dev->arch));
+    dev->probed = true;
+  }
+  return dev;
+}
+
+/* Free the operands the flags release, or both after a failure, and return
+   the status of the call */
+static int close_device(NativeDevice *dev, unsigned int flags) {
+  const bool failed = native_status != GPU_SUCCESS;
+  if (failed || (flags & BIT_NATIVE_RELEASE_QUERIES))
+    release_operand(&dev->queries);
+  if (failed || (flags & BIT_NATIVE_RELEASE_TARGETS))
+    release_operand(&dev->targets);
+  return failed ? (int)native_status : 0;
+}
+
+static int native_count_ops(unsigned int ops, const uint64_t *queries,
+                            size_t num_queries, size_t query_stride,
+                            const uint64_t *targets, size_t num_targets,
+                            size_t target_stride, size_t words,
+                            int *const *counts, int device_id,
+                            unsigned int flags) {
+  /* the coarsened and outer kernels index operands and counts with int */
+  if (device_id < 0 || device_id >= NATIVE_MAX_DEVICES || !num_queries ||
+      !num_targets || !words || num_queries > INT_MAX / num_targets ||
+      words > INT_MAX / num_targets || words > INT_MAX / num_queries ||
+      !ops || ops >> BIT_NATIVE_OPS)
+    return -1;
+  for (int op = 0; op < BIT_NATIVE_OPS; op++)
+    if (ops & 1u << op && !counts[op])
+      return -1;
+
+  std::lock_guard<std::mutex> guard(native_lock);
+  NativeDevice *dev = open_device(device_id);
+  if (!dev)
+    return (int)native_status;
+  const NativeKernel kernel = pick_kernel(dev, ops, true, num_queries, words);
+  const int slot = op_slot(ops);
+  const size_t planes = op_planes(ops);
+
+  if (kernel == NATIVE_KERNEL_BMMA) {
+    upload_operand(&dev->queries, queries, num_queries, query_stride, words,
+                   NATIVE_BMMA_TILES, flags & BIT_NATIVE_UPLOAD_QUERIES);
+    upload_operand(&dev->targets, targets, num_targets, target_stride, words,
+                   NATIVE_BMMA_TILES, flags & BIT_NATIVE_UPLOAD_TARGETS);
+    const size_t query_tiles = (num_queries + BMMA_ROWS - 1) / BMMA_ROWS;
+    const size_t target_tiles = (num_targets + BMMA_ROWS - 1) / BMMA_ROWS;
+    const size_t ldc = target_tiles * BMMA_ROWS;
+    reserve_counts(dev, query_tiles * BMMA_ROWS * ldc);
+    if (native_status == GPU_SUCCESS) {
+      const size_t blocks =
+          (query_tiles * target_tiles + BMMA_WARPS - 1) / BMMA_WARPS;
+      const dim3 grid((unsigned int)(blocks < 65536 ? blocks : 65536));
+      const size_t slices = (words + BMMA_WORDS - 1) / BMMA_WORDS;
+      if (slot == BIT_NATIVE_OP_AND)
+        GPU_LAUNCH_KERNEL(bmma_count_kernel<BIT_NATIVE_OP_AND>, grid,
+                          dim3(32 * BMMA_WARPS), 0, 0, dev->queries.data,
+                          dev->targets.data, dev->queries.population,
+                          dev->targets.population, dev->counts, query_tiles,
+                          target_tiles, slices);
+      else
+        GPU_LAUNCH_KERNEL(bmma_count_kernel<BIT_NATIVE_OP_XOR>, grid,
+                          dim3(32 * BMMA_WARPS), 0, 0, dev->queries.data,
+                          dev->targets.data, dev->queries.population,
+                          dev->targets.population, dev->counts, query_tiles,
+                          target_tiles, slices);
+      GPU_CHECK(GPU_GET_LAST_ERROR);
+      GPU_CHECK(GPU_MEMCPY_2D(counts[slot], num_targets * sizeof(int),
+                              dev->counts, ldc * sizeof(int),
+                              num_targets * sizeof(int), num_queries,
+                              GPU_MEMCPY_D2H));
+    }
+  } else if ((flags & BIT_NATIVE_UPLOAD_QUERIES ||
+              !operand_cached(&dev->queries, queries, num_queries,
+                              query_stride, words, NATIVE_ROWS)) &&
+             (graph_mode() ||
+              num_queries > chunk_rows(num_targets, words, planes))) {
+    /* queries that must cross the bus anyway are streamed in chunks, or
+       replayed through a graph */
+    release_operand(&dev->queries);
+    upload_operand(&dev->targets, targets, num_targets, target_stride, words,
+                   NATIVE_WORD_MAJOR, flags & BIT_NATIVE_UPLOAD_TARGETS);
+    const native_launch launch =
+        pick_launch(dev, kernel, slot, num_queries, num_targets, words);
+    if (native_status == GPU_SUCCESS &&
+        num_queries > chunk_rows(num_targets, words, planes))
+      stream_count(dev, launch, ops, queries, num_queries, query_stride,
+                   num_targets, words, counts);
+    else if (native_status == GPU_SUCCESS)
+      graph_count(dev, launch, ops, queries, num_queries, query_stride,
+                  num_targets, words, counts);
+  } else {
+    upload_operand(&dev->queries, queries, num_queries, query_stride, words,
+                   NATIVE_ROWS, flags & BIT_NATIVE_UPLOAD_QUERIES);
+    upload_operand(&dev->targets, targets, num_targets, target_stride, words,
+                   NATIVE_WORD_MAJOR, flags & BIT_NATIVE_UPLOAD_TARGETS);
+    const native_launch launch =
+        pick_launch(dev, kernel, slot, num_queries, num_targets, words);
+    const size_t counts_size = num_queries * num_targets;
+    reserve_counts(dev, planes * counts_size);
+    if (native_status == GPU_SUCCESS) {
+      launch(dev->queries.data, dev->targets.data, dev->counts,
+             (int)num_queries, (int)num_targets, (int)words, 0);
+      for (int op = 0; op < BIT_NATIVE_OPS; op++)
+        if (ops & 1u << op)
+          GPU_CHECK(GPU_MEMCPY(counts[op],
+                               dev->counts +
+                                   plane_offset(ops, op, counts_size),
+                               counts_size * sizeof(int), GPU_MEMCPY_D2H));
+    }
+  }
+  return close_device(dev, flags);
+}
+
+static int native_count(unsigned int op, const uint64_t *queries,
+                        size_t num_queries, size_t query_stride,
+                        const uint64_t *targets, size_t num_targets,
+                        size_t target_stride, size_t words, int *counts,
+                        int device_id, unsigned int flags) {
+  int *out[BIT_NATIVE_OPS] = {nullptr};
+  if (op >= BIT_NATIVE_OPS)
+    return -1;
+  out[op] = counts;
+  return native_count_ops(1u << op, queries, num_queries, query_stride,
+                          targets, num_targets, target_stride, words, out,
+                          device_id, flags);
+}
+
+static int native_count_threshold(unsigned int op, const uint64_t *queries,
+                                  size_t num_queries, size_t query_stride,
+                                  const uint64_t *targets, size_t num_targets,
+                                  size_t target_stride, size_t words,
+                                  int threshold, bit_native_match **matches,
+                                  size_t *num_matches, int device_id,
+                                  unsigned int flags) {
+  if (device_id < 0 || device_id >= NATIVE_MAX_DEVICES || !num_queries ||
+      !num_targets || !words || num_queries > INT_MAX / num_targets ||
+      words > INT_MAX / num_targets || words > INT_MAX / num_queries ||
+      op >= BIT_NATIVE_OPS || !matches || !num_matches)
+    return -1;
+  *matches = nullptr;
+  *num_matches = 0;
+
+  std::lock_guard<std::mutex> guard(native_lock);
+  NativeDevice *dev = open_device(device_id);
+  if (!dev)
+    return (int)native_status;
+  /* the queries stay whole on the device: a resumed launch starts at any
+     of them */
+  const NativeKernel kernel =
+      pick_kernel(dev, 1u << op, false, num_queries, words);
+  upload_operand(&dev->queries, queries, num_queries, query_stride, words,
+                 NATIVE_ROWS, flags & BIT_NATIVE_UPLOAD_QUERIES);
+  upload_operand(&dev->targets, targets, num_targets, target_stride, words,
+                 NATIVE_WORD_MAJOR, flags & BIT_NATIVE_UPLOAD_TARGETS);
+  const NativeVariant *variant =
+      native_status == GPU_SUCCESS && kernel != NATIVE_KERNEL_OUTER
+          ? pick_variant(dev, kernel, num_queries, num_targets, words)
+          : nullptr;
+  if (native_status == GPU_SUCCESS)
+    collect_matches(dev, variant_match_launch(variant, kernel, op), threshold,
+                    num_queries, num_targets, words, matches, num_matches);
+  return close_device(dev, flags);
+}
+
+static const bit_native_backend native_backend = {
+    BIT_NATIVE_ABI,
+    BACKEND_NAME,
+    native_device_count,
+    native_count,
+    native_count_ops,
+    native_count_threshold,
+};
+
+extern "C" const bit_native_backend *bit_native_backend_get(void) {
+  return &native_backend;
+}
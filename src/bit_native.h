@@ -0,0 +1,79 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+/* Interface between libbit and the optional native GPU backends,
+   libbit_cuda.so and libbit_hip.so (src/bit_native.cpp built by nvcc or
+   hipcc). libbit loads a backend at run time for the NATIVE_COARSENED
+   algorithm, so neither is a link dependency, and a build without CUDA or
+   ROCm runs the OpenMP kernels instead */
+
+/* Bumped on every incompatible change of bit_native_backend; libbit ignores
+   a backend built against another version */
+#define BIT_NATIVE_ABI 4
+
+/* Exported symbol of type bit_native_entry */
+#define BIT_NATIVE_ENTRY "bit_native_backend_get"
+
+/* Word operations a backend counts */
+#define BIT_NATIVE_OP_AND 0u     // a & b
+#define BIT_NATIVE_OP_OR 1u      // a | b
+#define BIT_NATIVE_OP_XOR 2u     // a ^ b
+#define BIT_NATIVE_OP_AND_NOT 3u // a & ~b
+#define BIT_NATIVE_OPS 4
+
+/* Return value of count for an operation the kernel that drives the device
+   does not implement; counts is left untouched */
+#define BIT_NATIVE_UNSUPPORTED (-2)
+
+/* Operands the backend must copy to the device again; without the flag it
+   may reuse the copy of the previous call with the same host buffer */
+#define BIT_NATIVE_UPLOAD_QUERIES 0x1u
+#define BIT_NATIVE_UPLOAD_TARGETS 0x2u
+/* Operands whose device copy is freed after the call */
+#define BIT_NATIVE_RELEASE_QUERIES 0x4u
+#define BIT_NATIVE_RELEASE_TARGETS 0x8u
+
+/* A pair of a threshold count */
+typedef struct {
+    int query;
+    int target;
+    int count;
+} bit_native_match;
+
+typedef struct {
+    int abi;          // BIT_NATIVE_ABI the backend was built against
+    const char *name; // "cuda" or "hip"
+    int (*device_count)(void);
+    /* counts[k * num_targets + i] = popcount(queries row k op targets row
+       i) over the first words words of the rows, which lie query_stride
+       and target_stride words apart, for op one of BIT_NATIVE_OP_*.
+       Returns 0 on success, BIT_NATIVE_UNSUPPORTED, or any other value on
+       failure, which leaves counts undefined */
+    int (*count)(unsigned int op, const uint64_t *queries, size_t num_queries,
+                 size_t query_stride, const uint64_t *targets,
+                 size_t num_targets, size_t target_stride, size_t words,
+                 int *counts, int device_id, unsigned int flags);
+    /* Fused counts of several operations from one pass over the rows: ops
+       is an or of 1u << BIT_NATIVE_OP_*, and counts[op] of every op in ops
+       receives the counts of op in the layout of count (the other entries
+       are ignored). Returns as count */
+    int (*count_ops)(unsigned int ops, const uint64_t *queries,
+                     size_t num_queries, size_t query_stride,
+                     const uint64_t *targets, size_t num_targets,
+                     size_t target_stride, size_t words, int *const *counts,
+                     int device_id, unsigned int flags);
+    /* The pairs (k, i) whose count of op, as for count, is at least
+       threshold, in no particular order: *matches receives an array of
+       *num_matches of them allocated with malloc, which the caller frees
+       (NULL for none). Returns as count */
+    int (*count_threshold)(unsigned int op, const uint64_t *queries,
+                           size_t num_queries, size_t query_stride,
+                           const uint64_t *targets, size_t num_targets,
+                           size_t target_stride, size_t words, int threshold,
+                           bit_native_match **matches, size_t *num_matches,
+                           int device_id, unsigned int flags);
+} bit_native_backend;
+
+typedef const bit_native_backend *(*bit_native_entry)(void);
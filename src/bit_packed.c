@@ -0,0 +1,242 @@
+/*
+    Packed containers of short rows (Bit_PDB_T, see include/bit.h).
+
+    A Bit_DB_T pads every row to a whole, aligned stride, so a row of 16 bits
+    takes 64 bytes of memory and of bandwidth. A Bit_PDB_T keeps rows of up
+    to 32 bits in lanes of 8, 16 or 32 bits, the narrowest that holds the
+    length, so that a 64-bit word carries 8, 4 or 2 rows. A count takes a
+    query row, repeats it in every lane of a word, and runs the packed_count
+    kernel over a block of target words: each word gives the counts of all
+    its rows at once, with the popcount split lane by lane.
+
+    * License : BSD-2
+*/
+
+/* ==========================================================================
+   SECTION 1: INCLUDES
+   Standard library headers first, then project headers.
+   ========================================================================== */
+
+#include "bit.h"
+#include "omp.h"
+#include <assert.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "bit_internal.h"
+
+/* --- End Section 1: INCLUDES --- */
+
+/* ==========================================================================
+   SECTION 2: COMPILE-TIME CONFIGURATION
+   ========================================================================== */
+
+/* Words of targets counted against a block of queries at a time: 16 KiB,
+   which stays in L1 while the queries go past */
+#ifndef BIT_PDB_BLOCK_WORDS
+#define BIT_PDB_BLOCK_WORDS 2048
+#endif
+
+/* Queries of such a block */
+#ifndef BIT_PDB_BLOCK_QUERIES
+#define BIT_PDB_BLOCK_QUERIES 64
+#endif
+
+/* --- End Section 2: COMPILE-TIME CONFIGURATION --- */
+
+/* ==========================================================================
+   SECTION 5: INTERNAL DATA STRUCTURES AND ENUMS
+   Types used only inside this translation unit.
+   ========================================================================== */
+
+struct T_PDB {
+  unsigned int nelem;  // rows
+  unsigned int length; // bits of every row
+  int lane_bits;       // bits of the lane of a row: 8, 16 or 32
+  int lanes;           // rows per word, 64 / lane_bits
+  size_t nwords;       // words of rows, the last one zero past nelem
+  uint64_t *words;
+};
+
+/* --- End Section 5: INTERNAL DATA STRUCTURES AND ENUMS --- */
+
+/* ==========================================================================
+   SECTION 8: INTERNAL HELPER FUNCTION DEFINITIONS
+   ========================================================================== */
+
+static bool is_count_op(Bit_count_ops op) {
+  return op == BIT_COUNT_INTER || op == BIT_COUNT_UNION ||
+         op == BIT_COUNT_DIFF || op == BIT_COUNT_MINUS;
+}
+
+static bit_setop_id count_op_id(Bit_count_ops op) {
+  switch (op) {
+  case BIT_COUNT_INTER:
+    return BIT_OP_AND;
+  case BIT_COUNT_UNION:
+    return BIT_OP_OR;
+  case BIT_COUNT_DIFF:
+    return BIT_OP_XOR;
+  default: // BIT_COUNT_MINUS
+    return BIT_OP_AND_NOT;
+  }
+}
+
+static inline uint64_t lane_mask(const struct T_PDB *set) {
+  return set->lane_bits == 32 ? UINT64_C(0xFFFFFFFF)
+                              : (UINT64_C(1) << set->lane_bits) - 1;
+}
+
+static inline uint32_t row_word(const struct T_PDB *set, unsigned int index) {
+  const int shift = set->lane_bits * (int)(index % (unsigned int)set->lanes);
+  return (uint32_t)((set->words[index / set->lanes] >> shift) &
+                    lane_mask(set));
+}
+
+/* Row index repeated in every lane of a word */
+static inline uint64_t row_broadcast(const struct T_PDB *set,
+                                     unsigned int index) {
+  static const uint64_t ones[] = {UINT64_C(0x0101010101010101),
+                                  UINT64_C(0x0001000100010001),
+                                  UINT64_C(0x0000000100000001)};
+  const int at = set->lane_bits == 8 ? 0 : set->lane_bits == 16 ? 1 : 2;
+  return (uint64_t)row_word(set, index) * ones[at];
+}
+
+/* --- End Section 8: INTERNAL HELPER FUNCTION DEFINITIONS --- */
+
+/* ==========================================================================
+   SECTION 9: PUBLIC API
+   ========================================================================== */
+
+T_PDB BitPDB_new(int length, int nelem) {
+  assert(length > 0 && length <= BIT_PDB_MAX_LENGTH);
+  assert(nelem >= 0);
+  T_PDB set = calloc(1, sizeof(*set));
+  assert(set != NULL);
+  set->nelem = (unsigned int)nelem;
+  set->length = (unsigned int)length;
+  set->lane_bits = length <= 8 ? 8 : length <= 16 ? 16 : 32;
+  set->lanes = 64 / set->lane_bits;
+  set->nwords = ((size_t)nelem + set->lanes - 1) / set->lanes;
+  set->words = calloc(set->nwords ? set->nwords : 1, sizeof(uint64_t));
+  assert(set->words != NULL);
+  return set;
+}
+
+T_PDB BitPDB_from_db(T_DB db) {
+  assert(db);
+  T_PDB set = BitPDB_new((int)db->length, (int)db->nelem);
+#pragma omp parallel for schedule(static)
+  for (size_t w = 0; w < set->nwords; w++) {
+    uint64_t word = 0;
+    for (int l = 0; l < set->lanes; l++) {
+      const size_t index = w * set->lanes + l;
+      if (index < set->nelem)
+        word |= (db->qwords[index * db->stride_in_qwords] & lane_mask(set))
+                << (set->lane_bits * l);
+    }
+    set->words[w] = word;
+  }
+  return set;
+}
+
+void BitPDB_free(T_PDB *set) {
+  assert(set && *set);
+  free((*set)->words);
+  free(*set);
+  *set = NULL;
+}
+
+int BitPDB_nelem(T_PDB set) {
+  assert(set);
+  return (int)set->nelem;
+}
+
+int BitPDB_length(T_PDB set) {
+  assert(set);
+  return (int)set->length;
+}
+
+int BitPDB_lane_bits(T_PDB set) {
+  assert(set);
+  return set->lane_bits;
+}
+
+size_t BitPDB_size_in_bytes(T_PDB set) {
+  assert(set);
+  return sizeof(*set) + set->nwords * sizeof(uint64_t);
+}
+
+uint32_t BitPDB_get_word(T_PDB set, int index) {
+  assert(set);
+  assert(index >= 0 && (unsigned int)index < set->nelem);
+  return row_word(set, (unsigned int)index);
+}
+
+void BitPDB_put_word(T_PDB set, int index, uint32_t bits) {
+  assert(set);
+  assert(index >= 0 && (unsigned int)index < set->nelem);
+  assert(set->length == 32 || bits >> set->length == 0);
+  const int shift = set->lane_bits * (index % set->lanes);
+  uint64_t *word = &set->words[index / set->lanes];
+  *word = (*word & ~(lane_mask(set) << shift)) | ((uint64_t)bits << shift);
+}
+
+T BitPDB_get_from(T_PDB set, int index) {
+  T bit = Bit_new(BitPDB_length(set));
+  bit->qwords[0] = BitPDB_get_word(set, index);
+  return bit;
+}
+
+void BitPDB_put_at(T_PDB set, int index, T bitset) {
+  assert(set && bitset);
+  assert(bitset->length == set->length);
+  BitPDB_put_word(set, index, (uint32_t)bitset->qwords[0]);
+}
+
+void BitPDB_count_store(T_PDB bit, T_PDB bits, Bit_count_ops op, int *counts,
+                        SETOP_COUNT_OPTS opts) {
+  assert(bit && bits);
+  assert(counts != NULL);
+  assert(bit->length == bits->length);
+  assert(is_count_op(op));
+  const bit_setop_id id = count_op_id(op);
+  void (*packed_count)(bit_setop_id, int, uint64_t, const uint64_t *, size_t,
+                       int *) = bit_kernels_active()->packed_count;
+  const size_t n = bits->nelem;
+  const size_t full = n / bits->lanes; // words with every lane a row
+  const int tail = (int)(n % bits->lanes);
+  const int nq = (int)bit->nelem;
+  const int nblocks = (int)((bits->nwords + BIT_PDB_BLOCK_WORDS - 1) /
+                            BIT_PDB_BLOCK_WORDS);
+  // each block of targets stays in L1 while a block of queries goes past
+#pragma omp parallel for collapse(2) num_threads(cpu_threads(opts))           \
+    schedule(dynamic)
+  for (int q_b = 0; q_b < nq; q_b += BIT_PDB_BLOCK_QUERIES) {
+    for (int b = 0; b < nblocks; b++) {
+      const size_t w_b = (size_t)b * BIT_PDB_BLOCK_WORDS;
+      const size_t w_max =
+          w_b + BIT_PDB_BLOCK_WORDS < full ? w_b + BIT_PDB_BLOCK_WORDS : full;
+      const bool last = tail && w_b + BIT_PDB_BLOCK_WORDS >= bits->nwords;
+      const int q_max =
+          q_b + BIT_PDB_BLOCK_QUERIES < nq ? q_b + BIT_PDB_BLOCK_QUERIES : nq;
+      for (int i = q_b; i < q_max; i++) {
+        const uint64_t q = row_broadcast(bit, (unsigned int)i);
+        int *out = counts + (size_t)i * n;
+        if (w_max > w_b)
+          packed_count(id, bits->lane_bits, q, bits->words + w_b, w_max - w_b,
+                       out + w_b * bits->lanes);
+        if (last) { // the lanes past the last row are not counts
+          int lanes[8];
+          packed_count(id, bits->lane_bits, q, bits->words + full, 1, lanes);
+          memcpy(out + full * bits->lanes, lanes, (size_t)tail * sizeof(int));
+        }
+      }
+    }
+  }
+}
+
+/* --- End Section 9: PUBLIC API --- */
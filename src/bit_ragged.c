@@ -0,0 +1,328 @@
+/*
+    Packed containers of rows of different lengths (Bit_RDB_T, see
+    include/bit.h).
+
+    A Bit_RDB_T lays its rows end to end in one allocation, each padded to a
+    whole number of ALIGNMENT blocks so that every row starts on an aligned
+    boundary, with an array of offsets to find them. A count of two rows
+    runs the count kernels of bit_kernels_active() over the words the rows
+    have in common, through stack Bit_T headers; the words past the end of
+    the shorter row are zero, so they add nothing to an intersection, and
+    the other ops follow from the intersection and the popcounts of the
+    rows. The work of a pair goes with its shorter row, so the queries are
+    counted longest first, in blocks of similar lengths that the threads
+    take one at a time.
+
+    * License : BSD-2
+*/
+
+/* ==========================================================================
+   SECTION 1: INCLUDES
+   Standard library headers first, then project headers.
+   ========================================================================== */
+
+#include "bit.h"
+#include "omp.h"
+#include <assert.h>
+#include <limits.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "bit_internal.h"
+
+/* --- End Section 1: INCLUDES --- */
+
+/* ==========================================================================
+   SECTION 2: COMPILE-TIME CONFIGURATION
+   File-local compile-time constants, build-time defaults, and feature flags.
+   ========================================================================== */
+
+/* Queries (of similar lengths, taken longest first) and targets of a unit
+   of work of BitRDB_count_store */
+#ifndef BIT_RDB_QUERY_BLOCK
+#define BIT_RDB_QUERY_BLOCK 8
+#endif
+
+#ifndef BIT_RDB_TARGET_BLOCK
+#define BIT_RDB_TARGET_BLOCK 256
+#endif
+
+/* --- End Section 2: COMPILE-TIME CONFIGURATION --- */
+
+/* ==========================================================================
+   SECTION 3: INFRASTRUCTURAL MACROS
+   Private macros used by helper functions and low-level operations.
+   ========================================================================== */
+
+/* Qwords of a row of length bits, padded to whole ALIGNMENT blocks */
+#define RDB_ROW_QWORDS(length)                                                 \
+  ((((size_t)(length) + BPQW - 1) / BPQW + ALIGNMENT / sizeof(uint64_t) -      \
+    1) / (ALIGNMENT / sizeof(uint64_t)) * (ALIGNMENT / sizeof(uint64_t)))
+
+/* --- End Section 3: INFRASTRUCTURAL MACROS --- */
+
+/* ==========================================================================
+   SECTION 5: INTERNAL DATA STRUCTURES AND ENUMS
+   Types used only inside this translation unit.
+   ========================================================================== */
+
+struct T_RDB {
+  unsigned int nelem; // rows
+  int *lengths;       // bits of every row
+  size_t *offsets;    // qwords of row i: [offsets[i], offsets[i + 1]),
+                      // padding included and kept zero
+  uint64_t *qwords;   // ALIGNMENT-aligned rows
+  int *row_counts;    // set bits of every row
+};
+
+/* A row and its qwords, for the longest-first order of the queries */
+typedef struct {
+  size_t qwords;
+  int row;
+} rdb_row_size;
+
+/* --- End Section 5: INTERNAL DATA STRUCTURES AND ENUMS --- */
+
+/* ==========================================================================
+   SECTION 8: INTERNAL HELPER FUNCTION DEFINITIONS
+   ========================================================================== */
+
+static bool is_count_op(Bit_count_ops op) {
+  return op == BIT_COUNT_INTER || op == BIT_COUNT_UNION ||
+         op == BIT_COUNT_DIFF || op == BIT_COUNT_MINUS;
+}
+
+/* The op count of rows of counts a and b with inter bits in common */
+static inline int count_from_inter(Bit_count_ops op, int a, int b,
+                                   int inter) {
+  switch (op) {
+  case BIT_COUNT_INTER:
+    return inter;
+  case BIT_COUNT_UNION:
+    return a + b - inter;
+  case BIT_COUNT_DIFF:
+    return a + b - 2 * inter;
+  default: // BIT_COUNT_MINUS
+    return a - inter;
+  }
+}
+
+static inline size_t rdb_row_qwords(T_RDB set, unsigned int index) {
+  return set->offsets[index + 1] - set->offsets[index];
+}
+
+/* Stack Bit_T header over the first nq qwords at qwords */
+static struct T qwords_view(uint64_t *qwords, size_t nq) {
+  return (struct T){.length = (unsigned int)(nq * BPQW),
+                    .size_in_bytes = (unsigned int)(nq * sizeof(uint64_t)),
+                    .size_in_qwords = (unsigned int)nq,
+                    .bytes = (unsigned char *)qwords,
+                    .qwords = qwords};
+}
+
+/* Bits two rows have in common over their shared words */
+static inline int rdb_inter(int (*inter_count)(T, T), uint64_t *a, size_t na,
+                            uint64_t *b, size_t nb) {
+  const size_t nq = na < nb ? na : nb;
+  if (nq == 0)
+    return 0;
+  struct T s = qwords_view(a, nq), t = qwords_view(b, nq);
+  return inter_count(&s, &t);
+}
+
+/* An empty container of rows of the given lengths */
+static T_RDB rdb_alloc(const int lengths[], int n) {
+  assert(n >= 0);
+  assert(n == 0 || lengths != NULL);
+  T_RDB set = calloc(1, sizeof(*set));
+  assert(set != NULL);
+  set->nelem = (unsigned int)n;
+  set->lengths = malloc(((size_t)n + 1) * sizeof(int));
+  set->offsets = malloc(((size_t)n + 1) * sizeof(size_t));
+  set->row_counts = calloc((size_t)n + 1, sizeof(int));
+  assert(set->lengths && set->offsets && set->row_counts);
+  size_t nq = 0;
+  for (int i = 0; i < n; i++) {
+    assert(lengths[i] > 0);
+    set->lengths[i] = lengths[i];
+    set->offsets[i] = nq;
+    nq += RDB_ROW_QWORDS(lengths[i]);
+  }
+  set->offsets[n] = nq;
+  // aligned_alloc wants a multiple of the alignment, which the rows are
+  set->qwords = aligned_alloc(ALIGNMENT, nq ? nq * sizeof(uint64_t)
+                                            : ALIGNMENT);
+  assert(set->qwords != NULL);
+  // the pages go to the threads that fill the rows
+#pragma omp parallel for schedule(static)
+  for (int i = 0; i < n; i++)
+    memset(set->qwords + set->offsets[i], 0,
+           rdb_row_qwords(set, (unsigned int)i) * sizeof(uint64_t));
+  return set;
+}
+
+static int rdb_longer_first(const void *x, const void *y) {
+  const rdb_row_size *a = x, *b = y;
+  if (a->qwords != b->qwords)
+    return a->qwords < b->qwords ? 1 : -1;
+  return (a->row > b->row) - (a->row < b->row);
+}
+
+/* The rows of set, longest first */
+static int *rdb_longest_first(T_RDB set) {
+  const size_t n = set->nelem;
+  rdb_row_size *sizes = malloc((n ? n : 1) * sizeof(*sizes));
+  int *order = malloc((n ? n : 1) * sizeof(int));
+  assert(sizes && order);
+  for (size_t i = 0; i < n; i++)
+    sizes[i] = (rdb_row_size){rdb_row_qwords(set, (unsigned int)i), (int)i};
+  qsort(sizes, n, sizeof(*sizes), rdb_longer_first);
+  for (size_t i = 0; i < n; i++)
+    order[i] = sizes[i].row;
+  free(sizes);
+  return order;
+}
+
+/* --- End Section 8: INTERNAL HELPER FUNCTION DEFINITIONS --- */
+
+/* ==========================================================================
+   SECTION 9: PUBLIC API
+   ========================================================================== */
+
+T_RDB BitRDB_new(const int lengths[], int n) { return rdb_alloc(lengths, n); }
+
+T_RDB BitRDB_from_bitsets(T rows[], int n) {
+  assert(n >= 0);
+  assert(n == 0 || rows != NULL);
+  int *lengths = malloc(((size_t)n + 1) * sizeof(int));
+  assert(lengths != NULL);
+  for (int i = 0; i < n; i++) {
+    assert(rows[i] != NULL);
+    lengths[i] = (int)rows[i]->length;
+  }
+  T_RDB set = rdb_alloc(lengths, n);
+  free(lengths);
+#pragma omp parallel for schedule(dynamic, 16)
+  for (int i = 0; i < n; i++)
+    BitRDB_replace_at(set, i, rows[i]);
+  return set;
+}
+
+void BitRDB_free(T_RDB *set) {
+  assert(set && *set);
+  free((*set)->lengths);
+  free((*set)->offsets);
+  free((*set)->qwords);
+  free((*set)->row_counts);
+  free(*set);
+  *set = NULL;
+}
+
+int BitRDB_nelem(T_RDB set) {
+  assert(set);
+  return (int)set->nelem;
+}
+
+int BitRDB_length_at(T_RDB set, int index) {
+  assert(set);
+  assert(index >= 0 && (unsigned int)index < set->nelem);
+  return set->lengths[index];
+}
+
+int BitRDB_count_at(T_RDB set, int index) {
+  assert(set);
+  assert(index >= 0 && (unsigned int)index < set->nelem);
+  return set->row_counts[index];
+}
+
+size_t BitRDB_size_in_bytes(T_RDB set) {
+  assert(set);
+  return sizeof(*set) +
+         ((size_t)set->nelem + 1) * (2 * sizeof(int) + sizeof(size_t)) +
+         set->offsets[set->nelem] * sizeof(uint64_t);
+}
+
+void BitRDB_replace_at(T_RDB set, int index, T bit) {
+  assert(set && bit);
+  assert(index >= 0 && (unsigned int)index < set->nelem);
+  assert((int)bit->length == set->lengths[index]);
+  uint64_t *row = set->qwords + set->offsets[index];
+  memcpy(row, bit->qwords, bit->size_in_bytes);
+  // a Bit_T may be padded less than the row
+  const size_t nq = bit->size_in_qwords;
+  memset(row + nq, 0,
+         (rdb_row_qwords(set, (unsigned int)index) - nq) * sizeof(uint64_t));
+  set->row_counts[index] = bit_kernels_active()->count_qwords(
+      row, rdb_row_qwords(set, (unsigned int)index));
+}
+
+T BitRDB_get_from(T_RDB set, int index) {
+  assert(set);
+  assert(index >= 0 && (unsigned int)index < set->nelem);
+  T bit = Bit_new(set->lengths[index]);
+  memcpy(bit->qwords, set->qwords + set->offsets[index], bit->size_in_bytes);
+  return bit;
+}
+
+void BitRDB_count_store(T_RDB bit, T_RDB bits, Bit_count_ops op, int *counts,
+                        SETOP_COUNT_OPTS opts) {
+  assert(bit && bits);
+  assert(counts != NULL);
+  assert(is_count_op(op));
+  const size_t nq = bit->nelem, nt = bits->nelem;
+  if (nq == 0 || nt == 0)
+    return;
+  int *order = rdb_longest_first(bit);
+  int (*inter_count)(T, T) = bit_kernels_active()->setop_count[BIT_OP_AND];
+  const size_t nqb = (nq + BIT_RDB_QUERY_BLOCK - 1) / BIT_RDB_QUERY_BLOCK;
+  const size_t ntb = (nt + BIT_RDB_TARGET_BLOCK - 1) / BIT_RDB_TARGET_BLOCK;
+  // the units of the longest queries go first, so that the short ones fill
+  // in behind them
+#pragma omp parallel for num_threads(cpu_threads(opts)) schedule(dynamic, 1)
+  for (size_t u = 0; u < nqb * ntb; u++) {
+    const size_t q0 = (u / ntb) * BIT_RDB_QUERY_BLOCK;
+    const size_t q1 = q0 + BIT_RDB_QUERY_BLOCK < nq ? q0 + BIT_RDB_QUERY_BLOCK
+                                                    : nq;
+    const size_t t0 = (u % ntb) * BIT_RDB_TARGET_BLOCK;
+    const size_t t1 = t0 + BIT_RDB_TARGET_BLOCK < nt
+                          ? t0 + BIT_RDB_TARGET_BLOCK
+                          : nt;
+    for (size_t k = q0; k < q1; k++) {
+      const unsigned int i = (unsigned int)order[k];
+      uint64_t *a = bit->qwords + bit->offsets[i];
+      const size_t na = rdb_row_qwords(bit, i);
+      int *out = counts + (size_t)i * nt;
+      for (size_t j = t0; j < t1; j++) {
+        const int inter =
+            rdb_inter(inter_count, a, na, bits->qwords + bits->offsets[j],
+                      rdb_row_qwords(bits, (unsigned int)j));
+        out[j] = count_from_inter(op, bit->row_counts[i], bits->row_counts[j],
+                                  inter);
+      }
+    }
+  }
+  free(order);
+}
+
+void BitRDB_query_count_store(T q, T_RDB db, Bit_count_ops op, int *counts,
+                              SETOP_COUNT_OPTS opts) {
+  assert(q && db);
+  assert(counts != NULL);
+  assert(is_count_op(op));
+  // the counts are of q against each row: q is the left operand
+  const int q_count = Bit_count(q);
+  int (*inter_count)(T, T) = bit_kernels_active()->setop_count[BIT_OP_AND];
+  const int n = (int)db->nelem;
+#pragma omp parallel for num_threads(cpu_threads(opts)) schedule(dynamic, 64)
+  for (int i = 0; i < n; i++) {
+    // a Bit_T is padded to whole qwords only, so it bounds the shared words
+    const int inter = rdb_inter(inter_count, q->qwords, q->size_in_qwords,
+                                db->qwords + db->offsets[i],
+                                rdb_row_qwords(db, (unsigned int)i));
+    counts[i] = count_from_inter(op, q_count, db->row_counts[i], inter);
+  }
+}
+
+/* --- End Section 9: PUBLIC API --- */
@@ -0,0 +1,319 @@
+/*
+    Run-length encoded serialization of Bit_T (see Bit_serialize_rle in
+    include/bit.h), after EWAH: the qwords of a bitset are a sequence of
+    markers, each one a run of clean words (all zeros or all ones) followed
+    by a number of literal words stored verbatim. A marker word holds
+
+        bit 0       the value of the bits of its run
+        bits 1-32   the clean words of the run
+        bits 33-63  the literal words that follow the marker
+
+    and the stream is preceded by a header word with the length of the
+    bitset in bits (low half) and the stream words that follow (high half).
+    Counts and intersections walk two streams marker by marker, so a run of
+    zeros in either skips the words of the other without reading them.
+
+    * License : BSD-2
+*/
+
+/* ==========================================================================
+   SECTION 1: INCLUDES
+   Standard library headers first, then project headers.
+   ========================================================================== */
+
+#include "bit.h"
+#include "omp.h"
+#include <assert.h>
+#include <limits.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "bit_internal.h"
+
+/* --- End Section 1: INCLUDES --- */
+
+/* ==========================================================================
+   SECTION 2: COMPILE-TIME CONFIGURATION
+   File-local compile-time constants, build-time defaults, and feature flags.
+   ========================================================================== */
+
+#define RLE_RUN_MAX UINT64_C(0xffffffff)   // clean words of one marker
+#define RLE_LITERAL_MAX UINT64_C(0x7fffffff) // literal words of one marker
+
+/* --- End Section 2: COMPILE-TIME CONFIGURATION --- */
+
+/* ==========================================================================
+   SECTION 3: INFRASTRUCTURAL MACROS
+   Private macros used by helper functions and low-level operations.
+   ========================================================================== */
+
+#define RLE_MARKER(bit, run, literals)                                         \
+  ((uint64_t)(bit) | (uint64_t)(run) << 1 | (uint64_t)(literals) << 33)
+#define RLE_CLEAN(word) ((word) == 0 || (word) == ~UINT64_C(0))
+
+/* --- End Section 3: INFRASTRUCTURAL MACROS --- */
+
+/* ==========================================================================
+   SECTION 5: INTERNAL DATA STRUCTURES AND ENUMS
+   Types used only inside this translation unit.
+   ========================================================================== */
+
+/* Position in a stream: the rest of the current run or of its literals */
+typedef struct {
+  const uint64_t *p;   // current literal, or the next marker
+  const uint64_t *end; // past the last stream word
+  uint64_t run;        // clean words left in the run
+  uint64_t literals;   // literal words left after the run
+  bool bit;            // value of the run
+} rle_cursor;
+
+/* Builds a stream; out may be NULL to only count its words */
+typedef struct {
+  uint64_t *out;
+  uint64_t n;        // stream words so far
+  uint64_t marker;   // index of the open marker
+  uint64_t run;      // clean words of the open marker
+  uint64_t literals; // literal words of the open marker
+  bool bit;
+} rle_writer;
+
+/* --- End Section 5: INTERNAL DATA STRUCTURES AND ENUMS --- */
+
+/* ==========================================================================
+   SECTION 8: INTERNAL HELPER FUNCTION DEFINITIONS
+   Stream cursors and writers.
+   ========================================================================== */
+
+static uint64_t rle_length(const uint64_t *buffer) {
+  return buffer[0] & UINT64_C(0xffffffff);
+}
+
+static uint64_t rle_words(const uint64_t *buffer) { return buffer[0] >> 32; }
+
+static void cursor_init(rle_cursor *c, const void *buffer) {
+  assert(buffer != NULL);
+  const uint64_t *words = buffer;
+  *c = (rle_cursor){.p = words + 1, .end = words + 1 + rle_words(words)};
+}
+
+/* Reads markers until the cursor is in a run or in literals; false at the
+   end of the stream */
+static bool cursor_fill(rle_cursor *c) {
+  while (c->run == 0 && c->literals == 0) {
+    if (c->p == c->end)
+      return false;
+    const uint64_t marker = *c->p++;
+    c->bit = marker & 1;
+    c->run = (marker >> 1) & RLE_RUN_MAX;
+    c->literals = marker >> 33;
+    assert(c->literals <= (uint64_t)(c->end - c->p)); // truncated stream
+  }
+  return true;
+}
+
+/* Words up to the end of the current run or literals */
+static uint64_t cursor_span(const rle_cursor *c) {
+  return c->run ? c->run : c->literals;
+}
+
+static void cursor_skip(rle_cursor *c, uint64_t n) {
+  if (c->run) {
+    c->run -= n;
+  } else {
+    c->p += n;
+    c->literals -= n;
+  }
+}
+
+static void writer_close(rle_writer *w) {
+  if (w->out)
+    w->out[w->marker] = RLE_MARKER(w->bit, w->run, w->literals);
+}
+
+static void writer_open(rle_writer *w) {
+  w->marker = w->n++;
+  w->run = w->literals = 0;
+  w->bit = false;
+}
+
+static void writer_run(rle_writer *w, bool bit, uint64_t n) {
+  while (n) {
+    if (w->literals || (w->run && w->bit != bit) || w->run == RLE_RUN_MAX) {
+      writer_close(w);
+      writer_open(w);
+    }
+    const uint64_t take = n < RLE_RUN_MAX - w->run ? n : RLE_RUN_MAX - w->run;
+    w->bit = bit;
+    w->run += take;
+    n -= take;
+  }
+}
+
+static void writer_words(rle_writer *w, const uint64_t *words, uint64_t n) {
+  for (uint64_t i = 0; i < n; i++) {
+    if (RLE_CLEAN(words[i])) {
+      uint64_t run = 1;
+      while (i + run < n && words[i + run] == words[i])
+        run++;
+      writer_run(w, words[i] != 0, run);
+      i += run - 1;
+      continue;
+    }
+    if (w->literals == RLE_LITERAL_MAX) {
+      writer_close(w);
+      writer_open(w);
+    }
+    if (w->out)
+      w->out[w->n] = words[i];
+    w->n++;
+    w->literals++;
+  }
+}
+
+static void writer_literal(rle_writer *w, uint64_t word) {
+  writer_words(w, &word, 1);
+}
+
+/* Header and stream of a bitset of length bits into out; bytes written */
+static int writer_finish(rle_writer *w, uint64_t length) {
+  writer_close(w);
+  if (w->out)
+    w->out[0] = length | (w->n - 1) << 32;
+  return (int)(w->n * sizeof(uint64_t));
+}
+
+static void writer_init(rle_writer *w, void *buffer) {
+  *w = (rle_writer){.out = buffer, .n = 1}; // word 0 is the header
+  writer_open(w);
+}
+
+/* Set bits of n literal words */
+static int literal_count(const uint64_t *words, uint64_t n) {
+  return bit_kernels_active()->count_qwords(words, (size_t)n);
+}
+
+/* Set bits of a AND b over n literal words */
+static int literal_inter_count(const uint64_t *a, const uint64_t *b,
+                               uint64_t n) {
+  struct T x = {.length = (unsigned int)(n * BPQW),
+                .size_in_bytes = (unsigned int)(n * sizeof(uint64_t)),
+                .size_in_qwords = (unsigned int)n,
+                .bytes = (unsigned char *)a,
+                .qwords = (uint64_t *)a};
+  struct T y = x;
+  y.bytes = (unsigned char *)b;
+  y.qwords = (uint64_t *)b;
+  return bit_kernels_active()->setop_count[BIT_OP_AND](&x, &y);
+}
+
+/* --- End Section 8: INTERNAL HELPER FUNCTION DEFINITIONS --- */
+
+/* ==========================================================================
+   SECTION 9: PUBLIC API
+   ========================================================================== */
+
+int Bit_serialize_rle(T set, void *buffer) {
+  assert(set);
+  rle_writer w;
+  writer_init(&w, buffer);
+  writer_words(&w, set->qwords, set->size_in_qwords);
+  return writer_finish(&w, set->length);
+}
+
+T Bit_deserialize_rle(const void *buffer, int bytes) {
+  assert(buffer != NULL);
+  assert(bytes >= (int)sizeof(uint64_t));
+  assert((uint64_t)bytes >= (1 + rle_words(buffer)) * sizeof(uint64_t));
+  T set = Bit_new((int)rle_length(buffer));
+  rle_cursor c;
+  cursor_init(&c, buffer);
+  uint64_t w = 0;
+  while (cursor_fill(&c)) {
+    const uint64_t n = cursor_span(&c);
+    assert(w + n <= set->size_in_qwords);
+    if (c.run == 0)
+      memcpy(set->qwords + w, c.p, n * sizeof(uint64_t));
+    else if (c.bit)
+      memset(set->qwords + w, 0xff, n * sizeof(uint64_t));
+    cursor_skip(&c, n);
+    w += n;
+  }
+  assert(w == set->size_in_qwords);
+  return set;
+}
+
+int Bit_rle_length(const void *buffer) {
+  assert(buffer != NULL);
+  return (int)rle_length(buffer);
+}
+
+int Bit_rle_count(const void *buffer) {
+  rle_cursor c;
+  cursor_init(&c, buffer);
+  int count = 0;
+  while (cursor_fill(&c)) {
+    const uint64_t n = cursor_span(&c);
+    if (c.run == 0)
+      count += literal_count(c.p, n);
+    else if (c.bit)
+      count += (int)(n * BPQW);
+    cursor_skip(&c, n);
+  }
+  return count;
+}
+
+int Bit_rle_inter_count(const void *s, const void *t) {
+  assert(Bit_rle_length(s) == Bit_rle_length(t));
+  rle_cursor a, b;
+  cursor_init(&a, s);
+  cursor_init(&b, t);
+  int count = 0;
+  while (cursor_fill(&a) && cursor_fill(&b)) {
+    const uint64_t span_a = cursor_span(&a), span_b = cursor_span(&b);
+    const uint64_t n = span_a < span_b ? span_a : span_b;
+    if ((a.run && !a.bit) || (b.run && !b.bit))
+      ; // a run of zeros: the words of the other are not read
+    else if (a.run && b.run)
+      count += (int)(n * BPQW);
+    else if (a.run)
+      count += literal_count(b.p, n);
+    else if (b.run)
+      count += literal_count(a.p, n);
+    else
+      count += literal_inter_count(a.p, b.p, n);
+    cursor_skip(&a, n);
+    cursor_skip(&b, n);
+  }
+  return count;
+}
+
+int Bit_rle_inter(const void *s, const void *t, void *buffer) {
+  assert(Bit_rle_length(s) == Bit_rle_length(t));
+  rle_cursor a, b;
+  cursor_init(&a, s);
+  cursor_init(&b, t);
+  rle_writer w;
+  writer_init(&w, buffer);
+  while (cursor_fill(&a) && cursor_fill(&b)) {
+    const uint64_t span_a = cursor_span(&a), span_b = cursor_span(&b);
+    const uint64_t n = span_a < span_b ? span_a : span_b;
+    if ((a.run && !a.bit) || (b.run && !b.bit))
+      writer_run(&w, false, n);
+    else if (a.run && b.run)
+      writer_run(&w, true, n);
+    else if (a.run)
+      writer_words(&w, b.p, n);
+    else if (b.run)
+      writer_words(&w, a.p, n);
+    else
+      for (uint64_t i = 0; i < n; i++)
+        writer_literal(&w, a.p[i] & b.p[i]);
+    cursor_skip(&a, n);
+    cursor_skip(&b, n);
+  }
+  return writer_finish(&w, rle_length(s));
+}
+
+/* --- End Section 9: PUBLIC API --- */
@@ -0,0 +1,298 @@
+/*
+    MinHash sketches of Bit_DB_T rows, LSH banding over the sketches, and
+    exact intersection counts of a list of row pairs (see BitDB_minhash in
+    include/bit.h).
+
+    Sketches use one-permutation hashing: every set bit j of a row is sent
+    through a fixed permutation of the 32-bit integers, the high bits of its
+    image pick one of k bins and the smallest image in each bin is the
+    signature entry. That is one hash per set bit instead of k. The images
+    of a qword's bits are computed a batch at a time in a vectorizable loop.
+    Bins no bit fell in borrow the entry of the next non-empty bin, mixed
+    with the distance to it, so that two rows agree on an empty bin about
+    as often as on a filled one.
+
+    * License : BSD-2
+*/
+
+/* ==========================================================================
+   SECTION 1: INCLUDES
+   Standard library headers first, then project headers.
+   ========================================================================== */
+
+#include "bit.h"
+#include "omp.h"
+#include <assert.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "bit_internal.h"
+
+/* --- End Section 1: INCLUDES --- */
+
+/* ==========================================================================
+   SECTION 2: COMPILE-TIME CONFIGURATION
+   File-local compile-time constants, build-time defaults, and feature flags.
+   ========================================================================== */
+
+#define SKETCH_BATCH 64       // bit positions hashed per vector loop
+#define SKETCH_EMPTY UINT32_MAX // every entry of the sketch of an empty row
+
+/* --- End Section 2: COMPILE-TIME CONFIGURATION --- */
+
+/* ==========================================================================
+   SECTION 5: INTERNAL DATA STRUCTURES AND ENUMS
+   Types used only inside this translation unit.
+   ========================================================================== */
+
+/* A target row filed under the hash of one band of its sketch */
+typedef struct {
+  uint64_t hash;
+  int row;
+} sketch_bucket;
+
+/* --- End Section 5: INTERNAL DATA STRUCTURES AND ENUMS --- */
+
+/* ==========================================================================
+   SECTION 8: INTERNAL HELPER FUNCTION DEFINITIONS
+   ========================================================================== */
+
+/* The permutation: the murmur3 finalizer, a bijection of the 32-bit
+   integers */
+static inline uint32_t sketch_permute(uint32_t x) {
+  x ^= x >> 16;
+  x *= 0x85ebca6bU;
+  x ^= x >> 13;
+  x *= 0xc2b2ae35U;
+  x ^= x >> 16;
+  return x;
+}
+
+/* Folds the images of n positions into the bins of sig */
+static void sketch_fold(const uint32_t *pos, int n, int k, uint32_t *sig,
+                        bool *filled) {
+  uint32_t image[SKETCH_BATCH];
+  OMP_CPU_SIMD
+  for (int i = 0; i < n; i++)
+    image[i] = sketch_permute(pos[i]);
+  for (int i = 0; i < n; i++) {
+    uint32_t bin = (uint32_t)(((uint64_t)image[i] * (uint32_t)k) >> 32);
+    if (image[i] <= sig[bin])
+      sig[bin] = image[i];
+    filled[bin] = true;
+  }
+}
+
+static void sketch_row(const uint64_t *qwords, size_t nq, int k,
+                       uint32_t *sig, bool *filled) {
+  uint32_t pos[SKETCH_BATCH];
+  int n = 0;
+  for (int b = 0; b < k; b++) {
+    sig[b] = SKETCH_EMPTY;
+    filled[b] = false;
+  }
+  for (size_t q = 0; q < nq; q++) {
+    for (uint64_t w = qwords[q]; w; w &= w - 1) {
+      pos[n++] = (uint32_t)(q * BPQW) + (uint32_t)__builtin_ctzll(w);
+      if (n == SKETCH_BATCH) {
+        sketch_fold(pos, n, k, sig, filled);
+        n = 0;
+      }
+    }
+  }
+  sketch_fold(pos, n, k, sig, filled);
+
+  // an empty bin takes the entry of the next filled one, circularly
+  int first = 0;
+  while (first < k && !filled[first])
+    first++;
+  if (first == k)
+    return; // an empty row
+  for (int b = k - 1, next = first; b >= 0; b--) {
+    if (filled[b]) {
+      next = b;
+    } else {
+      const int dist = next > b ? next - b : next + k - b;
+      sig[b] = sketch_permute(sig[next] + (uint32_t)dist * 0x9e3779b9U);
+    }
+  }
+}
+
+/* Hash of the entries of one band of a sketch */
+static inline uint64_t sketch_band_hash(const uint32_t *band, int r) {
+  uint64_t h = 0x243f6a8885a308d3ULL;
+  for (int i = 0; i < r; i++) {
+    h = (h ^ band[i]) * 0x100000001b3ULL;
+    h ^= h >> 29;
+  }
+  return h;
+}
+
+static int bucket_compare(const void *x, const void *y) {
+  const sketch_bucket *a = x, *b = y;
+  if (a->hash != b->hash)
+    return a->hash < b->hash ? -1 : 1;
+  return (a->row > b->row) - (a->row < b->row);
+}
+
+static int int_compare(const void *x, const void *y) {
+  const int a = *(const int *)x, b = *(const int *)y;
+  return (a > b) - (a < b);
+}
+
+/* First bucket of a sorted band whose hash is not below h */
+static size_t bucket_lower_bound(const sketch_bucket *band, size_t n,
+                                 uint64_t h) {
+  size_t lo = 0, hi = n;
+  while (lo < hi) {
+    size_t mid = lo + (hi - lo) / 2;
+    if (band[mid].hash < h)
+      lo = mid + 1;
+    else
+      hi = mid;
+  }
+  return lo;
+}
+
+/* --- End Section 8: INTERNAL HELPER FUNCTION DEFINITIONS --- */
+
+/* ==========================================================================
+   SECTION 9: PUBLIC API
+   ========================================================================== */
+
+void BitDB_minhash(T_DB set, int k, uint32_t *signatures,
+                   SETOP_COUNT_OPTS opts) {
+  assert(set);
+  assert(signatures != NULL);
+  assert(k >= 1);
+  const int n = (int)set->nelem;
+#pragma omp parallel num_threads(cpu_threads(opts))
+  {
+    bool *filled = malloc((size_t)k * sizeof(bool));
+    assert(filled != NULL);
+#pragma omp for schedule(dynamic, 64)
+    for (int i = 0; i < n; i++)
+      sketch_row(set->qwords + (size_t)i * set->stride_in_qwords,
+                 set->size_in_qwords, k, signatures + (size_t)i * k, filled);
+    free(filled);
+  }
+}
+
+double Bit_minhash_jaccard(const uint32_t *s, const uint32_t *t, int k) {
+  assert(s != NULL && t != NULL);
+  assert(k >= 1);
+  int same = 0;
+  for (int b = 0; b < k; b++)
+    same += s[b] == t[b];
+  return (double)same / k;
+}
+
+size_t BitDB_lsh_candidates(const uint32_t *queries, int nqueries,
+                            const uint32_t *targets, int ntargets, int k,
+                            int bands, SETOP_COUNT_OPTS opts, int **pairs) {
+  assert(queries != NULL && pairs != NULL);
+  assert(nqueries >= 0);
+  assert(bands >= 1 && k % bands == 0);
+  const bool self = targets == NULL;
+  if (self)
+    ntargets = nqueries, targets = queries;
+  assert(ntargets >= 0);
+  const int r = k / bands;
+  const size_t nt = (size_t)ntargets;
+
+  // the targets of every band, sorted by the hash of the band
+  const size_t entries = (size_t)bands * nt;
+  sketch_bucket *table =
+      malloc((entries ? entries : 1) * sizeof(sketch_bucket));
+  assert(table != NULL);
+#pragma omp parallel for num_threads(cpu_threads(opts)) schedule(static)
+  for (int band = 0; band < bands; band++) {
+    sketch_bucket *sorted = table + (size_t)band * nt;
+    for (size_t j = 0; j < nt; j++)
+      sorted[j] = (sketch_bucket){
+          sketch_band_hash(targets + j * k + (size_t)band * r, r), (int)j};
+    qsort(sorted, nt, sizeof(sketch_bucket), bucket_compare);
+  }
+
+  int **found = calloc(nqueries ? nqueries : 1, sizeof(int *));
+  size_t *nfound = calloc(nqueries ? nqueries : 1, sizeof(size_t));
+  assert(found && nfound);
+#pragma omp parallel for num_threads(cpu_threads(opts)) schedule(dynamic, 64)
+  for (int q = 0; q < nqueries; q++) {
+    size_t n = 0, cap = 0;
+    int *list = NULL;
+    for (int band = 0; band < bands; band++) {
+      const sketch_bucket *sorted = table + (size_t)band * nt;
+      uint64_t h =
+          sketch_band_hash(queries + (size_t)q * k + (size_t)band * r, r);
+      for (size_t b = bucket_lower_bound(sorted, nt, h);
+           b < nt && sorted[b].hash == h; b++) {
+        if (self && sorted[b].row <= q)
+          continue; // each unordered pair once, from its lower row
+        if (n == cap) {
+          cap = cap ? 2 * cap : 16;
+          list = realloc(list, cap * sizeof(int));
+          assert(list != NULL);
+        }
+        list[n++] = sorted[b].row;
+      }
+    }
+    // a pair that shares several bands is reported once
+    if (n > 1)
+      qsort(list, n, sizeof(int), int_compare);
+    size_t unique = 0;
+    for (size_t i = 0; i < n; i++)
+      if (unique == 0 || list[i] != list[unique - 1])
+        list[unique++] = list[i];
+    found[q] = list;
+    nfound[q] = unique;
+  }
+  free(table);
+
+  size_t total = 0;
+  for (int q = 0; q < nqueries; q++)
+    total += nfound[q];
+  *pairs = malloc((total ? 2 * total : 1) * sizeof(int));
+  assert(*pairs != NULL);
+  size_t m = 0;
+  for (int q = 0; q < nqueries; q++) {
+    for (size_t i = 0; i < nfound[q]; i++, m++) {
+      (*pairs)[2 * m] = q;
+      (*pairs)[2 * m + 1] = found[q][i];
+    }
+    free(found[q]);
+  }
+  free(found);
+  free(nfound);
+  return total;
+}
+
+void BitDB_pairs_count(T_DB bit, T_DB bits, const int pairs[], size_t n,
+                       int *counts, SETOP_COUNT_OPTS opts) {
+  assert(bit && bits);
+  assert(pairs != NULL || n == 0);
+  assert(counts != NULL || n == 0);
+  assert(bit->length == bits->length);
+  int (*kernel)(T, T) = bit_kernels_active()->setop_count[BIT_OP_AND];
+  const unsigned int nq = bit->size_in_qwords;
+  const struct T row = {.length = bit->length,
+                        .size_in_bytes = bit->size_in_bytes,
+                        .size_in_qwords = nq};
+  const long long npairs = (long long)n;
+#pragma omp parallel for num_threads(cpu_threads(opts)) schedule(static)
+  for (long long m = 0; m < npairs; m++) {
+    const int i = pairs[2 * m], j = pairs[2 * m + 1];
+    assert(i >= 0 && (size_t)i < bit->nelem);
+    assert(j >= 0 && (size_t)j < bits->nelem);
+    struct T x = row, y = row;
+    x.qwords = bit->qwords + (size_t)i * bit->stride_in_qwords;
+    y.qwords = bits->qwords + (size_t)j * bits->stride_in_qwords;
+    x.bytes = (unsigned char *)x.qwords;
+    y.bytes = (unsigned char *)y.qwords;
+    counts[m] = kernel(&x, &y);
+  }
+}
+
+/* --- End Section 9: PUBLIC API --- */
@@ -0,0 +1,290 @@
+/*
+    Packed containers with sparse rows (Bit_SDB_T, see include/bit.h).
+
+    A Bit_SDB_T holds the rows of a Bit_DB_T in two forms chosen row by row:
+    the rows with few set bits as sorted lists of their positions, and the
+    others in a packed Bit_DB_T of their own. A count of a sparse row
+    against a dense one reads only the words at its positions, through the
+    sparse_count kernel (gathers on the AVX2 and AVX-512 tiers), instead of
+    streaming the whole row; the dense rows go through the count kernels of
+    Bit_DB_T, and their counts are scattered to the rows they came from.
+
+    * License : BSD-2
+*/
+
+/* ==========================================================================
+   SECTION 1: INCLUDES
+   Standard library headers first, then project headers.
+   ========================================================================== */
+
+#include "bit.h"
+#include "omp.h"
+#include <assert.h>
+#include <limits.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "bit_internal.h"
+
+/* --- End Section 1: INCLUDES --- */
+
+/* ==========================================================================
+   SECTION 5: INTERNAL DATA STRUCTURES AND ENUMS
+   Types used only inside this translation unit.
+   ========================================================================== */
+
+struct T_SDB {
+  unsigned int nelem;  // rows
+  unsigned int length; // bits of every row
+  int *row_counts;     // set bits of every row
+  size_t *offsets;     // positions of row i: [offsets[i], offsets[i + 1]),
+                       // empty for a dense row
+  uint32_t *positions; // sorted set bits of the sparse rows
+  int *dense_at;       // row of dense holding every row, -1 if sparse
+  int *dense_rows;     // row of the container of every row of dense
+  T_DB dense;          // the dense rows, NULL if there are none
+};
+
+/* --- End Section 5: INTERNAL DATA STRUCTURES AND ENUMS --- */
+
+/* ==========================================================================
+   SECTION 8: INTERNAL HELPER FUNCTION DEFINITIONS
+   ========================================================================== */
+
+static const uint64_t *db_row(T_DB db, unsigned int index) {
+  return db->qwords + (size_t)index * db->stride_in_qwords;
+}
+
+/* The op count of rows of counts a and b with inter bits in common */
+static inline int count_from_inter(Bit_count_ops op, int a, int b,
+                                   int inter) {
+  switch (op) {
+  case BIT_COUNT_INTER:
+    return inter;
+  case BIT_COUNT_UNION:
+    return a + b - inter;
+  case BIT_COUNT_DIFF:
+    return a + b - 2 * inter;
+  default: // BIT_COUNT_MINUS
+    return a - inter;
+  }
+}
+
+static void dense_count_store(T_DB bit, T_DB bits, Bit_count_ops op,
+                              int *counts, SETOP_COUNT_OPTS opts) {
+  opts = bit_stop_ignored(opts);
+  switch (op) {
+  case BIT_COUNT_INTER:
+    BitDB_inter_count_store_cpu(bit, bits, counts, opts);
+    break;
+  case BIT_COUNT_UNION:
+    BitDB_union_count_store_cpu(bit, bits, counts, opts);
+    break;
+  case BIT_COUNT_DIFF:
+    BitDB_diff_count_store_cpu(bit, bits, counts, opts);
+    break;
+  default: // BIT_COUNT_MINUS
+    BitDB_minus_count_store_cpu(bit, bits, counts, opts);
+    break;
+  }
+}
+
+static bool is_count_op(Bit_count_ops op) {
+  return op == BIT_COUNT_INTER || op == BIT_COUNT_UNION ||
+         op == BIT_COUNT_DIFF || op == BIT_COUNT_MINUS;
+}
+
+/* --- End Section 8: INTERNAL HELPER FUNCTION DEFINITIONS --- */
+
+/* ==========================================================================
+   SECTION 9: PUBLIC API
+   ========================================================================== */
+
+T_SDB BitSDB_new(T_DB db, int threshold) {
+  assert(db);
+  const unsigned int nelem = db->nelem;
+  T_SDB set = calloc(1, sizeof(*set));
+  assert(set != NULL);
+  set->nelem = nelem;
+  set->length = db->length;
+  set->row_counts = malloc(((size_t)nelem + 1) * sizeof(int));
+  set->offsets = malloc(((size_t)nelem + 1) * sizeof(size_t));
+  set->dense_at = malloc(((size_t)nelem + 1) * sizeof(int));
+  assert(set->row_counts && set->offsets && set->dense_at);
+  // a position list pays off below a row's bytes
+  if (threshold < 0)
+    threshold = (int)(db->size_in_bytes / sizeof(uint32_t)) - 1;
+
+  BitDB_count_store(db, set->row_counts, (SETOP_COUNT_OPTS){0});
+  size_t npositions = 0;
+  int ndense = 0;
+  for (unsigned int i = 0; i < nelem; i++) {
+    set->offsets[i] = npositions;
+    if (set->row_counts[i] <= threshold) {
+      set->dense_at[i] = -1;
+      npositions += (size_t)set->row_counts[i];
+    } else {
+      set->dense_at[i] = ndense++;
+    }
+  }
+  set->offsets[nelem] = npositions;
+
+  set->positions = malloc((npositions ? npositions : 1) * sizeof(uint32_t));
+  set->dense_rows = malloc((ndense ? (size_t)ndense : 1) * sizeof(int));
+  assert(set->positions && set->dense_rows);
+  if (ndense)
+    set->dense = BitDB_new((int)set->length, ndense);
+#pragma omp parallel for schedule(static)
+  for (unsigned int i = 0; i < nelem; i++) {
+    const uint64_t *row = db_row(db, i);
+    if (set->dense_at[i] >= 0) {
+      const int k = set->dense_at[i];
+      set->dense_rows[k] = (int)i;
+      memcpy(set->dense->qwords + (size_t)k * set->dense->stride_in_qwords,
+             row, db->size_in_bytes);
+      continue;
+    }
+    uint32_t *out = set->positions + set->offsets[i];
+    for (unsigned int w = 0; w < db->size_in_qwords; w++)
+      for (uint64_t word = row[w]; word; word &= word - 1)
+        *out++ = w * (unsigned int)BPQW + (unsigned int)__builtin_ctzll(word);
+  }
+  return set;
+}
+
+void BitSDB_free(T_SDB *set) {
+  assert(set && *set);
+  if ((*set)->dense)
+    BitDB_free(&(*set)->dense);
+  free((*set)->row_counts);
+  free((*set)->offsets);
+  free((*set)->positions);
+  free((*set)->dense_at);
+  free((*set)->dense_rows);
+  free(*set);
+  *set = NULL;
+}
+
+int BitSDB_nelem(T_SDB set) {
+  assert(set);
+  return (int)set->nelem;
+}
+
+int BitSDB_length(T_SDB set) {
+  assert(set);
+  return (int)set->length;
+}
+
+int BitSDB_nsparse(T_SDB set) {
+  assert(set);
+  return (int)set->nelem - (set->dense ? BitDB_nelem(set->dense) : 0);
+}
+
+int BitSDB_count_at(T_SDB set, int index) {
+  assert(set);
+  assert(index >= 0 && (unsigned int)index < set->nelem);
+  return set->row_counts[index];
+}
+
+bool BitSDB_is_sparse_at(T_SDB set, int index) {
+  assert(set);
+  assert(index >= 0 && (unsigned int)index < set->nelem);
+  return set->dense_at[index] < 0;
+}
+
+size_t BitSDB_size_in_bytes(T_SDB set) {
+  assert(set);
+  size_t bytes = sizeof(*set) +
+                 ((size_t)set->nelem + 1) * (2 * sizeof(int) + sizeof(size_t)) +
+                 set->offsets[set->nelem] * sizeof(uint32_t);
+  if (set->dense)
+    bytes += (size_t)set->dense->nelem *
+             (set->dense->stride_in_bytes + sizeof(int));
+  return bytes;
+}
+
+T BitSDB_get_from(T_SDB set, int index) {
+  assert(set);
+  assert(index >= 0 && (unsigned int)index < set->nelem);
+  if (set->dense_at[index] >= 0)
+    return BitDB_get_from(set->dense, set->dense_at[index]);
+  T bit = Bit_new((int)set->length);
+  for (size_t k = set->offsets[index]; k < set->offsets[index + 1]; k++)
+    Bit_bset(bit, (int)set->positions[k]);
+  return bit;
+}
+
+void BitSDB_count_store(T_SDB bit, T_DB bits, Bit_count_ops op, int *counts,
+                        SETOP_COUNT_OPTS opts) {
+  assert(bit && bits);
+  assert(counts != NULL);
+  assert(bit->length == bits->length);
+  assert(is_count_op(op));
+  const size_t n = bits->nelem;
+  if (bit->dense) {
+    const size_t ndense = bit->dense->nelem;
+    int *dense_counts = malloc(ndense * n * sizeof(int));
+    assert(dense_counts != NULL);
+    dense_count_store(bit->dense, bits, op, dense_counts, opts);
+#pragma omp parallel for num_threads(cpu_threads(opts)) schedule(static)
+    for (size_t k = 0; k < ndense; k++)
+      memcpy(counts + (size_t)bit->dense_rows[k] * n, dense_counts + k * n,
+             n * sizeof(int));
+    free(dense_counts);
+  }
+  if (BitSDB_nsparse(bit) == 0)
+    return;
+  int *bits_counts = op == BIT_COUNT_INTER ? NULL : BitDB_count(bits);
+  int (*sparse_count)(const uint32_t *, int, const uint64_t *) =
+      bit_kernels_active()->sparse_count;
+#pragma omp parallel for num_threads(cpu_threads(opts)) schedule(dynamic, 16)
+  for (unsigned int i = 0; i < bit->nelem; i++) {
+    if (bit->dense_at[i] >= 0)
+      continue;
+    const uint32_t *pos = bit->positions + bit->offsets[i];
+    const int npos = (int)(bit->offsets[i + 1] - bit->offsets[i]);
+    int *out = counts + (size_t)i * n;
+    for (size_t j = 0; j < n; j++) {
+      const int inter = sparse_count(pos, npos, db_row(bits, (unsigned int)j));
+      out[j] = count_from_inter(op, npos, bits_counts ? bits_counts[j] : 0,
+                                inter);
+    }
+  }
+  free(bits_counts);
+}
+
+void BitSDB_query_count_store(T q, T_SDB db, Bit_count_ops op, int *counts,
+                              SETOP_COUNT_OPTS opts) {
+  assert(q && db);
+  assert(counts != NULL);
+  assert(q->length == db->length);
+  assert(is_count_op(op));
+  if (db->dense) {
+    const size_t ndense = db->dense->nelem;
+    int *dense_counts = malloc(ndense * sizeof(int));
+    assert(dense_counts != NULL);
+    BitDB_query_count_store(q, db->dense, op, dense_counts, opts);
+    for (size_t k = 0; k < ndense; k++)
+      counts[db->dense_rows[k]] = dense_counts[k];
+    free(dense_counts);
+  }
+  if (BitSDB_nsparse(db) == 0)
+    return;
+  // the counts are of q against each row: q is the left operand
+  const int q_count = op == BIT_COUNT_INTER ? 0 : Bit_count(q);
+  int (*sparse_count)(const uint32_t *, int, const uint64_t *) =
+      bit_kernels_active()->sparse_count;
+#pragma omp parallel for num_threads(cpu_threads(opts)) schedule(static)
+  for (unsigned int i = 0; i < db->nelem; i++) {
+    if (db->dense_at[i] >= 0)
+      continue;
+    const int npos = (int)(db->offsets[i + 1] - db->offsets[i]);
+    const int inter =
+        sparse_count(db->positions + db->offsets[i], npos, q->qwords);
+    counts[i] = count_from_inter(op, q_count, npos, inter);
+  }
+}
+
+/* --- End Section 9: PUBLIC API --- */
@@ -0,0 +1,166 @@
+/*
+    Weighted counts of bitsets (Bit_W_T, see include/bit.h).
+
+    A weighted count sums a weight per bit position over the set bits of a
+    bitset or of a set operation of two, as in weighted Jaccard or
+    feature-weighted similarities. A Bit_W_T turns the weights into nibble
+    tables: for every 4 bits of the row, the 16 sums of the weights of the
+    bits of each nibble value. A 64-bit word then takes 16 lookups, in 1 KiB
+    of tables, instead of expanding its bits to 64 floats; the rows are read
+    as packed bits, 32 times less data than the floats.
+
+    * License : BSD-2
+*/
+
+/* ==========================================================================
+   SECTION 1: INCLUDES
+   Standard library headers first, then project headers.
+   ========================================================================== */
+
+#include "bit.h"
+#include "omp.h"
+#include <assert.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+
+#include "bit_internal.h"
+
+/* --- End Section 1: INCLUDES --- */
+
+/* ==========================================================================
+   SECTION 2: COMPILE-TIME CONFIGURATION
+   ========================================================================== */
+
+/* Queries and targets of a block of BitDB_W_count_store: the targets of a
+   block are read again for every query of the block */
+#ifndef BIT_W_BLOCK_QUERIES
+#define BIT_W_BLOCK_QUERIES 16
+#endif
+
+#ifndef BIT_W_BLOCK_TARGETS
+#define BIT_W_BLOCK_TARGETS 64
+#endif
+
+/* --- End Section 2: COMPILE-TIME CONFIGURATION --- */
+
+/* ==========================================================================
+   SECTION 5: INTERNAL DATA STRUCTURES AND ENUMS
+   Types used only inside this translation unit.
+   ========================================================================== */
+
+struct T_W {
+  unsigned int length;         // bit positions weighted
+  unsigned int size_in_qwords; // words of a row of length bits
+  float *tables;               // 256 floats per word: 16 nibbles x 16 values
+};
+
+/* --- End Section 5: INTERNAL DATA STRUCTURES AND ENUMS --- */
+
+/* ==========================================================================
+   SECTION 8: INTERNAL HELPER FUNCTION DEFINITIONS
+   ========================================================================== */
+
+static bool is_count_op(Bit_count_ops op) {
+  return op == BIT_COUNT_INTER || op == BIT_COUNT_UNION ||
+         op == BIT_COUNT_DIFF || op == BIT_COUNT_MINUS;
+}
+
+static bit_setop_id count_op_id(Bit_count_ops op) {
+  switch (op) {
+  case BIT_COUNT_INTER:
+    return BIT_OP_AND;
+  case BIT_COUNT_UNION:
+    return BIT_OP_OR;
+  case BIT_COUNT_DIFF:
+    return BIT_OP_XOR;
+  default: // BIT_COUNT_MINUS
+    return BIT_OP_AND_NOT;
+  }
+}
+
+/* --- End Section 8: INTERNAL HELPER FUNCTION DEFINITIONS --- */
+
+/* ==========================================================================
+   SECTION 9: PUBLIC API
+   ========================================================================== */
+
+T_W Bit_W_new(const float *weights, int length) {
+  assert(weights != NULL);
+  assert(length > 0);
+  T_W w = calloc(1, sizeof(*w));
+  assert(w != NULL);
+  w->length = (unsigned int)length;
+  w->size_in_qwords = nqwords(length);
+  // positions past length weigh 0, so the padding of the rows adds nothing
+  w->tables = calloc((size_t)w->size_in_qwords * 256, sizeof(float));
+  assert(w->tables != NULL);
+  for (unsigned int nib = 0; nib < w->size_in_qwords * 16; nib++) {
+    float *t = w->tables + (size_t)nib * 16;
+    for (int v = 1; v < 16; v++) {
+      const int low = __builtin_ctz((unsigned int)v);
+      const unsigned int bit = nib * 4 + (unsigned int)low;
+      t[v] = t[v & (v - 1)] + (bit < w->length ? weights[bit] : 0.0f);
+    }
+  }
+  return w;
+}
+
+void Bit_W_free(T_W *w) {
+  assert(w && *w);
+  free((*w)->tables);
+  free(*w);
+  *w = NULL;
+}
+
+int Bit_W_length(T_W w) {
+  assert(w);
+  return (int)w->length;
+}
+
+float Bit_W_count(T_W w, T s) {
+  assert(w && s);
+  assert(s->length == w->length);
+  return bit_kernels_active()->weighted_count(
+      BIT_OP_AND, s->qwords, s->qwords, w->size_in_qwords, w->tables);
+}
+
+float Bit_W_setop_count(T_W w, T s, T t, Bit_count_ops op) {
+  assert(w && s && t);
+  assert(s->length == w->length && t->length == w->length);
+  assert(is_count_op(op));
+  return bit_kernels_active()->weighted_count(
+      count_op_id(op), s->qwords, t->qwords, w->size_in_qwords, w->tables);
+}
+
+void BitDB_W_count_store(T_W w, T_DB bit, T_DB bits, Bit_count_ops op,
+                         float *sums, SETOP_COUNT_OPTS opts) {
+  assert(w && bit && bits);
+  assert(sums != NULL);
+  assert(bit->length == w->length && bits->length == w->length);
+  assert(is_count_op(op));
+  const bit_setop_id id = count_op_id(op);
+  float (*weighted_count)(bit_setop_id, const uint64_t *, const uint64_t *,
+                          size_t, const float *) =
+      bit_kernels_active()->weighted_count;
+  const int nq = (int)bit->nelem, nt = (int)bits->nelem;
+#pragma omp parallel for collapse(2) num_threads(cpu_threads(opts))           \
+    schedule(dynamic)
+  for (int i_b = 0; i_b < nq; i_b += BIT_W_BLOCK_QUERIES) {
+    for (int j_b = 0; j_b < nt; j_b += BIT_W_BLOCK_TARGETS) {
+      const int i_max =
+          i_b + BIT_W_BLOCK_QUERIES < nq ? i_b + BIT_W_BLOCK_QUERIES : nq;
+      const int j_max =
+          j_b + BIT_W_BLOCK_TARGETS < nt ? j_b + BIT_W_BLOCK_TARGETS : nt;
+      for (int i = i_b; i < i_max; i++) {
+        const uint64_t *q = bit->qwords + (size_t)i * bit->stride_in_qwords;
+        for (int j = j_b; j < j_max; j++)
+          sums[(size_t)i * nt + j] = weighted_count(
+              id, q, bits->qwords + (size_t)j * bits->stride_in_qwords,
+              w->size_in_qwords, w->tables);
+      }
+    }
+  }
+}
+
+/* --- End Section 9: PUBLIC API --- */
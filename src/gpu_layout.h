@@ -1,7 +1,16 @@
 #pragma once
 
+#include <stdatomic.h>
+#include <stdbool.h>
 #include <stddef.h>
 #include <stdint.h>
+#include <time.h>
+
+/* Every translation unit with target regions must carry the same requires
+   directive, so the one for unified shared memory lives here */
+#if defined(BIT_USM) && !defined(NOGPU)
+#pragma omp requires unified_shared_memory
+#endif
 
 #define MASK_BASE_LAYOUT 0x000000FFu
 #define MASK_FLAGS 0xFFFFFF00u
@@ -11,13 +20,96 @@ typedef enum {
     LAYOUT_ROW_MAJOR = 0,
     LAYOUT_COL_MAJOR = 1,
     LAYOUT_Z_CURVE = 2,
+    LAYOUT_BIT_SLICED = 3,
 } GPUDataState;
 
+/* LAYOUT_Z_CURVE cuts a row-major rows x columns buffer into tiles of
+   ZCURVE_TILE_ROWS rows by ZCURVE_TILE_WORDS words, stores every tile as
+   one contiguous word-major block (word lj of row li at lj * h + li, for a
+   tile of h rows), and lays the tiles out in Morton order of (tile row,
+   tile column). Tiles on the last row or column are cut short and packed,
+   so the buffer keeps its size */
+#ifndef ZCURVE_TILE_ROWS
+#define ZCURVE_TILE_ROWS 256
+#endif
+#ifndef ZCURVE_TILE_WORDS
+#define ZCURVE_TILE_WORDS 8
+#endif
+
+/* LAYOUT_BIT_SLICED interleaves groups of BIT_SLICE_ROWS consecutive rows
+   word by word: word j of row r of a group of h rows sits at j * h + r of
+   the group, which starts at its first row times columns. Only the last
+   group can be short */
+#ifndef BIT_SLICE_ROWS
+#define BIT_SLICE_ROWS 64
+#endif
+
+#pragma omp declare target
+/* Words of the tiles in [first, last) that a buffer of total words, cut
+   into ntiles tiles of size words, actually holds */
+static inline size_t zcurve_span(size_t first, size_t last, size_t ntiles,
+                                 size_t size, size_t total) {
+    if (first >= ntiles)
+        return 0;
+    return (last * size < total ? last * size : total) - first * size;
+}
+
+/* Word offset of tile (bi, bj): the words of every tile before it in Morton
+   order, counted a quadrant at a time down the power-of-two square that
+   covers the tile grid */
+static inline size_t zcurve_tile_offset(size_t bi, size_t bj, size_t rows,
+                                        size_t columns) {
+    const size_t nr = (rows + ZCURVE_TILE_ROWS - 1) / ZCURVE_TILE_ROWS;
+    const size_t nc = (columns + ZCURVE_TILE_WORDS - 1) / ZCURVE_TILE_WORDS;
+    size_t side = 1;
+    while (side < nr || side < nc)
+        side <<= 1;
+    size_t offset = 0, r0 = 0, c0 = 0;
+    for (size_t half = side >> 1; half > 0; half >>= 1) {
+        const size_t qr = bi - r0 >= half, qc = bj - c0 >= half;
+        for (size_t q = 0; q < qr * 2 + qc; q++) { // quadrants before (qr, qc)
+            const size_t r = r0 + (q >> 1) * half, c = c0 + (q & 1) * half;
+            offset += zcurve_span(r, r + half, nr, ZCURVE_TILE_ROWS, rows) *
+                      zcurve_span(c, c + half, nc, ZCURVE_TILE_WORDS, columns);
+        }
+        r0 += qr * half;
+        c0 += qc * half;
+    }
+    return offset;
+}
+
+/* Position of word j of row i in the Z-curve layout */
+static inline size_t zcurve_word_index(size_t i, size_t j, size_t rows,
+                                       size_t columns) {
+    const size_t bi = i / ZCURVE_TILE_ROWS;
+    const size_t h = rows - bi * ZCURVE_TILE_ROWS < ZCURVE_TILE_ROWS
+                         ? rows - bi * ZCURVE_TILE_ROWS
+                         : ZCURVE_TILE_ROWS;
+    return zcurve_tile_offset(bi, j / ZCURVE_TILE_WORDS, rows, columns) +
+           (j % ZCURVE_TILE_WORDS) * h + i % ZCURVE_TILE_ROWS;
+}
+/* Position of word j of row i in the bit-sliced layout */
+static inline size_t sliced_word_index(size_t i, size_t j, size_t rows,
+                                       size_t columns) {
+    const size_t g0 = i / BIT_SLICE_ROWS * BIT_SLICE_ROWS;
+    const size_t h = rows - g0 < BIT_SLICE_ROWS ? rows - g0 : BIT_SLICE_ROWS;
+    return g0 * columns + j * h + (i - g0);
+}
+#pragma omp end declare target
+
+/* Flags sit above MASK_BASE_LAYOUT. FLAG_TRANSFORM narrows the words: each
+   64-bit word is split into its two 32-bit halves, low half first, and the
+   base layout orders those (a rows x 2 * columns buffer of 32-bit words).
+   Row-major narrowed words are the row-major buffer itself */
 typedef enum {
     FLAG_NONE = 0u,
-    FLAG_TRANSFORM = 1u,
+    FLAG_TRANSFORM = 0x100u,
 } GPUDataFlags;
 
+/* The bits of a state that decide where the words are in memory; states
+   that agree on them differ only in bookkeeping flags */
+#define MASK_WORD_LAYOUT (MASK_BASE_LAYOUT | FLAG_TRANSFORM)
+
 typedef void (*TransitionKernel)(
     GPUDataState from,
     GPUDataState to,
@@ -28,3 +120,41 @@ typedef void (*TransitionKernel)(
     void *transform_params,
     size_t params_size
 );
+
+/* Telemetry of the registry, the transition router and the host <-> device
+   copies, returned by Bit_gpu_stats_get (bit_gpu.c owns it). Counters are
+   relaxed atomics; the *_ns clocks advance only while timers is set */
+typedef struct {
+    _Atomic uint64_t layout_hits;
+    _Atomic uint64_t layout_misses;
+    _Atomic uint64_t transitions[LAYOUT_BIT_SLICED + 1][LAYOUT_BIT_SLICED + 1];
+    _Atomic uint64_t h2d_bytes, d2h_bytes;
+    _Atomic uint64_t h2d_transfers, d2h_transfers;
+    _Atomic uint64_t evictions, evicted_bytes;
+    _Atomic uint64_t transition_ns, transfer_ns, kernel_ns;
+    _Atomic bool timers;
+} GPUTelemetry;
+
+extern GPUTelemetry gpu_telemetry;
+
+#define GPU_STAT_ADD(counter, value)                                          \
+    atomic_fetch_add_explicit(&gpu_telemetry.counter, (uint64_t)(value),      \
+                              memory_order_relaxed)
+
+/* Monotonic clock in nanoseconds while the timers are on, 0 otherwise */
+static inline uint64_t gpu_stat_clock(void) {
+    if (!atomic_load_explicit(&gpu_telemetry.timers, memory_order_relaxed))
+        return 0;
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (uint64_t)now.tv_sec * UINT64_C(1000000000) + (uint64_t)now.tv_nsec;
+}
+
+/* Adds the time since start, a gpu_stat_clock reading, to a clock; nothing
+   if the timers were off at either end */
+#define GPU_STAT_TIME(clock, start)                                           \
+    do {                                                                      \
+        const uint64_t _stat_start = (start), _stat_end = gpu_stat_clock();  \
+        if (_stat_start && _stat_end)                                         \
+            GPU_STAT_ADD(clock, _stat_end - _stat_start);                     \
+    } while (0)
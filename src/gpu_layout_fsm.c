@@ -3,6 +3,7 @@
    Standard library headers first, then project headers.
    ========================================================================== */
 
+#include <limits.h>
 #include <stdlib.h>
 #include <stdio.h>
 #include "gpu_layout_fsm.h"
@@ -15,7 +16,8 @@
    File-local compile-time constants, build-time defaults, and feature flags.
    ========================================================================== */
 
-/* No compile-time configuration required here. */
+/* Nodes of the transition graph: every base layout, plain or narrowed */
+#define TRANSITION_NODES (2 * (LAYOUT_BIT_SLICED + 1))
 
 /* --- End Section 2: COMPILE-TIME CONFIGURATION --- */
 
@@ -42,9 +44,13 @@
    Types used only inside this translation unit.
    ========================================================================== */
 
+/* An edge of the transition graph between two states (layout and
+   FLAG_TRANSFORM); cost counts passes over the buffer, and a NULL func
+   relabels the words without moving them */
 typedef struct {
-    GPUDataState from;
-    GPUDataState to;
+    uint32_t from;
+    uint32_t to;
+    unsigned int cost;
     TransitionKernel func;
 } TransitionEntry;
 
@@ -56,8 +62,22 @@ typedef struct {
    ========================================================================== */
 
 static const TransitionEntry transition_table[] = {
-    {LAYOUT_ROW_MAJOR, LAYOUT_COL_MAJOR, GPU_region_transpose},
-    {LAYOUT_COL_MAJOR, LAYOUT_ROW_MAJOR, GPU_region_transpose},
+    {LAYOUT_ROW_MAJOR, LAYOUT_COL_MAJOR, 2, GPU_region_transpose},
+    {LAYOUT_COL_MAJOR, LAYOUT_ROW_MAJOR, 2, GPU_region_transpose},
+    {LAYOUT_ROW_MAJOR, LAYOUT_Z_CURVE, 2, GPU_region_relayout},
+    {LAYOUT_Z_CURVE, LAYOUT_ROW_MAJOR, 2, GPU_region_relayout},
+    {LAYOUT_COL_MAJOR, LAYOUT_Z_CURVE, 2, GPU_region_relayout},
+    {LAYOUT_Z_CURVE, LAYOUT_COL_MAJOR, 2, GPU_region_relayout},
+    {LAYOUT_ROW_MAJOR, LAYOUT_BIT_SLICED, 2, GPU_region_relayout},
+    {LAYOUT_BIT_SLICED, LAYOUT_ROW_MAJOR, 2, GPU_region_relayout},
+    {LAYOUT_COL_MAJOR, LAYOUT_BIT_SLICED, 2, GPU_region_relayout},
+    {LAYOUT_BIT_SLICED, LAYOUT_COL_MAJOR, 2, GPU_region_relayout},
+    {LAYOUT_ROW_MAJOR, MAKE_STATE(LAYOUT_ROW_MAJOR, FLAG_TRANSFORM), 0, NULL},
+    {MAKE_STATE(LAYOUT_ROW_MAJOR, FLAG_TRANSFORM), LAYOUT_ROW_MAJOR, 0, NULL},
+    {LAYOUT_ROW_MAJOR, MAKE_STATE(LAYOUT_COL_MAJOR, FLAG_TRANSFORM), 2,
+     GPU_region_transpose_narrow},
+    {MAKE_STATE(LAYOUT_COL_MAJOR, FLAG_TRANSFORM), LAYOUT_ROW_MAJOR, 2,
+     GPU_region_transpose_narrow},
 };
 
 #define TRANSITION_COUNT (sizeof(transition_table) / sizeof(transition_table[0]))
@@ -69,7 +89,7 @@ static const TransitionEntry transition_table[] = {
    Static helper prototypes for this translation unit.
    ========================================================================== */
 
-static TransitionKernel lookup_transition(GPUDataState from, GPUDataState to);
+static unsigned int state_node(uint32_t state);
 
 /* --- End Section 7: INTERNAL FUNCTION FORWARD DECLARATIONS --- */
 
@@ -78,13 +98,8 @@ static TransitionKernel lookup_transition(GPUDataState from, GPUDataState to);
    Low-level helpers for transition routing.
    ========================================================================== */
 
-static TransitionKernel lookup_transition(GPUDataState from, GPUDataState to) {
-    for (size_t i = 0; i < TRANSITION_COUNT; i++) {
-        if (transition_table[i].from == from && transition_table[i].to == to) {
-            return transition_table[i].func;
-        }
-    }
-    return NULL;
+static unsigned int state_node(uint32_t state) {
+    return (state & MASK_BASE_LAYOUT) * 2 + ((state & FLAG_TRANSFORM) != 0);
 }
 
 /* --- End Section 8: INTERNAL HELPER FUNCTION DEFINITIONS --- */
@@ -94,13 +109,57 @@ static TransitionKernel lookup_transition(GPUDataState from, GPUDataState to) {
    Transition router entry points.
    ========================================================================== */
 
-TransitionKernel get_transition_kernel(GPUDataState from, GPUDataState to) {
-    TransitionKernel func = lookup_transition(from, to);
-    if (!func) {
-        fprintf(stderr, "Fatal: No transition kernel defined for %d -> %d\n", from, to);
+void run_transition_path(uint32_t from, uint32_t to, uint64_t *bits,
+                         size_t rows, size_t columns, int device_id,
+                         void *params, size_t params_size) {
+    from &= MASK_WORD_LAYOUT;
+    to &= MASK_WORD_LAYOUT;
+    if (from == to)
+        return; // a change of bookkeeping flags only
+
+    /* Bellman-Ford from the current state; the graph is a handful of edges */
+    unsigned int cost[TRANSITION_NODES];
+    int via[TRANSITION_NODES]; // edge of the cheapest path into each node
+    for (unsigned int v = 0; v < TRANSITION_NODES; v++) {
+        cost[v] = UINT_MAX;
+        via[v] = -1;
+    }
+    cost[state_node(from)] = 0;
+    for (size_t round = 1; round < TRANSITION_NODES; round++) {
+        for (size_t e = 0; e < TRANSITION_COUNT; e++) {
+            const unsigned int u = state_node(transition_table[e].from);
+            const unsigned int v = state_node(transition_table[e].to);
+            if (cost[u] != UINT_MAX &&
+                cost[u] + transition_table[e].cost < cost[v]) {
+                cost[v] = cost[u] + transition_table[e].cost;
+                via[v] = (int)e;
+            }
+        }
+    }
+    if (cost[state_node(to)] == UINT_MAX) {
+        fprintf(stderr, "Fatal: No transition path defined for %#x -> %#x\n",
+                from, to);
         exit(EXIT_FAILURE);
     }
-    return func;
+
+    /* walk the path back from the target, then run it forwards */
+    int path[TRANSITION_NODES];
+    size_t steps = 0;
+    for (unsigned int v = state_node(to); v != state_node(from);
+         v = state_node(transition_table[path[steps - 1]].from))
+        path[steps++] = via[v];
+    const uint64_t start = gpu_stat_clock();
+    while (steps-- > 0) {
+        const TransitionEntry *edge = &transition_table[path[steps]];
+        const uint32_t base_from = edge->from & MASK_BASE_LAYOUT;
+        const uint32_t base_to = edge->to & MASK_BASE_LAYOUT;
+        if (base_from != base_to)
+            GPU_STAT_ADD(transitions[base_from][base_to], 1);
+        if (edge->func)
+            edge->func((GPUDataState)base_from, (GPUDataState)base_to, bits,
+                       rows, columns, device_id, params, params_size);
+    }
+    GPU_STAT_TIME(transition_ns, start);
 }
 
 /* --- End Section 9: PUBLIC API --- */
@@ -2,4 +2,10 @@
 
 #include "gpu_layout.h"
 
-TransitionKernel get_transition_kernel(GPUDataState from, GPUDataState to);
+/* Moves a rows x columns buffer from state from to state to along the
+   cheapest chain of transition kernels. States that differ only in
+   bookkeeping flags need no kernel; it is a fatal error for to to be
+   unreachable */
+void run_transition_path(uint32_t from, uint32_t to, uint64_t *bits,
+                         size_t rows, size_t columns, int device_id,
+                         void *params, size_t params_size);
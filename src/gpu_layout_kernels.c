@@ -4,9 +4,12 @@
    ========================================================================== */
 
 #include <omp.h>
+#include <stdio.h>
 #include <stdlib.h>
 #include <stddef.h>
+#include <string.h>
 #include "gpu_layout_kernels.h"
+#include "gpu_layout_registry.h"
 
 /* --- End Section 1: INCLUDES --- */
 
@@ -15,7 +18,28 @@
    File-local compile-time constants, build-time defaults, and feature flags.
    ========================================================================== */
 
-/* No compile-time configuration required here. */
+/* Words of scratch the in-place transpose asks for first: half the buffer,
+   halved on every failed allocation down to one row or column */
+#ifndef GPU_TRANSPOSE_SCRATCH_DIVISOR
+#define GPU_TRANSPOSE_SCRATCH_DIVISOR 2
+#endif
+
+/* Tiles of the out-of-place transpose: GPU_TRANSPOSE_TILE_DIM square words
+   per team, GPU_TRANSPOSE_BLOCK_ROWS rows of it per pass of the team's
+   threads (as GPU_TILE_DIM and GPU_BLOCK_ROWS of the native benchmark) */
+#ifndef GPU_TRANSPOSE_TILE_DIM
+#define GPU_TRANSPOSE_TILE_DIM 32
+#endif
+#ifndef GPU_TRANSPOSE_BLOCK_ROWS
+#define GPU_TRANSPOSE_BLOCK_ROWS 8
+#endif
+
+/* Cache blocks of the host transpose: CPU_TRANSPOSE_TILE square words per
+   thread, moved as CPU_TRANSPOSE_BLOCK square register blocks */
+#ifndef CPU_TRANSPOSE_TILE
+#define CPU_TRANSPOSE_TILE 64
+#endif
+#define CPU_TRANSPOSE_BLOCK 8
 
 /* --- End Section 2: COMPILE-TIME CONFIGURATION --- */
 
@@ -32,7 +56,21 @@
    SECTION 4: PRIVATE IMPLEMENTATION MACROS
    Reserved for file-local operational macros.
    ========================================================================== */
-#define GPU_KERNEL_ALLOC(dev, count) omp_target_alloc((count) * sizeof(uint64_t), (dev))
+/* Device scratch of count words, counted in the layout scratch of the
+   device (registry_scratch) while it is held */
+#define GPU_KERNEL_ALLOC(dev, count) kernel_scratch_alloc((dev), (count))
+#define GPU_KERNEL_FREE(dev, ptr, count)                                       \
+    do {                                                                       \
+        omp_target_free((ptr), (dev));                                         \
+        registry_scratch((dev), -(ptrdiff_t)((count) * sizeof(uint64_t)));     \
+    } while (0)
+
+static inline void *kernel_scratch_alloc(int device_id, size_t count) {
+    void *scratch = omp_target_alloc(count * sizeof(uint64_t), device_id);
+    if (scratch)
+        registry_scratch(device_id, (ptrdiff_t)(count * sizeof(uint64_t)));
+    return scratch;
+}
 /* --- End Section 4: PRIVATE IMPLEMENTATION MACROS --- */
 
 /* ==========================================================================
@@ -58,8 +96,19 @@
    Static helper prototypes for this translation unit.
    ========================================================================== */
 
+static size_t gcd_size(size_t a, size_t b);
+static void _GPU_transpose_inplace(uint64_t *bits, size_t m, size_t n,
+                                   int device_id);
+static void _GPU_transpose_tiled(const uint64_t *bits, uint64_t *bits_T,
+                                 size_t rows, size_t columns, int device_id);
 static void _GPU_transpose_kernel(uint64_t *bits, size_t rows,
                                   size_t columns, int device_id);
+static void _cpu_transpose_blocked(const uint64_t *bits, uint64_t *bits_T,
+                                   size_t rows, size_t columns);
+#pragma omp declare target
+static inline size_t layout_word_index(GPUDataState layout, size_t i,
+                                       size_t j, size_t rows, size_t columns);
+#pragma omp end declare target
 
 /* --- End Section 7: INTERNAL FUNCTION FORWARD DECLARATIONS --- */
 
@@ -67,20 +116,166 @@ static void _GPU_transpose_kernel(uint64_t *bits, size_t rows,
    SECTION 8: INTERNAL HELPER FUNCTION DEFINITIONS
    Low-level helpers and device kernels.
    ========================================================================== */
+static size_t gcd_size(size_t a, size_t b) {
+    while (b != 0) {
+        size_t r = a % b;
+        a = b;
+        b = r;
+    }
+    return a;
+}
+
+/* In-place transpose of a row-major m x n buffer into its n x m transpose,
+   after Catanzaro, Keller and Garland, "A Decomposition for In-place Matrix
+   Transposition" (PPoPP 2014): a rotation of every column, a shuffle of
+   every row, and a shuffle of every column. With c = gcd(m, n) and
+   b = n / c, the element (i, j) ends at word j * m + i when
+     1. column j is rotated up by j / b (a no-op for c = 1),
+     2. word j of row p moves to word (j * m + (p + j / b) % m) % n,
+     3. row I of column J takes row ((l % m) - (l / m) / b) % m, l = I * n + J.
+   Each pass stages a batch of whole columns (or rows) in a device scratch
+   buffer, so the peak extra memory is whatever scratch could be had, down to
+   a single column of m words; it is a fatal error to have less. */
+static void _GPU_transpose_inplace(uint64_t *bits, size_t m, size_t n,
+                                   int device_id) {
+    const size_t c = gcd_size(m, n), b = n / c;
+    const size_t least = m > n ? m : n;
+    size_t words = m * n / GPU_TRANSPOSE_SCRATCH_DIVISOR;
+    if (words < least)
+        words = least;
+    uint64_t *scratch = NULL;
+    while ((scratch = (uint64_t *)GPU_KERNEL_ALLOC(device_id, words)) == NULL &&
+           words > least)
+        words = words / 2 > least ? words / 2 : least;
+    if (!scratch) {
+        fprintf(stderr, "Fatal: no device memory to transpose %zu x %zu words\n",
+                m, n);
+        exit(EXIT_FAILURE);
+    }
+    const size_t col_batch = words / m < n ? words / m : n;
+    const size_t row_batch = words / n < m ? words / n : m;
+
+    /* 1. column rotation */
+    for (size_t j0 = 0; c > 1 && j0 < n; j0 += col_batch) {
+        const size_t nb = n - j0 < col_batch ? n - j0 : col_batch;
+#pragma omp target teams distribute parallel for collapse(2) device(device_id) \
+    is_device_ptr(scratch)
+        for (size_t jj = 0; jj < nb; jj++) {
+            for (size_t p = 0; p < m; p++) {
+                const size_t j = j0 + jj;
+                scratch[jj * m + p] = bits[((p + j / b) % m) * n + j];
+            }
+        }
+#pragma omp target teams distribute parallel for collapse(2) device(device_id) \
+    is_device_ptr(scratch)
+        for (size_t p = 0; p < m; p++) {
+            for (size_t jj = 0; jj < nb; jj++) {
+                bits[p * n + j0 + jj] = scratch[jj * m + p];
+            }
+        }
+    }
+
+    /* 2. row shuffle */
+    for (size_t p0 = 0; p0 < m; p0 += row_batch) {
+        const size_t nb = m - p0 < row_batch ? m - p0 : row_batch;
+#pragma omp target teams distribute parallel for collapse(2) device(device_id) \
+    is_device_ptr(scratch)
+        for (size_t pp = 0; pp < nb; pp++) {
+            for (size_t j = 0; j < n; j++) {
+                const size_t p = p0 + pp;
+                scratch[pp * n + (j * m + (p + j / b) % m) % n] = bits[p * n + j];
+            }
+        }
+#pragma omp target teams distribute parallel for device(device_id) \
+    is_device_ptr(scratch)
+        for (size_t idx = 0; idx < nb * n; idx++) {
+            bits[p0 * n + idx] = scratch[idx];
+        }
+    }
+
+    /* 3. column shuffle */
+    for (size_t j0 = 0; j0 < n; j0 += col_batch) {
+        const size_t nb = n - j0 < col_batch ? n - j0 : col_batch;
+#pragma omp target teams distribute parallel for collapse(2) device(device_id) \
+    is_device_ptr(scratch)
+        for (size_t jj = 0; jj < nb; jj++) {
+            for (size_t i = 0; i < m; i++) {
+                const size_t l = i * n + j0 + jj;
+                const size_t p = (l % m + m - (l / m / b) % m) % m;
+                scratch[jj * m + i] = bits[p * n + j0 + jj];
+            }
+        }
+#pragma omp target teams distribute parallel for collapse(2) device(device_id) \
+    is_device_ptr(scratch)
+        for (size_t i = 0; i < m; i++) {
+            for (size_t jj = 0; jj < nb; jj++) {
+                bits[i * n + j0 + jj] = scratch[jj * m + i];
+            }
+        }
+    }
+
+    GPU_KERNEL_FREE(device_id, scratch, words);
+}
+
+/* Out-of-place transpose of a row-major rows x columns buffer into bits_T,
+   after transpose_kernel in benchmark/native_device_code.cpp. Each team
+   stages one tile in team memory, padded by a word so that the column reads
+   spread over the banks: it loads rows of the tile and stores columns of
+   it, so consecutive threads touch consecutive words on both sides. A team
+   granted fewer threads than a tile pass covers the pass in rounds. */
+static void _GPU_transpose_tiled(const uint64_t *bits, uint64_t *bits_T,
+                                 size_t rows, size_t columns, int device_id) {
+    const size_t row_tiles = (rows + GPU_TRANSPOSE_TILE_DIM - 1) /
+                             GPU_TRANSPOSE_TILE_DIM;
+    const size_t col_tiles = (columns + GPU_TRANSPOSE_TILE_DIM - 1) /
+                             GPU_TRANSPOSE_TILE_DIM;
+    const unsigned int pass = GPU_TRANSPOSE_TILE_DIM * GPU_TRANSPOSE_BLOCK_ROWS;
+#pragma omp target teams distribute collapse(2) device(device_id) \
+    thread_limit(GPU_TRANSPOSE_TILE_DIM * GPU_TRANSPOSE_BLOCK_ROWS) \
+    is_device_ptr(bits_T)
+    for (size_t bi = 0; bi < row_tiles; bi++) {
+        for (size_t bj = 0; bj < col_tiles; bj++) {
+            uint64_t tile[GPU_TRANSPOSE_TILE_DIM][GPU_TRANSPOSE_TILE_DIM + 1];
+            const size_t i0 = bi * GPU_TRANSPOSE_TILE_DIM;
+            const size_t j0 = bj * GPU_TRANSPOSE_TILE_DIM;
+#pragma omp parallel num_threads(GPU_TRANSPOSE_TILE_DIM * GPU_TRANSPOSE_BLOCK_ROWS)
+            {
+                const unsigned int tid = omp_get_thread_num();
+                const unsigned int bdim = omp_get_num_threads();
+                for (unsigned int t = tid; t < pass; t += bdim) {
+                    const unsigned int tx = t % GPU_TRANSPOSE_TILE_DIM;
+                    for (unsigned int k = t / GPU_TRANSPOSE_TILE_DIM;
+                         k < GPU_TRANSPOSE_TILE_DIM; k += GPU_TRANSPOSE_BLOCK_ROWS)
+                        if (i0 + k < rows && j0 + tx < columns)
+                            tile[k][tx] = bits[(i0 + k) * columns + j0 + tx];
+                }
+#pragma omp barrier
+                for (unsigned int t = tid; t < pass; t += bdim) {
+                    const unsigned int tx = t % GPU_TRANSPOSE_TILE_DIM;
+                    for (unsigned int k = t / GPU_TRANSPOSE_TILE_DIM;
+                         k < GPU_TRANSPOSE_TILE_DIM; k += GPU_TRANSPOSE_BLOCK_ROWS)
+                        if (j0 + k < columns && i0 + tx < rows)
+                            bits_T[(j0 + k) * rows + i0 + tx] = tile[tx][k];
+                }
+            }
+        }
+    }
+}
+
+/* Transposes a row-major rows x columns buffer, out of place through a full
+   copy when the device can hold one, else in place */
 static void _GPU_transpose_kernel(uint64_t *bits, size_t rows,
                                   size_t columns, int device_id) {
     size_t t_elements = rows * columns;
+    if (rows < 2 || columns < 2)
+        return; // a vector is its own transpose
     uint64_t *bits_T = (uint64_t *)GPU_KERNEL_ALLOC(device_id, t_elements);
     if (!bits_T) {
+        _GPU_transpose_inplace(bits, rows, columns, device_id);
         return;
     }
 
-#pragma omp target teams distribute parallel for collapse(2) device(device_id)
-    for (size_t i = 0; i < rows; i++) {
-        for (size_t j = 0; j < columns; j++) {
-            bits_T[j * rows + i] = bits[i * columns + j];
-        }
-    }
+    _GPU_transpose_tiled(bits, bits_T, rows, columns, device_id);
 
 #pragma omp target teams distribute parallel for device(device_id) \
     is_device_ptr(bits_T)
@@ -88,8 +283,65 @@ static void _GPU_transpose_kernel(uint64_t *bits, size_t rows,
         bits[idx] = bits_T[idx];
     }
 
-    omp_target_free(bits_T, device_id);
+    GPU_KERNEL_FREE(device_id, bits_T, t_elements);
+}
+
+/* Host transpose of a row-major rows x columns buffer into bits_T. Each
+   thread takes CPU_TRANSPOSE_TILE square tiles, which fit in L1/L2 on both
+   sides, and moves every full 8 x 8 word block of a tile through a local
+   block: its rows are loaded and its columns stored as SIMD vectors, so
+   the compiler keeps the block in registers. Edge blocks go word by word */
+static void _cpu_transpose_blocked(const uint64_t *bits, uint64_t *bits_T,
+                                   size_t rows, size_t columns) {
+#pragma omp parallel for collapse(2) schedule(static)
+    for (size_t i0 = 0; i0 < rows; i0 += CPU_TRANSPOSE_TILE) {
+        for (size_t j0 = 0; j0 < columns; j0 += CPU_TRANSPOSE_TILE) {
+            const size_t i1 = rows - i0 < CPU_TRANSPOSE_TILE
+                                  ? rows : i0 + CPU_TRANSPOSE_TILE;
+            const size_t j1 = columns - j0 < CPU_TRANSPOSE_TILE
+                                  ? columns : j0 + CPU_TRANSPOSE_TILE;
+            for (size_t i = i0; i < i1; i += CPU_TRANSPOSE_BLOCK) {
+                for (size_t j = j0; j < j1; j += CPU_TRANSPOSE_BLOCK) {
+                    if (i + CPU_TRANSPOSE_BLOCK > i1 ||
+                        j + CPU_TRANSPOSE_BLOCK > j1) {
+                        for (size_t r = i; r < i1 && r < i + CPU_TRANSPOSE_BLOCK; r++)
+                            for (size_t c = j; c < j1 && c < j + CPU_TRANSPOSE_BLOCK; c++)
+                                bits_T[c * rows + r] = bits[r * columns + c];
+                        continue;
+                    }
+                    uint64_t block[CPU_TRANSPOSE_BLOCK][CPU_TRANSPOSE_BLOCK];
+                    for (size_t r = 0; r < CPU_TRANSPOSE_BLOCK; r++) {
+#pragma omp simd
+                        for (size_t c = 0; c < CPU_TRANSPOSE_BLOCK; c++)
+                            block[c][r] = bits[(i + r) * columns + j + c];
+                    }
+                    for (size_t c = 0; c < CPU_TRANSPOSE_BLOCK; c++) {
+#pragma omp simd
+                        for (size_t r = 0; r < CPU_TRANSPOSE_BLOCK; r++)
+                            bits_T[(j + c) * rows + i + r] = block[c][r];
+                    }
+                }
+            }
+        }
+    }
+}
+
+/* Position of word j of row i of a rows x columns buffer in layout */
+#pragma omp declare target
+static inline size_t layout_word_index(GPUDataState layout, size_t i,
+                                       size_t j, size_t rows, size_t columns) {
+    switch (layout) {
+    case LAYOUT_COL_MAJOR:
+        return j * rows + i;
+    case LAYOUT_Z_CURVE:
+        return zcurve_word_index(i, j, rows, columns);
+    case LAYOUT_BIT_SLICED:
+        return sliced_word_index(i, j, rows, columns);
+    default:
+        return i * columns + j;
+    }
 }
+#pragma omp end declare target
 
 /* --- End Section 8: INTERNAL HELPER FUNCTION DEFINITIONS --- */
 
@@ -101,23 +353,118 @@ static void _GPU_transpose_kernel(uint64_t *bits, size_t rows,
 void GPU_region_transpose(GPUDataState from, GPUDataState to, uint64_t *bits,
                           size_t rows, size_t columns, int device_id,
                           void *params, size_t params_size) {
-    (void)from;
     (void)to;
     (void)params;
     (void)params_size;
 
-    _GPU_transpose_kernel(bits, rows, columns, device_id);
+    /* rows x columns is the row-major geometry, so a column-major buffer
+       holds columns rows of rows words */
+    if (from == LAYOUT_COL_MAJOR)
+        _GPU_transpose_kernel(bits, columns, rows, device_id);
+    else
+        _GPU_transpose_kernel(bits, rows, columns, device_id);
+}
+
+void GPU_region_relayout(GPUDataState from, GPUDataState to, uint64_t *bits,
+                         size_t rows, size_t columns, int device_id,
+                         void *params, size_t params_size) {
+    (void)params;
+    (void)params_size;
+
+    const size_t t_elements = rows * columns;
+    uint64_t *scratch = (uint64_t *)GPU_KERNEL_ALLOC(device_id, t_elements);
+    if (!scratch) {
+        fprintf(stderr, "Fatal: no device memory to lay out %zu x %zu words\n",
+                rows, columns);
+        exit(EXIT_FAILURE);
+    }
+    /* consecutive threads take consecutive rows of one word, which are
+       consecutive in every layout but the row-major one */
+#pragma omp target teams distribute parallel for collapse(2) device(device_id) \
+    is_device_ptr(scratch)
+    for (size_t j = 0; j < columns; j++) {
+        for (size_t i = 0; i < rows; i++) {
+            scratch[layout_word_index(to, i, j, rows, columns)] =
+                bits[layout_word_index(from, i, j, rows, columns)];
+        }
+    }
+
+#pragma omp target teams distribute parallel for device(device_id) \
+    is_device_ptr(scratch)
+    for (size_t idx = 0; idx < t_elements; idx++) {
+        bits[idx] = scratch[idx];
+    }
+
+    GPU_KERNEL_FREE(device_id, scratch, t_elements);
+}
+
+void GPU_region_transpose_narrow(GPUDataState from, GPUDataState to,
+                                 uint64_t *bits, size_t rows, size_t columns,
+                                 int device_id, void *params,
+                                 size_t params_size) {
+    (void)to;
+    (void)params;
+    (void)params_size;
+
+    const size_t t_elements = rows * columns;
+    const size_t words = 2 * columns; // 32-bit words per row
+    uint64_t *scratch = (uint64_t *)GPU_KERNEL_ALLOC(device_id, t_elements);
+    if (!scratch) {
+        fprintf(stderr, "Fatal: no device memory to narrow %zu x %zu words\n",
+                rows, columns);
+        exit(EXIT_FAILURE);
+    }
+    /* row-major 64-bit words are row-major 32-bit words, so narrowing is a
+       transpose of the rows x words matrix of halves */
+    const int narrowing = from == LAYOUT_ROW_MAJOR;
+#pragma omp target teams distribute parallel for collapse(2) device(device_id) \
+    is_device_ptr(scratch)
+    for (size_t j = 0; j < words; j++) {
+        for (size_t i = 0; i < rows; i++) {
+            if (narrowing)
+                ((uint32_t *)scratch)[j * rows + i] =
+                    ((const uint32_t *)bits)[i * words + j];
+            else
+                ((uint32_t *)scratch)[i * words + j] =
+                    ((const uint32_t *)bits)[j * rows + i];
+        }
+    }
+
+#pragma omp target teams distribute parallel for device(device_id) \
+    is_device_ptr(scratch)
+    for (size_t idx = 0; idx < t_elements; idx++) {
+        bits[idx] = scratch[idx];
+    }
+
+    GPU_KERNEL_FREE(device_id, scratch, t_elements);
 }
 
 void cpu_universal_transpose(GPUDataState from, GPUDataState to,
                              uint64_t *bits, size_t rows, size_t columns,
                              int device_id, void *params, size_t params_size) {
-    (void)from;
     (void)to;
+    (void)device_id;
     (void)params;
     (void)params_size;
 
-    _GPU_transpose_kernel(bits, rows, columns, device_id);
+    /* a column-major buffer holds columns rows of rows words */
+    if (from == LAYOUT_COL_MAJOR) {
+        const size_t swap = rows;
+        rows = columns;
+        columns = swap;
+    }
+    if (rows < 2 || columns < 2)
+        return; // a vector is its own transpose
+    const size_t t_elements = rows * columns;
+    uint64_t *bits_T = (uint64_t *)malloc(t_elements * sizeof(uint64_t));
+    if (!bits_T) {
+        fprintf(stderr, "Fatal: no host memory to transpose %zu x %zu words\n",
+                rows, columns);
+        exit(EXIT_FAILURE);
+    }
+    _cpu_transpose_blocked(bits, bits_T, rows, columns);
+    memcpy(bits, bits_T, t_elements * sizeof(uint64_t));
+    free(bits_T);
 }
 
 /* --- End Section 9: PUBLIC API --- */
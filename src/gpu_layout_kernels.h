@@ -7,6 +7,21 @@ void GPU_region_transpose(GPUDataState from, GPUDataState to, uint64_t *bits,
                           size_t rows, size_t columns, int device_id,
                           void *params, size_t params_size);
 
+/* Between any two of the row-major, column-major, Z-curve and bit-sliced
+   layouts (see gpu_layout.h), out of place */
+void GPU_region_relayout(GPUDataState from, GPUDataState to, uint64_t *bits,
+                         size_t rows, size_t columns, int device_id,
+                         void *params, size_t params_size);
+
+/* Row-major <-> column-major narrowed words (see FLAG_TRANSFORM) in one
+   pass, out of place */
+void GPU_region_transpose_narrow(GPUDataState from, GPUDataState to,
+                                 uint64_t *bits, size_t rows, size_t columns,
+                                 int device_id, void *params,
+                                 size_t params_size);
+
+/* Row-major <-> column-major on a host buffer (device_id is ignored), so a
+   container can be laid out before it is uploaded or written out */
 void cpu_universal_transpose(GPUDataState from, GPUDataState to, uint64_t *bits,
                              size_t rows, size_t columns, int device_id,
                              void *params, size_t params_size);
@@ -3,6 +3,8 @@
    Standard library headers first, then project headers.
    ========================================================================== */
 
+#include <omp.h>
+#include <stddef.h>
 #include <stdlib.h>
 #include <stdio.h>
 #include "gpu_layout_registry.h"
@@ -14,7 +16,16 @@
    File-local compile-time constants, build-time defaults, and feature flags.
    ========================================================================== */
 
-/* No compile-time configuration required for this module. */
+/* Number of independently locked hash shards (a power of two). Buffers
+   that land in different shards never contend for a lock */
+#ifndef REGISTRY_SHARDS
+#define REGISTRY_SHARDS 256
+#endif
+
+/* Devices that can be given a memory budget; higher ids have none */
+#ifndef REGISTRY_MAX_DEVICES
+#define REGISTRY_MAX_DEVICES 64
+#endif
 
 /* --- End Section 2: COMPILE-TIME CONFIGURATION --- */
 
@@ -23,7 +34,19 @@
    Private macros used by helper functions and low-level operations.
    ========================================================================== */
 
-/* No additional macros required at this time. */
+/* Spin lock of one shard; held only for a short chain walk */
+#define SHARD_LOCK(shard) \
+    while (atomic_exchange_explicit(&(shard)->lock, 1, memory_order_acquire)) \
+        ;
+#define SHARD_UNLOCK(shard) \
+    atomic_store_explicit(&(shard)->lock, 0, memory_order_release);
+
+/* A node no call is using: eviction may unmap its buffer; the shard lock
+   is held */
+#define NODE_IDLE(node) \
+    (atomic_load_explicit(&(node)->pins, memory_order_acquire) == 0 && \
+     atomic_load_explicit(&(node)->active_users, memory_order_acquire) == 0 && \
+     atomic_load_explicit(&(node)->transition_lock, memory_order_acquire) == 0)
 
 /* --- End Section 3: INFRASTRUCTURAL MACROS --- */
 
@@ -41,7 +64,12 @@
    Types local to the registry implementation.
    ========================================================================== */
 
-/* No extra internal types are needed beyond the public registry node type. */
+/* One bucket of the registry: the nodes whose (host_ptr, device_id) hash
+   to it, most recently created first */
+typedef struct {
+    _Atomic int lock;
+    GPUAllocationState *head;
+} RegistryShard;
 
 /* --- End Section 5: INTERNAL DATA STRUCTURES AND ENUMS --- */
 
@@ -50,8 +78,25 @@
    File-scope constants and persistent state.
    ========================================================================== */
 
-static atomic_flag g_registry_lock = ATOMIC_FLAG_INIT;
-static GPUAllocationState *g_registry_head = NULL;
+static RegistryShard g_registry[REGISTRY_SHARDS];
+
+/* Memory budget of every device in bytes, 0 for none */
+static _Atomic size_t g_budget[REGISTRY_MAX_DEVICES];
+
+/* Ticks on every lookup; a node's last_use orders the eviction */
+static _Atomic uint64_t g_clock;
+
+/* Serialises admissions, so that two of them do not both count on the room
+   one eviction made */
+static _Atomic int g_admit_lock;
+
+/* Memory accounting of every device: mapped bytes as of the last walk, the
+   layout scratch now, and the high-water marks of both and of their sum */
+static _Atomic size_t g_mapped[REGISTRY_MAX_DEVICES];
+static _Atomic size_t g_mapped_peak[REGISTRY_MAX_DEVICES];
+static _Atomic ptrdiff_t g_scratch[REGISTRY_MAX_DEVICES];
+static _Atomic size_t g_scratch_peak[REGISTRY_MAX_DEVICES];
+static _Atomic size_t g_peak[REGISTRY_MAX_DEVICES];
 
 /* --- End Section 6: STATIC DATA --- */
 
@@ -60,7 +105,16 @@ static GPUAllocationState *g_registry_head = NULL;
    Static helper prototypes for this translation unit.
    ========================================================================== */
 
+static RegistryShard *registry_shard(const void *host_ptr, int device_id);
+static GPUAllocationState *find_node(RegistryShard *shard, const void *host_ptr,
+                                     int device_id);
+static GPUAllocationState *find_or_create_node(RegistryShard *shard,
+                                               const void *host_ptr,
+                                               int device_id);
 static GPUAllocationState *get_or_create_node(const void *host_ptr, int device_id);
+static int evict_lru(int device_id, const void *keep);
+static void raise_peak(_Atomic size_t *peak, size_t now);
+static size_t mapped_walk(int device_id);
 
 /* --- End Section 7: INTERNAL FUNCTION FORWARD DECLARATIONS --- */
 
@@ -69,49 +123,152 @@ static GPUAllocationState *get_or_create_node(const void *host_ptr, int device_i
    Low-level helpers and registry internals.
    ========================================================================== */
 
-static GPUAllocationState *get_or_create_node(const void *host_ptr, int device_id) {
-    while (atomic_flag_test_and_set_explicit(&g_registry_lock, memory_order_acquire))
-        ;
-
-    GPUAllocationState *entry = NULL;
-    GPUAllocationState *curr = g_registry_head;
-    GPUAllocationState *first_empty = NULL;
+/* Fibonacci hash of the pointer (its low bits are alignment) and device */
+static RegistryShard *registry_shard(const void *host_ptr, int device_id) {
+    uint64_t key = ((uint64_t)(uintptr_t)host_ptr >> 4) ^
+                   ((uint64_t)(unsigned int)device_id << 48);
+    key *= UINT64_C(0x9E3779B97F4A7C15);
+    return &g_registry[key >> 32 & (REGISTRY_SHARDS - 1)];
+}
 
-    while (curr != NULL) {
-        if (curr->host_ptr == host_ptr && curr->device_id == device_id) {
-            entry = curr;
-            break;
-        }
-        if (curr->host_ptr == NULL && first_empty == NULL) {
-            first_empty = curr;
-        }
+/* Node of (host_ptr, device_id) in shard, or NULL; the shard lock is held */
+static GPUAllocationState *find_node(RegistryShard *shard, const void *host_ptr,
+                                     int device_id) {
+    GPUAllocationState *curr = shard->head;
+    while (curr != NULL &&
+           (curr->host_ptr != host_ptr || curr->device_id != device_id))
         curr = curr->next;
-    }
+    return curr;
+}
 
+/* Node of (host_ptr, device_id), created row-major if there is none, and
+   marked as just used; the shard lock is held */
+static GPUAllocationState *find_or_create_node(RegistryShard *shard,
+                                               const void *host_ptr,
+                                               int device_id) {
+    GPUAllocationState *entry = find_node(shard, host_ptr, device_id);
     if (!entry) {
-        GPUAllocationState *target = first_empty
-                                          ? first_empty
-                                          : (GPUAllocationState *)malloc(
-                                                sizeof(GPUAllocationState));
-        if (!first_empty && target) {
-            target->next = g_registry_head;
-            g_registry_head = target;
-        }
-        if (target) {
-            target->host_ptr = host_ptr;
-            target->device_id = device_id;
-            atomic_init(&target->state_word,
+        entry = (GPUAllocationState *)malloc(sizeof(GPUAllocationState));
+        if (entry) {
+            entry->host_ptr = host_ptr;
+            entry->device_id = device_id;
+            atomic_init(&entry->state_word,
                         MAKE_STATE(LAYOUT_ROW_MAJOR, FLAG_NONE));
-            atomic_init(&target->transition_lock, 0);
-            atomic_init(&target->active_users, 0);
-            entry = target;
+            atomic_init(&entry->transition_lock, 0);
+            atomic_init(&entry->active_users, 0);
+            atomic_init(&entry->pins, 0);
+            atomic_init(&entry->last_use, 0);
+            entry->bytes = 0;
+            entry->mapped = 0;
+            entry->next = shard->head;
+            shard->head = entry;
         }
     }
+    if (entry)
+        atomic_store_explicit(&entry->last_use,
+                              atomic_fetch_add_explicit(&g_clock, 1,
+                                                        memory_order_relaxed),
+                              memory_order_relaxed);
+    return entry;
+}
 
-    atomic_flag_clear_explicit(&g_registry_lock, memory_order_release);
+static GPUAllocationState *get_or_create_node(const void *host_ptr, int device_id) {
+    RegistryShard *shard = registry_shard(host_ptr, device_id);
+    SHARD_LOCK(shard)
+    GPUAllocationState *entry = find_or_create_node(shard, host_ptr, device_id);
+    SHARD_UNLOCK(shard)
     return entry;
 }
 
+/* Drops the least recently used idle budgeted node of device_id other than
+   keep, unmapping its buffer (whatever layout the device copy was left in)
+   if it is still mapped. Returns 0 if no node could go */
+static int evict_lru(int device_id, const void *keep) {
+    const void *victim = NULL;
+    uint64_t oldest = UINT64_MAX;
+    for (size_t s = 0; s < REGISTRY_SHARDS; s++) {
+        RegistryShard *shard = &g_registry[s];
+        SHARD_LOCK(shard)
+        for (GPUAllocationState *node = shard->head; node; node = node->next) {
+            const uint64_t used =
+                atomic_load_explicit(&node->last_use, memory_order_relaxed);
+            if (node->device_id == device_id && node->bytes > 0 &&
+                node->host_ptr != keep && used < oldest && NODE_IDLE(node)) {
+                oldest = used;
+                victim = node->host_ptr;
+            }
+        }
+        SHARD_UNLOCK(shard)
+    }
+    if (victim == NULL)
+        return 0;
+
+    /* the victim may have been picked up since the scan: look again */
+    RegistryShard *shard = registry_shard(victim, device_id);
+    SHARD_LOCK(shard)
+    GPUAllocationState **link = &shard->head;
+    while (*link != NULL &&
+           ((*link)->host_ptr != victim || (*link)->device_id != device_id))
+        link = &(*link)->next;
+    GPUAllocationState *node = *link;
+    if (node && NODE_IDLE(node)) {
+        if (omp_target_is_present(victim, device_id)) {
+            char *bytes = (char *)victim;
+            const size_t span = node->bytes;
+#pragma omp target exit data map(delete : bytes[0:span]) device(device_id)
+            GPU_STAT_ADD(evictions, 1);
+            GPU_STAT_ADD(evicted_bytes, span);
+        }
+        *link = node->next;
+        free(node);
+    }
+    SHARD_UNLOCK(shard)
+    return 1;
+}
+
+static void raise_peak(_Atomic size_t *peak, size_t now) {
+    size_t seen = atomic_load_explicit(peak, memory_order_relaxed);
+    while (now > seen &&
+           !atomic_compare_exchange_weak_explicit(peak, &seen, now,
+                                                  memory_order_relaxed,
+                                                  memory_order_relaxed))
+        ;
+}
+
+/* Bytes mapped on device_id by enter data and still present, recorded in
+   g_mapped and its marks. Records kept only for the count, of buffers no
+   longer mapped and not budgeted, are dropped on the way: a buffer mapped
+   again starts row-major in any case */
+static size_t mapped_walk(int device_id) {
+    size_t total = 0;
+    for (size_t s = 0; s < REGISTRY_SHARDS; s++) {
+        RegistryShard *shard = &g_registry[s];
+        SHARD_LOCK(shard)
+        GPUAllocationState **link = &shard->head;
+        while (*link != NULL) {
+            GPUAllocationState *node = *link;
+            if (node->device_id != device_id || node->mapped == 0) {
+                link = &node->next;
+            } else if (omp_target_is_present(node->host_ptr, device_id)) {
+                total += node->mapped;
+                link = &node->next;
+            } else if (node->bytes == 0 && NODE_IDLE(node)) {
+                *link = node->next;
+                free(node);
+            } else {
+                link = &node->next;
+            }
+        }
+        SHARD_UNLOCK(shard)
+    }
+    atomic_store_explicit(&g_mapped[device_id], total, memory_order_relaxed);
+    raise_peak(&g_mapped_peak[device_id], total);
+    const ptrdiff_t scratch =
+        atomic_load_explicit(&g_scratch[device_id], memory_order_relaxed);
+    raise_peak(&g_peak[device_id], total + (scratch > 0 ? (size_t)scratch : 0));
+    return total;
+}
+
 /* --- End Section 8: INTERNAL HELPER FUNCTION DEFINITIONS --- */
 
 /* ==========================================================================
@@ -123,11 +280,25 @@ int registry_checkout_fast_path(uint64_t *bits, int device_id, uint32_t target_s
     GPUAllocationState *node = get_or_create_node(bits, device_id);
     if (atomic_load_explicit(&node->state_word, memory_order_acquire) == target_state) {
         atomic_fetch_add_explicit(&node->active_users, 1, memory_order_release);
+        GPU_STAT_ADD(layout_hits, 1);
         return 1;
     }
+    GPU_STAT_ADD(layout_misses, 1);
     return 0;
 }
 
+uint32_t registry_checkout_layout(uint64_t *bits, int device_id) {
+    GPUAllocationState *node = get_or_create_node(bits, device_id);
+    while (1) {
+        if (atomic_load_explicit(&node->transition_lock, memory_order_acquire) == 1)
+            continue;
+        atomic_fetch_add_explicit(&node->active_users, 1, memory_order_acq_rel);
+        if (atomic_load_explicit(&node->transition_lock, memory_order_acquire) == 0)
+            return atomic_load_explicit(&node->state_word, memory_order_acquire);
+        atomic_fetch_sub_explicit(&node->active_users, 1, memory_order_release);
+    }
+}
+
 GPUAllocationState *registry_claim_transition(uint64_t *bits, int device_id) {
     GPUAllocationState *node = get_or_create_node(bits, device_id);
     while (1) {
@@ -152,23 +323,164 @@ void registry_commit_transition(GPUAllocationState *node, uint32_t final_target)
 }
 
 void release_gpu_layout(uint64_t *bits, int device_id) {
-    while (atomic_flag_test_and_set_explicit(&g_registry_lock, memory_order_acquire))
-        ;
+    RegistryShard *shard = registry_shard(bits, device_id);
+    SHARD_LOCK(shard)
+    GPUAllocationState *target = find_node(shard, bits, device_id);
+    SHARD_UNLOCK(shard)
+    if (target) {
+        atomic_fetch_sub_explicit(&target->active_users, 1, memory_order_release);
+    }
+}
+
+int registry_forget(const void *host_ptr, int device_id) {
+    RegistryShard *shard = registry_shard(host_ptr, device_id);
+    int removed = 0;
+    SHARD_LOCK(shard)
+    GPUAllocationState **link = &shard->head;
+    while (*link != NULL &&
+           ((*link)->host_ptr != host_ptr || (*link)->device_id != device_id))
+        link = &(*link)->next;
+    GPUAllocationState *node = *link;
+    if (node &&
+        atomic_load_explicit(&node->active_users, memory_order_acquire) == 0 &&
+        atomic_load_explicit(&node->transition_lock, memory_order_acquire) == 0 &&
+        atomic_load_explicit(&node->pins, memory_order_acquire) == 0) {
+        *link = node->next;
+        free(node);
+        removed = 1;
+    }
+    SHARD_UNLOCK(shard)
+    return removed;
+}
 
-    GPUAllocationState *curr = g_registry_head;
-    GPUAllocationState *target = NULL;
-    while (curr != NULL) {
-        if (curr->host_ptr == bits && curr->device_id == device_id) {
-            target = curr;
-            break;
+void registry_pin(const void *host_ptr, int device_id) {
+    if (registry_budget(device_id) == 0)
+        return; // nothing is evicted without a budget
+    RegistryShard *shard = registry_shard(host_ptr, device_id);
+    SHARD_LOCK(shard)
+    GPUAllocationState *node = find_or_create_node(shard, host_ptr, device_id);
+    if (node)
+        atomic_fetch_add_explicit(&node->pins, 1, memory_order_acq_rel);
+    SHARD_UNLOCK(shard)
+}
+
+void registry_unpin(const void *host_ptr, int device_id) {
+    RegistryShard *shard = registry_shard(host_ptr, device_id);
+    SHARD_LOCK(shard)
+    GPUAllocationState **link = &shard->head;
+    while (*link != NULL &&
+           ((*link)->host_ptr != host_ptr || (*link)->device_id != device_id))
+        link = &(*link)->next;
+    GPUAllocationState *node = *link;
+    if (node && atomic_load_explicit(&node->pins, memory_order_acquire) > 0) {
+        atomic_fetch_sub_explicit(&node->pins, 1, memory_order_acq_rel);
+        /* a buffer the call unmapped (e.g. its counts) leaves no record */
+        if (node->bytes > 0 && NODE_IDLE(node) &&
+            !omp_target_is_present(host_ptr, device_id)) {
+            *link = node->next;
+            free(node);
         }
-        curr = curr->next;
     }
+    SHARD_UNLOCK(shard)
+}
+
+void registry_admit(const void *host_ptr, int device_id, size_t bytes) {
+    const size_t budget = registry_budget(device_id);
+#ifdef BIT_USM
+    return; // nothing is mapped
+#endif
+    if (device_id < 0 || device_id >= REGISTRY_MAX_DEVICES)
+        return;
+    if (budget > 0) {
+        while (atomic_exchange_explicit(&g_admit_lock, 1, memory_order_acquire))
+            ;
+        while (registry_resident_bytes(device_id) + bytes > budget &&
+               evict_lru(device_id, host_ptr))
+            ;
+    }
+    RegistryShard *shard = registry_shard(host_ptr, device_id);
+    SHARD_LOCK(shard)
+    GPUAllocationState *node = find_or_create_node(shard, host_ptr, device_id);
+    if (node) {
+        node->mapped = bytes; // counted with or without a budget
+        if (budget > 0)
+            node->bytes = bytes;
+    }
+    SHARD_UNLOCK(shard)
+    if (budget > 0)
+        atomic_store_explicit(&g_admit_lock, 0, memory_order_release);
+    mapped_walk(device_id); // raises the marks
+}
 
-    atomic_flag_clear_explicit(&g_registry_lock, memory_order_release);
-    if (target) {
-        atomic_fetch_sub_explicit(&target->active_users, 1, memory_order_release);
+void registry_set_budget(int device_id, size_t bytes) {
+    if (device_id >= 0 && device_id < REGISTRY_MAX_DEVICES)
+        atomic_store_explicit(&g_budget[device_id], bytes, memory_order_relaxed);
+}
+
+size_t registry_budget(int device_id) {
+    if (device_id < 0 || device_id >= REGISTRY_MAX_DEVICES)
+        return 0;
+    return atomic_load_explicit(&g_budget[device_id], memory_order_relaxed);
+}
+
+size_t registry_resident_bytes(int device_id) {
+    size_t total = 0;
+    for (size_t s = 0; s < REGISTRY_SHARDS; s++) {
+        RegistryShard *shard = &g_registry[s];
+        SHARD_LOCK(shard)
+        for (GPUAllocationState *node = shard->head; node; node = node->next)
+            if (node->device_id == device_id && node->bytes > 0 &&
+                omp_target_is_present(node->host_ptr, device_id))
+                total += node->bytes;
+        SHARD_UNLOCK(shard)
+    }
+    return total;
+}
+
+void registry_scratch(int device_id, ptrdiff_t bytes) {
+    if (device_id < 0 || device_id >= REGISTRY_MAX_DEVICES)
+        return;
+    const ptrdiff_t now = atomic_fetch_add_explicit(&g_scratch[device_id], bytes,
+                                                    memory_order_relaxed) +
+                          bytes;
+    if (bytes > 0 && now > 0) {
+        raise_peak(&g_scratch_peak[device_id], (size_t)now);
+        raise_peak(&g_peak[device_id],
+                   atomic_load_explicit(&g_mapped[device_id],
+                                        memory_order_relaxed) +
+                       (size_t)now);
     }
 }
 
+void registry_memory(int device_id, size_t *mapped, size_t *mapped_peak,
+                     size_t *scratch, size_t *scratch_peak, size_t *peak) {
+    *mapped = *mapped_peak = *scratch = *scratch_peak = *peak = 0;
+    if (device_id < 0 || device_id >= REGISTRY_MAX_DEVICES)
+        return;
+    *mapped = mapped_walk(device_id);
+    const ptrdiff_t now =
+        atomic_load_explicit(&g_scratch[device_id], memory_order_relaxed);
+    *scratch = now > 0 ? (size_t)now : 0;
+    *mapped_peak =
+        atomic_load_explicit(&g_mapped_peak[device_id], memory_order_relaxed);
+    *scratch_peak =
+        atomic_load_explicit(&g_scratch_peak[device_id], memory_order_relaxed);
+    *peak = atomic_load_explicit(&g_peak[device_id], memory_order_relaxed);
+}
+
+void registry_reset_peaks(int device_id) {
+    if (device_id < 0 || device_id >= REGISTRY_MAX_DEVICES)
+        return;
+    const size_t mapped = mapped_walk(device_id);
+    const ptrdiff_t now =
+        atomic_load_explicit(&g_scratch[device_id], memory_order_relaxed);
+    const size_t scratch = now > 0 ? (size_t)now : 0;
+    atomic_store_explicit(&g_mapped_peak[device_id], mapped,
+                          memory_order_relaxed);
+    atomic_store_explicit(&g_scratch_peak[device_id], scratch,
+                          memory_order_relaxed);
+    atomic_store_explicit(&g_peak[device_id], mapped + scratch,
+                          memory_order_relaxed);
+}
+
 /* --- End Section 9: PUBLIC API --- */
@@ -11,33 +11,54 @@ typedef struct GPUAllocationState {
     _Atomic uint32_t state_word;
     _Atomic int transition_lock;
     _Atomic int active_users;
+    _Atomic int pins;           // GPU calls using the buffer, see registry_pin
+    _Atomic uint64_t last_use;  // registry clock of the last lookup
+    size_t bytes;               // device bytes admitted, 0 if not budgeted
+    size_t mapped;              // device bytes of the last enter data
     struct GPUAllocationState *next;
 } GPUAllocationState;
 
 int registry_checkout_fast_path(uint64_t *bits, int device_id, uint32_t target_state);
+/* Check out a buffer in whatever layout it is in, and return that layout */
+uint32_t registry_checkout_layout(uint64_t *bits, int device_id);
 GPUAllocationState *registry_claim_transition(uint64_t *bits, int device_id);
 void registry_commit_transition(GPUAllocationState *node, uint32_t final_target);
 void release_gpu_layout(uint64_t *bits, int device_id);
+/* Drop the record of a buffer whose device copy is gone, so that a later
+   buffer at the same address starts row-major. Call it once no other thread
+   uses the buffer; records still checked out or mid-transition are kept.
+   Returns 1 if a record was removed */
+int registry_forget(const void *host_ptr, int device_id);
+/* Keep a buffer off the eviction list for the length of a GPU call; pin
+   every operand before mapping any of them, and unpin after the call */
+void registry_pin(const void *host_ptr, int device_id);
+void registry_unpin(const void *host_ptr, int device_id);
+/* Make room for a buffer of bytes about to be mapped to device_id, by
+   evicting the least recently used unpinned buffers over the device budget,
+   and count it against the budget from now on */
+void registry_admit(const void *host_ptr, int device_id, size_t bytes);
+/* Device memory budget of device_id in bytes (0: none) and the bytes of
+   the admitted buffers still mapped there */
+void registry_set_budget(int device_id, size_t bytes);
+size_t registry_budget(int device_id);
+size_t registry_resident_bytes(int device_id);
+/* Memory accounting of device_id (Bit_memory_stats): the bytes mapped by
+   enter data and still present, budgeted or not, the device scratch of
+   the layout transitions, and their high-water marks. registry_scratch
+   adds bytes (negative to release) to the scratch of device_id */
+void registry_scratch(int device_id, ptrdiff_t bytes);
+void registry_memory(int device_id, size_t *mapped, size_t *mapped_peak,
+                     size_t *scratch, size_t *scratch_peak, size_t *peak);
+void registry_reset_peaks(int device_id);
 
 #define ENSURE_GPU_LAYOUT(bits, rows, cols, target_state, device_id, params, params_size) \
     do { \
         if (!registry_checkout_fast_path((bits), (device_id), (target_state))) { \
             GPUAllocationState *_node = registry_claim_transition((bits), (device_id)); \
             uint32_t _current = atomic_load_explicit(&_node->state_word, memory_order_acquire); \
-            if (_current != (target_state)) { \
-                GPUDataState _c_base = (GPUDataState)(_current & MASK_BASE_LAYOUT); \
-                GPUDataState _t_base = (GPUDataState)((target_state) & MASK_BASE_LAYOUT); \
-                if (_c_base != _t_base) { \
-                    if (_c_base != LAYOUT_ROW_MAJOR) { \
-                        TransitionKernel _kfunc = get_transition_kernel(_c_base, LAYOUT_ROW_MAJOR); \
-                        _kfunc(_c_base, LAYOUT_ROW_MAJOR, (bits), (rows), (cols), (device_id), (params), (params_size)); \
-                    } \
-                    if (_t_base != LAYOUT_ROW_MAJOR) { \
-                        TransitionKernel _kfunc = get_transition_kernel(LAYOUT_ROW_MAJOR, _t_base); \
-                        _kfunc(LAYOUT_ROW_MAJOR, _t_base, (bits), (rows), (cols), (device_id), (params), (params_size)); \
-                    } \
-                } \
-            } \
+            if (_current != (target_state)) \
+                run_transition_path(_current, (target_state), (bits), (rows), (cols), \
+                                    (device_id), (params), (params_size)); \
             registry_commit_transition(_node, (target_state)); \
         } \
     } while (0)
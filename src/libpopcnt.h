@@ -907,6 +907,118 @@ static inline uint64_t popcnt(const void* data, uint64_t size)
 
 #endif
 
+#if defined(LIBPOPCNT_X86_OR_X64) && \
+    defined(LIBPOPCNT_HAVE_CPUID)
+static int popcnt_many_cpuid_ = -1;
+#endif
+
+/*
+ * Count the number of 1 bits in each of n data arrays
+ * @buffers: The arrays
+ * @sizes: Size of each array in bytes
+ * @n: Number of arrays
+ * @out: out[k] receives the count of buffers[k]
+ *
+ * The CPUID checks and the choice of algorithm are made once for
+ * the batch instead of once per array, which matters for many
+ * small arrays (e.g. the staging buffers of a count tile).
+ */
+static inline void popcnt_many(const void* const buffers[],
+                               const uint64_t sizes[],
+                               uint64_t n,
+                               uint64_t out[])
+{
+#if defined(LIBPOPCNT_X86_OR_X64) && \
+    defined(LIBPOPCNT_HAVE_CPUID)
+  int cpuid = popcnt_many_cpuid_;
+  if (cpuid == -1)
+  {
+    cpuid = get_cpuid();
+
+    #if defined(_MSC_VER)
+      _InterlockedCompareExchange(&popcnt_many_cpuid_, cpuid, -1);
+    #else
+      __sync_val_compare_and_swap(&popcnt_many_cpuid_, -1, cpuid);
+    #endif
+  }
+
+  int use_avx512 = 0, use_avx2 = 0, use_popcnt = 0;
+  (void) cpuid;
+  #if defined(LIBPOPCNT_HAVE_AVX512)
+    #if defined(__AVX512__) || \
+       (defined(__AVX512F__) && \
+        defined(__AVX512BW__) && \
+        defined(__AVX512VPOPCNTDQ__))
+      use_avx512 = 1;
+    #else
+      use_avx512 = (cpuid & LIBPOPCNT_BIT_AVX512_VPOPCNTDQ) != 0;
+    #endif
+  #endif
+  #if defined(LIBPOPCNT_HAVE_AVX2)
+    #if defined(__AVX2__)
+      use_avx2 = 1;
+    #else
+      use_avx2 = (cpuid & LIBPOPCNT_BIT_AVX2) != 0;
+    #endif
+  #endif
+  #if defined(LIBPOPCNT_HAVE_POPCNT)
+    #if defined(__POPCNT__)
+      use_popcnt = 1;
+    #else
+      use_popcnt = (cpuid & LIBPOPCNT_BIT_POPCNT) != 0;
+    #endif
+  #endif
+
+  #if defined(LIBPOPCNT_HAVE_AVX512)
+    /* For tiny arrays AVX512 is not worth it */
+    if (use_avx512)
+    {
+      for (uint64_t k = 0; k < n; k++)
+        out[k] = (sizes[k] >= 40)
+                     ? popcnt_avx512((const uint8_t*) buffers[k], sizes[k])
+                     : popcnt(buffers[k], sizes[k]);
+      return;
+    }
+  #endif
+
+  for (uint64_t k = 0; k < n; k++)
+  {
+    const uint8_t* ptr = (const uint8_t*) buffers[k];
+    uint64_t size = sizes[k];
+    uint64_t cnt = 0;
+    uint64_t i = 0;
+
+    #if defined(LIBPOPCNT_HAVE_AVX2)
+      /* AVX2 requires arrays >= 512 bytes */
+      if (use_avx2 && size >= 512)
+      {
+        cnt += popcnt_avx2((const __m256i*) ptr, size / 32);
+        i = size - size % 32;
+      }
+    #endif
+
+    /* Whole aligned words; the rest, rarely any, goes through popcnt */
+    if (((uintptr_t) &ptr[i]) % 8 == 0)
+    {
+      if (use_popcnt)
+        for (; i + 8 <= size; i += 8)
+          cnt += popcnt64(*(const uint64_t*)(ptr + i));
+      else
+        for (; i + 8 <= size; i += 8)
+          cnt += popcnt64_bitwise(*(const uint64_t*)(ptr + i));
+    }
+
+    if (i < size)
+      cnt += popcnt(ptr + i, size - i);
+
+    out[k] = cnt;
+  }
+#else
+  for (uint64_t k = 0; k < n; k++)
+    out[k] = popcnt(buffers[k], sizes[k]);
+#endif
+}
+
 #ifdef __cplusplus
 } /* extern "C" */
 #endif
@@ -1,7 +1,13 @@
 #include "bit.h"
+#include "bit_inline.h"
+#include <limits.h>
+#include <math.h>
+#include <omp.h>
 #include <stdbool.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
+#include <time.h>
 
 #define SIZE_OF_TEST_BIT 65536
 typedef struct {
@@ -35,6 +41,29 @@ bool test_bit_new() {
   return success;
 }
 
+bool test_bit_pool() {
+  Bit_pool_T pool = Bit_pool_new(SIZE_OF_TEST_BIT, 2);
+  Bit_T a = Bit_pool_get(pool);
+  Bit_T b = Bit_pool_get(pool);
+  Bit_T c = Bit_pool_get(pool); // forces a second slab
+  Bit_set(a, 0, 99);
+  Bit_set(c, 50, 149);
+  bool success = (Bit_length(c) == SIZE_OF_TEST_BIT && Bit_count(b) == 0 &&
+                  Bit_inter_count(a, c) == 50 && Bit_rank(a, 100) == 100);
+
+  Bit_T freed = a;
+  success = success && Bit_free(&a) == NULL && a == NULL;
+  Bit_T d = Bit_pool_get(pool); // recycled, and cleared
+  success = success && d == freed && Bit_count(d) == 0 && Bit_rank(d, 100) == 0;
+
+  Bit_free(&b);
+  Bit_free(&c);
+  Bit_pool_free(&pool);
+  success = success && pool == NULL;
+  report_test(__func__, success);
+  return success;
+}
+
 bool test_bit_extract() {
   Bit_T bit = Bit_new(SIZE_OF_TEST_BIT);
   Bit_bset(bit, 2);
@@ -58,6 +87,31 @@ bool test_bit_load()
   return success;
 }
 
+bool test_bit_load_misaligned() {
+  // an 8-byte offset defeats the aligned fast path of the set operations
+  int nbytes = Bit_buffer_size(SIZE_OF_TEST_BIT);
+  unsigned char *raw = calloc(nbytes + 64 + 8, 1);
+  unsigned char *buffer =
+      raw + ((64 - ((size_t)raw & 63)) & 63) + 8; // 64-byte aligned + 8
+  Bit_T loaded = Bit_load(SIZE_OF_TEST_BIT, buffer);
+  Bit_T bit = Bit_new(SIZE_OF_TEST_BIT);
+  Bit_set(loaded, 100, SIZE_OF_TEST_BIT - 100);
+  Bit_set(bit, 0, 4000);
+
+  Bit_T inter = Bit_inter(loaded, bit);
+  bool success = (Bit_count(inter) == 4000 - 100 + 1 &&
+                  Bit_inter_count(loaded, bit) == 4000 - 100 + 1 &&
+                  Bit_union_count(bit, loaded) == SIZE_OF_TEST_BIT - 100 + 1 &&
+                  Bit_intersects(loaded, bit) && !Bit_leq(bit, loaded));
+
+  Bit_free(&inter);
+  Bit_free(&bit);
+  success = success && Bit_free(&loaded) == buffer;
+  free(raw);
+  report_test(__func__, success);
+  return success;
+}
+
 bool test_bit_set() {
   Bit_T bit = Bit_new(SIZE_OF_TEST_BIT);
   Bit_bset(bit, 2);
@@ -124,6 +178,145 @@ bool test_bit_clear_range() {
   return success;
 }
 
+bool test_bit_not_range() {
+  Bit_T bit = Bit_new(SIZE_OF_TEST_BIT);
+  Bit_set(bit, 60, 70);
+  Bit_not(bit, 3, 1000); // spans partial head, full middle and tail qwords
+
+  bool success = (Bit_get(bit, 2) == 0 && Bit_get(bit, 1001) == 0);
+  for (int index = 3; index <= 1000; index++)
+    success = success &&
+              (Bit_get(bit, index) == (index < 60 || index > 70 ? 1 : 0));
+  Bit_not(bit, 5, 5);
+  success = success && Bit_get(bit, 5) == 0 && Bit_count(bit) == 998 - 11 - 1;
+
+  report_test(__func__, success);
+  Bit_free(&bit);
+  return success;
+}
+
+bool test_bit_set_ranges() {
+  Bit_T bit = Bit_new(SIZE_OF_TEST_BIT);
+  int lo[] = {0, 63, 200, 4000};
+  int hi[] = {0, 64, 511, SIZE_OF_TEST_BIT - 1};
+  Bit_set_ranges(bit, lo, hi, 4);
+  int expected = 1 + 2 + 312 + (SIZE_OF_TEST_BIT - 4000);
+  bool success = (Bit_count(bit) == expected && Bit_get(bit, 1) == 0 &&
+                  Bit_get(bit, 199) == 0 && Bit_get(bit, 512) == 0);
+
+  int clo[] = {63, 256};
+  int chi[] = {63, 511};
+  Bit_clear_ranges(bit, clo, chi, 2);
+  success = success && Bit_count(bit) == expected - 1 - 256 &&
+            Bit_get(bit, 64) == 1 && Bit_get(bit, 255) == 1;
+
+  Bit_not_ranges(bit, lo, hi, 4);
+  success = success && Bit_count(bit) == 1 + 256;
+
+  report_test(__func__, success);
+  Bit_free(&bit);
+  return success;
+}
+
+bool test_bit_aget_sorted() {
+  Bit_T bit = Bit_new(SIZE_OF_TEST_BIT);
+  int sorted[] = {1, 2, 2, 63, 64, 65, 4096, SIZE_OF_TEST_BIT - 1};
+  Bit_aset_sorted(bit, sorted, 8);
+  bool success = (Bit_count(bit) == 7);
+
+  int probe[64], out[64];
+  for (int i = 0; i < 64; i++)
+    probe[i] = (i * 7919) % SIZE_OF_TEST_BIT; // unsorted, past prefetch depth
+  probe[10] = 4096;
+  probe[50] = 65;
+  Bit_aget(bit, probe, 64, out);
+  for (int i = 0; i < 64 && success; i++)
+    success = out[i] == Bit_get(bit, probe[i]);
+  success = success && out[10] == 1 && out[50] == 1 && out[0] == 0;
+
+  int clear[] = {2, 63, 64};
+  Bit_aclear_sorted(bit, clear, 3);
+  success = success && Bit_count(bit) == 4 && Bit_get(bit, 1) == 1 &&
+            Bit_get(bit, 65) == 1 && Bit_get(bit, 64) == 0;
+
+  Bit_aset(bit, probe, 64);
+  Bit_aget(bit, probe, 64, out);
+  for (int i = 0; i < 64 && success; i++)
+    success = out[i] == 1;
+  Bit_aclear(bit, probe, 64);
+  Bit_aget(bit, probe, 64, out);
+  for (int i = 0; i < 64 && success; i++)
+    success = out[i] == 0;
+
+  report_test(__func__, success);
+  Bit_free(&bit);
+  return success;
+}
+
+static void collect_set_bit(int n, void *cl) {
+  int *out = cl;
+  out[++out[0]] = n;
+}
+
+bool test_bit_next_prev_foreach() {
+  Bit_T bit = Bit_new(SIZE_OF_TEST_BIT - 3); // partial last qword
+  int members[] = {0, 63, 64, 1000, SIZE_OF_TEST_BIT - 4};
+  Bit_aset(bit, members, 5);
+
+  bool success = (Bit_next_set(bit, 0) == 0 && Bit_next_set(bit, 1) == 63 &&
+                  Bit_next_set(bit, 65) == 1000 &&
+                  Bit_next_set(bit, SIZE_OF_TEST_BIT - 4) ==
+                      SIZE_OF_TEST_BIT - 4 &&
+                  Bit_next_set(bit, SIZE_OF_TEST_BIT - 3) == -1);
+  success = success && Bit_prev_set(bit, SIZE_OF_TEST_BIT - 5) == 1000 &&
+            Bit_prev_set(bit, 63) == 63 && Bit_prev_set(bit, 62) == 0 &&
+            Bit_prev_set(bit, -1) == -1;
+
+  int found[8] = {0};
+  Bit_foreach_set(bit, collect_set_bit, found);
+  success = success && found[0] == 5;
+  for (int i = 0; i < 5 && success; i++)
+    success = found[i + 1] == members[i];
+
+  Bit_bclear(bit, 0);
+  success = success && Bit_prev_set(bit, 62) == -1;
+
+  report_test(__func__, success);
+  Bit_free(&bit);
+  return success;
+}
+
+bool test_bit_rank_select() {
+  Bit_T bit = Bit_new(SIZE_OF_TEST_BIT - 7);
+  for (int i = 0; i < SIZE_OF_TEST_BIT - 7; i += 7)
+    Bit_bset(bit, i);
+  int total = Bit_count(bit);
+
+  bool success = (Bit_rank(bit, 0) == 0 && Bit_rank(bit, 1) == 1 &&
+                  Bit_rank(bit, 7) == 1 && Bit_rank(bit, 8) == 2 &&
+                  Bit_rank(bit, 5000) == (5000 + 6) / 7 &&
+                  Bit_rank(bit, SIZE_OF_TEST_BIT - 7) == total);
+  for (int k = 0; k < total && success; k += 97)
+    success = Bit_select(bit, k) == 7 * k && Bit_rank(bit, 7 * k) == k;
+  success = success && Bit_select(bit, total - 1) == 7 * (total - 1) &&
+            Bit_select(bit, total) == -1;
+
+  // mutators invalidate the index
+  Bit_bclear(bit, 0);
+  success = success && Bit_rank(bit, 8) == 1 && Bit_select(bit, 0) == 7;
+  Bit_set(bit, 1, 6);
+  success = success && Bit_rank(bit, 8) == 7 && Bit_select(bit, 6) == 7;
+  Bit_T empty = Bit_new(SIZE_OF_TEST_BIT - 7);
+  Bit_inter_assign(bit, empty);
+  success = success && Bit_rank(bit, SIZE_OF_TEST_BIT - 7) == 0 &&
+            Bit_select(bit, 0) == -1;
+
+  report_test(__func__, success);
+  Bit_free(&bit);
+  Bit_free(&empty);
+  return success;
+}
+
 bool test_bit_count() {
   Bit_T bit = Bit_new(SIZE_OF_TEST_BIT);
   Bit_bset(bit, 1);
@@ -199,6 +392,31 @@ bool test_bit_lt() {
   return success;
 }
 
+bool test_bit_intersects_disjoint() {
+  Bit_T bit1 = Bit_new(SIZE_OF_TEST_BIT);
+  Bit_T bit2 = Bit_new(SIZE_OF_TEST_BIT);
+
+  Bit_bset(bit1, 1);
+  Bit_bset(bit2, SIZE_OF_TEST_BIT - 1);
+  bool success = Bit_disjoint(bit1, bit2) && !Bit_intersects(bit1, bit2);
+
+  Bit_bset(bit1, SIZE_OF_TEST_BIT - 1); // common bit in the last block
+  success = success && Bit_intersects(bit1, bit2) &&
+            !Bit_disjoint(bit1, bit2);
+
+  // proper subset: equal sets are not, the empty set is
+  Bit_T empty = Bit_new(SIZE_OF_TEST_BIT);
+  success = success && Bit_lt(bit2, bit1) && !Bit_lt(bit1, bit1) &&
+            Bit_leq(bit1, bit1) && Bit_lt(empty, bit2) &&
+            !Bit_lt(empty, empty) && Bit_disjoint(empty, empty);
+
+  report_test(__func__, success);
+  Bit_free(&bit1);
+  Bit_free(&bit2);
+  Bit_free(&empty);
+  return success;
+}
+
 // Set operation tests
 bool test_bit_union() {
   Bit_T bit1 = Bit_new(SIZE_OF_TEST_BIT);
@@ -295,6 +513,52 @@ bool test_bit_diff() {
   return success;
 }
 
+bool test_bit_into_assign() {
+  Bit_T bit1 = Bit_new(SIZE_OF_TEST_BIT);
+  Bit_T bit2 = Bit_new(SIZE_OF_TEST_BIT);
+  Bit_T dst = Bit_new(SIZE_OF_TEST_BIT);
+
+  Bit_bset(bit1, 1);
+  Bit_bset(bit1, 3);
+  Bit_bset(bit2, 3);
+  Bit_bset(bit2, SIZE_OF_TEST_BIT - 1);
+
+  Bit_inter_into(dst, bit1, bit2);
+  bool success = (Bit_count(dst) == 1 && Bit_get(dst, 3) == 1);
+  Bit_union_into(dst, bit1, bit2);
+  success = success && Bit_count(dst) == 3;
+  Bit_diff_into(dst, bit1, bit2);
+  success = success && Bit_count(dst) == 2 && Bit_get(dst, 3) == 0;
+  Bit_minus_into(dst, bit1, bit2);
+  success = success && Bit_count(dst) == 1 && Bit_get(dst, 1) == 1;
+
+  // NULL and aliased operand shortcuts write into dst without allocating
+  Bit_union_into(dst, NULL, bit2);
+  success = success && Bit_eq(dst, bit2);
+  Bit_inter_into(dst, bit1, NULL);
+  success = success && Bit_count(dst) == 0;
+  Bit_minus_into(dst, bit1, NULL);
+  success = success && Bit_eq(dst, bit1);
+  Bit_diff_into(dst, bit2, bit2);
+  success = success && Bit_count(dst) == 0;
+
+  // Compound forms update the left operand in place
+  Bit_union_assign(bit1, bit2);
+  success = success && Bit_count(bit1) == 3;
+  Bit_minus_assign(bit1, bit2);
+  success = success && Bit_count(bit1) == 1 && Bit_get(bit1, 1) == 1;
+  Bit_diff_assign(bit1, bit2);
+  success = success && Bit_count(bit1) == 3;
+  Bit_inter_assign(bit1, bit2);
+  success = success && Bit_eq(bit1, bit2);
+
+  report_test(__func__, success);
+  Bit_free(&bit1);
+  Bit_free(&bit2);
+  Bit_free(&dst);
+  return success;
+}
+
 // Count operation tests
 bool test_bit_count_operations() {
   Bit_T bit1 = Bit_new(SIZE_OF_TEST_BIT);
@@ -420,41 +684,6349 @@ bool test_bitDB_extract_replace() {
   return success;
 }
 
-bool test_bitDB_inter_count() {
-#define SIZEOF_BITDB 45
-  Bit_DB_T bit1 = BitDB_new(SIZE_OF_TEST_BIT, SIZEOF_BITDB);
-  Bit_DB_T bit2 = BitDB_new(SIZE_OF_TEST_BIT, SIZEOF_BITDB);
+bool test_bitDB_count_cache() {
+  Bit_DB_T db = BitDB_new(SIZE_OF_TEST_BIT, 5);
+  Bit_T bit = Bit_new(SIZE_OF_TEST_BIT);
+  Bit_set(bit, 10, 1009);
+  BitDB_put_at(db, 1, bit);
+  BitDB_put_at(db, 4, bit);
 
-  Bit_T bitset1 = Bit_new(SIZE_OF_TEST_BIT);
-  Bit_bset(bitset1, 1);
-  Bit_bset(bitset1, 3);
+  int counts[5];
+  BitDB_count_store(db, counts, (SETOP_COUNT_OPTS){.num_cpu_threads = 2});
+  bool success = (counts[0] == 0 && counts[1] == 1000 && counts[4] == 1000);
 
-  Bit_T bitset2 = Bit_new(SIZE_OF_TEST_BIT);
-  Bit_bset(bitset2, 3);
-  Bit_bset(bitset2, 5);
+  BitDB_cache_counts(db, true, (SETOP_COUNT_OPTS){});
+  Bit_bset(bit, 0);
+  BitDB_put_at(db, 2, bit);
+  unsigned char buffer[Bit_buffer_size(SIZE_OF_TEST_BIT)];
+  Bit_extract(bit, buffer);
+  BitDB_replace_at(db, 3, buffer);
+  BitDB_clear_at(db, 4);
+  int *cached = BitDB_count(db);
+  success = success && cached[1] == 1000 && cached[2] == 1001 &&
+            cached[3] == 1001 && cached[4] == 0 &&
+            BitDB_count_at(db, 2) == 1001;
+  free(cached);
 
-  BitDB_put_at(bit1, 0, bitset1);
-  BitDB_put_at(bit2, 0, bitset2);
+  BitDB_clear(db);
+  success = success && BitDB_count_at(db, 1) == 0;
+  BitDB_cache_counts(db, false, (SETOP_COUNT_OPTS){});
+  BitDB_put_at(db, 0, bit);
+  success = success && BitDB_count_at(db, 0) == 1001;
 
-  Bit_bset(bitset1, 7); // Add an extra bit to bitset1
-  Bit_bset(bitset2, 7); // Add an extra bit to bitset2
+  Bit_free(&bit);
+  BitDB_free(&db);
+  report_test(__func__, success);
+  return success;
+}
 
-  BitDB_put_at(bit1, 1, bitset1);
-  BitDB_put_at(bit2, 1, bitset2);
+bool test_bitDB_grow() {
+  Bit_DB_T db = BitDB_new(SIZE_OF_TEST_BIT, 1);
+  Bit_T bit = Bit_new(SIZE_OF_TEST_BIT);
+  BitDB_cache_counts(db, true, (SETOP_COUNT_OPTS){});
+  bool success = BitDB_capacity(db) == 1;
 
-  int* count = BitDB_count(bit1);
-  int* count2 = BitDB_count(bit2);
+  // Enough appends to move the rows into an mremap-grown mapping
+  const int rows = 300;
+  for (int i = 1; i < rows; i++) {
+    Bit_clear(bit, 0, SIZE_OF_TEST_BIT - 1);
+    Bit_bset(bit, i);
+    success = success && BitDB_append(db, bit) == i;
+  }
+  success = success && BitDB_nelem(db) == rows && BitDB_capacity(db) >= rows;
 
-  int* inter_count = BitDB_inter_count(bit1, bit2, (SETOP_COUNT_OPTS) {}, cpu);
-  bool success = (*inter_count == 1) &&
-    (inter_count[1] == 1 && inter_count[SIZEOF_BITDB] == 1 &&
-      inter_count[SIZEOF_BITDB + 1] == 2);
+  Bit_clear(bit, 0, SIZE_OF_TEST_BIT - 1);
+  Bit_set(bit, 0, 99);
+  BitDB_insert_at(db, 1, bit);
+  success = success && BitDB_nelem(db) == rows + 1 &&
+            BitDB_count_at(db, 1) == 100 && BitDB_count_at(db, 2) == 1;
+  Bit_T row = BitDB_get_from(db, rows);
+  success = success && Bit_get(row, rows - 1) == 1 && Bit_count(row) == 1;
+  Bit_free(&row);
 
-  Bit_free(&bitset1);
-  Bit_free(&bitset2);
-  BitDB_free(&bit1);
-  BitDB_free(&bit2);
+  unsigned char buffer[2 * Bit_buffer_size(SIZE_OF_TEST_BIT)];
+  Bit_extract(bit, buffer);
+  Bit_extract(bit, buffer + Bit_buffer_size(SIZE_OF_TEST_BIT));
+  int first = BitDB_append_many(db, 2, buffer);
+  success = success && first == rows + 1 &&
+            BitDB_count_at(db, first + 1) == Bit_count(bit);
+  first = BitDB_append_many(db, 1, NULL);
+  success = success && BitDB_count_at(db, first) == 0;
+
+  BitDB_reserve(db, 1000);
+  int *counts = BitDB_count(db);
+  success = success && BitDB_capacity(db) >= 1000 && counts[0] == 0 &&
+            counts[2] == 1 && counts[rows] == 1 && BitDB_nelem(db) == rows + 4;
+  free(counts);
+
+  Bit_free(&bit);
+  BitDB_free(&db);
+  report_test(__func__, success);
+  return success;
+}
+
+bool test_bitDB_view_at() {
+  Bit_DB_T db = BitDB_new(SIZE_OF_TEST_BIT, 3);
+  Bit_T bit = Bit_new(SIZE_OF_TEST_BIT);
+  Bit_set(bit, 5, 14);
+  BitDB_put_at(db, 2, bit);
+
+  Bit_T view = NULL;
+  BitDB_view_at(db, 2, &view);
+  bool success = view != NULL && Bit_count(view) == 10 && Bit_eq(view, bit);
+  Bit_T handle = view;
+  BitDB_view_at(db, 0, &view);
+  success = success && view == handle && Bit_count(view) == 0;
+  Bit_bset(view, 7); // writes go to the row itself
+  success = success && BitDB_count_at(db, 0) == 1 &&
+            Bit_inter_count(view, bit) == 1;
+
+  success = success && Bit_free(&view) != NULL && view == NULL;
+  Bit_free(&bit);
+  BitDB_free(&db);
+  report_test(__func__, success);
+  return success;
+}
+
+bool test_bitDB_padded() {
+  bool success = true;
+  const int lengths[] = {166, 1088};
+  for (int l = 0; l < 2; l++) {
+    const int len = lengths[l], rows = 11;
+    Bit_DB_T packed = BitDB_new(len, rows);
+    Bit_DB_T padded = BitDB_new_padded(len, rows, 64);
+    Bit_T bit = Bit_new(len);
+    for (int i = 0; i < rows; i++) {
+      Bit_clear(bit, 0, len - 1);
+      for (int b = i; b < len; b += i + 2)
+        Bit_bset(bit, b);
+      BitDB_put_at(packed, i, bit);
+      BitDB_put_at(padded, i, bit);
+    }
+    Bit_T row = BitDB_get_from(padded, rows - 1);
+    Bit_T view = NULL;
+    BitDB_view_at(padded, 3, &view);
+    success = success && Bit_eq(row, bit) &&
+              Bit_count(view) == BitDB_count_at(packed, 3);
+    Bit_free(&view);
+    Bit_free(&row);
+
+    int *expected = BitDB_inter_count(packed, packed, (SETOP_COUNT_OPTS){}, cpu);
+    int *same = BitDB_inter_count(padded, padded, (SETOP_COUNT_OPTS){}, cpu);
+    int *mixed = BitDB_minus_count(padded, packed, (SETOP_COUNT_OPTS){}, cpu);
+    int *minus = BitDB_minus_count(packed, packed, (SETOP_COUNT_OPTS){}, cpu);
+    size_t pairs = BitDB_counts_size(packed, packed);
+    success = success && memcmp(expected, same, pairs * sizeof(int)) == 0 &&
+              memcmp(minus, mixed, pairs * sizeof(int)) == 0;
+    free(expected);
+    free(same);
+    free(mixed);
+    free(minus);
+
+    // Packed buffers in, packed buffers out
+    unsigned char buffer[2 * Bit_buffer_size(1088)];
+    BitDB_extract_from(padded, 4, buffer);
+    BitDB_extract_from(padded, 5, buffer + Bit_buffer_size(len));
+    int first = BitDB_append_many(padded, 2, buffer);
+    success = success &&
+              BitDB_count_at(padded, first + 1) == BitDB_count_at(padded, 5);
+
+    Bit_free(&bit);
+    BitDB_free(&packed);
+    BitDB_free(&padded);
+  }
+  report_test(__func__, success);
+  return success;
+}
+
+/* true iff the VmFlags of the mapping of the file name (by the end of its
+   path) in /proc/self/smaps hold flag; true where there is no smaps */
+static bool mapping_has_vmflag(const char *name, const char *flag) {
+#ifdef __linux__
+  FILE *smaps = fopen("/proc/self/smaps", "r");
+  if (smaps == NULL)
+    return true;
+  char line[4096];
+  bool in_file = false, found = false;
+  const size_t name_len = strlen(name);
+  while (!found && fgets(line, sizeof(line), smaps)) {
+    size_t len = strcspn(line, "\n");
+    line[len] = '\0';
+    if (strncmp(line, "VmFlags:", 8) == 0) {
+      if (in_file) { // " sr" among two-letter flags
+        char padded[4096];
+        snprintf(padded, sizeof(padded), "%s ", line + 8);
+        char want[8];
+        snprintf(want, sizeof(want), " %s ", flag);
+        found = strstr(padded, want) != NULL;
+      }
+      in_file = false;
+    } else {
+      unsigned long lo, hi; // the header line of a mapping: lo-hi ... path
+      if (sscanf(line, "%lx-%lx ", &lo, &hi) == 2)
+        in_file = len >= name_len && strcmp(line + len - name_len, name) == 0;
+    }
+  }
+  fclose(smaps);
+  return found;
+#else
+  (void)name;
+  (void)flag;
+  return true;
+#endif
+}
+
+bool test_bitDB_save_mmap() {
+  const char *path = "test_bitDB_save_mmap.bdb";
+  Bit_DB_T db = BitDB_new_padded(1000, 7, 64);
+  Bit_T bit = Bit_new(1000);
+  Bit_set(bit, 3, 700);
+  BitDB_put_at(db, 5, bit);
+  bool success = BitDB_save(db, path) == 0;
+
+  Bit_DB_T mapped =
+      BitDB_open_mmap(path, BIT_DB_MMAP_SEQUENTIAL | BIT_DB_MMAP_VERIFY);
+  success = success && mapped && BitDB_nelem(mapped) == 7 &&
+            BitDB_length(mapped) == 1000 && BitDB_count_at(mapped, 5) == 698;
+  // both pieces of advice: SEQUENTIAL is the one the mapping keeps
+  success = success && mapping_has_vmflag(path, "sr");
+  if (mapped) {
+    int *counts = BitDB_inter_count(mapped, db, (SETOP_COUNT_OPTS){}, cpu);
+    success = success && counts[BitDB_counts_offset(db, 5, 5)] == 698 &&
+              BitDB_free(&mapped) == NULL;
+    free(counts);
+  }
+
+  // Copy-on-write mappings take writes that never reach the file
+  Bit_DB_T scratch = BitDB_open_mmap(path, BIT_DB_MMAP_PRIVATE);
+  success = success && scratch;
+  if (scratch) {
+    BitDB_clear_at(scratch, 5);
+    success = success && BitDB_count_at(scratch, 5) == 0;
+    BitDB_free(&scratch);
+  }
+  mapped = BitDB_open_mmap(path, BIT_DB_MMAP_READONLY);
+  success = success && mapped && BitDB_count_at(mapped, 5) == 698;
+  if (mapped)
+    BitDB_free(&mapped);
+
+  // A flipped row bit is caught by the checksum, a bad header always
+  FILE *file = fopen(path, "r+b");
+  fseek(file, 4096 + 5 * 128, SEEK_SET);
+  fputc(0xFF, file);
+  fclose(file);
+  success = success && BitDB_open_mmap(path, BIT_DB_MMAP_VERIFY) == NULL;
+  file = fopen(path, "r+b");
+  fputc('X', file);
+  fclose(file);
+  success = success && BitDB_open_mmap(path, 0) == NULL &&
+            BitDB_open_mmap("no_such_file.bdb", 0) == NULL;
+  remove(path);
+
+  Bit_free(&bit);
+  BitDB_free(&db);
+  report_test(__func__, success);
+  return success;
+}
+
+typedef struct {
+  Bit_DB_T db;
+  int next;
+} stream_source;
+
+static int stream_next_block(void *cl, void *rows, int max_rows,
+                             int row_bytes) {
+  stream_source *source = cl;
+  int n = 0;
+  for (; n < max_rows && source->next < BitDB_nelem(source->db); n++)
+    BitDB_extract_from(source->db, source->next++,
+                       (unsigned char *)rows + (size_t)n * row_bytes);
+  return n;
+}
+
+typedef struct {
+  int *counts; // full nelem(bit) x nelem(bits) result being assembled
+  int nbits;
+  int ntargets;
+} stream_sink;
+
+static void stream_emit(void *cl, size_t first_row, int nrows,
+                        const int *counts) {
+  stream_sink *sink = cl;
+  for (int i = 0; i < sink->ntargets; i++)
+    for (int j = 0; j < nrows; j++)
+      sink->counts[(size_t)i * sink->nbits + first_row + j] =
+          counts[(size_t)i * nrows + j];
+}
+
+bool test_bitDB_count_stream() {
+  const int len = 1000, ntargets = 5, nbits = 23;
+  Bit_DB_T targets = BitDB_new(len, ntargets);
+  Bit_DB_T library = BitDB_new(len, nbits);
+  Bit_T bit = Bit_new(len);
+  for (int i = 0; i < nbits; i++) {
+    Bit_clear(bit, 0, len - 1);
+    Bit_set(bit, i, i + 10 * (i % 7));
+    BitDB_put_at(library, i, bit);
+    if (i < ntargets)
+      BitDB_put_at(targets, i, bit);
+  }
+  int *expected =
+      BitDB_inter_count(targets, library, (SETOP_COUNT_OPTS){}, cpu);
+  int *streamed = calloc(ntargets * nbits, sizeof(int));
+  stream_sink sink = {streamed, nbits, ntargets};
+
+  // Callback source, with a short last block
+  stream_source source = {library, 0};
+  BitDB_inter_count_stream_cpu(targets, stream_next_block, &source, 4,
+                               stream_emit, &sink,
+                               (SETOP_COUNT_OPTS){.num_cpu_threads = 2});
+  bool success =
+      memcmp(expected, streamed, ntargets * nbits * sizeof(int)) == 0;
+
+  // File source
+  FILE *file = tmpfile();
+  unsigned char row[Bit_buffer_size(1000)];
+  for (int i = 0; i < nbits; i++) {
+    BitDB_extract_from(library, i, row);
+    fwrite(row, 1, sizeof(row), file);
+  }
+  rewind(file);
+  memset(streamed, 0, ntargets * nbits * sizeof(int));
+  int *minus = BitDB_minus_count(targets, library, (SETOP_COUNT_OPTS){}, cpu);
+  BitDB_minus_count_stream_cpu(targets, BitDB_stream_read_file, file, 8,
+                               stream_emit, &sink, (SETOP_COUNT_OPTS){});
+  success = success &&
+            memcmp(minus, streamed, ntargets * nbits * sizeof(int)) == 0;
+  fclose(file);
+
+  free(expected);
+  free(minus);
+  free(streamed);
+  Bit_free(&bit);
+  BitDB_free(&targets);
+  BitDB_free(&library);
+  report_test(__func__, success);
+  return success;
+}
+
+bool test_bitDB_topk_threshold() {
+  const int len = 256, nq = 70, nt = 1100, k = 5, threshold = 40;
+  Bit_DB_T queries = BitDB_new(len, nq);
+  Bit_DB_T targets = BitDB_new(len, nt);
+  Bit_T bit = Bit_new(len);
+  unsigned int seed = 12345;
+  for (int i = 0; i < nq + nt; i++) {
+    Bit_clear(bit, 0, len - 1);
+    for (int b = 0; b < len; b++) {
+      seed = seed * 1103515245u + 12345u;
+      if ((seed >> 16) % 3 == 0)
+        Bit_bset(bit, b);
+    }
+    BitDB_put_at(i < nq ? queries : targets, i < nq ? i : i - nq, bit);
+  }
+  SETOP_COUNT_OPTS opts = {.num_cpu_threads = 3};
+  int *full = BitDB_inter_count(queries, targets, opts, cpu);
+
+  int *idx = malloc(nq * k * sizeof(int));
+  int *count = malloc(nq * k * sizeof(int));
+  BitDB_inter_count_topk(queries, targets, k, opts, idx, count);
+  bool success = true;
+  for (int q = 0; q < nq; q++) {
+    const int *row = full + (size_t)q * nt;
+    for (int r = 0; r < k; r++) {
+      int j = idx[q * k + r];
+      success = success && count[q * k + r] == row[j];
+      if (r > 0) // ranked, ties by index
+        success = success && (count[q * k + r - 1] > count[q * k + r] ||
+                              (count[q * k + r - 1] == count[q * k + r] &&
+                               idx[q * k + r - 1] < j));
+    }
+    int better = 0; // no target outside the top-k may beat the k-th
+    int worst = count[q * k + k - 1], worst_idx = idx[q * k + k - 1];
+    for (int j = 0; j < nt; j++)
+      better += row[j] > worst || (row[j] == worst && j <= worst_idx);
+    success = success && better == k;
+  }
+
+  size_t offsets[70 + 1];
+  int *match_idx, *match_count;
+  size_t total = BitDB_inter_count_threshold(queries, targets, threshold, opts,
+                                             offsets, &match_idx, &match_count);
+  size_t expected = 0;
+  for (int q = 0; q < nq; q++)
+    for (int j = 0; j < nt; j++)
+      if (full[(size_t)q * nt + j] >= threshold) {
+        success = success && match_idx[expected] == j &&
+                  match_count[expected] == full[(size_t)q * nt + j];
+        expected++;
+      }
+  success = success && total == expected && offsets[nq] == total && total > 0;
+
+  // More slots than targets are padded with -1
+  Bit_DB_T few = BitDB_new(len, 2);
+  int few_idx[3 * 70], few_count[3 * 70];
+  BitDB_inter_count_topk(queries, few, 3, opts, few_idx, few_count);
+  success = success && few_idx[2] == -1 && few_count[2] == -1 &&
+            few_idx[0] == 0 && few_idx[1] == 1;
+
+  free(match_idx);
+  free(match_count);
+  free(idx);
+  free(count);
+  free(full);
+  Bit_free(&bit);
+  BitDB_free(&few);
+  BitDB_free(&queries);
+  BitDB_free(&targets);
+  report_test(__func__, success);
+  return success;
+}
+
+bool test_bitDB_similarity() {
+  const int len = 192, nq = 40, nt = 300, k = 4;
+  Bit_DB_T queries = BitDB_new(len, nq);
+  Bit_DB_T targets = BitDB_new(len, nt);
+  Bit_T bit = Bit_new(len);
+  unsigned int seed = 4242;
+  for (int i = 0; i < nq + nt - 1; i++) { // the last target stays empty
+    Bit_clear(bit, 0, len - 1);
+    for (int b = 0; b < len; b++) {
+      seed = seed * 1103515245u + 12345u;
+      if ((seed >> 16) % 4 == 0)
+        Bit_bset(bit, b);
+    }
+    BitDB_put_at(i < nq ? queries : targets, i < nq ? i : i - nq, bit);
+  }
+  SETOP_COUNT_OPTS opts = {.num_cpu_threads = 3};
+  int *full = BitDB_inter_count(queries, targets, opts, cpu);
+  int *qc = BitDB_count(queries);
+  int *tc = BitDB_count(targets);
+  BitDB_cache_counts(targets, true, opts); // one side cached, one not
+
+  bool success = true;
+  float *sim = malloc(BitDB_counts_size(queries, targets) * sizeof(float));
+  uint16_t *fixed =
+      malloc(BitDB_counts_size(queries, targets) * sizeof(uint16_t));
+  Bit_similarity metrics[] = {{BIT_SIMILARITY_TANIMOTO, 0, 0},
+                              {BIT_SIMILARITY_DICE, 0, 0},
+                              {BIT_SIMILARITY_COSINE, 0, 0},
+                              {BIT_SIMILARITY_TVERSKY, 0.7, 0.3}};
+  for (int m = 0; m < 4; m++) {
+    BitDB_similarity_store_cpu(queries, targets, metrics[m], sim, opts);
+    for (int q = 0; q < nq; q++)
+      for (int j = 0; j < nt; j++) {
+        size_t at = BitDB_counts_offset(targets, q, j);
+        double c = full[at], a = qc[q], b = tc[j], got = sim[at], want;
+        if (m == 0)
+          want = c / (a + b - c);
+        else if (m == 1)
+          want = 2 * c / (a + b);
+        else if (m == 2) { // compare squares to stay clear of libm
+          want = b ? c * c / (a * b) : 0;
+          got *= got;
+        }
+        else
+          want = c / (c + 0.7 * (a - c) + 0.3 * (b - c));
+        if (j == nt - 1)
+          want = 0; // empty target: zero, not NaN
+        success = success && got > want - 1e-5 && got < want + 1e-5;
+      }
+  }
+
+  // 16 bit fixed point agrees with the floats to the quantization step
+  BitDB_similarity_store_cpu(queries, targets, metrics[0], sim, opts);
+  BitDB_similarity_u16_store_cpu(queries, targets, metrics[0], fixed, opts);
+  for (size_t i = 0; i < BitDB_counts_size(queries, targets); i++) {
+    double diff = fixed[i] / 65535.0 - sim[i];
+    success = success && diff < 1.0 / 65535 && diff > -1.0 / 65535;
+  }
+
+  // Top-k and threshold outputs match the full Tanimoto matrix
+  int *idx = malloc(nq * k * sizeof(int));
+  float *best = malloc(nq * k * sizeof(float));
+  BitDB_similarity_topk(queries, targets, metrics[0], k, opts, idx, best);
+  for (int q = 0; q < nq; q++) {
+    const float *row = sim + (size_t)q * nt;
+    for (int r = 0; r < k; r++)
+      success = success && best[q * k + r] == row[idx[q * k + r]] &&
+                (r == 0 || best[q * k + r - 1] >= best[q * k + r]);
+    int better = 0;
+    for (int j = 0; j < nt; j++)
+      better += row[j] > best[q * k + k - 1];
+    success = success && better < k;
+  }
+  size_t offsets[40 + 1];
+  int *match_idx;
+  float *match_sim;
+  size_t total = BitDB_similarity_threshold(
+      queries, targets, metrics[0], 0.2f, opts, offsets, &match_idx,
+      &match_sim);
+  size_t expected = 0;
+  for (int q = 0; q < nq; q++)
+    for (int j = 0; j < nt; j++)
+      if (sim[(size_t)q * nt + j] >= 0.2f) {
+        success = success && match_idx[expected] == j &&
+                  match_sim[expected] == sim[(size_t)q * nt + j];
+        expected++;
+      }
+  success = success && total == expected && offsets[nq] == total && total > 0;
+
+  free(match_idx);
+  free(match_sim);
+  free(idx);
+  free(best);
+  free(sim);
+  free(fixed);
+  free(qc);
+  free(tc);
+  free(full);
+  Bit_free(&bit);
+  BitDB_free(&queries);
+  BitDB_free(&targets);
+  report_test(__func__, success);
+  return success;
+}
+
+bool test_bitDB_multi_count() {
+  const int len = 300, nq = 37, nt = 129;
+  Bit_DB_T queries = BitDB_new(len, nq);
+  Bit_DB_T targets = BitDB_new(len, nt);
+  Bit_T bit = Bit_new(len);
+  unsigned int seed = 777;
+  for (int i = 0; i < nq + nt; i++) {
+    Bit_clear(bit, 0, len - 1);
+    for (int b = 0; b < len; b++) {
+      seed = seed * 1103515245u + 12345u;
+      if ((seed >> 16) % 5 < 2)
+        Bit_bset(bit, b);
+    }
+    BitDB_put_at(i < nq ? queries : targets, i < nq ? i : i - nq, bit);
+  }
+  SETOP_COUNT_OPTS opts = {.num_cpu_threads = 2};
+  size_t size = BitDB_counts_size(queries, targets);
+  int *want[4] = {BitDB_inter_count(queries, targets, opts, cpu),
+                  BitDB_union_count(queries, targets, opts, cpu),
+                  BitDB_diff_count(queries, targets, opts, cpu),
+                  BitDB_minus_count(queries, targets, opts, cpu)};
+  int *got[4];
+  for (int o = 0; o < 4; o++)
+    got[o] = calloc(size, sizeof(int));
+
+  bool success = true;
+  BitDB_multi_count_store(queries, targets, BIT_COUNT_ALL, got[0], got[1],
+                          got[2], got[3], opts);
+  for (int o = 0; o < 4; o++)
+    success = success && memcmp(got[o], want[o], size * sizeof(int)) == 0;
+
+  // A subset leaves the other buffers alone, and NULL is fine for them
+  memset(got[1], 0, size * sizeof(int));
+  memset(got[3], 0, size * sizeof(int));
+  BitDB_multi_count_store(queries, targets, BIT_COUNT_UNION | BIT_COUNT_MINUS,
+                          NULL, got[1], NULL, got[3], opts);
+  success = success && memcmp(got[1], want[1], size * sizeof(int)) == 0 &&
+            memcmp(got[3], want[3], size * sizeof(int)) == 0;
+
+  for (int o = 0; o < 4; o++) {
+    free(got[o]);
+    free(want[o]);
+  }
+  Bit_free(&bit);
+  BitDB_free(&queries);
+  BitDB_free(&targets);
+  report_test(__func__, success);
+  return success;
+}
+
+bool test_bit_tuning() {
+  const int len = 5000, nq = 23, nt = 41; // odd sizes exercise the fringes
+  Bit_DB_T queries = BitDB_new_padded(len, nq, 64);
+  Bit_DB_T targets = BitDB_new(len, nt);
+  Bit_T bit = Bit_new(len);
+  unsigned int seed = 99;
+  for (int i = 0; i < nq + nt; i++) {
+    Bit_clear(bit, 0, len - 1);
+    for (int b = 0; b < len; b++) {
+      seed = seed * 1103515245u + 12345u;
+      if ((seed >> 16) % 3 == 0)
+        Bit_bset(bit, b);
+    }
+    BitDB_put_at(i < nq ? queries : targets, i < nq ? i : i - nq, bit);
+  }
+  SETOP_COUNT_OPTS opts = {.num_cpu_threads = 2};
+  size_t size = BitDB_counts_size(queries, targets);
+  int *want = BitDB_minus_count(queries, targets, opts, cpu);
+  int *got = malloc(size * sizeof(int));
+
+  // Every register block and a few tile shapes agree with the default
+  bool success = true;
+  const int tiles[] = {1, 7, 64}, k_blocks[] = {8, 24, 1024};
+  for (int b = 0; b < BIT_TUNING_BLOCK_COUNT; b++)
+    for (int t = 0; t < 3; t++) {
+      Bit_tuning tuning = {(Bit_tuning_block)b, tiles[t], k_blocks[t], 0};
+      opts.tuning = &tuning;
+      BitDB_minus_count_store_cpu(queries, targets, got, opts);
+      success = success && memcmp(got, want, size * sizeof(int)) == 0;
+      // prefetching ahead of the next pass leaves the counts alone
+      tuning.prefetch = 2 + t;
+      BitDB_minus_count_store_cpu(queries, targets, got, opts);
+      success = success && memcmp(got, want, size * sizeof(int)) == 0;
+    }
+  opts.tuning = NULL;
+
+  // Profiles round trip and become the process-wide tuning
+  const char *path = "test_bit_tuning.profile";
+  Bit_tuning saved = {BIT_TUNING_BLOCK_4X2, 48, 512, 4};
+  success = success && Bit_tuning_save(path, saved) == 0 &&
+            Bit_tuning_load(path) == 0;
+  Bit_tuning active = Bit_tuning_get();
+  success = success && active.block == saved.block &&
+            active.tile == saved.tile && active.k_block == saved.k_block &&
+            active.prefetch == saved.prefetch;
+  BitDB_minus_count_store_cpu(queries, targets, got, opts);
+  success = success && memcmp(got, want, size * sizeof(int)) == 0;
+
+  // A profile of another ISA or a missing file leaves the tuning alone
+  FILE *file = fopen(path, "w");
+  fputs("isa no_such_isa\nblock 1x1\ntile 8\nk_block 64\n", file);
+  fclose(file);
+  success = success && Bit_tuning_load(path) == -1 &&
+            Bit_tuning_load("no/such/profile") == -1 &&
+            Bit_tuning_get().tile == saved.tile;
+
+  // The autotuner installs and persists a valid winner
+  Bit_tuning tuned = Bit_tuning_autotune(1024, 64, opts, path);
+  success = success && tuned.block >= 0 &&
+            tuned.block < BIT_TUNING_BLOCK_COUNT && tuned.tile > 0 &&
+            tuned.k_block % 8 == 0 && tuned.prefetch >= 0 &&
+            Bit_tuning_get().tile == tuned.tile &&
+            Bit_tuning_load(path) == 0;
+  BitDB_minus_count_store_cpu(queries, targets, got, opts);
+  success = success && memcmp(got, want, size * sizeof(int)) == 0;
+
+  Bit_tuning_set(Bit_tuning_defaults());
+  remove(path);
+  free(want);
+  free(got);
+  Bit_free(&bit);
+  BitDB_free(&queries);
+  BitDB_free(&targets);
+  report_test(__func__, success);
+  return success;
+}
+
+bool test_bitDB_sliced() {
+  const int len = 700, nq = 13, nt = 150; // a ragged last group of targets
+  Bit_DB_T queries = BitDB_new(len, nq);
+  Bit_DB_T targets = BitDB_new_padded(len, nt, 64);
+  Bit_T bit = Bit_new(len);
+  unsigned int seed = 4711;
+  for (int i = 0; i < nq + nt; i++) {
+    Bit_clear(bit, 0, len - 1);
+    for (int b = 0; b < len; b++) {
+      seed = seed * 1103515245u + 12345u;
+      if ((seed >> 16) % 4 == 0)
+        Bit_bset(bit, b);
+    }
+    BitDB_put_at(i < nq ? queries : targets, i < nq ? i : i - nq, bit);
+  }
+  size_t size = BitDB_counts_size(queries, targets);
+  int *want = malloc(size * sizeof(int));
+  int *got = malloc(size * sizeof(int));
+
+  // Sliced tiles of one or several groups, with a partial k_block, agree
+  // with the 1x1 block for every op
+  bool success = true;
+  const int tiles[] = {1, 100}, k_blocks[] = {8, 1024};
+  for (int t = 0; t < 2; t++) {
+    Bit_tuning plain = {BIT_TUNING_BLOCK_1X1, tiles[t], k_blocks[t], 0};
+    Bit_tuning sliced = {BIT_TUNING_BLOCK_SLICED, tiles[t], k_blocks[t], 0};
+    SETOP_COUNT_OPTS want_opts = {.num_cpu_threads = 2, .tuning = &plain};
+    SETOP_COUNT_OPTS got_opts = {.num_cpu_threads = 2, .tuning = &sliced};
+    BitDB_inter_count_store_cpu(queries, targets, want, want_opts);
+    BitDB_inter_count_store_cpu(queries, targets, got, got_opts);
+    success = success && memcmp(got, want, size * sizeof(int)) == 0;
+    BitDB_union_count_store_cpu(queries, targets, want, want_opts);
+    BitDB_union_count_store_cpu(queries, targets, got, got_opts);
+    success = success && memcmp(got, want, size * sizeof(int)) == 0;
+    BitDB_diff_count_store_cpu(queries, targets, want, want_opts);
+    BitDB_diff_count_store_cpu(queries, targets, got, got_opts);
+    success = success && memcmp(got, want, size * sizeof(int)) == 0;
+    BitDB_minus_count_store_cpu(queries, targets, want, want_opts);
+    BitDB_minus_count_store_cpu(queries, targets, got, got_opts);
+    success = success && memcmp(got, want, size * sizeof(int)) == 0;
+  }
+
+  free(want);
+  free(got);
+  Bit_free(&bit);
+  BitDB_free(&queries);
+  BitDB_free(&targets);
+  report_test(__func__, success);
+  return success;
+}
+
+bool test_bitDB_self_join() {
+  const int len = 200, n = 300; // three blocks, the last one ragged
+  Bit_DB_T set = BitDB_new(len, n);
+  Bit_T bit = Bit_new(len);
+  unsigned int seed = 2024;
+  for (int i = 0; i < n; i++) {
+    Bit_clear(bit, 0, len - 1);
+    for (int b = 0; b < len; b++) {
+      seed = seed * 1103515245u + 12345u;
+      if ((seed >> 16) % 4 == 0)
+        Bit_bset(bit, b);
+    }
+    BitDB_put_at(set, i, bit);
+  }
+  SETOP_COUNT_OPTS opts = {.num_cpu_threads = 3};
+  int *want[3] = {BitDB_inter_count(set, set, opts, cpu),
+                  BitDB_union_count(set, set, opts, cpu),
+                  BitDB_diff_count(set, set, opts, cpu)};
+  void (*self[3])(Bit_DB_T, int *, Bit_self_layout, SETOP_COUNT_OPTS) = {
+      BitDB_inter_count_self_cpu, BitDB_union_count_self_cpu,
+      BitDB_diff_count_self_cpu};
+  size_t full = BitDB_self_counts_size(set, BIT_SELF_MIRROR);
+  size_t packed = BitDB_self_counts_size(set, BIT_SELF_PACKED);
+  bool success = full == (size_t)n * n && packed == (size_t)n * (n + 1) / 2;
+  int *mirror = malloc(full * sizeof(int));
+  int *upper = malloc(packed * sizeof(int));
+  for (int o = 0; o < 3; o++) {
+    self[o](set, mirror, BIT_SELF_MIRROR, opts);
+    self[o](set, upper, BIT_SELF_PACKED, opts);
+    success = success && memcmp(mirror, want[o], full * sizeof(int)) == 0;
+    for (int i = 0; i < n; i++)
+      for (int j = 0; j < n; j++)
+        success = success &&
+                  upper[BitDB_self_counts_offset(set, i, j,
+                                                 BIT_SELF_PACKED)] ==
+                      want[o][(size_t)i * n + j];
+  }
+  success = success &&
+            BitDB_self_counts_offset(set, 1, 0, BIT_SELF_PACKED) == 1 &&
+            BitDB_self_counts_offset(set, 1, 1, BIT_SELF_PACKED) == (size_t)n;
+
+  for (int o = 0; o < 3; o++)
+    free(want[o]);
+  free(mirror);
+  free(upper);
+  Bit_free(&bit);
+  BitDB_free(&set);
+  report_test(__func__, success);
+  return success;
+}
+
+bool test_bitDB_numa() {
+  const int len = 300, n = 150;
+  SETOP_COUNT_OPTS opts = {.num_cpu_threads = 3};
+  Bit_DB_T plain = BitDB_new(len, n);
+  Bit_DB_T first = BitDB_new_numa(len, n, 64, BIT_NUMA_FIRST_TOUCH, opts);
+  Bit_DB_T spread = BitDB_new_numa(len, n, 0, BIT_NUMA_INTERLEAVE, opts);
+  bool success = BitDB_nelem(first) == n && BitDB_nelem(spread) == n;
+  for (int i = 0; i < n; i++) // placed rows start zeroed
+    success = success && BitDB_count_at(first, i) == 0 &&
+              BitDB_count_at(spread, i) == 0;
+  Bit_T bit = Bit_new(len);
+  unsigned int seed = 77;
+  for (int i = 0; i < n + 40; i++) { // the last rows grow the containers
+    Bit_clear(bit, 0, len - 1);
+    for (int b = 0; b < len; b++) {
+      seed = seed * 1103515245u + 12345u;
+      if ((seed >> 16) % 3 == 0)
+        Bit_bset(bit, b);
+    }
+    if (i < n) {
+      BitDB_put_at(plain, i, bit);
+      BitDB_put_at(first, i, bit);
+      BitDB_put_at(spread, i, bit);
+    } else {
+      BitDB_append(plain, bit);
+      BitDB_append(first, bit);
+      BitDB_append(spread, bit);
+    }
+  }
+  int *want = BitDB_inter_count(plain, plain, opts, cpu);
+  int *got_first = BitDB_inter_count(first, spread, opts, cpu);
+  int *got_spread = BitDB_inter_count(spread, first, opts, cpu);
+  size_t ncounts = (size_t)(n + 40) * (n + 40) * sizeof(int);
+  success = success && BitDB_nelem(first) == n + 40 &&
+            memcmp(want, got_first, ncounts) == 0 &&
+            memcmp(want, got_spread, ncounts) == 0;
+
+  free(want);
+  free(got_first);
+  free(got_spread);
+  Bit_free(&bit);
+  BitDB_free(&plain);
+  BitDB_free(&first);
+  BitDB_free(&spread);
+  report_test(__func__, success);
+  return success;
+}
+
+bool test_bitDB_small_batch() {
+  const int len = 500, ntargets = 3001; // ragged last target tile
+  Bit_DB_T targets = BitDB_new(len, ntargets);
+  Bit_DB_T queries = BitDB_new(len, 5);
+  Bit_T bit = Bit_new(len);
+  unsigned int seed = 4242;
+  for (int i = 0; i < ntargets + 5; i++) {
+    Bit_clear(bit, 0, len - 1);
+    for (int b = 0; b < len; b++) {
+      seed = seed * 1103515245u + 12345u;
+      if ((seed >> 16) % 3 == 0)
+        Bit_bset(bit, b);
+    }
+    if (i < ntargets)
+      BitDB_put_at(targets, i, bit);
+    else
+      BitDB_put_at(queries, i - ntargets, bit);
+  }
+  bool success = true;
+  SETOP_COUNT_OPTS opts = {.num_cpu_threads = 8};
+  int *counts = BitDB_inter_count(queries, targets, opts, cpu);
+  for (int q = 0; q < 5; q++) {
+    Bit_T query = BitDB_get_from(queries, q);
+    for (int t = 0; t < ntargets; t++) {
+      Bit_T target = BitDB_get_from(targets, t);
+      success = success && counts[(size_t)q * ntargets + t] ==
+                               Bit_inter_count(query, target);
+      Bit_free(&target);
+    }
+    Bit_free(&query);
+  }
+  // one query: the target tiles narrow until the team has work
+  Bit_DB_T one = BitDB_new(len, 1);
+  BitDB_put_at(one, 0, bit);
+  int *row = BitDB_inter_count(one, targets, opts, cpu);
+  success = success && memcmp(row, counts + (size_t)4 * ntargets,
+                              ntargets * sizeof(int)) == 0;
+
+  free(counts);
+  free(row);
+  Bit_free(&bit);
+  BitDB_free(&one);
+  BitDB_free(&queries);
+  BitDB_free(&targets);
+  report_test(__func__, success);
+  return success;
+}
+
+bool test_bit_ctx() {
+  const int len = 256, nq = 70, nt = 1100; // ragged search tiles
+  Bit_DB_T queries = BitDB_new(len, nq);
+  Bit_DB_T targets = BitDB_new(len, nt);
+  Bit_T bit = Bit_new(len);
+  unsigned int seed = 99;
+  for (int i = 0; i < nq + nt; i++) {
+    Bit_clear(bit, 0, len - 1);
+    for (int b = 0; b < len; b++) {
+      seed = seed * 1103515245u + 12345u;
+      if ((seed >> 16) % 3 == 0)
+        Bit_bset(bit, b);
+    }
+    BitDB_put_at(i < nq ? queries : targets, i < nq ? i : i - nq, bit);
+  }
+  SETOP_COUNT_OPTS plain = {.num_cpu_threads = 3};
+  int *want = BitDB_inter_count(queries, targets, plain, cpu);
+  const int k = 5;
+  int want_idx[nq * k], want_count[nq * k], idx[nq * k], count[nq * k];
+  BitDB_inter_count_topk(queries, targets, k, plain, want_idx, want_count);
+
+  Bit_ctx_T ctx = Bit_ctx_new(3, 0, NULL);
+  SETOP_COUNT_OPTS opts = Bit_ctx_opts(ctx);
+  bool success = opts.num_cpu_threads == 3 && opts.ctx == ctx;
+  for (int rep = 0; rep < 3; rep++) { // the scratch is reused
+    int *counts = Bit_ctx_counts(ctx, BitDB_counts_size(queries, targets));
+    BitDB_inter_count_store_cpu(queries, targets, counts, opts);
+    BitDB_inter_count_topk(queries, targets, k, opts, idx, count);
+    success = success && counts == Bit_ctx_counts(ctx, 1) &&
+              memcmp(counts, want, (size_t)nq * nt * sizeof(int)) == 0 &&
+              memcmp(idx, want_idx, sizeof(idx)) == 0 &&
+              memcmp(count, want_count, sizeof(count)) == 0;
+  }
+  Bit_ctx_free(&ctx);
+  success = success && ctx == NULL;
+
+  free(want);
+  Bit_free(&bit);
+  BitDB_free(&queries);
+  BitDB_free(&targets);
+  report_test(__func__, success);
+  return success;
+}
+
+bool test_bitDB_query_count() {
+  const int len = 1000, n = 777;
+  Bit_DB_T packed = BitDB_new(len, n);
+  Bit_DB_T padded = BitDB_new_padded(len, n, 64);
+  Bit_DB_T one = BitDB_new(len, 1);
+  Bit_T bit = Bit_new(len);
+  unsigned int seed = 31337;
+  for (int i = 0; i <= n; i++) { // the last bitset is the query
+    Bit_clear(bit, 0, len - 1);
+    for (int b = 0; b < len; b++) {
+      seed = seed * 1103515245u + 12345u;
+      if ((seed >> 16) % 3 == 0)
+        Bit_bset(bit, b);
+    }
+    if (i < n) {
+      BitDB_put_at(packed, i, bit);
+      BitDB_put_at(padded, i, bit);
+    }
+  }
+  BitDB_put_at(one, 0, bit);
+  SETOP_COUNT_OPTS opts = {.num_cpu_threads = 3};
+  const Bit_count_ops ops[] = {BIT_COUNT_INTER, BIT_COUNT_UNION,
+                               BIT_COUNT_DIFF, BIT_COUNT_MINUS};
+  int *want[4] = {BitDB_inter_count(one, packed, opts, cpu),
+                  BitDB_union_count(one, packed, opts, cpu),
+                  BitDB_diff_count(one, packed, opts, cpu),
+                  BitDB_minus_count(one, packed, opts, cpu)};
+  int *got = malloc(n * sizeof(int));
+  bool success = true;
+  for (int o = 0; o < 4; o++) {
+    BitDB_query_count_store(bit, packed, ops[o], got, opts);
+    success = success && memcmp(got, want[o], n * sizeof(int)) == 0;
+    BitDB_query_count_store(bit, padded, ops[o], got, opts);
+    success = success && memcmp(got, want[o], n * sizeof(int)) == 0;
+  }
+
+  for (int o = 0; o < 4; o++)
+    free(want[o]);
+  free(got);
+  Bit_free(&bit);
+  BitDB_free(&one);
+  BitDB_free(&packed);
+  BitDB_free(&padded);
+  report_test(__func__, success);
+  return success;
+}
+
+bool test_bitDB_query_queue() {
+  const int len = 512, n = 300, nq = 40;
+  Bit_DB_T db = BitDB_new(len, n);
+  Bit_DB_T queries = BitDB_new(len, nq);
+  Bit_T bit = Bit_new(len);
+  unsigned int seed = 5150;
+  for (int i = 0; i < n + nq; i++) {
+    Bit_clear(bit, 0, len - 1);
+    for (int b = 0; b < len; b++) {
+      seed = seed * 1103515245u + 12345u;
+      if ((seed >> 16) % 3 == 0)
+        Bit_bset(bit, b);
+    }
+    BitDB_put_at(i < n ? db : queries, i < n ? i : i - n, bit);
+  }
+  Bit_free(&bit);
+  SETOP_COUNT_OPTS opts = {.num_cpu_threads = 2};
+  int *want = BitDB_union_count(queries, db, opts, cpu);
+
+  // batches of 8 from four submitting threads; the latency budget flushes
+  // the ragged last batch
+  Bit_queue_T queue = BitDB_queue_new(db, BIT_COUNT_UNION, 8, 0.002, opts);
+  int *got = malloc((size_t)nq * n * sizeof(int));
+  bool success = true;
+#pragma omp parallel for num_threads(4) schedule(static, 1)
+  for (int i = 0; i < nq; i++) {
+    Bit_T q = BitDB_get_from(queries, i);
+    Bit_query_T ticket = BitDB_query_submit(queue, q);
+    BitDB_query_wait(&ticket, got + (size_t)i * n);
+    Bit_free(&q);
+  }
+  success = memcmp(got, want, (size_t)nq * n * sizeof(int)) == 0;
+
+  // one thread holding several tickets at once
+  Bit_query_T tickets[3];
+  for (int i = 0; i < 3; i++) {
+    Bit_T q = BitDB_get_from(queries, i);
+    tickets[i] = BitDB_query_submit(queue, q);
+    Bit_free(&q);
+  }
+  for (int i = 2; i >= 0; i--) {
+    BitDB_query_wait(&tickets[i], got);
+    success = success && tickets[i] == NULL &&
+              memcmp(got, want + (size_t)i * n, n * sizeof(int)) == 0;
+  }
+  BitDB_queue_free(&queue);
+  success = success && queue == NULL;
+
+  free(want);
+  free(got);
+  BitDB_free(&db);
+  BitDB_free(&queries);
+  report_test(__func__, success);
+  return success;
+}
+
+bool test_bitDB_sort_by_count() {
+  const int len = 256, n = 2500, nq = 90, k = 4;
+  Bit_DB_T targets = BitDB_new(len, n);
+  Bit_DB_T original = BitDB_new(len, n);
+  Bit_DB_T queries = BitDB_new(len, nq);
+  Bit_T bit = Bit_new(len);
+  unsigned int seed = 8086;
+  for (int i = 0; i < n + nq; i++) { // densities from 1/2 down to 1/12
+    int every = 2 + i % 11;
+    Bit_clear(bit, 0, len - 1);
+    for (int b = 0; b < len; b++) {
+      seed = seed * 1103515245u + 12345u;
+      if ((seed >> 16) % every == 0)
+        Bit_bset(bit, b);
+    }
+    if (i < n) {
+      BitDB_put_at(targets, i, bit);
+      BitDB_put_at(original, i, bit);
+    } else {
+      BitDB_put_at(queries, i - n, bit);
+    }
+  }
+  Bit_free(&bit);
+  SETOP_COUNT_OPTS opts = {.num_cpu_threads = 2};
+  int *perm = malloc(n * sizeof(int));
+  BitDB_cache_counts(targets, true, opts);
+  BitDB_sort_by_count(targets, perm, opts);
+  BitDB_sort_by_count(queries, NULL, opts);
+  bool success = true;
+  for (int i = 0; i < n; i++) {
+    Bit_T row = BitDB_get_from(targets, i);
+    Bit_T was = BitDB_get_from(original, perm[i]);
+    success = success && Bit_eq(row, was) &&
+              BitDB_count_at(targets, i) == Bit_count(row) &&
+              (i == 0 || BitDB_count_at(targets, i - 1) <= Bit_count(row));
+    Bit_free(&row);
+    Bit_free(&was);
+  }
+
+  // pruned searches agree with the full similarity matrix
+  Bit_similarity sim = {BIT_SIMILARITY_TANIMOTO, 0, 0};
+  float *full = malloc((size_t)nq * n * sizeof(float));
+  BitDB_similarity_store_cpu(queries, targets, sim, full, opts);
+  const float cutoff = 0.6f;
+  size_t offsets[nq + 1];
+  int *match_idx;
+  float *match_sim;
+  BitDB_similarity_threshold(queries, targets, sim, cutoff, opts, offsets,
+                             &match_idx, &match_sim);
+  int idx[nq * k];
+  float best[nq * k];
+  BitDB_similarity_topk(queries, targets, sim, k, opts, idx, best);
+  for (int q = 0; q < nq; q++) {
+    const float *row = full + (size_t)q * n;
+    size_t m = offsets[q];
+    for (int j = 0; j < n; j++)
+      if (row[j] >= cutoff)
+        success = success && m < offsets[q + 1] && match_idx[m] == j &&
+                  match_sim[m++] == row[j];
+    success = success && m == offsets[q + 1];
+    for (int r = 0; r < k; r++) { // r-th best: higher score, then lower index
+      int want = -1;
+      for (int j = 0; j < n; j++) {
+        bool taken = false;
+        for (int p = 0; p < r; p++)
+          taken = taken || idx[q * k + p] == j;
+        if (!taken && (want < 0 || row[j] > row[want]))
+          want = j;
+      }
+      success = success && idx[q * k + r] == want &&
+                best[q * k + r] == row[want];
+    }
+  }
+
+  free(full);
+  free(match_idx);
+  free(match_sim);
+  free(perm);
+  BitDB_free(&targets);
+  BitDB_free(&original);
+  BitDB_free(&queries);
+  report_test(__func__, success);
+  return success;
+}
+
+bool test_bitDB_typed_counts() {
+  const int nq = 70, n = 1100;
+  const int lengths[] = {200, 1000};
+  const Bit_count_ops ops[] = {BIT_COUNT_INTER, BIT_COUNT_UNION,
+                               BIT_COUNT_DIFF, BIT_COUNT_MINUS};
+  void (*stores[])(Bit_DB_T, Bit_DB_T, int *, SETOP_COUNT_OPTS) = {
+      BitDB_inter_count_store_cpu, BitDB_union_count_store_cpu,
+      BitDB_diff_count_store_cpu, BitDB_minus_count_store_cpu};
+  SETOP_COUNT_OPTS opts = {.num_cpu_threads = 2};
+  unsigned int seed = 6502;
+  bool success = true;
+  for (int l = 0; l < 2; l++) {
+    const int len = lengths[l];
+    Bit_DB_T queries = BitDB_new(len, nq);
+    Bit_DB_T targets = BitDB_new(len, n);
+    Bit_T bit = Bit_new(len);
+    for (int i = 0; i < nq + n; i++) {
+      Bit_clear(bit, 0, len - 1);
+      for (int b = 0; b < len; b++) {
+        seed = seed * 1103515245u + 12345u;
+        if ((seed >> 16) % 3 == 0)
+          Bit_bset(bit, b);
+      }
+      BitDB_put_at(i < nq ? queries : targets, i < nq ? i : i - nq, bit);
+    }
+    Bit_free(&bit);
+    Bit_counts_type narrow = l == 0 ? BIT_COUNTS_U8 : BIT_COUNTS_U16;
+    success = success &&
+              BitDB_counts_type(queries, BIT_COUNTS_AUTO) == narrow &&
+              BitDB_counts_bytes(queries, targets, BIT_COUNTS_AUTO) ==
+                  (size_t)nq * n * (l == 0 ? 1 : 2);
+    size_t size = BitDB_counts_size(queries, targets);
+    int *want = malloc(size * sizeof(int));
+    int *wide = malloc(size * sizeof(int));
+    void *typed = malloc(BitDB_counts_bytes(queries, targets, narrow));
+    for (int o = 0; o < 4; o++) {
+      stores[o](queries, targets, want, opts);
+      success = success &&
+                BitDB_count_store_typed_cpu(queries, targets, ops[o], typed,
+                                            BIT_COUNTS_AUTO, opts) == narrow &&
+                BitDB_count_store_typed_gpu(queries, targets, ops[o], wide,
+                                            BIT_COUNTS_I32,
+                                            opts) == BIT_COUNTS_I32;
+      for (size_t i = 0; i < size; i++) {
+        int got = l == 0 ? ((uint8_t *)typed)[i] : ((uint16_t *)typed)[i];
+        success = success && got == want[i] && wide[i] == want[i];
+      }
+    }
+    free(want);
+    free(wide);
+    free(typed);
+    BitDB_free(&queries);
+    BitDB_free(&targets);
+  }
+  report_test(__func__, success);
+  return success;
+}
+
+bool test_bitDB_gpu_algorithms() {
+  const int len = 1000, nq = 9, n = 4500; // a partial GPU_ILP block of targets
+  Bit_DB_T queries = BitDB_new(len, nq);
+  Bit_DB_T targets = BitDB_new(len, n);
+  Bit_T bit = Bit_new(len);
+  unsigned int seed = 1802;
+  for (int i = 0; i < nq + n; i++) {
+    Bit_clear(bit, 0, len - 1);
+    for (int b = 0; b < len; b++) {
+      seed = seed * 1103515245u + 12345u;
+      if ((seed >> 16) % 3 == 0)
+        Bit_bset(bit, b);
+    }
+    BitDB_put_at(i < nq ? queries : targets, i < nq ? i : i - nq, bit);
+  }
+  size_t size = BitDB_counts_size(queries, targets);
+  size_t self_size = BitDB_counts_size(queries, queries);
+  int *want = malloc(size * sizeof(int));
+  int *got = malloc(size * sizeof(int));
+  bool success = true;
+  for (int algorithm = 0; algorithm < 4; algorithm++) {
+    SETOP_COUNT_OPTS opts = {.num_cpu_threads = 2, .algorithm = algorithm};
+    BitDB_minus_count_store_cpu(queries, targets, want, opts);
+    BitDB_minus_count_store_gpu(queries, targets, got, opts);
+    success = success && memcmp(want, got, size * sizeof(int)) == 0;
+
+    // a second call reuses the device layout of the targets
+    BitDB_inter_count_store_cpu(queries, targets, want, opts);
+    BitDB_inter_count_store_gpu(queries, targets, got, opts);
+    success = success && memcmp(want, got, size * sizeof(int)) == 0;
+
+    // swapped roles: the transposed targets are read as queries in place
+    BitDB_diff_count_store_cpu(targets, queries, want, opts);
+    BitDB_diff_count_store_gpu(targets, queries, got, opts);
+    success = success && memcmp(want, got, size * sizeof(int)) == 0;
+
+    // after a host update, the uploaded targets are read afresh
+    Bit_clear(bit, 0, len - 1);
+    Bit_set(bit, 0, len / 2);
+    BitDB_put_at(targets, algorithm, bit);
+    opts.upd_2nd_operand = true;
+    BitDB_inter_count_store_cpu(queries, targets, want, opts);
+    BitDB_inter_count_store_gpu(queries, targets, got, opts);
+    success = success && memcmp(want, got, size * sizeof(int)) == 0;
+
+    // both operands in one buffer
+    opts.release_1st_operand = true;
+    opts.release_2nd_operand = true;
+    opts.release_counts = true;
+    BitDB_union_count_store_cpu(queries, queries, want, opts);
+    BitDB_union_count_store_gpu(queries, queries, got, opts);
+    success = success && memcmp(want, got, self_size * sizeof(int)) == 0;
+  }
+  free(want);
+  free(got);
+  Bit_free(&bit);
+  BitDB_free(&queries);
+  BitDB_free(&targets);
+  report_test(__func__, success);
+  return success;
+}
+
+bool test_bitDB_count_async() {
+  const int len = 700, nq = 11, n = 4500; // 4500 is not a multiple of 1000
+  Bit_DB_T queries = BitDB_new(len, nq);
+  Bit_DB_T targets = BitDB_new(len, n);
+  Bit_T bit = Bit_new(len);
+  unsigned int seed = 1969;
+  for (int i = 0; i < nq + n; i++) {
+    Bit_clear(bit, 0, len - 1);
+    for (int b = 0; b < len; b++) {
+      seed = seed * 1103515245u + 12345u;
+      if ((seed >> 16) % 3 == 0)
+        Bit_bset(bit, b);
+    }
+    BitDB_put_at(i < nq ? queries : targets, i < nq ? i : i - nq, bit);
+  }
+  Bit_free(&bit);
+  const Bit_count_ops ops[] = {BIT_COUNT_INTER, BIT_COUNT_UNION,
+                               BIT_COUNT_DIFF, BIT_COUNT_MINUS};
+  void (*stores[])(Bit_DB_T, Bit_DB_T, int *, SETOP_COUNT_OPTS) = {
+      BitDB_inter_count_store_cpu, BitDB_union_count_store_cpu,
+      BitDB_diff_count_store_cpu, BitDB_minus_count_store_cpu};
+  SETOP_COUNT_OPTS opts = {.num_cpu_threads = 2};
+  size_t size = BitDB_counts_size(queries, targets);
+  int *want = malloc(size * sizeof(int));
+  int *got[2] = {malloc(size * sizeof(int)), malloc(size * sizeof(int))};
+  bool success = true;
+  for (int o = 0; o < 4; o += 2) { // two calls in flight at once
+    Bit_async_T first = BitDB_count_store_gpu_async(queries, targets, ops[o],
+                                                    got[0], 1000, opts);
+    Bit_async_T second = BitDB_count_store_gpu_async(
+        queries, targets, ops[o + 1], got[1], 0, opts);
+    BitDB_async_wait(&second);
+    BitDB_async_wait(&first);
+    success = success && first == NULL && second == NULL;
+    for (int w = 0; w < 2; w++) {
+      stores[o + w](queries, targets, want, opts);
+      success = success && memcmp(want, got[w], size * sizeof(int)) == 0;
+    }
+  }
+  free(want);
+  free(got[0]);
+  free(got[1]);
+  BitDB_free(&queries);
+  BitDB_free(&targets);
+  report_test(__func__, success);
+  return success;
+}
+
+bool test_bitDB_count_multi() {
+  const int len = 600, nq = 13, n = 3001;
+  Bit_DB_T queries = BitDB_new(len, nq);
+  Bit_DB_T targets = BitDB_new(len, n);
+  Bit_T bit = Bit_new(len);
+  unsigned int seed = 486;
+  for (int i = 0; i < nq + n; i++) {
+    Bit_clear(bit, 0, len - 1);
+    for (int b = 0; b < len; b++) {
+      seed = seed * 1103515245u + 12345u;
+      if ((seed >> 16) % 3 == 0)
+        Bit_bset(bit, b);
+    }
+    BitDB_put_at(i < nq ? queries : targets, i < nq ? i : i - nq, bit);
+  }
+  Bit_free(&bit);
+  const int devices[] = {0, 0, 0, 0}; // shards may share a device
+  const double weights[] = {1.0, 2.5, 0.0, 0.5};
+  SETOP_COUNT_OPTS opts = {.num_cpu_threads = 2};
+  size_t size = BitDB_counts_size(queries, targets);
+  int *want = malloc(size * sizeof(int));
+  int *got = malloc(size * sizeof(int));
+  BitDB_minus_count_store_cpu(queries, targets, want, opts);
+  BitDB_count_store_gpu_multi(queries, targets, BIT_COUNT_MINUS, got, devices,
+                              weights, 4, opts);
+  bool success = memcmp(want, got, size * sizeof(int)) == 0;
+
+  // the shards stay resident; equal shares cut them elsewhere
+  opts.release_1st_operand = opts.release_2nd_operand = true;
+  BitDB_inter_count_store_cpu(queries, targets, want, opts);
+  BitDB_count_store_gpu_multi(queries, targets, BIT_COUNT_INTER, got, devices,
+                              weights, 4, opts);
+  success = success && memcmp(want, got, size * sizeof(int)) == 0;
+  BitDB_count_store_gpu_multi(queries, targets, BIT_COUNT_INTER, got, devices,
+                              NULL, 3, opts);
+  success = success && memcmp(want, got, size * sizeof(int)) == 0;
+  free(want);
+  free(got);
+  BitDB_free(&queries);
+  BitDB_free(&targets);
+  report_test(__func__, success);
+  return success;
+}
+
+bool test_bitDB_device_attach() {
+  const int len = 600, nq = 7, n = 301;
+  Bit_DB_T queries = BitDB_new(len, nq);
+  Bit_DB_T targets = BitDB_new(len, n);
+  Bit_T bit = Bit_new(len);
+  unsigned int seed = 3607;
+  for (int i = 0; i < nq + n; i++) {
+    Bit_clear(bit, 0, len - 1);
+    for (int b = 0; b < len; b++) {
+      seed = seed * 1103515245u + 12345u;
+      if ((seed >> 16) % 3 == 0)
+        Bit_bset(bit, b);
+    }
+    BitDB_put_at(i < nq ? queries : targets, i < nq ? i : i - nq, bit);
+  }
+  BitDB_device_attach(targets, 0);
+  bool success = BitDB_device_sync(targets) == 0;
+
+  // row 5 twice, the run 6-7 and row 200 are dirty: four rows
+  unsigned char *buffer = malloc(Bit_buffer_size(len));
+  BitDB_extract_from(queries, 0, buffer);
+  BitDB_put_at(targets, 5, bit);
+  BitDB_replace_at(targets, 6, buffer);
+  BitDB_replace_at(targets, 7, buffer);
+  BitDB_clear_at(targets, 200);
+  BitDB_put_at(targets, 5, bit);
+  success = success && BitDB_device_sync(targets) == 4;
+  success = success && BitDB_device_sync(targets) == 0;
+
+  // growing maps the rows afresh; only the appended row is dirty then
+  BitDB_append(targets, bit);
+  success = success && BitDB_device_sync(targets) == 1;
+  BitDB_put_at(targets, 9, bit);
+  SETOP_COUNT_OPTS opts = {.num_cpu_threads = 2};
+  size_t size = BitDB_counts_size(queries, targets);
+  int *want = malloc(size * sizeof(int));
+  int *got = malloc(size * sizeof(int));
+  BitDB_inter_count_store_cpu(queries, targets, want, opts);
+  BitDB_inter_count_store_gpu(queries, targets, got, opts);
+  success = success && memcmp(want, got, size * sizeof(int)) == 0;
+  BitDB_device_detach(targets);
+
+  BitDB_device_attach(queries, 0); // freed while attached
+  free(buffer);
+  free(want);
+  free(got);
+  Bit_free(&bit);
+  BitDB_free(&queries);
+  BitDB_free(&targets);
+  report_test(__func__, success);
+  return success;
+}
+
+bool test_bitDB_search_gpu() {
+  const int len = 300, nq = 9, nt = 2000;
+  Bit_DB_T queries = BitDB_new(len, nq);
+  Bit_DB_T targets = BitDB_new(len, nt);
+  Bit_T bit = Bit_new(len);
+  unsigned int seed = 5150;
+  for (int i = 0; i < nq + nt; i++) {
+    Bit_clear(bit, 0, len - 1);
+    for (int b = 0; b < len; b++) {
+      seed = seed * 1103515245u + 12345u;
+      if ((seed >> 16) % 3 == 0)
+        Bit_bset(bit, b);
+    }
+    BitDB_put_at(i < nq ? queries : targets, i < nq ? i : i - nq, bit);
+  }
+  Bit_free(&bit);
+  SETOP_COUNT_OPTS opts = {.num_cpu_threads = 2};
+  bool success = true;
+
+  // k = 50 of 2000 targets, then more slots than targets, then a self-join
+  const int ks[] = {50, 7, 3};
+  Bit_DB_T few = BitDB_new(len, 2);
+  Bit_DB_T bits_of[] = {targets, few, queries};
+  for (int t = 0; t < 3; t++) {
+    Bit_DB_T bits = bits_of[t];
+    size_t slots = (size_t)nq * ks[t];
+    int *want_idx = malloc(slots * sizeof(int));
+    int *want_count = malloc(slots * sizeof(int));
+    int *got_idx = malloc(slots * sizeof(int));
+    int *got_count = malloc(slots * sizeof(int));
+    BitDB_inter_count_topk(queries, bits, ks[t], opts, want_idx, want_count);
+    BitDB_inter_count_topk_gpu(queries, bits, ks[t], opts, got_idx,
+                               got_count);
+    success = success && memcmp(want_idx, got_idx, slots * sizeof(int)) == 0 &&
+              memcmp(want_count, got_count, slots * sizeof(int)) == 0;
+    free(want_idx);
+    free(want_count);
+    free(got_idx);
+    free(got_count);
+  }
+
+  // a threshold of 0 matches every pair and outgrows the first device list
+  const int thresholds[] = {45, 0, 1000};
+  for (int t = 0; t < 3; t++) {
+    size_t want_offsets[9 + 1], got_offsets[9 + 1];
+    int *want_idx, *want_count, *got_idx, *got_count;
+    size_t want = BitDB_inter_count_threshold(queries, targets, thresholds[t],
+                                              opts, want_offsets, &want_idx,
+                                              &want_count);
+    size_t got = BitDB_inter_count_threshold_gpu(
+        queries, targets, thresholds[t], opts, got_offsets, &got_idx,
+        &got_count);
+    success = success && want == got &&
+              memcmp(want_offsets, got_offsets, sizeof(want_offsets)) == 0 &&
+              memcmp(want_idx, got_idx, want * sizeof(int)) == 0 &&
+              memcmp(want_count, got_count, want * sizeof(int)) == 0;
+    free(want_idx);
+    free(want_count);
+    free(got_idx);
+    free(got_count);
+  }
+  BitDB_free(&few);
+  BitDB_free(&queries);
+  BitDB_free(&targets);
+  report_test(__func__, success);
+  return success;
+}
+
+bool test_bitDB_count_hybrid() {
+  const int len = 500, nq = 17, n = 2500;
+  Bit_DB_T queries = BitDB_new(len, nq);
+  Bit_DB_T targets = BitDB_new(len, n);
+  Bit_T bit = Bit_new(len);
+  unsigned int seed = 2718;
+  for (int i = 0; i < nq + n; i++) {
+    Bit_clear(bit, 0, len - 1);
+    for (int b = 0; b < len; b++) {
+      seed = seed * 1103515245u + 12345u;
+      if ((seed >> 16) % 3 == 0)
+        Bit_bset(bit, b);
+    }
+    BitDB_put_at(i < nq ? queries : targets, i < nq ? i : i - nq, bit);
+  }
+  Bit_free(&bit);
+  SETOP_COUNT_OPTS opts = {.num_cpu_threads = 3};
+  size_t size = BitDB_counts_size(queries, targets);
+  int *want = malloc(size * sizeof(int));
+  int *got = malloc(size * sizeof(int));
+  bool success = true;
+  // repeated calls move the split; the counts may not move with it
+  for (int rep = 0; rep < 3; rep++) {
+    BitDB_union_count_store_cpu(queries, targets, want, opts);
+    BitDB_union_count_store(queries, targets, opts, got, hybrid);
+    success = success && memcmp(want, got, size * sizeof(int)) == 0;
+    BitDB_minus_count_store_cpu(queries, targets, want, opts);
+    BitDB_minus_count_store(queries, targets, opts, got, hybrid);
+    success = success && memcmp(want, got, size * sizeof(int)) == 0;
+  }
+  int *counts = BitDB_inter_count(queries, targets, opts, hybrid);
+  BitDB_inter_count_store_cpu(queries, targets, want, opts);
+  success = success && memcmp(want, counts, size * sizeof(int)) == 0;
+  double share = BitDB_hybrid_share(0);
+  success = success && share >= 0 && share <= 1;
+  free(counts);
+  free(want);
+  free(got);
+  BitDB_free(&queries);
+  BitDB_free(&targets);
+  report_test(__func__, success);
+  return success;
+}
+
+bool test_bitDB_pinned() {
+  const int len = 300, nq = 9, n = 120;
+  Bit_DB_T plain = BitDB_new(len, n);
+  Bit_DB_T pinned = BitDB_new_pinned(len, n, 64);
+  bool success = BitDB_nelem(pinned) == n;
+  for (int i = 0; i < n; i++) // pinned rows start zeroed
+    success = success && BitDB_count_at(pinned, i) == 0;
+  Bit_DB_T queries = BitDB_new_pinned(len, nq, 0);
+  Bit_T bit = Bit_new(len);
+  unsigned int seed = 4242;
+  for (int i = 0; i < nq + n + 30; i++) { // the last rows grow the containers
+    Bit_clear(bit, 0, len - 1);
+    for (int b = 0; b < len; b++) {
+      seed = seed * 1103515245u + 12345u;
+      if ((seed >> 16) % 3 == 0)
+        Bit_bset(bit, b);
+    }
+    if (i < nq) {
+      BitDB_put_at(queries, i, bit);
+    } else if (i < nq + n) {
+      BitDB_put_at(plain, i - nq, bit);
+      BitDB_put_at(pinned, i - nq, bit);
+    } else {
+      BitDB_append(plain, bit);
+      BitDB_append(pinned, bit);
+    }
+  }
+  Bit_free(&bit);
+  success = success && !BitDB_is_pinned(plain); // pinned is only a hint
+  SETOP_COUNT_OPTS opts = {.num_cpu_threads = 2};
+  size_t size = BitDB_counts_size(queries, pinned);
+  int *want = BitDB_inter_count(queries, plain, opts, cpu);
+  int *got = Bit_pinned_alloc(size * sizeof(int));
+  success = success && ((uintptr_t)got & 31) == 0;
+  for (size_t i = 0; i < size; i++) // pinned buffers start zeroed
+    success = success && got[i] == 0;
+  BitDB_inter_count_store_gpu(queries, pinned, got, opts);
+  success = success && BitDB_nelem(pinned) == n + 30 &&
+            memcmp(want, got, size * sizeof(int)) == 0;
+  free(want);
+  Bit_pinned_free(got);
+  Bit_pinned_free(NULL);
+  BitDB_free(&plain);
+  BitDB_free(&pinned);
+  BitDB_free(&queries);
+  report_test(__func__, success);
+  return success;
+}
+
+bool test_bit_gpu_stats() {
+  const int len = 500, nq = 7, n = 90;
+  Bit_DB_T queries = BitDB_new(len, nq);
+  Bit_DB_T targets = BitDB_new(len, n);
+  Bit_T bit = Bit_new(len);
+  for (int i = 0; i < nq + n; i++) {
+    Bit_clear(bit, 0, len - 1);
+    Bit_set(bit, i % 50, i % 50 + 30);
+    BitDB_put_at(i < nq ? queries : targets, i < nq ? i : i - nq, bit);
+  }
+  Bit_free(&bit);
+  bool success = !Bit_gpu_stats_timers(true) && Bit_gpu_stats_timers(true);
+  Bit_gpu_stats_reset();
+  Bit_gpu_stats stats = Bit_gpu_stats_get();
+  const Bit_gpu_stats zero = {0};
+  success = success && memcmp(&stats, &zero, sizeof(stats)) == 0;
+
+  SETOP_COUNT_OPTS opts = {.num_cpu_threads = 2};
+  size_t size = BitDB_counts_size(queries, targets);
+  int *counts = malloc(size * sizeof(int));
+  BitDB_inter_count_store_gpu(queries, targets, counts, opts);
+  stats = Bit_gpu_stats_get();
+  // no copies without a GPU; with one the counts come back at least once
+  success = success && (stats.d2h_bytes == 0 ||
+                        (stats.d2h_bytes >= size * sizeof(int) &&
+                         stats.d2h_transfers > 0));
+  for (int l = 0; l < BIT_GPU_LAYOUTS; l++) // relabels are not transitions
+    success = success && stats.transitions[l][l] == 0;
+  success = success && stats.transition_seconds >= 0 &&
+            stats.transfer_seconds >= 0 && stats.kernel_seconds >= 0;
+
+  Bit_gpu_stats_reset();
+  stats = Bit_gpu_stats_get();
+  success = success && stats.d2h_bytes == 0 && stats.layout_hits == 0 &&
+            stats.kernel_seconds == 0 && Bit_gpu_stats_timers(false);
+  free(counts);
+  BitDB_free(&queries);
+  BitDB_free(&targets);
+  report_test(__func__, success);
+  return success;
+}
+
+bool test_bit_gpu_budget() {
+  const int len = 700, nq = 5, n = 64, ndbs = 3;
+  Bit_DB_T queries = BitDB_new(len, nq);
+  Bit_DB_T dbs[3];
+  Bit_T bit = Bit_new(len);
+  for (int d = 0; d < ndbs; d++)
+    dbs[d] = BitDB_new(len, n);
+  for (int i = 0; i < nq + ndbs * n; i++) {
+    Bit_clear(bit, 0, len - 1);
+    Bit_set(bit, i % 97, i % 97 + 200);
+    if (i < nq)
+      BitDB_put_at(queries, i, bit);
+    else
+      BitDB_put_at(dbs[(i - nq) / n], (i - nq) % n, bit);
+  }
+  Bit_free(&bit);
+  bool success = Bit_gpu_budget_get(0) == 0;
+  // room for about one reference container: every switch evicts
+  const size_t budget = (size_t)n * len / 8 + 4096;
+  Bit_gpu_budget_set(0, budget);
+  success = success && Bit_gpu_budget_get(0) == budget;
+
+  SETOP_COUNT_OPTS opts = {.num_cpu_threads = 2};
+  size_t size = BitDB_counts_size(queries, dbs[0]);
+  int *want = malloc(size * sizeof(int));
+  int *got = malloc(size * sizeof(int));
+  for (int round = 0; round < 2 * ndbs; round++) {
+    Bit_DB_T db = dbs[round % ndbs];
+    BitDB_inter_count_store_cpu(queries, db, want, opts);
+    BitDB_inter_count_store_gpu(queries, db, got, opts);
+    success = success && memcmp(want, got, size * sizeof(int)) == 0;
+  }
+  Bit_gpu_budget_set(0, 0);
+  success = success && Bit_gpu_budget_get(0) == 0;
+  free(want);
+  free(got);
+  for (int d = 0; d < ndbs; d++)
+    BitDB_free(&dbs[d]);
+  BitDB_free(&queries);
+  report_test(__func__, success);
+  return success;
+}
+
+bool test_bit_gpu_word_bits() {
+  const int len = 333, nq = 6, n = 70; // an odd number of 32-bit halves
+  Bit_DB_T queries = BitDB_new(len, nq);
+  Bit_DB_T targets = BitDB_new(len, n);
+  Bit_T bit = Bit_new(len);
+  unsigned int seed = 3232;
+  for (int i = 0; i < nq + n; i++) {
+    Bit_clear(bit, 0, len - 1);
+    for (int b = 0; b < len; b++) {
+      seed = seed * 1103515245u + 12345u;
+      if ((seed >> 16) % 3 == 0)
+        Bit_bset(bit, b);
+    }
+    BitDB_put_at(i < nq ? queries : targets, i < nq ? i : i - nq, bit);
+  }
+  Bit_free(&bit);
+  const int build_bits = Bit_gpu_word_bits(0);
+  bool success = build_bits == 32 || build_bits == 64;
+  SETOP_COUNT_OPTS opts = {.num_cpu_threads = 2};
+  size_t size = BitDB_counts_size(queries, targets);
+  size_t self_size = BitDB_counts_size(targets, targets);
+  int *want = malloc(self_size * sizeof(int));
+  int *got = malloc(self_size * sizeof(int));
+  const int widths[] = {32, 64, 32};
+  for (int w = 0; w < 3; w++) { // each switch changes the device layout
+    Bit_gpu_word_bits_set(0, widths[w]);
+    success = success && Bit_gpu_word_bits(0) == widths[w];
+    BitDB_minus_count_store_cpu(queries, targets, want, opts);
+    BitDB_minus_count_store_gpu(queries, targets, got, opts);
+    success = success && memcmp(want, got, size * sizeof(int)) == 0;
+    BitDB_diff_count_store_cpu(targets, targets, want, opts);
+    BitDB_diff_count_store_gpu(targets, targets, got, opts);
+    success = success && memcmp(want, got, self_size * sizeof(int)) == 0;
+  }
+  Bit_gpu_word_bits_set(0, 0);
+  success = success && Bit_gpu_word_bits(0) == build_bits;
+  free(want);
+  free(got);
+  BitDB_free(&queries);
+  BitDB_free(&targets);
+  report_test(__func__, success);
+  return success;
+}
+
+bool test_bit_gpu_native() {
+  const int len = 200, nq = 5, n = 41;
+  Bit_DB_T queries = BitDB_new(len, nq);
+  Bit_DB_T targets = BitDB_new(len, n);
+  Bit_T bit = Bit_new(len);
+  unsigned int seed = 5151;
+  for (int i = 0; i < nq + n; i++) {
+    Bit_clear(bit, 0, len - 1);
+    for (int b = 0; b < len; b++) {
+      seed = seed * 1103515245u + 12345u;
+      if ((seed >> 16) % 4 == 0)
+        Bit_bset(bit, b);
+    }
+    BitDB_put_at(i < nq ? queries : targets, i < nq ? i : i - nq, bit);
+  }
+  Bit_free(&bit);
+  const char *backend = Bit_gpu_native_backend();
+  bool success = backend == NULL || strcmp(backend, "cuda") == 0 ||
+                 strcmp(backend, "hip") == 0;
+  SETOP_COUNT_OPTS opts = {.num_cpu_threads = 2,
+                           .algorithm = NATIVE_COARSENED,
+                           .upd_1st_operand = true,
+                           .upd_2nd_operand = true,
+                           .release_1st_operand = true,
+                           .release_2nd_operand = true,
+                           .release_counts = true};
+  size_t size = BitDB_counts_size(queries, targets);
+  int *want = malloc(size * sizeof(int));
+  int *got = malloc(size * sizeof(int));
+  // with or without a backend, every op agrees with the CPU
+  BitDB_inter_count_store_cpu(queries, targets, want, opts);
+  BitDB_inter_count_store_gpu(queries, targets, got, opts);
+  success = success && memcmp(want, got, size * sizeof(int)) == 0;
+  BitDB_union_count_store_cpu(queries, targets, want, opts);
+  BitDB_union_count_store_gpu(queries, targets, got, opts);
+  success = success && memcmp(want, got, size * sizeof(int)) == 0;
+  BitDB_diff_count_store_cpu(queries, targets, want, opts);
+  BitDB_diff_count_store_gpu(queries, targets, got, opts);
+  success = success && memcmp(want, got, size * sizeof(int)) == 0;
+  BitDB_minus_count_store_cpu(queries, targets, want, opts);
+  BitDB_minus_count_store_gpu(queries, targets, got, opts);
+  success = success && memcmp(want, got, size * sizeof(int)) == 0;
+  // and so do the fused counts of several ops
+  int *got_union = malloc(size * sizeof(int));
+  BitDB_multi_count_store_gpu(queries, targets,
+                              BIT_COUNT_UNION | BIT_COUNT_MINUS, NULL,
+                              got_union, NULL, got, opts);
+  success = success && memcmp(want, got, size * sizeof(int)) == 0;
+  BitDB_union_count_store_cpu(queries, targets, want, opts);
+  success = success && memcmp(want, got_union, size * sizeof(int)) == 0;
+  // a device copy kept across calls follows writes to its container
+  opts.upd_1st_operand = opts.upd_2nd_operand = false;
+  opts.release_1st_operand = opts.release_2nd_operand = false;
+  BitDB_inter_count_store_gpu(queries, targets, got, opts);
+  Bit_T row = BitDB_get_from(queries, 0);
+  BitDB_put_at(targets, 3, row);
+  Bit_free(&row);
+  BitDB_inter_count_store_cpu(queries, targets, want, opts);
+  opts.release_1st_operand = opts.release_2nd_operand = true;
+  BitDB_inter_count_store_gpu(queries, targets, got, opts);
+  success = success && memcmp(want, got, size * sizeof(int)) == 0;
+  // the backend emits threshold matches from the kernel in any order
+  size_t want_offsets[nq + 1], got_offsets[nq + 1];
+  int *want_idx, *want_count, *got_idx, *got_count;
+  const size_t want_total = BitDB_inter_count_threshold(
+      queries, targets, 12, opts, want_offsets, &want_idx, &want_count);
+  const size_t got_total = BitDB_inter_count_threshold_gpu(
+      queries, targets, 12, opts, got_offsets, &got_idx, &got_count);
+  success = success && want_total == got_total &&
+            memcmp(want_offsets, got_offsets, sizeof(want_offsets)) == 0 &&
+            memcmp(want_idx, got_idx, want_total * sizeof(int)) == 0 &&
+            memcmp(want_count, got_count, want_total * sizeof(int)) == 0;
+  free(want_idx);
+  free(want_count);
+  free(got_idx);
+  free(got_count);
+  free(want);
+  free(got);
+  free(got_union);
+  BitDB_free(&queries);
+  BitDB_free(&targets);
+  report_test(__func__, success);
+  return success;
+}
+
+bool test_bitDB_inter_count() {
+#define SIZEOF_BITDB 45
+  Bit_DB_T bit1 = BitDB_new(SIZE_OF_TEST_BIT, SIZEOF_BITDB);
+  Bit_DB_T bit2 = BitDB_new(SIZE_OF_TEST_BIT, SIZEOF_BITDB);
+
+  Bit_T bitset1 = Bit_new(SIZE_OF_TEST_BIT);
+  Bit_bset(bitset1, 1);
+  Bit_bset(bitset1, 3);
+
+  Bit_T bitset2 = Bit_new(SIZE_OF_TEST_BIT);
+  Bit_bset(bitset2, 3);
+  Bit_bset(bitset2, 5);
+
+  BitDB_put_at(bit1, 0, bitset1);
+  BitDB_put_at(bit2, 0, bitset2);
+
+  Bit_bset(bitset1, 7); // Add an extra bit to bitset1
+  Bit_bset(bitset2, 7); // Add an extra bit to bitset2
+
+  BitDB_put_at(bit1, 1, bitset1);
+  BitDB_put_at(bit2, 1, bitset2);
+
+  int* count = BitDB_count(bit1);
+  int* count2 = BitDB_count(bit2);
+
+  int* inter_count = BitDB_inter_count(bit1, bit2, (SETOP_COUNT_OPTS) {}, cpu);
+  bool success = (*inter_count == 1) &&
+    (inter_count[1] == 1 && inter_count[SIZEOF_BITDB] == 1 &&
+      inter_count[SIZEOF_BITDB + 1] == 2);
+  success = success &&
+            BitDB_counts_size(bit1, bit2) == SIZEOF_BITDB * SIZEOF_BITDB &&
+            inter_count[BitDB_counts_offset(bit2, 1, 1)] == 2;
+
+  // The pair space of a 65536-row self-join no longer wraps to zero
+  Bit_DB_T wide = BitDB_new(64, 1 << 16);
+  success = success && BitDB_counts_size(wide, wide) == (size_t)1 << 32 &&
+            BitDB_counts_offset(wide, 65535, 65535) == ((size_t)1 << 32) - 1;
+  BitDB_free(&wide);
+
+  Bit_free(&bitset1);
+  Bit_free(&bitset2);
+  BitDB_free(&bit1);
+  BitDB_free(&bit2);
+
+  report_test(__func__, success);
+  return success;
+}
+
+bool test_bit_expr_count() {
+  const int len = SIZE_OF_TEST_BIT - 5; // several chunks, partial last qword
+  Bit_T a = Bit_new(len), b = Bit_new(len), c = Bit_new(len);
+  for (int i = 0; i < len; i += 3)
+    Bit_bset(a, i);
+  for (int i = 0; i < len; i += 5)
+    Bit_bset(b, i);
+  Bit_set(c, 1000, len - 1);
+
+  // |a & b & ~c|
+  Bit_expr_op p1[] = {BIT_EXPR_PUSH, BIT_EXPR_PUSH, BIT_EXPR_AND,
+                      BIT_EXPR_PUSH, BIT_EXPR_AND_NOT};
+  Bit_T ops1[] = {a, b, c};
+  Bit_T ab = Bit_inter(a, b);
+  bool success = Bit_expr_count(p1, 5, ops1, 3) == Bit_minus_count(ab, c);
+
+  // |~(a | b)| must not count the padding bits of the last qword
+  Bit_expr_op p2[] = {BIT_EXPR_PUSH, BIT_EXPR_PUSH, BIT_EXPR_OR,
+                      BIT_EXPR_NOT};
+  success = success &&
+            Bit_expr_count(p2, 4, ops1, 2) == len - Bit_union_count(a, b);
+
+  // |(a ^ c) | (b & c)| exercises a stack depth of three
+  Bit_expr_op p3[] = {BIT_EXPR_PUSH, BIT_EXPR_PUSH, BIT_EXPR_XOR,
+                      BIT_EXPR_PUSH, BIT_EXPR_PUSH, BIT_EXPR_AND,
+                      BIT_EXPR_OR};
+  Bit_T ops3[] = {a, c, b, c};
+  Bit_T ac = Bit_diff(a, c), bc = Bit_inter(b, c);
+  success = success && Bit_expr_count(p3, 7, ops3, 4) == Bit_union_count(ac, bc);
+
+  // row-wise over a container: |row & a & ~c|
+  Bit_DB_T db = BitDB_new(len, 3);
+  BitDB_put_at(db, 0, a);
+  BitDB_put_at(db, 1, b);
+  Bit_expr_op p4[] = {BIT_EXPR_PUSH_ROW, BIT_EXPR_PUSH, BIT_EXPR_AND,
+                      BIT_EXPR_PUSH, BIT_EXPR_AND_NOT};
+  Bit_T ops4[] = {a, c};
+  int *counts = BitDB_expr_count_cpu(db, p4, 5, ops4, 2, (SETOP_COUNT_OPTS){});
+  success = success && counts[0] == Bit_minus_count(a, c) &&
+            counts[1] == Bit_minus_count(ab, c) && counts[2] == 0;
+
+  free(counts);
+  BitDB_free(&db);
+  Bit_free(&ab);
+  Bit_free(&ac);
+  Bit_free(&bc);
+  Bit_free(&a);
+  Bit_free(&b);
+  Bit_free(&c);
+  report_test(__func__, success);
+  return success;
+}
+
+bool test_bit_stats() {
+  const int len = 1000, nq = 3, n = 20;
+  Bit_T s = Bit_new(len), t = Bit_new(len);
+  Bit_set(s, 0, 499);
+  Bit_set(t, 250, 749);
+  Bit_DB_T queries = BitDB_new(len, nq);
+  Bit_DB_T targets = BitDB_new(len, n);
+  int *counts = malloc((size_t)nq * n * sizeof(int));
+  Bit_stats_reset();
+  Bit_stats stats = Bit_stats_snapshot();
+  bool success = stats.isa && stats.simd && stats.ncalls == 0 &&
+                 stats.db_aligned == 0 && stats.setop_aligned == 0;
+
+  success = success && Bit_inter_count(s, t) == 250;
+  BitDB_inter_count_store_cpu(queries, targets, counts,
+                              (SETOP_COUNT_OPTS){.num_cpu_threads = 2});
+  stats = Bit_stats_snapshot();
+  if (!stats.enabled) { // the default build records nothing
+    success = success && stats.ncalls == 0 && stats.setop_aligned == 0 &&
+              stats.setop_unaligned == 0 && stats.db_aligned == 0 &&
+              stats.db_unaligned == 0;
+  } else {
+    const Bit_stats_call *inter = NULL;
+    for (int i = 0; i < stats.ncalls; i++) {
+      if (strcmp(stats.calls[i].name, "Bit_inter_count") == 0)
+        inter = &stats.calls[i];
+      // sorted by name
+      success = success && (i == 0 || strcmp(stats.calls[i - 1].name,
+                                             stats.calls[i].name) < 0);
+    }
+    success = success && inter && inter->calls == 1 &&
+              inter->bytes == 2 * (uint64_t)Bit_buffer_size(len);
+    uint64_t blocks = 0;
+    for (int b = 0; b < BIT_TUNING_BLOCK_COUNT; b++)
+      blocks += stats.blocks[b];
+    // Bit_new storage is aligned
+    success = success && stats.setop_aligned == 1 && blocks == 1;
+    Bit_stats_reset();
+    stats = Bit_stats_snapshot();
+    success = success && stats.ncalls == 0 && stats.setop_aligned == 0;
+  }
+  free(counts);
+  BitDB_free(&queries);
+  BitDB_free(&targets);
+  Bit_free(&s);
+  Bit_free(&t);
+  report_test(__func__, success);
+  return success;
+}
+
+bool test_bit_configuration() {
+  Bit_config config;
+  memset(&config, 0xff, sizeof(config));
+  Bit_get_configuration(&config);
+  Bit_stats stats = Bit_stats_snapshot();
+  Bit_tuning tuning = Bit_tuning_get();
+  bool success = config.isa && strcmp(config.isa, stats.isa) == 0 &&
+                 strcmp(config.simd, stats.simd) == 0 && config.popcount &&
+                 *config.popcount && config.profile == stats.enabled;
+  success = success && config.alignment >= 32 &&
+            (config.alignment & (config.alignment - 1)) == 0;
+  success = success && config.tuning.block == tuning.block &&
+            config.tuning.tile == tuning.tile &&
+            config.tuning.k_block == tuning.k_block;
+  success = success && config.cpu_tile_bit > 0 && config.k_block > 0 &&
+            config.outer_rows > 0 && config.outer_cols > 0;
+  success = success && config.omp_max_threads >= 1 &&
+            config.omp_num_procs >= 1 && config.omp_thread_limit >= 1;
+  success = success && config.gpu_archs && config.gpu_devices >= 0 &&
+            config.gpu_word_bits == Bit_gpu_word_bits(config.gpu_default_device);
+  // the native algorithm runs as such exactly when a backend is loaded
+  const char *backend = Bit_gpu_native_backend();
+  success = success && config.native_backend == backend &&
+            !(config.gpu_algorithms & 1u << NATIVE_COARSENED) == !backend &&
+            (backend ? config.native_devices > 0 : config.native_devices == 0);
+  success = success && (config.gpu ? (config.gpu_algorithms &
+                                      1u << TRANSPOSED_TEAM_PARALLEL_SIMD) != 0
+                                   : (config.gpu_algorithms &
+                                      ~(1u << NATIVE_COARSENED)) == 0);
+  report_test(__func__, success);
+  return success;
+}
+
+// Operand of the compressed tests: sparse, dense and run chunks, and a
+// partial last chunk
+static void fill_compressed(Bit_T bit, unsigned int seed) {
+  const int length = Bit_length(bit);
+  srand(seed);
+  for (int i = 0; i < 300; i++)
+    Bit_bset(bit, rand() % 65536);
+  for (int i = 65536; i < 2 * 65536; i++)
+    if (rand() % 2)
+      Bit_bset(bit, i);
+  for (int lo = 2 * 65536 + rand() % 64; lo + 1000 < 3 * 65536;
+       lo += 1000 + rand() % 2000)
+    Bit_set(bit, lo, lo + rand() % 1000);
+  Bit_set(bit, 3 * 65536 + seed % 7, 4 * 65536 - 1);
+  for (int i = 4 * 65536; i < length; i++)
+    if (rand() % 8 == 0)
+      Bit_bset(bit, i);
+}
+
+bool test_bit_compressed() {
+  const int length = 4 * 65536 + 5000;
+  Bit_T s = Bit_new(length), t = Bit_new(length);
+  fill_compressed(s, 1);
+  fill_compressed(t, 2);
+  Bit_clear(t, 3 * 65536 + 100, 3 * 65536 + 200);
+  Bit_C_T cs = Bit_C_from_bit(s), ct = Bit_C_from_bit(t);
+  bool success = Bit_C_length(cs) == length &&
+                 Bit_C_count(cs) == Bit_count(s) &&
+                 Bit_C_count(ct) == Bit_count(t);
+  // set operations against those of Bit_T, on both compressed operands and
+  // mixed ones
+  Bit_T (*bit_ops[])(Bit_T, Bit_T) = {Bit_diff, Bit_inter, Bit_minus,
+                                      Bit_union};
+  int (*bit_counts[])(Bit_T, Bit_T) = {Bit_diff_count, Bit_inter_count,
+                                       Bit_minus_count, Bit_union_count};
+  Bit_C_T (*c_ops[])(Bit_C_T, Bit_C_T) = {Bit_C_diff, Bit_C_inter,
+                                          Bit_C_minus, Bit_C_union};
+  int (*c_counts[])(Bit_C_T, Bit_C_T) = {Bit_C_diff_count, Bit_C_inter_count,
+                                         Bit_C_minus_count, Bit_C_union_count};
+  Bit_C_T (*mixed_ops[])(Bit_C_T, Bit_T) = {Bit_C_diff_bit, Bit_C_inter_bit,
+                                            Bit_C_minus_bit, Bit_C_union_bit};
+  int (*mixed_counts[])(Bit_C_T, Bit_T) = {
+      Bit_C_diff_count_bit, Bit_C_inter_count_bit, Bit_C_minus_count_bit,
+      Bit_C_union_count_bit};
+  for (int op = 0; op < 4; op++) {
+    Bit_T expected = bit_ops[op](s, t);
+    Bit_C_T result = c_ops[op](cs, ct);
+    Bit_C_T mixed = mixed_ops[op](cs, t);
+    Bit_T got = Bit_C_to_bit(result), got_mixed = Bit_C_to_bit(mixed);
+    const int count = Bit_count(expected);
+    success = success && Bit_eq(got, expected) && Bit_eq(got_mixed, expected) &&
+              Bit_C_count(result) == count && Bit_C_count(mixed) == count &&
+              c_counts[op](cs, ct) == count && mixed_counts[op](cs, t) == count &&
+              bit_counts[op](s, t) == count;
+    Bit_free(&expected);
+    Bit_free(&got);
+    Bit_free(&got_mixed);
+    Bit_C_free(&result);
+    Bit_C_free(&mixed);
+  }
+  // single bits, ranges and the forms of the containers
+  Bit_C_T c = Bit_C_new(length);
+  Bit_T ref = Bit_new(length);
+  int indices[] = {3, 70000, 70001, length - 1};
+  Bit_C_aset(c, indices, 4);
+  Bit_aset(ref, indices, 4);
+  success = success && Bit_C_get(c, 70001) && !Bit_C_get(c, 70002) &&
+            Bit_C_put(c, 70002, 1) == 0 && Bit_C_put(c, 70002, 0) == 1;
+  Bit_C_set(c, 100, 5000); // an array, then a bitmap past 4096 bits
+  Bit_set(ref, 100, 5000);
+  for (int i = 6000; i < 7000; i += 2) {
+    Bit_C_bset(c, i);
+    Bit_bset(ref, i);
+  }
+  Bit_C_set(c, 65536 + 10, 3 * 65536 + 20); // whole chunks become runs
+  Bit_set(ref, 65536 + 10, 3 * 65536 + 20);
+  Bit_C_clear(c, 2 * 65536 - 5, 2 * 65536 + 5);
+  Bit_clear(ref, 2 * 65536 - 5, 2 * 65536 + 5);
+  Bit_C_bclear(c, 3);
+  Bit_bclear(ref, 3);
+  const size_t bytes = Bit_C_size_in_bytes(c);
+  Bit_C_optimize(c);
+  Bit_T got = Bit_C_to_bit(c);
+  success = success && Bit_eq(got, ref) && Bit_C_count(c) == Bit_count(ref) &&
+            Bit_C_size_in_bytes(c) <= bytes &&
+            Bit_C_size_in_bytes(c) < (size_t)length / 8 / 4;
+  int next = 0, expected = 0;
+  for (int k = 0; k < 2000 && success; k++) {
+    next = Bit_C_next_set(c, next);
+    while (expected < length && !Bit_get(ref, expected))
+      expected++;
+    success = next == (expected < length ? expected : -1);
+    next++, expected++;
+  }
+  Bit_C_T copy = Bit_C_from_bit(ref);
+  success = success && Bit_C_eq(c, copy) && !Bit_C_eq(cs, ct) &&
+            Bit_C_next_set(c, length - 1) == length - 1;
+  Bit_C_clear(c, 0, length - 1);
+  success = success && Bit_C_count(c) == 0 && Bit_C_next_set(c, 0) == -1;
+  Bit_free(&got);
+  Bit_free(&ref);
+  Bit_C_free(&copy);
+  Bit_C_free(&c);
+  Bit_C_free(&cs);
+  Bit_C_free(&ct);
+  Bit_free(&s);
+  Bit_free(&t);
+  success = success && c == NULL;
+  report_test(__func__, success);
+  return success;
+}
+
+bool test_bit_rle() {
+  const int length = 4 * 65536 + 777;
+  Bit_T s = Bit_new(length), t = Bit_new(length), empty = Bit_new(length);
+  fill_compressed(s, 3); // runs, literals and zeros
+  srand(4);
+  for (int i = 0; i < 2000; i++)
+    Bit_bset(t, rand() % length);
+  Bit_set(t, 70000, 250000);
+  const int bytes_s = Bit_serialize_rle(s, NULL);
+  const int bytes_t = Bit_serialize_rle(t, NULL);
+  uint64_t *rs = malloc(bytes_s), *rt = malloc(bytes_t);
+  bool success = Bit_serialize_rle(s, rs) == bytes_s &&
+                 Bit_serialize_rle(t, rt) == bytes_t &&
+                 bytes_s <= Bit_buffer_size(length) + 16 &&
+                 bytes_t < Bit_buffer_size(length) / 2 &&
+                 Bit_serialize_rle(empty, NULL) == 16;
+  Bit_T back = Bit_deserialize_rle(rs, bytes_s);
+  success = success && Bit_eq(back, s) && Bit_rle_length(rs) == length &&
+            Bit_rle_count(rs) == Bit_count(s) &&
+            Bit_rle_count(rt) == Bit_count(t) &&
+            Bit_rle_inter_count(rs, rt) == Bit_inter_count(s, t);
+  Bit_T inter = Bit_inter(s, t);
+  const int bytes_i = Bit_rle_inter(rs, rt, NULL);
+  uint64_t *ri = malloc(bytes_i);
+  success = success && Bit_rle_inter(rs, rt, ri) == bytes_i &&
+            bytes_i == Bit_serialize_rle(inter, NULL);
+  Bit_T got = Bit_deserialize_rle(ri, bytes_i);
+  success = success && Bit_eq(got, inter);
+  Bit_free(&got);
+  Bit_free(&inter);
+  Bit_free(&back);
+  Bit_free(&empty);
+  Bit_free(&s);
+  Bit_free(&t);
+  free(ri);
+  free(rs);
+  free(rt);
+  report_test(__func__, success);
+  return success;
+}
+
+bool test_bitsdb() {
+  const int length = 2048, nrows = 300, ntargets = 37;
+  Bit_DB_T db = BitDB_new(length, nrows), targets = BitDB_new(length, ntargets);
+  Bit_T row = Bit_new(length);
+  srand(5);
+  for (int i = 0; i < nrows; i++) {
+    Bit_clear(row, 0, length - 1);
+    const int bits = i % 3 ? rand() % 32 : 200 + rand() % 800; // most sparse
+    for (int k = 0; k < bits; k++)
+      Bit_bset(row, rand() % length);
+    BitDB_put_at(db, i, row);
+  }
+  for (int j = 0; j < ntargets; j++) {
+    Bit_clear(row, 0, length - 1);
+    for (int k = 0; k < 1000; k++)
+      Bit_bset(row, rand() % length);
+    BitDB_put_at(targets, j, row);
+  }
+  Bit_SDB_T sdb = BitSDB_new(db, -1), all_sparse = BitSDB_new(db, length);
+  bool success = BitSDB_nelem(sdb) == nrows && BitSDB_length(sdb) == length &&
+                 BitSDB_nsparse(sdb) == 200 &&
+                 BitSDB_nsparse(all_sparse) == nrows &&
+                 BitSDB_is_sparse_at(sdb, 1) && !BitSDB_is_sparse_at(sdb, 0) &&
+                 BitSDB_size_in_bytes(sdb) <
+                     (size_t)nrows * Bit_buffer_size(length) * 3 / 5;
+  for (int i = 0; i < nrows && success; i++) {
+    Bit_T copy = BitSDB_get_from(sdb, i), orig = BitDB_get_from(db, i);
+    success = Bit_eq(copy, orig) && BitSDB_count_at(sdb, i) == Bit_count(orig);
+    Bit_free(&copy);
+    Bit_free(&orig);
+  }
+  const size_t ncounts = BitDB_counts_size(db, targets);
+  int *expected = malloc(ncounts * sizeof(int));
+  int *got = malloc(ncounts * sizeof(int));
+  void (*stores[])(Bit_DB_T, Bit_DB_T, int *, SETOP_COUNT_OPTS) = {
+      BitDB_inter_count_store_cpu, BitDB_union_count_store_cpu,
+      BitDB_diff_count_store_cpu, BitDB_minus_count_store_cpu};
+  Bit_count_ops ops[] = {BIT_COUNT_INTER, BIT_COUNT_UNION, BIT_COUNT_DIFF,
+                         BIT_COUNT_MINUS};
+  SETOP_COUNT_OPTS opts = {.num_cpu_threads = 2};
+  for (int op = 0; op < 4 && success; op++) {
+    stores[op](db, targets, expected, opts);
+    BitSDB_count_store(sdb, targets, ops[op], got, opts);
+    success = memcmp(expected, got, ncounts * sizeof(int)) == 0;
+    BitSDB_count_store(all_sparse, targets, ops[op], got, opts);
+    success = success && memcmp(expected, got, ncounts * sizeof(int)) == 0;
+    // one target as the query, against every row
+    Bit_T q = BitDB_get_from(targets, 3);
+    BitDB_query_count_store(q, db, ops[op], expected, opts);
+    BitSDB_query_count_store(q, sdb, ops[op], got, opts);
+    success = success && memcmp(expected, got, nrows * sizeof(int)) == 0;
+    Bit_free(&q);
+  }
+  free(expected);
+  free(got);
+  BitSDB_free(&sdb);
+  BitSDB_free(&all_sparse);
+  BitDB_free(&db);
+  BitDB_free(&targets);
+  Bit_free(&row);
+  success = success && sdb == NULL;
+  report_test(__func__, success);
+  return success;
+}
+
+bool test_bit_large() {
+  // just past INT_MAX bits: 256 MiB a set, three at a time at most
+  const int64_t big = (INT64_C(1) << 31) + 100;
+  Bit_L_T s = Bit_L_new(big);
+  bool success = Bit_L_length(s) == big && Bit_L_count(s) == 0;
+  Bit_L_bset(s, 0);
+  Bit_L_bset(s, big - 1);
+  Bit_L_set(s, INT_MAX - 10, (int64_t)INT_MAX + 10);
+  success = success && Bit_L_get(s, big - 1) && Bit_L_get(s, INT_MAX) &&
+            !Bit_L_get(s, INT_MAX - 11) && Bit_L_count(s) == 2 + 21 &&
+            Bit_L_next_set(s, 1) == INT_MAX - 10 &&
+            Bit_L_next_set(s, (int64_t)INT_MAX + 11) == big - 1 &&
+            Bit_L_prev_set(s, big - 2) == (int64_t)INT_MAX + 10;
+  Bit_L_T t = Bit_L_new(big);
+  Bit_L_set(t, 1, big - 1); // parallel range over ~2^25 qwords
+  Bit_L_not(t, 1, 1);
+  success = success && Bit_L_count(t) == big - 2 &&
+            Bit_L_inter_count(s, t) == 22 &&
+            Bit_L_union_count(s, t) == big - 1 &&
+            Bit_L_minus_count(s, t) == 1 &&
+            Bit_L_diff_count(s, t) == big - 1 - 22;
+  Bit_L_T i = Bit_L_inter(s, t);
+  success = success && Bit_L_count(i) == 22 && Bit_L_leq(i, s) &&
+            Bit_L_lt(i, s) && !Bit_L_leq(s, t);
+  Bit_L_free(&i);
+  Bit_L_T u = Bit_L_union(s, t);
+  success = success && Bit_L_count(u) == big - 1 && !Bit_L_eq(u, t);
+  Bit_L_put(t, 0, 1);
+  success = success && Bit_L_eq(u, t) && Bit_L_put(t, 1, 1) == 0;
+  Bit_L_free(&u);
+  Bit_L_free(&t);
+  Bit_L_free(&s);
+  // small sets against Bit_T, through a shared buffer
+  Bit_T bit = Bit_new(1000);
+  Bit_set(bit, 100, 700);
+  void *buffer = aligned_alloc(64, 128);
+  Bit_extract(bit, buffer);
+  Bit_L_T l = Bit_L_load(1000, buffer);
+  int64_t indices[] = {3, 999};
+  Bit_L_aset(l, indices, 2);
+  success = success && Bit_L_count(l) == Bit_count(bit) + 2 &&
+            Bit_L_buffer_size(1000) == (size_t)Bit_buffer_size(1000);
+  Bit_L_aclear(l, indices, 2);
+  success = success && Bit_L_free(&l) == buffer && l == NULL;
+  free(buffer);
+  Bit_free(&bit);
+  report_test(__func__, success);
+  return success;
+}
+
+/* Fills set with clusters of random bits, one every stride bits */
+static void fill_clustered(Bit_T set, int stride, int width, unsigned seed) {
+  srand(seed);
+  for (int lo = rand() % stride; lo + width < Bit_length(set); lo += stride)
+    for (int k = 0; k < width / 4; k++)
+      Bit_bset(set, lo + rand() % width);
+}
+
+bool test_bit_summary() {
+  const int length = (1 << 22) + 300; // 8193 blocks of 512 bits
+  Bit_T s = Bit_new(length), t = Bit_new(length);
+  fill_clustered(s, 40000, 3000, 6);
+  fill_clustered(t, 50000, 5000, 7);
+  Bit_T s0 = Bit_new(length), t0 = Bit_new(length); // without summaries
+  Bit_union_into(s0, s, NULL);
+  Bit_union_into(t0, t, NULL);
+  Bit_cache_summary(s, true);
+  Bit_cache_summary(t, true);
+  bool success = Bit_count(s) == Bit_count(s0) &&
+                 Bit_inter_count(s, t) == Bit_inter_count(s0, t0) &&
+                 Bit_union_count(s, t) == Bit_union_count(s0, t0) &&
+                 Bit_diff_count(s, t) == Bit_diff_count(s0, t0) &&
+                 Bit_minus_count(s, t) == Bit_minus_count(s0, t0) &&
+                 Bit_eq(s, s0) && !Bit_eq(s, t) &&
+                 Bit_intersects(s, t) == Bit_intersects(s0, t0);
+
+  // results carry summaries that the member operations keep current
+  Bit_T inter = Bit_inter(s, t), minus = Bit_minus(s, t);
+  Bit_T inter0 = Bit_inter(s0, t0), minus0 = Bit_minus(s0, t0);
+  success = success && Bit_eq(inter0, inter) && Bit_eq(minus0, minus) &&
+            Bit_leq(inter, s) && Bit_lt(inter, s) && !Bit_leq(s, inter) &&
+            Bit_leq(inter, t) && !Bit_intersects(inter, minus);
+  int first = Bit_next_set(inter, 0);
+  Bit_bclear(inter, first); // may empty its block
+  Bit_bclear(inter0, first);
+  Bit_clear(s, 100000, 900000);
+  Bit_clear(s0, 100000, 900000);
+  Bit_not(t, 2000000, 2000700);
+  Bit_not(t0, 2000000, 2000700);
+  Bit_set(s, length - 10, length - 1);
+  Bit_set(s0, length - 10, length - 1);
+  success = success && Bit_count(inter) == Bit_count(inter0) &&
+            Bit_inter_count(s, t) == Bit_inter_count(s0, t0) &&
+            Bit_diff_count(s, t) == Bit_diff_count(s0, t0) &&
+            Bit_leq(inter0, inter) && Bit_leq(inter, inter0);
+
+  // into an aliased destination, and into one with stale bits
+  Bit_inter_assign(s, t);
+  Bit_inter_assign(s0, t0);
+  Bit_minus_into(minus, t, s);
+  Bit_minus_into(minus0, t0, s0);
+  success = success && Bit_eq(s, s0) && Bit_eq(minus, minus0) &&
+            Bit_count(s) == Bit_count(s0) &&
+            Bit_count(minus) == Bit_count(minus0);
+
+  // rows of a container against a query
+  const int nrows = 40;
+  Bit_DB_T db = BitDB_new(length, nrows);
+  for (int i = 0; i < nrows; i++) {
+    Bit_T row = Bit_new(length);
+    fill_clustered(row, 30000 + 1000 * i, 2000, 100 + i);
+    BitDB_put_at(db, i, row);
+    Bit_free(&row);
+  }
+  int plain[4][40], summarized[4][40];
+  const Bit_count_ops ops[] = {BIT_COUNT_INTER, BIT_COUNT_UNION,
+                               BIT_COUNT_DIFF, BIT_COUNT_MINUS};
+  for (int k = 0; k < 4; k++)
+    BitDB_query_count_store(t0, db, ops[k], plain[k], (SETOP_COUNT_OPTS){0});
+  BitDB_cache_summary(db, true, (SETOP_COUNT_OPTS){0});
+  for (int k = 0; k < 4; k++)
+    BitDB_query_count_store(t, db, ops[k], summarized[k],
+                            (SETOP_COUNT_OPTS){0});
+  success = success && memcmp(plain, summarized, sizeof(plain)) == 0;
+  BitDB_clear_at(db, 3);
+  BitDB_put_at(db, 7, t0);
+  BitDB_query_count_store(t, db, BIT_COUNT_INTER, summarized[0],
+                          (SETOP_COUNT_OPTS){0});
+  success = success && summarized[0][3] == 0 &&
+            summarized[0][7] == Bit_count(t0);
+
+  Bit_cache_summary(t, false);
+  success = success && Bit_inter_count(t, minus) == Bit_count(minus0);
+  BitDB_free(&db);
+  Bit_free(&inter);
+  Bit_free(&minus);
+  Bit_free(&inter0);
+  Bit_free(&minus0);
+  Bit_free(&s);
+  Bit_free(&t);
+  Bit_free(&s0);
+  Bit_free(&t0);
+  report_test(__func__, success);
+  return success;
+}
+
+bool test_bit_bloom() {
+  const int nkeys = 50000, nprobes = 100000;
+  uint64_t *keys = malloc((nkeys + nprobes) * sizeof(uint64_t));
+  int *out = malloc(nprobes * sizeof(int));
+  for (int i = 0; i < nkeys + nprobes; i++)
+    keys[i] = (uint64_t)i * 0x9e3779b97f4a7c15ULL + 12345;
+  Bit_BF_T filter = Bit_BF_new(20 * nkeys, 8); // 20 bits per key
+  Bit_BF_insert_many(filter, keys, nkeys - 1);
+  Bit_BF_insert(filter, keys[nkeys - 1]);
+  bool success = Bit_BF_k(filter) == 8 &&
+                 Bit_length(Bit_BF_bits(filter)) % 512 == 0 &&
+                 Bit_length(Bit_BF_bits(filter)) >= 20 * nkeys &&
+                 Bit_BF_contains_many(filter, keys, nkeys, NULL) == nkeys &&
+                 Bit_BF_contains(filter, keys[17]);
+  // no false negatives, and few false positives among the other keys
+  const int maybe = Bit_BF_contains_many(filter, keys + nkeys, nprobes, out);
+  int agree = 0;
+  for (int i = 0; i < nprobes; i++)
+    agree += out[i] == Bit_BF_contains(filter, keys[nkeys + i]);
+  success = success && maybe < nprobes / 50 && agree == nprobes &&
+            Bit_count(Bit_BF_bits(filter)) <= 8 * nkeys;
+
+  // persisted as a row of a saved container, probed through the mapping
+  const char *path = "test_bit_bloom.bdb";
+  const int length = Bit_length(Bit_BF_bits(filter));
+  Bit_DB_T db = BitDB_new(length, 2);
+  BitDB_put_at(db, 1, Bit_BF_bits(filter));
+  success = success && BitDB_save(db, path) == 0;
+  Bit_DB_T mapped = BitDB_open_mmap(path, BIT_DB_MMAP_READONLY);
+  success = success && mapped;
+  if (mapped) {
+    Bit_T row = NULL;
+    BitDB_view_at(mapped, 1, &row);
+    Bit_BF_T loaded = Bit_BF_wrap(row, 8);
+    success = success &&
+              Bit_BF_contains_many(loaded, keys, nkeys, NULL) == nkeys &&
+              Bit_BF_contains_many(loaded, keys + nkeys, nprobes, NULL) ==
+                  maybe;
+    Bit_BF_free(&loaded);
+    Bit_free(&row);
+    BitDB_free(&mapped);
+  }
+  remove(path);
+  BitDB_free(&db);
+  Bit_BF_free(&filter);
+  free(keys);
+  free(out);
+  report_test(__func__, success);
+  return success;
+}
+
+static Bit_DB_T random_matrix(int rows, int columns, int percent,
+                               unsigned seed) {
+  Bit_DB_T matrix = BitDB_new(columns, rows);
+  Bit_T row = NULL;
+  srand(seed);
+  for (int i = 0; i < rows; i++) {
+    BitDB_view_at(matrix, i, &row);
+    for (int j = 0; j < columns; j++)
+      if (rand() % 100 < percent)
+        Bit_bset(row, j);
+  }
+  Bit_free(&row);
+  return matrix;
+}
+
+static int matrix_get(Bit_DB_T matrix, int i, int j, Bit_T *row) {
+  BitDB_view_at(matrix, i, row);
+  return Bit_get(*row, j);
+}
+
+bool test_bit_matrix() {
+  // past a 64 x 64 block in every dimension, and past a table tile in p
+  const int n = 70, m = 77, p = 8300;
+  SETOP_COUNT_OPTS opts = {.num_cpu_threads = 3};
+  Bit_DB_T a = random_matrix(n, m, 10, 8), b = random_matrix(m, p, 5, 9);
+  Bit_T r = NULL, s = NULL, t = NULL;
+
+  Bit_DB_T bt = BitDB_transpose(b), btt = BitDB_transpose(bt);
+  bool success = BitDB_nelem(bt) == p && BitDB_length(bt) == m;
+  for (int j = 0; j < m && success; j++)
+    for (int k = 0; k < p && success; k++)
+      success = matrix_get(b, j, k, &r) == matrix_get(bt, k, j, &s) &&
+                matrix_get(btt, j, k, &t) == matrix_get(b, j, k, &r);
+
+  Bit_DB_T ored = BitDB_matrix_product(a, b, BIT_MATRIX_BOOLEAN, opts);
+  Bit_DB_T xored = BitDB_matrix_product(a, b, BIT_MATRIX_GF2, opts);
+  int *counts = malloc((size_t)n * p * sizeof(int));
+  BitDB_matrix_count_store(a, b, counts, opts);
+  success = success && BitDB_nelem(ored) == n && BitDB_length(ored) == p;
+  for (int i = 0; i < n && success; i++)
+    for (int k = 0; k < p && success; k++) {
+      int sum = 0;
+      for (int j = 0; j < m; j++)
+        sum += matrix_get(a, i, j, &r) & matrix_get(b, j, k, &s);
+      success = counts[i * p + k] == sum &&
+                matrix_get(ored, i, k, &t) == (sum > 0) &&
+                matrix_get(xored, i, k, &t) == (sum & 1);
+    }
+
+  // a path 0 -> 1 -> ... -> 99 and a cycle 100 -> ... -> 129 -> 100
+  const int nodes = 130;
+  Bit_DB_T graph = BitDB_new(nodes, nodes);
+  for (int i = 0; i < nodes; i++) {
+    BitDB_view_at(graph, i, &r);
+    if (i < 99)
+      Bit_bset(r, i + 1);
+    else if (i >= 100)
+      Bit_bset(r, i < nodes - 1 ? i + 1 : 100);
+  }
+  Bit_DB_T reach = BitDB_matrix_closure(graph, opts);
+  for (int i = 0; i < nodes && success; i++)
+    for (int j = 0; j < nodes && success; j++)
+      success = matrix_get(reach, i, j, &r) ==
+                (i < 100 ? j > i && j < 100 : j >= 100);
+
+  free(counts);
+  Bit_free(&r);
+  Bit_free(&s);
+  Bit_free(&t);
+  BitDB_free(&a);
+  BitDB_free(&b);
+  BitDB_free(&bt);
+  BitDB_free(&btt);
+  BitDB_free(&ored);
+  BitDB_free(&xored);
+  BitDB_free(&graph);
+  BitDB_free(&reach);
+  report_test(__func__, success);
+  return success;
+}
+
+bool test_bit_sketch() {
+  // clusters of near-duplicate rows: copies of a base row with a few bits
+  // moved, so rows in a cluster have a Jaccard similarity near 0.9
+  const int length = 4096, clusters = 100, copies = 8, k = 64, bands = 16;
+  const int n = clusters * copies + 1; // the last row stays empty
+  SETOP_COUNT_OPTS opts = {.num_cpu_threads = 3};
+  Bit_DB_T db = BitDB_new(length, n);
+  Bit_T row = NULL, other = NULL;
+  srand(10);
+  for (int c = 0; c < clusters; c++) {
+    int base[400];
+    for (int b = 0; b < 400; b++)
+      base[b] = rand() % length;
+    for (int copy = 0; copy < copies; copy++) {
+      BitDB_view_at(db, c * copies + copy, &row);
+      for (int b = 0; b < 400; b++)
+        Bit_bset(row, copy && rand() % 40 == 0 ? rand() % length : base[b]);
+    }
+  }
+  uint32_t *sig = malloc((size_t)n * k * sizeof(uint32_t));
+  BitDB_minhash(db, k, sig, opts);
+  bool success = true;
+  for (int b = 0; b < k; b++)
+    success = success && sig[(size_t)(n - 1) * k + b] == UINT32_MAX;
+
+  // the estimates track the exact similarities
+  double error = 0;
+  for (int i = 0; i < n - 2; i++) {
+    BitDB_view_at(db, i, &row);
+    BitDB_view_at(db, i + 1, &other);
+    double jaccard = (double)Bit_inter_count(row, other) /
+                     Bit_union_count(row, other);
+    double estimate = Bit_minhash_jaccard(sig + (size_t)i * k,
+                                          sig + (size_t)(i + 1) * k, k);
+    error += (estimate - jaccard) * (estimate - jaccard);
+  }
+  success = success && error / (n - 2) < 0.01;
+
+  // every pair of a cluster is a candidate, in order, each once
+  int *pairs = NULL;
+  size_t npairs =
+      BitDB_lsh_candidates(sig, n, NULL, 0, k, bands, opts, &pairs);
+  int within = 0;
+  for (size_t m = 0; m < npairs && success; m++) {
+    success = pairs[2 * m] < pairs[2 * m + 1] &&
+              (m == 0 || pairs[2 * m - 2] < pairs[2 * m] ||
+               (pairs[2 * m - 2] == pairs[2 * m] &&
+                pairs[2 * m - 1] < pairs[2 * m + 1]));
+    within += pairs[2 * m] / copies == pairs[2 * m + 1] / copies &&
+              pairs[2 * m + 1] < n - 1;
+  }
+  success = success && within == clusters * copies * (copies - 1) / 2 &&
+            npairs < (size_t)within * 2;
+
+  // exact counts of the candidates
+  int *counts = malloc((npairs ? npairs : 1) * sizeof(int));
+  BitDB_pairs_count(db, db, pairs, npairs, counts, opts);
+  for (size_t m = 0; m < npairs && success; m++) {
+    BitDB_view_at(db, pairs[2 * m], &row);
+    BitDB_view_at(db, pairs[2 * m + 1], &other);
+    success = counts[m] == Bit_inter_count(row, other);
+  }
+  free(pairs);
+
+  // queries against separate targets: the first row of every cluster
+  uint32_t *firsts = malloc((size_t)clusters * k * sizeof(uint32_t));
+  for (int c = 0; c < clusters; c++)
+    memcpy(firsts + (size_t)c * k, sig + (size_t)c * copies * k,
+           k * sizeof(uint32_t));
+  npairs = BitDB_lsh_candidates(firsts, clusters, sig, n, k, bands, opts,
+                                &pairs);
+  within = 0;
+  for (size_t m = 0; m < npairs; m++)
+    within += pairs[2 * m] == pairs[2 * m + 1] / copies &&
+              pairs[2 * m + 1] < n - 1;
+  success = success && within == clusters * copies;
+
+  free(pairs);
+  free(firsts);
+  free(counts);
+  free(sig);
+  Bit_free(&row);
+  Bit_free(&other);
+  BitDB_free(&db);
+  report_test(__func__, success);
+  return success;
+}
+
+bool test_bit_postings() {
+  const int length = 20000, n = 3000;
+  SETOP_COUNT_OPTS opts = {.num_cpu_threads = 3};
+  Bit_DB_T db = random_matrix(n, length, 1, 11);
+  Bit_DB_T plain = random_matrix(n, length, 1, 11); // scanned, no index
+  BitDB_cache_postings(db, true, opts);
+  BitDB_cache_counts(db, true, opts);
+  Bit_T sparse = Bit_new(length), dense = Bit_new(length);
+  for (int b = 0; b < 6; b++)
+    Bit_bset(sparse, (b * 7919) % length);
+  for (int b = 0; b < length; b += 3)
+    Bit_bset(dense, b);
+  int *counts = malloc(n * sizeof(int)), *expect = malloc(n * sizeof(int));
+  const Bit_count_ops ops[] = {BIT_COUNT_INTER, BIT_COUNT_UNION,
+                               BIT_COUNT_DIFF, BIT_COUNT_MINUS};
+  bool success = true;
+  for (int round = 0; round < 2; round++) {
+    for (int o = 0; o < 4; o++)
+      for (int which = 0; which < 2; which++) {
+        Bit_T q = which ? dense : sparse;
+        BitDB_query_count_store(q, db, ops[o], counts, opts);
+        BitDB_query_count_store(q, plain, ops[o], expect, opts);
+        success = success && !memcmp(counts, expect, n * sizeof(int));
+      }
+    // writes through the API leave the index stale until the next query
+    Bit_T row = Bit_new(length);
+    Bit_bset(row, (3 * 7919) % length);
+    BitDB_put_at(db, 17, row);
+    BitDB_put_at(plain, 17, row);
+    BitDB_clear_at(db, 18);
+    BitDB_clear_at(plain, 18);
+    Bit_free(&row);
+  }
+  // without row counts only intersections take the postings
+  BitDB_cache_counts(db, false, opts);
+  BitDB_query_count_store(sparse, db, BIT_COUNT_UNION, counts, opts);
+  BitDB_query_count_store(sparse, plain, BIT_COUNT_UNION, expect, opts);
+  success = success && !memcmp(counts, expect, n * sizeof(int));
+  BitDB_cache_postings(db, false, opts);
+  BitDB_query_count_store(sparse, db, BIT_COUNT_INTER, counts, opts);
+  BitDB_query_count_store(sparse, plain, BIT_COUNT_INTER, expect, opts);
+  success = success && !memcmp(counts, expect, n * sizeof(int)) &&
+            counts[17] == 1 && counts[18] == 0;
+
+  free(counts);
+  free(expect);
+  Bit_free(&sparse);
+  Bit_free(&dense);
+  BitDB_free(&db);
+  BitDB_free(&plain);
+  report_test(__func__, success);
+  return success;
+}
+
+bool test_bit_bsi() {
+  const int n = 100003, bits = 20;
+  uint64_t *values = malloc(n * sizeof(uint64_t));
+  srand(12);
+  for (int i = 0; i < n; i++)
+    values[i] = i % 7 ? (uint64_t)rand() % 1000 : (uint64_t)rand() % (1 << bits);
+  Bit_BSI_T bsi = Bit_BSI_new(n, bits);
+  Bit_BSI_load(bsi, values);
+  Bit_BSI_put(bsi, 5, 999);
+  values[5] = 999;
+  bool success = Bit_BSI_length(bsi) == n && Bit_BSI_bits(bsi) == bits &&
+                 Bit_BSI_get(bsi, 5) == 999 &&
+                 Bit_BSI_get(bsi, n - 1) == values[n - 1];
+
+  const uint64_t constants[] = {0, 1, 500, 999, (1 << bits) - 1, 1 << bits};
+  for (int c = 0; c < 6 && success; c++)
+    for (Bit_bsi_op op = BIT_BSI_LT; op <= BIT_BSI_NE && success; op++) {
+      Bit_T mask = Bit_BSI_compare(bsi, op, constants[c]);
+      const uint64_t v = constants[c];
+      for (int i = 0; i < n && success; i++) {
+        const uint64_t x = values[i];
+        int expect = op == BIT_BSI_LT   ? x < v
+                     : op == BIT_BSI_LE ? x <= v
+                     : op == BIT_BSI_GT ? x > v
+                     : op == BIT_BSI_GE ? x >= v
+                     : op == BIT_BSI_EQ ? x == v
+                                        : x != v;
+        success = Bit_get(mask, i) == expect;
+      }
+      Bit_free(&mask);
+    }
+
+  // a range as a mask, and the sum and top rows within it
+  Bit_T range = Bit_BSI_between(bsi, 100, 900);
+  uint64_t sum = 0, total = 0;
+  int inside = 0;
+  for (int i = 0; i < n; i++) {
+    total += values[i];
+    if (values[i] >= 100 && values[i] <= 900) {
+      sum += values[i];
+      inside++;
+    }
+  }
+  success = success && Bit_count(range) == inside &&
+            Bit_BSI_sum(bsi, range) == sum && Bit_BSI_sum(bsi, NULL) == total;
+  const int k = 50;
+  Bit_T top = Bit_BSI_topk(bsi, range, k);
+  // the k-th largest value in the range, and how many rows exceed it
+  int histogram[901] = {0};
+  for (int i = 0; i < n; i++)
+    if (values[i] >= 100 && values[i] <= 900)
+      histogram[values[i]]++;
+  uint64_t kth = 900;
+  for (int atleast = histogram[900]; atleast < k;)
+    atleast += histogram[--kth];
+  int above = 0, last = -1;
+  for (int i = Bit_next_set(top, 0); i >= 0 && success;
+       i = Bit_next_set(top, i + 1)) {
+    success = values[i] >= kth && values[i] <= 900;
+    above += values[i] > kth;
+    last = values[i] == kth ? i : last;
+  }
+  // ties at the k-th value go to the lower rows
+  for (int i = 0; i < last && success; i++)
+    success = values[i] != kth || Bit_get(top, i);
+  success = success && Bit_count(top) == k;
+  Bit_T all = Bit_BSI_topk(bsi, NULL, n + 10);
+  success = success && Bit_count(all) == n;
+
+  Bit_free(&all);
+  Bit_free(&top);
+  Bit_free(&range);
+  Bit_BSI_free(&bsi);
+  free(values);
+  report_test(__func__, success);
+  return success;
+}
+
+/* Rows of a and b equal, through views */
+static bool same_rows(Bit_DB_T a, Bit_DB_T b) {
+  if (!a || !b || BitDB_nelem(a) != BitDB_nelem(b) ||
+      BitDB_length(a) != BitDB_length(b))
+    return false;
+  Bit_T r = NULL, s = NULL;
+  bool same = true;
+  for (int i = 0; i < BitDB_nelem(a) && same; i++) {
+    BitDB_view_at(a, i, &r);
+    BitDB_view_at(b, i, &s);
+    same = Bit_eq(r, s);
+  }
+  Bit_free(&r);
+  Bit_free(&s);
+  return same;
+}
+
+bool test_bit_load_text() {
+  const int n = 5000, length = 1000;
+  SETOP_COUNT_OPTS opts = {.num_cpu_threads = 3};
+  Bit_DB_T expect = random_matrix(n, length, 5, 13);
+  const char *hex_path = "test_bit_load_text.fps";
+  const char *csv_path = "test_bit_load_text.csv";
+  FILE *hex = fopen(hex_path, "w"), *csv = fopen(csv_path, "w");
+  fprintf(hex, "#FPS1\n#num_bits=%d\n", length);
+  unsigned char bytes[128]; // 125 bytes of a row, padded to whole qwords
+  Bit_T row = NULL;
+  for (int i = 0; i < n; i++) {
+    BitDB_extract_from(expect, i, bytes);
+    for (int b = 0; b < 125; b++)
+      fprintf(hex, "%02X", bytes[b]);
+    fprintf(hex, i % 3 ? "\tid%d\n" : "\tid%d\r\n", i);
+    if (i == n / 2)
+      fprintf(hex, "\n");
+    BitDB_view_at(expect, i, &row);
+    for (int j = Bit_next_set(row, 0), first = 1; j >= 0;
+         j = Bit_next_set(row, j + 1), first = 0)
+      fprintf(csv, first ? "%d" : (j % 2 ? ", %d" : ";%d"), j);
+    fprintf(csv, "\n");
+  }
+  fclose(hex);
+  fclose(csv);
+
+  Bit_DB_T from_hex = BitDB_load_text(hex_path, BIT_TEXT_HEX, 0, opts);
+  Bit_DB_T from_csv = BitDB_load_text(csv_path, BIT_TEXT_INDICES, length, opts);
+  bool success = same_rows(from_hex, expect) && same_rows(from_csv, expect);
+  // a shorter length masks the hex digits past it
+  Bit_DB_T shorter = BitDB_load_text(hex_path, BIT_TEXT_HEX, length - 3, opts);
+  success = success && shorter && BitDB_length(shorter) == length - 3;
+  for (int i = 0; i < n && success; i++) {
+    BitDB_view_at(expect, i, &row);
+    const int cut = Bit_get(row, length - 1) + Bit_get(row, length - 2) +
+                    Bit_get(row, length - 3);
+    BitDB_view_at(shorter, i, &row);
+    success = Bit_count(row) == BitDB_count_at(expect, i) - cut;
+  }
+  // lengths that do not match the file, malformed files, missing files
+  success = success &&
+            !BitDB_load_text(hex_path, BIT_TEXT_HEX, length + 8, opts) &&
+            !BitDB_load_text(csv_path, BIT_TEXT_INDICES, 10, opts) &&
+            !BitDB_load_text(hex_path, BIT_TEXT_INDICES, 0, opts) &&
+            !BitDB_load_text("no_such_file.fps", BIT_TEXT_HEX, 0, opts);
+
+  Bit_free(&row);
+  BitDB_free(&expect);
+  if (from_hex)
+    BitDB_free(&from_hex);
+  if (from_csv)
+    BitDB_free(&from_csv);
+  if (shorter)
+    BitDB_free(&shorter);
+  remove(hex_path);
+  remove(csv_path);
+  report_test(__func__, success);
+  return success;
+}
+
+bool test_bit_writer() {
+  // 512 byte rows: 20000 of them take more than one staging buffer
+  const int n = 20000, length = 4096, row_bytes = length / 8;
+  Bit_DB_T expect = random_matrix(n, length, 3, 29);
+  unsigned char *rows = malloc((size_t)n * row_bytes);
+  for (int i = 0; i < n; i++)
+    BitDB_extract_from(expect, i, rows + (size_t)i * row_bytes);
+  const char *path = "test_bit_writer.bdb";
+  bool success = true;
+  for (int flags = 0; flags <= BIT_DB_WRITER_DIRECT; flags++) {
+    Bit_writer_T writer = BitDB_writer_open(path, length, flags);
+    success = success && writer != NULL;
+    if (!writer)
+      break;
+    // single rows, then the rest in uneven batches
+    Bit_T row = NULL;
+    for (int i = 0; i < 7; i++) {
+      BitDB_view_at(expect, i, &row);
+      success = success && BitDB_writer_put(writer, row) == 0;
+    }
+    Bit_free(&row);
+    for (int i = 7, batch = 1; i < n; i += batch, batch = batch * 3 + 1) {
+      const int m = n - i < batch ? n - i : batch;
+      success = success &&
+                BitDB_writer_put_many(writer, m,
+                                      rows + (size_t)i * row_bytes) == 0;
+    }
+    success = success && BitDB_writer_close(&writer) == 0 && writer == NULL;
+    Bit_DB_T read = BitDB_open_mmap(path, BIT_DB_MMAP_VERIFY);
+    success = success && same_rows(read, expect);
+    if (read)
+      BitDB_free(&read);
+  }
+  // a file of no rows is refused, a directory cannot be written
+  Bit_writer_T empty = BitDB_writer_open(path, length, 0);
+  success = success && empty && BitDB_writer_close(&empty) == 0 &&
+            BitDB_open_mmap(path, 0) == NULL &&
+            BitDB_writer_open(".", length, 0) == NULL;
+
+  free(rows);
+  BitDB_free(&expect);
+  remove(path);
+  report_test(__func__, success);
+  return success;
+}
+
+bool test_bit_compressed_file() {
+  const int n = 5000, length = 1000, nq = 7;
+  SETOP_COUNT_OPTS opts = {.num_cpu_threads = 3};
+  Bit_DB_T library = random_matrix(n, length, 4, 31);
+  Bit_DB_T queries = random_matrix(nq, length, 20, 37);
+  const char *path = "test_bit_compressed_file.bdbz";
+  bool success = BitDB_save_compressed(library, path, 300, opts) == 0;
+  FILE *file = fopen(path, "rb");
+  fseek(file, 0, SEEK_END);
+  const long bytes = ftell(file);
+  fclose(file);
+  success = success && bytes < (long)n * Bit_buffer_size(length) / 2;
+  Bit_DB_T loaded = BitDB_load_compressed(path, opts);
+  success = success && same_rows(loaded, library);
+
+  // blocks of the stream that do not line up with those of the file
+  int *expected = BitDB_inter_count(queries, library, opts, cpu);
+  int *streamed = calloc((size_t)nq * n, sizeof(int));
+  stream_sink sink = {streamed, n, nq};
+  Bit_zreader_T reader = BitDB_zreader_open(path, opts);
+  success = success && reader && BitDB_zreader_nelem(reader) == n &&
+            BitDB_zreader_length(reader) == length;
+  if (reader) {
+    BitDB_inter_count_stream_cpu(queries, BitDB_zreader_read, reader, 700,
+                                 stream_emit, &sink, opts);
+    success = success && BitDB_zreader_close(&reader) == 0 &&
+              memcmp(expected, streamed, (size_t)nq * n * sizeof(int)) == 0;
+  }
+
+  // a corrupt block fails the read, a missing file the open
+  file = fopen(path, "r+b");
+  fseek(file, 5000, SEEK_SET);
+  const int byte = fgetc(file);
+  fseek(file, 5000, SEEK_SET);
+  fputc(byte ^ 0x10, file);
+  fclose(file);
+  success = success && BitDB_load_compressed(path, opts) == NULL &&
+            BitDB_zreader_open("no_such_file.bdbz", opts) == NULL;
+
+  free(expected);
+  free(streamed);
+  if (loaded)
+    BitDB_free(&loaded);
+  BitDB_free(&library);
+  BitDB_free(&queries);
+  remove(path);
+  report_test(__func__, success);
+  return success;
+}
+
+bool test_bit_reader() {
+  // 10 MB of rows: the slots of the reader are reused
+  const int n = 20000, length = 4096, nq = 3;
+  SETOP_COUNT_OPTS opts = {.num_cpu_threads = 2};
+  Bit_DB_T library = random_matrix(n, length, 3, 41);
+  Bit_DB_T queries = random_matrix(nq, length, 30, 43);
+  const char *path = "test_bit_reader.bdb";
+  bool success = BitDB_save(library, path) == 0;
+  int *expected = BitDB_inter_count(queries, library, opts, cpu);
+  int *streamed = calloc((size_t)nq * n, sizeof(int));
+  stream_sink sink = {streamed, n, nq};
+  const int flags[] = {0, BIT_DB_READER_DIRECT, BIT_DB_READER_PREAD,
+                       BIT_DB_READER_PREAD | BIT_DB_READER_DIRECT};
+  for (int f = 0; f < 4 && success; f++) {
+    Bit_reader_T reader = BitDB_reader_open(path, flags[f]);
+    success = reader && BitDB_reader_nelem(reader) == n &&
+              BitDB_reader_length(reader) == length;
+    if (!reader)
+      break;
+    memset(streamed, 0, (size_t)nq * n * sizeof(int));
+    BitDB_inter_count_stream_cpu(queries, BitDB_reader_read, reader, 999,
+                                 stream_emit, &sink, opts);
+    success = success && BitDB_reader_close(&reader) == 0 && !reader &&
+              memcmp(expected, streamed, (size_t)nq * n * sizeof(int)) == 0;
+  }
+
+  // rows padded in the file come out packed; a reader may stop early
+  Bit_DB_T padded = BitDB_new_padded(1100, 50, 64);
+  Bit_T row = Bit_new(1100);
+  for (int i = 0; i < 50; i++) {
+    Bit_clear(row, 0, 1099);
+    Bit_set(row, i, i + 1000);
+    BitDB_put_at(padded, i, row);
+  }
+  success = success && BitDB_save(padded, path) == 0;
+  Bit_reader_T reader = BitDB_reader_open(path, 0);
+  unsigned char rows[50 * Bit_buffer_size(1100)];
+  unsigned char expect[Bit_buffer_size(1100)];
+  success = success && reader &&
+            BitDB_reader_read(reader, rows, 30, Bit_buffer_size(1100)) ==
+                30 &&
+            BitDB_reader_read(reader, rows + 30 * Bit_buffer_size(1100), 30,
+                              Bit_buffer_size(1100)) == 20;
+  for (int i = 0; i < 50 && success; i++) {
+    BitDB_extract_from(padded, i, expect);
+    success = memcmp(rows + i * Bit_buffer_size(1100), expect,
+                     sizeof(expect)) == 0;
+  }
+  success = success && reader && BitDB_reader_close(&reader) == 0;
+  reader = BitDB_reader_open(path, 0);
+  success = success && reader &&
+            BitDB_reader_read(reader, rows, 10, Bit_buffer_size(1100)) ==
+                10 &&
+            BitDB_reader_close(&reader) == 0;
+  success = success && BitDB_reader_open("no_such_file.bdb", 0) == NULL;
+
+  free(expected);
+  free(streamed);
+  Bit_free(&row);
+  BitDB_free(&padded);
+  BitDB_free(&library);
+  BitDB_free(&queries);
+  remove(path);
+  report_test(__func__, success);
+  return success;
+}
+
+typedef struct {
+  int *counts; // the full matrix, assembled from the tiles
+  int *next;   // target each query expects its next tile to start at
+  int ntargets;
+  _Atomic bool ordered;
+} tile_sink;
+
+static void tile_sink_put(void *cl, int first_query, int nquery,
+                          int first_target, int ntarget, const int *tile) {
+  tile_sink *sink = cl;
+  for (int i = 0; i < nquery; i++) {
+    const int q = first_query + i;
+    if (sink->next[q] != first_target)
+      sink->ordered = false;
+    sink->next[q] = first_target + ntarget;
+    memcpy(sink->counts + (size_t)q * sink->ntargets + first_target,
+           tile + (size_t)i * ntarget, (size_t)ntarget * sizeof(int));
+  }
+}
+
+bool test_bit_count_tiles() {
+  const int nq = 150, nt = 2500, length = 300;
+  SETOP_COUNT_OPTS opts = {.num_cpu_threads = 3};
+  Bit_DB_T queries = random_matrix(nq, length, 20, 47);
+  Bit_DB_T targets = random_matrix(nt, length, 30, 53);
+  int *expected = BitDB_minus_count(queries, targets, opts, cpu);
+  tile_sink sink = {malloc((size_t)nq * nt * sizeof(int)),
+                    calloc(nq, sizeof(int)), nt, true};
+  BitDB_count_tiles_cpu(queries, targets, BIT_COUNT_MINUS, tile_sink_put,
+                        &sink, opts);
+  bool success =
+      sink.ordered &&
+      memcmp(sink.counts, expected, (size_t)nq * nt * sizeof(int)) == 0;
+
+  // the narrowed matrix in a file
+  int *unions = BitDB_union_count(queries, targets, opts, cpu);
+  const char *path = "test_bit_count_tiles.u16";
+  success = success &&
+            BitDB_count_store_file_cpu(queries, targets, BIT_COUNT_UNION,
+                                       BIT_COUNTS_U16, path, opts) == 0;
+  uint16_t *stored = malloc((size_t)nq * nt * sizeof(uint16_t));
+  FILE *file = fopen(path, "rb");
+  success = success && file &&
+            fread(stored, sizeof(uint16_t), (size_t)nq * nt, file) ==
+                (size_t)nq * nt &&
+            fgetc(file) == EOF;
+  for (size_t m = 0; m < (size_t)nq * nt && success; m++)
+    success = stored[m] == unions[m];
+  if (file)
+    fclose(file);
+  success = success &&
+            BitDB_count_store_file_cpu(queries, targets, BIT_COUNT_UNION,
+                                       BIT_COUNTS_AUTO, ".", opts) == -1;
+
+  free(sink.counts);
+  free(sink.next);
+  free(expected);
+  free(unions);
+  free(stored);
+  BitDB_free(&queries);
+  BitDB_free(&targets);
+  remove(path);
+  report_test(__func__, success);
+  return success;
+}
+
+bool test_bit_huge_pages() {
+  const int len = 700, n = 200, grown = 260;
+  SETOP_COUNT_OPTS opts = {.num_cpu_threads = 2};
+  Bit_DB_T plain = random_matrix(grown, len, 25, 61);
+  Bit_DB_T queries = random_matrix(11, len, 25, 67);
+  int *want = BitDB_inter_count(queries, plain, opts, cpu);
+  bool success = BitDB_pages(plain) == BIT_PAGES_DEFAULT;
+  for (Bit_page_policy pages = BIT_PAGES_DEFAULT;
+       pages <= BIT_PAGES_HUGETLB_1G; pages++) {
+    Bit_DB_T huge = BitDB_new_huge(len, n, 64, pages);
+    success = success && BitDB_nelem(huge) == n &&
+              BitDB_pages(huge) <= pages; // huge pages are only a hint
+    for (int i = 0; i < n; i++) // huge rows start zeroed
+      success = success && BitDB_count_at(huge, i) == 0;
+    for (int i = 0; i < grown; i++) { // the last rows grow the container
+      Bit_T bit = BitDB_get_from(plain, i);
+      if (i < n)
+        BitDB_put_at(huge, i, bit);
+      else
+        BitDB_append(huge, bit);
+      Bit_free(&bit);
+    }
+    int *got = BitDB_inter_count(queries, huge, opts, cpu);
+    success = success && BitDB_nelem(huge) == grown &&
+              memcmp(want, got, 11 * grown * sizeof(int)) == 0;
+    free(got);
+    BitDB_free(&huge);
+  }
+
+  size_t nbytes = (size_t)3 << 20;
+  unsigned char *buffer = Bit_huge_alloc(nbytes, BIT_PAGES_HUGE);
+  success = success && ((uintptr_t)buffer & 31) == 0 &&
+            Bit_huge_pages(buffer) <= BIT_PAGES_HUGE;
+  for (size_t i = 0; i < nbytes && success; i += 4093) // zeroed, writable
+    success = buffer[i] == 0 && (buffer[i] = 1);
+  Bit_huge_free(buffer);
+  Bit_huge_free(NULL);
+
+  // huge pages asked for a mapped file change nothing else
+  const char *path = "test_bit_huge_pages.bdb";
+  success = success && BitDB_save(plain, path) == 0;
+  Bit_DB_T mapped = BitDB_open_mmap(path, BIT_DB_MMAP_HUGE);
+  success = success && mapped != NULL;
+  if (mapped) {
+    int *got = BitDB_inter_count(queries, mapped, opts, cpu);
+    success = success && memcmp(want, got, 11 * grown * sizeof(int)) == 0;
+    free(got);
+    BitDB_free(&mapped);
+  }
+  remove(path);
+  free(want);
+  BitDB_free(&plain);
+  BitDB_free(&queries);
+  report_test(__func__, success);
+  return success;
+}
+
+bool test_bit_shared() {
+  const int len = 500, n = 300;
+  const char *name = "/test_bit_shared";
+  SETOP_COUNT_OPTS opts = {.num_cpu_threads = 2};
+  Bit_DB_T rows = random_matrix(n, len, 25, 71);
+  Bit_DB_T queries = random_matrix(5, len, 25, 73);
+  int *want = BitDB_inter_count(queries, rows, opts, cpu);
+  BitDB_unlink_shared(name); // left over by an interrupted run
+  Bit_DB_T owner = BitDB_create_shared(name, len, n, BIT_DB_SHARED_HUGE);
+  bool success = owner != NULL &&
+                 BitDB_create_shared(name, len, n, 0) == NULL &&
+                 BitDB_attach_shared(name) == NULL; // not published yet
+  if (!success) {
+    BitDB_unlink_shared(name);
+    report_test(__func__, success);
+    return success;
+  }
+  success = BitDB_shared_generation(owner) == 1 &&
+            BitDB_shared_generation(rows) == 0;
+  for (int i = 0; i < n; i++) {
+    Bit_T bit = BitDB_get_from(rows, i);
+    BitDB_put_at(owner, i, bit);
+    Bit_free(&bit);
+  }
+  success = success && BitDB_shared_publish(owner) == 2;
+
+  Bit_DB_T worker = BitDB_attach_shared(name);
+  success = success && worker != NULL && BitDB_nelem(worker) == n &&
+            BitDB_shared_generation(worker) == 2;
+  if (worker) {
+    int *got = BitDB_inter_count(queries, worker, opts, cpu);
+    success = success && memcmp(want, got, 5 * n * sizeof(int)) == 0;
+    free(got);
+    // a rewrite shows through the odd generation, then the next even one
+    BitDB_shared_begin_write(owner);
+    success = success && BitDB_shared_generation(worker) == 3;
+    BitDB_clear_at(owner, 7);
+    success = success && BitDB_count_at(worker, 7) == 0 &&
+              BitDB_shared_publish(owner) == 4 &&
+              BitDB_shared_generation(worker) == 4;
+    BitDB_free(&worker);
+  }
+  success = success && BitDB_unlink_shared(name) == 0 &&
+            BitDB_attach_shared(name) == NULL &&
+            BitDB_count_at(owner, 8) == BitDB_count_at(rows, 8);
+  free(want);
+  BitDB_free(&owner);
+  BitDB_free(&rows);
+  BitDB_free(&queries);
+  report_test(__func__, success);
+  return success;
+}
+
+/* Whether two containers hold the same rows */
+static bool arrow_rows_equal(Bit_DB_T a, Bit_DB_T b) {
+  bool same = BitDB_nelem(a) == BitDB_nelem(b) &&
+              BitDB_length(a) == BitDB_length(b);
+  for (int i = 0; same && i < BitDB_nelem(a); i++) {
+    Bit_T x = BitDB_get_from(a, i), y = BitDB_get_from(b, i);
+    same = Bit_eq(x, y);
+    Bit_free(&x);
+    Bit_free(&y);
+  }
+  return same;
+}
+
+static void arrow_release_array(struct ArrowArray *array) {
+  array->release = NULL;
+}
+
+static void arrow_release_schema(struct ArrowSchema *schema) {
+  schema->release = NULL;
+}
+
+bool test_bit_arrow() {
+  struct ArrowArray array;
+  struct ArrowSchema schema;
+  // a Bit_T goes out as a view of its bytes and comes back as one
+  Bit_T bit = Bit_new(1000);
+  for (int i = 0; i < 1000; i += 7)
+    Bit_bset(bit, i);
+  Bit_to_arrow(bit, &array, &schema);
+  bool success = strcmp(schema.format, "b") == 0 && array.length == 1000 &&
+                 array.null_count == 0 && array.buffers[0] == NULL;
+  Bit_T view = Bit_from_arrow(&array, &schema, BIT_ARROW_PADDED);
+  Bit_T copy = Bit_from_arrow(&array, &schema, 0); // may end mid-qword
+  success = success && Bit_eq(view, bit) && Bit_eq(copy, bit) &&
+            Bit_free(&view) != NULL && Bit_free(&copy) == NULL;
+  array.release(&array);
+  schema.release(&schema);
+  success = success && array.release == NULL && schema.release == NULL;
+
+  // an offset that is not on a qword, and nulls
+  unsigned char values[40], validity[40];
+  for (int i = 0; i < 40; i++) {
+    values[i] = (unsigned char)(i * 37 + 11);
+    validity[i] = (unsigned char)(i % 5 ? 0xff : 0xee);
+  }
+  const void *buffers[2] = {NULL, values};
+  struct ArrowArray borrowed = {.length = 290, .offset = 13, .n_buffers = 2,
+                                .buffers = buffers,
+                                .release = arrow_release_array};
+  struct ArrowSchema boolean = {.format = "b",
+                                .release = arrow_release_schema};
+  for (int pass = 0; pass < 2; pass++) {
+    if (pass == 1) {
+      buffers[0] = validity;
+      borrowed.null_count = -1; // not known
+    }
+    Bit_T got = Bit_from_arrow(&borrowed, &boolean, BIT_ARROW_PADDED);
+    success = success && got && Bit_length(got) == 290;
+    for (int i = 0; got && i < 290; i++) {
+      int at = i + 13;
+      int want = (values[at / 8] >> (at % 8)) & 1;
+      if (pass == 1)
+        want &= (validity[at / 8] >> (at % 8)) & 1;
+      success = success && Bit_get(got, i) == want;
+    }
+    if (got)
+      Bit_free(&got);
+  }
+  boolean.format = "i";
+  success = success && Bit_from_arrow(&borrowed, &boolean, 0) == NULL;
+
+  // containers as fixed size binary (a view) and as lists of booleans
+  Bit_DB_T rows = random_matrix(50, 300, 30, 79);
+  BitDB_to_arrow(rows, BIT_ARROW_BINARY, &array, &schema);
+  success = success && strcmp(schema.format, "w:40") == 0;
+  Bit_DB_T back = BitDB_from_arrow(&array, &schema, 0);
+  success = success && back && arrow_rows_equal(back, rows) &&
+            BitDB_free(&back) != NULL;
+  array.release(&array);
+  schema.release(&schema);
+  BitDB_to_arrow(rows, BIT_ARROW_BOOL_LIST, &array, &schema);
+  success = success && strcmp(schema.format, "+w:300") == 0 &&
+            array.children[0]->length == 50 * 300 &&
+            strcmp(schema.children[0]->format, "b") == 0;
+  back = BitDB_from_arrow(&array, &schema, 0);
+  success = success && back && arrow_rows_equal(back, rows) &&
+            BitDB_free(&back) == NULL;
+  array.release(&array);
+  schema.release(&schema);
+  BitDB_free(&rows);
+
+  Bit_DB_T wide = random_matrix(20, 256, 30, 83);
+  BitDB_to_arrow(wide, BIT_ARROW_BOOL_LIST, &array, &schema);
+  back = BitDB_from_arrow(&array, &schema, 0);
+  success = success && back && arrow_rows_equal(back, wide) &&
+            BitDB_free(&back) != NULL;
+  // a null row comes back empty, and narrower rows than the width
+  array.null_count = 1;
+  unsigned char row_validity[3] = {0xfb, 0xff, 0xff}; // row 2 is null
+  const void *list_buffers[1] = {row_validity};
+  const void **exported = array.buffers;
+  array.buffers = list_buffers;
+  back = BitDB_from_arrow(&array, &schema, 200);
+  success = success && back && BitDB_length(back) == 200 &&
+            BitDB_count_at(back, 2) == 0 &&
+            BitDB_count_at(back, 3) > 0 &&
+            BitDB_free(&back) == NULL &&
+            BitDB_from_arrow(&array, &schema, 257) == NULL;
+  array.buffers = exported;
+  array.release(&array);
+  schema.release(&schema);
+  BitDB_free(&wide);
+  Bit_free(&bit);
+  report_test(__func__, success);
+  return success;
+}
+
+bool test_bitDB_delta() {
+  const int len = 333, n = 200;
+  Bit_DB_T primary = random_matrix(n, len, 30, 89);
+  Bit_DB_T replica = BitDB_new(len, n);
+  Bit_DB_T fresh = random_matrix(6, len, 50, 97); // rows to write
+  for (int i = 0; i < n; i++) {
+    Bit_T row = BitDB_get_from(primary, i);
+    BitDB_put_at(replica, i, row);
+    Bit_free(&row);
+  }
+  BitDB_track_changes(primary, true);
+  BitDB_track_changes(replica, true); // replicas may be tracked in turn
+  Bit_T row = BitDB_get_from(fresh, 0), old = BitDB_get_from(primary, 60);
+  BitDB_put_at(primary, 5, row);
+  unsigned char buffer[64] = {0};
+  BitDB_extract_from(fresh, 1, buffer);
+  BitDB_replace_at(primary, 17, buffer);
+  BitDB_clear_at(primary, 40);
+  BitDB_put_at(primary, 60, row);
+  BitDB_put_at(primary, 60, old); // back as it was: no delta
+  BitDB_append(primary, row);
+  BitDB_append_many(primary, 1, NULL);
+  bool success = BitDB_changed_rows(primary) == 6;
+
+  void *delta = NULL;
+  size_t bytes = BitDB_export_delta(primary, &delta);
+  success = success && delta != NULL && BitDB_changed_rows(primary) == 0 &&
+            bytes == 48 + 6 * 4 + 5 * 48; // header, indices, 5 rows
+  success = success && BitDB_apply_delta(replica, delta, bytes) == 0 &&
+            arrow_rows_equal(replica, primary) &&
+            BitDB_changed_rows(replica) == 5 &&
+            BitDB_apply_delta(replica, delta, bytes) == -1; // not its base
+  ((unsigned char *)delta)[bytes - 1] ^= 1;
+  success = success && BitDB_apply_delta(replica, delta, bytes) == -1;
+  free(delta);
+
+  // nothing written since: an empty delta; rows moved: none at all
+  bytes = BitDB_export_delta(primary, &delta);
+  success = success && BitDB_apply_delta(replica, delta, bytes) == 0 &&
+            arrow_rows_equal(replica, primary);
+  free(delta);
+  BitDB_insert_at(primary, 3, row);
+  success = success && BitDB_export_delta(primary, &delta) == 0 &&
+            delta == NULL;
+  BitDB_track_changes(primary, false);
+  success = success && BitDB_changed_rows(primary) == 0;
+
+  Bit_free(&row);
+  Bit_free(&old);
+  BitDB_free(&primary);
+  BitDB_free(&replica);
+  BitDB_free(&fresh);
+  report_test(__func__, success);
+  return success;
+}
+
+bool test_bit_count_tiled() {
+  const int nq = 150, nt = 2500, length = 300;
+  SETOP_COUNT_OPTS opts = {.num_cpu_threads = 3};
+  Bit_DB_T queries = random_matrix(nq, length, 20, 47);
+  Bit_DB_T targets = random_matrix(nt, length, 30, 53);
+  int *unions = BitDB_union_count(queries, targets, opts, cpu);
+  const char *path = "test_bit_count_tiled.tcm";
+  bool success = true;
+  for (int flags = 0; flags <= BIT_TILES_COMPRESSED; flags++) {
+    for (Bit_counts_type type = BIT_COUNTS_U16; type <= BIT_COUNTS_I32;
+         type++) {
+      success = success &&
+                BitDB_count_store_tiled_cpu(queries, targets,
+                                            BIT_COUNT_UNION, type, path,
+                                            flags, opts) == 0;
+      Bit_tiles_T tiles = success ? BitDB_tiles_open(path) : NULL;
+      int rows = 0, cols = 0, tile_rows = 0, tile_cols = 0;
+      success = tiles != NULL &&
+                BitDB_tiles_size(tiles, &rows, &cols, &tile_rows,
+                                 &tile_cols) == type &&
+                rows == nq && cols == nt && tile_rows > 0 && tile_cols > 0;
+      for (int i = 0; i < nq && success; i++)
+        for (int j = 0; j < nt && success; j++)
+          success = BitDB_tiles_get(tiles, i, j) ==
+                    unions[(size_t)i * nt + j];
+      // the last tile holds the corner of the matrix, zero past it
+      int *block = success ? malloc((size_t)tile_rows * tile_cols *
+                                    sizeof(int))
+                           : NULL;
+      const int r = (nq - 1) / tile_rows, c = (nt - 1) / tile_cols;
+      success = block && BitDB_tiles_block(tiles, r, c, block) == 0;
+      for (int i = 0; i < tile_rows && success; i++) {
+        for (int j = 0; j < tile_cols && success; j++) {
+          const int q = r * tile_rows + i, t = c * tile_cols + j;
+          success = block[i * tile_cols + j] ==
+                    (q < nq && t < nt ? unions[(size_t)q * nt + t] : 0);
+        }
+      }
+      free(block);
+      if (tiles)
+        BitDB_tiles_close(&tiles);
+      success = success && tiles == NULL;
+    }
+  }
+
+  // a damaged header is refused
+  FILE *file = fopen(path, "r+b");
+  success = success && file && fseek(file, 24, SEEK_SET) == 0 &&
+            fputc(0x7f, file) != EOF;
+  if (file)
+    fclose(file);
+  success = success && BitDB_tiles_open(path) == NULL &&
+            BitDB_tiles_open("test_bit_count_tiled.none") == NULL &&
+            BitDB_count_store_tiled_cpu(queries, targets, BIT_COUNT_UNION,
+                                        BIT_COUNTS_AUTO, ".", 0, opts) == -1;
+
+  free(unions);
+  BitDB_free(&queries);
+  BitDB_free(&targets);
+  remove(path);
+  report_test(__func__, success);
+  return success;
+}
+
+bool test_bitDB_concurrent() {
+  const int len = 4096, n = 256, rounds = 200;
+  SETOP_COUNT_OPTS opts = {.num_cpu_threads = 1};
+  Bit_DB_T db = BitDB_new(len, n);
+  Bit_DB_T query = BitDB_new(len, 1);
+  Bit_T ones = Bit_new(len), zeros = Bit_new(len);
+  Bit_set(ones, 0, len - 1);
+  BitDB_put_at(query, 0, ones);
+  BitDB_concurrent(db, true);
+  bool success = BitDB_is_concurrent(db) && !BitDB_is_concurrent(query);
+
+  // a write inside the rows of a token invalidates it, others do not
+  uint64_t token = BitDB_read_begin(db, 0, 64);
+  BitDB_put_at(db, 100, ones);
+  success = success && !BitDB_read_retry(db, 0, 64, token);
+  BitDB_put_at(db, 10, ones);
+  success = success && BitDB_read_retry(db, 0, 64, token) &&
+            !BitDB_read_retry(query, 0, 1, BitDB_read_begin(query, 0, 1));
+  BitDB_clear(db);
+
+  // a writer flips whole rows between empty and full while counts run:
+  // every count is 0 or len, never a row half written
+  _Atomic bool torn = false;
+#pragma omp parallel sections num_threads(2)
+  {
+#pragma omp section
+    for (int r = 0; r < rounds; r++)
+      for (int i = r % 7; i < n; i += 7)
+        BitDB_put_at(db, i, r % 2 ? zeros : ones);
+#pragma omp section
+    for (int r = 0; r < rounds / 10; r++) {
+      int *counts = BitDB_inter_count(query, db, opts, cpu);
+      for (int i = 0; i < n; i++)
+        if (counts[i] != 0 && counts[i] != len)
+          torn = true;
+      free(counts);
+      Bit_T row = BitDB_get_from(db, r % n);
+      int count = Bit_count(row);
+      if (count != 0 && count != len)
+        torn = true;
+      Bit_free(&row);
+    }
+  }
+  success = success && !torn;
+
+  BitDB_concurrent(db, false);
+  success = success && !BitDB_is_concurrent(db);
+  Bit_free(&ones);
+  Bit_free(&zeros);
+  BitDB_free(&db);
+  BitDB_free(&query);
+  report_test(__func__, success);
+  return success;
+}
+
+bool test_bit_atomic_set() {
+  const int len = 100000, nthreads = 4;
+  Bit_T atomic = Bit_new(len), merged = Bit_new(len), expected = Bit_new(len);
+  Bit_cache_summary(atomic, true);
+  Bit_shards_T shards = Bit_shards_new(len, nthreads);
+  _Atomic int firsts = 0;
+  // every thread marks the multiples of 3 and of its own stride; the
+  // multiples of 3 are contended by all of them
+#pragma omp parallel for num_threads(nthreads) schedule(static, 1)
+  for (int me = 0; me < nthreads; me++) {
+    const int stride = 5 + me;
+    Bit_T shard = Bit_shards_get(shards, me);
+    int batch[64], n = 0;
+    for (int i = 0; i < len; i += 3) {
+      firsts += Bit_test_and_set(atomic, i) == 0;
+      Bit_bset(shard, i);
+    }
+    for (int i = me; i < len; i += stride) {
+      batch[n++] = i;
+      if (n == 64) {
+        Bit_aset_atomic(atomic, batch, n);
+        n = 0;
+      }
+      Bit_bset(shard, i);
+    }
+    Bit_aset_atomic(atomic, batch, n);
+    Bit_bset_atomic(atomic, len - 1);
+    Bit_bset(shard, len - 1);
+  }
+  for (int i = 0; i < len; i += 3)
+    Bit_bset(expected, i);
+  for (int me = 0; me < nthreads; me++)
+    for (int i = me; i < len; i += 5 + me)
+      Bit_bset(expected, i);
+  Bit_bset(expected, len - 1);
+  Bit_bset(merged, 7); // merging ORs into what the set holds
+  Bit_bset(expected, 7);
+  Bit_bset(atomic, 7);
+  Bit_shards_merge(shards, merged);
+  bool success = firsts == (len + 2) / 3 && Bit_eq(atomic, expected) &&
+                 Bit_eq(merged, expected) &&
+                 Bit_count(atomic) == Bit_count(expected) &&
+                 Bit_count(Bit_shards_get(shards, 0)) == 0 &&
+                 Bit_test_and_set(merged, 3) == 1;
+
+  Bit_shards_free(&shards);
+  success = success && shards == NULL;
+  Bit_free(&atomic);
+  Bit_free(&merged);
+  Bit_free(&expected);
+  report_test(__func__, success);
+  return success;
+}
+
+bool test_bitDB_build_from_csr() {
+  const int len = 1000, n = 500;
+  size_t *row_ptr = malloc((n + 1) * sizeof(size_t));
+  int *col_idx = malloc((size_t)n * 40 * sizeof(int));
+  Bit_DB_T expected = BitDB_new(len, n);
+  size_t nnz = 0;
+  srand(71);
+  for (int r = 0; r < n; r++) {
+    row_ptr[r] = nnz;
+    const int k = r % 5 == 0 ? 0 : rand() % 40; // some rows stay empty
+    Bit_T row = Bit_new(len);
+    for (int j = 0; j < k; j++) {
+      // sorted runs and scattered indices, repeats included
+      col_idx[nnz] = j < k / 2 ? (r + 3 * j) % len : rand() % len;
+      Bit_bset(row, col_idx[nnz++]);
+    }
+    BitDB_put_at(expected, r, row);
+    Bit_free(&row);
+  }
+  row_ptr[n] = nnz;
+  bool success = true;
+  for (int threads = 1; threads <= 3; threads++) {
+    SETOP_COUNT_OPTS opts = {.num_cpu_threads = threads};
+    Bit_DB_T built = BitDB_build_from_csr(len, n, row_ptr, col_idx, opts);
+    for (int r = 0; r < n && success && built; r++) {
+      Bit_T a = BitDB_get_from(built, r), b = BitDB_get_from(expected, r);
+      success = Bit_eq(a, b);
+      Bit_free(&a);
+      Bit_free(&b);
+    }
+    success = success && built && BitDB_nelem(built) == n;
+    if (built)
+      BitDB_free(&built);
+  }
+  // an index past the length is refused
+  col_idx[row_ptr[n - 1]] = len;
+  success = success &&
+            (row_ptr[n] == row_ptr[n - 1] ||
+             BitDB_build_from_csr(len, n, row_ptr, col_idx,
+                                  (SETOP_COUNT_OPTS){0}) == NULL);
+
+  free(row_ptr);
+  free(col_idx);
+  BitDB_free(&expected);
+  report_test(__func__, success);
+  return success;
+}
+
+bool test_bit_count_batch() {
+  const int len = 1500, n = 300;
+  Bit_DB_T rows = random_matrix(2 * n, len, 30, 101);
+  Bit_T a[300], b[300];
+  int out[300];
+  for (int i = 0; i < n; i++) {
+    a[i] = BitDB_get_from(rows, i);
+    b[i] = i % 7 ? BitDB_get_from(rows, n + i) : NULL;
+  }
+  for (int i = 0; i < n; i += 7)
+    b[i] = a[i]; // a bitset against itself
+  bool success = true;
+  Bit_inter_count_batch(a, b, n, out);
+  for (int i = 0; i < n && success; i++)
+    success = out[i] == Bit_inter_count(a[i], b[i]);
+  Bit_union_count_batch(a, b, n, out);
+  for (int i = 0; i < n && success; i++)
+    success = out[i] == Bit_union_count(a[i], b[i]);
+  Bit_diff_count_batch(a, b, n, out);
+  for (int i = 0; i < n && success; i++)
+    success = out[i] == Bit_diff_count(a[i], b[i]);
+  Bit_minus_count_batch(a, b, n, out);
+  for (int i = 0; i < n && success; i++)
+    success = out[i] == Bit_minus_count(a[i], b[i]);
+  Bit_inter_count_batch(NULL, NULL, 0, NULL); // an empty batch
+
+  for (int i = 0; i < n; i++) {
+    if (b[i] != a[i])
+      Bit_free(&b[i]);
+    Bit_free(&a[i]);
+  }
+  BitDB_free(&rows);
+  report_test(__func__, success);
+  return success;
+}
+
+/* The op of rows [0, n) of db at bit j, one row at a time */
+static int reduce_expected(Bit_DB_T db, int n, Bit_reduce_op op, int k,
+                           int j) {
+  int ones = 0;
+  for (int i = 0; i < n; i++) {
+    Bit_T row = BitDB_get_from(db, i);
+    ones += Bit_get(row, j);
+    Bit_free(&row);
+  }
+  switch (op) {
+  case BIT_REDUCE_OR:
+    return ones > 0;
+  case BIT_REDUCE_AND:
+    return ones == n;
+  case BIT_REDUCE_XOR:
+    return ones % 2;
+  case BIT_REDUCE_ATLEAST:
+    return ones >= k;
+  default:
+    return ones > n / 2;
+  }
+}
+
+bool test_bit_reduce() {
+  bool success = true;
+  // long rows (many blocks) and short ones (groups of rows per thread)
+  const int lengths[] = {20000, 200}, counts[] = {37, 301};
+  for (int c = 0; c < 2 && success; c++) {
+    const int len = lengths[c], n = counts[c];
+    Bit_DB_T db = random_matrix(n, len, c ? 50 : 3, 103);
+    if (c == 0) // a band every row has, for the intersection
+      for (int i = 0; i < n; i++) {
+        Bit_T row = BitDB_get_from(db, i);
+        Bit_set(row, 100, 400);
+        BitDB_put_at(db, i, row);
+        Bit_free(&row);
+      }
+    Bit_T *rows = malloc((size_t)n * sizeof(Bit_T));
+    for (int i = 0; i < n; i++)
+      rows[i] = BitDB_get_from(db, i);
+    Bit_T out = Bit_new(len), out_db = Bit_new(len);
+    for (Bit_reduce_op op = BIT_REDUCE_OR; op <= BIT_REDUCE_MAJORITY; op++) {
+      const int k = op == BIT_REDUCE_ATLEAST ? 3 : 0;
+      Bit_reduce(rows, n, op, k, out);
+      BitDB_reduce(db, op, k, out_db,
+                   (SETOP_COUNT_OPTS){.num_cpu_threads = 3});
+      success = success && Bit_eq(out, out_db);
+      // the bits are checked one row at a time on a sample
+      for (int j = 0; j < len && success; j += c ? 1 : 37)
+        success = Bit_get(out, j) == reduce_expected(db, n, op, k, j);
+    }
+    success = success && (c || Bit_count(out_db) > 0); // a non-trivial sample
+    Bit_reduce(rows, n, BIT_REDUCE_ATLEAST, n + 1, out); // more than exists
+    success = success && Bit_count(out) == 0;
+    Bit_reduce(rows, n, BIT_REDUCE_ATLEAST, 0, out); // every bit
+    success = success && Bit_count(out) == len;
+    for (int i = 0; i < n; i++)
+      Bit_free(&rows[i]);
+    free(rows);
+    Bit_free(&out);
+    Bit_free(&out_db);
+    BitDB_free(&db);
+  }
+  report_test(__func__, success);
+  return success;
+}
+
+bool test_bitDB_column_counts() {
+  bool success = true;
+  // many blocks of columns; and more rows than one set of counters holds
+  const int lengths[] = {20000, 130}, counts[] = {41, 70000};
+  for (int c = 0; c < 2 && success; c++) {
+    const int len = lengths[c], n = counts[c];
+    Bit_DB_T db = random_matrix(n, len, c ? 50 : 5, 104);
+    uint32_t *out = malloc((size_t)len * sizeof(uint32_t));
+    uint32_t *expected = calloc((size_t)len, sizeof(uint32_t));
+    Bit_T row = NULL;
+    for (int i = 0; i < n; i++) {
+      BitDB_view_at(db, i, &row);
+      for (int j = 0; j < len; j++)
+        expected[j] += (uint32_t)Bit_get(row, j);
+    }
+    Bit_free(&row);
+    // 8 threads split the 41 rows in groups; 1 thread counts 70000 rows
+    BitDB_column_counts(db, out,
+                        (SETOP_COUNT_OPTS){.num_cpu_threads = c ? 1 : 8});
+    success = memcmp(out, expected, (size_t)len * sizeof(uint32_t)) == 0;
+    free(out);
+    free(expected);
+    BitDB_free(&db);
+  }
+  report_test(__func__, success);
+  return success;
+}
+
+bool test_bitDB_row_mask() {
+  const int len = 300, nq = 30, nt = 1500, k = 6;
+  Bit_DB_T queries = random_matrix(nq, len, 20, 105);
+  Bit_DB_T targets = random_matrix(nt, len, 20, 106);
+  Bit_T mask = Bit_new(nt); // every third target, and one run of them
+  for (int j = 0; j < nt; j += 3)
+    Bit_bset(mask, j);
+  Bit_set(mask, 700, 1000);
+  SETOP_COUNT_OPTS opts = {.num_cpu_threads = 3};
+  int *full = BitDB_inter_count(queries, targets, opts, cpu);
+  SETOP_COUNT_OPTS masked = opts;
+  masked.row_mask = mask;
+  bool success = true;
+
+  // the top-k of the selected targets, by insertion into k slots
+  int *idx = malloc(nq * k * sizeof(int));
+  int *count = malloc(nq * k * sizeof(int));
+  int *gpu_idx = malloc(nq * k * sizeof(int));
+  int *gpu_count = malloc(nq * k * sizeof(int));
+  BitDB_inter_count_topk(queries, targets, k, masked, idx, count);
+  BitDB_inter_count_topk_gpu(queries, targets, k, masked, gpu_idx, gpu_count);
+  for (int q = 0; q < nq && success; q++) {
+    int want_idx[6], want_count[6];
+    for (int r = 0; r < k; r++)
+      want_idx[r] = want_count[r] = -1;
+    for (int j = 0; j < nt; j++) {
+      const int c = full[(size_t)q * nt + j];
+      if (!Bit_get(mask, j) || c <= want_count[k - 1])
+        continue; // targets come in order: a tie loses to the earlier one
+      int r = k - 1;
+      for (; r > 0 && c > want_count[r - 1]; r--) {
+        want_idx[r] = want_idx[r - 1];
+        want_count[r] = want_count[r - 1];
+      }
+      want_idx[r] = j;
+      want_count[r] = c;
+    }
+    success = memcmp(want_idx, idx + q * k, sizeof(want_idx)) == 0 &&
+              memcmp(want_count, count + q * k, sizeof(want_count)) == 0 &&
+              memcmp(want_idx, gpu_idx + q * k, sizeof(want_idx)) == 0;
+  }
+
+  // threshold matches: those of the whole search on selected targets
+  size_t all_offsets[30 + 1], offsets[30 + 1], gpu_offsets[30 + 1];
+  int *all_idx, *all_count, *match_idx, *match_count, *gpu_midx, *gpu_mcount;
+  size_t all = BitDB_inter_count_threshold(queries, targets, 12, opts,
+                                           all_offsets, &all_idx, &all_count);
+  size_t total = BitDB_inter_count_threshold(
+      queries, targets, 12, masked, offsets, &match_idx, &match_count);
+  size_t gpu_total = BitDB_inter_count_threshold_gpu(
+      queries, targets, 12, masked, gpu_offsets, &gpu_midx, &gpu_mcount);
+  size_t m = 0;
+  for (int q = 0; q < nq; q++) {
+    success = success && offsets[q] == m;
+    for (size_t a = all_offsets[q]; a < all_offsets[q + 1]; a++)
+      if (Bit_get(mask, all_idx[a])) {
+        success = success && m < total && match_idx[m] == all_idx[a] &&
+                  match_count[m] == all_count[a];
+        m++;
+      }
+  }
+  success = success && total == m && total > 0 && total < all &&
+            gpu_total == total &&
+            memcmp(gpu_offsets, offsets, sizeof(offsets)) == 0 &&
+            memcmp(gpu_midx, match_idx, total * sizeof(int)) == 0;
+
+  // similarity results land on selected targets only
+  float *sim = malloc(nq * k * sizeof(float));
+  Bit_similarity tanimoto = {BIT_SIMILARITY_TANIMOTO, 0, 0};
+  BitDB_similarity_topk(queries, targets, tanimoto, k, masked, idx, sim);
+  for (int s = 0; s < nq * k; s++)
+    success = success && idx[s] >= 0 && Bit_get(mask, idx[s]);
+
+  // an empty selection finds nothing
+  Bit_clear(mask, 0, nt - 1);
+  BitDB_inter_count_topk(queries, targets, k, masked, idx, count);
+  success = success && idx[0] == -1 && idx[nq * k - 1] == -1;
+  free(match_idx);
+  free(match_count);
+  success = success && BitDB_inter_count_threshold(queries, targets, 0, masked,
+                                                   offsets, &match_idx,
+                                                   &match_count) == 0;
+
+  free(all_idx);
+  free(all_count);
+  free(match_idx);
+  free(match_count);
+  free(gpu_midx);
+  free(gpu_mcount);
+  free(sim);
+  free(idx);
+  free(count);
+  free(gpu_idx);
+  free(gpu_count);
+  free(full);
+  Bit_free(&mask);
+  BitDB_free(&queries);
+  BitDB_free(&targets);
+  report_test(__func__, success);
+  return success;
+}
+
+bool test_bitDB_containment() {
+  const int len = 700, n = 500;
+  Bit_DB_T db = random_matrix(n, len, 10, 107);
+  Bit_T q_sup = Bit_new(len), q_sub = Bit_new(len), row = NULL;
+  for (int j = 0; j < len; j += 97)
+    Bit_bset(q_sup, j);
+  Bit_set(q_sub, 0, 350); // the left half
+  for (int i = 0; i < n; i += 7) { // supersets of q_sup
+    BitDB_view_at(db, i, &row);
+    for (int j = 0; j < len; j += 97)
+      Bit_bset(row, j);
+  }
+  for (int i = 3; i < n; i += 11) { // rows in the left half
+    BitDB_view_at(db, i, &row);
+    Bit_clear(row, 351, len - 1);
+  }
+  uint32_t *columns = malloc(len * sizeof(uint32_t));
+  SETOP_COUNT_OPTS opts = {.num_cpu_threads = 3};
+  BitDB_column_counts(db, columns, opts);
+  Bit_T out = Bit_new(n), mask = Bit_new(n);
+  Bit_set(mask, 100, 399);
+  bool success = true;
+  for (int c = 0; c < 4 && success; c++) {
+    SETOP_COUNT_OPTS o = opts;
+    o.row_mask = c & 2 ? mask : NULL;
+    const uint32_t *counts = c & 1 ? columns : NULL;
+    for (int superset = 0; superset < 2; superset++) {
+      Bit_T q = superset ? q_sup : q_sub;
+      if (superset)
+        BitDB_superset_search(q, db, counts, out, o);
+      else
+        BitDB_subset_search(q, db, counts, out, o);
+      int hits = 0;
+      for (int i = 0; i < n; i++) {
+        BitDB_view_at(db, i, &row);
+        bool want = (!o.row_mask || Bit_get(mask, i)) &&
+                    (superset ? Bit_leq(q, row) : Bit_leq(row, q));
+        success = success && Bit_get(out, i) == want;
+        hits += want;
+      }
+      success = success && hits > 0 && hits < n;
+    }
+  }
+  free(columns);
+  Bit_free(&row);
+  Bit_free(&out);
+  Bit_free(&mask);
+  Bit_free(&q_sup);
+  Bit_free(&q_sub);
+  BitDB_free(&db);
+  report_test(__func__, success);
+  return success;
+}
+
+bool test_bit_mih() {
+  const int len = 128, n = 4000, nq = 20, k = 5;
+  Bit_DB_T db = random_matrix(n, len, 50, 108);
+  Bit_DB_T queries = random_matrix(nq, len, 50, 109);
+  Bit_T row = NULL, query = NULL;
+  for (int q = 0; q < nq / 2; q++) { // near copies of rows of db
+    BitDB_view_at(db, q * 397, &row);
+    BitDB_view_at(queries, q, &query);
+    Bit_union_into(query, row, row);
+    for (int f = 0; f < 2 + q % 5; f++)
+      Bit_put(query, (q * 31 + f * 17) % len,
+              !Bit_get(query, (q * 31 + f * 17) % len));
+  }
+  Bit_free(&row);
+  Bit_free(&query);
+  SETOP_COUNT_OPTS opts = {.num_cpu_threads = 3};
+  int *full = BitDB_diff_count(queries, db, opts, cpu);
+  bool success = true;
+  const int ms[] = {0, 4, 3};
+  for (int t = 0; t < 3 && success; t++) {
+    Bit_MIH_T mih = Bit_MIH_new(db, ms[t], opts);
+    success = Bit_MIH_substrings(mih) == (ms[t] ? ms[t] : 11);
+    int idx[20 * 5], dist[20 * 5];
+    Bit_MIH_knn(mih, queries, k, opts, idx, dist);
+    for (int q = 0; q < nq && success; q++) {
+      int want_idx[5], want_dist[5];
+      for (int r = 0; r < k; r++)
+        want_idx[r] = want_dist[r] = -1;
+      for (int j = 0; j < n; j++) {
+        const int d = full[(size_t)q * n + j];
+        if (want_idx[k - 1] >= 0 && d >= want_dist[k - 1])
+          continue;
+        int r = k - 1;
+        for (; r > 0 && (want_idx[r - 1] < 0 || d < want_dist[r - 1]); r--) {
+          want_idx[r] = want_idx[r - 1];
+          want_dist[r] = want_dist[r - 1];
+        }
+        want_idx[r] = j;
+        want_dist[r] = d;
+      }
+      success = memcmp(want_idx, idx + q * k, sizeof(want_idx)) == 0 &&
+                memcmp(want_dist, dist + q * k, sizeof(want_dist)) == 0;
+      if (q < nq / 2) // the row a query was copied from is the nearest
+        success = success && idx[q * k] == q * 397;
+    }
+    // a small radius probes the tables, a large one scans
+    const int radii[] = {8, 50};
+    for (int c = 0; c < 2 && success; c++) {
+      size_t offsets[20 + 1];
+      int *match_idx, *match_dist;
+      size_t total = Bit_MIH_radius(mih, queries, radii[c], opts, offsets,
+                                    &match_idx, &match_dist);
+      size_t m = 0;
+      for (int q = 0; q < nq; q++) {
+        success = success && offsets[q] == m;
+        for (int j = 0; j < n; j++)
+          if (full[(size_t)q * n + j] <= radii[c]) {
+            success = success && m < total && match_idx[m] == j &&
+                      match_dist[m] == full[(size_t)q * n + j];
+            m++;
+          }
+      }
+      success = success && total == m && total >= (c ? 1 : nq / 2);
+      free(match_idx);
+      free(match_dist);
+    }
+    Bit_MIH_free(&mih);
+    success = success && mih == NULL;
+  }
+  free(full);
+  BitDB_free(&db);
+  BitDB_free(&queries);
+  report_test(__func__, success);
+  return success;
+}
+
+bool test_fixed_width_kernels() {
+  // 166, 512, 1024 and 2048 bits run the unrolled kernels, 1000 does not
+  const int lengths[] = {166, 512, 1024, 2048, 1000};
+  const int n = 37, nq = 5;
+  bool success = true;
+  for (int w = 0; w < 5 && success; w++) {
+    const int len = lengths[w];
+    Bit_DB_T db = random_matrix(n, len, 30, 110 + w);
+    Bit_DB_T queries = random_matrix(nq, len, 40, 120 + w);
+    SETOP_COUNT_OPTS opts = {.num_cpu_threads = 3};
+    int *inter = BitDB_inter_count(queries, db, opts, cpu);
+    int *diff = BitDB_diff_count(queries, db, opts, cpu);
+    int scan[37];
+    Bit_T q = NULL, row = NULL;
+    for (int i = 0; i < nq && success; i++) {
+      BitDB_view_at(queries, i, &q);
+      BitDB_query_count_store(q, db, BIT_COUNT_UNION, scan, opts);
+      for (int j = 0; j < n && success; j++) {
+        BitDB_view_at(db, j, &row);
+        int both = 0, either = 0, one = 0, minus = 0;
+        for (int b = 0; b < len; b++) {
+          const int x = Bit_get(q, b), y = Bit_get(row, b);
+          both += x & y;
+          either += x | y;
+          one += x ^ y;
+          minus += x & !y;
+        }
+        success = inter[i * n + j] == both && diff[i * n + j] == one &&
+                  scan[j] == either && Bit_inter_count(q, row) == both &&
+                  Bit_union_count(q, row) == either &&
+                  Bit_diff_count(q, row) == one &&
+                  Bit_minus_count(q, row) == minus;
+      }
+    }
+    Bit_free(&q);
+    Bit_free(&row);
+    free(inter);
+    free(diff);
+    BitDB_free(&db);
+    BitDB_free(&queries);
+  }
+  report_test(__func__, success);
+  return success;
+}
+
+bool test_bit_inline_accessors() {
+  const int len = 3000;
+  Bit_T lib = Bit_new(len), fast = Bit_new(len);
+  Bit_cache_summary(lib, true);
+  Bit_cache_summary(fast, true);
+  Bit_rank_build(lib);
+  Bit_rank_build(fast);
+  bool success = true;
+  unsigned int state = 17;
+  for (int step = 0; step < 4000 && success; step++) {
+    state = state * 1103515245u + 12345u;
+    const int i = (int)((state >> 8) % len);
+    switch (step % 4) {
+    case 0:
+      Bit_bset(lib, i);
+      Bit_bset_inline(fast, i);
+      break;
+    case 1:
+      Bit_bclear(lib, i);
+      Bit_bclear_unchecked(fast, i);
+      break;
+    case 2:
+      success = Bit_put(lib, i, step % 3 == 0) ==
+                Bit_put_inline(fast, i, step % 3 == 0);
+      break;
+    default:
+      success = Bit_get(lib, i) == Bit_get_inline(fast, i) &&
+                Bit_get(lib, i) == Bit_get_unchecked(fast, i);
+    }
+    // the rank index and the block summary follow the inline writers
+    if (step % 250 == 0)
+      success = success && Bit_rank(lib, i) == Bit_rank(fast, i) &&
+                Bit_next_set(lib, i) == Bit_next_set(fast, i);
+  }
+  success = success && Bit_eq(lib, fast) && Bit_count(lib) == Bit_count(fast);
+  Bit_free(&lib);
+  Bit_free(&fast);
+  report_test(__func__, success);
+  return success;
+}
+
+bool test_bit_count_cache() {
+  const int len = 5000;
+  uint64_t *buffer = calloc((size_t)Bit_buffer_size(len), 1);
+  Bit_T set = Bit_load(len, buffer), other = Bit_new(len);
+  Bit_T dst = Bit_new(len);
+  // count each bit through Bit_get, which no cache backs
+#define SCAN_COUNT(s, c)                                                       \
+  do {                                                                         \
+    c = 0;                                                                     \
+    for (int _i = 0; _i < len; _i++)                                           \
+      c += Bit_get(s, _i);                                                     \
+  } while (0)
+  int expected;
+  bool success = Bit_count(set) == 0;
+  unsigned int state = 29;
+  for (int step = 0; step < 3000 && success; step++) {
+    state = state * 1103515245u + 12345u;
+    const int i = (int)((state >> 8) % len);
+    switch (step % 5) {
+    case 0:
+      Bit_bset(set, i);
+      break;
+    case 1:
+      Bit_bclear(set, i);
+      break;
+    case 2:
+      Bit_put(set, i, step % 3 != 0);
+      break;
+    case 3:
+      Bit_bset_unchecked(set, i);
+      break;
+    default:
+      Bit_bclear_inline(set, i);
+    }
+    SCAN_COUNT(set, expected);
+    success = Bit_count(set) == expected;
+  }
+  // bulk writers drop the count
+  Bit_set(set, 100, 1999);
+  SCAN_COUNT(set, expected);
+  success = success && Bit_count(set) == expected;
+  Bit_not(set, 0, len - 1);
+  SCAN_COUNT(set, expected);
+  success = success && Bit_count(set) == expected;
+  int idx[3] = {0, 1, 4999};
+  Bit_aset(set, idx, 3);
+  Bit_bset_atomic(set, 2);
+  SCAN_COUNT(set, expected);
+  success = success && Bit_count(set) == expected;
+  Bit_set(other, 0, 2499);
+  success = success && Bit_inter_count(set, NULL) == 0 &&
+            Bit_union_count(NULL, other) == 2500;
+  Bit_count(dst);
+  Bit_inter_into(dst, set, other);
+  SCAN_COUNT(dst, expected);
+  success = success && Bit_count(dst) == expected;
+  Bit_union_assign(dst, other);
+  success = success && Bit_count(dst) == 2500;
+  // a current rank index supplies the total
+  Bit_rank_build(set);
+  Bit_touch(set);
+  Bit_rank_build(set);
+  SCAN_COUNT(set, expected);
+  success = success && Bit_count(set) == expected;
+  // writes behind the library's back are seen after Bit_touch
+  const int before = Bit_count(set);
+  buffer[0] = 0;
+  buffer[10] = ~UINT64_C(0);
+  success = success && Bit_count(set) == before;
+  Bit_touch(set);
+  SCAN_COUNT(set, expected);
+  success = success && Bit_count(set) == expected && expected != before;
+#undef SCAN_COUNT
+  Bit_free(&set);
+  Bit_free(&other);
+  Bit_free(&dst);
+  free(buffer);
+  report_test(__func__, success);
+  return success;
+}
+
+bool test_bit_shift_rotate_dilate() {
+  const int lengths[] = {1, 63, 64, 65, 1000, 4099};
+  bool success = true;
+  unsigned int state = 41;
+  for (size_t l = 0; l < sizeof(lengths) / sizeof(lengths[0]); l++) {
+    const int len = lengths[l];
+    Bit_T s = Bit_new(len), dst = Bit_new(len), in_place = Bit_new(len);
+    for (int i = 0; i < len; i++) {
+      state = state * 1103515245u + 12345u;
+      if ((state >> 16) % 3 == 0)
+        Bit_bset(s, i);
+    }
+    const int ks[] = {0, 1, 7, 63, 64, 65, 130, len - 1, len, len + 5};
+    for (size_t j = 0; j < sizeof(ks) / sizeof(ks[0]) && success; j++) {
+      const int k = ks[j];
+      for (int op = 0; op < 4; op++) {
+        Bit_clear(dst, 0, len - 1);
+        Bit_union_into(in_place, s, NULL);
+        switch (op) {
+        case 0:
+          Bit_shift_left_into(dst, s, k);
+          Bit_shift_left(in_place, k);
+          break;
+        case 1:
+          Bit_shift_right_into(dst, s, k);
+          Bit_shift_right(in_place, k);
+          break;
+        case 2:
+          Bit_rotate_left_into(dst, s, k);
+          Bit_rotate_left(in_place, k);
+          break;
+        default:
+          Bit_rotate_right_into(dst, s, k);
+          Bit_rotate_right(in_place, k);
+        }
+        int expected_count = 0;
+        for (int i = 0; i < len && success; i++) {
+          int from = op == 0 || op == 2 ? i - k : i + k;
+          int bit = 0;
+          if (op >= 2)
+            bit = Bit_get(s, ((from % len) + len) % len);
+          else if (from >= 0 && from < len)
+            bit = Bit_get(s, from);
+          expected_count += bit;
+          success = Bit_get(dst, i) == bit;
+        }
+        success = success && Bit_eq(dst, in_place) &&
+                  Bit_count(dst) == expected_count;
+      }
+    }
+    // dilation: bit i iff s has a bit in [i - before, i + after]
+    const int windows[][2] = {{0, 0}, {1, 0}, {0, 3}, {4, 2}, {70, 9},
+                              {len, len}};
+    for (size_t j = 0; j < sizeof(windows) / sizeof(windows[0]); j++) {
+      const int before = windows[j][0], after = windows[j][1];
+      Bit_dilate_into(dst, s, before, after);
+      Bit_union_into(in_place, s, NULL);
+      Bit_dilate(in_place, before, after);
+      int expected_count = 0;
+      for (int i = 0; i < len && success; i++) {
+        int bit = 0;
+        for (int x = i - before; x <= i + after && !bit; x++)
+          bit = x >= 0 && x < len && Bit_get(s, x);
+        expected_count += bit;
+        success = Bit_get(dst, i) == bit;
+      }
+      success = success && Bit_eq(dst, in_place) &&
+                Bit_count(dst) == expected_count;
+    }
+    Bit_free(&s);
+    Bit_free(&dst);
+    Bit_free(&in_place);
+  }
+  report_test(__func__, success);
+  return success;
+}
+
+bool test_bit_count_range() {
+  const int len = 3001;
+  Bit_T s = Bit_new(len), t = Bit_new(len);
+  unsigned int state = 53;
+  for (int i = 0; i < len; i++) {
+    state = state * 1103515245u + 12345u;
+    if ((state >> 16) % 3 == 0)
+      Bit_bset(s, i);
+    if ((state >> 20) % 2 == 0)
+      Bit_bset(t, i);
+  }
+  const int ranges[][2] = {{0, 0},     {5, 60},     {0, 63},   {63, 64},
+                           {64, 127},  {10, 2000},  {700, 1300},
+                           {0, len - 1}, {len - 1, len - 1}};
+  bool success = Bit_count_not(s) == len - Bit_count(s);
+  for (int pass = 0; pass < 2; pass++) {
+    if (pass == 1)
+      Bit_rank_build(s); // the rank path
+    for (size_t r = 0; r < sizeof(ranges) / sizeof(ranges[0]); r++) {
+      const int lo = ranges[r][0], hi = ranges[r][1];
+      int count = 0, both = 0, either = 0, one = 0, only_s = 0;
+      for (int i = lo; i <= hi; i++) {
+        const int a = Bit_get(s, i), b = Bit_get(t, i);
+        count += a;
+        both += a & b;
+        either += a | b;
+        one += a ^ b;
+        only_s += a & !b;
+      }
+      success = success && Bit_count_range(s, lo, hi) == count &&
+                Bit_count_not_range(s, lo, hi) == hi - lo + 1 - count &&
+                Bit_inter_count_range(s, t, lo, hi) == both &&
+                Bit_union_count_range(s, t, lo, hi) == either &&
+                Bit_diff_count_range(s, t, lo, hi) == one &&
+                Bit_minus_count_range(s, t, lo, hi) == only_s;
+    }
+  }
+  success = success &&
+            Bit_minus_count_range(s, t, 0, len - 1) == Bit_minus_count(s, t);
+  Bit_free(&s);
+  Bit_free(&t);
+  report_test(__func__, success);
+  return success;
+}
+
+bool test_bit_hash64() {
+  const int len = 5000, nrows = 6; // 79 qwords: full blocks, stripes, tail
+  Bit_DB_T db = BitDB_new(len, nrows);
+  Bit_T s = Bit_new(len);
+  unsigned int state = 97;
+  for (int i = 0; i < len; i++) {
+    state = state * 1103515245u + 12345u;
+    if ((state >> 16) % 3 == 0)
+      Bit_bset(s, i);
+  }
+  for (int r = 0; r < nrows; r++)
+    BitDB_put_at(db, r, s);
+  Bit_T copy = Bit_new(len);
+  Bit_shift_left_into(copy, s, 0); // a copy
+  const uint64_t h = Bit_hash64(s, 7);
+  bool success = Bit_hash64(copy, 7) == h && Bit_hash64(s, 8) != h;
+  Bit_bclear(copy, len - 1);
+  Bit_bset(copy, len - 1);
+  Bit_bclear(copy, 4000); // a change in the tail qwords
+  success = success && Bit_hash64(copy, 7) != h;
+  Bit_shift_left_into(copy, s, 0); // a copy
+  Bit_put(copy, 100, !Bit_get(copy, 100)); // a change in the first stripe
+  success = success && Bit_hash64(copy, 7) != h;
+
+  // the same qwords at another length hash apart
+  Bit_T shorter = Bit_new(len - 1);
+  for (int i = 0; i < len - 1; i++)
+    if (Bit_get(s, i))
+      Bit_bset(shorter, i);
+  if (!Bit_get(s, len - 1))
+    success = success && Bit_hash64(shorter, 7) != h;
+
+  // the hash is the same on every instruction set
+  Bit_T fixed = Bit_new(10000); // 19 stripes, a scramble and a tail
+  for (int i = 0; i < 10000; i += 7)
+    Bit_bset(fixed, i);
+  success = success &&
+            Bit_hash64(fixed, 0) == UINT64_C(0x517900228348fcf3);
+
+  uint64_t hashes[6];
+  BitDB_put_at(db, 3, copy);
+  BitDB_cache_hashes(db, true);
+  const uint64_t changed = Bit_hash64(copy, 7);
+  for (int pass = 0; pass < 3; pass++) { // hashed, cached, stale
+    if (pass == 2)
+      BitDB_put_at(db, 3, s);
+    BitDB_hash_rows(db, 7, hashes, (SETOP_COUNT_OPTS){0});
+    for (int r = 0; r < nrows; r++)
+      success = success && hashes[r] == (r == 3 && pass < 2 ? changed : h);
+  }
+  BitDB_hash_rows(db, 8, hashes, (SETOP_COUNT_OPTS){0}); // another seed
+  success = success && hashes[0] == Bit_hash64(s, 8);
+  BitDB_cache_hashes(db, false);
+
+  Bit_free(&fixed);
+  Bit_free(&shorter);
+  Bit_free(&copy);
+  Bit_free(&s);
+  BitDB_free(&db);
+  report_test(__func__, success);
+  return success;
+}
+
+bool test_bitdb_dedup() {
+  const int len = 700, nq = 40, nt = 200, k = 7, threshold = 40;
+  Bit_DB_T queries = BitDB_new(len, nq), targets = BitDB_new(len, nt);
+  Bit_T row = Bit_new(len);
+  unsigned int state = 101;
+  for (int r = 0; r < nq + nt; r++) {
+    const int pattern = (int)((state = state * 1103515245u + 12345u) >> 16) %
+                        (r < nq ? 9 : 31); // few distinct rows
+    Bit_clear(row, 0, len - 1);
+    for (int i = pattern; i < len; i += pattern % 5 + 3)
+      Bit_bset(row, (i * 7 + pattern) % len);
+    BitDB_put_at(r < nq ? queries : targets, r < nq ? r : r - nq, row);
+  }
+  int qmap[40], tmap[200];
+  SETOP_COUNT_OPTS opts = {0};
+  Bit_DB_T uq = BitDB_dedup(queries, qmap, opts);
+  Bit_DB_T ut = BitDB_dedup(targets, tmap, opts);
+  const int nuq = BitDB_nelem(uq), nut = BitDB_nelem(ut);
+  bool success = nuq <= 9 && nut <= 31 && qmap[0] == 0 && tmap[0] == 0;
+  for (int i = 0; i < nt; i++) {
+    Bit_T a = BitDB_get_from(targets, i), u = BitDB_get_from(ut, tmap[i]);
+    success = success && Bit_eq(a, u);
+    for (int j = 0; j < i && success; j++) {
+      Bit_T b = BitDB_get_from(targets, j);
+      success = (tmap[i] == tmap[j]) == (Bit_eq(a, b) == 1);
+      Bit_free(&b);
+    }
+    Bit_free(&a);
+    Bit_free(&u);
+  }
+
+  // counts against the distinct rows, expanded, are the original counts
+  int *want = BitDB_inter_count_cpu(queries, targets, opts);
+  int *few = BitDB_inter_count_cpu(uq, ut, opts);
+  int *got = malloc((size_t)nq * nt * sizeof(int));
+  BitDB_dedup_expand_counts(few, nut, qmap, nq, tmap, nt, got, opts);
+  success = success && memcmp(got, want, (size_t)nq * nt * sizeof(int)) == 0;
+
+  int want_idx[40 * 7], want_count[40 * 7], few_idx[9 * 7], few_count[9 * 7];
+  int got_idx[40 * 7], got_count[40 * 7];
+  BitDB_inter_count_topk(queries, targets, k, opts, want_idx, want_count);
+  BitDB_inter_count_topk(uq, ut, k, opts, few_idx, few_count);
+  BitDB_dedup_expand_topk(few_idx, few_count, k, qmap, nq, tmap, nt, got_idx,
+                          got_count);
+  success = success && memcmp(got_idx, want_idx, sizeof(want_idx)) == 0 &&
+            memcmp(got_count, want_count, sizeof(want_count)) == 0;
+
+  size_t want_off[41], few_off[10], got_off[41];
+  int *wi, *wc, *fi, *fc, *gi, *gc;
+  const size_t nwant = BitDB_inter_count_threshold(queries, targets, threshold,
+                                                   opts, want_off, &wi, &wc);
+  BitDB_inter_count_threshold(uq, ut, threshold, opts, few_off, &fi, &fc);
+  const size_t ngot = BitDB_dedup_expand_threshold(
+      few_off, fi, fc, qmap, nq, tmap, nt, got_off, &gi, &gc);
+  success = success && nwant > 0 && ngot == nwant &&
+            memcmp(got_off, want_off, sizeof(want_off)) == 0 &&
+            memcmp(gi, wi, nwant * sizeof(int)) == 0 &&
+            memcmp(gc, wc, nwant * sizeof(int)) == 0;
+
+  free(wi);
+  free(wc);
+  free(fi);
+  free(fc);
+  free(gi);
+  free(gc);
+  free(want);
+  free(few);
+  free(got);
+  Bit_free(&row);
+  BitDB_free(&uq);
+  BitDB_free(&ut);
+  BitDB_free(&queries);
+  BitDB_free(&targets);
+  report_test(__func__, success);
+  return success;
+}
+
+bool test_bitdb_reorder() {
+  const int len = 600, nq = 24, nt = 300, k = 5, threshold = 12;
+  Bit_DB_T queries = BitDB_new(len, nq), targets = BitDB_new(len, nt);
+  Bit_T row = Bit_new(len);
+  unsigned int state = 131;
+  for (int r = 0; r < nq + nt; r++) {
+    Bit_clear(row, 0, len - 1);
+    const int nbits = 20 + r % 70;
+    for (int b = 0; b < nbits; b++) {
+      state = state * 1103515245u + 12345u;
+      Bit_bset(row, (int)((state >> 8) % (unsigned int)(b % 3 ? len : 96)));
+    }
+    BitDB_put_at(r < nq ? queries : targets, r < nq ? r : r - nq, row);
+  }
+  SETOP_COUNT_OPTS opts = {0};
+  Bit_similarity sim = {BIT_SIMILARITY_TANIMOTO, 0, 0};
+  int want_idx[24 * 5], want_count[24 * 5], got_idx[24 * 5], got_count[24 * 5];
+  int sim_idx[24 * 5], got_sim_idx[24 * 5];
+  float sim_best[24 * 5], got_sim_best[24 * 5];
+  size_t want_off[25], got_off[25];
+  int *wi, *wc, *gi, *gc;
+  BitDB_inter_count_topk(queries, targets, k, opts, want_idx, want_count);
+  BitDB_similarity_topk(queries, targets, sim, k, opts, sim_idx, sim_best);
+  const size_t nwant = BitDB_inter_count_threshold(queries, targets, threshold,
+                                                   opts, want_off, &wi, &wc);
+  Bit_T *before = malloc(nt * sizeof(Bit_T));
+  for (int i = 0; i < nt; i++)
+    before[i] = BitDB_get_from(targets, i);
+
+  int perm[300], qperm[24];
+  bool success = BitDB_row_ids(targets) == NULL && nwant > 0;
+  BitDB_reorder(targets, BIT_ORDER_COUNT_GRAY, perm, opts);
+  for (int i = 0; i < nq; i++)
+    qperm[i] = (i * 7 + 3) % nq; // 7 is prime to 24
+  BitDB_reorder(queries, BIT_ORDER_PERM, qperm, opts);
+  const int *ids = BitDB_row_ids(targets);
+  for (int i = 0; i < nt; i++) {
+    Bit_T now = BitDB_get_from(targets, i);
+    success = success && ids[i] == perm[i] && Bit_eq(now, before[perm[i]]);
+    if (i > 0) // popcount first
+      success = success && BitDB_count_at(targets, i - 1) <=
+                               BitDB_count_at(targets, i);
+    Bit_free(&now);
+  }
+  for (int pass = 0; pass < 2; pass++) { // reordered, then reordered again
+    BitDB_inter_count_topk(queries, targets, k, opts, got_idx, got_count);
+    BitDB_similarity_topk(queries, targets, sim, k, opts, got_sim_idx,
+                          got_sim_best);
+    const size_t ngot = BitDB_inter_count_threshold(
+        queries, targets, threshold, opts, got_off, &gi, &gc);
+    success = success && memcmp(got_idx, want_idx, sizeof(want_idx)) == 0 &&
+              memcmp(got_count, want_count, sizeof(want_count)) == 0 &&
+              memcmp(got_sim_idx, sim_idx, sizeof(sim_idx)) == 0 &&
+              memcmp(got_sim_best, sim_best, sizeof(sim_best)) == 0 &&
+              ngot == nwant &&
+              memcmp(got_off, want_off, sizeof(want_off)) == 0 &&
+              memcmp(gi, wi, nwant * sizeof(int)) == 0 &&
+              memcmp(gc, wc, nwant * sizeof(int)) == 0;
+    free(gi);
+    free(gc);
+    const size_t ngpu = BitDB_inter_count_threshold_gpu(
+        queries, targets, threshold, opts, got_off, &gi, &gc);
+    success = success && ngpu == nwant &&
+              memcmp(got_off, want_off, sizeof(want_off)) == 0 &&
+              memcmp(gi, wi, nwant * sizeof(int)) == 0 &&
+              memcmp(gc, wc, nwant * sizeof(int)) == 0;
+    free(gi);
+    free(gc);
+    BitDB_reorder(targets, BIT_ORDER_GRAY, NULL, opts);
+    BitDB_sort_by_count(queries, NULL, opts); // keeps the IDs
+  }
+
+  // a row mask selects rows by place; the results still report IDs
+  Bit_T mask = Bit_new(nt);
+  ids = BitDB_row_ids(targets);
+  for (int i = 0; i < nt; i++)
+    if (ids[i] % 2 == 0)
+      Bit_bset(mask, i);
+  SETOP_COUNT_OPTS masked = {.row_mask = mask};
+  const size_t ngot = BitDB_inter_count_threshold(queries, targets, threshold,
+                                                  masked, got_off, &gi, &gc);
+  size_t even = 0;
+  for (size_t m = 0; m < nwant; m++)
+    even += wi[m] % 2 == 0;
+  for (size_t m = 0, e = 0; m < nwant && success; m++)
+    if (wi[m] % 2 == 0)
+      success = gi[e] == wi[m] && gc[e++] == wc[m];
+  success = success && ngot == even;
+  free(gi);
+  free(gc);
+
+  // appended rows take the next ID; resetting makes rows their own IDs
+  success = success && BitDB_append(targets, row) == nt &&
+            BitDB_row_ids(targets)[nt] == nt;
+  BitDB_reset_row_ids(targets);
+  success = success && BitDB_row_ids(targets) == NULL;
+
+  for (int i = 0; i < nt; i++)
+    Bit_free(&before[i]);
+  free(before);
+  free(wi);
+  free(wc);
+  Bit_free(&mask);
+  Bit_free(&row);
+  BitDB_free(&queries);
+  BitDB_free(&targets);
+  report_test(__func__, success);
+  return success;
+}
+
+bool test_bitdb_cancel() {
+  const int nq = 300, nt = 200, lengths[] = {1000, 512};
+  bool success = true;
+  for (int l = 0; l < 2; l++) {
+    const int len = lengths[l];
+    Bit_DB_T queries = BitDB_new(len, nq), targets = BitDB_new(len, nt);
+    Bit_T row = Bit_new(len);
+    unsigned int state = 977;
+    for (int r = 0; r < nq + nt; r++) {
+      Bit_clear(row, 0, len - 1);
+      for (int b = 0; b < 40; b++) {
+        state = state * 1103515245u + 12345u;
+        Bit_bset(row, (int)((state >> 8) % (unsigned int)len));
+      }
+      BitDB_put_at(r < nq ? queries : targets, r < nq ? r : r - nq, row);
+    }
+    int *want = malloc(sizeof(int) * nq * nt);
+    int *got = malloc(sizeof(int) * nq * nt);
+    Bit_progress progress = {true, -1};
+    SETOP_COUNT_OPTS opts = {0};
+    opts.progress = &progress;
+    BitDB_inter_count_store_cpu(queries, targets, want, opts);
+    success &= !progress.stopped && progress.queries_done == nq;
+
+    // a token cancelled before the call: nothing is counted
+    Bit_cancel_T token = Bit_cancel_new();
+    Bit_cancel_request(token);
+    success &= Bit_cancel_requested(token);
+    opts.cancel = token;
+    BitDB_inter_count_store_cpu(queries, targets, got, opts);
+    success &= progress.stopped && progress.queries_done == 0;
+    progress = (Bit_progress){false, -1};
+    BitDB_count_store_typed_cpu(queries, targets, BIT_COUNT_INTER, got,
+                                BIT_COUNTS_I32, opts);
+    success &= progress.stopped && progress.queries_done == 0;
+    progress = (Bit_progress){false, -1};
+    BitDB_inter_count_store_gpu(queries, targets, got, opts);
+    success &= progress.stopped && progress.queries_done == 0;
+
+    // a deadline long past does the same
+    opts.cancel = NULL;
+    opts.deadline = 1e-9;
+    progress = (Bit_progress){false, -1};
+    BitDB_diff_count_store_cpu(queries, targets, got, opts);
+    success &= progress.stopped && progress.queries_done == 0;
+
+    // a reset token and a distant deadline count everything
+    Bit_cancel_reset(token);
+    success &= !Bit_cancel_requested(token);
+    opts.cancel = token;
+    opts.deadline = 1e300;
+    memset(got, 0, sizeof(int) * nq * nt);
+    BitDB_inter_count_store_cpu(queries, targets, got, opts);
+    success &= !progress.stopped && progress.queries_done == nq &&
+               memcmp(got, want, sizeof(int) * nq * nt) == 0;
+    memset(got, 0, sizeof(int) * nq * nt);
+    BitDB_inter_count_store_gpu(queries, targets, got, opts);
+    success &= !progress.stopped && progress.queries_done == nq &&
+               memcmp(got, want, sizeof(int) * nq * nt) == 0;
+
+    // other functions ignore a cancelled token
+    Bit_cancel_request(token);
+    int *multi = malloc(sizeof(int) * nq * nt);
+    BitDB_multi_count_store(queries, targets, BIT_COUNT_INTER, multi, NULL,
+                            NULL, NULL, opts);
+    success &= memcmp(multi, want, sizeof(int) * nq * nt) == 0;
+
+    free(multi);
+    Bit_cancel_free(&token);
+    success &= token == NULL;
+    free(want);
+    free(got);
+    Bit_free(&row);
+    BitDB_free(&queries);
+    BitDB_free(&targets);
+  }
+  report_test(__func__, success);
+  return success;
+}
+
+typedef struct {
+  const int *want;
+  const int *counts;
+  int ntargets;
+  int *cells;      // times each count was reported final
+  _Atomic bool wrong;
+  size_t max_done, total;
+  uint64_t max_bytes;
+} tile_hook_state;
+
+static void tile_hook(void *cl, int first_query, int nquery, int first_target,
+                      int ntarget) {
+  tile_hook_state *s = cl;
+  for (int i = first_query; i < first_query + nquery; i++)
+    for (int j = first_target; j < first_target + ntarget; j++) {
+      size_t at = (size_t)i * s->ntargets + j;
+      if (s->counts[at] != s->want[at])
+        s->wrong = true;
+#pragma omp atomic
+      s->cells[at]++;
+    }
+}
+
+static void progress_hook(void *cl, size_t tiles_done, size_t tiles_total,
+                          uint64_t bytes_scanned) {
+  tile_hook_state *s = cl;
+  if (tiles_done == 0 || tiles_done > tiles_total)
+    s->wrong = true;
+#pragma omp critical(progress_hook)
+  {
+    s->total = tiles_total;
+    if (tiles_done > s->max_done)
+      s->max_done = tiles_done;
+    if (bytes_scanned > s->max_bytes)
+      s->max_bytes = bytes_scanned;
+  }
+}
+
+bool test_bitdb_tile_hooks() {
+  const int nq = 150, nt = 210, lengths[] = {700, 192};
+  bool success = true;
+  for (int l = 0; l < 2; l++) {
+    const int len = lengths[l];
+    Bit_DB_T queries = BitDB_new(len, nq), targets = BitDB_new(len, nt);
+    Bit_T row = Bit_new(len);
+    unsigned int state = 41;
+    for (int r = 0; r < nq + nt; r++) {
+      Bit_clear(row, 0, len - 1);
+      for (int b = 0; b < 30; b++) {
+        state = state * 1103515245u + 12345u;
+        Bit_bset(row, (int)((state >> 8) % (unsigned int)len));
+      }
+      BitDB_put_at(r < nq ? queries : targets, r < nq ? r : r - nq, row);
+    }
+    int *want = malloc(sizeof(int) * nq * nt);
+    int *got = malloc(sizeof(int) * nq * nt);
+    SETOP_COUNT_OPTS opts = {0};
+    BitDB_union_count_store_cpu(queries, targets, want, opts);
+    for (int gpu = 0; gpu < 2; gpu++) {
+      tile_hook_state hooks = {.want = want, .counts = got, .ntargets = nt,
+                               .cells = calloc(nq * nt, sizeof(int))};
+      opts.on_tile = tile_hook;
+      opts.on_progress = progress_hook;
+      opts.hook_cl = &hooks;
+      memset(got, 0xff, sizeof(int) * nq * nt);
+      if (gpu)
+        BitDB_union_count_store_gpu(queries, targets, got, opts);
+      else
+        BitDB_union_count_store_cpu(queries, targets, got, opts);
+      // every count is reported final once, and was final when reported
+      success &= !hooks.wrong && hooks.total > 0 &&
+                 hooks.max_done == hooks.total && hooks.max_bytes > 0 &&
+                 memcmp(got, want, sizeof(int) * nq * nt) == 0;
+      for (int c = 0; c < nq * nt; c++)
+        success &= hooks.cells[c] == 1;
+      free(hooks.cells);
+    }
+    free(want);
+    free(got);
+    Bit_free(&row);
+    BitDB_free(&queries);
+    BitDB_free(&targets);
+  }
+  report_test(__func__, success);
+  return success;
+}
+
+bool test_bitdb_exec_tasks() {
+  const int nq = 130, nt = 170, lengths[] = {700, 512};
+  bool success = true;
+  for (int l = 0; l < 2; l++) {
+    const int len = lengths[l];
+    Bit_DB_T queries = BitDB_new(len, nq), targets = BitDB_new(len, nt);
+    Bit_T row = Bit_new(len);
+    unsigned int state = 613;
+    for (int r = 0; r < nq + nt; r++) {
+      Bit_clear(row, 0, len - 1);
+      for (int b = 0; b < 35; b++) {
+        state = state * 1103515245u + 12345u;
+        Bit_bset(row, (int)((state >> 8) % (unsigned int)len));
+      }
+      BitDB_put_at(r < nq ? queries : targets, r < nq ? r : r - nq, row);
+    }
+    int *want = malloc(sizeof(int) * nq * nt);
+    SETOP_COUNT_OPTS team = {0};
+    BitDB_minus_count_store_cpu(queries, targets, want, team);
+    Bit_tuning sliced = {BIT_TUNING_BLOCK_SLICED, 32, 8, 0};
+    for (int t = 0; t < 2; t++) {
+      SETOP_COUNT_OPTS opts = {.exec = BIT_EXEC_TASKS,
+                               .tuning = t ? &sliced : NULL};
+      // one thread of the team counts, the others run its tiles
+      int *got = malloc(sizeof(int) * nq * nt);
+      memset(got, 0xff, sizeof(int) * nq * nt);
+#pragma omp parallel num_threads(4)
+#pragma omp single
+      BitDB_minus_count_store_cpu(queries, targets, got, opts);
+      success &= memcmp(got, want, sizeof(int) * nq * nt) == 0;
+      free(got);
+
+      // every thread of the team counts, and they share the tiles
+      int wrong = 0;
+#pragma omp parallel num_threads(4)
+      {
+        int *mine = malloc(sizeof(int) * nq * nt);
+        BitDB_minus_count_store_cpu(queries, targets, mine, opts);
+        if (memcmp(mine, want, sizeof(int) * nq * nt) != 0) {
+#pragma omp atomic
+          wrong++;
+        }
+        free(mine);
+      }
+      success &= wrong == 0;
+    }
+    // outside a parallel region tasks make a team as before
+    int *got = malloc(sizeof(int) * nq * nt);
+    team.exec = BIT_EXEC_TASKS;
+    BitDB_minus_count_store_cpu(queries, targets, got, team);
+    success &= memcmp(got, want, sizeof(int) * nq * nt) == 0;
+    free(got);
+    free(want);
+    Bit_free(&row);
+    BitDB_free(&queries);
+    BitDB_free(&targets);
+  }
+  report_test(__func__, success);
+  return success;
+}
+
+bool test_bit_affinity() {
+  bool success = true;
+  Bit_affinity all = {0};
+  int *cpus = malloc(sizeof(int) * 1024);
+  const int ncpus = Bit_affinity_cpus(&all, cpus, 1024);
+  success &= ncpus >= 0 && Bit_affinity_cpus(&all, NULL, 0) == ncpus;
+  Bit_affinity one_per_core = {.smt = BIT_SMT_ONE_PER_CORE};
+  const int ncores = Bit_affinity_cpus(&one_per_core, NULL, 0);
+  success &= ncores <= ncpus && (ncpus == 0 || ncores > 0);
+
+  const int nq = 90, nt = 140, len = 700;
+  Bit_DB_T queries = BitDB_new(len, nq), targets = BitDB_new(len, nt);
+  Bit_T row = Bit_new(len);
+  unsigned int state = 271;
+  for (int r = 0; r < nq + nt; r++) {
+    Bit_clear(row, 0, len - 1);
+    for (int b = 0; b < 30; b++) {
+      state = state * 1103515245u + 12345u;
+      Bit_bset(row, (int)((state >> 8) % (unsigned int)len));
+    }
+    BitDB_put_at(r < nq ? queries : targets, r < nq ? r : r - nq, row);
+  }
+  int *want = malloc(sizeof(int) * nq * nt);
+  int *got = malloc(sizeof(int) * nq * nt);
+  SETOP_COUNT_OPTS opts = {0};
+  BitDB_inter_count_store_cpu(queries, targets, want, opts);
+  if (ncpus > 0) {
+    // the last CPU, listed twice and with an unknown one: a list of one
+    int listed[] = {cpus[ncpus - 1], -3, cpus[ncpus - 1]};
+    Bit_affinity last = {.cpus = listed, .ncpus = 3};
+    int kept = -1;
+    success &= Bit_affinity_cpus(&last, &kept, 1) == 1 &&
+               kept == cpus[ncpus - 1];
+    opts.affinity = &last;
+    BitDB_inter_count_store_cpu(queries, targets, got, opts);
+    success &= memcmp(got, want, sizeof(int) * nq * nt) == 0;
+    opts.affinity = &one_per_core;
+    opts.num_cpu_threads = 3;
+    uint16_t *narrow = malloc(sizeof(uint16_t) * nq * nt);
+    BitDB_count_store_typed_cpu(queries, targets, BIT_COUNT_INTER, narrow,
+                                BIT_COUNTS_U16, opts);
+    for (int c = 0; c < nq * nt; c++)
+      success &= narrow[c] == want[c];
+    free(narrow);
+    // the calling thread may run on every CPU again
+    success &= Bit_affinity_cpus(&all, NULL, 0) == ncpus;
+  }
+  // a package the host does not have: no CPU, and an unpinned team
+  Bit_affinity nowhere = {.sockets = UINT64_C(1) << 40};
+  success &= Bit_affinity_cpus(&nowhere, NULL, 0) == 0;
+  opts = (SETOP_COUNT_OPTS){.affinity = &nowhere};
+  memset(got, 0, sizeof(int) * nq * nt);
+  BitDB_inter_count_store_cpu(queries, targets, got, opts);
+  success &= memcmp(got, want, sizeof(int) * nq * nt) == 0;
+  // a pinned call leaves the caller's dynamic adjustment as it was
+  if (ncpus > 0) {
+    const int dynamic = omp_get_dynamic();
+    omp_set_dynamic(1);
+    opts = (SETOP_COUNT_OPTS){.affinity = &all, .num_cpu_threads = 2};
+    BitDB_inter_count_store_cpu(queries, targets, got, opts);
+    success &= memcmp(got, want, sizeof(int) * nq * nt) == 0 &&
+               omp_get_dynamic() == 1 &&
+               Bit_affinity_cpus(&all, NULL, 0) == ncpus;
+    omp_set_dynamic(dynamic);
+  }
+  free(want);
+  free(got);
+  free(cpus);
+  Bit_free(&row);
+  BitDB_free(&queries);
+  BitDB_free(&targets);
+  report_test(__func__, success);
+  return success;
+}
+
+bool test_bit_isa_policy() {
+  bool success = true;
+  const uint64_t saved = Bit_isa_threshold_get();
+  Bit_isa_threshold_set(12345);
+  success &= Bit_isa_threshold_get() == 12345;
+
+  const int nq = 40, nt = 75, len = 900;
+  Bit_DB_T queries = BitDB_new(len, nq), targets = BitDB_new(len, nt);
+  Bit_T row = Bit_new(len);
+  unsigned int state = 337;
+  for (int r = 0; r < nq + nt; r++) {
+    Bit_clear(row, 0, len - 1);
+    for (int b = 0; b < 60; b++) {
+      state = state * 1103515245u + 12345u;
+      Bit_bset(row, (int)((state >> 8) % (unsigned int)len));
+    }
+    BitDB_put_at(r < nq ? queries : targets, r < nq ? r : r - nq, row);
+  }
+  int *want = malloc(sizeof(int) * nq * nt);
+  int *got = malloc(sizeof(int) * nq * nt);
+  SETOP_COUNT_OPTS opts = {.isa = BIT_ISA_WIDEST};
+  BitDB_diff_count_store_cpu(queries, targets, want, opts);
+  // every tier counts the same, below and above the threshold
+  const Bit_isa_policy policies[] = {BIT_ISA_NARROW, BIT_ISA_AUTO};
+  const uint64_t thresholds[] = {0, UINT64_MAX};
+  for (int p = 0; p < 2; p++)
+    for (int t = 0; t < 2; t++) {
+      Bit_isa_threshold_set(thresholds[t]);
+      opts.isa = policies[p];
+      memset(got, 0, sizeof(int) * nq * nt);
+      BitDB_diff_count_store_cpu(queries, targets, got, opts);
+      success &= memcmp(got, want, sizeof(int) * nq * nt) == 0;
+      uint16_t *narrow = malloc(sizeof(uint16_t) * nq * nt);
+      BitDB_count_store_typed_cpu(queries, targets, BIT_COUNT_DIFF, narrow,
+                                  BIT_COUNTS_U16, opts);
+      for (int c = 0; c < nq * nt; c++)
+        success &= narrow[c] == want[c];
+      free(narrow);
+    }
+  uint64_t threshold = Bit_isa_calibrate(256, (SETOP_COUNT_OPTS){0});
+  success &= Bit_isa_threshold_get() == threshold;
+  Bit_isa_threshold_set(saved);
+  free(want);
+  free(got);
+  Bit_free(&row);
+  BitDB_free(&queries);
+  BitDB_free(&targets);
+  report_test(__func__, success);
+  return success;
+}
+
+bool test_bitdb_store_stream() {
+  bool success = true;
+  const uint64_t saved = Bit_store_threshold_get();
+  Bit_store_threshold_set(4096);
+  success &= Bit_store_threshold_get() == 4096;
+
+  const int nq = 70, nt = 75, lens[] = {900, 512}; // generic, fixed width
+  int *want = malloc(sizeof(int) * nq * nt);
+  int *got = malloc(sizeof(int) * nq * nt);
+  for (int l = 0; l < 2; l++) {
+    const int len = lens[l];
+    Bit_DB_T queries = BitDB_new(len, nq), targets = BitDB_new(len, nt);
+    Bit_T row = Bit_new(len);
+    unsigned int state = 71 + l;
+    for (int r = 0; r < nq + nt; r++) {
+      Bit_clear(row, 0, len - 1);
+      for (int b = 0; b < 90; b++) {
+        state = state * 1103515245u + 12345u;
+        Bit_bset(row, (int)((state >> 8) % (unsigned int)len));
+      }
+      BitDB_put_at(r < nq ? queries : targets, r < nq ? r : r - nq, row);
+    }
+    SETOP_COUNT_OPTS opts = {.num_cpu_threads = 2};
+    BitDB_inter_count_store_cpu(queries, targets, want, opts);
+
+    // every register block, a tile on the stack and one allocated, with
+    // one and several k_block passes, streams the same counts
+    const int tiles[] = {8, 128}, k_blocks[] = {8, 1024};
+    for (int b = 0; b < BIT_TUNING_BLOCK_COUNT; b++)
+      for (int t = 0; t < 2; t++) {
+        Bit_tuning tuning = {(Bit_tuning_block)b, tiles[t], k_blocks[t], 0};
+        opts.tuning = &tuning;
+        opts.store = t ? BIT_STORE_AUTO : BIT_STORE_STREAM;
+        memset(got, 0xff, sizeof(int) * nq * nt);
+        BitDB_inter_count_store_cpu(queries, targets, got, opts);
+        success &= memcmp(got, want, sizeof(int) * nq * nt) == 0;
+      }
+    opts.tuning = NULL;
+
+    // the allocating counts need no zeroing
+    opts.store = BIT_STORE_STREAM;
+    int *counts = BitDB_inter_count_cpu(queries, targets, opts);
+    success &= memcmp(counts, want, sizeof(int) * nq * nt) == 0;
+    free(counts);
+    Bit_free(&row);
+    BitDB_free(&queries);
+    BitDB_free(&targets);
+  }
+  Bit_store_threshold_set(saved);
+  free(want);
+  free(got);
+  report_test(__func__, success);
+  return success;
+}
+
+bool test_bitdb_recursive() {
+  bool success = true;
+  // rows of 1000 qwords split into leaves of words; 37 x 53 split unevenly
+  const int nq = 37, nt = 53, len = 64000;
+  Bit_DB_T queries = BitDB_new(len, nq), targets = BitDB_new(len, nt);
+  Bit_T row = Bit_new(len);
+  unsigned int state = 919;
+  for (int r = 0; r < nq + nt; r++) {
+    Bit_clear(row, 0, len - 1);
+    for (int b = 0; b < 3000; b++) {
+      state = state * 1103515245u + 12345u;
+      Bit_bset(row, (int)((state >> 8) % (unsigned int)len));
+    }
+    BitDB_put_at(r < nq ? queries : targets, r < nq ? r : r - nq, row);
+  }
+  int *want = malloc(sizeof(int) * nq * nt);
+  int *got = malloc(sizeof(int) * nq * nt);
+  SETOP_COUNT_OPTS opts = {.num_cpu_threads = 3};
+  BitDB_union_count_store_cpu(queries, targets, want, opts);
+
+  Bit_tuning recursive = {BIT_TUNING_BLOCK_RECURSIVE, 32, 1024, 0};
+  opts.tuning = &recursive;
+  memset(got, 0xff, sizeof(int) * nq * nt);
+  BitDB_union_count_store_cpu(queries, targets, got, opts);
+  success &= memcmp(got, want, sizeof(int) * nq * nt) == 0;
+
+  // as tasks of the caller's team
+  opts.exec = BIT_EXEC_TASKS;
+  memset(got, 0xff, sizeof(int) * nq * nt);
+#pragma omp parallel num_threads(3)
+#pragma omp single
+  BitDB_union_count_store_cpu(queries, targets, got, opts);
+  success &= memcmp(got, want, sizeof(int) * nq * nt) == 0;
+  opts.exec = BIT_EXEC_TEAM;
+
+  // the whole matrix is one tile of the hooks
+  int *cells = calloc((size_t)nq * nt, sizeof(int));
+  tile_hook_state hooks = {.want = want, .counts = got, .ntargets = nt,
+                           .cells = cells};
+  opts.on_tile = tile_hook;
+  opts.hook_cl = &hooks;
+  BitDB_union_count_store_cpu(queries, targets, got, opts);
+  for (int c = 0; c < nq * nt; c++)
+    success &= cells[c] == 1;
+  success &= !hooks.wrong;
+
+  // a cancelled count reports no query done
+  Bit_cancel_T cancel = Bit_cancel_new();
+  Bit_cancel_request(cancel);
+  Bit_progress progress;
+  opts.on_tile = NULL;
+  opts.cancel = cancel;
+  opts.progress = &progress;
+  BitDB_union_count_store_cpu(queries, targets, got, opts);
+  success &= progress.stopped && progress.queries_done == 0;
+  Bit_cancel_free(&cancel);
+
+  free(cells);
+  free(want);
+  free(got);
+  Bit_free(&row);
+  BitDB_free(&queries);
+  BitDB_free(&targets);
+  report_test(__func__, success);
+  return success;
+}
+
+bool test_bitpdb_packed() {
+  bool success = true;
+  // 8, 16 and 32 bit lanes; neither count fills the last word
+  const int lengths[] = {5, 16, 29};
+  const int nq = 45, nt = 1037;
+  int *want = malloc(sizeof(int) * nq * nt);
+  int *got = malloc(sizeof(int) * nq * nt);
+  SETOP_COUNT_OPTS opts = {.num_cpu_threads = 3};
+  unsigned int state = 4242;
+  for (int k = 0; k < 3; k++) {
+    const int len = lengths[k];
+    Bit_DB_T queries = BitDB_new(len, nq), targets = BitDB_new(len, nt);
+    Bit_T row = Bit_new(len);
+    for (int r = 0; r < nq + nt; r++) {
+      Bit_clear(row, 0, len - 1);
+      for (int b = 0; b < len / 2; b++) {
+        state = state * 1103515245u + 12345u;
+        Bit_bset(row, (int)((state >> 8) % (unsigned int)len));
+      }
+      BitDB_put_at(r < nq ? queries : targets, r < nq ? r : r - nq, row);
+    }
+    Bit_PDB_T pq = BitPDB_from_db(queries), pt = BitPDB_from_db(targets);
+    success &= BitPDB_nelem(pt) == nt && BitPDB_length(pt) == len;
+    success &= BitPDB_lane_bits(pt) == (len <= 8 ? 8 : len <= 16 ? 16 : 32);
+    success &= BitPDB_size_in_bytes(pt) < sizeof(uint64_t) * nt; // 1 per row
+
+    struct {
+      Bit_count_ops op;
+      void (*count)(Bit_DB_T, Bit_DB_T, int *, SETOP_COUNT_OPTS);
+    } ops[] = {{BIT_COUNT_INTER, BitDB_inter_count_store_cpu},
+               {BIT_COUNT_UNION, BitDB_union_count_store_cpu},
+               {BIT_COUNT_DIFF, BitDB_diff_count_store_cpu},
+               {BIT_COUNT_MINUS, BitDB_minus_count_store_cpu}};
+    for (int o = 0; o < 4; o++) {
+      ops[o].count(queries, targets, want, opts);
+      memset(got, 0xff, sizeof(int) * nq * nt);
+      BitPDB_count_store(pq, pt, ops[o].op, got, opts);
+      success &= memcmp(got, want, sizeof(int) * nq * nt) == 0;
+    }
+
+    // rows in and out, as words and as Bit_T
+    Bit_T back = BitPDB_get_from(pt, nt - 1);
+    Bit_T orig = BitDB_get_from(targets, nt - 1);
+    success &= Bit_eq(back, orig);
+    const uint32_t left = BitPDB_get_word(pt, 2);
+    const uint32_t right = BitPDB_get_word(pt, 4);
+    BitPDB_put_word(pt, 3, 1u << (len - 1));
+    success &= BitPDB_get_word(pt, 3) == 1u << (len - 1);
+    success &= BitPDB_get_word(pt, 2) == left; // lanes of the same word
+    success &= BitPDB_get_word(pt, 4) == right;
+    BitPDB_put_at(pt, 3, orig);
+    success &= BitPDB_get_word(pt, 3) == BitPDB_get_word(pt, nt - 1);
+    Bit_free(&back);
+    Bit_free(&orig);
+
+    BitPDB_free(&pq);
+    BitPDB_free(&pt);
+    success &= pt == NULL;
+    Bit_free(&row);
+    BitDB_free(&queries);
+    BitDB_free(&targets);
+  }
+  free(want);
+  free(got);
+  report_test(__func__, success);
+  return success;
+}
+
+bool test_bit_weighted() {
+  bool success = true;
+  // 1000 bits end inside a word; 13 x 29 rows split the blocks unevenly
+  const int len = 1000, nq = 13, nt = 29;
+  float *weights = malloc(sizeof(float) * len);
+  unsigned int state = 6007;
+  for (int b = 0; b < len; b++) {
+    state = state * 1103515245u + 12345u;
+    weights[b] = (float)((state >> 8) % 1000) / 250.0f;
+  }
+  Bit_W_T w = Bit_W_new(weights, len);
+  success &= Bit_W_length(w) == len;
+  Bit_DB_T queries = BitDB_new(len, nq), targets = BitDB_new(len, nt);
+  Bit_T row = Bit_new(len);
+  for (int r = 0; r < nq + nt; r++) {
+    Bit_clear(row, 0, len - 1);
+    for (int b = 0; b < 300; b++) {
+      state = state * 1103515245u + 12345u;
+      Bit_bset(row, (int)((state >> 8) % (unsigned int)len));
+    }
+    BitDB_put_at(r < nq ? queries : targets, r < nq ? r : r - nq, row);
+  }
+
+  const Bit_count_ops ops[] = {BIT_COUNT_INTER, BIT_COUNT_UNION,
+                               BIT_COUNT_DIFF, BIT_COUNT_MINUS};
+  float *sums = malloc(sizeof(float) * nq * nt);
+  SETOP_COUNT_OPTS opts = {.num_cpu_threads = 3};
+  for (int o = 0; o < 4; o++) {
+    BitDB_W_count_store(w, queries, targets, ops[o], sums, opts);
+    for (int i = 0; i < nq; i++) {
+      Bit_T s = BitDB_get_from(queries, i);
+      for (int j = 0; j < nt; j++) {
+        Bit_T t = BitDB_get_from(targets, j);
+        double want = 0.0;
+        for (int b = 0; b < len; b++) {
+          const bool x = Bit_get(s, b), y = Bit_get(t, b);
+          const bool in = ops[o] == BIT_COUNT_INTER   ? x && y
+                          : ops[o] == BIT_COUNT_UNION ? x || y
+                          : ops[o] == BIT_COUNT_DIFF  ? x != y
+                                                      : x && !y;
+          if (in)
+            want += weights[b];
+        }
+        const float got = Bit_W_setop_count(w, s, t, ops[o]);
+        success &= fabs(got - want) <= 1e-4 * (want + 1.0);
+        success &= sums[i * nt + j] == got;
+        Bit_free(&t);
+      }
+      Bit_free(&s);
+    }
+  }
+
+  // all weights of a full set; none of an empty one
+  Bit_set(row, 0, len - 1);
+  double total = 0.0;
+  for (int b = 0; b < len; b++)
+    total += weights[b];
+  success &= fabs(Bit_W_count(w, row) - total) <= 1e-4 * total;
+  Bit_clear(row, 0, len - 1);
+  success &= Bit_W_count(w, row) == 0.0f;
+
+  Bit_W_free(&w);
+  success &= w == NULL;
+  free(sums);
+  free(weights);
+  Bit_free(&row);
+  BitDB_free(&queries);
+  BitDB_free(&targets);
+  report_test(__func__, success);
+  return success;
+}
+
+bool test_bitdb_setop_store() {
+  bool success = true;
+  const int len = 777, nq = 5, nt = 23;
+  Bit_DB_T queries = BitDB_new(len, nq), targets = BitDB_new(len, nt);
+  Bit_T row = Bit_new(len);
+  unsigned int state = 3301;
+  for (int r = 0; r < nq + nt; r++) {
+    Bit_clear(row, 0, len - 1);
+    for (int b = 0; b < 200; b++) {
+      state = state * 1103515245u + 12345u;
+      Bit_bset(row, (int)((state >> 8) % (unsigned int)len));
+    }
+    BitDB_put_at(r < nq ? queries : targets, r < nq ? r : r - nq, row);
+  }
+  void (*stores[])(Bit_DB_T, Bit_DB_T, const int[], size_t, Bit_DB_T,
+                   SETOP_COUNT_OPTS) = {BitDB_inter_store, BitDB_union_store,
+                                        BitDB_diff_store, BitDB_minus_store};
+  Bit_T (*ops[])(Bit_T, Bit_T) = {Bit_inter, Bit_union, Bit_diff, Bit_minus};
+  SETOP_COUNT_OPTS opts = {.num_cpu_threads = 3};
+
+  // every pair, in count-matrix order, with row counts kept current
+  Bit_DB_T out = BitDB_new(len, nq * nt);
+  BitDB_cache_counts(out, true, opts);
+  for (int o = 0; o < 4; o++) {
+    stores[o](queries, targets, NULL, 0, out, opts);
+    for (int i = 0; i < nq; i++)
+      for (int j = 0; j < nt; j++) {
+        Bit_T s = BitDB_get_from(queries, i), t = BitDB_get_from(targets, j);
+        Bit_T want = ops[o](s, t);
+        const int m = (int)BitDB_counts_offset(targets, i, j);
+        Bit_T got = BitDB_get_from(out, m);
+        success &= Bit_eq(got, want);
+        success &= BitDB_count_at(out, m) == Bit_count(want);
+        Bit_free(&s);
+        Bit_free(&t);
+        Bit_free(&want);
+        Bit_free(&got);
+      }
+  }
+  BitDB_free(&out);
+
+  // listed pairs, repeats included
+  const int pairs[] = {4, 22, 0, 0, 4, 22, 2, 11};
+  out = BitDB_new(len, 4);
+  BitDB_minus_store(queries, targets, pairs, 4, out, opts);
+  for (int m = 0; m < 4; m++) {
+    Bit_T s = BitDB_get_from(queries, pairs[2 * m]);
+    Bit_T t = BitDB_get_from(targets, pairs[2 * m + 1]);
+    Bit_T want = Bit_minus(s, t), got = BitDB_get_from(out, m);
+    success &= Bit_eq(got, want);
+    Bit_free(&s);
+    Bit_free(&t);
+    Bit_free(&want);
+    Bit_free(&got);
+  }
+
+  BitDB_free(&out);
+  Bit_free(&row);
+  BitDB_free(&queries);
+  BitDB_free(&targets);
+  report_test(__func__, success);
+  return success;
+}
+
+bool test_bitdb_apply() {
+  bool success = true;
+  const int len = 1500, n = 41;
+  Bit_DB_T set = BitDB_new(len, n);
+  Bit_T row = Bit_new(len), mask = Bit_new(len);
+  unsigned int state = 515;
+  for (int r = 0; r <= n; r++) {
+    Bit_T dst = r < n ? row : mask;
+    Bit_clear(dst, 0, len - 1);
+    for (int b = 0; b < 500; b++) {
+      state = state * 1103515245u + 12345u;
+      Bit_bset(dst, (int)((state >> 8) % (unsigned int)len));
+    }
+    if (r < n)
+      BitDB_put_at(set, r, row);
+  }
+  const Bit_count_ops ops[] = {BIT_COUNT_INTER, BIT_COUNT_UNION,
+                               BIT_COUNT_DIFF, BIT_COUNT_MINUS};
+  Bit_T (*bit_ops[])(Bit_T, Bit_T) = {Bit_inter, Bit_union, Bit_diff,
+                                      Bit_minus};
+  SETOP_COUNT_OPTS opts = {.num_cpu_threads = 3};
+  BitDB_cache_counts(set, true, opts);
+  for (int o = 0; o < 4; o++) {
+    Bit_DB_T before = BitDB_new(len, n);
+    for (int r = 0; r < n; r++) {
+      Bit_T copy = BitDB_get_from(set, r);
+      BitDB_put_at(before, r, copy);
+      Bit_free(&copy);
+    }
+    // rows 10 .. 29 only, then all of them
+    const int first = o % 2 ? 0 : 10, count = o % 2 ? n : 20;
+    if (o % 2)
+      BitDB_apply(set, ops[o], mask, opts);
+    else
+      BitDB_apply_range(set, first, count, ops[o], mask, opts);
+    for (int r = 0; r < n; r++) {
+      Bit_T old = BitDB_get_from(before, r), got = BitDB_get_from(set, r);
+      Bit_T want = r >= first && r < first + count ? bit_ops[o](old, mask)
+                                                   : Bit_inter(old, old);
+      success &= Bit_eq(got, want);
+      success &= BitDB_count_at(set, r) == Bit_count(want);
+      Bit_free(&old);
+      Bit_free(&got);
+      Bit_free(&want);
+    }
+    BitDB_free(&before);
+  }
+  Bit_free(&row);
+  Bit_free(&mask);
+  BitDB_free(&set);
+  report_test(__func__, success);
+  return success;
+}
+
+/* Whether rows [0, n) of a and b hold the same bits */
+static bool db_rows_equal(Bit_DB_T a, Bit_DB_T b, int n) {
+  bool equal = true;
+  for (int r = 0; r < n && equal; r++) {
+    Bit_T x = BitDB_get_from(a, r), y = BitDB_get_from(b, r);
+    equal = Bit_eq(x, y);
+    Bit_free(&x);
+    Bit_free(&y);
+  }
+  return equal;
+}
+
+bool test_bitdb_snapshot() {
+  bool success = true;
+  const int len = 1000, n = 3000;
+  Bit_DB_T set = BitDB_new(len, n), before = BitDB_new(len, n);
+  Bit_T row = Bit_new(len);
+  unsigned int state = 777;
+  for (int r = 0; r < n; r++) {
+    Bit_clear(row, 0, len - 1);
+    for (int b = 0; b < 100; b++) {
+      state = state * 1103515245u + 12345u;
+      Bit_bset(row, (int)((state >> 8) % (unsigned int)len));
+    }
+    BitDB_put_at(set, r, row);
+    BitDB_put_at(before, r, row);
+  }
+  SETOP_COUNT_OPTS opts = {.num_cpu_threads = 2};
+
+  // two snapshots of one generation, then a rewrite of set
+  Bit_DB_T first = BitDB_snapshot(set), again = BitDB_snapshot(set);
+  success &= BitDB_nelem(first) == n && db_rows_equal(first, before, n);
+  Bit_clear(row, 0, len - 1);
+  Bit_set(row, 0, 99);
+  for (int r = 0; r < n; r += 7)
+    BitDB_put_at(set, r, row);
+  BitDB_apply_range(set, 100, 200, BIT_COUNT_MINUS, row, opts);
+  success &= db_rows_equal(first, before, n);
+  success &= db_rows_equal(again, before, n);
+  Bit_T got = BitDB_get_from(set, 7);
+  success &= Bit_eq(got, row);
+  Bit_free(&got);
+
+  // counts run on a snapshot as on any container
+  int *want = malloc(sizeof(int) * 4 * n), *counts = malloc(sizeof(int) * 4 * n);
+  Bit_DB_T queries = BitDB_new(len, 4);
+  BitDB_inter_count_store_cpu(queries, before, want, opts);
+  BitDB_inter_count_store_cpu(queries, first, counts, opts);
+  success &= memcmp(want, counts, sizeof(int) * 4 * n) == 0;
+
+  // while those are open a new generation is a copy
+  Bit_DB_T copy = BitDB_snapshot(set);
+  success &= db_rows_equal(copy, set, n);
+  BitDB_free(&first);
+  BitDB_free(&again);
+
+  // with them closed the changes go back into the shared rows
+  Bit_DB_T later = BitDB_snapshot(set);
+  success &= db_rows_equal(later, copy, n) && db_rows_equal(set, copy, n);
+  Bit_clear(row, 0, len - 1);
+  for (int r = 0; r < n; r += 5)
+    BitDB_put_at(set, r, row);
+  for (int r = 0; r < 2 * n; r++) // grows the storage
+    BitDB_append(set, row);
+  success &= db_rows_equal(later, copy, n);
+  success &= BitDB_nelem(set) == 3 * n && BitDB_count_at(set, 5) == 0;
+
+  // snapshots outlive their container
+  BitDB_free(&set);
+  success &= db_rows_equal(later, copy, n);
+  BitDB_free(&later);
+  BitDB_free(&copy);
+
+  // writes through a row view survive the merge of the next generation
+  Bit_DB_T viewed = BitDB_new(len, 64);
+  Bit_DB_T shot = BitDB_snapshot(viewed);
+  Bit_T view = NULL;
+  BitDB_view_at(viewed, 3, &view);
+  Bit_bset(view, 17);
+  BitDB_free(&shot);
+  shot = BitDB_snapshot(viewed);
+  success &= BitDB_count_at(viewed, 3) == 1 && BitDB_count_at(shot, 3) == 1;
+  Bit_free(&view);
+  BitDB_free(&shot);
+  BitDB_free(&viewed);
+  free(want);
+  free(counts);
+  Bit_free(&row);
+  BitDB_free(&queries);
+  BitDB_free(&before);
+  report_test(__func__, success);
+  return success;
+}
+
+bool test_bit_large_device() {
+  const int64_t length = 100003;
+  Bit_L_T s = Bit_L_new(length), t = Bit_L_new(length);
+  Bit_L_set(s, 10, 60009);
+  Bit_L_set(t, 40000, length - 1);
+  Bit_L_T want_inter = Bit_L_inter(s, t), want_union = Bit_L_union(s, t);
+  Bit_L_T out = Bit_L_new(length);
+  bool success = Bit_L_device(s) == -1;
+  Bit_L_device_attach(s, 0);
+  Bit_L_device_attach(t, 0);
+  Bit_L_device_attach(out, 0);
+  success = success && Bit_L_device(s) == 0 &&
+            Bit_L_count_gpu(s) == Bit_L_count(s) &&
+            Bit_L_inter_count_gpu(s, t) == Bit_L_inter_count(s, t) &&
+            Bit_L_union_count_gpu(s, t) == Bit_L_union_count(s, t) &&
+            Bit_L_diff_count_gpu(s, t) == Bit_L_diff_count(s, t) &&
+            Bit_L_minus_count_gpu(s, t) == Bit_L_minus_count(s, t);
+  // a chain on the device: out = s AND t, then a range, then out |= s
+  Bit_L_inter_into_gpu(out, s, t);
+  success = success && Bit_L_count_gpu(out) == 60009 - 40000 + 1 &&
+            Bit_L_leq_gpu(out, s) && Bit_L_leq_gpu(out, t) &&
+            !Bit_L_leq_gpu(s, t);
+  Bit_L_device_pull(out);
+  success = success && Bit_L_eq(out, want_inter);
+  Bit_L_union_into_gpu(out, out, t);
+  Bit_L_set_gpu(out, 10, 39999);
+  Bit_L_device_pull(out);
+  success = success && Bit_L_eq(out, want_union) && Bit_L_eq_gpu(out, out);
+  Bit_L_clear_gpu(out, 0, length - 1);
+  Bit_L_not_gpu(out, 5, 5);
+  success = success && Bit_L_count_gpu(out) == 1;
+  // a host write reaches the device with a push
+  Bit_L_bset(t, 0);
+  Bit_L_device_push(t);
+  Bit_L_minus_into_gpu(out, t, s);
+  Bit_L_diff_into_gpu(out, out, t);
+  success = success && Bit_L_count_gpu(out) == Bit_L_inter_count(s, t);
+  Bit_L_device_detach(out);
+  success = success && Bit_L_device(out) == -1;
+  Bit_L_free(&want_inter);
+  Bit_L_free(&want_union);
+  Bit_L_free(&out);
+  Bit_L_free(&t);
+  Bit_L_free(&s); // detaches
+  report_test(__func__, success);
+  return success;
+}
+
+bool test_bitdb_counts_gpu() {
+  Bit_DB_T bit = random_matrix(7, 300, 30, 11);
+  Bit_DB_T bits = random_matrix(23, 300, 45, 12);
+  SETOP_COUNT_OPTS opts = {0};
+  int want[23], got[23], cards_q[7], cards_t[23], want_q[7];
+  BitDB_count_store(bits, want, opts);
+  BitDB_count_store(bit, want_q, opts);
+  BitDB_count_store_gpu(bits, got, opts);
+  bool success = memcmp(want, got, sizeof(want)) == 0;
+  int *want_counts = BitDB_union_count(bit, bits, opts, cpu);
+  int counts[7 * 23];
+  BitDB_count_store_cards_gpu(bit, bits, BIT_COUNT_UNION, counts, cards_q,
+                              cards_t, opts);
+  success = success && memcmp(counts, want_counts, sizeof(counts)) == 0 &&
+            memcmp(cards_q, want_q, sizeof(cards_q)) == 0 &&
+            memcmp(cards_t, want, sizeof(cards_t)) == 0;
+  // Jaccard from one call: |A & B| / (|A| + |B| - |A & B|)
+  BitDB_count_store_cards_gpu(bit, bits, BIT_COUNT_INTER, counts, cards_q,
+                              NULL, opts);
+  success = success && counts[3 * 23 + 5] + want_counts[3 * 23 + 5] ==
+                           cards_q[3] + want[5];
+  free(want_counts);
+  uint32_t columns[300], want_columns[300];
+  BitDB_column_counts(bits, want_columns, opts);
+  BitDB_column_counts_gpu(bits, columns, opts);
+  success = success && memcmp(columns, want_columns, sizeof(columns)) == 0;
+  Bit_T out = Bit_new(300), want_out = Bit_new(300);
+  const Bit_reduce_op ops[] = {BIT_REDUCE_OR, BIT_REDUCE_AND, BIT_REDUCE_XOR,
+                               BIT_REDUCE_ATLEAST, BIT_REDUCE_MAJORITY};
+  for (int o = 0; o < 5; o++) {
+    BitDB_reduce(bits, ops[o], 9, want_out, opts);
+    BitDB_reduce_gpu(bits, ops[o], 9, out, opts);
+    success = success && Bit_eq(out, want_out);
+  }
+  Bit_free(&out);
+  Bit_free(&want_out);
+  BitDB_free(&bit);
+  BitDB_free(&bits);
+  report_test(__func__, success);
+  return success;
+}
+
+bool test_bitdb_count_histogram() {
+  Bit_DB_T bit = random_matrix(37, 130, 40, 21);
+  Bit_DB_T bits = random_matrix(150, 130, 25, 22);
+  SETOP_COUNT_OPTS opts = {.num_cpu_threads = 3};
+  const int nbins = 131;
+  int *counts = BitDB_minus_count(bit, bits, opts, cpu);
+  uint64_t want[131] = {0};
+  uint64_t *want_q = calloc((size_t)37 * nbins, sizeof(uint64_t));
+  for (int q = 0; q < 37; q++)
+    for (int t = 0; t < 150; t++) {
+      want[counts[q * 150 + t]]++;
+      want_q[q * nbins + counts[q * 150 + t]]++;
+    }
+  uint64_t hist[131];
+  uint64_t *hist_q = malloc((size_t)37 * nbins * sizeof(uint64_t));
+  BitDB_count_histogram_cpu(bit, bits, BIT_COUNT_MINUS, false, hist, opts);
+  bool success = memcmp(hist, want, sizeof(hist)) == 0;
+  BitDB_count_histogram_cpu(bit, bits, BIT_COUNT_MINUS, true, hist_q, opts);
+  success = success &&
+            memcmp(hist_q, want_q, (size_t)37 * nbins * sizeof(uint64_t)) == 0;
+  memset(hist, 0xff, sizeof(hist));
+  BitDB_count_histogram_gpu(bit, bits, BIT_COUNT_MINUS, false, hist, opts);
+  success = success && memcmp(hist, want, sizeof(hist)) == 0;
+  BitDB_count_histogram_gpu(bit, bits, BIT_COUNT_MINUS, true, hist_q, opts);
+  success = success &&
+            memcmp(hist_q, want_q, (size_t)37 * nbins * sizeof(uint64_t)) == 0;
+  free(counts);
+  free(want_q);
+  free(hist_q);
+  BitDB_free(&bit);
+  BitDB_free(&bits);
+  report_test(__func__, success);
+  return success;
+}
+
+bool test_bitdb_screened_search() {
+  // long rows, few hits: targets 0, 40 and 80 are copies of query 0
+  Bit_DB_T bit = random_matrix(3, 16384, 5, 31);
+  Bit_DB_T bits = random_matrix(120, 16384, 5, 32);
+  Bit_T row = BitDB_get_from(bit, 0);
+  BitDB_put_at(bits, 0, row);
+  BitDB_put_at(bits, 40, row);
+  BitDB_put_at(bits, 80, row);
+  Bit_free(&row);
+  SETOP_COUNT_OPTS opts = {0};
+  int words[32], random_words[32];
+  bool success = BitDB_screen_words(bits, 32, true, 0, words) == 32 &&
+                 BitDB_screen_words(bits, 32, false, 7, random_words) == 32;
+  for (int m = 1; m < 32; m++)
+    success = success && words[m - 1] < words[m] &&
+              random_words[m - 1] < random_words[m];
+  const int threshold = 500;
+  size_t want_offsets[4], offsets[4];
+  int *want_idx, *want_count, *idx, *count;
+  size_t want = BitDB_inter_count_threshold(bit, bits, threshold, opts,
+                                            want_offsets, &want_idx,
+                                            &want_count);
+  size_t got = BitDB_inter_count_screened(bit, bits, threshold, words, 32,
+                                          BIT_SCREEN_BOUND, opts, offsets,
+                                          &idx, &count);
+  success = success && want == 3 && got == want &&
+            memcmp(offsets, want_offsets, sizeof(offsets)) == 0 &&
+            memcmp(idx, want_idx, want * sizeof(int)) == 0 &&
+            memcmp(count, want_count, want * sizeof(int)) == 0;
+  free(idx);
+  free(count);
+  // an estimate can only lose matches, never invent them
+  got = BitDB_inter_count_screened(bit, bits, threshold, random_words, 32,
+                                   BIT_SCREEN_ESTIMATE, opts, offsets, &idx,
+                                   &count);
+  success = success && got == 3 && idx[0] == 0 && idx[2] == 80 &&
+            count[1] == want_count[1];
+  free(idx);
+  free(count);
+  free(want_idx);
+  free(want_count);
+  BitDB_free(&bit);
+  BitDB_free(&bits);
+  report_test(__func__, success);
+  return success;
+}
+
+bool test_bitdb_folded_search() {
+  // 2048 bit rows folded to 256; target 30 is a copy of query 1
+  Bit_DB_T bit = random_matrix(4, 2048, 3, 41);
+  Bit_DB_T bits = random_matrix(150, 2048, 3, 42);
+  Bit_T row = BitDB_get_from(bit, 1);
+  BitDB_put_at(bits, 30, row);
+  SETOP_COUNT_OPTS opts = {0};
+  Bit_DB_T folded = BitDB_fold(bits, 256, opts);
+  Bit_T frow = BitDB_get_from(folded, 30);
+  bool success = BitDB_length(folded) == 256 && BitDB_nelem(folded) == 150;
+  for (int i = 0; i < 2048; i++)
+    if (Bit_get(row, i))
+      success = success && Bit_get(frow, i % 256);
+  Bit_free(&frow);
+  Bit_free(&row);
+  size_t want_offsets[5], offsets[5];
+  int *want_idx, *want_count, *idx, *count;
+  size_t want = BitDB_inter_count_threshold(bit, bits, 5, opts, want_offsets,
+                                            &want_idx, &want_count);
+  size_t got = BitDB_inter_count_threshold_folded(
+      bit, bits, folded, 5, opts, offsets, &idx, &count);
+  success = success && want > 0 && got == want &&
+            memcmp(offsets, want_offsets, sizeof(offsets)) == 0 &&
+            memcmp(idx, want_idx, want * sizeof(int)) == 0 &&
+            memcmp(count, want_count, want * sizeof(int)) == 0;
+  free(idx);
+  free(count);
+  free(want_idx);
+  free(want_count);
+  // small counts tie often: the folded top-k breaks them the same way
+  int want_topk_idx[4 * 8], want_topk_count[4 * 8];
+  int topk_idx[4 * 8], topk_count[4 * 8];
+  BitDB_inter_count_topk(bit, bits, 8, opts, want_topk_idx, want_topk_count);
+  BitDB_inter_count_topk_folded(bit, bits, folded, 8, opts, topk_idx,
+                                topk_count);
+  success = success && want_topk_idx[8] == 30 &&
+            memcmp(topk_idx, want_topk_idx, sizeof(topk_idx)) == 0 &&
+            memcmp(topk_count, want_topk_count, sizeof(topk_count)) == 0;
+  BitDB_free(&folded);
+  BitDB_free(&bit);
+  BitDB_free(&bits);
+  report_test(__func__, success);
+  return success;
+}
+
+static int test_gemm_s8(void *ctx, int m, int n, int k, const int8_t *a,
+                        const int8_t *b, int32_t *c) {
+  int *calls = ctx;
+  (*calls)++;
+  for (int i = 0; i < m; i++)
+    for (int j = 0; j < n; j++) {
+      int32_t sum = 0;
+      for (int l = 0; l < k; l++)
+        sum += a[(size_t)i * k + l] * b[(size_t)j * k + l];
+      c[(size_t)i * n + j] = sum;
+    }
+  return 0;
+}
+
+static int test_gemm_fail(void *ctx, int m, int n, int k, const int8_t *a,
+                          const int8_t *b, int32_t *c) {
+  (void)ctx, (void)m, (void)n, (void)k, (void)a, (void)b, (void)c;
+  return -1;
+}
+
+bool test_bitdb_count_gemm() {
+  // 5000 bits span two word blocks of the products
+  Bit_DB_T bit = random_matrix(7, 5000, 20, 51);
+  Bit_DB_T bits = random_matrix(13, 5000, 20, 52);
+  SETOP_COUNT_OPTS opts = {0};
+  const Bit_count_ops ops[] = {BIT_COUNT_INTER, BIT_COUNT_UNION,
+                               BIT_COUNT_DIFF, BIT_COUNT_MINUS};
+  int want[7 * 13], got[7 * 13];
+  int calls = 0;
+  bool success = Bit_gemm_backend_name() == NULL &&
+                 !BitDB_count_store_gemm(bit, bits, BIT_COUNT_INTER, got, opts);
+  Bit_gemm_backend_set(&(Bit_gemm_backend){"test", test_gemm_s8, &calls});
+  success = success && strcmp(Bit_gemm_backend_name(), "test") == 0;
+  for (int o = 0; o < 4; o++) {
+    BitDB_count_store_typed_cpu(bit, bits, ops[o], want, BIT_COUNTS_I32, opts);
+    memset(got, 0xff, sizeof(got));
+    success = success &&
+              BitDB_count_store_gemm(bit, bits, ops[o], got, opts) &&
+              memcmp(got, want, sizeof(want)) == 0;
+  }
+  success = success && calls == 4 * 2;
+  // a failing GEMM falls back to the popcount kernels
+  Bit_gemm_backend_set(&(Bit_gemm_backend){"fail", test_gemm_fail, NULL});
+  memset(got, 0, sizeof(got));
+  success = success &&
+            !BitDB_count_store_gemm(bit, bits, BIT_COUNT_MINUS, got, opts) &&
+            memcmp(got, want, sizeof(want)) == 0;
+  Bit_gemm_backend_set(NULL);
+  success = success && Bit_gemm_backend_name() == NULL;
+  BitDB_free(&bit);
+  BitDB_free(&bits);
+  report_test(__func__, success);
+  return success;
+}
+
+bool test_bitdb_count_auto() {
+  Bit_DB_T queries = random_matrix(9, 700, 30, 61);
+  Bit_DB_T targets = random_matrix(300, 700, 30, 62);
+  SETOP_COUNT_OPTS opts = {0};
+  size_t size = BitDB_counts_size(queries, targets);
+  int *want = malloc(size * sizeof(int));
+  int *got = malloc(size * sizeof(int));
+  Bit_gpu_stats_reset();
+  bool success = true;
+  // the first calls calibrate; each lands on one engine and is logged
+  for (int rep = 0; rep < 3; rep++) {
+    BitDB_union_count_store_cpu(queries, targets, want, opts);
+    BitDB_union_count_store(queries, targets, opts, got, auto);
+    success = success && memcmp(want, got, size * sizeof(int)) == 0;
+    BitDB_minus_count_store_cpu(queries, targets, want, opts);
+    BitDB_minus_count_store(queries, targets, opts, got, auto);
+    success = success && memcmp(want, got, size * sizeof(int)) == 0;
+  }
+  int *counts = BitDB_inter_count(queries, targets, opts, auto);
+  BitDB_inter_count_store_cpu(queries, targets, want, opts);
+  success = success && memcmp(want, counts, size * sizeof(int)) == 0;
+  Bit_gpu_stats stats = Bit_gpu_stats_get();
+  success = success && stats.auto_cpu_calls + stats.auto_gpu_calls == 7 &&
+            stats.auto_cpu_estimate >= 0 && stats.auto_gpu_estimate >= 0;
+  // no device: always the CPU
+  opts.device_id = -1;
+  success = success && !BitDB_auto_uses_gpu(queries, targets, opts);
+  Bit_gpu_stats_reset();
+  stats = Bit_gpu_stats_get();
+  success = success && stats.auto_cpu_calls == 0 && stats.auto_gpu_calls == 0;
+  free(counts);
+  free(want);
+  free(got);
+  BitDB_free(&queries);
+  BitDB_free(&targets);
+  report_test(__func__, success);
+  return success;
+}
+
+bool test_bitdb_put_many() {
+  // 600 rows of 2000 bits pass the parallel threshold
+  const int n = 600, len = 2000;
+  Bit_T *rows = malloc(n * sizeof(Bit_T));
+  for (int i = 0; i < n; i++) {
+    rows[i] = Bit_new(len);
+    for (int b = i % 7; b < len; b += 3 + i % 5)
+      Bit_bset(rows[i], b);
+  }
+  Bit_DB_T set = BitDB_from_bitsets(rows, n);
+  Bit_DB_T got = BitDB_new(len, n + 10);
+  SETOP_COUNT_OPTS opts = {0};
+  BitDB_cache_counts(got, true, opts);
+  BitDB_put_many(got, 5, rows, n);
+  BitDB_put_many(got, 0, rows, 0);
+  bool success = BitDB_nelem(set) == n && BitDB_length(set) == len;
+  for (int i = 0; i < n; i++) {
+    Bit_T a = BitDB_get_from(set, i), b = BitDB_get_from(got, i + 5);
+    success = success && Bit_eq(a, rows[i]) && Bit_eq(b, rows[i]) &&
+              BitDB_count_at(got, i + 5) == Bit_count(rows[i]);
+    Bit_free(&a);
+    Bit_free(&b);
+  }
+  success = success && BitDB_count_at(got, 0) == 0 &&
+            BitDB_count_at(got, n + 9) == 0;
+  for (int i = 0; i < n; i++)
+    Bit_free(&rows[i]);
+  free(rows);
+  BitDB_free(&set);
+  BitDB_free(&got);
+  report_test(__func__, success);
+  return success;
+}
+
+bool test_bitdb_gather_scatter() {
+  Bit_DB_T set = random_matrix(400, 3000, 10, 71);
+  Bit_DB_T queries = random_matrix(3, 3000, 10, 72);
+  SETOP_COUNT_OPTS opts = {0};
+  int rows[150];
+  for (int j = 0; j < 150; j++)
+    rows[j] = (j * 37 + 11) % 400; // distinct, out of order
+  Bit_DB_T gathered = BitDB_gather(set, rows, 150, NULL, opts);
+  bool success = BitDB_nelem(gathered) == 150;
+  for (int j = 0; j < 150; j++) {
+    Bit_T a = BitDB_get_from(gathered, j), b = BitDB_get_from(set, rows[j]);
+    success = success && Bit_eq(a, b) && BitDB_row_ids(gathered)[j] == rows[j];
+    Bit_free(&a);
+    Bit_free(&b);
+  }
+  // a search over the gathered rows reports the rows of set
+  int want_idx[3 * 4], want_count[3 * 4], idx[3 * 4], count[3 * 4];
+  Bit_T row_mask = Bit_new(400);
+  for (int j = 0; j < 150; j++)
+    Bit_bset(row_mask, rows[j]);
+  SETOP_COUNT_OPTS masked = {.row_mask = row_mask};
+  BitDB_inter_count_topk(queries, set, 4, masked, want_idx, want_count);
+  BitDB_inter_count_topk(queries, gathered, 4, opts, idx, count);
+  success = success && memcmp(idx, want_idx, sizeof(idx)) == 0 &&
+            memcmp(count, want_count, sizeof(count)) == 0;
+  Bit_free(&row_mask);
+  // reused for fewer rows, cleared, and scattered back
+  success = success &&
+            BitDB_gather(set, rows, 20, gathered, opts) == gathered &&
+            BitDB_nelem(gathered) == 20;
+  BitDB_clear(gathered);
+  BitDB_scatter(set, rows, 20, gathered, opts);
+  bool cleared[400] = {false};
+  for (int j = 0; j < 20; j++)
+    cleared[rows[j]] = true;
+  for (int i = 0; i < 400; i++)
+    success = success && (BitDB_count_at(set, i) == 0) == cleared[i];
+  BitDB_free(&gathered);
+  BitDB_free(&set);
+  BitDB_free(&queries);
+  report_test(__func__, success);
+  return success;
+}
+
+/* The rows of set restricted to bits [lo, hi), as a container of their own */
+static Bit_DB_T segment_rows(Bit_DB_T set, int lo, int hi) {
+  const int n = BitDB_nelem(set);
+  Bit_T *rows = malloc(n * sizeof(Bit_T));
+  for (int i = 0; i < n; i++) {
+    Bit_T row = BitDB_get_from(set, i);
+    rows[i] = Bit_new(hi - lo);
+    for (int b = lo; b < hi; b++)
+      if (Bit_get(row, b))
+        Bit_bset(rows[i], b - lo);
+    Bit_free(&row);
+  }
+  Bit_DB_T segment = BitDB_from_bitsets(rows, n);
+  for (int i = 0; i < n; i++)
+    Bit_free(&rows[i]);
+  free(rows);
+  return segment;
+}
+
+bool test_bitdb_count_bit_range() {
+  Bit_DB_T queries = random_matrix(5, 1200, 30, 81);
+  Bit_DB_T targets = random_matrix(70, 1200, 30, 82);
+  // one word, whole words, both ends partial, no whole word, to the end
+  const int ranges[][2] = {{5, 10}, {64, 128}, {3, 1000}, {70, 130},
+                           {1024, 1200}};
+  bool success = true;
+  for (size_t r = 0; r < sizeof(ranges) / sizeof(ranges[0]); r++) {
+    const int lo = ranges[r][0], hi = ranges[r][1];
+    Bit_DB_T sq = segment_rows(queries, lo, hi);
+    Bit_DB_T st = segment_rows(targets, lo, hi);
+    SETOP_COUNT_OPTS opts = {0}, range = {.bit_lo = lo, .bit_hi = hi};
+    int *want = BitDB_union_count_cpu(sq, st, opts);
+    int *got = BitDB_union_count_cpu(queries, targets, range);
+    success = success && memcmp(got, want, 5 * 70 * sizeof(int)) == 0;
+    free(want);
+    free(got);
+    want = BitDB_minus_count_cpu(sq, st, opts);
+    got = malloc(5 * 70 * sizeof(int));
+    BitDB_count_store_typed_cpu(queries, targets, BIT_COUNT_MINUS, got,
+                                BIT_COUNTS_I32, range);
+    success = success && memcmp(got, want, 5 * 70 * sizeof(int)) == 0;
+    free(want);
+    free(got);
+    want = BitDB_inter_count_cpu(st, st, opts);
+    got = BitDB_inter_count_cpu(targets, targets, range);
+    success = success && memcmp(got, want, 70 * 70 * sizeof(int)) == 0;
+    free(want);
+    free(got);
+    BitDB_free(&sq);
+    BitDB_free(&st);
+  }
+  BitDB_free(&queries);
+  BitDB_free(&targets);
+  report_test(__func__, success);
+  return success;
+}
+
+bool test_bitrdb() {
+  enum { nrows = 40 };
+  Bit_T rows[nrows];
+  srand(91);
+  for (int i = 0; i < nrows; i++) { // 1 to ~5000 bits, a few long rows
+    const int length = i % 10 == 0 ? 4000 + rand() % 1000 : 1 + rand() % 700;
+    rows[i] = Bit_new(length);
+    for (int b = 0; b < length; b++)
+      if (rand() % 4 == 0)
+        Bit_bset(rows[i], b);
+  }
+  Bit_RDB_T set = BitRDB_from_bitsets(rows, nrows);
+  bool success = BitRDB_nelem(set) == nrows;
+  for (int i = 0; i < nrows; i++) {
+    Bit_T copy = BitRDB_get_from(set, i);
+    success = success && BitRDB_length_at(set, i) == Bit_length(rows[i]) &&
+              BitRDB_count_at(set, i) == Bit_count(rows[i]) &&
+              Bit_eq(copy, rows[i]);
+    Bit_free(&copy);
+  }
+  const Bit_count_ops ops[] = {BIT_COUNT_INTER, BIT_COUNT_UNION,
+                               BIT_COUNT_DIFF, BIT_COUNT_MINUS};
+  int *counts = malloc(nrows * nrows * sizeof(int));
+  int row_counts[nrows];
+  for (int o = 0; o < 4; o++) {
+    BitRDB_count_store(set, set, ops[o], counts, (SETOP_COUNT_OPTS){0});
+    BitRDB_query_count_store(rows[0], set, ops[o], row_counts,
+                             (SETOP_COUNT_OPTS){0});
+    for (int i = 0; i < nrows; i++)
+      for (int j = 0; j < nrows; j++) {
+        // bits past the end of a row count as clear
+        const int li = Bit_length(rows[i]), lj = Bit_length(rows[j]);
+        int want = 0;
+        for (int b = 0; b < (li > lj ? li : lj); b++) {
+          const int x = b < li && Bit_get(rows[i], b);
+          const int y = b < lj && Bit_get(rows[j], b);
+          want += ops[o] == BIT_COUNT_INTER   ? x & y
+                  : ops[o] == BIT_COUNT_UNION ? x | y
+                  : ops[o] == BIT_COUNT_DIFF  ? x ^ y
+                                              : x & !y;
+        }
+        success = success && counts[i * nrows + j] == want &&
+                  (i != 0 || row_counts[j] == want);
+      }
+  }
+  free(counts);
+  // a replaced row is counted anew
+  Bit_clear(rows[3], 0, Bit_length(rows[3]) - 1);
+  BitRDB_replace_at(set, 3, rows[3]);
+  success = success && BitRDB_count_at(set, 3) == 0;
+  for (int i = 0; i < nrows; i++)
+    Bit_free(&rows[i]);
+  BitRDB_free(&set);
+  success = success && set == NULL;
+  report_test(__func__, success);
+  return success;
+}
+
+bool test_bitdb_count_stats() {
+  Bit_DB_T queries = random_matrix(37, 700, 20, 101);
+  Bit_DB_T targets = random_matrix(300, 700, 20, 102);
+  SETOP_COUNT_OPTS opts = {0};
+  Bit_count_stats cpu[37], gpu[37];
+  int *want = BitDB_union_count_cpu(queries, targets, opts);
+  int *counts = malloc(37 * 300 * sizeof(int));
+  BitDB_count_stats_cpu(queries, targets, BIT_COUNT_UNION, cpu, counts, opts);
+  BitDB_count_stats_gpu(queries, targets, BIT_COUNT_UNION, gpu, NULL, opts);
+  bool success = memcmp(counts, want, 37 * 300 * sizeof(int)) == 0;
+  for (int q = 0; q < 37; q++) {
+    const int *row = want + q * 300;
+    double sum = 0;
+    int lo = row[0], hi = row[0];
+    for (int j = 0; j < 300; j++) {
+      sum += row[j];
+      lo = row[j] < lo ? row[j] : lo;
+      hi = row[j] > hi ? row[j] : hi;
+    }
+    const double mean = sum / 300;
+    double var = 0;
+    for (int j = 0; j < 300; j++)
+      var += (row[j] - mean) * (row[j] - mean);
+    var /= 300;
+    for (int d = 0; d < 2; d++) {
+      const Bit_count_stats *st = d ? &gpu[q] : &cpu[q];
+      success = success && fabs(st->mean - mean) < 1e-9 &&
+                fabs(st->variance - var) < 1e-6 && st->min == lo &&
+                st->max == hi;
+    }
+  }
+  free(want);
+  free(counts);
+  BitDB_free(&queries);
+  BitDB_free(&targets);
+  report_test(__func__, success);
+  return success;
+}
+
+bool test_bit_parallel_split() {
+  const int length = (40 << 20) + 17; // 5 MiB ranges of 1 MiB, ragged end
+  Bit_T a = Bit_new(length), b = Bit_new(length);
+  srand(111);
+  for (int i = 0; i < (1 << 20); i++) {
+    Bit_bset(a, rand() % length);
+    Bit_bset(b, rand() % length);
+  }
+  Bit_bset(b, length - 1); // found in the last range only
+  const uint64_t saved = Bit_parallel_threshold_get();
+  int serial[6], split[6];
+  for (int pass = 0; pass < 2; pass++) {
+    int *out = pass ? split : serial;
+    Bit_parallel_threshold_set(pass ? 1 : UINT64_MAX);
+    Bit_T u = Bit_union(a, b);
+    out[0] = Bit_count(u);
+    out[1] = Bit_inter_count(a, b);
+    out[2] = Bit_minus_count(b, a);
+    out[3] = Bit_eq(u, b);
+    out[4] = Bit_leq(a, u);
+    out[5] = Bit_intersects(a, b);
+    Bit_free(&u);
+  }
+  Bit_parallel_threshold_set(saved);
+  bool success = memcmp(serial, split, sizeof(serial)) == 0 &&
+                 Bit_parallel_threshold_get() == saved && !serial[3] &&
+                 serial[4];
+  Bit_free(&a);
+  Bit_free(&b);
+  report_test(__func__, success);
+  return success;
+}
+
+bool test_bit_to_indices() {
+  bool success = true;
+  // short, past the parallel threshold, and a ragged dense tail
+  const int lengths[] = {1, 70, 5000, (1 << 21) + 40};
+  srand(121);
+  for (int l = 0; l < 4; l++) {
+    const int length = lengths[l];
+    Bit_T set = Bit_new(length);
+    for (int i = 0; i < length; i++)
+      if (rand() % 5 == 0 || i > length - 100)
+        Bit_bset(set, i);
+    const int count = Bit_count(set);
+    int *want = malloc((count + 1) * sizeof(int));
+    int *out = malloc((count + 1) * sizeof(int));
+    int n = 0;
+    for (int i = Bit_next_set(set, 0); i >= 0; i = Bit_next_set(set, i + 1))
+      want[n++] = i;
+    success = success && Bit_to_indices(set, out, count) == count &&
+              memcmp(out, want, count * sizeof(int)) == 0;
+    // a short array takes the smallest indices, and nothing past max
+    const int max = count / 3;
+    out[max] = -7;
+    success = success && Bit_to_indices(set, out, max) == count &&
+              memcmp(out, want, max * sizeof(int)) == 0 && out[max] == -7;
+    success = success && Bit_to_indices(set, NULL, 0) == count;
+    free(want);
+    free(out);
+    Bit_free(&set);
+  }
+  report_test(__func__, success);
+  return success;
+}
+
+/* Whether the counts file at path holds the n x n matrix want */
+static bool pairs_file_matches(const char *path, Bit_counts_type type,
+                               const int *want, size_t n) {
+  const size_t size = type == BIT_COUNTS_U16 ? sizeof(uint16_t) : sizeof(int);
+  unsigned char *stored = malloc(n * n * size + 1);
+  FILE *file = fopen(path, "rb");
+  bool success = file && fread(stored, size, n * n, file) == n * n &&
+                 fgetc(file) == EOF;
+  for (size_t m = 0; m < n * n && success; m++)
+    success = type == BIT_COUNTS_U16 ? ((uint16_t *)stored)[m] == want[m]
+                                     : ((int *)stored)[m] == want[m];
+  if (file)
+    fclose(file);
+  free(stored);
+  return success;
+}
+
+bool test_bitdb_count_update_file() {
+  const int n = 300, added = 70, length = 200;
+  SETOP_COUNT_OPTS opts = {.num_cpu_threads = 3};
+  Bit_DB_T set = random_matrix(n, length, 20, 131);
+  Bit_DB_T fresh = random_matrix(added, length, 30, 137);
+  const char *path = "test_bitdb_count_update_file.bin";
+
+  // the change log: rows rewritten and appended after the file
+  BitDB_track_changes(set, true);
+  bool success = BitDB_count_store_file_cpu(set, set, BIT_COUNT_UNION,
+                                            BIT_COUNTS_U16, path, opts) == 0;
+  for (int i = 0; i < added; i++) {
+    Bit_T row = BitDB_get_from(fresh, i);
+    if (i < 3)
+      BitDB_put_at(set, 40 * i + 5, row);
+    else
+      BitDB_append(set, row);
+    Bit_free(&row);
+  }
+  success = success && BitDB_count_update_file_cpu(
+                           set, BIT_COUNT_UNION, BIT_COUNTS_U16, path, NULL,
+                           0, opts) == 0;
+  int *want = BitDB_union_count(set, set, opts, cpu);
+  success = success && pairs_file_matches(path, BIT_COUNTS_U16, want,
+                                          (size_t)BitDB_nelem(set));
+  free(want);
+
+  // listed rows, and MINUS, whose columns do not mirror the rows
+  success = success && BitDB_count_store_file_cpu(set, set, BIT_COUNT_MINUS,
+                                                  BIT_COUNTS_I32, path,
+                                                  opts) == 0;
+  const int rows[] = {0, 17, 250};
+  for (int k = 0; k < 3; k++) {
+    Bit_T row = BitDB_get_from(fresh, k + 10);
+    BitDB_put_at(set, rows[k], row);
+    Bit_free(&row);
+  }
+  BitDB_append_many(set, 5, NULL);
+  success = success && BitDB_count_update_file_cpu(
+                           set, BIT_COUNT_MINUS, BIT_COUNTS_I32, path, rows,
+                           3, opts) == 0;
+  want = BitDB_minus_count(set, set, opts, cpu);
+  success = success && pairs_file_matches(path, BIT_COUNTS_I32, want,
+                                          (size_t)BitDB_nelem(set));
+  free(want);
+
+  // nothing changed: the file stays as it is
+  success = success && BitDB_count_update_file_cpu(
+                           set, BIT_COUNT_MINUS, BIT_COUNTS_I32, path, NULL,
+                           0, opts) == 0;
+  want = BitDB_minus_count(set, set, opts, cpu);
+  success = success && pairs_file_matches(path, BIT_COUNTS_I32, want,
+                                          (size_t)BitDB_nelem(set));
+  free(want);
+
+  // not a square matrix of the type, and no file at all
+  FILE *file = fopen(path, "ab");
+  if (file) {
+    fputc(0, file);
+    fclose(file);
+  }
+  success = success && BitDB_count_update_file_cpu(
+                           set, BIT_COUNT_MINUS, BIT_COUNTS_I32, path, NULL,
+                           0, opts) == -1;
+  remove(path);
+  success = success && BitDB_count_update_file_cpu(
+                           set, BIT_COUNT_MINUS, BIT_COUNTS_I32, path, NULL,
+                           0, opts) == -1;
+
+  BitDB_free(&set);
+  BitDB_free(&fresh);
+  report_test(__func__, success);
+  return success;
+}
+
+bool test_bitdb_similarity_join() {
+  const int n = 500, length = 1000;
+  SETOP_COUNT_OPTS opts = {.num_cpu_threads = 3};
+  // sparse rows with near copies of earlier rows, and an empty row
+  Bit_DB_T set = random_matrix(n, length, 4, 139);
+  srand(149);
+  for (int i = n / 2; i < n; i += 2) {
+    Bit_T copy = BitDB_get_from(set, rand() % (n / 2));
+    for (int f = rand() % 6; f > 0; f--)
+      Bit_bset(copy, rand() % length);
+    BitDB_put_at(set, i, copy);
+    Bit_free(&copy);
+  }
+  BitDB_clear_at(set, 7);
+
+  const Bit_similarity sims[] = {{BIT_SIMILARITY_TANIMOTO, 0, 0},
+                                 {BIT_SIMILARITY_DICE, 0, 0},
+                                 {BIT_SIMILARITY_COSINE, 0, 0}};
+  const float cutoffs[] = {0.8f, 0.9f, 0.7f};
+  size_t *offsets = malloc((n + 1) * sizeof(size_t));
+  size_t *want_offsets = malloc((n + 1) * sizeof(size_t));
+  bool success = true;
+  for (int m = 0; m < 3 && success; m++) {
+    int *idx, *want_idx;
+    float *score, *want_score;
+    size_t total = BitDB_similarity_join(set, sims[m], cutoffs[m], opts,
+                                         offsets, &idx, &score);
+    BitDB_similarity_threshold(set, set, sims[m], cutoffs[m], opts,
+                               want_offsets, &want_idx, &want_score);
+    // the brute-force matches above the diagonal
+    size_t k = 0;
+    for (int i = 0; i < n && success; i++) {
+      success = offsets[i] == k;
+      for (size_t w = want_offsets[i]; w < want_offsets[i + 1] && success;
+           w++) {
+        if (want_idx[w] <= i)
+          continue;
+        success = k < total && idx[k] == want_idx[w] &&
+                  score[k] == want_score[w];
+        k++;
+      }
+    }
+    success = success && k == total && offsets[n] == total && total > 0;
+    free(idx);
+    free(score);
+    free(want_idx);
+    free(want_score);
+  }
+
+  // a reordered container reports the pairs of its rows' IDs
+  int *idx, *sorted_idx;
+  float *score, *sorted_score;
+  size_t *sorted_offsets = malloc((n + 1) * sizeof(size_t));
+  size_t total = BitDB_similarity_join(set, sims[0], 0.75f, opts, offsets,
+                                       &idx, &score);
+  BitDB_reorder(set, BIT_ORDER_COUNT, NULL, opts);
+  size_t sorted_total = BitDB_similarity_join(
+      set, sims[0], 0.75f, opts, sorted_offsets, &sorted_idx, &sorted_score);
+  success = success && total == sorted_total &&
+            memcmp(offsets, sorted_offsets, (n + 1) * sizeof(size_t)) == 0 &&
+            memcmp(idx, sorted_idx, total * sizeof(int)) == 0;
+
+  free(idx);
+  free(score);
+  free(sorted_idx);
+  free(sorted_score);
+  free(sorted_offsets);
+  free(offsets);
+  free(want_offsets);
+  BitDB_free(&set);
+  report_test(__func__, success);
+  return success;
+}
+
+bool test_bitdb_ksplit() {
+  const int length = (1 << 22) + 37; // few long rows, a partial last word
+  Bit_DB_T bit = random_matrix(3, length, 30, 151);
+  Bit_DB_T bits = random_matrix(2, length, 50, 157);
+  const Bit_count_ops ops[] = {BIT_COUNT_INTER, BIT_COUNT_UNION,
+                               BIT_COUNT_DIFF, BIT_COUNT_MINUS};
+  SETOP_COUNT_OPTS one = {.num_cpu_threads = 1};
+  SETOP_COUNT_OPTS team = {.num_cpu_threads = 4}; // splits the words
+  int want[9], got[9];
+  bool success = true;
+  for (int m = 0; m < 4 && success; m++) {
+    BitDB_count_store_typed_cpu(bit, bits, ops[m], want, BIT_COUNTS_I32, one);
+    BitDB_count_store_typed_cpu(bit, bits, ops[m], got, BIT_COUNTS_I32, team);
+    success = memcmp(want, got, 6 * sizeof(int)) == 0;
+    BitDB_count_store_typed_cpu(bit, bit, ops[m], want, BIT_COUNTS_I32, one);
+    BitDB_count_store_typed_cpu(bit, bit, ops[m], got, BIT_COUNTS_I32, team);
+    success = success && memcmp(want, got, 9 * sizeof(int)) == 0;
+  }
+
+  // partitions summed over "devices" (the CPU without a GPU)
+  Bit_DB_T bit_parts[3], bits_parts[3];
+  const int nparts = BitDB_column_partition(bit, 3, bit_parts, team);
+  const int nbits_parts = BitDB_column_partition(bits, 3, bits_parts, team);
+  success = success && nparts == 3 && nbits_parts == 3;
+  int total_length = 0;
+  for (int p = 0; p < nparts && success; p++)
+    total_length += BitDB_length(bit_parts[p]);
+  success = success && total_length == length;
+  for (int m = 0; m < 4 && success; m++) {
+    BitDB_count_store_typed_cpu(bit, bits, ops[m], want, BIT_COUNTS_I32, one);
+    BitDB_count_store_gpu_parts(bit_parts, bits_parts, nparts, ops[m], got,
+                                NULL, one);
+    success = memcmp(want, got, 6 * sizeof(int)) == 0;
+  }
+  for (int p = 0; p < nparts; p++)
+    BitDB_free(&bit_parts[p]);
+  for (int p = 0; p < nbits_parts; p++)
+    BitDB_free(&bits_parts[p]);
+  BitDB_free(&bit);
+  BitDB_free(&bits);
+  report_test(__func__, success);
+  return success;
+}
+
+bool test_bit_capture() {
+  const char *path = "test_bit_capture.cap";
+  Bit_DB_T bit = random_matrix(5, 300, 30, 163);
+  Bit_DB_T bits = random_matrix(7, 300, 40, 167);
+  SETOP_COUNT_OPTS opts = {.num_cpu_threads = 2};
+  int counts[35], idx[10], best[10];
+  bool success = Bit_capture_start(path, BIT_CAPTURE_DATA);
+
+  // the public count store runs the typed one inside: one record each
+  BitDB_inter_count_store_cpu(bit, bits, counts, opts);
+  BitDB_count_store_typed_cpu(bit, bit, BIT_COUNT_UNION, counts,
+                              BIT_COUNTS_I32, opts);
+  BitDB_inter_count_topk(bit, bits, 2, opts, idx, best);
+#pragma omp parallel num_threads(2)
+  {
+    int minus[35];
+    BitDB_minus_count_store_cpu(bit, bits, minus, opts);
+  }
+  success = success && Bit_capture_stop() == 5;
+  BitDB_inter_count_store_cpu(bit, bits, counts, opts); // not recorded
+
+  int *row_ones = BitDB_count(bit);
+  uint64_t ones = 0;
+  for (int i = 0; i < 5; i++)
+    ones += (uint64_t)row_ones[i];
+  free(row_ones);
+
+  size_t n = 0;
+  unsigned int flags = 0;
+  Bit_capture_record *r = Bit_capture_load(path, &n, &flags);
+  success = success && r && n == 5 && flags == BIT_CAPTURE_DATA;
+  if (success) {
+    success = r[0].call == BIT_CAPTURE_COUNT_CPU &&
+              r[0].op == BIT_COUNT_INTER && r[0].nqueries == 5 &&
+              r[0].ntargets == 7 && r[0].length == 300 && !r[0].self &&
+              r[0].num_cpu_threads == 2 && r[0].thread == 0 &&
+              r[0].ones_q == ones &&
+              r[1].call == BIT_CAPTURE_COUNT_CPU && r[1].self &&
+              r[1].op == BIT_COUNT_UNION && r[1].ones_t == r[1].ones_q &&
+              r[1].hash_t == r[1].hash_q && r[0].hash_q == r[1].hash_q &&
+              r[0].hash_t != r[0].hash_q &&
+              r[2].call == BIT_CAPTURE_TOPK_CPU && r[2].k == 2 &&
+              r[2].start_ns >= r[1].start_ns + r[1].elapsed_ns;
+    // the two threads of the team are numbered apart
+    success = success && r[3].op == BIT_COUNT_MINUS &&
+              r[4].op == BIT_COUNT_MINUS && r[3].thread != r[4].thread &&
+              (r[3].thread == 0 || r[4].thread == 0);
+  }
+  free(r);
+  remove(path);
+  BitDB_free(&bit);
+  BitDB_free(&bits);
+  report_test(__func__, success);
+  return success;
+}
+
+bool test_bit_memory() {
+  Bit_mem_stats base, now;
+  Bit_memory_stats(&base);
+  bool success = base.ndevices >= 0 && base.ndevices <= BIT_MEM_MAX_DEVICES;
+
+  Bit_T bit = Bit_new(1000);
+  Bit_DB_T db = BitDB_new(1000, 100); // rows of 128 bytes
+  void *pinned = Bit_pinned_alloc(4096);
+  Bit_memory_stats(&now);
+  success = success &&
+            now.bytes[BIT_MEM_BITSETS] >= base.bytes[BIT_MEM_BITSETS] + 128 &&
+            now.bytes[BIT_MEM_CONTAINERS] ==
+                base.bytes[BIT_MEM_CONTAINERS] + 100 * 128 &&
+            now.bytes[BIT_MEM_RESULTS] >= base.bytes[BIT_MEM_RESULTS] + 4096 &&
+            now.host_bytes >= base.host_bytes + 100 * 128 + 128 + 4096;
+  BitDB_reserve(db, 1000); // growth is charged as the new capacity
+  const char *path = "test_bit_memory.bdb";
+  success = success && BitDB_save(db, path) == 0;
+  Bit_DB_T mapped = BitDB_open_mmap(path, 0);
+  Bit_memory_stats(&now);
+  success = success && mapped &&
+            now.bytes[BIT_MEM_CONTAINERS] ==
+                base.bytes[BIT_MEM_CONTAINERS] + 1000 * 128 &&
+            now.bytes[BIT_MEM_MAPPED] > base.bytes[BIT_MEM_MAPPED];
+  if (mapped)
+    BitDB_free(&mapped);
+  remove(path);
+  BitDB_free(&db);
+  Bit_free(&bit);
+  Bit_pinned_free(pinned);
+  Bit_memory_stats(&now);
+  for (int c = BIT_MEM_BITSETS; c < BIT_MEM_DEVICE; c++)
+    success = success && now.bytes[c] == base.bytes[c];
+  success = success && now.host_bytes == base.host_bytes &&
+            now.peak[BIT_MEM_CONTAINERS] >=
+                base.bytes[BIT_MEM_CONTAINERS] + 1000 * 128;
+  Bit_memory_reset_peaks();
+  Bit_memory_stats(&now);
+  success = success &&
+            now.peak[BIT_MEM_CONTAINERS] == now.bytes[BIT_MEM_CONTAINERS] &&
+            now.host_peak == now.host_bytes;
+
+  // a context keeps what fits its budget; the rest is the call's own
+  Bit_DB_T queries = random_matrix(4, 1000, 30, 173);
+  Bit_DB_T targets = random_matrix(50, 1000, 30, 179);
+  int want_idx[12], want_count[12], idx[12], count[12];
+  BitDB_inter_count_topk(queries, targets, 3,
+                         (SETOP_COUNT_OPTS){.num_cpu_threads = 2}, want_idx,
+                         want_count);
+  Bit_memory_stats(&base);
+  Bit_ctx_T ctx = Bit_ctx_new(2, 0, NULL);
+  Bit_ctx_budget_set(ctx, 1024);
+  int *counts = Bit_ctx_counts(ctx, 200); // 800 bytes
+  success = success && counts && Bit_ctx_bytes(ctx) == 800 &&
+            Bit_ctx_counts(ctx, 300) == NULL &&
+            Bit_ctx_counts(ctx, 150) == counts;
+  BitDB_inter_count_topk(queries, targets, 3, Bit_ctx_opts(ctx), idx, count);
+  Bit_memory_stats(&now);
+  success = success && Bit_ctx_bytes(ctx) <= 1024 &&
+            memcmp(idx, want_idx, sizeof(idx)) == 0 &&
+            memcmp(count, want_count, sizeof(count)) == 0 &&
+            now.bytes[BIT_MEM_RESULTS] == base.bytes[BIT_MEM_RESULTS] + 800;
+  Bit_ctx_budget_set(ctx, 0);
+  BitDB_inter_count_topk(queries, targets, 3, Bit_ctx_opts(ctx), idx, count);
+  Bit_memory_stats(&now);
+  success = success && Bit_ctx_bytes(ctx) > 800 &&
+            now.bytes[BIT_MEM_SCRATCH] ==
+                base.bytes[BIT_MEM_SCRATCH] + Bit_ctx_bytes(ctx) - 800;
+  Bit_ctx_free(&ctx);
+  Bit_memory_stats(&now);
+  success = success &&
+            now.bytes[BIT_MEM_RESULTS] == base.bytes[BIT_MEM_RESULTS] &&
+            now.bytes[BIT_MEM_SCRATCH] == base.bytes[BIT_MEM_SCRATCH];
+  BitDB_free(&queries);
+  BitDB_free(&targets);
+  report_test(__func__, success);
+  return success;
+}
+
+bool test_bit_estimate() {
+  SETOP_COUNT_OPTS opts = {.num_cpu_threads = 2};
+  Bit_estimate_shape shape = {.nqueries = 256, .ntargets = 512,
+                              .length = 1024};
+  Bit_estimate cpu =
+      BitDB_estimate(BIT_COUNT_INTER, shape, opts, BIT_ESTIMATE_CPU);
+  bool success = cpu.seconds > 0 && cpu.calibrated && !cpu.gpu &&
+                 cpu.copy_bytes == 0 && cpu.copy_seconds == 0 &&
+                 cpu.peak_bytes == 256 * 512 * sizeof(int) &&
+                 cpu.memory_bytes >= (256 + 512) * 128 + cpu.peak_bytes;
+
+  // more targets or more ops take longer, a top-k holds k pairs per query
+  Bit_estimate_shape wide = shape;
+  wide.ntargets = 4096;
+  Bit_estimate all =
+      BitDB_estimate(BIT_COUNT_ALL, shape, opts, BIT_ESTIMATE_CPU);
+  shape.k = 10;
+  Bit_estimate topk =
+      BitDB_estimate(BIT_COUNT_INTER, shape, opts, BIT_ESTIMATE_CPU);
+  success = success &&
+            BitDB_estimate(BIT_COUNT_INTER, wide, opts, BIT_ESTIMATE_CPU)
+                    .seconds > cpu.seconds &&
+            all.seconds > cpu.seconds &&
+            topk.peak_bytes == 256 * 10 * 2 * sizeof(int);
+
+  // within an order of magnitude of the call it describes
+  Bit_DB_T queries = random_matrix(256, 1024, 30, 181);
+  Bit_DB_T targets = random_matrix(512, 1024, 30, 191);
+  int *counts = BitDB_inter_count_cpu(queries, targets, opts);
+  free(counts);
+  double best = -1;
+  for (int run = 0; run < 3; run++) {
+    struct timespec start, end;
+    timespec_get(&start, TIME_UTC);
+    counts = BitDB_inter_count_cpu(queries, targets, opts);
+    timespec_get(&end, TIME_UTC);
+    const double elapsed =
+        (end.tv_sec - start.tv_sec) + (end.tv_nsec - start.tv_nsec) * 1e-9;
+    free(counts);
+    if (best < 0 || elapsed < best)
+      best = elapsed;
+  }
+  success = success && best < 10 * cpu.seconds && cpu.seconds < 10 * best;
+  BitDB_free(&queries);
+  BitDB_free(&targets);
+
+  // a GPU estimate is the CPU one where its calls run on the CPU
+  opts.device_id = -1;
+  shape.k = 0;
+  Bit_estimate gpu =
+      BitDB_estimate(BIT_COUNT_INTER, shape, opts, BIT_ESTIMATE_GPU);
+  Bit_estimate best_of =
+      BitDB_estimate(BIT_COUNT_INTER, shape, opts, BIT_ESTIMATE_AUTO);
+  success = success && !gpu.gpu && gpu.copy_bytes == 0 && !best_of.gpu &&
+            gpu.peak_bytes == cpu.peak_bytes;
+  report_test(__func__, success);
+  return success;
+}
+
+bool test_bitidb() {
+  enum { nq = 37, nt = 70, length = 1000 };
+  Bit_DB_T queries = random_matrix(nq, length, 30, 193);
+  Bit_DB_T targets = random_matrix(nt, length, 30, 197);
+  Bit_T q_rows[nq], t_rows[nt];
+  for (int i = 0; i < nq; i++)
+    q_rows[i] = BitDB_get_from(queries, i);
+  for (int i = 0; i < nt; i++)
+    t_rows[i] = BitDB_get_from(targets, i);
+  Bit_IDB_T q = BitIDB_from_bitsets(q_rows, nq);
+  Bit_IDB_T t = BitIDB_from_bitsets(t_rows, nt);
+  bool success = BitIDB_nelem(q) == nq && BitIDB_nelem(t) == nt &&
+                 BitIDB_length(t) == length && BitIDB_get_at(t, 5) == t_rows[5];
+
+  // every op, with the default tuning and with small tiles and k_blocks
+  // that leave fringes and several passes over the words, prefetching
+  const Bit_count_ops ops[] = {BIT_COUNT_INTER, BIT_COUNT_UNION,
+                               BIT_COUNT_DIFF, BIT_COUNT_MINUS};
+  Bit_tuning small = {BIT_TUNING_BLOCK_DEFAULT, 8, 8, 2};
+  int *want = malloc(nq * nt * sizeof(int));
+  int *counts = malloc(nq * nt * sizeof(int));
+  for (int o = 0; o < 4; o++)
+    for (int tuned = 0; tuned < 2; tuned++) {
+      SETOP_COUNT_OPTS opts = {.num_cpu_threads = 2};
+      if (tuned)
+        opts.tuning = &small;
+      BitDB_count_store_typed_cpu(queries, targets, ops[o], want,
+                                  BIT_COUNTS_I32, opts);
+      memset(counts, 0xFF, nq * nt * sizeof(int));
+      BitIDB_count_store(q, t, ops[o], counts, opts);
+      success = success && memcmp(counts, want, nq * nt * sizeof(int)) == 0;
+    }
+
+  // the view reads the bitsets as they are, and follows a replaced row
+  Bit_bset(q_rows[0], 999);
+  Bit_T other = Bit_new(length);
+  Bit_set(other, 0, length - 1);
+  BitIDB_replace_at(t, 1, other);
+  BitIDB_count_store(q, t, BIT_COUNT_INTER, counts, (SETOP_COUNT_OPTS){0});
+  success = success && counts[1] == Bit_count(q_rows[0]) &&
+            counts[nt + 1] == Bit_count(q_rows[1]);
+  BitIDB_free(&q);
+  BitIDB_free(&t);
+  success = success && q == NULL && t == NULL;
+  free(want);
+  free(counts);
+  Bit_free(&other);
+  for (int i = 0; i < nq; i++)
+    Bit_free(&q_rows[i]);
+  for (int i = 0; i < nt; i++)
+    Bit_free(&t_rows[i]);
+  BitDB_free(&queries);
+  BitDB_free(&targets);
+  report_test(__func__, success);
+  return success;
+}
+
+bool test_bit_kernel_variants() {
+  enum { nq = 29, nt = 45, length = 1000 };
+  Bit_DB_T queries = random_matrix(nq, length, 30, 199);
+  Bit_DB_T targets = random_matrix(nt, length, 30, 211);
+  const int n = Bit_kernel_variants(NULL, 0);
+  Bit_kernel_variant *variants = malloc(n * sizeof(*variants));
+  bool success = n > 0 && Bit_kernel_variants(variants, n) == n;
+
+  // every generated kernel against the tuned counts of its op, with the
+  // default tuning and with tiles and k_blocks that leave fringes
+  Bit_tuning small = {BIT_TUNING_BLOCK_DEFAULT, 8, 8, 2};
+  int *want = malloc(nq * nt * sizeof(int));
+  int *counts = malloc(nq * nt * sizeof(int));
+  int aligned = 0;
+  for (int v = 0; v < n && success; v++) {
+    success = variants[v].name != NULL && variants[v].rows > 0 &&
+              variants[v].cols > 0 && variants[v].vec_blk > 0;
+    aligned += variants[v].aligned;
+    for (int tuned = 0; tuned < 2; tuned++) {
+      SETOP_COUNT_OPTS opts = {.num_cpu_threads = 2};
+      if (tuned)
+        opts.tuning = &small;
+      BitDB_count_store_typed_cpu(queries, targets, variants[v].op, want,
+                                  BIT_COUNTS_I32, opts);
+      memset(counts, 0xFF, nq * nt * sizeof(int));
+      BitDB_count_variant(queries, targets, v, counts, opts);
+      success = success && memcmp(counts, want, nq * nt * sizeof(int)) == 0;
+    }
+  }
+  // both load types of every block and op
+  success = success && 2 * aligned == n;
+  free(variants);
+  free(want);
+  free(counts);
+  BitDB_free(&queries);
+  BitDB_free(&targets);
+  report_test(__func__, success);
+  return success;
+}
+
+/* Bit i of row q of m is set iff want[q * nt + i] reaches threshold and
+   the target is in mask (NULL for all) */
+static bool threshold_bits_match(Bit_DB_T m, const int *want, int nq, int nt,
+                                 int threshold, Bit_T mask) {
+  Bit_T row = NULL;
+  bool match = BitDB_nelem(m) == nq && BitDB_length(m) == nt;
+  for (int q = 0; q < nq && match; q++) {
+    BitDB_view_at(m, q, &row);
+    for (int i = 0; i < nt && match; i++)
+      match = Bit_get(row, i) == (want[q * nt + i] >= threshold &&
+                                  (mask == NULL || Bit_get(mask, i)));
+  }
+  Bit_free(&row);
+  return match;
+}
+
+bool test_bit_threshold_bits() {
+  // past one query block and one target block, with a partial last word
+  enum { nq = 70, nt = 2100, length = 512 };
+  const int threshold = 48;
+  Bit_DB_T queries = random_matrix(nq, length, 30, 223);
+  Bit_DB_T targets = random_matrix(nt, length, 30, 227);
+  SETOP_COUNT_OPTS opts = {.num_cpu_threads = 2};
+  int *want = malloc((size_t)nq * nt * sizeof(int));
+  BitDB_count_store_typed_cpu(queries, targets, BIT_COUNT_INTER, want,
+                              BIT_COUNTS_I32, opts);
+  int hits = 0;
+  for (int m = 0; m < nq * nt; m++)
+    hits += want[m] >= threshold;
+  bool success = hits > 0 && hits < nq * nt;
+
+  Bit_DB_T cpu = BitDB_inter_count_threshold_bits(queries, targets,
+                                                  threshold, opts);
+  Bit_DB_T gpu = BitDB_inter_count_threshold_bits_gpu(queries, targets,
+                                                      threshold, opts);
+  Bit_DB_T all = BitDB_inter_count_threshold_bits(queries, targets, 0, opts);
+  success = success &&
+            threshold_bits_match(cpu, want, nq, nt, threshold, NULL) &&
+            threshold_bits_match(gpu, want, nq, nt, threshold, NULL) &&
+            threshold_bits_match(all, want, nq, nt, 0, NULL);
+
+  // a row mask clears the bits of the targets it leaves out
+  Bit_T mask = Bit_new(nt);
+  for (int i = 0; i < nt; i += 3)
+    Bit_bset(mask, i);
+  SETOP_COUNT_OPTS masked = {.num_cpu_threads = 2, .row_mask = mask};
+  Bit_DB_T sel = BitDB_inter_count_threshold_bits(queries, targets,
+                                                  threshold, masked);
+  Bit_DB_T sel_gpu = BitDB_inter_count_threshold_bits_gpu(
+      queries, targets, threshold, masked);
+  success = success &&
+            threshold_bits_match(sel, want, nq, nt, threshold, mask) &&
+            threshold_bits_match(sel_gpu, want, nq, nt, threshold, mask);
+
+  // reordered containers give the matrix of the rows by their IDs
+  int perm[nt], qperm[nq];
+  BitDB_reorder(targets, BIT_ORDER_COUNT_GRAY, perm, opts);
+  for (int q = 0; q < nq; q++)
+    qperm[q] = (q * 11 + 5) % nq; // 11 is prime to 70
+  BitDB_reorder(queries, BIT_ORDER_PERM, qperm, opts);
+  Bit_DB_T moved = BitDB_inter_count_threshold_bits(queries, targets,
+                                                    threshold, opts);
+  Bit_DB_T moved_gpu = BitDB_inter_count_threshold_bits_gpu(
+      queries, targets, threshold, opts);
+  success = success &&
+            threshold_bits_match(moved, want, nq, nt, threshold, NULL) &&
+            threshold_bits_match(moved_gpu, want, nq, nt, threshold, NULL);
+
+  // the matrix feeds the container counts: common neighbours of two rows
+  int *common = malloc((size_t)nq * nq * sizeof(int));
+  BitDB_inter_count_store_cpu(cpu, cpu, common, opts);
+  for (int a = 0; a < nq && success; a += 7)
+    for (int b = 0; b < nq && success; b += 5) {
+      int shared = 0;
+      for (int i = 0; i < nt; i++)
+        shared += want[a * nt + i] >= threshold &&
+                  want[b * nt + i] >= threshold;
+      success = common[a * nq + b] == shared;
+    }
 
+  free(common);
+  free(want);
+  Bit_free(&mask);
+  BitDB_free(&cpu);
+  BitDB_free(&gpu);
+  BitDB_free(&all);
+  BitDB_free(&sel);
+  BitDB_free(&sel_gpu);
+  BitDB_free(&moved);
+  BitDB_free(&moved_gpu);
+  BitDB_free(&queries);
+  BitDB_free(&targets);
   report_test(__func__, success);
   return success;
 }
@@ -464,30 +7036,40 @@ void run_tests() {
 
   // Basic operations
   test_bit_new();
+  test_bit_pool();
   test_bit_set();
   test_bit_clear();
   test_bit_put();
   test_bit_set_range();
   test_bit_clear_range();
+  test_bit_not_range();
+  test_bit_set_ranges();
   test_bit_count();
+  test_bit_next_prev_foreach();
+  test_bit_aget_sorted();
+  test_bit_rank_select();
 
   // Comparison operations
   test_bit_eq();
   test_bit_leq();
   test_bit_lt();
+  test_bit_intersects_disjoint();
 
   // Set operations
   test_bit_union();
   test_bit_inter();
   test_bit_minus();
   test_bit_diff();
+  test_bit_into_assign();
 
   // Count operations
   test_bit_count_operations();
+  test_bit_expr_count();
 
   // Use external buffers
   test_bit_extract();
   test_bit_load();
+  test_bit_load_misaligned();
 
   // Edge cases
   test_bit_null_handling();
@@ -498,6 +7080,110 @@ void run_tests() {
   test_bitDB_get_put();
   test_bitDB_extract_replace();
   test_bitDB_inter_count();
+  test_bitDB_count_cache();
+  test_bitDB_grow();
+  test_bitDB_view_at();
+  test_bitDB_padded();
+  test_bitDB_save_mmap();
+  test_bitDB_count_stream();
+  test_bitDB_topk_threshold();
+  test_bitDB_similarity();
+  test_bitDB_multi_count();
+  test_bit_tuning();
+  test_bitDB_sliced();
+  test_bitDB_self_join();
+  test_bitDB_numa();
+  test_bitDB_small_batch();
+  test_bit_ctx();
+  test_bitDB_query_count();
+  test_bitDB_query_queue();
+  test_bitDB_sort_by_count();
+  test_bitDB_typed_counts();
+  test_bitDB_gpu_algorithms();
+  test_bitDB_count_async();
+  test_bitDB_count_multi();
+  test_bitDB_device_attach();
+  test_bitDB_search_gpu();
+  test_bitDB_count_hybrid();
+  test_bitDB_pinned();
+  test_bit_gpu_stats();
+  test_bit_gpu_budget();
+  test_bit_gpu_word_bits();
+  test_bit_gpu_native();
+  test_bit_stats();
+  test_bit_configuration();
+  test_bit_compressed();
+  test_bit_rle();
+  test_bitsdb();
+  test_bit_large();
+  test_bit_summary();
+  test_bit_bloom();
+  test_bit_matrix();
+  test_bit_sketch();
+  test_bit_postings();
+  test_bit_bsi();
+  test_bit_load_text();
+  test_bit_writer();
+  test_bit_compressed_file();
+  test_bit_reader();
+  test_bit_count_tiles();
+  test_bit_huge_pages();
+  test_bit_shared();
+  test_bit_arrow();
+  test_bitDB_delta();
+  test_bit_count_tiled();
+  test_bitDB_concurrent();
+  test_bit_atomic_set();
+  test_bitDB_build_from_csr();
+  test_bit_count_batch();
+  test_bit_reduce();
+  test_bitDB_column_counts();
+  test_bitDB_row_mask();
+  test_bitDB_containment();
+  test_bit_mih();
+  test_fixed_width_kernels();
+  test_bit_inline_accessors();
+  test_bit_count_cache();
+  test_bit_shift_rotate_dilate();
+  test_bit_count_range();
+  test_bit_hash64();
+  test_bitdb_dedup();
+  test_bitdb_reorder();
+  test_bitdb_cancel();
+  test_bitdb_tile_hooks();
+  test_bitdb_exec_tasks();
+  test_bit_affinity();
+  test_bit_isa_policy();
+  test_bitdb_store_stream();
+  test_bitdb_recursive();
+  test_bitpdb_packed();
+  test_bit_weighted();
+  test_bitdb_setop_store();
+  test_bitdb_apply();
+  test_bitdb_snapshot();
+  test_bit_large_device();
+  test_bitdb_counts_gpu();
+  test_bitdb_count_histogram();
+  test_bitdb_screened_search();
+  test_bitdb_folded_search();
+  test_bitdb_count_gemm();
+  test_bitdb_count_auto();
+  test_bitdb_put_many();
+  test_bitdb_gather_scatter();
+  test_bitdb_count_bit_range();
+  test_bitrdb();
+  test_bitdb_count_stats();
+  test_bit_parallel_split();
+  test_bit_to_indices();
+  test_bitdb_count_update_file();
+  test_bitdb_similarity_join();
+  test_bitdb_ksplit();
+  test_bit_capture();
+  test_bit_memory();
+  test_bit_estimate();
+  test_bitidb();
+  test_bit_kernel_variants();
+  test_bit_threshold_bits();
 
   // Print summary
   printf("\nTest Summary:\n");
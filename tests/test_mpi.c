@@ -0,0 +1,185 @@
+#include "bit.h"
+#include <mpi.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define MPI_TEST_LENGTH 1000
+#define MPI_TEST_QUERIES 37
+#define MPI_TEST_TARGETS 53
+
+typedef struct {
+  int total;
+  int passed;
+  int failed;
+} TestResults;
+
+TestResults results = { 0, 0, 0 };
+int world_rank = 0;
+
+// Every rank must pass for a test to pass
+void report_test(const char* test_name, bool passed) {
+  int local = passed, all = 0;
+  MPI_Allreduce(&local, &all, 1, MPI_INT, MPI_LAND, MPI_COMM_WORLD);
+  results.total++;
+  if (all) {
+    if (world_rank == 0)
+      printf("PASS: %s\n", test_name);
+    results.passed++;
+  }
+  else {
+    if (world_rank == 0)
+      printf("FAIL: %s\n", test_name);
+    results.failed++;
+  }
+}
+
+// The same pseudo-random rows on every rank
+Bit_DB_T random_db(int nelem, unsigned int seed) {
+  Bit_DB_T db = BitDB_new(MPI_TEST_LENGTH, nelem);
+  Bit_T row = Bit_new(MPI_TEST_LENGTH);
+  for (int r = 0; r < nelem; r++) {
+    Bit_clear(row, 0, MPI_TEST_LENGTH - 1);
+    for (int b = 0; b < MPI_TEST_LENGTH; b++) {
+      seed = seed * 1103515245u + 12345u;
+      if ((seed >> 16) % 5 == 0)
+        Bit_bset(row, b);
+    }
+    BitDB_put_at(db, r, row);
+  }
+  Bit_free(&row);
+  return db;
+}
+
+// Global index of the first query of this rank's panel (rank order)
+int first_query(Bit_DB_T queries) {
+  int n = BitDB_nelem(queries), first = 0;
+  MPI_Exscan(&n, &first, 1, MPI_INT, MPI_SUM, MPI_COMM_WORLD);
+  return world_rank == 0 ? 0 : first;
+}
+
+bool test_mpi_count_tile(Bit_mpi_grid_T grid, Bit_DB_T queries,
+                         Bit_DB_T targets, Bit_DB_T bit, Bit_DB_T bits) {
+  SETOP_COUNT_OPTS opts = { 0 };
+  int* expected = malloc(sizeof(int) * MPI_TEST_QUERIES * MPI_TEST_TARGETS);
+  BitDB_diff_count_store_cpu(queries, targets, expected, opts);
+  Bit_mpi_tile tile;
+  Bit_mpi_count_tile_cpu(grid, bit, bits, BIT_COUNT_DIFF, opts, &tile);
+  bool success = tile.nquery > 0 && tile.ntarget > 0;
+  for (int q = 0; q < tile.nquery; q++)
+    for (int t = 0; t < tile.ntarget; t++)
+      success &= tile.counts[(size_t)q * tile.ntarget + t] ==
+                 expected[(size_t)(tile.first_query + q) * MPI_TEST_TARGETS +
+                          tile.first_target + t];
+
+  // The blocks cover the whole matrix exactly once
+  int cells = tile.nquery * tile.ntarget, all = 0;
+  MPI_Allreduce(&cells, &all, 1, MPI_INT, MPI_SUM, MPI_COMM_WORLD);
+  success &= all == MPI_TEST_QUERIES * MPI_TEST_TARGETS;
+
+  Bit_mpi_count_tile_gpu(grid, bit, bits, BIT_COUNT_DIFF, opts, &tile);
+  for (int q = 0; q < tile.nquery; q++)
+    for (int t = 0; t < tile.ntarget; t++)
+      success &= tile.counts[(size_t)q * tile.ntarget + t] ==
+                 expected[(size_t)(tile.first_query + q) * MPI_TEST_TARGETS +
+                          tile.first_target + t];
+  free(tile.counts);
+  free(expected);
+  report_test(__func__, success);
+  return success;
+}
+
+bool test_mpi_inter_count_topk(Bit_mpi_grid_T grid, Bit_DB_T queries,
+                               Bit_DB_T targets, Bit_DB_T bit,
+                               Bit_DB_T bits) {
+  SETOP_COUNT_OPTS opts = { 0 };
+  const int k = 5, n = BitDB_nelem(bit), first = first_query(bit);
+  int* idx = malloc(sizeof(int) * MPI_TEST_QUERIES * k);
+  int* count = malloc(sizeof(int) * MPI_TEST_QUERIES * k);
+  int* got_idx = malloc(sizeof(int) * n * k);
+  int* got_count = malloc(sizeof(int) * n * k);
+  BitDB_inter_count_topk(queries, targets, k, opts, idx, count);
+  Bit_mpi_inter_count_topk(grid, bit, bits, k, opts, got_idx, got_count);
+  bool success =
+    memcmp(got_idx, idx + (size_t)first * k, sizeof(int) * n * k) == 0 &&
+    memcmp(got_count, count + (size_t)first * k, sizeof(int) * n * k) == 0;
+  Bit_mpi_inter_count_topk_gpu(grid, bit, bits, k, opts, got_idx, got_count);
+  success &=
+    memcmp(got_count, count + (size_t)first * k, sizeof(int) * n * k) == 0;
+  free(idx);
+  free(count);
+  free(got_idx);
+  free(got_count);
+  report_test(__func__, success);
+  return success;
+}
+
+bool test_mpi_inter_count_threshold(Bit_mpi_grid_T grid, Bit_DB_T queries,
+                                    Bit_DB_T targets, Bit_DB_T bit,
+                                    Bit_DB_T bits) {
+  SETOP_COUNT_OPTS opts = { 0 };
+  const int threshold = 45, n = BitDB_nelem(bit), first = first_query(bit);
+  size_t offsets[MPI_TEST_QUERIES + 1], got_offsets[MPI_TEST_QUERIES + 1];
+  int *idx, *count, *got_idx, *got_count;
+  BitDB_inter_count_threshold(queries, targets, threshold, opts, offsets,
+                              &idx, &count);
+  size_t total = Bit_mpi_inter_count_threshold(
+    grid, bit, bits, threshold, opts, got_offsets, &got_idx, &got_count);
+  bool success = total == offsets[first + n] - offsets[first];
+  for (int q = 0; success && q < n; q++) {
+    size_t e = offsets[first + q], g = got_offsets[q];
+    success = got_offsets[q + 1] - g == offsets[first + q + 1] - e;
+    for (; success && g < got_offsets[q + 1]; e++, g++)
+      success = got_idx[g] == idx[e] && got_count[g] == count[e];
+  }
+  long long matches = (long long)total, all = 0;
+  MPI_Allreduce(&matches, &all, 1, MPI_LONG_LONG, MPI_SUM, MPI_COMM_WORLD);
+  success &= all == (long long)offsets[MPI_TEST_QUERIES] && all > 0;
+  free(idx);
+  free(count);
+  free(got_idx);
+  free(got_count);
+  report_test(__func__, success);
+  return success;
+}
+
+void run_tests(void) {
+  Bit_mpi_grid_T grid = Bit_mpi_grid_new(MPI_COMM_WORLD, 0, 0);
+  Bit_DB_T queries = random_db(MPI_TEST_QUERIES, 7);
+  Bit_DB_T targets = random_db(MPI_TEST_TARGETS, 11);
+  Bit_DB_T bit = Bit_mpi_scatter(grid, world_rank == 0 ? queries : NULL, 0,
+                                 false);
+  Bit_DB_T bits = Bit_mpi_scatter(grid, world_rank == 0 ? targets : NULL, 0,
+                                  true);
+  int rows, cols;
+  Bit_mpi_grid_shape(grid, &rows, &cols, NULL, NULL);
+  if (world_rank == 0)
+    printf("Process grid: %d x %d\n", rows, cols);
+
+  test_mpi_count_tile(grid, queries, targets, bit, bits);
+  test_mpi_inter_count_topk(grid, queries, targets, bit, bits);
+  test_mpi_inter_count_threshold(grid, queries, targets, bit, bits);
+
+  BitDB_free(&bit);
+  BitDB_free(&bits);
+  BitDB_free(&queries);
+  BitDB_free(&targets);
+  Bit_mpi_grid_free(&grid);
+}
+
+int main(int argc, char* argv[]) {
+  MPI_Init(&argc, &argv);
+  MPI_Comm_rank(MPI_COMM_WORLD, &world_rank);
+  run_tests();
+  MPI_Finalize();
+
+  if (results.failed > 0) {
+    if (world_rank == 0)
+      printf("\nSome tests failed!\n");
+    return 1;
+  }
+  if (world_rank == 0)
+    printf("\nAll tests passed!\n");
+  return 0;
+}